@@ -0,0 +1,261 @@
+##
+##   ______                              _
+##  / _____)             _              | |
+## ( (____  _____ ____ _| |_ _____  ____| |__
+##  \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+##  _____) ) ____| | | || |_| ____( (___| | | |
+## (______/|_____)_|_|_| \__)_____)\____)_| |_|
+## (C)2013-2017 Semtech
+##  ___ _____ _   ___ _  _____ ___  ___  ___ ___
+## / __|_   _/_\ / __| |/ / __/ _ \| _ \/ __| __|
+## \__ \ | |/ _ \ (__| ' <| _| (_) |   / (__| _|
+## |___/ |_/_/ \_\___|_|\_\_| \___/|_|_\\___|___|
+## embedded.connectivity.solutions.==============
+##
+## License:  Revised BSD License, see LICENSE.TXT file included in the project
+##
+## Footprint report script run by the targets of generate_footprint_report
+##
+## Input variables:
+##   NM              - nm tool of the toolchain
+##   OBJECTS_FILE    - Object libraries objects, one "module|object" entry per line
+##   APP_NAME        - Application target name
+##   APP_OBJECTS_DIR - Directory of the application own objects
+##   OUTPUT_FILE     - Report file, one "data|bss|stack <name> <bytes>" entry per line
+##   BASELINE_FILE   - Optional report of a previous build to compare against
+##
+cmake_minimum_required(VERSION 3.18)
+
+# Number of listed largest static RAM symbols
+set(NB_LARGEST_SYMBOLS 10)
+
+#---------------------------------------------------------------------------------------
+# Left justifies VALUE on WIDTH characters
+#---------------------------------------------------------------------------------------
+function(footprint_pad OUT VALUE WIDTH)
+    string(LENGTH "${VALUE}" LENGTH)
+    while(LENGTH LESS WIDTH)
+        string(APPEND VALUE " ")
+        math(EXPR LENGTH "${LENGTH} + 1")
+    endwhile()
+    set(${OUT} "${VALUE}" PARENT_SCOPE)
+endfunction()
+
+#---------------------------------------------------------------------------------------
+# Appends a "KIND NAME BYTES" report entry to the REPORT and TABLE variables, the table
+# shows the difference with the baseline
+#---------------------------------------------------------------------------------------
+macro(footprint_add_entry KIND NAME BYTES)
+    string(APPEND REPORT "${KIND} ${NAME} ${BYTES}\n")
+    string(MAKE_C_IDENTIFIER "${KIND}_${NAME}" ENTRY_ID)
+    footprint_pad(ENTRY_ROW "  ${NAME}" 40)
+    footprint_pad(ENTRY_BYTES "${BYTES}" 8)
+    string(APPEND ENTRY_ROW "${ENTRY_BYTES}")
+    if(DEFINED BASELINE_${ENTRY_ID})
+        math(EXPR ENTRY_DELTA "${BYTES} - ${BASELINE_${ENTRY_ID}}")
+        if(ENTRY_DELTA GREATER 0)
+            string(APPEND ENTRY_ROW "(+${ENTRY_DELTA})")
+        elseif(ENTRY_DELTA LESS 0)
+            string(APPEND ENTRY_ROW "(${ENTRY_DELTA})")
+        endif()
+    elseif(BASELINE_FILE)
+        string(APPEND ENTRY_ROW "(new)")
+    endif()
+    string(STRIP "${ENTRY_ROW}" ENTRY_ROW)
+    set(ENTRY_ROW "  ${ENTRY_ROW}")
+    string(APPEND TABLE "${ENTRY_ROW}\n")
+endmacro()
+
+#---------------------------------------------------------------------------------------
+# Computes the maximum stack depth from function ID into the FOOTPRINT_DEPTH_<ID>
+# global property. FOOTPRINT_FLAGS_<ID> lists what the depth does not count: the
+# unbounded dynamic stack allocations, the indirect calls and the recursions.
+#---------------------------------------------------------------------------------------
+function(footprint_stack_depth ID)
+    set_property(GLOBAL PROPERTY FOOTPRINT_PATH_${ID} ON)
+    set(FLAGS "")
+    set(MAX_CALLEE_DEPTH 0)
+    if(DYNAMIC_${ID})
+        list(APPEND FLAGS "dynamic allocations")
+    endif()
+    set(CALLEES ${CALLEES_${ID}})
+    if(CALLEES)
+        list(REMOVE_DUPLICATES CALLEES)
+    endif()
+    foreach(CALLEE ${CALLEES})
+        if(CALLEE STREQUAL "__indirect_call")
+            list(APPEND FLAGS "indirect calls")
+            continue()
+        endif()
+        # The toolchain libraries functions have no stack usage information
+        if(NOT DEFINED FRAME_${CALLEE})
+            continue()
+        endif()
+        get_property(ON_PATH GLOBAL PROPERTY FOOTPRINT_PATH_${CALLEE})
+        if(ON_PATH)
+            list(APPEND FLAGS recursion)
+            continue()
+        endif()
+        get_property(DONE GLOBAL PROPERTY FOOTPRINT_DEPTH_${CALLEE} SET)
+        if(NOT DONE)
+            footprint_stack_depth(${CALLEE})
+        endif()
+        get_property(CALLEE_DEPTH GLOBAL PROPERTY FOOTPRINT_DEPTH_${CALLEE})
+        get_property(CALLEE_FLAGS GLOBAL PROPERTY FOOTPRINT_FLAGS_${CALLEE})
+        if(CALLEE_DEPTH GREATER MAX_CALLEE_DEPTH)
+            set(MAX_CALLEE_DEPTH ${CALLEE_DEPTH})
+        endif()
+        list(APPEND FLAGS ${CALLEE_FLAGS})
+    endforeach()
+    if(FLAGS)
+        list(REMOVE_DUPLICATES FLAGS)
+    endif()
+    math(EXPR DEPTH "${FRAME_${ID}} + ${MAX_CALLEE_DEPTH}")
+    set_property(GLOBAL PROPERTY FOOTPRINT_DEPTH_${ID} ${DEPTH})
+    set_property(GLOBAL PROPERTY FOOTPRINT_FLAGS_${ID} "${FLAGS}")
+    set_property(GLOBAL PROPERTY FOOTPRINT_PATH_${ID} OFF)
+endfunction()
+
+#---------------------------------------------------------------------------------------
+# Baseline report
+#---------------------------------------------------------------------------------------
+if(BASELINE_FILE)
+    if(NOT EXISTS ${BASELINE_FILE})
+        message(FATAL_ERROR "Footprint baseline ${BASELINE_FILE} not found")
+    endif()
+    file(STRINGS ${BASELINE_FILE} BASELINE_LINES)
+    foreach(LINE ${BASELINE_LINES})
+        if(LINE MATCHES "^([a-z]+) ([^ ]+) ([0-9]+)$")
+            string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_1}_${CMAKE_MATCH_2}" ENTRY_ID)
+            set(BASELINE_${ENTRY_ID} ${CMAKE_MATCH_3})
+        endif()
+    endforeach()
+endif()
+
+#---------------------------------------------------------------------------------------
+# Static RAM per module
+#---------------------------------------------------------------------------------------
+file(STRINGS ${OBJECTS_FILE} ENTRIES)
+file(GLOB_RECURSE APP_OBJECTS ${APP_OBJECTS_DIR}/*.o ${APP_OBJECTS_DIR}/*.obj)
+foreach(OBJECT ${APP_OBJECTS})
+    list(APPEND ENTRIES "${APP_NAME}|${OBJECT}")
+endforeach()
+
+set(MODULES "")
+set(SYMBOLS "")
+set(CALLGRAPH_FILES "")
+foreach(ENTRY ${ENTRIES})
+    if(NOT ENTRY MATCHES "^([^|]+)\\|(.+)$")
+        continue()
+    endif()
+    set(MODULE ${CMAKE_MATCH_1})
+    set(OBJECT ${CMAKE_MATCH_2})
+    if(NOT MODULE IN_LIST MODULES)
+        list(APPEND MODULES ${MODULE})
+        set(DATA_${MODULE} 0)
+        set(BSS_${MODULE} 0)
+    endif()
+
+    execute_process(COMMAND ${NM} -S ${OBJECT} OUTPUT_VARIABLE NM_OUTPUT RESULT_VARIABLE NM_RESULT)
+    if(NOT NM_RESULT EQUAL 0)
+        message(FATAL_ERROR "${NM} failed on ${OBJECT}")
+    endif()
+    string(REPLACE "\n" ";" NM_LINES "${NM_OUTPUT}")
+    foreach(LINE ${NM_LINES})
+        if(LINE MATCHES "^[0-9a-fA-F]+ ([0-9a-fA-F]+) ([bBcCdD]) (.+)$")
+            math(EXPR SIZE "0x${CMAKE_MATCH_1}")
+            list(APPEND SYMBOLS "${SIZE}|${CMAKE_MATCH_3}|${MODULE}")
+            if(CMAKE_MATCH_2 MATCHES "[dD]")
+                math(EXPR DATA_${MODULE} "${DATA_${MODULE}} + ${SIZE}")
+            else()
+                math(EXPR BSS_${MODULE} "${BSS_${MODULE}} + ${SIZE}")
+            endif()
+        endif()
+    endforeach()
+
+    # GCC writes the call graph next to the object
+    string(REGEX REPLACE "\\.(o|obj)$" ".ci" CALLGRAPH_FILE ${OBJECT})
+    if(NOT EXISTS ${CALLGRAPH_FILE})
+        message(FATAL_ERROR "${CALLGRAPH_FILE} not found, the footprint report requires FOOTPRINT_REPORT_ENABLED")
+    endif()
+    list(APPEND CALLGRAPH_FILES ${CALLGRAPH_FILE})
+endforeach()
+
+set(REPORT "")
+set(TABLE "Footprint of ${APP_NAME}\n")
+if(BASELINE_FILE)
+    string(APPEND TABLE "Compared to ${BASELINE_FILE}\n")
+endif()
+
+set(TOTAL_DATA 0)
+set(TOTAL_BSS 0)
+string(APPEND TABLE "\n.data [bytes]\n")
+foreach(MODULE ${MODULES})
+    footprint_add_entry(data ${MODULE} ${DATA_${MODULE}})
+    math(EXPR TOTAL_DATA "${TOTAL_DATA} + ${DATA_${MODULE}}")
+endforeach()
+footprint_add_entry(data total ${TOTAL_DATA})
+string(APPEND TABLE "\n.bss [bytes]\n")
+foreach(MODULE ${MODULES})
+    footprint_add_entry(bss ${MODULE} ${BSS_${MODULE}})
+    math(EXPR TOTAL_BSS "${TOTAL_BSS} + ${BSS_${MODULE}}")
+endforeach()
+footprint_add_entry(bss total ${TOTAL_BSS})
+
+string(APPEND TABLE "\nLargest static RAM symbols [bytes]\n")
+list(SORT SYMBOLS COMPARE NATURAL ORDER DESCENDING)
+list(LENGTH SYMBOLS NB_SYMBOLS)
+if(NB_SYMBOLS GREATER NB_LARGEST_SYMBOLS)
+    list(SUBLIST SYMBOLS 0 ${NB_LARGEST_SYMBOLS} SYMBOLS)
+endif()
+foreach(SYMBOL ${SYMBOLS})
+    string(REPLACE "|" ";" FIELDS "${SYMBOL}")
+    list(GET FIELDS 0 SIZE)
+    list(GET FIELDS 1 NAME)
+    list(GET FIELDS 2 MODULE)
+    footprint_pad(ROW "  ${NAME} ( ${MODULE} )" 40)
+    string(APPEND TABLE "${ROW}${SIZE}\n")
+endforeach()
+
+#---------------------------------------------------------------------------------------
+# Maximum stack depth per entry point
+#---------------------------------------------------------------------------------------
+set(FUNCTIONS "")
+foreach(CALLGRAPH_FILE ${CALLGRAPH_FILES})
+    file(STRINGS ${CALLGRAPH_FILE} LINES)
+    foreach(LINE ${LINES})
+        if(LINE MATCHES "^node: { title: \"([^\"]+)\" label: \"[^\"]*\\\\n([0-9]+) bytes \\(([a-z,]+)\\)\"")
+            string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_1}" ID)
+            set(NAME_${ID} "${CMAKE_MATCH_1}")
+            set(FRAME_${ID} ${CMAKE_MATCH_2})
+            if(CMAKE_MATCH_3 STREQUAL "dynamic")
+                set(DYNAMIC_${ID} ON)
+            endif()
+            list(APPEND FUNCTIONS ${ID})
+        elseif(LINE MATCHES "^edge: { sourcename: \"([^\"]+)\" targetname: \"([^\"]+)\"")
+            string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_1}" CALLER)
+            string(MAKE_C_IDENTIFIER "${CMAKE_MATCH_2}" CALLEE)
+            list(APPEND CALLEES_${CALLER} ${CALLEE})
+            set(CALLED_${CALLEE} ON)
+        endif()
+    endforeach()
+endforeach()
+
+# The entry points are main and the interrupt vectors nobody calls
+string(APPEND TABLE "\nMaximum stack depth [bytes]\n")
+foreach(ID ${FUNCTIONS})
+    if(( NAME_${ID} STREQUAL "main" ) OR ( ( NAME_${ID} MATCHES "(IRQ|_)Handler$" ) AND ( NOT CALLED_${ID} ) ))
+        footprint_stack_depth(${ID})
+        get_property(DEPTH GLOBAL PROPERTY FOOTPRINT_DEPTH_${ID})
+        get_property(FLAGS GLOBAL PROPERTY FOOTPRINT_FLAGS_${ID})
+        footprint_add_entry(stack ${NAME_${ID}} ${DEPTH})
+        if(FLAGS)
+            string(REPLACE ";" ", " FLAGS "${FLAGS}")
+            string(REGEX REPLACE "\n$" " ( not counted: ${FLAGS} )\n" TABLE "${TABLE}")
+        endif()
+    endif()
+endforeach()
+
+file(WRITE ${OUTPUT_FILE} "${REPORT}")
+string(APPEND TABLE "\nReport written to ${OUTPUT_FILE}")
+message("${TABLE}")
@@ -0,0 +1,47 @@
+##
+##   ______                              _
+##  / _____)             _              | |
+## ( (____  _____ ____ _| |_ _____  ____| |__
+##  \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+##  _____) ) ____| | | || |_| ____( (___| | | |
+## (______/|_____)_|_|_| \__)_____)\____)_| |_|
+## (C)2013-2017 Semtech
+##  ___ _____ _   ___ _  _____ ___  ___  ___ ___
+## / __|_   _/_\ / __| |/ / __/ _ \| _ \/ __| __|
+## \__ \ | |/ _ \ (__| ' <| _| (_) |   / (__| _|
+## |___/ |_/_/ \_\___|_|\_\_| \___/|_|_\\___|___|
+## embedded.connectivity.solutions.==============
+##
+## License:  Revised BSD License, see LICENSE.TXT file included in the project
+##
+## Static RAM and stack footprint report of an application
+##
+
+# Get the path of this module
+set(FOOTPRINT_REPORT_MODULE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+#---------------------------------------------------------------------------------------
+# Creates the TARGET.footprint target reporting the .data and .bss sizes of the TARGET
+# own objects and of the given object libraries, and the maximum stack depth of the
+# entry points. The sources must be compiled with -fcallgraph-info=su.
+#---------------------------------------------------------------------------------------
+function(generate_footprint_report TARGET)
+    set(OBJECTS_FILE ${CMAKE_CURRENT_BINARY_DIR}/${TARGET}.footprint-objects)
+    set(OBJECTS_CONTENT "")
+    foreach(MODULE ${ARGN})
+        string(APPEND OBJECTS_CONTENT "${MODULE}|$<JOIN:$<TARGET_OBJECTS:${MODULE}>,\n${MODULE}|>\n")
+    endforeach()
+    file(GENERATE OUTPUT ${OBJECTS_FILE} CONTENT "${OBJECTS_CONTENT}")
+
+    add_custom_target(${TARGET}.footprint
+        DEPENDS ${TARGET}
+        COMMAND ${CMAKE_COMMAND}
+            -DNM=${CMAKE_NM}
+            -DOBJECTS_FILE=${OBJECTS_FILE}
+            -DAPP_NAME=${TARGET}
+            -DAPP_OBJECTS_DIR=${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/${TARGET}.dir
+            -DOUTPUT_FILE=${CMAKE_CURRENT_BINARY_DIR}/${TARGET}.footprint
+            -DBASELINE_FILE=${FOOTPRINT_BASELINE}
+            -P ${FOOTPRINT_REPORT_MODULE_DIR}/footprint-report-script.cmake
+        VERBATIM)
+endfunction()
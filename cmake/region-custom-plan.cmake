@@ -0,0 +1,86 @@
+##
+##   ______                              _
+##  / _____)             _              | |
+## ( (____  _____ ____ _| |_ _____  ____| |__
+##  \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+##  _____) ) ____| | | || |_| ____( (___| | | |
+## (______/|_____)_|_|_| \__)_____)\____)_| |_|
+## (C)2013-2017 Semtech
+##  ___ _____ _   ___ _  _____ ___  ___  ___ ___
+## / __|_   _/_\ / __| |/ / __/ _ \| _ \/ __| __|
+## \__ \ | |/ _ \ (__| ' <| _| (_) |   / (__| _|
+## |___/ |_/_/ \_\___|_|\_\_| \___/|_|_\\___|___|
+## embedded.connectivity.solutions.==============
+##
+## License:  Revised BSD License, see LICENSE.TXT file included in the project
+##
+## Compiles a channel plan descriptor into the const tables of the custom region
+##
+
+# Get the path of this module
+set(REGION_CUSTOM_PLAN_MODULE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+#---------------------------------------------------------------------------------------
+# Generates the RegionCustomPlan.h header of the channel plan described by PLAN_FILE
+#---------------------------------------------------------------------------------------
+function(generate_region_custom_plan PLAN_FILE OUTPUT_FILE)
+    include(${PLAN_FILE})
+
+    # Regenerate the header when the descriptor changes
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${PLAN_FILE})
+
+    list(LENGTH PLAN_BANDS PLAN_NB_BANDS)
+    list(LENGTH PLAN_DEFAULT_CHANNELS PLAN_NB_DEFAULT_CHANNELS)
+    list(LENGTH PLAN_DATARATES PLAN_NB_DATARATES)
+
+    if(PLAN_MAX_NB_CHANNELS GREATER 16)
+        message(FATAL_ERROR "${PLAN_FILE}: the custom region supports at most 16 channels")
+    endif()
+    if(PLAN_NB_DEFAULT_CHANNELS EQUAL 0 OR PLAN_NB_DEFAULT_CHANNELS GREATER PLAN_MAX_NB_CHANNELS)
+        message(FATAL_ERROR "${PLAN_FILE}: invalid number of default channels")
+    endif()
+    foreach(TABLE PLAN_BANDWIDTHS PLAN_MAX_PAYLOADS PLAN_MAX_PAYLOADS_REPEATER)
+        list(LENGTH ${TABLE} TABLE_LENGTH)
+        if(NOT TABLE_LENGTH EQUAL PLAN_NB_DATARATES)
+            message(FATAL_ERROR "${PLAN_FILE}: ${TABLE} must have one entry per datarate")
+        endif()
+    endforeach()
+
+    # Bands and their frequency ranges
+    set(PLAN_BANDS_INIT "")
+    set(PLAN_BANDS_RANGES_INIT "")
+    foreach(BAND ${PLAN_BANDS})
+        string(REPLACE ":" ";" FIELDS ${BAND})
+        list(GET FIELDS 0 DUTY_CYCLE)
+        list(GET FIELDS 1 MIN_FREQ)
+        list(GET FIELDS 2 MAX_FREQ)
+        string(APPEND PLAN_BANDS_INIT " \\\n    { ${DUTY_CYCLE}, CUSTOM_MAX_TX_POWER, 0, 0, 0 BAND_DC_BUDGET_INIT },")
+        string(APPEND PLAN_BANDS_RANGES_INIT " \\\n    { ${MIN_FREQ}, ${MAX_FREQ} },")
+    endforeach()
+
+    # Default channels and their mask
+    set(PLAN_DEFAULT_CHANNELS_INIT "")
+    set(PLAN_DEFAULT_CHANNELS_MASK 0)
+    set(CHANNEL_INDEX 0)
+    foreach(CHANNEL ${PLAN_DEFAULT_CHANNELS})
+        string(REPLACE ":" ";" FIELDS ${CHANNEL})
+        list(GET FIELDS 0 FREQ)
+        list(GET FIELDS 1 DR_MIN)
+        list(GET FIELDS 2 DR_MAX)
+        list(GET FIELDS 3 BAND)
+        if(NOT BAND LESS PLAN_NB_BANDS)
+            message(FATAL_ERROR "${PLAN_FILE}: default channel ${FREQ} refers to an undefined band")
+        endif()
+        string(APPEND PLAN_DEFAULT_CHANNELS_INIT " \\\n    { ${FREQ}, 0, { ( ( DR_${DR_MAX} << 4 ) | DR_${DR_MIN} ) }, ${BAND} },")
+        math(EXPR PLAN_DEFAULT_CHANNELS_MASK "${PLAN_DEFAULT_CHANNELS_MASK} | ( 1 << ${CHANNEL_INDEX} )")
+        math(EXPR CHANNEL_INDEX "${CHANNEL_INDEX} + 1")
+    endforeach()
+
+    string(REPLACE ";" ", " PLAN_DATARATES_INIT "${PLAN_DATARATES}")
+    string(REPLACE ";" ", " PLAN_BANDWIDTHS_INIT "${PLAN_BANDWIDTHS}")
+    string(REPLACE ";" ", " PLAN_MAX_PAYLOADS_INIT "${PLAN_MAX_PAYLOADS}")
+    string(REPLACE ";" ", " PLAN_MAX_PAYLOADS_REPEATER_INIT "${PLAN_MAX_PAYLOADS_REPEATER}")
+
+    set(REGION_CUSTOM_PLAN_FILE ${PLAN_FILE})
+    configure_file(${REGION_CUSTOM_PLAN_MODULE_DIR}/RegionCustomPlan.h.in ${OUTPUT_FILE} @ONLY)
+endfunction()
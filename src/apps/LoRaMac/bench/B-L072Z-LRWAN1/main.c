@@ -0,0 +1,115 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     LoRaMac hot paths benchmark application
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+
+/*! \file bench/B-L072Z-LRWAN1/main.c */
+
+#include <stdio.h>
+#include "utilities.h"
+#include "board.h"
+#include "LoRaMac.h"
+#include "MacBenchmark.h"
+
+#ifndef ACTIVE_REGION
+
+#warning "No active region defined, LORAMAC_REGION_EU868 will be used as default."
+
+#define ACTIVE_REGION LORAMAC_REGION_EU868
+
+#endif
+
+/*!
+ * \brief   MCPS-Confirm event function
+ *
+ * \param   [IN] mcpsConfirm - Pointer to the confirm structure,
+ *               containing confirm attributes.
+ */
+static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+}
+
+/*!
+ * \brief   MCPS-Indication event function
+ *
+ * \param   [IN] mcpsIndication - Pointer to the indication structure,
+ *               containing indication attributes.
+ */
+static void McpsIndication( McpsIndication_t *mcpsIndication )
+{
+}
+
+/*!
+ * \brief   MLME-Confirm event function
+ *
+ * \param   [IN] mlmeConfirm - Pointer to the confirm structure,
+ *               containing confirm attributes.
+ */
+static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+}
+
+/*!
+ * \brief   MLME-Indication event function
+ *
+ * \param   [IN] mlmeIndication - Pointer to the indication structure.
+ */
+static void MlmeIndication( MlmeIndication_t *mlmeIndication )
+{
+}
+
+/**
+ * Main application entry point.
+ */
+int main( void )
+{
+    LoRaMacPrimitives_t macPrimitives;
+    LoRaMacCallback_t macCallbacks;
+    LoRaMacStatus_t status;
+
+    BoardInitMcu( );
+    BoardInitPeriph( );
+
+    macPrimitives.MacMcpsConfirm = McpsConfirm;
+    macPrimitives.MacMcpsIndication = McpsIndication;
+    macPrimitives.MacMlmeConfirm = MlmeConfirm;
+    macPrimitives.MacMlmeIndication = MlmeIndication;
+    macCallbacks.GetBatteryLevel = BoardGetBatteryLevel;
+    macCallbacks.GetTemperatureLevel = NULL;
+    macCallbacks.NvmContextChange = NULL;
+    macCallbacks.MacProcessNotify = NULL;
+
+    printf( "###### ===== LoRaMac benchmark application v1.0.0 ==== ######\r\n\r\n" );
+
+    status = LoRaMacInitialization( &macPrimitives, &macCallbacks, ACTIVE_REGION );
+    if( status != LORAMAC_STATUS_OK )
+    {
+        printf( "###### ===== LoRaMac initialization error %d ==== ######\r\n", status );
+    }
+    else
+    {
+        MacBenchmark( );
+    }
+
+    while( 1 )
+    {
+        // The MCU wakes up through events
+        BoardLowPowerHandler( );
+    }
+}
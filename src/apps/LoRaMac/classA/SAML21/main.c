@@ -32,6 +32,8 @@
 #include "LoRaMac.h"
 #include "Commissioning.h"
 #include "NvmCtxMgmt.h"
+#include "AesBenchmark.h"
+#include "UtilitiesBenchmark.h"
 
 #ifndef ACTIVE_REGION
 
@@ -584,7 +586,7 @@ static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
 #if defined( REGION_AS923 ) || defined( REGION_CN779 ) || \
     defined( REGION_EU868 ) || defined( REGION_IN865 ) || \
     defined( REGION_KR920 ) || defined( REGION_EU433 ) || \
-    defined( REGION_RU864 )
+    defined( REGION_RU864 ) || defined( REGION_CUSTOM )
 
         for( uint8_t i = 0; i < 1; i++)
 
@@ -970,6 +972,14 @@ int main( void )
 
     printf( "###### ===== ClassA demo application v1.0.RC1 ==== ######\r\n\r\n" );
 
+#if defined( AES_BENCHMARK_ENABLED )
+    AesBenchmark( );
+#endif
+
+#if defined( UTILITIES_BENCHMARK_ENABLED )
+    UtilitiesBenchmark( );
+#endif
+
     while( 1 )
     {
         // Tick the RTC to execute callback in context of the main loop (in stead of the IRQ)
@@ -29,6 +29,7 @@
 #include "gpio.h"
 #include "LoRaMac.h"
 #include "Commissioning.h"
+#include "eeprom.h"
 #include "NvmCtxMgmt.h"
 
 #ifndef ACTIVE_REGION
@@ -578,7 +579,7 @@ static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
 #if defined( REGION_AS923 ) || defined( REGION_CN779 ) || \
     defined( REGION_EU868 ) || defined( REGION_IN865 ) || \
     defined( REGION_KR920 ) || defined( REGION_EU433 ) || \
-    defined( REGION_RU864 )
+    defined( REGION_RU864 ) || defined( REGION_CUSTOM )
 
         for( uint8_t i = 0; i < 1; i++)
 
@@ -1204,6 +1205,9 @@ int main( void )
                     printf( "\r\n###### ===== CTXS STORED ==== ######\r\n" );
                 }
 
+                // The queued contexts writes complete before sleeping
+                EepromFlush( );
+
                 CRITICAL_SECTION_BEGIN( );
                 if( IsMacProcessPending == 1 )
                 {
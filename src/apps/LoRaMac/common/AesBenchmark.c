@@ -0,0 +1,118 @@
+/*!
+ * \file      AesBenchmark.c
+ *
+ * \brief     Measures the software secure element AES processing time
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdio.h>
+#include "utilities.h"
+#include "aes.h"
+#include "AesBenchmark.h"
+
+/*!
+ * Minimum duration of the benchmark run [ms]
+ */
+#define AES_BENCHMARK_MIN_TIME                      1000
+
+/*!
+ * Number of blocks encrypted between two time checks
+ */
+#define AES_BENCHMARK_BATCH_SIZE                    1000
+
+/*!
+ * Maximum number of encrypted blocks. Bounds the run when the time does not
+ * advance while the MCU is running, as with the Posix virtual RTC.
+ */
+#define AES_BENCHMARK_MAX_BLOCKS                    1000000
+
+/*!
+ * FIPS-197 appendix B cipher key
+ */
+static const uint8_t AesBenchmarkKey[16] =
+{
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+/*!
+ * FIPS-197 appendix B input block
+ */
+static const uint8_t AesBenchmarkInput[16] =
+{
+    0x32, 0x43, 0xF6, 0xA8, 0x88, 0x5A, 0x30, 0x8D, 0x31, 0x31, 0x98, 0xA2, 0xE0, 0x37, 0x07, 0x34
+};
+
+/*!
+ * FIPS-197 appendix B output block
+ */
+static const uint8_t AesBenchmarkOutput[16] =
+{
+    0x39, 0x25, 0x84, 0x1D, 0x02, 0xDC, 0x09, 0xFB, 0xDC, 0x11, 0x85, 0x97, 0x19, 0x6A, 0x0B, 0x32
+};
+
+bool AesBenchmarkRun( TimerTime_t minTime, uint32_t* nbBlocks, TimerTime_t* elapsed )
+{
+    aes_context ctx;
+    uint8_t block[16];
+    TimerTime_t startTime;
+
+    *nbBlocks = 0;
+    *elapsed = 0;
+
+    if( aes_set_key( AesBenchmarkKey, 16, &ctx ) != 0 )
+    {
+        return false;
+    }
+
+    // Known answer
+    memcpy1( block, AesBenchmarkInput, 16 );
+    aes_encrypt( block, block, &ctx );
+    for( uint8_t i = 0; i < 16; i++ )
+    {
+        if( block[i] != AesBenchmarkOutput[i] )
+        {
+            return false;
+        }
+    }
+
+    // Chained in place encryptions, as done by the CMAC computation
+    startTime = TimerGetCurrentTime( );
+    do
+    {
+        for( uint16_t i = 0; i < AES_BENCHMARK_BATCH_SIZE; i++ )
+        {
+            aes_encrypt( block, block, &ctx );
+        }
+        *nbBlocks += AES_BENCHMARK_BATCH_SIZE;
+        *elapsed = TimerGetElapsedTime( startTime );
+    }while( ( *elapsed < minTime ) && ( *nbBlocks < AES_BENCHMARK_MAX_BLOCKS ) );
+    return true;
+}
+
+void AesBenchmark( void )
+{
+    TimerTime_t elapsed = 0;
+    uint32_t nbBlocks = 0;
+    bool success = AesBenchmarkRun( AES_BENCHMARK_MIN_TIME, &nbBlocks, &elapsed );
+    uint32_t nsPerBlock = ( nbBlocks != 0 ) ? ( uint32_t )( ( ( uint64_t )elapsed * 1000000 ) / nbBlocks ) : 0;
+
+    printf( "\r\n###### ========== AES BENCHMARK ========== ######\r\n" );
+    printf( "BLOCKS      TIME [ms]   BLOCK [us]   STATUS\r\n" );
+    printf( "%8lu  %11lu  %7lu.%03lu   %s\r\n", ( unsigned long )nbBlocks, ( unsigned long )elapsed,
+            ( unsigned long )( nsPerBlock / 1000 ), ( unsigned long )( nsPerBlock % 1000 ),
+            ( success == true ) ? "OK" : "FAIL" );
+    printf( "\r\n" );
+}
@@ -0,0 +1,44 @@
+/*!
+ * \file      AesBenchmark.h
+ *
+ * \brief     Measures the software secure element AES processing time
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __AES_BENCHMARK_H__
+#define __AES_BENCHMARK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/*!
+ * \brief Checks the AES core against the FIPS-197 example vector and
+ *        encrypts blocks for at least the given time
+ *
+ * \param [IN]  minTime  Minimum encryption time [ms]
+ * \param [OUT] nbBlocks Number of encrypted blocks
+ * \param [OUT] elapsed  Time spent encrypting the blocks [ms]
+ * \retval status        true if the AES core output matches the vector
+ */
+bool AesBenchmarkRun( TimerTime_t minTime, uint32_t* nbBlocks, TimerTime_t* elapsed );
+
+/*!
+ * \brief Runs the benchmark and displays the time spent per block
+ */
+void AesBenchmark( void );
+
+#endif // __AES_BENCHMARK_H__
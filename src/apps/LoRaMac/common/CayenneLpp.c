@@ -19,6 +19,7 @@
  * \author    Miguel Luis ( Semtech )
  */
 #include <stdint.h>
+#include <stddef.h>
 
 #include "utilities.h"
 #include "CayenneLpp.h"
@@ -28,11 +29,74 @@
 static uint8_t CayenneLppBuffer[CAYENNE_LPP_MAXBUFFER_SIZE];
 static uint8_t CayenneLppCursor = 0;
 
+/*!
+ * Buffer the values are encoded into and its size
+ */
+static uint8_t* CayenneLppData = CayenneLppBuffer;
+static uint8_t CayenneLppMaxSize = CAYENNE_LPP_MAXBUFFER_SIZE;
+
+/*!
+ * Data types encoding
+ */
+typedef struct sCayenneLppTypeInfo
+{
+    uint8_t Type;
+    // Data ID + Data Type + Data Size
+    uint8_t Size;
+    uint8_t NbValues;
+    uint8_t ValueSize;
+    bool IsSigned;
+    float Resolution;
+}CayenneLppTypeInfo_t;
+
+static const CayenneLppTypeInfo_t CayenneLppTypes[] =
+{
+    { LPP_DIGITAL_INPUT,       LPP_DIGITAL_INPUT_SIZE,       1, 1, false, 1.0f    },
+    { LPP_DIGITAL_OUTPUT,      LPP_DIGITAL_OUTPUT_SIZE,      1, 1, false, 1.0f    },
+    { LPP_ANALOG_INPUT,        LPP_ANALOG_INPUT_SIZE,        1, 2, true,  0.01f   },
+    { LPP_ANALOG_OUTPUT,       LPP_ANALOG_OUTPUT_SIZE,       1, 2, true,  0.01f   },
+    { LPP_LUMINOSITY,          LPP_LUMINOSITY_SIZE,          1, 2, false, 1.0f    },
+    { LPP_PRESENCE,            LPP_PRESENCE_SIZE,            1, 1, false, 1.0f    },
+    { LPP_TEMPERATURE,         LPP_TEMPERATURE_SIZE,         1, 2, true,  0.1f    },
+    { LPP_RELATIVE_HUMIDITY,   LPP_RELATIVE_HUMIDITY_SIZE,   1, 1, false, 0.5f    },
+    { LPP_ACCELEROMETER,       LPP_ACCELEROMETER_SIZE,       3, 2, true,  0.001f  },
+    { LPP_BAROMETRIC_PRESSURE, LPP_BAROMETRIC_PRESSURE_SIZE, 1, 2, false, 0.1f    },
+    { LPP_GYROMETER,           LPP_GYROMETER_SIZE,           3, 2, true,  0.01f   },
+    { LPP_GPS,                 LPP_GPS_SIZE,                 3, 3, true,  0.0001f },
+};
+
+static const CayenneLppTypeInfo_t* CayenneLppGetTypeInfo( uint8_t type )
+{
+    for( uint8_t i = 0; i < ( sizeof( CayenneLppTypes ) / sizeof( CayenneLppTypes[0] ) ); i++ )
+    {
+        if( CayenneLppTypes[i].Type == type )
+        {
+            return &CayenneLppTypes[i];
+        }
+    }
+    return NULL;
+}
+
 void CayenneLppInit( void )
 {
     CayenneLppCursor = 0;
 }
 
+void CayenneLppSetBuffer( uint8_t* buffer, uint8_t maxSize )
+{
+    if( buffer == NULL )
+    {
+        CayenneLppData = CayenneLppBuffer;
+        CayenneLppMaxSize = CAYENNE_LPP_MAXBUFFER_SIZE;
+    }
+    else
+    {
+        CayenneLppData = buffer;
+        CayenneLppMaxSize = maxSize;
+    }
+    CayenneLppCursor = 0;
+}
+
 void CayenneLppReset( void )
 {
     CayenneLppCursor = 0;
@@ -45,39 +109,103 @@ uint8_t CayenneLppGetSize( void )
 
 uint8_t* CayenneLppGetBuffer( void )
 {
-    return CayenneLppBuffer;
+    return CayenneLppData;
 }
 
 uint8_t CayenneLppCopy( uint8_t* dst )
 {
-    memcpy1( dst, CayenneLppBuffer, CayenneLppCursor );
+    if( dst != CayenneLppData )
+    {
+        memcpy1( dst, CayenneLppData, CayenneLppCursor );
+    }
 
     return CayenneLppCursor;
 }
 
+uint8_t CayenneLppGetTypeSize( uint8_t type )
+{
+    const CayenneLppTypeInfo_t* info = CayenneLppGetTypeInfo( type );
+
+    return ( info != NULL ) ? info->Size : 0;
+}
+
+uint16_t CayenneLppGetEncodedSize( const uint8_t* types, uint8_t nbTypes )
+{
+    uint16_t size = 0;
+
+    for( uint8_t i = 0; i < nbTypes; i++ )
+    {
+        size += CayenneLppGetTypeSize( types[i] );
+    }
+    return size;
+}
+
+bool CayenneLppDecodeNext( const uint8_t* buffer, uint8_t size, uint8_t* offset, CayenneLppValue_t* value )
+{
+    const CayenneLppTypeInfo_t* info;
+    uint8_t index = *offset;
+
+    if( ( index + 2 ) > size )
+    {
+        return false;
+    }
+    info = CayenneLppGetTypeInfo( buffer[index + 1] );
+    if( ( info == NULL ) || ( ( index + info->Size ) > size ) )
+    {
+        return false;
+    }
+
+    value->Channel = buffer[index++];
+    value->Type = buffer[index++];
+    value->NbValues = info->NbValues;
+    for( uint8_t i = 0; i < info->NbValues; i++ )
+    {
+        int32_t raw = 0;
+
+        // Big endian
+        for( uint8_t j = 0; j < info->ValueSize; j++ )
+        {
+            raw = ( raw << 8 ) | buffer[index++];
+        }
+        if( ( info->IsSigned == true ) && ( ( raw & ( 1 << ( info->ValueSize * 8 - 1 ) ) ) != 0 ) )
+        {
+            // Sign extension
+            raw -= ( int32_t )1 << ( info->ValueSize * 8 );
+        }
+        value->Values[i] = raw * info->Resolution;
+    }
+    // GPS altitude resolution is 0.01 m
+    if( value->Type == LPP_GPS )
+    {
+        value->Values[2] *= 100;
+    }
+    *offset = index;
+    return true;
+}
+
 
 uint8_t CayenneLppAddDigitalInput( uint8_t channel, uint8_t value )
 {
-    if( ( CayenneLppCursor + LPP_DIGITAL_INPUT_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_DIGITAL_INPUT_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_DIGITAL_INPUT; 
-    CayenneLppBuffer[CayenneLppCursor++] = value; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_DIGITAL_INPUT; 
+    CayenneLppData[CayenneLppCursor++] = value; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddDigitalOutput( uint8_t channel, uint8_t value )
 {
-    if( ( CayenneLppCursor + LPP_DIGITAL_OUTPUT_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_DIGITAL_OUTPUT_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_DIGITAL_OUTPUT; 
-    CayenneLppBuffer[CayenneLppCursor++] = value; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_DIGITAL_OUTPUT; 
+    CayenneLppData[CayenneLppCursor++] = value; 
 
     return CayenneLppCursor;
 }
@@ -85,31 +213,31 @@ uint8_t CayenneLppAddDigitalOutput( uint8_t channel, uint8_t value )
 
 uint8_t CayenneLppAddAnalogInput( uint8_t channel, float value )
 {
-    if( ( CayenneLppCursor + LPP_ANALOG_INPUT_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_ANALOG_INPUT_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
 
     int16_t val = value * 100;
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_ANALOG_INPUT; 
-    CayenneLppBuffer[CayenneLppCursor++] = val >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = val; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_ANALOG_INPUT; 
+    CayenneLppData[CayenneLppCursor++] = val >> 8; 
+    CayenneLppData[CayenneLppCursor++] = val; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddAnalogOutput( uint8_t channel, float value )
 {
-    if( ( CayenneLppCursor + LPP_ANALOG_OUTPUT_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_ANALOG_OUTPUT_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
     int16_t val = value * 100;
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_ANALOG_OUTPUT;
-    CayenneLppBuffer[CayenneLppCursor++] = val >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = val; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_ANALOG_OUTPUT;
+    CayenneLppData[CayenneLppCursor++] = val >> 8; 
+    CayenneLppData[CayenneLppCursor++] = val; 
 
     return CayenneLppCursor;
 }
@@ -117,62 +245,62 @@ uint8_t CayenneLppAddAnalogOutput( uint8_t channel, float value )
 
 uint8_t CayenneLppAddLuminosity( uint8_t channel, uint16_t lux )
 {
-    if( ( CayenneLppCursor + LPP_LUMINOSITY_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_LUMINOSITY_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_LUMINOSITY; 
-    CayenneLppBuffer[CayenneLppCursor++] = lux >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = lux; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_LUMINOSITY; 
+    CayenneLppData[CayenneLppCursor++] = lux >> 8; 
+    CayenneLppData[CayenneLppCursor++] = lux; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddPresence( uint8_t channel, uint8_t value )
 {
-    if( ( CayenneLppCursor + LPP_PRESENCE_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_PRESENCE_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_PRESENCE; 
-    CayenneLppBuffer[CayenneLppCursor++] = value; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_PRESENCE; 
+    CayenneLppData[CayenneLppCursor++] = value; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddTemperature( uint8_t channel, float celsius )
 {
-    if( ( CayenneLppCursor + LPP_TEMPERATURE_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_TEMPERATURE_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
     int16_t val = celsius * 10;
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_TEMPERATURE; 
-    CayenneLppBuffer[CayenneLppCursor++] = val >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = val; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_TEMPERATURE; 
+    CayenneLppData[CayenneLppCursor++] = val >> 8; 
+    CayenneLppData[CayenneLppCursor++] = val; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddRelativeHumidity( uint8_t channel, float rh )
 {
-    if( ( CayenneLppCursor + LPP_RELATIVE_HUMIDITY_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_RELATIVE_HUMIDITY_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_RELATIVE_HUMIDITY; 
-    CayenneLppBuffer[CayenneLppCursor++] = rh * 2; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_RELATIVE_HUMIDITY; 
+    CayenneLppData[CayenneLppCursor++] = rh * 2; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddAccelerometer( uint8_t channel, float x, float y, float z )
 {
-    if( ( CayenneLppCursor + LPP_ACCELEROMETER_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_ACCELEROMETER_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
@@ -180,37 +308,37 @@ uint8_t CayenneLppAddAccelerometer( uint8_t channel, float x, float y, float z )
     int16_t vy = y * 1000;
     int16_t vz = z * 1000;
 
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_ACCELEROMETER; 
-    CayenneLppBuffer[CayenneLppCursor++] = vx >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = vx; 
-    CayenneLppBuffer[CayenneLppCursor++] = vy >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = vy; 
-    CayenneLppBuffer[CayenneLppCursor++] = vz >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = vz; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_ACCELEROMETER; 
+    CayenneLppData[CayenneLppCursor++] = vx >> 8; 
+    CayenneLppData[CayenneLppCursor++] = vx; 
+    CayenneLppData[CayenneLppCursor++] = vy >> 8; 
+    CayenneLppData[CayenneLppCursor++] = vy; 
+    CayenneLppData[CayenneLppCursor++] = vz >> 8; 
+    CayenneLppData[CayenneLppCursor++] = vz; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddBarometricPressure( uint8_t channel, float hpa )
 {
-    if( ( CayenneLppCursor + LPP_BAROMETRIC_PRESSURE_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_BAROMETRIC_PRESSURE_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
     int16_t val = hpa * 10;
 
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_BAROMETRIC_PRESSURE; 
-    CayenneLppBuffer[CayenneLppCursor++] = val >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = val; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_BAROMETRIC_PRESSURE; 
+    CayenneLppData[CayenneLppCursor++] = val >> 8; 
+    CayenneLppData[CayenneLppCursor++] = val; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddGyrometer( uint8_t channel, float x, float y, float z )
 {
-    if( ( CayenneLppCursor + LPP_GYROMETER_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    if( ( CayenneLppCursor + LPP_GYROMETER_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
@@ -218,40 +346,42 @@ uint8_t CayenneLppAddGyrometer( uint8_t channel, float x, float y, float z )
     int16_t vy = y * 100;
     int16_t vz = z * 100;
 
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_GYROMETER; 
-    CayenneLppBuffer[CayenneLppCursor++] = vx >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = vx; 
-    CayenneLppBuffer[CayenneLppCursor++] = vy >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = vy; 
-    CayenneLppBuffer[CayenneLppCursor++] = vz >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = vz; 
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_GYROMETER; 
+    CayenneLppData[CayenneLppCursor++] = vx >> 8; 
+    CayenneLppData[CayenneLppCursor++] = vx; 
+    CayenneLppData[CayenneLppCursor++] = vy >> 8; 
+    CayenneLppData[CayenneLppCursor++] = vy; 
+    CayenneLppData[CayenneLppCursor++] = vz >> 8; 
+    CayenneLppData[CayenneLppCursor++] = vz; 
 
     return CayenneLppCursor;
 }
 
 uint8_t CayenneLppAddGps( uint8_t channel, float latitude, float longitude, float meters )
 {
-    if( ( CayenneLppCursor + LPP_GPS_SIZE ) > CAYENNE_LPP_MAXBUFFER_SIZE )
+    return CayenneLppAddGpsFixed( channel, latitude * 10000, longitude * 10000, meters * 100 );
+}
+
+uint8_t CayenneLppAddGpsFixed( uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude )
+{
+    if( ( CayenneLppCursor + LPP_GPS_SIZE ) > CayenneLppMaxSize )
     {
         return 0;
     }
-    int32_t lat = latitude * 10000;
-    int32_t lon = longitude * 10000;
-    int32_t alt = meters * 100;
-
-    CayenneLppBuffer[CayenneLppCursor++] = channel; 
-    CayenneLppBuffer[CayenneLppCursor++] = LPP_GPS; 
-
-    CayenneLppBuffer[CayenneLppCursor++] = lat >> 16; 
-    CayenneLppBuffer[CayenneLppCursor++] = lat >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = lat; 
-    CayenneLppBuffer[CayenneLppCursor++] = lon >> 16; 
-    CayenneLppBuffer[CayenneLppCursor++] = lon >> 8; 
-    CayenneLppBuffer[CayenneLppCursor++] = lon; 
-    CayenneLppBuffer[CayenneLppCursor++] = alt >> 16; 
-    CayenneLppBuffer[CayenneLppCursor++] = alt >> 8;
-    CayenneLppBuffer[CayenneLppCursor++] = alt;
+
+    CayenneLppData[CayenneLppCursor++] = channel; 
+    CayenneLppData[CayenneLppCursor++] = LPP_GPS; 
+
+    CayenneLppData[CayenneLppCursor++] = latitude >> 16; 
+    CayenneLppData[CayenneLppCursor++] = latitude >> 8; 
+    CayenneLppData[CayenneLppCursor++] = latitude; 
+    CayenneLppData[CayenneLppCursor++] = longitude >> 16; 
+    CayenneLppData[CayenneLppCursor++] = longitude >> 8; 
+    CayenneLppData[CayenneLppCursor++] = longitude; 
+    CayenneLppData[CayenneLppCursor++] = altitude >> 16; 
+    CayenneLppData[CayenneLppCursor++] = altitude >> 8;
+    CayenneLppData[CayenneLppCursor++] = altitude;
 
     return CayenneLppCursor;
 }
@@ -22,6 +22,7 @@
 #define __CAYENNE_LPP_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #define LPP_DIGITAL_INPUT       0       // 1 byte
 #define LPP_DIGITAL_OUTPUT      1       // 1 byte
@@ -51,13 +52,69 @@
 #define LPP_GYROMETER_SIZE           8
 #define LPP_GPS_SIZE                 11
 
+/*!
+ * Largest number of values of a data type
+ */
+#define LPP_MAX_NB_VALUES            3
+
+/*!
+ * Decoded data
+ */
+typedef struct sCayenneLppValue
+{
+    uint8_t Channel;
+    uint8_t Type;
+    uint8_t NbValues;
+    float Values[LPP_MAX_NB_VALUES];
+}CayenneLppValue_t;
+
 void CayenneLppInit( void );
 
+/*!
+ * \brief Encodes the values directly into the given buffer, for instance the
+ *        application data buffer or the payload of a LoRaMacMcpsReqBuffer_t.
+ *        The encoded data is reset.
+ *
+ * \param [IN] buffer  Buffer to encode into. NULL selects the internal buffer.
+ * \param [IN] maxSize Buffer size
+ */
+void CayenneLppSetBuffer( uint8_t* buffer, uint8_t maxSize );
+
 void CayenneLppReset( void );
 uint8_t CayenneLppGetSize( void );
 uint8_t* CayenneLppGetBuffer( void );
 uint8_t CayenneLppCopy( uint8_t* buffer );
 
+/*!
+ * \brief Gets the encoded size of a data type
+ *
+ * \param [IN] type Data type
+ * \retval size     Data ID + Data Type + Data Size. 0 if the type is unknown.
+ */
+uint8_t CayenneLppGetTypeSize( uint8_t type );
+
+/*!
+ * \brief Computes the encoded size of a set of values, to be compared with
+ *        the LoRaMacQueryTxPossible result before encoding them
+ *
+ * \param [IN] types   Data types of the values
+ * \param [IN] nbTypes Number of values
+ * \retval size        Encoded size
+ */
+uint16_t CayenneLppGetEncodedSize( const uint8_t* types, uint8_t nbTypes );
+
+/*!
+ * \brief Decodes the next value of an encoded buffer
+ *
+ * \param [IN]    buffer Encoded buffer, for instance a downlink payload
+ * \param [IN]    size   Buffer size
+ * \param [INOUT] offset Offset of the value to decode. Updated to the next one.
+ * \param [OUT]   value  Decoded value, scaled to the data type unit
+ * \retval status        false at the end of the buffer or on an unknown or
+ *                       truncated value
+ */
+bool CayenneLppDecodeNext( const uint8_t* buffer, uint8_t size, uint8_t* offset, CayenneLppValue_t* value );
+
 uint8_t CayenneLppAddDigitalInput( uint8_t channel, uint8_t value );
 uint8_t CayenneLppAddDigitalOutput( uint8_t channel, uint8_t value );
 
@@ -73,4 +130,16 @@ uint8_t CayenneLppAddBarometricPressure( uint8_t channel, float hpa );
 uint8_t CayenneLppAddGyrometer( uint8_t channel, float x, float y, float z );
 uint8_t CayenneLppAddGps( uint8_t channel, float latitude, float longitude, float meters );
 
+/*!
+ * \brief Adds a GPS position given in the encoding units, without floating
+ *        point computation
+ *
+ * \param [IN] channel   Data channel
+ * \param [IN] latitude  Latitude [0.0001 degree]
+ * \param [IN] longitude Longitude [0.0001 degree]
+ * \param [IN] altitude  Altitude [0.01 m]
+ * \retval size          Encoded size, 0 if the buffer is full
+ */
+uint8_t CayenneLppAddGpsFixed( uint8_t channel, int32_t latitude, int32_t longitude, int32_t altitude );
+
 #endif // __CAYENNE_LPP_H__
@@ -0,0 +1,224 @@
+/*!
+ * \file      FragDecoderBenchmark.c
+ *
+ * \brief     Measures the fragmentation decoder processing time on a
+ *            synthetic fragmentation session
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdio.h>
+#include "utilities.h"
+#include "FragDecoder.h"
+#include "FragDecoderBenchmark.h"
+
+/*!
+ * Number of decoded sessions per benchmark configuration
+ */
+#define FRAG_DECODER_BENCHMARK_NB_RUNS              10
+
+/*!
+ * Original file, split into the uncoded fragments
+ */
+static uint8_t OriginalFile[FRAG_MAX_NB * FRAG_MAX_SIZE];
+
+/*!
+ * File rebuilt by the fragmentation decoder
+ */
+static uint8_t DecodedFile[FRAG_MAX_NB * FRAG_MAX_SIZE];
+
+/*!
+ * Fragmentation decoder session
+ */
+static FragDecoder_t FragDecoder;
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+static uint8_t FragDecoderWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    memcpy1( &DecodedFile[addr], data, size );
+    return 0; // Success
+}
+
+static uint8_t FragDecoderRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    memcpy1( data, &DecodedFile[addr], size );
+    return 0; // Success
+}
+
+static FragDecoderCallbacks_t FragDecoderCallbacks =
+{
+    .FragDecoderWrite = FragDecoderWrite,
+    .FragDecoderRead = FragDecoderRead,
+};
+#endif
+
+/*!
+ * \brief Pseudo random number generator used by the fragmentation encoder
+ *        (PRBS23). Same as the fragmentation decoder one.
+ */
+static int32_t FragPrbs23( int32_t value )
+{
+    int32_t b0 = value & 0x01;
+    int32_t b1 = ( value & 0x20 ) >> 5;
+    return ( value >> 1 ) + ( ( b0 ^ b1 ) << 22 );
+}
+
+/*!
+ * \brief Builds the coded fragment n by XORing the uncoded fragments
+ *        selected by the parity matrix row n
+ *
+ * \param [IN]  n        Coded fragment index [1:N]
+ * \param [IN]  fragNb   Number of uncoded fragments
+ * \param [IN]  fragSize Fragment size
+ * \param [OUT] frag     Coded fragment
+ */
+static void FragEncode( int32_t n, uint16_t fragNb, uint8_t fragSize, uint8_t *frag )
+{
+    uint8_t matrixRow[( FRAG_MAX_NB >> 3 ) + 1];
+    int32_t mTemp = ( ( fragNb & ( fragNb - 1 ) ) == 0 ) ? 1 : 0;
+    int32_t x = 1 + ( 1001 * n );
+    int32_t nbCoeff = 0;
+    int32_t r;
+
+    memset1( matrixRow, 0, sizeof( matrixRow ) );
+    memset1( frag, 0, fragSize );
+
+    while( nbCoeff < ( fragNb >> 1 ) )
+    {
+        r = 1 << 16;
+        while( r >= fragNb )
+        {
+            x = FragPrbs23( x );
+            r = x % ( fragNb + mTemp );
+        }
+        matrixRow[r >> 3] |= 1 << ( 7 - ( r % 8 ) );
+        nbCoeff += 1;
+    }
+
+    for( uint16_t i = 0; i < fragNb; i++ )
+    {
+        if( ( matrixRow[i >> 3] & ( 1 << ( 7 - ( i % 8 ) ) ) ) != 0 )
+        {
+            for( uint8_t j = 0; j < fragSize; j++ )
+            {
+                frag[j] ^= OriginalFile[i * fragSize + j];
+            }
+        }
+    }
+}
+
+bool FragDecoderBenchmarkRun( uint16_t fragNb, uint8_t fragSize, uint16_t nbLost, TimerTime_t* elapsed )
+{
+    uint8_t frag[FRAG_MAX_SIZE];
+    uint16_t lostStep = ( nbLost > 0 ) ? ( fragNb / nbLost ) : 0;
+    uint16_t lostCount = 0;
+    int32_t status = FRAG_SESSION_ONGOING;
+    TimerTime_t startTime;
+
+    *elapsed = 0;
+
+    if( ( fragNb == 0 ) || ( fragNb > FRAG_MAX_NB ) || ( fragSize == 0 ) || ( fragSize > FRAG_MAX_SIZE ) ||
+        ( nbLost > fragNb ) || ( nbLost > FRAG_MAX_REDUNDANCY ) )
+    {
+        return false;
+    }
+
+    for( uint32_t i = 0; i < ( uint32_t )( fragNb * fragSize ); i++ )
+    {
+        OriginalFile[i] = ( uint8_t )randr( 0, 255 );
+    }
+
+    startTime = TimerGetCurrentTime( );
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    FragDecoderInit( &FragDecoder, fragNb, fragSize, &FragDecoderCallbacks );
+#else
+    FragDecoderInit( &FragDecoder, fragNb, fragSize, DecodedFile, fragNb * fragSize );
+#endif
+    *elapsed += TimerGetElapsedTime( startTime );
+
+    // Uncoded fragments
+    for( uint16_t i = 0; i < fragNb; i++ )
+    {
+        if( ( lostCount < nbLost ) && ( ( i % lostStep ) == 0 ) )
+        {
+            lostCount++;
+            continue;
+        }
+        memcpy1( frag, &OriginalFile[i * fragSize], fragSize );
+
+        startTime = TimerGetCurrentTime( );
+        status = FragDecoderProcess( &FragDecoder, i + 1, frag );
+        *elapsed += TimerGetElapsedTime( startTime );
+    }
+
+    // Coded fragments, until the file is recovered
+    for( uint16_t n = 1; ( n <= ( fragNb + FRAG_MAX_REDUNDANCY ) ) && ( status < 0 ) && ( nbLost > 0 ); n++ )
+    {
+        FragEncode( n, fragNb, fragSize, frag );
+
+        startTime = TimerGetCurrentTime( );
+        status = FragDecoderProcess( &FragDecoder, fragNb + n, frag );
+        *elapsed += TimerGetElapsedTime( startTime );
+    }
+
+    if( ( status < 0 ) && ( nbLost > 0 ) )
+    {
+        return false;
+    }
+    for( uint32_t i = 0; i < ( uint32_t )( fragNb * fragSize ); i++ )
+    {
+        if( DecodedFile[i] != OriginalFile[i] )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FragDecoderBenchmark( void )
+{
+    const uint16_t fragNbList[] = { FRAG_MAX_NB / 4, FRAG_MAX_NB / 2, FRAG_MAX_NB };
+    const uint16_t nbLostList[] = { 1, FRAG_MAX_REDUNDANCY / 2, FRAG_MAX_REDUNDANCY };
+
+    printf( "\r\n###### ======= FRAG_DECODER BENCHMARK ======= ######\r\n" );
+    printf( "FRAG NB     LOST    SIZE    TIME [ms]   STATUS\r\n" );
+
+    for( uint8_t i = 0; i < ( sizeof( fragNbList ) / sizeof( fragNbList[0] ) ); i++ )
+    {
+        for( uint8_t j = 0; j < ( sizeof( nbLostList ) / sizeof( nbLostList[0] ) ); j++ )
+        {
+            uint16_t fragNb = fragNbList[i];
+            uint16_t nbLost = ( nbLostList[j] < fragNb ) ? nbLostList[j] : fragNb;
+            TimerTime_t total = 0;
+            bool success = true;
+
+            if( fragNb == 0 )
+            {
+                continue;
+            }
+
+            for( uint8_t run = 0; run < FRAG_DECODER_BENCHMARK_NB_RUNS; run++ )
+            {
+                TimerTime_t elapsed = 0;
+
+                success &= FragDecoderBenchmarkRun( fragNb, FRAG_MAX_SIZE, nbLost, &elapsed );
+                total += elapsed;
+            }
+            printf( "%7u  %7u  %6u  %11lu   %s\r\n", fragNb, nbLost, FRAG_MAX_SIZE,
+                    ( unsigned long )( total / FRAG_DECODER_BENCHMARK_NB_RUNS ), ( success == true ) ? "OK" : "FAIL" );
+        }
+    }
+    printf( "\r\n" );
+}
@@ -0,0 +1,51 @@
+/*!
+ * \file      FragDecoderBenchmark.h
+ *
+ * \brief     Measures the fragmentation decoder processing time on a
+ *            synthetic fragmentation session
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __FRAG_DECODER_BENCHMARK_H__
+#define __FRAG_DECODER_BENCHMARK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/*!
+ * \brief Decodes a synthetic fragmentation session
+ *
+ * \remark The fragments are generated from a pseudo random file. nbLost
+ *         uncoded fragments evenly spread over the file are dropped and the
+ *         coded fragments are then processed until the file is recovered.
+ *
+ * \param [IN]  fragNb   Number of uncoded fragments [1:FRAG_MAX_NB]
+ * \param [IN]  fragSize Fragment size [1:FRAG_MAX_SIZE]
+ * \param [IN]  nbLost   Number of lost uncoded fragments [0:FRAG_MAX_REDUNDANCY]
+ * \param [OUT] elapsed  Time spent in the fragmentation decoder [ms]
+ * \retval status        true if the decoded file matches the original one
+ */
+bool FragDecoderBenchmarkRun( uint16_t fragNb, uint8_t fragSize, uint16_t nbLost, TimerTime_t* elapsed );
+
+/*!
+ * \brief Runs the benchmark over a set of session configurations bounded by
+ *        FRAG_MAX_NB, FRAG_MAX_SIZE and FRAG_MAX_REDUNDANCY and displays the
+ *        results
+ */
+void FragDecoderBenchmark( void );
+
+#endif // __FRAG_DECODER_BENCHMARK_H__
@@ -27,6 +27,10 @@
 #include <stdbool.h>
 #include "utilities.h"
 #include "timer.h"
+#include "trace.h"
+#include "binlog.h"
+#include "eeprom.h"
+#include "packet-pool.h"
 #include "Commissioning.h"
 #include "NvmCtxMgmt.h"
 #include "LmHandler.h"
@@ -35,6 +39,7 @@
 #include "LmhpClockSync.h"
 #include "LmhpRemoteMcastSetup.h"
 #include "LmhpFragmentation.h"
+#include "LmhpUplinkFec.h"
 
 #ifndef ACTIVE_REGION
 
@@ -151,6 +156,17 @@ static LoRaMAcHandlerBeaconParams_t BeaconParams =
  */
 static bool IsClassBSwitchPending = false;
 
+/*!
+ * Indicates if the beacon has been acquired during the switch to Class B
+ */
+static bool IsClassBBeaconAcquired = false;
+
+/*!
+ * Indicates if the ping slot info has been answered during the switch to
+ * Class B
+ */
+static bool IsClassBPingSlotInfoAnswered = false;
+
 /*!
  * \brief   MCPS-Confirm event function
  *
@@ -167,89 +183,935 @@ static void McpsConfirm( McpsConfirm_t *mcpsConfirm );
  */
 static void McpsIndication( McpsIndication_t *mcpsIndication );
 
-/*!
- * \brief   MLME-Confirm event function
- *
- * \param   [IN] MlmeConfirm - Pointer to the confirm structure,
- *               containing confirm attributes.
- */
-static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm );
+/*!
+ * \brief   MLME-Confirm event function
+ *
+ * \param   [IN] MlmeConfirm - Pointer to the confirm structure,
+ *               containing confirm attributes.
+ */
+static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm );
+
+/*!
+ * \brief   MLME-Indication event function
+ *
+ * \param   [IN] mlmeIndication - Pointer to the indication structure,
+ *               containing indication attributes.
+ */
+static void MlmeIndication( MlmeIndication_t *mlmeIndication );
+
+/*!
+ * Requests network server time update
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SET if joined else \ref LORAMAC_HANDLER_RESET
+ */
+static LmHandlerErrorStatus_t LmHandlerDeviceTimeReq( void );
+
+/*!
+ * Starts the beacon search
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SET if joined else \ref LORAMAC_HANDLER_RESET
+ */
+static LmHandlerErrorStatus_t LmHandlerBeaconReq( void );
+
+/*!
+ * Starts the beacon search right away if the system time is synchronized,
+ * requests the network server time otherwise
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if requested else \ref LORAMAC_HANDLER_ERROR
+ */
+static LmHandlerErrorStatus_t LmHandlerBeaconTimeReq( void );
+
+/*!
+ * Requests the network server time and the ping slot info with the same
+ * uplink
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if requested else \ref LORAMAC_HANDLER_ERROR
+ */
+static LmHandlerErrorStatus_t LmHandlerClassBReq( void );
+
+/*!
+ * Switches to Class B once the beacon is acquired and the ping slot info
+ * answered
+ */
+static void LmHandlerClassBSwitch( void );
+
+/*!
+ * Join a LoRa Network in classA
+ *
+ * \param [IN] isOtaa Indicates which activation mode must be used
+ */
+static void LmHandlerJoinRequest( bool isOtaa );
+
+/*
+ *=============================================================================
+ * PACKAGES HANDLING
+ *=============================================================================
+ */
+typedef enum PackageNotifyTypes_e
+{
+    PACKAGE_MCPS_CONFIRM,
+    PACKAGE_MCPS_INDICATION,
+    PACKAGE_MLME_CONFIRM,
+    PACKAGE_MLME_INDICATION,
+    PACKAGE_NOTIFY_TYPES_NB,
+}PackageNotifyTypes_t;
+
+/*!
+ * Packages subscribed to each notification type, one bit per package id. A
+ * package subscribes to the notifications it has a callback for.
+ */
+static uint8_t LmHandlerPackagesSubscriptions[PACKAGE_NOTIFY_TYPES_NB];
+
+/*!
+ * Package owning each frame port, stored as the package id + 1. 0 when the
+ * port belongs to the application.
+ */
+static uint8_t LmHandlerPortPackages[256];
+
+/*!
+ * Notifies the package to process the LoRaMac callbacks.
+ *
+ * \param [IN] notifyType MAC notification type [PACKAGE_MCPS_CONFIRM,
+ *                                               PACKAGE_MCPS_INDICATION,
+ *                                               PACKAGE_MLME_CONFIRM,
+ *                                               PACKAGE_MLME_INDICATION]
+ * \param[IN] params      Notification parameters. The params type can be
+ *                        [McpsConfirm_t, McpsIndication_t, MlmeConfirm_t, MlmeIndication_t]
+ */
+static void LmHandlerPackagesNotify( PackageNotifyTypes_t notifyType, void *params );
+
+static void LmHandlerPackagesProcess( void );
+
+/*!
+ * Indicates if one of the registered packages has an internal event pending
+ *
+ * \retval status [true] Pending, [false] idle
+ */
+static bool LmHandlerPackagesHasPendingEvents( void );
+
+/*
+ *=============================================================================
+ * LORAMAC EVENTS QUEUE
+ *=============================================================================
+ */
+#if defined( LMHANDLER_EVENT_QUEUE_ENABLED )
+
+/*!
+ * Queued LoRaMac event
+ */
+typedef struct LmHandlerEvent_s
+{
+    /*!
+     * Event type
+     */
+    PackageNotifyTypes_t Type;
+    /*!
+     * Copy of the event parameters
+     */
+    union
+    {
+        McpsConfirm_t McpsConfirm;
+        McpsIndication_t McpsIndication;
+        MlmeConfirm_t MlmeConfirm;
+        MlmeIndication_t MlmeIndication;
+    }Params;
+    /*!
+     * Copy of the MCPS indication payload. The MAC reuses its reception
+     * buffer for the next downlink.
+     */
+    uint8_t Payload[LMHANDLER_EVENT_QUEUE_PAYLOAD_SIZE];
+}LmHandlerEvent_t;
+
+/*!
+ * Events pool, used as a ring
+ */
+static LmHandlerEvent_t LmHandlerEvents[LMHANDLER_EVENT_QUEUE_LEN];
+
+/*!
+ * Index of the oldest queued event
+ */
+static uint8_t LmHandlerEventsHead = 0;
+
+/*!
+ * Number of queued events
+ */
+static uint8_t LmHandlerEventsCnt = 0;
+
+/*!
+ * \brief Dispatches a LoRaMac event to the application and the packages
+ *
+ * \param [IN] type   Event type
+ * \param [IN] params Event parameters
+ */
+static void LmHandlerEventDispatch( PackageNotifyTypes_t type, void *params )
+{
+    switch( type )
+    {
+        case PACKAGE_MCPS_CONFIRM:
+        {
+            McpsConfirm( params );
+            break;
+        }
+        case PACKAGE_MCPS_INDICATION:
+        {
+            McpsIndication( params );
+            break;
+        }
+        case PACKAGE_MLME_CONFIRM:
+        {
+            MlmeConfirm( params );
+            break;
+        }
+        case PACKAGE_MLME_INDICATION:
+        {
+            MlmeIndication( params );
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/*!
+ * \brief Copies a LoRaMac event in the queue. The event is dispatched
+ *        immediately when the queue is full.
+ *
+ * \param [IN] type   Event type
+ * \param [IN] params Event parameters
+ */
+static void LmHandlerEventPost( PackageNotifyTypes_t type, void *params )
+{
+    LmHandlerEvent_t *event;
+
+    if( ( LmHandlerEventsCnt >= LMHANDLER_EVENT_QUEUE_LEN ) ||
+        ( ( type == PACKAGE_MCPS_INDICATION ) &&
+          ( ( ( McpsIndication_t* )params )->BufferSize > LMHANDLER_EVENT_QUEUE_PAYLOAD_SIZE ) ) )
+    {
+        LmHandlerEventDispatch( type, params );
+        return;
+    }
+
+    event = &LmHandlerEvents[( LmHandlerEventsHead + LmHandlerEventsCnt ) % LMHANDLER_EVENT_QUEUE_LEN];
+    event->Type = type;
+    switch( type )
+    {
+        case PACKAGE_MCPS_CONFIRM:
+        {
+            event->Params.McpsConfirm = *( McpsConfirm_t* )params;
+            break;
+        }
+        case PACKAGE_MCPS_INDICATION:
+        {
+            event->Params.McpsIndication = *( McpsIndication_t* )params;
+            if( event->Params.McpsIndication.Buffer != NULL )
+            {
+                memcpy1( event->Payload, event->Params.McpsIndication.Buffer, event->Params.McpsIndication.BufferSize );
+                event->Params.McpsIndication.Buffer = event->Payload;
+            }
+            break;
+        }
+        case PACKAGE_MLME_CONFIRM:
+        {
+            event->Params.MlmeConfirm = *( MlmeConfirm_t* )params;
+            break;
+        }
+        case PACKAGE_MLME_INDICATION:
+        {
+            event->Params.MlmeIndication = *( MlmeIndication_t* )params;
+            break;
+        }
+        default:
+            break;
+    }
+    LmHandlerEventsCnt++;
+}
+
+/*!
+ * \brief Dispatches the queued LoRaMac events, in the order they were posted
+ */
+static void LmHandlerEventsProcess( void )
+{
+    // The events posted while dispatching are processed in the same call
+    while( LmHandlerEventsCnt > 0 )
+    {
+        LmHandlerEvent_t *event = &LmHandlerEvents[LmHandlerEventsHead];
+
+        // The entry is released once processed, its payload being in use
+        LmHandlerEventDispatch( event->Type, &event->Params );
+        LmHandlerEventsHead = ( LmHandlerEventsHead + 1 ) % LMHANDLER_EVENT_QUEUE_LEN;
+        LmHandlerEventsCnt--;
+    }
+}
+
+static void McpsConfirmPost( McpsConfirm_t *mcpsConfirm )
+{
+    LmHandlerEventPost( PACKAGE_MCPS_CONFIRM, mcpsConfirm );
+}
+
+static void McpsIndicationPost( McpsIndication_t *mcpsIndication )
+{
+    LmHandlerEventPost( PACKAGE_MCPS_INDICATION, mcpsIndication );
+}
+
+static void MlmeConfirmPost( MlmeConfirm_t *mlmeConfirm )
+{
+    LmHandlerEventPost( PACKAGE_MLME_CONFIRM, mlmeConfirm );
+}
+
+static void MlmeIndicationPost( MlmeIndication_t *mlmeIndication )
+{
+    LmHandlerEventPost( PACKAGE_MLME_INDICATION, mlmeIndication );
+}
+
+#endif // LMHANDLER_EVENT_QUEUE_ENABLED
+
+/*
+ *=============================================================================
+ * UPLINK SCHEDULER
+ *=============================================================================
+ */
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+
+/*!
+ * Delay before trying again a job refused by the MAC [ms]
+ */
+#define LMHANDLER_UPLINK_RETRY_DELAY                1000
+
+/*!
+ * Scheduled uplink
+ */
+typedef struct LmHandlerUplinkJob_s
+{
+    /*!
+     * Indicates if the job waits to be sent
+     */
+    bool IsPending;
+    /*!
+     * Indicates if the uplink requires an acknowledgement
+     */
+    LmHandlerMsgTypes_t MsgType;
+    /*!
+     * Job priority, the highest is sent first
+     */
+    uint8_t Priority;
+    /*!
+     * Time at which the job was scheduled
+     */
+    TimerTime_t Timestamp;
+    /*!
+     * Delay after which the job is dropped [ms], 0 when it never expires
+     */
+    TimerTime_t Deadline;
+    /*!
+     * Application port
+     */
+    uint8_t Port;
+    /*!
+     * Payload size
+     */
+    uint8_t BufferSize;
+    /*!
+     * Copy of the payload
+     */
+    uint8_t Buffer[LMHANDLER_UPLINK_JOB_PAYLOAD_SIZE];
+}LmHandlerUplinkJob_t;
+
+/*!
+ * Scheduled uplinks
+ */
+static LmHandlerUplinkJob_t LmHandlerUplinkJobs[LMHANDLER_UPLINK_JOBS_LEN];
+
+/*!
+ * Wakes up the scheduler once the duty cycle allows the next uplink
+ */
+static TimerEvent_t LmHandlerUplinkTimer;
+
+/*!
+ * Indicates if the scheduler has to dispatch the jobs
+ */
+static volatile bool LmHandlerUplinkJobsRun = false;
+
+/*!
+ * \brief Function executed on LmHandlerUplinkTimer event
+ */
+static void OnLmHandlerUplinkTimerEvent( void* context )
+{
+    LmHandlerUplinkJobsRun = true;
+    if( LmHandlerCallbacks->OnMacProcess != NULL )
+    {
+        LmHandlerCallbacks->OnMacProcess( );
+    }
+}
+
+/*!
+ * \brief Gets the time left before a job expires
+ *
+ * \param [IN] job Scheduled uplink
+ * \retval time    Time left [ms], 0 when expired. The maximum time when the
+ *                 job never expires
+ */
+static TimerTime_t LmHandlerUplinkJobTimeLeft( LmHandlerUplinkJob_t* job )
+{
+    TimerTime_t elapsed = TimerGetElapsedTime( job->Timestamp );
+
+    if( job->Deadline == 0 )
+    {
+        return UINT32_MAX;
+    }
+    if( elapsed >= job->Deadline )
+    {
+        return 0;
+    }
+    return job->Deadline - elapsed;
+}
+
+/*!
+ * \brief Drops the expired jobs and gets the job to send next
+ *
+ * \retval job Highest priority job, the one expiring first on equal
+ *             priorities. NULL if no job is pending
+ */
+static LmHandlerUplinkJob_t* LmHandlerUplinkJobNext( void )
+{
+    LmHandlerUplinkJob_t* next = NULL;
+    TimerTime_t nextTimeLeft = 0;
+
+    for( uint8_t i = 0; i < LMHANDLER_UPLINK_JOBS_LEN; i++ )
+    {
+        LmHandlerUplinkJob_t* job = &LmHandlerUplinkJobs[i];
+
+        if( job->IsPending == false )
+        {
+            continue;
+        }
+
+        TimerTime_t timeLeft = LmHandlerUplinkJobTimeLeft( job );
+        if( timeLeft == 0 )
+        {
+            // The data is worthless
+            job->IsPending = false;
+            continue;
+        }
+        if( ( next == NULL ) || ( job->Priority > next->Priority ) ||
+            ( ( job->Priority == next->Priority ) && ( timeLeft < nextTimeLeft ) ) )
+        {
+            next = job;
+            nextTimeLeft = timeLeft;
+        }
+    }
+    return next;
+}
+
+/*!
+ * \brief Sends the next job once the MAC is idle and the duty cycle allows it
+ */
+static void LmHandlerUplinkJobsProcess( void )
+{
+    LmHandlerUplinkJob_t* job;
+    LmHandlerAppData_t appData;
+    LoRaMacTxInfo_t txInfo;
+    LoRaMacStatus_t status;
+
+    if( LmHandlerUplinkJobsRun == false )
+    {
+        return;
+    }
+    LmHandlerUplinkJobsRun = false;
+
+    job = LmHandlerUplinkJobNext( );
+    if( job == NULL )
+    {
+        return;
+    }
+    // The MAC confirms run the scheduler again
+    if( ( LoRaMacIsBusy( ) == true ) || ( LmHandlerJoinStatus( ) != LORAMAC_HANDLER_SET ) )
+    {
+        return;
+    }
+
+    TimerStop( &LmHandlerUplinkTimer );
+    status = LoRaMacQueryTxPossible( job->BufferSize, &txInfo );
+    if( txInfo.NextTxDelay > 0 )
+    {
+        // Wait for the band and aggregated time-offs to allow the uplink
+        TimerSetValue( &LmHandlerUplinkTimer, txInfo.NextTxDelay );
+        TimerStart( &LmHandlerUplinkTimer );
+        return;
+    }
+    if( job->BufferSize > txInfo.CurrentPossiblePayloadSize )
+    {
+        // The payload doesn't fit at the current datarate
+        job->IsPending = false;
+        LmHandlerUplinkJobsRun = true;
+        return;
+    }
+
+    appData.Port = job->Port;
+    appData.BufferSize = job->BufferSize;
+    appData.Buffer = job->Buffer;
+    if( LmHandlerSend( &appData, job->MsgType ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        // Refused by the MAC, try again later
+        TimerSetValue( &LmHandlerUplinkTimer, LMHANDLER_UPLINK_RETRY_DELAY );
+        TimerStart( &LmHandlerUplinkTimer );
+    }
+    else if( status == LORAMAC_STATUS_OK )
+    {
+        job->IsPending = false;
+    }
+    // Otherwise an empty frame flushes the MAC commands first and the job is
+    // sent next
+}
+
+LmHandlerErrorStatus_t LmHandlerScheduleSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                              uint8_t priority, TimerTime_t deadline )
+{
+    LmHandlerUplinkJob_t* job = NULL;
+
+    if( appData->BufferSize > LMHANDLER_UPLINK_JOB_PAYLOAD_SIZE )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    // The fresh data of a port replaces its stale sample
+    for( uint8_t i = 0; ( i < LMHANDLER_UPLINK_JOBS_LEN ) && ( job == NULL ); i++ )
+    {
+        if( ( LmHandlerUplinkJobs[i].IsPending == true ) && ( LmHandlerUplinkJobs[i].Port == appData->Port ) )
+        {
+            job = &LmHandlerUplinkJobs[i];
+        }
+    }
+    for( uint8_t i = 0; ( i < LMHANDLER_UPLINK_JOBS_LEN ) && ( job == NULL ); i++ )
+    {
+        if( LmHandlerUplinkJobs[i].IsPending == false )
+        {
+            job = &LmHandlerUplinkJobs[i];
+        }
+    }
+    if( job == NULL )
+    {
+        // The scheduler is full, replace the lowest priority job
+        job = &LmHandlerUplinkJobs[0];
+        for( uint8_t i = 1; i < LMHANDLER_UPLINK_JOBS_LEN; i++ )
+        {
+            if( LmHandlerUplinkJobs[i].Priority < job->Priority )
+            {
+                job = &LmHandlerUplinkJobs[i];
+            }
+        }
+        if( job->Priority >= priority )
+        {
+            return LORAMAC_HANDLER_ERROR;
+        }
+    }
+
+    job->MsgType = isTxConfirmed;
+    job->Priority = priority;
+    job->Timestamp = TimerGetCurrentTime( );
+    job->Deadline = deadline;
+    job->Port = appData->Port;
+    job->BufferSize = appData->BufferSize;
+    memcpy1( job->Buffer, appData->Buffer, appData->BufferSize );
+    job->IsPending = true;
+    LmHandlerUplinkJobsRun = true;
+
+    if( ( LmHandlerJoinStatus( ) != LORAMAC_HANDLER_SET ) && ( LoRaMacIsBusy( ) == false ) )
+    {
+        // The network isn't joined, the jobs are sent once joined
+        LmHandlerJoinRequest( CommissioningParams.IsOtaaActivation );
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+#else
+
+LmHandlerErrorStatus_t LmHandlerScheduleSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                              uint8_t priority, TimerTime_t deadline )
+{
+    return LmHandlerSend( appData, isTxConfirmed );
+}
+
+#endif // LMHANDLER_UPLINK_SCHEDULER_ENABLED
+
+/*
+ *=============================================================================
+ * SAMPLES BATCH
+ *=============================================================================
+ */
+#if defined( LMHANDLER_BATCH_ENABLED )
+
+/*!
+ * Size of the batch header, the number of values and the age [bytes]
+ */
+#define LMHANDLER_BATCH_HEADER_SIZE                 3
+
+/*!
+ * Largest size of an encoded sample, 5 bytes per varint [bytes]
+ */
+#define LMHANDLER_BATCH_SAMPLE_MAX_SIZE             ( 5 * ( 1 + LMHANDLER_BATCH_MAX_NB_VALUES ) )
+
+/*!
+ * Delay before trying again a batch refused by the MAC [ms]
+ */
+#define LMHANDLER_BATCH_RETRY_DELAY                 1000
+
+/*!
+ * Samples batch
+ */
+typedef struct LmHandlerBatch_s
+{
+    /*!
+     * Application port
+     */
+    uint8_t Port;
+    /*!
+     * Number of values of a sample
+     */
+    uint8_t NbValues;
+    /*!
+     * Indicates if the batches require an acknowledgement
+     */
+    LmHandlerMsgTypes_t MsgType;
+    /*!
+     * Maximum delay between the first sample and the uplink [ms]
+     */
+    TimerTime_t Latency;
+    /*!
+     * Number of samples in the batch
+     */
+    uint8_t NbSamples;
+    /*!
+     * Values of the last sample
+     */
+    int32_t Values[LMHANDLER_BATCH_MAX_NB_VALUES];
+    /*!
+     * Time of the last sample
+     */
+    TimerTime_t Timestamp;
+    /*!
+     * Payload size
+     */
+    uint8_t BufferSize;
+    /*!
+     * Encoded payload
+     */
+    uint8_t Buffer[LMHANDLER_BATCH_PAYLOAD_SIZE];
+}LmHandlerBatch_t;
+
+/*!
+ * Samples batch
+ */
+static LmHandlerBatch_t LmHandlerBatch;
+
+/*!
+ * Sends the batch once its latency elapsed or to retry a refused batch
+ */
+static TimerEvent_t LmHandlerBatchTimer;
+
+/*!
+ * Indicates if the batch has to be sent
+ */
+static volatile bool LmHandlerBatchSendPending = false;
+
+/*!
+ * \brief Function executed on LmHandlerBatchTimer event
+ */
+static void OnLmHandlerBatchTimerEvent( void* context )
+{
+    LmHandlerBatchSendPending = true;
+    if( LmHandlerCallbacks->OnMacProcess != NULL )
+    {
+        LmHandlerCallbacks->OnMacProcess( );
+    }
+}
+
+/*!
+ * \brief Writes a LEB128 varint
+ *
+ * \param [IN] buffer Destination buffer
+ * \param [IN] value  Value to encode
+ * \retval size       Encoded size, up to 5 bytes
+ */
+static uint8_t LmHandlerBatchPutVarint( uint8_t* buffer, uint32_t value )
+{
+    uint8_t size = 0;
+
+    while( value >= 0x80 )
+    {
+        buffer[size++] = ( uint8_t )( value | 0x80 );
+        value >>= 7;
+    }
+    buffer[size++] = ( uint8_t )value;
+    return size;
+}
+
+/*!
+ * \brief Encodes a sample against the last sample of the batch
+ *
+ * \param [OUT] buffer    Destination buffer, \ref LMHANDLER_BATCH_SAMPLE_MAX_SIZE bytes
+ * \param [IN]  values    Sample values
+ * \param [IN]  timestamp Sample time
+ * \retval size           Encoded size
+ */
+static uint8_t LmHandlerBatchEncodeSample( uint8_t* buffer, const int32_t* values, TimerTime_t timestamp )
+{
+    uint8_t size = 0;
+    uint32_t delta;
+
+    if( LmHandlerBatch.NbSamples == 0 )
+    {
+        size += LmHandlerBatchPutVarint( buffer, 0 );
+    }
+    else
+    {
+        // Whole seconds of both times, the rounding errors don't add up
+        size += LmHandlerBatchPutVarint( buffer, ( timestamp / 1000 ) - ( LmHandlerBatch.Timestamp / 1000 ) );
+    }
+    for( uint8_t i = 0; i < LmHandlerBatch.NbValues; i++ )
+    {
+        delta = ( uint32_t )values[i];
+        if( LmHandlerBatch.NbSamples > 0 )
+        {
+            delta -= ( uint32_t )LmHandlerBatch.Values[i];
+        }
+        // Zigzag, the small negative differences are small varints as well
+        delta = ( delta << 1 ) ^ ( ( ( int32_t )delta < 0 ) ? UINT32_MAX : 0 );
+        size += LmHandlerBatchPutVarint( &buffer[size], delta );
+    }
+    return size;
+}
+
+/*!
+ * \brief Gets the largest payload the current datarate can send
+ *
+ * \retval size Largest batch size [bytes]
+ */
+static uint8_t LmHandlerBatchGetMaxSize( void )
+{
+    LoRaMacTxInfo_t txInfo;
+    uint8_t maxSize;
+
+    if( LoRaMacQueryTxPossible( 0, &txInfo ) == LORAMAC_STATUS_OK )
+    {
+        // The pending MAC commands are sent along
+        maxSize = txInfo.MaxPossibleApplicationDataSize;
+    }
+    else
+    {
+        // The MAC commands are flushed by an empty frame first
+        maxSize = txInfo.CurrentPossiblePayloadSize;
+    }
+    return MIN( maxSize, LMHANDLER_BATCH_PAYLOAD_SIZE );
+}
+
+/*!
+ * \brief Resets the batch and stops its timer
+ */
+static void LmHandlerBatchReset( void )
+{
+    TimerStop( &LmHandlerBatchTimer );
+    LmHandlerBatchSendPending = false;
+    LmHandlerBatch.NbSamples = 0;
+    LmHandlerBatch.Buffer[0] = LmHandlerBatch.NbValues;
+    LmHandlerBatch.BufferSize = LMHANDLER_BATCH_HEADER_SIZE;
+}
+
+/*!
+ * \brief Sends the batch, retried later when refused
+ *
+ * \retval status Returns true if the batch is empty or sent
+ */
+static bool LmHandlerBatchSend( void )
+{
+    LmHandlerAppData_t appData;
+    LoRaMacTxInfo_t txInfo;
+    TimerTime_t age;
+
+    if( LmHandlerBatch.NbSamples == 0 )
+    {
+        return true;
+    }
+
+    age = MIN( TimerGetElapsedTime( LmHandlerBatch.Timestamp ) / 1000, UINT16_MAX );
+    LmHandlerBatch.Buffer[1] = ( uint8_t )( age >> 0 );
+    LmHandlerBatch.Buffer[2] = ( uint8_t )( age >> 8 );
+
+    appData.Port = LmHandlerBatch.Port;
+    appData.BufferSize = LmHandlerBatch.BufferSize;
+    appData.Buffer = LmHandlerBatch.Buffer;
+
+    if( LoRaMacQueryTxPossible( appData.BufferSize, &txInfo ) != LORAMAC_STATUS_OK )
+    {
+        // LmHandlerSend flushes the MAC commands with an empty frame, the
+        // batch is kept for the next uplink
+        LmHandlerSend( &appData, LmHandlerBatch.MsgType );
+    }
+    else if( LmHandlerSend( &appData, LmHandlerBatch.MsgType ) == LORAMAC_HANDLER_SUCCESS )
+    {
+        // The MAC holds a copy of the payload
+        LmHandlerBatchReset( );
+        return true;
+    }
+    TimerStop( &LmHandlerBatchTimer );
+    TimerSetValue( &LmHandlerBatchTimer, LMHANDLER_BATCH_RETRY_DELAY );
+    TimerStart( &LmHandlerBatchTimer );
+    return false;
+}
+
+/*!
+ * \brief Sends the batch once its latency elapsed
+ */
+static void LmHandlerBatchProcess( void )
+{
+    if( LmHandlerBatchSendPending == false )
+    {
+        return;
+    }
+    LmHandlerBatchSendPending = false;
+    LmHandlerBatchSend( );
+}
+
+LmHandlerErrorStatus_t LmHandlerBatchInit( uint8_t port, uint8_t nbValues, LmHandlerMsgTypes_t isTxConfirmed,
+                                           TimerTime_t latency )
+{
+    if( ( nbValues == 0 ) || ( nbValues > LMHANDLER_BATCH_MAX_NB_VALUES ) )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    TimerInit( &LmHandlerBatchTimer, OnLmHandlerBatchTimerEvent );
+    TimerSetDeferred( &LmHandlerBatchTimer, true );
+
+    LmHandlerBatch.Port = port;
+    LmHandlerBatch.NbValues = nbValues;
+    LmHandlerBatch.MsgType = isTxConfirmed;
+    LmHandlerBatch.Latency = latency;
+    LmHandlerBatchReset( );
+    return LORAMAC_HANDLER_SUCCESS;
+}
+
+LmHandlerErrorStatus_t LmHandlerBatchAdd( const int32_t *values )
+{
+    uint8_t sample[LMHANDLER_BATCH_SAMPLE_MAX_SIZE];
+    TimerTime_t timestamp = TimerGetCurrentTime( );
+    uint8_t maxSize = LmHandlerBatchGetMaxSize( );
+    uint8_t size;
+
+    if( LmHandlerBatch.NbValues == 0 )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    size = LmHandlerBatchEncodeSample( sample, values, timestamp );
+    if( ( LmHandlerBatch.BufferSize + size ) > maxSize )
+    {
+        // The batch fills the frame
+        if( LmHandlerBatchSend( ) == false )
+        {
+            return LORAMAC_HANDLER_ERROR;
+        }
+        size = LmHandlerBatchEncodeSample( sample, values, timestamp );
+        if( ( LmHandlerBatch.BufferSize + size ) > maxSize )
+        {
+            return LORAMAC_HANDLER_ERROR;
+        }
+    }
+
+    memcpy1( &LmHandlerBatch.Buffer[LmHandlerBatch.BufferSize], sample, size );
+    LmHandlerBatch.BufferSize += size;
+    memcpy1( ( uint8_t* )LmHandlerBatch.Values, ( const uint8_t* )values, LmHandlerBatch.NbValues * sizeof( int32_t ) );
+    LmHandlerBatch.Timestamp = timestamp;
+    LmHandlerBatch.NbSamples++;
 
-/*!
- * \brief   MLME-Indication event function
- *
- * \param   [IN] mlmeIndication - Pointer to the indication structure,
- *               containing indication attributes.
- */
-static void MlmeIndication( MlmeIndication_t *mlmeIndication );
+    if( LmHandlerBatch.NbSamples == 1 )
+    {
+        TimerSetValue( &LmHandlerBatchTimer, LmHandlerBatch.Latency );
+        TimerStart( &LmHandlerBatchTimer );
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
 
-/*!
- * Requests network server time update
- *
- * \retval status Returns \ref LORAMAC_HANDLER_SET if joined else \ref LORAMAC_HANDLER_RESET
- */
-static LmHandlerErrorStatus_t LmHandlerDeviceTimeReq( void );
+LmHandlerErrorStatus_t LmHandlerBatchFlush( void )
+{
+    if( LmHandlerBatchSend( ) == false )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+    return LORAMAC_HANDLER_SUCCESS;
+}
 
-/*!
- * Starts the beacon search
- *
- * \retval status Returns \ref LORAMAC_HANDLER_SET if joined else \ref LORAMAC_HANDLER_RESET
- */
-static LmHandlerErrorStatus_t LmHandlerBeaconReq( void );
+#else
 
-/*
- *=============================================================================
- * PACKAGES HANDLING
- *=============================================================================
- */
-typedef enum PackageNotifyTypes_e
+LmHandlerErrorStatus_t LmHandlerBatchInit( uint8_t port, uint8_t nbValues, LmHandlerMsgTypes_t isTxConfirmed,
+                                           TimerTime_t latency )
 {
-    PACKAGE_MCPS_CONFIRM,
-    PACKAGE_MCPS_INDICATION,
-    PACKAGE_MLME_CONFIRM,
-    PACKAGE_MLME_INDICATION,
-}PackageNotifyTypes_t;
+    return LORAMAC_HANDLER_ERROR;
+}
 
-/*!
- * Notifies the package to process the LoRaMac callbacks.
- *
- * \param [IN] notifyType MAC notification type [PACKAGE_MCPS_CONFIRM,
- *                                               PACKAGE_MCPS_INDICATION,
- *                                               PACKAGE_MLME_CONFIRM,
- *                                               PACKAGE_MLME_INDICATION]
- * \param[IN] params      Notification parameters. The params type can be
- *                        [McpsConfirm_t, McpsIndication_t, MlmeConfirm_t, MlmeIndication_t]
- */
-static void LmHandlerPackagesNotify( PackageNotifyTypes_t notifyType, void *params );
+LmHandlerErrorStatus_t LmHandlerBatchAdd( const int32_t *values )
+{
+    return LORAMAC_HANDLER_ERROR;
+}
 
-static void LmHandlerPackagesProcess( void );
+LmHandlerErrorStatus_t LmHandlerBatchFlush( void )
+{
+    return LORAMAC_HANDLER_ERROR;
+}
+
+#endif // LMHANDLER_BATCH_ENABLED
 
 LmHandlerErrorStatus_t LmHandlerInit( LmHandlerCallbacks_t *handlerCallbacks,
                                       LmHandlerParams_t *handlerParams )
 {
     //
     MibRequestConfirm_t mibReq;
+    LoRaMacStatus_t status;
+    NvmCtxMgmtStatus_t nvmStatus;
     LmHandlerParams = handlerParams;
     LmHandlerCallbacks = handlerCallbacks;
 
+#if defined( LMHANDLER_EVENT_QUEUE_ENABLED )
+    LmHandlerEventsHead = 0;
+    LmHandlerEventsCnt = 0;
+    LoRaMacPrimitives.MacMcpsConfirm = McpsConfirmPost;
+    LoRaMacPrimitives.MacMcpsIndication = McpsIndicationPost;
+    LoRaMacPrimitives.MacMlmeConfirm = MlmeConfirmPost;
+    LoRaMacPrimitives.MacMlmeIndication = MlmeIndicationPost;
+#else
     LoRaMacPrimitives.MacMcpsConfirm = McpsConfirm;
     LoRaMacPrimitives.MacMcpsIndication = McpsIndication;
     LoRaMacPrimitives.MacMlmeConfirm = MlmeConfirm;
     LoRaMacPrimitives.MacMlmeIndication = MlmeIndication;
+#endif
     LoRaMacCallbacks.GetBatteryLevel = LmHandlerCallbacks->GetBatteryLevel;
     LoRaMacCallbacks.GetTemperatureLevel = LmHandlerCallbacks->GetTemperature;
     LoRaMacCallbacks.NvmContextChange = NvmCtxMgmtEvent;
     LoRaMacCallbacks.MacProcessNotify = LmHandlerCallbacks->OnMacProcess;
+    // The deferred timer callbacks are run by LmHandlerProcess
+    TimerSetProcessNotify( LmHandlerCallbacks->OnMacProcess );
 
     IsClassBSwitchPending = false;
 
-    if( LoRaMacInitialization( &LoRaMacPrimitives, &LoRaMacCallbacks, LmHandlerParams->Region ) != LORAMAC_STATUS_OK )
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+    memset1( ( uint8_t* )LmHandlerUplinkJobs, 0, sizeof( LmHandlerUplinkJobs ) );
+    LmHandlerUplinkJobsRun = false;
+    TimerInit( &LmHandlerUplinkTimer, OnLmHandlerUplinkTimerEvent );
+    TimerSetDeferred( &LmHandlerUplinkTimer, true );
+#endif
+
+    TRACE_BEGIN( TRACE_PROBE_MAC_INIT );
+    status = LoRaMacInitialization( &LoRaMacPrimitives, &LoRaMacCallbacks, LmHandlerParams->Region );
+    TRACE_END( TRACE_PROBE_MAC_INIT );
+    if( status != LORAMAC_STATUS_OK )
     {
         return LORAMAC_HANDLER_ERROR;
     }
 
     // Try to restore from NVM and query the mac if possible.
-    if( NvmCtxMgmtRestore( ) == NVMCTXMGMT_STATUS_SUCCESS )
+    TRACE_BEGIN( TRACE_PROBE_NVM_CTX_RESTORE );
+    nvmStatus = NvmCtxMgmtRestore( );
+    TRACE_END( TRACE_PROBE_NVM_CTX_RESTORE );
+    if( nvmStatus == NVMCTXMGMT_STATUS_SUCCESS )
     {
         LmHandlerCallbacks->OnNvmContextChange( LORAMAC_HANDLER_NVM_RESTORE );
     }
@@ -369,20 +1231,97 @@ bool LmHandlerIsBusy( void )
     return false;
 }
 
+bool LmHandlerHasPendingEvents( void )
+{
+    if( ( Radio.IsIrqPending != NULL ) && ( Radio.IsIrqPending( ) == true ) )
+    {
+        return true;
+    }
+    if( LoRaMacHasPendingEvents( ) == true )
+    {
+        return true;
+    }
+    if( TimerHasPendingEvents( ) == true )
+    {
+        return true;
+    }
+    if( EepromIsWritePending( ) == true )
+    {
+        return true;
+    }
+#if defined( LMHANDLER_EVENT_QUEUE_ENABLED )
+    if( LmHandlerEventsCnt > 0 )
+    {
+        return true;
+    }
+#endif
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+    if( LmHandlerUplinkJobsRun == true )
+    {
+        return true;
+    }
+#endif
+#if defined( LMHANDLER_BATCH_ENABLED )
+    if( LmHandlerBatchSendPending == true )
+    {
+        return true;
+    }
+#endif
+    if( LmHandlerPackagesHasPendingEvents( ) == true )
+    {
+        return true;
+    }
+    // The contexts are only stored while the MAC is idle
+    if( ( NvmCtxMgmtIsStorePending( ) == true ) && ( LoRaMacIsBusy( ) == false ) )
+    {
+        return true;
+    }
+    return false;
+}
+
 void LmHandlerProcess( void )
 {
+    // Sends the binary log records the debug UART can take
+    BinLogProcess( );
+
+    if( LmHandlerHasPendingEvents( ) == false )
+    {
+        return;
+    }
+
     // Process Radio IRQ
     if( Radio.IrqProcess != NULL )
     {
         Radio.IrqProcess( );
     }
 
+    // Runs the deferred timer callbacks
+    TimerProcess( );
+
     // Processes the LoRaMac events
     LoRaMacProcess( );
 
+    // Programs the next chunk of the queued contexts writes
+    EepromProcess( );
+
+#if defined( LMHANDLER_EVENT_QUEUE_ENABLED )
+    // Dispatches the LoRaMac confirms and indications
+    LmHandlerEventsProcess( );
+#endif
+
     // Call all packages process functions
     LmHandlerPackagesProcess( );
 
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+    // Sends the scheduled uplinks
+    LmHandlerUplinkJobsProcess( );
+#endif
+
+#if defined( LMHANDLER_BATCH_ENABLED )
+    // Sends the samples batch once its latency elapsed
+    LmHandlerBatchProcess( );
+#endif
+
     if( NvmCtxMgmtStore( ) == NVMCTXMGMT_STATUS_SUCCESS )
     {
         LmHandlerCallbacks->OnNvmContextChange( LORAMAC_HANDLER_NVM_STORE );
@@ -407,6 +1346,9 @@ static void LmHandlerJoinRequest( bool isOtaa )
         // Update commissioning parameters activation type variable.
         CommissioningParams.IsOtaaActivation = true;
 
+        // The stored DevNonce is written before being used
+        EepromFlush( );
+
         // Starts the OTAA join procedure
         LmHandlerCallbacks->OnMacMlmeRequest( LoRaMacMlmeRequest( &mlmeReq ), &mlmeReq );
     }
@@ -459,11 +1401,30 @@ LmHandlerFlagStatus_t LmHandlerJoinStatus( void )
     }
 }
 
+/*!
+ * \brief Measures the battery level answered to the next DevStatusReq
+ *
+ * \remark Done before the uplinks, the DevStatusReq are received in their
+ *         RX windows. Keeps the ADC conversion out of the downlink processing.
+ */
+static void LmHandlerUpdateBatteryLevel( void )
+{
+    MibRequestConfirm_t mibReq;
+
+    if( LmHandlerCallbacks->GetBatteryLevel != NULL )
+    {
+        mibReq.Type = MIB_BATTERY_LEVEL;
+        mibReq.Param.BatteryLevel = LmHandlerCallbacks->GetBatteryLevel( );
+        LoRaMacMibSetRequestConfirm( &mibReq );
+    }
+}
+
 LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed )
 {
     LoRaMacStatus_t status;
     McpsReq_t mcpsReq;
     LoRaMacTxInfo_t txInfo;
+    uint8_t* block = PacketPoolGetBlock( appData->Buffer );
 
     if( LmHandlerJoinStatus( ) != LORAMAC_HANDLER_SET )
     {
@@ -506,7 +1467,20 @@ LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgT
     TxParams.AppData = *appData;
     TxParams.Datarate = LmHandlerParams->TxDatarate;
 
-    status = LoRaMacMcpsRequest( &mcpsReq );
+    // The stored frame counters are written before the next uplink
+    EepromFlush( );
+
+    LmHandlerUpdateBatteryLevel( );
+
+    // The payloads of the packet pool blocks are sent in place
+    if( ( block != NULL ) && ( mcpsReq.Req.Unconfirmed.fBuffer == ( ( LoRaMacMcpsReqBuffer_t* )block )->Payload ) )
+    {
+        status = LoRaMacMcpsRequestInPlace( &mcpsReq );
+    }
+    else
+    {
+        status = LoRaMacMcpsRequest( &mcpsReq );
+    }
     LmHandlerCallbacks->OnMacMcpsRequest( status, &mcpsReq );
 
     if( status == LORAMAC_STATUS_OK )
@@ -539,6 +1513,55 @@ static LmHandlerErrorStatus_t LmHandlerDeviceTimeReq( void )
     }
 }
 
+static LmHandlerErrorStatus_t LmHandlerClassBReq( void )
+{
+    LoRaMacStatus_t status;
+    MlmeReq_t mlmeReqs[2];
+
+    if( SysTimeGetSyncAge( ) <= LMHANDLER_TIME_SYNC_MAX_AGE )
+    {
+        // The beacon search uses the system time. The ping slot info is
+        // requested once the beacon is acquired.
+        return LmHandlerBeaconReq( );
+    }
+
+    mlmeReqs[0].Type = MLME_DEVICE_TIME;
+    mlmeReqs[1].Type = MLME_PING_SLOT_INFO;
+    mlmeReqs[1].Req.PingSlotInfo.PingSlot.Fields.Periodicity = 0;
+    mlmeReqs[1].Req.PingSlotInfo.PingSlot.Fields.RFU = 0;
+
+    status = LoRaMacMlmeRequests( mlmeReqs, 2 );
+    LmHandlerCallbacks->OnMacMlmeRequest( status, &mlmeReqs[0] );
+    LmHandlerCallbacks->OnMacMlmeRequest( status, &mlmeReqs[1] );
+
+    if( status == LORAMAC_STATUS_OK )
+    {
+        return LORAMAC_HANDLER_SUCCESS;
+    }
+    else
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+}
+
+static void LmHandlerClassBSwitch( void )
+{
+    MibRequestConfirm_t mibReq;
+
+    if( ( IsClassBBeaconAcquired == false ) || ( IsClassBPingSlotInfoAnswered == false ) )
+    {
+        return;
+    }
+
+    // Class B is now activated
+    mibReq.Type = MIB_DEVICE_CLASS;
+    mibReq.Param.Class = CLASS_B;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+    // Notify upper layer
+    LmHandlerCallbacks->OnClassChange( CLASS_B );
+    IsClassBSwitchPending = false;
+}
+
 static LmHandlerErrorStatus_t LmHandlerBeaconReq( void )
 {
     LoRaMacStatus_t status;
@@ -559,6 +1582,15 @@ static LmHandlerErrorStatus_t LmHandlerBeaconReq( void )
     }
 }
 
+static LmHandlerErrorStatus_t LmHandlerBeaconTimeReq( void )
+{
+    if( SysTimeGetSyncAge( ) <= LMHANDLER_TIME_SYNC_MAX_AGE )
+    {
+        return LmHandlerBeaconReq( );
+    }
+    return LmHandlerDeviceTimeReq( );
+}
+
 LmHandlerErrorStatus_t LmHandlerPingSlotReq( uint8_t periodicity )
 {
     LoRaMacStatus_t status;
@@ -626,8 +1658,11 @@ LmHandlerErrorStatus_t LmHandlerRequestClass( DeviceClass_t newClass )
                 {
                     errorStatus = LORAMAC_HANDLER_ERROR;
                 }
-                // Beacon must first be acquired
-                errorStatus = LmHandlerDeviceTimeReq( );
+                // Beacon must first be acquired. The ping slot info is
+                // requested with the same uplink as the device time.
+                IsClassBBeaconAcquired = false;
+                IsClassBPingSlotInfoAnswered = false;
+                errorStatus = LmHandlerClassBReq( );
                 IsClassBSwitchPending = true;
             }
             break;
@@ -697,6 +1732,11 @@ static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
     TxParams.Channel = mcpsConfirm->Channel;
     TxParams.AckReceived = mcpsConfirm->AckReceived;
 
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+    // The MAC is idle again
+    LmHandlerUplinkJobsRun = true;
+#endif
+
     LmHandlerCallbacks->OnTxData( &TxParams );
 
     LmHandlerPackagesNotify( PACKAGE_MCPS_CONFIRM, mcpsConfirm );
@@ -732,27 +1772,18 @@ static void McpsIndication( McpsIndication_t *mcpsIndication )
     }
     // Call packages RxProcess function
     LmHandlerPackagesNotify( PACKAGE_MCPS_INDICATION, mcpsIndication );
-
-    if( ( mcpsIndication->FramePending == true ) && ( LmHandlerGetCurrentClass( ) == CLASS_A ) )
-    {
-        // The server signals that it has pending data to be sent.
-        // We schedule an uplink as soon as possible to flush the server.
-
-        // Send an empty message
-        LmHandlerAppData_t appData =
-        {
-            .Buffer = NULL,
-            .BufferSize = 0,
-            .Port = 0
-        };
-        LmHandlerSend( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG );
-    }
+    // The MAC sends the uplinks flushing the server when FramePending is
+    // set, see MIB_FPENDING_MAX_UPLINKS
 }
 
 static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
 {
     TxParams.IsMcpsConfirm = 0;
     TxParams.Status = mlmeConfirm->Status;
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+    // The MAC is idle again, the network may have been joined
+    LmHandlerUplinkJobsRun = true;
+#endif
     LmHandlerCallbacks->OnTxData( &TxParams );
 
     LmHandlerPackagesNotify( PACKAGE_MLME_CONFIRM, mlmeConfirm );
@@ -800,14 +1831,23 @@ static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
             if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
             {
                 // Beacon has been acquired
-                // Request server for ping slot
-                LmHandlerPingSlotReq( 0 );
+                IsClassBBeaconAcquired = true;
+                if( IsClassBPingSlotInfoAnswered == true )
+                {
+                    LmHandlerClassBSwitch( );
+                }
+                else
+                {
+                    // Request server for ping slot
+                    LmHandlerPingSlotReq( 0 );
+                }
             }
             else
             {
                 // Beacon not acquired
-                // Request Device Time again.
-                LmHandlerDeviceTimeReq( );
+                // Request Device Time again, unless the system time is
+                // kept synchronized.
+                LmHandlerBeaconTimeReq( );
             }
         }
         break;
@@ -815,17 +1855,11 @@ static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
         {
             if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
             {
-                MibRequestConfirm_t mibReq;
-
-                // Class B is now activated
-                mibReq.Type = MIB_DEVICE_CLASS;
-                mibReq.Param.Class = CLASS_B;
-                LoRaMacMibSetRequestConfirm( &mibReq );
-                // Notify upper layer
-                LmHandlerCallbacks->OnClassChange( CLASS_B );
-                IsClassBSwitchPending = false;
+                // Switches once the beacon is acquired as well
+                IsClassBPingSlotInfoAnswered = true;
+                LmHandlerClassBSwitch( );
             }
-            else
+            else if( IsClassBBeaconAcquired == true )
             {
                 LmHandlerPingSlotReq( 0 );
             }
@@ -878,7 +1912,10 @@ static void MlmeIndication( MlmeIndication_t *mlmeIndication )
             LmHandlerCallbacks->OnClassChange( CLASS_A );
             LmHandlerCallbacks->OnBeaconStatusChange( &BeaconParams );
 
-            LmHandlerDeviceTimeReq( );
+            if( SysTimeGetSyncAge( ) > LMHANDLER_TIME_SYNC_MAX_AGE )
+            {
+                LmHandlerDeviceTimeReq( );
+            }
         }
         break;
     case MLME_BEACON:
@@ -935,6 +1972,11 @@ LmHandlerErrorStatus_t LmHandlerPackageRegister( uint8_t id, void *params )
             package = LmhpFragmentationPackageFactory( );
             break;
         }
+        case PACKAGE_ID_UPLINK_FEC:
+        {
+            package = LmhpUplinkFecPackageFactory( );
+            break;
+        }
     }
     if( package != NULL )
     {
@@ -947,6 +1989,36 @@ LmHandlerErrorStatus_t LmHandlerPackageRegister( uint8_t id, void *params )
         LmHandlerPackages[id]->OnSysTimeUpdate = LmHandlerCallbacks->OnSysTimeUpdate;
         LmHandlerPackages[id]->Init( params, LmHandlerParams->DataBuffer, LmHandlerParams->DataBufferMaxSize );
 
+        // Notifications subscriptions
+        for( uint8_t i = 0; i < PACKAGE_NOTIFY_TYPES_NB; i++ )
+        {
+            LmHandlerPackagesSubscriptions[i] &= ~( 1 << id );
+        }
+        for( uint16_t port = 0; port < sizeof( LmHandlerPortPackages ); port++ )
+        {
+            if( LmHandlerPortPackages[port] == ( id + 1 ) )
+            {
+                LmHandlerPortPackages[port] = 0;
+            }
+        }
+        if( package->OnMcpsConfirmProcess != NULL )
+        {
+            LmHandlerPackagesSubscriptions[PACKAGE_MCPS_CONFIRM] |= 1 << id;
+        }
+        if( package->OnMcpsIndicationProcess != NULL )
+        {
+            LmHandlerPackagesSubscriptions[PACKAGE_MCPS_INDICATION] |= 1 << id;
+            LmHandlerPortPackages[package->Port] = id + 1;
+        }
+        if( package->OnMlmeConfirmProcess != NULL )
+        {
+            LmHandlerPackagesSubscriptions[PACKAGE_MLME_CONFIRM] |= 1 << id;
+        }
+        if( package->OnMlmeIndicationProcess != NULL )
+        {
+            LmHandlerPackagesSubscriptions[PACKAGE_MLME_INDICATION] |= 1 << id;
+        }
+
         return LORAMAC_HANDLER_SUCCESS;
     }
     else
@@ -981,46 +2053,46 @@ bool LmHandlerPackageIsRunning( uint8_t id )
 
 static void LmHandlerPackagesNotify( PackageNotifyTypes_t notifyType, void *params )
 {
-    for( int8_t i = 0; i < PKG_MAX_NUMBER; i++ )
+    uint8_t subscribers = LmHandlerPackagesSubscriptions[notifyType];
+
+    if( notifyType == PACKAGE_MCPS_INDICATION )
+    {
+        // Straight to the package owning the port, if any
+        uint8_t owner = LmHandlerPortPackages[( ( McpsIndication_t* )params )->Port];
+
+        if( owner != 0 )
+        {
+            LmHandlerPackages[owner - 1]->OnMcpsIndicationProcess( params );
+        }
+        return;
+    }
+
+    // Only the subscribed packages are notified
+    for( int8_t i = 0; ( i < PKG_MAX_NUMBER ) && ( subscribers != 0 ); i++, subscribers >>= 1 )
     {
-        if( LmHandlerPackages[i] != NULL )
+        if( ( subscribers & 0x01 ) == 0 )
         {
-            switch( notifyType )
+            continue;
+        }
+        switch( notifyType )
+        {
+            case PACKAGE_MCPS_CONFIRM:
             {
-                case PACKAGE_MCPS_CONFIRM:
-                {
-                    if( LmHandlerPackages[i]->OnMcpsConfirmProcess != NULL )
-                    {
-                        LmHandlerPackages[i]->OnMcpsConfirmProcess( params );
-                    }
-                    break;
-                }
-                case PACKAGE_MCPS_INDICATION:
-                {
-                    if( ( LmHandlerPackages[i]->OnMcpsIndicationProcess != NULL ) &&
-                        ( LmHandlerPackages[i]->Port == ( ( McpsIndication_t* )params )->Port ) )
-                    {
-                        LmHandlerPackages[i]->OnMcpsIndicationProcess( params );
-                    }
-                    break;
-                }
-                case PACKAGE_MLME_CONFIRM:
-                {
-                    if( LmHandlerPackages[i]->OnMlmeConfirmProcess != NULL )
-                    {
-                        LmHandlerPackages[i]->OnMlmeConfirmProcess( params );
-                    }
-                    break;
-                }
-                case PACKAGE_MLME_INDICATION:
-                {
-                    if( LmHandlerPackages[i]->OnMlmeIndicationProcess != NULL )
-                    {
-                        LmHandlerPackages[i]->OnMlmeIndicationProcess( params );
-                    }
-                    break;
-                }
+                LmHandlerPackages[i]->OnMcpsConfirmProcess( params );
+                break;
+            }
+            case PACKAGE_MLME_CONFIRM:
+            {
+                LmHandlerPackages[i]->OnMlmeConfirmProcess( params );
+                break;
             }
+            case PACKAGE_MLME_INDICATION:
+            {
+                LmHandlerPackages[i]->OnMlmeIndicationProcess( params );
+                break;
+            }
+            default:
+                break;
         }
     }
 }
@@ -1037,3 +2109,18 @@ static void LmHandlerPackagesProcess( void )
         }
     }
 }
+
+static bool LmHandlerPackagesHasPendingEvents( void )
+{
+    for( int8_t i = 0; i < PKG_MAX_NUMBER; i++ )
+    {
+        if( ( LmHandlerPackages[i] != NULL ) &&
+            ( LmHandlerPackages[i]->IsProcessPending != NULL ) &&
+            ( LmHandlerPackageIsInitialized( i ) != false ) &&
+            ( LmHandlerPackages[i]->IsProcessPending( ) == true ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
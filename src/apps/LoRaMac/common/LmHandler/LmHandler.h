@@ -33,6 +33,60 @@ extern "C"
 #include "LmHandlerTypes.h"
 #include "LmhpCompliance.h"
 
+/*!
+ * Number of LoRaMac events held by the LmHandler event queue. The queue is
+ * only used when LMHANDLER_EVENT_QUEUE_ENABLED is defined.
+ */
+#ifndef LMHANDLER_EVENT_QUEUE_LEN
+#define LMHANDLER_EVENT_QUEUE_LEN                   4
+#endif
+
+/*!
+ * Largest MCPS indication payload copied in the LmHandler event queue [bytes].
+ * The indications with a larger payload are processed immediately.
+ */
+#ifndef LMHANDLER_EVENT_QUEUE_PAYLOAD_SIZE
+#define LMHANDLER_EVENT_QUEUE_PAYLOAD_SIZE          242
+#endif
+
+/*!
+ * Number of uplink jobs held by the LmHandler uplink scheduler. The scheduler
+ * is only used when LMHANDLER_UPLINK_SCHEDULER_ENABLED is defined.
+ */
+#ifndef LMHANDLER_UPLINK_JOBS_LEN
+#define LMHANDLER_UPLINK_JOBS_LEN                   4
+#endif
+
+/*!
+ * Largest uplink job payload [bytes]
+ */
+#ifndef LMHANDLER_UPLINK_JOB_PAYLOAD_SIZE
+#define LMHANDLER_UPLINK_JOB_PAYLOAD_SIZE           64
+#endif
+
+/*!
+ * Largest payload of a samples batch [bytes]. The batches are only used when
+ * LMHANDLER_BATCH_ENABLED is defined.
+ */
+#ifndef LMHANDLER_BATCH_PAYLOAD_SIZE
+#define LMHANDLER_BATCH_PAYLOAD_SIZE                242
+#endif
+
+/*!
+ * Largest number of values of a batched sample
+ */
+#ifndef LMHANDLER_BATCH_MAX_NB_VALUES
+#define LMHANDLER_BATCH_MAX_NB_VALUES               8
+#endif
+
+/*!
+ * Maximum age of the system time synchronization for which the Class B
+ * switch skips the DeviceTimeReq [s]. A source like a GPS keeps the system
+ * time synchronized.
+ */
+#ifndef LMHANDLER_TIME_SYNC_MAX_AGE
+#define LMHANDLER_TIME_SYNC_MAX_AGE                 60
+#endif
 
 typedef struct LmHandlerJoinParams_s
 {
@@ -223,17 +277,39 @@ LmHandlerErrorStatus_t LmHandlerInit( LmHandlerCallbacks_t *callbacks,
  */
 bool LmHandlerIsBusy( void );
 
+/*!
+ * Indicates if a Radio, LoRaMac, queued LoRaMac event, package or NVM context
+ * event is waiting to be processed by \ref LmHandlerProcess
+ *
+ * \remark The check has to be done with the interrupts disabled before
+ *         entering a low power mode.
+ *
+ * \retval status [true] Pending, [false] idle
+ */
+bool LmHandlerHasPendingEvents( void );
+
 /*!
  * Processes the LoRaMac and Radio events. 
  * When no pendig operation asks to go in low power mode.
  *
- * \remark This function must be called in the main loop.
+ * \remark This function must be called in the main loop. It returns
+ *         immediately when no event is pending.
+ *
+ * \remark When LMHANDLER_EVENT_QUEUE_ENABLED is defined, the LoRaMac
+ *         confirms and indications are copied in a queue by the MAC and
+ *         dispatched to the application and the packages here, once the MAC
+ *         events are processed. The events are processed immediately when
+ *         the queue is full.
  */
 void LmHandlerProcess( void );
 
 /*!
  * Instructs the MAC layer to send a ClassA uplink
  *
+ * \remark When the data is the payload of a packet pool block laid out as a
+ *         \ref LoRaMacMcpsReqBuffer_t, the frame is built around it without
+ *         copy, see \ref LoRaMacMcpsRequestInPlace.
+ *
  * \param [IN] appData Data to be sent
  * \param [IN] isTxConfirmed Indicates if the uplink requires an acknowledgement
  *
@@ -242,6 +318,83 @@ void LmHandlerProcess( void );
  */
 LmHandlerErrorStatus_t LmHandlerSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed );
 
+/*!
+ * Schedules an uplink, sent at the earliest moment the MAC and the duty
+ * cycle allow
+ *
+ * \remark The payload is copied. A job replaces the pending job of the same
+ *         port, the stale sample is never sent. The jobs are sent by
+ *         decreasing priority then by increasing deadline. A job is dropped
+ *         once its deadline is missed.
+ *         When the scheduler is full the job replaces the lowest priority
+ *         job, if it has a lower priority.
+ *         Only available when LMHANDLER_UPLINK_SCHEDULER_ENABLED is defined.
+ *
+ * \param [IN] appData       Data to be sent
+ * \param [IN] isTxConfirmed Indicates if the uplink requires an acknowledgement
+ * \param [IN] priority      Job priority, the highest is sent first
+ * \param [IN] deadline      Delay after which the data is worthless [ms].
+ *                           0 when the job never expires
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the job is scheduled
+ *                else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmHandlerScheduleSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed,
+                                              uint8_t priority, TimerTime_t deadline );
+
+/*!
+ * Starts a samples batch. The samples added by \ref LmHandlerBatchAdd are
+ * delta encoded and sent together in a single uplink.
+ *
+ * \remark The batch is sent when the next sample doesn't fit in the maximum
+ *         payload of the current datarate anymore, or when its first sample
+ *         waited for the latency. The payload is
+ *
+ *         | NbValues | Age | Sample 0 | ... | Sample N |
+ *         |    1     |  2  |                          |
+ *
+ *         Age is the time elapsed since the last sample [s], little endian
+ *         and saturated to 0xFFFF. A sample is the time elapsed since the
+ *         previous sample [s] followed by the NbValues differences to the
+ *         previous sample values, 0 and the absolute values for the first
+ *         sample. The fields are LEB128 varints, the differences are zigzag
+ *         encoded first and wrap around 32 bits. LmHandlerBatchDecode.py
+ *         decodes the payloads.
+ *         Only available when LMHANDLER_BATCH_ENABLED is defined.
+ *
+ * \param [IN] port          Application port of the batches
+ * \param [IN] nbValues      Number of values of a sample, up to
+ *                           \ref LMHANDLER_BATCH_MAX_NB_VALUES
+ * \param [IN] isTxConfirmed Indicates if the batches require an acknowledgement
+ * \param [IN] latency       Maximum delay between the first sample of a
+ *                           batch and its uplink [ms]
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the batch is started
+ *                else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmHandlerBatchInit( uint8_t port, uint8_t nbValues, LmHandlerMsgTypes_t isTxConfirmed,
+                                           TimerTime_t latency );
+
+/*!
+ * Adds a sample to the batch
+ *
+ * \param [IN] values Sample values, in the application units
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the sample is added
+ *                else \ref LORAMAC_HANDLER_ERROR when the batch is full and
+ *                can't be sent yet
+ */
+LmHandlerErrorStatus_t LmHandlerBatchAdd( const int32_t *values );
+
+/*!
+ * Sends the batch without waiting for it to be full or for the latency
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the batch is empty
+ *                or sent else \ref LORAMAC_HANDLER_ERROR, the batch is sent
+ *                again later
+ */
+LmHandlerErrorStatus_t LmHandlerBatchFlush( void );
+
 /*!
  * Join a LoRa Network in classA
  *
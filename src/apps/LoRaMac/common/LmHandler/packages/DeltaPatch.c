@@ -0,0 +1,161 @@
+/*!
+ * \file      DeltaPatch.c
+ *
+ * \brief     Applies a delta patch received through a fragmentation session
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "utilities.h"
+#include "DeltaPatch.h"
+
+/*!
+ * \brief Gets a little endian 32 bits field
+ *
+ * \param [IN] buffer Field start
+ *
+ * \retval value      Field value
+ */
+static uint32_t DeltaPatchGet32( const uint8_t *buffer )
+{
+    return ( ( uint32_t )buffer[0] << 0 ) | ( ( uint32_t )buffer[1] << 8 ) |
+           ( ( uint32_t )buffer[2] << 16 ) | ( ( uint32_t )buffer[3] << 24 );
+}
+
+bool DeltaPatchIsPatch( const DeltaPatchParams_t *params, uint32_t patchAddr, uint32_t patchSize )
+{
+    uint8_t header[DELTA_PATCH_HEADER_SIZE];
+
+    if( ( params == NULL ) || ( patchSize < DELTA_PATCH_HEADER_SIZE ) ||
+        ( params->ReadPatch( patchAddr, header, DELTA_PATCH_HEADER_SIZE ) != 0 ) )
+    {
+        return false;
+    }
+    return DeltaPatchGet32( header ) == DELTA_PATCH_MAGIC;
+}
+
+DeltaPatchStatus_t DeltaPatchApply( const DeltaPatchParams_t *params, uint32_t patchAddr, uint32_t patchSize, uint32_t *targetSize )
+{
+    uint8_t data[DELTA_PATCH_CHUNK_SIZE];
+    uint8_t diff[DELTA_PATCH_CHUNK_SIZE];
+    uint32_t patchPos = DELTA_PATCH_HEADER_SIZE;
+    uint32_t sourcePos = 0;
+    uint32_t targetPos = 0;
+    uint32_t size;
+
+    *targetSize = 0;
+
+    if( DeltaPatchIsPatch( params, patchAddr, patchSize ) == false )
+    {
+        return DELTA_PATCH_STATUS_NOT_A_PATCH;
+    }
+    if( params->ReadPatch( patchAddr, data, DELTA_PATCH_HEADER_SIZE ) != 0 )
+    {
+        return DELTA_PATCH_STATUS_ERROR_STORAGE;
+    }
+    if( ( DeltaPatchGet32( &data[4] ) != params->SourceSize ) ||
+        ( DeltaPatchGet32( &data[8] ) > params->TargetMaxSize ) )
+    {
+        // Built against another image or too large for the target storage
+        return DELTA_PATCH_STATUS_ERROR_FORMAT;
+    }
+    size = DeltaPatchGet32( &data[8] );
+
+    while( targetPos < size )
+    {
+        uint32_t diffLen;
+        uint32_t extraLen;
+        int32_t seek;
+
+        if( ( patchSize - patchPos ) < DELTA_PATCH_CTRL_SIZE )
+        {
+            return DELTA_PATCH_STATUS_ERROR_FORMAT;
+        }
+        if( params->ReadPatch( patchAddr + patchPos, data, DELTA_PATCH_CTRL_SIZE ) != 0 )
+        {
+            return DELTA_PATCH_STATUS_ERROR_STORAGE;
+        }
+        patchPos += DELTA_PATCH_CTRL_SIZE;
+        diffLen = DeltaPatchGet32( &data[0] );
+        extraLen = DeltaPatchGet32( &data[4] );
+        seek = ( int32_t )DeltaPatchGet32( &data[8] );
+
+        if( ( diffLen > ( size - targetPos ) ) || ( diffLen > ( params->SourceSize - sourcePos ) ) ||
+            ( diffLen > ( patchSize - patchPos ) ) )
+        {
+            return DELTA_PATCH_STATUS_ERROR_FORMAT;
+        }
+        // Target bytes are the source bytes plus the diff bytes
+        while( diffLen > 0 )
+        {
+            uint32_t chunk = MIN( diffLen, DELTA_PATCH_CHUNK_SIZE );
+
+            if( ( params->ReadSource( sourcePos, data, chunk ) != 0 ) ||
+                ( params->ReadPatch( patchAddr + patchPos, diff, chunk ) != 0 ) )
+            {
+                return DELTA_PATCH_STATUS_ERROR_STORAGE;
+            }
+            for( uint32_t i = 0; i < chunk; i++ )
+            {
+                data[i] += diff[i];
+            }
+            if( params->WriteTarget( targetPos, data, chunk ) != 0 )
+            {
+                return DELTA_PATCH_STATUS_ERROR_STORAGE;
+            }
+            sourcePos += chunk;
+            patchPos += chunk;
+            targetPos += chunk;
+            diffLen -= chunk;
+        }
+
+        if( ( extraLen > ( size - targetPos ) ) || ( extraLen > ( patchSize - patchPos ) ) )
+        {
+            return DELTA_PATCH_STATUS_ERROR_FORMAT;
+        }
+        // New bytes are copied as is
+        while( extraLen > 0 )
+        {
+            uint32_t chunk = MIN( extraLen, DELTA_PATCH_CHUNK_SIZE );
+
+            if( ( params->ReadPatch( patchAddr + patchPos, data, chunk ) != 0 ) ||
+                ( params->WriteTarget( targetPos, data, chunk ) != 0 ) )
+            {
+                return DELTA_PATCH_STATUS_ERROR_STORAGE;
+            }
+            patchPos += chunk;
+            targetPos += chunk;
+            extraLen -= chunk;
+        }
+
+        if( ( ( seek < 0 ) && ( ( uint32_t )-( int64_t )seek > sourcePos ) ) ||
+            ( ( seek > 0 ) && ( ( uint32_t )seek > ( params->SourceSize - sourcePos ) ) ) )
+        {
+            return DELTA_PATCH_STATUS_ERROR_FORMAT;
+        }
+        sourcePos += ( uint32_t )seek;
+    }
+
+    if( patchPos != patchSize )
+    {
+        // Trailing bytes, the patch is not the one expected
+        return DELTA_PATCH_STATUS_ERROR_FORMAT;
+    }
+    *targetSize = size;
+    return DELTA_PATCH_STATUS_OK;
+}
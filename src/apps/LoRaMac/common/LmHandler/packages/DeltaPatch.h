@@ -0,0 +1,155 @@
+/*!
+ * \file      DeltaPatch.h
+ *
+ * \brief     Applies a delta patch received through a fragmentation session
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __DELTA_PATCH_H__
+#define __DELTA_PATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Patch header magic, "LDP1" little endian
+ */
+#define DELTA_PATCH_MAGIC                           0x3150444C
+
+/*!
+ * Size of the patch header [bytes]
+ *
+ * | Magic | Source size | Target size |
+ * |   4   |      4      |      4      |
+ */
+#define DELTA_PATCH_HEADER_SIZE                     12
+
+/*!
+ * Size of a patch control block [bytes]
+ *
+ * | Diff length | Extra length | Source seek |
+ * |      4      |      4       |      4      |
+ *
+ * The diff length bytes of the target are the source bytes plus the diff
+ * bytes following the control block. The extra length bytes following the
+ * diff bytes are copied as is. The source position then moves by the signed
+ * source seek. All the fields are little endian.
+ */
+#define DELTA_PATCH_CTRL_SIZE                       12
+
+/*!
+ * Size of the buffers the patch is streamed through [bytes]
+ *
+ * \remark Two buffers of this size are on the stack while patching.
+ */
+#ifndef DELTA_PATCH_CHUNK_SIZE
+#define DELTA_PATCH_CHUNK_SIZE                      64
+#endif
+
+/*!
+ * Delta patch status
+ */
+typedef enum eDeltaPatchStatus
+{
+    /*!
+     * The target image is written
+     */
+    DELTA_PATCH_STATUS_OK,
+    /*!
+     * The file does not start with a patch header, it is a full image
+     */
+    DELTA_PATCH_STATUS_NOT_A_PATCH,
+    /*!
+     * The patch does not apply to the source image or is corrupted
+     */
+    DELTA_PATCH_STATUS_ERROR_FORMAT,
+    /*!
+     * A storage read or write failed
+     */
+    DELTA_PATCH_STATUS_ERROR_STORAGE,
+}DeltaPatchStatus_t;
+
+typedef struct sDeltaPatchParams
+{
+    /*!
+     * Reads `data` buffer of `size` starting at address `addr` of the
+     * received patch. Usually the FragDecoderRead callback.
+     *
+     * \param [IN] addr Address start index to read from.
+     * \param [IN] data Data buffer to be read.
+     * \param [IN] size Size of data buffer to be read.
+     *
+     * \retval status Read operation status [0: Success, -1 Fail]
+     */
+    uint8_t ( *ReadPatch )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Reads `data` buffer of `size` starting at address `addr` of the
+     * running image
+     *
+     * \param [IN] addr Address start index to read from.
+     * \param [IN] data Data buffer to be read.
+     * \param [IN] size Size of data buffer to be read.
+     *
+     * \retval status Read operation status [0: Success, -1 Fail]
+     */
+    uint8_t ( *ReadSource )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Writes `data` buffer of `size` starting at address `addr` of the new
+     * image. The image is written in order, from address 0.
+     *
+     * \param [IN] addr Address start index to write to.
+     * \param [IN] data Data buffer to be written.
+     * \param [IN] size Size of data buffer to be written.
+     *
+     * \retval status Write operation status [0: Success, -1 Fail]
+     */
+    uint8_t ( *WriteTarget )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Size of the running image the patches are built against
+     */
+    uint32_t SourceSize;
+    /*!
+     * Size of the new image storage area
+     */
+    uint32_t TargetMaxSize;
+}DeltaPatchParams_t;
+
+/*!
+ * \brief Checks if the received file is a delta patch
+ *
+ * \param [IN] params    Delta patch parameters
+ * \param [IN] patchAddr Address of the received file
+ * \param [IN] patchSize Size of the received file
+ *
+ * \retval isPatch       Returns true if the file starts with a patch header
+ */
+bool DeltaPatchIsPatch( const DeltaPatchParams_t *params, uint32_t patchAddr, uint32_t patchSize );
+
+/*!
+ * \brief Rebuilds the new image out of the running image and the received
+ *        patch. The new image is streamed to the target storage, the source
+ *        and the target must not overlap.
+ *
+ * \param [IN]  params     Delta patch parameters
+ * \param [IN]  patchAddr  Address of the received file
+ * \param [IN]  patchSize  Size of the received file
+ * \param [OUT] targetSize Size of the new image
+ *
+ * \retval status          Patch status
+ */
+DeltaPatchStatus_t DeltaPatchApply( const DeltaPatchParams_t *params, uint32_t patchAddr, uint32_t patchSize, uint32_t *targetSize );
+
+#endif // __DELTA_PATCH_H__
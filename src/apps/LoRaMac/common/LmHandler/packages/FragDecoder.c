@@ -21,6 +21,7 @@
  * \author    Miguel Luis ( Semtech )
  */
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include "utilities.h"
 #include "FragDecoder.h"
@@ -48,35 +49,51 @@
  *=============================================================================
  */
 
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 ) && ( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
 typedef struct
 {
-#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-    FragDecoderCallbacks_t *Callbacks;
-#else
-    uint8_t *File;
-    uint32_t FileSize;
+    // Decoder whose file bytes are cached, the cache is shared by the
+    // decoders
+    FragDecoder_t *Owner;
+    // File address of the cached page
+    uint32_t PageAddr;
+    // Range of the page bytes not yet written to the file. The cache is
+    // clean when Start equals End.
+    uint16_t Start;
+    uint16_t End;
+    uint8_t Data[FRAG_DECODER_WRITE_CACHE_SIZE];
+}FragDecoderWriteCache_t;
 #endif
-    uint16_t FragNb;
-    uint8_t FragSize;
-
-    uint32_t M2BLine;
-    uint8_t MatrixM2B[( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ) * FRAG_MAX_REDUNDANCY];
-    uint16_t FragNbMissingIndex[FRAG_MAX_NB];
-
-    uint8_t S[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
 
-    FragDecoderStatus_t Status;
-}FragDecoder_t;
+/*!
+ * Address spaces shared by the sessions
+ */
+typedef enum
+{
+    /*!
+     * Workspace pool
+     */
+    FRAG_SPACE_POOL,
+    /*!
+     * File storage
+     */
+    FRAG_SPACE_FILE,
+    /*!
+     * Parity matrix storage area
+     */
+    FRAG_SPACE_MATRIX,
+}FragSpace_t;
 
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 /*!
  * \brief Sets a row from source into file destination
  *
+ * \param [IN] obj  Decoder object
  * \param [IN] src  Source buffer pointer
  * \param [IN] row  Destination index of the row to be copied
  * \param [IN] size Source number of bytes to be copied
  */
-static void SetRow( uint8_t *src, uint16_t row, uint16_t size );
+static void SetRow( FragDecoder_t *obj, uint8_t *src, uint16_t row, uint16_t size );
 #else
 /*!
  * \brief Sets a row from source into destination
@@ -93,11 +110,38 @@ static void SetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size );
 /*!
  * \brief Gets a row from source and stores it into file destination
  *
+ * \param [IN] obj  Decoder object
  * \param [IN] src  Source buffer pointer
  * \param [IN] row  Source index of the row to be copied
  * \param [IN] size Source number of bytes to be copied
  */
-static void GetRow( uint8_t *src, uint16_t row, uint16_t size );
+static void GetRow( FragDecoder_t *obj, uint8_t *src, uint16_t row, uint16_t size );
+
+/*!
+ * \brief Writes bytes to the file through the write cache
+ *
+ * \param [IN] obj  Decoder object
+ * \param [IN] addr File address
+ * \param [IN] data Bytes to be written
+ * \param [IN] size Number of bytes to be written
+ */
+static void FragFileWrite( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size );
+
+/*!
+ * \brief Reads bytes from the file, including the ones still in the write
+ *        cache
+ *
+ * \param [IN]  obj  Decoder object
+ * \param [IN]  addr File address
+ * \param [OUT] data Read bytes
+ * \param [IN]  size Number of bytes to be read
+ */
+static void FragFileRead( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size );
+
+/*!
+ * \brief Writes the pending write cache bytes to the file of their decoder
+ */
+static void FragFileFlush( void );
 #else
 /*!
  * \brief Gets a row from source and stores it into destination
@@ -118,7 +162,7 @@ static void GetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size );
  *
  * \retval parity         Parity value at the given index
  */
-static uint8_t GetParity( uint8_t index, uint8_t *matrixRow  );
+static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  );
 
 /*!
  * \brief Sets the parity value on the given row of the parity matrix
@@ -127,7 +171,7 @@ static uint8_t GetParity( uint8_t index, uint8_t *matrixRow  );
  * \param [IN/OUT] matrixRow Pointer to the parity matrix.
  * \param [IN]     parity    The parity value to be set in the parity matrix
  */
-static void SetParity( uint8_t index, uint8_t *matrixRow, uint8_t parity );
+static void SetParity( uint16_t index, uint8_t *matrixRow, uint8_t parity );
 
 /*!
  * \brief Check if the provided value is a power of 2
@@ -169,6 +213,18 @@ static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size );
  */
 static int32_t FragPrbs23( int32_t value );
 
+/*!
+ * \brief Computes the remainder of a division by a constant divisor using its
+ *        precomputed reciprocal
+ *
+ * \param [IN] x          Dividend
+ * \param [IN] divisor    Divisor
+ * \param [IN] reciprocal 0xFFFFFFFF / divisor
+ *
+ * \retval remainder      x % divisor
+ */
+static uint32_t FragModulo( uint32_t x, uint32_t divisor, uint32_t reciprocal );
+
 /*!
  * \brief Gets and fills the parity matrix
  *
@@ -196,40 +252,201 @@ static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size );
  */
 static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size );
 
+/*!
+ * \brief Gets 8 consecutive bits of a bit array starting at any bit index
+ *
+ * \param [IN] bitArray Pointer to the bit array
+ * \param [IN] size     Bit array size in bytes
+ * \param [IN] index    Index of the first bit. Bits out of the array are read as 0
+ * \retval bits         Bits. The bit at the given index is the most significant one
+ */
+static uint8_t BitArrayGetByte( uint8_t *bitArray, uint32_t size, int32_t index );
+
+/*!
+ * \brief Computes the mask of the bits of a bit array byte that are in a range
+ *
+ * \param [IN] byteIndex Index of the byte in the bit array
+ * \param [IN] first     Index of the first bit of the range
+ * \param [IN] last      Index following the last bit of the range
+ * \retval mask          Mask of the bits in the range
+ */
+static uint8_t BitArrayRangeMask( uint32_t byteIndex, uint32_t first, uint32_t last );
+
+/*!
+ * \brief Counts the number of bits set in a byte
+ *
+ * \param [IN] bits Byte to be tested
+ * \retval count    Number of bits set
+ */
+static uint8_t BitCount( uint8_t bits );
+
+/*!
+ * \brief Gets the received fragments bit array of a session. The lost
+ *        fragments are numbered in the fragment counter order.
+ *
+ * \param [IN] ctx Session context
+ * \retval bits    Received uncoded fragments bit array
+ */
+static uint8_t* FragGetRxBitArray( FragDecoderCtx_t *ctx );
+
+/*!
+ * \brief Gets the diagonalized parity rows bit array of a session
+ *
+ * \param [IN] ctx Session context
+ * \retval bits    Diagonalized rows bit array
+ */
+static uint8_t* FragGetS( FragDecoderCtx_t *ctx );
+
+/*!
+ * \brief Counts the lost fragments among the 8 fragments of a received
+ *        fragments bit array byte
+ *
+ * \param [IN] ctx       Session context
+ * \param [IN] byteIndex Index of the byte in the received fragments bit array
+ * \retval count         Number of lost fragments
+ */
+static uint8_t FragCountLost( FragDecoderCtx_t *ctx, uint16_t byteIndex );
+
+/*!
+ * \brief Reads bytes from the parity matrix
+ *
+ * \param [IN]  obj  Decoder object
+ * \param [IN]  addr Parity matrix byte index
+ * \param [OUT] data Read bytes
+ * \param [IN]  size Number of bytes to be read
+ */
+static void FragMatrixRead( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size );
+
+/*!
+ * \brief Writes bytes to the parity matrix
+ *
+ * \param [IN] obj  Decoder object
+ * \param [IN] addr Parity matrix byte index
+ * \param [IN] data Bytes to be written
+ * \param [IN] size Number of bytes to be written
+ */
+static void FragMatrixWrite( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size );
+
 /*!
  * \brief Finds & marks missing fragments
  *
+ * \param [IN]  obj     Decoder object
  * \param [IN]  counter Current fragment counter
- * \param [OUT] FragDecoder.FragNbMissingIndex[] array is updated in place
+ * \param [OUT] obj->Status.FragNbLost is updated in place
  */
-static void FragFindMissingFrags( uint16_t counter );
+static void FragFindMissingFrags( FragDecoder_t *obj, uint16_t counter );
 
 /*!
  * \brief Finds the index (frag counter) of the x th missing frag
  *
+ * \param [IN] ctx Session context
  * \param [IN] x   x th missing frag
  *
  * \retval counter The counter value associated to the x th missing frag
  */
-static uint16_t FragFindMissingIndex( uint16_t x );
+static uint16_t FragFindMissingIndex( FragDecoderCtx_t *ctx, uint16_t x );
 
 /*!
  * \brief Extacts a row from the binary matrix and expands it to a bitArray
  *
+ * \param [IN] obj       Decoder object
  * \param [IN] bitArray  Pointer to the bit array
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow );
+static void FragExtractLineFromBinaryMatrix( FragDecoder_t *obj, uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow );
 
 /*!
  * \brief Collapses and Pushs a row of a bit array to the matrix
  *
+ * \param [IN] obj       Decoder object
  * \param [IN] bitArray  Pointer to the bit array
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow );
+static void FragPushLineToBinaryMatrix( FragDecoder_t *obj, uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow );
+
+/*!
+ * \brief Sets the parity matrix back to its initial state
+ *
+ * \param [IN] obj Decoder object
+ */
+static void FragResetParityMatrix( FragDecoder_t *obj );
+
+/*!
+ * \brief Checks if all the uncoded fragments are received
+ *
+ * \param [IN] ctx Session context
+ *
+ * \retval complete True if the file is complete
+ */
+static bool FragIsFileComplete( FragDecoderCtx_t *ctx );
+
+/*!
+ * \brief Gets the range a session uses in one of the shared address spaces
+ *
+ * \param [IN]  ctx   Session context
+ * \param [IN]  space Address space
+ * \param [OUT] start Range start
+ * \param [OUT] size  Range size
+ */
+static void FragSpaceGetRange( FragDecoderCtx_t *ctx, FragSpace_t space, uint32_t *start, uint32_t *size );
+
+/*!
+ * \brief Checks if a range of a shared address space is used by no session
+ *
+ * \param [IN] skip      Session context whose range is considered free
+ * \param [IN] space     Address space
+ * \param [IN] spaceSize Size of the address space
+ * \param [IN] addr      Range start
+ * \param [IN] size      Range size
+ *
+ * \retval free          True if the range is free
+ */
+static bool FragSpaceIsFree( FragDecoderCtx_t *skip, FragSpace_t space, uint32_t spaceSize, uint32_t addr, uint32_t size );
+
+/*!
+ * \brief Finds the lowest free range of a shared address space
+ *
+ * \param [IN]  skip      Session context whose range is considered free
+ * \param [IN]  space     Address space
+ * \param [IN]  spaceSize Size of the address space
+ * \param [IN]  size      Range size
+ * \param [OUT] addr      Range start
+ *
+ * \retval found          True if a free range is found
+ */
+static bool FragSpaceFind( FragDecoderCtx_t *skip, FragSpace_t space, uint32_t spaceSize, uint32_t size, uint32_t *addr );
+
+/*!
+ * \brief Finds the workspace and storage ranges of a session
+ *
+ * \param [IN]  skip     Session context whose ranges are considered free
+ * \param [IN]  fragNb   Number of fragments
+ * \param [IN]  fragSize Size of a fragment
+ * \param [OUT] layout   Storage ranges, FileAddr and MatrixAddr, of the session
+ * \param [OUT] poolAddr Workspace pool address
+ *
+ * \retval found         True if the pool and the storage can hold the session
+ */
+static bool FragFindRanges( FragDecoderCtx_t *skip, uint16_t fragNb, uint8_t fragSize, FragDecoderCtx_t *layout, uint32_t *poolAddr );
+
+/*!
+ * \brief Registers a session context placed in the workspace pool
+ *
+ * \param [IN] obj      Decoder object
+ * \param [IN] poolAddr Workspace pool address of the context
+ */
+static void FragAttachCtx( FragDecoder_t *obj, uint32_t poolAddr );
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+/*!
+ * \brief Notifies that the decoder state changed
+ *
+ * \param [IN] obj Decoder object
+ */
+static void FragSaveNvmCtx( FragDecoder_t *obj );
+#endif
 
 /*
  *=============================================================================
@@ -237,68 +454,232 @@ static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, ui
  *=============================================================================
  */
 
-static FragDecoder_t FragDecoder;
+/*!
+ * Workspace pool the sessions contexts are drawn from, words keep the
+ * contexts aligned
+ */
+static uint32_t FragDecoderPool[( FRAG_DECODER_POOL_SIZE + 3 ) / 4];
+
+/*!
+ * Contexts of the sessions holding a workspace, NULL for a free entry
+ */
+static FragDecoderCtx_t *FragDecoderCtxs[FRAG_DECODER_MAX_SESSIONS];
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 ) && ( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
+static FragDecoderWriteCache_t FragDecoderWriteCache;
+#endif
 
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t *callbacks )
+bool FragDecoderInit( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t *callbacks )
 #else
-void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, uint8_t *file, uint32_t fileSize )
+bool FragDecoderInit( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize, uint8_t *file, uint32_t fileSize )
 #endif
 {
+    FragDecoderCtx_t layout;
+    FragDecoderCtx_t *ctx;
+    uint32_t poolAddr = 0;
+
+    FragDecoderDeInit( obj );
+
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-    FragDecoder.Callbacks = callbacks;
+    obj->Callbacks = callbacks;
 #else
-    FragDecoder.File = file;
-    FragDecoder.FileSize = fileSize;
+    obj->File = file;
+    obj->FileSize = fileSize;
 #endif
-    FragDecoder.FragNb = fragNb;                                // FragNb = FRAG_MAX_SIZE
-    FragDecoder.FragSize = fragSize;                            // number of byte on a row
-    FragDecoder.Status.FragNbLastRx = 0;
-    FragDecoder.Status.FragNbLost = 0;
-    FragDecoder.M2BLine = 0;
+    obj->Status.FragNbRx = 0;
+    obj->Status.FragNbLastRx = 0;
+    obj->Status.FragNbLost = 0;
+    obj->Status.MatrixError = 0;
 
-    // Initialize missing fragments index array
-    for( uint16_t i = 0; i < FRAG_MAX_NB; i++ )
+    if( FragFindRanges( NULL, fragNb, fragSize, &layout, &poolAddr ) == false )
     {
-        FragDecoder.FragNbMissingIndex[i] = 1;
+        return false;
     }
+    FragAttachCtx( obj, poolAddr );
+    ctx = obj->Ctx;
+    ctx->Descriptor = 0;
+    ctx->FileAddr = layout.FileAddr;
+    ctx->MatrixAddr = layout.MatrixAddr;
+    ctx->CtxSize = FRAG_DECODER_WORKSPACE_SIZE( fragNb );
+    ctx->FragNb = fragNb;                                       // FragNb = FRAG_MAX_SIZE
+    ctx->FragSize = fragSize;                                   // number of byte on a row
+    ctx->Redundancy = FRAG_DECODER_REDUNDANCY( fragNb );
+
+    // Initialize received fragments bit array
+    memset1( FragGetRxBitArray( ctx ), 0, ( fragNb >> 3 ) + 1 );
 
     // Initialize parity matrix
-    for( uint32_t i = 0; i < ( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ); i++ )
+    FragResetParityMatrix( obj );
+
+    // Initialize final uncoded data buffer ( FRAG_MAX_NB * FRAG_MAX_SIZE )
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    {
+        uint8_t erasedRow[FRAG_MAX_SIZE];
+
+        memset1( erasedRow, 0xFF, sizeof( erasedRow ) );
+        for( uint16_t i = 0; i < fragNb; i++ )
+        {
+            SetRow( obj, erasedRow, i, fragSize );
+        }
+    }
+#else
+    for( uint32_t i = 0; i < ( fragNb * fragSize ); i++ )
     {
-        FragDecoder.S[i] = 0;
+        obj->File[i] = 0xFF;
     }
+#endif
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    FragSaveNvmCtx( obj );
+#endif
+    return true;
+}
 
-    for( uint32_t i = 0; i < ( ( ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 ) * FRAG_MAX_REDUNDANCY ); i++ )
+void FragDecoderDeInit( FragDecoder_t *obj )
+{
+    if( obj->Ctx == NULL )
     {
-       FragDecoder.MatrixM2B[i] = 0xFF;
+        return;
     }
-    
-    // Initialize final uncoded data buffer ( FRAG_MAX_NB * FRAG_MAX_SIZE )
-    for( uint32_t i = 0; i < ( fragNb * fragSize ); i++ )
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 ) && ( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
+    if( FragDecoderWriteCache.Owner == obj )
+    {
+        FragFileFlush( );
+        FragDecoderWriteCache.Owner = NULL;
+    }
+#endif
+    for( uint8_t i = 0; i < FRAG_DECODER_MAX_SESSIONS; i++ )
     {
+        if( FragDecoderCtxs[i] == obj->Ctx )
+        {
+            FragDecoderCtxs[i] = NULL;
+        }
+    }
+    obj->Ctx = NULL;
+}
+
+bool FragDecoderIsSessionSupported( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize )
+{
+    FragDecoderCtx_t layout;
+    uint32_t poolAddr = 0;
+
+    return FragFindRanges( obj->Ctx, fragNb, fragSize, &layout, &poolAddr );
+}
+
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-        if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
+bool FragDecoderResume( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize, uint32_t descriptor, FragDecoderCallbacks_t *callbacks )
+{
+    FragDecoderCtx_t *ctx = obj->Ctx;
+
+    if( ( ctx == NULL ) || ( ctx->FragNb != fragNb ) || ( ctx->FragSize != fragSize ) ||
+        ( ctx->Descriptor != descriptor ) )
+    {
+        if( FragDecoderInit( obj, fragNb, fragSize, callbacks ) == true )
         {
-            FragDecoder.Callbacks->FragDecoderWrite( i, ( uint8_t[] ){ 0xFF }, 1 );
+            obj->Ctx->Descriptor = descriptor;
+            FragSaveNvmCtx( obj );
         }
-#else
-        FragDecoder.File[i] = 0xFF;
+        return false;
+    }
+
+    obj->Callbacks = callbacks;
+#if( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
+    if( FragDecoderWriteCache.Owner == obj )
+    {
+        FragFileFlush( );
+    }
 #endif
+
+    // The fragments counters restart with the session. The lost fragments are
+    // counted again, skipping the ones already received. The received
+    // fragments and the reduced parity rows are kept in the workspace.
+    obj->Status.FragNbRx = 0;
+    obj->Status.FragNbLost = 0;
+    obj->Status.FragNbLastRx = 0;
+    obj->Status.MatrixError = 0;
+    FragSaveNvmCtx( obj );
+    return true;
+}
+
+void* FragDecoderGetNvmCtx( FragDecoder_t *obj, uint32_t *nvmCtxSize )
+{
+    if( obj->Ctx == NULL )
+    {
+        *nvmCtxSize = 0;
+        return NULL;
     }
-    FragDecoder.Status.FragNbLost = 0;
-    FragDecoder.Status.FragNbLastRx = 0;
+    // The workspace is stored as is
+    *nvmCtxSize = obj->Ctx->CtxSize;
+    return obj->Ctx;
+}
+
+bool FragDecoderRestoreNvmCtx( FragDecoder_t *obj, const void *nvmCtx )
+{
+    const FragDecoderCtx_t *ctx = ( const FragDecoderCtx_t* )nvmCtx;
+    uint32_t poolAddr = 0;
+
+    if( ( ctx == NULL ) ||
+        ( ctx->FragNb == 0 ) || ( ctx->FragNb > FRAG_MAX_NB ) ||
+        ( ctx->FragSize == 0 ) || ( ctx->FragSize > FRAG_MAX_SIZE ) ||
+        ( ctx->Redundancy != FRAG_DECODER_REDUNDANCY( ctx->FragNb ) ) ||
+        ( ctx->CtxSize != FRAG_DECODER_WORKSPACE_SIZE( ctx->FragNb ) ) ||
+        ( ctx->M2BLine > ctx->Redundancy ) )
+    {
+        // Erased or corrupted storage
+        return false;
+    }
+
+    FragDecoderDeInit( obj );
+    // The file rows and the parity matrix are already in the storage, their
+    // ranges must still be free
+    if( ( FragSpaceIsFree( NULL, FRAG_SPACE_FILE, FragDecoderGetMaxFileSize( ), ctx->FileAddr,
+                           ( uint32_t )ctx->FragNb * ctx->FragSize ) == false ) ||
+#if( FRAG_DECODER_MATRIX_IN_STORAGE == 1 )
+        ( FragSpaceIsFree( NULL, FRAG_SPACE_MATRIX, FRAG_DECODER_MATRIX_STORAGE_SIZE, ctx->MatrixAddr,
+                           FRAG_DECODER_PARITY_MATRIX_SIZE( ctx->Redundancy ) ) == false ) ||
+#endif
+        ( FragSpaceFind( NULL, FRAG_SPACE_POOL, FRAG_DECODER_POOL_SIZE, ctx->CtxSize, &poolAddr ) == false ) )
+    {
+        return false;
+    }
+    FragAttachCtx( obj, poolAddr );
+    memcpy1( ( uint8_t* )obj->Ctx, ( const uint8_t* )ctx, ctx->CtxSize );
+    obj->Status.FragNbRx = 0;
+    obj->Status.FragNbLost = 0;
+    obj->Status.FragNbLastRx = 0;
+    obj->Status.MatrixError = 0;
+    return true;
 }
 
-#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 uint32_t FragDecoderGetMaxFileSize( void )
 {
     return FRAG_MAX_NB * FRAG_MAX_SIZE;
 }
+
+uint32_t FragDecoderGetFileAddr( FragDecoder_t *obj )
+{
+    if( obj->Ctx == NULL )
+    {
+        return 0;
+    }
+    return obj->Ctx->FileAddr;
+}
 #endif
 
-int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
+/*!
+ * \brief Decodes a received fragment
+ *
+ * \param [IN] obj         Decoder object
+ * \param [IN] fragCounter Fragment counter
+ * \param [IN] rawData     Fragment data
+ *
+ * \retval status          Process status, see \ref FragDecoderProcess
+ */
+static int32_t FragDecode( FragDecoder_t *obj, uint16_t fragCounter, uint8_t *rawData )
 {
+    FragDecoderCtx_t *ctx = obj->Ctx;
+    uint8_t *rxBitArray = FragGetRxBitArray( ctx );
+    uint8_t *s = FragGetS( ctx );
     uint16_t firstOneInRow = 0;
     int32_t first = 0;
     int32_t noInfo = 0;
@@ -313,79 +694,122 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
     memset1( dataTempVector, 0, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 );
     memset1( dataTempVector2, 0, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1 );
 
-    FragDecoder.Status.FragNbRx = fragCounter;
+    obj->Status.FragNbRx = fragCounter;
 
-    if( fragCounter < FragDecoder.Status.FragNbLastRx )
+    if( fragCounter < obj->Status.FragNbLastRx )
     {
         return FRAG_SESSION_ONGOING;  // Drop frame out of order
     }
 
     // The M (FragNb) first packets aren't encoded or in other words they are
     // encoded with the unitary matrix
-    if( fragCounter < ( FragDecoder.FragNb + 1 ) )
+    if( fragCounter < ( ctx->FragNb + 1 ) )
     {
-        // The M first frame are not encoded store them
+        // A resumed session already holds some of the fragments
+        if( GetParity( fragCounter - 1, rxBitArray ) == 0 )
+        {
+            // The M first frame are not encoded store them
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-        SetRow( rawData, fragCounter - 1, FragDecoder.FragSize );
+            SetRow( obj, rawData, fragCounter - 1, ctx->FragSize );
 #else
-        SetRow( FragDecoder.File, rawData, fragCounter - 1, FragDecoder.FragSize );
+            SetRow( obj->File, rawData, fragCounter - 1, ctx->FragSize );
 #endif
 
-        FragDecoder.FragNbMissingIndex[fragCounter - 1] = 0;
+            SetParity( fragCounter - 1, rxBitArray, 1 );
 
-        // Update the FragDecoder.FragNbMissingIndex with the loosing frame
-        FragFindMissingFrags( fragCounter );
+            if( ctx->M2BLine != 0 )
+            {
+                // The parity rows of a resumed session are indexed by the
+                // lost fragments, one of them is no longer lost
+                FragResetParityMatrix( obj );
+            }
+        }
+
+        // Update the lost fragments count with the loosing frames
+        FragFindMissingFrags( obj, fragCounter );
+
+        if( FragIsFileComplete( ctx ) == true )
+        {
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+            FragFileFlush( );
+#endif
+            return obj->Status.FragNbLost;
+        }
     }
     else
     {
-        if( FragDecoder.Status.FragNbLost > FRAG_MAX_REDUNDANCY )
+        // In case of the end of true data is missing
+        FragFindMissingFrags( obj, fragCounter );
+
+        // The parity rows are sized after the session redundancy, more lost
+        // fragments would overflow into the neighbouring workspace
+        if( obj->Status.FragNbLost > ctx->Redundancy )
         {
-           FragDecoder.Status.MatrixError = 1;
+           obj->Status.MatrixError = 1;
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+           FragFileFlush( );
+#endif
            return FRAG_SESSION_FINISHED;
         }
         // At this point we receive encoded frames and the number of loosing frames
-        // is well known: FragDecoder.FragNbLost - 1;
+        // is well known: obj->Status.FragNbLost - 1;
 
-        // In case of the end of true data is missing
-        FragFindMissingFrags( fragCounter );
-
-        if( FragDecoder.Status.FragNbLost == 0 )
+        if( obj->Status.FragNbLost == 0 )
         { 
             // the case : all the M(FragNb) first rows have been transmitted with no error
-            return FragDecoder.Status.FragNbLost;
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+            FragFileFlush( );
+#endif
+            return obj->Status.FragNbLost;
         }
 
-        // fragCounter - FragDecoder.FragNb
-        FragGetParityMatrixRow( fragCounter - FragDecoder.FragNb, FragDecoder.FragNb, matrixRow );
+        // fragCounter - ctx->FragNb
+        FragGetParityMatrixRow( fragCounter - ctx->FragNb, ctx->FragNb, matrixRow );
+
+        // Number of lost fragments preceding the fragment i
+        uint16_t nbLost = 0;
 
-        for( int32_t i = 0; i < FragDecoder.FragNb; i++ )
+        for( int32_t i = 0; i < ctx->FragNb; i++ )
         {
+            if( ( ( i & 0x07 ) == 0 ) && ( matrixRow[i >> 3] == 0 ) )
+            {
+                // No coefficient in this byte of the parity row
+                nbLost += FragCountLost( ctx, i >> 3 );
+                i += 7;
+                continue;
+            }
+            bool isLost = ( GetParity( i, rxBitArray ) == 0 );
+
             if( GetParity( i , matrixRow ) == 1 )
             {
-                if( FragDecoder.FragNbMissingIndex[i] == 0 )
+                if( isLost == false )
                 {
                     // XOR with already receive frag
                     SetParity( i, matrixRow, 0 );
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                    GetRow( matrixDataTemp, i, FragDecoder.FragSize );
+                    GetRow( obj, matrixDataTemp, i, ctx->FragSize );
 #else
-                    GetRow( matrixDataTemp, FragDecoder.File, i, FragDecoder.FragSize );
+                    GetRow( matrixDataTemp, obj->File, i, ctx->FragSize );
 #endif
-                    XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
+                    XorDataLine( rawData, matrixDataTemp, ctx->FragSize );
                 }
                 else
                 {
                     // Fill the "little" boolean matrix m2b
-                    SetParity( FragDecoder.FragNbMissingIndex[i] - 1, dataTempVector, 1 );
+                    SetParity( nbLost, dataTempVector, 1 );
                     if( first == 0 )
                     {
                         first = 1;
                     }
                 }
             }
+            if( isLost == true )
+            {
+                nbLost++;
+            }
         }
 
-        firstOneInRow = BitArrayFindFirstOne( dataTempVector, FragDecoder.Status.FragNbLost );
+        firstOneInRow = BitArrayFindFirstOne( dataTempVector, obj->Status.FragNbLost );
 
         if( first > 0 )
         {
@@ -393,85 +817,91 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
             int32_t lj;
 
             // Manage a new line in MatrixM2B
-            while( GetParity( firstOneInRow, FragDecoder.S ) == 1 )
+            while( GetParity( firstOneInRow, s ) == 1 )
             { 
-                // Row already diagonalized exist & ( FragDecoder.MatrixM2B[firstOneInRow][0] )
-                FragExtractLineFromBinaryMatrix( dataTempVector2, firstOneInRow, FragDecoder.Status.FragNbLost );
-                XorParityLine( dataTempVector, dataTempVector2, FragDecoder.Status.FragNbLost );
+                // Row already diagonalized exist & ( MatrixM2B[firstOneInRow][0] )
+                FragExtractLineFromBinaryMatrix( obj, dataTempVector2, firstOneInRow, obj->Status.FragNbLost );
+                XorParityLine( dataTempVector, dataTempVector2, obj->Status.FragNbLost );
                 // Have to store it in the mi th position of the missing frag
-                li = FragFindMissingIndex( firstOneInRow );
+                li = FragFindMissingIndex( ctx, firstOneInRow );
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                GetRow( matrixDataTemp, li, FragDecoder.FragSize );
+                GetRow( obj, matrixDataTemp, li, ctx->FragSize );
 #else
-                GetRow( matrixDataTemp, FragDecoder.File, li, FragDecoder.FragSize );
+                GetRow( matrixDataTemp, obj->File, li, ctx->FragSize );
 #endif
-                XorDataLine( rawData, matrixDataTemp, FragDecoder.FragSize );
-                if( BitArrayIsAllZeros( dataTempVector, FragDecoder.Status.FragNbLost ) )
+                XorDataLine( rawData, matrixDataTemp, ctx->FragSize );
+                if( BitArrayIsAllZeros( dataTempVector, obj->Status.FragNbLost ) )
                 {
                     noInfo = 1;
                     break;
                 }
-                firstOneInRow = BitArrayFindFirstOne( dataTempVector, FragDecoder.Status.FragNbLost );
+                firstOneInRow = BitArrayFindFirstOne( dataTempVector, obj->Status.FragNbLost );
             }
 
             if( noInfo == 0 )
             {
-                FragPushLineToBinaryMatrix( dataTempVector, firstOneInRow, FragDecoder.Status.FragNbLost );
-                li = FragFindMissingIndex( firstOneInRow );
+                FragPushLineToBinaryMatrix( obj, dataTempVector, firstOneInRow, obj->Status.FragNbLost );
+                li = FragFindMissingIndex( ctx, firstOneInRow );
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                SetRow( rawData, li, FragDecoder.FragSize );
+                SetRow( obj, rawData, li, ctx->FragSize );
 #else
-                SetRow( FragDecoder.File, rawData, li, FragDecoder.FragSize );
+                SetRow( obj->File, rawData, li, ctx->FragSize );
 #endif
-                SetParity( firstOneInRow, FragDecoder.S, 1 );
-                FragDecoder.M2BLine++;
+                SetParity( firstOneInRow, s, 1 );
+                ctx->M2BLine++;
             }
 
-            if( FragDecoder.M2BLine == FragDecoder.Status.FragNbLost )
+            if( ctx->M2BLine == obj->Status.FragNbLost )
             { 
                 // Then last step diagonalized
-                if( FragDecoder.Status.FragNbLost > 1 )
+                if( obj->Status.FragNbLost > 1 )
                 {
                     int32_t i, j;
 
-                    for( i = ( FragDecoder.Status.FragNbLost - 2 ); i >= 0 ; i-- )
+                    for( i = ( obj->Status.FragNbLost - 2 ); i >= 0 ; i-- )
                     {
-                        li = FragFindMissingIndex( i );
+                        li = FragFindMissingIndex( ctx, i );
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                        GetRow( matrixDataTemp, li, FragDecoder.FragSize );
+                        GetRow( obj, matrixDataTemp, li, ctx->FragSize );
 #else
-                        GetRow( matrixDataTemp, FragDecoder.File, li, FragDecoder.FragSize );
+                        GetRow( matrixDataTemp, obj->File, li, ctx->FragSize );
 #endif
-                        for( j = ( FragDecoder.Status.FragNbLost - 1 ); j > i; j--)
+                        // The rows after i only have coefficients from their own index
+                        // onwards. XORing them doesn't change the row i coefficients
+                        // that are still to be tested, the row is thus read once.
+                        FragExtractLineFromBinaryMatrix( obj, dataTempVector2, i, obj->Status.FragNbLost );
+                        for( j = ( obj->Status.FragNbLost - 1 ); j > i; j--)
                         {
-                            FragExtractLineFromBinaryMatrix( dataTempVector2, i, FragDecoder.Status.FragNbLost );
-                            FragExtractLineFromBinaryMatrix( dataTempVector, j, FragDecoder.Status.FragNbLost );
                             if( GetParity( j, dataTempVector2 ) == 1 )
                             {
-                                XorParityLine( dataTempVector2, dataTempVector, FragDecoder.Status.FragNbLost );
-
-                                lj = FragFindMissingIndex( j );
+                                lj = FragFindMissingIndex( ctx, j );
 
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                                GetRow( rawData, lj, FragDecoder.FragSize );
+                                GetRow( obj, rawData, lj, ctx->FragSize );
 #else
-                                GetRow( rawData, FragDecoder.File, lj, FragDecoder.FragSize );
+                                GetRow( rawData, obj->File, lj, ctx->FragSize );
 #endif
-                                XorDataLine( matrixDataTemp , rawData , FragDecoder.FragSize );
+                                XorDataLine( matrixDataTemp , rawData , ctx->FragSize );
                             }
                         }
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                        SetRow( matrixDataTemp, li, FragDecoder.FragSize );
+                        SetRow( obj, matrixDataTemp, li, ctx->FragSize );
 #else
-                        SetRow( FragDecoder.File, matrixDataTemp, li, FragDecoder.FragSize );
+                        SetRow( obj->File, matrixDataTemp, li, ctx->FragSize );
 #endif
                     }
-                    return FragDecoder.Status.FragNbLost;
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+                    FragFileFlush( );
+#endif
+                    return obj->Status.FragNbLost;
                 }
                 else
                 { 
-                    //If not ( FragDecoder.FragNbLost > 1 )
-                    return FragDecoder.Status.FragNbLost;
+                    //If not ( obj->Status.FragNbLost > 1 )
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+                    FragFileFlush( );
+#endif
+                    return obj->Status.FragNbLost;
                 }
             }
         }
@@ -479,9 +909,25 @@ int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData )
     return FRAG_SESSION_ONGOING;
 }
 
-FragDecoderStatus_t FragDecoderGetStatus( void )
+int32_t FragDecoderProcess( FragDecoder_t *obj, uint16_t fragCounter, uint8_t *rawData )
+{
+    int32_t status;
+
+    if( obj->Ctx == NULL )
+    {
+        return FRAG_SESSION_NOT_STARTED;
+    }
+    status = FragDecode( obj, fragCounter, rawData );
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    FragSaveNvmCtx( obj );
+#endif
+    return status;
+}
+
+FragDecoderStatus_t FragDecoderGetStatus( FragDecoder_t *obj )
 { 
-    return FragDecoder.Status;
+    return obj->Status;
 }
 
 /*
@@ -491,20 +937,107 @@ FragDecoderStatus_t FragDecoderGetStatus( void )
  */
 
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-static void SetRow( uint8_t *src, uint16_t row, uint16_t size )
+static void SetRow( FragDecoder_t *obj, uint8_t *src, uint16_t row, uint16_t size )
 {
-    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderWrite != NULL ) )
+    FragFileWrite( obj, obj->Ctx->FileAddr + ( ( uint32_t )row * size ), src, size );
+}
+
+static void GetRow( FragDecoder_t *obj, uint8_t *dst, uint16_t row, uint16_t size )
+{
+    FragFileRead( obj, obj->Ctx->FileAddr + ( ( uint32_t )row * size ), dst, size );
+}
+
+static void FragFileWrite( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size )
+{
+#if( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
+    FragDecoderWriteCache_t *cache = &FragDecoderWriteCache;
+
+    if( cache->Owner != obj )
+    {
+        // Another decoder bytes are written to its own file first
+        FragFileFlush( );
+        cache->Owner = obj;
+    }
+    while( size > 0 )
+    {
+        uint32_t pageAddr = addr - ( addr % FRAG_DECODER_WRITE_CACHE_SIZE );
+        uint16_t start = addr - pageAddr;
+        uint16_t end = MIN( FRAG_DECODER_WRITE_CACHE_SIZE, start + size );
+
+        // Only a contiguous range of a single page is kept
+        if( ( cache->Start != cache->End ) &&
+            ( ( pageAddr != cache->PageAddr ) || ( start > cache->End ) || ( end < cache->Start ) ) )
+        {
+            FragFileFlush( );
+        }
+        if( cache->Start == cache->End )
+        {
+            cache->PageAddr = pageAddr;
+            cache->Start = start;
+            cache->End = end;
+        }
+        else
+        {
+            cache->Start = MIN( cache->Start, start );
+            cache->End = MAX( cache->End, end );
+        }
+        memcpy1( &cache->Data[start], data, end - start );
+
+        if( ( cache->End - cache->Start ) == FRAG_DECODER_WRITE_CACHE_SIZE )
+        {
+            FragFileFlush( );
+        }
+        data += end - start;
+        addr += end - start;
+        size -= end - start;
+    }
+#else
+    if( ( obj->Callbacks != NULL ) && ( obj->Callbacks->FragDecoderWrite != NULL ) )
     {
-        FragDecoder.Callbacks->FragDecoderWrite( row * size, src, size );
+        obj->Callbacks->FragDecoderWrite( addr, data, size );
     }
+#endif
 }
 
-static void GetRow( uint8_t *dst, uint16_t row, uint16_t size )
+static void FragFileRead( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size )
 {
-    if( ( FragDecoder.Callbacks != NULL ) && ( FragDecoder.Callbacks->FragDecoderRead != NULL ) )
+#if( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
+    FragDecoderWriteCache_t *cache = &FragDecoderWriteCache;
+    uint32_t first = MAX( addr, cache->PageAddr + cache->Start );
+    uint32_t last = MIN( addr + size, cache->PageAddr + cache->End );
+#endif
+
+    if( ( obj->Callbacks != NULL ) && ( obj->Callbacks->FragDecoderRead != NULL ) )
+    {
+        obj->Callbacks->FragDecoderRead( addr, data, size );
+    }
+#if( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
+    // The bytes still in the cache are newer than the file ones
+    if( ( cache->Owner == obj ) && ( cache->Start != cache->End ) && ( first < last ) )
     {
-        FragDecoder.Callbacks->FragDecoderRead( row * size, dst, size );
+        memcpy1( &data[first - addr], &cache->Data[first - cache->PageAddr], last - first );
     }
+#endif
+}
+
+static void FragFileFlush( void )
+{
+#if( FRAG_DECODER_WRITE_CACHE_SIZE > 0 )
+    FragDecoderWriteCache_t *cache = &FragDecoderWriteCache;
+    FragDecoder_t *owner = cache->Owner;
+
+    if( cache->Start == cache->End )
+    {
+        return;
+    }
+    if( ( owner != NULL ) && ( owner->Callbacks != NULL ) && ( owner->Callbacks->FragDecoderWrite != NULL ) )
+    {
+        owner->Callbacks->FragDecoderWrite( cache->PageAddr + cache->Start, &cache->Data[cache->Start],
+                                            cache->End - cache->Start );
+    }
+    cache->Start = 0;
+    cache->End = 0;
+#endif
 }
 #else
 static void SetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size )
@@ -518,7 +1051,7 @@ static void GetRow( uint8_t *dst, uint8_t *src, uint16_t row, uint16_t size )
 }
 #endif
 
-static uint8_t GetParity( uint8_t index, uint8_t *matrixRow  )
+static uint8_t GetParity( uint16_t index, uint8_t *matrixRow  )
 {
     uint8_t parity;
     parity = matrixRow[index >> 3];
@@ -526,7 +1059,7 @@ static uint8_t GetParity( uint8_t index, uint8_t *matrixRow  )
     return parity;
 }
 
-static void SetParity( uint8_t index, uint8_t *matrixRow, uint8_t parity )
+static void SetParity( uint16_t index, uint8_t *matrixRow, uint8_t parity )
 {
     uint8_t mask = 0xFF - ( 1 << ( 7 - ( index % 8 ) ) );
     parity = parity << ( 7 - ( index % 8 ) );
@@ -548,19 +1081,37 @@ static bool IsPowerOfTwo( uint32_t x )
     return false;
 }
 
-static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size )
+LORAMAC_HOT static void XorDataLine( uint8_t *line1, uint8_t *line2, int32_t size )
 {
-    for( int32_t i = 0; i < size; i++ )
+    int32_t i = 0;
+
+    // Word wide XOR is only possible when both lines share the same alignment
+    if( ( ( ( uintptr_t )line1 ^ ( uintptr_t )line2 ) & 0x03 ) == 0 )
+    {
+        for( ; ( i < size ) && ( ( ( uintptr_t )&line1[i] & 0x03 ) != 0 ); i++ )
+        {
+            line1[i] = line1[i] ^ line2[i];
+        }
+        for( ; ( i + 4 ) <= size; i += 4 )
+        {
+            *( uint32_t* )&line1[i] ^= *( uint32_t* )&line2[i];
+        }
+    }
+    for( ; i < size; i++ )
     {
         line1[i] = line1[i] ^ line2[i];
     }
 }
 
-static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size )
+LORAMAC_HOT static void XorParityLine( uint8_t* line1, uint8_t* line2, int32_t size )
 {
-    for( int32_t i = 0; i < size; i++ )
+    int32_t nbBytes = size >> 3;
+
+    XorDataLine( line1, line2, nbBytes );
+    if( ( size & 0x07 ) != 0 )
     {
-        SetParity( i, line1, ( GetParity( i, line1 ) ^ GetParity( i, line2 ) ) );
+        // Only XOR the remaining bits of the last byte
+        line1[nbBytes] ^= line2[nbBytes] & ( uint8_t )( 0xFF << ( 8 - ( size & 0x07 ) ) );
     }
 }
 
@@ -571,12 +1122,27 @@ static int32_t FragPrbs23( int32_t value )
     return ( value >> 1 ) + ( ( b0 ^ b1 ) << 22 );;
 }
 
+static uint32_t FragModulo( uint32_t x, uint32_t divisor, uint32_t reciprocal )
+{
+    // The reciprocal is rounded down, the quotient estimate is thus either
+    // exact or one below the quotient
+    uint32_t q = ( uint32_t )( ( ( uint64_t )x * reciprocal ) >> 32 );
+    uint32_t r = x - ( q * divisor );
+
+    if( r >= divisor )
+    {
+        r -= divisor;
+    }
+    return r;
+}
+
 static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow )
 {
     int32_t mTemp;
     int32_t x;
     int32_t nbCoeff = 0;
     int32_t r;
+    uint32_t reciprocal;
 
     if( IsPowerOfTwo( m ) != false )
     {
@@ -588,29 +1154,42 @@ static void FragGetParityMatrixRow( int32_t n, int32_t m, uint8_t *matrixRow )
     }
 
     x = 1 + ( 1001 * n );
-    for( uint8_t i = 0; i < ( ( m >> 3 ) + 1 ); i++ )
+    memset1( matrixRow, 0, ( m >> 3 ) + 1 );
+    if( ( m >> 1 ) == 0 )
     {
-        matrixRow[i] = 0;
+        return;
     }
+
+    // The divisor is the same for the whole row. A single division is done
+    // instead of one per coefficient, the MCU may lack a division instruction.
+    reciprocal = 0xFFFFFFFF / ( uint32_t )( m + mTemp );
     while( nbCoeff < ( m >> 1 ) )
     {
         r = 1 << 16;
         while( r >= m )
         {
             x = FragPrbs23( x );
-            r = x % ( m + mTemp );
+            r = ( int32_t )FragModulo( ( uint32_t )x, ( uint32_t )( m + mTemp ), reciprocal );
         }
-        SetParity( r, matrixRow, 1 );
+        matrixRow[r >> 3] |= 0x80 >> ( r & 0x07 );
         nbCoeff += 1;
     }
 }
 
 static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size )
 {
-    for( uint16_t i = 0; i < size; i++)
+    for( uint16_t i = 0; i < size; i += 8 )
     {
-        if ( GetParity( i, bitArray ) == 1 )
+        uint8_t bits = bitArray[i >> 3] & BitArrayRangeMask( i >> 3, 0, size );
+
+        if( bits != 0 )
         {
+            // Locate the most significant set bit of the byte
+            while( ( bits & 0x80 ) == 0 )
+            {
+                bits <<= 1;
+                i++;
+            }
             return i;
         }
     }
@@ -619,9 +1198,9 @@ static uint16_t BitArrayFindFirstOne( uint8_t *bitArray, uint16_t size )
 
 static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size )
 {
-    for( uint16_t i = 0; i < size; i++ )
+    for( uint16_t i = 0; i < size; i += 8 )
     {
-        if( GetParity( i, bitArray ) == 1 )
+        if( ( bitArray[i >> 3] & BitArrayRangeMask( i >> 3, 0, size ) ) != 0 )
         {
             return 0;
         }
@@ -629,51 +1208,164 @@ static uint8_t BitArrayIsAllZeros( uint8_t *bitArray, uint16_t  size )
     return 1;
 }
 
+static uint8_t BitArrayGetByte( uint8_t *bitArray, uint32_t size, int32_t index )
+{
+    int32_t byteIndex = ( index >= 0 ) ? ( index / 8 ) : ( ( index - 7 ) / 8 );
+    uint8_t shift = ( uint8_t )( index - ( byteIndex * 8 ) );
+    uint16_t bits = 0;
+
+    if( ( byteIndex >= 0 ) && ( ( uint32_t )byteIndex < size ) )
+    {
+        bits = ( uint16_t )bitArray[byteIndex] << 8;
+    }
+    if( ( byteIndex >= -1 ) && ( ( uint32_t )( byteIndex + 1 ) < size ) )
+    {
+        bits |= bitArray[byteIndex + 1];
+    }
+    return ( uint8_t )( bits >> ( 8 - shift ) );
+}
+
+static uint8_t BitArrayRangeMask( uint32_t byteIndex, uint32_t first, uint32_t last )
+{
+    uint32_t firstBit = byteIndex << 3;
+    uint32_t lo;
+    uint32_t hi;
+
+    if( ( last <= firstBit ) || ( first >= ( firstBit + 8 ) ) || ( first >= last ) )
+    {
+        return 0;
+    }
+    lo = ( first > firstBit ) ? ( first - firstBit ) : 0;
+    hi = ( last < ( firstBit + 8 ) ) ? ( last - firstBit ) : 8;
+    return ( uint8_t )( ( 0xFF >> lo ) & ( 0xFF << ( 8 - hi ) ) );
+}
+
+static uint8_t BitCount( uint8_t bits )
+{
+    uint8_t count = 0;
+
+    while( bits != 0 )
+    {
+        // Clear the least significant set bit
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+static uint8_t* FragGetRxBitArray( FragDecoderCtx_t *ctx )
+{
+    return ( uint8_t* )( ctx + 1 );
+}
+
+static uint8_t* FragGetS( FragDecoderCtx_t *ctx )
+{
+    return FragGetRxBitArray( ctx ) + ( ctx->FragNb >> 3 ) + 1;
+}
+
+static uint8_t FragCountLost( FragDecoderCtx_t *ctx, uint16_t byteIndex )
+{
+    uint8_t mask = BitArrayRangeMask( byteIndex, 0, ctx->FragNb );
+
+    return BitCount( ~FragGetRxBitArray( ctx )[byteIndex] & mask );
+}
+
+static void FragMatrixRead( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size )
+{
+#if( FRAG_DECODER_MATRIX_IN_STORAGE == 1 )
+    if( ( obj->Callbacks != NULL ) && ( obj->Callbacks->FragDecoderMatrixRead != NULL ) )
+    {
+        obj->Callbacks->FragDecoderMatrixRead( obj->Ctx->MatrixAddr + addr, data, size );
+    }
+#else
+    // The parity matrix follows the diagonalized rows bit array
+    memcpy1( data, FragGetS( obj->Ctx ) + ( obj->Ctx->Redundancy >> 3 ) + 1 + addr, size );
+#endif
+}
+
+static void FragMatrixWrite( FragDecoder_t *obj, uint32_t addr, uint8_t *data, uint32_t size )
+{
+#if( FRAG_DECODER_MATRIX_IN_STORAGE == 1 )
+    if( ( obj->Callbacks != NULL ) && ( obj->Callbacks->FragDecoderMatrixWrite != NULL ) )
+    {
+        obj->Callbacks->FragDecoderMatrixWrite( obj->Ctx->MatrixAddr + addr, data, size );
+    }
+#else
+    memcpy1( FragGetS( obj->Ctx ) + ( obj->Ctx->Redundancy >> 3 ) + 1 + addr, data, size );
+#endif
+}
+
 /*!
  * \brief Finds & marks missing fragments
  *
+ * \param [IN]  obj     Decoder object
  * \param [IN]  counter Current fragment counter
- * \param [OUT] FragDecoder.FragNbMissingIndex[] array is updated in place
+ * \param [OUT] obj->Status.FragNbLost is updated in place
  */
-static void FragFindMissingFrags( uint16_t counter )
+static void FragFindMissingFrags( FragDecoder_t *obj, uint16_t counter )
 {
+    FragDecoderCtx_t *ctx = obj->Ctx;
+    uint8_t *rxBitArray = FragGetRxBitArray( ctx );
     int32_t i;
-    for( i = FragDecoder.Status.FragNbLastRx; i < ( counter - 1 ); i++ )
+
+    for( i = obj->Status.FragNbLastRx; i < ( counter - 1 ); i++ )
     {
-        if( i < FragDecoder.FragNb )
+        if( ( i < ctx->FragNb ) && ( GetParity( i, rxBitArray ) == 0 ) )
         {
-            FragDecoder.Status.FragNbLost++;
-            FragDecoder.FragNbMissingIndex[i] = FragDecoder.Status.FragNbLost;
+            // The fragment bit is left cleared in the received fragments bit array
+            obj->Status.FragNbLost++;
         }
     }
-    if( i < FragDecoder.FragNb )
+    if( i < ctx->FragNb )
     {
-        FragDecoder.Status.FragNbLastRx = counter;
+        obj->Status.FragNbLastRx = counter;
     }
     else
     {
-        FragDecoder.Status.FragNbLastRx = FragDecoder.FragNb + 1;
+        obj->Status.FragNbLastRx = ctx->FragNb + 1;
     }
-    DBG( "RECEIVED    : %5d / %5d Fragments\r\n", FragDecoder.Status.FragNbRx, FragDecoder.FragNb );
-    DBG( "              %5d / %5d Bytes\r\n", FragDecoder.Status.FragNbRx * FragDecoder.FragSize, FragDecoder.FragNb * FragDecoder.FragSize );
-    DBG( "LOST        :       %7d Fragments\r\n\r\n", FragDecoder.Status.FragNbLost );
+    DBG( "RECEIVED    : %5d / %5d Fragments\r\n", obj->Status.FragNbRx, ctx->FragNb );
+    DBG( "              %5d / %5d Bytes\r\n", obj->Status.FragNbRx * ctx->FragSize, ctx->FragNb * ctx->FragSize );
+    DBG( "LOST        :       %7d Fragments\r\n\r\n", obj->Status.FragNbLost );
 }
 
 /*!
  * \brief Finds the index (frag counter) of the x th missing frag
  *
+ * \param [IN] ctx Session context
  * \param [IN] x   x th missing frag
  *
  * \retval counter The counter value associated to the x th missing frag
  */
-static uint16_t FragFindMissingIndex( uint16_t x )
+static uint16_t FragFindMissingIndex( FragDecoderCtx_t *ctx, uint16_t x )
 {
-    for( uint16_t i = 0; i < FragDecoder.FragNb; i++ )
+    uint8_t *rxBitArray = FragGetRxBitArray( ctx );
+    uint16_t nbLost = 0;
+
+    for( uint16_t i = 0; i < ctx->FragNb; i += 8 )
     {
-        if( FragDecoder.FragNbMissingIndex[i] == ( x + 1 ) )
+        uint8_t count = FragCountLost( ctx, i >> 3 );
+
+        if( ( nbLost + count ) > x )
         {
-            return i;
+            uint8_t lost = ~rxBitArray[i >> 3];
+
+            // Locate the lost fragment within the byte
+            while( true )
+            {
+                if( ( lost & 0x80 ) != 0 )
+                {
+                    if( nbLost == x )
+                    {
+                        return i;
+                    }
+                    nbLost++;
+                }
+                lost <<= 1;
+                i++;
+            }
         }
+        nbLost += count;
     }
     return 0;
 }
@@ -681,70 +1373,245 @@ static uint16_t FragFindMissingIndex( uint16_t x )
 /*!
  * \brief Extacts a row from the binary matrix and expands it to a bitArray
  *
+ * \param [IN] obj       Decoder object
  * \param [IN] bitArray  Pointer to the bit array
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragExtractLineFromBinaryMatrix( uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow )
+static void FragExtractLineFromBinaryMatrix( FragDecoder_t *obj, uint8_t* bitArray, uint16_t rowIndex, uint16_t bitsInRow )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
+    uint8_t rowBits[( FRAG_MAX_REDUNDANCY >> 3 ) + 2];
+    uint32_t start = 0;
+    uint32_t nbBytes = 0;
 
     if( rowIndex > 0 )
     {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
+        start = rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 );
     }
-    if( rowIndex > 0 )
+    if( rowIndex < bitsInRow )
     {
-        for( uint16_t i = 0; i < rowIndex; i++ )
-        {
-            SetParity( i, bitArray, 0 );
-        }
+        nbBytes = ( ( start + bitsInRow - rowIndex - 1 ) >> 3 ) - ( start >> 3 ) + 1;
+        FragMatrixRead( obj, start >> 3, rowBits, nbBytes );
     }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
+
+    // The row is stored from the matrix bit start onwards. The bit array bits
+    // before rowIndex are cleared and the ones after bitsInRow are kept.
+    for( uint32_t i = 0; i < ( ( bitsInRow + 7U ) >> 3 ); i++ )
     {
-        SetParity( i,
-                   bitArray, 
-                   ( FragDecoder.MatrixM2B[findByte] >> ( 7 - findBitInByte ) ) & 0x01 );
+        uint8_t rowMask = BitArrayRangeMask( i, rowIndex, bitsInRow );
+        uint8_t mask = rowMask | BitArrayRangeMask( i, 0, rowIndex );
+        uint8_t bits = BitArrayGetByte( rowBits, nbBytes, ( int32_t )( ( start & 0x07 ) - rowIndex + ( i << 3 ) ) );
 
-        findBitInByte++;
-        if( findBitInByte == 8 )
-        {
-            findBitInByte = 0;
-            findByte++;
-        }
+        bitArray[i] = ( bitArray[i] & ~mask ) | ( bits & rowMask );
     }
 }
 
 /*!
  * \brief Collapses and Pushs a row of a bit array to the matrix
  *
+ * \param [IN] obj       Decoder object
  * \param [IN] bitArray  Pointer to the bit array
  * \param [IN] rowIndex  Matrix row index
  * \param [IN] bitsInRow Number of bits in one row
  */
-static void FragPushLineToBinaryMatrix( uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow )
+static void FragPushLineToBinaryMatrix( FragDecoder_t *obj, uint8_t *bitArray, uint16_t rowIndex, uint16_t bitsInRow )
+{
+    uint8_t rowBits[( FRAG_MAX_REDUNDANCY >> 3 ) + 2];
+    uint32_t start = 0;
+    uint32_t end;
+    uint32_t nbBytes;
+
+    if( rowIndex >= bitsInRow )
+    {
+        return;
+    }
+    if( rowIndex > 0 )
+    {
+        start = rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 );
+    }
+    end = start + bitsInRow - rowIndex;
+    nbBytes = ( ( end - 1 ) >> 3 ) - ( start >> 3 ) + 1;
+
+    // The first and last bytes may be shared with the neighbouring rows. The
+    // spanned bytes are read, updated and written back.
+    FragMatrixRead( obj, start >> 3, rowBits, nbBytes );
+
+    // Clears the matrix bits of the row whose bit array counterpart is 0
+    for( uint32_t i = start >> 3; i <= ( ( end - 1 ) >> 3 ); i++ )
+    {
+        uint8_t mask = BitArrayRangeMask( i, start, end );
+        uint8_t bits = BitArrayGetByte( bitArray, ( FRAG_MAX_REDUNDANCY >> 3 ) + 1, ( int32_t )( ( i << 3 ) - start + rowIndex ) );
+
+        rowBits[i - ( start >> 3 )] &= ~( mask & ~bits );
+    }
+    FragMatrixWrite( obj, start >> 3, rowBits, nbBytes );
+}
+
+static void FragResetParityMatrix( FragDecoder_t *obj )
+{
+    FragDecoderCtx_t *ctx = obj->Ctx;
+    uint8_t matrixRow[( FRAG_MAX_REDUNDANCY >> 3 ) + 1];
+    uint8_t rowSize = ( ctx->Redundancy >> 3 ) + 1;
+
+    ctx->M2BLine = 0;
+    memset1( FragGetS( ctx ), 0, rowSize );
+
+    memset1( matrixRow, 0xFF, sizeof( matrixRow ) );
+    for( uint32_t i = 0; i < ctx->Redundancy; i++ )
+    {
+        FragMatrixWrite( obj, i * rowSize, matrixRow, rowSize );
+    }
+}
+
+static bool FragIsFileComplete( FragDecoderCtx_t *ctx )
+{
+    for( uint16_t i = 0; i < ctx->FragNb; i += 8 )
+    {
+        if( FragCountLost( ctx, i >> 3 ) != 0 )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void FragSpaceGetRange( FragDecoderCtx_t *ctx, FragSpace_t space, uint32_t *start, uint32_t *size )
+{
+    switch( space )
+    {
+        case FRAG_SPACE_POOL:
+        {
+            *start = ( uint32_t )( ( uint8_t* )ctx - ( uint8_t* )FragDecoderPool );
+            *size = ctx->CtxSize;
+            break;
+        }
+        case FRAG_SPACE_FILE:
+        {
+            *start = ctx->FileAddr;
+            *size = ( uint32_t )ctx->FragNb * ctx->FragSize;
+            break;
+        }
+        default:
+        {
+            *start = ctx->MatrixAddr;
+            *size = FRAG_DECODER_PARITY_MATRIX_SIZE( ctx->Redundancy );
+            break;
+        }
+    }
+}
+
+static bool FragSpaceIsFree( FragDecoderCtx_t *skip, FragSpace_t space, uint32_t spaceSize, uint32_t addr, uint32_t size )
 {
-    uint32_t findByte = 0;
-    uint32_t findBitInByte = 0;
+    uint32_t start;
+    uint32_t rangeSize;
+
+    if( ( size > spaceSize ) || ( addr > ( spaceSize - size ) ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < FRAG_DECODER_MAX_SESSIONS; i++ )
+    {
+        if( ( FragDecoderCtxs[i] == NULL ) || ( FragDecoderCtxs[i] == skip ) )
+        {
+            continue;
+        }
+        FragSpaceGetRange( FragDecoderCtxs[i], space, &start, &rangeSize );
+        if( ( addr < ( start + rangeSize ) ) && ( start < ( addr + size ) ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-    if ( rowIndex > 0) {
-        findByte      = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) >> 3;
-        findBitInByte = ( rowIndex * bitsInRow - ( ( rowIndex * ( rowIndex - 1 ) ) >> 1 ) ) % 8;
+static bool FragSpaceFind( FragDecoderCtx_t *skip, FragSpace_t space, uint32_t spaceSize, uint32_t size, uint32_t *addr )
+{
+    uint32_t start;
+    uint32_t rangeSize;
+    bool found = false;
 
+    // The lowest free range starts either at the space start or at the end
+    // of a used range
+    if( FragSpaceIsFree( skip, space, spaceSize, 0, size ) == true )
+    {
+        *addr = 0;
+        return true;
     }
-    for( uint16_t i = rowIndex; i < bitsInRow; i++ )
+    for( uint8_t i = 0; i < FRAG_DECODER_MAX_SESSIONS; i++ )
     {
-        if( GetParity( i, bitArray ) == 0 )
+        if( ( FragDecoderCtxs[i] == NULL ) || ( FragDecoderCtxs[i] == skip ) )
         {
-            FragDecoder.MatrixM2B[findByte] = FragDecoder.MatrixM2B[findByte] & ( 0xFF - ( 1 << ( 7 - findBitInByte ) ) );
+            continue;
         }
-        findBitInByte++;
-        if( findBitInByte == 8 )
+        FragSpaceGetRange( FragDecoderCtxs[i], space, &start, &rangeSize );
+        if( ( ( found == false ) || ( ( start + rangeSize ) < *addr ) ) &&
+            ( FragSpaceIsFree( skip, space, spaceSize, start + rangeSize, size ) == true ) )
         {
-            findBitInByte = 0;
-            findByte++;
+            *addr = start + rangeSize;
+            found = true;
         }
     }
+    return found;
 }
+
+static bool FragFindRanges( FragDecoderCtx_t *skip, uint16_t fragNb, uint8_t fragSize, FragDecoderCtx_t *layout, uint32_t *poolAddr )
+{
+    bool isEntryFree = false;
+
+    if( ( fragNb == 0 ) || ( fragNb > FRAG_MAX_NB ) || ( fragSize == 0 ) || ( fragSize > FRAG_MAX_SIZE ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < FRAG_DECODER_MAX_SESSIONS; i++ )
+    {
+        if( ( FragDecoderCtxs[i] == NULL ) || ( FragDecoderCtxs[i] == skip ) )
+        {
+            isEntryFree = true;
+        }
+    }
+    if( ( isEntryFree == false ) ||
+        ( FragSpaceFind( skip, FRAG_SPACE_POOL, FRAG_DECODER_POOL_SIZE, FRAG_DECODER_WORKSPACE_SIZE( fragNb ), poolAddr ) == false ) )
+    {
+        return false;
+    }
+    layout->FileAddr = 0;
+    layout->MatrixAddr = 0;
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    if( FragSpaceFind( skip, FRAG_SPACE_FILE, FragDecoderGetMaxFileSize( ), ( uint32_t )fragNb * fragSize, &layout->FileAddr ) == false )
+    {
+        return false;
+    }
+#endif
+#if( FRAG_DECODER_MATRIX_IN_STORAGE == 1 )
+    if( FragSpaceFind( skip, FRAG_SPACE_MATRIX, FRAG_DECODER_MATRIX_STORAGE_SIZE,
+                       FRAG_DECODER_PARITY_MATRIX_SIZE( FRAG_DECODER_REDUNDANCY( fragNb ) ), &layout->MatrixAddr ) == false )
+    {
+        return false;
+    }
+#endif
+    return true;
+}
+
+static void FragAttachCtx( FragDecoder_t *obj, uint32_t poolAddr )
+{
+    obj->Ctx = ( FragDecoderCtx_t* )( ( uint8_t* )FragDecoderPool + poolAddr );
+    for( uint8_t i = 0; i < FRAG_DECODER_MAX_SESSIONS; i++ )
+    {
+        if( FragDecoderCtxs[i] == NULL )
+        {
+            FragDecoderCtxs[i] = obj->Ctx;
+            break;
+        }
+    }
+}
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+static void FragSaveNvmCtx( FragDecoder_t *obj )
+{
+    // The workspace is the NVM context, it is kept up to date
+    if( ( obj->Callbacks != NULL ) && ( obj->Callbacks->FragDecoderNvmCtxChanged != NULL ) )
+    {
+        obj->Callbacks->FragDecoderNvmCtxChanged( );
+    }
+}
+#endif
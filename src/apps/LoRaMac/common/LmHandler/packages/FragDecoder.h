@@ -24,6 +24,7 @@
 #define __FRAG_DECODER_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /*!
  * If set to 1 the new API defining \ref FragDecoderWrite and
@@ -36,21 +37,113 @@
  *
  * \remark This parameter has an impact on the memory footprint.
  */
+#ifndef FRAG_MAX_NB
 #define FRAG_MAX_NB                                 21
+#endif
 
 /*!
  * Maximum fragment size that can be handled.
  *
  * \remark This parameter has an impact on the memory footprint.
  */
+#ifndef FRAG_MAX_SIZE
 #define FRAG_MAX_SIZE                               50
+#endif
 
 /*!
  * Maximum number of extra frames that can be handled.
  *
  * \remark This parameter has an impact on the memory footprint.
  */
+#ifndef FRAG_MAX_REDUNDANCY
 #define FRAG_MAX_REDUNDANCY                         5
+#endif
+
+/*!
+ * If set to 1 the parity matrix is kept in a storage area provided by the
+ * application through the \ref FragDecoderMatrixWrite and
+ * \ref FragDecoderMatrixRead callbacks instead of RAM.
+ *
+ * \remark The parity matrix grows quadratically with FRAG_MAX_REDUNDANCY.
+ *         Keeping it in storage bounds the decoder RAM usage to a few parity
+ *         rows and one bit per fragment.
+ *
+ * \remark Requires FRAG_DECODER_FILE_HANDLING_NEW_API to be set to 1.
+ */
+#ifndef FRAG_DECODER_MATRIX_IN_STORAGE
+#define FRAG_DECODER_MATRIX_IN_STORAGE              0
+#endif
+
+/*!
+ * Size of the file write cache [bytes]. Set to 0 to disable the cache.
+ *
+ * \remark The file is written through a cache holding one page of this size.
+ *         Contiguous rows are coalesced and a page is handed to the
+ *         \ref FragDecoderWrite callback once it is complete or when a row
+ *         outside of it is written. Set it to the storage page size in order
+ *         to get one write per page.
+ *
+ * \remark Requires FRAG_DECODER_FILE_HANDLING_NEW_API to be set to 1.
+ */
+#ifndef FRAG_DECODER_WRITE_CACHE_SIZE
+#define FRAG_DECODER_WRITE_CACHE_SIZE               0
+#endif
+
+/*!
+ * Maximum number of sessions decoded concurrently
+ */
+#ifndef FRAG_DECODER_MAX_SESSIONS
+#define FRAG_DECODER_MAX_SESSIONS                   4
+#endif
+
+/*!
+ * Number of parity rows of a session, the lost fragments that can be recovered
+ */
+#define FRAG_DECODER_REDUNDANCY( fragNb )           ( ( ( fragNb ) < FRAG_MAX_REDUNDANCY ) ? ( fragNb ) : FRAG_MAX_REDUNDANCY )
+
+/*!
+ * Size of the parity matrix of a session [bytes]
+ */
+#define FRAG_DECODER_PARITY_MATRIX_SIZE( redundancy ) ( ( ( ( redundancy ) >> 3 ) + 1 ) * ( redundancy ) )
+
+/*!
+ * Size of the parity matrix [bytes]
+ */
+#define FRAG_DECODER_MATRIX_SIZE                    FRAG_DECODER_PARITY_MATRIX_SIZE( FRAG_MAX_REDUNDANCY )
+
+/*!
+ * Size of the workspace of a session [bytes]: its context, received fragments
+ * bit array and parity matrix, unless the matrix is kept in storage.
+ */
+#define FRAG_DECODER_WORKSPACE_SIZE( fragNb )                                                   \
+    ( ( sizeof( FragDecoderCtx_t ) + ( ( ( fragNb ) >> 3 ) + 1 ) +                              \
+        ( ( FRAG_DECODER_REDUNDANCY( fragNb ) >> 3 ) + 1 ) +                                    \
+        ( ( FRAG_DECODER_MATRIX_IN_STORAGE == 0 ) ? FRAG_DECODER_PARITY_MATRIX_SIZE( FRAG_DECODER_REDUNDANCY( fragNb ) ) : 0 ) + \
+        3 ) & ~3UL )
+
+/*!
+ * Size of the workspace pool shared by the sessions [bytes]
+ *
+ * \remark The pool is sized by the total number of fragments of the
+ *         concurrent sessions. By default it holds a single session of
+ *         FRAG_MAX_NB fragments, or several smaller ones. Set it to the sum
+ *         of the FRAG_DECODER_WORKSPACE_SIZE of the sessions to be decoded
+ *         concurrently.
+ */
+#ifndef FRAG_DECODER_POOL_SIZE
+#define FRAG_DECODER_POOL_SIZE                      FRAG_DECODER_WORKSPACE_SIZE( FRAG_MAX_NB )
+#endif
+
+/*!
+ * Size of the parity matrix storage area shared by the sessions [bytes]
+ */
+#ifndef FRAG_DECODER_MATRIX_STORAGE_SIZE
+#define FRAG_DECODER_MATRIX_STORAGE_SIZE            FRAG_DECODER_MATRIX_SIZE
+#endif
+
+#if( FRAG_DECODER_MATRIX_IN_STORAGE == 1 ) && ( FRAG_DECODER_FILE_HANDLING_NEW_API != 1 )
+#error "FRAG_DECODER_MATRIX_IN_STORAGE requires FRAG_DECODER_FILE_HANDLING_NEW_API"
+#endif
 
 #define FRAG_SESSION_FINISHED                       ( int32_t )0
 #define FRAG_SESSION_NOT_STARTED                    ( int32_t )-2
@@ -64,6 +157,47 @@ typedef struct sFragDecoderStatus
     uint8_t MatrixError;
 }FragDecoderStatus_t;
 
+/*!
+ * Session context. It is followed in the workspace pool by the received
+ * fragments bit array, the diagonalized rows bit array and the parity matrix.
+ * The whole workspace is the decoder state stored in NVM.
+ */
+typedef struct sFragDecoderCtx
+{
+    /*!
+     * File descriptor of the session
+     */
+    uint32_t Descriptor;
+    /*!
+     * Address of the file in the storage
+     */
+    uint32_t FileAddr;
+    /*!
+     * Address of the parity matrix in its storage area
+     */
+    uint32_t MatrixAddr;
+    /*!
+     * Size of the workspace [bytes]
+     */
+    uint16_t CtxSize;
+    /*!
+     * Number of fragments of the file, without redundancy
+     */
+    uint16_t FragNb;
+    /*!
+     * Size of a fragment
+     */
+    uint8_t FragSize;
+    /*!
+     * Number of parity rows
+     */
+    uint8_t Redundancy;
+    /*!
+     * Number of diagonalized parity rows
+     */
+    uint16_t M2BLine;
+}FragDecoderCtx_t;
+
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 typedef struct sFragDecoderCallbacks
 {
@@ -87,57 +221,214 @@ typedef struct sFragDecoderCallbacks
      * \retval status Read operation status [0: Success, -1 Fail]
      */
     uint8_t ( *FragDecoderRead )( uint32_t addr, uint8_t *data, uint32_t size );
+#if( FRAG_DECODER_MATRIX_IN_STORAGE == 1 )
+    /*!
+     * Writes `data` buffer of `size` starting at address `addr` of the parity
+     * matrix storage area
+     *
+     * \remark The storage area is FRAG_DECODER_MATRIX_STORAGE_SIZE bytes
+     *         long, each session uses a range of it. A range is set to 0xFF
+     *         by \ref FragDecoderInit, or by a session resumed by
+     *         \ref FragDecoderResume dropping its parity rows, and afterwards
+     *         bits are only cleared. A flash memory area only has to be
+     *         erased beforehand.
+     *
+     * \param [IN] addr Address start index to write to.
+     * \param [IN] data Data buffer to be written.
+     * \param [IN] size Size of data buffer to be written.
+     *
+     * \retval status Write operation status [0: Success, -1 Fail]
+     */
+    uint8_t ( *FragDecoderMatrixWrite )( uint32_t addr, uint8_t *data, uint32_t size );
+    /*!
+     * Reads `data` buffer of `size` starting at address `addr` of the parity
+     * matrix storage area
+     *
+     * \param [IN] addr Address start index to read from.
+     * \param [IN] data Data buffer to be read.
+     * \param [IN] size Size of data buffer to be read.
+     *
+     * \retval status Read operation status [0: Success, -1 Fail]
+     */
+    uint8_t ( *FragDecoderMatrixRead )( uint32_t addr, uint8_t *data, uint32_t size );
+#endif
+    /*!
+     * Notifies that the decoder state changed. The context returned by
+     * \ref FragDecoderGetNvmCtx has to be stored in order to resume the file
+     * decoding after a reset. Optional.
+     */
+    void ( *FragDecoderNvmCtxChanged )( void );
 }FragDecoderCallbacks_t;
 #endif
 
+/*!
+ * Fragmentation decoder object, one per concurrent session
+ */
+typedef struct sFragDecoder
+{
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+    /*!
+     * Write/Read functions
+     */
+    FragDecoderCallbacks_t *Callbacks;
+#else
+    /*!
+     * File buffer
+     */
+    uint8_t *File;
+    /*!
+     * File buffer size
+     */
+    uint32_t FileSize;
+#endif
+    /*!
+     * Session workspace, NULL when the decoder holds none
+     */
+    FragDecoderCtx_t *Ctx;
+    /*!
+     * Session status
+     */
+    FragDecoderStatus_t Status;
+}FragDecoder_t;
+
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 /*!
  * \brief Initializes the fragmentation decoder
  *
+ * \remark The session workspace is drawn from the pool shared by the
+ *         decoders and its file is stored in a free range of the storage.
+ *
+ * \param [IN] obj        Decoder object
  * \param [IN] fragNb     Number of expected fragments (without redundancy packets)
  * \param [IN] fragSize   Size of a fragment
  * \param [IN] callbacks  Pointer to the Write/Read functions.
+ *
+ * \retval started        False if the pool or the storage can't hold the session
  */
-void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t *callbacks );
+bool FragDecoderInit( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize, FragDecoderCallbacks_t *callbacks );
 #else
 /*!
  * \brief Initializes the fragmentation decoder
  *
+ * \param [IN] obj        Decoder object
  * \param [IN] fragNb     Number of expected fragments (without redundancy packets)
  * \param [IN] fragSize   Size of a fragment
  * \param [IN] file       Pointer to file buffer size
  * \param [IN] fileSize   File buffer size
+ *
+ * \retval started        False if the pool can't hold the session
  */
-void FragDecoderInit( uint16_t fragNb, uint8_t fragSize, uint8_t *file, uint32_t fileSize );
+bool FragDecoderInit( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize, uint8_t *file, uint32_t fileSize );
 #endif
 
+/*!
+ * \brief Releases the session workspace and storage ranges of the decoder
+ *
+ * \param [IN] obj Decoder object
+ */
+void FragDecoderDeInit( FragDecoder_t *obj );
+
+/*!
+ * \brief Checks if the decoder can start a session, the workspace and storage
+ *        ranges it holds being released beforehand
+ *
+ * \param [IN] obj      Decoder object
+ * \param [IN] fragNb   Number of expected fragments (without redundancy packets)
+ * \param [IN] fragSize Size of a fragment
+ *
+ * \retval supported    True if the pool and the storage can hold the session
+ */
+bool FragDecoderIsSessionSupported( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize );
+
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 /*!
- * \brief Gets the maximum file size that can be received
+ * \brief Initializes the fragmentation decoder for a session, resuming the
+ *        decoding of the same file if the decoder state matches it.
+ *        Otherwise the decoder is initialized as by \ref FragDecoderInit.
+ *
+ * \remark The decoder state is the one of the previous session of the
+ *         decoder or the one restored by \ref FragDecoderRestoreNvmCtx. It
+ *         is kept until \ref FragDecoderDeInit. The fragments counters
+ *         restart with the session. The received uncoded fragments are
+ *         kept and the reduced parity rows are kept until a fragment they
+ *         miss is received, in which case the parity matrix storage is set
+ *         to 0xFF again.
+ *
+ * \param [IN] fragNb     Number of expected fragments (without redundancy packets)
+ * \param [IN] fragSize   Size of a fragment
+ * \param [IN] descriptor File descriptor of the session
+ * \param [IN] callbacks  Pointer to the Write/Read functions.
+ *
+ * \retval resumed        True if the file decoding is resumed
+ */
+bool FragDecoderResume( FragDecoder_t *obj, uint16_t fragNb, uint8_t fragSize, uint32_t descriptor, FragDecoderCallbacks_t *callbacks );
+
+/*!
+ * \brief Gets the decoder state to be stored in NVM
+ *
+ * \param [IN]  obj        Decoder object
+ * \param [OUT] nvmCtxSize Size of the decoder state, 0 without session
+ *
+ * \retval nvmCtx          Decoder state
+ */
+void* FragDecoderGetNvmCtx( FragDecoder_t *obj, uint32_t *nvmCtxSize );
+
+/*!
+ * \brief Restores the decoder state stored in NVM. To be called before
+ *        \ref FragDecoderResume.
+ *
+ * \param [IN] obj    Decoder object
+ * \param [IN] nvmCtx Decoder state
+ *
+ * \retval valid      True if the state is restored, false if it isn't a
+ *                    valid decoder state or if its storage ranges are
+ *                    already used by another decoder
+ */
+bool FragDecoderRestoreNvmCtx( FragDecoder_t *obj, const void *nvmCtx );
+
+/*!
+ * \brief Gets the maximum file size that can be received, the storage being
+ *        shared by the concurrent sessions
  * 
  * \retval size FileSize
  */
 uint32_t FragDecoderGetMaxFileSize( void );
+
+/*!
+ * \brief Gets the address of the session file in the storage
+ *
+ * \param [IN] obj Decoder object
+ *
+ * \retval addr    File address
+ */
+uint32_t FragDecoderGetFileAddr( FragDecoder_t *obj );
 #endif
 
 /*!
  * \brief Function to decode and reconstruct the binary file
  *        Called for each receive frame
+ *
+ * \remark The decoding is finished as soon as all the uncoded fragments are
+ *         received, without waiting for the redundancy fragments.
  * 
+ * \param [IN] obj         Decoder object
  * \param [IN] fragCounter Fragment counter [1..(FragDecoder.FragNb + FragDecoder.Redundancy)]
  * \param [IN] rawData     Pointer to the fragment to be processed (length = FragDecoder.FragSize)
  *
  * \retval status          Process status. [FRAG_SESSION_ONGOING,
- *                                          FRAG_SESSION_FINISHED or
+ *                                          FRAG_SESSION_FINISHED,
+ *                                          FRAG_SESSION_NOT_STARTED or
  *                                          FragDecoder.Status.FragNbLost]
  */
-int32_t FragDecoderProcess( uint16_t fragCounter, uint8_t *rawData );
+int32_t FragDecoderProcess( FragDecoder_t *obj, uint16_t fragCounter, uint8_t *rawData );
 
 /*!
  * \brief Gets the current fragmentation status
  * 
- * \retval status Fragmentation decoder status
+ * \param [IN] obj Decoder object
+ *
+ * \retval status  Fragmentation decoder status
  */
-FragDecoderStatus_t FragDecoderGetStatus( void );
+FragDecoderStatus_t FragDecoderGetStatus( FragDecoder_t *obj );
 
 #endif // __FRAG_DECODER_H__
@@ -28,7 +28,7 @@
 /*!
  * Maximum number of packages
  */
-#define PKG_MAX_NUMBER                              4
+#define PKG_MAX_NUMBER                              5
 
 typedef struct LmhPackage_s
 {
@@ -65,6 +65,15 @@ typedef struct LmhPackage_s
      * Processes the internal package events.
      */
     void ( *Process )( void );
+    /*!
+     * Returns the package internal events status.
+     *
+     * \remark NULL when the package has no internal events.
+     *
+     * \retval status Package internal events status
+     *                [true: Pending, false: Not pending]
+     */
+    bool ( *IsProcessPending )( void );
     /*!
      * Processes the MCSP Confirm
      *
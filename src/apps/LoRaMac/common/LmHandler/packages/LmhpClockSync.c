@@ -20,6 +20,7 @@
  * \author    Miguel Luis ( Semtech )
  */
 #include "systime.h"
+#include "timer.h"
 #include "LmHandler.h"
 #include "LmhpClockSync.h"
 
@@ -31,6 +32,11 @@
 #define CLOCK_SYNC_ID                               1
 #define CLOCK_SYNC_VERSION                          1
 
+/*!
+ * Lateness tolerated by the periodic synchronization requests [ms]
+ */
+#define CLOCK_SYNC_REQ_SLACK                        1000
+
 /*!
  * Package current context
  */
@@ -54,6 +60,31 @@ typedef struct LmhpClockSyncState_s
     bool AdrEnabledPrev;
     uint8_t NbTransPrev;
     uint8_t DataratePrev;
+    /*!
+     * Drift estimation reference is set
+     */
+    bool IsDriftRefSet;
+    /*!
+     * MCU time of the drift estimation reference [s]
+     */
+    uint32_t DriftRefTime;
+    /*!
+     * MCU time of the last accepted correction [s]
+     */
+    uint32_t LastSyncTime;
+    /*!
+     * Error of the uncompensated RTC accumulated since the drift estimation
+     * reference [ms]
+     */
+    int64_t CumulatedError;
+    /*!
+     * Period between two AppTimeReq sent by the package [s]
+     */
+    uint32_t ReqPeriod;
+    /*!
+     * An AppTimeReq has to be sent
+     */
+    bool IsReqTimerExpired;
 }LmhpClockSyncState_t;
 
 typedef enum LmhpClockSyncMoteCmd_e
@@ -123,9 +154,43 @@ static LmhpClockSyncState_t LmhpClockSyncState =
     .TimeReqParam.Value = 0,
     .AppTimeReqPending = false,
     .AdrEnabledPrev = false,
-    .NbTransPrev = 0
+    .NbTransPrev = 0,
+    .IsDriftRefSet = false,
+    .ReqPeriod = LMHP_CLOCK_SYNC_MIN_PERIOD,
+    .IsReqTimerExpired = false,
 };
 
+/*!
+ * Timer used to send the periodic AppTimeReq
+ */
+static TimerEvent_t ReqTimer;
+
+/*!
+ * \brief Function executed on ReqTimer event
+ */
+static void OnReqTimerEvent( void *context );
+
+/*!
+ * \brief Starts ReqTimer
+ *
+ * \param [IN] delay Delay before the next AppTimeReq [s]
+ */
+static void StartReqTimer( uint32_t delay );
+
+/*!
+ * \brief Updates the RTC drift estimation and schedules the next AppTimeReq
+ *
+ * \param [IN] timeCorrection Accepted AppTimeAns time correction [s]
+ */
+static void UpdateDrift( int32_t timeCorrection );
+
+/*!
+ * Returns if the package has a pending AppTimeReq to send.
+ *
+ * \retval status [true: pending, false: none]
+ */
+static bool LmhpClockSyncIsProcessPending( void );
+
 static LmhPackage_t LmhpClockSyncPackage =
 {
     .Port = CLOCK_SYNC_PORT,
@@ -133,6 +198,7 @@ static LmhPackage_t LmhpClockSyncPackage =
     .IsInitialized = LmhpClockSyncIsInitialized,
     .IsRunning = LmhpClockSyncIsRunning,
     .Process = LmhpClockSyncProcess,
+    .IsProcessPending = LmhpClockSyncIsProcessPending,
     .OnMcpsConfirmProcess = LmhpClockSyncOnMcpsConfirm,
     .OnMcpsIndicationProcess = LmhpClockSyncOnMcpsIndication,
     .OnMlmeConfirmProcess = NULL,                              // Not used in this package
@@ -158,6 +224,12 @@ static void LmhpClockSyncInit( void * params, uint8_t *dataBuffer, uint8_t dataB
         LmhpClockSyncState.DataBufferMaxSize = dataBufferMaxSize;
         LmhpClockSyncState.Initialized = true;
         LmhpClockSyncState.IsRunning = true;
+        LmhpClockSyncState.IsDriftRefSet = false;
+        LmhpClockSyncState.ReqPeriod = LMHP_CLOCK_SYNC_MIN_PERIOD;
+        LmhpClockSyncState.IsReqTimerExpired = false;
+        TimerInit( &ReqTimer, OnReqTimerEvent );
+        TimerSetDeferred( &ReqTimer, true );
+        TimerSetSlack( &ReqTimer, CLOCK_SYNC_REQ_SLACK );
     }
     else
     {
@@ -181,9 +253,26 @@ static bool LmhpClockSyncIsRunning( void )
     return LmhpClockSyncState.IsRunning;
 }
 
+static bool LmhpClockSyncIsProcessPending( void )
+{
+    return LmhpClockSyncState.IsReqTimerExpired;
+}
+
 static void LmhpClockSyncProcess( void )
 {
-    // Nothing to process
+    if( LmhpClockSyncState.IsReqTimerExpired == true )
+    {
+        LmhpClockSyncState.IsReqTimerExpired = false;
+        if( SysTimeGetSyncAge( ) <= LMHP_CLOCK_SYNC_EXTERNAL_MAX_AGE )
+        {
+            // The system time is synchronized by another source, e.g. a GPS
+            StartReqTimer( LmhpClockSyncState.ReqPeriod );
+        }
+        else if( LmhpClockSyncAppTimeReq( ) != LORAMAC_HANDLER_SUCCESS )
+        {
+            StartReqTimer( LMHP_CLOCK_SYNC_RETRY_DELAY );
+        }
+    }
 }
 
 static void LmhpClockSyncOnMcpsConfirm( McpsConfirm_t *mcpsConfirm )
@@ -233,6 +322,10 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
                 // If yes then don't process and ignore this answer.
                 if( mcpsIndication->DeviceTimeAnsReceived == true )
                 {
+                    // The time has been stepped by an unknown amount.
+                    // Restart the drift estimation.
+                    LmhpClockSyncState.IsDriftRefSet = false;
+                    cmdIndex += 5;
                     break;
                 }
                 int32_t timeCorrection = 0;
@@ -246,6 +339,7 @@ static void LmhpClockSyncOnMcpsIndication( McpsIndication_t *mcpsIndication )
                     curTime = SysTimeGet( );
                     curTime.Seconds += timeCorrection;
                     SysTimeSet( curTime );
+                    UpdateDrift( timeCorrection );
                     LmhpClockSyncState.TimeReqParam.Fields.TokenReq = ( LmhpClockSyncState.TimeReqParam.Fields.TokenReq + 1 ) & 0x0F;
                     if( LmhpClockSyncPackage.OnSysTimeUpdate != NULL )
                     {
@@ -356,3 +450,81 @@ LmHandlerErrorStatus_t LmhpClockSyncAppTimeReq( void )
     LmhpClockSyncState.AppTimeReqPending = true;
     return LmhpClockSyncPackage.OnSendRequest( &appData, LORAMAC_HANDLER_UNCONFIRMED_MSG );
 }
+
+static void OnReqTimerEvent( void *context )
+{
+    LmhpClockSyncState.IsReqTimerExpired = true;
+}
+
+static void StartReqTimer( uint32_t delay )
+{
+    TimerStop( &ReqTimer );
+    TimerSetValue( &ReqTimer, delay * 1000 );
+    TimerStart( &ReqTimer );
+}
+
+static void UpdateDrift( int32_t timeCorrection )
+{
+    uint32_t now = SysTimeGetMcuTime( ).Seconds;
+
+    if( LmhpClockSyncState.IsDriftRefSet == true )
+    {
+        uint32_t sinceLastSync = now - LmhpClockSyncState.LastSyncTime;
+        uint32_t elapsed = now - LmhpClockSyncState.DriftRefTime;
+        int64_t absCorrection = ( timeCorrection < 0 ) ? -( int64_t )timeCorrection : timeCorrection;
+
+        // A correction larger than the maximum drift plus the 1 s resolution
+        // is a time step. It restarts the estimation.
+        if( ( elapsed > 0 ) &&
+            ( ( absCorrection * 1000000 ) <= ( ( int64_t )LMHP_CLOCK_SYNC_MAX_DRIFT * sinceLastSync + 1000000 ) ) )
+        {
+            int64_t drift;
+
+            // Error of the uncompensated RTC: the correction of the compensated
+            // time plus the compensation applied since the last correction
+            LmhpClockSyncState.CumulatedError += ( int64_t )timeCorrection * 1000 +
+                                                 ( ( int64_t )SysTimeGetDrift( ) * sinceLastSync ) / 1000;
+            LmhpClockSyncState.LastSyncTime = now;
+
+            drift = ( LmhpClockSyncState.CumulatedError * 1000 ) / elapsed;
+            if( drift > LMHP_CLOCK_SYNC_MAX_DRIFT )
+            {
+                drift = LMHP_CLOCK_SYNC_MAX_DRIFT;
+            }
+            else if( drift < -LMHP_CLOCK_SYNC_MAX_DRIFT )
+            {
+                drift = -LMHP_CLOCK_SYNC_MAX_DRIFT;
+            }
+            SysTimeSetDrift( ( int32_t )drift );
+
+            // Space the requests while the compensated time stays accurate
+            if( ( absCorrection * 1000 ) < LMHP_CLOCK_SYNC_MAX_ERROR )
+            {
+                LmhpClockSyncState.ReqPeriod *= 2;
+            }
+            else
+            {
+                LmhpClockSyncState.ReqPeriod /= 2;
+            }
+            if( LmhpClockSyncState.ReqPeriod > LMHP_CLOCK_SYNC_MAX_PERIOD )
+            {
+                LmhpClockSyncState.ReqPeriod = LMHP_CLOCK_SYNC_MAX_PERIOD;
+            }
+            else if( LmhpClockSyncState.ReqPeriod < LMHP_CLOCK_SYNC_MIN_PERIOD )
+            {
+                LmhpClockSyncState.ReqPeriod = LMHP_CLOCK_SYNC_MIN_PERIOD;
+            }
+            StartReqTimer( LmhpClockSyncState.ReqPeriod );
+            return;
+        }
+    }
+
+    // (Re)start the estimation from this correction. The current drift
+    // compensation is kept.
+    LmhpClockSyncState.IsDriftRefSet = true;
+    LmhpClockSyncState.DriftRefTime = now;
+    LmhpClockSyncState.LastSyncTime = now;
+    LmhpClockSyncState.CumulatedError = 0;
+    LmhpClockSyncState.ReqPeriod = LMHP_CLOCK_SYNC_MIN_PERIOD;
+    StartReqTimer( LmhpClockSyncState.ReqPeriod );
+}
@@ -33,6 +33,53 @@
  */
 #define PACKAGE_ID_CLOCK_SYNC                       1
 
+/*!
+ * Maximum system time error tolerated between two AppTimeReq [ms]. Used to
+ * adapt the requests period to the measured RTC drift.
+ */
+#ifndef LMHP_CLOCK_SYNC_MAX_ERROR
+#define LMHP_CLOCK_SYNC_MAX_ERROR                   1000
+#endif
+
+/*!
+ * Minimum period between two AppTimeReq [s]
+ */
+#ifndef LMHP_CLOCK_SYNC_MIN_PERIOD
+#define LMHP_CLOCK_SYNC_MIN_PERIOD                  600
+#endif
+
+/*!
+ * Maximum period between two AppTimeReq [s]
+ */
+#ifndef LMHP_CLOCK_SYNC_MAX_PERIOD
+#define LMHP_CLOCK_SYNC_MAX_PERIOD                  86400
+#endif
+
+/*!
+ * Delay before retrying an AppTimeReq which couldn't be sent [s]
+ */
+#ifndef LMHP_CLOCK_SYNC_RETRY_DELAY
+#define LMHP_CLOCK_SYNC_RETRY_DELAY                 30
+#endif
+
+/*!
+ * Largest RTC frequency error accepted by the drift estimation [ppm]. Larger
+ * estimates are considered as a time step and restart the estimation.
+ */
+#ifndef LMHP_CLOCK_SYNC_MAX_DRIFT
+#define LMHP_CLOCK_SYNC_MAX_DRIFT                   500
+#endif
+
+/*!
+ * Maximum age of a system time synchronization made by another source, e.g. a
+ * GPS, for which the periodic AppTimeReq is skipped [s]. Less than
+ * \ref LMHP_CLOCK_SYNC_MIN_PERIOD so that the package own corrections don't
+ * skip the next request.
+ */
+#ifndef LMHP_CLOCK_SYNC_EXTERNAL_MAX_AGE
+#define LMHP_CLOCK_SYNC_EXTERNAL_MAX_AGE            60
+#endif
+
 /*!
  * Clock sync package parameters
  *
@@ -44,6 +91,20 @@
 
 LmhPackage_t *LmphClockSyncPackageFactory( void );
 
+/*!
+ * \brief Sends an AppTimeReq
+ *
+ * \remark Once the time has been corrected a first time, the package sends the
+ *         next requests by itself. The RTC drift is estimated from the
+ *         following corrections and compensated by the system time. The
+ *         requests period starts at \ref LMHP_CLOCK_SYNC_MIN_PERIOD and is
+ *         doubled while the corrections stay below \ref LMHP_CLOCK_SYNC_MAX_ERROR,
+ *         up to \ref LMHP_CLOCK_SYNC_MAX_PERIOD. It is halved otherwise. The
+ *         periodic requests are skipped while another source keeps the system
+ *         time synchronized.
+ *
+ * \retval status Status of the operation
+ */
 LmHandlerErrorStatus_t LmhpClockSyncAppTimeReq( void );
 
 #endif // __LMHP_CLOCK_SYNC_H__
@@ -60,6 +60,7 @@ typedef struct ComplianceTestState_s
     bool LinkCheck;
     uint8_t DemodMargin;
     uint8_t NbGateways;
+    TimerTime_t StepTime;
 }ComplianceTestState_t;
 
 /*!
@@ -84,7 +85,8 @@ static ComplianceTestState_t ComplianceTestState =
     .DownLinkCounter = 0,
     .LinkCheck = false,
     .DemodMargin = 0,
-    .NbGateways = 0
+    .NbGateways = 0,
+    .StepTime = 0
 };
 
 /*!
@@ -123,6 +125,14 @@ static bool LmhpComplianceIsRunning( void );
  */
 static void LmhpComplianceProcess( void );
 
+/*!
+ * Returns if the compliance certification protocol has a transmission pending.
+ *
+ * \retval status Compliance certification protocol events status
+ *                [true: Pending, false: Not pending]
+ */
+static bool LmhpComplianceIsProcessPending( void );
+
 /*!
  * Processes the MCPS Indication
  *
@@ -130,6 +140,13 @@ static void LmhpComplianceProcess( void );
  */
 static void LmhpComplianceOnMcpsIndication( McpsIndication_t *mcpsIndication );
 
+/*!
+ * Processes the MCPS Confirm
+ *
+ * \param [IN] mcpsConfirm MCPS confirmation primitive data
+ */
+static void LmhpComplianceOnMcpsConfirm( McpsConfirm_t *mcpsConfirm );
+
 /*!
  * Processes the MLME Confirm
  *
@@ -158,7 +175,8 @@ LmhPackage_t LmhpCompliancePackage =
     .IsInitialized = LmhpComplianceIsInitialized,
     .IsRunning = LmhpComplianceIsRunning,
     .Process = LmhpComplianceProcess,
-    .OnMcpsConfirmProcess = NULL,                              // Not used in this package
+    .IsProcessPending = LmhpComplianceIsProcessPending,
+    .OnMcpsConfirmProcess = LmhpComplianceOnMcpsConfirm,
     .OnMcpsIndicationProcess = LmhpComplianceOnMcpsIndication,
     .OnMlmeConfirmProcess = LmhpComplianceOnMlmeConfirm,
     .OnMlmeIndicationProcess = NULL,                           // Not used in this package
@@ -265,6 +283,19 @@ static LmHandlerErrorStatus_t LmhpComplianceTxProcess( void )
     return LmhpCompliancePackage.OnSendRequest( &appData, ( LmHandlerMsgTypes_t )ComplianceTestState.IsTxConfirmed );
 }
 
+static void LmhpComplianceOnMcpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+    if( ( ComplianceTestState.IsRunning == false ) || ( LmhpComplianceParams->FastMode == false ) )
+    {
+        return;
+    }
+
+    // The RX windows are closed, send the next uplink right away. The timer
+    // is kept as a fallback when the uplink can't be sent.
+    TimerStop( &ComplianceTxNextPacketTimer );
+    ComplianceTestState.TxPending = true;
+}
+
 static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication )
 {
     if( ComplianceTestState.Initialized == false )
@@ -304,6 +335,7 @@ static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication )
             ComplianceTestState.NbGateways = 0;
             ComplianceTestState.IsRunning = true;
             ComplianceTestState.State = 1;
+            ComplianceTestState.StepTime = TimerGetCurrentTime( );
 
             // Enable ADR while in compliance test mode
             mibReq.Type = MIB_ADR;
@@ -320,6 +352,7 @@ static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication )
             }
             // Initialize compliance protocol transmission timer
             TimerInit( &ComplianceTxNextPacketTimer, OnComplianceTxNextPacketTimerEvent );
+            TimerSetDeferred( &ComplianceTxNextPacketTimer, true );
             TimerSetValue( &ComplianceTxNextPacketTimer, COMPLIANCE_TX_DUTYCYCLE );
 
             // Confirm compliance test protocol activation
@@ -333,6 +366,12 @@ static void LmhpComplianceOnMcpsIndication( McpsIndication_t* mcpsIndication )
         // Increment the compliance certification protocol downlink counter
         ComplianceTestState.DownLinkCounter++;
 
+        if( LmhpComplianceParams->OnTestStep != NULL )
+        {
+            LmhpComplianceParams->OnTestStep( mcpsIndication->Buffer[0], TimerGetElapsedTime( ComplianceTestState.StepTime ) );
+        }
+        ComplianceTestState.StepTime = TimerGetCurrentTime( );
+
         // Parse compliance test protocol
         ComplianceTestState.State = mcpsIndication->Buffer[0];
         switch( ComplianceTestState.State )
@@ -485,6 +524,11 @@ static void LmhpComplianceProcess( void )
     }
 }
 
+static bool LmhpComplianceIsProcessPending( void )
+{
+    return ComplianceTestState.TxPending;
+}
+
 static void OnComplianceTxNextPacketTimerEvent( void* context )
 {
     ComplianceTestState.TxPending = true;
@@ -61,6 +61,22 @@ typedef struct LmhpComplianceParams_s
      *         reduce the power consumption.
      */
     void ( *StartPeripherals )( void );
+    /*!
+     * Sends the uplinks back-to-back, as soon as the previous one is
+     * confirmed, instead of every 5 s.
+     *
+     * \remark Use only for lab regression tests against a test network
+     *         server. The duty cycle is disabled in the test mode.
+     */
+    bool FastMode;
+    /*!
+     * Reports every test command received with the time elapsed since the
+     * previous one, or since the test mode activation. May be NULL.
+     *
+     * \param [IN] command Test command identifier
+     * \param [IN] elapsed Step duration [ms]
+     */
+    void ( *OnTestStep )( uint8_t command, TimerTime_t elapsed );
 }LmhpComplianceParams_t;
 
 LmhPackage_t *LmphCompliancePackageFactory( void );
@@ -19,6 +19,8 @@
  *
  * \author    Miguel Luis ( Semtech )
  */
+#include "board.h"
+#include "trace.h"
 #include "LmHandler.h"
 #include "LmhpFragmentation.h"
 #include "FragDecoder.h"
@@ -33,6 +35,13 @@
 
 #define FRAGMENTATION_MAX_SESSIONS                  4
 
+/*!
+ * Number of received fragments waiting to be fed to the decoder
+ */
+#ifndef FRAGMENTATION_QUEUE_SIZE
+#define FRAGMENTATION_QUEUE_SIZE                    4
+#endif
+
 /*!
  * Package current context
  */
@@ -97,6 +106,14 @@ static bool LmhpFragmentationIsRunning( void );
  */
 static void LmhpFragmentationProcess( void );
 
+/*!
+ * Returns if fragments are waiting to be fed to the decoder.
+ *
+ * \retval status Package pending events status
+ *                [true: Fragments queued, false: Queue empty]
+ */
+static bool LmhpFragmentationIsProcessPending( void );
+
 /*!
  * Processes the MCPS Indication
  *
@@ -144,10 +161,35 @@ typedef struct FragSessionData_s
     FragGroupData_t FragGroupData;
     FragDecoderStatus_t FragDecoderStatus;
     int32_t FragDecoderPorcessStatus;
+    uint16_t FragNbLastQueued;
 }FragSessionData_t;
 
 FragSessionData_t FragSessionData[FRAGMENTATION_MAX_SESSIONS];
 
+/*!
+ * Decoder of each fragmentation session. Kept apart from FragSessionData as
+ * the decoders own a workspace and must not be copied.
+ */
+static FragDecoder_t FragDecoders[FRAGMENTATION_MAX_SESSIONS];
+
+/*!
+ * Received fragment waiting to be fed to the decoder
+ */
+typedef struct FragQueueEntry_s
+{
+    uint8_t FragIndex;
+    uint16_t FragCounter;
+    uint8_t Data[FRAG_MAX_SIZE];
+}FragQueueEntry_t;
+
+/*!
+ * Fragments queue. The fragments are decoded from the package process so
+ * that the MAC keeps up with the fragments rate.
+ */
+static FragQueueEntry_t FragQueue[FRAGMENTATION_QUEUE_SIZE];
+static uint8_t FragQueueHead = 0;
+static uint8_t FragQueueCnt = 0;
+
 
 static LmhPackage_t LmhpFragmentationPackage =
 {
@@ -156,6 +198,7 @@ static LmhPackage_t LmhpFragmentationPackage =
     .IsInitialized = LmhpFragmentationIsInitialized,
     .IsRunning = LmhpFragmentationIsRunning,
     .Process = LmhpFragmentationProcess,
+    .IsProcessPending = LmhpFragmentationIsProcessPending,
     .OnMcpsConfirmProcess = NULL,                              // Not used in this package
     .OnMcpsIndicationProcess = LmhpFragmentationOnMcpsIndication,
     .OnMlmeConfirmProcess = NULL,                              // Not used in this package
@@ -206,10 +249,175 @@ static bool LmhpFragmentationIsRunning( void )
     return LmhpFragmentationState.IsRunning;
 }
 
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+/*!
+ * Rebuilds the new image when the received file is a delta patch
+ *
+ * \param [IN] fragIndex Fragmentation session index
+ */
+static void FragmentationPatch( uint8_t fragIndex )
+{
+    DeltaPatchParams_t *params = LmhpFragmentationParams->DeltaPatch;
+    uint32_t addr = FragDecoderGetFileAddr( &FragDecoders[fragIndex] );
+    uint32_t size = ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding;
+    uint32_t targetSize = 0;
+    DeltaPatchStatus_t status;
+
+    if( ( params == NULL ) || ( DeltaPatchIsPatch( params, addr, size ) == false ) )
+    {
+        // Full image, left to the application
+        return;
+    }
+
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
+    status = DeltaPatchApply( params, addr, size, &targetSize );
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
+    if( LmhpFragmentationParams->OnPatchDone != NULL )
+    {
+        LmhpFragmentationParams->OnPatchDone( status, targetSize );
+    }
+}
+#endif
+
+/*!
+ * Feeds a received fragment to the decoder
+ *
+ * \param [IN] fragIndex   Fragmentation session index
+ * \param [IN] fragCounter Fragment counter
+ * \param [IN] data        Fragment data
+ */
+static void FragmentationDecode( uint8_t fragIndex, uint16_t fragCounter, uint8_t *data )
+{
+    int32_t status;
+
+    if( FragSessionData[fragIndex].FragDecoderPorcessStatus != FRAG_SESSION_ONGOING )
+    {
+        return;
+    }
+
+    TRACE_BEGIN( TRACE_PROBE_FRAG_DECODER_PROCESS );
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
+    status = FragDecoderProcess( &FragDecoders[fragIndex], fragCounter, data );
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
+    TRACE_END( TRACE_PROBE_FRAG_DECODER_PROCESS );
+    FragSessionData[fragIndex].FragDecoderPorcessStatus = status;
+    FragSessionData[fragIndex].FragDecoderStatus = FragDecoderGetStatus( &FragDecoders[fragIndex] );
+    if( LmhpFragmentationParams->OnProgress != NULL )
+    {
+        LmhpFragmentationParams->OnProgress( FragSessionData[fragIndex].FragDecoderStatus.FragNbRx,
+                                             FragSessionData[fragIndex].FragGroupData.FragNb,
+                                             FragSessionData[fragIndex].FragGroupData.FragSize,
+                                             FragSessionData[fragIndex].FragDecoderStatus.FragNbLost );
+    }
+
+    if( status >= 0 )
+    {
+        // Fragmentation done, notified right away
+        FragSessionData[fragIndex].FragDecoderPorcessStatus = FRAG_SESSION_NOT_STARTED;
+        if( LmhpFragmentationParams->OnDone != NULL )
+        {
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+            LmhpFragmentationParams->OnDone( status,
+                                            ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding );
+#else
+            LmhpFragmentationParams->OnDone( status,
+                                            LmhpFragmentationParams->Buffer,
+                                            ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding );
+#endif
+        }
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+        if( LmhpFragmentationParams->OnSessionDone != NULL )
+        {
+            LmhpFragmentationParams->OnSessionDone( fragIndex, status, FragDecoderGetFileAddr( &FragDecoders[fragIndex] ),
+                                                    ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding );
+        }
+        if( FragSessionData[fragIndex].FragDecoderStatus.MatrixError == 0 )
+        {
+            FragmentationPatch( fragIndex );
+        }
+#endif
+        if( FragSessionData[fragIndex].FragDecoderStatus.MatrixError == 0 )
+        {
+            // Give the workspace back to the other sessions. A failed file
+            // keeps it so that a new session can resume it.
+            FragDecoderDeInit( &FragDecoders[fragIndex] );
+        }
+    }
+}
+
+/*!
+ * Feeds the oldest queued fragment to the decoder
+ */
+static void FragmentationQueueProcess( void )
+{
+    FragQueueEntry_t *entry = &FragQueue[FragQueueHead];
+
+    if( FragQueueCnt == 0 )
+    {
+        return;
+    }
+    FragmentationDecode( entry->FragIndex, entry->FragCounter, entry->Data );
+    FragQueueHead = ( FragQueueHead + 1 ) % FRAGMENTATION_QUEUE_SIZE;
+    FragQueueCnt--;
+}
+
+/*!
+ * Feeds all the queued fragments to the decoder, before the sessions or
+ * their status are handled
+ */
+static void FragmentationQueueFlush( void )
+{
+    while( FragQueueCnt != 0 )
+    {
+        FragmentationQueueProcess( );
+    }
+}
+
+/*!
+ * Queues a received fragment. The fragments already received are dropped
+ * before being copied.
+ *
+ * \param [IN] fragIndex   Fragmentation session index
+ * \param [IN] fragCounter Fragment counter
+ * \param [IN] data        Fragment data
+ */
+static void FragmentationQueuePush( uint8_t fragIndex, uint16_t fragCounter, uint8_t *data )
+{
+    FragQueueEntry_t *entry;
+
+    if( FragSessionData[fragIndex].FragDecoderPorcessStatus == FRAG_SESSION_ONGOING )
+    {
+        if( fragCounter <= FragSessionData[fragIndex].FragNbLastQueued )
+        {
+            // Repeated or out of order fragment, dropped by the decoder anyway
+            return;
+        }
+        FragSessionData[fragIndex].FragNbLastQueued = fragCounter;
+    }
+    if( FragQueueCnt == FRAGMENTATION_QUEUE_SIZE )
+    {
+        // Make room, the decoder gets the fragments in order
+        FragmentationQueueProcess( );
+    }
+
+    entry = &FragQueue[( FragQueueHead + FragQueueCnt ) % FRAGMENTATION_QUEUE_SIZE];
+    entry->FragIndex = fragIndex;
+    entry->FragCounter = fragCounter;
+    memcpy1( entry->Data, data, MIN( FragSessionData[fragIndex].FragGroupData.FragSize, FRAG_MAX_SIZE ) );
+    FragQueueCnt++;
+}
+
 static void LmhpFragmentationProcess( void )
 {
     // TODO: Start a timer to randomly delay the answer
 
+    // One fragment per call, the MAC events are handled in between
+    FragmentationQueueProcess( );
+}
+
+static bool LmhpFragmentationIsProcessPending( void )
+{
+    return FragQueueCnt != 0;
 }
 
 static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication )
@@ -240,7 +448,8 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                 uint8_t participants = fragIndex & 0x01;
 
                 fragIndex >>= 1;
-                FragSessionData[fragIndex].FragDecoderStatus = FragDecoderGetStatus( );
+                FragmentationQueueFlush( );
+                FragSessionData[fragIndex].FragDecoderStatus = FragDecoderGetStatus( &FragDecoders[fragIndex] );
 
                 if( ( participants == 1 ) ||
                     ( ( participants == 0 ) && ( FragSessionData[fragIndex].FragDecoderStatus.FragNbLost > 0 ) ) )
@@ -287,8 +496,13 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                 }
 
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                if( ( fragSessionData.FragGroupData.FragNb * fragSessionData.FragGroupData.FragSize ) > FragDecoderGetMaxFileSize( ) )
+                if( ( fragSessionData.FragGroupData.FragSession.Fields.FragIndex < FRAGMENTATION_MAX_SESSIONS ) &&
+                    ( FragDecoderIsSessionSupported( &FragDecoders[fragSessionData.FragGroupData.FragSession.Fields.FragIndex],
+                                                     fragSessionData.FragGroupData.FragNb,
+                                                     fragSessionData.FragGroupData.FragSize ) == false ) )
                 {
+                    // Workspace, file or matrix storage left by the other
+                    // sessions is too small
                     status |= 0x02; // Not enough Memory
                 }
 #else
@@ -314,15 +528,22 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                 if( ( status & 0x0F ) == 0 )
                 {
                     // The FragSessionSetup is accepted
+                    FragmentationQueueFlush( );
                     fragSessionData.FragGroupData.IsActive = true;
                     fragSessionData.FragDecoderPorcessStatus = FRAG_SESSION_ONGOING;
+                    fragSessionData.FragNbLastQueued = 0;
                     FragSessionData[fragSessionData.FragGroupData.FragSession.Fields.FragIndex] = fragSessionData;
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                    FragDecoderInit( fragSessionData.FragGroupData.FragNb,
-                                     fragSessionData.FragGroupData.FragSize,
-                                     &LmhpFragmentationParams->DecoderCallbacks );
+                    // A session for the same file goes on with the fragments
+                    // already received
+                    FragDecoderResume( &FragDecoders[fragSessionData.FragGroupData.FragSession.Fields.FragIndex],
+                                       fragSessionData.FragGroupData.FragNb,
+                                       fragSessionData.FragGroupData.FragSize,
+                                       fragSessionData.FragGroupData.Descriptor,
+                                       &LmhpFragmentationParams->DecoderCallbacks );
 #else
-                    FragDecoderInit( fragSessionData.FragGroupData.FragNb,
+                    FragDecoderInit( &FragDecoders[fragSessionData.FragGroupData.FragSession.Fields.FragIndex],
+                                     fragSessionData.FragGroupData.FragNb,
                                      fragSessionData.FragGroupData.FragSize,
                                      LmhpFragmentationParams->Buffer,
                                      LmhpFragmentationParams->BufferSize );
@@ -351,7 +572,9 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                 else
                 {
                     // Delete session
+                    FragmentationQueueFlush( );
                     FragSessionData[id].FragGroupData.IsActive = false;
+                    FragDecoderDeInit( &FragDecoders[id] );
                 }
                 LmhpFragmentationState.DataBuffer[dataBufferIndex++] = FRAGMENTATION_FRAG_SESSION_DELETE_ANS;
                 LmhpFragmentationState.DataBuffer[dataBufferIndex++] = status;
@@ -385,37 +608,7 @@ static void LmhpFragmentationOnMcpsIndication( McpsIndication_t *mcpsIndication
                     //}
                 }
 
-                if( FragSessionData[fragIndex].FragDecoderPorcessStatus == FRAG_SESSION_ONGOING )
-                {
-                    FragSessionData[fragIndex].FragDecoderPorcessStatus = FragDecoderProcess( fragCounter, &mcpsIndication->Buffer[cmdIndex] );
-                    FragSessionData[fragIndex].FragDecoderStatus = FragDecoderGetStatus( );
-                    if( LmhpFragmentationParams->OnProgress != NULL )
-                    {
-                        LmhpFragmentationParams->OnProgress( FragSessionData[fragIndex].FragDecoderStatus.FragNbRx,
-                                                             FragSessionData[fragIndex].FragGroupData.FragNb,
-                                                             FragSessionData[fragIndex].FragGroupData.FragSize,
-                                                             FragSessionData[fragIndex].FragDecoderStatus.FragNbLost );
-                    }
-                }
-                else
-                {
-                    if( FragSessionData[fragIndex].FragDecoderPorcessStatus >= 0 )
-                    {
-                        // Fragmentation successfully done
-                        FragSessionData[fragIndex].FragDecoderPorcessStatus = FRAG_SESSION_NOT_STARTED;
-                        if( LmhpFragmentationParams->OnDone != NULL )
-                        {
-#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
-                            LmhpFragmentationParams->OnDone( FragSessionData[fragIndex].FragDecoderPorcessStatus,
-                                                            ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding );
-#else
-                            LmhpFragmentationParams->OnDone( FragSessionData[fragIndex].FragDecoderPorcessStatus,
-                                                            LmhpFragmentationParams->Buffer,
-                                                            ( FragSessionData[fragIndex].FragGroupData.FragNb * FragSessionData[fragIndex].FragGroupData.FragSize ) - FragSessionData[fragIndex].FragGroupData.Padding );
-#endif
-                        }
-                    }
-                }
+                FragmentationQueuePush( fragIndex, fragCounter, &mcpsIndication->Buffer[cmdIndex] );
                 cmdIndex += FragSessionData[fragIndex].FragGroupData.FragSize;
                 break;
             }
@@ -26,6 +26,7 @@
 #include "LmHandlerTypes.h"
 #include "LmhPackage.h"
 #include "FragDecoder.h"
+#include "DeltaPatch.h"
 
 /*!
  * Fragmentation data block transport package identifier.
@@ -73,6 +74,29 @@ typedef struct LmhpFragmentationParams_s
      * \param [IN] size   Received file size
      */
     void ( *OnDone )( int32_t status, uint32_t size );
+    /*!
+     * Notifies that a fragmentation session is finished. Optional, needed
+     * when several sessions run at once as each file is stored at its own
+     * address.
+     *
+     * \param [IN] fragIndex Fragmentation session index
+     * \param [IN] status    Fragmentation session status
+     * \param [IN] addr      Received file address in the storage
+     * \param [IN] size      Received file size
+     */
+    void ( *OnSessionDone )( uint8_t fragIndex, int32_t status, uint32_t addr, uint32_t size );
+    /*!
+     * Delta patch parameters. Optional, when set a received file starting
+     * with a patch header is applied to the running image.
+     */
+    DeltaPatchParams_t *DeltaPatch;
+    /*!
+     * Notifies that a received delta patch has been applied
+     *
+     * \param [IN] status Delta patch status
+     * \param [IN] size   New image size
+     */
+    void ( *OnPatchDone )( DeltaPatchStatus_t status, uint32_t size );
 #else
     /*!
      * Notifies that the fragmentation session is finished
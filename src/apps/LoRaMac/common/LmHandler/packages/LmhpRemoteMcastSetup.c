@@ -114,9 +114,13 @@ static void LmhpRemoteMcastSetupProcess( void );
  */
 static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndication );
 
-static void OnSessionStartTimer( void *context );
+static void OnSessionTimer( void *context );
 
-static void OnSessionStopTimer( void *context );
+/*!
+ * \brief Updates the device class from the sessions windows and starts the
+ *        session timer on the next window edge
+ */
+static void ScheduleSessions( void );
 
 static LmhpRemoteMcastSetupState_t LmhpRemoteMcastSetupState =
 {
@@ -144,6 +148,7 @@ typedef struct McGroupData_s
 typedef enum eSessionState
 {
     SESSION_STOPED,
+    SESSION_SCHEDULED,
     SESSION_STARTED
 }SessionState_t;
 
@@ -154,19 +159,52 @@ typedef struct McSessionData_s
     uint32_t SessionTime;
     uint8_t SessionTimeout;
     McRxParams_t RxParams;
+    /*!
+     * Session start, in the timer time base [ms]
+     */
+    TimerTime_t StartTime;
+    /*!
+     * Session end, in the timer time base [ms]
+     */
+    TimerTime_t StopTime;
 }McSessionData_t;
 
 McSessionData_t McSessionData[LORAMAC_MAX_MC_CTX];
 
 /*!
- * Session start timer
+ * Session timer. Expires on the next session window edge.
  */
-static TimerEvent_t SessionStartTimer;
+static TimerEvent_t SessionTimer;
 
 /*!
- * Session start timer
+ * Set when the package switched the device to Class C
  */
-static TimerEvent_t SessionStopTimer;
+static bool IsSessionClassC = false;
+
+/*!
+ * Session which opened the current Class C period
+ */
+static uint8_t ClassCSessionId = 0;
+
+/*!
+ * Class C switch-over measurements of the last session start
+ */
+static LmhpRemoteMcastSetupSwitchStats_t SwitchStats;
+
+/*!
+ * Multicast groups setups of a downlink, provisioned together
+ */
+typedef struct McGroupSetupBatch_s
+{
+    uint8_t NbGroups;
+    McChannelParams_t Channels[LORAMAC_MAX_MC_CTX];
+    /*!
+     * Answers status byte indexes in the data buffer
+     */
+    uint8_t AnsIndexes[LORAMAC_MAX_MC_CTX];
+}McGroupSetupBatch_t;
+
+static McGroupSetupBatch_t McGroupSetupBatch;
 
 static LmhPackage_t LmhpRemoteMcastSetupPackage =
 {
@@ -175,6 +213,7 @@ static LmhPackage_t LmhpRemoteMcastSetupPackage =
     .IsInitialized = LmhpRemoteMcastSetupIsInitialized,
     .IsRunning = LmhpRemoteMcastSetupIsRunning,
     .Process = LmhpRemoteMcastSetupProcess,
+    .IsProcessPending = NULL,                                  // Not used in this package
     .OnMcpsConfirmProcess = NULL,                              // Not used in this package
     .OnMcpsIndicationProcess = LmhpRemoteMcastSetupOnMcpsIndication,
     .OnMlmeConfirmProcess = NULL,                              // Not used in this package
@@ -200,8 +239,13 @@ static void LmhpRemoteMcastSetupInit( void * params, uint8_t *dataBuffer, uint8_
         LmhpRemoteMcastSetupState.DataBufferMaxSize = dataBufferMaxSize;
         LmhpRemoteMcastSetupState.Initialized = true;
         LmhpRemoteMcastSetupState.IsRunning = true;
-        TimerInit( &SessionStartTimer, OnSessionStartTimer );
-        TimerInit( &SessionStopTimer, OnSessionStopTimer );
+        TimerInit( &SessionTimer, OnSessionTimer );
+        TimerSetDeferred( &SessionTimer, true );
+        for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+        {
+            McSessionData[i].SessionState = SESSION_STOPED;
+        }
+        IsSessionClassC = false;
     }
     else
     {
@@ -230,6 +274,31 @@ static void LmhpRemoteMcastSetupProcess( void )
     // TODO: add sessions handling
 }
 
+/*!
+ * \brief Sets up the multicast groups of the pending McGroupSetupReq commands
+ *        and updates their answers
+ */
+static void SetupMcGroupsBatch( void )
+{
+    LoRaMacStatus_t statuses[LORAMAC_MAX_MC_CTX];
+
+    if( McGroupSetupBatch.NbGroups == 0 )
+    {
+        return;
+    }
+
+    LoRaMacMcChannelSetupBatch( McGroupSetupBatch.Channels, McGroupSetupBatch.NbGroups, statuses );
+    for( uint8_t i = 0; i < McGroupSetupBatch.NbGroups; i++ )
+    {
+        if( statuses[i] != LORAMAC_STATUS_OK )
+        {
+            // IDerror
+            LmhpRemoteMcastSetupState.DataBuffer[McGroupSetupBatch.AnsIndexes[i]] |= 0x01 << 2;
+        }
+    }
+    McGroupSetupBatch.NbGroups = 0;
+}
+
 static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndication )
 {
     uint8_t cmdIndex = 0;
@@ -237,6 +306,12 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
 
     while( cmdIndex < mcpsIndication->BufferSize )
     {
+        if( ( mcpsIndication->Buffer[cmdIndex] != REMOTE_MCAST_SETUP_MC_GROUP_SETUP_REQ ) ||
+            ( McGroupSetupBatch.NbGroups == LORAMAC_MAX_MC_CTX ) )
+        {
+            // The following commands find the groups set up
+            SetupMcGroupsBatch( );
+        }
         switch( mcpsIndication->Buffer[cmdIndex++] )
         {
             case REMOTE_MCAST_SETUP_PKG_VERSION_REQ:
@@ -276,7 +351,7 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                 McSessionData[id].McGroupData.McFCountMax += ( mcpsIndication->Buffer[cmdIndex++] << 16 ) & 0x00FF0000;
                 McSessionData[id].McGroupData.McFCountMax += ( mcpsIndication->Buffer[cmdIndex++] << 24 ) & 0xFF000000;
 
-                McChannelParams_t channel = 
+                McGroupSetupBatch.Channels[McGroupSetupBatch.NbGroups] = ( McChannelParams_t )
                 {
                     .Class = CLASS_C, // Field not used for multicast channel setup. Must be initialized to something
                     .IsEnabled = true,
@@ -291,13 +366,10 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                         .Datarate = 0
                     }
                 };
-                uint8_t idError = 0x01; // One bit value
-                if( LoRaMacMcChannelSetup( &channel ) == LORAMAC_STATUS_OK )
-                {
-                    idError = 0x00;
-                }
+                // The groups are set up together, the IDerror bit is set then
                 LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = REMOTE_MCAST_SETUP_MC_GROUP_SETUP_ANS;
-                LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = ( idError << 2 ) | McSessionData[id].McGroupData.IdHeader.Fields.McGroupId;
+                McGroupSetupBatch.AnsIndexes[McGroupSetupBatch.NbGroups++] = dataBufferIndex;
+                LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = McSessionData[id].McGroupData.IdHeader.Fields.McGroupId;
                 break;
             }
             case REMOTE_MCAST_SETUP_MC_GROUP_DELETE_REQ:
@@ -313,6 +385,12 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                 {
                     status |= 0x04; // McGroupUndefined bit set
                 }
+                else if( McSessionData[id].SessionState != SESSION_STOPED )
+                {
+                    // Cancel the group session
+                    McSessionData[id].SessionState = SESSION_STOPED;
+                    ScheduleSessions( );
+                }
                 LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = status;
                 break;
             }
@@ -342,16 +420,22 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
                 if( LoRaMacMcChannelSetupRxParams( ( AddressIdentifier_t )id, &McSessionData[id].RxParams, &status ) == LORAMAC_STATUS_OK )
                 {
                     SysTime_t curTime = { .Seconds = 0, .SubSeconds = 0 };
+                    TimerTime_t now = TimerGetCurrentTime( );
                     curTime = SysTimeGet( );
 
                     int32_t timeToSessionStart = McSessionData[id].SessionTime - curTime.Seconds;
                     if( timeToSessionStart > 0 )
                     {
-                        // Start session start timer
-                        TimerSetValue( &SessionStartTimer, timeToSessionStart * 1000 );
-                        TimerStart( &SessionStartTimer );
+                        // Session window in the timer time base, with the
+                        // system time sub-seconds
+                        int32_t timeToSessionStartMs = timeToSessionStart * 1000 - curTime.SubSeconds;
 
-                        DBG( "Time2SessionStart: %ld ms\r\n", timeToSessionStart * 1000 );
+                        McSessionData[id].StartTime = now + timeToSessionStartMs;
+                        McSessionData[id].StopTime = McSessionData[id].StartTime + ( ( uint32_t )1 << McSessionData[id].SessionTimeout ) * 1000;
+                        McSessionData[id].SessionState = SESSION_SCHEDULED;
+                        ScheduleSessions( );
+
+                        DBG( "Time2SessionStart: %ld ms\r\n", timeToSessionStartMs );
 
                         LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = status;
                         LmhpRemoteMcastSetupState.DataBuffer[dataBufferIndex++] = ( timeToSessionStart >> 0  ) & 0xFF;
@@ -379,6 +463,7 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
             }
         }
     }
+    SetupMcGroupsBatch( );
 
     if( dataBufferIndex != 0 )
     {
@@ -409,21 +494,127 @@ static void LmhpRemoteMcastSetupOnMcpsIndication( McpsIndication_t *mcpsIndicati
     }
 }
 
-static void OnSessionStartTimer( void *context )
+void LmhpRemoteMcastSetupGetSwitchStats( LmhpRemoteMcastSetupSwitchStats_t *stats )
 {
-    TimerStop( &SessionStartTimer );
+    *stats = SwitchStats;
+}
 
-    // Switch to Class C
-    LmHandlerRequestClass( CLASS_C );
+static void OnSessionTimer( void *context )
+{
+    ScheduleSessions( );
+}
 
-    TimerSetValue( &SessionStopTimer, ( 1 << McSessionData[0].SessionTimeout ) * 1000 );
-    TimerStart( &SessionStopTimer );
+/*!
+ * \brief Checks if two sessions use the same reception parameters
+ */
+static bool IsSameRxParams( McSessionData_t *a, McSessionData_t *b )
+{
+    return ( a->RxParams.ClassC.Frequency == b->RxParams.ClassC.Frequency ) &&
+           ( a->RxParams.ClassC.Datarate == b->RxParams.ClassC.Datarate );
 }
 
-static void OnSessionStopTimer( void *context )
+static void ScheduleSessions( void )
 {
-    TimerStop( &SessionStopTimer );
+    TimerTime_t now = TimerGetCurrentTime( );
+    TimerTime_t nextEvent = 0;
+    bool isNextEventSet = false;
+    bool isClassCRequired = false;
+    int32_t firstStart = 0;
+    uint8_t firstId = 0;
+
+    TimerStop( &SessionTimer );
+
+    // Sessions within their window. The window opens the guard time ahead of
+    // the session start.
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        McSessionData_t *session = &McSessionData[i];
+
+        if( session->SessionState == SESSION_STOPED )
+        {
+            continue;
+        }
+        if( ( int32_t )( session->StopTime - now ) <= 0 )
+        {
+            session->SessionState = SESSION_STOPED;
+            continue;
+        }
+        if( ( session->SessionState == SESSION_STARTED ) ||
+            ( ( int32_t )( session->StartTime - LMHP_REMOTE_MCAST_SETUP_SESSION_GUARD - now ) <= 0 ) )
+        {
+            if( ( isClassCRequired == false ) || ( ( int32_t )( session->StartTime - now ) < firstStart ) )
+            {
+                firstStart = ( int32_t )( session->StartTime - now );
+                firstId = i;
+            }
+            session->SessionState = SESSION_STARTED;
+            isClassCRequired = true;
+        }
+    }
+
+    // Sessions sharing the reception parameters of the current Class C period
+    // and starting shortly after extend it
+    for( uint8_t i = 0; ( i < LORAMAC_MAX_MC_CTX ) && ( IsSessionClassC == true ); i++ )
+    {
+        if( ( McSessionData[i].SessionState == SESSION_SCHEDULED ) &&
+            ( ( int32_t )( McSessionData[i].StartTime - now ) <= LMHP_REMOTE_MCAST_SETUP_SESSION_MERGE_GAP ) &&
+            ( IsSameRxParams( &McSessionData[i], &McSessionData[ClassCSessionId] ) == true ) )
+        {
+            McSessionData[i].SessionState = SESSION_STARTED;
+            isClassCRequired = true;
+        }
+    }
 
-    // Switch back to Class A
-    LmHandlerRequestClass( CLASS_A );
+    // Next window edge
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        McSessionData_t *session = &McSessionData[i];
+        TimerTime_t event;
+
+        if( session->SessionState == SESSION_STOPED )
+        {
+            continue;
+        }
+        event = ( session->SessionState == SESSION_STARTED ) ? session->StopTime :
+                                                               ( session->StartTime - LMHP_REMOTE_MCAST_SETUP_SESSION_GUARD );
+        if( ( isNextEventSet == false ) || ( ( int32_t )( event - nextEvent ) < 0 ) )
+        {
+            nextEvent = event;
+            isNextEventSet = true;
+        }
+    }
+
+    if( ( isClassCRequired == true ) && ( IsSessionClassC == false ) )
+    {
+        TimerTime_t switchStart = TimerGetCurrentTime( );
+
+        // Switch to Class C
+        if( LmHandlerRequestClass( CLASS_C ) == LORAMAC_HANDLER_SUCCESS )
+        {
+            IsSessionClassC = true;
+            ClassCSessionId = firstId;
+        }
+        else
+        {
+            // Retry shortly, the active sessions stop later
+            nextEvent = now + LMHP_REMOTE_MCAST_SETUP_SESSION_GUARD;
+        }
+        SwitchStats.SwitchDuration = TimerGetElapsedTime( switchStart );
+        SwitchStats.StartMargin = firstStart - ( int32_t )TimerGetElapsedTime( now );
+        DBG( "Session start margin: %ld ms, switch: %lu ms\r\n", SwitchStats.StartMargin, SwitchStats.SwitchDuration );
+    }
+    else if( ( isClassCRequired == false ) && ( IsSessionClassC == true ) )
+    {
+        // Switch back to Class A
+        LmHandlerRequestClass( CLASS_A );
+        IsSessionClassC = false;
+    }
+
+    if( isNextEventSet == true )
+    {
+        int32_t delay = ( int32_t )( nextEvent - TimerGetCurrentTime( ) );
+
+        TimerSetValue( &SessionTimer, ( delay > 0 ) ? ( uint32_t )delay : 1 );
+        TimerStart( &SessionTimer );
+    }
 }
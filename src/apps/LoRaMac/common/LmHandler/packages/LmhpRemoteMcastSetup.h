@@ -33,6 +33,22 @@
  */
 #define PACKAGE_ID_REMOTE_MCAST_SETUP               2
 
+/*!
+ * Time the Class C switch is done ahead of a session start [ms]. Covers the
+ * timer and class switch latencies.
+ */
+#ifndef LMHP_REMOTE_MCAST_SETUP_SESSION_GUARD
+#define LMHP_REMOTE_MCAST_SETUP_SESSION_GUARD       50
+#endif
+
+/*!
+ * Largest gap between two sessions with identical reception parameters
+ * bridged without leaving Class C [ms]
+ */
+#ifndef LMHP_REMOTE_MCAST_SETUP_SESSION_MERGE_GAP
+#define LMHP_REMOTE_MCAST_SETUP_SESSION_MERGE_GAP   500
+#endif
+
 /*!
  * Remote multicast setup package parameters
  *
@@ -42,6 +58,29 @@
 //{
 //}LmhpRemoteMcastSetupParams_t;
 
+/*!
+ * Class C switch-over measurements of the last session start
+ */
+typedef struct LmhpRemoteMcastSetupSwitchStats_s
+{
+    /*!
+     * Time between the end of the class switch and the session start [ms].
+     * Negative when the switch completed after the session start.
+     */
+    int32_t StartMargin;
+    /*!
+     * Time spent switching the device class [ms]
+     */
+    uint32_t SwitchDuration;
+}LmhpRemoteMcastSetupSwitchStats_t;
+
 LmhPackage_t *LmhpRemoteMcastSetupPackageFactory( void );
 
+/*!
+ * \brief Gets the Class C switch-over measurements of the last session start
+ *
+ * \param [OUT] stats Measurements
+ */
+void LmhpRemoteMcastSetupGetSwitchStats( LmhpRemoteMcastSetupSwitchStats_t *stats );
+
 #endif // __LMHP_REMOTE_MCAST_SETUP_H__
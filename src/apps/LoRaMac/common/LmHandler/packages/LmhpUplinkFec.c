@@ -0,0 +1,271 @@
+/*!
+ * \file      LmhpUplinkFec.c
+ *
+ * \brief     Implements the uplink forward error correction package
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include "utilities.h"
+#include "LmHandler.h"
+#include "LmhpUplinkFec.h"
+
+/*!
+ * Size of the coded uplink header, the index and K [bytes]
+ */
+#define UPLINK_FEC_HEADER_SIZE                      2
+
+/*!
+ * Largest block, the port, the size and the payload [bytes]
+ */
+#define UPLINK_FEC_MAX_BLOCK_SIZE                   ( 2 + LMHP_UPLINK_FEC_MAX_PAYLOAD_SIZE )
+
+/*!
+ * Package current context
+ */
+typedef struct LmhpUplinkFecState_s
+{
+    bool Initialized;
+    bool IsRunning;
+    /*!
+     * Number of previous uplinks covered by the parity
+     */
+    uint8_t K;
+    /*!
+     * Index of the next coded uplink
+     */
+    uint8_t Index;
+    /*!
+     * Number of blocks held by the history
+     */
+    uint8_t NbBlocks;
+    /*!
+     * History slot of the next block
+     */
+    uint8_t Head;
+    /*!
+     * Sizes of the history blocks
+     */
+    uint8_t BlockSizes[LMHP_UPLINK_FEC_MAX_K];
+    /*!
+     * Blocks of the previous uplinks
+     */
+    uint8_t Blocks[LMHP_UPLINK_FEC_MAX_K][UPLINK_FEC_MAX_BLOCK_SIZE];
+    /*!
+     * Coded uplink. The application data buffer may hold the data to code.
+     */
+    uint8_t Frame[UPLINK_FEC_HEADER_SIZE + 2 * UPLINK_FEC_MAX_BLOCK_SIZE];
+}LmhpUplinkFecState_t;
+
+/*!
+ * Initializes the package with provided parameters
+ *
+ * \param [IN] params            Pointer to the package parameters
+ * \param [IN] dataBuffer        Pointer to main application buffer
+ * \param [IN] dataBufferMaxSize Main application buffer maximum size
+ */
+static void LmhpUplinkFecInit( void *params, uint8_t *dataBuffer, uint8_t dataBufferMaxSize );
+
+/*!
+ * Returns the current package initialization status.
+ *
+ * \retval status Package initialization status
+ *                [true: Initialized, false: Not initialized]
+ */
+static bool LmhpUplinkFecIsInitialized( void );
+
+/*!
+ * Returns the package operation status.
+ *
+ * \retval status Package operation status
+ *                [true: Running, false: Not running]
+ */
+static bool LmhpUplinkFecIsRunning( void );
+
+static LmhpUplinkFecState_t LmhpUplinkFecState =
+{
+    .Initialized = false,
+    .IsRunning = false,
+};
+
+static LmhPackage_t LmhpUplinkFecPackage =
+{
+    .Port = LMHP_UPLINK_FEC_PORT,
+    .Init = LmhpUplinkFecInit,
+    .IsInitialized = LmhpUplinkFecIsInitialized,
+    .IsRunning = LmhpUplinkFecIsRunning,
+    .Process = NULL,                                           // Not used in this package
+    .IsProcessPending = NULL,                                  // Not used in this package
+    .OnMcpsConfirmProcess = NULL,                              // Not used in this package
+    .OnMcpsIndicationProcess = NULL,                           // Not used in this package
+    .OnMlmeConfirmProcess = NULL,                              // Not used in this package
+    .OnMlmeIndicationProcess = NULL,                           // Not used in this package
+    .OnMacMcpsRequest = NULL,                                  // To be initialized by LmHandler
+    .OnMacMlmeRequest = NULL,                                  // To be initialized by LmHandler
+    .OnJoinRequest = NULL,                                     // To be initialized by LmHandler
+    .OnSendRequest = NULL,                                     // To be initialized by LmHandler
+    .OnDeviceTimeRequest = NULL,                               // To be initialized by LmHandler
+    .OnSysTimeUpdate = NULL,                                   // To be initialized by LmHandler
+};
+
+LmhPackage_t *LmhpUplinkFecPackageFactory( void )
+{
+    return &LmhpUplinkFecPackage;
+}
+
+static void LmhpUplinkFecInit( void *params, uint8_t *dataBuffer, uint8_t dataBufferMaxSize )
+{
+    LmhpUplinkFecParams_t *fecParams = ( LmhpUplinkFecParams_t* )params;
+
+    if( ( fecParams != NULL ) && ( fecParams->K <= LMHP_UPLINK_FEC_MAX_K ) )
+    {
+        LmhpUplinkFecState.K = fecParams->K;
+        LmhpUplinkFecState.Index = 0;
+        LmhpUplinkFecState.NbBlocks = 0;
+        LmhpUplinkFecState.Head = 0;
+        LmhpUplinkFecState.Initialized = true;
+        LmhpUplinkFecState.IsRunning = true;
+    }
+    else
+    {
+        LmhpUplinkFecState.IsRunning = false;
+        LmhpUplinkFecState.Initialized = false;
+    }
+}
+
+static bool LmhpUplinkFecIsInitialized( void )
+{
+    return LmhpUplinkFecState.Initialized;
+}
+
+static bool LmhpUplinkFecIsRunning( void )
+{
+    if( LmhpUplinkFecState.Initialized == false )
+    {
+        return false;
+    }
+
+    return LmhpUplinkFecState.IsRunning;
+}
+
+/*!
+ * \brief Gets a history block
+ *
+ * \param [IN] age Block age, 1 for the previous uplink
+ * \retval slot    History slot of the block
+ */
+static uint8_t LmhpUplinkFecGetSlot( uint8_t age )
+{
+    return ( LmhpUplinkFecState.Head + LMHP_UPLINK_FEC_MAX_K - age ) % LMHP_UPLINK_FEC_MAX_K;
+}
+
+/*!
+ * \brief Gets the parity size of the previous uplinks
+ *
+ * \param [IN] k Number of previous uplinks
+ * \retval size  Size of the longest block [bytes]
+ */
+static uint8_t LmhpUplinkFecGetParitySize( uint8_t k )
+{
+    uint8_t size = 0;
+
+    for( uint8_t age = 1; age <= k; age++ )
+    {
+        size = MAX( size, LmhpUplinkFecState.BlockSizes[LmhpUplinkFecGetSlot( age )] );
+    }
+    return size;
+}
+
+/*!
+ * \brief Gets the largest payload the current datarate can send
+ *
+ * \retval size Largest frame size [bytes]
+ */
+static uint8_t LmhpUplinkFecGetMaxSize( void )
+{
+    LoRaMacTxInfo_t txInfo;
+
+    if( LoRaMacQueryTxPossible( 0, &txInfo ) == LORAMAC_STATUS_OK )
+    {
+        // The pending MAC commands are sent along
+        return txInfo.MaxPossibleApplicationDataSize;
+    }
+    return txInfo.CurrentPossiblePayloadSize;
+}
+
+LmHandlerErrorStatus_t LmhpUplinkFecSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed )
+{
+    LmHandlerAppData_t codedData;
+    LoRaMacTxInfo_t txInfo;
+    uint8_t* frame = LmhpUplinkFecState.Frame;
+    uint8_t* block = &frame[UPLINK_FEC_HEADER_SIZE];
+    uint8_t blockSize = 2 + appData->BufferSize;
+    uint8_t maxSize = LmhpUplinkFecGetMaxSize( );
+    uint8_t k = MIN( LmhpUplinkFecState.K, LmhpUplinkFecState.NbBlocks );
+    uint8_t paritySize = LmhpUplinkFecGetParitySize( k );
+
+    if( ( LmhpUplinkFecState.IsRunning == false ) || ( appData->BufferSize > LMHP_UPLINK_FEC_MAX_PAYLOAD_SIZE ) )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    // The oldest uplinks are not covered when the parity doesn't fit
+    while( ( k > 0 ) && ( ( UPLINK_FEC_HEADER_SIZE + blockSize + paritySize ) > maxSize ) )
+    {
+        k--;
+        paritySize = LmhpUplinkFecGetParitySize( k );
+    }
+
+    frame[0] = LmhpUplinkFecState.Index;
+    frame[1] = k;
+    block[0] = appData->Port;
+    block[1] = appData->BufferSize;
+    memcpy1( &block[2], appData->Buffer, appData->BufferSize );
+
+    memset1( &block[blockSize], 0, paritySize );
+    for( uint8_t age = 1; age <= k; age++ )
+    {
+        uint8_t slot = LmhpUplinkFecGetSlot( age );
+
+        for( uint8_t i = 0; i < LmhpUplinkFecState.BlockSizes[slot]; i++ )
+        {
+            block[blockSize + i] ^= LmhpUplinkFecState.Blocks[slot][i];
+        }
+    }
+
+    codedData.Port = LMHP_UPLINK_FEC_PORT;
+    codedData.BufferSize = UPLINK_FEC_HEADER_SIZE + blockSize + paritySize;
+    codedData.Buffer = frame;
+
+    if( LoRaMacQueryTxPossible( codedData.BufferSize, &txInfo ) != LORAMAC_STATUS_OK )
+    {
+        // An empty frame flushes the MAC commands, the application sends the
+        // data again
+        LmhpUplinkFecPackage.OnSendRequest( &codedData, isTxConfirmed );
+        return LORAMAC_HANDLER_ERROR;
+    }
+    if( LmhpUplinkFecPackage.OnSendRequest( &codedData, isTxConfirmed ) != LORAMAC_HANDLER_SUCCESS )
+    {
+        return LORAMAC_HANDLER_ERROR;
+    }
+
+    // An uplink lost by the MAC is recovered as well
+    memcpy1( LmhpUplinkFecState.Blocks[LmhpUplinkFecState.Head], block, blockSize );
+    LmhpUplinkFecState.BlockSizes[LmhpUplinkFecState.Head] = blockSize;
+    LmhpUplinkFecState.Head = ( LmhpUplinkFecState.Head + 1 ) % LMHP_UPLINK_FEC_MAX_K;
+    LmhpUplinkFecState.NbBlocks = MIN( LmhpUplinkFecState.NbBlocks + 1, LMHP_UPLINK_FEC_MAX_K );
+    LmhpUplinkFecState.Index++;
+    return LORAMAC_HANDLER_SUCCESS;
+}
@@ -0,0 +1,97 @@
+/*!
+ * \file      LmhpUplinkFec.h
+ *
+ * \brief     Implements the uplink forward error correction package
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2018 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \remark    Every coded uplink carries the application data and the XOR
+ *            parity of the data of the previous uplinks, the network server
+ *            recovers an uplink lost amongst them. The frames are
+ *
+ *            | Index | K | Port | Size | Payload | Parity |
+ *            |   1   | 1 |  1   |  1   |  Size   |        |
+ *
+ *            Index counts the coded uplinks, modulo 256. The parity is the XOR
+ *            of the Port | Size | Payload blocks of the K previous uplinks,
+ *            padded with zeros to the longest one. K is lowered, down to 0,
+ *            while the frame doesn't fit in the maximum payload of the
+ *            datarate.
+ *
+ *            The parity costs less airtime than the unconfirmed uplinks
+ *            repetitions, the MAC NbTrans is best left at 1.
+ */
+#ifndef __LMHP_UPLINK_FEC_H__
+#define __LMHP_UPLINK_FEC_H__
+
+#include "LoRaMac.h"
+#include "LmHandlerTypes.h"
+#include "LmhPackage.h"
+
+/*!
+ * Uplink FEC package identifier.
+ *
+ * \remark This value must be unique amongst the packages
+ */
+#define PACKAGE_ID_UPLINK_FEC                       4
+
+/*!
+ * Port of the coded uplinks, below the LoRa-Alliance packages ports
+ */
+#ifndef LMHP_UPLINK_FEC_PORT
+#define LMHP_UPLINK_FEC_PORT                        199
+#endif
+
+/*!
+ * Largest number of previous uplinks covered by the parity
+ */
+#ifndef LMHP_UPLINK_FEC_MAX_K
+#define LMHP_UPLINK_FEC_MAX_K                       4
+#endif
+
+/*!
+ * Largest application payload of a coded uplink [bytes]
+ */
+#ifndef LMHP_UPLINK_FEC_MAX_PAYLOAD_SIZE
+#define LMHP_UPLINK_FEC_MAX_PAYLOAD_SIZE            62
+#endif
+
+/*!
+ * Uplink FEC package parameters
+ */
+typedef struct LmhpUplinkFecParams_s
+{
+    /*!
+     * Number of previous uplinks covered by the parity, up to
+     * \ref LMHP_UPLINK_FEC_MAX_K
+     */
+    uint8_t K;
+}LmhpUplinkFecParams_t;
+
+LmhPackage_t *LmhpUplinkFecPackageFactory( void );
+
+/*!
+ * \brief Sends a coded uplink
+ *
+ * \param [IN] appData       Data to be sent
+ * \param [IN] isTxConfirmed Indicates if the uplink requires an acknowledgement
+ *
+ * \retval status Returns \ref LORAMAC_HANDLER_SUCCESS if the uplink is sent
+ *                else \ref LORAMAC_HANDLER_ERROR
+ */
+LmHandlerErrorStatus_t LmhpUplinkFecSend( LmHandlerAppData_t *appData, LmHandlerMsgTypes_t isTxConfirmed );
+
+#endif // __LMHP_UPLINK_FEC_H__
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+##
+##   ______                              _
+##  / _____)             _              | |
+## ( (____  _____ ____ _| |_ _____  ____| |__
+##  \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+##  _____) ) ____| | | || |_| ____( (___| | | |
+## (______/|_____)_|_|_| \__)_____)\____)_| |_|
+## (C)2013-2019 Semtech
+##
+## License:  Revised BSD License, see LICENSE.TXT file included in the project
+## Authors:  Miguel Luis (Semtech)
+##
+## Decodes the samples batches of LmHandler.c (LMHANDLER_BATCH_ENABLED).
+##
+## | NbValues | Age | Sample 0 | ... | Sample N |
+## |    1     |  2  |                          |
+##
+## Age is the time elapsed since the last sample [s], little endian. A sample
+## is the time elapsed since the previous sample [s] followed by the NbValues
+## differences to the previous sample values. The fields are LEB128 varints,
+## the differences are zigzag encoded and wrap around 32 bits.
+##
+## Usage: LmHandlerBatchDecode.py <hex payload> [reception UNIX time]
+##
+import struct
+import sys
+import time
+
+
+def varint(payload, offset):
+    value = 0
+    shift = 0
+    while True:
+        byte = payload[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, offset
+
+
+def zigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def signed32(value):
+    value &= 0xFFFFFFFF
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def decode(payload, rx_time):
+    """Returns the (time, values) samples of a batch, oldest first"""
+    nb_values = payload[0]
+    age, = struct.unpack('<H', payload[1:3])
+    samples = []
+    offset = 3
+    elapsed = 0
+    values = [0] * nb_values
+    while offset < len(payload):
+        delta, offset = varint(payload, offset)
+        elapsed += delta
+        for i in range(nb_values):
+            diff, offset = varint(payload, offset)
+            values[i] = signed32(values[i] + zigzag(diff))
+        samples.append((elapsed, list(values)))
+    # The sample times are known relative to the last one
+    last = rx_time - age
+    return [(last - elapsed + t, v) for t, v in samples]
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit('Usage: %s <hex payload> [reception UNIX time]' % sys.argv[0])
+    rx_time = int(sys.argv[2]) if len(sys.argv) > 2 else int(time.time())
+    try:
+        samples = decode(bytes.fromhex(sys.argv[1]), rx_time)
+    except (IndexError, ValueError, struct.error):
+        sys.exit('Invalid batch %s' % sys.argv[1])
+    for sample_time, values in samples:
+        print('%s %s' % (time.strftime('%Y-%m-%d %H:%M:%S', time.gmtime(sample_time)),
+                         ' '.join('%d' % v for v in values)))
+
+
+if __name__ == '__main__':
+    main()
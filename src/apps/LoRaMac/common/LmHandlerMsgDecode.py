@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+##
+##   ______                              _
+##  / _____)             _              | |
+## ( (____  _____ ____ _| |_ _____  ____| |__
+##  \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+##  _____) ) ____| | | || |_| ____( (___| | | |
+## (______/|_____)_|_|_| \__)_____)\____)_| |_|
+## (C)2013-2019 Semtech
+##
+## License:  Revised BSD License, see LICENSE.TXT file included in the project
+## Authors:  Miguel Luis (Semtech)
+##
+## Decodes the binary log records of LmHandlerMsgDisplay.c (BINLOG_ENABLED) and
+## the radio events trace records of LoRaMac.c (RADIO_TRACE_ENABLED).
+##
+## Usage: LmHandlerMsgDecode.py <capture file | serial device> [baudrate]
+##
+import struct
+import sys
+
+SYNC = 0xA5
+HEADER = struct.Struct('<BBBI')
+
+MAC_STATUS = ['OK', 'Busy', 'Service unknown', 'Parameter invalid', 'Frequency invalid', 'Datarate invalid',
+              'Frequency or datarate invalid', 'No network joined', 'Length error', 'Region not supported',
+              'Skipped APP data', 'Duty-cycle restricted', 'No channel found', 'No free channel found',
+              'Busy beacon reserved time', 'Busy ping-slot window time', 'Busy uplink collision', 'Crypto error',
+              'FCnt handler error', 'MAC command error', 'ClassB error', 'Confirm queue error',
+              'Multicast group undefined', 'Unknown error']
+EVENT_STATUS = ['OK', 'Error', 'Tx timeout', 'Rx 1 timeout', 'Rx 2 timeout', 'Rx1 error', 'Rx2 error', 'Join failed',
+                'Downlink repeated', 'Tx DR payload size error', 'Downlink too many frames loss', 'Address fail',
+                'MIC fail', 'Multicast fail', 'Beacon locked', 'Beacon lost', 'Beacon not found', 'Tx channel busy']
+TRACE_PROBES = ['Radio RxDone', 'Crypto unsecure', 'Region next channel', 'Timer IRQ', 'Frag decoder process',
+                'MAC init', 'MAC init radio', 'NVM context restore', 'Radio IRQ']
+MCPS_TYPES = ['MCPS_UNCONFIRMED', 'MCPS_CONFIRMED', 'MCPS_MULTICAST', 'MCPS_PROPRIETARY']
+RX_SLOTS = ['1', '2', 'C', 'C Multicast', 'B Ping-Slot', 'B Multicast Ping-Slot']
+BEACON_STATES = ['ACQUIRING', 'LOST', 'RX', 'NRX']
+MAC_TIMERS = ['RX1', 'RX2', 'ACK_TIMEOUT', 'TX_DELAYED']
+TRACE_SLOT_BEACON = 0x80
+
+
+def name(table, index):
+    return table[index] if index < len(table) else str(index)
+
+
+def version(value):
+    return '%d.%d.%d' % ((value >> 24) & 0xFF, (value >> 16) & 0xFF, (value >> 8) & 0xFF)
+
+
+def dropped(p):
+    return 'DROPPED     : %d records' % struct.unpack('<H', p)
+
+
+def nvm_context(p):
+    return 'CTXS %s' % ('RESTORED' if p[0] == 0 else 'STORED')
+
+
+def network_parameters(p):
+    return 'DevEui %s JoinEui %s' % (p[0:8].hex('-').upper(), p[8:16].hex('-').upper())
+
+
+def mcps_request(p):
+    return 'MCPS-Request %s STATUS %s' % (name(MCPS_TYPES, p[0]), name(MAC_STATUS, p[1]))
+
+
+def mlme_request(p):
+    return 'MLME-Request %d STATUS %s' % (p[0], name(MAC_STATUS, p[1]))
+
+
+def join(p):
+    status, otaa, dev_addr, dr = struct.unpack('<BBIb', p)
+    return 'JOIN %s %s DevAddr %08X DR_%d' % ('OK' if status == 0 else 'FAIL', 'OTAA' if otaa else 'ABP', dev_addr, dr)
+
+
+def tx(p):
+    text = '%s STATUS %s' % ('MCPS-Confirm' if p[0] else 'MLME-Confirm', name(EVENT_STATUS, p[1]))
+    if p[0]:
+        counter, cls, port, msg_type, ack, size, dr, power, freq = struct.unpack('<IBBBBBbbI', p[2:17])
+        text += ' UPLINK %d CLASS %s PORT %d %s SIZE %d DR_%d POWER %d FREQ %d' % (
+            counter, 'ABC'[cls], port, ('CONFIRMED - ' + ('ACK' if ack else 'NACK')) if msg_type else 'UNCONFIRMED',
+            size, dr, power, freq)
+        if len(p) >= 19:
+            text += ' MASK %04X' % struct.unpack('<H', p[17:19])
+    return text
+
+
+def rx(p):
+    text = '%s STATUS %s' % ('MCPS-Indication' if p[0] else 'MLME-Indication', name(EVENT_STATUS, p[1]))
+    if p[0]:
+        counter, slot, port, size, dr, rssi, snr = struct.unpack('<IbBBbbb', p[2:12])
+        text += ' DOWNLINK %d WINDOW %s PORT %d SIZE %d DR_%d RSSI %d SNR %d' % (
+            counter, name(RX_SLOTS, slot), port, size, dr, rssi, snr)
+    return text
+
+
+def trace(p):
+    probe, start, duration = struct.unpack('<BII', p)
+    return 'TRACE %-20s  %10d  %11d' % (name(TRACE_PROBES, probe), start, duration)
+
+
+def beacon(p):
+    state, seconds, freq, dr, rssi, snr = struct.unpack('<BIIBhb', p)
+    return 'BEACON %s %d FREQ %d DR_%d RSSI %d SNR %d' % (name(BEACON_STATES, state), seconds, freq, dr, rssi, snr)
+
+
+def device_class(p):
+    return 'Switch to Class %s done' % 'ABC'[p[0]]
+
+
+def app_info(p):
+    app, github = struct.unpack('<II', p[0:8])
+    return 'Application %s %s, GitHub base %s' % (p[8:].decode('ascii', 'replace'), version(app), version(github))
+
+
+def radio_tx(p):
+    digest, size, mhdr, port, payload_size, channel, dr, power, toa = struct.unpack('<IBBBBBbbH', p)
+    return 'RADIO TX SIZE %d MHDR %02X PORT %d PAYLOAD %d CH %d DR_%d POWER %d TOA %d DIGEST %08X' % (
+        size, mhdr, port, payload_size, channel, dr, power, toa, digest)
+
+
+def radio_tx_done(p):
+    return 'RADIO TX DONE LATENCY %d' % struct.unpack('<H', p)
+
+
+def radio_rx_window(p):
+    slot = 'BEACON' if p[0] == TRACE_SLOT_BEACON else name(RX_SLOTS, p[0])
+    return 'RADIO RX WINDOW %s DR_%d' % (slot, struct.unpack('<b', p[1:2])[0])
+
+
+def radio_rx_done(p):
+    latency, rssi, snr = struct.unpack('<Hhb', p[0:5])
+    return 'RADIO RX DONE LATENCY %d RSSI %d SNR %d %s' % (latency, rssi, snr, p[5:].hex().upper())
+
+
+def timer(p):
+    timer_id, delay = struct.unpack('<BI', p)
+    return 'TIMER %s %d us' % (name(MAC_TIMERS, timer_id), delay)
+
+
+# Indexed by the DisplayLogId_t values
+DECODERS = [dropped, nvm_context, network_parameters, mcps_request, mlme_request, join, tx, rx, trace, beacon,
+            device_class, app_info]
+
+# Indexed by the LORAMAC_TRACE_ID values
+RADIO_TRACE_ID = 0x40
+RADIO_DECODERS = [radio_tx, radio_tx_done, lambda p: 'RADIO TX TIMEOUT', radio_rx_window, radio_rx_done,
+                  lambda p: 'RADIO RX TIMEOUT', lambda p: 'RADIO RX ERROR', timer]
+
+
+def records(stream):
+    buffer = b''
+    while True:
+        data = stream.read(1)
+        if not data:
+            return
+        buffer += data
+        # Resynchronizes on the sync byte after a lost byte
+        while buffer and buffer[0] != SYNC:
+            buffer = buffer[1:]
+        if len(buffer) < HEADER.size:
+            continue
+        _, record_id, size, time = HEADER.unpack(buffer[:HEADER.size])
+        if len(buffer) < HEADER.size + size:
+            continue
+        yield time, record_id, buffer[HEADER.size:HEADER.size + size]
+        buffer = buffer[HEADER.size + size:]
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit('Usage: %s <capture file | serial device> [baudrate]' % sys.argv[0])
+    if len(sys.argv) > 2:
+        import serial
+        stream = serial.Serial(sys.argv[1], int(sys.argv[2]))
+    else:
+        stream = open(sys.argv[1], 'rb')
+    for time, record_id, payload in records(stream):
+        try:
+            if record_id >= RADIO_TRACE_ID:
+                text = RADIO_DECODERS[record_id - RADIO_TRACE_ID](payload)
+            else:
+                text = DECODERS[record_id](payload)
+        except (IndexError, struct.error):
+            text = 'UNKNOWN %d : %s' % (record_id, payload.hex().upper())
+        print('%10d.%03d %s' % (time // 1000, time % 1000, text))
+
+
+if __name__ == '__main__':
+    main()
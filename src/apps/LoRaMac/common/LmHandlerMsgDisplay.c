@@ -25,6 +25,8 @@
 #include <stdio.h>
 #include "utilities.h"
 #include "timer.h"
+#include "trace.h"
+#include "binlog.h"
 
 #include "LmHandlerMsgDisplay.h"
 
@@ -80,9 +82,66 @@ const char* EventInfoStatusStrings[] =
     "Multicast fail",                // LORAMAC_EVENT_INFO_STATUS_MULTICAST_FAIL
     "Beacon locked",                 // LORAMAC_EVENT_INFO_STATUS_BEACON_LOCKED
     "Beacon lost",                   // LORAMAC_EVENT_INFO_STATUS_BEACON_LOST
-    "Beacon not found"               // LORAMAC_EVENT_INFO_STATUS_BEACON_NOT_FOUND
+    "Beacon not found",              // LORAMAC_EVENT_INFO_STATUS_BEACON_NOT_FOUND
+    "Tx channel busy"                // LORAMAC_EVENT_INFO_STATUS_TX_CHANNEL_BUSY
 };
 
+#ifdef TRACE_ENABLED
+/*!
+ * Trace probe strings
+ */
+const char* TraceProbeStrings[] =
+{
+    "Radio RxDone",                  // TRACE_PROBE_RADIO_RX_DONE
+    "Crypto unsecure",               // TRACE_PROBE_CRYPTO_UNSECURE
+    "Region next channel",           // TRACE_PROBE_REGION_NEXT_CHANNEL
+    "Timer IRQ",                     // TRACE_PROBE_TIMER_IRQ
+    "Frag decoder process",          // TRACE_PROBE_FRAG_DECODER_PROCESS
+    "MAC init",                      // TRACE_PROBE_MAC_INIT
+    "MAC init radio",                // TRACE_PROBE_MAC_INIT_RADIO
+    "NVM context restore",           // TRACE_PROBE_NVM_CTX_RESTORE
+    "Radio IRQ"                      // TRACE_PROBE_RADIO_IRQ
+};
+#endif
+
+#ifdef BINLOG_ENABLED
+/*!
+ * Binary log records identifiers. The payloads are described in
+ * LmHandlerMsgDecode.py, which decodes the records on the host.
+ */
+typedef enum eDisplayLogId
+{
+    DISPLAY_LOG_NVM_CONTEXT = 1,
+    DISPLAY_LOG_NETWORK_PARAMETERS,
+    DISPLAY_LOG_MCPS_REQUEST,
+    DISPLAY_LOG_MLME_REQUEST,
+    DISPLAY_LOG_JOIN,
+    DISPLAY_LOG_TX,
+    DISPLAY_LOG_RX,
+    DISPLAY_LOG_TRACE,
+    DISPLAY_LOG_BEACON,
+    DISPLAY_LOG_CLASS,
+    DISPLAY_LOG_APP_INFO,
+}DisplayLogId_t;
+
+/*!
+ * \brief Stores a 32 bits field little endian
+ *
+ * \param [OUT] buffer Field start
+ * \param [IN]  value  Field value
+ *
+ * \retval size        Field size
+ */
+static uint8_t DisplayLogPut32( uint8_t *buffer, uint32_t value )
+{
+    buffer[0] = ( uint8_t )( value >> 0 );
+    buffer[1] = ( uint8_t )( value >> 8 );
+    buffer[2] = ( uint8_t )( value >> 16 );
+    buffer[3] = ( uint8_t )( value >> 24 );
+    return 4;
+}
+#endif
+
 /*!
  * Prints the provided buffer in HEX
  * 
@@ -113,6 +172,12 @@ void PrintHexBuffer( uint8_t *buffer, uint8_t size )
 
 void DisplayNvmContextChange( LmHandlerNvmContextStates_t state )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record = ( uint8_t )state;
+
+    BinLogWrite( DISPLAY_LOG_NVM_CONTEXT, &record, 1 );
+    return;
+#endif
     if( state == LORAMAC_HANDLER_NVM_STORE )
     {
         printf( "\r\n###### ============ CTXS STORED ============ ######\r\n\r\n" );
@@ -125,6 +190,15 @@ void DisplayNvmContextChange( LmHandlerNvmContextStates_t state )
 
 void DisplayNetworkParametersUpdate( CommissioningParams_t *commissioningParams )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record[16];
+
+    // The keys are not logged
+    memcpy1( record, commissioningParams->DevEui, 8 );
+    memcpy1( record + 8, commissioningParams->JoinEui, 8 );
+    BinLogWrite( DISPLAY_LOG_NETWORK_PARAMETERS, record, sizeof( record ) );
+    return;
+#endif
     printf( "DevEui      : %02X", commissioningParams->DevEui[0] );
     for( int i = 1; i < 8; i++ )
     {
@@ -148,6 +222,12 @@ void DisplayNetworkParametersUpdate( CommissioningParams_t *commissioningParams
 
 void DisplayMacMcpsRequestUpdate( LoRaMacStatus_t status, McpsReq_t *mcpsReq )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record[2] = { ( uint8_t )mcpsReq->Type, ( uint8_t )status };
+
+    BinLogWrite( DISPLAY_LOG_MCPS_REQUEST, record, sizeof( record ) );
+    return;
+#endif
     switch( mcpsReq->Type )
     {
         case MCPS_CONFIRMED:
@@ -184,6 +264,12 @@ void DisplayMacMcpsRequestUpdate( LoRaMacStatus_t status, McpsReq_t *mcpsReq )
 
 void DisplayMacMlmeRequestUpdate( LoRaMacStatus_t status, MlmeReq_t *mlmeReq )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record[2] = { ( uint8_t )mlmeReq->Type, ( uint8_t )status };
+
+    BinLogWrite( DISPLAY_LOG_MLME_REQUEST, record, sizeof( record ) );
+    return;
+#endif
     switch( mlmeReq->Type )
     {
         case MLME_JOIN:
@@ -234,6 +320,16 @@ void DisplayMacMlmeRequestUpdate( LoRaMacStatus_t status, MlmeReq_t *mlmeReq )
 
 void DisplayJoinRequestUpdate( LmHandlerJoinParams_t *params )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record[7];
+
+    record[0] = ( uint8_t )params->Status;
+    record[1] = ( params->CommissioningParams->IsOtaaActivation == true ) ? 1 : 0;
+    DisplayLogPut32( &record[2], params->CommissioningParams->DevAddr );
+    record[6] = ( uint8_t )params->Datarate;
+    BinLogWrite( DISPLAY_LOG_JOIN, record, sizeof( record ) );
+    return;
+#endif
     if( params->CommissioningParams->IsOtaaActivation == true )
     {
         if( params->Status == LORAMAC_HANDLER_SUCCESS )
@@ -271,6 +367,44 @@ void DisplayTxUpdate( LmHandlerTxParams_t *params )
 {
     MibRequestConfirm_t mibGet;
 
+#ifdef BINLOG_ENABLED
+    uint8_t record[19];
+    uint8_t size = 0;
+
+    record[size++] = params->IsMcpsConfirm;
+    record[size++] = ( uint8_t )params->Status;
+    if( params->IsMcpsConfirm != 0 )
+    {
+        size += DisplayLogPut32( &record[size], params->UplinkCounter );
+        record[size++] = ( uint8_t )LmHandlerGetCurrentClass( );
+        record[size++] = params->AppData.Port;
+        record[size++] = ( uint8_t )params->MsgType;
+        record[size++] = params->AckReceived;
+        record[size++] = params->AppData.BufferSize;
+        record[size++] = ( uint8_t )params->Datarate;
+        record[size++] = ( uint8_t )params->TxPower;
+        mibGet.Type  = MIB_CHANNELS;
+        if( LoRaMacMibGetRequestConfirm( &mibGet ) == LORAMAC_STATUS_OK )
+        {
+            size += DisplayLogPut32( &record[size], mibGet.Param.ChannelList[params->Channel].Frequency );
+        }
+        else
+        {
+            size += DisplayLogPut32( &record[size], 0 );
+        }
+        mibGet.Type  = MIB_CHANNELS_MASK;
+        if( LoRaMacMibGetRequestConfirm( &mibGet ) == LORAMAC_STATUS_OK )
+        {
+            // First channels mask block, the one of the regions up to 16 channels
+            record[size++] = ( uint8_t )( mibGet.Param.ChannelsMask[0] >> 0 );
+            record[size++] = ( uint8_t )( mibGet.Param.ChannelsMask[0] >> 8 );
+        }
+    }
+    BinLogWrite( DISPLAY_LOG_TX, record, size );
+    DisplayTraceUpdate( );
+    return;
+#endif
+
     if( params->IsMcpsConfirm == 0 )
     {
         printf( "\r\n###### =========== MLME-Confirm ============ ######\r\n" );
@@ -350,12 +484,34 @@ void DisplayTxUpdate( LmHandlerTxParams_t *params )
     }
 
     printf( "\r\n" );
+
+    DisplayTraceUpdate( );
 }
 
 void DisplayRxUpdate( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params )
 {
     const char *slotStrings[] = { "1", "2", "C", "C Multicast", "B Ping-Slot", "B Multicast Ping-Slot" };
 
+#ifdef BINLOG_ENABLED
+    uint8_t record[12];
+    uint8_t size = 0;
+
+    record[size++] = params->IsMcpsIndication;
+    record[size++] = ( uint8_t )params->Status;
+    if( params->IsMcpsIndication != 0 )
+    {
+        size += DisplayLogPut32( &record[size], params->DownlinkCounter );
+        record[size++] = ( uint8_t )params->RxSlot;
+        record[size++] = appData->Port;
+        record[size++] = appData->BufferSize;
+        record[size++] = ( uint8_t )params->Datarate;
+        record[size++] = ( uint8_t )params->Rssi;
+        record[size++] = ( uint8_t )params->Snr;
+    }
+    BinLogWrite( DISPLAY_LOG_RX, record, size );
+    return;
+#endif
+
     if( params->IsMcpsIndication == 0 )
     {
         printf( "\r\n###### ========== MLME-Indication ========== ######\r\n" );
@@ -386,8 +542,55 @@ void DisplayRxUpdate( LmHandlerAppData_t *appData, LmHandlerRxParams_t *params )
     printf( "\r\n" );
 }
 
+void DisplayTraceUpdate( void )
+{
+#ifdef TRACE_ENABLED
+    TraceRecord_t records[TRACE_RING_SIZE];
+    uint8_t nbRecords = TraceGetRecords( records, TRACE_RING_SIZE );
+
+    if( nbRecords == 0 )
+    {
+        return;
+    }
+
+#ifdef BINLOG_ENABLED
+    for( uint8_t i = 0; i < nbRecords; i++ )
+    {
+        uint8_t record[9];
+
+        record[0] = ( uint8_t )records[i].Id;
+        DisplayLogPut32( &record[1], records[i].Start );
+        DisplayLogPut32( &record[5], records[i].Duration );
+        BinLogWrite( DISPLAY_LOG_TRACE, record, sizeof( record ) );
+    }
+    return;
+#endif
+    printf( "\r\n###### ============ TRACE RECORDS ============ ######\r\n" );
+    printf( "PROBE                     START       CYCLES\r\n" );
+    for( uint8_t i = 0; i < nbRecords; i++ )
+    {
+        printf( "%-20s  %10lu  %11lu\r\n", TraceProbeStrings[records[i].Id],
+                ( unsigned long )records[i].Start, ( unsigned long )records[i].Duration );
+    }
+    printf( "\r\n" );
+#endif
+}
+
 void DisplayBeaconUpdate( LoRaMAcHandlerBeaconParams_t *params )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record[13];
+
+    record[0] = ( uint8_t )params->State;
+    DisplayLogPut32( &record[1], params->Info.Time.Seconds );
+    DisplayLogPut32( &record[5], params->Info.Frequency );
+    record[9] = params->Info.Datarate;
+    record[10] = ( uint8_t )( params->Info.Rssi >> 0 );
+    record[11] = ( uint8_t )( params->Info.Rssi >> 8 );
+    record[12] = ( uint8_t )params->Info.Snr;
+    BinLogWrite( DISPLAY_LOG_BEACON, record, sizeof( record ) );
+    return;
+#endif
     switch( params->State )
     {
         default:
@@ -425,11 +628,31 @@ void DisplayBeaconUpdate( LoRaMAcHandlerBeaconParams_t *params )
 
 void DisplayClassUpdate( DeviceClass_t deviceClass )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record = ( uint8_t )deviceClass;
+
+    BinLogWrite( DISPLAY_LOG_CLASS, &record, 1 );
+    return;
+#endif
     printf( "\r\n\r\n###### ===== Switch to Class %c done.  ===== ######\r\n\r\n", "ABC"[deviceClass] );
 }
 
 void DisplayAppInfo( const char* appName, const Version_t* appVersion, const Version_t* gitHubVersion )
 {
+#ifdef BINLOG_ENABLED
+    uint8_t record[24];
+    uint8_t size = 0;
+
+    size += DisplayLogPut32( &record[size], appVersion->Value );
+    size += DisplayLogPut32( &record[size], gitHubVersion->Value );
+    // Name truncated to the record end
+    while( ( size < sizeof( record ) ) && ( *appName != '\0' ) )
+    {
+        record[size++] = ( uint8_t )*appName++;
+    }
+    BinLogWrite( DISPLAY_LOG_APP_INFO, record, size );
+    return;
+#endif
     printf( "\r\n###### ===================================== ######\r\n\r\n" );
     printf( "Application name   : %s\r\n", appName );
     printf( "Application version: %d.%d.%d\r\n", appVersion->Fields.Major, appVersion->Fields.Minor, appVersion->Fields.Revision );
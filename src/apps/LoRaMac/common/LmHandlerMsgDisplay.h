@@ -78,6 +78,14 @@ void DisplayTxUpdate( LmHandlerTxParams_t* params );
  */
 void DisplayRxUpdate( LmHandlerAppData_t* appData, LmHandlerRxParams_t* params );
 
+/*!
+ * \brief Displays and clears the trace records
+ *
+ * \remark Only active when TRACE_ENABLED is defined. Called by
+ *         \ref DisplayTxUpdate at each uplink.
+ */
+void DisplayTraceUpdate( void );
+
 /*!
  * \brief Displays beacon status update
  *
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+##
+##   ______                              _
+##  / _____)             _              | |
+## ( (____  _____ ____ _| |_ _____  ____| |__
+##  \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+##  _____) ) ____| | | || |_| ____( (___| | | |
+## (______/|_____)_|_|_| \__)_____)\____)_| |_|
+## (C)2013-2019 Semtech
+##
+## License:  Revised BSD License, see LICENSE.TXT file included in the project
+## Authors:  Miguel Luis (Semtech)
+##
+## Decodes the coded uplinks of LmhpUplinkFec.c and recovers the lost ones.
+##
+## | Index | K | Port | Size | Payload | Parity |
+## |   1   | 1 |  1   |  1   |  Size   |        |
+##
+## The parity is the XOR of the Port | Size | Payload blocks of the K previous
+## uplinks, padded with zeros to the longest one.
+##
+## Usage: LmhpUplinkFecDecode.py <hex frame> [<hex frame> ...]
+##
+import sys
+
+
+def decode(frames):
+    """Returns the {index: (port, payload)} uplinks, received or recovered"""
+    blocks = {}
+    parities = []
+    for frame in frames:
+        index, k, port, size = frame[0], frame[1], frame[2], frame[3]
+        # Unwraps the 8 bits index, the frames are given in reception order
+        if blocks or parities:
+            last = max(list(blocks) + [p[0] for p in parities])
+            index = last + ((index - last) & 0xFF)
+        blocks[index] = frame[2:4 + size]
+        if k > 0:
+            parities.append((index, k, frame[4 + size:]))
+    recovered = True
+    while recovered:
+        recovered = False
+        for index, k, parity in parities:
+            lost = [i for i in range(index - k, index) if i not in blocks and i >= 0]
+            if len(lost) != 1:
+                continue
+            block = bytearray(parity)
+            for i in range(index - k, index):
+                for j, byte in enumerate(blocks.get(i, b'')):
+                    block[j] ^= byte
+            blocks[lost[0]] = bytes(block[:2 + block[1]])
+            recovered = True
+    return {i: (b[0], b[2:]) for i, b in sorted(blocks.items())}
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit('Usage: %s <hex frame> [<hex frame> ...]' % sys.argv[0])
+    try:
+        uplinks = decode([bytes.fromhex(frame) for frame in sys.argv[1:]])
+    except (IndexError, ValueError):
+        sys.exit('Invalid frames')
+    for index, (port, payload) in uplinks.items():
+        print('%5d PORT %3d %s' % (index, port, payload.hex().upper()))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,580 @@
+/*!
+ * \file      MacBenchmark.c
+ *
+ * \brief     Measures the processing cost of the LoRaMac hot paths
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdio.h>
+#include "utilities.h"
+#include "board.h"
+#include "timer.h"
+#include "LoRaMac.h"
+#include "LoRaMacTest.h"
+#include "LoRaMacCommands.h"
+#include "LoRaMacCrypto.h"
+#include "LoRaMacParser.h"
+#include "LoRaMacSerializer.h"
+#include "secure-element.h"
+#include "region/Region.h"
+#include "FragDecoder.h"
+#include "MacBenchmark.h"
+
+/*!
+ * Number of runs of each operation
+ */
+#define MAC_BENCHMARK_NB_OPS                        64
+
+/*!
+ * Size of the stack window painted below the caller stack [bytes]
+ *
+ * \remark A larger usage is displayed as saturated. The window has to fit in
+ *         the free RAM below the stack.
+ */
+#ifndef MAC_BENCHMARK_STACK_PAINT_SIZE
+#define MAC_BENCHMARK_STACK_PAINT_SIZE              2048
+#endif
+
+/*!
+ * Unpainted space left below the painting function local variables [bytes]
+ */
+#define MAC_BENCHMARK_STACK_PAINT_MARGIN            32
+
+/*!
+ * Stack painting pattern
+ */
+#define MAC_BENCHMARK_STACK_PAINT_PATTERN           0xA5
+
+/*!
+ * Device address of the benchmark frames
+ */
+#define MAC_BENCHMARK_DEV_ADDR                      0x26011F7A
+
+/*!
+ * Application payload size of the benchmark frames
+ */
+#define MAC_BENCHMARK_PAYLOAD_SIZE                  32
+
+/*!
+ * Number of timers of the timer list operations
+ */
+#define MAC_BENCHMARK_NB_TIMERS                     8
+
+/*!
+ * Shortest timeout of the timer list operations, never reached [ms]
+ */
+#define MAC_BENCHMARK_TIMER_TIMEOUT                 60000
+
+/*!
+ * Benchmark operation
+ */
+typedef struct sMacBenchmarkOp
+{
+    /*!
+     * Operation name
+     */
+    const char* Name;
+    /*!
+     * Prepares the run n of the operation, not measured. May be NULL
+     */
+    void ( *Prepare )( uint16_t n );
+    /*!
+     * Runs the operation a single time
+     *
+     * \retval status true if the operation succeeded
+     */
+    bool ( *Run )( uint16_t n );
+}MacBenchmarkOp_t;
+
+/*!
+ * Session key of all the network and application session keys
+ */
+static uint8_t MacBenchmarkKey[16] =
+{
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+/*!
+ * Received MAC commands, as sent by a network server after a join
+ */
+static uint8_t MacCommands[] =
+{
+    SRV_MAC_LINK_ADR_REQ, 0x50, 0x07, 0x00, 0x01,       // DR5, max power, channels 0..2
+    SRV_MAC_RX_PARAM_SETUP_REQ, 0x00, 0x52, 0xAD, 0x84, // Rx2 869.525 MHz, DR0
+    SRV_MAC_DEV_STATUS_REQ,
+    SRV_MAC_NEW_CHANNEL_REQ, 0x03, 0x18, 0x4F, 0x84, 0x50, // Channel 3 867.1 MHz, DR0..DR5
+    SRV_MAC_DUTY_CYCLE_REQ, 0x00,
+    SRV_MAC_RX_TIMING_SETUP_REQ, 0x01,
+};
+
+/*!
+ * Frame buffer of the crypto, parser and serializer operations
+ */
+static uint8_t FrameBuffer[64];
+
+/*!
+ * Frame payload
+ */
+static uint8_t Payload[MAC_BENCHMARK_PAYLOAD_SIZE];
+
+/*!
+ * Frame of the crypto, parser and serializer operations
+ */
+static LoRaMacMessageData_t MacMsg;
+
+/*!
+ * Uplink and downlink frame counters
+ */
+static uint32_t FCntUp = 0;
+static uint32_t FCntDown = 0;
+
+/*!
+ * Region of the RegionNextChannel operation
+ */
+static LoRaMacRegion_t NextChanRegion;
+
+/*!
+ * RegionNextChannel operation parameters
+ */
+static NextChanParams_t NextChanParams;
+
+/*!
+ * File rebuilt by the fragmentation decoder
+ */
+static uint8_t FragFile[FRAG_MAX_NB * FRAG_MAX_SIZE];
+
+/*!
+ * Fragmentation decoder session
+ */
+static FragDecoder_t FragDecoder;
+
+/*!
+ * Fragment processed by the fragmentation decoder
+ */
+static uint8_t Fragment[FRAG_MAX_SIZE];
+
+/*!
+ * Counter of the fragment processed by the fragmentation decoder
+ */
+static uint16_t FragCounter;
+
+/*!
+ * Timers of the timer list operations
+ */
+static TimerEvent_t Timers[MAC_BENCHMARK_NB_TIMERS];
+
+/*!
+ * Lowest address of the painted stack window
+ */
+static uintptr_t StackPaintBottom;
+
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+static uint8_t FragDecoderWrite( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    memcpy1( &FragFile[addr], data, size );
+    return 0; // Success
+}
+
+static uint8_t FragDecoderRead( uint32_t addr, uint8_t *data, uint32_t size )
+{
+    memcpy1( data, &FragFile[addr], size );
+    return 0; // Success
+}
+
+static FragDecoderCallbacks_t FragDecoderCallbacks =
+{
+    .FragDecoderWrite = FragDecoderWrite,
+    .FragDecoderRead = FragDecoderRead,
+};
+#endif
+
+/*!
+ * \brief Paints the stack window below the current stack pointer
+ *
+ * \remark Not inlined in order to paint below its own frame
+ */
+__attribute__( ( noinline ) ) static void StackPaint( void )
+{
+    volatile uint8_t marker = 0;
+    uintptr_t top = ( uintptr_t )&marker - MAC_BENCHMARK_STACK_PAINT_MARGIN;
+
+    StackPaintBottom = top - MAC_BENCHMARK_STACK_PAINT_SIZE;
+    for( uintptr_t addr = StackPaintBottom; addr < top; addr++ )
+    {
+        *( volatile uint8_t* )addr = MAC_BENCHMARK_STACK_PAINT_PATTERN;
+    }
+}
+
+/*!
+ * \brief Gets the stack used below the given reference since StackPaint
+ *
+ * \param [IN]  ref       Stack reference address
+ * \param [OUT] saturated Set to true when the whole painted window is used
+ * \retval usage          Used stack [bytes]
+ */
+static uint32_t StackUsage( uintptr_t ref, bool* saturated )
+{
+    uintptr_t addr = StackPaintBottom;
+
+    while( ( addr < ref ) && ( *( volatile uint8_t* )addr == MAC_BENCHMARK_STACK_PAINT_PATTERN ) )
+    {
+        addr++;
+    }
+    *saturated = ( addr == StackPaintBottom );
+    return ( uint32_t )( ref - addr );
+}
+
+/*!
+ * \brief Builds a data frame carrying the application payload
+ *
+ * \param [IN] mType Frame type
+ * \param [IN] fCnt  Frame counter
+ */
+static void BuildDataFrame( LoRaMacFrameType_t mType, uint32_t fCnt )
+{
+    for( uint8_t i = 0; i < MAC_BENCHMARK_PAYLOAD_SIZE; i++ )
+    {
+        Payload[i] = i;
+    }
+    MacMsg.Buffer = FrameBuffer;
+    MacMsg.BufSize = sizeof( FrameBuffer );
+    MacMsg.MHDR.Value = 0;
+    MacMsg.MHDR.Bits.MType = mType;
+    MacMsg.FHDR.DevAddr = MAC_BENCHMARK_DEV_ADDR;
+    MacMsg.FHDR.FCtrl.Value = 0;
+    MacMsg.FHDR.FCnt = ( uint16_t )fCnt;
+    MacMsg.FPort = 1;
+    MacMsg.FRMPayload = Payload;
+    MacMsg.FRMPayloadSize = MAC_BENCHMARK_PAYLOAD_SIZE;
+    MacMsg.MIC = 0;
+}
+
+static void SecurePrepare( uint16_t n )
+{
+    BuildDataFrame( FRAME_TYPE_DATA_UNCONFIRMED_UP, ++FCntUp );
+}
+
+static bool SecureRun( uint16_t n )
+{
+    return LoRaMacCryptoSecureMessage( FCntUp, DR_0, 0, &MacMsg ) == LORAMAC_CRYPTO_SUCCESS;
+}
+
+static void UnsecurePrepare( uint16_t n )
+{
+    uint8_t b0[16] = { 0x49, 0x00, 0x00, 0x00, 0x00, 0x01 }; // Downlink direction
+    uint16_t micOffset;
+
+    BuildDataFrame( FRAME_TYPE_DATA_UNCONFIRMED_DOWN, ++FCntDown );
+    LoRaMacSerializerData( &MacMsg );
+    micOffset = MacMsg.BufSize - LORAMAC_MIC_FIELD_SIZE;
+
+    // Signs the frame as the network server does
+    b0[6] = MAC_BENCHMARK_DEV_ADDR & 0xFF;
+    b0[7] = ( MAC_BENCHMARK_DEV_ADDR >> 8 ) & 0xFF;
+    b0[8] = ( MAC_BENCHMARK_DEV_ADDR >> 16 ) & 0xFF;
+    b0[9] = ( MAC_BENCHMARK_DEV_ADDR >> 24 ) & 0xFF;
+    b0[10] = FCntDown & 0xFF;
+    b0[11] = ( FCntDown >> 8 ) & 0xFF;
+    b0[12] = ( FCntDown >> 16 ) & 0xFF;
+    b0[13] = ( FCntDown >> 24 ) & 0xFF;
+    b0[15] = micOffset & 0xFF;
+    SecureElementComputeAesCmac( b0, FrameBuffer, micOffset, S_NWK_S_INT_KEY, &MacMsg.MIC );
+    FrameBuffer[micOffset] = MacMsg.MIC & 0xFF;
+    FrameBuffer[micOffset + 1] = ( MacMsg.MIC >> 8 ) & 0xFF;
+    FrameBuffer[micOffset + 2] = ( MacMsg.MIC >> 16 ) & 0xFF;
+    FrameBuffer[micOffset + 3] = ( MacMsg.MIC >> 24 ) & 0xFF;
+
+    LoRaMacParserData( &MacMsg );
+}
+
+static bool UnsecureRun( uint16_t n )
+{
+    return LoRaMacCryptoUnsecureMessage( UNICAST_DEV_ADDR, MAC_BENCHMARK_DEV_ADDR, FCNT_DOWN, FCntDown, &MacMsg ) == LORAMAC_CRYPTO_SUCCESS;
+}
+
+static void SerializerPrepare( uint16_t n )
+{
+    BuildDataFrame( FRAME_TYPE_DATA_UNCONFIRMED_UP, n );
+}
+
+static bool SerializerRun( uint16_t n )
+{
+    return LoRaMacSerializerData( &MacMsg ) == LORAMAC_SERIALIZER_SUCCESS;
+}
+
+static void ParserPrepare( uint16_t n )
+{
+    BuildDataFrame( FRAME_TYPE_DATA_UNCONFIRMED_DOWN, n );
+    LoRaMacSerializerData( &MacMsg );
+}
+
+static bool ParserRun( uint16_t n )
+{
+    return LoRaMacParserData( &MacMsg ) == LORAMAC_PARSER_SUCCESS;
+}
+
+static void NextChannelPrepare( uint16_t n )
+{
+    NextChanParams.AggrTimeOff = 0;
+    NextChanParams.LastAggrTx = 0;
+    NextChanParams.Datarate = DR_0;
+    NextChanParams.Joined = true;
+    NextChanParams.DutyCycleEnabled = false;
+    NextChanParams.CurrentTime = TimerGetCurrentTime( );
+}
+
+static bool NextChannelRun( uint16_t n )
+{
+    uint8_t channel = 0;
+    TimerTime_t time = 0;
+    TimerTime_t aggregatedTimeOff = 0;
+
+    return RegionNextChannel( NextChanRegion, &NextChanParams, &channel, &time, &aggregatedTimeOff ) == LORAMAC_STATUS_OK;
+}
+
+static void MacCommandsPrepare( uint16_t n )
+{
+    LoRaMacCommandsRemoveNoneStickyCmds( );
+    LoRaMacCommandsRemoveStickyAnsCmds( );
+}
+
+static bool MacCommandsRun( uint16_t n )
+{
+    LoRaMacTestProcessMacCommands( MacCommands, sizeof( MacCommands ), 10 );
+    return true;
+}
+
+static void FragDecoderPrepare( uint16_t n )
+{
+    uint16_t index = n % FRAG_MAX_NB;
+
+    if( index == 0 )
+    {
+#if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
+        FragDecoderInit( &FragDecoder, FRAG_MAX_NB, FRAG_MAX_SIZE, &FragDecoderCallbacks );
+#else
+        FragDecoderInit( &FragDecoder, FRAG_MAX_NB, FRAG_MAX_SIZE, FragFile, sizeof( FragFile ) );
+#endif
+    }
+    memset1( Fragment, ( uint8_t )n, FRAG_MAX_SIZE );
+    FragCounter = index + 1;
+}
+
+static bool FragDecoderRun( uint16_t n )
+{
+    return FragDecoderProcess( &FragDecoder, FragCounter, Fragment ) != FRAG_SESSION_NOT_STARTED;
+}
+
+static void OnBenchmarkTimerEvent( void* context )
+{
+}
+
+static void TimerStartPrepare( uint16_t n )
+{
+    TimerEvent_t* timer = &Timers[n % MAC_BENCHMARK_NB_TIMERS];
+
+    // Spreads the insertions over the whole list
+    TimerStop( timer );
+    TimerSetValue( timer, MAC_BENCHMARK_TIMER_TIMEOUT + ( ( n * 5 ) % MAC_BENCHMARK_NB_TIMERS ) * 1000 );
+}
+
+static bool TimerStartRun( uint16_t n )
+{
+    TimerStart( &Timers[n % MAC_BENCHMARK_NB_TIMERS] );
+    return true;
+}
+
+static void TimerStopPrepare( uint16_t n )
+{
+    TimerStart( &Timers[n % MAC_BENCHMARK_NB_TIMERS] );
+}
+
+static bool TimerStopRun( uint16_t n )
+{
+    TimerStop( &Timers[n % MAC_BENCHMARK_NB_TIMERS] );
+    return true;
+}
+
+/*!
+ * MAC operations
+ */
+static const MacBenchmarkOp_t MacBenchmarkOps[] =
+{
+    { "CryptoSecureMessage", SecurePrepare, SecureRun },
+    { "CryptoUnsecureMessage", UnsecurePrepare, UnsecureRun },
+    { "SerializerData", SerializerPrepare, SerializerRun },
+    { "ParserData", ParserPrepare, ParserRun },
+    { "ProcessMacCommands", MacCommandsPrepare, MacCommandsRun },
+    { "FragDecoderProcess", FragDecoderPrepare, FragDecoderRun },
+    { "TimerStart", TimerStartPrepare, TimerStartRun },
+    { "TimerStop", TimerStopPrepare, TimerStopRun },
+};
+
+/*!
+ * Compiled regions
+ */
+static const struct
+{
+    LoRaMacRegion_t Region;
+    const char* Name;
+}MacBenchmarkRegions[] =
+{
+#if defined( REGION_AS923 )
+    { LORAMAC_REGION_AS923, "NextChannel AS923" },
+#endif
+#if defined( REGION_AU915 )
+    { LORAMAC_REGION_AU915, "NextChannel AU915" },
+#endif
+#if defined( REGION_CN470 )
+    { LORAMAC_REGION_CN470, "NextChannel CN470" },
+#endif
+#if defined( REGION_CN779 )
+    { LORAMAC_REGION_CN779, "NextChannel CN779" },
+#endif
+#if defined( REGION_EU433 )
+    { LORAMAC_REGION_EU433, "NextChannel EU433" },
+#endif
+#if defined( REGION_EU868 )
+    { LORAMAC_REGION_EU868, "NextChannel EU868" },
+#endif
+#if defined( REGION_KR920 )
+    { LORAMAC_REGION_KR920, "NextChannel KR920" },
+#endif
+#if defined( REGION_IN865 )
+    { LORAMAC_REGION_IN865, "NextChannel IN865" },
+#endif
+#if defined( REGION_US915 )
+    { LORAMAC_REGION_US915, "NextChannel US915" },
+#endif
+#if defined( REGION_RU864 )
+    { LORAMAC_REGION_RU864, "NextChannel RU864" },
+#endif
+#if defined( REGION_CUSTOM )
+    { LORAMAC_REGION_CUSTOM, "NextChannel CUSTOM" },
+#endif
+};
+
+/*!
+ * \brief Measures an operation and displays the results
+ *
+ * \param [IN] op Operation
+ */
+static void MacBenchmarkRun( const MacBenchmarkOp_t* op )
+{
+    volatile uint8_t stackRef = 0;
+    uint32_t minCycles = UINT32_MAX;
+    uint32_t maxCycles = 0;
+    uint64_t totalCycles = 0;
+    uint32_t maxStack = 0;
+    bool stackSaturated = false;
+    bool success = true;
+
+    for( uint16_t n = 0; n < MAC_BENCHMARK_NB_OPS; n++ )
+    {
+        uint32_t start;
+        uint32_t cycles;
+        uint32_t stack;
+        bool saturated;
+
+        if( op->Prepare != NULL )
+        {
+            op->Prepare( n );
+        }
+        StackPaint( );
+
+        start = BoardGetCycleCounter( );
+        success &= op->Run( n );
+        cycles = BoardGetCycleCounter( ) - start;
+
+        stack = StackUsage( ( uintptr_t )&stackRef, &saturated );
+        stackSaturated |= saturated;
+        maxStack = MAX( maxStack, stack );
+        minCycles = MIN( minCycles, cycles );
+        maxCycles = MAX( maxCycles, cycles );
+        totalCycles += cycles;
+    }
+
+    printf( "%-22s %10lu %10lu %10lu   %c%8lu   %s\r\n", op->Name, ( unsigned long )minCycles,
+            ( unsigned long )( totalCycles / MAC_BENCHMARK_NB_OPS ), ( unsigned long )maxCycles,
+            ( stackSaturated == true ) ? '>' : ' ', ( unsigned long )maxStack, ( success == true ) ? "OK" : "FAIL" );
+}
+
+void MacBenchmark( void )
+{
+    MibRequestConfirm_t mibReq;
+    InitDefaultsParams_t initDefaults;
+
+    // ABP LoRaWAN 1.0.4 session
+    mibReq.Type = MIB_ABP_LORAWAN_VERSION;
+    mibReq.Param.AbpLrWanVersion.Fields.Major = 1;
+    mibReq.Param.AbpLrWanVersion.Fields.Minor = 0;
+    mibReq.Param.AbpLrWanVersion.Fields.Revision = 4;
+    mibReq.Param.AbpLrWanVersion.Fields.Rfu = 0;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_DEV_ADDR;
+    mibReq.Param.DevAddr = MAC_BENCHMARK_DEV_ADDR;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_F_NWK_S_INT_KEY;
+    mibReq.Param.FNwkSIntKey = MacBenchmarkKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_S_NWK_S_INT_KEY;
+    mibReq.Param.SNwkSIntKey = MacBenchmarkKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_NWK_S_ENC_KEY;
+    mibReq.Param.NwkSEncKey = MacBenchmarkKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_APP_S_KEY;
+    mibReq.Param.AppSKey = MacBenchmarkKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    for( uint8_t i = 0; i < MAC_BENCHMARK_NB_TIMERS; i++ )
+    {
+        TimerInit( &Timers[i], OnBenchmarkTimerEvent );
+    }
+
+    printf( "\r\n###### ============ MAC BENCHMARK ============ ######\r\n" );
+    printf( "OPERATION               MIN [cyc]  AVG [cyc]  MAX [cyc]   STACK [B]   STATUS\r\n" );
+
+    for( uint8_t i = 0; i < ( sizeof( MacBenchmarkOps ) / sizeof( MacBenchmarkOps[0] ) ); i++ )
+    {
+        MacBenchmarkRun( &MacBenchmarkOps[i] );
+    }
+
+    for( uint8_t i = 0; i < ( sizeof( MacBenchmarkRegions ) / sizeof( MacBenchmarkRegions[0] ) ); i++ )
+    {
+        MacBenchmarkOp_t op = { MacBenchmarkRegions[i].Name, NextChannelPrepare, NextChannelRun };
+
+        initDefaults.NvmCtx = NULL;
+        initDefaults.Type = INIT_TYPE_INIT;
+        RegionInitDefaults( MacBenchmarkRegions[i].Region, &initDefaults );
+
+        NextChanRegion = MacBenchmarkRegions[i].Region;
+        MacBenchmarkRun( &op );
+    }
+    printf( "\r\n" );
+
+    for( uint8_t i = 0; i < MAC_BENCHMARK_NB_TIMERS; i++ )
+    {
+        TimerStop( &Timers[i] );
+    }
+    LoRaMacCommandsRemoveNoneStickyCmds( );
+    LoRaMacCommandsRemoveStickyAnsCmds( );
+}
@@ -0,0 +1,40 @@
+/*!
+ * \file      MacBenchmark.h
+ *
+ * \brief     Measures the processing cost of the LoRaMac hot paths
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __MAC_BENCHMARK_H__
+#define __MAC_BENCHMARK_H__
+
+/*!
+ * \brief Runs the MAC hot paths benchmark and displays the results
+ *
+ * \remark Each operation is run MAC_BENCHMARK_NB_OPS times. The minimum,
+ *         average and maximum costs are given in BoardGetCycleCounter units,
+ *         which are the MCU cycles on the Cortex-M3/M4 boards. The stack
+ *         usage is the deepest use of a painted window below the caller
+ *         stack, interrupts taken during the operation included.
+ *
+ * \remark The MAC layer has to be initialized. The benchmark sets ABP
+ *         LoRaWAN 1.0.4 session keys and resets the channel plans of the
+ *         compiled regions. The device has to be reset before joining a
+ *         network.
+ */
+void MacBenchmark( void );
+
+#endif // __MAC_BENCHMARK_H__
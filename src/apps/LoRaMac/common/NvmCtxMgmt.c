@@ -31,11 +31,16 @@
  * \author    Johannes Bruder ( STACKFORCE )
  */
 
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include "NvmCtxMgmt.h"
 #include "utilities.h"
+#include "timer.h"
+#include "lpm-board.h"
 #include "eeprom.h"
-#include "nvmm.h"
+#include "nvmlog.h"
+#include "crc.h"
 
 /*!
  * Enables/Disables the context storage management storage at all. Must be enabled for LoRaWAN 1.1.x.
@@ -55,6 +60,540 @@
 #define NVM_CTX_STORAGE_MASK               0x8C
 #endif
 
+/*!
+ * Modules stored as soon as the MAC is idle: the crypto context, which holds
+ * the frame counters, and the secure element context, which holds the keys.
+ */
+#define NVM_CTX_URGENT_MASK                0x0C
+
+/*!
+ * Maximum time the changes of the other modules are batched before being
+ * stored [ms]. 0 stores them as soon as the MAC is idle.
+ */
+#ifndef NVM_CTX_MAX_DIRTY_AGE
+#define NVM_CTX_MAX_DIRTY_AGE              60000
+#endif
+
+/*!
+ * Lateness tolerated by the storage of the batched changes [ms]
+ */
+#define NVM_CTX_DIRTY_AGE_SLACK            5000
+
+#if ( CONTEXT_MANAGEMENT_ENABLED == 1 ) || defined( NVM_CTX_RETAINED_ENABLED ) || defined( NVM_CTX_PROFILES_ENABLED )
+/*!
+ * Number of module contexts, one per \ref LoRaMacCtxUpdateStatus_t bit
+ */
+#define NVM_CTX_NB_MODULES                 7
+
+/*!
+ * \brief Gets the context pointer and size fields of the modules
+ *
+ * \param [IN]  contexts Contexts structure
+ * \param [OUT] ctx      Context pointer fields, indexed by the module bit
+ * \param [OUT] size     Context size fields, indexed by the module bit
+ */
+static void NvmCtxGetFields( LoRaMacCtxs_t* contexts, void** ctx[NVM_CTX_NB_MODULES], size_t* size[NVM_CTX_NB_MODULES] )
+{
+    ctx[0] = &contexts->MacNvmCtx;
+    size[0] = &contexts->MacNvmCtxSize;
+    ctx[1] = &contexts->RegionNvmCtx;
+    size[1] = &contexts->RegionNvmCtxSize;
+    ctx[2] = &contexts->CryptoNvmCtx;
+    size[2] = &contexts->CryptoNvmCtxSize;
+    ctx[3] = &contexts->SecureElementNvmCtx;
+    size[3] = &contexts->SecureElementNvmCtxSize;
+    ctx[4] = &contexts->CommandsNvmCtx;
+    size[4] = &contexts->CommandsNvmCtxSize;
+    ctx[5] = &contexts->ClassBNvmCtx;
+    size[5] = &contexts->ClassBNvmCtxSize;
+    ctx[6] = &contexts->ConfirmQueueNvmCtx;
+    size[6] = &contexts->ConfirmQueueNvmCtxSize;
+}
+
+#endif
+
+#if defined( NVM_CTX_RETAINED_ENABLED )
+/*!
+ * Size of the retained RAM area holding the copies of the contexts
+ */
+#ifndef NVM_CTX_RETAINED_SIZE
+#define NVM_CTX_RETAINED_SIZE              2560
+#endif
+
+/*!
+ * Identifies a snapshot laid out by this module
+ */
+#define NVM_CTX_RETAINED_MAGIC             0x4E435852
+
+/*!
+ * Session snapshot kept across the warm reboots
+ */
+typedef struct sNvmCtxRetained
+{
+    /*!
+     * \ref NVM_CTX_RETAINED_MAGIC once a snapshot has been written
+     */
+    uint32_t Magic;
+    /*!
+     * Incremented before and after each refresh, odd while the contexts are
+     * being copied
+     */
+    uint32_t Generation;
+    /*!
+     * CRC-32 of the contexts sizes and of the contexts
+     */
+    uint32_t Crc;
+    /*!
+     * Contexts sizes, indexed by the module bit
+     */
+    uint16_t Sizes[NVM_CTX_NB_MODULES];
+    /*!
+     * Contexts copies, in the module bits order
+     */
+    uint8_t Contexts[NVM_CTX_RETAINED_SIZE];
+}NvmCtxRetained_t;
+
+/*
+ * The snapshot lives in a section the startup code neither clears nor
+ * initializes, so that it survives the resets which keep the RAM powered.
+ */
+static NvmCtxRetained_t NvmCtxRetained __attribute__( ( section( ".noinit" ) ) );
+
+/*
+ * Set when a context changed since the last snapshot refresh
+ */
+static bool NvmCtxRetainedDirty = true;
+
+/*!
+ * \brief Computes the CRC-32 of the snapshot sizes and contexts
+ *
+ * \param [IN] length Contexts length
+ * \retval crc        CRC-32 (IEEE 802.3)
+ */
+static uint32_t NvmCtxRetainedCrc( size_t length )
+{
+    uint32_t crc = Crc32Update( 0, ( const uint8_t* )NvmCtxRetained.Sizes, sizeof( NvmCtxRetained.Sizes ) );
+
+    return Crc32Update( crc, NvmCtxRetained.Contexts, length );
+}
+
+/*!
+ * \brief Copies the contexts into the retained RAM snapshot
+ *
+ * \remark A reset during the copy leaves an odd generation, which discards
+ *         the snapshot at the next boot.
+ */
+static void NvmCtxRetainedRefresh( void )
+{
+    MibRequestConfirm_t mibReq;
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
+    size_t used = 0;
+
+    mibReq.Type = MIB_NVM_CTXS;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    NvmCtxGetFields( mibReq.Param.Contexts, ctx, size );
+
+    NvmCtxRetained.Generation = ( NvmCtxRetained.Generation + 1 ) | 0x01;
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        if( ( used + *size[i] ) > NVM_CTX_RETAINED_SIZE )
+        {
+            // Too small to hold a snapshot, keep it invalid
+            NvmCtxRetained.Magic = 0;
+            return;
+        }
+        NvmCtxRetained.Sizes[i] = *size[i];
+        memcpy1( &NvmCtxRetained.Contexts[used], ( uint8_t* )*ctx[i], *size[i] );
+        used += *size[i];
+    }
+    NvmCtxRetained.Crc = NvmCtxRetainedCrc( used );
+    NvmCtxRetained.Magic = NVM_CTX_RETAINED_MAGIC;
+    NvmCtxRetained.Generation++;
+}
+
+/*!
+ * \brief Allows the OFF mode, which restarts the MCU, only while the session
+ *        can be resumed from the snapshot: the snapshot is current and the MAC
+ *        is an idle class A device, without timers or radio reception to keep.
+ */
+static void NvmCtxRetainedUpdateOffMode( void )
+{
+    MibRequestConfirm_t mibReq;
+    bool resumable = ( NvmCtxRetainedDirty == false ) && ( NvmCtxRetained.Magic == NVM_CTX_RETAINED_MAGIC ) &&
+                     ( LoRaMacIsBusy( ) == false );
+
+    mibReq.Type = MIB_DEVICE_CLASS;
+    if( ( LoRaMacMibGetRequestConfirm( &mibReq ) != LORAMAC_STATUS_OK ) || ( mibReq.Param.Class != CLASS_A ) )
+    {
+        resumable = false;
+    }
+    LpmSetOffMode( LPM_LIB_ID, ( resumable == true ) ? LPM_ENABLE : LPM_DISABLE );
+}
+
+/*!
+ * \brief Restores the contexts from the retained RAM snapshot
+ *
+ * \retval true if the snapshot was valid and matched the firmware contexts
+ */
+static bool NvmCtxRetainedRestore( void )
+{
+    MibRequestConfirm_t mibReq;
+    LoRaMacCtxs_t contexts = { 0 };
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
+    size_t used = 0;
+
+    if( ( NvmCtxRetained.Magic != NVM_CTX_RETAINED_MAGIC ) || ( ( NvmCtxRetained.Generation & 0x01 ) != 0 ) )
+    {
+        return false;
+    }
+
+    // The snapshot must have been written by a firmware with the same contexts
+    mibReq.Type = MIB_NVM_CTXS;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    NvmCtxGetFields( mibReq.Param.Contexts, ctx, size );
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        if( NvmCtxRetained.Sizes[i] != *size[i] )
+        {
+            return false;
+        }
+        used += *size[i];
+    }
+    if( ( used > NVM_CTX_RETAINED_SIZE ) || ( NvmCtxRetained.Crc != NvmCtxRetainedCrc( used ) ) )
+    {
+        return false;
+    }
+
+    used = 0;
+    NvmCtxGetFields( &contexts, ctx, size );
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        *ctx[i] = &NvmCtxRetained.Contexts[used];
+        *size[i] = NvmCtxRetained.Sizes[i];
+        used += NvmCtxRetained.Sizes[i];
+    }
+    mibReq.Type = MIB_NVM_CTXS;
+    mibReq.Param.Contexts = &contexts;
+    return LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK;
+}
+#endif
+
+#if defined( NVM_CTX_PROFILES_ENABLED )
+/*!
+ * EEPROM address of the profiles, after the NVM log banks
+ */
+#ifndef NVM_CTX_PROFILES_START_ADDR
+#define NVM_CTX_PROFILES_START_ADDR        ( NVM_LOG_START_ADDR + ( 2 * NVM_LOG_BANK_SIZE ) )
+#endif
+
+/*!
+ * Size of the contexts of a profile
+ */
+#ifndef NVM_CTX_PROFILE_SIZE
+#define NVM_CTX_PROFILE_SIZE               2560
+#endif
+
+/*!
+ * Identifies a stored profile
+ */
+#define NVM_CTX_PROFILE_MAGIC              0x4E435850
+
+/*!
+ * No profile
+ */
+#define NVM_CTX_PROFILE_NONE               0xFF
+
+/*!
+ * Network session profile, as laid out in the EEPROM
+ */
+typedef struct sNvmCtxProfile
+{
+    /*!
+     * \ref NVM_CTX_PROFILE_MAGIC once the profile has been written
+     */
+    uint32_t Magic;
+    /*!
+     * CRC-32 of the name, of the contexts sizes and of the contexts
+     */
+    uint32_t Crc;
+    /*!
+     * Profile name, null terminated
+     */
+    char Name[NVM_CTX_PROFILE_NAME_SIZE];
+    /*!
+     * Contexts sizes, indexed by the module bit
+     */
+    uint16_t Sizes[NVM_CTX_NB_MODULES];
+    /*!
+     * Contexts copies, in the module bits order
+     */
+    uint8_t Contexts[NVM_CTX_PROFILE_SIZE];
+}NvmCtxProfile_t;
+
+/*!
+ * EEPROM address of the active profile slot, followed by the profiles
+ */
+#define NVM_CTX_PROFILE_ADDR( slot )       ( NVM_CTX_PROFILES_START_ADDR + 1 + ( ( slot ) * sizeof( NvmCtxProfile_t ) ) )
+
+/*
+ * Profile of the active session, read from the EEPROM on first use
+ */
+static uint8_t NvmCtxProfileActive = NVM_CTX_PROFILE_NONE;
+static bool NvmCtxProfileActiveKnown = false;
+
+/*
+ * Copy of the last active profile, swapped with the session contexts on a
+ * switch back to it
+ */
+static NvmCtxProfile_t NvmCtxProfileCache;
+static uint8_t NvmCtxProfileCacheSlot = NVM_CTX_PROFILE_NONE;
+
+/*!
+ * \brief Copies a profile name, truncated and null padded
+ *
+ * \param [OUT] dst  Destination name
+ * \param [IN]  name Source name
+ */
+static void NvmCtxProfileSetName( char dst[NVM_CTX_PROFILE_NAME_SIZE], const char* name )
+{
+    uint8_t i = 0;
+
+    for( ; ( i < ( NVM_CTX_PROFILE_NAME_SIZE - 1 ) ) && ( name[i] != '\0' ); i++ )
+    {
+        dst[i] = name[i];
+    }
+    for( ; i < NVM_CTX_PROFILE_NAME_SIZE; i++ )
+    {
+        dst[i] = '\0';
+    }
+}
+
+/*!
+ * \brief Gets the slot of the active profile
+ *
+ * \retval slot Active profile slot, NVM_CTX_PROFILE_NONE if none
+ */
+static uint8_t NvmCtxProfileGetActive( void )
+{
+    if( NvmCtxProfileActiveKnown == false )
+    {
+        if( ( EepromReadBuffer( NVM_CTX_PROFILES_START_ADDR, &NvmCtxProfileActive, 1 ) != SUCCESS ) ||
+            ( NvmCtxProfileActive >= NVM_CTX_NB_PROFILES ) )
+        {
+            NvmCtxProfileActive = NVM_CTX_PROFILE_NONE;
+        }
+        NvmCtxProfileActiveKnown = true;
+    }
+    return NvmCtxProfileActive;
+}
+
+/*!
+ * \brief Sets the slot of the active profile
+ *
+ * \param [IN] slot Active profile slot, NVM_CTX_PROFILE_NONE if none
+ */
+static void NvmCtxProfileSetActive( uint8_t slot )
+{
+    NvmCtxProfileActive = slot;
+    NvmCtxProfileActiveKnown = true;
+    EepromWriteBuffer( NVM_CTX_PROFILES_START_ADDR, &slot, 1 );
+}
+
+/*!
+ * \brief Finds a stored profile
+ *
+ * \param [IN] name Profile name, NULL to find a free slot
+ * \retval slot     Profile slot, NVM_CTX_PROFILE_NONE if not found
+ */
+static uint8_t NvmCtxProfileFind( const char* name )
+{
+    NvmCtxProfile_t header;
+    char profileName[NVM_CTX_PROFILE_NAME_SIZE];
+
+    if( name != NULL )
+    {
+        NvmCtxProfileSetName( profileName, name );
+    }
+    for( uint8_t slot = 0; slot < NVM_CTX_NB_PROFILES; slot++ )
+    {
+        // Only the magic and the name are read
+        if( EepromReadBuffer( NVM_CTX_PROFILE_ADDR( slot ), ( uint8_t* )&header, offsetof( NvmCtxProfile_t, Sizes ) ) != SUCCESS )
+        {
+            continue;
+        }
+        if( name == NULL )
+        {
+            if( header.Magic != NVM_CTX_PROFILE_MAGIC )
+            {
+                return slot;
+            }
+        }
+        else if( ( header.Magic == NVM_CTX_PROFILE_MAGIC ) &&
+                 ( memcmp( header.Name, profileName, NVM_CTX_PROFILE_NAME_SIZE ) == 0 ) )
+        {
+            return slot;
+        }
+    }
+    return NVM_CTX_PROFILE_NONE;
+}
+
+/*!
+ * \brief Gets the session contexts
+ *
+ * \param [OUT] ctx  Context pointers, indexed by the module bit
+ * \param [OUT] size Context sizes, indexed by the module bit
+ * \retval contexts  Session contexts, to be given back to the MAC
+ */
+static LoRaMacCtxs_t* NvmCtxProfileGetSession( void** ctx[NVM_CTX_NB_MODULES], size_t* size[NVM_CTX_NB_MODULES] )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_NVM_CTXS;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    NvmCtxGetFields( mibReq.Param.Contexts, ctx, size );
+    return mibReq.Param.Contexts;
+}
+
+/*!
+ * \brief Writes the session contexts to a profile slot
+ *
+ * \remark The contexts are written straight from the MAC, the profiles cache
+ *         is left untouched.
+ *
+ * \param [IN] slot Profile slot
+ * \param [IN] name Profile name
+ * \retval         true if the profile is written
+ */
+static bool NvmCtxProfileWriteSession( uint8_t slot, const char* name )
+{
+    NvmCtxProfile_t header;
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
+    uint16_t addr = NVM_CTX_PROFILE_ADDR( slot ) + offsetof( NvmCtxProfile_t, Contexts );
+    size_t used = 0;
+
+    NvmCtxProfileGetSession( ctx, size );
+    NvmCtxProfileSetName( header.Name, name );
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        header.Sizes[i] = *size[i];
+        used += *size[i];
+    }
+    if( used > NVM_CTX_PROFILE_SIZE )
+    {
+        return false;
+    }
+
+    header.Crc = Crc32Update( 0, ( const uint8_t* )header.Name, sizeof( header.Name ) + sizeof( header.Sizes ) );
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        header.Crc = Crc32Update( header.Crc, ( const uint8_t* )*ctx[i], *size[i] );
+        if( EepromWriteBuffer( addr, ( uint8_t* )*ctx[i], *size[i] ) != SUCCESS )
+        {
+            return false;
+        }
+        addr += *size[i];
+    }
+    // The header is written last, a reset leaves the previous profile invalid
+    header.Magic = NVM_CTX_PROFILE_MAGIC;
+    return EepromWriteBuffer( NVM_CTX_PROFILE_ADDR( slot ), ( uint8_t* )&header, offsetof( NvmCtxProfile_t, Contexts ) ) == SUCCESS;
+}
+
+/*!
+ * \brief Reads a profile into the profiles cache
+ *
+ * \param [IN] slot Profile slot
+ * \retval         true if the profile is valid and matches the firmware
+ *                  contexts
+ */
+static bool NvmCtxProfileReadCache( uint8_t slot )
+{
+    NvmCtxProfile_t* profile = &NvmCtxProfileCache;
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
+    size_t used = 0;
+
+    NvmCtxProfileCacheSlot = NVM_CTX_PROFILE_NONE;
+    if( EepromReadBuffer( NVM_CTX_PROFILE_ADDR( slot ), ( uint8_t* )profile, offsetof( NvmCtxProfile_t, Contexts ) ) != SUCCESS )
+    {
+        return false;
+    }
+
+    // The profile must have been written by a firmware with the same contexts
+    NvmCtxProfileGetSession( ctx, size );
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        if( profile->Sizes[i] != *size[i] )
+        {
+            return false;
+        }
+        used += *size[i];
+    }
+    if( ( profile->Magic != NVM_CTX_PROFILE_MAGIC ) || ( used > NVM_CTX_PROFILE_SIZE ) ||
+        ( EepromReadBuffer( NVM_CTX_PROFILE_ADDR( slot ) + offsetof( NvmCtxProfile_t, Contexts ), profile->Contexts, used ) != SUCCESS ) )
+    {
+        return false;
+    }
+    if( Crc32Update( Crc32Update( 0, ( const uint8_t* )profile->Name, sizeof( profile->Name ) + sizeof( profile->Sizes ) ),
+                     profile->Contexts, used ) != profile->Crc )
+    {
+        return false;
+    }
+    NvmCtxProfileCacheSlot = slot;
+    return true;
+}
+
+/*!
+ * \brief Swaps the session contexts with the profiles cache contexts and
+ *        restores the new session
+ *
+ * \remark The MAC must be stopped
+ *
+ * \retval true if the MAC accepted the new session
+ */
+static bool NvmCtxProfileSwapCache( void )
+{
+    MibRequestConfirm_t mibReq;
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
+    uint8_t* cache = NvmCtxProfileCache.Contexts;
+
+    mibReq.Param.Contexts = NvmCtxProfileGetSession( ctx, size );
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        uint8_t* session = ( uint8_t* )*ctx[i];
+
+        for( size_t j = 0; j < *size[i]; j++ )
+        {
+            uint8_t byte = session[j];
+
+            session[j] = cache[j];
+            cache[j] = byte;
+        }
+        cache += *size[i];
+    }
+
+    // The MAC contexts now hold the new session, the restore runs the
+    // modules updates of a session change
+    mibReq.Type = MIB_NVM_CTXS;
+    return LoRaMacMibSetRequestConfirm( &mibReq ) == LORAMAC_STATUS_OK;
+}
+
+/*!
+ * \brief Marks all the contexts as changed, the new session is stored by the
+ *        next \ref NvmCtxMgmtStore
+ */
+static void NvmCtxProfileNotifyChange( void )
+{
+    for( uint8_t i = LORAMAC_NVMCTXMODULE_MAC; i <= LORAMAC_NVMCTXMODULE_CONFIRM_QUEUE; i++ )
+    {
+        NvmCtxMgmtEvent( ( LoRaMacNvmCtxModule_t )i );
+    }
+}
+#endif
+
 #if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
 /*!
  * LoRaMAC Structure holding contexts changed status
@@ -109,22 +648,100 @@ typedef union uLoRaMacCtxsUpdateInfo
 
 LoRaMacCtxUpdateStatus_t CtxUpdateStatus = { .Value = 0 };
 
-/*
- * Nvmm handles
+/*!
+ * Size of the buffer holding the copies of the stored contexts
  */
-static NvmmDataBlock_t SecureElementNvmCtxDataBlock;
-static NvmmDataBlock_t CryptoNvmCtxDataBlock;
+#ifndef NVM_CTX_IMAGES_SIZE
 #if ( MAX_PERSISTENT_CTX_MGMT_ENABLED == 1 )
-static NvmmDataBlock_t MacNvmCtxDataBlock;
-static NvmmDataBlock_t RegionNvmCtxDataBlock;
-static NvmmDataBlock_t CommandsNvmCtxDataBlock;
-static NvmmDataBlock_t ConfirmQueueNvmCtxDataBlock;
-static NvmmDataBlock_t ClassBNvmCtxDataBlock;
+#define NVM_CTX_IMAGES_SIZE                4096
+#else
+#define NVM_CTX_IMAGES_SIZE                1280
 #endif
 #endif
 
+/*
+ * NVM log blocks, indexed by the \ref LoRaMacCtxUpdateStatus_t bit of the
+ * module. Only the modules of NVM_CTX_STORAGE_MASK have a non empty block.
+ */
+static NvmLogBlock_t NvmCtxBlocks[NVM_CTX_NB_MODULES];
+
+/*
+ * Copies of the stored contexts. The log only stores the bytes which differ
+ * from these copies.
+ */
+static uint8_t NvmCtxImages[NVM_CTX_IMAGES_SIZE];
+
+/*
+ * Set once the NVM log has been initialized
+ */
+static bool NvmCtxLogReady = false;
+
+/*
+ * Started by the first change of a deferred module
+ */
+static TimerEvent_t DirtyAgeTimer;
+static bool DirtyAgeTimerInitialized = false;
+
+/*
+ * Set when the deferred changes have to be stored
+ */
+static bool DirtyAgeElapsed = false;
+
+/*!
+ * \brief Function executed on the dirty age timer event
+ */
+static void OnDirtyAgeTimerEvent( void* context )
+{
+    DirtyAgeElapsed = true;
+}
+
+/*!
+ * \brief Stores the updated contexts, whatever the commit policy
+ *
+ * \retval Status of the operation
+ */
+static NvmCtxMgmtStatus_t NvmCtxMgmtCommit( void );
+
+/*!
+ * \brief Lays out the stored contexts copies and restores them from the NVM
+ *        log
+ *
+ * \param [IN] contexts MAC contexts, giving the contexts sizes
+ * \retval             true if the NVM log is ready
+ */
+static bool NvmCtxLogInit( LoRaMacCtxs_t* contexts )
+{
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
+    size_t used = 0;
+
+    NvmCtxGetFields( contexts, ctx, size );
+    NvmCtxLogReady = false;
+
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+    {
+        NvmCtxBlocks[i].Image = &NvmCtxImages[used];
+        NvmCtxBlocks[i].Size = 0;
+        if( ( NVM_CTX_STORAGE_MASK & ( 1 << i ) ) != 0 )
+        {
+            if( ( used + *size[i] ) > NVM_CTX_IMAGES_SIZE )
+            {
+                return false;
+            }
+            NvmCtxBlocks[i].Size = *size[i];
+            used += *size[i];
+        }
+    }
+    NvmCtxLogReady = ( NvmLogInit( NvmCtxBlocks, NVM_CTX_NB_MODULES ) == NVMLOG_SUCCESS );
+    return NvmCtxLogReady;
+}
+#endif
+
 void NvmCtxMgmtEvent( LoRaMacNvmCtxModule_t module )
 {
+#if defined( NVM_CTX_RETAINED_ENABLED )
+    NvmCtxRetainedDirty = true;
+#endif
 #if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
     switch( module )
     {
@@ -168,12 +785,64 @@ void NvmCtxMgmtEvent( LoRaMacNvmCtxModule_t module )
             break;
         }
     }
+
+    // The first deferred change starts the batching period
+    if( ( ( CtxUpdateStatus.Value & NVM_CTX_STORAGE_MASK ) != 0 ) && ( NVM_CTX_MAX_DIRTY_AGE > 0 ) &&
+        ( DirtyAgeElapsed == false ) )
+    {
+        if( DirtyAgeTimerInitialized == false )
+        {
+            TimerInit( &DirtyAgeTimer, OnDirtyAgeTimerEvent );
+            TimerSetValue( &DirtyAgeTimer, NVM_CTX_MAX_DIRTY_AGE );
+            TimerSetSlack( &DirtyAgeTimer, NVM_CTX_DIRTY_AGE_SLACK );
+            DirtyAgeTimerInitialized = true;
+        }
+        if( TimerIsStarted( &DirtyAgeTimer ) == false )
+        {
+            TimerStart( &DirtyAgeTimer );
+        }
+    }
 #endif
 }
 
 NvmCtxMgmtStatus_t NvmCtxMgmtStore( void )
 {
+#if defined( NVM_CTX_RETAINED_ENABLED )
+    // The snapshot is only consistent between two MAC transactions
+    if( ( NvmCtxRetainedDirty == true ) && ( LoRaMacIsBusy( ) == false ) )
+    {
+        NvmCtxRetainedDirty = false;
+        NvmCtxRetainedRefresh( );
+    }
+    NvmCtxRetainedUpdateOffMode( );
+#endif
+#if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    if( NvmCtxMgmtIsStorePending( ) == false )
+    {
+        return NVMCTXMGMT_STATUS_FAIL;
+    }
+    return NvmCtxMgmtCommit( );
+#else
+    return NVMCTXMGMT_STATUS_FAIL;
+#endif
+}
+
+NvmCtxMgmtStatus_t NvmCtxMgmtFlush( void )
+{
 #if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    return NvmCtxMgmtCommit( );
+#else
+    return NVMCTXMGMT_STATUS_FAIL;
+#endif
+}
+
+#if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
+static NvmCtxMgmtStatus_t NvmCtxMgmtCommit( void )
+{
+    NvmCtxMgmtStatus_t status = NVMCTXMGMT_STATUS_SUCCESS;
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
+
     // Read out the contexts lengths and pointers
     MibRequestConfirm_t mibReq;
     mibReq.Type = MIB_NVM_CTXS;
@@ -185,197 +854,267 @@ NvmCtxMgmtStatus_t NvmCtxMgmtStore( void )
     {
         return NVMCTXMGMT_STATUS_FAIL;
     }
-    if( LoRaMacStop( ) != LORAMAC_STATUS_OK )
+    if( ( NvmCtxLogReady == false ) && ( NvmCtxLogInit( MacContexts ) == false ) )
     {
         return NVMCTXMGMT_STATUS_FAIL;
     }
-
-    // Write
-    if( CtxUpdateStatus.Elements.Crypto == 1 )
+    if( LoRaMacStop( ) != LORAMAC_STATUS_OK )
     {
-        if( NvmmWrite( &CryptoNvmCtxDataBlock, MacContexts->CryptoNvmCtx, MacContexts->CryptoNvmCtxSize ) != NVMM_SUCCESS )
-        {
-            return NVMCTXMGMT_STATUS_FAIL;
-        }
+        return NVMCTXMGMT_STATUS_FAIL;
     }
 
-    if( CtxUpdateStatus.Elements.SecureElement == 1 )
+    // Write the changes of the updated contexts
+    NvmCtxGetFields( MacContexts, ctx, size );
+    for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
     {
-        if( NvmmWrite( &SecureElementNvmCtxDataBlock, MacContexts->SecureElementNvmCtx, MacContexts->SecureElementNvmCtxSize ) != NVMM_SUCCESS )
+        if( ( CtxUpdateStatus.Value & NVM_CTX_STORAGE_MASK & ( 1 << i ) ) != 0 )
         {
-            return NVMCTXMGMT_STATUS_FAIL;
+            if( NvmLogWrite( i, ( uint8_t* )*ctx[i] ) != NVMLOG_SUCCESS )
+            {
+                status = NVMCTXMGMT_STATUS_FAIL;
+                break;
+            }
         }
     }
 
-#if ( MAX_PERSISTENT_CTX_MGMT_ENABLED == 1 )
-    if( CtxUpdateStatus.Elements.Mac == 1 )
+    if( status == NVMCTXMGMT_STATUS_SUCCESS )
     {
-        if( NvmmWrite( &MacNvmCtxDataBlock, MacContexts->MacNvmCtx, MacContexts->MacNvmCtxSize ) != NVMM_SUCCESS )
+        CtxUpdateStatus.Value = 0x00;
+        DirtyAgeElapsed = false;
+        if( DirtyAgeTimerInitialized == true )
         {
-            return NVMCTXMGMT_STATUS_FAIL;
+            TimerStop( &DirtyAgeTimer );
         }
     }
 
-    if( CtxUpdateStatus.Elements.Region == 1 )
-    {
-        if( NvmmWrite( &RegionNvmCtxDataBlock, MacContexts->RegionNvmCtx, MacContexts->RegionNvmCtxSize ) != NVMM_SUCCESS )
-        {
-            return NVMCTXMGMT_STATUS_FAIL;
-        }
-    }
+    // Resume LoRaMac
+    LoRaMacStart( );
 
-    if( CtxUpdateStatus.Elements.Commands == 1 )
-    {
-        if( NvmmWrite( &CommandsNvmCtxDataBlock, MacContexts->CommandsNvmCtx, MacContexts->CommandsNvmCtxSize ) != NVMM_SUCCESS )
-        {
-            return NVMCTXMGMT_STATUS_FAIL;
-        }
-    }
+    return status;
+}
+#endif
 
-    if( CtxUpdateStatus.Elements.ClassB == 1 )
+bool NvmCtxMgmtIsStorePending( void )
+{
+#if defined( NVM_CTX_RETAINED_ENABLED )
+    if( NvmCtxRetainedDirty == true )
     {
-        if( NvmmWrite( &ClassBNvmCtxDataBlock, MacContexts->ClassBNvmCtx, MacContexts->ClassBNvmCtxSize ) != NVMM_SUCCESS )
-        {
-            return NVMCTXMGMT_STATUS_FAIL;
-        }
+        return true;
     }
+#endif
+#if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
+    uint8_t pending = CtxUpdateStatus.Value & NVM_CTX_STORAGE_MASK;
 
-    if( CtxUpdateStatus.Elements.ConfirmQueue == 1 )
+    if( pending == 0 )
     {
-        if( NvmmWrite( &ConfirmQueueNvmCtxDataBlock, MacContexts->ConfirmQueueNvmCtx, MacContexts->ConfirmQueueNvmCtxSize ) != NVMM_SUCCESS )
-        {
-            return NVMCTXMGMT_STATUS_FAIL;
-        }
+        return false;
     }
-#endif
-
-    CtxUpdateStatus.Value = 0x00;
-
-    // Resume LoRaMac
-    LoRaMacStart( );
-
-    return NVMCTXMGMT_STATUS_SUCCESS;
+    // The deferred changes wait for the dirty age timer
+    return ( ( pending & NVM_CTX_URGENT_MASK ) != 0 ) || ( NVM_CTX_MAX_DIRTY_AGE == 0 ) || ( DirtyAgeElapsed == true );
 #else
-    return NVMCTXMGMT_STATUS_FAIL;
+    return false;
 #endif
 }
 
 NvmCtxMgmtStatus_t NvmCtxMgmtRestore( void )
 {
+#if defined( NVM_CTX_RETAINED_ENABLED )
+    // A warm boot resumes the session from the retained RAM, a cold boot
+    // falls back to the NVM
+    if( NvmCtxRetainedRestore( ) == true )
+    {
+        NvmCtxRetainedDirty = false;
+        return NVMCTXMGMT_STATUS_SUCCESS;
+    }
+#endif
 #if ( CONTEXT_MANAGEMENT_ENABLED == 1 )
     MibRequestConfirm_t mibReq;
     LoRaMacCtxs_t contexts = { 0 };
     NvmCtxMgmtStatus_t status = NVMCTXMGMT_STATUS_SUCCESS;
+    void** ctx[NVM_CTX_NB_MODULES];
+    size_t* size[NVM_CTX_NB_MODULES];
 
     // Read out the contexts lengths
     mibReq.Type = MIB_NVM_CTXS;
     LoRaMacMibGetRequestConfirm( &mibReq );
 
-
-    uint8_t NvmCryptoCtxRestore[mibReq.Param.Contexts->CryptoNvmCtxSize];
-    uint8_t NvmSecureElementCtxRestore[mibReq.Param.Contexts->SecureElementNvmCtxSize];
-#if ( MAX_PERSISTENT_CTX_MGMT_ENABLED == 1 )
-    uint8_t NvmMacCtxRestore[mibReq.Param.Contexts->MacNvmCtxSize];
-    uint8_t NvmRegionCtxRestore[mibReq.Param.Contexts->RegionNvmCtxSize];
-    uint8_t NvmCommandsCtxRestore[mibReq.Param.Contexts->CommandsNvmCtxSize];
-    uint8_t NvmClassBCtxRestore[mibReq.Param.Contexts->ClassBNvmCtxSize];
-    uint8_t NvmConfirmQueueCtxRestore[mibReq.Param.Contexts->ConfirmQueueNvmCtxSize];
-#endif
-
-    if ( NvmmDeclare( &CryptoNvmCtxDataBlock, mibReq.Param.Contexts->CryptoNvmCtxSize ) == NVMM_SUCCESS )
+    // Replay the NVM log into the contexts copies
+    if( NvmCtxLogInit( mibReq.Param.Contexts ) == false )
     {
-        NvmmRead( &CryptoNvmCtxDataBlock, NvmCryptoCtxRestore, mibReq.Param.Contexts->CryptoNvmCtxSize );
-        contexts.CryptoNvmCtx = &NvmCryptoCtxRestore;
-        contexts.CryptoNvmCtxSize = mibReq.Param.Contexts->CryptoNvmCtxSize;
+        status = NVMCTXMGMT_STATUS_FAIL;
     }
     else
     {
-        status = NVMCTXMGMT_STATUS_FAIL;
+        NvmCtxGetFields( &contexts, ctx, size );
+        for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+        {
+            if( ( NVM_CTX_STORAGE_MASK & ( 1 << i ) ) == 0 )
+            {
+                continue;
+            }
+            if( NvmCtxBlocks[i].Stored == true )
+            {
+                *ctx[i] = NvmCtxBlocks[i].Image;
+                *size[i] = NvmCtxBlocks[i].Size;
+            }
+            else
+            {
+                status = NVMCTXMGMT_STATUS_FAIL;
+            }
+        }
     }
 
-    if ( NvmmDeclare( &SecureElementNvmCtxDataBlock, mibReq.Param.Contexts->SecureElementNvmCtxSize ) == NVMM_SUCCESS )
+    // Enforce storing all contexts
+    if( status == NVMCTXMGMT_STATUS_FAIL )
     {
-        NvmmRead( &SecureElementNvmCtxDataBlock, NvmSecureElementCtxRestore, mibReq.Param.Contexts->SecureElementNvmCtxSize );
-        contexts.SecureElementNvmCtx = &NvmSecureElementCtxRestore;
-        contexts.SecureElementNvmCtxSize = mibReq.Param.Contexts->SecureElementNvmCtxSize;
+        CtxUpdateStatus.Value = 0xFF;
+        NvmCtxMgmtCommit( );
     }
     else
-    {
-        status = NVMCTXMGMT_STATUS_FAIL;
+    {  // If successful query the mac to restore contexts
+        mibReq.Type = MIB_NVM_CTXS;
+        mibReq.Param.Contexts = &contexts;
+        LoRaMacMibSetRequestConfirm( &mibReq );
     }
 
-#if ( MAX_PERSISTENT_CTX_MGMT_ENABLED == 1 )
-    if( NvmmDeclare( &MacNvmCtxDataBlock, mibReq.Param.Contexts->MacNvmCtxSize ) == NVMM_SUCCESS )
+    return status;
+#else
+    return NVMCTXMGMT_STATUS_FAIL;
+#endif
+}
+
+#if defined( NVM_CTX_PROFILES_ENABLED )
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileSave( const char* name )
+{
+    uint8_t slot = NvmCtxProfileFind( name );
+    bool written;
+
+    if( slot == NVM_CTX_PROFILE_NONE )
     {
-        NvmmRead( &MacNvmCtxDataBlock, NvmMacCtxRestore, mibReq.Param.Contexts->MacNvmCtxSize );
-        contexts.MacNvmCtx = &NvmMacCtxRestore;
-        contexts.MacNvmCtxSize = mibReq.Param.Contexts->MacNvmCtxSize;
+        slot = NvmCtxProfileFind( NULL );
     }
-    else
+    if( ( slot == NVM_CTX_PROFILE_NONE ) || ( LoRaMacStop( ) != LORAMAC_STATUS_OK ) )
     {
-        status = NVMCTXMGMT_STATUS_FAIL;
+        return NVMCTXMGMT_STATUS_FAIL;
     }
 
-    if ( NvmmDeclare( &RegionNvmCtxDataBlock, mibReq.Param.Contexts->RegionNvmCtxSize ) == NVMM_SUCCESS )
+    if( NvmCtxProfileCacheSlot == slot )
     {
-        NvmmRead( &RegionNvmCtxDataBlock, NvmRegionCtxRestore, mibReq.Param.Contexts->RegionNvmCtxSize );
-        contexts.RegionNvmCtx = &NvmRegionCtxRestore;
-        contexts.RegionNvmCtxSize = mibReq.Param.Contexts->RegionNvmCtxSize;
+        NvmCtxProfileCacheSlot = NVM_CTX_PROFILE_NONE;
     }
-    else
+    written = NvmCtxProfileWriteSession( slot, name );
+    LoRaMacStart( );
+
+    if( written == false )
     {
-        status = NVMCTXMGMT_STATUS_FAIL;
+        return NVMCTXMGMT_STATUS_FAIL;
     }
+    NvmCtxProfileSetActive( slot );
+    return NVMCTXMGMT_STATUS_SUCCESS;
+}
 
-    if ( NvmmDeclare( &CommandsNvmCtxDataBlock, mibReq.Param.Contexts->CommandsNvmCtxSize ) == NVMM_SUCCESS )
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileSwitch( const char* name )
+{
+    uint8_t active = NvmCtxProfileGetActive( );
+    uint8_t slot = NvmCtxProfileFind( name );
+    NvmCtxProfile_t header;
+
+    if( slot == NVM_CTX_PROFILE_NONE )
+    {
+        return NVMCTXMGMT_STATUS_FAIL;
+    }
+    if( slot == active )
     {
-        NvmmRead( &CommandsNvmCtxDataBlock, NvmCommandsCtxRestore, mibReq.Param.Contexts->CommandsNvmCtxSize );
-        contexts.CommandsNvmCtx = &NvmCommandsCtxRestore;
-        contexts.CommandsNvmCtxSize = mibReq.Param.Contexts->CommandsNvmCtxSize;
+        return NVMCTXMGMT_STATUS_SUCCESS;
     }
-    else
+    if( ( active != NVM_CTX_PROFILE_NONE ) &&
+        ( EepromReadBuffer( NVM_CTX_PROFILE_ADDR( active ), ( uint8_t* )&header, offsetof( NvmCtxProfile_t, Sizes ) ) != SUCCESS ) )
     {
-        status = NVMCTXMGMT_STATUS_FAIL;
+        return NVMCTXMGMT_STATUS_FAIL;
+    }
+    if( LoRaMacStop( ) != LORAMAC_STATUS_OK )
+    {
+        return NVMCTXMGMT_STATUS_FAIL;
     }
 
-    if ( NvmmDeclare( &ClassBNvmCtxDataBlock, mibReq.Param.Contexts->ClassBNvmCtxSize ) == NVMM_SUCCESS )
+    // The last active profile is already in RAM
+    if( ( NvmCtxProfileCacheSlot != slot ) && ( NvmCtxProfileReadCache( slot ) == false ) )
     {
-        NvmmRead( &ClassBNvmCtxDataBlock, NvmClassBCtxRestore, mibReq.Param.Contexts->ClassBNvmCtxSize );
-        contexts.ClassBNvmCtx = &NvmClassBCtxRestore;
-        contexts.ClassBNvmCtxSize = mibReq.Param.Contexts->ClassBNvmCtxSize;
+        LoRaMacStart( );
+        return NVMCTXMGMT_STATUS_FAIL;
     }
-    else
+    if( NvmCtxProfileSwapCache( ) == false )
     {
-        status = NVMCTXMGMT_STATUS_FAIL;
+        // Back to the previous session
+        NvmCtxProfileSwapCache( );
+        LoRaMacStart( );
+        return NVMCTXMGMT_STATUS_FAIL;
     }
 
-    if ( NvmmDeclare( &ConfirmQueueNvmCtxDataBlock, mibReq.Param.Contexts->ConfirmQueueNvmCtxSize ) == NVMM_SUCCESS )
+    // The cache now holds the previous session, stored in its profile
+    NvmCtxProfileCacheSlot = NVM_CTX_PROFILE_NONE;
+    if( active != NVM_CTX_PROFILE_NONE )
     {
-        NvmmRead( &ConfirmQueueNvmCtxDataBlock, NvmConfirmQueueCtxRestore, mibReq.Param.Contexts->ConfirmQueueNvmCtxSize );
-        contexts.ConfirmQueueNvmCtx = &NvmConfirmQueueCtxRestore;
-        contexts.ConfirmQueueNvmCtxSize = mibReq.Param.Contexts->ConfirmQueueNvmCtxSize;
+        size_t used = 0;
+
+        for( uint8_t i = 0; i < NVM_CTX_NB_MODULES; i++ )
+        {
+            used += NvmCtxProfileCache.Sizes[i];
+        }
+        NvmCtxProfileSetName( NvmCtxProfileCache.Name, header.Name );
+        NvmCtxProfileCache.Crc = Crc32Update( Crc32Update( 0, ( const uint8_t* )NvmCtxProfileCache.Name,
+                                                           sizeof( NvmCtxProfileCache.Name ) + sizeof( NvmCtxProfileCache.Sizes ) ),
+                                              NvmCtxProfileCache.Contexts, used );
+        NvmCtxProfileCache.Magic = NVM_CTX_PROFILE_MAGIC;
+        if( EepromWriteBuffer( NVM_CTX_PROFILE_ADDR( active ), ( uint8_t* )&NvmCtxProfileCache,
+                               offsetof( NvmCtxProfile_t, Contexts ) + used ) == SUCCESS )
+        {
+            NvmCtxProfileCacheSlot = active;
+        }
     }
-    else
+    NvmCtxProfileSetActive( slot );
+    NvmCtxProfileNotifyChange( );
+
+    LoRaMacStart( );
+    return NVMCTXMGMT_STATUS_SUCCESS;
+}
+
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileDelete( const char* name )
+{
+    uint8_t slot = NvmCtxProfileFind( name );
+    uint32_t magic = 0;
+
+    if( slot == NVM_CTX_PROFILE_NONE )
     {
-        status = NVMCTXMGMT_STATUS_FAIL;
+        return NVMCTXMGMT_STATUS_FAIL;
     }
-#endif
-
-    // Enforce storing all contexts
-    if( status == NVMCTXMGMT_STATUS_FAIL )
+    if( NvmCtxProfileCacheSlot == slot )
     {
-        CtxUpdateStatus.Value = 0xFF;
-        NvmCtxMgmtStore( );
+        NvmCtxProfileCacheSlot = NVM_CTX_PROFILE_NONE;
     }
-    else
-    {  // If successful query the mac to restore contexts
-        mibReq.Type = MIB_NVM_CTXS;
-        mibReq.Param.Contexts = &contexts;
-        LoRaMacMibSetRequestConfirm( &mibReq );
+    if( NvmCtxProfileGetActive( ) == slot )
+    {
+        NvmCtxProfileSetActive( NVM_CTX_PROFILE_NONE );
     }
-
-    return status;
+    if( EepromWriteBuffer( NVM_CTX_PROFILE_ADDR( slot ), ( uint8_t* )&magic, sizeof( magic ) ) != SUCCESS )
+    {
+        return NVMCTXMGMT_STATUS_FAIL;
+    }
+    return NVMCTXMGMT_STATUS_SUCCESS;
+}
 #else
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileSave( const char* name )
+{
+    return NVMCTXMGMT_STATUS_FAIL;
+}
+
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileSwitch( const char* name )
+{
     return NVMCTXMGMT_STATUS_FAIL;
-#endif
 }
+
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileDelete( const char* name )
+{
+    return NVMCTXMGMT_STATUS_FAIL;
+}
+#endif
@@ -39,6 +39,19 @@
 
 #include "LoRaMac.h"
 
+/*!
+ * Number of network session profiles. The profiles are only stored when
+ * NVM_CTX_PROFILES_ENABLED is defined.
+ */
+#ifndef NVM_CTX_NB_PROFILES
+#define NVM_CTX_NB_PROFILES                2
+#endif
+
+/*!
+ * Size of a profile name, including the null terminator [bytes]
+ */
+#define NVM_CTX_PROFILE_NAME_SIZE          8
+
 /*!
  * Data structure containing the status of a operation
  */
@@ -62,8 +75,73 @@ typedef enum NvmCtxMgmtStatus_e
  */
 void NvmCtxMgmtEvent( LoRaMacNvmCtxModule_t module );
 
+/*!
+ * \brief Stores the updated contexts when the commit policy allows it
+ *
+ * \remark The changes of all the modules are batched and written at once
+ *         while the MAC is idle. The crypto and secure element changes are
+ *         written on the next call, the other changes wait up to
+ *         NVM_CTX_MAX_DIRTY_AGE.
+ *
+ * \retval Status of the operation. NVMCTXMGMT_STATUS_FAIL when nothing has
+ *         been stored
+ */
 NvmCtxMgmtStatus_t NvmCtxMgmtStore( void );
 
+/*!
+ * \brief Stores all the updated contexts now, e.g. before a power down
+ *
+ * \retval Status of the operation
+ */
+NvmCtxMgmtStatus_t NvmCtxMgmtFlush( void );
+
+/*!
+ * \brief Verifies if a context change is due to be stored by
+ *        \ref NvmCtxMgmtStore
+ *
+ * \retval [true, if a store is pending; false, if not]
+ */
+bool NvmCtxMgmtIsStorePending( void );
+
 NvmCtxMgmtStatus_t NvmCtxMgmtRestore(void );
 
+/*!
+ * \brief Stores the active network session as a profile, which becomes the
+ *        active profile
+ *
+ * \remark A profile holds all the MAC contexts: DevAddr, keys, frame
+ *         counters and channels. The profiles use the active region.
+ *         Only available when NVM_CTX_PROFILES_ENABLED is defined.
+ *
+ * \param [IN] name Profile name, replaces the profile of the same name
+ *
+ * \retval Status of the operation. NVMCTXMGMT_STATUS_FAIL when the MAC is
+ *         busy or all the profiles are used
+ */
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileSave( const char* name );
+
+/*!
+ * \brief Switches to the network session of a profile, without a join
+ *
+ * \remark The active session is stored in its profile first. The last
+ *         active profile is kept in RAM, switching back to it doesn't read
+ *         the EEPROM. The other profiles are read from the EEPROM.
+ *         Only available when NVM_CTX_PROFILES_ENABLED is defined.
+ *
+ * \param [IN] name Profile name
+ *
+ * \retval Status of the operation. NVMCTXMGMT_STATUS_FAIL when the MAC is
+ *         busy or the profile is unknown or invalid
+ */
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileSwitch( const char* name );
+
+/*!
+ * \brief Deletes a profile
+ *
+ * \param [IN] name Profile name
+ *
+ * \retval Status of the operation
+ */
+NvmCtxMgmtStatus_t NvmCtxMgmtProfileDelete( const char* name );
+
 #endif // __NVMCTXMGMT_H__
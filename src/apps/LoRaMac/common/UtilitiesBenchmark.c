@@ -0,0 +1,147 @@
+/*!
+ * \file      UtilitiesBenchmark.c
+ *
+ * \brief     Measures the memcpy1, memset1 and memcpyr processing times over a
+ *            set of buffer sizes
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdio.h>
+#include "utilities.h"
+#include "UtilitiesBenchmark.h"
+
+/*!
+ * Largest benchmarked buffer size [bytes]
+ */
+#define UTILITIES_BENCHMARK_MAX_SIZE                255
+
+/*!
+ * Number of calls of each utility per benchmark configuration
+ */
+#define UTILITIES_BENCHMARK_NB_CALLS                10000
+
+/*!
+ * Source buffer. Word aligned, the offsets are applied on top of it.
+ */
+static uint32_t SrcBuffer[( UTILITIES_BENCHMARK_MAX_SIZE + 3 + 3 ) / 4];
+
+/*!
+ * Destination buffer. Word aligned, the offsets are applied on top of it.
+ */
+static uint32_t DstBuffer[( UTILITIES_BENCHMARK_MAX_SIZE + 3 + 3 ) / 4];
+
+bool UtilitiesBenchmarkRun( uint16_t size, uint8_t offset, uint32_t nbCalls, UtilitiesBenchmarkTimes_t* times )
+{
+    uint8_t* src = ( uint8_t* )SrcBuffer + offset;
+    uint8_t* dst = ( uint8_t* )DstBuffer + offset;
+    TimerTime_t startTime;
+
+    times->Copy = 0;
+    times->Set = 0;
+    times->Reverse = 0;
+
+    if( ( size == 0 ) || ( size > UTILITIES_BENCHMARK_MAX_SIZE ) || ( offset > 3 ) )
+    {
+        return false;
+    }
+
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        src[i] = ( uint8_t )randr( 0, 255 );
+    }
+
+    // Outputs
+    memcpy1( dst, src, size );
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        if( dst[i] != src[i] )
+        {
+            return false;
+        }
+    }
+    memcpyr( dst, src, size );
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        if( dst[i] != src[size - 1 - i] )
+        {
+            return false;
+        }
+    }
+    memset1( dst, src[0], size );
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        if( dst[i] != src[0] )
+        {
+            return false;
+        }
+    }
+
+    // Timings
+    startTime = TimerGetCurrentTime( );
+    for( uint32_t n = 0; n < nbCalls; n++ )
+    {
+        memcpy1( dst, src, size );
+    }
+    times->Copy = TimerGetElapsedTime( startTime );
+
+    startTime = TimerGetCurrentTime( );
+    for( uint32_t n = 0; n < nbCalls; n++ )
+    {
+        memset1( dst, ( uint8_t )n, size );
+    }
+    times->Set = TimerGetElapsedTime( startTime );
+
+    startTime = TimerGetCurrentTime( );
+    for( uint32_t n = 0; n < nbCalls; n++ )
+    {
+        memcpyr( dst, src, size );
+    }
+    times->Reverse = TimerGetElapsedTime( startTime );
+    return true;
+}
+
+/*!
+ * \brief Converts the time spent by nbCalls calls to a time per call [ns]
+ */
+static uint32_t UtilitiesBenchmarkPerCall( TimerTime_t elapsed, uint32_t nbCalls )
+{
+    return ( uint32_t )( ( ( uint64_t )elapsed * 1000000 ) / nbCalls );
+}
+
+void UtilitiesBenchmark( void )
+{
+    const uint16_t sizeList[] = { 8, 16, 32, 64, 128, UTILITIES_BENCHMARK_MAX_SIZE };
+    const uint8_t offsetList[] = { 0, 1 };
+
+    printf( "\r\n###### ======= UTILITIES BENCHMARK ======== ######\r\n" );
+    printf( "SIZE  OFFSET  MEMCPY1 [ns]  MEMSET1 [ns]  MEMCPYR [ns]   STATUS\r\n" );
+
+    for( uint8_t i = 0; i < ( sizeof( sizeList ) / sizeof( sizeList[0] ) ); i++ )
+    {
+        for( uint8_t j = 0; j < ( sizeof( offsetList ) / sizeof( offsetList[0] ) ); j++ )
+        {
+            UtilitiesBenchmarkTimes_t times;
+            bool success = UtilitiesBenchmarkRun( sizeList[i], offsetList[j], UTILITIES_BENCHMARK_NB_CALLS, &times );
+
+            printf( "%4u  %6u  %12lu  %12lu  %12lu   %s\r\n", sizeList[i], offsetList[j],
+                    ( unsigned long )UtilitiesBenchmarkPerCall( times.Copy, UTILITIES_BENCHMARK_NB_CALLS ),
+                    ( unsigned long )UtilitiesBenchmarkPerCall( times.Set, UTILITIES_BENCHMARK_NB_CALLS ),
+                    ( unsigned long )UtilitiesBenchmarkPerCall( times.Reverse, UTILITIES_BENCHMARK_NB_CALLS ),
+                    ( success == true ) ? "OK" : "FAIL" );
+        }
+    }
+    printf( "\r\n" );
+}
@@ -0,0 +1,66 @@
+/*!
+ * \file      UtilitiesBenchmark.h
+ *
+ * \brief     Measures the memcpy1, memset1 and memcpyr processing times over a
+ *            set of buffer sizes
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __UTILITIES_BENCHMARK_H__
+#define __UTILITIES_BENCHMARK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+/*!
+ * Memory utilities benchmark results
+ */
+typedef struct sUtilitiesBenchmarkTimes
+{
+    /*!
+     * Time spent in memcpy1 [ms]
+     */
+    TimerTime_t Copy;
+    /*!
+     * Time spent in memset1 [ms]
+     */
+    TimerTime_t Set;
+    /*!
+     * Time spent in memcpyr [ms]
+     */
+    TimerTime_t Reverse;
+}UtilitiesBenchmarkTimes_t;
+
+/*!
+ * \brief Checks the memory utilities output against byte by byte references
+ *        and calls each of them nbCalls times on the same buffers
+ *
+ * \param [IN]  size    Buffer size [1:255]
+ * \param [IN]  offset  Offset of the buffers from a word aligned address [0:3]
+ * \param [IN]  nbCalls Number of calls of each utility
+ * \param [OUT] times   Time spent in each utility
+ * \retval status       true if the utilities outputs match the references
+ */
+bool UtilitiesBenchmarkRun( uint16_t size, uint8_t offset, uint32_t nbCalls, UtilitiesBenchmarkTimes_t* times );
+
+/*!
+ * \brief Runs the benchmark over a set of buffer sizes and alignments and
+ *        displays the time spent per call
+ */
+void UtilitiesBenchmark( void );
+
+#endif // __UTILITIES_BENCHMARK_H__
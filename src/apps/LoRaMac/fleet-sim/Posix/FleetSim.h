@@ -0,0 +1,167 @@
+/*!
+ * \file      FleetSim.h
+ *
+ * \brief     Network simulator shared definitions
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __FLEET_SIM_H__
+#define __FLEET_SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "LoRaMac.h"
+
+/*!
+ * Maximum number of gateways
+ */
+#define FLEET_SIM_MAX_GATEWAYS                      4
+
+/*!
+ * Maximum number of worker processes
+ */
+#define FLEET_SIM_MAX_WORKERS                       64
+
+/*!
+ * Maximum number of simulated regions
+ */
+#define FLEET_SIM_MAX_REGIONS                       11
+
+/*!
+ * Simulation configuration
+ */
+typedef struct sFleetSimConfig
+{
+    uint32_t NbDevices;                                 //! Number of devices
+    uint32_t NbWorkers;                                 //! Number of worker processes
+    uint32_t Duration;                                  //! Simulated time [s]
+    uint32_t Seed;                                      //! Pseudo random generators seed
+    uint32_t Epoch;                                     //! Virtual clock barrier period [ms]
+    uint32_t Radius;                                    //! Radius of the area the devices are placed in [m]
+    uint8_t NbGateways;                                 //! Number of gateways
+    uint8_t NbDemodulators;                             //! Number of demodulators of each gateway
+    bool AdrOn;                                         //! Devices ADR and network server ADR algorithm
+    bool Otaa;                                          //! Devices join the network, ABP sessions otherwise
+    uint32_t JoinSpread;                                //! Window the first join requests are spread over [s]
+    uint8_t NbRegions;                                  //! Number of simulated regions
+    LoRaMacRegion_t Regions[FLEET_SIM_MAX_REGIONS];     //! Simulated regions, assigned in turn to the devices
+}FleetSimConfig_t;
+
+/*!
+ * Transmission logged on the shared channel
+ */
+typedef struct sFleetSimTx
+{
+    uint64_t Start;                                     //! Virtual start time [ms]
+    uint32_t Duration;                                  //! Time on air [ms]
+    uint32_t Frequency;                                 //! Channel frequency [Hz]
+    uint32_t DeviceId;                                  //! Transmitting device or addressed device for downlinks
+    uint8_t Sf;                                         //! LoRa spreading factor
+    uint8_t Bandwidth;                                  //! LoRa bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+    uint8_t Gateway;                                    //! Transmitting gateway of a downlink
+    bool IsDownlink;                                    //! Set for the gateways transmissions
+    bool IsJoinRequest;                                 //! Set for the join requests
+    bool IsLockAssigned;                                //! Set once the gateways demodulators allocation is known
+    uint8_t Locked;                                     //! Mask of the gateways a demodulator locked on the uplink
+    float Rssi[FLEET_SIM_MAX_GATEWAYS];                 //! Uplink RSSI at each gateway [dBm]
+}FleetSimTx_t;
+
+/*!
+ * Per device results. Written by the owning worker, except for the exact
+ * reception counters written by the coordinator between the barriers.
+ */
+typedef struct sFleetSimDeviceStats
+{
+    uint32_t Requests;                                  //! Accepted application uplink requests
+    uint32_t ConfirmedRequests;                         //! Accepted confirmed uplink requests
+    uint32_t Acked;                                     //! Acknowledged confirmed uplink requests
+    uint32_t DutyCycleRestricted;                       //! Requests deferred by the duty-cycle
+    uint32_t Uplinks;                                   //! Transmitted frames, retransmissions included
+    uint32_t UplinksReceived;                           //! Frames received as seen by the network server
+    uint32_t UplinksDelivered;                          //! Frames received according to the exact resolution
+    uint32_t Downlinks;                                 //! Frames received by the device
+    uint32_t JoinRequests;                              //! Transmitted join requests
+    uint32_t JoinDelay;                                 //! Delay from the first join request to the join accept [ms]
+    uint32_t AirTime;                                   //! Accumulated time on air [ms]
+    int8_t Datarate;                                    //! Datarate at the end of the simulation
+    int8_t TxPower;                                     //! Tx power index at the end of the simulation
+    uint8_t Region;                                     //! Index of the device region in the configuration
+    bool IsJoined;                                      //! Set once the device has a session
+}FleetSimDeviceStats_t;
+
+/*!
+ * Reception outcomes of the uplinks, from the furthest reception stage
+ */
+typedef enum eFleetSimRxStatus
+{
+    FLEET_SIM_RX_OK,                                    //! Received by at least one gateway
+    FLEET_SIM_RX_COLLISION,                             //! Lost to interferers on the same channel and SF
+    FLEET_SIM_RX_DEMODULATORS,                          //! No demodulator available
+    FLEET_SIM_RX_GATEWAY_BUSY,                          //! Gateways transmitting a downlink
+    FLEET_SIM_RX_SENSITIVITY,                           //! Below the sensitivity of all the gateways
+    FLEET_SIM_RX_STATUS_MAX,
+}FleetSimRxStatus_t;
+
+/*!
+ * State shared by the coordinator and the worker processes
+ */
+typedef struct sFleetSimShared
+{
+    pthread_barrier_t Barrier;                          //! Virtual clock barrier, coordinator and workers
+    uint64_t EpochEnd;                                  //! End of the running epoch [ms]
+    bool Stop;                                          //! Set by the coordinator to end the simulation
+    uint32_t VisibleCapacity;                           //! Capacity of the visible transmissions log
+    uint32_t NbVisible;                                 //! Transmissions of the past epochs
+    uint32_t PendingCapacity;                           //! Capacity of each worker transmissions log
+    uint32_t NbPending[FLEET_SIM_MAX_WORKERS];          //! Transmissions of the running epoch per worker, logged or not
+    uint32_t NbDropped;                                 //! Transmissions not logged, logs full
+    uint32_t RxStatus[FLEET_SIM_RX_STATUS_MAX];         //! Exact uplinks reception outcomes
+    uint32_t NbDownlinks;                               //! Downlinks transmitted by the gateways
+}FleetSimShared_t;
+
+/*!
+ * Shared memory map
+ */
+typedef struct sFleetSimMemory
+{
+    FleetSimShared_t* Shared;                           //! Coordination state
+    FleetSimTx_t* Visible;                              //! Transmissions of the past epochs, read-only for the workers
+    FleetSimTx_t* Pending;                              //! Per worker logs of the running epoch
+    FleetSimDeviceStats_t* Stats;                       //! Per device results
+}FleetSimMemory_t;
+
+/*!
+ * \brief Mixes two values into a well distributed hash
+ *
+ * \remark Used to derive the per device pseudo random values from the seed,
+ *         whatever the worker the device is run by.
+ *
+ * \param [IN] a First value
+ * \param [IN] b Second value
+ * \retval hash  32 bits hash
+ */
+uint32_t FleetSimHash( uint32_t a, uint32_t b );
+
+/*!
+ * \brief Returns the name of a region
+ *
+ * \param [IN] region Region
+ * \retval name       Region name
+ */
+const char* FleetSimRegionName( LoRaMacRegion_t region );
+
+#endif // __FLEET_SIM_H__
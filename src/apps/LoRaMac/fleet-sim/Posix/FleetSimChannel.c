@@ -0,0 +1,304 @@
+/*!
+ * \file      FleetSimChannel.c
+ *
+ * \brief     Network simulator radio channel and gateways model
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <math.h>
+#include "utilities.h"
+#include "FleetSimChannel.h"
+
+/*!
+ * Log-distance path loss model, suburban parameters at 868 MHz
+ */
+#define PATH_LOSS_REFERENCE                         107.41
+#define PATH_LOSS_REFERENCE_DISTANCE                40.0
+#define PATH_LOSS_EXPONENT                          2.08
+
+/*!
+ * Standard deviation of the log-normal shadowing [dB]
+ */
+#define PATH_LOSS_SHADOWING                         3.57
+
+/*!
+ * Minimal distance of a device to a gateway [m]
+ */
+#define MIN_DISTANCE                                10.0
+
+/*!
+ * Receivers noise figure [dB]
+ */
+#define NOISE_FIGURE                                6.0f
+
+/*!
+ * Simulation configuration
+ */
+static const FleetSimConfig_t* Config;
+
+/*!
+ * Gateways positions [m]
+ */
+static double GatewayX[FLEET_SIM_MAX_GATEWAYS];
+static double GatewayY[FLEET_SIM_MAX_GATEWAYS];
+
+/*!
+ * \brief Returns a uniform number in ]0, 1[ derived from the key and index
+ */
+static double Uniform( uint32_t key, uint32_t index )
+{
+    return ( ( double )FleetSimHash( key, index ) + 0.5 ) / 4294967296.0;
+}
+
+/*!
+ * \brief Returns a standard normal number derived from the key and index
+ */
+static double Gaussian( uint32_t key, uint32_t index )
+{
+    return sqrt( -2.0 * log( Uniform( key, index ) ) ) * cos( 2.0 * M_PI * Uniform( key, index + 1 ) );
+}
+
+/*!
+ * \brief Checks if two transmissions overlap in time
+ */
+static bool IsOverlapping( const FleetSimTx_t* a, const FleetSimTx_t* b )
+{
+    return ( a->Start < ( b->Start + b->Duration ) ) && ( b->Start < ( a->Start + a->Duration ) );
+}
+
+/*!
+ * \brief Checks if a gateway transmits while an uplink is on air
+ *
+ * \param [IN] tx      Uplink
+ * \param [IN] gateway Gateway
+ * \param [IN] log     Transmissions
+ * \param [IN] nbLog   Number of logged transmissions
+ * \param [IN] atStart Only checks the uplink start, when the demodulators lock
+ * \retval status      true if the gateway transmits
+ */
+static bool IsGatewayTransmitting( const FleetSimTx_t* tx, uint8_t gateway, const FleetSimTx_t* log, uint32_t nbLog,
+                                   bool atStart )
+{
+    for( uint32_t i = 0; i < nbLog; i++ )
+    {
+        const FleetSimTx_t* dl = &log[i];
+
+        if( ( dl->IsDownlink == false ) || ( dl->Gateway != gateway ) )
+        {
+            continue;
+        }
+        if( atStart == true )
+        {
+            if( ( dl->Start <= tx->Start ) && ( tx->Start < ( dl->Start + dl->Duration ) ) )
+            {
+                return true;
+            }
+        }
+        else if( IsOverlapping( tx, dl ) == true )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Checks if a gateway demodulator can lock on an uplink preamble
+ */
+static bool CanLock( const FleetSimTx_t* tx, uint8_t gateway, const FleetSimTx_t* log, uint32_t nbLog )
+{
+    uint8_t busy = 0;
+
+    if( FleetSimChannelIsAboveSensitivity( tx->Rssi[gateway], tx->Sf, tx->Bandwidth ) == false )
+    {
+        return false;
+    }
+    if( IsGatewayTransmitting( tx, gateway, log, nbLog, true ) == true )
+    {
+        return false;
+    }
+    for( uint32_t i = 0; i < nbLog; i++ )
+    {
+        const FleetSimTx_t* ul = &log[i];
+
+        if( ( ul == tx ) || ( ul->IsLockAssigned == false ) || ( ( ul->Locked & ( 1 << gateway ) ) == 0 ) )
+        {
+            continue;
+        }
+        if( ( ul->Start <= tx->Start ) && ( tx->Start < ( ul->Start + ul->Duration ) ) )
+        {
+            busy++;
+        }
+    }
+    return busy < Config->NbDemodulators;
+}
+
+/*!
+ * \brief Checks if the co-channel interferers prevent the uplink capture
+ */
+static bool IsCollided( const FleetSimTx_t* tx, uint8_t gateway, const FleetSimTx_t* log, uint32_t nbLog )
+{
+    double interference = 0.0;
+
+    for( uint32_t i = 0; i < nbLog; i++ )
+    {
+        const FleetSimTx_t* ul = &log[i];
+
+        if( ( ul == tx ) || ( ul->IsDownlink == true ) || ( ul->Frequency != tx->Frequency ) || ( ul->Sf != tx->Sf ) )
+        {
+            continue;
+        }
+        if( IsOverlapping( tx, ul ) == true )
+        {
+            interference += pow( 10.0, ul->Rssi[gateway] / 10.0 );
+        }
+    }
+    if( interference == 0.0 )
+    {
+        return false;
+    }
+    return ( tx->Rssi[gateway] - 10.0 * log10( interference ) ) < FLEET_SIM_CHANNEL_CAPTURE_THRESHOLD;
+}
+
+/*!
+ * \brief Returns the reception stage an uplink reaches at a gateway
+ */
+static FleetSimRxStatus_t GatewayReceive( const FleetSimTx_t* tx, uint8_t gateway, bool locked,
+                                          const FleetSimTx_t* log, uint32_t nbLog )
+{
+    if( FleetSimChannelIsAboveSensitivity( tx->Rssi[gateway], tx->Sf, tx->Bandwidth ) == false )
+    {
+        return FLEET_SIM_RX_SENSITIVITY;
+    }
+    if( IsGatewayTransmitting( tx, gateway, log, nbLog, false ) == true )
+    {
+        return FLEET_SIM_RX_GATEWAY_BUSY;
+    }
+    if( locked == false )
+    {
+        return FLEET_SIM_RX_DEMODULATORS;
+    }
+    if( IsCollided( tx, gateway, log, nbLog ) == true )
+    {
+        return FLEET_SIM_RX_COLLISION;
+    }
+    return FLEET_SIM_RX_OK;
+}
+
+void FleetSimChannelInit( const FleetSimConfig_t* config )
+{
+    Config = config;
+
+    // First gateway at the center, the other ones spread at half the radius
+    GatewayX[0] = 0.0;
+    GatewayY[0] = 0.0;
+    for( uint8_t i = 1; i < Config->NbGateways; i++ )
+    {
+        double angle = ( 2.0 * M_PI * ( i - 1 ) ) / ( Config->NbGateways - 1 );
+
+        GatewayX[i] = 0.5 * Config->Radius * cos( angle );
+        GatewayY[i] = 0.5 * Config->Radius * sin( angle );
+    }
+}
+
+void FleetSimChannelPlaceDevice( uint32_t id, float pathLoss[FLEET_SIM_MAX_GATEWAYS] )
+{
+    uint32_t key = FleetSimHash( Config->Seed, id );
+    // Uniform placement over the disk
+    double r = Config->Radius * sqrt( Uniform( key, 0 ) );
+    double angle = 2.0 * M_PI * Uniform( key, 1 );
+    double x = r * cos( angle );
+    double y = r * sin( angle );
+
+    for( uint8_t i = 0; i < Config->NbGateways; i++ )
+    {
+        double distance = MAX( hypot( x - GatewayX[i], y - GatewayY[i] ), MIN_DISTANCE );
+
+        pathLoss[i] = ( float )( PATH_LOSS_REFERENCE +
+                                 10.0 * PATH_LOSS_EXPONENT * log10( distance / PATH_LOSS_REFERENCE_DISTANCE ) +
+                                 PATH_LOSS_SHADOWING * Gaussian( key, 2 + 2 * i ) );
+    }
+}
+
+float FleetSimChannelRequiredSnr( uint8_t sf )
+{
+    // 2.5 dB per spreading factor, -20 dB at SF12
+    return -20.0f + 2.5f * ( 12 - sf );
+}
+
+float FleetSimChannelSnr( float rssi, uint8_t bandwidth )
+{
+    float noiseFloor = -174.0f + 10.0f * log10f( ( float )( 125000 << bandwidth ) ) + NOISE_FIGURE;
+
+    return rssi - noiseFloor;
+}
+
+bool FleetSimChannelIsAboveSensitivity( float rssi, uint8_t sf, uint8_t bandwidth )
+{
+    return FleetSimChannelSnr( rssi, bandwidth ) >= FleetSimChannelRequiredSnr( sf );
+}
+
+bool FleetSimChannelIsReceived( const FleetSimTx_t* tx, const FleetSimTx_t* log, uint32_t nbLog, uint8_t* gateway )
+{
+    bool received = false;
+
+    for( uint8_t i = 0; i < Config->NbGateways; i++ )
+    {
+        bool locked = CanLock( tx, i, log, nbLog );
+
+        if( ( GatewayReceive( tx, i, locked, log, nbLog ) == FLEET_SIM_RX_OK ) &&
+            ( ( received == false ) || ( tx->Rssi[i] > tx->Rssi[*gateway] ) ) )
+        {
+            received = true;
+            *gateway = i;
+        }
+    }
+    return received;
+}
+
+void FleetSimChannelAssignLocks( FleetSimTx_t* log, uint32_t nbLog, uint64_t boundary )
+{
+    for( uint32_t i = 0; ( i < nbLog ) && ( log[i].Start < boundary ); i++ )
+    {
+        FleetSimTx_t* tx = &log[i];
+
+        if( ( tx->IsDownlink == true ) || ( tx->IsLockAssigned == true ) )
+        {
+            continue;
+        }
+        // The earlier uplinks already hold their demodulators
+        tx->Locked = 0;
+        for( uint8_t j = 0; j < Config->NbGateways; j++ )
+        {
+            if( CanLock( tx, j, log, nbLog ) == true )
+            {
+                tx->Locked |= 1 << j;
+            }
+        }
+        tx->IsLockAssigned = true;
+    }
+}
+
+FleetSimRxStatus_t FleetSimChannelResolve( const FleetSimTx_t* tx, const FleetSimTx_t* log, uint32_t nbLog )
+{
+    FleetSimRxStatus_t status = FLEET_SIM_RX_SENSITIVITY;
+
+    for( uint8_t i = 0; i < Config->NbGateways; i++ )
+    {
+        status = MIN( status, GatewayReceive( tx, i, ( tx->Locked & ( 1 << i ) ) != 0, log, nbLog ) );
+    }
+    return status;
+}
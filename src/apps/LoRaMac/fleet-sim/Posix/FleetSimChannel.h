@@ -0,0 +1,114 @@
+/*!
+ * \file      FleetSimChannel.h
+ *
+ * \brief     Network simulator radio channel and gateways model
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __FLEET_SIM_CHANNEL_H__
+#define __FLEET_SIM_CHANNEL_H__
+
+#include "FleetSim.h"
+
+/*!
+ * Minimum power ratio of an uplink to its co-channel interferers [dB]
+ */
+#define FLEET_SIM_CHANNEL_CAPTURE_THRESHOLD         6.0f
+
+/*!
+ * \brief Initializes the gateways positions
+ *
+ * \param [IN] config Simulation configuration
+ */
+void FleetSimChannelInit( const FleetSimConfig_t* config );
+
+/*!
+ * \brief Places a device and computes its path loss to the gateways
+ *
+ * \remark The position and the shadowing only depend on the seed and on the
+ *         device identifier.
+ *
+ * \param [IN]  id       Device identifier
+ * \param [OUT] pathLoss Path loss to each gateway [dB]
+ */
+void FleetSimChannelPlaceDevice( uint32_t id, float pathLoss[FLEET_SIM_MAX_GATEWAYS] );
+
+/*!
+ * \brief Returns the SNR a LoRa demodulator requires
+ *
+ * \param [IN] sf LoRa spreading factor
+ * \retval snr    Required SNR [dB]
+ */
+float FleetSimChannelRequiredSnr( uint8_t sf );
+
+/*!
+ * \brief Computes the SNR of a frame
+ *
+ * \param [IN] rssi      Frame RSSI [dBm]
+ * \param [IN] bandwidth LoRa bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \retval snr           SNR [dB]
+ */
+float FleetSimChannelSnr( float rssi, uint8_t bandwidth );
+
+/*!
+ * \brief Checks if a frame is above the sensitivity
+ *
+ * \param [IN] rssi      Frame RSSI [dBm]
+ * \param [IN] sf        LoRa spreading factor
+ * \param [IN] bandwidth LoRa bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \retval status        true if the frame can be demodulated
+ */
+bool FleetSimChannelIsAboveSensitivity( float rssi, uint8_t sf, uint8_t bandwidth );
+
+/*!
+ * \brief Estimates the reception of an uplink by the gateways
+ *
+ * \remark Used by the network server while the uplink epoch is running. Only
+ *         the transmissions of the past epochs are known, the uplink is not
+ *         part of the log.
+ *
+ * \param [IN]  tx      Uplink
+ * \param [IN]  log     Transmissions of the past epochs
+ * \param [IN]  nbLog   Number of logged transmissions
+ * \param [OUT] gateway Gateway receiving the uplink with the best RSSI
+ * \retval status       true if the uplink is received
+ */
+bool FleetSimChannelIsReceived( const FleetSimTx_t* tx, const FleetSimTx_t* log, uint32_t nbLog, uint8_t* gateway );
+
+/*!
+ * \brief Allocates the gateways demodulators to the uplinks starting before
+ *        the boundary
+ *
+ * \param [IN] log      Transmissions sorted by start time
+ * \param [IN] nbLog    Number of logged transmissions
+ * \param [IN] boundary All the transmissions starting before it are logged [ms]
+ */
+void FleetSimChannelAssignLocks( FleetSimTx_t* log, uint32_t nbLog, uint64_t boundary );
+
+/*!
+ * \brief Resolves the reception of a logged uplink
+ *
+ * \remark All the transmissions overlapping the uplink have to be logged and
+ *         their demodulators allocated.
+ *
+ * \param [IN] tx    Uplink, part of the log
+ * \param [IN] log   Transmissions
+ * \param [IN] nbLog Number of logged transmissions
+ * \retval status    Reception outcome
+ */
+FleetSimRxStatus_t FleetSimChannelResolve( const FleetSimTx_t* tx, const FleetSimTx_t* log, uint32_t nbLog );
+
+#endif // __FLEET_SIM_CHANNEL_H__
@@ -0,0 +1,350 @@
+/*!
+ * \file      FleetSimServer.c
+ *
+ * \brief     Network simulator LoRaWAN 1.0.x network server
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <math.h>
+#include "utilities.h"
+#include "aes.h"
+#include "cmac.h"
+#include "region/Region.h"
+#include "FleetSimChannel.h"
+#include "FleetSimServer.h"
+
+/*!
+ * Join request frame size
+ */
+#define JOIN_REQUEST_SIZE                           23
+
+/*!
+ * Join accept frame size, without CFList
+ */
+#define JOIN_ACCEPT_SIZE                            17
+
+/*!
+ * Smallest data frame size, MHDR, FHDR and MIC
+ */
+#define DATA_FRAME_MIN_SIZE                         12
+
+/*!
+ * LinkADRReq and LinkADRAns MAC commands identifier
+ */
+#define MAC_CMD_LINK_ADR                            0x03
+
+/*!
+ * LinkADRAns status with the channels mask, datarate and power acknowledged
+ */
+#define LINK_ADR_ANS_ALL_ACKED                      0x07
+
+/*!
+ * LinkADRReq ChMaskCntl turning all the 125 kHz channels of the fixed
+ * channel plans on
+ */
+#define LINK_ADR_CH_MASK_CNTL_ALL_ON                6
+
+/*!
+ * ADR limits of the regions, indexed by region
+ */
+static const struct
+{
+    int8_t MaxDatarate;                                 //! Highest 125 kHz LoRa datarate
+    int8_t MinTxPower;                                  //! Lowest Tx power index
+    bool IsFixedPlan;                                   //! Fixed channel plan
+}ServerRegions[] =
+{
+    [LORAMAC_REGION_AS923]  = { DR_5, TX_POWER_7, false },
+    [LORAMAC_REGION_AU915]  = { DR_5, TX_POWER_14, true },
+    [LORAMAC_REGION_CN470]  = { DR_5, TX_POWER_7, true },
+    [LORAMAC_REGION_CN779]  = { DR_5, TX_POWER_5, false },
+    [LORAMAC_REGION_EU433]  = { DR_5, TX_POWER_5, false },
+    [LORAMAC_REGION_EU868]  = { DR_5, TX_POWER_7, false },
+    [LORAMAC_REGION_KR920]  = { DR_5, TX_POWER_7, false },
+    [LORAMAC_REGION_IN865]  = { DR_5, TX_POWER_10, false },
+    [LORAMAC_REGION_US915]  = { DR_3, TX_POWER_14, true },
+    [LORAMAC_REGION_RU864]  = { DR_5, TX_POWER_7, false },
+    [LORAMAC_REGION_CUSTOM] = { DR_5, TX_POWER_7, false },
+};
+
+static void WriteLe( uint8_t* buffer, uint32_t value, uint8_t size )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        buffer[i] = ( value >> ( 8 * i ) ) & 0xFF;
+    }
+}
+
+static uint32_t ReadLe( const uint8_t* buffer, uint8_t size )
+{
+    uint32_t value = 0;
+
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        value |= ( uint32_t )buffer[i] << ( 8 * i );
+    }
+    return value;
+}
+
+/*!
+ * \brief Computes a frame MIC
+ *
+ * \param [IN]  key    AES-CMAC key
+ * \param [IN]  b0     B0 block, NULL for the join frames
+ * \param [IN]  buffer Frame
+ * \param [IN]  size   Frame size, MIC excluded
+ * \param [OUT] mic    Frame MIC
+ */
+static void ComputeMic( const uint8_t* key, const uint8_t* b0, const uint8_t* buffer, uint8_t size, uint8_t* mic )
+{
+    AES_CMAC_CTX ctx;
+    uint8_t digest[AES_CMAC_DIGEST_LENGTH];
+
+    AES_CMAC_Init( &ctx );
+    AES_CMAC_SetKey( &ctx, key );
+    if( b0 != NULL )
+    {
+        AES_CMAC_Update( &ctx, b0, 16 );
+    }
+    AES_CMAC_Update( &ctx, buffer, size );
+    AES_CMAC_Final( digest, &ctx );
+    memcpy1( mic, digest, 4 );
+}
+
+/*!
+ * \brief Answers a join request, the device joins a LoRaWAN 1.0.x network
+ */
+static uint8_t JoinAccept( FleetSimServerDevice_t* device, const uint8_t* frame, uint8_t size, uint8_t* downlink )
+{
+    MibRequestConfirm_t mibReq;
+    aes_context aesCtx;
+    uint8_t buffer[JOIN_ACCEPT_SIZE];
+    uint8_t keyBase[16] = { 0 };
+
+    if( size != JOIN_REQUEST_SIZE )
+    {
+        return 0;
+    }
+
+    mibReq.Type = MIB_RX2_DEFAULT_CHANNEL;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+
+    device->JoinNonce++;
+
+    buffer[0] = FRAME_TYPE_JOIN_ACCEPT << 5;
+    WriteLe( &buffer[1], device->JoinNonce, 3 );
+    WriteLe( &buffer[4], FLEET_SIM_SERVER_NET_ID, 3 );
+    WriteLe( &buffer[7], device->DevAddr, 4 );
+    // RX1 datarate offset 0, OptNeg 0
+    buffer[11] = mibReq.Param.Rx2DefaultChannel.Datarate & 0x0F;
+    // 1 s RX1 delay
+    buffer[12] = 1;
+    ComputeMic( device->NwkKey, NULL, buffer, 13, &buffer[13] );
+
+    // The device encrypts the join accept to recover it
+    memset1( ( uint8_t* )&aesCtx, 0, sizeof( aesCtx ) );
+    aes_set_key( device->NwkKey, 16, &aesCtx );
+    downlink[0] = buffer[0];
+    aes_decrypt( &buffer[1], &downlink[1], &aesCtx );
+
+    // NwkSKey = aes128_encrypt( NwkKey, 0x01 | JoinNonce | NetID | DevNonce | pad16 )
+    keyBase[0] = 0x01;
+    memcpy1( &keyBase[1], &buffer[1], 6 );
+    memcpy1( &keyBase[7], &frame[17], 2 );
+    aes_encrypt( keyBase, device->NwkSKey, &aesCtx );
+
+    device->FCntDown = 0;
+    device->NbSnr = 0;
+    device->SnrIndex = 0;
+    device->IsAdrRejected = false;
+    return JOIN_ACCEPT_SIZE;
+}
+
+/*!
+ * \brief Runs the network server ADR algorithm
+ *
+ * \param [IN]  device    Network server device context
+ * \param [IN]  sf        Uplink spreading factor
+ * \param [OUT] linkAdr   LinkADRReq MAC command
+ * \retval status         true if the device has to change its settings
+ */
+static bool ComputeAdr( FleetSimServerDevice_t* device, uint8_t sf, uint8_t* linkAdr )
+{
+    MibRequestConfirm_t mibReq;
+    float snrMax = -INFINITY;
+    int8_t currentDatarate;
+    int8_t currentTxPower;
+    int8_t datarate;
+    int8_t txPower;
+    int8_t nbSteps;
+    uint16_t chMask;
+    uint8_t chMaskCntl = 0;
+
+    if( device->NbSnr < FLEET_SIM_SERVER_ADR_HISTORY )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < FLEET_SIM_SERVER_ADR_HISTORY; i++ )
+    {
+        snrMax = MAX( snrMax, device->SnrHistory[i] );
+    }
+
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    currentDatarate = mibReq.Param.ChannelsDatarate;
+    mibReq.Type = MIB_CHANNELS_TX_POWER;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    currentTxPower = mibReq.Param.ChannelsTxPower;
+
+    datarate = currentDatarate;
+    txPower = currentTxPower;
+
+    // One step per 3 dB of margin: datarate increase first, then power decrease
+    nbSteps = ( int8_t )floorf( ( snrMax - FleetSimChannelRequiredSnr( sf ) - FLEET_SIM_SERVER_ADR_MARGIN ) / 3.0f );
+    while( ( nbSteps > 0 ) && ( datarate < ServerRegions[device->Region].MaxDatarate ) )
+    {
+        datarate++;
+        nbSteps--;
+    }
+    while( ( nbSteps > 0 ) && ( txPower < ServerRegions[device->Region].MinTxPower ) )
+    {
+        txPower++;
+        nbSteps--;
+    }
+    while( ( nbSteps < 0 ) && ( txPower > 0 ) )
+    {
+        txPower--;
+        nbSteps++;
+    }
+
+    if( ( datarate == currentDatarate ) && ( txPower == currentTxPower ) )
+    {
+        return false;
+    }
+
+    // Keep the enabled channels
+    mibReq.Type = MIB_CHANNELS_MASK;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+    if( ServerRegions[device->Region].IsFixedPlan == true )
+    {
+        chMaskCntl = LINK_ADR_CH_MASK_CNTL_ALL_ON;
+        chMask = mibReq.Param.ChannelsMask[4] & 0x00FF;
+    }
+    else
+    {
+        chMask = mibReq.Param.ChannelsMask[0];
+    }
+
+    linkAdr[0] = MAC_CMD_LINK_ADR;
+    linkAdr[1] = ( datarate << 4 ) | ( txPower & 0x0F );
+    WriteLe( &linkAdr[2], chMask, 2 );
+    linkAdr[4] = ( chMaskCntl << 4 ) | 1;
+    return true;
+}
+
+void FleetSimServerInitDevice( FleetSimServerDevice_t* device, LoRaMacRegion_t region, uint32_t id, uint32_t seed )
+{
+    memset1( ( uint8_t* )device, 0, sizeof( FleetSimServerDevice_t ) );
+
+    device->Region = region;
+    WriteLe( &device->NwkKey[0], id, 4 );
+    WriteLe( &device->NwkKey[4], seed, 4 );
+    for( uint8_t i = 8; i < 16; i++ )
+    {
+        device->NwkKey[i] = 0xA5 ^ i;
+    }
+    memcpy1( device->NwkSKey, device->NwkKey, 16 );
+    device->NwkSKey[15] ^= 0x01;
+
+    // Type 0 NetID, the NwkID takes the 7 address MSBs
+    device->DevAddr = ( ( uint32_t )( FLEET_SIM_SERVER_NET_ID & 0x7F ) << 25 ) | ( id & 0x01FFFFFF );
+}
+
+uint8_t FleetSimServerProcessUplink( FleetSimServerDevice_t* device, const uint8_t* frame, uint8_t size, uint8_t sf,
+                                     float snr, bool adrOn, uint8_t* downlink )
+{
+    LoRaMacFrameType_t mType = ( LoRaMacFrameType_t )( frame[0] >> 5 );
+    uint8_t fCtrl;
+    uint8_t fOptsLen;
+    uint8_t fOpts[15];
+    uint8_t nbFOpts = 0;
+    bool ack;
+    uint8_t b0[16] = { 0 };
+    uint8_t dlSize = 0;
+
+    if( mType == FRAME_TYPE_JOIN_REQ )
+    {
+        return JoinAccept( device, frame, size, downlink );
+    }
+    if( ( ( mType != FRAME_TYPE_DATA_UNCONFIRMED_UP ) && ( mType != FRAME_TYPE_DATA_CONFIRMED_UP ) ) ||
+        ( size < DATA_FRAME_MIN_SIZE ) || ( ReadLe( &frame[1], 4 ) != device->DevAddr ) )
+    {
+        return 0;
+    }
+
+    fCtrl = frame[5];
+    fOptsLen = MIN( fCtrl & 0x0F, size - DATA_FRAME_MIN_SIZE );
+    ack = ( mType == FRAME_TYPE_DATA_CONFIRMED_UP );
+
+    // LoRaWAN 1.0.x FOpts are not encrypted. The LinkADRAns is the only
+    // answer the devices can send, followed by no other command.
+    for( uint8_t i = 0; i < fOptsLen; i++ )
+    {
+        if( ( frame[8 + i] == MAC_CMD_LINK_ADR ) && ( ( i + 1 ) < fOptsLen ) &&
+            ( ( frame[9 + i] & LINK_ADR_ANS_ALL_ACKED ) != LINK_ADR_ANS_ALL_ACKED ) )
+        {
+            device->IsAdrRejected = true;
+        }
+    }
+
+    device->SnrHistory[device->SnrIndex] = snr;
+    device->SnrIndex = ( device->SnrIndex + 1 ) % FLEET_SIM_SERVER_ADR_HISTORY;
+    device->NbSnr = MIN( device->NbSnr + 1, FLEET_SIM_SERVER_ADR_HISTORY );
+
+    // ADR bit set by the device
+    if( ( adrOn == true ) && ( ( fCtrl & 0x80 ) != 0 ) && ( device->IsAdrRejected == false ) &&
+        ( ComputeAdr( device, sf, &fOpts[nbFOpts] ) == true ) )
+    {
+        nbFOpts += 5;
+    }
+
+    // Answer the confirmed uplinks, the ADRACKReq and the MAC commands
+    if( ( ack == false ) && ( nbFOpts == 0 ) && ( ( fCtrl & 0x40 ) == 0 ) )
+    {
+        return 0;
+    }
+
+    downlink[dlSize++] = FRAME_TYPE_DATA_UNCONFIRMED_DOWN << 5;
+    WriteLe( &downlink[dlSize], device->DevAddr, 4 );
+    dlSize += 4;
+    downlink[dlSize++] = ( ( ack == true ) ? 0x20 : 0x00 ) | nbFOpts;
+    WriteLe( &downlink[dlSize], device->FCntDown, 2 );
+    dlSize += 2;
+    memcpy1( &downlink[dlSize], fOpts, nbFOpts );
+    dlSize += nbFOpts;
+
+    // B0 = 0x49 | 4 x 0x00 | Dir | DevAddr | FCntDown | 0x00 | Len
+    b0[0] = 0x49;
+    b0[5] = 0x01;
+    WriteLe( &b0[6], device->DevAddr, 4 );
+    WriteLe( &b0[10], device->FCntDown, 4 );
+    b0[15] = dlSize;
+    ComputeMic( device->NwkSKey, b0, downlink, dlSize, &downlink[dlSize] );
+    dlSize += 4;
+
+    device->FCntDown++;
+    return dlSize;
+}
@@ -0,0 +1,91 @@
+/*!
+ * \file      FleetSimServer.h
+ *
+ * \brief     Network simulator LoRaWAN 1.0.x network server
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __FLEET_SIM_SERVER_H__
+#define __FLEET_SIM_SERVER_H__
+
+#include "FleetSim.h"
+
+/*!
+ * Number of uplinks SNR the ADR algorithm is run over
+ */
+#define FLEET_SIM_SERVER_ADR_HISTORY                20
+
+/*!
+ * ADR installation margin [dB]
+ */
+#define FLEET_SIM_SERVER_ADR_MARGIN                 10.0f
+
+/*!
+ * Network identifier
+ */
+#define FLEET_SIM_SERVER_NET_ID                     0x000013
+
+/*!
+ * Network server device context
+ */
+typedef struct sFleetSimServerDevice
+{
+    LoRaMacRegion_t Region;                             //! Device region
+    uint8_t NwkKey[16];                                 //! Root key
+    uint8_t NwkSKey[16];                                //! Network session key
+    uint32_t DevAddr;                                   //! Device address
+    uint32_t FCntDown;                                  //! Next downlink frame counter
+    uint32_t JoinNonce;                                 //! Last join nonce
+    float SnrHistory[FLEET_SIM_SERVER_ADR_HISTORY];     //! SNR of the last received uplinks [dB]
+    uint8_t NbSnr;                                      //! Number of valid SNR history entries
+    uint8_t SnrIndex;                                   //! Next SNR history entry
+    bool IsAdrRejected;                                 //! Set when the device refuses a LinkADRReq
+}FleetSimServerDevice_t;
+
+/*!
+ * \brief Provisions a device
+ *
+ * \remark The root key and the device address only depend on the seed and on
+ *         the device identifier. The ABP session key is derived from the root
+ *         key.
+ *
+ * \param [OUT] device Network server device context
+ * \param [IN]  region Device region
+ * \param [IN]  id     Device identifier
+ * \param [IN]  seed   Simulation seed
+ */
+void FleetSimServerInitDevice( FleetSimServerDevice_t* device, LoRaMacRegion_t region, uint32_t id, uint32_t seed );
+
+/*!
+ * \brief Processes an uplink received by a gateway and builds the RX1 answer
+ *
+ * \remark The device LoRaMac instance has to be the active one. Its datarate,
+ *         Tx power and channels mask stand for the gateway metadata and the
+ *         device profile a network server keeps.
+ *
+ * \param [IN]  device   Network server device context
+ * \param [IN]  frame    Uplink frame
+ * \param [IN]  size     Uplink frame size
+ * \param [IN]  sf       Uplink spreading factor
+ * \param [IN]  snr      Uplink SNR at the receiving gateway [dB]
+ * \param [IN]  adrOn    Runs the ADR algorithm when the device requests it
+ * \param [OUT] downlink Downlink frame, LoRaMac maximum frame size
+ * \retval size          Downlink frame size, 0 if nothing has to be sent
+ */
+uint8_t FleetSimServerProcessUplink( FleetSimServerDevice_t* device, const uint8_t* frame, uint8_t size, uint8_t sf,
+                                     float snr, bool adrOn, uint8_t* downlink );
+
+#endif // __FLEET_SIM_SERVER_H__
@@ -0,0 +1,662 @@
+/*!
+ * \file      FleetSimWorker.c
+ *
+ * \brief     Network simulator worker process, runs a share of the devices
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "utilities.h"
+#include "board.h"
+#include "LoRaMac.h"
+#include "secure-element.h"
+#include "Region.h"
+#include "secure-element.h"
+#include "rtc-sim.h"
+#include "sim-radio.h"
+#include "FleetSimChannel.h"
+#include "FleetSimServer.h"
+#include "FleetSimWorker.h"
+
+/*!
+ * Application port of the uplinks
+ */
+#define APP_PORT                                    2
+
+/*!
+ * Number of trials of the confirmed uplinks
+ */
+#define CONFIRMED_NB_TRIALS                         8
+
+/*!
+ * Minimal delay before a device retries a join [ms]
+ */
+#define JOIN_RETRY_DELAY                            10000
+
+/*!
+ * Minimal delay before a device retries a duty-cycle restricted request [ms]
+ */
+#define DUTY_CYCLE_RETRY_DELAY                      1000
+
+/*!
+ * Simulated device
+ */
+typedef struct sFleetSimDevice
+{
+    uint32_t Id;                                        //! Device identifier
+    LoRaMacRegion_t Region;                             //! Device region
+    const FleetSimProfile_t* Profile;                   //! Traffic profile
+    LoRaMacHandle_t Handle;                             //! LoRaMac instance
+    uint64_t NextWake;                                  //! Virtual time of the next transaction [ms]
+    uint64_t FirstJoinTime;                             //! Virtual time of the first join request [ms]
+    uint32_t NbTransactions;                            //! Number of run transactions
+    float PathLoss[FLEET_SIM_MAX_GATEWAYS];             //! Path loss to the gateways [dB]
+    float GatewayPower;                                 //! Gateways Tx power, region default max EIRP [dBm]
+    FleetSimServerDevice_t Server;                      //! Network server context
+    FleetSimDeviceStats_t* Stats;                       //! Shared results
+}FleetSimDevice_t;
+
+const FleetSimProfile_t FleetSimProfiles[FLEET_SIM_NB_PROFILES] =
+{
+    { "meter",   3600, 12, 0,   70 },
+    { "tracker", 300,  24, 0,   25 },
+    { "alarm",   900,  4,  100, 5 },
+};
+
+/*!
+ * Simulation configuration
+ */
+static const FleetSimConfig_t* Config;
+
+/*!
+ * Shared memory map
+ */
+static FleetSimMemory_t* Memory;
+
+/*!
+ * Worker index
+ */
+static uint32_t Worker;
+
+/*!
+ * Devices run by the worker
+ */
+static FleetSimDevice_t* Devices;
+static uint32_t NbDevices;
+
+/*!
+ * Devices min-heap, ordered by next transaction time
+ */
+static FleetSimDevice_t** Heap;
+
+/*!
+ * Device running a transaction
+ */
+static FleetSimDevice_t* ActiveDevice = NULL;
+
+/*!
+ * Set once the MAC confirms the running transaction request
+ */
+static bool IsTransactionDone;
+
+/*!
+ * Last uplink of the active device, answered in the next RX1 window
+ */
+static FleetSimTx_t Uplink;
+static uint8_t UplinkFrame[SIM_RADIO_MAX_PAYLOAD];
+static uint8_t UplinkSize;
+static bool IsRx1Pending;
+
+/*!
+ * Network server answer
+ */
+static uint8_t Downlink[SIM_RADIO_MAX_PAYLOAD];
+
+/*!
+ * Application payload, content is irrelevant
+ */
+static uint8_t Payload[SIM_RADIO_MAX_PAYLOAD];
+
+/*!
+ * LoRaMac primitives and callbacks, shared by the instances
+ */
+static LoRaMacPrimitives_t MacPrimitives;
+static LoRaMacCallback_t MacCallbacks;
+
+/*!
+ * \brief Logs a transmission for the coordinator
+ *
+ * \remark The transmissions not fitting in the log are counted by the
+ *         coordinator as dropped.
+ */
+static void LogTx( const FleetSimTx_t* tx )
+{
+    uint32_t index = Memory->Shared->NbPending[Worker]++;
+
+    if( index < Memory->Shared->PendingCapacity )
+    {
+        Memory->Pending[( Worker * Memory->Shared->PendingCapacity ) + index] = *tx;
+    }
+}
+
+static void OnRadioTx( uint32_t freq, uint8_t sf, uint8_t *buffer, uint8_t size )
+{
+    FleetSimDevice_t* dev = ActiveDevice;
+    int8_t power;
+    uint32_t bandwidth;
+
+    if( dev == NULL )
+    {
+        return;
+    }
+
+    memset1( ( uint8_t* )&Uplink, 0, sizeof( FleetSimTx_t ) );
+    Uplink.Duration = SimRadioGetTxSettings( &power, &bandwidth );
+    Uplink.Start = RtcSimGetTime( );
+    Uplink.Frequency = freq;
+    Uplink.DeviceId = dev->Id;
+    Uplink.Sf = sf;
+    Uplink.Bandwidth = bandwidth;
+    Uplink.IsJoinRequest = ( buffer[0] >> 5 ) == FRAME_TYPE_JOIN_REQ;
+    for( uint8_t i = 0; i < Config->NbGateways; i++ )
+    {
+        Uplink.Rssi[i] = power - dev->PathLoss[i];
+    }
+    LogTx( &Uplink );
+
+    dev->Stats->Uplinks++;
+    dev->Stats->AirTime += Uplink.Duration;
+    if( Uplink.IsJoinRequest == true )
+    {
+        dev->Stats->JoinRequests++;
+    }
+
+    memcpy1( UplinkFrame, buffer, size );
+    UplinkSize = size;
+    IsRx1Pending = true;
+}
+
+static void OnRadioRx( uint32_t freq, uint8_t sf )
+{
+    FleetSimDevice_t* dev = ActiveDevice;
+    FleetSimTx_t dl;
+    uint8_t gateway = 0;
+    uint8_t size;
+    float rssi;
+
+    // The network server answers in RX1 only
+    if( ( dev == NULL ) || ( IsRx1Pending == false ) )
+    {
+        return;
+    }
+    IsRx1Pending = false;
+
+    if( FleetSimChannelIsReceived( &Uplink, Memory->Visible, Memory->Shared->NbVisible, &gateway ) == false )
+    {
+        return;
+    }
+    dev->Stats->UplinksReceived++;
+
+    size = FleetSimServerProcessUplink( &dev->Server, UplinkFrame, UplinkSize, Uplink.Sf,
+                                        FleetSimChannelSnr( Uplink.Rssi[gateway], Uplink.Bandwidth ), Config->AdrOn,
+                                        Downlink );
+    if( size == 0 )
+    {
+        return;
+    }
+
+    memset1( ( uint8_t* )&dl, 0, sizeof( FleetSimTx_t ) );
+    dl.Start = RtcSimGetTime( );
+    dl.Bandwidth = SimRadioGetRxBandwidth( );
+    dl.Duration = SimRadioLoRaTimeOnAir( dl.Bandwidth, sf, false, size );
+    dl.Frequency = freq;
+    dl.DeviceId = dev->Id;
+    dl.Sf = sf;
+    dl.Gateway = gateway;
+    dl.IsDownlink = true;
+    LogTx( &dl );
+
+    rssi = dev->GatewayPower - dev->PathLoss[gateway];
+    if( FleetSimChannelIsAboveSensitivity( rssi, sf, dl.Bandwidth ) == true )
+    {
+        SimRadioQueueRxFrame( Downlink, size, ( int16_t )rssi, ( int8_t )FleetSimChannelSnr( rssi, dl.Bandwidth ) );
+    }
+}
+
+/*!
+ * Simulated radio hooks
+ */
+static SimRadioHooks_t RadioHooks =
+{
+    .OnTx = OnRadioTx,
+    .OnRx = OnRadioRx,
+};
+
+static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+    if( ( mcpsConfirm->McpsRequest == MCPS_CONFIRMED ) && ( mcpsConfirm->AckReceived == true ) )
+    {
+        ActiveDevice->Stats->Acked++;
+    }
+    IsTransactionDone = true;
+}
+
+static void McpsIndication( McpsIndication_t *mcpsIndication )
+{
+    if( mcpsIndication->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        ActiveDevice->Stats->Downlinks++;
+    }
+}
+
+static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+    FleetSimDevice_t* dev = ActiveDevice;
+
+    if( mlmeConfirm->MlmeRequest != MLME_JOIN )
+    {
+        return;
+    }
+    if( mlmeConfirm->Status == LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        dev->Stats->IsJoined = true;
+        dev->Stats->Downlinks++;
+        dev->Stats->JoinDelay = ( uint32_t )( RtcSimGetTime( ) - dev->FirstJoinTime );
+    }
+    IsTransactionDone = true;
+}
+
+static void MlmeIndication( MlmeIndication_t *mlmeIndication )
+{
+}
+
+/*!
+ * \brief Checks if a device transaction comes before another one
+ */
+static bool IsEarlier( const FleetSimDevice_t* a, const FleetSimDevice_t* b )
+{
+    return ( a->NextWake < b->NextWake ) || ( ( a->NextWake == b->NextWake ) && ( a->Id < b->Id ) );
+}
+
+/*!
+ * \brief Restores the heap order below a node
+ */
+static void HeapSiftDown( uint32_t index )
+{
+    while( true )
+    {
+        uint32_t smallest = index;
+        uint32_t left = ( 2 * index ) + 1;
+        uint32_t right = left + 1;
+        FleetSimDevice_t* tmp;
+
+        if( ( left < NbDevices ) && ( IsEarlier( Heap[left], Heap[smallest] ) == true ) )
+        {
+            smallest = left;
+        }
+        if( ( right < NbDevices ) && ( IsEarlier( Heap[right], Heap[smallest] ) == true ) )
+        {
+            smallest = right;
+        }
+        if( smallest == index )
+        {
+            return;
+        }
+        tmp = Heap[index];
+        Heap[index] = Heap[smallest];
+        Heap[smallest] = tmp;
+        index = smallest;
+    }
+}
+
+/*!
+ * \brief Aborts the worker
+ */
+static void Fatal( const char* message, uint32_t id )
+{
+    fprintf( stderr, "Worker %lu, device %lu: %s\r\n", ( unsigned long )Worker, ( unsigned long )id, message );
+    exit( EXIT_FAILURE );
+}
+
+/*!
+ * \brief Creates the device LoRaMac instance and provisions it
+ */
+static void InitDevice( FleetSimDevice_t* dev, uint32_t id )
+{
+    MibRequestConfirm_t mibReq;
+    GetPhyParams_t getPhy;
+    // The secure element copies SE_EUI_SIZE bytes
+    uint8_t devEui[SE_EUI_SIZE];
+    uint8_t joinEui[SE_EUI_SIZE] = { 0 };
+    uint32_t share = FleetSimHash( Config->Seed ^ 0x50524F46, id ) % 100;
+    uint32_t window;
+
+    dev->Id = id;
+    dev->Stats = &Memory->Stats[id];
+    dev->Stats->Region = id % Config->NbRegions;
+    dev->Region = Config->Regions[dev->Stats->Region];
+    dev->Profile = &FleetSimProfiles[FLEET_SIM_NB_PROFILES - 1];
+    for( uint8_t i = 0; i < FLEET_SIM_NB_PROFILES; i++ )
+    {
+        if( share < FleetSimProfiles[i].Share )
+        {
+            dev->Profile = &FleetSimProfiles[i];
+            break;
+        }
+        share -= FleetSimProfiles[i].Share;
+    }
+    FleetSimChannelPlaceDevice( id, dev->PathLoss );
+    FleetSimServerInitDevice( &dev->Server, dev->Region, id, Config->Seed );
+
+    dev->Handle = calloc( 1, LoRaMacInstanceGetSize( dev->Region ) );
+    if( dev->Handle == NULL )
+    {
+        Fatal( "LoRaMac instance allocation failed", id );
+    }
+    if( ( LoRaMacInstanceSelect( dev->Handle ) != LORAMAC_STATUS_OK ) || ( RtcSimSetTime( 0 ) == false ) ||
+        ( LoRaMacInitialization( &MacPrimitives, &MacCallbacks, dev->Region ) != LORAMAC_STATUS_OK ) )
+    {
+        Fatal( "LoRaMac initialization failed", id );
+    }
+
+    getPhy.Attribute = PHY_DEF_MAX_EIRP;
+    dev->GatewayPower = RegionGetPhyParam( dev->Region, &getPhy ).fValue;
+
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = Config->AdrOn;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_PUBLIC_NETWORK;
+    mibReq.Param.EnablePublicNetwork = true;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    memset1( devEui, 0, sizeof( devEui ) );
+    memcpy1( devEui, ( uint8_t* )&id, sizeof( id ) );
+    mibReq.Type = MIB_DEV_EUI;
+    mibReq.Param.DevEui = devEui;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_JOIN_EUI;
+    mibReq.Param.JoinEui = joinEui;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    if( Config->Otaa == true )
+    {
+        mibReq.Type = MIB_NWK_KEY;
+        mibReq.Param.NwkKey = dev->Server.NwkKey;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        // Spread the join requests over the join window
+        window = Config->JoinSpread * 1000;
+    }
+    else
+    {
+        mibReq.Type = MIB_ABP_LORAWAN_VERSION;
+        mibReq.Param.AbpLrWanVersion.Fields.Major = 1;
+        mibReq.Param.AbpLrWanVersion.Fields.Minor = 0;
+        mibReq.Param.AbpLrWanVersion.Fields.Revision = 4;
+        mibReq.Param.AbpLrWanVersion.Fields.Rfu = 0;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_NET_ID;
+        mibReq.Param.NetID = FLEET_SIM_SERVER_NET_ID;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_DEV_ADDR;
+        mibReq.Param.DevAddr = dev->Server.DevAddr;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_F_NWK_S_INT_KEY;
+        mibReq.Param.FNwkSIntKey = dev->Server.NwkSKey;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_S_NWK_S_INT_KEY;
+        mibReq.Param.SNwkSIntKey = dev->Server.NwkSKey;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_NWK_S_ENC_KEY;
+        mibReq.Param.NwkSEncKey = dev->Server.NwkSKey;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_APP_S_KEY;
+        mibReq.Param.AppSKey = dev->Server.NwkSKey;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_NETWORK_ACTIVATION;
+        mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        dev->Stats->IsJoined = true;
+
+        // Spread the first uplinks over the device period
+        window = dev->Profile->Period * 1000;
+    }
+
+    LoRaMacStart( );
+
+    dev->NextWake = ( window > 0 ) ? ( FleetSimHash( Config->Seed ^ 0x57414B45, id ) % window ) : 0;
+}
+
+/*!
+ * \brief Requests the device join
+ */
+static LoRaMacStatus_t Join( FleetSimDevice_t* dev )
+{
+    MibRequestConfirm_t mibReq;
+    MlmeReq_t mlmeReq;
+
+    mibReq.Type = MIB_CHANNELS_DEFAULT_DATARATE;
+    LoRaMacMibGetRequestConfirm( &mibReq );
+
+    mlmeReq.Type = MLME_JOIN;
+    mlmeReq.Req.Join.Datarate = mibReq.Param.ChannelsDefaultDatarate;
+
+    if( dev->Stats->JoinRequests == 0 )
+    {
+        dev->FirstJoinTime = RtcSimGetTime( );
+    }
+    return LoRaMacMlmeRequest( &mlmeReq );
+}
+
+/*!
+ * \brief Requests the device uplink
+ */
+static LoRaMacStatus_t Send( FleetSimDevice_t* dev )
+{
+    McpsReq_t mcpsReq;
+    LoRaMacTxInfo_t txInfo;
+    LoRaMacStatus_t status;
+    uint8_t size = dev->Profile->PayloadSize;
+    bool confirmed = randr( 0, 99 ) < dev->Profile->ConfirmedRatio;
+
+    if( LoRaMacQueryTxPossible( size, &txInfo ) != LORAMAC_STATUS_OK )
+    {
+        // The payload does not fit at the current datarate, flush the MAC commands
+        size = 0;
+    }
+
+    if( ( confirmed == true ) && ( size > 0 ) )
+    {
+        mcpsReq.Type = MCPS_CONFIRMED;
+        mcpsReq.Req.Confirmed.fPort = APP_PORT;
+        mcpsReq.Req.Confirmed.fBuffer = Payload;
+        mcpsReq.Req.Confirmed.fBufferSize = size;
+        mcpsReq.Req.Confirmed.NbTrials = CONFIRMED_NB_TRIALS;
+        mcpsReq.Req.Confirmed.Datarate = DR_0;
+    }
+    else
+    {
+        confirmed = false;
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = APP_PORT;
+        // An empty frame still needs a buffer to be encrypted
+        mcpsReq.Req.Unconfirmed.fBuffer = Payload;
+        mcpsReq.Req.Unconfirmed.fBufferSize = size;
+        mcpsReq.Req.Unconfirmed.Datarate = DR_0;
+    }
+
+    status = LoRaMacMcpsRequest( &mcpsReq );
+    if( status == LORAMAC_STATUS_OK )
+    {
+        dev->Stats->Requests++;
+        if( confirmed == true )
+        {
+            dev->Stats->ConfirmedRequests++;
+        }
+    }
+    return status;
+}
+
+/*!
+ * \brief Runs a device transaction and schedules the next one
+ *
+ * \remark The device runs on its own time line, from the request up to the
+ *         end of the last RX window, retransmissions included.
+ */
+static void RunTransaction( FleetSimDevice_t* dev )
+{
+    LoRaMacStatus_t status;
+    LoRaMacTxInfo_t txInfo;
+    uint64_t start = dev->NextWake;
+    bool isJoin = dev->Stats->IsJoined == false;
+    int32_t period = dev->Profile->Period * 1000;
+    uint64_t now;
+
+    if( ( LoRaMacInstanceSelect( dev->Handle ) != LORAMAC_STATUS_OK ) || ( RtcSimSetTime( start ) == false ) )
+    {
+        Fatal( "LoRaMac instance not idle", dev->Id );
+    }
+
+    // The device draws the same numbers whatever the worker running it
+    srand1( FleetSimHash( Config->Seed ^ dev->Id, dev->NbTransactions++ ) );
+
+    ActiveDevice = dev;
+    IsTransactionDone = false;
+    IsRx1Pending = false;
+
+    status = ( isJoin == true ) ? Join( dev ) : Send( dev );
+    if( status == LORAMAC_STATUS_OK )
+    {
+        LoRaMacProcess( );
+        while( ( IsTransactionDone == false ) || ( LoRaMacIsBusy( ) == true ) )
+        {
+            if( RtcSimAdvanceToAlarm( ) == false )
+            {
+                break;
+            }
+            LoRaMacProcess( );
+        }
+    }
+    ActiveDevice = NULL;
+
+    now = RtcSimGetTime( );
+    if( isJoin == true )
+    {
+        if( dev->Stats->IsJoined == true )
+        {
+            // First uplink within a period after the join
+            dev->NextWake = now + randr( 1000, period );
+        }
+        else
+        {
+            // Join failed or restricted by the join back-off
+            dev->Stats->DutyCycleRestricted += ( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED ) ? 1 : 0;
+            dev->NextWake = now + randr( JOIN_RETRY_DELAY, 2 * JOIN_RETRY_DELAY );
+        }
+    }
+    else if( status == LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
+    {
+        dev->Stats->DutyCycleRestricted++;
+        LoRaMacQueryTxPossible( 0, &txInfo );
+        dev->NextWake = now + MAX( txInfo.NextTxDelay, DUTY_CYCLE_RETRY_DELAY );
+    }
+    else
+    {
+        dev->NextWake = MAX( start + period + randr( -period / 10, period / 10 ), now + 1 );
+    }
+}
+
+int FleetSimWorkerRun( const FleetSimConfig_t* config, FleetSimMemory_t* memory, uint32_t worker )
+{
+    FleetSimShared_t* shared = memory->Shared;
+    uint64_t duration = ( uint64_t )config->Duration * 1000;
+    MibRequestConfirm_t mibReq;
+
+    Config = config;
+    Memory = memory;
+    Worker = worker;
+
+    BoardInitMcu( );
+    FleetSimChannelInit( Config );
+    SimRadioSetHooks( &RadioHooks );
+
+    MacPrimitives.MacMcpsConfirm = McpsConfirm;
+    MacPrimitives.MacMcpsIndication = McpsIndication;
+    MacPrimitives.MacMlmeConfirm = MlmeConfirm;
+    MacPrimitives.MacMlmeIndication = MlmeIndication;
+    MacCallbacks.GetBatteryLevel = BoardGetBatteryLevel;
+    MacCallbacks.GetTemperatureLevel = NULL;
+    MacCallbacks.NvmContextChange = NULL;
+    MacCallbacks.MacProcessNotify = NULL;
+
+    NbDevices = ( Config->NbDevices - Worker + Config->NbWorkers - 1 ) / Config->NbWorkers;
+    Devices = calloc( NbDevices, sizeof( FleetSimDevice_t ) );
+    Heap = calloc( NbDevices, sizeof( FleetSimDevice_t* ) );
+    if( ( NbDevices > 0 ) && ( ( Devices == NULL ) || ( Heap == NULL ) ) )
+    {
+        Fatal( "devices allocation failed", Worker );
+    }
+    for( uint32_t i = 0; i < NbDevices; i++ )
+    {
+        InitDevice( &Devices[i], Worker + ( i * Config->NbWorkers ) );
+        Heap[i] = &Devices[i];
+    }
+    for( uint32_t i = NbDevices / 2; i-- > 0; )
+    {
+        HeapSiftDown( i );
+    }
+
+    while( true )
+    {
+        // Wait for the coordinator to open the next epoch
+        pthread_barrier_wait( &shared->Barrier );
+        if( shared->Stop == true )
+        {
+            break;
+        }
+        while( ( NbDevices > 0 ) && ( Heap[0]->NextWake < shared->EpochEnd ) && ( Heap[0]->NextWake < duration ) )
+        {
+            RunTransaction( Heap[0] );
+            HeapSiftDown( 0 );
+        }
+        pthread_barrier_wait( &shared->Barrier );
+    }
+
+    for( uint32_t i = 0; i < NbDevices; i++ )
+    {
+        LoRaMacInstanceSelect( Devices[i].Handle );
+
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+        Devices[i].Stats->Datarate = mibReq.Param.ChannelsDatarate;
+
+        mibReq.Type = MIB_CHANNELS_TX_POWER;
+        LoRaMacMibGetRequestConfirm( &mibReq );
+        Devices[i].Stats->TxPower = mibReq.Param.ChannelsTxPower;
+    }
+    return EXIT_SUCCESS;
+}
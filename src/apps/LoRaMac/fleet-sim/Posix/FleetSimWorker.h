@@ -0,0 +1,64 @@
+/*!
+ * \file      FleetSimWorker.h
+ *
+ * \brief     Network simulator worker process, runs a share of the devices
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __FLEET_SIM_WORKER_H__
+#define __FLEET_SIM_WORKER_H__
+
+#include "FleetSim.h"
+
+/*!
+ * Device traffic profile
+ */
+typedef struct sFleetSimProfile
+{
+    const char* Name;                                   //! Profile name
+    uint32_t Period;                                    //! Uplinks period, +/- 10 % [s]
+    uint8_t PayloadSize;                                //! Application payload size
+    uint8_t ConfirmedRatio;                             //! Share of confirmed uplinks [%]
+    uint8_t Share;                                      //! Share of the devices [%]
+}FleetSimProfile_t;
+
+/*!
+ * Number of traffic profiles
+ */
+#define FLEET_SIM_NB_PROFILES                       3
+
+/*!
+ * Traffic profiles
+ */
+extern const FleetSimProfile_t FleetSimProfiles[FLEET_SIM_NB_PROFILES];
+
+/*!
+ * \brief Runs the devices of a worker until the coordinator stops the
+ *        simulation
+ *
+ * \remark Each device owns a LoRaMac instance and its virtual time line. The
+ *         devices are run one transaction at a time, in the virtual time
+ *         order, up to the end of the epoch the coordinator opens.
+ *
+ * \param [IN] config Simulation configuration
+ * \param [IN] memory Shared memory map
+ * \param [IN] worker Worker index, runs the devices which identifier modulo
+ *                    the number of workers matches it
+ * \retval status     Process exit status
+ */
+int FleetSimWorkerRun( const FleetSimConfig_t* config, FleetSimMemory_t* memory, uint32_t worker );
+
+#endif // __FLEET_SIM_WORKER_H__
@@ -0,0 +1,636 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Virtual time network simulator running a fleet of LoRaMac devices
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+
+/*! \file fleet-sim/Posix/main.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "Region.h"
+#include "FleetSim.h"
+#include "FleetSimChannel.h"
+#include "FleetSimWorker.h"
+
+#ifndef ACTIVE_REGION
+
+#warning "No active region defined, LORAMAC_REGION_EU868 will be used as default."
+
+#define ACTIVE_REGION LORAMAC_REGION_EU868
+
+#endif
+
+/*!
+ * Logs entries reserved per device, uplinks, retransmissions and downlinks
+ */
+#define LOG_ENTRIES_PER_DEVICE                      4
+
+/*!
+ * Logs entries reserved on top of the per device ones
+ */
+#define LOG_ENTRIES_MARGIN                          1024
+
+/*!
+ * Number of reported datarates per region
+ */
+#define NB_DATARATES                                16
+
+/*!
+ * Regions names, indexed by region
+ */
+static const char* RegionNames[] =
+{
+    [LORAMAC_REGION_AS923]  = "AS923",
+    [LORAMAC_REGION_AU915]  = "AU915",
+    [LORAMAC_REGION_CN470]  = "CN470",
+    [LORAMAC_REGION_CN779]  = "CN779",
+    [LORAMAC_REGION_EU433]  = "EU433",
+    [LORAMAC_REGION_EU868]  = "EU868",
+    [LORAMAC_REGION_KR920]  = "KR920",
+    [LORAMAC_REGION_IN865]  = "IN865",
+    [LORAMAC_REGION_US915]  = "US915",
+    [LORAMAC_REGION_RU864]  = "RU864",
+    [LORAMAC_REGION_CUSTOM] = "CUSTOM",
+};
+
+/*!
+ * Uplinks reception outcomes names
+ */
+static const char* RxStatusNames[FLEET_SIM_RX_STATUS_MAX] =
+{
+    [FLEET_SIM_RX_OK]           = "received",
+    [FLEET_SIM_RX_COLLISION]    = "collision",
+    [FLEET_SIM_RX_DEMODULATORS] = "no demodulator",
+    [FLEET_SIM_RX_GATEWAY_BUSY] = "gateway transmitting",
+    [FLEET_SIM_RX_SENSITIVITY]  = "below sensitivity",
+};
+
+/*!
+ * Simulation configuration
+ */
+static FleetSimConfig_t Config =
+{
+    .NbDevices = 1000,
+    .NbWorkers = 1,
+    .Duration = 3600,
+    .Seed = 1,
+    .Epoch = 100,
+    .Radius = 5000,
+    .NbGateways = 1,
+    .NbDemodulators = 8,
+    .AdrOn = true,
+    .Otaa = false,
+    .JoinSpread = 60,
+    .NbRegions = 1,
+    .Regions = { ACTIVE_REGION },
+};
+
+/*!
+ * Shared memory map
+ */
+static FleetSimMemory_t Memory;
+
+/*!
+ * Longest logged transmission [ms]
+ */
+static uint32_t MaxDuration = 0;
+
+/*!
+ * End of the last merged epoch [ms]
+ */
+static uint64_t ResolvedEnd = 0;
+
+uint32_t FleetSimHash( uint32_t a, uint32_t b )
+{
+    uint32_t h = ( a * 0x9E3779B1 ) ^ b;
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+const char* FleetSimRegionName( LoRaMacRegion_t region )
+{
+    return RegionNames[region];
+}
+
+/*!
+ * \brief Prints the command line usage
+ */
+static void PrintUsage( const char* name )
+{
+    printf( "Usage: %s [options]\r\n", name );
+    printf( "  -n <devices>    Number of devices ( %lu )\r\n", ( unsigned long )Config.NbDevices );
+    printf( "  -w <workers>    Number of worker processes, 1 to %u ( %lu )\r\n", FLEET_SIM_MAX_WORKERS,
+            ( unsigned long )Config.NbWorkers );
+    printf( "  -d <seconds>    Simulated time ( %lu )\r\n", ( unsigned long )Config.Duration );
+    printf( "  -s <seed>       Pseudo random generators seed ( %lu )\r\n", ( unsigned long )Config.Seed );
+    printf( "  -e <ms>         Virtual clock barrier period ( %lu )\r\n", ( unsigned long )Config.Epoch );
+    printf( "  -g <gateways>   Number of gateways, 1 to %u ( %u )\r\n", FLEET_SIM_MAX_GATEWAYS, Config.NbGateways );
+    printf( "  -D <number>     Demodulators per gateway ( %u )\r\n", Config.NbDemodulators );
+    printf( "  -R <meters>     Radius of the devices area ( %lu )\r\n", ( unsigned long )Config.Radius );
+    printf( "  -r <regions>    Comma separated regions, assigned in turn to the devices ( %s )\r\n",
+            RegionNames[ACTIVE_REGION] );
+    printf( "  -j              Join storm, the devices join over the air instead of using ABP sessions\r\n" );
+    printf( "  -J <seconds>    Window the first join requests are spread over ( %lu )\r\n",
+            ( unsigned long )Config.JoinSpread );
+    printf( "  -a              Turns off the ADR\r\n" );
+    printf( "  -h              Prints this help\r\n" );
+}
+
+/*!
+ * \brief Parses the comma separated regions list
+ *
+ * \retval status true if all the regions are known and built in
+ */
+static bool ParseRegions( char* list )
+{
+    char* name;
+
+    Config.NbRegions = 0;
+    for( name = strtok( list, "," ); name != NULL; name = strtok( NULL, "," ) )
+    {
+        uint8_t region;
+
+        for( region = 0; region < FLEET_SIM_MAX_REGIONS; region++ )
+        {
+            if( strcasecmp( name, RegionNames[region] ) == 0 )
+            {
+                break;
+            }
+        }
+        if( ( region == FLEET_SIM_MAX_REGIONS ) || ( RegionIsActive( ( LoRaMacRegion_t )region ) == false ) )
+        {
+            fprintf( stderr, "Region %s unknown or not built in\r\n", name );
+            return false;
+        }
+        if( Config.NbRegions == FLEET_SIM_MAX_REGIONS )
+        {
+            fprintf( stderr, "Too many regions\r\n" );
+            return false;
+        }
+        Config.Regions[Config.NbRegions++] = ( LoRaMacRegion_t )region;
+    }
+    return Config.NbRegions > 0;
+}
+
+/*!
+ * \brief Parses the command line
+ *
+ * \retval status true if the configuration is valid
+ */
+static bool ParseArguments( int argc, char* argv[] )
+{
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "n:w:d:s:e:g:D:R:r:jJ:ah" ) ) != -1 )
+    {
+        switch( opt )
+        {
+            case 'n':
+                Config.NbDevices = strtoul( optarg, NULL, 0 );
+                break;
+            case 'w':
+                Config.NbWorkers = strtoul( optarg, NULL, 0 );
+                break;
+            case 'd':
+                Config.Duration = strtoul( optarg, NULL, 0 );
+                break;
+            case 's':
+                Config.Seed = strtoul( optarg, NULL, 0 );
+                break;
+            case 'e':
+                Config.Epoch = strtoul( optarg, NULL, 0 );
+                break;
+            case 'g':
+                Config.NbGateways = strtoul( optarg, NULL, 0 );
+                break;
+            case 'D':
+                Config.NbDemodulators = strtoul( optarg, NULL, 0 );
+                break;
+            case 'R':
+                Config.Radius = strtoul( optarg, NULL, 0 );
+                break;
+            case 'r':
+                if( ParseRegions( optarg ) == false )
+                {
+                    return false;
+                }
+                break;
+            case 'j':
+                Config.Otaa = true;
+                break;
+            case 'J':
+                Config.JoinSpread = strtoul( optarg, NULL, 0 );
+                break;
+            case 'a':
+                Config.AdrOn = false;
+                break;
+            default:
+                return false;
+        }
+    }
+    if( ( Config.NbDevices == 0 ) || ( Config.NbWorkers == 0 ) || ( Config.NbWorkers > FLEET_SIM_MAX_WORKERS ) ||
+        ( Config.Epoch == 0 ) || ( Config.NbGateways == 0 ) || ( Config.NbGateways > FLEET_SIM_MAX_GATEWAYS ) ||
+        ( Config.NbDemodulators == 0 ) )
+    {
+        fprintf( stderr, "Invalid configuration\r\n" );
+        return false;
+    }
+    if( RegionIsActive( Config.Regions[0] ) == false )
+    {
+        fprintf( stderr, "Region %s not built in\r\n", RegionNames[Config.Regions[0]] );
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Aborts the simulation when a worker ends before the coordinator
+ *        stops it, the barrier would never be released otherwise
+ */
+static void OnWorkerExit( int signal )
+{
+    siginfo_t info;
+
+    info.si_pid = 0;
+    // Leaves the worker to the final wait
+    if( ( waitid( P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT ) == 0 ) && ( info.si_pid != 0 ) &&
+        ( Memory.Shared->Stop == false ) )
+    {
+        static const char message[] = "Worker ended before the simulation end\r\n";
+
+        write( STDERR_FILENO, message, sizeof( message ) - 1 );
+        _exit( EXIT_FAILURE );
+    }
+}
+
+/*!
+ * \brief Maps the memory shared by the coordinator and the workers
+ *
+ * \retval status true if the memory is mapped
+ */
+static bool MapSharedMemory( void )
+{
+    uint32_t devicesPerWorker = ( Config.NbDevices + Config.NbWorkers - 1 ) / Config.NbWorkers;
+    uint32_t visibleCapacity = ( Config.NbDevices * LOG_ENTRIES_PER_DEVICE ) + LOG_ENTRIES_MARGIN;
+    uint32_t pendingCapacity = ( devicesPerWorker * LOG_ENTRIES_PER_DEVICE ) + LOG_ENTRIES_MARGIN;
+    size_t sharedSize = ( sizeof( FleetSimShared_t ) + 63 ) & ~( size_t )63;
+    size_t visibleSize = ( size_t )visibleCapacity * sizeof( FleetSimTx_t );
+    size_t pendingSize = ( size_t )pendingCapacity * Config.NbWorkers * sizeof( FleetSimTx_t );
+    size_t statsSize = ( size_t )Config.NbDevices * sizeof( FleetSimDeviceStats_t );
+    pthread_barrierattr_t attr;
+    uint8_t* map;
+
+    map = mmap( NULL, sharedSize + visibleSize + pendingSize + statsSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if( map == MAP_FAILED )
+    {
+        return false;
+    }
+    Memory.Shared = ( FleetSimShared_t* )map;
+    Memory.Visible = ( FleetSimTx_t* )( map + sharedSize );
+    Memory.Pending = ( FleetSimTx_t* )( map + sharedSize + visibleSize );
+    Memory.Stats = ( FleetSimDeviceStats_t* )( map + sharedSize + visibleSize + pendingSize );
+
+    Memory.Shared->VisibleCapacity = visibleCapacity;
+    Memory.Shared->PendingCapacity = pendingCapacity;
+
+    // The coordinator takes part in the virtual clock barrier
+    pthread_barrierattr_init( &attr );
+    pthread_barrierattr_setpshared( &attr, PTHREAD_PROCESS_SHARED );
+    if( pthread_barrier_init( &Memory.Shared->Barrier, &attr, Config.NbWorkers + 1 ) != 0 )
+    {
+        return false;
+    }
+    pthread_barrierattr_destroy( &attr );
+    return true;
+}
+
+/*!
+ * \brief Orders the transmissions by start time, then by device
+ */
+static int CompareTx( const void* a, const void* b )
+{
+    const FleetSimTx_t* txA = a;
+    const FleetSimTx_t* txB = b;
+
+    if( txA->Start != txB->Start )
+    {
+        return ( txA->Start < txB->Start ) ? -1 : 1;
+    }
+    if( txA->DeviceId != txB->DeviceId )
+    {
+        return ( txA->DeviceId < txB->DeviceId ) ? -1 : 1;
+    }
+    // A device uplink always comes before its answer
+    return ( int )txA->IsDownlink - ( int )txB->IsDownlink;
+}
+
+/*!
+ * \brief Merges the transmissions of the epoch and resolves the uplinks which
+ *        can no more be interfered with
+ *
+ * \remark The transmissions of the next epochs start after the boundary, the
+ *         uplinks ending before it are resolved with all their interferers.
+ *
+ * \param [IN] boundary End of the merged epoch [ms]
+ */
+static void MergeEpoch( uint64_t boundary )
+{
+    FleetSimShared_t* shared = Memory.Shared;
+    uint32_t nbLog = shared->NbVisible;
+    uint32_t kept = 0;
+
+    for( uint32_t w = 0; w < Config.NbWorkers; w++ )
+    {
+        uint32_t nbPending = shared->NbPending[w];
+
+        if( nbPending > shared->PendingCapacity )
+        {
+            shared->NbDropped += nbPending - shared->PendingCapacity;
+            nbPending = shared->PendingCapacity;
+        }
+        for( uint32_t i = 0; i < nbPending; i++ )
+        {
+            const FleetSimTx_t* tx = &Memory.Pending[( w * shared->PendingCapacity ) + i];
+
+            if( nbLog == shared->VisibleCapacity )
+            {
+                shared->NbDropped++;
+                continue;
+            }
+            MaxDuration = MAX( MaxDuration, tx->Duration );
+            shared->NbDownlinks += ( tx->IsDownlink == true ) ? 1 : 0;
+            Memory.Visible[nbLog++] = *tx;
+        }
+        shared->NbPending[w] = 0;
+    }
+
+    // The merged log order does not depend on the workers the devices are run by
+    qsort( Memory.Visible, nbLog, sizeof( FleetSimTx_t ), CompareTx );
+    FleetSimChannelAssignLocks( Memory.Visible, nbLog, boundary );
+
+    for( uint32_t i = 0; i < nbLog; i++ )
+    {
+        FleetSimTx_t* tx = &Memory.Visible[i];
+        uint64_t end = tx->Start + tx->Duration;
+
+        if( ( tx->IsDownlink == false ) && ( end > ResolvedEnd ) && ( end <= boundary ) )
+        {
+            FleetSimRxStatus_t status = FleetSimChannelResolve( tx, Memory.Visible, nbLog );
+
+            shared->RxStatus[status]++;
+            if( status == FLEET_SIM_RX_OK )
+            {
+                Memory.Stats[tx->DeviceId].UplinksDelivered++;
+            }
+        }
+    }
+    ResolvedEnd = boundary;
+
+    // Only keeps the transmissions which may still overlap an unresolved uplink
+    for( uint32_t i = 0; i < nbLog; i++ )
+    {
+        if( ( boundary == UINT64_MAX ) ||
+            ( ( Memory.Visible[i].Start + Memory.Visible[i].Duration + MaxDuration ) > boundary ) )
+        {
+            Memory.Visible[kept++] = Memory.Visible[i];
+        }
+    }
+    shared->NbVisible = kept;
+}
+
+/*!
+ * \brief Runs the virtual clock, one epoch at a time
+ */
+static void RunCoordinator( void )
+{
+    FleetSimShared_t* shared = Memory.Shared;
+    uint64_t duration = ( uint64_t )Config.Duration * 1000;
+    uint64_t epochEnd = 0;
+    uint32_t progress = 0;
+
+    do
+    {
+        epochEnd = MIN( epochEnd + Config.Epoch, duration );
+        shared->EpochEnd = epochEnd;
+
+        // Opens the epoch and waits for the workers to run it
+        pthread_barrier_wait( &shared->Barrier );
+        pthread_barrier_wait( &shared->Barrier );
+        MergeEpoch( epochEnd );
+
+        if( ( duration > 0 ) && ( ( epochEnd * 10 / duration ) > progress ) )
+        {
+            progress = epochEnd * 10 / duration;
+            printf( "%3lu %%\r\n", ( unsigned long )progress * 10 );
+            fflush( stdout );
+        }
+    } while( epochEnd < duration );
+
+    shared->Stop = true;
+    pthread_barrier_wait( &shared->Barrier );
+}
+
+/*!
+ * \brief Prints the simulation results
+ *
+ * \param [IN] wallTime Simulation wall clock time [s]
+ */
+static void PrintReport( double wallTime )
+{
+    FleetSimShared_t* shared = Memory.Shared;
+    FleetSimDeviceStats_t total = { 0 };
+    uint32_t resolved = 0;
+    uint32_t joined = 0;
+    uint64_t joinDelay = 0;
+    uint64_t airTime = 0;
+    uint32_t datarates[FLEET_SIM_MAX_REGIONS][NB_DATARATES] = { { 0 } };
+
+    for( uint32_t i = 0; i < Config.NbDevices; i++ )
+    {
+        FleetSimDeviceStats_t* stats = &Memory.Stats[i];
+
+        total.Requests += stats->Requests;
+        total.ConfirmedRequests += stats->ConfirmedRequests;
+        total.Acked += stats->Acked;
+        total.DutyCycleRestricted += stats->DutyCycleRestricted;
+        total.Uplinks += stats->Uplinks;
+        total.UplinksReceived += stats->UplinksReceived;
+        total.UplinksDelivered += stats->UplinksDelivered;
+        total.Downlinks += stats->Downlinks;
+        total.JoinRequests += stats->JoinRequests;
+        airTime += stats->AirTime;
+        if( stats->IsJoined == true )
+        {
+            joined++;
+            joinDelay += stats->JoinDelay;
+            if( ( stats->Datarate >= 0 ) && ( stats->Datarate < NB_DATARATES ) )
+            {
+                datarates[stats->Region][stats->Datarate]++;
+            }
+        }
+    }
+    for( uint8_t i = 0; i < FLEET_SIM_RX_STATUS_MAX; i++ )
+    {
+        resolved += shared->RxStatus[i];
+    }
+
+    printf( "\r\n###### ===== Fleet simulation report ==== ######\r\n\r\n" );
+    printf( "Devices        : %lu, %s, ADR %s\r\n", ( unsigned long )Config.NbDevices,
+            ( Config.Otaa == true ) ? "OTAA" : "ABP", ( Config.AdrOn == true ) ? "on" : "off" );
+    printf( "Regions        :" );
+    for( uint8_t i = 0; i < Config.NbRegions; i++ )
+    {
+        printf( " %s", RegionNames[Config.Regions[i]] );
+    }
+    printf( "\r\n" );
+    printf( "Gateways       : %u, %u demodulators, %lu m radius\r\n", Config.NbGateways, Config.NbDemodulators,
+            ( unsigned long )Config.Radius );
+    printf( "Simulated time : %lu s, %lu ms epochs, seed %lu\r\n", ( unsigned long )Config.Duration,
+            ( unsigned long )Config.Epoch, ( unsigned long )Config.Seed );
+    printf( "Wall time      : %.2f s, %lu workers, %.0f x real time\r\n", wallTime, ( unsigned long )Config.NbWorkers,
+            ( wallTime > 0.0 ) ? Config.Duration / wallTime : 0.0 );
+    printf( "\r\n" );
+    printf( "Requests       : %lu, %lu confirmed, %lu acked\r\n", ( unsigned long )total.Requests,
+            ( unsigned long )total.ConfirmedRequests, ( unsigned long )total.Acked );
+    printf( "Duty-cycle     : %lu deferred requests\r\n", ( unsigned long )total.DutyCycleRestricted );
+    printf( "Uplinks        : %lu, %lu received by the network server, %lu delivered\r\n",
+            ( unsigned long )total.Uplinks, ( unsigned long )total.UplinksReceived,
+            ( unsigned long )total.UplinksDelivered );
+    for( uint8_t i = 0; i < FLEET_SIM_RX_STATUS_MAX; i++ )
+    {
+        printf( "  %-20s : %lu ( %.1f %% )\r\n", RxStatusNames[i], ( unsigned long )shared->RxStatus[i],
+                ( resolved > 0 ) ? ( 100.0 * shared->RxStatus[i] ) / resolved : 0.0 );
+    }
+    printf( "Downlinks      : %lu sent, %lu received\r\n", ( unsigned long )shared->NbDownlinks,
+            ( unsigned long )total.Downlinks );
+    if( Config.Otaa == true )
+    {
+        printf( "Joins          : %lu joined, %lu join requests, %.1f s average delay\r\n", ( unsigned long )joined,
+                ( unsigned long )total.JoinRequests, ( joined > 0 ) ? joinDelay / ( 1000.0 * joined ) : 0.0 );
+    }
+    printf( "Air time       : %.1f s, %.3f %% per device\r\n", airTime / 1000.0,
+            ( Config.Duration > 0 ) ? ( airTime / 10.0 ) / ( ( double )Config.Duration * Config.NbDevices ) : 0.0 );
+    printf( "Dropped logs   : %lu\r\n", ( unsigned long )shared->NbDropped );
+    printf( "\r\nDatarates of the joined devices\r\n" );
+    for( uint8_t i = 0; i < Config.NbRegions; i++ )
+    {
+        printf( "  %-6s :", RegionNames[Config.Regions[i]] );
+        for( uint8_t dr = 0; dr < NB_DATARATES; dr++ )
+        {
+            if( datarates[i][dr] > 0 )
+            {
+                printf( " DR%u %lu", dr, ( unsigned long )datarates[i][dr] );
+            }
+        }
+        printf( "\r\n" );
+    }
+
+    // Machine readable summary
+    printf( "\r\nFLEET,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.2f\r\n",
+            ( unsigned long )Config.NbDevices, ( unsigned long )Config.Duration, ( unsigned long )Config.Seed,
+            ( unsigned long )total.Requests, ( unsigned long )total.Acked, ( unsigned long )total.Uplinks,
+            ( unsigned long )total.UplinksReceived, ( unsigned long )total.UplinksDelivered,
+            ( unsigned long )shared->RxStatus[FLEET_SIM_RX_COLLISION], ( unsigned long )total.Downlinks,
+            ( unsigned long )joined, ( unsigned long )total.DutyCycleRestricted, ( unsigned long )shared->NbDropped,
+            wallTime );
+}
+
+/**
+ * Main application entry point.
+ */
+int main( int argc, char* argv[] )
+{
+    struct timespec start;
+    struct timespec end;
+    int status = EXIT_SUCCESS;
+
+    if( ParseArguments( argc, argv ) == false )
+    {
+        PrintUsage( argv[0] );
+        return EXIT_FAILURE;
+    }
+    if( MapSharedMemory( ) == false )
+    {
+        fprintf( stderr, "Shared memory allocation failed\r\n" );
+        return EXIT_FAILURE;
+    }
+
+    printf( "###### ===== LoRaMac fleet simulator v1.0.0 ==== ######\r\n\r\n" );
+    fflush( stdout );
+
+    // The coordinator resolves the uplinks with the same channel model
+    FleetSimChannelInit( &Config );
+    signal( SIGCHLD, OnWorkerExit );
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    // The MAC, the timers and the radio are process singletons, each worker
+    // runs its devices in its own process
+    for( uint32_t w = 0; w < Config.NbWorkers; w++ )
+    {
+        pid_t pid = fork( );
+
+        if( pid < 0 )
+        {
+            fprintf( stderr, "Worker %lu creation failed\r\n", ( unsigned long )w );
+            exit( EXIT_FAILURE );
+        }
+        if( pid == 0 )
+        {
+            // The workers do not outlive an aborted coordinator
+            prctl( PR_SET_PDEATHSIG, SIGKILL );
+            _exit( FleetSimWorkerRun( &Config, &Memory, w ) );
+        }
+    }
+
+    RunCoordinator( );
+
+    for( uint32_t w = 0; w < Config.NbWorkers; w++ )
+    {
+        int workerStatus;
+
+        if( ( wait( &workerStatus ) < 0 ) || ( WIFEXITED( workerStatus ) == 0 ) ||
+            ( WEXITSTATUS( workerStatus ) != EXIT_SUCCESS ) )
+        {
+            status = EXIT_FAILURE;
+        }
+    }
+    // Resolves the transmissions of the last transactions
+    MergeEpoch( UINT64_MAX );
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    PrintReport( ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9 );
+    return status;
+}
@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include "utilities.h"
+#include "crc.h"
 #include "board-config.h"
 #include "board.h"
 #include "gpio.h"
@@ -36,6 +37,7 @@
 #include "LmhpRemoteMcastSetup.h"
 #include "LmhpFragmentation.h"
 #include "LmHandlerMsgDisplay.h"
+#include "FragDecoderBenchmark.h"
 
 #ifndef ACTIVE_REGION
 
@@ -150,16 +152,6 @@ static void OnFragDone( int32_t status, uint8_t *file, uint32_t size );
 static void StartTxProcess( LmHandlerTxEvents_t txEvent );
 static void UplinkProcess( void );
 
-/*!
- * Computes a CCITT 32 bits CRC
- *
- * \param [IN] buffer   Data buffer used to compute the CRC
- * \param [IN] length   Data buffer length
- * 
- * \retval crc          The computed buffer of length CRC
- */
-static uint32_t Crc32( uint8_t *buffer, uint16_t length );
-
 /*!
  * Function executed on TxTimer event
  */
@@ -312,6 +304,10 @@ int main( void )
                     &appVersion,
                     &gitHubVersion );
 
+#if defined( FRAG_DECODER_BENCHMARK_ENABLED )
+    FragDecoderBenchmark( );
+#endif
+
     LmHandlerInit( &LmHandlerCallbacks, &LmHandlerParams );
 
     // The LoRa-Alliance Compliance protocol package should always be
@@ -508,7 +504,7 @@ static void OnFragProgress( uint16_t fragCounter, uint16_t fragNb, uint8_t fragS
 #if( FRAG_DECODER_FILE_HANDLING_NEW_API == 1 )
 static void OnFragDone( int32_t status, uint32_t size )
 {
-    FileRxCrc = Crc32( UnfragmentedData, size );
+    FileRxCrc = Crc32Update( 0, UnfragmentedData, size );
     IsFileTransferDone = true;
     // Switch LED 2 OFF
     GpioWrite( &Led2, 1 );
@@ -522,7 +518,7 @@ static void OnFragDone( int32_t status, uint32_t size )
 #else
 static void OnFragDone( int32_t status, uint8_t *file, uint32_t size )
 {
-    FileRxCrc = Crc32( file, size );
+    FileRxCrc = Crc32Update( 0, file, size );
     IsFileTransferDone = true;
     // Switch LED 2 OFF
     GpioWrite( &Led2, 1 );
@@ -664,28 +660,3 @@ static void OnLedBeaconTimerEvent( void* context )
 
     TimerStart( &LedBeaconTimer );
 }
-
-static uint32_t Crc32( uint8_t *buffer, uint16_t length )
-{
-    // The CRC calculation follows CCITT - 0x04C11DB7
-    const uint32_t reversedPolynom = 0xEDB88320;
-
-    // CRC initial value
-    uint32_t crc = 0xFFFFFFFF;
-
-    if( buffer == NULL )
-    {
-        return 0;
-    }
-
-    for( uint16_t i = 0; i < length; ++i )
-    {
-        crc ^= ( uint32_t )buffer[i];
-        for( uint16_t i = 0; i < 8; i++ )
-        {
-            crc = ( crc >> 1 ) ^ ( reversedPolynom & ~( ( crc & 0x01 ) - 1 ) );
-        }
-    }
-
-    return ~crc;
-}
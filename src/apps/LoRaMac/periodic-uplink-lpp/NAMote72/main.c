@@ -27,6 +27,7 @@
 #include "gpio.h"
 #include "gps.h"
 #include "mpl3115.h"
+#include "mma8451.h"
 
 #include "Commissioning.h"
 #include "LmHandler.h"
@@ -95,6 +96,25 @@
  */
 #define LORAWAN_APP_PORT                            2
 
+/*!
+ * Accelerometer FIFO batch sampling. 100 Hz samples drained every 250 ms and
+ * averaged by 4 before the vibration summary.
+ */
+#define ACCEL_FIFO_DATA_RATE                        MMA8451_DR_100_HZ
+#define ACCEL_FIFO_WATERMARK                        25
+#define ACCEL_FIFO_DECIMATION                       4
+
+/*!
+ * Accelerometer FIFO drain period, value in [ms]. The MMA8451 interrupt pins
+ * are not routed to the MCU on this board, the drains are timed.
+ */
+#define ACCEL_FIFO_DRAIN_PERIOD                     250
+
+/*!
+ * Maximum horizontal dilution of precision of the GPS fixes, in tenths
+ */
+#define APP_GPS_MAX_HDOP                            50
+
 /*!
  *
  */
@@ -144,6 +164,11 @@ static TimerEvent_t Led2Timer;
  */
 static TimerEvent_t LedBeaconTimer;
 
+/*!
+ * Timer to handle the accelerometer FIFO drains
+ */
+static TimerEvent_t AccelFifoTimer;
+
 static void OnMacProcessNotify( void );
 static void OnNvmContextChange( LmHandlerNvmContextStates_t state );
 static void OnNetworkParametersChange( CommissioningParams_t* params );
@@ -158,6 +183,7 @@ static void OnBeaconStatusChange( LoRaMAcHandlerBeaconParams_t* params );
 static void PrepareTxFrame( void );
 static void StartTxProcess( LmHandlerTxEvents_t txEvent );
 static void UplinkProcess( void );
+static void AccelFifoProcess( void );
 
 /*!
  * Function executed on TxTimer event
@@ -179,6 +205,11 @@ static void OnLed2TimerEvent( void* context );
  */
 static void OnLedBeaconTimerEvent( void* context );
 
+/*!
+ * Function executed on accelerometer FIFO timer event
+ */
+static void OnAccelFifoTimerEvent( void* context );
+
 static LmHandlerCallbacks_t LmHandlerCallbacks =
 {
     .GetBatteryLevel = BoardGetBatteryLevel,
@@ -225,6 +256,8 @@ static volatile uint8_t IsMacProcessPending = 0;
 
 static volatile uint8_t IsTxFramePending = 0;
 
+static volatile uint8_t IsAccelFifoPending = 0;
+
 /*!
  * LED GPIO pins objects
  */
@@ -249,6 +282,14 @@ int main( void )
     TimerInit( &LedBeaconTimer, OnLedBeaconTimerEvent );
     TimerSetValue( &LedBeaconTimer, 5000 );
 
+    MMA8451FifoStart( ACCEL_FIFO_DATA_RATE, ACCEL_FIFO_WATERMARK, ACCEL_FIFO_DECIMATION );
+    TimerInit( &AccelFifoTimer, OnAccelFifoTimerEvent );
+    TimerSetValue( &AccelFifoTimer, ACCEL_FIFO_DRAIN_PERIOD );
+    TimerStart( &AccelFifoTimer );
+
+    // The GPS is only powered until it gets a fix
+    GpsRequestFix( APP_GPS_MAX_HDOP );
+
     const Version_t appVersion = { .Fields.Major = 1, .Fields.Minor = 0, .Fields.Revision = 0 };
     const Version_t gitHubVersion = { .Fields.Major = 4, .Fields.Minor = 4, .Fields.Revision = 2 };
     DisplayAppInfo( "periodic-uplink-lpp", 
@@ -273,6 +314,12 @@ int main( void )
         // Process application uplinks management
         UplinkProcess( );
 
+        // Drains the accelerometer FIFO
+        AccelFifoProcess( );
+
+        // Synchronizes the system time on the GPS PPS
+        GpsProcess( );
+
         CRITICAL_SECTION_BEGIN( );
         if( IsMacProcessPending == 1 )
         {
@@ -396,10 +443,12 @@ static void OnBeaconStatusChange( LoRaMAcHandlerBeaconParams_t* params )
  */
 static void PrepareTxFrame( void )
 {
+#if !defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
     if( LmHandlerIsBusy( ) == true )
     {
         return;
     }
+#endif
 
 #if defined( REGION_US915 )
     MibRequestConfirm_t mibReq;
@@ -422,36 +471,50 @@ static void PrepareTxFrame( void )
 
     AppData.Port = LORAWAN_APP_PORT;
 
-    CayenneLppReset( );
+    // Encode directly into the application data buffer
+    CayenneLppSetBuffer( AppData.Buffer, LORAWAN_APP_DATA_BUFFER_MAX_SIZE );
     if( TxGpsData == 0 )
     {
         CayenneLppAddDigitalInput( 0, AppLedStateOn );
         CayenneLppAddAnalogInput( 1, BoardGetBatteryLevel( ) * 100 / 254 );
         CayenneLppAddTemperature( 2, MPL3115ReadTemperature( ) );
         CayenneLppAddBarometricPressure( 3, MPL3115ReadPressure( ) / 100 );
+
+        MMA8451VibrationSummary_t vibration;
+
+        MMA8451FifoGetSummary( &vibration );
+        CayenneLppAddAccelerometer( 5, vibration.Rms[0], vibration.Rms[1], vibration.Rms[2] );
+
+        // Get the position ready for the next uplink
+        GpsRequestFix( APP_GPS_MAX_HDOP );
     }
     else
     {
         if( GpsHasFix( ) == true )
         {
-            double latitude = 0, longitude = 0;
-            uint16_t altitudeGps = 0xFFFF;
+            int32_t latitude = 0, longitude = 0;
+            int16_t altitudeGps = 0;
 
-            GpsGetLatestGpsPositionDouble( &latitude, &longitude );
+            GpsGetLatestGpsPositionFixed( &latitude, &longitude );      // in microdegrees
             altitudeGps = GpsGetLatestGpsAltitude( );                     // in m
 
-            CayenneLppAddGps( 4, latitude, longitude, altitudeGps );
+            CayenneLppAddGpsFixed( 4, latitude / 100, longitude / 100, altitudeGps * 100 );
         }
         else
         {
-            CayenneLppAddGps( 4, 0, 0, 0 );
+            CayenneLppAddGpsFixed( 4, 0, 0, 0 );
         }
     }
 
-    CayenneLppCopy( AppData.Buffer );
     AppData.BufferSize = CayenneLppGetSize( );
 
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+    // The sample replaces the pending one and is sent as soon as the duty
+    // cycle allows it, or dropped once the next sample is due
+    if( LmHandlerScheduleSend( &AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, 0, APP_TX_DUTYCYCLE ) == LORAMAC_HANDLER_SUCCESS )
+#else
     if( LmHandlerSend( &AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE ) == LORAMAC_HANDLER_SUCCESS )
+#endif
     {
         TxGpsData = ( TxGpsData + 1 ) & 0x01; // Send GPS data every 2 uplinks
         // Switch LED 1 ON
@@ -494,6 +557,19 @@ static void UplinkProcess( void )
     }
 }
 
+static void AccelFifoProcess( void )
+{
+    uint8_t isPending = 0;
+    CRITICAL_SECTION_BEGIN( );
+    isPending = IsAccelFifoPending;
+    IsAccelFifoPending = 0;
+    CRITICAL_SECTION_END( );
+    if( isPending == 1 )
+    {
+        MMA8451FifoProcess( );
+    }
+}
+
 /*!
  * Function executed on TxTimer event
  */
@@ -538,3 +614,13 @@ static void OnLedBeaconTimerEvent( void* context )
 
     TimerStart( &LedBeaconTimer );
 }
+
+/*!
+ * Function executed on accelerometer FIFO timer event
+ */
+static void OnAccelFifoTimerEvent( void* context )
+{
+    IsAccelFifoPending = 1;
+
+    TimerStart( &AccelFifoTimer );
+}
@@ -55,6 +55,17 @@
  */
 #define APP_TX_DUTYCYCLE_RND                        1000
 
+/*!
+ * Maximum delay between the first sample of a batch and its uplink. 60s,
+ * value in [ms]. Only used when LMHANDLER_BATCH_ENABLED is defined.
+ */
+#define APP_BATCH_LATENCY                           60000
+
+/*!
+ * Number of values of a batched sample
+ */
+#define APP_BATCH_NB_VALUES                         2
+
 /*!
  * LoRaWAN Adaptive Data Rate
  *
@@ -257,6 +268,10 @@ int main( void )
     // initialized and activated.
     LmHandlerPackageRegister( PACKAGE_ID_COMPLIANCE, &LmhpComplianceParams );
 
+#if defined( LMHANDLER_BATCH_ENABLED )
+    LmHandlerBatchInit( LORAWAN_APP_PORT, APP_BATCH_NB_VALUES, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, APP_BATCH_LATENCY );
+#endif
+
     LmHandlerJoin( );
 
     StartTxProcess( LORAMAC_HANDLER_TX_ON_TIMER );
@@ -391,23 +406,39 @@ static void OnBeaconStatusChange( LoRaMAcHandlerBeaconParams_t* params )
  */
 static void PrepareTxFrame( void )
 {
+#if defined( LMHANDLER_BATCH_ENABLED )
+    // The LED state and the battery level [%] are sent in batches, once the
+    // batch fills the frame or after APP_BATCH_LATENCY
+    int32_t sample[APP_BATCH_NB_VALUES] = { AppLedStateOn, BoardGetBatteryLevel( ) * 100 / 254 };
+
+    LmHandlerBatchAdd( sample );
+    return;
+#endif
+#if !defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
     if( LmHandlerIsBusy( ) == true )
     {
         return;
     }
+#endif
 
     uint8_t channel = 0;
 
     AppData.Port = LORAWAN_APP_PORT;
 
-    CayenneLppReset( );
+    // Encode directly into the application data buffer
+    CayenneLppSetBuffer( AppData.Buffer, LORAWAN_APP_DATA_BUFFER_MAX_SIZE );
     CayenneLppAddDigitalInput( channel++, AppLedStateOn );
     CayenneLppAddAnalogInput( channel++, BoardGetBatteryLevel( ) * 100 / 254 );
 
-    CayenneLppCopy( AppData.Buffer );
     AppData.BufferSize = CayenneLppGetSize( );
 
+#if defined( LMHANDLER_UPLINK_SCHEDULER_ENABLED )
+    // The sample replaces the pending one and is sent as soon as the duty
+    // cycle allows it, or dropped once the next sample is due
+    if( LmHandlerScheduleSend( &AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE, 0, APP_TX_DUTYCYCLE ) == LORAMAC_HANDLER_SUCCESS )
+#else
     if( LmHandlerSend( &AppData, LORAWAN_DEFAULT_CONFIRMED_MSG_STATE ) == LORAMAC_HANDLER_SUCCESS )
+#endif
     {
         // Switch LED 1 ON
         GpioWrite( &Led1, 1 );
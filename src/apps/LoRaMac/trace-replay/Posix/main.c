@@ -0,0 +1,804 @@
+/*!
+ * \file      main.c
+ *
+ * \brief     Replays a radio events trace into LoRaMac in virtual time
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \remark    The recorded uplinks are requested again at their recorded times
+ *            and the recorded downlinks are delivered into the matching class A
+ *            windows. The replayed frames match the recorded digests when the
+ *            session keys and the frame counters are the ones of the capture,
+ *            the OTAA replays only match with the recorded DevNonce.
+ */
+
+/*! \file trace-replay/Posix/main.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "utilities.h"
+#include "board.h"
+#include "crc.h"
+#include "binlog.h"
+#include "rtc-sim.h"
+#include "sim-radio.h"
+#include "LoRaMac.h"
+#include "LoRaMacTest.h"
+
+#ifndef ACTIVE_REGION
+
+#warning "No active region defined, LORAMAC_REGION_EU868 will be used as default."
+
+#define ACTIVE_REGION LORAMAC_REGION_EU868
+
+#endif
+
+/*!
+ * Difference between the recorded and the replayed window delays reported
+ * as a shifted window [ms]
+ */
+#define REPLAY_WINDOW_TOLERANCE                     1
+
+/*!
+ * No record
+ */
+#define REPLAY_NO_RECORD                            UINT32_MAX
+
+/*!
+ * Trace record, refer to \ref LORAMAC_TRACE
+ */
+typedef struct sReplayRecord
+{
+    uint8_t Id;                                         //! Record identifier
+    uint8_t Size;                                       //! Payload size
+    uint32_t Time;                                      //! Record time [ms]
+    const uint8_t* Payload;                             //! Payload, in the trace buffer
+}ReplayRecord_t;
+
+/*!
+ * Replay configuration
+ */
+typedef struct sReplayConfig
+{
+    const char* TraceFile;                              //! Captured binary log
+    uint32_t Seed;                                      //! Pseudo random generator seed
+    bool Quiet;                                         //! Only the summary is printed
+    bool Otaa;                                          //! The session is joined by the replay
+    uint32_t DevAddr;                                   //! ABP device address
+    uint8_t NwkSKey[16];                                //! ABP network session key
+    uint8_t AppSKey[16];                                //! ABP application session key
+    uint8_t NwkKey[16];                                 //! OTAA root key
+    uint8_t DevEui[8];                                  //! OTAA device EUI
+    uint8_t JoinEui[8];                                 //! OTAA join EUI
+}ReplayConfig_t;
+
+/*!
+ * Replay counters
+ */
+typedef struct sReplayStats
+{
+    uint32_t Uplinks;                                   //! Requests issued from the recorded frames
+    uint32_t Tx;                                        //! Replayed transmissions
+    uint32_t TxDiff;                                    //! Transmissions not matching the recorded digest
+    uint32_t Windows;                                   //! Replayed reception windows
+    uint32_t WindowsShifted;                            //! Windows opened off the recorded delay
+    uint32_t RxDone;                                    //! Recorded frames delivered to the MAC
+    uint64_t CpuTime;                                   //! MAC processing CPU time [us]
+    uint64_t MaxCpuTime;                                //! Largest uplink exchange CPU time [us]
+}ReplayStats_t;
+
+/*!
+ * Reception window slots names
+ */
+static const char* SlotNames[] =
+{
+    [RX_SLOT_WIN_1] = "RX1",
+    [RX_SLOT_WIN_2] = "RX2",
+};
+
+/*!
+ * Replay configuration
+ */
+static ReplayConfig_t Config =
+{
+    .Seed = 1,
+};
+
+/*!
+ * Trace file content
+ */
+static uint8_t* Trace;
+
+/*!
+ * MAC records of the trace, in the trace order
+ */
+static ReplayRecord_t* Records;
+static uint32_t NbRecords = 0;
+
+/*!
+ * Number of records reported dropped by the binary log
+ */
+static uint32_t NbDropped = 0;
+
+/*!
+ * Index of the next recorded transmission not replayed yet
+ */
+static uint32_t NextTx = REPLAY_NO_RECORD;
+
+/*!
+ * Index of the first record not matched yet to a replayed reception window
+ */
+static uint32_t NextWindow = REPLAY_NO_RECORD;
+
+/*!
+ * Recorded and replayed Tx done times of the last transmission [ms]
+ */
+static uint64_t RecordedTxDone = 0;
+static uint64_t ReplayedTxDone = 0;
+
+/*!
+ * Replay counters
+ */
+static ReplayStats_t Stats;
+
+/*!
+ * MAC primitives and callbacks
+ */
+static LoRaMacPrimitives_t MacPrimitives;
+static LoRaMacCallback_t MacCallbacks;
+
+/*!
+ * Application payload of the replayed uplinks, the content is not recorded
+ */
+static uint8_t Payload[UINT8_MAX];
+
+/*!
+ * \brief Reads a little endian 16 bits field
+ */
+static uint16_t GetUint16( const uint8_t* buffer )
+{
+    return ( uint16_t )buffer[0] | ( ( uint16_t )buffer[1] << 8 );
+}
+
+/*!
+ * \brief Reads a little endian 32 bits field
+ */
+static uint32_t GetUint32( const uint8_t* buffer )
+{
+    return ( uint32_t )GetUint16( buffer ) | ( ( uint32_t )GetUint16( &buffer[2] ) << 16 );
+}
+
+/*!
+ * \brief Prints the command line usage
+ */
+static void PrintUsage( const char* name )
+{
+    printf( "Usage: %s [options] <trace>\r\n", name );
+    printf( "  -a <devaddr>    ABP device address, hexadecimal\r\n" );
+    printf( "  -n <key>        ABP LoRaWAN 1.0.x NwkSKey, hexadecimal\r\n" );
+    printf( "  -p <key>        ABP AppSKey, hexadecimal\r\n" );
+    printf( "  -k <key>        OTAA LoRaWAN 1.0.x AppKey, the recorded join requests are replayed\r\n" );
+    printf( "  -d <eui>        OTAA DevEUI, hexadecimal\r\n" );
+    printf( "  -j <eui>        OTAA JoinEUI, hexadecimal\r\n" );
+    printf( "  -s <seed>       Pseudo random generator seed ( %lu )\r\n", ( unsigned long )Config.Seed );
+    printf( "  -q              Only prints the summary\r\n" );
+    printf( "  -h              Prints this help\r\n" );
+}
+
+/*!
+ * \brief Parses a big endian hexadecimal string
+ *
+ * \retval status true if the string holds exactly size bytes
+ */
+static bool ParseHex( const char* string, uint8_t* buffer, size_t size )
+{
+    if( strlen( string ) != ( 2 * size ) )
+    {
+        return false;
+    }
+    for( size_t i = 0; i < size; i++ )
+    {
+        unsigned int byte;
+
+        if( sscanf( &string[2 * i], "%2x", &byte ) != 1 )
+        {
+            return false;
+        }
+        buffer[i] = ( uint8_t )byte;
+    }
+    return true;
+}
+
+/*!
+ * \brief Parses the command line
+ *
+ * \retval status true if the configuration is valid
+ */
+static bool ParseArguments( int argc, char* argv[] )
+{
+    uint8_t devAddr[4];
+    bool isAbp = false;
+    int opt;
+
+    while( ( opt = getopt( argc, argv, "a:n:p:k:d:j:s:qh" ) ) != -1 )
+    {
+        bool valid = true;
+
+        switch( opt )
+        {
+            case 'a':
+                valid = ParseHex( optarg, devAddr, sizeof( devAddr ) );
+                Config.DevAddr = ( ( uint32_t )devAddr[0] << 24 ) | ( ( uint32_t )devAddr[1] << 16 ) |
+                                 ( ( uint32_t )devAddr[2] << 8 ) | devAddr[3];
+                isAbp = true;
+                break;
+            case 'n':
+                valid = ParseHex( optarg, Config.NwkSKey, sizeof( Config.NwkSKey ) );
+                break;
+            case 'p':
+                valid = ParseHex( optarg, Config.AppSKey, sizeof( Config.AppSKey ) );
+                break;
+            case 'k':
+                valid = ParseHex( optarg, Config.NwkKey, sizeof( Config.NwkKey ) );
+                Config.Otaa = true;
+                break;
+            case 'd':
+                valid = ParseHex( optarg, Config.DevEui, sizeof( Config.DevEui ) );
+                break;
+            case 'j':
+                valid = ParseHex( optarg, Config.JoinEui, sizeof( Config.JoinEui ) );
+                break;
+            case 's':
+                Config.Seed = strtoul( optarg, NULL, 0 );
+                break;
+            case 'q':
+                Config.Quiet = true;
+                break;
+            default:
+                return false;
+        }
+        if( valid == false )
+        {
+            fprintf( stderr, "Invalid -%c value %s\r\n", opt, optarg );
+            return false;
+        }
+    }
+    if( ( optind != ( argc - 1 ) ) || ( isAbp == Config.Otaa ) )
+    {
+        fprintf( stderr, "A trace and either an ABP or an OTAA session are required\r\n" );
+        return false;
+    }
+    Config.TraceFile = argv[optind];
+    return true;
+}
+
+/*!
+ * \brief Loads the MAC records of a captured binary log
+ *
+ * \remark The bytes out of the records, such as the printf output sharing
+ *         the UART, are skipped.
+ *
+ * \retval status true if the trace holds MAC records
+ */
+static bool LoadTrace( const char* name )
+{
+    FILE* file = fopen( name, "rb" );
+    long size;
+    long pos = 0;
+
+    if( file == NULL )
+    {
+        fprintf( stderr, "Cannot open %s\r\n", name );
+        return false;
+    }
+    fseek( file, 0, SEEK_END );
+    size = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    Trace = malloc( size + 1 );
+    // A record takes at least a header
+    Records = malloc( ( ( size / BINLOG_HEADER_SIZE ) + 1 ) * sizeof( ReplayRecord_t ) );
+    if( ( Trace == NULL ) || ( Records == NULL ) || ( fread( Trace, 1, size, file ) != ( size_t )size ) )
+    {
+        fprintf( stderr, "Cannot read %s\r\n", name );
+        fclose( file );
+        return false;
+    }
+    fclose( file );
+
+    while( ( pos + BINLOG_HEADER_SIZE ) <= size )
+    {
+        uint8_t id = Trace[pos + 1];
+        uint8_t length = Trace[pos + 2];
+
+        if( ( Trace[pos] != BINLOG_SYNC ) || ( ( pos + BINLOG_HEADER_SIZE + length ) > size ) )
+        {
+            pos++;
+            continue;
+        }
+        if( ( id == BINLOG_ID_DROPPED ) && ( length == 2 ) )
+        {
+            NbDropped += GetUint16( &Trace[pos + BINLOG_HEADER_SIZE] );
+        }
+        else if( ( id >= LORAMAC_TRACE_ID_TX ) && ( id <= LORAMAC_TRACE_ID_TIMER ) )
+        {
+            Records[NbRecords].Id = id;
+            Records[NbRecords].Size = length;
+            Records[NbRecords].Time = GetUint32( &Trace[pos + 3] );
+            Records[NbRecords].Payload = &Trace[pos + BINLOG_HEADER_SIZE];
+            NbRecords++;
+        }
+        pos += BINLOG_HEADER_SIZE + length;
+    }
+    if( NbRecords == 0 )
+    {
+        fprintf( stderr, "No radio events records in %s\r\n", name );
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Finds the next record of an identifier
+ *
+ * \param [IN] from First searched record
+ * \param [IN] to   Record ending the search
+ * \param [IN] id   Record identifier
+ * \retval index    Record index, REPLAY_NO_RECORD if not found
+ */
+static uint32_t FindRecord( uint32_t from, uint32_t to, uint8_t id )
+{
+    for( uint32_t i = from; ( i < to ) && ( i < NbRecords ); i++ )
+    {
+        if( Records[i].Id == id )
+        {
+            return i;
+        }
+    }
+    return REPLAY_NO_RECORD;
+}
+
+/*!
+ * \brief Finds the next class A window record of a transmission
+ *
+ * \param [IN] from First searched record
+ * \param [IN] to   Record ending the search
+ * \retval index    Record index, REPLAY_NO_RECORD if not found
+ */
+static uint32_t FindWindow( uint32_t from, uint32_t to )
+{
+    for( uint32_t i = FindRecord( from, to, LORAMAC_TRACE_ID_RX_WINDOW ); i != REPLAY_NO_RECORD;
+         i = FindRecord( i + 1, to, LORAMAC_TRACE_ID_RX_WINDOW ) )
+    {
+        if( ( Records[i].Size >= 1 ) &&
+            ( ( Records[i].Payload[0] == RX_SLOT_WIN_1 ) || ( Records[i].Payload[0] == RX_SLOT_WIN_2 ) ) )
+        {
+            return i;
+        }
+    }
+    return REPLAY_NO_RECORD;
+}
+
+/*!
+ * \brief Finds the outcome of a reception window
+ *
+ * \param [IN] window Window record
+ * \retval index      Rx done, Rx timeout or Rx error record, REPLAY_NO_RECORD
+ *                    if the window has none
+ */
+static uint32_t FindOutcome( uint32_t window )
+{
+    for( uint32_t i = window + 1; i < NbRecords; i++ )
+    {
+        switch( Records[i].Id )
+        {
+            case LORAMAC_TRACE_ID_RX_DONE:
+            case LORAMAC_TRACE_ID_RX_TIMEOUT:
+            case LORAMAC_TRACE_ID_RX_ERROR:
+                return i;
+            case LORAMAC_TRACE_ID_TX:
+            case LORAMAC_TRACE_ID_RX_WINDOW:
+                return REPLAY_NO_RECORD;
+            default:
+                break;
+        }
+    }
+    return REPLAY_NO_RECORD;
+}
+
+/*!
+ * \brief Returns the CPU time used by the process [us]
+ */
+static uint64_t GetCpuTime( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &now );
+    return ( ( uint64_t )now.tv_sec * 1000000 ) + ( now.tv_nsec / 1000 );
+}
+
+/*!
+ * \brief Matches a replayed transmission with the next recorded one
+ */
+static void OnRadioTx( uint32_t freq, uint8_t sf, uint8_t *buffer, uint8_t size )
+{
+    const ReplayRecord_t* tx;
+    uint32_t digest = Crc32Update( 0, buffer, size );
+    uint32_t txDone;
+    int8_t power;
+    uint32_t bandwidth;
+    bool isSame;
+
+    ReplayedTxDone = RtcSimGetTime( ) + SimRadioGetTxSettings( &power, &bandwidth );
+    Stats.Tx++;
+
+    if( NextTx == REPLAY_NO_RECORD )
+    {
+        // The replay sends more frames than the device did
+        NextWindow = REPLAY_NO_RECORD;
+        Stats.TxDiff++;
+        if( Config.Quiet == false )
+        {
+            printf( "TX,-,%llu,%u,EXTRA\r\n", ( unsigned long long )RtcSimGetTime( ), size );
+        }
+        return;
+    }
+
+    tx = &Records[NextTx];
+    isSame = ( tx->Size >= 4 ) && ( GetUint32( tx->Payload ) == digest );
+    if( isSame == false )
+    {
+        Stats.TxDiff++;
+    }
+    if( Config.Quiet == false )
+    {
+        printf( "TX,%lu,%llu,%u,%s\r\n", ( unsigned long )tx->Time, ( unsigned long long )RtcSimGetTime( ), size,
+                ( isSame == true ) ? "SAME" : "DIFF" );
+    }
+
+    NextWindow = NextTx + 1;
+    NextTx = FindRecord( NextTx + 1, NbRecords, LORAMAC_TRACE_ID_TX );
+    txDone = FindRecord( NextWindow, NextTx, LORAMAC_TRACE_ID_TX_DONE );
+    RecordedTxDone = ( txDone != REPLAY_NO_RECORD ) ? Records[txDone].Time :
+                     tx->Time + ( ( tx->Size >= 13 ) ? GetUint16( &tx->Payload[11] ) : 0 );
+}
+
+/*!
+ * \brief Delivers the frame recorded in the matching reception window
+ *
+ * \remark The simulated radio has no reception errors, the recorded errors
+ *         are replayed as timeouts.
+ */
+static void OnRadioRx( uint32_t freq, uint8_t sf )
+{
+    uint64_t delay = RtcSimGetTime( ) - ReplayedTxDone;
+    uint32_t window = FindWindow( NextWindow, NextTx );
+    uint32_t outcome;
+    const char* outcomeName = "TIMEOUT";
+    int64_t recordedDelay;
+    uint8_t slot;
+
+    Stats.Windows++;
+    if( window == REPLAY_NO_RECORD )
+    {
+        Stats.WindowsShifted++;
+        if( Config.Quiet == false )
+        {
+            printf( "RX,-,-,%llu,EXTRA\r\n", ( unsigned long long )delay );
+        }
+        return;
+    }
+    NextWindow = window + 1;
+    slot = Records[window].Payload[0];
+    recordedDelay = ( int64_t )Records[window].Time - ( int64_t )RecordedTxDone;
+    if( llabs( ( int64_t )delay - recordedDelay ) > REPLAY_WINDOW_TOLERANCE )
+    {
+        Stats.WindowsShifted++;
+    }
+
+    outcome = FindOutcome( window );
+    if( outcome != REPLAY_NO_RECORD )
+    {
+        const ReplayRecord_t* rx = &Records[outcome];
+
+        if( ( rx->Id == LORAMAC_TRACE_ID_RX_DONE ) && ( rx->Size > 5 ) )
+        {
+            SimRadioQueueRxFrame( ( uint8_t* )&rx->Payload[5], rx->Size - 5, ( int16_t )GetUint16( &rx->Payload[2] ),
+                                  ( int8_t )rx->Payload[4] );
+            Stats.RxDone++;
+            outcomeName = "DONE";
+        }
+        else if( rx->Id == LORAMAC_TRACE_ID_RX_ERROR )
+        {
+            outcomeName = "ERROR";
+        }
+    }
+    if( Config.Quiet == false )
+    {
+        printf( "RX,%s,%lld,%llu,%s\r\n", SlotNames[slot], ( long long )recordedDelay, ( unsigned long long )delay,
+                outcomeName );
+    }
+}
+
+/*!
+ * Simulated radio hooks
+ */
+static SimRadioHooks_t RadioHooks =
+{
+    .OnTx = OnRadioTx,
+    .OnRx = OnRadioRx,
+};
+
+static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
+{
+}
+
+static void McpsIndication( McpsIndication_t *mcpsIndication )
+{
+}
+
+static void MlmeConfirm( MlmeConfirm_t *mlmeConfirm )
+{
+}
+
+static void MlmeIndication( MlmeIndication_t *mlmeIndication )
+{
+}
+
+/*!
+ * \brief Provisions the session keys or the join keys
+ */
+static void InitSession( void )
+{
+    MibRequestConfirm_t mibReq;
+
+    mibReq.Type = MIB_PUBLIC_NETWORK;
+    mibReq.Param.EnablePublicNetwork = true;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    if( Config.Otaa == true )
+    {
+        mibReq.Type = MIB_NWK_KEY;
+        mibReq.Param.NwkKey = Config.NwkKey;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_DEV_EUI;
+        mibReq.Param.DevEui = Config.DevEui;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+
+        mibReq.Type = MIB_JOIN_EUI;
+        mibReq.Param.JoinEui = Config.JoinEui;
+        LoRaMacMibSetRequestConfirm( &mibReq );
+        return;
+    }
+
+    mibReq.Type = MIB_ABP_LORAWAN_VERSION;
+    mibReq.Param.AbpLrWanVersion.Fields.Major = 1;
+    mibReq.Param.AbpLrWanVersion.Fields.Minor = 0;
+    mibReq.Param.AbpLrWanVersion.Fields.Revision = 4;
+    mibReq.Param.AbpLrWanVersion.Fields.Rfu = 0;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_DEV_ADDR;
+    mibReq.Param.DevAddr = Config.DevAddr;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_F_NWK_S_INT_KEY;
+    mibReq.Param.FNwkSIntKey = Config.NwkSKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_S_NWK_S_INT_KEY;
+    mibReq.Param.SNwkSIntKey = Config.NwkSKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_NWK_S_ENC_KEY;
+    mibReq.Param.NwkSEncKey = Config.NwkSKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_APP_S_KEY;
+    mibReq.Param.AppSKey = Config.AppSKey;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    mibReq.Type = MIB_NETWORK_ACTIVATION;
+    mibReq.Param.NetworkActivation = ACTIVATION_TYPE_ABP;
+    LoRaMacMibSetRequestConfirm( &mibReq );
+}
+
+/*!
+ * \brief Counts the recorded transmissions of a frame
+ *
+ * \remark The retransmissions of a confirmed uplink carry the same frame
+ *         counter, they have the digest of the first transmission.
+ *
+ * \param [IN] index First transmission record
+ * \retval nbTrials  Number of transmissions
+ */
+static uint8_t GetNbTrials( uint32_t index )
+{
+    uint32_t digest = GetUint32( Records[index].Payload );
+    uint8_t nbTrials = 1;
+
+    for( index = FindRecord( index + 1, NbRecords, LORAMAC_TRACE_ID_TX ); index != REPLAY_NO_RECORD;
+         index = FindRecord( index + 1, NbRecords, LORAMAC_TRACE_ID_TX ) )
+    {
+        if( ( Records[index].Size < 4 ) || ( GetUint32( Records[index].Payload ) != digest ) || ( nbTrials == UINT8_MAX ) )
+        {
+            break;
+        }
+        nbTrials++;
+    }
+    return nbTrials;
+}
+
+/*!
+ * \brief Requests the recorded frame
+ *
+ * \param [IN] tx Recorded transmission
+ * \retval status LoRaMac request status
+ */
+static LoRaMacStatus_t Request( const ReplayRecord_t* tx )
+{
+    MlmeReq_t mlmeReq;
+    McpsReq_t mcpsReq;
+    MibRequestConfirm_t mibReq;
+    uint8_t mType;
+
+    if( tx->Size < 13 )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    mType = tx->Payload[5] >> 5;
+
+    if( mType == FRAME_TYPE_JOIN_REQ )
+    {
+        mlmeReq.Type = MLME_JOIN;
+        mlmeReq.Req.Join.Datarate = ( int8_t )tx->Payload[9];
+        return LoRaMacMlmeRequest( &mlmeReq );
+    }
+
+    // The datarate is the one of the recorded frame, as if set by the ADR
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = ( int8_t )tx->Payload[9];
+    LoRaMacMibSetRequestConfirm( &mibReq );
+
+    if( mType == FRAME_TYPE_DATA_CONFIRMED_UP )
+    {
+        mcpsReq.Type = MCPS_CONFIRMED;
+        mcpsReq.Req.Confirmed.fPort = tx->Payload[6];
+        mcpsReq.Req.Confirmed.fBuffer = Payload;
+        mcpsReq.Req.Confirmed.fBufferSize = tx->Payload[7];
+        mcpsReq.Req.Confirmed.NbTrials = GetNbTrials( ( uint32_t )( tx - Records ) );
+        mcpsReq.Req.Confirmed.Datarate = ( int8_t )tx->Payload[9];
+    }
+    else
+    {
+        mcpsReq.Type = MCPS_UNCONFIRMED;
+        mcpsReq.Req.Unconfirmed.fPort = tx->Payload[6];
+        mcpsReq.Req.Unconfirmed.fBuffer = Payload;
+        mcpsReq.Req.Unconfirmed.fBufferSize = tx->Payload[7];
+        mcpsReq.Req.Unconfirmed.Datarate = ( int8_t )tx->Payload[9];
+    }
+    return LoRaMacMcpsRequest( &mcpsReq );
+}
+
+/*!
+ * \brief Replays the recorded uplinks exchanges, one at a time
+ */
+static void RunReplay( void )
+{
+    NextTx = FindRecord( 0, NbRecords, LORAMAC_TRACE_ID_TX );
+
+    while( NextTx != REPLAY_NO_RECORD )
+    {
+        const ReplayRecord_t* tx = &Records[NextTx];
+        uint32_t index = NextTx;
+        uint64_t now = RtcSimGetTime( );
+        uint64_t cpuTime;
+        LoRaMacStatus_t status;
+
+        // The uplinks are requested at the recorded time, the MAC then sends
+        // its retransmissions and its own uplinks by itself
+        if( tx->Time > now )
+        {
+            RtcSimAdvance( tx->Time - now );
+        }
+
+        cpuTime = GetCpuTime( );
+        status = Request( tx );
+        if( status == LORAMAC_STATUS_OK )
+        {
+            Stats.Uplinks++;
+            LoRaMacProcess( );
+            while( LoRaMacIsBusy( ) == true )
+            {
+                if( RtcSimAdvanceToAlarm( ) == false )
+                {
+                    break;
+                }
+                LoRaMacProcess( );
+            }
+        }
+        cpuTime = GetCpuTime( ) - cpuTime;
+        Stats.CpuTime += cpuTime;
+        Stats.MaxCpuTime = MAX( Stats.MaxCpuTime, cpuTime );
+
+        if( Config.Quiet == false )
+        {
+            printf( "UPLINK,%lu,%d,%llu\r\n", ( unsigned long )tx->Time, status, ( unsigned long long )cpuTime );
+        }
+        if( NextTx == index )
+        {
+            // Not sent, the recorded frame is skipped
+            NextTx = FindRecord( index + 1, NbRecords, LORAMAC_TRACE_ID_TX );
+        }
+    }
+}
+
+/**
+ * Main application entry point.
+ */
+int main( int argc, char* argv[] )
+{
+    if( ParseArguments( argc, argv ) == false )
+    {
+        PrintUsage( argv[0] );
+        return EXIT_FAILURE;
+    }
+    if( LoadTrace( Config.TraceFile ) == false )
+    {
+        return EXIT_FAILURE;
+    }
+
+    BoardInitMcu( );
+    SimRadioSetHooks( &RadioHooks );
+
+    // The replay draws the same numbers on every run
+    srand( Config.Seed );
+    srand1( Config.Seed );
+
+    MacPrimitives.MacMcpsConfirm = McpsConfirm;
+    MacPrimitives.MacMcpsIndication = McpsIndication;
+    MacPrimitives.MacMlmeConfirm = MlmeConfirm;
+    MacPrimitives.MacMlmeIndication = MlmeIndication;
+    MacCallbacks.GetBatteryLevel = BoardGetBatteryLevel;
+    MacCallbacks.GetTemperatureLevel = NULL;
+    MacCallbacks.NvmContextChange = NULL;
+    MacCallbacks.MacProcessNotify = NULL;
+
+    // The virtual time runs on the recorded time line
+    if( ( RtcSimSetTime( Records[0].Time ) == false ) ||
+        ( LoRaMacInitialization( &MacPrimitives, &MacCallbacks, ACTIVE_REGION ) != LORAMAC_STATUS_OK ) )
+    {
+        fprintf( stderr, "LoRaMac initialization failed\r\n" );
+        return EXIT_FAILURE;
+    }
+    InitSession( );
+    // The uplinks go out at the recorded times
+    LoRaMacTestSetDutyCycleOn( false );
+    LoRaMacStart( );
+
+    RunReplay( );
+
+    // Machine readable summary
+    printf( "REPLAY,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%llu,%llu\r\n", ( unsigned long )NbRecords,
+            ( unsigned long )NbDropped, ( unsigned long )Stats.Uplinks, ( unsigned long )Stats.Tx,
+            ( unsigned long )Stats.TxDiff, ( unsigned long )Stats.Windows, ( unsigned long )Stats.WindowsShifted,
+            ( unsigned long )Stats.RxDone, ( unsigned long )( RtcSimGetTime( ) - Records[0].Time ),
+            ( unsigned long long )Stats.CpuTime, ( unsigned long long )Stats.MaxCpuTime );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,513 @@
+/*!
+ * \file      PingPongBenchmark.c
+ *
+ * \brief     Measures the radio link goodput, round-trip latency, Tx to Rx
+ *            turnaround time and packet error rate over a sweep of LoRa
+ *            settings and payload lengths
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include "utilities.h"
+#include "board.h"
+#include "delay.h"
+#include "timer.h"
+#include "radio.h"
+#include "PingPongBenchmark.h"
+
+/*!
+ * Spreading factors of the sweep [SF7..SF12]
+ */
+static const uint8_t SpreadingFactors[] = { 7, 8, 9, 10, 11, 12 };
+
+/*!
+ * Bandwidths of the sweep [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ */
+static const uint8_t Bandwidths[] = { 0, 1, 2 };
+
+/*!
+ * Coding rates of the sweep [1: 4/5, 2: 4/6, 3: 4/7, 4: 4/8]
+ */
+static const uint8_t CodingRates[] = { 1, 4 };
+
+/*!
+ * Payload lengths of the sweep [bytes], at least PING_PONG_BENCHMARK_HEADER_SIZE
+ */
+static const uint8_t PayloadSizes[] = { 16, 64, 255 };
+
+/*!
+ * Number of PING frames sent per step
+ */
+#define PING_PONG_BENCHMARK_NB_PACKETS              10
+
+/*!
+ * Control settings, used to announce the steps
+ */
+#define PING_PONG_BENCHMARK_CONTROL_SF              7
+#define PING_PONG_BENCHMARK_CONTROL_BW              0
+#define PING_PONG_BENCHMARK_CONTROL_CR              1
+
+#define PING_PONG_BENCHMARK_PREAMBLE_LENGTH         8
+
+/*!
+ * Tx timeout [ms], above the longest time on air of the sweep
+ */
+#define PING_PONG_BENCHMARK_TX_TIMEOUT              20000
+
+/*!
+ * Time allowed to the peer on top of the frame time on air [ms]
+ */
+#define PING_PONG_BENCHMARK_RX_MARGIN               100
+
+/*!
+ * Delay given to the peer to switch its settings before the first frame [ms]
+ */
+#define PING_PONG_BENCHMARK_SWITCH_DELAY            20
+
+/*!
+ * Number of step announcements sent before the step is skipped
+ */
+#define PING_PONG_BENCHMARK_SETUP_RETRIES           5
+
+/*!
+ * Number of consecutive missed PING frames after which the slave returns to
+ * the control settings
+ */
+#define PING_PONG_BENCHMARK_MAX_MISSES              3
+
+/*!
+ * Frame types, first byte of the frames
+ */
+#define PING_PONG_BENCHMARK_SETUP                   'S'
+#define PING_PONG_BENCHMARK_SETUP_ACK               'A'
+#define PING_PONG_BENCHMARK_PING                    'P'
+#define PING_PONG_BENCHMARK_PONG                    'O'
+
+/*!
+ * PING and PONG header { Type, Step, Seq[2], SlaveTurnaround[4] }
+ */
+#define PING_PONG_BENCHMARK_HEADER_SIZE             8
+
+/*!
+ * SETUP frame { Type, Step, Sf, Bw, Cr, Size, NbPackets }
+ */
+#define PING_PONG_BENCHMARK_SETUP_SIZE              7
+
+/*!
+ * Radio events reported to the benchmark loop
+ */
+typedef enum eBenchmarkEvent
+{
+    BENCHMARK_EVENT_NONE,
+    BENCHMARK_EVENT_TX_DONE,
+    BENCHMARK_EVENT_TX_TIMEOUT,
+    BENCHMARK_EVENT_RX_DONE,
+    BENCHMARK_EVENT_RX_TIMEOUT,
+    BENCHMARK_EVENT_RX_ERROR,
+}BenchmarkEvent_t;
+
+/*!
+ * Settings of a step of the sweep
+ */
+typedef struct sBenchmarkStep
+{
+    uint8_t Index;
+    uint8_t Sf;
+    uint8_t Bw;
+    uint8_t Cr;
+    uint8_t Size;
+    uint8_t NbPackets;
+}BenchmarkStep_t;
+
+/*!
+ * Radio events function pointer
+ */
+static RadioEvents_t BenchmarkRadioEvents;
+
+/*!
+ * Last radio event, set by the radio callbacks
+ */
+static volatile BenchmarkEvent_t Event = BENCHMARK_EVENT_NONE;
+
+/*!
+ * Timer ticks captured at the last Tx done and Rx done interrupt edges
+ */
+static uint32_t TxDoneTicks = 0;
+static uint32_t RxDoneTicks = 0;
+
+/*!
+ * Timer ticks captured when the last reception was started
+ */
+static uint32_t RxStartTicks = 0;
+
+/*!
+ * Last received frame
+ */
+static uint8_t Buffer[255];
+static uint8_t BufferSize = 0;
+static int16_t RssiValue = 0;
+static int8_t SnrValue = 0;
+
+/*!
+ * Tx output power [dBm]
+ */
+static int8_t TxPower = 0;
+
+static void OnTxDone( uint32_t timestamp )
+{
+    Radio.Sleep( );
+    TxDoneTicks = timestamp;
+    Event = BENCHMARK_EVENT_TX_DONE;
+}
+
+static void OnRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr, uint32_t timestamp )
+{
+    Radio.Sleep( );
+    RxDoneTicks = timestamp;
+    BufferSize = MIN( size, sizeof( Buffer ) );
+    memcpy1( Buffer, payload, BufferSize );
+    RssiValue = rssi;
+    SnrValue = snr;
+    Event = BENCHMARK_EVENT_RX_DONE;
+}
+
+static void OnTxTimeout( void )
+{
+    Radio.Sleep( );
+    Event = BENCHMARK_EVENT_TX_TIMEOUT;
+}
+
+static void OnRxTimeout( void )
+{
+    Radio.Sleep( );
+    Event = BENCHMARK_EVENT_RX_TIMEOUT;
+}
+
+static void OnRxError( void )
+{
+    Radio.Sleep( );
+    Event = BENCHMARK_EVENT_RX_ERROR;
+}
+
+/*!
+ * \brief Waits for the next radio event
+ *
+ * \retval event Radio event
+ */
+static BenchmarkEvent_t WaitEvent( void )
+{
+    BenchmarkEvent_t event;
+
+    while( Event == BENCHMARK_EVENT_NONE )
+    {
+        BoardLowPowerHandler( );
+        // Process Radio IRQ
+        if( Radio.IrqProcess != NULL )
+        {
+            Radio.IrqProcess( );
+        }
+    }
+    event = Event;
+    Event = BENCHMARK_EVENT_NONE;
+    return event;
+}
+
+/*!
+ * \brief Applies the given LoRa settings to both Tx and Rx
+ */
+static void SetConfig( uint8_t sf, uint8_t bw, uint8_t cr )
+{
+    Radio.SetTxConfig( MODEM_LORA, TxPower, 0, bw, sf, cr,
+                                   PING_PONG_BENCHMARK_PREAMBLE_LENGTH, false,
+                                   true, 0, 0, false, PING_PONG_BENCHMARK_TX_TIMEOUT );
+
+    Radio.SetRxConfig( MODEM_LORA, bw, sf, cr, 0, PING_PONG_BENCHMARK_PREAMBLE_LENGTH,
+                                   0, false, 0, true, 0, 0, false, true );
+}
+
+static BenchmarkEvent_t Send( uint8_t *buffer, uint8_t size )
+{
+    Radio.Send( buffer, size );
+    return WaitEvent( );
+}
+
+static BenchmarkEvent_t Receive( uint32_t timeout )
+{
+    RxStartTicks = TimerGetCurrentTicks( );
+    Radio.Rx( timeout );
+    return WaitEvent( );
+}
+
+/*!
+ * \brief Answers the PING frames of a step until the last one or until the
+ *        master is lost
+ */
+static void RunSlaveStep( BenchmarkStep_t *step )
+{
+    uint8_t frame[255];
+    uint8_t misses = 0;
+    uint16_t seq = 0;
+    uint32_t timeout = 0;
+    uint32_t turnaround = 0;
+
+    SetConfig( step->Sf, step->Bw, step->Cr );
+    timeout = 2 * ( Radio.TimeOnAir( MODEM_LORA, step->Size ) + PING_PONG_BENCHMARK_RX_MARGIN );
+
+    while( misses < PING_PONG_BENCHMARK_MAX_MISSES )
+    {
+        if( ( Receive( timeout ) != BENCHMARK_EVENT_RX_DONE ) ||
+            ( BufferSize < PING_PONG_BENCHMARK_HEADER_SIZE ) ||
+            ( Buffer[0] != PING_PONG_BENCHMARK_PING ) || ( Buffer[1] != step->Index ) )
+        {
+            misses++;
+            continue;
+        }
+        misses = 0;
+        seq = Buffer[2] | ( Buffer[3] << 8 );
+
+        memcpy1( frame, Buffer, BufferSize );
+        frame[0] = PING_PONG_BENCHMARK_PONG;
+        turnaround = TimerTicks2Us( TimerGetCurrentTicks( ) - RxDoneTicks );
+        frame[4] = turnaround & 0xFF;
+        frame[5] = ( turnaround >> 8 ) & 0xFF;
+        frame[6] = ( turnaround >> 16 ) & 0xFF;
+        frame[7] = ( turnaround >> 24 ) & 0xFF;
+        Send( frame, BufferSize );
+
+        if( seq >= ( step->NbPackets - 1 ) )
+        {
+            break;
+        }
+    }
+}
+
+/*!
+ * \brief Runs the slave side, never returns
+ */
+static void RunSlave( void )
+{
+    BenchmarkStep_t step;
+    uint8_t ack[2];
+
+    while( 1 )
+    {
+        SetConfig( PING_PONG_BENCHMARK_CONTROL_SF, PING_PONG_BENCHMARK_CONTROL_BW, PING_PONG_BENCHMARK_CONTROL_CR );
+
+        if( ( Receive( 0 ) != BENCHMARK_EVENT_RX_DONE ) ||
+            ( BufferSize < PING_PONG_BENCHMARK_SETUP_SIZE ) || ( Buffer[0] != PING_PONG_BENCHMARK_SETUP ) )
+        {
+            continue;
+        }
+        step.Index = Buffer[1];
+        step.Sf = Buffer[2];
+        step.Bw = Buffer[3];
+        step.Cr = Buffer[4];
+        step.Size = Buffer[5];
+        step.NbPackets = Buffer[6];
+
+        ack[0] = PING_PONG_BENCHMARK_SETUP_ACK;
+        ack[1] = step.Index;
+        if( Send( ack, sizeof( ack ) ) == BENCHMARK_EVENT_TX_DONE )
+        {
+            RunSlaveStep( &step );
+        }
+    }
+}
+
+/*!
+ * \brief Announces a step on the control settings
+ *
+ * \retval status true when the slave has acknowledged the step
+ */
+static bool SetupStep( BenchmarkStep_t *step )
+{
+    uint8_t setup[PING_PONG_BENCHMARK_SETUP_SIZE];
+    uint32_t timeout = 0;
+
+    setup[0] = PING_PONG_BENCHMARK_SETUP;
+    setup[1] = step->Index;
+    setup[2] = step->Sf;
+    setup[3] = step->Bw;
+    setup[4] = step->Cr;
+    setup[5] = step->Size;
+    setup[6] = step->NbPackets;
+
+    SetConfig( PING_PONG_BENCHMARK_CONTROL_SF, PING_PONG_BENCHMARK_CONTROL_BW, PING_PONG_BENCHMARK_CONTROL_CR );
+    timeout = Radio.TimeOnAir( MODEM_LORA, 2 ) + PING_PONG_BENCHMARK_RX_MARGIN;
+
+    for( uint8_t i = 0; i < PING_PONG_BENCHMARK_SETUP_RETRIES; i++ )
+    {
+        DelayMs( PING_PONG_BENCHMARK_SWITCH_DELAY );
+        if( ( Send( setup, sizeof( setup ) ) == BENCHMARK_EVENT_TX_DONE ) &&
+            ( Receive( timeout ) == BENCHMARK_EVENT_RX_DONE ) &&
+            ( BufferSize >= 2 ) && ( Buffer[0] == PING_PONG_BENCHMARK_SETUP_ACK ) && ( Buffer[1] == step->Index ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Runs a step of the sweep and prints its results
+ */
+static void RunMasterStep( BenchmarkStep_t *step )
+{
+    uint8_t frame[255];
+    uint16_t received = 0;
+    uint32_t timeout = 0;
+    uint32_t txStartTicks = 0;
+    uint32_t rtt = 0;
+    uint32_t rttMin = UINT32_MAX;
+    uint32_t rttMax = 0;
+    uint64_t rttSum = 0;
+    uint64_t turnaroundSum = 0;
+    uint64_t slaveTurnaroundSum = 0;
+    int32_t rssiSum = 0;
+    int32_t snrSum = 0;
+    TimerTime_t stepStart = 0;
+    TimerTime_t elapsed = 0;
+
+    if( SetupStep( step ) == false )
+    {
+        printf( "BENCH,%u,%u,%u,%u,%u,SKIPPED\r\n", step->Index, step->Sf, step->Bw, step->Cr, step->Size );
+        return;
+    }
+
+    SetConfig( step->Sf, step->Bw, step->Cr );
+    timeout = Radio.TimeOnAir( MODEM_LORA, step->Size ) + PING_PONG_BENCHMARK_RX_MARGIN;
+
+    for( uint8_t i = 0; i < step->Size; i++ )
+    {
+        frame[i] = i;
+    }
+    frame[0] = PING_PONG_BENCHMARK_PING;
+    frame[1] = step->Index;
+
+    DelayMs( PING_PONG_BENCHMARK_SWITCH_DELAY );
+    stepStart = TimerGetCurrentTime( );
+
+    for( uint16_t seq = 0; seq < step->NbPackets; seq++ )
+    {
+        frame[2] = seq & 0xFF;
+        frame[3] = ( seq >> 8 ) & 0xFF;
+
+        DelayMs( 1 );
+        txStartTicks = TimerGetCurrentTicks( );
+        if( Send( frame, step->Size ) != BENCHMARK_EVENT_TX_DONE )
+        {
+            continue;
+        }
+        if( ( Receive( timeout ) != BENCHMARK_EVENT_RX_DONE ) ||
+            ( BufferSize != step->Size ) || ( Buffer[0] != PING_PONG_BENCHMARK_PONG ) ||
+            ( Buffer[1] != step->Index ) || ( ( Buffer[2] | ( Buffer[3] << 8 ) ) != seq ) )
+        {
+            continue;
+        }
+        received++;
+
+        rtt = TimerTicks2Us( RxDoneTicks - txStartTicks );
+        rttSum += rtt;
+        rttMin = MIN( rttMin, rtt );
+        rttMax = MAX( rttMax, rtt );
+        turnaroundSum += TimerTicks2Us( RxStartTicks - TxDoneTicks );
+        slaveTurnaroundSum += ( uint32_t )Buffer[4] | ( ( uint32_t )Buffer[5] << 8 ) |
+                              ( ( uint32_t )Buffer[6] << 16 ) | ( ( uint32_t )Buffer[7] << 24 );
+        rssiSum += RssiValue;
+        snrSum += SnrValue;
+    }
+    elapsed = MAX( TimerGetElapsedTime( stepStart ), 1 );
+
+    if( received == 0 )
+    {
+        printf( "BENCH,%u,%u,%u,%u,%u,%u,0,1000,0,,,,,,,\r\n", step->Index, step->Sf, step->Bw, step->Cr, step->Size, step->NbPackets );
+        return;
+    }
+    printf( "BENCH,%u,%u,%u,%u,%u,%u,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu,%ld,%ld\r\n",
+            step->Index, step->Sf, step->Bw, step->Cr, step->Size, step->NbPackets, received,
+            ( 1000 * ( step->NbPackets - received ) ) / step->NbPackets,
+            ( unsigned long )( ( ( uint64_t )received * step->Size * 8 * 1000 ) / elapsed ),
+            ( unsigned long )( rttSum / received ), ( unsigned long )rttMin, ( unsigned long )rttMax,
+            ( unsigned long )( turnaroundSum / received ), ( unsigned long )( slaveTurnaroundSum / received ),
+            ( long )( rssiSum / received ), ( long )( snrSum / received ) );
+}
+
+/*!
+ * \brief Runs the sweep on the master side, never returns
+ */
+static void RunMaster( void )
+{
+    BenchmarkStep_t step;
+
+    step.Index = 0;
+    step.NbPackets = PING_PONG_BENCHMARK_NB_PACKETS;
+
+    printf( "BENCH,STEP,SF,BW,CR,SIZE,SENT,RECEIVED,PER,GOODPUT,RTT_AVG,RTT_MIN,RTT_MAX,TURNAROUND,SLAVE_TURNAROUND,RSSI,SNR\r\n" );
+
+    for( uint8_t sf = 0; sf < sizeof( SpreadingFactors ); sf++ )
+    {
+        for( uint8_t bw = 0; bw < sizeof( Bandwidths ); bw++ )
+        {
+            for( uint8_t cr = 0; cr < sizeof( CodingRates ); cr++ )
+            {
+                for( uint8_t size = 0; size < sizeof( PayloadSizes ); size++ )
+                {
+                    step.Sf = SpreadingFactors[sf];
+                    step.Bw = Bandwidths[bw];
+                    step.Cr = CodingRates[cr];
+                    step.Size = MAX( PayloadSizes[size], PING_PONG_BENCHMARK_HEADER_SIZE );
+
+                    RunMasterStep( &step );
+                    step.Index++;
+                }
+            }
+        }
+    }
+    printf( "BENCH,END\r\n" );
+
+    Radio.Sleep( );
+    while( 1 )
+    {
+        BoardLowPowerHandler( );
+    }
+}
+
+void PingPongBenchmark( uint32_t frequency, int8_t power )
+{
+    TxPower = power;
+
+    BenchmarkRadioEvents.TxDoneTimestamped = OnTxDone;
+    BenchmarkRadioEvents.RxDoneTimestamped = OnRxDone;
+    BenchmarkRadioEvents.TxTimeout = OnTxTimeout;
+    BenchmarkRadioEvents.RxTimeout = OnRxTimeout;
+    BenchmarkRadioEvents.RxError = OnRxError;
+
+    Radio.Init( &BenchmarkRadioEvents );
+    Radio.SetChannel( frequency );
+    srand1( Radio.Random( ) );
+
+    // The board hearing an announcement from a master becomes the slave
+    SetConfig( PING_PONG_BENCHMARK_CONTROL_SF, PING_PONG_BENCHMARK_CONTROL_BW, PING_PONG_BENCHMARK_CONTROL_CR );
+    if( ( Receive( randr( 1000, 3000 ) ) == BENCHMARK_EVENT_RX_DONE ) &&
+        ( BufferSize >= PING_PONG_BENCHMARK_SETUP_SIZE ) && ( Buffer[0] == PING_PONG_BENCHMARK_SETUP ) )
+    {
+        printf( "BENCH,SLAVE\r\n" );
+        // Let the master retry the announcement
+        RunSlave( );
+    }
+    RunMaster( );
+}
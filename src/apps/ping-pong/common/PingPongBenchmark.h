@@ -0,0 +1,50 @@
+/*!
+ * \file      PingPongBenchmark.h
+ *
+ * \brief     Measures the radio link goodput, round-trip latency, Tx to Rx
+ *            turnaround time and packet error rate over a sweep of LoRa
+ *            settings and payload lengths
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __PING_PONG_BENCHMARK_H__
+#define __PING_PONG_BENCHMARK_H__
+
+#include <stdint.h>
+
+/*!
+ * \brief Runs the link benchmark between two boards. Never returns.
+ *
+ * \remark Both boards listen for a random time on the control settings
+ *         (SF7, 125 kHz, 4/5). The one which hears nothing becomes the master,
+ *         announces each step of the sweep on the control settings and
+ *         exchanges PING/PONG frames with the slave on the step settings.
+ *
+ *         The master prints one machine readable line per step over the
+ *         UART:
+ *         BENCH,STEP,SF,BW,CR,SIZE,SENT,RECEIVED,PER,GOODPUT,RTT_AVG,RTT_MIN,RTT_MAX,TURNAROUND,SLAVE_TURNAROUND,RSSI,SNR
+ *         PER is given in per mille, GOODPUT in bit/s of acknowledged PING
+ *         payload, the times in microseconds. TURNAROUND is the time from
+ *         the TxDone interrupt edge to the Rx start, SLAVE_TURNAROUND the
+ *         time from the RxDone interrupt edge to the Tx start reported by
+ *         the slave.
+ *
+ * \param [IN] frequency RF frequency [Hz]
+ * \param [IN] power     Tx output power [dBm]
+ */
+void PingPongBenchmark( uint32_t frequency, int8_t power );
+
+#endif // __PING_PONG_BENCHMARK_H__
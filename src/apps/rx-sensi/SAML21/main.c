@@ -32,6 +32,10 @@
 #include "timer.h"
 #include "radio.h"
 
+#if defined( RX_SENSI_SWEEP_ENABLED )
+#include "RxSensiSweep.h"
+#endif
+
 #if defined( REGION_AS923 )
 
 #define RF_FREQUENCY                                923000000 // Hz
@@ -128,6 +132,16 @@ int main( void )
     BoardInitMcu( );
     BoardInitPeriph( );
 
+#if defined( RX_SENSI_SWEEP_ENABLED )
+#if defined( RX_SENSI_SWEEP_TRANSMITTER )
+    RxSensiSweepTransmitter( RF_FREQUENCY );
+#else
+    // Steps through the scheduled frequencies and datarates instead of
+    // receiving on a single configuration
+    RxSensiSweepReceiver( RF_FREQUENCY );
+#endif
+#endif
+
     // Radio initialization
     RadioEvents.RxDone = OnRxDone;
 
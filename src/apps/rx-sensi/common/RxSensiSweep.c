@@ -0,0 +1,408 @@
+/*!
+ * \file      RxSensiSweep.c
+ *
+ * \brief     Steps the receiver through a schedule of frequencies and
+ *            datarates and collects the packet error rate, RSSI and SNR
+ *            statistics of each step
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include "utilities.h"
+#include "board.h"
+#include "timer.h"
+#include "radio.h"
+#include "RxSensiSweep.h"
+
+/*!
+ * LoRa datarate of a step
+ */
+typedef struct sRxSensiSweepDatarate
+{
+    uint8_t Sf; // [SF7..SF12]
+    uint8_t Bw; // [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+}RxSensiSweepDatarate_t;
+
+/*!
+ * Frequency offsets of the schedule from the base frequency [Hz]
+ */
+static const int32_t FrequencyOffsets[] = { 0, 200000, 400000 };
+
+/*!
+ * Datarates of the schedule, swept for each frequency
+ */
+static const RxSensiSweepDatarate_t Datarates[] =
+{
+    { 7, 0 }, { 8, 0 }, { 9, 0 }, { 10, 0 }, { 11, 0 }, { 12, 0 },
+};
+
+#define RX_SENSI_SWEEP_NB_FREQUENCIES               ( sizeof( FrequencyOffsets ) / sizeof( FrequencyOffsets[0] ) )
+#define RX_SENSI_SWEEP_NB_DATARATES                 ( sizeof( Datarates ) / sizeof( Datarates[0] ) )
+#define RX_SENSI_SWEEP_NB_STEPS                     ( RX_SENSI_SWEEP_NB_FREQUENCIES * RX_SENSI_SWEEP_NB_DATARATES )
+
+/*!
+ * Number of frames sent per step
+ */
+#define RX_SENSI_SWEEP_NB_PACKETS                   50
+
+/*!
+ * Frame length { 'R', 'S', Run, Step, Seq[2], Padding } [bytes]
+ */
+#define RX_SENSI_SWEEP_PAYLOAD_SIZE                 16
+
+#define RX_SENSI_SWEEP_CODINGRATE                   1
+#define RX_SENSI_SWEEP_PREAMBLE_LENGTH              8
+
+/*!
+ * Transmitter output power [dBm]. The path to the receivers is expected to
+ * be attenuated down to the sensitivity levels under test.
+ */
+#define RX_SENSI_SWEEP_TX_POWER                     14
+
+/*!
+ * Schedule of a step: the first frame is sent RX_SENSI_SWEEP_STEP_LEAD after
+ * the step start, the next ones every time on air + RX_SENSI_SWEEP_FRAME_GAP,
+ * and the step ends RX_SENSI_SWEEP_STEP_TAIL after the last one [ms]
+ */
+#define RX_SENSI_SWEEP_STEP_LEAD                    100
+#define RX_SENSI_SWEEP_FRAME_GAP                    50
+#define RX_SENSI_SWEEP_STEP_TAIL                    100
+
+/*!
+ * Histograms bins
+ */
+#define RX_SENSI_SWEEP_RSSI_MIN                     -140 // dBm
+#define RX_SENSI_SWEEP_RSSI_BIN                     10   // dB
+#define RX_SENSI_SWEEP_RSSI_NB_BINS                 12
+#define RX_SENSI_SWEEP_SNR_MIN                      -25  // dB
+#define RX_SENSI_SWEEP_SNR_BIN                      5    // dB
+#define RX_SENSI_SWEEP_SNR_NB_BINS                  8
+
+/*!
+ * Statistics of a step
+ */
+typedef struct sRxSensiSweepStats
+{
+    uint16_t Expected;
+    uint16_t Received;
+    uint16_t CrcErrors;
+    int32_t RssiSum;
+    int32_t SnrSum;
+    uint16_t RssiHistogram[RX_SENSI_SWEEP_RSSI_NB_BINS];
+    uint16_t SnrHistogram[RX_SENSI_SWEEP_SNR_NB_BINS];
+    TimerTime_t RxOnTime;
+}RxSensiSweepStats_t;
+
+/*!
+ * Radio events function pointer
+ */
+static RadioEvents_t RadioEvents;
+
+/*!
+ * Base RF frequency of the schedule [Hz]
+ */
+static uint32_t BaseFrequency = 0;
+
+/*!
+ * Timer used to wait for the schedule events
+ */
+static TimerEvent_t ScheduleTimer;
+static volatile bool ScheduleTimerFired = false;
+
+/*!
+ * Set when the transmission is done or has timed out
+ */
+static volatile bool TxFinished = false;
+
+/*!
+ * Receiver state, updated from the radio callbacks
+ */
+static RxSensiSweepStats_t Stats[RX_SENSI_SWEEP_NB_STEPS];
+static volatile bool Synchronized = false;
+static uint8_t CurrentRun = 0;
+static uint8_t CurrentStep = 0;
+static uint16_t SyncSeq = 0;
+static TimerTime_t SyncTime = 0;
+
+/*!
+ * \brief Processes the radio events until the flag is set
+ */
+static void WaitFlag( volatile bool *flag )
+{
+    while( *flag == false )
+    {
+        BoardLowPowerHandler( );
+        // Process Radio IRQ
+        if( Radio.IrqProcess != NULL )
+        {
+            Radio.IrqProcess( );
+        }
+    }
+}
+
+static void OnScheduleTimerEvent( void* context )
+{
+    ScheduleTimerFired = true;
+}
+
+/*!
+ * \brief Processes the radio events until the given time
+ *
+ * \param [IN] time System time to wait for [ms]
+ */
+static void WaitUntil( TimerTime_t time )
+{
+    int32_t delay = ( int32_t )( time - TimerGetCurrentTime( ) );
+
+    if( delay <= 0 )
+    {
+        return;
+    }
+    ScheduleTimerFired = false;
+    TimerSetValue( &ScheduleTimer, delay );
+    TimerStart( &ScheduleTimer );
+    WaitFlag( &ScheduleTimerFired );
+}
+
+/*!
+ * \brief Applies the settings of a step
+ *
+ * \param [IN] step Step index
+ * \retval period   Period of the frames of the step [ms]
+ */
+static uint32_t SetStep( uint8_t step )
+{
+    const RxSensiSweepDatarate_t *datarate = &Datarates[step % RX_SENSI_SWEEP_NB_DATARATES];
+
+    Radio.SetChannel( BaseFrequency + FrequencyOffsets[step / RX_SENSI_SWEEP_NB_DATARATES] );
+
+    Radio.SetTxConfig( MODEM_LORA, RX_SENSI_SWEEP_TX_POWER, 0, datarate->Bw,
+                                   datarate->Sf, RX_SENSI_SWEEP_CODINGRATE,
+                                   RX_SENSI_SWEEP_PREAMBLE_LENGTH, false,
+                                   true, 0, 0, false, 3000 );
+
+    Radio.SetRxConfig( MODEM_LORA, datarate->Bw, datarate->Sf,
+                                   RX_SENSI_SWEEP_CODINGRATE, 0, RX_SENSI_SWEEP_PREAMBLE_LENGTH,
+                                   0, false, 0, true, 0, 0, false, true );
+
+    return Radio.TimeOnAir( MODEM_LORA, RX_SENSI_SWEEP_PAYLOAD_SIZE ) + RX_SENSI_SWEEP_FRAME_GAP;
+}
+
+/*!
+ * \brief Computes the duration of a step
+ *
+ * \param [IN] period Period of the frames of the step [ms]
+ * \retval duration   Step duration [ms]
+ */
+static TimerTime_t StepDuration( uint32_t period )
+{
+    return RX_SENSI_SWEEP_STEP_LEAD + ( RX_SENSI_SWEEP_NB_PACKETS * period ) + RX_SENSI_SWEEP_STEP_TAIL;
+}
+
+static void OnTxDone( void )
+{
+    TxFinished = true;
+}
+
+static void OnTxTimeout( void )
+{
+    TxFinished = true;
+}
+
+static void OnRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
+{
+    RxSensiSweepStats_t *stats = &Stats[CurrentStep];
+    int32_t bin = 0;
+
+    if( ( size != RX_SENSI_SWEEP_PAYLOAD_SIZE ) || ( payload[0] != 'R' ) || ( payload[1] != 'S' ) )
+    {
+        return;
+    }
+
+    if( Synchronized == false )
+    {
+        if( payload[3] != 0 )
+        {
+            return;
+        }
+        CurrentRun = payload[2];
+        SyncSeq = payload[4] | ( payload[5] << 8 );
+        SyncTime = TimerGetCurrentTime( );
+        Synchronized = true;
+    }
+    else if( ( payload[2] != CurrentRun ) || ( payload[3] != CurrentStep ) )
+    {
+        // Frame of another step, the schedules have drifted apart
+        return;
+    }
+
+    stats->Received++;
+    stats->RssiSum += rssi;
+    stats->SnrSum += snr;
+
+    bin = ( rssi - RX_SENSI_SWEEP_RSSI_MIN ) / RX_SENSI_SWEEP_RSSI_BIN;
+    stats->RssiHistogram[MIN( MAX( bin, 0 ), RX_SENSI_SWEEP_RSSI_NB_BINS - 1 )]++;
+    bin = ( snr - RX_SENSI_SWEEP_SNR_MIN ) / RX_SENSI_SWEEP_SNR_BIN;
+    stats->SnrHistogram[MIN( MAX( bin, 0 ), RX_SENSI_SWEEP_SNR_NB_BINS - 1 )]++;
+}
+
+static void OnRxError( void )
+{
+    if( Synchronized == true )
+    {
+        Stats[CurrentStep].CrcErrors++;
+    }
+}
+
+/*!
+ * \brief Prints the statistics of the run
+ */
+static void PrintRun( void )
+{
+    for( uint8_t step = 0; step < RX_SENSI_SWEEP_NB_STEPS; step++ )
+    {
+        RxSensiSweepStats_t *stats = &Stats[step];
+        const RxSensiSweepDatarate_t *datarate = &Datarates[step % RX_SENSI_SWEEP_NB_DATARATES];
+        uint16_t lost = ( stats->Expected > stats->Received ) ? ( stats->Expected - stats->Received ) : 0;
+
+        printf( "SWEEP,%u,%u,%lu,%u,%u,%u,%u,%u,%u,", CurrentRun, step,
+                ( unsigned long )( BaseFrequency + FrequencyOffsets[step / RX_SENSI_SWEEP_NB_DATARATES] ),
+                datarate->Sf, datarate->Bw, stats->Expected, stats->Received, stats->CrcErrors,
+                ( stats->Expected > 0 ) ? ( 1000 * lost ) / stats->Expected : 0 );
+        if( stats->Received > 0 )
+        {
+            printf( "%ld,%ld,", ( long )( stats->RssiSum / stats->Received ), ( long )( stats->SnrSum / stats->Received ) );
+        }
+        else
+        {
+            printf( ",," );
+        }
+        printf( "%lu\r\n", ( unsigned long )stats->RxOnTime );
+
+        printf( "RSSI_HIST,%u,%u", CurrentRun, step );
+        for( uint8_t i = 0; i < RX_SENSI_SWEEP_RSSI_NB_BINS; i++ )
+        {
+            printf( ",%u", stats->RssiHistogram[i] );
+        }
+        printf( "\r\nSNR_HIST,%u,%u", CurrentRun, step );
+        for( uint8_t i = 0; i < RX_SENSI_SWEEP_SNR_NB_BINS; i++ )
+        {
+            printf( ",%u", stats->SnrHistogram[i] );
+        }
+        printf( "\r\n" );
+    }
+}
+
+void RxSensiSweepReceiver( uint32_t frequency )
+{
+    TimerTime_t stepStart = 0;
+    TimerTime_t stepEnd = 0;
+    TimerTime_t rxOnStart = 0;
+    uint32_t period = 0;
+
+    BaseFrequency = frequency;
+    TimerInit( &ScheduleTimer, OnScheduleTimerEvent );
+
+    RadioEvents.RxDone = OnRxDone;
+    RadioEvents.RxError = OnRxError;
+    Radio.Init( &RadioEvents );
+
+    printf( "SWEEP,RUN,STEP,FREQ,SF,BW,EXPECTED,RECEIVED,CRC_ERRORS,PER,RSSI_AVG,SNR_AVG,RX_ON_MS\r\n" );
+
+    while( 1 )
+    {
+        memset1( ( uint8_t* )Stats, 0, sizeof( Stats ) );
+
+        // Synchronizes on the first frame of the first step
+        CurrentStep = 0;
+        period = SetStep( 0 );
+        Synchronized = false;
+        rxOnStart = TimerGetCurrentTime( );
+        Radio.Rx( 0 ); // Continuous Rx
+        WaitFlag( &Synchronized );
+
+        // The frame ended one time on air after its scheduled transmission
+        stepStart = SyncTime - ( period - RX_SENSI_SWEEP_FRAME_GAP ) - RX_SENSI_SWEEP_STEP_LEAD - ( SyncSeq * period );
+        Stats[0].Expected = ( SyncSeq < RX_SENSI_SWEEP_NB_PACKETS ) ? ( RX_SENSI_SWEEP_NB_PACKETS - SyncSeq ) : 0;
+
+        for( uint8_t step = 0; step < RX_SENSI_SWEEP_NB_STEPS; step++ )
+        {
+            if( step > 0 )
+            {
+                CurrentStep = step;
+                period = SetStep( step );
+                Stats[step].Expected = RX_SENSI_SWEEP_NB_PACKETS;
+                WaitUntil( stepStart );
+                rxOnStart = TimerGetCurrentTime( );
+                Radio.Rx( 0 ); // Continuous Rx
+            }
+            stepEnd = stepStart + StepDuration( period );
+            WaitUntil( stepEnd );
+            Radio.Sleep( );
+            Stats[step].RxOnTime = TimerGetElapsedTime( rxOnStart );
+            stepStart = stepEnd;
+        }
+        PrintRun( );
+    }
+}
+
+void RxSensiSweepTransmitter( uint32_t frequency )
+{
+    uint8_t frame[RX_SENSI_SWEEP_PAYLOAD_SIZE];
+    TimerTime_t stepStart = 0;
+    uint32_t period = 0;
+    uint8_t run = 0;
+
+    BaseFrequency = frequency;
+    TimerInit( &ScheduleTimer, OnScheduleTimerEvent );
+
+    RadioEvents.TxDone = OnTxDone;
+    RadioEvents.TxTimeout = OnTxTimeout;
+    Radio.Init( &RadioEvents );
+
+    for( uint8_t i = 0; i < RX_SENSI_SWEEP_PAYLOAD_SIZE; i++ )
+    {
+        frame[i] = i;
+    }
+    frame[0] = 'R';
+    frame[1] = 'S';
+
+    stepStart = TimerGetCurrentTime( );
+    while( 1 )
+    {
+        frame[2] = run;
+        for( uint8_t step = 0; step < RX_SENSI_SWEEP_NB_STEPS; step++ )
+        {
+            frame[3] = step;
+            period = SetStep( step );
+
+            for( uint16_t seq = 0; seq < RX_SENSI_SWEEP_NB_PACKETS; seq++ )
+            {
+                frame[4] = seq & 0xFF;
+                frame[5] = ( seq >> 8 ) & 0xFF;
+
+                WaitUntil( stepStart + RX_SENSI_SWEEP_STEP_LEAD + ( seq * period ) );
+                TxFinished = false;
+                Radio.Send( frame, RX_SENSI_SWEEP_PAYLOAD_SIZE );
+                WaitFlag( &TxFinished );
+            }
+            Radio.Sleep( );
+            stepStart += StepDuration( period );
+        }
+        run++;
+    }
+}
@@ -0,0 +1,53 @@
+/*!
+ * \file      RxSensiSweep.h
+ *
+ * \brief     Steps the receiver through a schedule of frequencies and
+ *            datarates and collects the packet error rate, RSSI and SNR
+ *            statistics of each step
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __RX_SENSI_SWEEP_H__
+#define __RX_SENSI_SWEEP_H__
+
+#include <stdint.h>
+
+/*!
+ * \brief Runs the sweep receiver. Never returns.
+ *
+ * \remark The receiver waits for a frame of the first step to synchronize
+ *         on the transmitter schedule, then follows the schedule without
+ *         further synchronization until the end of the run.
+ *         At the end of each run it prints over the UART one line per step:
+ *         SWEEP,RUN,STEP,FREQ,SF,BW,EXPECTED,RECEIVED,CRC_ERRORS,PER,RSSI_AVG,SNR_AVG,RX_ON_MS
+ *         followed by the RSSI and SNR histograms:
+ *         RSSI_HIST,RUN,STEP,<count per 10 dB bin from -140 dBm>
+ *         SNR_HIST,RUN,STEP,<count per 5 dB bin from -25 dB>
+ *         PER is given in per mille.
+ *
+ * \param [IN] frequency Base RF frequency of the schedule [Hz]
+ */
+void RxSensiSweepReceiver( uint32_t frequency );
+
+/*!
+ * \brief Runs the sweep transmitter, which feeds the receivers under test
+ *        with the scheduled frames. Never returns.
+ *
+ * \param [IN] frequency Base RF frequency of the schedule [Hz]
+ */
+void RxSensiSweepTransmitter( uint32_t frequency );
+
+#endif // __RX_SENSI_SWEEP_H__
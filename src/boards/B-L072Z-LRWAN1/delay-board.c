@@ -23,9 +23,10 @@
  * \author    Johannes Bruder ( STACKFORCE )
  */
 #include "stm32l0xx.h"
+#include "rtc-board.h"
 #include "delay-board.h"
 
 void DelayMsMcu( uint32_t ms )
 {
-    HAL_Delay( ms );
+    RtcDelayMs( ms );
 }
@@ -20,14 +20,53 @@
  *
  * \author    Gregory Cristian ( Semtech )
  */
+#include <stdbool.h>
 #include "stm32l0xx.h"
 #include "utilities.h"
 #include "board.h"
 #include "gpio.h"
 #include "spi-board.h"
 
+/*!
+ * Transfers shorter than this size are done by polling. Setting up the DMA
+ * streams costs more than sending a few bytes.
+ */
+#define SPI_DMA_MIN_TRANSFER_SIZE                   8
+
 static SPI_HandleTypeDef SpiHandle[2];
 
+/*!
+ * SPI DMA streams handles
+ */
+static DMA_HandleTypeDef SpiDmaTxHandle[2];
+static DMA_HandleTypeDef SpiDmaRxHandle[2];
+
+/*!
+ * SPI objects owning the on-going non-blocking transfers
+ */
+static Spi_t* SpiTransferObj[2];
+
+/*!
+ * Byte sent when no transmit buffer is given and sink of the received bytes
+ * when no receive buffer is given
+ */
+static const uint8_t SpiDummyTx = 0x00;
+static uint8_t SpiDummyRx;
+
+/*!
+ * \brief Initializes the DMA streams used by the given SPI peripheral
+ *
+ * \param [IN] spiId SPI peripheral ID
+ */
+static void SpiDmaInit( SpiId_t spiId );
+
+/*!
+ * \brief Reception stream transfer completion callback
+ *
+ * \param [IN] hdma DMA stream handle
+ */
+static void SpiDmaOnRxCplt( DMA_HandleTypeDef *hdma );
+
 void SpiInit( Spi_t *obj, SpiId_t spiId, PinNames mosi, PinNames miso, PinNames sclk, PinNames nss )
 {
     CRITICAL_SECTION_BEGIN( );
@@ -74,12 +113,16 @@ void SpiInit( Spi_t *obj, SpiId_t spiId, PinNames mosi, PinNames miso, PinNames
 
     HAL_SPI_Init( &SpiHandle[spiId] );
 
+    SpiDmaInit( spiId );
+
     CRITICAL_SECTION_END( );
 }
 
 void SpiDeInit( Spi_t *obj )
 {
     HAL_SPI_DeInit( &SpiHandle[obj->SpiId] );
+    HAL_DMA_DeInit( &SpiDmaRxHandle[obj->SpiId] );
+    HAL_DMA_DeInit( &SpiDmaTxHandle[obj->SpiId] );
 
     GpioInit( &obj->Mosi, obj->Mosi.pin, PIN_OUTPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
     GpioInit( &obj->Miso, obj->Miso.pin, PIN_OUTPUT, PIN_PUSH_PULL, PIN_PULL_DOWN, 0 );
@@ -163,3 +206,181 @@ uint16_t SpiInOut( Spi_t *obj, uint16_t outData )
     return( rxData );
 }
 
+static void SpiDmaInit( SpiId_t spiId )
+{
+    IRQn_Type irq;
+
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+
+    if( spiId == SPI_1 )
+    {
+        SpiDmaRxHandle[spiId].Instance = DMA1_Channel2;
+        SpiDmaTxHandle[spiId].Instance = DMA1_Channel3;
+        SpiDmaRxHandle[spiId].Init.Request = DMA_REQUEST_1;
+        SpiDmaTxHandle[spiId].Init.Request = DMA_REQUEST_1;
+        irq = DMA1_Channel2_3_IRQn;
+    }
+    else
+    {
+        SpiDmaRxHandle[spiId].Instance = DMA1_Channel4;
+        SpiDmaTxHandle[spiId].Instance = DMA1_Channel5;
+        SpiDmaRxHandle[spiId].Init.Request = DMA_REQUEST_2;
+        SpiDmaTxHandle[spiId].Init.Request = DMA_REQUEST_2;
+        irq = DMA1_Channel4_5_6_7_IRQn;
+    }
+
+    SpiDmaRxHandle[spiId].Init.Direction = DMA_PERIPH_TO_MEMORY;
+    SpiDmaRxHandle[spiId].Init.PeriphInc = DMA_PINC_DISABLE;
+    SpiDmaRxHandle[spiId].Init.MemInc = DMA_MINC_ENABLE;
+    SpiDmaRxHandle[spiId].Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    SpiDmaRxHandle[spiId].Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    SpiDmaRxHandle[spiId].Init.Mode = DMA_NORMAL;
+    SpiDmaRxHandle[spiId].Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    HAL_DMA_Init( &SpiDmaRxHandle[spiId] );
+    SpiDmaRxHandle[spiId].XferCpltCallback = SpiDmaOnRxCplt;
+
+    SpiDmaTxHandle[spiId].Init.Direction = DMA_MEMORY_TO_PERIPH;
+    SpiDmaTxHandle[spiId].Init.PeriphInc = DMA_PINC_DISABLE;
+    SpiDmaTxHandle[spiId].Init.MemInc = DMA_MINC_ENABLE;
+    SpiDmaTxHandle[spiId].Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    SpiDmaTxHandle[spiId].Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    SpiDmaTxHandle[spiId].Init.Mode = DMA_NORMAL;
+    SpiDmaTxHandle[spiId].Init.Priority = DMA_PRIORITY_HIGH;
+    HAL_DMA_Init( &SpiDmaTxHandle[spiId] );
+
+    // Only the reception stream completion is used to signal the end of a non-blocking transfer
+    HAL_NVIC_SetPriority( irq, 0, 0 );
+    HAL_NVIC_EnableIRQ( irq );
+}
+
+/*!
+ * \brief Enables or disables the memory address increment of a DMA stream
+ *
+ * \remark The stream must be disabled
+ *
+ * \param [IN] hdma   DMA stream handle
+ * \param [IN] enable Enables the increment when true
+ */
+static void SpiDmaSetMemInc( DMA_HandleTypeDef *hdma, bool enable )
+{
+    if( enable == true )
+    {
+        SET_BIT( hdma->Instance->CCR, DMA_CCR_MINC );
+    }
+    else
+    {
+        CLEAR_BIT( hdma->Instance->CCR, DMA_CCR_MINC );
+    }
+}
+
+void SpiTransfer( Spi_t *obj, const uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size )
+{
+    SPI_HandleTypeDef *handle;
+    DMA_HandleTypeDef *dmaTx;
+    DMA_HandleTypeDef *dmaRx;
+
+    if( ( obj == NULL ) || ( SpiHandle[obj->SpiId].Instance ) == NULL )
+    {
+        assert_param( FAIL );
+    }
+
+    if( size == 0 )
+    {
+        if( obj->TransferDone != NULL )
+        {
+            obj->TransferDone( obj->Context );
+        }
+        return;
+    }
+
+    if( ( size < SPI_DMA_MIN_TRANSFER_SIZE ) && ( obj->TransferDone == NULL ) )
+    {
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            uint8_t data = SpiInOut( obj, ( txBuffer != NULL ) ? txBuffer[i] : 0x00 );
+
+            if( rxBuffer != NULL )
+            {
+                rxBuffer[i] = data;
+            }
+        }
+        return;
+    }
+
+    handle = &SpiHandle[obj->SpiId];
+    dmaTx = &SpiDmaTxHandle[obj->SpiId];
+    dmaRx = &SpiDmaRxHandle[obj->SpiId];
+
+    // Use the dummy bytes when a buffer isn't given
+    SpiDmaSetMemInc( dmaTx, ( txBuffer != NULL ) );
+    SpiDmaSetMemInc( dmaRx, ( rxBuffer != NULL ) );
+    if( txBuffer == NULL )
+    {
+        txBuffer = &SpiDummyTx;
+    }
+    if( rxBuffer == NULL )
+    {
+        rxBuffer = &SpiDummyRx;
+    }
+
+    __HAL_SPI_ENABLE( handle );
+
+    // The reception stream is started first in order to not miss the first received byte
+    SET_BIT( handle->Instance->CR2, SPI_CR2_RXDMAEN );
+    if( obj->TransferDone == NULL )
+    {
+        HAL_DMA_Start( dmaRx, ( uint32_t )&handle->Instance->DR, ( uint32_t )rxBuffer, size );
+    }
+    else
+    {
+        SpiTransferObj[obj->SpiId] = obj;
+        HAL_DMA_Start_IT( dmaRx, ( uint32_t )&handle->Instance->DR, ( uint32_t )rxBuffer, size );
+    }
+    HAL_DMA_Start( dmaTx, ( uint32_t )txBuffer, ( uint32_t )&handle->Instance->DR, size );
+    SET_BIT( handle->Instance->CR2, SPI_CR2_TXDMAEN );
+
+    if( obj->TransferDone == NULL )
+    {
+        // The transfer is done once the last byte has been received.
+        // Polling allows to call this function from interrupt context or from a critical section.
+        HAL_DMA_PollForTransfer( dmaRx, HAL_DMA_FULL_TRANSFER, HAL_MAX_DELAY );
+        HAL_DMA_PollForTransfer( dmaTx, HAL_DMA_FULL_TRANSFER, HAL_MAX_DELAY );
+        CLEAR_BIT( handle->Instance->CR2, SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN );
+    }
+}
+
+void SpiSetTransferCallback( Spi_t *obj, SpiTransferCallback *callback, void* context )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    obj->TransferDone = callback;
+    obj->Context = context;
+
+    CRITICAL_SECTION_END( );
+}
+
+static void SpiDmaOnRxCplt( DMA_HandleTypeDef *hdma )
+{
+    SpiId_t spiId = ( hdma == &SpiDmaRxHandle[SPI_1] ) ? SPI_1 : SPI_2;
+    Spi_t *obj = SpiTransferObj[spiId];
+
+    // Release the transmission stream. Its last byte has already been sent.
+    HAL_DMA_PollForTransfer( &SpiDmaTxHandle[spiId], HAL_DMA_FULL_TRANSFER, HAL_MAX_DELAY );
+    CLEAR_BIT( SpiHandle[spiId].Instance->CR2, SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN );
+
+    SpiTransferObj[spiId] = NULL;
+    if( ( obj != NULL ) && ( obj->TransferDone != NULL ) )
+    {
+        obj->TransferDone( obj->Context );
+    }
+}
+
+void DMA1_Channel2_3_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( &SpiDmaRxHandle[SPI_1] );
+}
+
+void DMA1_Channel4_5_6_7_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( &SpiDmaRxHandle[SPI_2] );
+}
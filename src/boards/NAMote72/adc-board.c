@@ -20,12 +20,64 @@
  *
  * \author    Gregory Cristian ( Semtech )
  */
+#include <stdbool.h>
+#include <stddef.h>
 #include "stm32l1xx.h"
+#include "utilities.h"
 #include "board-config.h"
+#include "lpm-board.h"
 #include "adc-board.h"
 
+/*!
+ * Number of samples transferred by a single DMA run. Larger averages are made
+ * of several runs.
+ */
+#define ADC_DMA_BUFFER_SIZE                         16
+
 ADC_HandleTypeDef AdcHandle;
 
+/*!
+ * ADC DMA channel handle
+ */
+static DMA_HandleTypeDef AdcDmaHandle;
+
+/*!
+ * Samples of the ongoing DMA run
+ */
+static uint16_t AdcDmaBuffer[ADC_DMA_BUFFER_SIZE];
+
+/*!
+ * Ongoing non-blocking conversion
+ */
+static AdcConversionCallback *AdcConversionDone = NULL;
+static void* AdcConversionContext = NULL;
+static uint32_t AdcConversionChannel = 0;
+static uint16_t AdcConversionNbSamples = 0;
+static uint16_t AdcConversionRemaining = 0;
+static uint32_t AdcConversionSum = 0;
+
+/*!
+ * \brief Powers the ADC and selects the channel
+ *
+ * \param [IN] channel ADC input channel
+ * \retval isAdcReady  True when the ADC is enabled
+ */
+static bool AdcMcuEnable( uint32_t channel );
+
+/*!
+ * \brief Powers down the ADC once a conversion is done
+ *
+ * \param [IN] channel ADC input channel
+ */
+static void AdcMcuDisable( uint32_t channel );
+
+/*!
+ * \brief Starts a DMA run of continuous conversions for the remaining samples
+ *
+ * \retval status HAL_OK when the run is started
+ */
+static HAL_StatusTypeDef AdcMcuStartDma( void );
+
 void AdcMcuInit( Adc_t *obj, PinNames adcInput )
 {
     AdcHandle.Instance = ( ADC_TypeDef* )ADC1_BASE;
@@ -38,6 +90,22 @@ void AdcMcuInit( Adc_t *obj, PinNames adcInput )
     {
         GpioInit( &obj->AdcInput, adcInput, PIN_ANALOGIC, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
     }
+
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+
+    AdcDmaHandle.Instance = DMA1_Channel1;
+    AdcDmaHandle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    AdcDmaHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+    AdcDmaHandle.Init.MemInc = DMA_MINC_ENABLE;
+    AdcDmaHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    AdcDmaHandle.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    AdcDmaHandle.Init.Mode = DMA_NORMAL;
+    AdcDmaHandle.Init.Priority = DMA_PRIORITY_LOW;
+    HAL_DMA_Init( &AdcDmaHandle );
+    __HAL_LINKDMA( &AdcHandle, DMA_Handle, AdcDmaHandle );
+
+    HAL_NVIC_SetPriority( DMA1_Channel1_IRQn, 2, 0 );
+    HAL_NVIC_EnableIRQ( DMA1_Channel1_IRQn );
 }
 
 void AdcMcuConfig( void )
@@ -59,9 +127,58 @@ void AdcMcuConfig( void )
 
 uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
 {
-    ADC_ChannelConfTypeDef adcConf = { 0 };
     uint16_t adcData = 0;
 
+    if( AdcConversionDone != NULL )
+    {
+        // A non-blocking conversion owns the ADC
+        return 0;
+    }
+
+    if( AdcMcuEnable( channel ) == true )
+    {
+        // Start ADC Software Conversion
+        HAL_ADC_Start( &AdcHandle );
+
+        HAL_ADC_PollForConversion( &AdcHandle, HAL_MAX_DELAY );
+
+        adcData = HAL_ADC_GetValue( &AdcHandle );
+    }
+
+    AdcMcuDisable( channel );
+
+    return adcData;
+}
+
+uint8_t AdcMcuStartConversion( Adc_t *obj, uint32_t channel, uint16_t nbSamples, AdcConversionCallback *callback, void* context )
+{
+    if( AdcConversionDone != NULL )
+    {
+        return FAIL;
+    }
+    AdcConversionDone = callback;
+    AdcConversionContext = context;
+    AdcConversionChannel = channel;
+    AdcConversionNbSamples = nbSamples;
+    AdcConversionRemaining = nbSamples;
+    AdcConversionSum = 0;
+
+    LpmSetStopMode( LPM_ADC_ID, LPM_DISABLE );
+
+    if( ( AdcMcuEnable( channel ) == false ) || ( AdcMcuStartDma( ) != HAL_OK ) )
+    {
+        AdcMcuDisable( channel );
+        AdcConversionDone = NULL;
+        LpmSetStopMode( LPM_ADC_ID, LPM_ENABLE );
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+static bool AdcMcuEnable( uint32_t channel )
+{
+    ADC_ChannelConfTypeDef adcConf = { 0 };
+
     // Enable HSI
     __HAL_RCC_HSI_ENABLE( );
 
@@ -79,19 +196,14 @@ uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
     HAL_ADC_ConfigChannel( &AdcHandle, &adcConf );
 
     // Enable ADC1
-    if( ADC_Enable( &AdcHandle ) == HAL_OK )
-    {
-        // Start ADC Software Conversion
-        HAL_ADC_Start( &AdcHandle );
-
-        HAL_ADC_PollForConversion( &AdcHandle, HAL_MAX_DELAY );
-
-        adcData = HAL_ADC_GetValue( &AdcHandle );
-    }
+    return ( ADC_Enable( &AdcHandle ) == HAL_OK ) ? true : false;
+}
 
+static void AdcMcuDisable( uint32_t channel )
+{
     ADC_ConversionStop_Disable( &AdcHandle );
 
-    if( ( adcConf.Channel == ADC_CHANNEL_TEMPSENSOR ) || ( adcConf.Channel == ADC_CHANNEL_VREFINT ) )
+    if( ( channel == ADC_CHANNEL_TEMPSENSOR ) || ( channel == ADC_CHANNEL_VREFINT ) )
     {
         HAL_ADC_DeInit( &AdcHandle );
     }
@@ -99,6 +211,52 @@ uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
 
     // Disable HSI
     __HAL_RCC_HSI_DISABLE( );
+}
 
-    return adcData;
+static HAL_StatusTypeDef AdcMcuStartDma( void )
+{
+    // The ADC has no hardware oversampler, it converts continuously while the
+    // DMA fills the buffer and the samples are summed up once it is full
+    SET_BIT( AdcHandle.Instance->CR2, ADC_CR2_CONT );
+    return HAL_ADC_Start_DMA( &AdcHandle, ( uint32_t* )AdcDmaBuffer, MIN( AdcConversionRemaining, ADC_DMA_BUFFER_SIZE ) );
+}
+
+void HAL_ADC_ConvCpltCallback( ADC_HandleTypeDef* hadc )
+{
+    AdcConversionCallback *callback = AdcConversionDone;
+    uint16_t count = MIN( AdcConversionRemaining, ADC_DMA_BUFFER_SIZE );
+    uint16_t value = 0;
+
+    CLEAR_BIT( hadc->Instance->CR2, ADC_CR2_CONT );
+    HAL_ADC_Stop_DMA( hadc );
+
+    for( uint16_t i = 0; i < count; i++ )
+    {
+        AdcConversionSum += AdcDmaBuffer[i];
+    }
+    AdcConversionRemaining -= count;
+
+    if( ( AdcConversionRemaining > 0 ) && ( AdcMcuStartDma( ) == HAL_OK ) )
+    {
+        return;
+    }
+
+    if( AdcConversionRemaining < AdcConversionNbSamples )
+    {
+        value = AdcConversionSum / ( AdcConversionNbSamples - AdcConversionRemaining );
+    }
+
+    AdcMcuDisable( AdcConversionChannel );
+    AdcConversionDone = NULL;
+    LpmSetStopMode( LPM_ADC_ID, LPM_ENABLE );
+
+    if( callback != NULL )
+    {
+        callback( AdcConversionContext, value );
+    }
+}
+
+void DMA1_Channel1_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( AdcHandle.DMA_Handle );
 }
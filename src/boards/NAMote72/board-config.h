@@ -38,6 +38,13 @@
  */
 #define BOARD_TCXO_WAKEUP_TIME                      0
 
+/*!
+ * NVIC priority masked by the critical sections, along with the lower ones.
+ * Priority 0 is left to the interrupts which never enter the stack (SysTick,
+ * PVD, FLASH), they stay enabled during the critical sections.
+ */
+#define BOARD_CRITICAL_SECTION_PRIORITY             1
+
 /*!
  * Board MCU pins definitions
  */
@@ -133,13 +133,14 @@ static Version_t BoardVersion = { 0 };
 
 void BoardCriticalSectionBegin( uint32_t *mask )
 {
-    *mask = __get_PRIMASK( );
-    __disable_irq( );
+    // Only masks the interrupts which may enter the stack
+    *mask = __get_BASEPRI( );
+    __set_BASEPRI_MAX( BOARD_CRITICAL_SECTION_PRIORITY << ( 8 - __NVIC_PRIO_BITS ) );
 }
 
 void BoardCriticalSectionEnd( uint32_t *mask )
 {
-    __set_PRIMASK( *mask );
+    __set_BASEPRI( *mask );
 }
 
 void BoardInitPeriph( void )
@@ -276,6 +277,53 @@ uint32_t BoardGetRandomSeed( void )
     return ( ( *( uint32_t* )ID1 ) ^ ( *( uint32_t* )ID2 ) ^ ( *( uint32_t* )ID3 ) );
 }
 
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords )
+{
+    // No hardware generator on this MCU
+    return 0;
+}
+
+uint32_t BoardGetCycleCounter( void )
+{
+#if ( __CORTEX_M >= 3 )
+    if( ( DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk ) == 0 )
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#else
+    // No DWT cycle counter on Cortex-M0+. Count the SysTick cycles instead.
+    uint32_t tick;
+    uint32_t val;
+
+    do
+    {
+        tick = HAL_GetTick( );
+        val = SysTick->VAL;
+    }while( tick != HAL_GetTick( ) );
+    return ( tick * ( SysTick->LOAD + 1 ) ) + ( SysTick->LOAD - val );
+#endif
+}
+
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size )
+{
+    uint16_t count = 0;
+
+    // Takes what the Tx FIFO can hold, never waits for the UART
+    while( ( count < size ) && ( UartPutChar( &Uart2, buffer[count] ) == 0 ) )
+    {
+        count++;
+    }
+    return count;
+}
+
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level )
+{
+    // The MCU runs at a fixed clock
+}
+
 void BoardGetUniqueId( uint8_t *id )
 {
     id[7] = ( ( *( uint32_t* )ID1 )+ ( *( uint32_t* )ID3 ) ) >> 24;
@@ -310,26 +358,30 @@ void BoardGetUniqueId( uint8_t *id )
 #define BATTERY_MIN_LEVEL                           1900 // mV
 #define BATTERY_SHUTDOWN_LEVEL                      1800 // mV
 
+/*!
+ * Number of ADC samples averaged by a battery measurement
+ */
+#define BATTERY_NB_SAMPLES                          16
+
 static uint16_t BatteryVoltage = BATTERY_MAX_LEVEL;
 
-uint16_t BoardBatteryMeasureVolage( void )
+/*!
+ * Indicates if BatteryVoltage holds a measurement
+ */
+static bool BatteryMeasured = false;
+
+/*!
+ * \brief Computes the battery voltage from the divider bridge conversion result
+ *
+ * \param [IN] vdiv Divider bridge ADC value
+ * \retval batteryVoltage Battery voltage [mV]
+ */
+static uint16_t BoardBatteryVoltageFromAdc( uint16_t vdiv )
 {
     uint16_t vdd = 0;
     uint16_t vref = VREFINT_CAL;
-    uint16_t vdiv = 0;
     uint16_t batteryVoltage = 0;
 
-    switch( BoardVersion.Fields.Major )
-    {
-        case 2:
-            vdiv = AdcReadChannel( &Adc, BAT_LEVEL_CHANNEL_PA0 );
-            break;
-        case 3:
-            vdiv = AdcReadChannel( &Adc, BAT_LEVEL_CHANNEL_PA1 );
-            break;
-        default:
-            break;
-    }
     //vref = AdcReadChannel( &Adc, ADC_CHANNEL_VREFINT );
 
     vdd = ( float )FACTORY_POWER_SUPPLY * ( float )VREFINT_CAL / ( float )vref;
@@ -341,6 +393,44 @@ uint16_t BoardBatteryMeasureVolage( void )
     return batteryVoltage;
 }
 
+/*!
+ * \brief Battery measurement done callback, called from the ADC interrupt
+ */
+static void OnBatteryConversionDone( void* context, uint16_t value )
+{
+    BatteryVoltage = BoardBatteryVoltageFromAdc( value );
+}
+
+/*!
+ * \brief Gets the ADC channel of the battery divider bridge
+ *
+ * \retval channel ADC channel, 0xFFFFFFFF when the board version has none
+ */
+static uint32_t BoardBatteryAdcChannel( void )
+{
+    switch( BoardVersion.Fields.Major )
+    {
+        case 2:
+            return BAT_LEVEL_CHANNEL_PA0;
+        case 3:
+            return BAT_LEVEL_CHANNEL_PA1;
+        default:
+            return 0xFFFFFFFF;
+    }
+}
+
+uint16_t BoardBatteryMeasureVolage( void )
+{
+    uint32_t channel = BoardBatteryAdcChannel( );
+    uint16_t vdiv = 0;
+
+    if( channel != 0xFFFFFFFF )
+    {
+        vdiv = AdcReadChannel( &Adc, channel );
+    }
+    return BoardBatteryVoltageFromAdc( vdiv );
+}
+
 uint32_t BoardGetBatteryVoltage( void )
 {
     return BatteryVoltage;
@@ -350,7 +440,17 @@ uint8_t BoardGetBatteryLevel( void )
 {
     uint8_t batteryLevel = 0;
 
-    BatteryVoltage = BoardBatteryMeasureVolage( );
+    if( BatteryMeasured == false )
+    {
+        BatteryMeasured = true;
+        BatteryVoltage = BoardBatteryMeasureVolage( );
+    }
+    else if( BoardBatteryAdcChannel( ) != 0xFFFFFFFF )
+    {
+        // The level is computed from the previous measurement, the next one
+        // runs in the background so that the caller never waits for the ADC
+        AdcStartConversion( &Adc, BoardBatteryAdcChannel( ), BATTERY_NB_SAMPLES, OnBatteryConversionDone, NULL );
+    }
 
     if( GetBoardPowerSource( ) == USB_POWER )
     {
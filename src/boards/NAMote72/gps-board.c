@@ -38,16 +38,6 @@
 //uint8_t TxBuffer[FIFO_TX_SIZE];
 static uint8_t RxBuffer[FIFO_RX_SIZE];
 
-/*!
- * \brief Buffer holding the  raw data received from the gps
- */
-static uint8_t NmeaString[128];
-
-/*!
- * \brief Maximum number of data byte that we will accept from the GPS
- */
-static volatile uint8_t NmeaStringSize = 0;
-
 static Gpio_t GpsPowerEn;
 static Gpio_t GpsPps;
 
@@ -78,8 +68,6 @@ void GpsMcuInvertPpsTrigger( void )
 
 void GpsMcuInit( void )
 {
-    NmeaStringSize = 0;
-
     switch( BoardGetVersion( ).Fields.Major )
     {
         case 2:
@@ -136,22 +124,15 @@ void GpsMcuIrqNotify( UartNotifyId_t id )
     uint8_t data;
     if( id == UART_NOTIFY_RX )
     {
-        if( UartGetChar( &Uart1, &data ) == 0 )
+        // The sentences are parsed as the characters are received
+        while( UartGetChar( &Uart1, &data ) == 0 )
         {
-            if( ( data == '$' ) || ( NmeaStringSize >= 127 ) )
-            {
-                NmeaStringSize = 0;
-            }
-
-            NmeaString[NmeaStringSize++] = ( int8_t )data;
-
-            if( data == '\n' )
+            if( GpsParseGpsChar( data ) == true )
             {
-                NmeaString[NmeaStringSize++] = '\0';
-                GpsParseGpsData( ( int8_t* )NmeaString, NmeaStringSize );
                 UartDeInit( &Uart1 );
                 // Enables lowest power modes
                 LpmSetStopMode( LPM_GPS_ID , LPM_ENABLE );
+                break;
             }
         }
     }
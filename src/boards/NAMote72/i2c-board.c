@@ -32,8 +32,32 @@
 
 static I2C_HandleTypeDef I2cHandle = { 0 };
 
+/*!
+ * I2C DMA channels handles
+ */
+static DMA_HandleTypeDef I2cDmaTxHandle;
+static DMA_HandleTypeDef I2cDmaRxHandle;
+
+/*!
+ * I2C object owning the on-going non-blocking transfer
+ */
+static I2c_t* I2cTransferObj = NULL;
+
 static I2cAddrSize I2cInternalAddrSize = I2C_ADDR_SIZE_8;
 
+/*!
+ * \brief Initializes the DMA channels and the interrupts used by the
+ *        non-blocking transfers
+ */
+static void I2cDmaInit( void );
+
+/*!
+ * \brief Calls the transfer callback of the on-going non-blocking transfer
+ *
+ * \param [IN] status [SUCCESS, FAIL]
+ */
+static void I2cOnTransferDone( uint8_t status );
+
 void I2cMcuInit( I2c_t *obj, I2cId_t i2cId, PinNames scl, PinNames sda )
 {
     __HAL_RCC_I2C1_CLK_DISABLE( );
@@ -72,6 +96,7 @@ void I2cMcuFormat( I2c_t *obj, I2cMode mode, I2cDutyCycle dutyCycle, bool I2cAck
     I2cHandle.Init.NoStretchMode = I2C_NOSTRETCH_DISABLED;
 
     HAL_I2C_Init( &I2cHandle );
+    I2cDmaInit( );
 }
 
 void I2cMcuResetBus( I2c_t *obj )
@@ -90,6 +115,12 @@ void I2cMcuResetBus( I2c_t *obj )
 void I2cMcuDeInit( I2c_t *obj )
 {
 
+    HAL_NVIC_DisableIRQ( I2C1_EV_IRQn );
+    HAL_NVIC_DisableIRQ( I2C1_ER_IRQn );
+    HAL_NVIC_DisableIRQ( DMA1_Channel6_IRQn );
+    HAL_NVIC_DisableIRQ( DMA1_Channel7_IRQn );
+    HAL_DMA_DeInit( &I2cDmaTxHandle );
+    HAL_DMA_DeInit( &I2cDmaRxHandle );
     HAL_I2C_DeInit( &I2cHandle );
 
     __HAL_RCC_I2C1_FORCE_RESET();
@@ -118,6 +149,17 @@ uint8_t I2cMcuWriteBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_
     {
         memAddSize = I2C_MEMADD_SIZE_16BIT;
     }
+    if( obj->TransferDone != NULL )
+    {
+        // The callback is called from the DMA or I2C interrupts
+        I2cTransferObj = obj;
+        status = ( HAL_I2C_Mem_Write_DMA( &I2cHandle, deviceAddr, addr, memAddSize, buffer, size ) == HAL_OK ) ? SUCCESS : FAIL;
+        if( status == FAIL )
+        {
+            I2cTransferObj = NULL;
+        }
+        return status;
+    }
     status = ( HAL_I2C_Mem_Write( &I2cHandle, deviceAddr, addr, memAddSize, buffer, size, 2000 ) == HAL_OK ) ? SUCCESS : FAIL;
 
     return status;
@@ -136,6 +178,17 @@ uint8_t I2cMcuReadBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t
     {
         memAddSize = I2C_MEMADD_SIZE_16BIT;
     }
+    if( obj->TransferDone != NULL )
+    {
+        // The callback is called from the DMA or I2C interrupts
+        I2cTransferObj = obj;
+        status = ( HAL_I2C_Mem_Read_DMA( &I2cHandle, deviceAddr, addr, memAddSize, buffer, size ) == HAL_OK ) ? SUCCESS : FAIL;
+        if( status == FAIL )
+        {
+            I2cTransferObj = NULL;
+        }
+        return status;
+    }
     status = ( HAL_I2C_Mem_Read( &I2cHandle, deviceAddr, addr, memAddSize, buffer, size, 2000 ) == HAL_OK ) ? SUCCESS : FAIL;
 
     return status;
@@ -149,3 +202,86 @@ uint8_t I2cMcuWaitStandbyState( I2c_t *obj, uint8_t deviceAddr )
 
     return status;
 }
+
+static void I2cDmaInit( void )
+{
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+
+    I2cDmaTxHandle.Instance = DMA1_Channel6;
+    I2cDmaTxHandle.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    I2cDmaTxHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+    I2cDmaTxHandle.Init.MemInc = DMA_MINC_ENABLE;
+    I2cDmaTxHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    I2cDmaTxHandle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    I2cDmaTxHandle.Init.Mode = DMA_NORMAL;
+    I2cDmaTxHandle.Init.Priority = DMA_PRIORITY_LOW;
+    HAL_DMA_Init( &I2cDmaTxHandle );
+    __HAL_LINKDMA( &I2cHandle, hdmatx, I2cDmaTxHandle );
+
+    I2cDmaRxHandle.Instance = DMA1_Channel7;
+    I2cDmaRxHandle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    I2cDmaRxHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+    I2cDmaRxHandle.Init.MemInc = DMA_MINC_ENABLE;
+    I2cDmaRxHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    I2cDmaRxHandle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    I2cDmaRxHandle.Init.Mode = DMA_NORMAL;
+    I2cDmaRxHandle.Init.Priority = DMA_PRIORITY_LOW;
+    HAL_DMA_Init( &I2cDmaRxHandle );
+    __HAL_LINKDMA( &I2cHandle, hdmarx, I2cDmaRxHandle );
+
+    // The end of the write transfers is signaled by the I2C event interrupt
+    HAL_NVIC_SetPriority( DMA1_Channel6_IRQn, 2, 0 );
+    HAL_NVIC_EnableIRQ( DMA1_Channel6_IRQn );
+    HAL_NVIC_SetPriority( DMA1_Channel7_IRQn, 2, 0 );
+    HAL_NVIC_EnableIRQ( DMA1_Channel7_IRQn );
+    HAL_NVIC_SetPriority( I2C1_EV_IRQn, 2, 0 );
+    HAL_NVIC_EnableIRQ( I2C1_EV_IRQn );
+    HAL_NVIC_SetPriority( I2C1_ER_IRQn, 2, 0 );
+    HAL_NVIC_EnableIRQ( I2C1_ER_IRQn );
+}
+
+static void I2cOnTransferDone( uint8_t status )
+{
+    I2c_t* obj = I2cTransferObj;
+
+    I2cTransferObj = NULL;
+    if( ( obj != NULL ) && ( obj->TransferDone != NULL ) )
+    {
+        obj->TransferDone( obj->Context, status );
+    }
+}
+
+void HAL_I2C_MemTxCpltCallback( I2C_HandleTypeDef *handle )
+{
+    I2cOnTransferDone( SUCCESS );
+}
+
+void HAL_I2C_MemRxCpltCallback( I2C_HandleTypeDef *handle )
+{
+    I2cOnTransferDone( SUCCESS );
+}
+
+void HAL_I2C_ErrorCallback( I2C_HandleTypeDef *handle )
+{
+    I2cOnTransferDone( FAIL );
+}
+
+void DMA1_Channel6_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( I2cHandle.hdmatx );
+}
+
+void DMA1_Channel7_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( I2cHandle.hdmarx );
+}
+
+void I2C1_EV_IRQHandler( void )
+{
+    HAL_I2C_EV_IRQHandler( &I2cHandle );
+}
+
+void I2C1_ER_IRQHandler( void )
+{
+    HAL_I2C_ER_IRQHandler( &I2cHandle );
+}
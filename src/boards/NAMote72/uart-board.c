@@ -293,13 +293,24 @@ uint8_t UartMcuPutBuffer( Uart_t *obj, uint8_t *buffer, uint16_t size )
     }
     else
     {
-        uint8_t retryCount;
-        uint16_t i;
+        uint8_t retryCount = 0;
+        uint16_t count;
 
-        for( i = 0; i < size; i++ )
+        while( size > 0 )
         {
-            retryCount = 0;
-            while( UartPutChar( obj, buffer[i] ) != 0 )
+            count = FifoPushBuffer( &obj->FifoTx, buffer, size );
+            if( count > 0 )
+            {
+                CRITICAL_SECTION_BEGIN( );
+                // Trig UART Tx interrupt to start sending the FIFO contents.
+                __HAL_UART_ENABLE_IT( &UartContext[obj->UartId].UartHandle, UART_IT_TC );
+                CRITICAL_SECTION_END( );
+
+                buffer += count;
+                size -= count;
+                retryCount = 0;
+            }
+            else
             {
                 retryCount++;
 
@@ -318,17 +329,24 @@ uint8_t UartMcuGetBuffer( Uart_t *obj, uint8_t *buffer, uint16_t size, uint16_t
 {
     uint16_t localSize = 0;
 
-    while( localSize < size )
+    if( obj->UartId == UART_USB_CDC )
     {
-        if( UartGetChar( obj, buffer + localSize ) == 0 )
+        while( localSize < size )
         {
-            localSize++;
-        }
-        else
-        {
-            break;
+            if( UartGetChar( obj, buffer + localSize ) == 0 )
+            {
+                localSize++;
+            }
+            else
+            {
+                break;
+            }
         }
     }
+    else
+    {
+        localSize = FifoPopBuffer( &obj->FifoRx, buffer, size );
+    }
 
     *nbReadBytes = localSize;
 
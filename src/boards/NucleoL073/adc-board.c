@@ -22,12 +22,45 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "stm32l0xx.h"
+#include "utilities.h"
 #include "board-config.h"
+#include "lpm-board.h"
 #include "adc-board.h"
 
 ADC_HandleTypeDef AdcHandle;
 
+/*!
+ * Calibration factor measured by AdcMcuConfig. The ADC loses it whenever it is
+ * de-initialized, it is restored each time the ADC is enabled.
+ */
+static uint32_t AdcCalibrationFactor = 0;
+
+/*!
+ * Ongoing non-blocking conversion
+ */
+static AdcConversionCallback *AdcConversionDone = NULL;
+static void* AdcConversionContext = NULL;
+static uint32_t AdcConversionChannel = 0;
+
+/*!
+ * \brief Powers the ADC, selects the channel and programs the hardware
+ *        oversampler
+ *
+ * \param [IN] channel   ADC input channel
+ * \param [IN] nbSamples Number of samples to average, power of 2
+ * \retval isAdcReady    True when the ADC is enabled
+ */
+static bool AdcMcuEnable( uint32_t channel, uint16_t nbSamples );
+
+/*!
+ * \brief Powers down the ADC once a conversion is done
+ *
+ * \param [IN] channel ADC input channel
+ */
+static void AdcMcuDisable( uint32_t channel );
+
 void AdcMcuInit( Adc_t *obj, PinNames adcInput )
 {
     AdcHandle.Instance = ( ADC_TypeDef* )ADC1_BASE;
@@ -40,6 +73,9 @@ void AdcMcuInit( Adc_t *obj, PinNames adcInput )
     {
         GpioInit( &obj->AdcInput, adcInput, PIN_ANALOGIC, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
     }
+
+    HAL_NVIC_SetPriority( ADC1_COMP_IRQn, 2, 0 );
+    HAL_NVIC_EnableIRQ( ADC1_COMP_IRQn );
 }
 
 void AdcMcuConfig( void )
@@ -65,15 +101,61 @@ void AdcMcuConfig( void )
 
     // Calibration
     HAL_ADCEx_Calibration_Start( &AdcHandle, ADC_SINGLE_ENDED );
-
+    AdcCalibrationFactor = HAL_ADCEx_Calibration_GetValue( &AdcHandle, ADC_SINGLE_ENDED );
 }
 
 uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
 {
-    ADC_ChannelConfTypeDef adcConf = { 0 };
     uint16_t adcData = 0;
+
+    if( AdcConversionDone != NULL )
+    {
+        // A non-blocking conversion owns the ADC
+        return 0;
+    }
+
+    if( AdcMcuEnable( channel, 1 ) == true )
+    {
+        // Start ADC Software Conversion
+        HAL_ADC_Start( &AdcHandle );
+
+        HAL_ADC_PollForConversion( &AdcHandle, HAL_MAX_DELAY );
+
+        adcData = HAL_ADC_GetValue( &AdcHandle );
+    }
+
+    AdcMcuDisable( channel );
+
+    return adcData;
+}
+
+uint8_t AdcMcuStartConversion( Adc_t *obj, uint32_t channel, uint16_t nbSamples, AdcConversionCallback *callback, void* context )
+{
+    if( AdcConversionDone != NULL )
+    {
+        return FAIL;
+    }
+    AdcConversionDone = callback;
+    AdcConversionContext = context;
+    AdcConversionChannel = channel;
+
+    LpmSetStopMode( LPM_ADC_ID, LPM_DISABLE );
+
+    if( ( AdcMcuEnable( channel, nbSamples ) == false ) || ( HAL_ADC_Start_IT( &AdcHandle ) != HAL_OK ) )
+    {
+        AdcMcuDisable( channel );
+        AdcConversionDone = NULL;
+        LpmSetStopMode( LPM_ADC_ID, LPM_ENABLE );
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+static bool AdcMcuEnable( uint32_t channel, uint16_t nbSamples )
+{
+    ADC_ChannelConfTypeDef adcConf = { 0 };
     uint32_t tickStart = 0;
-    bool isAdcReady = true;
+    uint32_t ratio = 0;
 
     // Enable HSI
     __HAL_RCC_HSI_ENABLE( );
@@ -94,6 +176,23 @@ uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
     adcConf.Rank = ADC_RANK_CHANNEL_NUMBER;
     HAL_ADC_ConfigChannel( &AdcHandle, &adcConf );
 
+    // The oversampler accumulates nbSamples = 2^ratio conversions and shifts
+    // the sum right by ratio bits, which gives their 12 bits average.
+    // It can only be programmed while the ADC is disabled.
+    while( ( 1 << ratio ) < nbSamples )
+    {
+        ratio++;
+    }
+    if( ratio == 0 )
+    {
+        CLEAR_BIT( AdcHandle.Instance->CFGR2, ADC_CFGR2_OVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS | ADC_CFGR2_TOVS );
+    }
+    else
+    {
+        MODIFY_REG( AdcHandle.Instance->CFGR2, ADC_CFGR2_OVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS | ADC_CFGR2_TOVS,
+                    ADC_CFGR2_OVSE | ( ( ratio - 1 ) << ADC_CFGR2_OVSR_Pos ) | ( ratio << ADC_CFGR2_OVSS_Pos ) );
+    }
+
     // Enable ADC1
     __HAL_ADC_ENABLE( &AdcHandle );
 
@@ -103,24 +202,20 @@ uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
     {
         if( ( HAL_GetTick( ) - tickStart ) > ADC_ENABLE_TIMEOUT )
         {
-            isAdcReady = false;
-            break;
+            return false;
         }
     }
 
-    if( isAdcReady != false )
-    {
-        // Start ADC Software Conversion
-        HAL_ADC_Start( &AdcHandle );
-
-        HAL_ADC_PollForConversion( &AdcHandle, HAL_MAX_DELAY );
-
-        adcData = HAL_ADC_GetValue( &AdcHandle );
-    }
+    // Restore the calibration instead of running it again
+    HAL_ADCEx_Calibration_SetValue( &AdcHandle, ADC_SINGLE_ENDED, AdcCalibrationFactor );
+    return true;
+}
 
+static void AdcMcuDisable( uint32_t channel )
+{
     __HAL_ADC_DISABLE( &AdcHandle );
 
-    if( ( adcConf.Channel == ADC_CHANNEL_TEMPSENSOR ) || ( adcConf.Channel == ADC_CHANNEL_VREFINT ) )
+    if( ( channel == ADC_CHANNEL_TEMPSENSOR ) || ( channel == ADC_CHANNEL_VREFINT ) )
     {
         HAL_ADC_DeInit( &AdcHandle );
     }
@@ -128,6 +223,24 @@ uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
 
     // Disable HSI
     __HAL_RCC_HSI_DISABLE( );
+}
 
-    return adcData;
+void HAL_ADC_ConvCpltCallback( ADC_HandleTypeDef* hadc )
+{
+    AdcConversionCallback *callback = AdcConversionDone;
+    uint16_t value = HAL_ADC_GetValue( hadc );
+
+    AdcMcuDisable( AdcConversionChannel );
+    AdcConversionDone = NULL;
+    LpmSetStopMode( LPM_ADC_ID, LPM_ENABLE );
+
+    if( callback != NULL )
+    {
+        callback( AdcConversionContext, value );
+    }
+}
+
+void ADC1_COMP_IRQHandler( void )
+{
+    HAL_ADC_IRQHandler( &AdcHandle );
 }
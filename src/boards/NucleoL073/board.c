@@ -225,6 +225,96 @@ uint32_t BoardGetRandomSeed( void )
     return ( ( *( uint32_t* )ID1 ) ^ ( *( uint32_t* )ID2 ) ^ ( *( uint32_t* )ID3 ) );
 }
 
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords )
+{
+    uint8_t count = 0;
+    // Bounds the wait for the HSI48 start and each generated word
+    uint32_t timeout = 10000;
+    bool hsi48WasOn = READ_BIT( RCC->CRRCR, RCC_CRRCR_HSI48ON ) != 0;
+
+    // The RNG runs from the HSI48, which needs the VREFINT buffer
+    if( hsi48WasOn == false )
+    {
+        __HAL_RCC_SYSCFG_CLK_ENABLE( );
+        SET_BIT( SYSCFG->CFGR3, SYSCFG_CFGR3_ENREF_HSI48 );
+        SET_BIT( RCC->CRRCR, RCC_CRRCR_HSI48ON );
+    }
+    MODIFY_REG( RCC->CCIPR, RCC_CCIPR_HSI48SEL, RCC_RNGCLKSOURCE_HSI48 );
+    __HAL_RCC_RNG_CLK_ENABLE( );
+    SET_BIT( RNG->CR, RNG_CR_RNGEN );
+
+    while( ( count < nbWords ) && ( timeout > 0 ) )
+    {
+        uint32_t status = RNG->SR;
+
+        if( ( status & ( RNG_SR_SECS | RNG_SR_CECS ) ) != 0 )
+        {
+            // Seed or clock error, the caller falls back to another source
+            break;
+        }
+        if( ( status & RNG_SR_DRDY ) != 0 )
+        {
+            buffer[count++] = RNG->DR;
+            timeout = 10000;
+        }
+        else
+        {
+            timeout--;
+        }
+    }
+
+    CLEAR_BIT( RNG->CR, RNG_CR_RNGEN );
+    __HAL_RCC_RNG_CLK_DISABLE( );
+    if( hsi48WasOn == false )
+    {
+        // The HSI48 is kept on for the USB
+        CLEAR_BIT( RCC->CRRCR, RCC_CRRCR_HSI48ON );
+        CLEAR_BIT( SYSCFG->CFGR3, SYSCFG_CFGR3_ENREF_HSI48 );
+    }
+    return count;
+}
+
+uint32_t BoardGetCycleCounter( void )
+{
+#if ( __CORTEX_M >= 3 )
+    if( ( DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk ) == 0 )
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#else
+    // No DWT cycle counter on Cortex-M0+. Count the SysTick cycles instead.
+    uint32_t tick;
+    uint32_t val;
+
+    do
+    {
+        tick = HAL_GetTick( );
+        val = SysTick->VAL;
+    }while( tick != HAL_GetTick( ) );
+    return ( tick * ( SysTick->LOAD + 1 ) ) + ( SysTick->LOAD - val );
+#endif
+}
+
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size )
+{
+    uint16_t count = 0;
+
+    // Takes what the Tx FIFO can hold, never waits for the UART
+    while( ( count < size ) && ( UartPutChar( &Uart2, buffer[count] ) == 0 ) )
+    {
+        count++;
+    }
+    return count;
+}
+
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level )
+{
+    // The MCU runs at a fixed clock
+}
+
 void BoardGetUniqueId( uint8_t *id )
 {
     id[7] = ( ( *( uint32_t* )ID1 )+ ( *( uint32_t* )ID3 ) ) >> 24;
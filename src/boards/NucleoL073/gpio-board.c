@@ -322,20 +322,66 @@ uint32_t GpioMcuRead( Gpio_t *obj )
     }
 }
 
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+/*!
+ * \brief Dispatches the interrupts of a vector EXTI lines
+ *
+ * \remark Replaces the HAL_GPIO_EXTI_IRQHandler and HAL_GPIO_EXTI_Callback
+ *         layers. The pending lines are read and cleared at once, the scan
+ *         stops at the last pending line. The Cortex-M0+ has no CLZ
+ *         instruction, the lines are visited from the vector first line.
+ *
+ * \param [IN] first First EXTI line of the vector
+ * \param [IN] lines EXTI lines mask of the vector
+ */
+static inline void GpioMcuDispatchLines( uint8_t first, uint32_t lines )
+{
+    uint32_t pending = EXTI->PR & lines;
+
+    EXTI->PR = pending;
+    for( uint8_t line = first; pending != 0; line++ )
+    {
+        Gpio_t *obj;
+
+        if( ( pending & ( 1UL << line ) ) == 0 )
+        {
+            continue;
+        }
+        pending &= ~( 1UL << line );
+        obj = GpioIrq[line];
+        if( ( obj != NULL ) && ( obj->IrqHandler != NULL ) )
+        {
+            obj->IrqHandler( obj->Context );
+        }
+    }
+}
+#endif
+
 void EXTI0_1_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLines( 0, 0x00000003 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_0 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_1 );
+#endif
 }
 
 void EXTI2_3_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLines( 2, 0x0000000C );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_2 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_3 );
+#endif
 }
 
 void EXTI4_15_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLines( 4, 0x0000FFF0 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_4 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_5 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_6 );
@@ -348,6 +394,7 @@ void EXTI4_15_IRQHandler( void )
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_13 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_14 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_15 );
+#endif
 }
 
 void HAL_GPIO_EXTI_Callback( uint16_t gpioPin )
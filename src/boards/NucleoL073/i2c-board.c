@@ -121,6 +121,12 @@ uint8_t I2cMcuWriteBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_
     }
     status = ( HAL_I2C_Mem_Write( &I2cHandle, deviceAddr, addr, memAddSize, buffer, size, 2000 ) == HAL_OK ) ? SUCCESS : FAIL;
 
+    if( obj->TransferDone != NULL )
+    {
+        // No DMA on this board, the transfer is already completed
+        obj->TransferDone( obj->Context, status );
+        return SUCCESS;
+    }
     return status;
 }
 
@@ -139,6 +145,12 @@ uint8_t I2cMcuReadBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t
     }
     status = ( HAL_I2C_Mem_Read( &I2cHandle, deviceAddr, addr, memAddSize, buffer, size, 2000 ) == HAL_OK ) ? SUCCESS : FAIL;
 
+    if( obj->TransferDone != NULL )
+    {
+        // No DMA on this board, the transfer is already completed
+        obj->TransferDone( obj->Context, status );
+        return SUCCESS;
+    }
     return status;
 }
 
@@ -119,13 +119,14 @@ static void OnCalibrateSystemWakeupTimeTimerEvent( void* context )
 
 void BoardCriticalSectionBegin( uint32_t *mask )
 {
-    *mask = __get_PRIMASK( );
-    __disable_irq( );
+    // Only masks the interrupts which may enter the stack
+    *mask = __get_BASEPRI( );
+    __set_BASEPRI_MAX( BOARD_CRITICAL_SECTION_PRIORITY << ( 8 - __NVIC_PRIO_BITS ) );
 }
 
 void BoardCriticalSectionEnd( uint32_t *mask )
 {
-    __set_PRIMASK( *mask );
+    __set_BASEPRI( *mask );
 }
 
 void BoardInitPeriph( void )
@@ -225,6 +226,53 @@ uint32_t BoardGetRandomSeed( void )
     return ( ( *( uint32_t* )ID1 ) ^ ( *( uint32_t* )ID2 ) ^ ( *( uint32_t* )ID3 ) );
 }
 
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords )
+{
+    // No hardware generator on this MCU
+    return 0;
+}
+
+uint32_t BoardGetCycleCounter( void )
+{
+#if ( __CORTEX_M >= 3 )
+    if( ( DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk ) == 0 )
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#else
+    // No DWT cycle counter on Cortex-M0+. Count the SysTick cycles instead.
+    uint32_t tick;
+    uint32_t val;
+
+    do
+    {
+        tick = HAL_GetTick( );
+        val = SysTick->VAL;
+    }while( tick != HAL_GetTick( ) );
+    return ( tick * ( SysTick->LOAD + 1 ) ) + ( SysTick->LOAD - val );
+#endif
+}
+
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size )
+{
+    uint16_t count = 0;
+
+    // Takes what the Tx FIFO can hold, never waits for the UART
+    while( ( count < size ) && ( UartPutChar( &Uart2, buffer[count] ) == 0 ) )
+    {
+        count++;
+    }
+    return count;
+}
+
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level )
+{
+    // The MCU runs at a fixed clock
+}
+
 void BoardGetUniqueId( uint8_t *id )
 {
     id[7] = ( ( *( uint32_t* )ID1 )+ ( *( uint32_t* )ID3 ) ) >> 24;
@@ -25,6 +25,7 @@
 #include "board-config.h"
 #include "board.h"
 #include "delay.h"
+#include "lpm-board.h"
 #include "radio.h"
 #include "sx126x-board.h"
 
@@ -53,6 +54,10 @@ void SX126xIoInit( void )
 void SX126xIoIrqInit( DioIrqHandler dioIrq )
 {
     GpioSetInterrupt( &SX126x.DIO1, IRQ_RISING_EDGE, IRQ_HIGH_PRIORITY, dioIrq );
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+    // Highest priority in order to wake up the MCU even when waiting from the RTC alarm context
+    GpioSetInterrupt( &SX126x.BUSY, IRQ_FALLING_EDGE, IRQ_VERY_HIGH_PRIORITY, SX126xOnBusyIrq );
+#endif
 }
 
 void SX126xIoDeInit( void )
@@ -91,7 +96,21 @@ void SX126xReset( void )
 
 void SX126xWaitOnBusy( void )
 {
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+    // Interrupts are masked so that the BUSY line release can't be missed
+    // between the pin read and the WFI instruction. A pending interrupt still
+    // wakes up the MCU.
+    CRITICAL_SECTION_BEGIN( );
+    LpmSetStopMode( LPM_RADIO_ID, LPM_DISABLE );
+    while( GpioRead( &SX126x.BUSY ) == 1 )
+    {
+        LpmEnterLowPower( );
+    }
+    LpmSetStopMode( LPM_RADIO_ID, LPM_ENABLE );
+    CRITICAL_SECTION_END( );
+#else
     while( GpioRead( &SX126x.BUSY ) == 1 );
+#endif
 }
 
 void SX126xWakeup( void )
@@ -99,6 +118,7 @@ void SX126xWakeup( void )
     CRITICAL_SECTION_BEGIN( );
 
     GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
 
     SpiInOut( &SX126x.Spi, RADIO_GET_STATUS );
     SpiInOut( &SX126x.Spi, 0x00 );
@@ -116,13 +136,11 @@ void SX126xWriteCommand( RadioCommands_t command, uint8_t *buffer, uint16_t size
     SX126xCheckDeviceReady( );
 
     GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
 
     SpiInOut( &SX126x.Spi, ( uint8_t )command );
 
-    for( uint16_t i = 0; i < size; i++ )
-    {
-        SpiInOut( &SX126x.Spi, buffer[i] );
-    }
+    SpiTransfer( &SX126x.Spi, buffer, NULL, size );
 
     GpioWrite( &SX126x.Spi.Nss, 1 );
 
@@ -139,13 +157,11 @@ uint8_t SX126xReadCommand( RadioCommands_t command, uint8_t *buffer, uint16_t si
     SX126xCheckDeviceReady( );
 
     GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
 
     SpiInOut( &SX126x.Spi, ( uint8_t )command );
     status = SpiInOut( &SX126x.Spi, 0x00 );
-    for( uint16_t i = 0; i < size; i++ )
-    {
-        buffer[i] = SpiInOut( &SX126x.Spi, 0 );
-    }
+    SpiTransfer( &SX126x.Spi, NULL, buffer, size );
 
     GpioWrite( &SX126x.Spi.Nss, 1 );
 
@@ -159,15 +175,13 @@ void SX126xWriteRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
     SX126xCheckDeviceReady( );
 
     GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
     
     SpiInOut( &SX126x.Spi, RADIO_WRITE_REGISTER );
     SpiInOut( &SX126x.Spi, ( address & 0xFF00 ) >> 8 );
     SpiInOut( &SX126x.Spi, address & 0x00FF );
     
-    for( uint16_t i = 0; i < size; i++ )
-    {
-        SpiInOut( &SX126x.Spi, buffer[i] );
-    }
+    SpiTransfer( &SX126x.Spi, buffer, NULL, size );
 
     GpioWrite( &SX126x.Spi.Nss, 1 );
 
@@ -184,15 +198,13 @@ void SX126xReadRegisters( uint16_t address, uint8_t *buffer, uint16_t size )
     SX126xCheckDeviceReady( );
 
     GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
 
     SpiInOut( &SX126x.Spi, RADIO_READ_REGISTER );
     SpiInOut( &SX126x.Spi, ( address & 0xFF00 ) >> 8 );
     SpiInOut( &SX126x.Spi, address & 0x00FF );
     SpiInOut( &SX126x.Spi, 0 );
-    for( uint16_t i = 0; i < size; i++ )
-    {
-        buffer[i] = SpiInOut( &SX126x.Spi, 0 );
-    }
+    SpiTransfer( &SX126x.Spi, NULL, buffer, size );
     GpioWrite( &SX126x.Spi.Nss, 1 );
 
     SX126xWaitOnBusy( );
@@ -210,13 +222,11 @@ void SX126xWriteBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
     SX126xCheckDeviceReady( );
 
     GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
 
     SpiInOut( &SX126x.Spi, RADIO_WRITE_BUFFER );
     SpiInOut( &SX126x.Spi, offset );
-    for( uint16_t i = 0; i < size; i++ )
-    {
-        SpiInOut( &SX126x.Spi, buffer[i] );
-    }
+    SpiTransfer( &SX126x.Spi, buffer, NULL, size );
     GpioWrite( &SX126x.Spi.Nss, 1 );
 
     SX126xWaitOnBusy( );
@@ -227,14 +237,12 @@ void SX126xReadBuffer( uint8_t offset, uint8_t *buffer, uint8_t size )
     SX126xCheckDeviceReady( );
 
     GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
 
     SpiInOut( &SX126x.Spi, RADIO_READ_BUFFER );
     SpiInOut( &SX126x.Spi, offset );
     SpiInOut( &SX126x.Spi, 0 );
-    for( uint16_t i = 0; i < size; i++ )
-    {
-        buffer[i] = SpiInOut( &SX126x.Spi, 0 );
-    }
+    SpiTransfer( &SX126x.Spi, NULL, buffer, size );
     GpioWrite( &SX126x.Spi.Nss, 1 );
 
     SX126xWaitOnBusy( );
@@ -257,6 +265,40 @@ uint8_t SX126xGetDeviceId( void )
     }
 }
 
+/*!
+ * SX1261 PA optimal settings, DS_SX1261-2 datasheet table 13-21. The
+ * currents are the typical DC-DC regulator values at 3.3 V.
+ */
+static const SX126xPaSetting_t PaSettingsSX1261[] =
+{
+    { 10, 0x01, 0x00, 13, 18 },
+    { 14, 0x04, 0x00, 14, 25 },
+    { 15, 0x06, 0x00, 14, 33 },
+};
+
+/*!
+ * SX1262 PA optimal settings, DS_SX1261-2 datasheet table 13-21. The
+ * currents are the typical DC-DC regulator values at 3.3 V.
+ */
+static const SX126xPaSetting_t PaSettingsSX1262[] =
+{
+    { 14, 0x02, 0x02, 22, 90 },
+    { 17, 0x02, 0x03, 22, 95 },
+    { 20, 0x03, 0x05, 22, 102 },
+    { 22, 0x04, 0x07, 22, 118 },
+};
+
+const SX126xPaSetting_t* SX126xGetBoardPaSettings( uint8_t deviceId, uint8_t *size )
+{
+    if( deviceId == SX1261 )
+    {
+        *size = sizeof( PaSettingsSX1261 ) / sizeof( SX126xPaSetting_t );
+        return PaSettingsSX1261;
+    }
+    *size = sizeof( PaSettingsSX1262 ) / sizeof( SX126xPaSetting_t );
+    return PaSettingsSX1262;
+}
+
 void SX126xAntSwOn( void )
 {
     GpioInit( &AntPow, RADIO_ANT_SWITCH_POWER, PIN_OUTPUT, PIN_PUSH_PULL, PIN_PULL_UP, 1 );
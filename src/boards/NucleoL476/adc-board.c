@@ -20,12 +20,46 @@
  *
  * \author    Gregory Cristian ( Semtech )
  */
+#include <stdbool.h>
+#include <stddef.h>
 #include "stm32l4xx.h"
+#include "utilities.h"
 #include "board-config.h"
+#include "lpm-board.h"
 #include "adc-board.h"
 
 ADC_HandleTypeDef AdcHandle;
 
+/*!
+ * Calibration factor measured by AdcMcuConfig. The ADC loses it whenever it is
+ * de-initialized, it is restored each time the ADC is enabled.
+ */
+static uint32_t AdcCalibrationFactor = 0;
+
+/*!
+ * Ongoing non-blocking conversion
+ */
+static AdcConversionCallback *AdcConversionDone = NULL;
+static void* AdcConversionContext = NULL;
+static uint32_t AdcConversionChannel = 0;
+
+/*!
+ * \brief Powers the ADC, selects the channel and programs the hardware
+ *        oversampler
+ *
+ * \param [IN] channel   ADC input channel
+ * \param [IN] nbSamples Number of samples to average, power of 2
+ * \retval isAdcReady    True when the ADC is enabled
+ */
+static bool AdcMcuEnable( uint32_t channel, uint16_t nbSamples );
+
+/*!
+ * \brief Powers down the ADC once a conversion is done
+ *
+ * \param [IN] channel ADC input channel
+ */
+static void AdcMcuDisable( uint32_t channel );
+
 void AdcMcuInit( Adc_t *obj, PinNames adcInput )
 {
     AdcHandle.Instance = ( ADC_TypeDef* )ADC1_BASE;
@@ -38,6 +72,9 @@ void AdcMcuInit( Adc_t *obj, PinNames adcInput )
     {
         GpioInit( &obj->AdcInput, adcInput, PIN_ANALOGIC, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
     }
+
+    HAL_NVIC_SetPriority( ADC1_2_IRQn, 2, 0 );
+    HAL_NVIC_EnableIRQ( ADC1_2_IRQn );
 }
 
 void AdcMcuConfig( void )
@@ -54,13 +91,64 @@ void AdcMcuConfig( void )
     AdcHandle.Init.NbrOfConversion       = 1;
     AdcHandle.Init.LowPowerAutoWait      = DISABLE;
     HAL_ADC_Init( &AdcHandle );
+
+    // Calibration
+    HAL_ADCEx_Calibration_Start( &AdcHandle, ADC_SINGLE_ENDED );
+    AdcCalibrationFactor = HAL_ADCEx_Calibration_GetValue( &AdcHandle, ADC_SINGLE_ENDED );
 }
 
 uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
 {
-    ADC_ChannelConfTypeDef adcConf = { 0 };
     uint16_t adcData = 0;
 
+    if( AdcConversionDone != NULL )
+    {
+        // A non-blocking conversion owns the ADC
+        return 0;
+    }
+
+    if( AdcMcuEnable( channel, 1 ) == true )
+    {
+        // Start ADC Software Conversion
+        HAL_ADC_Start( &AdcHandle );
+
+        HAL_ADC_PollForConversion( &AdcHandle, HAL_MAX_DELAY );
+
+        adcData = HAL_ADC_GetValue( &AdcHandle );
+    }
+
+    AdcMcuDisable( channel );
+
+    return adcData;
+}
+
+uint8_t AdcMcuStartConversion( Adc_t *obj, uint32_t channel, uint16_t nbSamples, AdcConversionCallback *callback, void* context )
+{
+    if( AdcConversionDone != NULL )
+    {
+        return FAIL;
+    }
+    AdcConversionDone = callback;
+    AdcConversionContext = context;
+    AdcConversionChannel = channel;
+
+    LpmSetStopMode( LPM_ADC_ID, LPM_DISABLE );
+
+    if( ( AdcMcuEnable( channel, nbSamples ) == false ) || ( HAL_ADC_Start_IT( &AdcHandle ) != HAL_OK ) )
+    {
+        AdcMcuDisable( channel );
+        AdcConversionDone = NULL;
+        LpmSetStopMode( LPM_ADC_ID, LPM_ENABLE );
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+static bool AdcMcuEnable( uint32_t channel, uint16_t nbSamples )
+{
+    ADC_ChannelConfTypeDef adcConf = { 0 };
+    uint32_t ratio = 0;
+
     // Enable HSI
     __HAL_RCC_HSI_ENABLE( );
 
@@ -77,21 +165,39 @@ uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
 
     HAL_ADC_ConfigChannel( &AdcHandle, &adcConf );
 
-    // Enable ADC
-    if( ADC_Enable( &AdcHandle ) == HAL_OK )
+    // The oversampler accumulates nbSamples = 2^ratio conversions and shifts
+    // the sum right by ratio bits, which gives their 12 bits average
+    while( ( 1 << ratio ) < nbSamples )
     {
-        // Start ADC Software Conversion
-        HAL_ADC_Start( &AdcHandle );
-
-        HAL_ADC_PollForConversion( &AdcHandle, HAL_MAX_DELAY );
+        ratio++;
+    }
+    if( ratio == 0 )
+    {
+        CLEAR_BIT( AdcHandle.Instance->CFGR2, ADC_CFGR2_ROVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS | ADC_CFGR2_TROVS | ADC_CFGR2_ROVSM );
+    }
+    else
+    {
+        MODIFY_REG( AdcHandle.Instance->CFGR2, ADC_CFGR2_ROVSE | ADC_CFGR2_OVSR | ADC_CFGR2_OVSS | ADC_CFGR2_TROVS | ADC_CFGR2_ROVSM,
+                    ADC_CFGR2_ROVSE | ( ( ratio - 1 ) << ADC_CFGR2_OVSR_Pos ) | ( ratio << ADC_CFGR2_OVSS_Pos ) );
+    }
 
-        adcData = HAL_ADC_GetValue( &AdcHandle );
+    // Enable ADC
+    if( ADC_Enable( &AdcHandle ) != HAL_OK )
+    {
+        return false;
     }
 
+    // Restore the calibration instead of running it again
+    HAL_ADCEx_Calibration_SetValue( &AdcHandle, ADC_SINGLE_ENDED, AdcCalibrationFactor );
+    return true;
+}
+
+static void AdcMcuDisable( uint32_t channel )
+{
     ADC_ConversionStop( &AdcHandle, ADC_REGULAR_GROUP );
-    HAL_ADC_Stop( &AdcHandle );
+    HAL_ADC_Stop_IT( &AdcHandle );
 
-    if( ( adcConf.Channel == ADC_CHANNEL_TEMPSENSOR ) || ( adcConf.Channel == ADC_CHANNEL_VREFINT ) )
+    if( ( channel == ADC_CHANNEL_TEMPSENSOR ) || ( channel == ADC_CHANNEL_VREFINT ) )
     {
         HAL_ADC_DeInit( &AdcHandle );
     }
@@ -99,6 +205,24 @@ uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
 
     // Disable HSI
     __HAL_RCC_HSI_DISABLE( );
+}
 
-    return adcData;
+void HAL_ADC_ConvCpltCallback( ADC_HandleTypeDef* hadc )
+{
+    AdcConversionCallback *callback = AdcConversionDone;
+    uint16_t value = HAL_ADC_GetValue( hadc );
+
+    AdcMcuDisable( AdcConversionChannel );
+    AdcConversionDone = NULL;
+    LpmSetStopMode( LPM_ADC_ID, LPM_ENABLE );
+
+    if( callback != NULL )
+    {
+        callback( AdcConversionContext, value );
+    }
+}
+
+void ADC1_2_IRQHandler( void )
+{
+    HAL_ADC_IRQHandler( &AdcHandle );
 }
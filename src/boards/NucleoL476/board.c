@@ -84,6 +84,21 @@ static void CalibrateSystemWakeupTime( void );
  */
 static void SystemClockReConfig( void );
 
+#if defined( CLOCK_SCALING_ENABLED )
+/*!
+ * Number of pending high performance level requests
+ */
+static uint8_t PerformanceRequests = 0;
+
+/*!
+ * \brief Switches the system clock to the requested performance level
+ *
+ * \remark The high level runs the core from the 80 MHz PLL, the low level
+ *         from the 16 MHz HSI in the voltage range 2.
+ */
+static void SystemClockApplyLevel( void );
+#endif
+
 /*!
  * Timer used at first boot to calibrate the SystemWakeupTime
  */
@@ -124,13 +139,14 @@ static void OnCalibrateSystemWakeupTimeTimerEvent( void* context )
 
 void BoardCriticalSectionBegin( uint32_t *mask )
 {
-    *mask = __get_PRIMASK( );
-    __disable_irq( );
+    // Only masks the interrupts which may enter the stack
+    *mask = __get_BASEPRI( );
+    __set_BASEPRI_MAX( BOARD_CRITICAL_SECTION_PRIORITY << ( 8 - __NVIC_PRIO_BITS ) );
 }
 
 void BoardCriticalSectionEnd( uint32_t *mask )
 {
-    __set_PRIMASK( *mask );
+    __set_BASEPRI( *mask );
 }
 
 void BoardInitPeriph( void )
@@ -174,6 +190,9 @@ void BoardInitMcu( void )
         SystemClockReConfig( );
     }
 
+    // The SPI prescaler is computed for the high performance level clock. The
+    // transfers get slower, never faster, at the low level.
+
 #if defined( SX1261MBXBAS ) || defined( SX1262MBXCAS ) || defined( SX1262MBXDAS )
     SpiInit( &SX126x.Spi, SPI_1, RADIO_MOSI, RADIO_MISO, RADIO_SCLK, NC );
     SX126xIoInit( );
@@ -203,6 +222,11 @@ void BoardInitMcu( void )
             CalibrateSystemWakeupTime( );
         }
     }
+#if defined( CLOCK_SCALING_ENABLED )
+    CRITICAL_SECTION_BEGIN( );
+    SystemClockApplyLevel( );
+    CRITICAL_SECTION_END( );
+#endif
 }
 
 void BoardResetMcu( void )
@@ -232,6 +256,100 @@ uint32_t BoardGetRandomSeed( void )
     return ( ( *( uint32_t* )ID1 ) ^ ( *( uint32_t* )ID2 ) ^ ( *( uint32_t* )ID3 ) );
 }
 
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords )
+{
+    uint8_t count = 0;
+    // Bounds the wait for each generated word
+    uint32_t timeout = 10000;
+
+    // The RNG runs from the main PLL "Q" output. It is stopped while the
+    // system clock is scaled down, the clock error then ends the call.
+    __HAL_RCC_PLLCLKOUT_ENABLE( RCC_PLL_48M1CLK );
+    __HAL_RCC_RNG_CONFIG( RCC_RNGCLKSOURCE_PLL );
+    __HAL_RCC_RNG_CLK_ENABLE( );
+    SET_BIT( RNG->CR, RNG_CR_RNGEN );
+
+    while( ( count < nbWords ) && ( timeout > 0 ) )
+    {
+        uint32_t status = RNG->SR;
+
+        if( ( status & ( RNG_SR_SECS | RNG_SR_CECS ) ) != 0 )
+        {
+            // Seed or clock error, the caller falls back to another source
+            break;
+        }
+        if( ( status & RNG_SR_DRDY ) != 0 )
+        {
+            buffer[count++] = RNG->DR;
+            timeout = 10000;
+        }
+        else
+        {
+            timeout--;
+        }
+    }
+
+    CLEAR_BIT( RNG->CR, RNG_CR_RNGEN );
+    __HAL_RCC_RNG_CLK_DISABLE( );
+    return count;
+}
+
+uint32_t BoardGetCycleCounter( void )
+{
+#if ( __CORTEX_M >= 3 )
+    if( ( DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk ) == 0 )
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#else
+    // No DWT cycle counter on Cortex-M0+. Count the SysTick cycles instead.
+    uint32_t tick;
+    uint32_t val;
+
+    do
+    {
+        tick = HAL_GetTick( );
+        val = SysTick->VAL;
+    }while( tick != HAL_GetTick( ) );
+    return ( tick * ( SysTick->LOAD + 1 ) ) + ( SysTick->LOAD - val );
+#endif
+}
+
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size )
+{
+    uint16_t count = 0;
+
+    // Takes what the Tx FIFO can hold, never waits for the UART
+    while( ( count < size ) && ( UartPutChar( &Uart2, buffer[count] ) == 0 ) )
+    {
+        count++;
+    }
+    return count;
+}
+
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level )
+{
+#if defined( CLOCK_SCALING_ENABLED )
+    CRITICAL_SECTION_BEGIN( );
+    if( level == BOARD_PERFORMANCE_LEVEL_HIGH )
+    {
+        PerformanceRequests++;
+    }
+    else if( PerformanceRequests > 0 )
+    {
+        PerformanceRequests--;
+    }
+    if( McuInitialized == true )
+    {
+        SystemClockApplyLevel( );
+    }
+    CRITICAL_SECTION_END( );
+#endif
+}
+
 void BoardGetUniqueId( uint8_t *id )
 {
     id[7] = ( ( *( uint32_t* )ID1 )+ ( *( uint32_t* )ID3 ) ) >> 24;
@@ -279,6 +397,11 @@ void SystemClockConfig( void )
     RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_MSI | RCC_OSCILLATORTYPE_LSE;
     RCC_OscInitStruct.MSIState            = RCC_MSI_ON;
     RCC_OscInitStruct.LSEState            = RCC_LSE_ON;
+#if defined( CLOCK_SCALING_ENABLED )
+    RCC_OscInitStruct.OscillatorType     |= RCC_OSCILLATORTYPE_HSI;
+    RCC_OscInitStruct.HSIState            = RCC_HSI_ON;
+    RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+#endif
     RCC_OscInitStruct.MSIClockRange       = RCC_MSIRANGE_6;
     RCC_OscInitStruct.MSICalibrationValue = RCC_MSICALIBRATION_DEFAULT;
     RCC_OscInitStruct.PLL.PLLState        = RCC_PLL_ON;
@@ -306,6 +429,11 @@ void SystemClockConfig( void )
 
     PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_RTC;
     PeriphClkInit.RTCClockSelection = RCC_RTCCLKSOURCE_LSE;
+#if defined( CLOCK_SCALING_ENABLED )
+    // Keeps the UART baud rate independent of the system clock
+    PeriphClkInit.PeriphClockSelection |= RCC_PERIPHCLK_USART2;
+    PeriphClkInit.Usart2ClockSelection = RCC_USART2CLKSOURCE_HSI;
+#endif
     if( HAL_RCCEx_PeriphCLKConfig( &PeriphClkInit ) != HAL_OK )
     {
         assert_param( FAIL );
@@ -422,6 +550,11 @@ void SystemClockReConfig( void )
         // Enable Power Control clock
         __HAL_RCC_PWR_CLK_ENABLE( );
 
+#if defined( CLOCK_SCALING_ENABLED )
+        // The low performance level may have left the voltage range 2
+        HAL_PWREx_ControlVoltageScaling( PWR_REGULATOR_VOLTAGE_SCALE1 );
+#endif
+
         // Get the Oscillators configuration according to the internal RCC registers */
         HAL_RCC_GetOscConfig( &RCC_OscInitStruct );
 
@@ -435,6 +568,10 @@ void SystemClockReConfig( void )
         
         /* Get the Clocks configuration according to the internal RCC registers */
         HAL_RCC_GetClockConfig(&RCC_ClkInitStruct, &pFLatency);
+#if defined( CLOCK_SCALING_ENABLED )
+        // The low performance level may have left a lower flash latency
+        pFLatency = FLASH_LATENCY_4;
+#endif
         
         /* Select PLL as system clock source and keep HCLK, PCLK1 and PCLK2 clocks dividers as before */
         RCC_ClkInitStruct.ClockType     = RCC_CLOCKTYPE_SYSCLK;
@@ -452,6 +589,81 @@ void SystemClockReConfig( void )
     CRITICAL_SECTION_END( );
 }
 
+#if defined( CLOCK_SCALING_ENABLED )
+void SystemClockApplyLevel( void )
+{
+    RCC_ClkInitTypeDef RCC_ClkInitStruct = { 0 };
+    RCC_OscInitTypeDef RCC_OscInitStruct = { 0 };
+    uint32_t pFLatency = 0;
+
+    // HSI clocks the UART and the low performance level. It is stopped in STOP mode.
+    if( __HAL_RCC_GET_FLAG( RCC_FLAG_HSIRDY ) == RESET )
+    {
+        RCC_OscInitStruct.OscillatorType      = RCC_OSCILLATORTYPE_HSI;
+        RCC_OscInitStruct.HSIState            = RCC_HSI_ON;
+        RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+        RCC_OscInitStruct.PLL.PLLState        = RCC_PLL_NONE;
+        if( HAL_RCC_OscConfig( &RCC_OscInitStruct ) != HAL_OK )
+        {
+            assert_param( FAIL );
+        }
+    }
+
+    HAL_RCC_GetClockConfig( &RCC_ClkInitStruct, &pFLatency );
+    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_SYSCLK;
+
+    if( PerformanceRequests > 0 )
+    {
+        if( __HAL_RCC_GET_SYSCLK_SOURCE( ) == RCC_CFGR_SWS_PLL )
+        {
+            return;
+        }
+        HAL_PWREx_ControlVoltageScaling( PWR_REGULATOR_VOLTAGE_SCALE1 );
+
+        if( __HAL_RCC_GET_FLAG( RCC_FLAG_PLLRDY ) == RESET )
+        {
+            HAL_RCC_GetOscConfig( &RCC_OscInitStruct );
+            RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+            RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+            if( HAL_RCC_OscConfig( &RCC_OscInitStruct ) != HAL_OK )
+            {
+                assert_param( FAIL );
+            }
+        }
+
+        RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+        if( HAL_RCC_ClockConfig( &RCC_ClkInitStruct, FLASH_LATENCY_4 ) != HAL_OK )
+        {
+            assert_param( FAIL );
+        }
+    }
+    else
+    {
+        if( __HAL_RCC_GET_SYSCLK_SOURCE( ) == RCC_CFGR_SWS_HSI )
+        {
+            return;
+        }
+        // 16 MHz requires 1 wait state in the voltage range 2
+        RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+        if( HAL_RCC_ClockConfig( &RCC_ClkInitStruct, FLASH_LATENCY_1 ) != HAL_OK )
+        {
+            assert_param( FAIL );
+        }
+
+        // The PLL is restarted by the next high performance level request
+        HAL_RCC_GetOscConfig( &RCC_OscInitStruct );
+        RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+        RCC_OscInitStruct.PLL.PLLState = RCC_PLL_OFF;
+        if( HAL_RCC_OscConfig( &RCC_OscInitStruct ) != HAL_OK )
+        {
+            assert_param( FAIL );
+        }
+
+        HAL_PWREx_ControlVoltageScaling( PWR_REGULATOR_VOLTAGE_SCALE2 );
+    }
+}
+#endif
+
 void SysTick_Handler( void )
 {
     HAL_IncTick( );
@@ -501,6 +713,54 @@ void LpmExitStopMode( void )
     CRITICAL_SECTION_END( );
 }
 
+#if defined( NVM_CTX_RETAINED_ENABLED )
+/**
+  * \brief Enters Low Power Standby Mode
+  *
+  * \note The SRAM2 and the RTC keep running. The RTC alarm wakes the MCU up
+  *       through a reset.
+  */
+void LpmEnterOffMode( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    BoardDeInitMcu( );
+
+    CRITICAL_SECTION_END( );
+
+    // The SRAM2 holds the MAC contexts snapshot
+    HAL_PWREx_EnableSRAM2ContentRetention( );
+
+    // Keeps the radio NSS line high, the GPIOs are floating in Standby
+    HAL_PWREx_EnableGPIOPullUp( ( uint32_t )RADIO_NSS >> 4, 1 << ( RADIO_NSS & 0x0F ) );
+    HAL_PWREx_EnablePullUpPullDownConfig( );
+
+    // The RTC alarm is an internal wake up source
+    HAL_PWREx_EnableInternalWakeUpLine( );
+    __HAL_PWR_CLEAR_FLAG( PWR_FLAG_WU );
+
+    // Enter Standby Mode
+    HAL_PWR_EnterSTANDBYMode( );
+}
+
+/*!
+ * \brief Exits Low Power Standby Mode, only reached when the Standby mode
+ *        wasn't entered because of a pending interrupt
+ */
+void LpmExitOffMode( void )
+{
+    HAL_PWREx_DisablePullUpPullDownConfig( );
+
+    // Disable IRQ while the MCU is not running on HSI
+    CRITICAL_SECTION_BEGIN( );
+
+    // Initilizes the peripherals
+    BoardInitMcu( );
+
+    CRITICAL_SECTION_END( );
+}
+#endif
+
 /*!
  * \brief Enters Low Power Sleep Mode
  *
@@ -27,9 +27,29 @@
 #include "eeprom-board.h"
 #include "utilities.h"
 
+/*!
+ * Number of bytes held by an emulated variable
+ */
+#define EEPROM_VARIABLE_SIZE                        4
+
 uint16_t EepromVirtualAddress[NB_OF_VARIABLES];
 __IO uint32_t ErasingOnGoing = 0;
 
+/*!
+ * Current values of the emulated variables
+ */
+static uint32_t EepromCache[NB_OF_VARIABLES];
+
+/*!
+ * One bit per emulated variable, set when the variable holds a value
+ */
+static uint32_t EepromCacheValid[( NB_OF_VARIABLES + 31 ) / 32];
+
+static bool EepromIsVariableValid( uint16_t index )
+{
+    return ( EepromCacheValid[index >> 5] & ( 1UL << ( index & 0x1F ) ) ) != 0;
+}
+
 /*!
  * \brief Initializes the EEPROM emulation module.
  */
@@ -79,6 +99,19 @@ void EepromMcuInit( void )
         }
     }
 
+    // Load the current values. The reads don't access the flash anymore.
+    for( uint16_t i = 0; i < NB_OF_VARIABLES; i++ )
+    {
+        if( EE_ReadVariable32bits( EepromVirtualAddress[i], &EepromCache[i] ) == EE_OK )
+        {
+            EepromCacheValid[i >> 5] |= 1UL << ( i & 0x1F );
+        }
+        else
+        {
+            EepromCache[i] = 0;
+        }
+    }
+
     // Lock the Flash Program Erase controller
     HAL_FLASH_Lock( );
 }
@@ -93,17 +126,53 @@ bool EepromMcuIsErasingOnGoing( void )
     return ErasingOnGoing;
 }
 
+bool EepromMcuIsBusy( void )
+{
+    // The end of the clean up erase is signaled by the flash end of operation
+    // interrupt
+    return ErasingOnGoing != 0;
+}
+
 uint8_t EepromMcuWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 {
     uint8_t status = SUCCESS;
     EE_Status eeStatus = EE_OK;
-    
+    uint32_t i = 0;
+
+    assert_param( ( addr + size ) <= ( NB_OF_VARIABLES * EEPROM_VARIABLE_SIZE ) );
+
+    // The flash can't be programmed while a clean up erases pages
+    while( ErasingOnGoing != 0 ){ }
+
     // Unlock the Flash Program Erase controller
     HAL_FLASH_Unlock( );
 
-    for( uint32_t i = 0; i < size; i++ )
+    while( i < size )
     {
-        eeStatus |= EE_WriteVariable8bits( EepromVirtualAddress[addr + i], buffer[i] );
+        uint16_t index = ( addr + i ) / EEPROM_VARIABLE_SIZE;
+        uint32_t value = EepromCache[index];
+
+        // Merge the new bytes in the variable, little endian
+        do
+        {
+            uint8_t shift = ( ( addr + i ) % EEPROM_VARIABLE_SIZE ) * 8;
+
+            value = ( value & ~( 0xFFUL << shift ) ) | ( ( uint32_t )buffer[i] << shift );
+            i++;
+        } while( ( i < size ) && ( ( ( addr + i ) % EEPROM_VARIABLE_SIZE ) != 0 ) );
+
+        // Unchanged variables are not written again
+        if( ( EepromIsVariableValid( index ) == false ) || ( value != EepromCache[index] ) )
+        {
+            EE_Status writeStatus = EE_WriteVariable32bits( EepromVirtualAddress[index], value );
+
+            eeStatus |= writeStatus;
+            if( ( writeStatus & EE_STATUSMASK_ERROR ) != EE_STATUSMASK_ERROR )
+            {
+                EepromCache[index] = value;
+                EepromCacheValid[index >> 5] |= 1UL << ( index & 0x1F );
+            }
+        }
     }
 
     if( eeStatus != EE_OK )
@@ -113,8 +182,15 @@ uint8_t EepromMcuWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 
     if( ( eeStatus & EE_STATUSMASK_CLEANUP ) == EE_STATUSMASK_CLEANUP )
     {
+        // Erase the pages in the background. The flash is locked again by
+        // EE_EndOfCleanup_UserCallback.
+        ErasingOnGoing = 1;
+        if( EE_CleanUp_IT( ) == EE_OK )
+        {
+            return ( ( eeStatus & EE_STATUSMASK_ERROR ) == EE_STATUSMASK_ERROR ) ? FAIL : SUCCESS;
+        }
         ErasingOnGoing = 0;
-        eeStatus |= EE_CleanUp( );
+        status = FAIL;
     }
     if( ( eeStatus & EE_STATUSMASK_ERROR ) == EE_STATUSMASK_ERROR )
     {
@@ -128,23 +204,19 @@ uint8_t EepromMcuWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 
 uint8_t EepromMcuReadBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 {
-    uint8_t status = SUCCESS;
-
-    // Unlock the Flash Program Erase controller
-    HAL_FLASH_Unlock( );
+    assert_param( ( addr + size ) <= ( NB_OF_VARIABLES * EEPROM_VARIABLE_SIZE ) );
 
     for( uint32_t i = 0; i < size; i++ )
     {
-        if( EE_ReadVariable8bits( EepromVirtualAddress[addr + i], buffer + i ) != EE_OK )
+        uint16_t index = ( addr + i ) / EEPROM_VARIABLE_SIZE;
+
+        if( EepromIsVariableValid( index ) == false )
         {
-            status = FAIL;
-            break;
+            return FAIL;
         }
+        buffer[i] = EepromCache[index] >> ( ( ( addr + i ) % EEPROM_VARIABLE_SIZE ) * 8 );
     }
-
-    // Lock the Flash Program Erase controller
-    HAL_FLASH_Lock( );
-    return status;
+    return SUCCESS;
 }
 
 void EepromMcuSetDeviceAddr( uint8_t addr )
@@ -183,5 +255,7 @@ void HAL_FLASH_EndOfOperationCallback( uint32_t ReturnValue )
  */
 void EE_EndOfCleanup_UserCallback( void )
 {
+    // Lock the Flash Program Erase controller
+    HAL_FLASH_Lock( );
     ErasingOnGoing = 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
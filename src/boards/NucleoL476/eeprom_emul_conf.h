@@ -94,7 +94,7 @@
 /** @defgroup Exported_Configuration_Constants Exported Configuration Constants
   * @{
   */
-#define NB_OF_VARIABLES         2048U  /*!< Number of variables to handle in eeprom */
+#define NB_OF_VARIABLES         512U   /*!< Number of variables to handle in eeprom. Each 32 bits variable holds 4 bytes */
 
 /**
   * @}
@@ -176,11 +176,11 @@ void GpioMcuSetInterrupt( Gpio_t *obj, IrqModes irqMode, IrqPriorities irqPriori
             priority = 2;
             break;
         case IRQ_HIGH_PRIORITY:
-            priority = 1;
-            break;
         case IRQ_VERY_HIGH_PRIORITY:
         default:
-            priority = 0;
+            // The handlers enter the stack, they must be masked by the
+            // critical sections
+            priority = BOARD_CRITICAL_SECTION_PRIORITY;
             break;
         }
 
@@ -331,48 +331,130 @@ uint32_t GpioMcuRead( Gpio_t *obj )
     }
 }
 
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+/*!
+ * \brief Calls the handler bound to an EXTI line
+ *
+ * \param [IN] line EXTI line
+ */
+static inline void GpioMcuCallIrqHandler( uint8_t line )
+{
+    Gpio_t *obj = GpioIrq[line];
+
+    if( ( obj != NULL ) && ( obj->IrqHandler != NULL ) )
+    {
+        obj->IrqHandler( obj->Context );
+    }
+}
+
+/*!
+ * \brief Dispatches the interrupt of a dedicated vector EXTI line
+ *
+ * \remark Replaces the HAL_GPIO_EXTI_IRQHandler and HAL_GPIO_EXTI_Callback
+ *         layers, the radio DIO bound to the lines 0 to 4 reach their driver
+ *         handler with a single register write.
+ *
+ * \param [IN] line EXTI line
+ */
+static inline void GpioMcuDispatchLine( uint8_t line )
+{
+    EXTI->PR1 = 1UL << line;
+    GpioMcuCallIrqHandler( line );
+}
+
+/*!
+ * \brief Dispatches the interrupts of a shared vector EXTI lines
+ *
+ * \remark The pending lines are read and cleared at once, only the pending
+ *         ones are visited instead of the vector whole lines range.
+ *
+ * \param [IN] lines EXTI lines mask of the vector
+ */
+static inline void GpioMcuDispatchLines( uint32_t lines )
+{
+    uint32_t pending = EXTI->PR1 & lines;
+
+    EXTI->PR1 = pending;
+    while( pending != 0 )
+    {
+        uint8_t line = 31 - __CLZ( pending );
+
+        pending &= ~( 1UL << line );
+        GpioMcuCallIrqHandler( line );
+    }
+}
+#endif
+
 void EXTI0_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLine( 0 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_0 );
+#endif
 }
 
 void EXTI1_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLine( 1 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_1 );
+#endif
 }
 
 void EXTI2_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLine( 2 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_2 );
+#endif
 }
 
 void EXTI3_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLine( 3 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_3 );
+#endif
 }
 
 void EXTI4_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLine( 4 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_4 );
+#endif
 }
 
 void EXTI9_5_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLines( 0x000003E0 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_5 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_6 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_7 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_8 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_9 );
+#endif
 }
 
 void EXTI15_10_IRQHandler( void )
 {
+#if defined( GPIO_IRQ_DIRECT_ENABLED )
+    GpioMcuDispatchLines( 0x0000FC00 );
+#else
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_10 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_11 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_12 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_13 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_14 );
     HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_15 );
+#endif
 }
 
 void HAL_GPIO_EXTI_Callback( uint16_t gpioPin )
@@ -25,11 +25,25 @@
 #include <stdint.h>
 #include "stm32l4xx.h"
 #include "utilities.h"
+#include "rtc-board.h"
 #include "lpm-board.h"
 
+#if defined( NVM_CTX_RETAINED_ENABLED )
+/*!
+ * Minimum time left before the next timer expiry for the OFF mode to be
+ * entered [ms]. Below it, the MCU restart costs more than the STOP mode.
+ */
+#define LPM_OFF_MODE_MIN_TIMEOUT                    2000
+#endif
+
 static uint32_t StopModeDisable = 0;
 static uint32_t OffModeDisable = 0;
 
+/*!
+ * Set while the MAC waits for a reception window
+ */
+static bool RxWaitMode = false;
+
 void LpmSetOffMode( LpmId_t id, LpmSetMode_t mode )
 {
     CRITICAL_SECTION_BEGIN( );
@@ -82,9 +96,60 @@ void LpmSetStopMode( LpmId_t id, LpmSetMode_t mode )
     return;
 }
 
+void LpmSetRxWaitMode( bool enable )
+{
+    RxWaitMode = enable;
+}
+
+/*!
+ * \brief Selects the deepest allowed low power mode which is left before the
+ *        next timer expiry
+ *
+ * \retval mode Low power mode to enter
+ */
+static LpmGetMode_t LpmSelectMode( void )
+{
+    LpmGetMode_t mode = LpmGetMode( );
+    uint32_t remaining = RtcGetAlarmRemainingTicks( );
+    int16_t wakeUpTime = RtcGetMcuWakeUpTime( );
+
+    if( remaining == RTC_ALARM_NOT_RUNNING )
+    {
+        return mode;
+    }
+
+    if( mode == LPM_OFF_MODE )
+    {
+#if defined( NVM_CTX_RETAINED_ENABLED )
+        // The timers are lost in OFF mode. The RTC alarm restarts the MCU at
+        // the next expiry and the session resumes from the SRAM2.
+        if( remaining <= RtcMs2Tick( LPM_OFF_MODE_MIN_TIMEOUT ) )
+        {
+            mode = LPM_STOP_MODE;
+        }
+#else
+        // The timers are lost in OFF mode
+        mode = LPM_STOP_MODE;
+#endif
+    }
+
+    if( ( mode == LPM_STOP_MODE ) &&
+        ( remaining <= ( RtcGetMinimumTimeout( ) + ( uint32_t )MAX( wakeUpTime, 0 ) ) ) )
+    {
+        // The STOP mode would be left after the timer expiry
+        mode = LPM_SLEEP_MODE;
+    }
+
+    // Only the STOP mode requires the alarm to anticipate the MCU wake up time
+    RtcSetAlarmWakeUpCompensation( mode == LPM_STOP_MODE );
+    return mode;
+}
+
 void LpmEnterLowPower( void )
 {
-    if( StopModeDisable != 0 )
+    LpmGetMode_t mode = LpmSelectMode( );
+
+    if( mode == LPM_SLEEP_MODE )
     {
         /*!
         * SLEEP mode is required
@@ -94,7 +159,7 @@ void LpmEnterLowPower( void )
     }
     else
     { 
-        if( OffModeDisable != 0 )
+        if( mode == LPM_STOP_MODE )
         {
             /*!
             * STOP mode is required
@@ -117,16 +182,23 @@ void LpmEnterLowPower( void )
 LpmGetMode_t LpmGetMode(void)
 {
     LpmGetMode_t mode;
+    uint32_t stopModeDisable;
 
     CRITICAL_SECTION_BEGIN( );
 
-    if( StopModeDisable != 0 )
+    stopModeDisable = StopModeDisable;
+    if( RxWaitMode == true )
+    {
+        stopModeDisable &= ~( uint32_t )LPM_RX_WAIT_IGNORED_IDS;
+    }
+
+    if( stopModeDisable != 0 )
     {
         mode = LPM_SLEEP_MODE;
     }
     else
     {
-        if( OffModeDisable != 0 )
+        if( ( OffModeDisable != 0 ) || ( RxWaitMode == true ) )
         {
             mode = LPM_STOP_MODE;
         }
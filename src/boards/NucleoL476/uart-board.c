@@ -32,11 +32,59 @@
 #define TX_BUFFER_RETRY_COUNT                       10
 
 static UART_HandleTypeDef UartHandle;
-uint8_t RxData = 0;
-uint8_t TxData = 0;
+
+/*!
+ * UART DMA channels handles
+ */
+static DMA_HandleTypeDef UartDmaTxHandle;
+static DMA_HandleTypeDef UartDmaRxHandle;
+
+/*!
+ * Size of the FIFO block being sent by the Tx DMA channel. 0 when idle
+ */
+static uint16_t UartDmaTxSize = 0;
 
 extern Uart_t Uart2;
 
+/*!
+ * \brief Initializes the DMA channels used by the UART
+ */
+static void UartDmaInit( void );
+
+/*!
+ * \brief Starts receiving into the Rx FIFO buffer
+ *
+ * \remark The Rx DMA channel runs in circular mode over the whole Rx FIFO
+ *         buffer. The received bytes are committed to the FIFO on the half
+ *         transfer, transfer complete and idle line interrupts.
+ */
+static void UartDmaStartRx( void );
+
+/*!
+ * \brief Commits the bytes received by the Rx DMA channel to the Rx FIFO
+ */
+static void UartDmaRxUpdate( void );
+
+/*!
+ * \brief Starts sending the next contiguous block of the Tx FIFO, if the Tx
+ *        DMA channel is idle
+ */
+static void UartDmaStartTx( void );
+
+/*!
+ * \brief Rx DMA channel half transfer and transfer complete callback
+ *
+ * \param [IN] hdma DMA channel handle
+ */
+static void UartDmaOnRx( DMA_HandleTypeDef *hdma );
+
+/*!
+ * \brief Tx DMA channel transfer complete and error callback
+ *
+ * \param [IN] hdma DMA channel handle
+ */
+static void UartDmaOnTxCplt( DMA_HandleTypeDef *hdma );
+
 void UartMcuInit( Uart_t *obj, UartId_t uartId, PinNames tx, PinNames rx )
 {
     obj->UartId = uartId;
@@ -157,11 +205,15 @@ void UartMcuConfig( Uart_t *obj, UartMode_t mode, uint32_t baudrate, WordLength_
             assert_param( FAIL );
         }
 
+        UartDmaInit( );
+
         HAL_NVIC_SetPriority( USART2_IRQn, 1, 0 );
         HAL_NVIC_EnableIRQ( USART2_IRQn );
 
-        /* Enable the UART Data Register not empty Interrupt */
-        HAL_UART_Receive_IT( &UartHandle, &RxData, 1 );
+        if( mode != TX_ONLY )
+        {
+            UartDmaStartRx( );
+        }
     }
 }
 
@@ -175,6 +227,11 @@ void UartMcuDeInit( Uart_t *obj )
     }
     else
     {
+        HAL_NVIC_DisableIRQ( USART2_IRQn );
+        HAL_DMA_DeInit( &UartDmaRxHandle );
+        HAL_DMA_DeInit( &UartDmaTxHandle );
+        UartDmaTxSize = 0;
+
         __HAL_RCC_USART2_FORCE_RESET( );
         __HAL_RCC_USART2_RELEASE_RESET( );
         __HAL_RCC_USART2_CLK_DISABLE( );
@@ -197,14 +254,13 @@ uint8_t UartMcuPutChar( Uart_t *obj, uint8_t data )
     else
     {
         CRITICAL_SECTION_BEGIN( );
-        TxData = data;
 
         if( IsFifoFull( &obj->FifoTx ) == false )
         {
-            FifoPush( &obj->FifoTx, TxData );
+            FifoPush( &obj->FifoTx, data );
 
-            // Trig UART Tx interrupt to start sending the FIFO contents.
-            __HAL_UART_ENABLE_IT( &UartHandle, UART_IT_TC );
+            // Start sending the FIFO contents
+            UartDmaStartTx( );
 
             CRITICAL_SECTION_END( );
             return 0; // OK
@@ -251,13 +307,24 @@ uint8_t UartMcuPutBuffer( Uart_t *obj, uint8_t *buffer, uint16_t size )
     }
     else
     {
-        uint8_t retryCount;
-        uint16_t i;
+        uint8_t retryCount = 0;
+        uint16_t count;
 
-        for( i = 0; i < size; i++ )
+        while( size > 0 )
         {
-            retryCount = 0;
-            while( UartPutChar( obj, buffer[i] ) != 0 )
+            count = FifoPushBuffer( &obj->FifoTx, buffer, size );
+            if( count > 0 )
+            {
+                CRITICAL_SECTION_BEGIN( );
+                // Start sending the FIFO contents
+                UartDmaStartTx( );
+                CRITICAL_SECTION_END( );
+
+                buffer += count;
+                size -= count;
+                retryCount = 0;
+            }
+            else
             {
                 retryCount++;
 
@@ -276,17 +343,24 @@ uint8_t UartMcuGetBuffer( Uart_t *obj, uint8_t *buffer, uint16_t size, uint16_t
 {
     uint16_t localSize = 0;
 
-    while( localSize < size )
+    if( obj->UartId == UART_USB_CDC )
     {
-        if( UartGetChar( obj, buffer + localSize ) == 0 )
-        {
-            localSize++;
-        }
-        else
+        while( localSize < size )
         {
-            break;
+            if( UartGetChar( obj, buffer + localSize ) == 0 )
+            {
+                localSize++;
+            }
+            else
+            {
+                break;
+            }
         }
     }
+    else
+    {
+        localSize = FifoPopBuffer( &obj->FifoRx, buffer, size );
+    }
 
     *nbReadBytes = localSize;
 
@@ -297,43 +371,133 @@ uint8_t UartMcuGetBuffer( Uart_t *obj, uint8_t *buffer, uint16_t size, uint16_t
     return 0; // OK
 }
 
-void HAL_UART_TxCpltCallback( UART_HandleTypeDef *handle )
+static void UartDmaInit( void )
 {
-    if( IsFifoEmpty( &Uart2.FifoTx ) == false )
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+
+    UartDmaRxHandle.Instance = DMA1_Channel6;
+    UartDmaRxHandle.Init.Request = DMA_REQUEST_2;
+    UartDmaRxHandle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    UartDmaRxHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+    UartDmaRxHandle.Init.MemInc = DMA_MINC_ENABLE;
+    UartDmaRxHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    UartDmaRxHandle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    UartDmaRxHandle.Init.Mode = DMA_CIRCULAR;
+    UartDmaRxHandle.Init.Priority = DMA_PRIORITY_MEDIUM;
+    HAL_DMA_Init( &UartDmaRxHandle );
+    UartDmaRxHandle.XferHalfCpltCallback = UartDmaOnRx;
+    UartDmaRxHandle.XferCpltCallback = UartDmaOnRx;
+
+    UartDmaTxHandle.Instance = DMA1_Channel7;
+    UartDmaTxHandle.Init.Request = DMA_REQUEST_2;
+    UartDmaTxHandle.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    UartDmaTxHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+    UartDmaTxHandle.Init.MemInc = DMA_MINC_ENABLE;
+    UartDmaTxHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    UartDmaTxHandle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    UartDmaTxHandle.Init.Mode = DMA_NORMAL;
+    UartDmaTxHandle.Init.Priority = DMA_PRIORITY_LOW;
+    HAL_DMA_Init( &UartDmaTxHandle );
+    UartDmaTxHandle.XferCpltCallback = UartDmaOnTxCplt;
+    UartDmaTxHandle.XferErrorCallback = UartDmaOnTxCplt;
+    UartDmaTxSize = 0;
+
+    // Same priority as the UART interrupt, the FIFOs are never updated by
+    // both handlers at the same time
+    HAL_NVIC_SetPriority( DMA1_Channel6_IRQn, 1, 0 );
+    HAL_NVIC_EnableIRQ( DMA1_Channel6_IRQn );
+    HAL_NVIC_SetPriority( DMA1_Channel7_IRQn, 1, 0 );
+    HAL_NVIC_EnableIRQ( DMA1_Channel7_IRQn );
+}
+
+static void UartDmaStartRx( void )
+{
+    // The channel writes from the start of the buffer, which must match the
+    // FIFO write index
+    FifoInit( &Uart2.FifoRx, Uart2.FifoRx.Data, Uart2.FifoRx.Size );
+
+    HAL_DMA_Start_IT( &UartDmaRxHandle, ( uint32_t )&UartHandle.Instance->RDR, ( uint32_t )Uart2.FifoRx.Data, Uart2.FifoRx.Size );
+    SET_BIT( UartHandle.Instance->CR3, USART_CR3_DMAR );
+
+    // One interrupt per burst, when the line becomes idle
+    __HAL_UART_CLEAR_IDLEFLAG( &UartHandle );
+    __HAL_UART_ENABLE_IT( &UartHandle, UART_IT_IDLE );
+}
+
+static void UartDmaRxUpdate( void )
+{
+    uint16_t mask = Uart2.FifoRx.Size - 1;
+    uint16_t pos = ( Uart2.FifoRx.Size - __HAL_DMA_GET_COUNTER( &UartDmaRxHandle ) ) & mask;
+    uint16_t count = ( pos - Uart2.FifoRx.End ) & mask;
+
+    if( count == 0 )
     {
-        TxData = FifoPop( &Uart2.FifoTx );
-        //  Write one byte to the transmit data register
-        HAL_UART_Transmit_IT( &UartHandle, &TxData, 1 );
+        return;
     }
+    // The bytes which do not fit have been overwritten by the channel anyway
+    FifoCommit( &Uart2.FifoRx, count );
 
     if( Uart2.IrqNotify != NULL )
     {
-        Uart2.IrqNotify( UART_NOTIFY_TX );
+        Uart2.IrqNotify( UART_NOTIFY_RX );
     }
 }
 
-void HAL_UART_RxCpltCallback( UART_HandleTypeDef *handle )
+static void UartDmaStartTx( void )
 {
-    if( IsFifoFull( &Uart2.FifoRx ) == false )
+    uint8_t *data;
+
+    if( UartDmaTxSize != 0 )
+    {
+        // Already sending, the completion will start the next block
+        return;
+    }
+    UartDmaTxSize = FifoPeekSpan( &Uart2.FifoTx, &data );
+    if( UartDmaTxSize == 0 )
     {
-        // Read one byte from the receive data register
-        FifoPush( &Uart2.FifoRx, RxData );
+        return;
     }
+    HAL_DMA_Start_IT( &UartDmaTxHandle, ( uint32_t )data, ( uint32_t )&UartHandle.Instance->TDR, UartDmaTxSize );
+    SET_BIT( UartHandle.Instance->CR3, USART_CR3_DMAT );
+}
+
+static void UartDmaOnRx( DMA_HandleTypeDef *hdma )
+{
+    UartDmaRxUpdate( );
+}
+
+static void UartDmaOnTxCplt( DMA_HandleTypeDef *hdma )
+{
+    CLEAR_BIT( UartHandle.Instance->CR3, USART_CR3_DMAT );
+    FifoSkip( &Uart2.FifoTx, UartDmaTxSize );
+    UartDmaTxSize = 0;
+    UartDmaStartTx( );
 
     if( Uart2.IrqNotify != NULL )
     {
-        Uart2.IrqNotify( UART_NOTIFY_RX );
+        Uart2.IrqNotify( UART_NOTIFY_TX );
     }
+}
 
-    HAL_UART_Receive_IT( &UartHandle, &RxData, 1 );
+void USART2_IRQHandler( void )
+{
+    if( ( __HAL_UART_GET_FLAG( &UartHandle, UART_FLAG_IDLE ) == true ) &&
+        ( __HAL_UART_GET_IT_SOURCE( &UartHandle, UART_IT_IDLE ) != RESET ) )
+    {
+        __HAL_UART_CLEAR_IDLEFLAG( &UartHandle );
+        UartDmaRxUpdate( );
+    }
+
+    // Reception errors do not stop the Rx DMA channel, just clear them
+    __HAL_UART_CLEAR_FLAG( &UartHandle, UART_CLEAR_PEF | UART_CLEAR_FEF | UART_CLEAR_NEF | UART_CLEAR_OREF );
 }
 
-void HAL_UART_ErrorCallback( UART_HandleTypeDef *handle )
+void DMA1_Channel6_IRQHandler( void )
 {
-    HAL_UART_Receive_IT( &UartHandle, &RxData, 1 );
+    HAL_DMA_IRQHandler( &UartDmaRxHandle );
 }
 
-void USART2_IRQHandler( void )
+void DMA1_Channel7_IRQHandler( void )
 {
-    HAL_UART_IRQHandler( &UartHandle );
+    HAL_DMA_IRQHandler( &UartDmaTxHandle );
 }
@@ -0,0 +1,43 @@
+/*!
+ * \file      adc-board.c
+ *
+ * \brief     Target board ADC driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "utilities.h"
+#include "adc-board.h"
+
+void AdcMcuInit( Adc_t *obj, PinNames adcInput )
+{
+}
+
+void AdcMcuConfig( void )
+{
+}
+
+uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel )
+{
+    return 0;
+}
+
+uint8_t AdcMcuStartConversion( Adc_t *obj, uint32_t channel, uint16_t nbSamples, AdcConversionCallback *callback, void* context )
+{
+    callback( context, 0 );
+    return SUCCESS;
+}
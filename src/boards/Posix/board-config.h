@@ -0,0 +1,51 @@
+/*!
+ * \file      board-config.h
+ *
+ * \brief     Board configuration
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#ifndef __BOARD_CONFIG_H__
+#define __BOARD_CONFIG_H__
+
+/*!
+ * Defines the time required for the TCXO to wakeup [ms].
+ */
+#define BOARD_TCXO_WAKEUP_TIME                      0
+
+/*!
+ * Size of the simulated EEPROM [bytes]
+ */
+#define BOARD_EEPROM_SIZE                           6144
+
+/*!
+ * Board MCU pins definitions
+ *
+ * \remark The host has no physical pins. The pins are only used to keep
+ *         track of the GPIO objects state.
+ */
+#define LED_1                                       PA_0
+#define LED_2                                       PA_1
+
+#define I2C_SCL                                     PB_8
+#define I2C_SDA                                     PB_9
+
+#define UART_TX                                     PA_2
+#define UART_RX                                     PA_3
+
+#endif // __BOARD_CONFIG_H__
@@ -0,0 +1,179 @@
+/*!
+ * \file      board.c
+ *
+ * \brief     Target board general functions implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utilities.h"
+#include "gpio.h"
+#include "i2c.h"
+#include "uart.h"
+#include "timer.h"
+#include "board-config.h"
+#include "lpm-board.h"
+#include "rtc-board.h"
+#include "board.h"
+
+/*!
+ * Environment variable used to override the board unique ID seed
+ */
+#define BOARD_ID_ENV                                "LORAMAC_SIM_ID"
+
+/*!
+ * LED GPIO pins objects
+ */
+Gpio_t Led1;
+Gpio_t Led2;
+
+/*
+ * MCU objects
+ */
+I2c_t I2c;
+Uart_t Uart2;
+
+/*!
+ * Flag to indicate if the MCU is Initialized
+ */
+static bool McuInitialized = false;
+
+/*!
+ * \brief Returns the board identifier seed
+ *
+ * \retval id Identifier read from \ref BOARD_ID_ENV or a default value
+ */
+static uint32_t BoardGetIdSeed( void )
+{
+    char *env = getenv( BOARD_ID_ENV );
+
+    if( env != NULL )
+    {
+        return ( uint32_t )strtoul( env, NULL, 0 );
+    }
+    return 0x0001;
+}
+
+void BoardCriticalSectionBegin( uint32_t *mask )
+{
+    // The simulation is single threaded. No interrupts to mask.
+    *mask = 0;
+}
+
+void BoardCriticalSectionEnd( uint32_t *mask )
+{
+    ( void )mask;
+}
+
+void BoardInitPeriph( void )
+{
+
+}
+
+void BoardInitMcu( void )
+{
+    if( McuInitialized == false )
+    {
+        // LEDs
+        GpioInit( &Led1, LED_1, PIN_OUTPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
+        GpioInit( &Led2, LED_2, PIN_OUTPUT, PIN_PUSH_PULL, PIN_NO_PULL, 0 );
+
+        UartInit( &Uart2, UART_2, UART_TX, UART_RX );
+        UartConfig( &Uart2, RX_TX, 921600, UART_8_BIT, UART_1_STOP_BIT, NO_PARITY, NO_FLOW_CTRL );
+
+        RtcInit( );
+
+        McuInitialized = true;
+    }
+}
+
+void BoardResetMcu( void )
+{
+    exit( EXIT_SUCCESS );
+}
+
+void BoardDeInitMcu( void )
+{
+}
+
+uint32_t BoardGetRandomSeed( void )
+{
+    return BoardGetIdSeed( ) * 1103515245UL + 12345;
+}
+
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords )
+{
+    // Keeps the simulations reproducible, the simulated radio provides the
+    // entropy
+    return 0;
+}
+
+uint32_t BoardGetCycleCounter( void )
+{
+    struct timespec now;
+
+    // Host nanoseconds
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint32_t )( ( ( uint64_t )now.tv_sec * 1000000000ULL ) + now.tv_nsec );
+}
+
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size )
+{
+    return ( uint16_t )fwrite( buffer, 1, size, stdout );
+}
+
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level )
+{
+    // The MCU runs at a fixed clock
+}
+
+void BoardGetUniqueId( uint8_t *id )
+{
+    uint32_t seed = BoardGetIdSeed( );
+
+    id[7] = 0x00;
+    id[6] = 0x00;
+    id[5] = 0x00;
+    id[4] = 0x50; // 'P'osix
+    id[3] = seed >> 24;
+    id[2] = seed >> 16;
+    id[1] = seed >> 8;
+    id[0] = seed;
+}
+
+uint32_t BoardGetBatteryVoltage( void )
+{
+    return 0;
+}
+
+uint8_t BoardGetBatteryLevel( void )
+{
+    return 0; //  Battery level [0: node is connected to an external power source ...
+}
+
+uint8_t GetBoardPowerSource( void )
+{
+    return USB_POWER;
+}
+
+void BoardLowPowerHandler( void )
+{
+    LpmEnterLowPower( );
+}
@@ -0,0 +1,65 @@
+/*!
+ * \file      eeprom-board.c
+ *
+ * \brief     Target board EEPROM driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "utilities.h"
+#include "board-config.h"
+#include "eeprom-board.h"
+
+/*!
+ * Simulated EEPROM memory
+ */
+static uint8_t EepromMemory[BOARD_EEPROM_SIZE];
+
+uint8_t EepromMcuWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
+{
+    if( ( ( uint32_t )addr + size ) > BOARD_EEPROM_SIZE )
+    {
+        return FAIL;
+    }
+    memcpy1( EepromMemory + addr, buffer, size );
+    return SUCCESS;
+}
+
+uint8_t EepromMcuReadBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
+{
+    if( ( ( uint32_t )addr + size ) > BOARD_EEPROM_SIZE )
+    {
+        return FAIL;
+    }
+    memcpy1( buffer, EepromMemory + addr, size );
+    return SUCCESS;
+}
+
+void EepromMcuSetDeviceAddr( uint8_t addr )
+{
+    // Not used on this platform.
+}
+
+uint8_t EepromMcuGetDeviceAddr( void )
+{
+    return 0;
+}
+
+bool EepromMcuIsBusy( void )
+{
+    return false;
+}
@@ -0,0 +1,115 @@
+/*!
+ * \file      gpio-board.c
+ *
+ * \brief     Target board GPIO driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include <stddef.h>
+#include "utilities.h"
+#include "gpio-board.h"
+
+/*!
+ * Number of MCU pins tracked by the simulation
+ */
+#define GPIO_MCU_PIN_COUNT                          ( PH_15 + 1 )
+
+/*!
+ * Simulated output pins state
+ */
+static uint8_t GpioPinState[GPIO_MCU_PIN_COUNT];
+
+void GpioMcuInit( Gpio_t *obj, PinNames pin, PinModes mode, PinConfigs config, PinTypes type, uint32_t value )
+{
+    obj->pin = pin;
+
+    if( pin == NC )
+    {
+        return;
+    }
+
+    obj->pinIndex = ( uint16_t )pin;
+    obj->pull = type;
+
+    // Sets initial output value
+    if( mode == PIN_OUTPUT )
+    {
+        GpioMcuWrite( obj, value );
+    }
+}
+
+void GpioMcuSetContext( Gpio_t *obj, void* context )
+{
+    obj->Context = context;
+}
+
+void GpioMcuSetInterrupt( Gpio_t *obj, IrqModes irqMode, IrqPriorities irqPriority, GpioIrqHandler *irqHandler )
+{
+    if( obj->pin == NC )
+    {
+        return;
+    }
+    obj->IrqHandler = irqHandler;
+}
+
+void GpioMcuRemoveInterrupt( Gpio_t *obj )
+{
+    obj->IrqHandler = NULL;
+}
+
+void GpioMcuWrite( Gpio_t *obj, uint32_t value )
+{
+    if( obj == NULL )
+    {
+        while( 1 );
+    }
+    // Check if pin is not connected
+    if( obj->pin == NC )
+    {
+        return;
+    }
+    GpioPinState[obj->pinIndex] = ( value != 0 ) ? 1 : 0;
+}
+
+void GpioMcuToggle( Gpio_t *obj )
+{
+    if( obj == NULL )
+    {
+        while( 1 );
+    }
+    // Check if pin is not connected
+    if( obj->pin == NC )
+    {
+        return;
+    }
+    GpioPinState[obj->pinIndex] ^= 1;
+}
+
+uint32_t GpioMcuRead( Gpio_t *obj )
+{
+    if( obj == NULL )
+    {
+        while( 1 );
+    }
+    // Check if pin is not connected
+    if( obj->pin == NC )
+    {
+        return 0;
+    }
+    return GpioPinState[obj->pinIndex];
+}
@@ -0,0 +1,56 @@
+/*!
+ * \file      gps-board.c
+ *
+ * \brief     Target board GPS driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "utilities.h"
+#include "gps-board.h"
+
+/*
+ * No GPS is available on the simulated board.
+ */
+
+void GpsMcuOnPpsSignal( void* context )
+{
+}
+
+void GpsMcuInvertPpsTrigger( void )
+{
+}
+
+void GpsMcuInit( void )
+{
+}
+
+void GpsMcuStart( void )
+{
+}
+
+void GpsMcuStop( void )
+{
+}
+
+void GpsMcuProcess( void )
+{
+}
+
+void GpsMcuIrqNotify( UartNotifyId_t id )
+{
+}
@@ -0,0 +1,62 @@
+/*!
+ * \file      i2c-board.c
+ *
+ * \brief     Target board I2C driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "utilities.h"
+#include "i2c-board.h"
+
+void I2cMcuInit( I2c_t *obj, I2cId_t i2cId, PinNames scl, PinNames sda )
+{
+    obj->I2cId = i2cId;
+}
+
+void I2cMcuFormat( I2c_t *obj, I2cMode mode, I2cDutyCycle dutyCycle, bool I2cAckEnable, I2cAckAddrMode AckAddrMode, uint32_t I2cFrequency )
+{
+}
+
+void I2cMcuDeInit( I2c_t *obj )
+{
+}
+
+void I2cMcuResetBus( I2c_t *obj )
+{
+}
+
+void I2cSetAddrSize( I2c_t *obj, I2cAddrSize addrSize )
+{
+}
+
+uint8_t I2cMcuWriteBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *buffer, uint16_t size )
+{
+    // No device is attached to the simulated bus
+    return FAIL;
+}
+
+uint8_t I2cMcuReadBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *buffer, uint16_t size )
+{
+    // No device is attached to the simulated bus
+    return FAIL;
+}
+
+uint8_t I2cMcuWaitStandbyState( I2c_t *obj, uint8_t deviceAddr )
+{
+    return FAIL;
+}
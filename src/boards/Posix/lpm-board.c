@@ -0,0 +1,164 @@
+/*!
+ * \file      lpm-board.c
+ *
+ * \brief     Target board low power modes management
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "utilities.h"
+#include "lpm-board.h"
+#include "rtc-sim.h"
+
+static uint32_t StopModeDisable = 0;
+static uint32_t OffModeDisable = 0;
+
+/*!
+ * Set while the MAC waits for a reception window
+ */
+static bool RxWaitMode = false;
+
+void LpmSetOffMode( LpmId_t id, LpmSetMode_t mode )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    switch( mode )
+    {
+        case LPM_DISABLE:
+        {
+            OffModeDisable |= ( uint32_t )id;
+            break;
+        }
+        case LPM_ENABLE:
+        {
+            OffModeDisable &= ~( uint32_t )id;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    CRITICAL_SECTION_END( );
+    return;
+}
+
+void LpmSetStopMode( LpmId_t id, LpmSetMode_t mode )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    switch( mode )
+    {
+        case LPM_DISABLE:
+        {
+            StopModeDisable |= ( uint32_t )id;
+            break;
+        }
+        case LPM_ENABLE:
+        {
+            StopModeDisable &= ~( uint32_t )id;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    CRITICAL_SECTION_END( );
+    return;
+}
+
+void LpmSetRxWaitMode( bool enable )
+{
+    RxWaitMode = enable;
+}
+
+void LpmEnterLowPower( void )
+{
+    /*!
+     * Whatever the requested mode, sleeping on the host means jumping the
+     * virtual time up to the next alarm.
+     */
+    if( RtcSimAdvanceToAlarm( ) == false )
+    {
+        // Nothing can wake up the MCU anymore
+        printf( "\r\n###### Simulation ended: no pending alarm ######\r\n" );
+        exit( EXIT_SUCCESS );
+    }
+}
+
+LpmGetMode_t LpmGetMode(void)
+{
+    LpmGetMode_t mode;
+    uint32_t stopModeDisable;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    stopModeDisable = StopModeDisable;
+    if( RxWaitMode == true )
+    {
+        stopModeDisable &= ~( uint32_t )LPM_RX_WAIT_IGNORED_IDS;
+    }
+
+    if( stopModeDisable != 0 )
+    {
+        mode = LPM_SLEEP_MODE;
+    }
+    else
+    {
+        if( ( OffModeDisable != 0 ) || ( RxWaitMode == true ) )
+        {
+            mode = LPM_STOP_MODE;
+        }
+        else
+        {
+            mode = LPM_OFF_MODE;
+        }
+    }
+
+    CRITICAL_SECTION_END( );
+    return mode;
+}
+
+void LpmEnterSleepMode( void )
+{
+}
+
+void LpmExitSleepMode( void )
+{
+}
+
+void LpmEnterStopMode( void )
+{
+}
+
+void LpmExitStopMode( void )
+{
+}
+
+void LpmEnterOffMode( void )
+{
+}
+
+void LpmExitOffMode( void )
+{
+}
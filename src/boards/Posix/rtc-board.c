@@ -0,0 +1,252 @@
+/*!
+ * \file      rtc-board.c
+ *
+ * \brief     Target board RTC timer and low power modes management
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "utilities.h"
+#include "timer.h"
+#include "rtc-board.h"
+#include "rtc-sim.h"
+
+/*!
+ * Minimum timeout delay of the alarm [ticks]
+ *
+ * \remark The virtual RTC runs with a 1 ms tick.
+ */
+#define MIN_ALARM_DELAY                             1
+
+/*!
+ * RTC timer context
+ */
+typedef struct
+{
+    uint32_t Time;         // Reference time
+    uint32_t Delay;        // Reference Timeout duration
+    bool     IsRunning;    // Alarm is armed
+}RtcTimerContext_t;
+
+/*!
+ * Keep the value of the RTC timer when the RTC alarm is set
+ * Set with the \ref RtcSetTimerContext function
+ * Value is kept as a Reference to calculate alarm
+ */
+static RtcTimerContext_t RtcTimerContext;
+
+/*!
+ * Virtual time since the start of the simulation [ms]
+ */
+static uint64_t RtcVirtualTime = 0;
+
+/*!
+ * Backup registers
+ */
+static uint32_t RtcBkupRegisters[2];
+
+/*!
+ * \brief Returns the virtual time truncated to the timer width [ticks]
+ */
+static uint32_t RtcGetVirtualTicks( void )
+{
+    return ( uint32_t )RtcVirtualTime;
+}
+
+uint32_t RtcGetAlarmRemainingTicks( void )
+{
+    uint32_t elapsed = RtcGetVirtualTicks( ) - RtcTimerContext.Time;
+
+    if( RtcTimerContext.IsRunning == false )
+    {
+        return RTC_ALARM_NOT_RUNNING;
+    }
+
+    if( elapsed >= RtcTimerContext.Delay )
+    {
+        return 0;
+    }
+    return RtcTimerContext.Delay - elapsed;
+}
+
+void RtcInit( void )
+{
+    RtcTimerContext.Time = 0;
+    RtcTimerContext.Delay = 0;
+    RtcTimerContext.IsRunning = false;
+}
+
+uint32_t RtcSetTimerContext( void )
+{
+    RtcTimerContext.Time = RtcGetVirtualTicks( );
+    return RtcTimerContext.Time;
+}
+
+uint32_t RtcGetTimerContext( void )
+{
+    return RtcTimerContext.Time;
+}
+
+uint32_t RtcGetMinimumTimeout( void )
+{
+    return( MIN_ALARM_DELAY );
+}
+
+uint32_t RtcMs2Tick( TimerTime_t milliseconds )
+{
+    return ( uint32_t )milliseconds;
+}
+
+uint32_t RtcUs2Tick( uint32_t microseconds )
+{
+    return microseconds / 1000;
+}
+
+uint32_t RtcTick2Us( uint32_t tick )
+{
+    return tick * 1000;
+}
+
+TimerTime_t RtcTick2Ms( uint32_t tick )
+{
+    return ( TimerTime_t )tick;
+}
+
+void RtcDelayMs( TimerTime_t milliseconds )
+{
+    RtcSimAdvance( RtcMs2Tick( milliseconds ) );
+}
+
+void RtcSetAlarm( uint32_t timeout )
+{
+    RtcStartAlarm( timeout );
+}
+
+void RtcSetAlarmWakeUpCompensation( bool enable )
+{
+    // The virtual time has no wake up latency
+}
+
+void RtcStopAlarm( void )
+{
+    RtcTimerContext.IsRunning = false;
+}
+
+void RtcStartAlarm( uint32_t timeout )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    RtcTimerContext.Delay = timeout;
+    RtcTimerContext.IsRunning = true;
+
+    CRITICAL_SECTION_END( );
+}
+
+uint32_t RtcGetTimerValue( void )
+{
+    return RtcGetVirtualTicks( );
+}
+
+uint32_t RtcGetTimerElapsedTime( void )
+{
+    return( ( uint32_t )( RtcGetVirtualTicks( ) - RtcTimerContext.Time ) );
+}
+
+void RtcSetMcuWakeUpTime( void )
+{
+}
+
+int16_t RtcGetMcuWakeUpTime( void )
+{
+    return 0;
+}
+
+uint32_t RtcGetCalendarTime( uint16_t *milliseconds )
+{
+    *milliseconds = ( uint16_t )( RtcVirtualTime % 1000 );
+    return ( uint32_t )( RtcVirtualTime / 1000 );
+}
+
+void RtcBkupWrite( uint32_t data0, uint32_t data1 )
+{
+    RtcBkupRegisters[0] = data0;
+    RtcBkupRegisters[1] = data1;
+}
+
+void RtcBkupRead( uint32_t *data0, uint32_t *data1 )
+{
+    *data0 = RtcBkupRegisters[0];
+    *data1 = RtcBkupRegisters[1];
+}
+
+void RtcProcess( void )
+{
+    // Not used on this platform.
+}
+
+TimerTime_t RtcTempCompensation( TimerTime_t period, float temperature )
+{
+    return period;
+}
+
+void RtcSimAdvance( uint32_t ticks )
+{
+    while( ticks > 0 )
+    {
+        uint32_t remaining = RtcGetAlarmRemainingTicks( );
+
+        if( ( RtcTimerContext.IsRunning == true ) && ( remaining <= ticks ) )
+        {
+            RtcVirtualTime += remaining;
+            ticks -= remaining;
+            RtcTimerContext.IsRunning = false;
+            TimerIrqHandler( );
+        }
+        else
+        {
+            RtcVirtualTime += ticks;
+            ticks = 0;
+        }
+    }
+}
+
+bool RtcSimAdvanceToAlarm( void )
+{
+    if( RtcTimerContext.IsRunning == false )
+    {
+        return false;
+    }
+    RtcVirtualTime += RtcGetAlarmRemainingTicks( );
+    RtcTimerContext.IsRunning = false;
+    TimerIrqHandler( );
+    return true;
+}
+
+uint64_t RtcSimGetTime( void )
+{
+    return RtcVirtualTime;
+}
+
+bool RtcSimSetTime( uint64_t time )
+{
+    if( RtcTimerContext.IsRunning == true )
+    {
+        return false;
+    }
+    RtcVirtualTime = time;
+    return true;
+}
@@ -0,0 +1,75 @@
+/*!
+ * \file      rtc-sim.h
+ *
+ * \brief     Host virtual time control
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#ifndef __RTC_SIM_H__
+#define __RTC_SIM_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * \brief Advances the virtual time by the given amount of ticks
+ *
+ * \remark The alarm handler is called if the alarm expires during the
+ *         advance. The virtual time then keeps advancing until the requested
+ *         amount of ticks has elapsed.
+ *
+ * \param [IN] ticks Number of ticks to advance
+ */
+void RtcSimAdvance( uint32_t ticks );
+
+/*!
+ * \brief Advances the virtual time up to the pending alarm and calls the
+ *        alarm handler
+ *
+ * \retval status true if an alarm was pending, false otherwise
+ */
+bool RtcSimAdvanceToAlarm( void );
+
+/*!
+ * \brief Returns the virtual time elapsed since the start of the simulation
+ *
+ * \retval time Virtual time [ms]
+ */
+uint64_t RtcSimGetTime( void );
+
+/*!
+ * \brief Sets the virtual time
+ *
+ * \remark Allows a host harness to run several devices, each one on its own
+ *         time line. The time can only be set while no alarm is pending.
+ *
+ * \param [IN] time Virtual time [ms]
+ * \retval status   true if the time has been set, false if an alarm is pending
+ */
+bool RtcSimSetTime( uint64_t time );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RTC_SIM_H__
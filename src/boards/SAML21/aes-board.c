@@ -0,0 +1,104 @@
+/*!
+ * \file      aes-board.c
+ *
+ * \brief     Target board AES hardware accelerator driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ *
+ * \author    Marten Lootsma(TWTG) on behalf of Microchip/Atmel (c)2017
+ */
+#include <hal_init.h>
+#include "utilities.h"
+#include "aes-board.h"
+
+/*!
+ * \brief Reads a little endian 32 bits word
+ */
+static uint32_t AesMcuGetWord( const uint8_t *buffer )
+{
+    return ( ( uint32_t )buffer[3] << 24 ) | ( ( uint32_t )buffer[2] << 16 ) |
+           ( ( uint32_t )buffer[1] << 8 ) | ( uint32_t )buffer[0];
+}
+
+/*!
+ * \brief Writes a little endian 32 bits word
+ */
+static void AesMcuPutWord( uint8_t *buffer, uint32_t word )
+{
+    buffer[0] = ( uint8_t )word;
+    buffer[1] = ( uint8_t )( word >> 8 );
+    buffer[2] = ( uint8_t )( word >> 16 );
+    buffer[3] = ( uint8_t )( word >> 24 );
+}
+
+void AesMcuInit( void )
+{
+    hri_mclk_set_APBCMASK_AES_bit( MCLK );
+
+    hri_aes_set_CTRLA_SWRST_bit( AES );
+    while( hri_aes_get_CTRLA_SWRST_bit( AES ) == true )
+    {
+    }
+
+    // ECB encryption, 128 bits key, started by software. CTRLA can only be
+    // written while the peripheral is disabled.
+    hri_aes_write_CTRLA_reg( AES, AES_CTRLA_AESMODE( 0 ) | AES_CTRLA_KEYSIZE( 0 ) | AES_CTRLA_CIPHER );
+    hri_aes_set_CTRLA_ENABLE_bit( AES );
+}
+
+void AesMcuDeInit( void )
+{
+    hri_aes_clear_CTRLA_ENABLE_bit( AES );
+
+    hri_mclk_clear_APBCMASK_AES_bit( MCLK );
+}
+
+void AesMcuSetKey( const uint8_t key[AES_MCU_BLOCK_SIZE] )
+{
+    // The key words are written in the buffer byte order, first byte in the
+    // least significant byte of KEYWORD0
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        hri_aes_write_KEYWORD_reg( AES, i, AesMcuGetWord( &key[i * 4] ) );
+    }
+}
+
+void AesMcuEncrypt( const uint8_t in[AES_MCU_BLOCK_SIZE], uint8_t out[AES_MCU_BLOCK_SIZE] )
+{
+    hri_aes_write_DATABUFPTR_reg( AES, 0 );
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        hri_aes_write_INDATA_reg( AES, AesMcuGetWord( &in[i * 4] ) );
+    }
+
+    hri_aes_set_CTRLB_START_bit( AES );
+
+    // A block takes 57 peripheral clock cycles. Busy waiting is cheaper than
+    // switching to a DMAC transfer or an interrupt for a single block.
+    while( hri_aes_get_INTFLAG_ENCCMP_bit( AES ) == false )
+    {
+    }
+
+    hri_aes_write_DATABUFPTR_reg( AES, 0 );
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        AesMcuPutWord( &out[i * 4], hri_aes_read_INDATA_reg( AES ) );
+    }
+
+    hri_aes_clear_INTFLAG_reg( AES, AES_INTFLAG_ENCCMP );
+}
@@ -109,6 +109,56 @@ uint32_t BoardGetRandomSeed( void )
     return 0;
 }
 
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords )
+{
+    uint8_t count = 0;
+    // Bounds the wait for each generated word
+    uint32_t timeout = 10000;
+
+    hri_mclk_set_APBCMASK_TRNG_bit( MCLK );
+    hri_trng_set_CTRLA_ENABLE_bit( TRNG );
+
+    while( ( count < nbWords ) && ( timeout > 0 ) )
+    {
+        if( hri_trng_get_INTFLAG_DATARDY_bit( TRNG ) == true )
+        {
+            buffer[count++] = hri_trng_read_DATA_reg( TRNG );
+            timeout = 10000;
+        }
+        else
+        {
+            timeout--;
+        }
+    }
+
+    hri_trng_clear_CTRLA_ENABLE_bit( TRNG );
+    hri_mclk_clear_APBCMASK_TRNG_bit( MCLK );
+    return count;
+}
+
+uint32_t BoardGetCycleCounter( void )
+{
+    // No cycle counter on Cortex-M0+ and the SysTick is used by the delays
+    return RtcGetTimerValue( );
+}
+
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size )
+{
+    uint16_t count = 0;
+
+    // Takes what the Tx FIFO can hold, never waits for the UART
+    while( ( count < size ) && ( UartPutChar( &Uart1, buffer[count] ) == 0 ) )
+    {
+        count++;
+    }
+    return count;
+}
+
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level )
+{
+    // The MCU runs at a fixed clock
+}
+
 void BoardGetUniqueId( uint8_t *id )
 {
     // We don't have an ID, so use the one from Commissioning.h
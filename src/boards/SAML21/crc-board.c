@@ -0,0 +1,60 @@
+/*!
+ * \file      crc-board.c
+ *
+ * \brief     Target board CRC calculation unit driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include <hal_init.h>
+#include "utilities.h"
+#include "crc-board.h"
+
+bool CrcMcuUpdate16( uint16_t *crc, const uint8_t *buffer, uint32_t size )
+{
+    // The DSU only computes the CRC-32
+    return false;
+}
+
+bool CrcMcuUpdate32( uint32_t *crc, const uint8_t *buffer, uint32_t size )
+{
+    // The DSU reads whole words
+    if( ( ( ( uint32_t )buffer & 0x03 ) != 0 ) || ( ( size & 0x03 ) != 0 ) || ( size == 0 ) )
+    {
+        return false;
+    }
+
+    // The DSU is write protected after reset
+    hri_pac_write_WRCTRL_reg( PAC, PAC_WRCTRL_PERID( ID_DSU ) | PAC_WRCTRL_KEY( PAC_WRCTRL_KEY_CLR_Val ) );
+
+    // The DSU register is the one of the software implementations, before
+    // the final XOR
+    hri_dsu_clear_STATUSA_reg( DSU, DSU_STATUSA_DONE | DSU_STATUSA_BERR );
+    hri_dsu_write_ADDR_reg( DSU, ( uint32_t )buffer );
+    hri_dsu_write_LENGTH_reg( DSU, size );
+    hri_dsu_write_DATA_reg( DSU, *crc );
+    hri_dsu_write_CTRL_reg( DSU, DSU_CTRL_CRC );
+    while( hri_dsu_get_STATUSA_DONE_bit( DSU ) == false )
+    {
+    }
+    if( hri_dsu_get_STATUSA_BERR_bit( DSU ) == true )
+    {
+        return false;
+    }
+    *crc = hri_dsu_read_DATA_reg( DSU );
+    return true;
+}
@@ -49,3 +49,8 @@ uint8_t EepromMcuGetDeviceAddr( void )
     }
 //    return 0;
 }
+
+bool EepromMcuIsBusy( void )
+{
+    return false;
+}
@@ -133,6 +133,16 @@ uint32_t RtcMs2Tick( TimerTime_t milliseconds )
     return ( uint32_t )( milliseconds );
 }
 
+uint32_t RtcUs2Tick( uint32_t microseconds )
+{
+    return ( uint32_t )( microseconds / 1000 );
+}
+
+uint32_t RtcTick2Us( uint32_t tick )
+{
+    return ( uint32_t )( tick * 1000 );
+}
+
 TimerTime_t RtcTick2Ms( uint32_t tick )
 {
     uint32_t seconds = tick >> 10;
@@ -25,10 +25,36 @@
 #include <peripheral_clk_config.h>
 #include <hal_spi_m_sync.h>
 #include <hal_gpio.h>
+#include "utilities.h"
 #include "spi-board.h"
 
+/*!
+ * Transfers shorter than this size are done by SpiInOut calls
+ */
+#define SPI_BURST_MIN_TRANSFER_SIZE                 8
+
+/*!
+ * Maximum number of bytes written and not read back yet. The SERCOM holds one
+ * byte in the shift register and one in the transmit buffer.
+ */
+#define SPI_BURST_MAX_PENDING                       2
+
 struct spi_m_sync_descriptor Spi0;
 
+/*!
+ * Ongoing burst transfer. The SAML21 DMAC has no trigger for SERCOM5, the
+ * bursts are done by the SERCOM interrupts instead.
+ */
+static struct
+{
+    Spi_t *Obj;
+    const uint8_t *TxBuffer;
+    uint8_t *RxBuffer;
+    uint16_t Size;
+    uint16_t TxCount;
+    uint16_t RxCount;
+}SpiBurst;
+
 void SpiInit( Spi_t *obj, SpiId_t spiId, PinNames mosi, PinNames miso, PinNames sclk, PinNames nss )
 {
     hri_gclk_write_PCHCTRL_reg( GCLK, SERCOM5_GCLK_ID_CORE, CONF_GCLK_SERCOM5_CORE_SRC | ( 1 << GCLK_PCHCTRL_CHEN_Pos ) );
@@ -64,6 +90,8 @@ void SpiInit( Spi_t *obj, SpiId_t spiId, PinNames mosi, PinNames miso, PinNames
     gpio_set_pin_function( sclk, PINMUX_PB23D_SERCOM5_PAD3 );
 
     hri_sercomspi_set_CTRLA_ENABLE_bit( SERCOM5 );
+
+    NVIC_EnableIRQ( SERCOM5_IRQn );
 }
 
 void SpiDeInit( Spi_t *obj )
@@ -98,3 +126,112 @@ uint16_t SpiInOut( Spi_t *obj, uint16_t outData )
 
     return outData;
 }
+
+/*!
+ * \brief Reads the received byte and writes the next one if the SERCOM can
+ *        take it
+ *
+ * \remark Called by polling or from the SERCOM5 interrupt
+ */
+static void SpiBurstStep( void )
+{
+    uint8_t flags = hri_sercomspi_read_INTFLAG_reg( SERCOM5 );
+
+    if( ( flags & SERCOM_SPI_INTFLAG_RXC ) != 0 )
+    {
+        uint8_t data = ( uint8_t )hri_sercomspi_read_DATA_reg( SERCOM5 );
+
+        if( SpiBurst.RxBuffer != NULL )
+        {
+            SpiBurst.RxBuffer[SpiBurst.RxCount] = data;
+        }
+        SpiBurst.RxCount++;
+    }
+    // The next byte is written while the previous one is being shifted out
+    if( ( ( flags & SERCOM_SPI_INTFLAG_DRE ) != 0 ) && ( SpiBurst.TxCount < SpiBurst.Size ) &&
+        ( ( SpiBurst.TxCount - SpiBurst.RxCount ) < SPI_BURST_MAX_PENDING ) )
+    {
+        hri_sercomspi_write_DATA_reg( SERCOM5, ( SpiBurst.TxBuffer != NULL ) ? SpiBurst.TxBuffer[SpiBurst.TxCount] : 0x00 );
+        SpiBurst.TxCount++;
+    }
+}
+
+void SpiTransfer( Spi_t *obj, const uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size )
+{
+    if( size == 0 )
+    {
+        if( obj->TransferDone != NULL )
+        {
+            obj->TransferDone( obj->Context );
+        }
+        return;
+    }
+
+    if( ( size < SPI_BURST_MIN_TRANSFER_SIZE ) && ( obj->TransferDone == NULL ) )
+    {
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            uint8_t data = SpiInOut( obj, ( txBuffer != NULL ) ? txBuffer[i] : 0x00 );
+
+            if( rxBuffer != NULL )
+            {
+                rxBuffer[i] = data;
+            }
+        }
+        return;
+    }
+
+    SpiBurst.Obj = obj;
+    SpiBurst.TxBuffer = txBuffer;
+    SpiBurst.RxBuffer = rxBuffer;
+    SpiBurst.Size = size;
+    SpiBurst.TxCount = 0;
+    SpiBurst.RxCount = 0;
+
+    if( obj->TransferDone != NULL )
+    {
+        // Completed by SERCOM5_Handler, the callback is called from the
+        // interrupt
+        hri_sercomspi_set_INTEN_reg( SERCOM5, SERCOM_SPI_INTENSET_DRE | SERCOM_SPI_INTENSET_RXC );
+        return;
+    }
+
+    while( SpiBurst.RxCount < SpiBurst.Size )
+    {
+        SpiBurstStep( );
+    }
+    SpiBurst.Obj = NULL;
+}
+
+void SpiSetTransferCallback( Spi_t *obj, SpiTransferCallback *callback, void* context )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    obj->TransferDone = callback;
+    obj->Context = context;
+
+    CRITICAL_SECTION_END( );
+}
+
+void SERCOM5_Handler( void )
+{
+    Spi_t *obj = SpiBurst.Obj;
+
+    SpiBurstStep( );
+
+    if( SpiBurst.TxCount == SpiBurst.Size )
+    {
+        // DRE stays set once the last byte is written
+        hri_sercomspi_clear_INTEN_reg( SERCOM5, SERCOM_SPI_INTENSET_DRE );
+    }
+    if( SpiBurst.RxCount == SpiBurst.Size )
+    {
+        hri_sercomspi_clear_INTEN_reg( SERCOM5, SERCOM_SPI_INTENSET_RXC );
+
+        SpiBurst.Obj = NULL;
+        if( ( obj != NULL ) && ( obj->TransferDone != NULL ) )
+        {
+            obj->TransferDone( obj->Context );
+        }
+    }
+}
@@ -46,7 +46,7 @@ static bool RadioIsActive = false;
 /*!
  * Radio driver structure initialization
  */
-const struct Radio_s Radio =
+const struct Radio_s SX1276Radio =
 {
     SX1276Init,
     SX1276GetStatus,
@@ -73,8 +73,13 @@ const struct Radio_s Radio =
     SX1276SetPublicNetwork,
     SX1276GetWakeupTime,
     NULL, // void ( *IrqProcess )( void )
+    NULL, // bool ( *IsIrqPending )( void )
+    SX1276GetStats,
+    SX1276ResetStats,
+    NULL, // bool ( *IsCommandPending )( void )
     NULL, // void ( *RxBoosted )( uint32_t timeout ) - SX126x Only
     NULL, // void ( *SetRxDutyCycle )( uint32_t rxTime, uint32_t sleepTime ) - SX126x Only
+    SX1276SetHopTable,
 };
 
 /*!
@@ -50,6 +50,13 @@
 #define USE_POTENTIOMETER                           1
 
 
+/*!
+ * NVIC priority masked by the critical sections, along with the lower ones.
+ * Priority 0 is left to the interrupts which never enter the stack (SysTick,
+ * PVD, FLASH), they stay enabled during the critical sections.
+ */
+#define BOARD_CRITICAL_SECTION_PRIORITY             1
+
 /*!
  * Board MCU pins definitions
  */
@@ -115,13 +115,14 @@ static void OnCalibrateSystemWakeupTimeTimerEvent( void* context )
 
 void BoardCriticalSectionBegin( uint32_t *mask )
 {
-    *mask = __get_PRIMASK( );
-    __disable_irq( );
+    // Only masks the interrupts which may enter the stack
+    *mask = __get_BASEPRI( );
+    __set_BASEPRI_MAX( BOARD_CRITICAL_SECTION_PRIORITY << ( 8 - __NVIC_PRIO_BITS ) );
 }
 
 void BoardCriticalSectionEnd( uint32_t *mask )
 {
-    __set_PRIMASK( *mask );
+    __set_BASEPRI( *mask );
 }
 
 void BoardInitPeriph( void )
@@ -219,6 +220,53 @@ uint32_t BoardGetRandomSeed( void )
     return ( ( *( uint32_t* )ID1 ) ^ ( *( uint32_t* )ID2 ) ^ ( *( uint32_t* )ID3 ) );
 }
 
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords )
+{
+    // No hardware generator on this MCU
+    return 0;
+}
+
+uint32_t BoardGetCycleCounter( void )
+{
+#if ( __CORTEX_M >= 3 )
+    if( ( DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk ) == 0 )
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#else
+    // No DWT cycle counter on Cortex-M0+. Count the SysTick cycles instead.
+    uint32_t tick;
+    uint32_t val;
+
+    do
+    {
+        tick = HAL_GetTick( );
+        val = SysTick->VAL;
+    }while( tick != HAL_GetTick( ) );
+    return ( tick * ( SysTick->LOAD + 1 ) ) + ( SysTick->LOAD - val );
+#endif
+}
+
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size )
+{
+    uint16_t count = 0;
+
+    // Takes what the Tx FIFO can hold, never waits for the UART
+    while( ( count < size ) && ( UartPutChar( &Uart1, buffer[count] ) == 0 ) )
+    {
+        count++;
+    }
+    return count;
+}
+
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level )
+{
+    // The MCU runs at a fixed clock
+}
+
 void BoardGetUniqueId( uint8_t *id )
 {
     id[7] = ( ( *( uint32_t* )ID1 )+ ( *( uint32_t* )ID3 ) ) >> 24;
@@ -289,15 +337,32 @@ uint8_t BoardGetPotiLevel( void )
 #define BATTERY_MIN_LEVEL                           2400 // mV
 #define BATTERY_SHUTDOWN_LEVEL                      2300 // mV
 
+/*!
+ * Number of ADC samples averaged by a battery measurement
+ */
+#define BATTERY_NB_SAMPLES                          16
+
 static uint16_t BatteryVoltage = BATTERY_MAX_LEVEL;
 
-uint16_t BoardBatteryMeasureVolage( void )
+/*!
+ * Indicates if BatteryVoltage holds a measurement
+ */
+static bool BatteryMeasured = false;
+
+/*!
+ * \brief Computes the supply voltage from the VREFINT conversion result
+ *
+ * \param [IN] vref VREFINT ADC value
+ * \retval batteryVoltage Battery voltage [mV]
+ */
+static uint16_t BoardBatteryVoltageFromAdc( uint16_t vref )
 {
-    uint16_t vref = 0;
     uint32_t batteryVoltage = 0;
 
-    // Read the current Voltage
-    vref = AdcReadChannel( &Adc , ADC_CHANNEL_17 );
+    if( vref == 0 )
+    {
+        return 0;
+    }
 
     // We don't use the VREF from calibValues here.
     // calculate the Voltage in millivolt
@@ -307,6 +372,20 @@ uint16_t BoardBatteryMeasureVolage( void )
     return batteryVoltage;
 }
 
+/*!
+ * \brief Battery measurement done callback, called from the ADC interrupt
+ */
+static void OnBatteryConversionDone( void* context, uint16_t value )
+{
+    BatteryVoltage = BoardBatteryVoltageFromAdc( value );
+}
+
+uint16_t BoardBatteryMeasureVolage( void )
+{
+    // Read the current Voltage
+    return BoardBatteryVoltageFromAdc( AdcReadChannel( &Adc , ADC_CHANNEL_17 ) );
+}
+
 uint32_t BoardGetBatteryVoltage( void )
 {
     return BatteryVoltage;
@@ -316,7 +395,17 @@ uint8_t BoardGetBatteryLevel( void )
 {
     uint8_t batteryLevel = 0;
 
-    BatteryVoltage = BoardBatteryMeasureVolage( );
+    if( BatteryMeasured == false )
+    {
+        BatteryMeasured = true;
+        BatteryVoltage = BoardBatteryMeasureVolage( );
+    }
+    else
+    {
+        // The level is computed from the previous measurement, the next one
+        // runs in the background so that the caller never waits for the ADC
+        AdcStartConversion( &Adc, ADC_CHANNEL_17, BATTERY_NB_SAMPLES, OnBatteryConversionDone, NULL );
+    }
 
     if( GetBoardPowerSource( ) == USB_POWER )
     {
@@ -20,6 +20,7 @@
  *
  * \author    Gregory Cristian ( Semtech )
  */
+#include <stdbool.h>
 #include "stm32l1xx.h"
 #include "utilities.h"
 #include "eeprom-board.h"
@@ -34,17 +35,52 @@ uint8_t EepromMcuWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 
     if( HAL_FLASHEx_DATAEEPROM_Unlock( ) == HAL_OK )
     {
-        for( uint16_t i = 0; i < size; i++ )
+        uint16_t i = 0;
+
+        status = SUCCESS;
+        while( i < size )
         {
-            if( HAL_FLASHEx_DATAEEPROM_Program( FLASH_TYPEPROGRAMDATA_BYTE,
-                                                ( FLASH_EEPROM_BASE + addr + i ),
-                                                  buffer[i] ) != HAL_OK )
+            uint32_t address = FLASH_EEPROM_BASE + addr + i;
+            uint32_t typeProgram;
+            uint32_t data;
+            uint8_t length;
+            bool isUnchanged;
+
+            // A word or half-word costs a single erase and program cycle, as a
+            // byte does. Use the largest aligned access left in the buffer.
+            if( ( ( address & 0x03 ) == 0 ) && ( ( size - i ) >= 4 ) )
+            {
+                typeProgram = FLASH_TYPEPROGRAMDATA_WORD;
+                data = ( uint32_t )buffer[i] | ( ( uint32_t )buffer[i + 1] << 8 ) |
+                       ( ( uint32_t )buffer[i + 2] << 16 ) | ( ( uint32_t )buffer[i + 3] << 24 );
+                length = 4;
+                isUnchanged = ( *( volatile uint32_t* )address == data );
+            }
+            else if( ( ( address & 0x01 ) == 0 ) && ( ( size - i ) >= 2 ) )
+            {
+                typeProgram = FLASH_TYPEPROGRAMDATA_HALFWORD;
+                data = ( uint32_t )buffer[i] | ( ( uint32_t )buffer[i + 1] << 8 );
+                length = 2;
+                isUnchanged = ( *( volatile uint16_t* )address == data );
+            }
+            else
+            {
+                typeProgram = FLASH_TYPEPROGRAMDATA_BYTE;
+                data = buffer[i];
+                length = 1;
+                isUnchanged = ( *( volatile uint8_t* )address == data );
+            }
+
+            // Unchanged data is not written again
+            if( ( isUnchanged == false ) &&
+                ( HAL_FLASHEx_DATAEEPROM_Program( typeProgram, address, data ) != HAL_OK ) )
             {
                 // Failed to write EEPROM
+                status = FAIL;
                 break;
             }
+            i += length;
         }
-        status = SUCCESS;
     }
 
     HAL_FLASHEx_DATAEEPROM_Lock( );
@@ -71,3 +107,8 @@ uint8_t EepromMcuGetDeviceAddr( void )
     assert_param( FAIL );
     return 0;
 }
+
+bool EepromMcuIsBusy( void )
+{
+    return false;
+}
@@ -0,0 +1,96 @@
+/*!
+ * \file      aes-board.c
+ *
+ * \brief     Target board AES hardware accelerator driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "stm32l0xx.h"
+#include "utilities.h"
+#include "aes-board.h"
+
+/*!
+ * \brief Reads a big endian 32 bits word
+ */
+static uint32_t AesMcuGetWord( const uint8_t *buffer )
+{
+    return ( ( uint32_t )buffer[0] << 24 ) | ( ( uint32_t )buffer[1] << 16 ) |
+           ( ( uint32_t )buffer[2] << 8 ) | ( uint32_t )buffer[3];
+}
+
+/*!
+ * \brief Writes a big endian 32 bits word
+ */
+static void AesMcuPutWord( uint8_t *buffer, uint32_t word )
+{
+    buffer[0] = ( uint8_t )( word >> 24 );
+    buffer[1] = ( uint8_t )( word >> 16 );
+    buffer[2] = ( uint8_t )( word >> 8 );
+    buffer[3] = ( uint8_t )word;
+}
+
+void AesMcuInit( void )
+{
+    // The HAL does not provide the AES clock macros for the STM32L081
+    SET_BIT( RCC->AHBENR, RCC_AHBENR_CRYPEN );
+
+    // ECB encryption, 32 bits data type. The blocks are converted to big
+    // endian words by the driver.
+    AES->CR = 0;
+}
+
+void AesMcuDeInit( void )
+{
+    AES->CR = 0;
+
+    CLEAR_BIT( RCC->AHBENR, RCC_AHBENR_CRYPEN );
+}
+
+void AesMcuSetKey( const uint8_t key[AES_MCU_BLOCK_SIZE] )
+{
+    // The key registers can only be written while the peripheral is disabled
+    AES->CR &= ~AES_CR_EN;
+
+    AES->KEYR3 = AesMcuGetWord( &key[0] );
+    AES->KEYR2 = AesMcuGetWord( &key[4] );
+    AES->KEYR1 = AesMcuGetWord( &key[8] );
+    AES->KEYR0 = AesMcuGetWord( &key[12] );
+
+    AES->CR |= AES_CR_EN;
+}
+
+void AesMcuEncrypt( const uint8_t in[AES_MCU_BLOCK_SIZE], uint8_t out[AES_MCU_BLOCK_SIZE] )
+{
+    AES->DINR = AesMcuGetWord( &in[0] );
+    AES->DINR = AesMcuGetWord( &in[4] );
+    AES->DINR = AesMcuGetWord( &in[8] );
+    AES->DINR = AesMcuGetWord( &in[12] );
+
+    // A block takes about 200 AHB clock cycles. Busy waiting is cheaper than
+    // switching to a DMA transfer or an interrupt for a single block.
+    while( ( AES->SR & AES_SR_CCF ) == 0 )
+    {
+    }
+
+    AesMcuPutWord( &out[0], AES->DOUTR );
+    AesMcuPutWord( &out[4], AES->DOUTR );
+    AesMcuPutWord( &out[8], AES->DOUTR );
+    AesMcuPutWord( &out[12], AES->DOUTR );
+
+    AES->CR |= AES_CR_CCFC;
+}
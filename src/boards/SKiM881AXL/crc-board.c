@@ -0,0 +1,104 @@
+/*!
+ * \file      crc-board.c
+ *
+ * \brief     Target board CRC calculation unit driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "stm32l0xx.h"
+#include "utilities.h"
+#include "crc-board.h"
+
+/*!
+ * Configuration of the CRC unit, which is shared with the EEPROM emulation
+ */
+typedef struct sCrcMcuConfig
+{
+    uint32_t Pol;
+    uint32_t Init;
+    uint32_t Cr;
+}CrcMcuConfig_t;
+
+/*!
+ * \brief Enables the CRC unit and saves its configuration
+ *
+ * \param [OUT] config Saved configuration
+ */
+static void CrcMcuSave( CrcMcuConfig_t *config )
+{
+    __HAL_RCC_CRC_CLK_ENABLE( );
+
+    config->Pol = CRC->POL;
+    config->Init = CRC->INIT;
+    config->Cr = CRC->CR;
+}
+
+/*!
+ * \brief Restores the CRC unit configuration
+ *
+ * \param [IN] config Saved configuration
+ */
+static void CrcMcuRestore( const CrcMcuConfig_t *config )
+{
+    CRC->POL = config->Pol;
+    CRC->INIT = config->Init;
+    CRC->CR = config->Cr;
+}
+
+bool CrcMcuUpdate16( uint16_t *crc, const uint8_t *buffer, uint32_t size )
+{
+    CrcMcuConfig_t config;
+
+    CrcMcuSave( &config );
+
+    // 16 bits polynomial, the CRC resumes from the given value
+    CRC->POL = 0x1021;
+    CRC->INIT = *crc;
+    CRC->CR = CRC_CR_POLYSIZE_0 | CRC_CR_RESET;
+    for( uint32_t i = 0; i < size; i++ )
+    {
+        // Byte access, one byte is processed per write
+        *( __IO uint8_t* )&CRC->DR = buffer[i];
+    }
+    *crc = ( uint16_t )CRC->DR;
+
+    CrcMcuRestore( &config );
+    return true;
+}
+
+bool CrcMcuUpdate32( uint32_t *crc, const uint8_t *buffer, uint32_t size )
+{
+    CrcMcuConfig_t config;
+
+    CrcMcuSave( &config );
+
+    // 32 bits polynomial, input bits reversed by byte and output reversed,
+    // which gives the register of the software implementations. The unit
+    // register itself is the bit reversed value.
+    CRC->POL = 0x04C11DB7;
+    CRC->INIT = __RBIT( *crc );
+    CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT | CRC_CR_RESET;
+    for( uint32_t i = 0; i < size; i++ )
+    {
+        *( __IO uint8_t* )&CRC->DR = buffer[i];
+    }
+    *crc = CRC->DR;
+
+    CrcMcuRestore( &config );
+    return true;
+}
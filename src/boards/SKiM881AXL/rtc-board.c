@@ -22,7 +22,6 @@
  *
  * \author    MCD Application Team (C)( STMicroelectronics International )
  */
-#include <math.h>
 #include <time.h>
 #include "stm32l0xx.h"
 #include "utilities.h"
@@ -37,6 +36,9 @@
 // MCU Wake Up Time
 #define MIN_ALARM_DELAY                             3 // in ticks
 
+// Minimum delay entering the low power mode
+#define RTC_DELAY_LOW_POWER_MIN                     5 // in ms
+
 // sub-second number of bits
 #define N_PREDIV_S                                  10
 
@@ -89,11 +91,29 @@ typedef struct
     RTC_DateTypeDef CalendarDate; // Reference date in calendar format
 }RtcTimerContext_t;
 
+/*!
+ * Clock source drift in ppb from RTC_TEMP_TABLE_MIN, by steps of
+ * RTC_TEMP_TABLE_STEP degrees. Precomputed from the RTC_TEMP_xxx coefficients.
+ */
+static const int32_t RtcTempPpbTable[RTC_TEMP_TABLE_SIZE] =
+{
+    -138600, -116463,  -96250,  -77963,  -61600,  -47163,  -34650,  -24063,
+     -15400,   -8663,   -3850,    -963,       0,    -963,   -3850,   -8663,
+     -15400,  -24063,  -34650,  -47163,  -61600,  -77963,  -96250, -116463,
+    -138600, -162663
+};
+
 /*!
  * \brief Indicates if the RTC is already Initialized or not
  */
 static bool RtcInitialized = false;
 
+/*!
+ * \brief Timer and end flag of the RtcDelayMs low power delays
+ */
+static TimerEvent_t RtcDelayTimer;
+static volatile bool RtcDelayElapsed = false;
+
 /*!
  * \brief Indicates if the RTC Wake Up Time is calibrated or not
  */
@@ -104,6 +124,21 @@ static bool McuWakeUpTimeInitialized = false;
  */
 static int16_t McuWakeUpTimeCal = 0;
 
+/*!
+ * \brief Alarm timeout requested by RtcSetAlarm, relative to the timer context
+ */
+static uint32_t RtcAlarmTimeout = 0;
+
+/*!
+ * \brief Indicates if the alarm requested by RtcSetAlarm is running
+ */
+static bool RtcAlarmRunning = false;
+
+/*!
+ * \brief Indicates if the running alarm anticipates the stop mode wake up time
+ */
+static bool RtcAlarmCompensated = false;
+
 /*!
  * Number of days in each month on a normal year
  */
@@ -139,6 +174,21 @@ static RTC_HandleTypeDef RtcHandle =
  */
 static RTC_AlarmTypeDef RtcAlarm;
 
+/*!
+ * Start of the current day, lets the timer value be computed from the time
+ * registers alone while the date doesn't change
+ */
+typedef struct
+{
+    uint32_t DateReg;             // Date register value of the cached day, 0 when empty
+    uint32_t Seconds;             // Seconds elapsed from 01/01/2000 to the start of the day
+}RtcDayCache_t;
+
+/*!
+ * Start of the current day cache
+ */
+static RtcDayCache_t RtcDayCache;
+
 /*!
  * Keep the value of the RTC timer when the RTC alarm is set
  * Set with the \ref RtcSetTimerContext function
@@ -155,6 +205,25 @@ static RtcTimerContext_t RtcTimerContext;
  */
 static uint64_t RtcGetCalendarValue( RTC_DateTypeDef* date, RTC_TimeTypeDef* time );
 
+/*!
+ * \brief Get the current time from the RTC registers in ticks
+ *
+ * \remark Unlike \ref RtcGetCalendarValue, the date is only decoded when it
+ *         changes. The timer value doesn't need the calendar structures.
+ *
+ * \retval timerValue Time in ticks
+ */
+static uint32_t RtcGetTimerTicks( void );
+
+/*!
+ * \brief Get the number of seconds elapsed from 01/01/2000 to the start of the
+ *        date
+ *
+ * \param [IN] date           Pointer to RTC_DateStruct
+ * \retval seconds Seconds at the start of the day
+ */
+static uint32_t RtcGetDaySeconds( RTC_DateTypeDef* date );
+
 void RtcInit( void )
 {
     RTC_DateTypeDef date;
@@ -247,6 +316,28 @@ uint32_t RtcMs2Tick( uint32_t milliseconds )
     return ( uint32_t )( ( ( ( uint64_t )milliseconds ) * CONV_DENOM ) / CONV_NUMER );
 }
 
+/*!
+ * \brief converts time in us to time in ticks
+ *
+ * \param[IN] microseconds Time in microseconds
+ * \retval returns time in timer ticks, rounded down
+ */
+uint32_t RtcUs2Tick( uint32_t microseconds )
+{
+    return ( uint32_t )( ( ( ( uint64_t )microseconds ) * CONV_DENOM ) / ( CONV_NUMER * 1000 ) );
+}
+
+/*!
+ * \brief converts time in ticks to time in us
+ *
+ * \param[IN] tick Time in timer ticks
+ * \retval returns time in microseconds, rounded down
+ */
+uint32_t RtcTick2Us( uint32_t tick )
+{
+    return ( uint32_t )( ( ( ( uint64_t )tick ) * CONV_NUMER * 1000 ) / CONV_DENOM );
+}
+
 /*!
  * \brief converts time in ticks to time in ms
  *
@@ -262,21 +353,44 @@ uint32_t RtcTick2Ms( uint32_t tick )
 }
 
 /*!
- * \brief a delay of delay ms by polling RTC
+ * \brief Delay timer callback
+ */
+static void OnRtcDelayTimerEvent( void* context )
+{
+    RtcDelayElapsed = true;
+}
+
+/*!
+ * \brief a delay of delay ms. The MCU enters the low power mode until the
+ *        end of the delay, the short delays busy wait on the SysTick
  *
  * \param[IN] delay in ms
  */
 void RtcDelayMs( uint32_t delay )
 {
-    uint64_t delayTicks = 0;
-    uint64_t refTicks = RtcGetTimerValue( );
+    // The RTC alarm can't be serviced from an interrupt handler or a
+    // critical section
+    if( ( RtcInitialized == false ) || ( delay < RTC_DELAY_LOW_POWER_MIN ) ||
+        ( __get_IPSR( ) != 0 ) || ( __get_PRIMASK( ) != 0 ) )
+    {
+        HAL_Delay( delay );
+        return;
+    }
 
-    delayTicks = RtcMs2Tick( delay );
+    RtcDelayElapsed = false;
+    TimerInit( &RtcDelayTimer, OnRtcDelayTimerEvent );
+    // One more tick as the conversion rounds down
+    TimerStartTicks( &RtcDelayTimer, RtcMs2Tick( delay ) + 1 );
 
-    // Wait delay ms
-    while( ( ( RtcGetTimerValue( ) - refTicks ) ) < delayTicks )
+    while( RtcDelayElapsed == false )
     {
-        __NOP( );
+        __disable_irq( );
+        // Other interrupts may wake up the MCU before the end of the delay
+        if( RtcDelayElapsed == false )
+        {
+            LpmEnterLowPower( );
+        }
+        __enable_irq( );
     }
 }
 
@@ -299,17 +413,65 @@ void RtcSetAlarm( uint32_t timeout )
         LpmSetStopMode( LPM_RTC_ID, LPM_DISABLE );
     }
 
+    RtcAlarmTimeout = timeout;
+    RtcAlarmCompensated = false;
+
     // In case stop mode is required
     if( LpmGetMode( ) == LPM_STOP_MODE )
     {
         timeout = timeout - McuWakeUpTimeCal;
+        RtcAlarmCompensated = true;
     }
 
     RtcStartAlarm( timeout );
+    RtcAlarmRunning = true;
+}
+
+uint32_t RtcGetAlarmRemainingTicks( void )
+{
+    uint32_t elapsed = 0;
+
+    if( RtcAlarmRunning == false )
+    {
+        return RTC_ALARM_NOT_RUNNING;
+    }
+
+    elapsed = RtcGetTimerElapsedTime( );
+    if( elapsed >= RtcAlarmTimeout )
+    {
+        return 0;
+    }
+    return RtcAlarmTimeout - elapsed;
+}
+
+void RtcSetAlarmWakeUpCompensation( bool enable )
+{
+    if( ( RtcAlarmRunning == false ) || ( RtcAlarmCompensated == enable ) )
+    {
+        return;
+    }
+
+    if( enable == true )
+    {
+        // Too late to anticipate the wake up
+        if( RtcGetAlarmRemainingTicks( ) <= ( uint32_t )( MIN_ALARM_DELAY + McuWakeUpTimeCal ) )
+        {
+            return;
+        }
+        RtcStartAlarm( RtcAlarmTimeout - McuWakeUpTimeCal );
+    }
+    else
+    {
+        RtcStartAlarm( RtcAlarmTimeout );
+    }
+    RtcAlarmCompensated = enable;
+    RtcAlarmRunning = true;
 }
 
 void RtcStopAlarm( void )
 {
+    RtcAlarmRunning = false;
+
     // Disable the Alarm A interrupt
     HAL_RTC_DeactivateAlarm( &RtcHandle, RTC_ALARM_A );
 
@@ -425,22 +587,12 @@ void RtcStartAlarm( uint32_t timeout )
 
 uint32_t RtcGetTimerValue( void )
 {
-    RTC_TimeTypeDef time;
-    RTC_DateTypeDef date;
-
-    uint32_t calendarValue = ( uint32_t )RtcGetCalendarValue( &date, &time );
-
-    return( calendarValue );
+    return RtcGetTimerTicks( );
 }
 
 uint32_t RtcGetTimerElapsedTime( void )
 {
-  RTC_TimeTypeDef time;
-  RTC_DateTypeDef date;
-  
-  uint32_t calendarValue = ( uint32_t )RtcGetCalendarValue( &date, &time );
-
-  return( ( uint32_t )( calendarValue - RtcTimerContext.Time ) );
+    return( ( uint32_t )( RtcGetTimerTicks( ) - RtcTimerContext.Time ) );
 }
 
 void RtcSetMcuWakeUpTime( void )
@@ -482,7 +634,6 @@ static uint64_t RtcGetCalendarValue( RTC_DateTypeDef* date, RTC_TimeTypeDef* tim
 {
     uint64_t calendarValue = 0;
     uint32_t firstRead;
-    uint32_t correction;
     uint32_t seconds;
 
     // Make sure it is correct due to asynchronus nature of RTC
@@ -493,6 +644,66 @@ static uint64_t RtcGetCalendarValue( RTC_DateTypeDef* date, RTC_TimeTypeDef* tim
         HAL_RTC_GetTime( &RtcHandle, time, RTC_FORMAT_BIN );
     }while( firstRead != RTC->SSR );
 
+    seconds = RtcGetDaySeconds( date );
+
+    seconds += ( ( uint32_t )time->Seconds + 
+                 ( ( uint32_t )time->Minutes * SECONDS_IN_1MINUTE ) +
+                 ( ( uint32_t )time->Hours * SECONDS_IN_1HOUR ) ) ;
+
+    calendarValue = ( ( ( uint64_t )seconds ) << N_PREDIV_S ) + ( PREDIV_S - time->SubSeconds );
+
+    return( calendarValue );
+}
+
+static uint32_t RtcGetTimerTicks( void )
+{
+    RTC_DateTypeDef date;
+    uint32_t firstRead;
+    uint32_t timeReg;
+    uint32_t dateReg;
+    uint32_t seconds;
+
+    // Make sure it is correct due to asynchronus nature of RTC
+    do
+    {
+        firstRead = RTC->SSR;
+        timeReg = RTC->TR;
+        dateReg = RTC->DR;
+    }while( firstRead != RTC->SSR );
+
+    // The week day doesn't matter
+    dateReg &= RTC_DR_YT | RTC_DR_YU | RTC_DR_MT | RTC_DR_MU | RTC_DR_DT | RTC_DR_DU;
+
+    if( dateReg != RtcDayCache.DateReg )
+    {
+        date.Year = RTC_Bcd2ToByte( ( uint8_t )( ( dateReg & ( RTC_DR_YT | RTC_DR_YU ) ) >> RTC_DR_YU_Pos ) );
+        date.Month = RTC_Bcd2ToByte( ( uint8_t )( ( dateReg & ( RTC_DR_MT | RTC_DR_MU ) ) >> RTC_DR_MU_Pos ) );
+        date.Date = RTC_Bcd2ToByte( ( uint8_t )( ( dateReg & ( RTC_DR_DT | RTC_DR_DU ) ) >> RTC_DR_DU_Pos ) );
+        seconds = RtcGetDaySeconds( &date );
+
+        CRITICAL_SECTION_BEGIN( );
+        RtcDayCache.Seconds = seconds;
+        RtcDayCache.DateReg = dateReg;
+        CRITICAL_SECTION_END( );
+    }
+    else
+    {
+        seconds = RtcDayCache.Seconds;
+    }
+
+    // Time of the day, 24 hours format
+    seconds += ( ( ( timeReg & RTC_TR_HT ) >> RTC_TR_HT_Pos ) * 10 + ( ( timeReg & RTC_TR_HU ) >> RTC_TR_HU_Pos ) ) * SECONDS_IN_1HOUR;
+    seconds += ( ( ( timeReg & RTC_TR_MNT ) >> RTC_TR_MNT_Pos ) * 10 + ( ( timeReg & RTC_TR_MNU ) >> RTC_TR_MNU_Pos ) ) * SECONDS_IN_1MINUTE;
+    seconds += ( ( ( timeReg & RTC_TR_ST ) >> RTC_TR_ST_Pos ) * 10 + ( ( timeReg & RTC_TR_SU ) >> RTC_TR_SU_Pos ) );
+
+    return ( seconds << N_PREDIV_S ) + ( PREDIV_S - ( firstRead & RTC_SSR_SS ) );
+}
+
+static uint32_t RtcGetDaySeconds( RTC_DateTypeDef* date )
+{
+    uint32_t correction;
+    uint32_t seconds;
+
     // Calculte amount of elapsed days since 01/01/2000
     seconds = DIVC( ( DAYS_IN_YEAR * 3 + DAYS_IN_LEAP_YEAR ) * date->Year , 4 );
 
@@ -503,15 +714,7 @@ static uint64_t RtcGetCalendarValue( RTC_DateTypeDef* date, RTC_TimeTypeDef* tim
     seconds += ( date->Date -1 );
 
     // Convert from days to seconds
-    seconds *= SECONDS_IN_1DAY;
-
-    seconds += ( ( uint32_t )time->Seconds + 
-                 ( ( uint32_t )time->Minutes * SECONDS_IN_1MINUTE ) +
-                 ( ( uint32_t )time->Hours * SECONDS_IN_1HOUR ) ) ;
-
-    calendarValue = ( ( ( uint64_t )seconds ) << N_PREDIV_S ) + ( PREDIV_S - time->SubSeconds );
-
-    return( calendarValue );
+    return seconds * SECONDS_IN_1DAY;
 }
 
 uint32_t RtcGetCalendarTime( uint16_t *milliseconds )
@@ -565,6 +768,7 @@ void RTC_IRQHandler( void )
  */
 void HAL_RTC_AlarmAEventCallback( RTC_HandleTypeDef *hrtc )
 {
+    RtcAlarmRunning = false;
     TimerIrqHandler( );
 }
 
@@ -587,35 +791,46 @@ void RtcProcess( void )
 
 TimerTime_t RtcTempCompensation( TimerTime_t period, float temperature )
 {
-    float k = RTC_TEMP_COEFFICIENT;
-    float kDev = RTC_TEMP_DEV_COEFFICIENT;
-    float t = RTC_TEMP_TURNOVER;
-    float tDev = RTC_TEMP_DEV_TURNOVER;
-    float interim = 0.0;
-    float ppm = 0.0;
-
-    if( k < 0.0 )
+    int32_t t = ( int32_t )( temperature * 100 ) - ( RTC_TEMP_TABLE_MIN * 100 );
+    int32_t index = 0;
+    int32_t ppb = 0;
+    int64_t drift = 0;
+
+    // Interpolate the drift between the table entries, the temperature is
+    // clamped to the table range
+    if( t <= 0 )
     {
-        ppm = ( k - kDev );
+        ppb = RtcTempPpbTable[0];
     }
     else
     {
-        ppm = ( k + kDev );
+        index = t / ( RTC_TEMP_TABLE_STEP * 100 );
+        if( index >= ( RTC_TEMP_TABLE_SIZE - 1 ) )
+        {
+            ppb = RtcTempPpbTable[RTC_TEMP_TABLE_SIZE - 1];
+        }
+        else
+        {
+            ppb = RtcTempPpbTable[index] + ( ( RtcTempPpbTable[index + 1] - RtcTempPpbTable[index] ) *
+                                             ( t % ( RTC_TEMP_TABLE_STEP * 100 ) ) ) / ( RTC_TEMP_TABLE_STEP * 100 );
+        }
     }
-    interim = ( temperature - ( t - tDev ) );
-    ppm *=  interim * interim;
 
-    // Calculate the drift in time
-    interim = ( ( float ) period * ppm ) / 1e6;
-    // Calculate the resulting time period
-    interim += period;
-    interim = floor( interim );
-
-    if( interim < 0.0 )
+    // Calculate the drift in time, rounded down
+    drift = ( int64_t )period * ppb;
+    if( drift < 0 )
+    {
+        drift = -( ( -drift + 999999999 ) / 1000000000 );
+        if( ( uint64_t )( -drift ) > period )
+        {
+            return period;
+        }
+    }
+    else
     {
-        interim = ( float )period;
+        drift /= 1000000000;
     }
 
     // Calculate the resulting period
-    return ( TimerTime_t ) interim;
+    return ( TimerTime_t )( ( int64_t )period + drift );
 }
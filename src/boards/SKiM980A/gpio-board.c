@@ -176,11 +176,11 @@ void GpioMcuSetInterrupt( Gpio_t *obj, IrqModes irqMode, IrqPriorities irqPriori
             priority = 2;
             break;
         case IRQ_HIGH_PRIORITY:
-            priority = 1;
-            break;
         case IRQ_VERY_HIGH_PRIORITY:
         default:
-            priority = 0;
+            // The handlers enter the stack, they must be masked by the
+            // critical sections
+            priority = BOARD_CRITICAL_SECTION_PRIORITY;
             break;
         }
 
@@ -43,7 +43,7 @@ static bool RadioIsActive = false;
 /*!
  * Radio driver structure initialization
  */
-const struct Radio_s Radio =
+const struct Radio_s SX1272Radio =
 {
     SX1272Init,
     SX1272GetStatus,
@@ -70,8 +70,13 @@ const struct Radio_s Radio =
     SX1272SetPublicNetwork,
     SX1272GetWakeupTime,
     NULL, // void ( *IrqProcess )( void )
+    NULL, // bool ( *IsIrqPending )( void )
+    SX1272GetStats,
+    SX1272ResetStats,
+    NULL, // bool ( *IsCommandPending )( void )
     NULL, // void ( *RxBoosted )( uint32_t timeout ) - SX126x Only
     NULL, // void ( *SetRxDutyCycle )( uint32_t rxTime, uint32_t sleepTime ) - SX126x Only
+    SX1272SetHopTable,
 };
 
 /*!
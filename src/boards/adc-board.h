@@ -46,4 +46,16 @@ void AdcMcuConfig( void );
  */
 uint16_t AdcMcuReadChannel( Adc_t *obj, uint32_t channel );
 
+/*!
+ * \brief Starts a non-blocking conversion averaging nbSamples samples
+ *
+ * \param [IN] obj       ADC object
+ * \param [IN] channel   ADC input channel
+ * \param [IN] nbSamples Number of samples, power of 2 up to ADC_MAX_NB_SAMPLES
+ * \param [IN] callback  Conversion done callback
+ * \param [IN] context   User context given to the callback
+ * \retval status        [SUCCESS, FAIL]
+ */
+uint8_t AdcMcuStartConversion( Adc_t *obj, uint32_t channel, uint16_t nbSamples, AdcConversionCallback *callback, void* context );
+
 #endif // __ADC_BOARD_H__
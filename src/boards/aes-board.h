@@ -0,0 +1,69 @@
+/*!
+ * \file      aes-board.h
+ *
+ * \brief     Target board AES hardware accelerator driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#ifndef __AES_BOARD_H__
+#define __AES_BOARD_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*!
+ * AES block size [bytes]
+ */
+#define AES_MCU_BLOCK_SIZE                          16
+
+/*!
+ * \brief Initializes the AES hardware accelerator
+ */
+void AesMcuInit( void );
+
+/*!
+ * \brief Stops the AES hardware accelerator and its clock
+ */
+void AesMcuDeInit( void );
+
+/*!
+ * \brief Loads the 128 bits key used by the following encryptions
+ *
+ * \param [IN] key Key. The first byte is the most significant byte of the key
+ */
+void AesMcuSetKey( const uint8_t key[AES_MCU_BLOCK_SIZE] );
+
+/*!
+ * \brief Encrypts a single block in ECB mode with the current key
+ *
+ * \remark in and out may point to the same buffer
+ *
+ * \param [IN]  in  Plain text block
+ * \param [OUT] out Cipher text block
+ */
+void AesMcuEncrypt( const uint8_t in[AES_MCU_BLOCK_SIZE], uint8_t out[AES_MCU_BLOCK_SIZE] );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __AES_BOARD_H__
@@ -87,6 +87,67 @@ uint8_t BoardGetBatteryLevel( void );
  */
 uint32_t BoardGetRandomSeed( void );
 
+/*!
+ * \brief Gets random words from the MCU hardware generator
+ *
+ * \remark The generator is only powered during the call.
+ *
+ * \param [OUT] buffer  Random words
+ * \param [IN]  nbWords Number of requested words
+ * \retval count        Number of words obtained. 0 if the MCU has no
+ *                      hardware generator or if it failed.
+ */
+uint8_t BoardGetTrueRandom( uint32_t* buffer, uint8_t nbWords );
+
+/*!
+ * \brief Gets the free running cycle counter value
+ *
+ * \remark The MCU cycles on the Cortex-M3/M4 boards. The other boards count
+ *         the SysTick cycles, the RTC ticks or the host nanoseconds.
+ *
+ * \retval cycles Counter value, wraps around
+ */
+uint32_t BoardGetCycleCounter( void );
+
+/*!
+ * \brief Writes to the debug UART without waiting for it
+ *
+ * \param [IN] buffer Data buffer
+ * \param [IN] size   Data buffer size
+ *
+ * \retval count      Number of bytes taken by the UART Tx FIFO
+ */
+uint16_t BoardLogWrite( uint8_t *buffer, uint16_t size );
+
+/*!
+ * MCU performance levels
+ */
+typedef enum eBoardPerformanceLevel
+{
+    /*!
+     * Clock for the waits and the peripherals handling
+     */
+    BOARD_PERFORMANCE_LEVEL_LOW,
+    /*!
+     * Clock for the compute bursts
+     */
+    BOARD_PERFORMANCE_LEVEL_HIGH,
+}BoardPerformanceLevel_t;
+
+/*!
+ * \brief Requests or releases the MCU high performance level
+ *
+ * \remark The requests nest. The MCU runs at the high performance level as
+ *         long as a BOARD_PERFORMANCE_LEVEL_HIGH request isn't released by a
+ *         BOARD_PERFORMANCE_LEVEL_LOW one. Only the NucleoL476 scales its
+ *         clock, when CLOCK_SCALING_ENABLED is defined. The other boards keep
+ *         their fixed clock.
+ *
+ * \param [IN] level BOARD_PERFORMANCE_LEVEL_HIGH to request the high level,
+ *                   BOARD_PERFORMANCE_LEVEL_LOW to release it
+ */
+void BoardSetPerformanceLevel( BoardPerformanceLevel_t level );
+
 /*!
  * \brief Gets the board 64 bits unique ID
  *
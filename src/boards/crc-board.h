@@ -0,0 +1,68 @@
+/*!
+ * \file      crc-board.h
+ *
+ * \brief     Target board CRC calculation unit driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#ifndef __CRC_BOARD_H__
+#define __CRC_BOARD_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * \brief Updates a CRC-16 CCITT: 0x1021 polynomial, MSB first
+ *
+ * \remark The CRC unit configuration is restored before returning.
+ *
+ * \param [IN/OUT] crc    CRC of the previous buffers, updated with this one
+ * \param [IN]     buffer Data buffer
+ * \param [IN]     size   Data buffer size
+ *
+ * \retval computed       Returns false if the CRC unit can't compute it,
+ *                        the CRC is then left unchanged
+ */
+bool CrcMcuUpdate16( uint16_t *crc, const uint8_t *buffer, uint32_t size );
+
+/*!
+ * \brief Updates a CRC-32 (IEEE 802.3): 0x04C11DB7 polynomial, reflected
+ *        input and output
+ *
+ * \remark The CRC unit configuration is restored before returning.
+ *
+ * \param [IN/OUT] crc    Register value of the previous buffers, before the
+ *                        final XOR, updated with this one
+ * \param [IN]     buffer Data buffer
+ * \param [IN]     size   Data buffer size
+ *
+ * \retval computed       Returns false if the CRC unit can't compute it,
+ *                        the CRC is then left unchanged
+ */
+bool CrcMcuUpdate32( uint32_t *crc, const uint8_t *buffer, uint32_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CRC_BOARD_H__
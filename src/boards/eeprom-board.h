@@ -24,6 +24,7 @@
 #define __EEPROM_BOARD_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /*!
  * Writes the given buffer to the EEPROM at the specified address.
@@ -63,4 +64,15 @@ void EepromMcuSetDeviceAddr( uint8_t addr );
  */
 uint8_t EepromMcuGetDeviceAddr( void );
 
+/*!
+ * Indicates if the EEPROM can't be written right now, e.g. while flash pages
+ * are erased in the background.
+ *
+ * \remark Polled by \ref EepromProcess, which skips the queued writes while
+ *         busy instead of waiting.
+ *
+ * \retval isBusy Returns true if a write would have to wait
+ */
+bool EepromMcuIsBusy( void );
+
 #endif // __EEPROM_BOARD_H__
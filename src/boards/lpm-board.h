@@ -29,6 +29,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include "board-config.h"
 
 /*!
@@ -42,8 +43,16 @@ typedef enum
     LPM_GPS_ID     =                                ( 1 << 3 ),
     LPM_UART_RX_ID =                                ( 1 << 4 ),
     LPM_UART_TX_ID =                                ( 1 << 5 ),
+    LPM_RADIO_ID   =                                ( 1 << 6 ),
+    LPM_ADC_ID     =                                ( 1 << 7 ),
 } LpmId_t;
 
+/*!
+ * Users whose Stop mode disables are ignored while waiting for a reception
+ * window. They only ask for a fast reaction, no peripheral is running.
+ */
+#define LPM_RX_WAIT_IGNORED_IDS                     ( LPM_APPLI_ID | LPM_LIB_ID | LPM_UART_RX_ID )
+
 /*!
  * Low Power Mode selected
  */
@@ -91,6 +100,16 @@ void LpmSetStopMode( LpmId_t id, LpmSetMode_t mode );
  */
 void LpmSetOffMode(LpmId_t id, LpmSetMode_t mode );
 
+/*!
+ * \brief  This API notifies the low power manager that the MAC waits for a reception window, the radio being asleep.
+ *         Until the window opens, the \ref LPM_RX_WAIT_IGNORED_IDS users Stop mode disables are ignored and the Off
+ *         mode is not entered, the timers being lost. The Stop mode is left before the window thanks to the measured
+ *         MCU wake up time.
+ *
+ * \param [IN] enable Set to true while waiting for the window
+ */
+void LpmSetRxWaitMode( bool enable );
+
 /*!
  * \brief  This API shall be used by the application when there is no more code to execute so that the system may
  *         enter low-power mode. The mode selected depends on the information received from LpmOffModeSelection( ) and
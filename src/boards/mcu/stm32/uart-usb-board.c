@@ -0,0 +1,293 @@
+/*!
+ * \file      uart-usb-board.c
+ *
+ * \brief     Target board UART over USB driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include <stdbool.h>
+#include "utilities.h"
+#include "usbd_core.h"
+#include "usbd_cdc.h"
+#include "fifo.h"
+#include "uart-usb-board.h"
+
+/*!
+ * Virtual COM port descriptors, provided by the board USB device
+ * configuration
+ */
+extern USBD_DescriptorsTypeDef VCP_Desc;
+
+/*!
+ * USB device handle
+ */
+static USBD_HandleTypeDef UsbdHandle;
+
+/*!
+ * UART object bound to the USB CDC interface
+ */
+static Uart_t *UartUsbObj = NULL;
+
+/*!
+ * Reception buffer used when the free space of the Rx FIFO wraps around the
+ * end of its buffer
+ */
+static uint8_t UartUsbRxPacket[UART_USB_PACKET_SIZE];
+
+/*!
+ * Set while the OUT endpoint isn't armed because the Rx FIFO is full. The
+ * host packets are NAKed until the application reads the FIFO.
+ */
+static volatile bool UartUsbRxPaused = false;
+
+/*!
+ * Number of Tx FIFO bytes handed to the IN endpoint
+ */
+static uint16_t UartUsbTxInFlight = 0;
+
+/*!
+ * Set when the last transfer ended with a full packet. A zero length packet
+ * then terminates the host read if no data follows.
+ */
+static bool UartUsbTxZlpPending = false;
+
+/*!
+ * Number of start of frames the partial packet has waited for
+ */
+static uint8_t UartUsbTxWaitFrames = 0;
+
+static int8_t UartUsbCdcInit( void );
+static int8_t UartUsbCdcDeInit( void );
+static int8_t UartUsbCdcControl( uint8_t cmd, uint8_t* buffer, uint16_t length );
+static int8_t UartUsbCdcReceive( uint8_t* buffer, uint32_t *length );
+
+static USBD_CDC_ItfTypeDef UartUsbCdcItf =
+{
+    UartUsbCdcInit,
+    UartUsbCdcDeInit,
+    UartUsbCdcControl,
+    UartUsbCdcReceive
+};
+
+/*!
+ * \brief Selects the buffer the next OUT packet is received into
+ *
+ * \remark Producer side of the Rx FIFO. The packet goes straight into the
+ *         FIFO when its free block can hold it.
+ *
+ * \retval ready Returns false if the FIFO can't hold a packet
+ */
+static bool UartUsbSetRxBuffer( void )
+{
+    uint8_t *span = NULL;
+    uint16_t free = UartUsbObj->FifoRx.Size - FifoGetCount( &UartUsbObj->FifoRx );
+
+    if( free < UART_USB_PACKET_SIZE )
+    {
+        return false;
+    }
+    if( FifoFreeSpan( &UartUsbObj->FifoRx, &span ) >= UART_USB_PACKET_SIZE )
+    {
+        USBD_CDC_SetRxBuffer( &UsbdHandle, span );
+    }
+    else
+    {
+        USBD_CDC_SetRxBuffer( &UsbdHandle, UartUsbRxPacket );
+    }
+    return true;
+}
+
+void UartUsbInit( Uart_t *obj, UartId_t uartId, PinNames tx, PinNames rx )
+{
+    obj->UartId = uartId;
+    UartUsbObj = obj;
+
+    USBD_Init( &UsbdHandle, &VCP_Desc, 0 );
+    USBD_RegisterClass( &UsbdHandle, USBD_CDC_CLASS );
+    USBD_CDC_RegisterInterface( &UsbdHandle, &UartUsbCdcItf );
+    USBD_Start( &UsbdHandle );
+}
+
+void UartUsbConfig( Uart_t *obj, UartMode_t mode, uint32_t baudrate, WordLength_t wordLength, StopBits_t stopBits, Parity_t parity, FlowCtrl_t flowCtrl )
+{
+    // The line coding is meaningless over USB
+}
+
+void UartUsbDeInit( Uart_t *obj )
+{
+    USBD_Stop( &UsbdHandle );
+    USBD_DeInit( &UsbdHandle );
+    UartUsbObj = NULL;
+}
+
+uint8_t UartUsbIsUsbCableConnected( void )
+{
+    return ( UsbdHandle.dev_state == USBD_STATE_CONFIGURED ) ? 1 : 0;
+}
+
+uint8_t UartUsbPutBuffer( Uart_t *obj, uint8_t *buffer, uint16_t size )
+{
+    if( UartUsbIsUsbCableConnected( ) == 0 )
+    {
+        return 2; // Fail
+    }
+    if( ( obj->FifoTx.Size - FifoGetCount( &obj->FifoTx ) ) < size )
+    {
+        return 1; // Busy
+    }
+    FifoPushBuffer( &obj->FifoTx, buffer, size );
+    return 0; // OK
+}
+
+uint8_t UartUsbPutChar( Uart_t *obj, uint8_t data )
+{
+    return UartUsbPutBuffer( obj, &data, 1 );
+}
+
+uint8_t UartUsbGetChar( Uart_t *obj, uint8_t *data )
+{
+    if( IsFifoEmpty( &obj->FifoRx ) == true )
+    {
+        return 1; // Busy
+    }
+    *data = FifoPop( &obj->FifoRx );
+
+    if( UartUsbRxPaused == true )
+    {
+        CRITICAL_SECTION_BEGIN( );
+        if( ( UartUsbRxPaused == true ) && ( UartUsbSetRxBuffer( ) == true ) )
+        {
+            UartUsbRxPaused = false;
+            USBD_CDC_ReceivePacket( &UsbdHandle );
+        }
+        CRITICAL_SECTION_END( );
+    }
+    return 0; // OK
+}
+
+void UartUsbSofHandler( void )
+{
+    USBD_CDC_HandleTypeDef *hcdc = ( USBD_CDC_HandleTypeDef* )UsbdHandle.pClassData;
+    uint8_t *span = NULL;
+    uint16_t size = 0;
+
+    if( ( hcdc == NULL ) || ( UartUsbObj == NULL ) || ( hcdc->TxState != 0 ) )
+    {
+        return;
+    }
+
+    // The transferred data leaves the FIFO once the transfer is complete
+    if( UartUsbTxInFlight > 0 )
+    {
+        FifoSkip( &UartUsbObj->FifoTx, UartUsbTxInFlight );
+        UartUsbTxInFlight = 0;
+    }
+
+    size = FifoPeekSpan( &UartUsbObj->FifoTx, &span );
+    if( size == 0 )
+    {
+        UartUsbTxWaitFrames = 0;
+        if( UartUsbTxZlpPending == true )
+        {
+            UartUsbTxZlpPending = false;
+            USBD_CDC_SetTxBuffer( &UsbdHandle, NULL, 0 );
+            USBD_CDC_TransmitPacket( &UsbdHandle );
+        }
+        return;
+    }
+
+    if( size >= UART_USB_PACKET_SIZE )
+    {
+        // Full packets only, the remainder waits for more data
+        size = MIN( size, UART_USB_TX_MAX_TRANSFER );
+        size -= size % UART_USB_PACKET_SIZE;
+    }
+    else if( ( FifoGetCount( &UartUsbObj->FifoTx ) < UART_USB_PACKET_SIZE ) &&
+             ( ++UartUsbTxWaitFrames < UART_USB_TX_FLUSH_FRAMES ) )
+    {
+        // Give the partial packet a chance to fill up
+        return;
+    }
+    UartUsbTxWaitFrames = 0;
+    UartUsbTxZlpPending = ( size % UART_USB_PACKET_SIZE ) == 0;
+
+    // Sent straight from the FIFO buffer
+    UartUsbTxInFlight = size;
+    USBD_CDC_SetTxBuffer( &UsbdHandle, span, size );
+    USBD_CDC_TransmitPacket( &UsbdHandle );
+}
+
+static int8_t UartUsbCdcInit( void )
+{
+    if( UartUsbObj == NULL )
+    {
+        return USBD_FAIL;
+    }
+    UartUsbTxInFlight = 0;
+    UartUsbTxZlpPending = false;
+    UartUsbTxWaitFrames = 0;
+
+    // The class arms the OUT endpoint right after, a packet must fit
+    UartUsbRxPaused = false;
+    if( UartUsbSetRxBuffer( ) == false )
+    {
+        FifoFlush( &UartUsbObj->FifoRx );
+        UartUsbSetRxBuffer( );
+    }
+    return USBD_OK;
+}
+
+static int8_t UartUsbCdcDeInit( void )
+{
+    if( UartUsbObj != NULL )
+    {
+        // Drop the data of the transfer interrupted by the disconnection
+        FifoSkip( &UartUsbObj->FifoTx, UartUsbTxInFlight );
+    }
+    UartUsbTxInFlight = 0;
+    return USBD_OK;
+}
+
+static int8_t UartUsbCdcControl( uint8_t cmd, uint8_t* buffer, uint16_t length )
+{
+    // The line coding and control line state requests are accepted as is
+    return USBD_OK;
+}
+
+static int8_t UartUsbCdcReceive( uint8_t* buffer, uint32_t *length )
+{
+    if( buffer == UartUsbRxPacket )
+    {
+        FifoPushBuffer( &UartUsbObj->FifoRx, buffer, *length );
+    }
+    else
+    {
+        FifoCommit( &UartUsbObj->FifoRx, *length );
+    }
+
+    if( UartUsbSetRxBuffer( ) == true )
+    {
+        USBD_CDC_ReceivePacket( &UsbdHandle );
+    }
+    else
+    {
+        // Backpressure, the host retries until the FIFO is read
+        UartUsbRxPaused = true;
+    }
+    return USBD_OK;
+}
@@ -28,38 +28,192 @@
  * Redefinition of rand() and srand() standard C functions.
  * These functions are redefined in order to get the same behavior across
  * different compiler toolchains implementations.
+ *
+ * The generator is xoshiro128** (D. Blackman, S. Vigna). It only uses 32 bits
+ * shifts, rotations and multiplications, has a 2^128 - 1 period and passes the
+ * usual statistical test suites.
  */
 // Standard random functions redefinition start
 #define RAND_LOCAL_MAX 2147483647L
 
-static uint32_t next = 1;
+/*!
+ * Generator state. Must never be all zeros.
+ */
+static uint32_t RandState[4] = { 0x9E3779B9, 0x243F6A88, 0xB7E15162, 0x6A09E667 };
+
+static inline uint32_t RandRotl( uint32_t x, uint8_t n )
+{
+    return ( x << n ) | ( x >> ( 32 - n ) );
+}
+
+uint32_t rand32( void )
+{
+    uint32_t result = RandRotl( RandState[1] * 5, 7 ) * 9;
+    uint32_t t = RandState[1] << 9;
+
+    RandState[2] ^= RandState[0];
+    RandState[3] ^= RandState[1];
+    RandState[1] ^= RandState[2];
+    RandState[0] ^= RandState[3];
+    RandState[2] ^= t;
+    RandState[3] = RandRotl( RandState[3], 11 );
+    return result;
+}
 
 int32_t rand1( void )
 {
-    return ( ( next = next * 1103515245L + 12345L ) % RAND_LOCAL_MAX );
+    return ( int32_t )( rand32( ) >> 1 );
 }
 
 void srand1( uint32_t seed )
 {
-    next = seed;
+    // Spreads the seed over the state words with distinct multiples of the
+    // golden ratio followed by the MurmurHash3 finalizer. The finalizer being
+    // a bijection, at most one of the state words can be zero.
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        uint32_t z = seed + ( ( uint32_t )( i + 1 ) * 0x9E3779B9 );
+
+        z = ( z ^ ( z >> 16 ) ) * 0x85EBCA6B;
+        z = ( z ^ ( z >> 13 ) ) * 0xC2B2AE35;
+        RandState[i] = z ^ ( z >> 16 );
+    }
 }
 // Standard random functions redefinition end
 
 int32_t randr( int32_t min, int32_t max )
 {
-    return ( int32_t )rand1( ) % ( max - min + 1 ) + min;
+    // Lemire's multiply-shift range reduction. The division computing the
+    // rejection threshold only runs with a probability of range / 2^32.
+    uint32_t range = ( uint32_t )max - ( uint32_t )min + 1;
+    uint64_t m;
+
+    if( range == 0 )
+    {
+        // Full 32 bits range
+        return ( int32_t )rand32( );
+    }
+    m = ( uint64_t )rand32( ) * range;
+    if( ( uint32_t )m < range )
+    {
+        uint32_t threshold = ( 0 - range ) % range;
+
+        while( ( uint32_t )m < threshold )
+        {
+            m = ( uint64_t )rand32( ) * range;
+        }
+    }
+    return ( int32_t )( ( uint32_t )min + ( uint32_t )( m >> 32 ) );
 }
 
+/*!
+ * Word type used by the aligned accesses to the byte buffers. The buffers may
+ * hold objects of any type.
+ */
+#if defined( __GNUC__ )
+typedef uint32_t __attribute__( ( __may_alias__ ) ) uint32_alias_t;
+#else
+typedef uint32_t uint32_alias_t;
+#endif
+
+/*!
+ * Minimum size from which the word accesses pay off the alignment handling [bytes]
+ */
+#define UTILITIES_WORD_MIN_SIZE                     8
+
+/*!
+ * Mask of the address bits which must be cleared for a word access
+ */
+#define UTILITIES_WORD_ALIGN_MASK                   ( sizeof( uint32_t ) - 1 )
+
 void memcpy1( uint8_t *dst, const uint8_t *src, uint16_t size )
 {
-    while( size-- )
+    // The copy is always done forward and every element is loaded before being
+    // stored, which keeps the overlapping copies with dst below src working.
+    if( ( size >= UTILITIES_WORD_MIN_SIZE ) &&
+        ( ( ( ( uintptr_t )dst ^ ( uintptr_t )src ) & UTILITIES_WORD_ALIGN_MASK ) == 0 ) )
     {
-        *dst++ = *src++;
+        uint32_alias_t *dstWord;
+        const uint32_alias_t *srcWord;
+
+        while( ( ( uintptr_t )dst & UTILITIES_WORD_ALIGN_MASK ) != 0 )
+        {
+            *dst++ = *src++;
+            size--;
+        }
+        dstWord = ( uint32_alias_t* )dst;
+        srcWord = ( const uint32_alias_t* )src;
+
+        // Four words per iteration, compiled to LDM/STM pairs on Cortex-M3/M4
+        while( size >= 16 )
+        {
+            uint32_t w0 = srcWord[0];
+            uint32_t w1 = srcWord[1];
+            uint32_t w2 = srcWord[2];
+            uint32_t w3 = srcWord[3];
+
+            dstWord[0] = w0;
+            dstWord[1] = w1;
+            dstWord[2] = w2;
+            dstWord[3] = w3;
+            dstWord += 4;
+            srcWord += 4;
+            size -= 16;
+        }
+        while( size >= 4 )
+        {
+            *dstWord++ = *srcWord++;
+            size -= 4;
+        }
+        dst = ( uint8_t* )dstWord;
+        src = ( const uint8_t* )srcWord;
+    }
+    else
+    {
+        while( size >= 4 )
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = src[3];
+            dst += 4;
+            src += 4;
+            size -= 4;
+        }
+    }
+
+    switch( size )
+    {
+        case 3:
+            *dst++ = *src++;
+            // Fall through
+        case 2:
+            *dst++ = *src++;
+            // Fall through
+        case 1:
+            *dst = *src;
+            // Fall through
+        default:
+            break;
     }
 }
 
 void memcpyr( uint8_t *dst, const uint8_t *src, uint16_t size )
 {
+    if( size == 8 )
+    {
+        // EUIs
+        dst[0] = src[7];
+        dst[1] = src[6];
+        dst[2] = src[5];
+        dst[3] = src[4];
+        dst[4] = src[3];
+        dst[5] = src[2];
+        dst[6] = src[1];
+        dst[7] = src[0];
+        return;
+    }
+
     dst = dst + ( size - 1 );
     while( size-- )
     {
@@ -69,12 +223,78 @@ void memcpyr( uint8_t *dst, const uint8_t *src, uint16_t size )
 
 void memset1( uint8_t *dst, uint8_t value, uint16_t size )
 {
-    while( size-- )
+    if( size >= UTILITIES_WORD_MIN_SIZE )
+    {
+        uint32_t word = value * 0x01010101UL;
+        uint32_alias_t *dstWord;
+
+        while( ( ( uintptr_t )dst & UTILITIES_WORD_ALIGN_MASK ) != 0 )
+        {
+            *dst++ = value;
+            size--;
+        }
+        dstWord = ( uint32_alias_t* )dst;
+
+        while( size >= 16 )
+        {
+            dstWord[0] = word;
+            dstWord[1] = word;
+            dstWord[2] = word;
+            dstWord[3] = word;
+            dstWord += 4;
+            size -= 16;
+        }
+        while( size >= 4 )
+        {
+            *dstWord++ = word;
+            size -= 4;
+        }
+        dst = ( uint8_t* )dstWord;
+    }
+
+    switch( size )
     {
-        *dst++ = value;
+        case 7:
+            *dst++ = value;
+            // Fall through
+        case 6:
+            *dst++ = value;
+            // Fall through
+        case 5:
+            *dst++ = value;
+            // Fall through
+        case 4:
+            *dst++ = value;
+            // Fall through
+        case 3:
+            *dst++ = value;
+            // Fall through
+        case 2:
+            *dst++ = value;
+            // Fall through
+        case 1:
+            *dst = value;
+            // Fall through
+        default:
+            break;
     }
 }
 
+uint32_t AtomicFetchAndClear( volatile uint32_t *word )
+{
+#if defined( __GCC_ATOMIC_INT_LOCK_FREE ) && ( __GCC_ATOMIC_INT_LOCK_FREE == 2 )
+    return __atomic_exchange_n( word, 0, __ATOMIC_SEQ_CST );
+#else
+    uint32_t value;
+
+    CRITICAL_SECTION_BEGIN( );
+    value = *word;
+    *word = 0;
+    CRITICAL_SECTION_END( );
+    return value;
+#endif
+}
+
 int8_t Nibble2HexChar( uint8_t a )
 {
     if( a < 10 )
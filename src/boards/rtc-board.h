@@ -47,6 +47,27 @@
  */
 #define RTC_TEMP_DEV_TURNOVER                           ( 5.0 )
 
+/*!
+ * \brief Lowest temperature of the clock source drift table
+ */
+#define RTC_TEMP_TABLE_MIN                              ( -40 )
+
+/*!
+ * \brief Temperature step of the clock source drift table
+ */
+#define RTC_TEMP_TABLE_STEP                             ( 5 )
+
+/*!
+ * \brief Number of entries of the clock source drift table, from -40 to 85
+ *        degrees
+ */
+#define RTC_TEMP_TABLE_SIZE                             ( 26 )
+
+/*!
+ * \brief Remaining alarm time returned when no alarm is running
+ */
+#define RTC_ALARM_NOT_RUNNING                           0xFFFFFFFF
+
 /*!
  * \brief Initializes the RTC timer
  *
@@ -69,6 +90,22 @@ uint32_t RtcGetMinimumTimeout( void );
  */
 uint32_t RtcMs2Tick( TimerTime_t milliseconds );
 
+/*!
+ * \brief converts time in us to time in ticks
+ *
+ * \param[IN] microseconds Time in microseconds
+ * \retval returns time in timer ticks, rounded down
+ */
+uint32_t RtcUs2Tick( uint32_t microseconds );
+
+/*!
+ * \brief converts time in ticks to time in us
+ *
+ * \param[IN] tick Time in timer ticks
+ * \retval returns time in microseconds, rounded down
+ */
+uint32_t RtcTick2Us( uint32_t tick );
+
 /*!
  * \brief converts time in ticks to time in ms
  *
@@ -78,7 +115,10 @@ uint32_t RtcMs2Tick( TimerTime_t milliseconds );
 TimerTime_t RtcTick2Ms( uint32_t tick );
 
 /*!
- * \brief Performs a delay of milliseconds by polling RTC
+ * \brief Performs a delay of milliseconds
+ *
+ * \remark Depending on the board, the MCU enters the low power mode until
+ *         the end of the longer delays.
  *
  * \param[IN] milliseconds Delay in ms
  */
@@ -121,6 +161,25 @@ void RtcStopAlarm( void );
  */
 void RtcStartAlarm( uint32_t timeout );
 
+/*!
+ * \brief Returns the time left before the alarm set by \ref RtcSetAlarm
+ *        expires
+ *
+ * \retval remaining Remaining time in ticks, \ref RTC_ALARM_NOT_RUNNING if
+ *                   no alarm is running
+ */
+uint32_t RtcGetAlarmRemainingTicks( void );
+
+/*!
+ * \brief Moves the running alarm to anticipate the MCU wake up time, or not
+ *
+ * \remark Called by the low power manager once the low power mode is
+ *         selected. Only the STOP mode requires the compensation.
+ *
+ * \param [IN] enable Set to true to anticipate the MCU wake up time
+ */
+void RtcSetAlarmWakeUpCompensation( bool enable );
+
 /*!
  * \brief Sets the RTC timer reference
  *
@@ -182,6 +241,9 @@ void RtcProcess( void );
  * \brief Computes the temperature compensation for a period of time on a
  *        specific temperature.
  *
+ * \remark The clock source drift is interpolated from a table of
+ *         RTC_TEMP_TABLE_SIZE entries in ppb, which each board may calibrate.
+ *
  * \param [IN] period Time period to compensate in milliseconds
  * \param [IN] temperature Current temperature
  *
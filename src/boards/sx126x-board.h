@@ -122,6 +122,16 @@ void SX126xSetRfTxPower( int8_t power );
  */
 uint8_t SX126xGetDeviceId( void );
 
+/*!
+ * \brief Gets the board PA settings of a device
+ *
+ * \param [IN]  deviceId Device ID, see \ref SX126xGetDeviceId
+ * \param [OUT] size     Number of settings
+ *
+ * \retval settings      PA settings sorted by increasing output power
+ */
+const SX126xPaSetting_t* SX126xGetBoardPaSettings( uint8_t deviceId, uint8_t *size );
+
 /*!
  * \brief Initializes the RF Switch I/Os pins interface
  */
@@ -19,6 +19,13 @@
  * \author    Miguel Luis ( Semtech )
  *
  * \author    Gregory Cristian ( Semtech )
+ *
+ * \remark    The data is exchanged through the UART object FIFOs, which must
+ *            hold at least a USB packet. The writes are batched into full
+ *            speed bulk packets sent straight from the Tx FIFO on the USB
+ *            start of frames, the OUT packets are received straight into the
+ *            Rx FIFO. The board USB device configuration must call
+ *            \ref UartUsbSofHandler on each start of frame.
  */
 #ifndef __UART_USB_BOARD_H__
 #define __UART_USB_BOARD_H__
@@ -26,6 +33,26 @@
 #include <stdint.h>
 #include "uart.h"
 
+/*!
+ * USB full speed bulk packet size [bytes]
+ */
+#define UART_USB_PACKET_SIZE                        64
+
+/*!
+ * Number of start of frames a partial packet waits for more data before it
+ * is sent [1 ms]
+ */
+#ifndef UART_USB_TX_FLUSH_FRAMES
+#define UART_USB_TX_FLUSH_FRAMES                    2
+#endif
+
+/*!
+ * Maximum size of a bulk IN transfer, sent as consecutive packets [bytes]
+ */
+#ifndef UART_USB_TX_MAX_TRANSFER
+#define UART_USB_TX_MAX_TRANSFER                    1024
+#endif
+
 /*!
  * \brief Initializes the UART object and MCU peripheral
  *
@@ -65,6 +92,9 @@ uint8_t UartUsbIsUsbCableConnected( void );
 /*!
  * \brief Sends a buffer to the UART
  *
+ * \remark Never waits. The buffer is queued as a whole or not at all, so that
+ *         the records streamed by the callers are not split.
+ *
  * \param [IN] obj    UART object
  * \param [IN] buffer Buffer to be sent
  * \param [IN] size   Buffer size
@@ -90,4 +120,9 @@ uint8_t UartUsbPutChar( Uart_t *obj, uint8_t data );
  */
 uint8_t UartUsbGetChar( Uart_t *obj, uint8_t *data );
 
+/*!
+ * \brief Sends the queued data. To be called on each USB start of frame.
+ */
+void UartUsbSofHandler( void );
+
 #endif // __UART_USB_BOARD_H__
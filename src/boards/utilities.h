@@ -62,6 +62,18 @@
  */
 #define POW2( n ) ( 1 << n )
 
+/*!
+ * Places a hot path function in RAM. The startup code copies it there along
+ * with the initialized data, its instructions are then fetched without the
+ * flash wait states. Only effective when RAM_FUNCTIONS_ENABLED is defined, the
+ * linker script must then place the .ramfunc sections in the data.
+ */
+#if defined( RAM_FUNCTIONS_ENABLED )
+#define LORAMAC_HOT                                 __attribute__( ( section( ".ramfunc" ) ) )
+#else
+#define LORAMAC_HOT
+#endif
+
 /*!
  * Version
  */
@@ -84,9 +96,19 @@ typedef union Version_u
  */
 void srand1( uint32_t seed );
 
+/*!
+ * \brief Computes a 32 bits random number
+ *
+ * \retval random random value in range 0..0xFFFFFFFF
+ */
+uint32_t rand32( void );
+
 /*!
  * \brief Computes a random number between min and max
  *
+ * \remark The range is reduced with a multiplication instead of a modulo, all
+ *         values are equally likely
+ *
  * \param [IN] min range minimum value
  * \param [IN] max range maximum value
  * \retval random random value in range min..max
@@ -98,6 +120,10 @@ int32_t randr( int32_t min, int32_t max );
  *
  * \remark STM32 Standard memcpy function only works on pointers that are aligned
  *
+ * \remark The copy is done a word at a time when dst and src share the same
+ *         word alignment. It is always done forward, dst may overlap src when
+ *         it is located below it.
+ *
  * \param [OUT] dst  Destination array
  * \param [IN]  src  Source array
  * \param [IN]  size Number of bytes to be copied
@@ -132,6 +158,17 @@ void memset1( uint8_t *dst, uint8_t value, uint16_t size );
  */
 int8_t Nibble2HexChar( uint8_t a );
 
+/*!
+ * \brief Reads a word and clears it in a single atomic operation
+ *
+ * \remark Uses the exclusive load and store instructions when the core has
+ *         them (Cortex-M3/M4), a critical section otherwise.
+ *
+ * \param [IN] word Word to be cleared
+ * \retval value    Value of the word before it was cleared
+ */
+uint32_t AtomicFetchAndClear( volatile uint32_t *word );
+
 /*!
  * Begins critical section
  */
@@ -31,6 +31,13 @@
  * \author    Johannes Bruder ( STACKFORCE )
  */
 #include "utilities.h"
+#include "board.h"
+#include "lpm-board.h"
+#include "trace.h"
+#include "binlog.h"
+#include "crc.h"
+#include "packet-pool.h"
+#include "entropy.h"
 #include "region/Region.h"
 #include "LoRaMacClassB.h"
 #include "LoRaMacCrypto.h"
@@ -38,11 +45,13 @@
 #include "LoRaMacTest.h"
 #include "LoRaMacTypes.h"
 #include "LoRaMacConfirmQueue.h"
+#include "LoRaMacTxQueue.h"
 #include "LoRaMacHeaderTypes.h"
 #include "LoRaMacMessageTypes.h"
 #include "LoRaMacParser.h"
 #include "LoRaMacCommands.h"
 #include "LoRaMacAdr.h"
+#include "LoRaMacRetry.h"
 
 #include "LoRaMac.h"
 
@@ -51,6 +60,10 @@
  */
 #define LORAMAC_PHY_MAXPAYLOAD                      255
 
+#if defined( PACKET_POOL_ENABLED ) && ( PACKET_POOL_BLOCK_SIZE < ( LORAMAC_FRAME_HEADROOM + LORAMAC_FRAME_PAYLOAD_MAX_SIZE + LORAMAC_FRAME_TAILROOM ) )
+#error "The packet pool blocks must hold a LoRaMacMcpsReqBuffer_t"
+#endif
+
 /*!
  * Maximum MAC commands buffer size
  */
@@ -62,19 +75,25 @@
 #define LORA_MAC_COMMAND_MAX_FOPTS_LENGTH           15
 
 /*!
- * LoRaMac duty cycle for the back-off procedure during the first hour.
+ * Join requests airtime budget during the first hour [ms].
+ */
+#define BACKOFF_BUDGET_1_HOUR                       36000
+
+/*!
+ * Join requests airtime budget during the next 10 hours [ms].
  */
-#define BACKOFF_DC_1_HOUR                           100
+#define BACKOFF_BUDGET_10_HOURS                     36000
 
 /*!
- * LoRaMac duty cycle for the back-off procedure during the next 10 hours.
+ * Join requests airtime budget during each following 24 hours [ms].
  */
-#define BACKOFF_DC_10_HOURS                         1000
+#define BACKOFF_BUDGET_24_HOURS                     8700
 
 /*!
- * LoRaMac duty cycle for the back-off procedure during the next 24 hours.
+ * Lateness tolerated by the duty cycle and acknowledgement timeout timers [ms].
+ * Lets them share a wake up with the other timers.
  */
-#define BACKOFF_DC_24_HOURS                         10000
+#define LORAMAC_TIMER_SLACK                         100
 
 /*!
  * LoRaMac internal states
@@ -89,6 +108,7 @@ enum eLoRaMacState
     LORAMAC_TX_DELAYED    = 0x00000020,
     LORAMAC_TX_CONFIG     = 0x00000040,
     LORAMAC_RX_ABORT      = 0x00000080,
+    LORAMAC_LBT_CAD       = 0x00000100,
 };
 
 /*
@@ -145,7 +165,7 @@ typedef struct sLoRaMacNvmCtx
      */
     LoRaMacParams_t MacParams;
     /*
-     * Maximum duty cycle
+     * Maximum duty cycle. The aggregated duty cycle is 1 / 2^MaxDCycle.
      * \remark Possibility to shutdown the device.
      */
     uint8_t MaxDCycle;
@@ -170,10 +190,6 @@ typedef struct sLoRaMacNvmCtx
      * if the ACK bit must be set for the next transmission
      */
     bool SrvAckRequested;
-    /*
-     * Aggregated duty cycle management
-     */
-    uint16_t AggregatedDCycle;
     /*
     * Aggregated duty cycle management
     */
@@ -182,9 +198,17 @@ typedef struct sLoRaMacNvmCtx
     /*
     * Stores the time at LoRaMac initialization.
     *
-    * \remark Used for the BACKOFF_DC computation.
+    * \remark Used for the join requests back-off computation.
     */
     SysTime_t InitializationTime;
+    /*
+    * Join requests back-off window of JoinAirtime, see \ref GetJoinWindow
+    */
+    uint32_t JoinWindow;
+    /*
+    * Join requests airtime accounted in JoinWindow [ms]
+    */
+    TimerTime_t JoinAirtime;
     /*
      * Current LoRaWAN Version
      */
@@ -199,32 +223,162 @@ typedef struct sLoRaMacNvmCtx
     uint32_t LastRxMic;
 }LoRaMacNvmCtx_t;
 
+/*!
+ * Last maximum payload length lookup
+ */
+typedef struct sLoRaMacMaxPayloadLookup
+{
+    /*
+     * Datarate of the lookup. -1 if no lookup was done yet.
+     */
+    int8_t Datarate;
+    /*
+     * Dwell time setting of the lookup
+     */
+    uint8_t DwellTime;
+    /*
+     * Repeater support setting of the lookup
+     */
+    bool RepeaterSupport;
+    /*
+     * Maximum payload length
+     */
+    uint8_t MaxPayload;
+}LoRaMacMaxPayloadLookup_t;
+
+/*!
+ * Region PHY parameters used on the uplink and downlink paths.
+ *
+ * \remark The constant parameters are read once at initialization and when
+ *         the contexts are restored. The maximum payload lengths are looked up
+ *         again only if the datarate, dwell time or repeater support changed.
+ */
+typedef struct sRegionPhyParamsCache
+{
+    /*
+     * Maximum allowed downlink frame counter gap
+     */
+    uint32_t MaxFCntGap;
+    /*
+     * Minimum uplink datarate, indexed by the uplink dwell time setting
+     */
+    int8_t MinTxDr[2];
+    /*
+     * Maximum uplink datarate
+     */
+    int8_t MaxTxDr;
+    /*
+     * Last uplink maximum payload length lookup
+     */
+    LoRaMacMaxPayloadLookup_t UplinkMaxPayload;
+    /*
+     * Last downlink maximum payload length lookup
+     */
+    LoRaMacMaxPayloadLookup_t DownlinkMaxPayload;
+}RegionPhyParamsCache_t;
+
+/*!
+ * Last \ref LoRaMacQueryTxPossible payload size computation
+ *
+ * \remark The ADR strategy is only called again if its parameters changed or
+ *         if its history was updated.
+ */
+typedef struct sLoRaMacTxInfoCache
+{
+    /*
+     * Set if the entry holds a computation
+     */
+    bool IsValid;
+    /*
+     * ADR parameters of the computation
+     */
+    CalcNextAdrParams_t AdrNext;
+    /*
+     * Datarate selected by the ADR strategy
+     */
+    int8_t Datarate;
+}LoRaMacTxInfoCache_t;
+
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+/*!
+ * Class C frame waiting to be processed
+ */
+typedef struct sLoRaMacRxCQueueFrame
+{
+    /*!
+     * System time of the radio RX done interrupt
+     */
+    TimerTime_t LastRxDone;
+    /*!
+     * RTC ticks of the radio RX done interrupt edge
+     */
+    uint32_t LastRxDoneTicks;
+    /*!
+     * Frame size
+     */
+    uint16_t Size;
+    /*!
+     * Frame RSSI
+     */
+    int16_t Rssi;
+    /*!
+     * Frame SNR
+     */
+    int8_t Snr;
+    /*!
+     * Frame copied out of the radio buffer
+     */
+    uint8_t Payload[LORAMAC_PHY_MAXPAYLOAD];
+}LoRaMacRxCQueueFrame_t;
+#endif
+
 typedef struct sLoRaMacCtx
 {
     /*
     * Length of packet in PktBuffer
     */
     uint16_t PktBufferLen;
+#ifdef PACKET_POOL_ENABLED
+    /*
+    * Buffer containing the data to be sent. Allocated from the packet pool
+    * by the frames not built in place, until the MAC is idle again.
+    */
+    uint8_t* PktBuffer;
+    /*
+    * Application buffer of the on-going in place MCPS request. The MAC
+    * holds a reference to it until the MCPS-Confirm.
+    */
+    uint8_t* TxAppBuffer;
+#else
     /*
     * Buffer containing the data to be sent or received.
     */
     uint8_t PktBuffer[LORAMAC_PHY_MAXPAYLOAD];
+#endif
+    /*
+    * Start of the packet to be sent. Points to PktBuffer or into the
+    * application buffer of an in place MCPS request.
+    */
+    uint8_t* TxPkt;
     /*!
     * Current processed transmit message
     */
     LoRaMacMessage_t TxMsg;
+#if defined( LORAMAC_TX_QUEUE_ENABLED ) && !defined( PACKET_POOL_ENABLED )
     /*!
-    * Buffer containing the data received by the application.
+    * Buffer receiving the payload of the queued uplinks. The frame is built
+    * in place around it.
     */
-    uint8_t AppData[LORAMAC_PHY_MAXPAYLOAD];
+    LoRaMacMcpsReqBuffer_t TxQueueBuffer;
+#endif
     /*
     * Size of buffer containing the application data.
     */
     uint8_t AppDataSize;
     /*
-    * Buffer containing the upper layer data.
+    * Size of the MAC commands of the prepared frame.
     */
-    uint8_t RxPayload[LORAMAC_PHY_MAXPAYLOAD];
+    uint8_t TxMacCmdsSize;
     SysTime_t LastTxSysTime;
     /*
     * LoRaMac internal state
@@ -259,11 +413,22 @@ typedef struct sLoRaMacCtx
     uint32_t RxWindow1Delay;
     uint32_t RxWindow2Delay;
     /*
+    * LoRaMac reception windows delay in RTC ticks, computed with the
+    * microsecond RX window offsets
+    */
+    uint32_t RxWindow1DelayTicks;
+    uint32_t RxWindow2DelayTicks;
+    /*
     * LoRaMac Rx windows configuration
     */
     RxConfigParams_t RxWindow1Config;
     RxConfigParams_t RxWindow2Config;
     RxConfigParams_t RxWindowCConfig;
+    /*
+     * Class A window the radio has been configured for ahead of its opening,
+     * RX_SLOT_NONE when none
+     */
+    LoRaMacRxSlot_t RxWindowPrepared;
     /*
      * Limit of uplinks without any donwlink response before the ADRACKReq bit will be set.
      */
@@ -335,6 +500,216 @@ typedef struct sLoRaMacCtx
     */
     LoRaMacRequestHandling_t AllowRequests;
     /*
+    * Region PHY parameters used on the uplink and downlink paths
+    */
+    RegionPhyParamsCache_t PhyParams;
+    /*
+    * Last LoRaMacQueryTxPossible payload size computation
+    */
+    LoRaMacTxInfoCache_t TxInfoCache;
+#ifdef LORAMAC_RX_TIMING_STATS_ENABLED
+    /*
+    * RTC ticks at the last RX window opening
+    */
+    uint32_t RxWindowStartTicks;
+    /*
+    * RX window timing statistics per datarate
+    */
+    RxTimingStats_t RxTimingStats[LORAMAC_RX_TIMING_STATS_NB_DR];
+    /*
+    * Sums of the offsets of the RX window timing statistics [us]
+    */
+    int64_t RxTimingSums[LORAMAC_RX_TIMING_STATS_NB_DR];
+#endif
+#ifdef LORAMAC_IRQ_LATENCY_STATS_ENABLED
+    /*
+    * Radio interrupt latency histograms per MAC processing stage
+    */
+    LoRaMacIrqLatencyStats_t IrqLatencyStats[LORAMAC_IRQ_LATENCY_STAGE_MAX];
+#endif
+#ifdef LORAMAC_CHANNEL_QUALITY_ENABLED
+    /*
+    * Uplink channels link quality
+    */
+    LoRaMacChannelQuality_t ChannelQuality[LORAMAC_CHANNEL_QUALITY_NB_CHANNELS];
+#endif
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    /*
+    * Class C frames received while the previous ones are processed
+    */
+    LoRaMacRxCQueueFrame_t RxCQueue[LORAMAC_CLASS_C_RX_QUEUE_SIZE];
+    /*
+    * Index of the oldest frame of RxCQueue
+    */
+    uint8_t RxCQueueHead;
+    /*
+    * Number of frames in RxCQueue, the one being processed included
+    */
+    uint8_t RxCQueueCnt;
+    /*
+    * Maximum number of frames in RxCQueue, 0 processes the class C frames
+    * with the radio asleep
+    */
+    uint8_t RxCQueueDepth;
+    /*
+    * Set while the head of RxCQueue is processed
+    */
+    bool RxCQueueProcessing;
+    /*
+    * Set while the radio listens with the class C window parameters
+    */
+    bool RxCWindowArmed;
+    /*
+    * Radio dedicated to the class C window, NULL when the class C window
+    * shares the radio of the class A exchanges
+    */
+    const struct Radio_s* RxCRadio;
+    /*
+    * Dedicated class C radio events function pointer
+    */
+    RadioEvents_t RxCRadioEvents;
+    /*
+    * Datarate of the class C window on the dedicated radio
+    */
+    int8_t RxCDatarate;
+    /*
+    * Set when the dedicated class C radio stops listening on error
+    */
+    bool RxCRadioRestart;
+#endif
+    /*
+    * Set while the activity is attributed to an MCPS request
+    */
+    bool UplinkCostActive;
+    /*
+    * Radio statistics at the last uplink cost update
+    */
+    RadioStats_t UplinkCostRadioStats;
+    /*
+    * RX window the radio reception time is attributed to
+    */
+    LoRaMacRxSlot_t UplinkCostRxSlot;
+    /*
+    * Time of the last uplink cost update
+    */
+    TimerTime_t UplinkCostTime;
+    /*
+    * RTC ticks at the start of the current LoRaMacProcess call
+    */
+    uint32_t UplinkCostProcessTicks;
+    /*
+    * Sum of the activity attributed to the MCPS requests
+    */
+    LoRaMacUplinkCost_t UplinkCostTotal;
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+    /*
+    * Mean SNR margin of the class A downlinks above the demodulation floor
+    * of their datarate, with the power saving gain [dB]
+    */
+    int16_t RxGainMargin;
+    /*
+    * Set once a class A downlink margin is recorded
+    */
+    bool RxGainMarginValid;
+    /*
+    * Number of class A receptions failed since the last class A downlink
+    */
+    uint8_t RxGainFailures;
+    /*
+    * Set while the current class A window uses the boosted gain
+    */
+    bool RxGainBoosted;
+#endif
+    /*
+    * Set if the listen before talk with CAD is enabled
+    */
+    bool LbtCadOn;
+    /*
+    * Number of channels found busy for the current transmission
+    */
+    uint8_t LbtCadTrials;
+    /*
+    * Set if the delayed join request is already secured
+    */
+    bool JoinReqPrepared;
+    /*
+    * Set if the last CAD detected an activity
+    */
+    bool LbtChannelBusy;
+    /*
+    * Class C downlinks preamble length driving the radio RX duty cycle. 0 for
+    * the continuous reception.
+    */
+    uint16_t RxCDutyCyclePreambleLen;
+    /*
+    * Device side ADR strategy
+    */
+    const LoRaMacAdrStrategy_t* AdrStrategy;
+    /*
+    * Confirmed uplinks retry policy
+    */
+    const LoRaMacRetryPolicy_t* RetryPolicy;
+    /*
+    * Maximum number of uplinks sent in a row to collect the downlinks
+    * announced by the FPending bit, 0 when disabled
+    */
+    uint8_t FPendingMaxUplinks;
+    /*
+    * Number of uplinks sent to collect the pending downlinks since the last
+    * application uplink
+    */
+    uint8_t FPendingUplinkCnt;
+    /*
+    * Set when a class A downlink announced pending downlinks
+    */
+    bool FPendingUplinkRequested;
+    /*
+    * Set while the MAC requests an uplink collecting the pending downlinks
+    */
+    bool FPendingUplinkOngoing;
+    /*
+    * Delay after a class C confirmed downlink before the MAC sends its
+    * acknowledgement [ms], 0 when disabled
+    */
+    uint32_t ClassCAckDelay;
+    /*
+    * Battery level set by the application
+    */
+    uint8_t BatteryLevel;
+    /*
+    * Set once the battery level is set by the application
+    */
+    bool BatteryLevelSet;
+    /*
+    * Class C acknowledgement delay timer
+    */
+    TimerEvent_t ClassCAckTimer;
+    /*
+    * Set when the class C acknowledgement delay elapsed
+    */
+    bool ClassCAckUplinkRequested;
+    /*
+    * Enabled multicast groups sorted by address
+    */
+    uint8_t McAddrMap[LORAMAC_MAX_MC_CTX];
+    /*
+    * Number of entries in McAddrMap
+    */
+    uint8_t McAddrMapNb;
+    /*
+    * Received frames drop counters
+    */
+    LoRaMacRxDropStats_t RxDropStats;
+    /*
+    * Uplinks intra-packet frequency hopping period, 0 disables the hopping
+    */
+    uint8_t TxHopPeriod;
+    /*
+    * Regions whose context is initialized, bit n for region n. The contexts
+    * of all regions are kept in RAM, see \ref LoRaMacSwitchRegion.
+    */
+    uint32_t RegionsInitialized;
+    /*
     * Non-volatile module context structure
     */
     LoRaMacNvmCtx_t* NvmCtx;
@@ -357,6 +732,42 @@ static LoRaMacNvmCtx_t NvmMacCtx;
  */
 LoRaMacCtxs_t Contexts;
 
+/*
+ * LoRaMac instance storage
+ *
+ * \remark The storage is followed by a copy of the non-volatile contexts of
+ *         the Region, Secure Element, Crypto, Commands, Class B and Confirm
+ *         queue modules. Refer to \ref LoRaMacInstanceGetSize.
+ */
+struct sLoRaMacInstance
+{
+    /*
+     * Set to true once the instance holds a saved stack state
+     */
+    bool IsSaved;
+    /*
+     * Region of the saved stack state
+     */
+    LoRaMacRegion_t Region;
+    /*
+     * Volatile module context
+     */
+    LoRaMacCtx_t MacCtx;
+    /*
+     * Non-volatile module context
+     */
+    LoRaMacNvmCtx_t NvmMacCtx;
+    /*
+     * Sub modules non-volatile contexts
+     */
+    uint8_t NvmCtxs[];
+};
+
+/*
+ * Currently selected LoRaMac instance. NULL when the built-in storage is used.
+ */
+static LoRaMacHandle_t ActiveInstance = NULL;
+
 /*!
  * Defines the LoRaMac radio events status
  */
@@ -370,6 +781,7 @@ typedef union uLoRaMacRadioEvents
         uint32_t TxTimeout : 1;
         uint32_t RxDone    : 1;
         uint32_t TxDone    : 1;
+        uint32_t CadDone   : 1;
     }Events;
 }LoRaMacRadioEvents_t;
 
@@ -380,8 +792,10 @@ LoRaMacRadioEvents_t LoRaMacRadioEvents = { .Value = 0 };
 
 /*!
  * \brief Function to be executed on Radio Tx Done event
+ *
+ * \param [IN] timestamp Timer ticks captured at the radio interrupt edge
  */
-static void OnRadioTxDone( void );
+static void OnRadioTxDone( uint32_t timestamp );
 
 /*!
  * \brief This function prepares the MAC to abort the execution of function
@@ -391,8 +805,10 @@ static void PrepareRxDoneAbort( void );
 
 /*!
  * \brief Function to be executed on Radio Rx Done event
+ *
+ * \param [IN] timestamp Timer ticks captured at the radio interrupt edge
  */
-static void OnRadioRxDone( uint8_t* payload, uint16_t size, int16_t rssi, int8_t snr );
+static void OnRadioRxDone( uint8_t* payload, uint16_t size, int16_t rssi, int8_t snr, uint32_t timestamp );
 
 /*!
  * \brief Function executed on Radio Tx Timeout event
@@ -409,6 +825,19 @@ static void OnRadioRxError( void );
  */
 static void OnRadioRxTimeout( void );
 
+/*!
+ * \brief Function executed on Radio CAD done event
+ *
+ * \param [IN] channelActivityDetected Set if an activity was detected
+ */
+static void OnRadioCadDone( bool channelActivityDetected );
+
+/*!
+ * \brief Sends the frame on the radio once the channel has been selected
+ *        and found free
+ */
+static void SendFrame( void );
+
 /*!
  * \brief Function executed on duty cycle delayed Tx  timer event
  */
@@ -429,6 +858,11 @@ static void OnRxWindow2TimerEvent( void* context );
  */
 static void OnAckTimeoutTimerEvent( void* context );
 
+/*!
+ * \brief Function executed on the class C acknowledgement delay timer event
+ */
+static void OnClassCAckTimerEvent( void* context );
+
 /*!
  * \brief Configures the events to trigger an MLME-Indication with
  *        a MLME type of MLME_SCHEDULE_UPLINK.
@@ -467,6 +901,37 @@ static LoRaMacStatus_t SwitchClass( DeviceClass_t deviceClass );
  */
 static uint8_t GetMaxAppPayloadWithoutFOptsLength( int8_t datarate );
 
+/*!
+ * \brief Gets the lowest datarate, starting at a given datarate, a frame fits
+ *        into with the current uplink dwell time setting
+ *
+ * \param [IN] datarate First datarate to check
+ * \param [IN] size     FRMPayload and FOpts size of the frame
+ *
+ * \retval Datarate, -1 if the frame fits at no datarate
+ */
+static int8_t GetFitDatarate( int8_t datarate, uint16_t size );
+
+/*!
+ * \brief Reads the constant region PHY parameters and invalidates the
+ *        maximum payload lookups
+ */
+static void PhyParamsCacheInit( void );
+
+/*!
+ * \brief Gets the maximum payload length for the given settings. The region
+ *        is only queried if the settings differ from the last lookup ones.
+ *
+ * \param [IN] lookup          Last lookup of the uplink or downlink path
+ *
+ * \param [IN] dwellTime       Dwell time setting
+ *
+ * \param [IN] datarate        Datarate
+ *
+ * \retval                    Max length
+ */
+static uint8_t GetMaxPayload( LoRaMacMaxPayloadLookup_t* lookup, uint8_t dwellTime, int8_t datarate );
+
 /*!
  * \brief Validates if the payload fits into the frame, taking the datarate
  *        into account.
@@ -485,6 +950,21 @@ static uint8_t GetMaxAppPayloadWithoutFOptsLength( int8_t datarate );
  */
 static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen );
 
+/*!
+ * \brief Gets the size of the MAC commands an uplink with application data
+ *        has to carry. The requests of the end-device are left out when the
+ *        answers fit into the FOpts field, they may be deferred.
+ *
+ * \retval size Size of the MAC commands
+ */
+static size_t GetRequiredMacCmdsSize( void );
+
+/*!
+ * \brief Keeps the confirms of the piggy-backed requests which were deferred
+ *        to a next uplink pending
+ */
+static void UpdateDeferredMlmeConfirms( void );
+
 /*!
  * \brief Decodes MAC commands in the fOpts field and in the payload
  *
@@ -503,13 +983,20 @@ static void ProcessMacCommands( uint8_t* payload, uint8_t macIndex, uint8_t comm
  * \param [IN] fPort       MAC payload port
  * \param [IN] fBuffer     MAC data buffer to be sent
  * \param [IN] fBufferSize MAC data buffer size
+ * \param [IN] allowDelayedTx When set to true, the frame will be delayed while
+ *                            the duty cycle restriction is active
+ * \param [IN] inPlace     When set to true, fBuffer is the payload of a
+ *                         \ref LoRaMacMcpsReqBuffer_t
  * \retval status          Status of the operation.
  */
-LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uint16_t fBufferSize );
+LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uint16_t fBufferSize, bool allowDelayedTx, bool inPlace );
 
 /*!
  * \brief LoRaMAC layer send join/rejoin request
  *
+ * \remark Only the join-request is supported. The rejoin-requests need the
+ *         LoRaWAN 1.1 session keys and are rejected.
+ *
  * \param [IN] joinReqType Type of join-request or rejoin
  *
  * \retval status          Status of the operation.
@@ -525,9 +1012,11 @@ LoRaMacStatus_t SendReJoinReq( JoinReqIdentifier_t joinReqType );
  * \param [IN] fPort       MAC payload port
  * \param [IN] fBuffer     MAC data buffer to be sent
  * \param [IN] fBufferSize MAC data buffer size
+ * \param [IN] inPlace     When set to true, the frame is built around fBuffer
+ *                         instead of copying it into PktBuffer
  * \retval status          Status of the operation.
  */
-LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl, uint8_t fPort, void* fBuffer, uint16_t fBufferSize );
+LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl, uint8_t fPort, void* fBuffer, uint16_t fBufferSize, bool inPlace );
 
 /*
  * \brief Schedules the frame according to the duty cycle
@@ -550,8 +1039,47 @@ static LoRaMacStatus_t SecureFrame( uint8_t txDr, uint8_t txCh );
  * \brief Calculates the back-off time for the band of a channel.
  *
  * \param [IN] channel     The last Tx channel index
+ * \param [IN] now         Current time
+ */
+static void CalculateBackOff( uint8_t channel, TimerTime_t now );
+
+/*
+ * \brief Gets the join requests back-off window of the current time.
+ *        Window 0 is the first hour after the initialization, window 1 the
+ *        next 10 hours and window 2 + N the N-th following 24 hours period.
+ *
+ * \param [OUT] windowEnd   Time until the end of the window [ms]
+ * \param [OUT] budget      Join requests airtime budget of the window [ms]
+ *
+ * \retval window           The window number
+ */
+static uint32_t GetJoinWindow( TimerTime_t* windowEnd, TimerTime_t* budget );
+
+/*
+ * \brief Gets the delay before a join request may be sent without
+ *        exceeding the airtime budget of the current window.
+ *
+ * \param [IN] txTimeOnAir  Time on air of the join request [ms]
+ *
+ * \retval delay            0 when the join request may be sent now [ms]
+ */
+static TimerTime_t GetJoinBackOff( TimerTime_t txTimeOnAir );
+
+/*
+ * \brief Accounts a sent join request in the join airtime ledger.
+ *
+ * \param [IN] txTimeOnAir  Time on air of the join request [ms]
+ */
+static void AddJoinAirtime( TimerTime_t txTimeOnAir );
+
+/*
+ * \brief Sets up the channel selection parameters of the next transmission
+ *
+ * \param [IN]  datarate  Datarate of the next transmission
+ * \param [IN]  now       Current time
+ * \param [OUT] nextChan  Channel selection parameters
  */
-static void CalculateBackOff( uint8_t channel );
+static void GetNextChanParams( int8_t datarate, TimerTime_t now, NextChanParams_t* nextChan );
 
 /*
  * \brief Function to remove pending MAC commands
@@ -601,15 +1129,98 @@ LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequency, uint
 static void ResetMacParameters( void );
 
 /*!
- * \brief Initializes and opens the reception window
- *
- * \param [IN] rxTimer  Window timer to be topped.
- * \param [IN] rxConfig Window parameters to be setup
+ * \brief Resets the region specific MAC parameters to the region defaults
  */
-static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig );
+static void ResetRegionMacParameters( void );
 
 /*!
- * \brief Opens up a continuous RX C window. This is used for
+ * \brief Reads the region default MAC parameters
+ */
+static void InitMacParamsDefaults( void );
+
+/*!
+ * \brief Verifies if the stack state may be swapped, which requires that no
+ *        MAC operation is ongoing
+ *
+ * \retval [true: no operation ongoing, false: busy]
+ */
+static bool IsStackIdle( void );
+
+/*!
+ * \brief Rebuilds the multicast address map from the multicast channel list
+ */
+static void UpdateMcAddrMap( void );
+
+/*!
+ * \brief Compares the ADR parameters of two computations
+ *
+ * \param [IN] a First ADR parameters
+ * \param [IN] b Second ADR parameters
+ *
+ * \retval Returns true if the ADR strategy gives the same result for both
+ */
+static bool IsAdrNextEqual( CalcNextAdrParams_t* a, CalcNextAdrParams_t* b );
+
+/*!
+ * \brief Gets the delay before the duty-cycle allows the next transmission
+ *
+ * \param [IN] datarate Datarate of the next transmission
+ *
+ * \retval Delay in ms. 0 if the transmission is possible right away.
+ */
+static TimerTime_t GetNextTxDelay( int8_t datarate );
+
+/*!
+ * \brief Looks up the enabled multicast group of an address
+ *
+ * \param [IN] address Device address of a downlink
+ *
+ * \retval mcCtx Multicast context. NULL for the unicast address and unknown
+ *               addresses.
+ */
+static MulticastCtx_t* GetMcCtx( uint32_t address );
+
+/*!
+ * \brief Checks the MHDR and the device address of a received frame in the
+ *        radio buffer, before the frame is parsed
+ *
+ * \param [IN] payload Received PHY payload
+ * \param [IN] size    PHY payload size
+ *
+ * \retval status LORAMAC_EVENT_INFO_STATUS_OK if the frame must be processed
+ */
+static LoRaMacEventInfoStatus_t FilterRxFrame( const uint8_t* payload, uint16_t size );
+
+/*!
+ * \brief Initializes and opens the reception window
+ *
+ * \param [IN] rxTimer  Window timer to be topped.
+ * \param [IN] rxConfig Window parameters to be setup
+ */
+static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig );
+
+/*!
+ * \brief Sets the parameters of the RX1 window
+ */
+static void SetRxWindow1Config( void );
+
+/*!
+ * \brief Sets the parameters of the RX2 window
+ */
+static void SetRxWindow2Config( void );
+
+/*!
+ * \brief Configures the radio for a class A window ahead of its opening. The
+ *        window timer then only has to start the reception.
+ *
+ * \remark The radio keeps its configuration while sleeping
+ *
+ * \param [IN] rxConfig Window parameters to be setup
+ */
+static void PrepareRxWindow( RxConfigParams_t* rxConfig );
+
+/*!
+ * \brief Opens up a continuous RX C window. This is used for
  *        class c devices.
  */
 static void OpenContinuousRxCWindow( void );
@@ -683,6 +1294,13 @@ static void AckTimeoutRetriesProcess( void );
  */
 static void AckTimeoutRetriesFinalize( void );
 
+/*!
+ * \brief Gets the retry policy parameters of the current confirmed uplink
+ *
+ * \param [OUT] params Retry policy parameters
+ */
+static void GetRetryParams( LoRaMacRetryParams_t* params );
+
 /*!
  * \brief Calls the callback to indicate that a context changed
  */
@@ -693,6 +1311,16 @@ static void CallNvmCtxCallback( LoRaMacNvmCtxModule_t module );
  */
 static void EventMacNvmCtxChanged( void );
 
+/*!
+ * \brief Sets a MIB attribute, without notifying the context changes
+ *
+ * \param [IN]  mibSet        MIB-SET-Request to perform
+ * \param [OUT] nvmCtxChanged Set if the MAC or the region context changed
+ *
+ * \retval status Status of the operation
+ */
+static LoRaMacStatus_t SetMibAttribute( MibRequestConfirm_t* mibSet, bool* nvmCtxChanged );
+
 /*!
  * \brief Region NVM Context has been changed
  */
@@ -770,12 +1398,57 @@ static void LoRaMacHandleRequestEvents( void );
  */
 static void LoRaMacHandleIndicationEvents( void );
 
+/*!
+ * \brief This function sends the queued uplinks while the MAC is idle
+ */
+static void LoRaMacHandleTxQueue( void );
+
+/*!
+ * \brief This function sends an empty uplink while the MAC is idle when the
+ *        last class A downlink announced pending downlinks
+ */
+static void LoRaMacHandleFPendingUplink( void );
+
+/*!
+ * \brief This function sends an empty uplink while the MAC is idle when no
+ *        uplink carried the acknowledgement of a class C confirmed downlink
+ */
+static void LoRaMacHandleClassCAckUplink( void );
+
+/*!
+ * \brief Processes an MCPS request while the MAC is idle
+ *
+ * \param [IN] mcpsRequest    MCPS request
+ * \param [IN] allowDelayedTx When set to true, the frame will be delayed while
+ *                            the duty cycle restriction is active
+ * \param [IN] inPlace        When set to true, the payload is the one of a
+ *                            \ref LoRaMacMcpsReqBuffer_t
+ * \retval status             Status of the operation.
+ */
+static LoRaMacStatus_t McpsRequest( McpsReq_t* mcpsRequest, bool allowDelayedTx, bool inPlace );
+
+/*!
+ * \brief Allocates the frame buffer from the packet pool if not done yet
+ *
+ * \retval status true if the frame buffer is available
+ */
+static bool AcquirePktBuffer( void );
+
+/*!
+ * \brief Returns the frame buffer to the packet pool once the MAC is idle
+ *
+ * \retval buffer Application buffer of the completed in place MCPS request,
+ *                the caller releases its reference. NULL if none
+ */
+static uint8_t* ReleasePktBuffer( void );
+
 /*!
  * Structure used to store the radio Tx event data
  */
 struct
 {
     TimerTime_t CurTime;
+    uint32_t CurTicks;
 }TxDoneParams;
 
 /*!
@@ -784,151 +1457,1011 @@ struct
 struct
 {
     TimerTime_t LastRxDone;
+    uint32_t LastRxDoneTicks;
     uint8_t *Payload;
     uint16_t Size;
     int16_t Rssi;
     int8_t Snr;
 }RxDoneParams;
 
-static void OnRadioTxDone( void )
+/*!
+ * \brief Records the latency of a MAC processing stage in its histogram
+ *
+ * \param [IN] stage       MAC processing stage
+ * \param [IN] originTicks RTC ticks of the radio interrupt edge, or of the
+ *                         scheduled event the stage is late on
+ */
+static void UpdateIrqLatencyStats( LoRaMacIrqLatencyStage_t stage, uint32_t originTicks )
 {
-    TxDoneParams.CurTime = TimerGetCurrentTime( );
-    MacCtx.LastTxSysTime = SysTimeGet( );
-
-    LoRaMacRadioEvents.Events.TxDone = 1;
+#ifdef LORAMAC_IRQ_LATENCY_STATS_ENABLED
+    LoRaMacIrqLatencyStats_t* stats = &MacCtx.IrqLatencyStats[stage];
+    uint32_t elapsedTicks = TimerGetCurrentTicks( ) - originTicks;
+    uint32_t latency = 0;
+    uint32_t bound = LORAMAC_IRQ_LATENCY_BIN0_US;
+    uint8_t bin = 0;
 
-    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    // Early by a tick or so is on time
+    if( ( int32_t )elapsedTicks > 0 )
     {
-        MacCtx.MacCallbacks->MacProcessNotify( );
+        latency = TimerTicks2Us( elapsedTicks );
+    }
+    while( ( latency >= bound ) && ( bin < ( LORAMAC_IRQ_LATENCY_NB_BINS - 1 ) ) )
+    {
+        bound <<= 1;
+        bin++;
     }
+    stats->Bins[bin]++;
+    stats->NbSamples++;
+    stats->MaxLatency = MAX( stats->MaxLatency, latency );
+#endif
 }
 
-static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr )
+/*!
+ * \brief Declares the wait for a class A reception window to the low power
+ *        manager. The radio is asleep until the window opens.
+ *
+ * \param [IN] enable Set to true until the window opens
+ */
+static void SetRxWaitMode( bool enable )
 {
-    RxDoneParams.LastRxDone = TimerGetCurrentTime( );
-    RxDoneParams.Payload = payload;
-    RxDoneParams.Size = size;
-    RxDoneParams.Rssi = rssi;
-    RxDoneParams.Snr = snr;
+#if defined( LORAMAC_RX_WAIT_DEEP_SLEEP_ENABLED )
+    LpmSetRxWaitMode( enable );
+#endif
+}
 
-    LoRaMacRadioEvents.Events.RxDone = 1;
+#ifdef LORAMAC_PROFILE_ENABLED
+/*!
+ * MAC state bits of the profiled states
+ */
+static const uint32_t ProfileStateMasks[LORAMAC_PROFILE_STATE_MAX] =
+{
+    [LORAMAC_PROFILE_STATE_IDLE]       = LORAMAC_IDLE,
+    [LORAMAC_PROFILE_STATE_STOPPED]    = LORAMAC_STOPPED,
+    [LORAMAC_PROFILE_STATE_TX_RUNNING] = LORAMAC_TX_RUNNING,
+    [LORAMAC_PROFILE_STATE_RX]         = LORAMAC_RX,
+    [LORAMAC_PROFILE_STATE_ACK_RETRY]  = LORAMAC_ACK_RETRY,
+    [LORAMAC_PROFILE_STATE_TX_DELAYED] = LORAMAC_TX_DELAYED,
+    [LORAMAC_PROFILE_STATE_TX_CONFIG]  = LORAMAC_TX_CONFIG,
+    [LORAMAC_PROFILE_STATE_RX_ABORT]   = LORAMAC_RX_ABORT,
+    [LORAMAC_PROFILE_STATE_LBT_CAD]    = LORAMAC_LBT_CAD,
+};
 
-    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+/*!
+ * MAC profiling context
+ */
+static struct
+{
+    const LoRaMacProfileHooks_t* Hooks;
+    LoRaMacProfileStats_t Stats;
+    /*!
+     * Time of the last state change
+     */
+    TimerTime_t StateStart;
+    /*!
+     * Start of the current events pass [ticks]
+     */
+    uint32_t PassStart;
+    /*!
+     * Acceptance time of the pending requests
+     */
+    TimerTime_t RequestStart[LORAMAC_PROFILE_REQUEST_MAX];
+    /*!
+     * Pending requests, bit mask of ( 1 << LoRaMacProfileRequest_t )
+     */
+    uint8_t PendingRequests;
+}Profile;
+
+/*!
+ * \brief Converts a MAC state into profiled states
+ *
+ * \param [IN] macState MAC state
+ *
+ * \retval states Bit mask of ( 1 << LoRaMacProfileState_t )
+ */
+static uint16_t ProfileGetStates( uint32_t macState )
+{
+    uint16_t states = 0;
+
+    if( macState == LORAMAC_IDLE )
     {
-        MacCtx.MacCallbacks->MacProcessNotify( );
+        return 1 << LORAMAC_PROFILE_STATE_IDLE;
+    }
+    for( uint8_t i = LORAMAC_PROFILE_STATE_IDLE + 1; i < LORAMAC_PROFILE_STATE_MAX; i++ )
+    {
+        if( ( macState & ProfileStateMasks[i] ) != 0 )
+        {
+            states |= 1 << i;
+        }
     }
+    return states;
 }
 
-static void OnRadioTxTimeout( void )
+/*!
+ * \brief Adds the time elapsed since the last state change to the counters
+ *        of the current states
+ *
+ * \param [IN] stats Counters to update
+ * \param [IN] now   Current time
+ */
+static void ProfileAddStateTime( LoRaMacProfileStats_t* stats, TimerTime_t now )
 {
-    LoRaMacRadioEvents.Events.TxTimeout = 1;
+    uint16_t states = ProfileGetStates( MacCtx.MacState );
+    TimerTime_t elapsed = now - Profile.StateStart;
 
-    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    for( uint8_t i = 0; i < LORAMAC_PROFILE_STATE_MAX; i++ )
     {
-        MacCtx.MacCallbacks->MacProcessNotify( );
+        if( ( states & ( 1 << i ) ) != 0 )
+        {
+            stats->StateTime[i] += elapsed;
+        }
     }
 }
 
-static void OnRadioRxError( void )
+/*!
+ * \brief Restarts the profiling counters
+ */
+static void ProfileReset( void )
 {
-    LoRaMacRadioEvents.Events.RxError = 1;
+    memset1( ( uint8_t* )&Profile.Stats, 0, sizeof( Profile.Stats ) );
+    Profile.StateStart = TimerGetCurrentTime( );
+    Profile.PendingRequests = 0;
+}
+#endif
 
-    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+/*!
+ * \brief Changes the MAC state, every change goes through this function
+ *
+ * \param [IN] macState New MAC state
+ */
+static void SetMacState( uint32_t macState )
+{
+#ifdef LORAMAC_PROFILE_ENABLED
+    uint32_t oldState;
+    TimerTime_t now = TimerGetCurrentTime( );
+
+    CRITICAL_SECTION_BEGIN( );
+    oldState = MacCtx.MacState;
+    ProfileAddStateTime( &Profile.Stats, now );
+    Profile.StateStart = now;
+    MacCtx.MacState = macState;
+    CRITICAL_SECTION_END( );
+
+    if( ( oldState != macState ) && ( Profile.Hooks != NULL ) && ( Profile.Hooks->OnStateChange != NULL ) )
     {
-        MacCtx.MacCallbacks->MacProcessNotify( );
+        Profile.Hooks->OnStateChange( ProfileGetStates( oldState ), ProfileGetStates( macState ) );
     }
+#else
+    MacCtx.MacState = macState;
+#endif
 }
 
-static void OnRadioRxTimeout( void )
+/*!
+ * \brief Marks the start of a LoRaMacProcess events pass
+ */
+static void ProfilePassBegin( void )
 {
-    LoRaMacRadioEvents.Events.RxTimeout = 1;
+#ifdef LORAMAC_PROFILE_ENABLED
+    Profile.PassStart = TimerGetCurrentTicks( );
+#endif
+}
 
-    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+/*!
+ * \brief Marks the end of a LoRaMacProcess events pass
+ *
+ * \param [IN] pass Events pass
+ */
+static void ProfilePassEnd( LoRaMacProfilePass_t pass )
+{
+#ifdef LORAMAC_PROFILE_ENABLED
+    uint32_t duration = TimerTicks2Us( TimerGetCurrentTicks( ) - Profile.PassStart );
+
+    Profile.Stats.PassTime[pass] += duration;
+    Profile.Stats.NbPasses[pass]++;
+    if( ( Profile.Hooks != NULL ) && ( Profile.Hooks->OnEventsPass != NULL ) )
     {
-        MacCtx.MacCallbacks->MacProcessNotify( );
+        Profile.Hooks->OnEventsPass( pass, duration );
     }
+#endif
 }
 
-static void UpdateRxSlotIdleState( void )
+/*!
+ * \brief Gets the profiled request type of an MCPS request
+ *
+ * \param [IN] type MCPS request type
+ *
+ * \retval request Profiled request type
+ */
+static LoRaMacProfileRequest_t ProfileGetMcpsRequest( Mcps_t type )
 {
-    if( MacCtx.NvmCtx->DeviceClass != CLASS_C )
+    if( type == MCPS_PROPRIETARY )
     {
-        MacCtx.RxSlot = RX_SLOT_NONE;
+        return LORAMAC_PROFILE_REQUEST_MCPS_PROPRIETARY;
     }
-    else
+    return ( type == MCPS_CONFIRMED ) ? LORAMAC_PROFILE_REQUEST_MCPS_CONFIRMED : LORAMAC_PROFILE_REQUEST_MCPS_UNCONFIRMED;
+}
+
+/*!
+ * \brief Starts timing an accepted request, unless already pending
+ *
+ * \param [IN] request Profiled request type
+ */
+static void ProfileRequestStart( LoRaMacProfileRequest_t request )
+{
+#ifdef LORAMAC_PROFILE_ENABLED
+    if( ( Profile.PendingRequests & ( 1 << request ) ) == 0 )
     {
-        MacCtx.RxSlot = RX_SLOT_WIN_CLASS_C;
+        Profile.PendingRequests |= 1 << request;
+        Profile.RequestStart[request] = TimerGetCurrentTime( );
     }
+#endif
 }
 
-static void ProcessRadioTxDone( void )
+/*!
+ * \brief Counts the time of a confirmed request
+ *
+ * \param [IN] request Profiled request type
+ */
+static void ProfileRequestDone( LoRaMacProfileRequest_t request )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
-    SetBandTxDoneParams_t txDone;
-
-    if( MacCtx.NvmCtx->DeviceClass != CLASS_C )
+#ifdef LORAMAC_PROFILE_ENABLED
+    if( ( Profile.PendingRequests & ( 1 << request ) ) != 0 )
     {
-        Radio.Sleep( );
+        Profile.PendingRequests &= ~( 1 << request );
+        Profile.Stats.RequestTime[request] += TimerGetElapsedTime( Profile.RequestStart[request] );
+        Profile.Stats.NbRequests[request]++;
     }
-    // Setup timers
-    TimerSetValue( &MacCtx.RxWindowTimer1, MacCtx.RxWindow1Delay );
-    TimerStart( &MacCtx.RxWindowTimer1 );
-    TimerSetValue( &MacCtx.RxWindowTimer2, MacCtx.RxWindow2Delay );
-    TimerStart( &MacCtx.RxWindowTimer2 );
+#endif
+}
 
-    if( ( MacCtx.NvmCtx->DeviceClass == CLASS_C ) || ( MacCtx.NodeAckRequested == true ) )
+/*!
+ * \brief Records the outcome of an uplink in the link quality of its channel
+ *
+ * \param [IN] received Set to true when a class A downlink is received, false
+ *                      when the acknowledgement of a confirmed uplink is missed
+ * \param [IN] rssi     Downlink RSSI [dBm]
+ * \param [IN] snr      Downlink SNR [dB]
+ */
+static void UpdateChannelQuality( bool received, int16_t rssi, int8_t snr )
+{
+#ifdef LORAMAC_CHANNEL_QUALITY_ENABLED
+    LoRaMacChannelQuality_t* quality;
+
+    if( MacCtx.Channel >= LORAMAC_CHANNEL_QUALITY_NB_CHANNELS )
     {
-        getPhy.Attribute = PHY_ACK_TIMEOUT;
-        phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-        TimerSetValue( &MacCtx.AckTimeoutTimer, MacCtx.RxWindow2Delay + phyParam.Value );
-        TimerStart( &MacCtx.AckTimeoutTimer );
+        return;
     }
+    quality = &MacCtx.ChannelQuality[MacCtx.Channel];
 
-    // Store last Tx channel
-    MacCtx.NvmCtx->LastTxChannel = MacCtx.Channel;
-    // Update last tx done time for the current channel
-    txDone.Channel = MacCtx.Channel;
-    if( MacCtx.NvmCtx->NetworkActivation == ACTIVATION_TYPE_NONE )
+    quality->Loss -= quality->Loss >> 2;
+    if( received == false )
     {
-        txDone.Joined  = false;
+        quality->Loss += 63;
     }
-    else
+    // A downlink without the ACK bit is followed by the ACK timeout
+    if( ( MacCtx.NodeAckRequested == true ) && ( ( received == false ) || ( MacCtx.McpsConfirm.AckReceived == true ) ) )
     {
-        txDone.Joined  = true;
+        quality->NbConfirmed++;
+        if( received == true )
+        {
+            quality->NbAcked++;
+        }
     }
-    txDone.LastTxDoneTime = TxDoneParams.CurTime;
-    RegionSetBandTxDone( MacCtx.NvmCtx->Region, &txDone );
-    // Update Aggregated last tx done time
-    MacCtx.NvmCtx->LastTxDoneTime = TxDoneParams.CurTime;
+    if( ( received == true ) && ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_1 ) )
+    {
+        if( quality->NbRx1 == 0 )
+        {
+            quality->Rx1Rssi = rssi;
+            quality->Rx1Snr = snr;
+        }
+        else
+        {
+            quality->Rx1Rssi += ( rssi - quality->Rx1Rssi ) / 4;
+            quality->Rx1Snr += ( snr - quality->Rx1Snr ) / 4;
+        }
+        quality->NbRx1++;
+    }
+#endif
+}
 
-    if( MacCtx.NodeAckRequested == false )
+/*!
+ * \brief Verifies if another channel is drawn instead of the selected one
+ *
+ * \param [IN] channel Channel selected by the region
+ *
+ * \retval avoided Returns true with a probability of the channel loss score
+ */
+static bool IsChannelLossy( uint8_t channel )
+{
+#ifdef LORAMAC_CHANNEL_QUALITY_ENABLED
+    if( ( channel < LORAMAC_CHANNEL_QUALITY_NB_CHANNELS ) && ( MacCtx.ChannelQuality[channel].Loss > 0 ) )
     {
-        MacCtx.McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+        return randr( 0, 255 ) < MacCtx.ChannelQuality[channel].Loss;
     }
+#endif
+    return false;
 }
 
-static void PrepareRxDoneAbort( void )
+/*!
+ * \brief Writes a radio events trace record, refer to \ref LORAMAC_TRACE
+ *
+ * \param [IN] id   Record identifier
+ * \param [IN] data Record payload
+ * \param [IN] size Record payload size
+ */
+static void TraceRadioEvent( uint8_t id, const uint8_t* data, uint8_t size )
 {
-    MacCtx.MacState |= LORAMAC_RX_ABORT;
+#ifdef LORAMAC_RADIO_TRACE_ENABLED
+    BinLogWrite( id, data, size );
+#endif
+}
 
-    if( MacCtx.NodeAckRequested == true )
+/*!
+ * \brief Writes the record of a radio interrupt, Tx done or Rx done
+ *
+ * \param [IN] id        Record identifier
+ * \param [IN] timestamp Timer ticks captured at the radio interrupt edge
+ * \param [IN] rssi      Frame RSSI
+ * \param [IN] snr       Frame SNR
+ * \param [IN] payload   Received frame, NULL for the Tx done
+ * \param [IN] size      Received frame size
+ */
+static void TraceRadioIrq( uint8_t id, uint32_t timestamp, int16_t rssi, int8_t snr, const uint8_t* payload, uint16_t size )
+{
+#ifdef LORAMAC_RADIO_TRACE_ENABLED
+    uint8_t record[5 + LORAMAC_TRACE_RX_MAX_SIZE];
+    uint32_t latency = TimerTicks2Us( TimerGetCurrentTicks( ) - timestamp );
+
+    latency = MIN( latency, UINT16_MAX );
+    record[0] = ( uint8_t )( latency >> 0 );
+    record[1] = ( uint8_t )( latency >> 8 );
+    if( payload == NULL )
     {
-        OnAckTimeoutTimerEvent( NULL );
+        TraceRadioEvent( id, record, 2 );
+        return;
     }
+    size = MIN( size, LORAMAC_TRACE_RX_MAX_SIZE );
+    record[2] = ( uint8_t )( rssi >> 0 );
+    record[3] = ( uint8_t )( rssi >> 8 );
+    record[4] = ( uint8_t )snr;
+    memcpy1( &record[5], payload, size );
+    TraceRadioEvent( id, record, 5 + size );
+#endif
+}
 
-    MacCtx.MacFlags.Bits.McpsInd = 1;
-    MacCtx.MacFlags.Bits.MacDone = 1;
+/*!
+ * \brief Writes the record of a MAC timer start
+ *
+ * \param [IN] timer Started timer
+ * \param [IN] delay Timer delay [us]
+ */
+static void TraceTimerStart( LoRaMacTraceTimer_t timer, uint32_t delay )
+{
+#ifdef LORAMAC_RADIO_TRACE_ENABLED
+    uint8_t record[5] =
+    {
+        ( uint8_t )timer,
+        ( uint8_t )( delay >> 0 ), ( uint8_t )( delay >> 8 ), ( uint8_t )( delay >> 16 ), ( uint8_t )( delay >> 24 )
+    };
 
-    UpdateRxSlotIdleState( );
+    TraceRadioEvent( LORAMAC_TRACE_ID_TIMER, record, sizeof( record ) );
+#endif
 }
 
-static void ProcessRadioRxDone( void )
+/*!
+ * \brief Writes the record of a reception window opening
+ *
+ * \param [IN] slot     Window slot
+ * \param [IN] datarate Window datarate
+ */
+static void TraceRxWindow( uint8_t slot, int8_t datarate )
+{
+#ifdef LORAMAC_RADIO_TRACE_ENABLED
+    uint8_t record[2] = { slot, ( uint8_t )datarate };
+
+    TraceRadioEvent( LORAMAC_TRACE_ID_RX_WINDOW, record, sizeof( record ) );
+#endif
+}
+
+/*!
+ * \brief Writes the record of the frame being sent
+ */
+static void TraceTx( void )
+{
+#ifdef LORAMAC_RADIO_TRACE_ENABLED
+    uint32_t digest = Crc32Update( 0, MacCtx.TxPkt, MacCtx.PktBufferLen );
+    uint16_t timeOnAir = MIN( MacCtx.TxTimeOnAir, UINT16_MAX );
+    bool isData = ( MacCtx.TxMsg.Type == LORAMAC_MSG_TYPE_DATA );
+    uint8_t record[13] =
+    {
+        ( uint8_t )( digest >> 0 ), ( uint8_t )( digest >> 8 ), ( uint8_t )( digest >> 16 ), ( uint8_t )( digest >> 24 ),
+        ( uint8_t )MacCtx.PktBufferLen,
+        MacCtx.TxPkt[0],
+        ( isData == true ) ? MacCtx.TxMsg.Message.Data.FPort : 0,
+        ( isData == true ) ? MacCtx.TxMsg.Message.Data.FRMPayloadSize : 0,
+        MacCtx.Channel,
+        ( uint8_t )MacCtx.McpsConfirm.Datarate,
+        ( uint8_t )MacCtx.McpsConfirm.TxPower,
+        ( uint8_t )( timeOnAir >> 0 ), ( uint8_t )( timeOnAir >> 8 )
+    };
+
+    TraceRadioEvent( LORAMAC_TRACE_ID_TX, record, sizeof( record ) );
+#endif
+}
+
+static void OnRadioTxDone( uint32_t timestamp )
+{
+    // Time elapsed since the radio interrupt edge
+    uint32_t latency = TimerTicks2Us( TimerGetCurrentTicks( ) - timestamp ) / 1000;
+    SysTime_t sysLatency = { .Seconds = latency / 1000, .SubSeconds = latency % 1000 };
+
+    TxDoneParams.CurTime = TimerGetCurrentTime( ) - latency;
+    TxDoneParams.CurTicks = timestamp;
+    MacCtx.LastTxSysTime = SysTimeSub( SysTimeGet( ), sysLatency );
+    UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_TX_DONE_EVENT, timestamp );
+    TraceRadioIrq( LORAMAC_TRACE_ID_TX_DONE, timestamp, 0, 0, NULL, 0 );
+
+    LoRaMacRadioEvents.Events.TxDone = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+/*!
+ * \brief Adds a class C frame to the class C queue
+ *
+ * \remark The dedicated class C radio queues its frames whatever the queue
+ *         depth, a depth of 0 is then handled as 1.
+ *
+ * \param [IN] payload   Received PHY payload
+ * \param [IN] size      PHY payload size
+ * \param [IN] rssi      Frame RSSI
+ * \param [IN] snr       Frame SNR
+ * \param [IN] timestamp Timer ticks captured at the radio interrupt edge
+ */
+static void AddRxCQueueFrame( uint8_t* payload, uint16_t size, int16_t rssi, int8_t snr, uint32_t timestamp )
+{
+    LoRaMacRxCQueueFrame_t* frame;
+
+    // Drop the frames of the other devices right away
+    if( FilterRxFrame( payload, size ) != LORAMAC_EVENT_INFO_STATUS_OK )
+    {
+        return;
+    }
+    if( MacCtx.RxCQueueCnt >= MAX( MacCtx.RxCQueueDepth, 1 ) )
+    {
+        MacCtx.RxDropStats.Overflow++;
+        return;
+    }
+
+    frame = &MacCtx.RxCQueue[( MacCtx.RxCQueueHead + MacCtx.RxCQueueCnt ) % LORAMAC_CLASS_C_RX_QUEUE_SIZE];
+    frame->LastRxDone = TimerGetCurrentTime( ) - TimerTicks2Us( TimerGetCurrentTicks( ) - timestamp ) / 1000;
+    frame->LastRxDoneTicks = timestamp;
+    frame->Size = size;
+    frame->Rssi = rssi;
+    frame->Snr = snr;
+    memcpy1( frame->Payload, payload, size );
+    MacCtx.RxCQueueCnt++;
+}
+#endif
+
+/*!
+ * \brief Copies a frame received in the class C window to the class C queue
+ *        and keeps the radio listening, so that the back to back frames are
+ *        received while the MAC processes the previous ones
+ *
+ * \param [IN] payload   Received PHY payload
+ * \param [IN] size      PHY payload size
+ * \param [IN] rssi      Frame RSSI
+ * \param [IN] snr       Frame SNR
+ * \param [IN] timestamp Timer ticks captured at the radio interrupt edge
+ * \retval queued        True if the queue handles the frame, false if the
+ *                       frame is processed with the radio asleep
+ */
+static bool QueueRxCFrame( uint8_t* payload, uint16_t size, int16_t rssi, int8_t snr, uint32_t timestamp )
+{
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    if( ( MacCtx.RxCQueueDepth == 0 ) || ( MacCtx.RxSlot != RX_SLOT_WIN_CLASS_C ) || ( MacCtx.RxCRadio != NULL ) )
+    {
+        return false;
+    }
+    if( Radio.GetStatus( ) != RF_RX_RUNNING )
+    {
+        // The duty cycled reception ends with the received frame
+        OpenContinuousRxCWindow( );
+    }
+
+    AddRxCQueueFrame( payload, size, rssi, snr, timestamp );
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+/*!
+ * \brief Queues the frames received by the dedicated class C radio. They are
+ *        processed in between the class A exchanges of the other radio.
+ */
+static void OnRxCRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr, uint32_t timestamp )
+{
+    if( MacCtx.RxCRadio->GetStatus( ) != RF_RX_RUNNING )
+    {
+        // The duty cycled reception ends with the received frame
+        OpenContinuousRxCWindow( );
+    }
+    AddRxCQueueFrame( payload, size, rssi, snr, timestamp );
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
+/*!
+ * \brief Gets the dedicated class C radio reception restarted by
+ *        LoRaMacProcess
+ */
+static void OnRxCRadioRxError( void )
+{
+    MacCtx.RxCRadioRestart = true;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+#endif
+
+static void OnRadioRxDone( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr, uint32_t timestamp )
+{
+    TraceRadioIrq( LORAMAC_TRACE_ID_RX_DONE, timestamp, rssi, snr, payload, size );
+
+    if( QueueRxCFrame( payload, size, rssi, snr, timestamp ) == true )
+    {
+        UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX_DONE_EVENT, timestamp );
+
+        if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+        {
+            MacCtx.MacCallbacks->MacProcessNotify( );
+        }
+        return;
+    }
+
+    RxDoneParams.LastRxDone = TimerGetCurrentTime( ) - TimerTicks2Us( TimerGetCurrentTicks( ) - timestamp ) / 1000;
+    RxDoneParams.LastRxDoneTicks = timestamp;
+    RxDoneParams.Payload = payload;
+    RxDoneParams.Size = size;
+    RxDoneParams.Rssi = rssi;
+    RxDoneParams.Snr = snr;
+    UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX_DONE_EVENT, timestamp );
+
+    LoRaMacRadioEvents.Events.RxDone = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
+static void OnRadioTxTimeout( void )
+{
+    TraceRadioEvent( LORAMAC_TRACE_ID_TX_TIMEOUT, NULL, 0 );
+    LoRaMacRadioEvents.Events.TxTimeout = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
+static void OnRadioRxError( void )
+{
+    TraceRadioEvent( LORAMAC_TRACE_ID_RX_ERROR, NULL, 0 );
+    LoRaMacRadioEvents.Events.RxError = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
+static void OnRadioRxTimeout( void )
+{
+    TraceRadioEvent( LORAMAC_TRACE_ID_RX_TIMEOUT, NULL, 0 );
+    LoRaMacRadioEvents.Events.RxTimeout = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
+static void OnRadioCadDone( bool channelActivityDetected )
+{
+    MacCtx.LbtChannelBusy = channelActivityDetected;
+    LoRaMacRadioEvents.Events.CadDone = 1;
+
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
+/*!
+ * \brief Starts attributing the radio and MCU activity to the MCPS request
+ */
+static void UplinkCostStart( void )
+{
+    MacCtx.UplinkCostActive = true;
+    MacCtx.UplinkCostRxSlot = RX_SLOT_NONE;
+    MacCtx.UplinkCostTime = TimerGetCurrentTime( );
+    if( Radio.GetStats != NULL )
+    {
+        Radio.GetStats( &MacCtx.UplinkCostRadioStats );
+    }
+}
+
+/*!
+ * \brief Attributes the radio activity since the last update to the MCPS
+ *        request
+ *
+ * \param [IN] rxSlot RX window the following reception time is attributed to
+ */
+static void UplinkCostUpdate( LoRaMacRxSlot_t rxSlot )
+{
+    TimerTime_t now = TimerGetCurrentTime( );
+    TimerTime_t rxTime = 0;
+
+    if( MacCtx.UplinkCostActive == false )
+    {
+        return;
+    }
+
+    if( Radio.GetStats != NULL )
+    {
+        RadioStats_t stats;
+
+        Radio.GetStats( &stats );
+        MacCtx.McpsConfirm.Cost.TxTime += stats.TxTime - MacCtx.UplinkCostRadioStats.TxTime;
+        MacCtx.McpsConfirm.Cost.TxCharge += stats.TxCharge - MacCtx.UplinkCostRadioStats.TxCharge;
+        rxTime = stats.RxTime - MacCtx.UplinkCostRadioStats.RxTime;
+        MacCtx.UplinkCostRadioStats = stats;
+    }
+    else if( MacCtx.UplinkCostRxSlot != RX_SLOT_NONE )
+    {
+        // Time the RX window was open
+        rxTime = now - MacCtx.UplinkCostTime;
+    }
+
+    if( MacCtx.UplinkCostRxSlot == RX_SLOT_WIN_1 )
+    {
+        MacCtx.McpsConfirm.Cost.Rx1Time += rxTime;
+    }
+    else if( MacCtx.UplinkCostRxSlot == RX_SLOT_WIN_2 )
+    {
+        MacCtx.McpsConfirm.Cost.Rx2Time += rxTime;
+    }
+    MacCtx.UplinkCostRxSlot = rxSlot;
+    MacCtx.UplinkCostTime = now;
+}
+
+/*!
+ * \brief Attributes the MCU activity since startTicks to the MCPS request
+ *
+ * \param [IN] startTicks RTC ticks at the start of the activity
+ */
+static void UplinkCostAddMcuTime( uint32_t startTicks )
+{
+    if( MacCtx.UplinkCostActive == true )
+    {
+        MacCtx.McpsConfirm.Cost.McuActiveTime += TimerTicks2Us( TimerGetCurrentTicks( ) - startTicks );
+    }
+}
+
+/*!
+ * \brief Stops attributing the activity to the MCPS request and adds it to
+ *        the sum of all requests
+ */
+static void UplinkCostFinalize( void )
+{
+    LoRaMacUplinkCost_t* cost = &MacCtx.McpsConfirm.Cost;
+
+    UplinkCostUpdate( RX_SLOT_NONE );
+    UplinkCostAddMcuTime( MacCtx.UplinkCostProcessTicks );
+    MacCtx.UplinkCostActive = false;
+
+    MacCtx.UplinkCostTotal.NbTx += cost->NbTx;
+    MacCtx.UplinkCostTotal.TxTime += cost->TxTime;
+    MacCtx.UplinkCostTotal.TxCharge += cost->TxCharge;
+    MacCtx.UplinkCostTotal.Rx1Time += cost->Rx1Time;
+    MacCtx.UplinkCostTotal.Rx2Time += cost->Rx2Time;
+    MacCtx.UplinkCostTotal.McuActiveTime += cost->McuActiveTime;
+    MacCtx.UplinkCostTotal.TimeOff += cost->TimeOff;
+}
+
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+/*!
+ * \brief Drops the class A downlinks history of the RX gain selection
+ */
+static void RxGainReset( void )
+{
+    MacCtx.RxGainMargin = 0;
+    MacCtx.RxGainMarginValid = false;
+    MacCtx.RxGainFailures = 0;
+}
+
+/*!
+ * \brief Records the SNR margin of a downlink received in a class A window
+ *
+ * \param [IN] snr      Downlink SNR [dB]
+ * \param [IN] datarate Downlink datarate
+ */
+static void RxGainOnDownlink( int8_t snr, int8_t datarate )
 {
-    LoRaMacHeader_t macHdr;
-    ApplyCFListParams_t applyCFList;
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
+    int16_t margin;
+
+    MacCtx.RxGainFailures = 0;
+
+    getPhy.Attribute = PHY_SPREADING_FACTOR;
+    getPhy.Datarate = datarate;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    if( ( phyParam.Value < 7 ) || ( phyParam.Value > 12 ) )
+    {
+        return;
+    }
+    // Demodulation floor of -7.5 dB at SF7, 2.5 dB lower per spreading factor
+    margin = ( ( 2 * snr ) - ( 20 - ( 5 * ( int16_t )phyParam.Value ) ) ) / 2;
+    if( MacCtx.RxGainBoosted == true )
+    {
+        margin -= LORAMAC_RX_GAIN_BOOST_SNR_GAIN;
+    }
+
+    if( MacCtx.RxGainMarginValid == false )
+    {
+        MacCtx.RxGainMargin = margin;
+        MacCtx.RxGainMarginValid = true;
+    }
+    else
+    {
+        MacCtx.RxGainMargin = ( ( 3 * MacCtx.RxGainMargin ) + margin ) / 4;
+    }
+}
+
+/*!
+ * \brief Records a class A reception failure: a frame received with errors
+ *        or a missed acknowledgement
+ */
+static void RxGainOnFailure( void )
+{
+    if( MacCtx.RxGainFailures < UINT8_MAX )
+    {
+        MacCtx.RxGainFailures++;
+    }
+}
+
+/*!
+ * \brief Selects the RX gain of a class A window
+ *
+ * \retval boosted Returns true if the window uses the boosted gain
+ */
+static bool RxGainIsBoosted( void )
+{
+    if( Radio.RxBoosted == NULL )
+    {
+        return false;
+    }
+    if( MacCtx.RxGainFailures >= LORAMAC_RX_GAIN_BOOST_FAILURES )
+    {
+        return true;
+    }
+    // Without downlink history the power saving gain is kept
+    return ( MacCtx.RxGainMarginValid == true ) && ( MacCtx.RxGainMargin < LORAMAC_RX_GAIN_BOOST_MARGIN );
+}
+#endif
+
+static void UpdateRxSlotIdleState( void )
+{
+    UplinkCostUpdate( RX_SLOT_NONE );
+
+    if( MacCtx.NvmCtx->DeviceClass != CLASS_C )
+    {
+        MacCtx.RxSlot = RX_SLOT_NONE;
+    }
+    else
+    {
+        MacCtx.RxSlot = RX_SLOT_WIN_CLASS_C;
+    }
+}
+
+static void ProcessRadioTxDone( void )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    SetBandTxDoneParams_t txDone;
+    LoRaMacRetryParams_t retryParams;
+    TimerTime_t ackTimeout;
+    uint32_t elapsedTicks = 0;
+
+    MacCtx.RxWindowPrepared = RX_SLOT_NONE;
+    if( MacCtx.NvmCtx->DeviceClass != CLASS_C )
+    {
+        if( MacCtx.NvmCtx->DeviceClass == CLASS_A )
+        {
+            // Configure the radio for RX1 now instead of upon the window timer
+            SetRxWindow1Config( );
+            PrepareRxWindow( &MacCtx.RxWindow1Config );
+            SetRxWaitMode( true );
+        }
+        Radio.Sleep( );
+    }
+    // Setup timers. The delays start at the TX done interrupt.
+    elapsedTicks = TimerGetCurrentTicks( ) - TxDoneParams.CurTicks;
+    UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX1_TIMER_START, TxDoneParams.CurTicks );
+    TimerStartTicks( &MacCtx.RxWindowTimer1, ( MacCtx.RxWindow1DelayTicks > elapsedTicks ) ? ( MacCtx.RxWindow1DelayTicks - elapsedTicks ) : 0 );
+    TimerStartTicks( &MacCtx.RxWindowTimer2, ( MacCtx.RxWindow2DelayTicks > elapsedTicks ) ? ( MacCtx.RxWindow2DelayTicks - elapsedTicks ) : 0 );
+    TraceTimerStart( LORAMAC_TRACE_TIMER_RX1, TimerTicks2Us( MacCtx.RxWindow1DelayTicks ) );
+    TraceTimerStart( LORAMAC_TRACE_TIMER_RX2, TimerTicks2Us( MacCtx.RxWindow2DelayTicks ) );
+
+    if( ( MacCtx.NvmCtx->DeviceClass == CLASS_C ) || ( MacCtx.NodeAckRequested == true ) )
+    {
+        getPhy.Attribute = PHY_ACK_TIMEOUT;
+        phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+        ackTimeout = phyParam.Value;
+        if( MacCtx.NodeAckRequested == true )
+        {
+            GetRetryParams( &retryParams );
+            ackTimeout = MacCtx.RetryPolicy->GetAckTimeout( &retryParams, ackTimeout );
+        }
+        TimerSetValue( &MacCtx.AckTimeoutTimer, MacCtx.RxWindow2Delay + ackTimeout );
+        TimerStart( &MacCtx.AckTimeoutTimer );
+        TraceTimerStart( LORAMAC_TRACE_TIMER_ACK_TIMEOUT, ( MacCtx.RxWindow2Delay + ackTimeout ) * 1000 );
+    }
+
+    // Store last Tx channel
+    MacCtx.NvmCtx->LastTxChannel = MacCtx.Channel;
+    // Update last tx done time for the current channel
+    txDone.Channel = MacCtx.Channel;
+    if( MacCtx.NvmCtx->NetworkActivation == ACTIVATION_TYPE_NONE )
+    {
+        txDone.Joined  = false;
+    }
+    else
+    {
+        txDone.Joined  = true;
+    }
+    txDone.LastTxDoneTime = TxDoneParams.CurTime;
+    txDone.LastTxAirTime = MacCtx.TxTimeOnAir;
+    RegionSetBandTxDone( MacCtx.NvmCtx->Region, &txDone );
+    if( MacCtx.TxMsg.Type == LORAMAC_MSG_TYPE_JOIN_REQUEST )
+    {
+        AddJoinAirtime( MacCtx.TxTimeOnAir );
+    }
+    // Update Aggregated last tx done time
+    MacCtx.NvmCtx->LastTxDoneTime = TxDoneParams.CurTime;
+
+    if( MacCtx.UplinkCostActive == true )
+    {
+        MacCtx.McpsConfirm.Cost.TimeOff += ( MacCtx.TxTimeOnAir << MacCtx.NvmCtx->MaxDCycle ) - MacCtx.TxTimeOnAir;
+    }
+
+    if( MacCtx.NodeAckRequested == false )
+    {
+        MacCtx.McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_OK;
+    }
+
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+    if( ( MacCtx.NvmCtx->NetworkActivation != ACTIVATION_TYPE_NONE ) && ( MacCtx.TxMsg.Type == LORAMAC_MSG_TYPE_DATA ) )
+    {
+        // Computed during the RX1 delay, the downlink is then deciphered
+        // with a plain XOR
+        LoRaMacCryptoPrecomputeDownlinkKeyStream( MacCtx.NvmCtx->DevAddr );
+    }
+#endif
+}
+
+static void PrepareRxDoneAbort( void )
+{
+    SetMacState( MacCtx.MacState | LORAMAC_RX_ABORT );
+
+    if( MacCtx.NodeAckRequested == true )
+    {
+        OnAckTimeoutTimerEvent( NULL );
+    }
+
+    MacCtx.MacFlags.Bits.McpsInd = 1;
+    MacCtx.MacFlags.Bits.MacDone = 1;
+
+    UpdateRxSlotIdleState( );
+}
+
+static LoRaMacEventInfoStatus_t FilterRxFrame( const uint8_t* payload, uint16_t size )
+{
+    LoRaMacHeader_t macHdr;
+    uint32_t devAddr;
+
+    if( size < LORAMAC_MHDR_FIELD_SIZE )
+    {
+        MacCtx.RxDropStats.Length++;
+        return LORAMAC_EVENT_INFO_STATUS_ERROR;
+    }
+
+    macHdr.Value = payload[0];
+    switch( macHdr.Bits.MType )
+    {
+        case FRAME_TYPE_JOIN_ACCEPT:
+        case FRAME_TYPE_PROPRIETARY:
+            return LORAMAC_EVENT_INFO_STATUS_OK;
+        case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
+        case FRAME_TYPE_DATA_CONFIRMED_DOWN:
+            break;
+        default:
+            MacCtx.RxDropStats.MType++;
+            return LORAMAC_EVENT_INFO_STATUS_ERROR;
+    }
+
+    // MHDR(1) + FHDR(7) + MIC(4), the port and the frame payload are optional
+    if( size < ( LORA_MAC_FRMPAYLOAD_OVERHEAD - LORAMAC_F_PORT_FIELD_SIZE ) )
+    {
+        MacCtx.RxDropStats.Length++;
+        return LORAMAC_EVENT_INFO_STATUS_ERROR;
+    }
+
+    devAddr = LoRaMacParserDataDevAddr( payload );
+
+    if( ( devAddr == MacCtx.NvmCtx->DevAddr ) || ( GetMcCtx( devAddr ) != NULL ) )
+    {
+        return LORAMAC_EVENT_INFO_STATUS_OK;
+    }
+    MacCtx.RxDropStats.Address++;
+    return LORAMAC_EVENT_INFO_STATUS_ADDRESS_FAIL;
+}
+
+/*!
+ * \brief Adds the preamble offset of the received downlink to the RX window
+ *        timing statistics
+ *
+ * \param [IN] datarate Downlink datarate
+ * \param [IN] size     Downlink PHY payload size
+ */
+static void UpdateRxTimingStats( uint8_t datarate, uint16_t size )
+{
+#ifdef LORAMAC_RX_TIMING_STATS_ENABLED
+    RxTimingStats_t* stats;
+    int32_t offset;
+
+    if( datarate >= LORAMAC_RX_TIMING_STATS_NB_DR )
+    {
+        return;
+    }
+    stats = &MacCtx.RxTimingStats[datarate];
+
+    // The preamble started one time-on-air before the RxDone event
+    offset = ( int32_t )TimerTicks2Us( RxDoneParams.LastRxDoneTicks - MacCtx.RxWindowStartTicks ) -
+             ( int32_t )RegionGetRxTimeOnAirUs( MacCtx.NvmCtx->Region, datarate, ( uint8_t )size );
+
+    if( ( stats->NbSamples == 0 ) || ( offset < stats->MinOffset ) )
+    {
+        stats->MinOffset = offset;
+    }
+    if( ( stats->NbSamples == 0 ) || ( offset > stats->MaxOffset ) )
+    {
+        stats->MaxOffset = offset;
+    }
+    stats->NbSamples++;
+    MacCtx.RxTimingSums[datarate] += offset;
+    stats->MeanOffset = ( int32_t )( MacCtx.RxTimingSums[datarate] / ( int64_t )stats->NbSamples );
+#endif
+}
+
+static void ProcessRadioRxDone( void )
+{
+    LoRaMacHeader_t macHdr;
+    ApplyCFListParams_t applyCFList;
     LoRaMacCryptoStatus_t macCryptoStatus = LORAMAC_CRYPTO_ERROR;
 
     LoRaMacMessageData_t macMsgData;
@@ -946,6 +2479,22 @@ static void ProcessRadioRxDone( void )
     AddressIdentifier_t addrID = UNICAST_DEV_ADDR;
     FCntIdentifier_t fCntID;
 
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    // The radio keeps listening while the queued frames are processed
+    if( MacCtx.RxCQueueProcessing == false )
+#endif
+    {
+        Radio.Sleep( );
+    }
+
+    if( ( MacCtx.RxSlot == RX_SLOT_WIN_CLASS_C ) &&
+        ( FilterRxFrame( payload, size ) != LORAMAC_EVENT_INFO_STATUS_OK ) )
+    {
+        // Drop the frames of the other devices right away. LoRaMacProcess
+        // reopens the window and a pending RX2 window is kept.
+        return;
+    }
+
     MacCtx.McpsConfirm.AckReceived = false;
     MacCtx.McpsIndication.Rssi = rssi;
     MacCtx.McpsIndication.Snr = snr;
@@ -962,11 +2511,10 @@ static void ProcessRadioRxDone( void )
     MacCtx.McpsIndication.DevAddress = 0;
     MacCtx.McpsIndication.DeviceTimeAnsReceived = false;
 
-    Radio.Sleep( );
     TimerStop( &MacCtx.RxWindowTimer2 );
 
     // This function must be called even if we are not in class b mode yet.
-    if( LoRaMacClassBRxBeacon( payload, size ) == true )
+    if( LoRaMacClassBRxBeacon( payload, size, RxDoneParams.LastRxDone ) == true )
     {
         MacCtx.MlmeIndication.BeaconInfo.Rssi = rssi;
         MacCtx.MlmeIndication.BeaconInfo.Snr = snr;
@@ -989,6 +2537,21 @@ static void ProcessRadioRxDone( void )
         }
     }
 
+    if( ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_1 ) || ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_2 ) )
+    {
+        UpdateRxTimingStats( MacCtx.McpsIndication.RxDatarate, size );
+    }
+
+    if( MacCtx.RxSlot != RX_SLOT_WIN_CLASS_C )
+    {
+        MacCtx.McpsIndication.Status = FilterRxFrame( payload, size );
+        if( MacCtx.McpsIndication.Status != LORAMAC_EVENT_INFO_STATUS_OK )
+        {
+            PrepareRxDoneAbort( );
+            return;
+        }
+    }
+
     macHdr.Value = payload[pktHeaderLen++];
 
     switch( macHdr.Bits.MType )
@@ -1004,7 +2567,11 @@ static void ProcessRadioRxDone( void )
                 PrepareRxDoneAbort( );
                 return;
             }
+            // Decryption and MIC check in a single burst, the session keys are
+            // derived once the MAC events are handled
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
             macCryptoStatus = LoRaMacCryptoHandleJoinAccept( JOIN_REQ, SecureElementGetJoinEui( ), &macMsgJoinAccept );
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
 
             if( LORAMAC_CRYPTO_SUCCESS == macCryptoStatus )
             {
@@ -1061,29 +2628,21 @@ static void ProcessRadioRxDone( void )
             // Intentional fall through
         case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
             // Check if the received payload size is valid
-            getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
-            getPhy.Datarate = MacCtx.McpsIndication.RxDatarate;
-            getPhy.Attribute = PHY_MAX_PAYLOAD;
-
-            // Get the maximum payload length
-            if( MacCtx.NvmCtx->RepeaterSupport == true )
-            {
-                getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
-            }
-            phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-            if( MAX( 0, ( int16_t )( ( int16_t ) size - ( int16_t ) LORA_MAC_FRMPAYLOAD_OVERHEAD ) ) > ( int16_t )phyParam.Value )
+            if( MAX( 0, ( int16_t )( ( int16_t ) size - ( int16_t ) LORA_MAC_FRMPAYLOAD_OVERHEAD ) ) >
+                ( int16_t )GetMaxPayload( &MacCtx.PhyParams.DownlinkMaxPayload, MacCtx.NvmCtx->MacParams.DownlinkDwellTime, MacCtx.McpsIndication.RxDatarate ) )
             {
+                MacCtx.RxDropStats.Length++;
                 MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
                 PrepareRxDoneAbort( );
                 return;
             }
+            // The frame is parsed and decrypted in the radio buffer
             macMsgData.Buffer = payload;
             macMsgData.BufSize = size;
-            macMsgData.FRMPayload = MacCtx.RxPayload;
-            macMsgData.FRMPayloadSize = LORAMAC_PHY_MAXPAYLOAD;
 
             if( LORAMAC_PARSER_SUCCESS != LoRaMacParserData( &macMsgData ) )
             {
+                MacCtx.RxDropStats.Length++;
                 MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
                 PrepareRxDoneAbort( );
                 return;
@@ -1103,31 +2662,24 @@ static void ProcessRadioRxDone( void )
             //Check if it is a multicast message
             multicast = 0;
             downLinkCounter = 0;
-            for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
-            {
-                if( ( MacCtx.NvmCtx->MulticastChannelList[i].ChannelParams.Address == macMsgData.FHDR.DevAddr ) &&
-                    ( MacCtx.NvmCtx->MulticastChannelList[i].ChannelParams.IsEnabled == true ) )
+            MulticastCtx_t* mcCtx = GetMcCtx( macMsgData.FHDR.DevAddr );
+            if( mcCtx != NULL )
+            {
+                multicast = 1;
+                addrID = mcCtx->ChannelParams.GroupID;
+                downLinkCounter = *( mcCtx->DownLinkCounter );
+                address = mcCtx->ChannelParams.Address;
+                if( MacCtx.NvmCtx->DeviceClass == CLASS_C )
                 {
-                    multicast = 1;
-                    addrID = MacCtx.NvmCtx->MulticastChannelList[i].ChannelParams.GroupID;
-                    downLinkCounter = *( MacCtx.NvmCtx->MulticastChannelList[i].DownLinkCounter );
-                    address = MacCtx.NvmCtx->MulticastChannelList[i].ChannelParams.Address;
-                    if( MacCtx.NvmCtx->DeviceClass == CLASS_C )
-                    {
-                        MacCtx.McpsIndication.RxSlot = RX_SLOT_WIN_CLASS_C_MULTICAST;
-                    }
-                    break;
+                    MacCtx.McpsIndication.RxSlot = RX_SLOT_WIN_CLASS_C_MULTICAST;
                 }
             }
 
-            // Get maximum allowed counter difference
-            getPhy.Attribute = PHY_MAX_FCNT_GAP;
-            phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-
             // Get downlink frame counter value
-            macCryptoStatus = GetFCntDown( addrID, fType, &macMsgData, MacCtx.NvmCtx->Version, phyParam.Value, &fCntID, &downLinkCounter );
+            macCryptoStatus = GetFCntDown( addrID, fType, &macMsgData, MacCtx.NvmCtx->Version, MacCtx.PhyParams.MaxFCntGap, &fCntID, &downLinkCounter );
             if( macCryptoStatus != LORAMAC_CRYPTO_SUCCESS )
             {
+                MacCtx.RxDropStats.FCnt++;
                 if( macCryptoStatus == LORAMAC_CRYPTO_FAIL_FCNT_DUPLICATED )
                 {
                     // Catch the case of repeated downlink frame counter
@@ -1152,17 +2704,23 @@ static void ProcessRadioRxDone( void )
                 return;
             }
 
+            TRACE_BEGIN( TRACE_PROBE_CRYPTO_UNSECURE );
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
             macCryptoStatus = LoRaMacCryptoUnsecureMessage( addrID, address, fCntID, downLinkCounter, &macMsgData );
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
+            TRACE_END( TRACE_PROBE_CRYPTO_UNSECURE );
             if( macCryptoStatus != LORAMAC_CRYPTO_SUCCESS )
             {
                 if( macCryptoStatus == LORAMAC_CRYPTO_FAIL_ADDRESS )
                 {
                     // We are not the destination of this frame.
+                    MacCtx.RxDropStats.Address++;
                     MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_ADDRESS_FAIL;
                 }
                 else
                 {
                     // MIC calculation fail
+                    MacCtx.RxDropStats.Mic++;
                     MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_MIC_FAIL;
                 }
                 PrepareRxDoneAbort( );
@@ -1173,6 +2731,10 @@ static void ProcessRadioRxDone( void )
             MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
             MacCtx.McpsIndication.Multicast = multicast;
             MacCtx.McpsIndication.FramePending = macMsgData.FHDR.FCtrl.Bits.FPending;
+            if( ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_1 ) || ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_2 ) )
+            {
+                MacCtx.FPendingUplinkRequested = ( macMsgData.FHDR.FCtrl.Bits.FPending == 1 );
+            }
             MacCtx.McpsIndication.Buffer = NULL;
             MacCtx.McpsIndication.BufferSize = 0;
             MacCtx.McpsIndication.DownLinkCounter = downLinkCounter;
@@ -1186,6 +2748,20 @@ static void ProcessRadioRxDone( void )
                 ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_2 ) )
             {
                 MacCtx.NvmCtx->AdrAckCounter = 0;
+                if( MacCtx.AdrStrategy->OnDownlink != NULL )
+                {
+                    MacCtx.AdrStrategy->OnDownlink( rssi, snr );
+                    MacCtx.TxInfoCache.IsValid = false;
+                }
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+                RxGainOnDownlink( snr, MacCtx.McpsIndication.RxDatarate );
+#endif
+                UpdateChannelQuality( true, rssi, snr );
+                if( ( MacCtx.NodeAckRequested == true ) && ( MacCtx.McpsConfirm.AckReceived == true ) &&
+                    ( MacCtx.RetryPolicy->OnAck != NULL ) )
+                {
+                    MacCtx.RetryPolicy->OnAck( MacCtx.Channel, MacCtx.McpsIndication.RxSlot, snr );
+                }
             }
 
             // MCPS Indication and ack requested handling
@@ -1202,6 +2778,13 @@ static void ProcessRadioRxDone( void )
                     {
                         MacCtx.NvmCtx->LastRxMic = macMsgData.MIC;
                     }
+                    // The downlinks of a burst share the acknowledgement
+                    if( ( MacCtx.McpsIndication.RxSlot == RX_SLOT_WIN_CLASS_C ) && ( MacCtx.ClassCAckDelay != 0 ) &&
+                        ( TimerIsStarted( &MacCtx.ClassCAckTimer ) == false ) )
+                    {
+                        TimerSetValue( &MacCtx.ClassCAckTimer, MacCtx.ClassCAckDelay );
+                        TimerStart( &MacCtx.ClassCAckTimer );
+                    }
                     MacCtx.McpsIndication.McpsIndication = MCPS_CONFIRMED;
                 }
                 else
@@ -1284,11 +2867,9 @@ static void ProcessRadioRxDone( void )
 
             break;
         case FRAME_TYPE_PROPRIETARY:
-            memcpy1( MacCtx.RxPayload, &payload[pktHeaderLen], size - pktHeaderLen );
-
             MacCtx.McpsIndication.McpsIndication = MCPS_PROPRIETARY;
             MacCtx.McpsIndication.Status = LORAMAC_EVENT_INFO_STATUS_OK;
-            MacCtx.McpsIndication.Buffer = MacCtx.RxPayload;
+            MacCtx.McpsIndication.Buffer = &payload[pktHeaderLen];
             MacCtx.McpsIndication.BufferSize = size - pktHeaderLen;
 
             MacCtx.MacFlags.Bits.McpsInd = 1;
@@ -1342,87 +2923,264 @@ static void HandleRadioRxErrorTimeout( LoRaMacEventInfoStatus_t rx1EventInfoStat
 
     if( MacCtx.NvmCtx->DeviceClass != CLASS_C )
     {
-        Radio.Sleep( );
+        if( ( MacCtx.NvmCtx->DeviceClass == CLASS_A ) && ( MacCtx.RxSlot == RX_SLOT_WIN_1 ) )
+        {
+            // RX1 is over, configure the radio for RX2 before sleeping
+            SetRxWindow2Config( );
+            PrepareRxWindow( &MacCtx.RxWindow2Config );
+            SetRxWaitMode( true );
+        }
+        Radio.Sleep( );
+    }
+
+    if( LoRaMacClassBIsBeaconExpected( ) == true )
+    {
+        LoRaMacClassBSetBeaconState( BEACON_STATE_TIMEOUT );
+        LoRaMacClassBBeaconTimerEvent( NULL );
+        classBRx = true;
+    }
+    if( MacCtx.NvmCtx->DeviceClass == CLASS_B )
+    {
+        if( LoRaMacClassBIsPingExpected( ) == true )
+        {
+            LoRaMacClassBSetPingSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
+            LoRaMacClassBPingSlotTimerEvent( NULL );
+            classBRx = true;
+        }
+        if( LoRaMacClassBIsMulticastExpected( ) == true )
+        {
+            LoRaMacClassBSetMulticastSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
+            LoRaMacClassBMulticastSlotTimerEvent( NULL );
+            classBRx = true;
+        }
+    }
+
+    if( classBRx == false )
+    {
+        if( MacCtx.RxSlot == RX_SLOT_WIN_1 )
+        {
+            if( MacCtx.NodeAckRequested == true )
+            {
+                MacCtx.McpsConfirm.Status = rx1EventInfoStatus;
+            }
+            LoRaMacConfirmQueueSetStatusCmn( rx1EventInfoStatus );
+        }
+        else
+        {
+            if( MacCtx.NodeAckRequested == true )
+            {
+                MacCtx.McpsConfirm.Status = rx2EventInfoStatus;
+            }
+            LoRaMacConfirmQueueSetStatusCmn( rx2EventInfoStatus );
+
+            if( MacCtx.NvmCtx->DeviceClass != CLASS_C )
+            {
+                MacCtx.MacFlags.Bits.MacDone = 1;
+            }
+        }
+    }
+
+    UpdateRxSlotIdleState( );
+}
+
+static void ProcessRadioRxError( void )
+{
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+    if( ( MacCtx.RxSlot == RX_SLOT_WIN_1 ) || ( MacCtx.RxSlot == RX_SLOT_WIN_2 ) )
+    {
+        RxGainOnFailure( );
+    }
+#endif
+    HandleRadioRxErrorTimeout( LORAMAC_EVENT_INFO_STATUS_RX1_ERROR, LORAMAC_EVENT_INFO_STATUS_RX2_ERROR );
+}
+
+static void ProcessRadioRxTimeout( void )
+{
+    HandleRadioRxErrorTimeout( LORAMAC_EVENT_INFO_STATUS_RX1_TIMEOUT, LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT );
+}
+
+static void ProcessRadioCadDone( void )
+{
+    if( ( MacCtx.MacState & LORAMAC_LBT_CAD ) != LORAMAC_LBT_CAD )
+    {
+        return;
+    }
+    SetMacState( MacCtx.MacState & ~LORAMAC_LBT_CAD );
+
+    if( MacCtx.LbtChannelBusy == false )
+    {
+        SendFrame( );
+        return;
+    }
+
+    // Channel busy, select another one right away
+    SetMacState( MacCtx.MacState & ~LORAMAC_TX_RUNNING );
+    MacCtx.LbtCadTrials++;
+    if( MacCtx.LbtCadTrials < LORAMAC_LBT_CAD_MAX_TRIALS )
+    {
+        OnTxDelayedTimerEvent( NULL );
+    }
+    else
+    {
+        MacCtx.LbtCadTrials = 0;
+        MacCtx.McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_TX_CHANNEL_BUSY;
+        LoRaMacConfirmQueueSetStatusCmn( LORAMAC_EVENT_INFO_STATUS_TX_CHANNEL_BUSY );
+        StopRetransmission( );
+        MacCtx.MacFlags.Bits.MacDone = 1;
+    }
+}
+
+/*!
+ * \brief Checks if a queued class C frame can be processed. The frames wait
+ *        for the end of the uplinks RX windows.
+ *
+ * \retval pending True if the next LoRaMacProcess call processes a frame
+ */
+static bool IsRxCQueuePending( void )
+{
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    return ( MacCtx.RxCQueueCnt != 0 ) && ( MacCtx.RxCQueueProcessing == false ) &&
+           ( MacCtx.RxSlot == RX_SLOT_WIN_CLASS_C );
+#else
+    return false;
+#endif
+}
+
+/*!
+ * \brief Processes the oldest queued class C frame. The frame stays in the
+ *        queue until its indication is handled.
+ */
+static void ProcessRxCQueue( void )
+{
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    LoRaMacRxCQueueFrame_t* frame = &MacCtx.RxCQueue[MacCtx.RxCQueueHead];
+
+    if( IsRxCQueuePending( ) == false )
+    {
+        return;
     }
 
-    if( LoRaMacClassBIsBeaconExpected( ) == true )
+    RxDoneParams.LastRxDone = frame->LastRxDone;
+    RxDoneParams.LastRxDoneTicks = frame->LastRxDoneTicks;
+    RxDoneParams.Payload = frame->Payload;
+    RxDoneParams.Size = frame->Size;
+    RxDoneParams.Rssi = frame->Rssi;
+    RxDoneParams.Snr = frame->Snr;
+    MacCtx.RxCQueueProcessing = true;
+    if( MacCtx.RxCRadio != NULL )
     {
-        LoRaMacClassBSetBeaconState( BEACON_STATE_TIMEOUT );
-        LoRaMacClassBBeaconTimerEvent( NULL );
-        classBRx = true;
+        // The class A exchanges of the other radio reuse the indication
+        MacCtx.McpsIndication.RxDatarate = MacCtx.RxCDatarate;
     }
-    if( MacCtx.NvmCtx->DeviceClass == CLASS_B )
+
+    UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX_DONE_PROCESS, frame->LastRxDoneTicks );
+    TRACE_BEGIN( TRACE_PROBE_RADIO_RX_DONE );
+    ProcessRadioRxDone( );
+    TRACE_END( TRACE_PROBE_RADIO_RX_DONE );
+    UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX_DONE_PROCESSED, frame->LastRxDoneTicks );
+#endif
+}
+
+/*!
+ * \brief Frees the processed class C frame once its indication is handled
+ *        and schedules the processing of the next one
+ */
+static void ReleaseRxCQueueFrame( void )
+{
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    if( MacCtx.RxCQueueProcessing == true )
     {
-        if( LoRaMacClassBIsPingExpected( ) == true )
-        {
-            LoRaMacClassBSetPingSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
-            LoRaMacClassBPingSlotTimerEvent( NULL );
-            classBRx = true;
-        }
-        if( LoRaMacClassBIsMulticastExpected( ) == true )
+        CRITICAL_SECTION_BEGIN( );
+        if( MacCtx.RxCQueueCnt != 0 )
         {
-            LoRaMacClassBSetMulticastSlotState( PINGSLOT_STATE_CALC_PING_OFFSET );
-            LoRaMacClassBMulticastSlotTimerEvent( NULL );
-            classBRx = true;
+            MacCtx.RxCQueueHead = ( MacCtx.RxCQueueHead + 1 ) % LORAMAC_CLASS_C_RX_QUEUE_SIZE;
+            MacCtx.RxCQueueCnt--;
         }
+        CRITICAL_SECTION_END( );
+        MacCtx.RxCQueueProcessing = false;
     }
 
-    if( classBRx == false )
+    if( ( IsRxCQueuePending( ) == true ) &&
+        ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
     {
-        if( MacCtx.RxSlot == RX_SLOT_WIN_1 )
-        {
-            if( MacCtx.NodeAckRequested == true )
-            {
-                MacCtx.McpsConfirm.Status = rx1EventInfoStatus;
-            }
-            LoRaMacConfirmQueueSetStatusCmn( rx1EventInfoStatus );
-        }
-        else
-        {
-            if( MacCtx.NodeAckRequested == true )
-            {
-                MacCtx.McpsConfirm.Status = rx2EventInfoStatus;
-            }
-            LoRaMacConfirmQueueSetStatusCmn( rx2EventInfoStatus );
-
-            if( MacCtx.NvmCtx->DeviceClass != CLASS_C )
-            {
-                MacCtx.MacFlags.Bits.MacDone = 1;
-            }
-        }
+        MacCtx.MacCallbacks->MacProcessNotify( );
     }
+#endif
+}
 
-    UpdateRxSlotIdleState( );
+/*!
+ * \brief Checks if the radio still listens with the class C window
+ *        parameters, in which case the window must not be reopened
+ *
+ * \retval listening True if the radio needs no new setup
+ */
+static bool IsRxCWindowListening( void )
+{
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    if( MacCtx.RxCRadio != NULL )
+    {
+        return ( MacCtx.RxCWindowArmed == true ) && ( MacCtx.RxCRadioRestart == false ) &&
+               ( MacCtx.RxCRadio->GetStatus( ) == RF_RX_RUNNING );
+    }
+    // Reopening the window would abort a frame being received
+    return ( MacCtx.RxCQueueDepth != 0 ) && ( MacCtx.RxCWindowArmed == true ) &&
+           ( Radio.GetStatus( ) == RF_RX_RUNNING );
+#else
+    return false;
+#endif
 }
 
-static void ProcessRadioRxError( void )
+/*!
+ * \brief Checks if the class C window has to be reopened
+ *
+ * \retval closed True if the class C window isn't listening
+ */
+static bool IsRxCWindowClosed( void )
 {
-    HandleRadioRxErrorTimeout( LORAMAC_EVENT_INFO_STATUS_RX1_ERROR, LORAMAC_EVENT_INFO_STATUS_RX2_ERROR );
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    if( MacCtx.RxCRadio != NULL )
+    {
+        // The dedicated radio listens during the class A exchanges as well
+        return ( MacCtx.NvmCtx->DeviceClass == CLASS_C ) && ( IsRxCWindowListening( ) == false );
+    }
+#endif
+    return ( MacCtx.RxSlot == RX_SLOT_WIN_CLASS_C ) && ( IsRxCWindowListening( ) == false );
 }
 
-static void ProcessRadioRxTimeout( void )
+/*!
+ * \brief Checks if the dedicated class C radio stopped listening on error
+ *
+ * \retval pending True if the next LoRaMacProcess call restarts the reception
+ */
+static bool IsRxCRadioRestartPending( void )
 {
-    HandleRadioRxErrorTimeout( LORAMAC_EVENT_INFO_STATUS_RX1_TIMEOUT, LORAMAC_EVENT_INFO_STATUS_RX2_TIMEOUT );
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    return ( MacCtx.RxCRadio != NULL ) && ( MacCtx.RxCRadioRestart == true );
+#else
+    return false;
+#endif
 }
 
 static void LoRaMacHandleIrqEvents( void )
 {
     LoRaMacRadioEvents_t events;
 
-    CRITICAL_SECTION_BEGIN( );
-    events = LoRaMacRadioEvents;
-    LoRaMacRadioEvents.Value = 0;
-    CRITICAL_SECTION_END( );
+    events.Value = AtomicFetchAndClear( &LoRaMacRadioEvents.Value );
 
     if( events.Value != 0 )
     {
         if( events.Events.TxDone == 1 )
         {
+            UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_TX_DONE_PROCESS, TxDoneParams.CurTicks );
             ProcessRadioTxDone( );
         }
         if( events.Events.RxDone == 1 )
         {
+            UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX_DONE_PROCESS, RxDoneParams.LastRxDoneTicks );
+            TRACE_BEGIN( TRACE_PROBE_RADIO_RX_DONE );
             ProcessRadioRxDone( );
+            TRACE_END( TRACE_PROBE_RADIO_RX_DONE );
+            UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX_DONE_PROCESSED, RxDoneParams.LastRxDoneTicks );
         }
         if( events.Events.TxTimeout == 1 )
         {
@@ -1436,6 +3194,14 @@ static void LoRaMacHandleIrqEvents( void )
         {
             ProcessRadioRxTimeout( );
         }
+        if( events.Events.CadDone == 1 )
+        {
+            ProcessRadioCadDone( );
+        }
+    }
+    if( events.Events.RxDone == 0 )
+    {
+        ProcessRxCQueue( );
     }
 }
 
@@ -1459,9 +3225,14 @@ static void LoRaMacHandleRequestEvents( void )
 {
     // Handle events
     LoRaMacFlags_t reqEvents = MacCtx.MacFlags;
+    uint8_t* txAppBuffer = NULL;
 
     if( MacCtx.MacState == LORAMAC_IDLE )
     {
+        // The frame is no longer needed. Released before the confirms so
+        // that they can send again.
+        txAppBuffer = ReleasePktBuffer( );
+
         // Update event bits
         if( MacCtx.MacFlags.Bits.McpsReq == 1 )
         {
@@ -1479,6 +3250,8 @@ static void LoRaMacHandleRequestEvents( void )
         // Handle callbacks
         if( reqEvents.Bits.McpsReq == 1 )
         {
+            ProfileRequestDone( ProfileGetMcpsRequest( MacCtx.McpsConfirm.McpsRequest ) );
+            UplinkCostFinalize( );
             MacCtx.MacPrimitives->MacMcpsConfirm( &MacCtx.McpsConfirm );
         }
 
@@ -1489,6 +3262,10 @@ static void LoRaMacHandleRequestEvents( void )
             {
                 MacCtx.MacFlags.Bits.MlmeReq = 1;
             }
+            else
+            {
+                ProfileRequestDone( LORAMAC_PROFILE_REQUEST_MLME );
+            }
         }
 
         // Start beaconing again
@@ -1496,6 +3273,9 @@ static void LoRaMacHandleRequestEvents( void )
 
         // Procedure done. Reset variables.
         MacCtx.MacFlags.Bits.MacDone = 0;
+
+        // The application buffer is valid up to the MCPS-Confirm return
+        PacketPoolFree( txAppBuffer );
     }
 }
 
@@ -1537,6 +3317,8 @@ static void LoRaMacHandleIndicationEvents( void )
     if( MacCtx.MacFlags.Bits.McpsInd == 1 )
     {
         MacCtx.MacFlags.Bits.McpsInd = 0;
+        // The MCPS indications follow a RxDone event
+        UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_MCPS_INDICATION, RxDoneParams.LastRxDoneTicks );
         MacCtx.MacPrimitives->MacMcpsIndication( &MacCtx.McpsIndication );
     }
 }
@@ -1558,6 +3340,22 @@ static void LoRaMacHandleMcpsRequest( void )
         {
             if( MacCtx.AckTimeoutRetry == true )
             {
+                // A TX timeout tells nothing about the channel
+                if( ( MacCtx.McpsConfirm.AckReceived == false ) && ( MacCtx.McpsConfirm.Status != LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT ) &&
+                    ( MacCtx.RetryPolicy->OnAck != NULL ) )
+                {
+                    MacCtx.RetryPolicy->OnAck( MacCtx.Channel, RX_SLOT_NONE, 0 );
+                }
+                if( ( MacCtx.McpsConfirm.AckReceived == false ) && ( MacCtx.McpsConfirm.Status != LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT ) )
+                {
+                    UpdateChannelQuality( false, 0, 0 );
+                }
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+                if( ( MacCtx.McpsConfirm.AckReceived == false ) && ( MacCtx.McpsConfirm.Status != LORAMAC_EVENT_INFO_STATUS_TX_TIMEOUT ) )
+                {
+                    RxGainOnFailure( );
+                }
+#endif
                 stopRetransmission = CheckRetransConfirmedUplink( );
 
                 if( MacCtx.NvmCtx->Version.Fields.Minor == 0 )
@@ -1581,7 +3379,7 @@ static void LoRaMacHandleMcpsRequest( void )
         if( stopRetransmission == true )
         {// Stop retransmission
             TimerStop( &MacCtx.TxDelayedTimer );
-            MacCtx.MacState &= ~LORAMAC_TX_DELAYED;
+            SetMacState( MacCtx.MacState & ~LORAMAC_TX_DELAYED );
             StopRetransmission( );
         }
         else if( waitForRetransmission == false )
@@ -1606,12 +3404,12 @@ static void LoRaMacHandleMlmeRequest( void )
             {// Node joined successfully
                 MacCtx.ChannelsNbTransCounter = 0;
             }
-            MacCtx.MacState &= ~LORAMAC_TX_RUNNING;
+            SetMacState( MacCtx.MacState & ~LORAMAC_TX_RUNNING );
         }
         else if( ( LoRaMacConfirmQueueIsCmdActive( MLME_TXCW ) == true ) ||
                  ( LoRaMacConfirmQueueIsCmdActive( MLME_TXCW_1 ) == true ) )
         {
-            MacCtx.MacState &= ~LORAMAC_TX_RUNNING;
+            SetMacState( MacCtx.MacState & ~LORAMAC_TX_RUNNING );
         }
     }
 }
@@ -1623,7 +3421,7 @@ static uint8_t LoRaMacCheckForBeaconAcquisition( void )
     {
         if( MacCtx.MacFlags.Bits.MlmeReq == 1 )
         {
-            MacCtx.MacState &= ~LORAMAC_TX_RUNNING;
+            SetMacState( MacCtx.MacState & ~LORAMAC_TX_RUNNING );
             return 0x01;
         }
     }
@@ -1635,17 +3433,50 @@ static void LoRaMacCheckForRxAbort( void )
     // A error occurs during receiving
     if( ( MacCtx.MacState & LORAMAC_RX_ABORT ) == LORAMAC_RX_ABORT )
     {
-        MacCtx.MacState &= ~LORAMAC_RX_ABORT;
-        MacCtx.MacState &= ~LORAMAC_TX_RUNNING;
+        SetMacState( MacCtx.MacState & ~LORAMAC_RX_ABORT );
+        SetMacState( MacCtx.MacState & ~LORAMAC_TX_RUNNING );
     }
 }
 
 
+bool LoRaMacHasPendingEvents( void )
+{
+    LoRaMacFlags_t macEvents = MacCtx.MacFlags;
+
+    // The request bits stay set until the procedure completes. The
+    // completion is signaled by the other bits.
+    macEvents.Bits.McpsReq = 0;
+    macEvents.Bits.MlmeReq = 0;
+
+    if( ( LoRaMacRadioEvents.Value != 0 ) ||
+        ( macEvents.Value != 0 ) ||
+        ( LoRaMacClassBHasPendingEvents( ) == true ) ||
+        ( IsRxCQueuePending( ) == true ) ||
+        ( IsRxCRadioRestartPending( ) == true ) ||
+        ( ( LoRaMacTxQueueGetCnt( ) != 0 ) && ( LoRaMacIsBusy( ) == false ) ) )
+    {
+        return true;
+    }
+    return false;
+}
+
 void LoRaMacProcess( void )
 {
     uint8_t noTx = false;
 
+    // Every state change goes through a radio, timer or class B event.
+    // Without any of them there is nothing to do, the class C window is
+    // still open as well. The queued uplinks are sent as soon as the MAC is
+    // idle.
+    if( LoRaMacHasPendingEvents( ) == false )
+    {
+        return;
+    }
+    MacCtx.UplinkCostProcessTicks = TimerGetCurrentTicks( );
+
+    ProfilePassBegin( );
     LoRaMacHandleIrqEvents( );
+    ProfilePassEnd( LORAMAC_PROFILE_PASS_IRQ_EVENTS );
     LoRaMacClassBProcess( );
 
     // MAC proceeded a state and is ready to check
@@ -1665,21 +3496,40 @@ void LoRaMacProcess( void )
             LoRaMacHandleMlmeRequest( );
             LoRaMacHandleMcpsRequest( );
         }
+        ProfilePassBegin( );
         LoRaMacHandleRequestEvents( );
+        ProfilePassEnd( LORAMAC_PROFILE_PASS_REQUEST_EVENTS );
         LoRaMacHandleScheduleUplinkEvent( );
         LoRaMacEnableRequests( LORAMAC_REQUEST_HANDLING_ON );
     }
+    ProfilePassBegin( );
     LoRaMacHandleIndicationEvents( );
-    if( MacCtx.RxSlot == RX_SLOT_WIN_CLASS_C )
+    ProfilePassEnd( LORAMAC_PROFILE_PASS_INDICATION_EVENTS );
+    ReleaseRxCQueueFrame( );
+    // Session keys of an accepted join, before the first uplink uses them
+    LoRaMacCryptoDeriveSessionKeys( );
+    LoRaMacHandleTxQueue( );
+    LoRaMacHandleFPendingUplink( );
+    LoRaMacHandleClassCAckUplink( );
+    if( IsRxCWindowClosed( ) == true )
     {
         OpenContinuousRxCWindow( );
     }
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+    if( ( MacCtx.MacState == LORAMAC_IDLE ) && ( MacCtx.NvmCtx->NetworkActivation != ACTIVATION_TYPE_NONE ) )
+    {
+        // The address and the frame counter of the next uplink are known,
+        // its encryption is then a plain XOR
+        LoRaMacCryptoPrecomputeUplinkKeyStream( MacCtx.NvmCtx->DevAddr, GetMaxAppPayloadWithoutFOptsLength( MacCtx.NvmCtx->MacParams.ChannelsDatarate ) );
+    }
+#endif
+    UplinkCostAddMcuTime( MacCtx.UplinkCostProcessTicks );
 }
 
 static void OnTxDelayedTimerEvent( void* context )
 {
     TimerStop( &MacCtx.TxDelayedTimer );
-    MacCtx.MacState &= ~LORAMAC_TX_DELAYED;
+    SetMacState( MacCtx.MacState & ~LORAMAC_TX_DELAYED );
 
     // Schedule frame, allow delayed frame transmissions
     switch( ScheduleTx( true ) )
@@ -1704,32 +3554,62 @@ static void OnTxDelayedTimerEvent( void* context )
 
 static void OnRxWindow1TimerEvent( void* context )
 {
-    MacCtx.RxWindow1Config.Channel = MacCtx.Channel;
-    MacCtx.RxWindow1Config.DrOffset = MacCtx.NvmCtx->MacParams.Rx1DrOffset;
-    MacCtx.RxWindow1Config.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
-    MacCtx.RxWindow1Config.RepeaterSupport = MacCtx.NvmCtx->RepeaterSupport;
-    MacCtx.RxWindow1Config.RxContinuous = false;
-    MacCtx.RxWindow1Config.RxSlot = RX_SLOT_WIN_1;
-
+    SetRxWaitMode( false );
+    UpdateIrqLatencyStats( LORAMAC_IRQ_LATENCY_RX1_OPENING, TxDoneParams.CurTicks + MacCtx.RxWindow1DelayTicks );
+    if( MacCtx.RxWindowPrepared != RX_SLOT_WIN_1 )
+    {
+        SetRxWindow1Config( );
+    }
     RxWindowSetup( &MacCtx.RxWindowTimer1, &MacCtx.RxWindow1Config );
 }
 
 static void OnRxWindow2TimerEvent( void* context )
 {
+    SetRxWaitMode( false );
     // Check if we are processing Rx1 window.
     // If yes, we don't setup the Rx2 window.
     if( MacCtx.RxSlot == RX_SLOT_WIN_1 )
     {
         return;
     }
+    if( MacCtx.RxWindowPrepared != RX_SLOT_WIN_2 )
+    {
+        SetRxWindow2Config( );
+    }
+    RxWindowSetup( &MacCtx.RxWindowTimer2, &MacCtx.RxWindow2Config );
+}
+
+static void SetRxWindow1Config( void )
+{
+    MacCtx.RxWindow1Config.Channel = MacCtx.Channel;
+    MacCtx.RxWindow1Config.DrOffset = MacCtx.NvmCtx->MacParams.Rx1DrOffset;
+    MacCtx.RxWindow1Config.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
+    MacCtx.RxWindow1Config.RepeaterSupport = MacCtx.NvmCtx->RepeaterSupport;
+    MacCtx.RxWindow1Config.RxContinuous = false;
+    MacCtx.RxWindow1Config.RxSlot = RX_SLOT_WIN_1;
+}
+
+static void SetRxWindow2Config( void )
+{
     MacCtx.RxWindow2Config.Channel = MacCtx.Channel;
     MacCtx.RxWindow2Config.Frequency = MacCtx.NvmCtx->MacParams.Rx2Channel.Frequency;
     MacCtx.RxWindow2Config.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
     MacCtx.RxWindow2Config.RepeaterSupport = MacCtx.NvmCtx->RepeaterSupport;
     MacCtx.RxWindow2Config.RxContinuous = false;
     MacCtx.RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
+}
 
-    RxWindowSetup( &MacCtx.RxWindowTimer2, &MacCtx.RxWindow2Config );
+static void PrepareRxWindow( RxConfigParams_t* rxConfig )
+{
+    MacCtx.RxWindowPrepared = RX_SLOT_NONE;
+
+    // Ensure the radio is Idle
+    Radio.Standby( );
+
+    if( RegionRxConfig( MacCtx.NvmCtx->Region, rxConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true )
+    {
+        MacCtx.RxWindowPrepared = rxConfig->RxSlot;
+    }
 }
 
 static void OnAckTimeoutTimerEvent( void* context )
@@ -1750,6 +3630,17 @@ static void OnAckTimeoutTimerEvent( void* context )
     }
 }
 
+static void OnClassCAckTimerEvent( void* context )
+{
+    TimerStop( &MacCtx.ClassCAckTimer );
+
+    MacCtx.ClassCAckUplinkRequested = true;
+    if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+}
+
 static LoRaMacCryptoStatus_t GetFCntDown( AddressIdentifier_t addrID, FType_t fType, LoRaMacMessageData_t* macMsg, Version_t lrWanVersion,
                                           uint16_t maxFCntGap, FCntIdentifier_t* fCntID, uint32_t* currentDown )
 {
@@ -1876,366 +3767,610 @@ static LoRaMacStatus_t SwitchClass( DeviceClass_t deviceClass )
             {
                 MacCtx.NvmCtx->DeviceClass = deviceClass;
 
-                // Set the radio into sleep to setup a defined state
-                Radio.Sleep( );
+                // Set the radio into sleep to setup a defined state
+                Radio.Sleep( );
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+                if( MacCtx.RxCRadio != NULL )
+                {
+                    MacCtx.RxCRadio->Sleep( );
+                }
+                // Drop the class C frames not processed yet
+                CRITICAL_SECTION_BEGIN( );
+                MacCtx.RxCQueueCnt = 0;
+                CRITICAL_SECTION_END( );
+#endif
+
+                status = LORAMAC_STATUS_OK;
+            }
+            break;
+        }
+    }
+
+    return status;
+}
+
+static uint8_t GetMaxAppPayloadWithoutFOptsLength( int8_t datarate )
+{
+    return GetMaxPayload( &MacCtx.PhyParams.UplinkMaxPayload, MacCtx.NvmCtx->MacParams.UplinkDwellTime, datarate );
+}
+
+static int8_t GetFitDatarate( int8_t datarate, uint16_t size )
+{
+    // Private lookup, the scan must not evict the uplink payload lookup
+    LoRaMacMaxPayloadLookup_t lookup = { .Datarate = -1 };
+
+    for( datarate = MAX( datarate, MacCtx.PhyParams.MinTxDr[MacCtx.NvmCtx->MacParams.UplinkDwellTime != 0] );
+         datarate <= MacCtx.PhyParams.MaxTxDr; datarate++ )
+    {
+        if( GetMaxPayload( &lookup, MacCtx.NvmCtx->MacParams.UplinkDwellTime, datarate ) >= size )
+        {
+            return datarate;
+        }
+    }
+    return -1;
+}
+
+static void PhyParamsCacheInit( void )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    getPhy.Attribute = PHY_MAX_FCNT_GAP;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.PhyParams.MaxFCntGap = phyParam.Value;
+
+    getPhy.Attribute = PHY_MIN_TX_DR;
+    for( uint8_t i = 0; i < 2; i++ )
+    {
+        getPhy.UplinkDwellTime = i;
+        phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+        MacCtx.PhyParams.MinTxDr[i] = ( int8_t )phyParam.Value;
+    }
+
+    getPhy.Attribute = PHY_MAX_TX_DR;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.PhyParams.MaxTxDr = ( int8_t )phyParam.Value;
+
+    MacCtx.PhyParams.UplinkMaxPayload.Datarate = -1;
+    MacCtx.PhyParams.DownlinkMaxPayload.Datarate = -1;
+}
+
+static uint8_t GetMaxPayload( LoRaMacMaxPayloadLookup_t* lookup, uint8_t dwellTime, int8_t datarate )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    if( ( lookup->Datarate == datarate ) && ( lookup->DwellTime == dwellTime ) &&
+        ( lookup->RepeaterSupport == MacCtx.NvmCtx->RepeaterSupport ) )
+    {
+        return lookup->MaxPayload;
+    }
+
+    // Setup PHY request
+    getPhy.UplinkDwellTime = dwellTime;
+    getPhy.Datarate = datarate;
+    getPhy.Attribute = PHY_MAX_PAYLOAD;
+
+    // Get the maximum payload length
+    if( MacCtx.NvmCtx->RepeaterSupport == true )
+    {
+        getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
+    }
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+
+    lookup->Datarate = datarate;
+    lookup->DwellTime = dwellTime;
+    lookup->RepeaterSupport = MacCtx.NvmCtx->RepeaterSupport;
+    lookup->MaxPayload = phyParam.Value;
+
+    return lookup->MaxPayload;
+}
+
+static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
+{
+    uint16_t maxN = 0;
+    uint16_t payloadSize = 0;
+
+    maxN = GetMaxAppPayloadWithoutFOptsLength( datarate );
+
+    // Calculate the resulting payload size
+    payloadSize = ( lenN + fOptsLen );
+
+    // Validation of the application payload size
+    if( ( payloadSize <= maxN ) && ( payloadSize <= LORAMAC_PHY_MAXPAYLOAD ) )
+    {
+        return true;
+    }
+    return false;
+}
+
+static size_t GetRequiredMacCmdsSize( void )
+{
+    size_t macCmdsSize = 0;
+    size_t ansCmdsSize = 0;
+
+    LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize );
+    LoRaMacCommandsGetSizeAnsCmds( &ansCmdsSize );
+
+    if( ansCmdsSize <= LORA_MAC_COMMAND_MAX_FOPTS_LENGTH )
+    {
+        return ansCmdsSize;
+    }
+    return macCmdsSize;
+}
+
+static void UpdateDeferredMlmeConfirms( void )
+{
+    MacCommand_t* macCmd = NULL;
+
+    // The ping slot info confirm always waits for its answer
+    LoRaMacConfirmQueueSetRestrictCmn( MLME_LINK_CHECK,
+                                       LoRaMacCommandsGetCmd( MOTE_MAC_LINK_CHECK_REQ, &macCmd ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacConfirmQueueSetRestrictCmn( MLME_DEVICE_TIME,
+                                       LoRaMacCommandsGetCmd( MOTE_MAC_DEVICE_TIME_REQ, &macCmd ) == LORAMAC_COMMANDS_SUCCESS );
+    LoRaMacConfirmQueueSetRestrictCmn( MLME_BEACON_TIMING,
+                                       LoRaMacCommandsGetCmd( MOTE_MAC_BEACON_TIMING_REQ, &macCmd ) == LORAMAC_COMMANDS_SUCCESS );
+}
+
+static void SetMlmeScheduleUplinkIndication( void )
+{
+    MacCtx.MacFlags.Bits.MlmeSchedUplinkInd = 1;
+}
+
+/*!
+ * Maximum number of MAC command answers collected before they are added to
+ * the MAC commands list
+ */
+#define LORA_MAC_COMMAND_ANS_BATCH_SIZE             8
+
+/*!
+ * Context of the processing of the MAC commands of a frame
+ */
+typedef struct sMacCommandsProcessCtx
+{
+    /*!
+     * MAC commands buffer
+     */
+    uint8_t* Payload;
+    /*!
+     * Index of the next byte to process
+     */
+    uint8_t Index;
+    /*!
+     * Size of the MAC commands
+     */
+    uint8_t Size;
+    /*!
+     * SNR of the frame
+     */
+    int8_t Snr;
+    /*!
+     * Set when the LinkAdrReq block was processed
+     */
+    bool AdrBlockFound;
+    /*!
+     * Answers not yet added to the MAC commands list
+     */
+    MacCommand_t Answers[LORA_MAC_COMMAND_ANS_BATCH_SIZE];
+    /*!
+     * Number of answers in Answers
+     */
+    uint8_t NbAnswers;
+}MacCommandsProcessCtx_t;
+
+/*!
+ * MAC command handler
+ */
+typedef struct sMacCommandHandler
+{
+    /*!
+     * Size of the MAC command payload, CID excluded
+     */
+    uint8_t PayloadSize;
+    /*!
+     * Processes the MAC command. The payload starts at ctx->Index and is
+     * PayloadSize bytes long.
+     */
+    void ( *Process )( MacCommandsProcessCtx_t* ctx );
+}MacCommandHandler_t;
 
-                status = LORAMAC_STATUS_OK;
-            }
-            break;
-        }
+/*!
+ * \brief Adds the collected answers to the MAC commands list
+ *
+ * \param [IN] ctx MAC commands processing context
+ */
+static void FlushMacCommandAnswers( MacCommandsProcessCtx_t* ctx )
+{
+    if( ctx->NbAnswers > 0 )
+    {
+        LoRaMacCommandsAddCmds( ctx->Answers, ctx->NbAnswers );
+        ctx->NbAnswers = 0;
     }
-
-    return status;
 }
 
-static uint8_t GetMaxAppPayloadWithoutFOptsLength( int8_t datarate )
+/*!
+ * \brief Collects a MAC command answer
+ *
+ * \param [IN] ctx         MAC commands processing context
+ * \param [IN] cid         MAC command identifier of the answer
+ * \param [IN] payload     Answer payload
+ * \param [IN] payloadSize Answer payload size [0:LORAMAC_COMMADS_MAX_NUM_OF_PARAMS]
+ */
+static void AddMacCommandAnswer( MacCommandsProcessCtx_t* ctx, uint8_t cid, uint8_t* payload, uint8_t payloadSize )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
-
-    // Setup PHY request
-    getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
-    getPhy.Datarate = datarate;
-    getPhy.Attribute = PHY_MAX_PAYLOAD;
+    MacCommand_t* answer;
 
-    // Get the maximum payload length
-    if( MacCtx.NvmCtx->RepeaterSupport == true )
+    if( ctx->NbAnswers == LORA_MAC_COMMAND_ANS_BATCH_SIZE )
     {
-        getPhy.Attribute = PHY_MAX_PAYLOAD_REPEATER;
+        FlushMacCommandAnswers( ctx );
     }
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    answer = &ctx->Answers[ctx->NbAnswers++];
+    answer->CID = cid;
+    answer->PayloadSize = payloadSize;
+    memcpy1( answer->Payload, payload, payloadSize );
+}
+
+static void ProcessLinkCheckAns( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t* payload = &ctx->Payload[ctx->Index];
 
-    return phyParam.Value;
+    if( LoRaMacConfirmQueueIsCmdActive( MLME_LINK_CHECK ) == true )
+    {
+        LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_LINK_CHECK );
+        MacCtx.MlmeConfirm.DemodMargin = payload[0];
+        MacCtx.MlmeConfirm.NbGateways = payload[1];
+    }
 }
 
-static bool ValidatePayloadLength( uint8_t lenN, int8_t datarate, uint8_t fOptsLen )
+static void ProcessLinkAdrReq( MacCommandsProcessCtx_t* ctx )
 {
-    uint16_t maxN = 0;
-    uint16_t payloadSize = 0;
+    LinkAdrReqParams_t linkAdrReq;
+    int8_t linkAdrDatarate = DR_0;
+    int8_t linkAdrTxPower = TX_POWER_0;
+    uint8_t linkAdrNbRep = 0;
+    uint8_t linkAdrNbBytesParsed = 0;
+    uint8_t status = 0;
 
-    maxN = GetMaxAppPayloadWithoutFOptsLength( datarate );
+    if( ctx->AdrBlockFound == true )
+    {
+        return;
+    }
+    ctx->AdrBlockFound = true;
 
-    // Calculate the resulting payload size
-    payloadSize = ( lenN + fOptsLen );
+    // Fill parameter structure. The region parses the whole chain of
+    // contiguous LinkAdrReq commands at once.
+    linkAdrReq.Payload = &ctx->Payload[ctx->Index - 1];
+    linkAdrReq.PayloadSize = ctx->Size - ( ctx->Index - 1 );
+    linkAdrReq.AdrEnabled = MacCtx.NvmCtx->AdrCtrlOn;
+    linkAdrReq.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
+    linkAdrReq.CurrentDatarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
+    linkAdrReq.CurrentTxPower = MacCtx.NvmCtx->MacParams.ChannelsTxPower;
+    linkAdrReq.CurrentNbRep = MacCtx.NvmCtx->MacParams.ChannelsNbTrans;
+    linkAdrReq.Version = MacCtx.NvmCtx->Version;
 
-    // Validation of the application payload size
-    if( ( payloadSize <= maxN ) && ( payloadSize <= LORAMAC_PHY_MAXPAYLOAD ) )
+    // Process the ADR requests
+    status = RegionLinkAdrReq( MacCtx.NvmCtx->Region, &linkAdrReq, &linkAdrDatarate,
+                               &linkAdrTxPower, &linkAdrNbRep, &linkAdrNbBytesParsed );
+
+    if( ( status & 0x07 ) == 0x07 )
     {
-        return true;
+        MacCtx.NvmCtx->MacParams.ChannelsDatarate = linkAdrDatarate;
+        MacCtx.NvmCtx->MacParams.ChannelsTxPower = linkAdrTxPower;
+        MacCtx.NvmCtx->MacParams.ChannelsNbTrans = linkAdrNbRep;
+
+        // The network set a new reference
+        if( MacCtx.AdrStrategy->Reset != NULL )
+        {
+            MacCtx.AdrStrategy->Reset( );
+            MacCtx.TxInfoCache.IsValid = false;
+        }
+    }
+
+    // One answer per block
+    for( uint8_t i = 0; i < ( linkAdrNbBytesParsed / 5 ); i++ )
+    {
+        AddMacCommandAnswer( ctx, MOTE_MAC_LINK_ADR_ANS, &status, 1 );
+    }
+    // Skip the following blocks of the chain. The first one is skipped by
+    // the caller.
+    if( linkAdrNbBytesParsed > 5 )
+    {
+        ctx->Index += linkAdrNbBytesParsed - 5;
     }
-    return false;
 }
 
-static void SetMlmeScheduleUplinkIndication( void )
+static void ProcessDutyCycleReq( MacCommandsProcessCtx_t* ctx )
 {
-    MacCtx.MacFlags.Bits.MlmeSchedUplinkInd = 1;
+    MacCtx.NvmCtx->MaxDCycle = ctx->Payload[ctx->Index] & 0x0F;
+    AddMacCommandAnswer( ctx, MOTE_MAC_DUTY_CYCLE_ANS, NULL, 0 );
 }
 
-static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t commandsSize, int8_t snr, LoRaMacRxSlot_t rxSlot )
+static void ProcessRxParamSetupReq( MacCommandsProcessCtx_t* ctx )
 {
-    uint8_t status = 0;
-    bool adrBlockFound = false;
-    uint8_t macCmdPayload[2] = { 0x00, 0x00 };
+    uint8_t* payload = &ctx->Payload[ctx->Index];
+    RxParamSetupReqParams_t rxParamSetupReq;
+    uint8_t status = 0x07;
+
+    rxParamSetupReq.DrOffset = ( payload[0] >> 4 ) & 0x07;
+    rxParamSetupReq.Datarate = payload[0] & 0x0F;
 
-    while( macIndex < commandsSize )
+    rxParamSetupReq.Frequency = ( uint32_t ) payload[1];
+    rxParamSetupReq.Frequency |= ( uint32_t ) payload[2] << 8;
+    rxParamSetupReq.Frequency |= ( uint32_t ) payload[3] << 16;
+    rxParamSetupReq.Frequency *= 100;
+
+    // Perform request on region
+    status = RegionRxParamSetupReq( MacCtx.NvmCtx->Region, &rxParamSetupReq );
+
+    if( ( status & 0x07 ) == 0x07 )
     {
-        // Decode Frame MAC commands
-        switch( payload[macIndex++] )
-        {
-            case SRV_MAC_LINK_CHECK_ANS:
-            {
-                if( LoRaMacConfirmQueueIsCmdActive( MLME_LINK_CHECK ) == true )
-                {
-                    LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_LINK_CHECK );
-                    MacCtx.MlmeConfirm.DemodMargin = payload[macIndex++];
-                    MacCtx.MlmeConfirm.NbGateways = payload[macIndex++];
-                }
-                break;
-            }
-            case SRV_MAC_LINK_ADR_REQ:
-            {
-                LinkAdrReqParams_t linkAdrReq;
-                int8_t linkAdrDatarate = DR_0;
-                int8_t linkAdrTxPower = TX_POWER_0;
-                uint8_t linkAdrNbRep = 0;
-                uint8_t linkAdrNbBytesParsed = 0;
+        MacCtx.NvmCtx->MacParams.Rx2Channel.Datarate = rxParamSetupReq.Datarate;
+        MacCtx.NvmCtx->MacParams.RxCChannel.Datarate = rxParamSetupReq.Datarate;
+        MacCtx.NvmCtx->MacParams.Rx2Channel.Frequency = rxParamSetupReq.Frequency;
+        MacCtx.NvmCtx->MacParams.RxCChannel.Frequency = rxParamSetupReq.Frequency;
+        MacCtx.NvmCtx->MacParams.Rx1DrOffset = rxParamSetupReq.DrOffset;
+    }
+    AddMacCommandAnswer( ctx, MOTE_MAC_RX_PARAM_SETUP_ANS, &status, 1 );
+    // Setup indication to inform the application
+    SetMlmeScheduleUplinkIndication( );
+}
 
-                if( adrBlockFound == false )
-                {
-                    adrBlockFound = true;
-
-                    // Fill parameter structure
-                    linkAdrReq.Payload = &payload[macIndex - 1];
-                    linkAdrReq.PayloadSize = commandsSize - ( macIndex - 1 );
-                    linkAdrReq.AdrEnabled = MacCtx.NvmCtx->AdrCtrlOn;
-                    linkAdrReq.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
-                    linkAdrReq.CurrentDatarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
-                    linkAdrReq.CurrentTxPower = MacCtx.NvmCtx->MacParams.ChannelsTxPower;
-                    linkAdrReq.CurrentNbRep = MacCtx.NvmCtx->MacParams.ChannelsNbTrans;
-                    linkAdrReq.Version = MacCtx.NvmCtx->Version;
-
-                    // Process the ADR requests
-                    status = RegionLinkAdrReq( MacCtx.NvmCtx->Region, &linkAdrReq, &linkAdrDatarate,
-                                               &linkAdrTxPower, &linkAdrNbRep, &linkAdrNbBytesParsed );
-
-                    if( ( status & 0x07 ) == 0x07 )
-                    {
-                        MacCtx.NvmCtx->MacParams.ChannelsDatarate = linkAdrDatarate;
-                        MacCtx.NvmCtx->MacParams.ChannelsTxPower = linkAdrTxPower;
-                        MacCtx.NvmCtx->MacParams.ChannelsNbTrans = linkAdrNbRep;
-                    }
+static void ProcessDevStatusReq( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t macCmdPayload[2];
+    uint8_t batteryLevel = BAT_LEVEL_NO_MEASURE;
 
-                    // Add the answers to the buffer
-                    for( uint8_t i = 0; i < ( linkAdrNbBytesParsed / 5 ); i++ )
-                    {
-                        LoRaMacCommandsAddCmd( MOTE_MAC_LINK_ADR_ANS, &status, 1 );
-                    }
-                    // Update MAC index
-                    macIndex += linkAdrNbBytesParsed - 1;
-                }
-                break;
-            }
-            case SRV_MAC_DUTY_CYCLE_REQ:
-            {
-                MacCtx.NvmCtx->MaxDCycle = payload[macIndex++] & 0x0F;
-                MacCtx.NvmCtx->AggregatedDCycle = 1 << MacCtx.NvmCtx->MaxDCycle;
-                LoRaMacCommandsAddCmd( MOTE_MAC_DUTY_CYCLE_ANS, macCmdPayload, 0 );
-                break;
-            }
-            case SRV_MAC_RX_PARAM_SETUP_REQ:
-            {
-                RxParamSetupReqParams_t rxParamSetupReq;
-                status = 0x07;
+    if( MacCtx.BatteryLevelSet == true )
+    {
+        // No measurement while the downlink is processed
+        batteryLevel = MacCtx.BatteryLevel;
+    }
+    else if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->GetBatteryLevel != NULL ) )
+    {
+        batteryLevel = MacCtx.MacCallbacks->GetBatteryLevel( );
+    }
+    macCmdPayload[0] = batteryLevel;
+    macCmdPayload[1] = ( uint8_t )( ctx->Snr & 0x3F );
+    AddMacCommandAnswer( ctx, MOTE_MAC_DEV_STATUS_ANS, macCmdPayload, 2 );
+}
 
-                rxParamSetupReq.DrOffset = ( payload[macIndex] >> 4 ) & 0x07;
-                rxParamSetupReq.Datarate = payload[macIndex] & 0x0F;
-                macIndex++;
+static void ProcessNewChannelReq( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t* payload = &ctx->Payload[ctx->Index];
+    NewChannelReqParams_t newChannelReq;
+    ChannelParams_t chParam;
+    uint8_t status = 0x03;
 
-                rxParamSetupReq.Frequency = ( uint32_t ) payload[macIndex++];
-                rxParamSetupReq.Frequency |= ( uint32_t ) payload[macIndex++] << 8;
-                rxParamSetupReq.Frequency |= ( uint32_t ) payload[macIndex++] << 16;
-                rxParamSetupReq.Frequency *= 100;
+    newChannelReq.ChannelId = payload[0];
+    newChannelReq.NewChannel = &chParam;
 
-                // Perform request on region
-                status = RegionRxParamSetupReq( MacCtx.NvmCtx->Region, &rxParamSetupReq );
+    chParam.Frequency = ( uint32_t ) payload[1];
+    chParam.Frequency |= ( uint32_t ) payload[2] << 8;
+    chParam.Frequency |= ( uint32_t ) payload[3] << 16;
+    chParam.Frequency *= 100;
+    chParam.Rx1Frequency = 0;
+    chParam.DrRange.Value = payload[4];
 
-                if( ( status & 0x07 ) == 0x07 )
-                {
-                    MacCtx.NvmCtx->MacParams.Rx2Channel.Datarate = rxParamSetupReq.Datarate;
-                    MacCtx.NvmCtx->MacParams.RxCChannel.Datarate = rxParamSetupReq.Datarate;
-                    MacCtx.NvmCtx->MacParams.Rx2Channel.Frequency = rxParamSetupReq.Frequency;
-                    MacCtx.NvmCtx->MacParams.RxCChannel.Frequency = rxParamSetupReq.Frequency;
-                    MacCtx.NvmCtx->MacParams.Rx1DrOffset = rxParamSetupReq.DrOffset;
-                }
-                macCmdPayload[0] = status;
-                LoRaMacCommandsAddCmd( MOTE_MAC_RX_PARAM_SETUP_ANS, macCmdPayload, 1 );
-                // Setup indication to inform the application
-                SetMlmeScheduleUplinkIndication( );
-                break;
-            }
-            case SRV_MAC_DEV_STATUS_REQ:
-            {
-                uint8_t batteryLevel = BAT_LEVEL_NO_MEASURE;
-                if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->GetBatteryLevel != NULL ) )
-                {
-                    batteryLevel = MacCtx.MacCallbacks->GetBatteryLevel( );
-                }
-                macCmdPayload[0] = batteryLevel;
-                macCmdPayload[1] = ( uint8_t )( snr & 0x3F );
-                LoRaMacCommandsAddCmd( MOTE_MAC_DEV_STATUS_ANS, macCmdPayload, 2 );
-                break;
-            }
-            case SRV_MAC_NEW_CHANNEL_REQ:
-            {
-                NewChannelReqParams_t newChannelReq;
-                ChannelParams_t chParam;
-                status = 0x03;
+    status = RegionNewChannelReq( MacCtx.NvmCtx->Region, &newChannelReq );
 
-                newChannelReq.ChannelId = payload[macIndex++];
-                newChannelReq.NewChannel = &chParam;
+    AddMacCommandAnswer( ctx, MOTE_MAC_NEW_CHANNEL_ANS, &status, 1 );
+}
 
-                chParam.Frequency = ( uint32_t ) payload[macIndex++];
-                chParam.Frequency |= ( uint32_t ) payload[macIndex++] << 8;
-                chParam.Frequency |= ( uint32_t ) payload[macIndex++] << 16;
-                chParam.Frequency *= 100;
-                chParam.Rx1Frequency = 0;
-                chParam.DrRange.Value = payload[macIndex++];
+static void ProcessRxTimingSetupReq( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t delay = ctx->Payload[ctx->Index] & 0x0F;
 
-                status = RegionNewChannelReq( MacCtx.NvmCtx->Region, &newChannelReq );
+    if( delay == 0 )
+    {
+        delay++;
+    }
+    MacCtx.NvmCtx->MacParams.ReceiveDelay1 = delay * 1000;
+    MacCtx.NvmCtx->MacParams.ReceiveDelay2 = MacCtx.NvmCtx->MacParams.ReceiveDelay1 + 1000;
+    AddMacCommandAnswer( ctx, MOTE_MAC_RX_TIMING_SETUP_ANS, NULL, 0 );
+    // Setup indication to inform the application
+    SetMlmeScheduleUplinkIndication( );
+}
 
-                macCmdPayload[0] = status;
-                LoRaMacCommandsAddCmd( MOTE_MAC_NEW_CHANNEL_ANS, macCmdPayload, 1 );
-                break;
-            }
-            case SRV_MAC_RX_TIMING_SETUP_REQ:
-            {
-                uint8_t delay = payload[macIndex++] & 0x0F;
+static void ProcessTxParamSetupReq( MacCommandsProcessCtx_t* ctx )
+{
+    TxParamSetupReqParams_t txParamSetupReq;
+    uint8_t eirpDwellTime = ctx->Payload[ctx->Index];
 
-                if( delay == 0 )
-                {
-                    delay++;
-                }
-                MacCtx.NvmCtx->MacParams.ReceiveDelay1 = delay * 1000;
-                MacCtx.NvmCtx->MacParams.ReceiveDelay2 = MacCtx.NvmCtx->MacParams.ReceiveDelay1 + 1000;
-                LoRaMacCommandsAddCmd( MOTE_MAC_RX_TIMING_SETUP_ANS, macCmdPayload, 0 );
-                // Setup indication to inform the application
-                SetMlmeScheduleUplinkIndication( );
-                break;
-            }
-            case SRV_MAC_TX_PARAM_SETUP_REQ:
-            {
-                TxParamSetupReqParams_t txParamSetupReq;
-                GetPhyParams_t getPhy;
-                PhyParam_t phyParam;
-                uint8_t eirpDwellTime = payload[macIndex++];
+    txParamSetupReq.UplinkDwellTime = 0;
+    txParamSetupReq.DownlinkDwellTime = 0;
 
-                txParamSetupReq.UplinkDwellTime = 0;
-                txParamSetupReq.DownlinkDwellTime = 0;
+    if( ( eirpDwellTime & 0x20 ) == 0x20 )
+    {
+        txParamSetupReq.DownlinkDwellTime = 1;
+    }
+    if( ( eirpDwellTime & 0x10 ) == 0x10 )
+    {
+        txParamSetupReq.UplinkDwellTime = 1;
+    }
+    txParamSetupReq.MaxEirp = eirpDwellTime & 0x0F;
 
-                if( ( eirpDwellTime & 0x20 ) == 0x20 )
-                {
-                    txParamSetupReq.DownlinkDwellTime = 1;
-                }
-                if( ( eirpDwellTime & 0x10 ) == 0x10 )
-                {
-                    txParamSetupReq.UplinkDwellTime = 1;
-                }
-                txParamSetupReq.MaxEirp = eirpDwellTime & 0x0F;
+    // Check the status for correctness
+    if( RegionTxParamSetupReq( MacCtx.NvmCtx->Region, &txParamSetupReq ) != -1 )
+    {
+        // Accept command
+        MacCtx.NvmCtx->MacParams.UplinkDwellTime = txParamSetupReq.UplinkDwellTime;
+        MacCtx.NvmCtx->MacParams.DownlinkDwellTime = txParamSetupReq.DownlinkDwellTime;
+        MacCtx.NvmCtx->MacParams.MaxEirp = LoRaMacMaxEirpTable[txParamSetupReq.MaxEirp];
+        // Update the datarate in case of the new configuration limits it
+        MacCtx.NvmCtx->MacParams.ChannelsDatarate = MAX( MacCtx.NvmCtx->MacParams.ChannelsDatarate,
+                                                         MacCtx.PhyParams.MinTxDr[MacCtx.NvmCtx->MacParams.UplinkDwellTime != 0] );
 
-                // Check the status for correctness
-                if( RegionTxParamSetupReq( MacCtx.NvmCtx->Region, &txParamSetupReq ) != -1 )
-                {
-                    // Accept command
-                    MacCtx.NvmCtx->MacParams.UplinkDwellTime = txParamSetupReq.UplinkDwellTime;
-                    MacCtx.NvmCtx->MacParams.DownlinkDwellTime = txParamSetupReq.DownlinkDwellTime;
-                    MacCtx.NvmCtx->MacParams.MaxEirp = LoRaMacMaxEirpTable[txParamSetupReq.MaxEirp];
-                    // Update the datarate in case of the new configuration limits it
-                    getPhy.Attribute = PHY_MIN_TX_DR;
-                    getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
-                    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-                    MacCtx.NvmCtx->MacParams.ChannelsDatarate = MAX( MacCtx.NvmCtx->MacParams.ChannelsDatarate, ( int8_t )phyParam.Value );
-
-                    // Add command response
-                    LoRaMacCommandsAddCmd( MOTE_MAC_TX_PARAM_SETUP_ANS, macCmdPayload, 0 );
-                }
-                break;
-            }
-            case SRV_MAC_DL_CHANNEL_REQ:
-            {
-                DlChannelReqParams_t dlChannelReq;
-                status = 0x03;
+        // Add command response
+        AddMacCommandAnswer( ctx, MOTE_MAC_TX_PARAM_SETUP_ANS, NULL, 0 );
+    }
+}
 
-                dlChannelReq.ChannelId = payload[macIndex++];
-                dlChannelReq.Rx1Frequency = ( uint32_t ) payload[macIndex++];
-                dlChannelReq.Rx1Frequency |= ( uint32_t ) payload[macIndex++] << 8;
-                dlChannelReq.Rx1Frequency |= ( uint32_t ) payload[macIndex++] << 16;
-                dlChannelReq.Rx1Frequency *= 100;
+static void ProcessDlChannelReq( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t* payload = &ctx->Payload[ctx->Index];
+    DlChannelReqParams_t dlChannelReq;
+    uint8_t status = 0x03;
+
+    dlChannelReq.ChannelId = payload[0];
+    dlChannelReq.Rx1Frequency = ( uint32_t ) payload[1];
+    dlChannelReq.Rx1Frequency |= ( uint32_t ) payload[2] << 8;
+    dlChannelReq.Rx1Frequency |= ( uint32_t ) payload[3] << 16;
+    dlChannelReq.Rx1Frequency *= 100;
+
+    status = RegionDlChannelReq( MacCtx.NvmCtx->Region, &dlChannelReq );
+    AddMacCommandAnswer( ctx, MOTE_MAC_DL_CHANNEL_ANS, &status, 1 );
+    // Setup indication to inform the application
+    SetMlmeScheduleUplinkIndication( );
+}
 
-                status = RegionDlChannelReq( MacCtx.NvmCtx->Region, &dlChannelReq );
-                macCmdPayload[0] = status;
-                LoRaMacCommandsAddCmd( MOTE_MAC_DL_CHANNEL_ANS, macCmdPayload, 1 );
-                // Setup indication to inform the application
-                SetMlmeScheduleUplinkIndication( );
-                break;
-            }
-            case SRV_MAC_DEVICE_TIME_ANS:
-            {
-                SysTime_t gpsEpochTime = { 0 };
-                SysTime_t sysTime = { 0 };
-                SysTime_t sysTimeCurrent = { 0 };
+static void ProcessDeviceTimeAns( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t* payload = &ctx->Payload[ctx->Index];
+    SysTime_t gpsEpochTime = { 0 };
+    SysTime_t sysTime = { 0 };
+    SysTime_t sysTimeCurrent = { 0 };
+
+    gpsEpochTime.Seconds = ( uint32_t )payload[0];
+    gpsEpochTime.Seconds |= ( uint32_t )payload[1] << 8;
+    gpsEpochTime.Seconds |= ( uint32_t )payload[2] << 16;
+    gpsEpochTime.Seconds |= ( uint32_t )payload[3] << 24;
+    gpsEpochTime.SubSeconds = payload[4];
+
+    // Convert the fractional second received in ms
+    // round( pow( 0.5, 8.0 ) * 1000 ) = 3.90625
+    gpsEpochTime.SubSeconds = ( int16_t )( ( ( int32_t )gpsEpochTime.SubSeconds * 1000 ) >> 8 );
+
+    // Copy received GPS Epoch time into system time
+    sysTime = gpsEpochTime;
+    // Add Unix to Gps epcoh offset. The system time is based on Unix time.
+    sysTime.Seconds += UNIX_GPS_EPOCH_OFFSET;
+
+    // Compensate time difference between Tx Done time and now
+    sysTimeCurrent = SysTimeGet( );
+    sysTime = SysTimeAdd( sysTimeCurrent, SysTimeSub( sysTime, MacCtx.LastTxSysTime ) );
+
+    // Apply the new system time.
+    SysTimeSet( sysTime );
+    LoRaMacClassBDeviceTimeAns( );
+    MacCtx.McpsIndication.DeviceTimeAnsReceived = true;
+}
 
-                gpsEpochTime.Seconds = ( uint32_t )payload[macIndex++];
-                gpsEpochTime.Seconds |= ( uint32_t )payload[macIndex++] << 8;
-                gpsEpochTime.Seconds |= ( uint32_t )payload[macIndex++] << 16;
-                gpsEpochTime.Seconds |= ( uint32_t )payload[macIndex++] << 24;
-                gpsEpochTime.SubSeconds = payload[macIndex++];
+static void ProcessPingSlotInfoAns( MacCommandsProcessCtx_t* ctx )
+{
+    // According to the specification, it is not allowed to process this answer in
+    // a ping or multicast slot
+    if( ( MacCtx.RxSlot != RX_SLOT_WIN_CLASS_B_PING_SLOT ) && ( MacCtx.RxSlot != RX_SLOT_WIN_CLASS_B_MULTICAST_SLOT ) )
+    {
+        LoRaMacClassBPingSlotInfoAns( );
+    }
+}
 
-                // Convert the fractional second received in ms
-                // round( pow( 0.5, 8.0 ) * 1000 ) = 3.90625
-                gpsEpochTime.SubSeconds = ( int16_t )( ( ( int32_t )gpsEpochTime.SubSeconds * 1000 ) >> 8 );
+static void ProcessPingSlotChannelReq( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t* payload = &ctx->Payload[ctx->Index];
+    uint8_t status = 0x03;
+    uint32_t frequency = 0;
+    uint8_t datarate;
+
+    frequency = ( uint32_t )payload[0];
+    frequency |= ( uint32_t )payload[1] << 8;
+    frequency |= ( uint32_t )payload[2] << 16;
+    frequency *= 100;
+    datarate = payload[3] & 0x0F;
+
+    status = LoRaMacClassBPingSlotChannelReq( datarate, frequency );
+    AddMacCommandAnswer( ctx, MOTE_MAC_PING_SLOT_FREQ_ANS, &status, 1 );
+}
 
-                // Copy received GPS Epoch time into system time
-                sysTime = gpsEpochTime;
-                // Add Unix to Gps epcoh offset. The system time is based on Unix time.
-                sysTime.Seconds += UNIX_GPS_EPOCH_OFFSET;
+static void ProcessBeaconTimingAns( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t* payload = &ctx->Payload[ctx->Index];
+    uint16_t beaconTimingDelay = 0;
+    uint8_t beaconTimingChannel = 0;
 
-                // Compensate time difference between Tx Done time and now
-                sysTimeCurrent = SysTimeGet( );
-                sysTime = SysTimeAdd( sysTimeCurrent, SysTimeSub( sysTime, MacCtx.LastTxSysTime ) );
+    beaconTimingDelay = ( uint16_t )payload[0];
+    beaconTimingDelay |= ( uint16_t )payload[1] << 8;
+    beaconTimingChannel = payload[2];
 
-                // Apply the new system time.
-                SysTimeSet( sysTime );
-                LoRaMacClassBDeviceTimeAns( );
-                MacCtx.McpsIndication.DeviceTimeAnsReceived = true;
-                break;
-            }
-            case SRV_MAC_PING_SLOT_INFO_ANS:
-            {
-                // According to the specification, it is not allowed to process this answer in
-                // a ping or multicast slot
-                if( ( MacCtx.RxSlot != RX_SLOT_WIN_CLASS_B_PING_SLOT ) && ( MacCtx.RxSlot != RX_SLOT_WIN_CLASS_B_MULTICAST_SLOT ) )
-                {
-                    LoRaMacClassBPingSlotInfoAns( );
-                }
-                break;
-            }
-            case SRV_MAC_PING_SLOT_CHANNEL_REQ:
-            {
-                uint8_t status = 0x03;
-                uint32_t frequency = 0;
-                uint8_t datarate;
+    LoRaMacClassBBeaconTimingAns( beaconTimingDelay, beaconTimingChannel, RxDoneParams.LastRxDone );
+}
 
-                frequency = ( uint32_t )payload[macIndex++];
-                frequency |= ( uint32_t )payload[macIndex++] << 8;
-                frequency |= ( uint32_t )payload[macIndex++] << 16;
-                frequency *= 100;
-                datarate = payload[macIndex++] & 0x0F;
+static void ProcessBeaconFreqReq( MacCommandsProcessCtx_t* ctx )
+{
+    uint8_t* payload = &ctx->Payload[ctx->Index];
+    uint8_t status = 0;
+    uint32_t frequency = 0;
 
-                status = LoRaMacClassBPingSlotChannelReq( datarate, frequency );
-                macCmdPayload[0] = status;
-                LoRaMacCommandsAddCmd( MOTE_MAC_PING_SLOT_FREQ_ANS, macCmdPayload, 1 );
-                break;
-            }
-            case SRV_MAC_BEACON_TIMING_ANS:
-            {
-                uint16_t beaconTimingDelay = 0;
-                uint8_t beaconTimingChannel = 0;
+    frequency = ( uint32_t )payload[0];
+    frequency |= ( uint32_t )payload[1] << 8;
+    frequency |= ( uint32_t )payload[2] << 16;
+    frequency *= 100;
 
-                beaconTimingDelay = ( uint16_t )payload[macIndex++];
-                beaconTimingDelay |= ( uint16_t )payload[macIndex++] << 8;
-                beaconTimingChannel = payload[macIndex++];
+    if( LoRaMacClassBBeaconFreqReq( frequency ) == true )
+    {
+        status = 1;
+    }
+    AddMacCommandAnswer( ctx, MOTE_MAC_BEACON_FREQ_ANS, &status, 1 );
+}
 
-                LoRaMacClassBBeaconTimingAns( beaconTimingDelay, beaconTimingChannel, RxDoneParams.LastRxDone );
-                break;
-            }
-            case SRV_MAC_BEACON_FREQ_REQ:
-                {
-                    uint32_t frequency = 0;
+/*!
+ * Handlers of the MAC commands sent by the network server, indexed by CID
+ */
+static const MacCommandHandler_t MacCommandHandlers[] =
+{
+    [SRV_MAC_LINK_CHECK_ANS]        = { 2, ProcessLinkCheckAns },
+    [SRV_MAC_LINK_ADR_REQ]          = { 4, ProcessLinkAdrReq },
+    [SRV_MAC_DUTY_CYCLE_REQ]        = { 1, ProcessDutyCycleReq },
+    [SRV_MAC_RX_PARAM_SETUP_REQ]    = { 4, ProcessRxParamSetupReq },
+    [SRV_MAC_DEV_STATUS_REQ]        = { 0, ProcessDevStatusReq },
+    [SRV_MAC_NEW_CHANNEL_REQ]       = { 5, ProcessNewChannelReq },
+    [SRV_MAC_RX_TIMING_SETUP_REQ]   = { 1, ProcessRxTimingSetupReq },
+    [SRV_MAC_TX_PARAM_SETUP_REQ]    = { 1, ProcessTxParamSetupReq },
+    [SRV_MAC_DL_CHANNEL_REQ]        = { 4, ProcessDlChannelReq },
+    [SRV_MAC_DEVICE_TIME_ANS]       = { 5, ProcessDeviceTimeAns },
+    [SRV_MAC_PING_SLOT_INFO_ANS]    = { 0, ProcessPingSlotInfoAns },
+    [SRV_MAC_PING_SLOT_CHANNEL_REQ] = { 4, ProcessPingSlotChannelReq },
+    [SRV_MAC_BEACON_TIMING_ANS]     = { 3, ProcessBeaconTimingAns },
+    [SRV_MAC_BEACON_FREQ_REQ]       = { 3, ProcessBeaconFreqReq },
+};
 
-                    frequency = ( uint32_t )payload[macIndex++];
-                    frequency |= ( uint32_t )payload[macIndex++] << 8;
-                    frequency |= ( uint32_t )payload[macIndex++] << 16;
-                    frequency *= 100;
+static void ProcessMacCommands( uint8_t *payload, uint8_t macIndex, uint8_t commandsSize, int8_t snr, LoRaMacRxSlot_t rxSlot )
+{
+    MacCommandsProcessCtx_t ctx;
+    const MacCommandHandler_t* handler;
+    uint8_t cid;
 
-                    if( LoRaMacClassBBeaconFreqReq( frequency ) == true )
-                    {
-                        macCmdPayload[0] = 1;
-                    }
-                    else
-                    {
-                        macCmdPayload[0] = 0;
-                    }
-                    LoRaMacCommandsAddCmd( MOTE_MAC_BEACON_FREQ_ANS, macCmdPayload, 1 );
-                }
-                break;
-            default:
-                // Unknown command. ABORT MAC commands processing
-                return;
+    ctx.Payload = payload;
+    ctx.Index = macIndex;
+    ctx.Size = commandsSize;
+    ctx.Snr = snr;
+    ctx.AdrBlockFound = false;
+    ctx.NbAnswers = 0;
+
+    while( ctx.Index < ctx.Size )
+    {
+        // Decode Frame MAC commands
+        cid = ctx.Payload[ctx.Index++];
+        handler = ( cid < ( sizeof( MacCommandHandlers ) / sizeof( MacCommandHandlers[0] ) ) ) ? &MacCommandHandlers[cid] : NULL;
+
+        if( ( handler == NULL ) || ( handler->Process == NULL ) )
+        {
+            // Unknown command. ABORT MAC commands processing
+            break;
+        }
+        if( handler->PayloadSize > ( ctx.Size - ctx.Index ) )
+        {
+            // Truncated command. ABORT MAC commands processing
+            break;
         }
+        handler->Process( &ctx );
+        ctx.Index += handler->PayloadSize;
     }
+
+    FlushMacCommandAnswers( &ctx );
 }
 
-LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uint16_t fBufferSize )
+LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uint16_t fBufferSize, bool allowDelayedTx, bool inPlace )
 {
     LoRaMacFrameCtrl_t fCtrl;
     LoRaMacStatus_t status = LORAMAC_STATUS_PARAMETER_INVALID;
@@ -2243,6 +4378,7 @@ LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uin
     int8_t txPower = MacCtx.NvmCtx->MacParams.ChannelsTxPower;
     uint32_t adrAckCounter = MacCtx.NvmCtx->AdrAckCounter;
     CalcNextAdrParams_t adrNext;
+    bool isAppDataSkipped = false;
 
     // Check if we are joined
     if( MacCtx.NvmCtx->NetworkActivation == ACTIVATION_TYPE_NONE )
@@ -2286,17 +4422,18 @@ LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uin
     adrNext.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
     adrNext.Region = MacCtx.NvmCtx->Region;
 
-    fCtrl.Bits.AdrAckReq = LoRaMacAdrCalcNext( &adrNext, &MacCtx.NvmCtx->MacParams.ChannelsDatarate,
-                                               &MacCtx.NvmCtx->MacParams.ChannelsTxPower, &adrAckCounter );
+    fCtrl.Bits.AdrAckReq = MacCtx.AdrStrategy->CalcNext( &adrNext, &MacCtx.NvmCtx->MacParams.ChannelsDatarate,
+                                                         &MacCtx.NvmCtx->MacParams.ChannelsTxPower, &adrAckCounter );
 
     // Prepare the frame
-    status = PrepareFrame( macHdr, &fCtrl, fPort, fBuffer, fBufferSize );
+    status = PrepareFrame( macHdr, &fCtrl, fPort, fBuffer, fBufferSize, inPlace );
 
     // Validate status
     if( ( status == LORAMAC_STATUS_OK ) || ( status == LORAMAC_STATUS_SKIPPED_APP_DATA ) )
     {
-        // Schedule frame, do not allow delayed transmissions
-        status = ScheduleTx( false );
+        isAppDataSkipped = ( status == LORAMAC_STATUS_SKIPPED_APP_DATA );
+        // Schedule frame. Only the queued uplinks may be delayed.
+        status = ScheduleTx( allowDelayedTx );
     }
 
     // Post processing
@@ -2312,18 +4449,53 @@ LoRaMacStatus_t Send( LoRaMacHeader_t* macHdr, uint8_t fPort, void* fBuffer, uin
         // Good case
         MacCtx.NvmCtx->SrvAckRequested = false;
         MacCtx.NvmCtx->AdrAckCounter = adrAckCounter;
-        // Remove all none sticky MAC commands
+        // Remove all none sticky MAC commands sent with the frame
         if( LoRaMacCommandsRemoveNoneStickyCmds( ) != LORAMAC_COMMANDS_SUCCESS )
         {
             return LORAMAC_STATUS_MAC_COMMAD_ERROR;
         }
+        UpdateDeferredMlmeConfirms( );
+        if( isAppDataSkipped == true )
+        {
+            // The frame only carries the MAC commands, the application
+            // payload has to be sent again
+            status = LORAMAC_STATUS_SKIPPED_APP_DATA;
+        }
     }
     return status;
 }
 
+static bool AcquirePktBuffer( void )
+{
+#ifdef PACKET_POOL_ENABLED
+    if( MacCtx.PktBuffer == NULL )
+    {
+        MacCtx.PktBuffer = PacketPoolAlloc( );
+    }
+    return MacCtx.PktBuffer != NULL;
+#else
+    return true;
+#endif
+}
+
+static uint8_t* ReleasePktBuffer( void )
+{
+    uint8_t* txAppBuffer = NULL;
+
+#ifdef PACKET_POOL_ENABLED
+    if( MacCtx.MacState == LORAMAC_IDLE )
+    {
+        PacketPoolFree( MacCtx.PktBuffer );
+        MacCtx.PktBuffer = NULL;
+        txAppBuffer = MacCtx.TxAppBuffer;
+        MacCtx.TxAppBuffer = NULL;
+    }
+#endif
+    return txAppBuffer;
+}
+
 LoRaMacStatus_t SendReJoinReq( JoinReqIdentifier_t joinReqType )
 {
-    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
     LoRaMacHeader_t macHdr;
     macHdr.Value = 0;
     bool allowDelayedTx = true;
@@ -2335,6 +4507,10 @@ LoRaMacStatus_t SendReJoinReq( JoinReqIdentifier_t joinReqType )
         {
             SwitchClass( CLASS_A );
 
+            if( AcquirePktBuffer( ) == false )
+            {
+                return LORAMAC_STATUS_BUSY;
+            }
             MacCtx.TxMsg.Type = LORAMAC_MSG_TYPE_JOIN_REQUEST;
             MacCtx.TxMsg.Message.JoinReq.Buffer = MacCtx.PktBuffer;
             MacCtx.TxMsg.Message.JoinReq.BufSize = LORAMAC_PHY_MAXPAYLOAD;
@@ -2345,45 +4521,72 @@ LoRaMacStatus_t SendReJoinReq( JoinReqIdentifier_t joinReqType )
             memcpy1( MacCtx.TxMsg.Message.JoinReq.JoinEUI, SecureElementGetJoinEui( ), LORAMAC_JOIN_EUI_FIELD_SIZE );
             memcpy1( MacCtx.TxMsg.Message.JoinReq.DevEUI, SecureElementGetDevEui( ), LORAMAC_DEV_EUI_FIELD_SIZE );
 
-            allowDelayedTx = false;
+            MacCtx.JoinReqPrepared = false;
 
             break;
         }
         default:
-            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
-            break;
+            // Nothing to schedule, the pending frame must not be sent
+            return LORAMAC_STATUS_SERVICE_UNKNOWN;
     }
 
     // Schedule frame
-    status = ScheduleTx( allowDelayedTx );
-    return status;
+    return ScheduleTx( allowDelayedTx );
 }
 
 static LoRaMacStatus_t ScheduleTx( bool allowDelayedTx )
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_PARAMETER_INVALID;
     TimerTime_t dutyCycleTimeOff = 0;
+    TimerTime_t joinBackOff = 0;
     NextChanParams_t nextChan;
-    size_t macCmdsSize = 0;
+    // The RTC is read once for the whole back-off update
+    TimerTime_t now = TimerGetCurrentTime( );
 
-    // Update back-off
-    CalculateBackOff( MacCtx.NvmCtx->LastTxChannel );
+    // Update back-off. Already done when retrying after a busy channel.
+    if( MacCtx.LbtCadTrials == 0 )
+    {
+        CalculateBackOff( MacCtx.NvmCtx->LastTxChannel, now );
+    }
 
-    nextChan.AggrTimeOff = MacCtx.NvmCtx->AggregatedTimeOff;
-    nextChan.Datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
-    nextChan.DutyCycleEnabled = MacCtx.NvmCtx->DutyCycleOn;
-    if( MacCtx.NvmCtx->NetworkActivation == ACTIVATION_TYPE_NONE )
+    if( MacCtx.TxMsg.Type == LORAMAC_MSG_TYPE_JOIN_REQUEST )
     {
-        nextChan.Joined = false;
+        // The join airtime ledger tells when the next join request is allowed
+        joinBackOff = GetJoinBackOff( RegionGetTimeOnAir( MacCtx.NvmCtx->Region, MacCtx.NvmCtx->MacParams.ChannelsDatarate, MacCtx.PktBufferLen ) );
     }
-    else
+
+    if( joinBackOff != 0 )
     {
-        nextChan.Joined = true;
+        status = LORAMAC_STATUS_DUTYCYCLE_RESTRICTED;
+        dutyCycleTimeOff = joinBackOff;
     }
-    nextChan.LastAggrTx = MacCtx.NvmCtx->LastTxDoneTime;
+    else
+    {
+        GetNextChanParams( MacCtx.NvmCtx->MacParams.ChannelsDatarate, now, &nextChan );
+
+        // Select channel
+        TRACE_BEGIN( TRACE_PROBE_REGION_NEXT_CHANNEL );
+        status = RegionNextChannel( MacCtx.NvmCtx->Region, &nextChan, &MacCtx.Channel, &dutyCycleTimeOff, &MacCtx.NvmCtx->AggregatedTimeOff );
+        TRACE_END( TRACE_PROBE_REGION_NEXT_CHANNEL );
+
+        // Draw another channel, more likely when the selected one loses uplinks
+        for( uint8_t draw = 1; ( draw < LORAMAC_CHANNEL_QUALITY_DRAWS ) && ( status == LORAMAC_STATUS_OK ) &&
+                               ( IsChannelLossy( MacCtx.Channel ) == true ); draw++ )
+        {
+            status = RegionNextChannel( MacCtx.NvmCtx->Region, &nextChan, &MacCtx.Channel, &dutyCycleTimeOff, &MacCtx.NvmCtx->AggregatedTimeOff );
+        }
 
-    // Select channel
-    status = RegionNextChannel( MacCtx.NvmCtx->Region, &nextChan, &MacCtx.Channel, &dutyCycleTimeOff, &MacCtx.NvmCtx->AggregatedTimeOff );
+        // Draw another channel when the retry policy avoids the selected one
+        if( ( MacCtx.NodeAckRequested == true ) && ( MacCtx.AckTimeoutRetriesCounter > 1 ) &&
+            ( MacCtx.RetryPolicy->IsChannelAvoided != NULL ) )
+        {
+            for( uint8_t draw = 1; ( draw < LORAMAC_RETRY_CHANNEL_DRAWS ) && ( status == LORAMAC_STATUS_OK ) &&
+                                   ( MacCtx.RetryPolicy->IsChannelAvoided( MacCtx.Channel ) == true ); draw++ )
+            {
+                status = RegionNextChannel( MacCtx.NvmCtx->Region, &nextChan, &MacCtx.Channel, &dutyCycleTimeOff, &MacCtx.NvmCtx->AggregatedTimeOff );
+            }
+        }
+    }
 
     if( status != LORAMAC_STATUS_OK )
     {
@@ -2394,9 +4597,32 @@ static LoRaMacStatus_t ScheduleTx( bool allowDelayedTx )
             // the MAC must retransmit a frame with the frame repetitions
             if( dutyCycleTimeOff != 0 )
             {// Send later - prepare timer
-                MacCtx.MacState |= LORAMAC_TX_DELAYED;
+                if( MacCtx.TxMsg.Type == LORAMAC_MSG_TYPE_JOIN_REQUEST )
+                {
+                    // Spread the join requests of the devices sharing the
+                    // same time-off, e.g. after a power outage, over one
+                    // more time-off. Not for the join back-off which may
+                    // last hours, the band time-off spreads them after it.
+                    if( joinBackOff == 0 )
+                    {
+                        dutyCycleTimeOff += randr( 0, dutyCycleTimeOff );
+                    }
+
+                    // The join request doesn't depend on the channel. Secure
+                    // it while waiting so that it is sent right away.
+                    if( MacCtx.JoinReqPrepared == false )
+                    {
+                        if( SecureFrame( MacCtx.NvmCtx->MacParams.ChannelsDatarate, MacCtx.Channel ) != LORAMAC_STATUS_OK )
+                        {
+                            return LORAMAC_STATUS_CRYPTO_ERROR;
+                        }
+                        MacCtx.JoinReqPrepared = true;
+                    }
+                }
+                SetMacState( MacCtx.MacState | LORAMAC_TX_DELAYED );
                 TimerSetValue( &MacCtx.TxDelayedTimer, dutyCycleTimeOff );
                 TimerStart( &MacCtx.TxDelayedTimer );
+                TraceTimerStart( LORAMAC_TRACE_TIMER_TX_DELAYED, dutyCycleTimeOff * 1000 );
             }
             return LORAMAC_STATUS_OK;
         }
@@ -2423,20 +4649,34 @@ static LoRaMacStatus_t ScheduleTx( bool allowDelayedTx )
     {
         MacCtx.RxWindow1Delay = MacCtx.NvmCtx->MacParams.JoinAcceptDelay1 + MacCtx.RxWindow1Config.WindowOffset;
         MacCtx.RxWindow2Delay = MacCtx.NvmCtx->MacParams.JoinAcceptDelay2 + MacCtx.RxWindow2Config.WindowOffset;
-    }
-    else
-    {
-        if( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
-        {
-            return LORAMAC_STATUS_MAC_COMMAD_ERROR;
-        }
-
-        if( ValidatePayloadLength( MacCtx.AppDataSize, MacCtx.NvmCtx->MacParams.ChannelsDatarate, macCmdsSize ) == false )
+        MacCtx.RxWindow1DelayTicks = TimerUs2Ticks( ( MacCtx.NvmCtx->MacParams.JoinAcceptDelay1 * 1000 ) + MacCtx.RxWindow1Config.WindowOffsetUs );
+        MacCtx.RxWindow2DelayTicks = TimerUs2Ticks( ( MacCtx.NvmCtx->MacParams.JoinAcceptDelay2 * 1000 ) + MacCtx.RxWindow2Config.WindowOffsetUs );
+    }
+    else
+    {
+        if( ValidatePayloadLength( MacCtx.AppDataSize, MacCtx.NvmCtx->MacParams.ChannelsDatarate, MacCtx.TxMacCmdsSize ) == false )
         {
             return LORAMAC_STATUS_LENGTH_ERROR;
         }
         MacCtx.RxWindow1Delay = MacCtx.NvmCtx->MacParams.ReceiveDelay1 + MacCtx.RxWindow1Config.WindowOffset;
         MacCtx.RxWindow2Delay = MacCtx.NvmCtx->MacParams.ReceiveDelay2 + MacCtx.RxWindow2Config.WindowOffset;
+        MacCtx.RxWindow1DelayTicks = TimerUs2Ticks( ( MacCtx.NvmCtx->MacParams.ReceiveDelay1 * 1000 ) + MacCtx.RxWindow1Config.WindowOffsetUs );
+        MacCtx.RxWindow2DelayTicks = TimerUs2Ticks( ( MacCtx.NvmCtx->MacParams.ReceiveDelay2 * 1000 ) + MacCtx.RxWindow2Config.WindowOffsetUs );
+    }
+
+    if( ( MacCtx.NvmCtx->DeviceClass == CLASS_B ) && ( LoRaMacClassBIsBeaconModeActive( ) == true ) )
+    {
+        // Move the uplink and its RX windows between the ping slots
+        TimerTime_t uplinkShift = LoRaMacClassBGetUplinkShift( RegionGetTimeOnAir( MacCtx.NvmCtx->Region, MacCtx.NvmCtx->MacParams.ChannelsDatarate, MacCtx.PktBufferLen ) );
+
+        if( uplinkShift > 0 )
+        {
+            SetMacState( MacCtx.MacState | LORAMAC_TX_DELAYED );
+            TimerSetValue( &MacCtx.TxDelayedTimer, uplinkShift );
+            TimerStart( &MacCtx.TxDelayedTimer );
+            TraceTimerStart( LORAMAC_TRACE_TIMER_TX_DELAYED, uplinkShift * 1000 );
+            return LORAMAC_STATUS_OK;
+        }
     }
 
     // Secure frame
@@ -2458,11 +4698,20 @@ static LoRaMacStatus_t SecureFrame( uint8_t txDr, uint8_t txCh )
     switch( MacCtx.TxMsg.Type )
     {
         case LORAMAC_MSG_TYPE_JOIN_REQUEST:
+            if( MacCtx.JoinReqPrepared == true )
+            {
+                // Already secured while the transmission was delayed
+                MacCtx.JoinReqPrepared = false;
+                break;
+            }
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
             macCryptoStatus = LoRaMacCryptoPrepareJoinRequest( &MacCtx.TxMsg.Message.JoinReq );
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
             if( LORAMAC_CRYPTO_SUCCESS != macCryptoStatus )
             {
                 return LORAMAC_STATUS_CRYPTO_ERROR;
             }
+            MacCtx.TxPkt = MacCtx.TxMsg.Message.JoinReq.Buffer;
             MacCtx.PktBufferLen = MacCtx.TxMsg.Message.JoinReq.BufSize;
             break;
         case LORAMAC_MSG_TYPE_DATA:
@@ -2477,11 +4726,14 @@ static LoRaMacStatus_t SecureFrame( uint8_t txDr, uint8_t txCh )
                 fCntUp -= 1;
             }
 
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
             macCryptoStatus = LoRaMacCryptoSecureMessage( fCntUp, txDr, txCh, &MacCtx.TxMsg.Message.Data );
+            BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
             if( LORAMAC_CRYPTO_SUCCESS != macCryptoStatus )
             {
                 return LORAMAC_STATUS_CRYPTO_ERROR;
             }
+            MacCtx.TxPkt = MacCtx.TxMsg.Message.Data.Buffer;
             MacCtx.PktBufferLen = MacCtx.TxMsg.Message.Data.BufSize;
             break;
         case LORAMAC_MSG_TYPE_JOIN_ACCEPT:
@@ -2492,7 +4744,24 @@ static LoRaMacStatus_t SecureFrame( uint8_t txDr, uint8_t txCh )
     return LORAMAC_STATUS_OK;
 }
 
-static void CalculateBackOff( uint8_t channel )
+static void GetNextChanParams( int8_t datarate, TimerTime_t now, NextChanParams_t* nextChan )
+{
+    nextChan->AggrTimeOff = MacCtx.NvmCtx->AggregatedTimeOff;
+    nextChan->Datarate = datarate;
+    nextChan->DutyCycleEnabled = MacCtx.NvmCtx->DutyCycleOn;
+    if( MacCtx.NvmCtx->NetworkActivation == ACTIVATION_TYPE_NONE )
+    {
+        nextChan->Joined = false;
+    }
+    else
+    {
+        nextChan->Joined = true;
+    }
+    nextChan->LastAggrTx = MacCtx.NvmCtx->LastTxDoneTime;
+    nextChan->CurrentTime = now;
+}
+
+static void CalculateBackOff( uint8_t channel, TimerTime_t now )
 {
     CalcBackOffParams_t calcBackOff;
 
@@ -2506,20 +4775,76 @@ static void CalculateBackOff( uint8_t channel )
     }
     calcBackOff.DutyCycleEnabled = MacCtx.NvmCtx->DutyCycleOn;
     calcBackOff.Channel = channel;
-    calcBackOff.ElapsedTime = SysTimeSub( SysTimeGetMcuTime( ), MacCtx.NvmCtx->InitializationTime );
     calcBackOff.TxTimeOnAir = MacCtx.TxTimeOnAir;
-    calcBackOff.LastTxIsJoinRequest = false;
-    if( ( MacCtx.MacFlags.Bits.MlmeReq == 1 ) && ( LoRaMacConfirmQueueIsCmdActive( MLME_JOIN ) == true ) )
-    {
-        calcBackOff.LastTxIsJoinRequest = true;
-    }
+    calcBackOff.CurrentTime = now;
 
     // Update regional back-off
     RegionCalcBackOff( MacCtx.NvmCtx->Region, &calcBackOff );
 
     // Update aggregated time-off. This must be an assignment and no incremental
-    // update as we do only calculate the time-off based on the last transmission
-    MacCtx.NvmCtx->AggregatedTimeOff = ( MacCtx.TxTimeOnAir * MacCtx.NvmCtx->AggregatedDCycle - MacCtx.TxTimeOnAir );
+    // update as we do only calculate the time-off based on the last transmission.
+    // The aggregated duty-cycle is a power of two.
+    MacCtx.NvmCtx->AggregatedTimeOff = ( MacCtx.TxTimeOnAir << MacCtx.NvmCtx->MaxDCycle ) - MacCtx.TxTimeOnAir;
+}
+
+static uint32_t GetJoinWindow( TimerTime_t* windowEnd, TimerTime_t* budget )
+{
+    SysTime_t elapsed = SysTimeSub( SysTimeGetMcuTime( ), MacCtx.NvmCtx->InitializationTime );
+    uint32_t window = 0;
+    uint32_t end = 0;
+
+    if( elapsed.Seconds < 3600 )
+    {
+        window = 0;
+        end = 3600;
+        *budget = BACKOFF_BUDGET_1_HOUR;
+    }
+    else if( elapsed.Seconds < ( 3600 + 36000 ) )
+    {
+        window = 1;
+        end = 3600 + 36000;
+        *budget = BACKOFF_BUDGET_10_HOURS;
+    }
+    else
+    {
+        window = 2 + ( elapsed.Seconds - ( 3600 + 36000 ) ) / 86400;
+        end = ( 3600 + 36000 ) + ( window - 1 ) * 86400;
+        *budget = BACKOFF_BUDGET_24_HOURS;
+    }
+    *windowEnd = ( TimerTime_t )( end - elapsed.Seconds ) * 1000 - elapsed.SubSeconds;
+    return window;
+}
+
+static TimerTime_t GetJoinBackOff( TimerTime_t txTimeOnAir )
+{
+    TimerTime_t windowEnd = 0;
+    TimerTime_t budget = 0;
+    TimerTime_t airtime = 0;
+
+    if( GetJoinWindow( &windowEnd, &budget ) == MacCtx.NvmCtx->JoinWindow )
+    {
+        airtime = MacCtx.NvmCtx->JoinAirtime;
+    }
+    if( ( airtime + txTimeOnAir ) <= budget )
+    {
+        return 0;
+    }
+    // The budget is renewed by the next window
+    return windowEnd;
+}
+
+static void AddJoinAirtime( TimerTime_t txTimeOnAir )
+{
+    TimerTime_t windowEnd = 0;
+    TimerTime_t budget = 0;
+    uint32_t window = GetJoinWindow( &windowEnd, &budget );
+
+    if( window != MacCtx.NvmCtx->JoinWindow )
+    {
+        MacCtx.NvmCtx->JoinWindow = window;
+        MacCtx.NvmCtx->JoinAirtime = 0;
+    }
+    MacCtx.NvmCtx->JoinAirtime += txTimeOnAir;
 }
 
 static void RemoveMacCommands( LoRaMacRxSlot_t rxSlot, LoRaMacFrameCtrl_t fCtrl, Mcps_t request )
@@ -2543,12 +4868,77 @@ static void RemoveMacCommands( LoRaMacRxSlot_t rxSlot, LoRaMacFrameCtrl_t fCtrl,
 }
 
 
+static void UpdateMcAddrMap( void )
+{
+    MacCtx.McAddrMapNb = 0;
+    for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++ )
+    {
+        uint32_t address = MacCtx.NvmCtx->MulticastChannelList[i].ChannelParams.Address;
+        uint8_t j = MacCtx.McAddrMapNb;
+
+        if( MacCtx.NvmCtx->MulticastChannelList[i].ChannelParams.IsEnabled == false )
+        {
+            continue;
+        }
+        // Insertion sort
+        while( ( j > 0 ) && ( MacCtx.NvmCtx->MulticastChannelList[MacCtx.McAddrMap[j - 1]].ChannelParams.Address > address ) )
+        {
+            MacCtx.McAddrMap[j] = MacCtx.McAddrMap[j - 1];
+            j--;
+        }
+        MacCtx.McAddrMap[j] = i;
+        MacCtx.McAddrMapNb++;
+    }
+}
+
+static MulticastCtx_t* GetMcCtx( uint32_t address )
+{
+    uint8_t low = 0;
+    uint8_t high = MacCtx.McAddrMapNb;
+
+    // Binary search
+    while( low < high )
+    {
+        uint8_t mid = ( low + high ) >> 1;
+        MulticastCtx_t* mcCtx = &MacCtx.NvmCtx->MulticastChannelList[MacCtx.McAddrMap[mid]];
+
+        if( mcCtx->ChannelParams.Address == address )
+        {
+            return mcCtx;
+        }
+        if( mcCtx->ChannelParams.Address < address )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return NULL;
+}
+
 static void ResetMacParameters( void )
 {
     MacCtx.NvmCtx->NetworkActivation = ACTIVATION_TYPE_NONE;
 
     // ADR counter
     MacCtx.NvmCtx->AdrAckCounter = 0;
+    if( MacCtx.AdrStrategy->Reset != NULL )
+    {
+        MacCtx.AdrStrategy->Reset( );
+    }
+    if( MacCtx.RetryPolicy->Reset != NULL )
+    {
+        MacCtx.RetryPolicy->Reset( );
+    }
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+    RxGainReset( );
+#endif
+#ifdef LORAMAC_CHANNEL_QUALITY_ENABLED
+    memset1( ( uint8_t* )MacCtx.ChannelQuality, 0, sizeof( MacCtx.ChannelQuality ) );
+#endif
+    MacCtx.TxInfoCache.IsValid = false;
 
     MacCtx.ChannelsNbTransCounter = 0;
     MacCtx.AckTimeoutRetries = 1;
@@ -2556,8 +4946,21 @@ static void ResetMacParameters( void )
     MacCtx.AckTimeoutRetry = false;
 
     MacCtx.NvmCtx->MaxDCycle = 0;
-    MacCtx.NvmCtx->AggregatedDCycle = 1;
 
+    MacCtx.NodeAckRequested = false;
+    MacCtx.NvmCtx->SrvAckRequested = false;
+
+    // Reset to application defaults
+    InitDefaultsParams_t params;
+    params.Type = INIT_TYPE_RESTORE_DEFAULT_CHANNELS;
+    params.NvmCtx = NULL;
+    RegionInitDefaults( MacCtx.NvmCtx->Region, &params );
+
+    ResetRegionMacParameters( );
+}
+
+static void ResetRegionMacParameters( void )
+{
     MacCtx.NvmCtx->MacParams.ChannelsTxPower = MacCtx.NvmCtx->MacParamsDefaults.ChannelsTxPower;
     MacCtx.NvmCtx->MacParams.ChannelsDatarate = MacCtx.NvmCtx->MacParamsDefaults.ChannelsDatarate;
     MacCtx.NvmCtx->MacParams.Rx1DrOffset = MacCtx.NvmCtx->MacParamsDefaults.Rx1DrOffset;
@@ -2568,26 +4971,89 @@ static void ResetMacParameters( void )
     MacCtx.NvmCtx->MacParams.MaxEirp = MacCtx.NvmCtx->MacParamsDefaults.MaxEirp;
     MacCtx.NvmCtx->MacParams.AntennaGain = MacCtx.NvmCtx->MacParamsDefaults.AntennaGain;
 
-    MacCtx.NodeAckRequested = false;
-    MacCtx.NvmCtx->SrvAckRequested = false;
-
-    // Reset to application defaults
-    InitDefaultsParams_t params;
-    params.Type = INIT_TYPE_RESTORE_DEFAULT_CHANNELS;
-    params.NvmCtx = NULL;
-    RegionInitDefaults( MacCtx.NvmCtx->Region, &params );
-
     // Initialize channel index.
     MacCtx.Channel = 0;
     MacCtx.NvmCtx->LastTxChannel = MacCtx.Channel;
 
     // Initialize Rx2 config parameters.
-    MacCtx.RxWindow2Config.Channel = MacCtx.Channel;
-    MacCtx.RxWindow2Config.Frequency = MacCtx.NvmCtx->MacParams.Rx2Channel.Frequency;
-    MacCtx.RxWindow2Config.DownlinkDwellTime = MacCtx.NvmCtx->MacParams.DownlinkDwellTime;
-    MacCtx.RxWindow2Config.RepeaterSupport = MacCtx.NvmCtx->RepeaterSupport;
-    MacCtx.RxWindow2Config.RxContinuous = false;
-    MacCtx.RxWindow2Config.RxSlot = RX_SLOT_WIN_2;
+    SetRxWindow2Config( );
+    MacCtx.RxWindowPrepared = RX_SLOT_NONE;
+}
+
+static void InitMacParamsDefaults( void )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    getPhy.Attribute = PHY_DUTY_CYCLE;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->DutyCycleOn = ( bool ) phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_TX_POWER;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.ChannelsTxPower = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_TX_DR;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.ChannelsDatarate = phyParam.Value;
+
+    getPhy.Attribute = PHY_MAX_RX_WINDOW;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.MaxRxWindow = phyParam.Value;
+
+    getPhy.Attribute = PHY_RECEIVE_DELAY1;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.ReceiveDelay1 = phyParam.Value;
+
+    getPhy.Attribute = PHY_RECEIVE_DELAY2;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.ReceiveDelay2 = phyParam.Value;
+
+    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY1;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.JoinAcceptDelay1 = phyParam.Value;
+
+    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY2;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.JoinAcceptDelay2 = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_DR1_OFFSET;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.Rx1DrOffset = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_RX2_FREQUENCY;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.Rx2Channel.Frequency = phyParam.Value;
+    MacCtx.NvmCtx->MacParamsDefaults.RxCChannel.Frequency = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_RX2_DR;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.Rx2Channel.Datarate = phyParam.Value;
+    MacCtx.NvmCtx->MacParamsDefaults.RxCChannel.Datarate = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_UPLINK_DWELL_TIME;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.UplinkDwellTime = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_DOWNLINK_DWELL_TIME;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.DownlinkDwellTime = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_MAX_EIRP;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.MaxEirp = phyParam.fValue;
+
+    getPhy.Attribute = PHY_DEF_ANTENNA_GAIN;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.NvmCtx->MacParamsDefaults.AntennaGain = phyParam.fValue;
+
+    getPhy.Attribute = PHY_DEF_ADR_ACK_LIMIT;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.AdrAckLimit = phyParam.Value;
+
+    getPhy.Attribute = PHY_DEF_ADR_ACK_DELAY;
+    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
+    MacCtx.AdrAckDelay = phyParam.Value;
 }
 
 /*!
@@ -2598,49 +5064,136 @@ static void ResetMacParameters( void )
  */
 static void RxWindowSetup( TimerEvent_t* rxTimer, RxConfigParams_t* rxConfig )
 {
+    bool prepared = ( MacCtx.RxWindowPrepared == rxConfig->RxSlot );
+
     TimerStop( rxTimer );
+    MacCtx.RxWindowPrepared = RX_SLOT_NONE;
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    MacCtx.RxCWindowArmed = false;
+#endif
 
     // Ensure the radio is Idle
     Radio.Standby( );
 
-    if( RegionRxConfig( MacCtx.NvmCtx->Region, rxConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true )
+    // A prepared window only has to be started
+    if( ( prepared == true ) ||
+        ( RegionRxConfig( MacCtx.NvmCtx->Region, rxConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true ) )
     {
-        Radio.Rx( MacCtx.NvmCtx->MacParams.MaxRxWindow );
+        UplinkCostUpdate( rxConfig->RxSlot );
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+        MacCtx.RxGainBoosted = false;
+        if( ( ( rxConfig->RxSlot == RX_SLOT_WIN_1 ) || ( rxConfig->RxSlot == RX_SLOT_WIN_2 ) ) &&
+            ( RxGainIsBoosted( ) == true ) )
+        {
+            MacCtx.RxGainBoosted = true;
+            Radio.RxBoosted( MacCtx.NvmCtx->MacParams.MaxRxWindow );
+        }
+        else
+#endif
+        {
+            Radio.Rx( MacCtx.NvmCtx->MacParams.MaxRxWindow );
+        }
         MacCtx.RxSlot = rxConfig->RxSlot;
+        TraceRxWindow( rxConfig->RxSlot, MacCtx.McpsIndication.RxDatarate );
+#ifdef LORAMAC_RX_TIMING_STATS_ENABLED
+        MacCtx.RxWindowStartTicks = TimerGetCurrentTicks( );
+#endif
     }
 }
 
 static void OpenContinuousRxCWindow( void )
 {
+    int8_t* rxDatarate = ( int8_t* )&MacCtx.McpsIndication.RxDatarate;
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    const struct Radio_s* uplinkRadio = NULL;
+#endif
+
     MacCtx.RxWindowCConfig.RxSlot = RX_SLOT_WIN_CLASS_C;
     // Setup continuous listening
     MacCtx.RxWindowCConfig.RxContinuous = true;
 
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    if( MacCtx.RxCRadio != NULL )
+    {
+        // The region layer configures the selected radio. The other radio
+        // stays available for the class A exchanges.
+        uplinkRadio = RadioSelect( MacCtx.RxCRadio );
+        rxDatarate = &MacCtx.RxCDatarate;
+        MacCtx.RxCRadioRestart = false;
+        Radio.Standby( );
+    }
+#endif
+
     // At this point the Radio should be idle.
     // Thus, there is no need to set the radio in standby mode.
-    if( RegionRxConfig( MacCtx.NvmCtx->Region, &MacCtx.RxWindowCConfig, ( int8_t* )&MacCtx.McpsIndication.RxDatarate ) == true )
+    if( RegionRxConfig( MacCtx.NvmCtx->Region, &MacCtx.RxWindowCConfig, rxDatarate ) == true )
+    {
+        uint32_t rxTime = 0;
+        uint32_t sleepTime = 0;
+
+        if( ( MacCtx.RxCDutyCyclePreambleLen != 0 ) && ( Radio.SetRxDutyCycle != NULL ) )
+        {
+            // Listen for the minimum detection symbols. A whole listening period
+            // must fit in the preamble whatever the preamble start time.
+            uint32_t rxSymbols = MacCtx.NvmCtx->MacParams.MinRxSymbols;
+            uint32_t wakeUpTimeUs = Radio.GetWakeupTime( ) * 1000;
+
+            rxTime = rxSymbols * MacCtx.RxWindowCConfig.SymbolTimeUs;
+            if( MacCtx.RxCDutyCyclePreambleLen > ( 2 * rxSymbols ) )
+            {
+                sleepTime = ( MacCtx.RxCDutyCyclePreambleLen - ( 2 * rxSymbols ) ) * MacCtx.RxWindowCConfig.SymbolTimeUs;
+                sleepTime = ( sleepTime > wakeUpTimeUs ) ? ( sleepTime - wakeUpTimeUs ) : 0;
+            }
+        }
+
+        if( sleepTime != 0 )
+        {
+            // The radio periods are expressed in steps of 15.625 us
+            Radio.SetRxDutyCycle( ( rxTime * 64 ) / 1000, ( sleepTime * 64 ) / 1000 );
+        }
+        else
+        {
+            Radio.Rx( 0 ); // Continuous mode
+        }
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+        // The dedicated radio leaves the slot of the class A exchanges as is
+        if( ( uplinkRadio == NULL ) || ( MacCtx.RxSlot == RX_SLOT_NONE ) )
+#endif
+        {
+            MacCtx.RxSlot = MacCtx.RxWindowCConfig.RxSlot;
+        }
+        TraceRxWindow( RX_SLOT_WIN_CLASS_C, *rxDatarate );
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+        MacCtx.RxCWindowArmed = true;
+#endif
+    }
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    if( uplinkRadio != NULL )
     {
-        Radio.Rx( 0 ); // Continuous mode
-        MacCtx.RxSlot = MacCtx.RxWindowCConfig.RxSlot;
+        RadioSelect( uplinkRadio );
     }
+#endif
 }
 
-LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl, uint8_t fPort, void* fBuffer, uint16_t fBufferSize )
+LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl, uint8_t fPort, void* fBuffer, uint16_t fBufferSize, bool inPlace )
 {
     MacCtx.PktBufferLen = 0;
+    MacCtx.TxMacCmdsSize = 0;
     MacCtx.NodeAckRequested = false;
     uint32_t fCntUp = 0;
     size_t macCmdsSize = 0;
     uint8_t availableSize = 0;
+    uint8_t hdrSize = 0;
+    bool isAnsDeferred = true;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
 
     if( fBuffer == NULL )
     {
         fBufferSize = 0;
     }
 
-    memcpy1( MacCtx.AppData, ( uint8_t* ) fBuffer, fBufferSize );
     MacCtx.AppDataSize = fBufferSize;
-    MacCtx.PktBuffer[0] = macHdr->Value;
+    MacCtx.TxPkt = MacCtx.PktBuffer;
 
     switch( macHdr->Bits.MType )
     {
@@ -2656,7 +5209,7 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl
             MacCtx.TxMsg.Message.Data.FHDR.DevAddr = MacCtx.NvmCtx->DevAddr;
             MacCtx.TxMsg.Message.Data.FHDR.FCtrl.Value = fCtrl->Value;
             MacCtx.TxMsg.Message.Data.FRMPayloadSize = MacCtx.AppDataSize;
-            MacCtx.TxMsg.Message.Data.FRMPayload = MacCtx.AppData;
+            MacCtx.TxMsg.Message.Data.FRMPayload = ( uint8_t* ) fBuffer;
 
             if( LORAMAC_CRYPTO_SUCCESS != LoRaMacCryptoGetFCntUp( &fCntUp ) )
             {
@@ -2679,33 +5232,37 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl
             {
                 availableSize = GetMaxAppPayloadWithoutFOptsLength( MacCtx.NvmCtx->MacParams.ChannelsDatarate );
 
-                // There is application payload available and the MAC commands fit into FOpts field.
-                if( ( MacCtx.AppDataSize > 0 ) && ( macCmdsSize <= LORA_MAC_COMMAND_MAX_FOPTS_LENGTH ) )
+                // There is application payload available. Pack the most urgent
+                // MAC commands into the room left in the FOpts field, the
+                // requests which don't fit wait for a next uplink.
+                if( ( MacCtx.AppDataSize > 0 ) && ( MacCtx.AppDataSize <= availableSize ) )
                 {
-                    if( LoRaMacCommandsSerializeCmds( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH, &macCmdsSize, MacCtx.TxMsg.Message.Data.FHDR.FOpts ) != LORAMAC_COMMANDS_SUCCESS )
+                    if( LoRaMacCommandsPackCmds( MIN( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH, availableSize - MacCtx.AppDataSize ),
+                                                 &macCmdsSize, MacCtx.TxMsg.Message.Data.FHDR.FOpts, &isAnsDeferred ) != LORAMAC_COMMANDS_SUCCESS )
                     {
                         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
                     }
+                }
+
+                // The MAC commands fit into FOpts field.
+                if( ( MacCtx.AppDataSize > 0 ) && ( isAnsDeferred == false ) )
+                {
                     fCtrl->Bits.FOptsLen = macCmdsSize;
                     // Update FCtrl field with new value of FOptionsLength
                     MacCtx.TxMsg.Message.Data.FHDR.FCtrl.Value = fCtrl->Value;
                 }
-                // There is application payload available but the MAC commands does NOT fit into FOpts field.
-                else if( ( MacCtx.AppDataSize > 0 ) && ( macCmdsSize > LORA_MAC_COMMAND_MAX_FOPTS_LENGTH ) )
+                // Add the mac commands to the FRMPayload. The application
+                // payload is skipped if the answers do NOT fit into FOpts field.
+                else
                 {
-
                     if( LoRaMacCommandsSerializeCmds( availableSize, &macCmdsSize, MacCtx.NvmCtx->MacCommandsBuffer ) != LORAMAC_COMMANDS_SUCCESS )
                     {
                         return LORAMAC_STATUS_MAC_COMMAD_ERROR;
                     }
-                    return LORAMAC_STATUS_SKIPPED_APP_DATA;
-                }
-                // No application payload available therefore add all mac commands to the FRMPayload.
-                else
-                {
-                    if( LoRaMacCommandsSerializeCmds( availableSize, &macCmdsSize, MacCtx.NvmCtx->MacCommandsBuffer ) != LORAMAC_COMMANDS_SUCCESS )
+                    if( MacCtx.AppDataSize > 0 )
                     {
-                        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+                        MacCtx.AppDataSize = 0;
+                        status = LORAMAC_STATUS_SKIPPED_APP_DATA;
                     }
                     // Force FPort to be zero
                     MacCtx.TxMsg.Message.Data.FPort = 0;
@@ -2713,21 +5270,76 @@ LoRaMacStatus_t PrepareFrame( LoRaMacHeader_t* macHdr, LoRaMacFrameCtrl_t* fCtrl
                     MacCtx.TxMsg.Message.Data.FRMPayload = MacCtx.NvmCtx->MacCommandsBuffer;
                     MacCtx.TxMsg.Message.Data.FRMPayloadSize = macCmdsSize;
                 }
+                MacCtx.TxMacCmdsSize = macCmdsSize;
+            }
+
+            // Only the frames not built around the application buffer need
+            // the frame buffer
+            if( ( inPlace == false ) || ( MacCtx.AppDataSize == 0 ) || ( MacCtx.TxMsg.Message.Data.FRMPayload != fBuffer ) )
+            {
+                if( AcquirePktBuffer( ) == false )
+                {
+                    return LORAMAC_STATUS_BUSY;
+                }
+                MacCtx.TxMsg.Message.Data.Buffer = MacCtx.PktBuffer;
             }
 
+            // Place the application payload where the serializer expects it,
+            // so that it is encrypted in place and not copied again.
+            if( ( MacCtx.AppDataSize > 0 ) && ( MacCtx.TxMsg.Message.Data.FRMPayload == fBuffer ) )
+            {
+                hdrSize = LORAMAC_MHDR_FIELD_SIZE + LORAMAC_FHDR_DEV_ADD_FIELD_SIZE + LORAMAC_FHDR_F_CTRL_FIELD_SIZE +
+                          LORAMAC_FHDR_F_CNT_FIELD_SIZE + fCtrl->Bits.FOptsLen + LORAMAC_F_PORT_FIELD_SIZE;
+
+                if( ( hdrSize + fBufferSize + LORAMAC_MIC_FIELD_SIZE ) > LORAMAC_PHY_MAXPAYLOAD )
+                {
+                    return LORAMAC_STATUS_LENGTH_ERROR;
+                }
+                if( inPlace == true )
+                {
+                    // The headroom of the application buffer holds the header
+                    MacCtx.TxMsg.Message.Data.Buffer = ( uint8_t* ) fBuffer - hdrSize;
+                    MacCtx.TxMsg.Message.Data.BufSize = hdrSize + MacCtx.AppDataSize + LORAMAC_MIC_FIELD_SIZE;
+                }
+                else
+                {
+                    memcpy1( MacCtx.PktBuffer + hdrSize, ( uint8_t* ) fBuffer, MacCtx.AppDataSize );
+                    MacCtx.TxMsg.Message.Data.FRMPayload = MacCtx.PktBuffer + hdrSize;
+                }
+            }
             break;
         case FRAME_TYPE_PROPRIETARY:
+            if( ( inPlace == false ) || ( fBuffer == NULL ) || ( MacCtx.AppDataSize == 0 ) )
+            {
+                if( AcquirePktBuffer( ) == false )
+                {
+                    return LORAMAC_STATUS_BUSY;
+                }
+                MacCtx.TxPkt = MacCtx.PktBuffer;
+            }
             if( ( fBuffer != NULL ) && ( MacCtx.AppDataSize > 0 ) )
             {
-                memcpy1( MacCtx.PktBuffer + LORAMAC_MHDR_FIELD_SIZE, ( uint8_t* ) fBuffer, MacCtx.AppDataSize );
+                if( ( LORAMAC_MHDR_FIELD_SIZE + fBufferSize ) > LORAMAC_PHY_MAXPAYLOAD )
+                {
+                    return LORAMAC_STATUS_LENGTH_ERROR;
+                }
+                if( inPlace == true )
+                {
+                    MacCtx.TxPkt = ( uint8_t* ) fBuffer - LORAMAC_MHDR_FIELD_SIZE;
+                }
+                else
+                {
+                    memcpy1( MacCtx.PktBuffer + LORAMAC_MHDR_FIELD_SIZE, ( uint8_t* ) fBuffer, MacCtx.AppDataSize );
+                }
                 MacCtx.PktBufferLen = LORAMAC_MHDR_FIELD_SIZE + MacCtx.AppDataSize;
             }
+            MacCtx.TxPkt[0] = macHdr->Value;
             break;
         default:
             return LORAMAC_STATUS_SERVICE_UNKNOWN;
     }
 
-    return LORAMAC_STATUS_OK;
+    return status;
 }
 
 LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
@@ -2741,6 +5353,8 @@ LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
     txConfig.MaxEirp = MacCtx.NvmCtx->MacParams.MaxEirp;
     txConfig.AntennaGain = MacCtx.NvmCtx->MacParams.AntennaGain;
     txConfig.PktLen = MacCtx.PktBufferLen;
+    txConfig.HopPeriod = MacCtx.TxHopPeriod;
+    txConfig.HopSeed = MacCtx.NvmCtx->DevAddr;
 
 
     if( LoRaMacClassBIsBeaconExpected( ) == true )
@@ -2788,16 +5402,46 @@ LoRaMacStatus_t SendFrameOnChannel( uint8_t channel )
 
     LoRaMacClassBHaltBeaconing( );
 
-    MacCtx.MacState |= LORAMAC_TX_RUNNING;
+    SetMacState( MacCtx.MacState | LORAMAC_TX_RUNNING );
+    if( MacCtx.LbtCadOn == true )
+    {
+        SetMacState( MacCtx.MacState | LORAMAC_LBT_CAD );
+        Radio.StartCad( );
+        if( ( Radio.GetStatus( ) == RF_CAD ) || ( LoRaMacRadioEvents.Events.CadDone == 1 ) )
+        {
+            // The frame is sent once the channel is found free
+            return LORAMAC_STATUS_OK;
+        }
+        // No CAD with the current modem
+        SetMacState( MacCtx.MacState & ~LORAMAC_LBT_CAD );
+    }
+
+    SendFrame( );
+
+    return LORAMAC_STATUS_OK;
+}
+
+static void SendFrame( void )
+{
+    MacCtx.LbtCadTrials = 0;
     if( MacCtx.NodeAckRequested == false )
     {
         MacCtx.ChannelsNbTransCounter++;
     }
 
-    // Send now
-    Radio.Send( MacCtx.PktBuffer, MacCtx.PktBufferLen );
+    UplinkCostUpdate( RX_SLOT_NONE );
+    if( MacCtx.UplinkCostActive == true )
+    {
+        MacCtx.McpsConfirm.Cost.NbTx++;
+        if( Radio.GetStats == NULL )
+        {
+            MacCtx.McpsConfirm.Cost.TxTime += MacCtx.TxTimeOnAir;
+        }
+    }
 
-    return LORAMAC_STATUS_OK;
+    // Send now
+    TraceTx( );
+    Radio.Send( MacCtx.TxPkt, MacCtx.PktBufferLen );
 }
 
 LoRaMacStatus_t SetTxContinuousWave( uint16_t timeout )
@@ -2813,7 +5457,7 @@ LoRaMacStatus_t SetTxContinuousWave( uint16_t timeout )
 
     RegionSetContinuousWave( MacCtx.NvmCtx->Region, &continuousWave );
 
-    MacCtx.MacState |= LORAMAC_TX_RUNNING;
+    SetMacState( MacCtx.MacState | LORAMAC_TX_RUNNING );
 
     return LORAMAC_STATUS_OK;
 }
@@ -2822,7 +5466,7 @@ LoRaMacStatus_t SetTxContinuousWave1( uint16_t timeout, uint32_t frequency, uint
 {
     Radio.SetTxContinuousWave( frequency, power, timeout );
 
-    MacCtx.MacState |= LORAMAC_TX_RUNNING;
+    SetMacState( MacCtx.MacState | LORAMAC_TX_RUNNING );
 
     return LORAMAC_STATUS_OK;
 }
@@ -2857,11 +5501,16 @@ LoRaMacStatus_t RestoreCtxs( LoRaMacCtxs_t* contexts )
     {
         memcpy1( ( uint8_t* ) &NvmMacCtx, ( uint8_t* ) contexts->MacNvmCtx, contexts->MacNvmCtxSize );
     }
+    UpdateMcAddrMap( );
 
     InitDefaultsParams_t params;
     params.Type = INIT_TYPE_RESTORE_CTX;
     params.NvmCtx = contexts->RegionNvmCtx;
     RegionInitDefaults( MacCtx.NvmCtx->Region, &params );
+    // Only the context of the active region is stored
+    MacCtx.RegionsInitialized = 1 << MacCtx.NvmCtx->Region;
+
+    PhyParamsCacheInit( );
 
     if( SecureElementRestoreNvmCtx( contexts->SecureElementNvmCtx ) != SECURE_ELEMENT_SUCCESS )
     {
@@ -2888,6 +5537,15 @@ LoRaMacStatus_t RestoreCtxs( LoRaMacCtxs_t* contexts )
         return LORAMAC_STATUS_CONFIRM_QUEUE_ERROR;
     }
 
+    // The caches were built with the replaced session, e.g. on a network
+    // profile switch
+    LoRaMacCryptoDropKeyStreams( );
+    MacCtx.TxInfoCache.IsValid = false;
+    MacCtx.FPendingUplinkRequested = false;
+#ifdef LORAMAC_RX_GAIN_ADAPTIVE_ENABLED
+    RxGainReset( );
+#endif
+
     return LORAMAC_STATUS_OK;
 }
 
@@ -3003,7 +5661,7 @@ static bool StopRetransmission( void )
     MacCtx.ChannelsNbTransCounter = 0;
     MacCtx.NodeAckRequested = false;
     MacCtx.AckTimeoutRetry = false;
-    MacCtx.MacState &= ~LORAMAC_TX_RUNNING;
+    SetMacState( MacCtx.MacState & ~LORAMAC_TX_RUNNING );
 
     return true;
 }
@@ -3012,18 +5670,11 @@ static void AckTimeoutRetriesProcess( void )
 {
     if( MacCtx.AckTimeoutRetriesCounter < MacCtx.AckTimeoutRetries )
     {
-        MacCtx.AckTimeoutRetriesCounter++;
-        if( ( MacCtx.AckTimeoutRetriesCounter % 2 ) == 1 )
-        {
-            GetPhyParams_t getPhy;
-            PhyParam_t phyParam;
+        LoRaMacRetryParams_t retryParams;
 
-            getPhy.Attribute = PHY_NEXT_LOWER_TX_DR;
-            getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
-            getPhy.Datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
-            phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-            MacCtx.NvmCtx->MacParams.ChannelsDatarate = phyParam.Value;
-        }
+        MacCtx.AckTimeoutRetriesCounter++;
+        GetRetryParams( &retryParams );
+        MacCtx.NvmCtx->MacParams.ChannelsDatarate = MacCtx.RetryPolicy->GetRetryDatarate( &retryParams );
     }
 }
 
@@ -3042,6 +5693,15 @@ static void AckTimeoutRetriesFinalize( void )
     MacCtx.McpsConfirm.NbRetries = MacCtx.AckTimeoutRetriesCounter;
 }
 
+static void GetRetryParams( LoRaMacRetryParams_t* params )
+{
+    params->Trial = MacCtx.AckTimeoutRetriesCounter;
+    params->NbTrials = MacCtx.AckTimeoutRetries;
+    params->Datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
+    params->UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
+    params->Region = MacCtx.NvmCtx->Region;
+}
+
 static void CallNvmCtxCallback( LoRaMacNvmCtxModule_t module )
 {
     if( ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->NvmContextChange != NULL ) )
@@ -3098,8 +5758,6 @@ static uint8_t IsRequestPending( void )
 
 LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacCallback_t* callbacks, LoRaMacRegion_t region )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     LoRaMacClassBCallback_t classBCallbacks;
     LoRaMacClassBParams_t classBParams;
 
@@ -3125,6 +5783,9 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     // Confirm queue reset
     LoRaMacConfirmQueueInit( primitives, EventConfirmQueueNvmCtxChanged );
 
+    // Uplink queue reset
+    LoRaMacTxQueueInit( );
+
     // Initialize the module context with zeros
     memset1( ( uint8_t* ) &NvmMacCtx, 0x00, sizeof( LoRaMacNvmCtx_t ) );
     memset1( ( uint8_t* ) &MacCtx, 0x00, sizeof( LoRaMacCtx_t ) );
@@ -3145,75 +5806,7 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     MacCtx.NvmCtx->Version = lrWanVersion;
 
     // Reset to defaults
-    getPhy.Attribute = PHY_DUTY_CYCLE;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->DutyCycleOn = ( bool ) phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_TX_POWER;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.ChannelsTxPower = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_TX_DR;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.ChannelsDatarate = phyParam.Value;
-
-    getPhy.Attribute = PHY_MAX_RX_WINDOW;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.MaxRxWindow = phyParam.Value;
-
-    getPhy.Attribute = PHY_RECEIVE_DELAY1;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.ReceiveDelay1 = phyParam.Value;
-
-    getPhy.Attribute = PHY_RECEIVE_DELAY2;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.ReceiveDelay2 = phyParam.Value;
-
-    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY1;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.JoinAcceptDelay1 = phyParam.Value;
-
-    getPhy.Attribute = PHY_JOIN_ACCEPT_DELAY2;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.JoinAcceptDelay2 = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_DR1_OFFSET;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.Rx1DrOffset = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_RX2_FREQUENCY;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.Rx2Channel.Frequency = phyParam.Value;
-    MacCtx.NvmCtx->MacParamsDefaults.RxCChannel.Frequency = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_RX2_DR;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.Rx2Channel.Datarate = phyParam.Value;
-    MacCtx.NvmCtx->MacParamsDefaults.RxCChannel.Datarate = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_UPLINK_DWELL_TIME;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.UplinkDwellTime = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_DOWNLINK_DWELL_TIME;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.DownlinkDwellTime = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_MAX_EIRP;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.MaxEirp = phyParam.fValue;
-
-    getPhy.Attribute = PHY_DEF_ANTENNA_GAIN;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.NvmCtx->MacParamsDefaults.AntennaGain = phyParam.fValue;
-
-    getPhy.Attribute = PHY_DEF_ADR_ACK_LIMIT;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.AdrAckLimit = phyParam.Value;
-
-    getPhy.Attribute = PHY_DEF_ADR_ACK_DELAY;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
-    MacCtx.AdrAckDelay = phyParam.Value;
+    InitMacParamsDefaults( );
 
     // Init parameters which are not set in function ResetMacParameters
     MacCtx.NvmCtx->MacParamsDefaults.ChannelsNbTrans = 1;
@@ -3229,6 +5822,16 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     MacCtx.NvmCtx->MacParams.JoinAcceptDelay2 = MacCtx.NvmCtx->MacParamsDefaults.JoinAcceptDelay2;
     MacCtx.NvmCtx->MacParams.ChannelsNbTrans = MacCtx.NvmCtx->MacParamsDefaults.ChannelsNbTrans;
 
+    MacCtx.AdrStrategy = &LoRaMacAdrStrategyBackoff;
+    MacCtx.RetryPolicy = &LoRaMacRetryPolicyDefault;
+    MacCtx.FPendingMaxUplinks = LORAMAC_FPENDING_MAX_UPLINKS;
+    MacCtx.ClassCAckDelay = LORAMAC_CLASS_C_ACK_DELAY;
+    MacCtx.BatteryLevel = BAT_LEVEL_NO_MEASURE;
+    MacCtx.BatteryLevelSet = false;
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+    MacCtx.RxCQueueDepth = LORAMAC_CLASS_C_RX_QUEUE_SIZE;
+#endif
+
     ResetMacParameters( );
 
     MacCtx.NvmCtx->PublicNetwork = true;
@@ -3236,7 +5839,10 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     MacCtx.MacPrimitives = primitives;
     MacCtx.MacCallbacks = callbacks;
     MacCtx.MacFlags.Value = 0;
-    MacCtx.MacState = LORAMAC_STOPPED;
+#ifdef LORAMAC_PROFILE_ENABLED
+    ProfileReset( );
+#endif
+    SetMacState( LORAMAC_STOPPED );
 
     // Reset duty cycle times
     MacCtx.NvmCtx->LastTxDoneTime = 0;
@@ -3247,22 +5853,30 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     TimerInit( &MacCtx.RxWindowTimer1, OnRxWindow1TimerEvent );
     TimerInit( &MacCtx.RxWindowTimer2, OnRxWindow2TimerEvent );
     TimerInit( &MacCtx.AckTimeoutTimer, OnAckTimeoutTimerEvent );
+    TimerInit( &MacCtx.ClassCAckTimer, OnClassCAckTimerEvent );
+    TimerSetSlack( &MacCtx.TxDelayedTimer, LORAMAC_TIMER_SLACK );
+    TimerSetSlack( &MacCtx.AckTimeoutTimer, LORAMAC_TIMER_SLACK );
 
     // Store the current initialization time
     MacCtx.NvmCtx->InitializationTime = SysTimeGetMcuTime( );
 
     // Initialize Radio driver
-    MacCtx.RadioEvents.TxDone = OnRadioTxDone;
-    MacCtx.RadioEvents.RxDone = OnRadioRxDone;
+    MacCtx.RadioEvents.TxDoneTimestamped = OnRadioTxDone;
+    MacCtx.RadioEvents.RxDoneTimestamped = OnRadioRxDone;
     MacCtx.RadioEvents.RxError = OnRadioRxError;
     MacCtx.RadioEvents.TxTimeout = OnRadioTxTimeout;
     MacCtx.RadioEvents.RxTimeout = OnRadioRxTimeout;
+    MacCtx.RadioEvents.CadDone = OnRadioCadDone;
+    TRACE_BEGIN( TRACE_PROBE_MAC_INIT_RADIO );
     Radio.Init( &MacCtx.RadioEvents );
 
     InitDefaultsParams_t params;
     params.Type = INIT_TYPE_INIT;
     params.NvmCtx = NULL;
     RegionInitDefaults( MacCtx.NvmCtx->Region, &params );
+    MacCtx.RegionsInitialized = 1 << MacCtx.NvmCtx->Region;
+
+    PhyParamsCacheInit( );
 
     // Initialize the Secure Element driver
     if( SecureElementInit( EventSecureElementNvmCtxChanged ) != SECURE_ELEMENT_SUCCESS )
@@ -3273,72 +5887,370 @@ LoRaMacStatus_t LoRaMacInitialization( LoRaMacPrimitives_t* primitives, LoRaMacC
     // Initialize Crypto module
     if( LoRaMacCryptoInit( EventCryptoNvmCtxChanged ) != LORAMAC_CRYPTO_SUCCESS )
     {
-        return LORAMAC_STATUS_CRYPTO_ERROR;
+        return LORAMAC_STATUS_CRYPTO_ERROR;
+    }
+
+    // Initialize MAC commands module
+    if( LoRaMacCommandsInit( EventCommandsNvmCtxChanged ) != LORAMAC_COMMANDS_SUCCESS )
+    {
+        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+    }
+
+    // Set multicast downlink counter reference
+    if( LoRaMacCryptoSetMulticastReference( MacCtx.NvmCtx->MulticastChannelList ) != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return LORAMAC_STATUS_CRYPTO_ERROR;
+    }
+
+    // Random seed initialization. The radio only provides the entropy the
+    // MCU can't.
+    EntropyInit( Radio.Random );
+    srand1( EntropyGetRandom( ) );
+
+    Radio.SetPublicNetwork( MacCtx.NvmCtx->PublicNetwork );
+    Radio.Sleep( );
+    TRACE_END( TRACE_PROBE_MAC_INIT_RADIO );
+
+    // Initialize class b
+    // Apply callback
+    classBCallbacks.GetTemperatureLevel = NULL;
+    classBCallbacks.MacProcessNotify = NULL;
+    if( callbacks != NULL )
+    {
+        classBCallbacks.GetTemperatureLevel = callbacks->GetTemperatureLevel;
+        classBCallbacks.MacProcessNotify = callbacks->MacProcessNotify;
+    }
+
+    // Must all be static. Don't use local references.
+    classBParams.MlmeIndication = &MacCtx.MlmeIndication;
+    classBParams.McpsIndication = &MacCtx.McpsIndication;
+    classBParams.MlmeConfirm = &MacCtx.MlmeConfirm;
+    classBParams.LoRaMacFlags = &MacCtx.MacFlags;
+    classBParams.LoRaMacDevAddr = &MacCtx.NvmCtx->DevAddr;
+    classBParams.LoRaMacRegion = &MacCtx.NvmCtx->Region;
+    classBParams.LoRaMacParams = &MacCtx.NvmCtx->MacParams;
+    classBParams.MulticastChannels = &MacCtx.NvmCtx->MulticastChannelList[0];
+
+    LoRaMacClassBInit( &classBParams, &classBCallbacks, &EventClassBNvmCtxChanged );
+
+    LoRaMacEnableRequests( LORAMAC_REQUEST_HANDLING_ON );
+
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacStart( void )
+{
+    SetMacState( LORAMAC_IDLE );
+
+    // Send the uplinks queued while the MAC was stopped
+    if( ( LoRaMacTxQueueGetCnt( ) != 0 ) &&
+        ( MacCtx.MacCallbacks != NULL ) && ( MacCtx.MacCallbacks->MacProcessNotify != NULL ) )
+    {
+        MacCtx.MacCallbacks->MacProcessNotify( );
+    }
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacStop( void )
+{
+    if( LoRaMacIsBusy( ) == false )
+    {
+        SetMacState( LORAMAC_STOPPED );
+        return LORAMAC_STATUS_OK;
+    }
+    else if(  MacCtx.MacState == LORAMAC_STOPPED )
+    {
+        return LORAMAC_STATUS_OK;
+    }
+    return LORAMAC_STATUS_BUSY;
+}
+
+/*!
+ * Sub module non-volatile context stored by the instances
+ */
+typedef struct sInstanceNvmCtxModule
+{
+    /*!
+     * Gets the module non-volatile context and its size
+     */
+    void* ( *GetNvmCtx )( size_t* nvmCtxSize );
+    /*!
+     * Loads a stored context into the module and drops the module state
+     * derived from the previous one. NULL when a plain copy is enough.
+     */
+    void ( *RestoreNvmCtx )( void* nvmCtx );
+}InstanceNvmCtxModule_t;
+
+/*!
+ * \brief Loads a stored secure element context. The keys expanded from the
+ *        previous instance context are dropped.
+ *
+ * \param [IN] nvmCtx Stored secure element context
+ */
+static void InstanceRestoreSecureElementNvmCtx( void* nvmCtx )
+{
+    SecureElementRestoreNvmCtx( nvmCtx );
+}
+
+/*!
+ * Sub modules contexts of the instance storage, stored after the region
+ * context. The crypto context is copied as is, LoRaMacCryptoRestoreNvmCtx
+ * would skip the reserved uplink frame counters. Its key streams are dropped
+ * by LoRaMacInstanceSelect.
+ */
+static const InstanceNvmCtxModule_t InstanceNvmCtxModules[] =
+{
+    { .GetNvmCtx = SecureElementGetNvmCtx,       .RestoreNvmCtx = InstanceRestoreSecureElementNvmCtx },
+    { .GetNvmCtx = LoRaMacCryptoGetNvmCtx,       .RestoreNvmCtx = NULL },
+    { .GetNvmCtx = LoRaMacCommandsGetNvmCtx,     .RestoreNvmCtx = NULL },
+    { .GetNvmCtx = LoRaMacClassBGetNvmCtx,       .RestoreNvmCtx = NULL },
+    { .GetNvmCtx = LoRaMacConfirmQueueGetNvmCtx, .RestoreNvmCtx = NULL },
+};
+
+/*!
+ * \brief Copies the sub modules non-volatile contexts from or to the
+ *        instance storage
+ *
+ * \param [IN] buffer Sub modules non-volatile contexts storage
+ * \param [IN] region Region of the stack state
+ * \param [IN] save   Set to true to copy the contexts to the storage
+ */
+static void InstanceCopyNvmCtxs( uint8_t* buffer, LoRaMacRegion_t region, bool save )
+{
+    GetNvmCtxParams_t params ={ 0 };
+    void* ctx = RegionGetNvmCtx( region, &params );
+
+    if( ctx != NULL )
+    {
+        if( save == true )
+        {
+            memcpy1( buffer, ( uint8_t* ) ctx, params.nvmCtxSize );
+        }
+        else
+        {
+            memcpy1( ( uint8_t* ) ctx, buffer, params.nvmCtxSize );
+        }
+        buffer += params.nvmCtxSize;
+    }
+
+    for( uint8_t i = 0; i < ( sizeof( InstanceNvmCtxModules ) / sizeof( InstanceNvmCtxModules[0] ) ); i++ )
+    {
+        const InstanceNvmCtxModule_t* module = &InstanceNvmCtxModules[i];
+        size_t size = 0;
+
+        ctx = module->GetNvmCtx( &size );
+        if( ctx == NULL )
+        {
+            continue;
+        }
+        if( save == true )
+        {
+            memcpy1( buffer, ( uint8_t* ) ctx, size );
+        }
+        else if( module->RestoreNvmCtx != NULL )
+        {
+            module->RestoreNvmCtx( buffer );
+        }
+        else
+        {
+            memcpy1( ( uint8_t* ) ctx, buffer, size );
+        }
+        buffer += size;
+    }
+}
+
+size_t LoRaMacInstanceGetSize( LoRaMacRegion_t region )
+{
+    size_t instanceSize = sizeof( struct sLoRaMacInstance );
+    GetNvmCtxParams_t params ={ 0 };
+
+    RegionGetNvmCtx( region, &params );
+    instanceSize += params.nvmCtxSize;
+    for( uint8_t i = 0; i < ( sizeof( InstanceNvmCtxModules ) / sizeof( InstanceNvmCtxModules[0] ) ); i++ )
+    {
+        size_t size = 0;
+
+        InstanceNvmCtxModules[i].GetNvmCtx( &size );
+        instanceSize += size;
+    }
+
+    return instanceSize;
+}
+
+LoRaMacStatus_t LoRaMacInstanceSelect( LoRaMacHandle_t handle )
+{
+    if( handle == ActiveInstance )
+    {
+        return LORAMAC_STATUS_OK;
+    }
+
+    if( ( ActiveInstance == NULL ) && ( MacCtx.MacPrimitives != NULL ) )
+    {
+        // The initialized built-in stack state has no storage to be saved to
+        return LORAMAC_STATUS_SERVICE_UNKNOWN;
+    }
+
+    if( IsStackIdle( ) == false )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    if( ActiveInstance != NULL )
+    {
+        // Save the active stack state
+        ActiveInstance->Region = MacCtx.NvmCtx->Region;
+        memcpy1( ( uint8_t* ) &ActiveInstance->MacCtx, ( uint8_t* ) &MacCtx, sizeof( LoRaMacCtx_t ) );
+        memcpy1( ( uint8_t* ) &ActiveInstance->NvmMacCtx, ( uint8_t* ) &NvmMacCtx, sizeof( LoRaMacNvmCtx_t ) );
+        InstanceCopyNvmCtxs( ActiveInstance->NvmCtxs, ActiveInstance->Region, true );
+        ActiveInstance->IsSaved = true;
+    }
+
+    if( ( handle != NULL ) && ( handle->IsSaved == true ) )
+    {
+        // Load the new stack state
+        memcpy1( ( uint8_t* ) &MacCtx, ( uint8_t* ) &handle->MacCtx, sizeof( LoRaMacCtx_t ) );
+        memcpy1( ( uint8_t* ) &NvmMacCtx, ( uint8_t* ) &handle->NvmMacCtx, sizeof( LoRaMacNvmCtx_t ) );
+        // Re-assign the confirm queue primitives before restoring its context
+        LoRaMacConfirmQueueInit( MacCtx.MacPrimitives, EventConfirmQueueNvmCtxChanged );
+        InstanceCopyNvmCtxs( handle->NvmCtxs, handle->Region, false );
+        // The other regions contexts are shared with the other instances
+        MacCtx.RegionsInitialized = 1 << handle->Region;
+    }
+    else
+    {
+        // Fresh instance. LoRaMacInitialization must be called next.
+        memset1( ( uint8_t* ) &MacCtx, 0x00, sizeof( LoRaMacCtx_t ) );
+        memset1( ( uint8_t* ) &NvmMacCtx, 0x00, sizeof( LoRaMacNvmCtx_t ) );
+        MacCtx.NvmCtx = &NvmMacCtx;
+        SetMacState( LORAMAC_STOPPED );
+    }
+    // The key streams were computed with the keys of the previous instance
+    LoRaMacCryptoDropKeyStreams( );
+
+    ActiveInstance = handle;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacHandle_t LoRaMacInstanceGetActive( void )
+{
+    return ActiveInstance;
+}
+
+static bool IsStackIdle( void )
+{
+    if( MacCtx.MacPrimitives == NULL )
+    {
+        // The stack is not initialized, the sub modules have no context yet
+        return true;
+    }
+    // The stack state can only be swapped while no operation is ongoing
+    if( ( ( MacCtx.MacState & ~LORAMAC_STOPPED ) != 0 ) ||
+        ( MacCtx.MacFlags.Value != 0 ) ||
+        ( LoRaMacRadioEvents.Value != 0 ) ||
+        ( LoRaMacConfirmQueueGetCnt( ) != 0 ) ||
+        ( LoRaMacTxQueueGetCnt( ) != 0 ) ||
+        ( TimerIsStarted( &MacCtx.ClassCAckTimer ) == true ) ||
+        ( MacCtx.ClassCAckUplinkRequested == true ) ||
+        ( LoRaMacClassBIsAcquisitionInProgress( ) == true ) ||
+        ( LoRaMacClassBIsBeaconModeActive( ) == true ) )
+    {
+        return false;
+    }
+    return true;
+}
+
+LoRaMacStatus_t LoRaMacSwitchRegion( LoRaMacRegion_t region )
+{
+    InitDefaultsParams_t params;
+
+    if( RegionIsActive( region ) == false )
+    {
+        return LORAMAC_STATUS_REGION_NOT_SUPPORTED;
     }
-
-    // Initialize MAC commands module
-    if( LoRaMacCommandsInit( EventCommandsNvmCtxChanged ) != LORAMAC_COMMANDS_SUCCESS )
+    if( region == MacCtx.NvmCtx->Region )
     {
-        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
+        return LORAMAC_STATUS_OK;
     }
-
-    // Set multicast downlink counter reference
-    if( LoRaMacCryptoSetMulticastReference( MacCtx.NvmCtx->MulticastChannelList ) != LORAMAC_CRYPTO_SUCCESS )
+    if( ( IsStackIdle( ) == false ) || ( MacCtx.NvmCtx->DeviceClass != CLASS_A ) )
     {
-        return LORAMAC_STATUS_CRYPTO_ERROR;
+        return LORAMAC_STATUS_BUSY;
     }
 
-    // Random seed initialization
-    srand1( Radio.Random( ) );
-
-    Radio.SetPublicNetwork( MacCtx.NvmCtx->PublicNetwork );
-    Radio.Sleep( );
+    MacCtx.NvmCtx->Region = region;
 
-    // Initialize class b
-    // Apply callback
-    classBCallbacks.GetTemperatureLevel = NULL;
-    classBCallbacks.MacProcessNotify = NULL;
-    if( callbacks != NULL )
+    // The region contexts are kept in RAM. The channel plan and the band
+    // time-offs of an already visited region are reused as they are.
+    if( ( MacCtx.RegionsInitialized & ( 1 << region ) ) == 0 )
     {
-        classBCallbacks.GetTemperatureLevel = callbacks->GetTemperatureLevel;
-        classBCallbacks.MacProcessNotify = callbacks->MacProcessNotify;
+        params.Type = INIT_TYPE_INIT;
+        params.NvmCtx = NULL;
+        RegionInitDefaults( region, &params );
+        MacCtx.RegionsInitialized |= 1 << region;
     }
 
-    // Must all be static. Don't use local references.
-    classBParams.MlmeIndication = &MacCtx.MlmeIndication;
-    classBParams.McpsIndication = &MacCtx.McpsIndication;
-    classBParams.MlmeConfirm = &MacCtx.MlmeConfirm;
-    classBParams.LoRaMacFlags = &MacCtx.MacFlags;
-    classBParams.LoRaMacDevAddr = &MacCtx.NvmCtx->DevAddr;
-    classBParams.LoRaMacRegion = &MacCtx.NvmCtx->Region;
-    classBParams.LoRaMacParams = &MacCtx.NvmCtx->MacParams;
-    classBParams.MulticastChannels = &MacCtx.NvmCtx->MulticastChannelList[0];
+    // The session, the receive delays and the aggregated duty-cycle are kept.
+    // The radio parameters restart from the region defaults.
+    InitMacParamsDefaults( );
+    ResetRegionMacParameters( );
+    PhyParamsCacheInit( );
 
-    LoRaMacClassBInit( &classBParams, &classBCallbacks, &EventClassBNvmCtxChanged );
+    MacCtx.NvmCtx->AdrAckCounter = 0;
+    if( MacCtx.AdrStrategy->Reset != NULL )
+    {
+        MacCtx.AdrStrategy->Reset( );
+    }
+    // The channels differ from a region to the other
+    if( MacCtx.RetryPolicy->Reset != NULL )
+    {
+        MacCtx.RetryPolicy->Reset( );
+    }
+#ifdef LORAMAC_CHANNEL_QUALITY_ENABLED
+    memset1( ( uint8_t* )MacCtx.ChannelQuality, 0, sizeof( MacCtx.ChannelQuality ) );
+#endif
+    MacCtx.TxInfoCache.IsValid = false;
 
-    LoRaMacEnableRequests( LORAMAC_REQUEST_HANDLING_ON );
+    LoRaMacClassBSwitchRegion( );
 
+    EventMacNvmCtxChanged( );
+    EventRegionNvmCtxChanged( );
     return LORAMAC_STATUS_OK;
 }
 
-LoRaMacStatus_t LoRaMacStart( void )
+static bool IsAdrNextEqual( CalcNextAdrParams_t* a, CalcNextAdrParams_t* b )
 {
-    MacCtx.MacState = LORAMAC_IDLE;
-    return LORAMAC_STATUS_OK;
+    return ( a->Version.Value == b->Version.Value ) &&
+           ( a->UpdateChanMask == b->UpdateChanMask ) &&
+           ( a->AdrEnabled == b->AdrEnabled ) &&
+           ( a->AdrAckCounter == b->AdrAckCounter ) &&
+           ( a->AdrAckLimit == b->AdrAckLimit ) &&
+           ( a->AdrAckDelay == b->AdrAckDelay ) &&
+           ( a->Datarate == b->Datarate ) &&
+           ( a->TxPower == b->TxPower ) &&
+           ( a->UplinkDwellTime == b->UplinkDwellTime ) &&
+           ( a->Region == b->Region );
 }
 
-LoRaMacStatus_t LoRaMacStop( void )
+static TimerTime_t GetNextTxDelay( int8_t datarate )
 {
-    if( LoRaMacIsBusy( ) == false )
+    NextChanParams_t nextChan;
+    TimerTime_t aggregatedTimeOff = MacCtx.NvmCtx->AggregatedTimeOff;
+    TimerTime_t nextTxDelay = 0;
+    uint8_t channel = 0;
+    TimerTime_t now = TimerGetCurrentTime( );
+
+    // Same back-off update as the one done when scheduling the next frame.
+    if( MacCtx.LbtCadTrials == 0 )
     {
-        MacCtx.MacState = LORAMAC_STOPPED;
-        return LORAMAC_STATUS_OK;
+        CalculateBackOff( MacCtx.NvmCtx->LastTxChannel, now );
     }
-    else if(  MacCtx.MacState == LORAMAC_STOPPED )
+    GetNextChanParams( datarate, now, &nextChan );
+
+    // The channel and the aggregated time-off are not applied
+    if( RegionNextChannel( MacCtx.NvmCtx->Region, &nextChan, &channel, &nextTxDelay, &aggregatedTimeOff ) != LORAMAC_STATUS_DUTYCYCLE_RESTRICTED )
     {
-        return LORAMAC_STATUS_OK;
+        return 0;
     }
-    return LORAMAC_STATUS_BUSY;
+    return nextTxDelay;
 }
 
 LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
@@ -3366,16 +6278,32 @@ LoRaMacStatus_t LoRaMacQueryTxPossible( uint8_t size, LoRaMacTxInfo_t* txInfo )
     adrNext.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
     adrNext.Region = MacCtx.NvmCtx->Region;
 
-    // We call the function for information purposes only. We don't want to
-    // apply the datarate, the tx power and the ADR ack counter.
-    LoRaMacAdrCalcNext( &adrNext, &datarate, &txPower, &adrAckCounter );
+    if( ( MacCtx.TxInfoCache.IsValid == true ) && ( IsAdrNextEqual( &MacCtx.TxInfoCache.AdrNext, &adrNext ) == true ) )
+    {
+        datarate = MacCtx.TxInfoCache.Datarate;
+    }
+    else
+    {
+        MacCtx.TxInfoCache.AdrNext = adrNext;
+
+        // We call the function for information purposes only. We don't want to
+        // apply the datarate, the tx power and the ADR ack counter.
+        MacCtx.AdrStrategy->CalcNext( &adrNext, &datarate, &txPower, &adrAckCounter );
+
+        MacCtx.TxInfoCache.Datarate = datarate;
+        MacCtx.TxInfoCache.IsValid = true;
+    }
 
     txInfo->CurrentPossiblePayloadSize = GetMaxAppPayloadWithoutFOptsLength( datarate );
+    txInfo->NextTxDelay = GetNextTxDelay( datarate );
 
-    if( LoRaMacCommandsGetSizeSerializedCmds( &macCmdsSize ) != LORAMAC_COMMANDS_SUCCESS )
-    {
-        return LORAMAC_STATUS_MAC_COMMAD_ERROR;
-    }
+    // The requests of the end-device may be deferred
+    macCmdsSize = GetRequiredMacCmdsSize( );
+
+    // Airtime of the frame and the datarate it would fit into. The maximum
+    // payloads of the regions already account for the uplink dwell time.
+    txInfo->TimeOnAir = RegionGetTimeOnAir( MacCtx.NvmCtx->Region, datarate, size + macCmdsSize + LORA_MAC_FRMPAYLOAD_OVERHEAD );
+    txInfo->FitDatarate = GetFitDatarate( datarate, size + macCmdsSize );
 
     // Verify if the MAC commands fit into the FOpts and into the maximum payload.
     if( ( LORA_MAC_COMMAND_MAX_FOPTS_LENGTH >= macCmdsSize ) && ( txInfo->CurrentPossiblePayloadSize >= macCmdsSize ) )
@@ -3576,6 +6504,106 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
             mibGet->Param.DefaultAntennaGain = MacCtx.NvmCtx->MacParamsDefaults.AntennaGain;
             break;
         }
+        case MIB_FCNT_UP_LOOKAHEAD:
+        {
+            mibGet->Param.FCntUpLookahead = LoRaMacCryptoGetFCntUpLookahead( );
+            break;
+        }
+        case MIB_RX_TIMING_STATS:
+        {
+#ifdef LORAMAC_RX_TIMING_STATS_ENABLED
+            mibGet->Param.RxTimingStats = MacCtx.RxTimingStats;
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            break;
+        }
+        case MIB_UPLINK_COST:
+        {
+            mibGet->Param.UplinkCost = &MacCtx.UplinkCostTotal;
+            break;
+        }
+        case MIB_LBT_CAD:
+        {
+            mibGet->Param.LbtCadEnable = MacCtx.LbtCadOn;
+            break;
+        }
+        case MIB_RXC_DUTY_CYCLE:
+        {
+            mibGet->Param.RxCDutyCyclePreambleLen = MacCtx.RxCDutyCyclePreambleLen;
+            break;
+        }
+        case MIB_ADR_STRATEGY:
+        {
+            mibGet->Param.AdrStrategy = MacCtx.AdrStrategy;
+            break;
+        }
+        case MIB_RETRY_POLICY:
+        {
+            mibGet->Param.RetryPolicy = MacCtx.RetryPolicy;
+            break;
+        }
+        case MIB_FPENDING_MAX_UPLINKS:
+        {
+            mibGet->Param.FPendingMaxUplinks = MacCtx.FPendingMaxUplinks;
+            break;
+        }
+        case MIB_CHANNEL_QUALITY:
+        {
+#ifdef LORAMAC_CHANNEL_QUALITY_ENABLED
+            mibGet->Param.ChannelQuality = MacCtx.ChannelQuality;
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            break;
+        }
+        case MIB_CLASS_C_ACK_DELAY:
+        {
+            mibGet->Param.ClassCAckDelay = MacCtx.ClassCAckDelay;
+            break;
+        }
+        case MIB_BATTERY_LEVEL:
+        {
+            mibGet->Param.BatteryLevel = MacCtx.BatteryLevel;
+            break;
+        }
+        case MIB_RX_DROP_STATS:
+        {
+            mibGet->Param.RxDropStats = &MacCtx.RxDropStats;
+            break;
+        }
+        case MIB_TX_HOP_PERIOD:
+        {
+            mibGet->Param.TxHopPeriod = MacCtx.TxHopPeriod;
+            break;
+        }
+        case MIB_IRQ_LATENCY_STATS:
+        {
+#ifdef LORAMAC_IRQ_LATENCY_STATS_ENABLED
+            mibGet->Param.IrqLatencyStats = MacCtx.IrqLatencyStats;
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            break;
+        }
+        case MIB_CLASS_C_RX_QUEUE_DEPTH:
+        {
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+            mibGet->Param.ClassCRxQueueDepth = MacCtx.RxCQueueDepth;
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            break;
+        }
+        case MIB_CLASS_C_RADIO:
+        {
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+            mibGet->Param.ClassCRadio = MacCtx.RxCRadio;
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            break;
+        }
         default:
         {
             status = LoRaMacClassBMibGetRequestConfirm( mibGet );
@@ -3585,20 +6613,29 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet )
     return status;
 }
 
-LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
+LoRaMacStatus_t LoRaMacMibGetRequestConfirmList( MibRequestConfirm_t* mibGet, uint8_t nbMib )
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_OK;
-    ChanMaskSetParams_t chanMaskSet;
-    VerifyParams_t verify;
 
-    if( mibSet == NULL )
+    if( mibGet == NULL )
     {
         return LORAMAC_STATUS_PARAMETER_INVALID;
     }
-    if( ( MacCtx.MacState & LORAMAC_TX_RUNNING ) == LORAMAC_TX_RUNNING )
+
+    for( uint8_t i = 0; ( i < nbMib ) && ( status == LORAMAC_STATUS_OK ); i++ )
     {
-        return LORAMAC_STATUS_BUSY;
+        status = LoRaMacMibGetRequestConfirm( &mibGet[i] );
     }
+    return status;
+}
+
+static LoRaMacStatus_t SetMibAttribute( MibRequestConfirm_t* mibSet, bool* nvmCtxChanged )
+{
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    ChanMaskSetParams_t chanMaskSet;
+    VerifyParams_t verify;
+
+    *nvmCtxChanged = true;
 
     switch( mibSet->Type )
     {
@@ -3611,6 +6648,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
         {
             if( mibSet->Param.NetworkActivation != ACTIVATION_TYPE_OTAA  )
             {
+                *nvmCtxChanged = ( MacCtx.NvmCtx->NetworkActivation != mibSet->Param.NetworkActivation );
                 MacCtx.NvmCtx->NetworkActivation = mibSet->Param.NetworkActivation;
             }
             else
@@ -3637,6 +6675,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
         }
         case MIB_ADR:
         {
+            *nvmCtxChanged = ( MacCtx.NvmCtx->AdrCtrlOn != mibSet->Param.AdrEnable );
             MacCtx.NvmCtx->AdrCtrlOn = mibSet->Param.AdrEnable;
             break;
         }
@@ -3647,6 +6686,7 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
         }
         case MIB_DEV_ADDR:
         {
+            *nvmCtxChanged = ( MacCtx.NvmCtx->DevAddr != mibSet->Param.DevAddr );
             MacCtx.NvmCtx->DevAddr = mibSet->Param.DevAddr;
             break;
         }
@@ -3984,6 +7024,12 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
         {
             MacCtx.NvmCtx->PublicNetwork = mibSet->Param.EnablePublicNetwork;
             Radio.SetPublicNetwork( MacCtx.NvmCtx->PublicNetwork );
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+            if( MacCtx.RxCRadio != NULL )
+            {
+                MacCtx.RxCRadio->SetPublicNetwork( MacCtx.NvmCtx->PublicNetwork );
+            }
+#endif
             break;
         }
         case MIB_REPEATER_SUPPORT:
@@ -4143,6 +7189,12 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
         }
         case MIB_CHANNELS_DATARATE:
         {
+            if( mibSet->Param.ChannelsDatarate == MacCtx.NvmCtx->MacParams.ChannelsDatarate )
+            {
+                // Already verified when it was set
+                *nvmCtxChanged = false;
+                break;
+            }
             verify.DatarateParams.Datarate = mibSet->Param.ChannelsDatarate;
             verify.DatarateParams.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
 
@@ -4170,67 +7222,249 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
             }
             break;
         }
-        case MIB_CHANNELS_TX_POWER:
+        case MIB_CHANNELS_TX_POWER:
+        {
+            if( mibSet->Param.ChannelsTxPower == MacCtx.NvmCtx->MacParams.ChannelsTxPower )
+            {
+                // Already verified when it was set
+                *nvmCtxChanged = false;
+                break;
+            }
+            verify.TxPower = mibSet->Param.ChannelsTxPower;
+
+            if( RegionVerify( MacCtx.NvmCtx->Region, &verify, PHY_TX_POWER ) == true )
+            {
+                MacCtx.NvmCtx->MacParams.ChannelsTxPower = verify.TxPower;
+            }
+            else
+            {
+                status = LORAMAC_STATUS_PARAMETER_INVALID;
+            }
+            break;
+        }
+        case MIB_SYSTEM_MAX_RX_ERROR:
+        {
+            MacCtx.NvmCtx->MacParams.SystemMaxRxError = MacCtx.NvmCtx->MacParamsDefaults.SystemMaxRxError = mibSet->Param.SystemMaxRxError;
+            break;
+        }
+        case MIB_MIN_RX_SYMBOLS:
+        {
+            MacCtx.NvmCtx->MacParams.MinRxSymbols = MacCtx.NvmCtx->MacParamsDefaults.MinRxSymbols = mibSet->Param.MinRxSymbols;
+            break;
+        }
+        case MIB_ANTENNA_GAIN:
+        {
+            MacCtx.NvmCtx->MacParams.AntennaGain = mibSet->Param.AntennaGain;
+            break;
+        }
+        case MIB_DEFAULT_ANTENNA_GAIN:
+        {
+            MacCtx.NvmCtx->MacParamsDefaults.AntennaGain = mibSet->Param.DefaultAntennaGain;
+            break;
+        }
+        case MIB_NVM_CTXS:
+        {
+            if( mibSet->Param.Contexts != 0 )
+            {
+                status = RestoreCtxs( mibSet->Param.Contexts );
+            }
+            else
+            {
+                status = LORAMAC_STATUS_PARAMETER_INVALID;
+            }
+            break;
+        }
+        case MIB_ABP_LORAWAN_VERSION:
+        {
+            if( mibSet->Param.AbpLrWanVersion.Fields.Minor <= 1 )
+            {
+                MacCtx.NvmCtx->Version = mibSet->Param.AbpLrWanVersion;
+
+                if( LORAMAC_CRYPTO_SUCCESS != LoRaMacCryptoSetLrWanVersion( mibSet->Param.AbpLrWanVersion ) )
+                {
+                    return LORAMAC_STATUS_CRYPTO_ERROR;
+                }
+            }
+            else
+            {
+                status = LORAMAC_STATUS_PARAMETER_INVALID;
+            }
+            break;
+        }
+        case MIB_FCNT_UP_LOOKAHEAD:
+        {
+            if( LORAMAC_CRYPTO_SUCCESS != LoRaMacCryptoSetFCntUpLookahead( mibSet->Param.FCntUpLookahead ) )
+            {
+                return LORAMAC_STATUS_CRYPTO_ERROR;
+            }
+            break;
+        }
+        case MIB_RX_TIMING_STATS:
+        {
+#ifdef LORAMAC_RX_TIMING_STATS_ENABLED
+            memset1( ( uint8_t* )MacCtx.RxTimingStats, 0, sizeof( MacCtx.RxTimingStats ) );
+            memset1( ( uint8_t* )MacCtx.RxTimingSums, 0, sizeof( MacCtx.RxTimingSums ) );
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            break;
+        }
+        case MIB_UPLINK_COST:
+        {
+            memset1( ( uint8_t* )&MacCtx.UplinkCostTotal, 0, sizeof( MacCtx.UplinkCostTotal ) );
+            break;
+        }
+        case MIB_LBT_CAD:
+        {
+            MacCtx.LbtCadOn = mibSet->Param.LbtCadEnable;
+            break;
+        }
+        case MIB_RXC_DUTY_CYCLE:
+        {
+            MacCtx.RxCDutyCyclePreambleLen = mibSet->Param.RxCDutyCyclePreambleLen;
+            if( MacCtx.RxSlot == RX_SLOT_WIN_CLASS_C )
+            {
+                // Restart the class C reception with the new mode
+                Radio.Sleep( );
+                OpenContinuousRxCWindow( );
+            }
+            break;
+        }
+        case MIB_ADR_STRATEGY:
+        {
+            if( ( mibSet->Param.AdrStrategy != NULL ) && ( mibSet->Param.AdrStrategy->CalcNext != NULL ) )
+            {
+                MacCtx.AdrStrategy = mibSet->Param.AdrStrategy;
+                MacCtx.TxInfoCache.IsValid = false;
+                if( MacCtx.AdrStrategy->Reset != NULL )
+                {
+                    MacCtx.AdrStrategy->Reset( );
+                }
+            }
+            else
+            {
+                status = LORAMAC_STATUS_PARAMETER_INVALID;
+            }
+            break;
+        }
+        case MIB_RETRY_POLICY:
+        {
+            if( ( mibSet->Param.RetryPolicy != NULL ) && ( mibSet->Param.RetryPolicy->GetAckTimeout != NULL ) &&
+                ( mibSet->Param.RetryPolicy->GetRetryDatarate != NULL ) )
+            {
+                MacCtx.RetryPolicy = mibSet->Param.RetryPolicy;
+                if( MacCtx.RetryPolicy->Reset != NULL )
+                {
+                    MacCtx.RetryPolicy->Reset( );
+                }
+            }
+            else
+            {
+                status = LORAMAC_STATUS_PARAMETER_INVALID;
+            }
+            break;
+        }
+        case MIB_FPENDING_MAX_UPLINKS:
+        {
+            MacCtx.FPendingMaxUplinks = mibSet->Param.FPendingMaxUplinks;
+            break;
+        }
+        case MIB_CHANNEL_QUALITY:
+        {
+#ifdef LORAMAC_CHANNEL_QUALITY_ENABLED
+            memset1( ( uint8_t* )MacCtx.ChannelQuality, 0, sizeof( MacCtx.ChannelQuality ) );
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            *nvmCtxChanged = false;
+            break;
+        }
+        case MIB_CLASS_C_ACK_DELAY:
         {
-            verify.TxPower = mibSet->Param.ChannelsTxPower;
-
-            if( RegionVerify( MacCtx.NvmCtx->Region, &verify, PHY_TX_POWER ) == true )
-            {
-                MacCtx.NvmCtx->MacParams.ChannelsTxPower = verify.TxPower;
-            }
-            else
+            MacCtx.ClassCAckDelay = mibSet->Param.ClassCAckDelay;
+            if( MacCtx.ClassCAckDelay == 0 )
             {
-                status = LORAMAC_STATUS_PARAMETER_INVALID;
+                TimerStop( &MacCtx.ClassCAckTimer );
+                MacCtx.ClassCAckUplinkRequested = false;
             }
+            *nvmCtxChanged = false;
             break;
         }
-        case MIB_SYSTEM_MAX_RX_ERROR:
+        case MIB_BATTERY_LEVEL:
         {
-            MacCtx.NvmCtx->MacParams.SystemMaxRxError = MacCtx.NvmCtx->MacParamsDefaults.SystemMaxRxError = mibSet->Param.SystemMaxRxError;
+            MacCtx.BatteryLevel = mibSet->Param.BatteryLevel;
+            MacCtx.BatteryLevelSet = true;
+            *nvmCtxChanged = false;
             break;
         }
-        case MIB_MIN_RX_SYMBOLS:
+        case MIB_RX_DROP_STATS:
         {
-            MacCtx.NvmCtx->MacParams.MinRxSymbols = MacCtx.NvmCtx->MacParamsDefaults.MinRxSymbols = mibSet->Param.MinRxSymbols;
+            memset1( ( uint8_t* )&MacCtx.RxDropStats, 0, sizeof( MacCtx.RxDropStats ) );
+            *nvmCtxChanged = false;
             break;
         }
-        case MIB_ANTENNA_GAIN:
+        case MIB_TX_HOP_PERIOD:
         {
-            MacCtx.NvmCtx->MacParams.AntennaGain = mibSet->Param.AntennaGain;
+            MacCtx.TxHopPeriod = mibSet->Param.TxHopPeriod;
+            *nvmCtxChanged = false;
             break;
         }
-        case MIB_DEFAULT_ANTENNA_GAIN:
+        case MIB_IRQ_LATENCY_STATS:
         {
-            MacCtx.NvmCtx->MacParamsDefaults.AntennaGain = mibSet->Param.DefaultAntennaGain;
+#ifdef LORAMAC_IRQ_LATENCY_STATS_ENABLED
+            memset1( ( uint8_t* )MacCtx.IrqLatencyStats, 0, sizeof( MacCtx.IrqLatencyStats ) );
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            *nvmCtxChanged = false;
             break;
         }
-        case MIB_NVM_CTXS:
+        case MIB_CLASS_C_RX_QUEUE_DEPTH:
         {
-            if( mibSet->Param.Contexts != 0 )
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+            if( mibSet->Param.ClassCRxQueueDepth <= LORAMAC_CLASS_C_RX_QUEUE_SIZE )
             {
-                status = RestoreCtxs( mibSet->Param.Contexts );
+                // The queued frames are processed whatever the new depth
+                MacCtx.RxCQueueDepth = mibSet->Param.ClassCRxQueueDepth;
             }
             else
             {
                 status = LORAMAC_STATUS_PARAMETER_INVALID;
             }
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            *nvmCtxChanged = false;
             break;
         }
-        case MIB_ABP_LORAWAN_VERSION:
+        case MIB_CLASS_C_RADIO:
         {
-            if( mibSet->Param.AbpLrWanVersion.Fields.Minor <= 1 )
+#ifdef LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+            if( MacCtx.RxCRadio != NULL )
             {
-                MacCtx.NvmCtx->Version = mibSet->Param.AbpLrWanVersion;
-
-                if( LORAMAC_CRYPTO_SUCCESS != LoRaMacCryptoSetLrWanVersion( mibSet->Param.AbpLrWanVersion ) )
-                {
-                    return LORAMAC_STATUS_CRYPTO_ERROR;
-                }
+                MacCtx.RxCRadio->Sleep( );
             }
-            else
+            MacCtx.RxCRadio = mibSet->Param.ClassCRadio;
+            MacCtx.RxCWindowArmed = false;
+            if( MacCtx.RxCRadio != NULL )
             {
-                status = LORAMAC_STATUS_PARAMETER_INVALID;
+                MacCtx.RxCRadioEvents.RxDoneTimestamped = OnRxCRadioRxDone;
+                MacCtx.RxCRadioEvents.RxError = OnRxCRadioRxError;
+                MacCtx.RxCRadioEvents.RxTimeout = OnRxCRadioRxError;
+                MacCtx.RxCRadio->Init( &MacCtx.RxCRadioEvents );
+                MacCtx.RxCRadio->SetPublicNetwork( MacCtx.NvmCtx->PublicNetwork );
+                MacCtx.RxCRadio->Sleep( );
+            }
+            if( MacCtx.RxSlot == RX_SLOT_WIN_CLASS_C )
+            {
+                // Restart the class C reception on the new radio
+                Radio.Sleep( );
+                OpenContinuousRxCWindow( );
             }
+#else
+            status = LORAMAC_STATUS_SERVICE_UNKNOWN;
+#endif
+            *nvmCtxChanged = false;
             break;
         }
         default:
@@ -4239,8 +7473,44 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
             break;
         }
     }
-    EventRegionNvmCtxChanged( );
-    EventMacNvmCtxChanged( );
+    return status;
+}
+
+LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet )
+{
+    return LoRaMacMibSetRequestConfirmList( mibSet, 1 );
+}
+
+LoRaMacStatus_t LoRaMacMibSetRequestConfirmList( MibRequestConfirm_t* mibSet, uint8_t nbMib )
+{
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+    bool nvmCtxChanged = false;
+    bool anyNvmCtxChanged = false;
+
+    if( mibSet == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if( ( MacCtx.MacState & LORAMAC_TX_RUNNING ) == LORAMAC_TX_RUNNING )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    for( uint8_t i = 0; ( i < nbMib ) && ( status == LORAMAC_STATUS_OK ); i++ )
+    {
+        status = SetMibAttribute( &mibSet[i], &nvmCtxChanged );
+        if( ( status == LORAMAC_STATUS_OK ) && ( nvmCtxChanged == true ) )
+        {
+            anyNvmCtxChanged = true;
+        }
+    }
+
+    // Notify the context changes once for the whole list
+    if( anyNvmCtxChanged == true )
+    {
+        EventRegionNvmCtxChanged( );
+        EventMacNvmCtxChanged( );
+    }
     return status;
 }
 
@@ -4300,6 +7570,7 @@ LoRaMacStatus_t LoRaMacMcChannelSetup( McChannelParams_t *channel )
     }
 
     MacCtx.NvmCtx->MulticastChannelList[channel->GroupID].ChannelParams = *channel;
+    UpdateMcAddrMap( );
 
     const KeyIdentifier_t mcKeys[LORAMAC_MAX_MC_CTX] = { MC_KEY_0, MC_KEY_1, MC_KEY_2, MC_KEY_3 };
     if( LoRaMacCryptoSetKey( mcKeys[channel->GroupID], channel->McKeyE ) != LORAMAC_CRYPTO_SUCCESS )
@@ -4323,6 +7594,72 @@ LoRaMacStatus_t LoRaMacMcChannelSetup( McChannelParams_t *channel )
     return LORAMAC_STATUS_OK;
 }
 
+LoRaMacStatus_t LoRaMacMcChannelSetupBatch( McChannelParams_t *channels, uint8_t nbChannels, LoRaMacStatus_t *statuses )
+{
+    McChannelParams_t validChannels[LORAMAC_MAX_MC_CTX];
+    uint8_t nbValidChannels = 0;
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+
+    if( ( channels == NULL ) || ( statuses == NULL ) || ( nbChannels > LORAMAC_MAX_MC_CTX ) )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+
+    if( ( MacCtx.MacState & LORAMAC_TX_RUNNING ) == LORAMAC_TX_RUNNING )
+    {
+        for( uint8_t i = 0; i < nbChannels; i++ )
+        {
+            statuses[i] = LORAMAC_STATUS_BUSY;
+        }
+        return LORAMAC_STATUS_BUSY;
+    }
+
+    for( uint8_t i = 0; i < nbChannels; i++ )
+    {
+        if( channels[i].GroupID >= LORAMAC_MAX_MC_CTX )
+        {
+            statuses[i] = LORAMAC_STATUS_MC_GROUP_UNDEFINED;
+            status = LORAMAC_STATUS_MC_GROUP_UNDEFINED;
+            continue;
+        }
+        MacCtx.NvmCtx->MulticastChannelList[channels[i].GroupID].ChannelParams = channels[i];
+        validChannels[nbValidChannels++] = channels[i];
+        statuses[i] = LORAMAC_STATUS_OK;
+    }
+
+    if( nbValidChannels == 0 )
+    {
+        return status;
+    }
+    UpdateMcAddrMap( );
+
+    // All the McKeys and key pairs at once, the root keys are expanded once
+    if( LoRaMacCryptoSetMcKeys( validChannels, nbValidChannels ) != LORAMAC_CRYPTO_SUCCESS )
+    {
+        for( uint8_t i = 0; i < nbChannels; i++ )
+        {
+            if( statuses[i] == LORAMAC_STATUS_OK )
+            {
+                statuses[i] = LORAMAC_STATUS_CRYPTO_ERROR;
+            }
+        }
+        return LORAMAC_STATUS_CRYPTO_ERROR;
+    }
+
+    for( uint8_t i = 0; i < nbValidChannels; i++ )
+    {
+        if( validChannels[i].Class == CLASS_B )
+        {
+            // Calculate class b parameters
+            LoRaMacClassBSetMulticastPeriodicity( &MacCtx.NvmCtx->MulticastChannelList[validChannels[i].GroupID] );
+        }
+    }
+
+    EventMacNvmCtxChanged( );
+    EventRegionNvmCtxChanged( );
+    return status;
+}
+
 LoRaMacStatus_t LoRaMacMcChannelDelete( AddressIdentifier_t groupID )
 {
     if( ( MacCtx.MacState & LORAMAC_TX_RUNNING ) == LORAMAC_TX_RUNNING )
@@ -4342,6 +7679,7 @@ LoRaMacStatus_t LoRaMacMcChannelDelete( AddressIdentifier_t groupID )
     memset1( ( uint8_t* )&channel, 0, sizeof( McChannelParams_t ) );
 
     MacCtx.NvmCtx->MulticastChannelList[groupID].ChannelParams = channel;
+    UpdateMcAddrMap( );
 
     EventMacNvmCtxChanged( );
     EventRegionNvmCtxChanged( );
@@ -4424,6 +7762,26 @@ LoRaMacStatus_t LoRaMacMcChannelSetupRxParams( AddressIdentifier_t groupID, McRx
     return LORAMAC_STATUS_OK;
 }
 
+/*!
+ * \brief Verifies if a MLME request is sent as a MAC command of the next uplink
+ *
+ * \param [IN] request MLME request type
+ * \retval isPiggyBacked Returns true if the request is piggy-backed
+ */
+static bool IsMlmePiggyBacked( Mlme_t request )
+{
+    switch( request )
+    {
+        case MLME_LINK_CHECK:
+        case MLME_DEVICE_TIME:
+        case MLME_PING_SLOT_INFO:
+        case MLME_BEACON_TIMING:
+            return true;
+        default:
+            return false;
+    }
+}
+
 LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest )
 {
     LoRaMacStatus_t status = LORAMAC_STATUS_SERVICE_UNKNOWN;
@@ -4438,6 +7796,16 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest )
     {
         return LORAMAC_STATUS_BUSY;
     }
+    if( LoRaMacConfirmQueueIsCmdActive( mlmeRequest->Type ) == true )
+    {
+        // The pending request answers the same question with the next uplink.
+        // The ping slot periodicity can't change while it is pending.
+        if( ( IsMlmePiggyBacked( mlmeRequest->Type ) == true ) && ( mlmeRequest->Type != MLME_PING_SLOT_INFO ) )
+        {
+            return LORAMAC_STATUS_OK;
+        }
+        return LORAMAC_STATUS_BUSY;
+    }
     if( LoRaMacConfirmQueueIsFull( ) == true )
     {
         return LORAMAC_STATUS_BUSY;
@@ -4566,19 +7934,201 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest )
             MacCtx.NodeAckRequested = false;
             MacCtx.MacFlags.Bits.MlmeReq = 0;
         }
+        PacketPoolFree( ReleasePktBuffer( ) );
     }
     else
     {
         LoRaMacConfirmQueueAdd( &queueElement );
+        ProfileRequestStart( LORAMAC_PROFILE_REQUEST_MLME );
         EventMacNvmCtxChanged( );
     }
     return status;
 }
 
+LoRaMacStatus_t LoRaMacMlmeRequests( MlmeReq_t* mlmeRequests, uint8_t nbRequests )
+{
+    LoRaMacStatus_t status = LORAMAC_STATUS_OK;
+
+    if( mlmeRequests == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    for( uint8_t i = 0; i < nbRequests; i++ )
+    {
+        if( IsMlmePiggyBacked( mlmeRequests[i].Type ) == false )
+        {
+            return LORAMAC_STATUS_PARAMETER_INVALID;
+        }
+    }
+    for( uint8_t i = 0; ( i < nbRequests ) && ( status == LORAMAC_STATUS_OK ); i++ )
+    {
+        status = LoRaMacMlmeRequest( &mlmeRequests[i] );
+    }
+    return status;
+}
+
 LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
+    LoRaMacStatus_t status;
+
+    if( mcpsRequest == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if( ( LoRaMacIsBusy( ) == true ) || ( LoRaMacTxQueueGetCnt( ) != 0 ) )
+    {
+        // Queue the request behind the pending ones. Reports busy if the
+        // queue is full or disabled.
+        status = LoRaMacTxQueueAdd( mcpsRequest );
+        if( status == LORAMAC_STATUS_OK )
+        {
+            LoRaMacHandleTxQueue( );
+        }
+        return status;
+    }
+    return McpsRequest( mcpsRequest, false, false );
+}
+
+LoRaMacStatus_t LoRaMacMcpsRequestInPlace( McpsReq_t* mcpsRequest )
+{
+    if( mcpsRequest == NULL )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
+    if( ( LoRaMacIsBusy( ) == true ) || ( LoRaMacTxQueueGetCnt( ) != 0 ) )
+    {
+        // The queue keeps a copy of the payload
+        return LoRaMacMcpsRequest( mcpsRequest );
+    }
+    // The payload size is bounded by the application buffer. The
+    // confirmed request parameters start with the unconfirmed ones.
+    if( ( mcpsRequest->Type == MCPS_PROPRIETARY ) ? ( mcpsRequest->Req.Proprietary.fBufferSize > LORAMAC_FRAME_PAYLOAD_MAX_SIZE ) :
+                                                    ( mcpsRequest->Req.Unconfirmed.fBufferSize > LORAMAC_FRAME_PAYLOAD_MAX_SIZE ) )
+    {
+        return LORAMAC_STATUS_LENGTH_ERROR;
+    }
+    return McpsRequest( mcpsRequest, false, true );
+}
+
+static void LoRaMacHandleTxQueue( void )
+{
+#ifdef LORAMAC_TX_QUEUE_ENABLED
+    McpsReq_t mcpsReq;
+    LoRaMacMcpsReqBuffer_t* buffer;
+    int8_t datarate;
+    size_t macCmdsSize = 0;
+    uint8_t maxSize;
+    LoRaMacStatus_t status;
+
+    while( ( LoRaMacIsBusy( ) == false ) && ( LoRaMacTxQueuePeek( &mcpsReq ) == true ) )
+    {
+#ifdef PACKET_POOL_ENABLED
+        // The uplink stays queued until a block is released
+        buffer = ( LoRaMacMcpsReqBuffer_t* )PacketPoolAlloc( );
+        if( buffer == NULL )
+        {
+            break;
+        }
+#else
+        buffer = &MacCtx.TxQueueBuffer;
+#endif
+
+        // Datarate the frame will be sent with
+        datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
+        if( MacCtx.NvmCtx->AdrCtrlOn == false )
+        {
+            datarate = ( mcpsReq.Type == MCPS_PROPRIETARY ) ? mcpsReq.Req.Proprietary.Datarate : mcpsReq.Req.Unconfirmed.Datarate;
+            datarate = MAX( datarate, MacCtx.PhyParams.MinTxDr[MacCtx.NvmCtx->MacParams.UplinkDwellTime != 0] );
+        }
+
+        // Leave room for the MAC commands sent in the FOpts field
+        maxSize = GetMaxAppPayloadWithoutFOptsLength( datarate );
+        macCmdsSize = GetRequiredMacCmdsSize( );
+        if( macCmdsSize <= LORA_MAC_COMMAND_MAX_FOPTS_LENGTH )
+        {
+            maxSize = ( macCmdsSize < maxSize ) ? ( maxSize - macCmdsSize ) : 0;
+        }
+
+        // The frame is built around the popped payload
+        LoRaMacTxQueuePop( &mcpsReq, buffer->Payload, MIN( maxSize, LORAMAC_FRAME_PAYLOAD_MAX_SIZE ) );
+
+        // A payload skipped for the MAC commands is confirmed with their frame
+        status = McpsRequest( &mcpsReq, true, true );
+        if( ( status != LORAMAC_STATUS_OK ) && ( status != LORAMAC_STATUS_SKIPPED_APP_DATA ) )
+        {
+            // The request was already accepted. Report the failure through
+            // the confirm.
+            MacCtx.McpsConfirm.McpsRequest = mcpsReq.Type;
+            MacCtx.McpsConfirm.Status = LORAMAC_EVENT_INFO_STATUS_ERROR;
+            MacCtx.MacPrimitives->MacMcpsConfirm( &MacCtx.McpsConfirm );
+        }
+        // The MAC holds its own reference until the MCPS-Confirm
+        PacketPoolFree( buffer );
+    }
+#endif // LORAMAC_TX_QUEUE_ENABLED
+}
+
+static void LoRaMacHandleFPendingUplink( void )
+{
+    McpsReq_t mcpsReq;
+
+    if( ( MacCtx.FPendingUplinkRequested == false ) || ( LoRaMacIsBusy( ) == true ) || ( LoRaMacTxQueueGetCnt( ) != 0 ) )
+    {
+        return;
+    }
+    MacCtx.FPendingUplinkRequested = false;
+
+    if( ( MacCtx.NvmCtx->DeviceClass != CLASS_A ) || ( MacCtx.FPendingUplinkCnt >= MacCtx.FPendingMaxUplinks ) )
+    {
+        return;
+    }
+
+    // Empty frame, the pending MAC commands answers are sent along. The frame
+    // waits for the duty-cycle.
+    mcpsReq.Type = MCPS_UNCONFIRMED;
+    mcpsReq.Req.Unconfirmed.fPort = 0;
+    mcpsReq.Req.Unconfirmed.fBuffer = NULL;
+    mcpsReq.Req.Unconfirmed.fBufferSize = 0;
+    mcpsReq.Req.Unconfirmed.Datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
+
+    MacCtx.FPendingUplinkOngoing = true;
+    if( McpsRequest( &mcpsReq, true, false ) == LORAMAC_STATUS_OK )
+    {
+        MacCtx.FPendingUplinkCnt++;
+    }
+    MacCtx.FPendingUplinkOngoing = false;
+}
+
+static void LoRaMacHandleClassCAckUplink( void )
+{
+    McpsReq_t mcpsReq;
+
+    // The queued uplinks carry the acknowledgement
+    if( ( MacCtx.ClassCAckUplinkRequested == false ) || ( LoRaMacIsBusy( ) == true ) || ( LoRaMacTxQueueGetCnt( ) != 0 ) )
+    {
+        return;
+    }
+    MacCtx.ClassCAckUplinkRequested = false;
+
+    // An uplink sent meanwhile carried the acknowledgement
+    if( ( MacCtx.NvmCtx->SrvAckRequested == false ) || ( MacCtx.NvmCtx->DeviceClass != CLASS_C ) )
+    {
+        return;
+    }
+
+    // Empty frame, the pending MAC commands answers are sent along. The frame
+    // waits for the duty-cycle.
+    mcpsReq.Type = MCPS_UNCONFIRMED;
+    mcpsReq.Req.Unconfirmed.fPort = 0;
+    mcpsReq.Req.Unconfirmed.fBuffer = NULL;
+    mcpsReq.Req.Unconfirmed.fBufferSize = 0;
+    mcpsReq.Req.Unconfirmed.Datarate = MacCtx.NvmCtx->MacParams.ChannelsDatarate;
+
+    McpsRequest( &mcpsReq, true, false );
+}
+
+static LoRaMacStatus_t McpsRequest( McpsReq_t* mcpsRequest, bool allowDelayedTx, bool inPlace )
+{
     LoRaMacStatus_t status = LORAMAC_STATUS_SERVICE_UNKNOWN;
     LoRaMacHeader_t macHdr;
     VerifyParams_t verify;
@@ -4587,15 +8137,7 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest )
     uint16_t fBufferSize;
     int8_t datarate = DR_0;
     bool readyToSend = false;
-
-    if( mcpsRequest == NULL )
-    {
-        return LORAMAC_STATUS_PARAMETER_INVALID;
-    }
-    if( LoRaMacIsBusy( ) == true )
-    {
-        return LORAMAC_STATUS_BUSY;
-    }
+    uint32_t startTicks = TimerGetCurrentTicks( );
 
     macHdr.Value = 0;
     memset1( ( uint8_t* ) &MacCtx.McpsConfirm, 0, sizeof( MacCtx.McpsConfirm ) );
@@ -4604,6 +8146,13 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest )
     // AckTimeoutRetriesCounter must be reset every time a new request (unconfirmed or confirmed) is performed.
     MacCtx.AckTimeoutRetriesCounter = 1;
 
+    if( MacCtx.FPendingUplinkOngoing == false )
+    {
+        // The application uplink opens the RX windows as well
+        MacCtx.FPendingUplinkRequested = false;
+        MacCtx.FPendingUplinkCnt = 0;
+    }
+
     switch( mcpsRequest->Type )
     {
         case MCPS_UNCONFIRMED:
@@ -4645,13 +8194,9 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest )
             break;
     }
 
-    // Get the minimum possible datarate
-    getPhy.Attribute = PHY_MIN_TX_DR;
-    getPhy.UplinkDwellTime = MacCtx.NvmCtx->MacParams.UplinkDwellTime;
-    phyParam = RegionGetPhyParam( MacCtx.NvmCtx->Region, &getPhy );
     // Apply the minimum possible datarate.
     // Some regions have limitations for the minimum datarate.
-    datarate = MAX( datarate, ( int8_t )phyParam.Value );
+    datarate = MAX( datarate, MacCtx.PhyParams.MinTxDr[MacCtx.NvmCtx->MacParams.UplinkDwellTime != 0] );
 
     if( readyToSend == true )
     {
@@ -4670,15 +8215,28 @@ LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest )
             }
         }
 
-        status = Send( &macHdr, fPort, fBuffer, fBufferSize );
-        if( status == LORAMAC_STATUS_OK )
+        UplinkCostStart( );
+        status = Send( &macHdr, fPort, fBuffer, fBufferSize, allowDelayedTx, inPlace );
+        if( ( status == LORAMAC_STATUS_OK ) || ( status == LORAMAC_STATUS_SKIPPED_APP_DATA ) )
         {
             MacCtx.McpsConfirm.McpsRequest = mcpsRequest->Type;
             MacCtx.MacFlags.Bits.McpsReq = 1;
+            ProfileRequestStart( ProfileGetMcpsRequest( mcpsRequest->Type ) );
+            UplinkCostAddMcuTime( startTicks );
+#ifdef PACKET_POOL_ENABLED
+            if( inPlace == true )
+            {
+                // The application may release its reference right away
+                PacketPoolRef( fBuffer );
+                MacCtx.TxAppBuffer = fBuffer;
+            }
+#endif
         }
         else
         {
+            MacCtx.UplinkCostActive = false;
             MacCtx.NodeAckRequested = false;
+            PacketPoolFree( ReleasePktBuffer( ) );
         }
     }
 
@@ -4697,3 +8255,37 @@ void LoRaMacTestSetDutyCycleOn( bool enable )
         MacCtx.NvmCtx->DutyCycleOn = enable;
     }
 }
+
+void LoRaMacTestProcessMacCommands( uint8_t* payload, uint8_t size, int8_t snr )
+{
+    ProcessMacCommands( payload, 0, size, snr, RX_SLOT_WIN_1 );
+}
+
+void LoRaMacTestSetProfileHooks( const LoRaMacProfileHooks_t* hooks )
+{
+#ifdef LORAMAC_PROFILE_ENABLED
+    Profile.Hooks = hooks;
+#endif
+}
+
+bool LoRaMacTestGetProfileStats( LoRaMacProfileStats_t* stats, bool reset )
+{
+#ifdef LORAMAC_PROFILE_ENABLED
+    if( stats == NULL )
+    {
+        return false;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    *stats = Profile.Stats;
+    ProfileAddStateTime( stats, TimerGetCurrentTime( ) );
+    if( reset == true )
+    {
+        ProfileReset( );
+    }
+    CRITICAL_SECTION_END( );
+    return true;
+#else
+    return false;
+#endif
+}
@@ -134,6 +134,63 @@
  */
 #define MAX_ACK_RETRIES                             8
 
+/*!
+ * Maximum number of channels tried for a transmission by the listen before
+ * talk with CAD, see \ref MIB_LBT_CAD
+ */
+#ifndef LORAMAC_LBT_CAD_MAX_TRIALS
+#define LORAMAC_LBT_CAD_MAX_TRIALS                  4
+#endif
+
+/*!
+ * Default maximum number of empty uplinks the MAC sends in a row to collect
+ * the downlinks announced by the FPending bit, see
+ * \ref MIB_FPENDING_MAX_UPLINKS
+ */
+#ifndef LORAMAC_FPENDING_MAX_UPLINKS
+#define LORAMAC_FPENDING_MAX_UPLINKS                8
+#endif
+
+/*!
+ * Default delay after a class C confirmed downlink before the MAC sends its
+ * acknowledgement in an empty uplink [ms], see \ref MIB_CLASS_C_ACK_DELAY
+ */
+#ifndef LORAMAC_CLASS_C_ACK_DELAY
+#define LORAMAC_CLASS_C_ACK_DELAY                   2000
+#endif
+
+/*!
+ * Mean SNR margin of the class A downlinks above the demodulation floor of
+ * their datarate under which the RX1 and RX2 windows use the boosted gain of
+ * the radio [dB]. Only used when LORAMAC_RX_GAIN_ADAPTIVE_ENABLED is defined.
+ */
+#ifndef LORAMAC_RX_GAIN_BOOST_MARGIN
+#define LORAMAC_RX_GAIN_BOOST_MARGIN                3
+#endif
+
+/*!
+ * Number of class A reception failures, frames received with errors or
+ * missed acknowledgements, from which the RX1 and RX2 windows use the
+ * boosted gain until the next downlink
+ */
+#ifndef LORAMAC_RX_GAIN_BOOST_FAILURES
+#define LORAMAC_RX_GAIN_BOOST_FAILURES              2
+#endif
+
+/*!
+ * SNR improvement of the boosted gain, removed from the SNR of the downlinks
+ * received with it [dB]
+ */
+#define LORAMAC_RX_GAIN_BOOST_SNR_GAIN              2
+
+/*!
+ * Maximum number of class C frames waiting to be processed, see
+ * \ref MIB_CLASS_C_RX_QUEUE_DEPTH
+ */
+#ifndef LORAMAC_CLASS_C_RX_QUEUE_SIZE
+#define LORAMAC_CLASS_C_RX_QUEUE_SIZE               4
+#endif
+
 /*!
  * Frame direction definition for up-link communications
  */
@@ -162,6 +219,21 @@
  */
 #define LORA_MAC_FRMPAYLOAD_OVERHEAD                13 // MHDR(1) + FHDR(7) + Port(1) + MIC(4)
 
+/*!
+ * Room reserved in front of the payload of an in place MCPS request
+ */
+#define LORAMAC_FRAME_HEADROOM                      24 // MHDR(1) + FHDR(7) + FOpts(15) + Port(1)
+
+/*!
+ * Room reserved after the payload of an in place MCPS request
+ */
+#define LORAMAC_FRAME_TAILROOM                      4 // MIC(4)
+
+/*!
+ * Maximum payload size of an in place MCPS request
+ */
+#define LORAMAC_FRAME_PAYLOAD_MAX_SIZE              242
+
 /*!
  * Maximum number of multicast context
  */
@@ -595,6 +667,11 @@ typedef enum eLoRaMacEventInfoStatus
      * ToDo
      */
     LORAMAC_EVENT_INFO_STATUS_BEACON_NOT_FOUND,
+    /*!
+     * An activity was detected on all the channels tried by the listen
+     * before talk with CAD
+     */
+    LORAMAC_EVENT_INFO_STATUS_TX_CHANNEL_BUSY,
 }LoRaMacEventInfoStatus_t;
 
 /*!
@@ -803,6 +880,102 @@ typedef struct sMcpsReq
     }Req;
 }McpsReq_t;
 
+/*!
+ * Application buffer of an in place MCPS request. The LoRaMAC layer builds
+ * the frame header in the headroom and the MIC after the payload.
+ *
+ * \sa LoRaMacMcpsRequestInPlace
+ */
+typedef struct sLoRaMacMcpsReqBuffer
+{
+    /*!
+     * Reserved for the frame header
+     */
+    uint8_t Headroom[LORAMAC_FRAME_HEADROOM];
+    /*!
+     * Frame payload, followed by the room reserved for the MIC
+     */
+    uint8_t Payload[LORAMAC_FRAME_PAYLOAD_MAX_SIZE + LORAMAC_FRAME_TAILROOM];
+}LoRaMacMcpsReqBuffer_t;
+
+/*!
+ * Radio and MCU activity attributed to an uplink, retransmissions included
+ *
+ * The radio times come from the radio statistics. When the radio driver does
+ * not provide them, the transmission time is the frame time-on-air and the
+ * reception time is the time the RX1 and RX2 windows were open in the MAC.
+ * The class C continuous reception is not attributed to the uplinks.
+ */
+typedef struct sLoRaMacUplinkCost
+{
+    /*!
+     * Number of transmissions
+     */
+    uint32_t NbTx;
+    /*!
+     * Radio transmission time [ms]
+     */
+    TimerTime_t TxTime;
+    /*!
+     * Radio transmission charge estimate [uAs], 0 when the radio driver does
+     * not provide it
+     */
+    uint32_t TxCharge;
+    /*!
+     * Radio reception time in the RX1 windows [ms]
+     */
+    TimerTime_t Rx1Time;
+    /*!
+     * Radio reception time in the RX2 windows [ms]
+     */
+    TimerTime_t Rx2Time;
+    /*!
+     * Time spent in the MAC processing [us]
+     */
+    uint32_t McuActiveTime;
+    /*!
+     * Aggregated duty cycle time-off caused by the transmissions [ms]
+     */
+    TimerTime_t TimeOff;
+}LoRaMacUplinkCost_t;
+
+/*!
+ * Number of received frames dropped by the MAC, per reason
+ *
+ * The MHDR and the device address of the data frames are checked in the radio
+ * buffer, before the frame is parsed. The frames of the other devices received
+ * in the class C window are dropped there and the window is reopened without
+ * any MCPS-Indication.
+ */
+typedef struct sLoRaMacRxDropStats
+{
+    /*!
+     * Frames with an uplink or an unknown message type
+     */
+    uint32_t MType;
+    /*!
+     * Frames too short or too long for the datarate, or which could not be
+     * parsed
+     */
+    uint32_t Length;
+    /*!
+     * Frames addressed to another device or to an unknown multicast group
+     */
+    uint32_t Address;
+    /*!
+     * Frames with an invalid frame counter, repeated frames included
+     */
+    uint32_t FCnt;
+    /*!
+     * Frames with an invalid MIC
+     */
+    uint32_t Mic;
+    /*!
+     * Class C frames received while the class C queue was full
+     */
+    uint32_t Overflow;
+}LoRaMacRxDropStats_t;
+
 /*!
  * LoRaMAC MCPS-Confirm
  */
@@ -844,6 +1017,10 @@ typedef struct sMcpsConfirm
      * The uplink channel related to the frame
      */
     uint32_t Channel;
+    /*!
+     * Radio and MCU activity of the request
+     */
+    LoRaMacUplinkCost_t Cost;
 }McpsConfirm_t;
 
 /*!
@@ -876,7 +1053,8 @@ typedef struct sMcpsIndication
      */
     uint8_t FramePending;
     /*!
-     * Pointer to the received data stream
+     * Pointer to the received data stream. Points into the radio receive
+     * buffer and is only valid until the MCPS-Indication callback returns.
      */
     uint8_t* Buffer;
     /*!
@@ -1274,6 +1452,22 @@ typedef struct sMlmeIndication
  * \ref MIB_DEFAULT_ANTENNA_GAIN                 | YES | YES
  * \ref MIB_NVM_CTXS                             | YES | YES
  * \ref MIB_ABP_LORAWAN_VERSION                  | YES | YES
+ * \ref MIB_FCNT_UP_LOOKAHEAD                    | YES | YES
+ * \ref MIB_RX_TIMING_STATS                      | YES | YES
+ * \ref MIB_UPLINK_COST                          | YES | YES
+ * \ref MIB_LBT_CAD                              | YES | YES
+ * \ref MIB_RXC_DUTY_CYCLE                       | YES | YES
+ * \ref MIB_ADR_STRATEGY                         | YES | YES
+ * \ref MIB_RX_DROP_STATS                        | YES | YES
+ * \ref MIB_TX_HOP_PERIOD                        | YES | YES
+ * \ref MIB_IRQ_LATENCY_STATS                    | YES | YES
+ * \ref MIB_CLASS_C_RX_QUEUE_DEPTH               | YES | YES
+ * \ref MIB_CLASS_C_RADIO                        | YES | YES
+ * \ref MIB_RETRY_POLICY                         | YES | YES
+ * \ref MIB_FPENDING_MAX_UPLINKS                 | YES | YES
+ * \ref MIB_CHANNEL_QUALITY                      | YES | YES
+ * \ref MIB_CLASS_C_ACK_DELAY                    | YES | YES
+ * \ref MIB_BATTERY_LEVEL                        | YES | YES
  *
  * The following table provides links to the function implementations of the
  * related MIB primitives:
@@ -1282,6 +1476,8 @@ typedef struct sMlmeIndication
  * ---------------- | :---------------------:
  * MIB-Set          | \ref LoRaMacMibSetRequestConfirm
  * MIB-Get          | \ref LoRaMacMibGetRequestConfirm
+ * MIB-Set list     | \ref LoRaMacMibSetRequestConfirmList
+ * MIB-Get list     | \ref LoRaMacMibGetRequestConfirmList
  */
 typedef enum eMib
 {
@@ -1624,12 +1820,142 @@ typedef enum eMib
     MIB_DEFAULT_ANTENNA_GAIN,
     /*!
      * Structure holding pointers to internal contexts and its size
+     *
+     * \remark Setting the contexts requires a stopped MAC. The key streams
+     *         and the other caches of the replaced session are dropped, which
+     *         allows switching between network sessions.
      */
     MIB_NVM_CTXS,
     /*!
      * LoRaWAN MAC layer operating version when activated by ABP.
      */
     MIB_ABP_LORAWAN_VERSION,
+    /*!
+     * Number of uplink frame counters reserved by each store of the crypto
+     * context. The uplink frame counter resumes from the reserved value after
+     * a reset, which skips up to this number of counters.
+     * 0 stores the crypto context on every uplink.
+     */
+    MIB_FCNT_UP_LOOKAHEAD,
+    /*!
+     * Offsets of the received downlinks preambles in the RX1 and RX2
+     * windows, per datarate. Only available when
+     * LORAMAC_RX_TIMING_STATS_ENABLED is defined. Setting it clears the
+     * statistics.
+     */
+    MIB_RX_TIMING_STATS,
+    /*!
+     * Sum of the activity attributed to the confirmed MCPS requests.
+     * Setting it clears the sum.
+     */
+    MIB_UPLINK_COST,
+    /*!
+     * Listen before talk with a channel activity detection. When enabled,
+     * a CAD runs on the selected channel before each transmission. The MAC
+     * selects another channel when an activity is detected, up to
+     * \ref LORAMAC_LBT_CAD_MAX_TRIALS channels. Only applies to the LoRa
+     * datarates, the regional carrier sense is still performed.
+     */
+    MIB_LBT_CAD,
+    /*!
+     * Class C reception with the radio RX duty cycle. The radio autonomously
+     * alternates short receptions and sleep periods and only interrupts the
+     * MCU when a downlink preamble is detected.
+     *
+     * The value is the preamble length, in symbols, the network server uses
+     * for the class C downlinks of the device. LoRaWAN has no MAC command to
+     * negotiate it: it must be configured on the network server side, the
+     * default 8 symbols preamble being too short for the duty cycle.
+     *
+     * The listening periods last \ref MIB_MIN_RX_SYMBOLS symbols and the
+     * sleep periods are sized so that a listening period always falls within
+     * the preamble. Set to 0 to use the continuous reception. The continuous
+     * reception is also kept when the radio has no RX duty cycle or the
+     * preamble is too short for the RX2 datarate.
+     */
+    MIB_RXC_DUTY_CYCLE,
+    /*!
+     * Device side ADR strategy, see \ref LoRaMacAdr.h. Defaults to the
+     * LoRaWAN ADR backoff. Setting it drops the link history of the new
+     * strategy.
+     */
+    MIB_ADR_STRATEGY,
+    /*!
+     * Number of received frames dropped by the MAC, per reason. Setting it
+     * clears the counters.
+     */
+    MIB_RX_DROP_STATS,
+    /*!
+     * Intra-packet frequency hopping period of the uplinks [symbols]. The
+     * radio hops on the enabled channels in a pseudo-random sequence seeded
+     * by the device address. Set to 0 to disable the hopping, the default.
+     *
+     * \remark Supported by the US915 region with a SX127x radio. The
+     *         receiver must follow the same hopping sequence.
+     */
+    MIB_TX_HOP_PERIOD,
+    /*!
+     * Latency histograms from the radio interrupts to the MAC processing
+     * stages. Only available when LORAMAC_IRQ_LATENCY_STATS_ENABLED is
+     * defined. Setting it clears the histograms.
+     */
+    MIB_IRQ_LATENCY_STATS,
+    /*!
+     * Maximum number of class C frames waiting to be processed, up to
+     * \ref LORAMAC_CLASS_C_RX_QUEUE_SIZE. The radio keeps listening from
+     * the RX done interrupt on and the frames received meanwhile are
+     * queued. Set to 0 to process the class C frames with the radio asleep.
+     * Only available when LORAMAC_CLASS_C_RX_QUEUE_ENABLED is defined.
+     */
+    MIB_CLASS_C_RX_QUEUE_DEPTH,
+    /*!
+     * Radio dedicated to the class C window, NULL to share the radio of the
+     * class A exchanges. The dedicated radio keeps listening while the other
+     * one transmits and opens the RX1 and RX2 windows. Its frames are queued
+     * in the class C queue and processed in between the class A exchanges.
+     * The radio must use another driver than the selected one, refer to
+     * \ref RadioSelect. Only available when LORAMAC_CLASS_C_RX_QUEUE_ENABLED
+     * is defined.
+     */
+    MIB_CLASS_C_RADIO,
+    /*!
+     * Confirmed uplinks retry policy, see \ref LoRaMacRetry.h. Defaults to
+     * the LoRaWAN retries. Setting it drops the history of the new policy.
+     */
+    MIB_RETRY_POLICY,
+    /*!
+     * Maximum number of uplinks the MAC sends in a row when a class A
+     * downlink has the FPending bit set. The uplinks are empty, they carry
+     * the pending MAC commands answers, and are sent as soon as the
+     * duty-cycle allows. An application uplink restarts the count. Set to 0
+     * to disable. Defaults to \ref LORAMAC_FPENDING_MAX_UPLINKS. Only
+     * applies to class A.
+     */
+    MIB_FPENDING_MAX_UPLINKS,
+    /*!
+     * Link quality of the uplink channels. The uplinks avoid the channels
+     * with missed acknowledgements. Cleared at the network activation and
+     * when the region changes, setting it clears the statistics. Only
+     * available when LORAMAC_CHANNEL_QUALITY_ENABLED is defined.
+     */
+    MIB_CHANNEL_QUALITY,
+    /*!
+     * Delay after a class C confirmed downlink before the MAC sends its
+     * acknowledgement in an empty uplink [ms]. An uplink sent meanwhile
+     * carries the acknowledgement instead, and so do the queued ones. The
+     * downlinks of a burst share the acknowledgement, the delay starts at
+     * the first one. The empty uplink waits for the duty-cycle. Set to 0 to
+     * leave the acknowledgements to the application. Defaults to
+     * \ref LORAMAC_CLASS_C_ACK_DELAY.
+     */
+    MIB_CLASS_C_ACK_DELAY,
+    /*!
+     * Battery level answered to the DevStatusReq commands. Once set, the
+     * \ref LoRaMacCallback_t::GetBatteryLevel callback is no longer called
+     * while the downlinks are processed, the application refreshes the
+     * value when convenient.
+     */
+    MIB_BATTERY_LEVEL,
     /*!
      * Beacon interval in ms
      */
@@ -1690,6 +2016,276 @@ typedef enum eMib
      MIB_PING_SLOT_DATARATE,
 }Mib_t;
 
+/*!
+ * Number of datarates tracked by the RX window timing statistics
+ */
+#define LORAMAC_RX_TIMING_STATS_NB_DR               16
+
+/*!
+ * RX window timing statistics of a datarate
+ *
+ * The offset is the time between the RX window opening and the start of the
+ * downlink preamble. The preamble start is the RxDone event time minus the
+ * frame time-on-air.
+ */
+typedef struct sRxTimingStats
+{
+    /*!
+     * Number of measured downlinks
+     */
+    uint32_t NbSamples;
+    /*!
+     * Mean offset [us]
+     */
+    int32_t MeanOffset;
+    /*!
+     * Minimum offset [us]
+     */
+    int32_t MinOffset;
+    /*!
+     * Maximum offset [us]
+     */
+    int32_t MaxOffset;
+}RxTimingStats_t;
+
+/*!
+ * Number of bins of the radio interrupt latency histograms
+ */
+#define LORAMAC_IRQ_LATENCY_NB_BINS                 12
+
+/*!
+ * Upper bound of the first bin of the radio interrupt latency histograms [us].
+ * The bound doubles from one bin to the next one, the last bin collects the
+ * latencies above 65.536 ms.
+ */
+#define LORAMAC_IRQ_LATENCY_BIN0_US                 64
+
+/*!
+ * MAC processing stages measured from the radio interrupt edge
+ */
+typedef enum eLoRaMacIrqLatencyStage
+{
+    /*!
+     * RxDone radio event callback
+     */
+    LORAMAC_IRQ_LATENCY_RX_DONE_EVENT,
+    /*!
+     * RxDone event picked up by LoRaMacProcess
+     */
+    LORAMAC_IRQ_LATENCY_RX_DONE_PROCESS,
+    /*!
+     * End of the received frame processing
+     */
+    LORAMAC_IRQ_LATENCY_RX_DONE_PROCESSED,
+    /*!
+     * MCPS indication to the application
+     */
+    LORAMAC_IRQ_LATENCY_MCPS_INDICATION,
+    /*!
+     * TxDone radio event callback
+     */
+    LORAMAC_IRQ_LATENCY_TX_DONE_EVENT,
+    /*!
+     * TxDone event picked up by LoRaMacProcess
+     */
+    LORAMAC_IRQ_LATENCY_TX_DONE_PROCESS,
+    /*!
+     * Start of the RX1 window timer
+     */
+    LORAMAC_IRQ_LATENCY_RX1_TIMER_START,
+    /*!
+     * RX1 window opening, measured past the RX1 delay
+     */
+    LORAMAC_IRQ_LATENCY_RX1_OPENING,
+    /*!
+     * Number of measured stages
+     */
+    LORAMAC_IRQ_LATENCY_STAGE_MAX,
+}LoRaMacIrqLatencyStage_t;
+
+/*!
+ * Latency histogram of a MAC processing stage
+ */
+typedef struct sLoRaMacIrqLatencyStats
+{
+    /*!
+     * Number of latencies per bin. Bin n counts the latencies below
+     * \ref LORAMAC_IRQ_LATENCY_BIN0_US << n
+     */
+    uint32_t Bins[LORAMAC_IRQ_LATENCY_NB_BINS];
+    /*!
+     * Number of measured latencies
+     */
+    uint32_t NbSamples;
+    /*!
+     * Maximum latency [us]
+     */
+    uint32_t MaxLatency;
+}LoRaMacIrqLatencyStats_t;
+
+/*!
+ * \defgroup LORAMAC_TRACE Radio events trace
+ *
+ * Binary log records of the radio events and of the MAC timers arming, only
+ * written when LORAMAC_RADIO_TRACE_ENABLED and BINLOG_ENABLED are defined.
+ * The record time is the \ref TimerGetCurrentTime value at the event. The
+ * multi-bytes fields are little endian. The trace-replay sub project replays
+ * a capture into LoRaMac in virtual time.
+ *
+ * \remark The RX done records carry the received frame, BINLOG_RING_SIZE
+ *         has to be raised to hold a few of them.
+ * \{
+ */
+
+/*!
+ * Frame sent
+ *
+ * | Digest | Size | MHDR | FPort | FRMPayloadSize | Channel | Datarate | TxPower | TimeOnAir |
+ * |   4    |  1   |  1   |   1   |       1        |    1    |    1     |    1    |     2     |
+ *
+ * Digest is the CRC-32 of the frame. FPort and FRMPayloadSize are 0 for the
+ * join requests. TimeOnAir is in ms.
+ */
+#define LORAMAC_TRACE_ID_TX                         0x40
+
+/*!
+ * Tx done, the payload is the radio interrupt latency [us], 16 bits
+ */
+#define LORAMAC_TRACE_ID_TX_DONE                    0x41
+
+/*!
+ * Tx timeout, no payload
+ */
+#define LORAMAC_TRACE_ID_TX_TIMEOUT                 0x42
+
+/*!
+ * Reception window opened
+ *
+ * | Slot | Datarate |
+ * |  1   |    1     |
+ *
+ * Slot is a \ref LoRaMacRxSlot_t or \ref LORAMAC_TRACE_SLOT_BEACON.
+ */
+#define LORAMAC_TRACE_ID_RX_WINDOW                  0x43
+
+/*!
+ * Frame received
+ *
+ * | Latency | RSSI | SNR | Payload |
+ * |    2    |  2   |  1  |  Size   |
+ *
+ * Latency is the radio interrupt latency [us]. The payload is truncated to
+ * \ref LORAMAC_TRACE_RX_MAX_SIZE bytes.
+ */
+#define LORAMAC_TRACE_ID_RX_DONE                    0x44
+
+/*!
+ * Rx timeout, no payload
+ */
+#define LORAMAC_TRACE_ID_RX_TIMEOUT                 0x45
+
+/*!
+ * Rx error, no payload
+ */
+#define LORAMAC_TRACE_ID_RX_ERROR                   0x46
+
+/*!
+ * MAC timer started
+ *
+ * | Timer | Delay |
+ * |   1   |   4   |
+ *
+ * Timer is a \ref LoRaMacTraceTimer_t, Delay is in us.
+ */
+#define LORAMAC_TRACE_ID_TIMER                      0x47
+
+/*!
+ * Slot of the class B beacon windows
+ */
+#define LORAMAC_TRACE_SLOT_BEACON                   0x80
+
+/*!
+ * Largest received payload held by a record [bytes]
+ */
+#define LORAMAC_TRACE_RX_MAX_SIZE                   250
+
+/*!
+ * Traced MAC timers
+ */
+typedef enum eLoRaMacTraceTimer
+{
+    /*!
+     * RX1 window opening, from the Tx done
+     */
+    LORAMAC_TRACE_TIMER_RX1,
+    /*!
+     * RX2 window opening, from the Tx done
+     */
+    LORAMAC_TRACE_TIMER_RX2,
+    /*!
+     * Acknowledgement timeout
+     */
+    LORAMAC_TRACE_TIMER_ACK_TIMEOUT,
+    /*!
+     * Delayed transmission, duty cycle or uplink shift
+     */
+    LORAMAC_TRACE_TIMER_TX_DELAYED,
+}LoRaMacTraceTimer_t;
+
+/*! \} defgroup LORAMAC_TRACE */
+
+/*!
+ * Number of channels whose link quality is tracked. The channels above are
+ * selected as the region draws them.
+ */
+#ifndef LORAMAC_CHANNEL_QUALITY_NB_CHANNELS
+#define LORAMAC_CHANNEL_QUALITY_NB_CHANNELS         16
+#endif
+
+/*!
+ * Maximum number of channels drawn for an uplink, the last one is kept
+ * whatever its link quality
+ */
+#ifndef LORAMAC_CHANNEL_QUALITY_DRAWS
+#define LORAMAC_CHANNEL_QUALITY_DRAWS               4
+#endif
+
+/*!
+ * Link quality of an uplink channel
+ *
+ * A missed acknowledgement raises the loss score of the channel and a class A
+ * downlink lowers it, each outcome weighs a quarter of the score. The MAC
+ * draws another channel from the region with a probability of Loss / 256,
+ * the channels selection stays random and within the regional rules.
+ */
+typedef struct sLoRaMacChannelQuality
+{
+    /*!
+     * Number of transmissions of the confirmed uplinks
+     */
+    uint16_t NbConfirmed;
+    /*!
+     * Number of acknowledged transmissions of the confirmed uplinks
+     */
+    uint16_t NbAcked;
+    /*!
+     * Number of downlinks received in the RX1 window
+     */
+    uint16_t NbRx1;
+    /*!
+     * RX1 downlinks RSSI moving average [dBm]
+     */
+    int16_t Rx1Rssi;
+    /*!
+     * RX1 downlinks SNR moving average [dB]
+     */
+    int8_t Rx1Snr;
+    /*!
+     * Loss score, from 0 to 252
+     */
+    uint8_t Loss;
+}LoRaMacChannelQuality_t;
+
 /*!
  * LoRaMAC MIB parameters
  */
@@ -2025,6 +2621,107 @@ typedef union uMibParam
      * Related MIB type: \ref MIB_ABP_LORAWAN_VERSION
      */
     Version_t AbpLrWanVersion;
+    /*!
+     * Number of reserved uplink frame counters
+     *
+     * Related MIB type: \ref MIB_FCNT_UP_LOOKAHEAD
+     */
+    uint32_t FCntUpLookahead;
+    /*!
+     * RX window timing statistics, array of \ref LORAMAC_RX_TIMING_STATS_NB_DR
+     * elements indexed by the datarate
+     *
+     * Related MIB type: \ref MIB_RX_TIMING_STATS
+     */
+    const RxTimingStats_t* RxTimingStats;
+    /*!
+     * Sum of the activity attributed to the MCPS requests
+     *
+     * Related MIB type: \ref MIB_UPLINK_COST
+     */
+    const LoRaMacUplinkCost_t* UplinkCost;
+    /*!
+     * Listen before talk with CAD activation
+     *
+     * Related MIB type: \ref MIB_LBT_CAD
+     */
+    bool LbtCadEnable;
+    /*!
+     * Class C downlinks preamble length [symbols], 0 for the continuous
+     * reception
+     *
+     * Related MIB type: \ref MIB_RXC_DUTY_CYCLE
+     */
+    uint16_t RxCDutyCyclePreambleLen;
+    /*!
+     * Device side ADR strategy
+     *
+     * Related MIB type: \ref MIB_ADR_STRATEGY
+     */
+    const struct sLoRaMacAdrStrategy* AdrStrategy;
+    /*!
+     * Received frames drop counters
+     *
+     * Related MIB type: \ref MIB_RX_DROP_STATS
+     */
+    const LoRaMacRxDropStats_t* RxDropStats;
+    /*!
+     * Uplinks frequency hopping period [symbols]
+     *
+     * Related MIB type: \ref MIB_TX_HOP_PERIOD
+     */
+    uint8_t TxHopPeriod;
+    /*!
+     * Radio interrupt latency histograms, array of
+     * \ref LORAMAC_IRQ_LATENCY_STAGE_MAX elements indexed by the stage
+     *
+     * Related MIB type: \ref MIB_IRQ_LATENCY_STATS
+     */
+    const LoRaMacIrqLatencyStats_t* IrqLatencyStats;
+    /*!
+     * Maximum number of class C frames waiting to be processed
+     *
+     * Related MIB type: \ref MIB_CLASS_C_RX_QUEUE_DEPTH
+     */
+    uint8_t ClassCRxQueueDepth;
+    /*!
+     * Radio dedicated to the class C window
+     *
+     * Related MIB type: \ref MIB_CLASS_C_RADIO
+     */
+    const struct Radio_s* ClassCRadio;
+    /*!
+     * Confirmed uplinks retry policy
+     *
+     * Related MIB type: \ref MIB_RETRY_POLICY
+     */
+    const struct sLoRaMacRetryPolicy* RetryPolicy;
+    /*!
+     * Maximum number of uplinks collecting the pending downlinks
+     *
+     * Related MIB type: \ref MIB_FPENDING_MAX_UPLINKS
+     */
+    uint8_t FPendingMaxUplinks;
+    /*!
+     * Uplink channels link quality, array of
+     * \ref LORAMAC_CHANNEL_QUALITY_NB_CHANNELS elements indexed by the channel
+     *
+     * Related MIB type: \ref MIB_CHANNEL_QUALITY
+     */
+    const LoRaMacChannelQuality_t* ChannelQuality;
+    /*!
+     * Delay before the acknowledgement of a class C confirmed downlink is
+     * sent in an empty uplink [ms]
+     *
+     * Related MIB type: \ref MIB_CLASS_C_ACK_DELAY
+     */
+    uint32_t ClassCAckDelay;
+    /*!
+     * Battery level, see \ref LoRaMacCallback_t::GetBatteryLevel
+     *
+     * Related MIB type: \ref MIB_BATTERY_LEVEL
+     */
+    uint8_t BatteryLevel;
     /*!
      * Beacon interval in ms
      *
@@ -2137,6 +2834,24 @@ typedef struct sLoRaMacTxInfo
      * which is dependent on the current datarate.
      */
     uint8_t CurrentPossiblePayloadSize;
+    /*!
+     * Time to wait in ms before the band and aggregated time-offs allow the
+     * next transmission. 0 if it is possible right away.
+     */
+    TimerTime_t NextTxDelay;
+    /*!
+     * Time-on-air in ms of the frame carrying the application data payload
+     * and the scheduled MAC commands, at the datarate it would be sent with.
+     * When the uplink dwell time is enabled, the maximum payload sizes keep
+     * it below the dwell time limit.
+     */
+    TimerTime_t TimeOnAir;
+    /*!
+     * Lowest datarate, starting at the datarate the frame would be sent with,
+     * the frame fits into. -1 if it fits at no datarate. Applications running
+     * without ADR can use it to avoid the \ref LORAMAC_STATUS_LENGTH_ERROR.
+     */
+    int8_t FitDatarate;
 }LoRaMacTxInfo_t;
 
 /*!
@@ -2289,6 +3004,10 @@ typedef enum eLoRaMacRegion_t
      * Russia band on 864MHz
      */
     LORAMAC_REGION_RU864,
+    /*!
+     * Custom channel plan, see \ref REGIONCUSTOM
+     */
+    LORAMAC_REGION_CUSTOM,
 }LoRaMacRegion_t;
 
 /*!
@@ -2367,6 +3086,9 @@ typedef struct sLoRaMacCallback
     /*!
      * \brief   Measures the battery level
      *
+     * \remark  Called on the DevStatusReq commands until the battery level
+     *          is set with \ref MIB_BATTERY_LEVEL.
+     *
      * \retval  Battery level [0: node is connected to an external
      *          power source, 1..254: battery level, where 1 is the minimum
      *          and 254 is the maximum value, 255: the node was not able
@@ -2395,6 +3117,11 @@ typedef struct sLoRaMacCallback
 }LoRaMacCallback_t;
 
 
+/*!
+ * LoRaMAC instance handle. Refer to \ref LoRaMacInstanceSelect.
+ */
+typedef struct sLoRaMacInstance* LoRaMacHandle_t;
+
 /*!
  * LoRaMAC Max EIRP (dBm) table
  */
@@ -2442,6 +3169,77 @@ LoRaMacStatus_t LoRaMacStart( void );
  */
 LoRaMacStatus_t LoRaMacStop( void );
 
+/*!
+ * \brief   Returns the amount of memory required to store a LoRaMAC instance
+ *
+ * \details The instance storage holds the complete LoRaMAC stack state
+ *          including the non-volatile contexts of the sub modules.
+ *          The storage must be zero initialized before its first selection.
+ *
+ * \param   [IN] region - The region the instance will run.
+ *
+ * \retval  size Instance storage size in bytes
+ */
+size_t LoRaMacInstanceGetSize( LoRaMacRegion_t region );
+
+/*!
+ * \brief   Selects the LoRaMAC instance on which the API operates
+ *
+ * \details Saves the state of the currently selected instance into its
+ *          storage and loads the state of the given instance. A never
+ *          selected instance must be initialized by calling
+ *          \ref LoRaMacInitialization after its selection.
+ *          Passing NULL selects the built-in storage, which starts
+ *          uninitialized. The built-in storage has no instance storage to
+ *          save its state to: once initialized, it can not be swapped out
+ *          and the selection of another instance is rejected.
+ *
+ * \remark  The radio and the Class B module volatile state are shared between
+ *          the instances. An instance may only be swapped out when no MAC
+ *          operation is ongoing and Class B beacon tracking is inactive.
+ *
+ * \param   [IN] handle - Instance storage of at least
+ *                        \ref LoRaMacInstanceGetSize bytes.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY,
+ *          \ref LORAMAC_STATUS_SERVICE_UNKNOWN.
+ */
+LoRaMacStatus_t LoRaMacInstanceSelect( LoRaMacHandle_t handle );
+
+/*!
+ * \brief   Returns the currently selected LoRaMAC instance
+ *
+ * \retval  handle Selected instance. NULL when the built-in storage is used.
+ */
+LoRaMacHandle_t LoRaMacInstanceGetActive( void );
+
+/*!
+ * \brief   Switches the LoRaMAC layer to another region without a full
+ *          re-initialization
+ *
+ * \details The region contexts are kept in RAM. A region which has been
+ *          active before is resumed with its channel plan and band time-offs,
+ *          a never used region starts from its defaults. The session (device
+ *          address, keys and frame counters), the receive delays and the
+ *          aggregated duty-cycle are kept. The datarate, the TX power, the
+ *          RX2 channel, the dwell times and the Class B parameters restart
+ *          from the new region defaults.
+ *
+ * \remark  Only the context of the active region is part of the NVM
+ *          contexts, see \ref MIB_NVM_CTXS. The switch is only
+ *          possible in Class A and while no MAC operation is ongoing.
+ *
+ * \param   [IN] region - The region to switch to.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY,
+ *          \ref LORAMAC_STATUS_REGION_NOT_SUPPORTED.
+ */
+LoRaMacStatus_t LoRaMacSwitchRegion( LoRaMacRegion_t region );
+
 /*!
  * \brief Returns a value indicating if the MAC layer is busy or not.
  * 
@@ -2449,10 +3247,23 @@ LoRaMacStatus_t LoRaMacStop( void );
  */
 bool LoRaMacIsBusy( void );
 
+/*!
+ * \brief Returns a value indicating if a LoRaMac event is waiting to be
+ *        processed by \ref LoRaMacProcess.
+ *
+ * \remark The radio, timer and class B events are set from interrupt
+ *         context. The check has to be done with the interrupts disabled
+ *         before entering a low power mode.
+ *
+ * \retval isPending An event is pending.
+ */
+bool LoRaMacHasPendingEvents( void );
+
 /*!
  * Processes the LoRaMac events.
  *
- * \remark This function must be called in the main loop.
+ * \remark This function must be called in the main loop. It returns
+ *         immediately when no event is pending.
  */
 void LoRaMacProcess( void );
 
@@ -2468,6 +3279,10 @@ void LoRaMacProcess( void );
  *                         ( according to the configured datarate or the next
  *                         datarate according to ADR ), and the maximum frame
  *                         size, taking the scheduled MAC commands into account.
+ *                         It also reports the time to wait before the
+ *                         duty-cycle allows the next transmission, the
+ *                         time-on-air of the frame and the lowest datarate
+ *                         it fits into.
  *
  * \retval  LoRaMacStatus_t Status of the operation. When the parameters are
  *          not valid, the function returns \ref LORAMAC_STATUS_PARAMETER_INVALID.
@@ -2530,6 +3345,30 @@ LoRaMacStatus_t LoRaMacChannelRemove( uint8_t id );
  */
 LoRaMacStatus_t LoRaMacMcChannelSetup( McChannelParams_t *channel );
 
+/*!
+ * \brief   LoRaMAC multicast channels batch setup service
+ *
+ * \details Sets up several multicast channels at once. The keys of all the
+ *          channels are derived in a single secure element batch and the
+ *          NVM contexts change once.
+ *
+ * \param   [IN] channels - Multicast channels to set.
+ *
+ * \param   [IN] nbChannels - Number of channels, up to \ref LORAMAC_MAX_MC_CTX.
+ *
+ * \param   [OUT] statuses - Status of each channel setup. Set unless
+ *                           \ref LORAMAC_STATUS_PARAMETER_INVALID is returned.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation, the last failed channel
+ *          setup status. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY,
+ *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+ *          \ref LORAMAC_STATUS_MC_GROUP_UNDEFINED,
+ *          \ref LORAMAC_STATUS_CRYPTO_ERROR.
+ */
+LoRaMacStatus_t LoRaMacMcChannelSetupBatch( McChannelParams_t *channels, uint8_t nbChannels, LoRaMacStatus_t *statuses );
+
 /*!
  * \brief   LoRaMAC multicast channel removal service
  *
@@ -2599,6 +3438,20 @@ LoRaMacStatus_t LoRaMacMcChannelSetupRxParams( AddressIdentifier_t groupID, McRx
  */
 LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet );
 
+/*!
+ * \brief   LoRaMAC MIB-Get of several attributes
+ *
+ * \details Performs the MIB-GET-Requests of the list in order, as
+ *          \ref LoRaMacMibGetRequestConfirm does, and stops at the first
+ *          failure.
+ *
+ * \param   [IN] mibGet - MIB-GET-Requests to perform. Refer to \ref MibRequestConfirm_t.
+ * \param   [IN] nbMib  - Number of requests in the list.
+ *
+ * \retval  LoRaMacStatus_t Status of the last request performed.
+ */
+LoRaMacStatus_t LoRaMacMibGetRequestConfirmList( MibRequestConfirm_t* mibGet, uint8_t nbMib );
+
 /*!
  * \brief   LoRaMAC MIB-Set
  *
@@ -2630,6 +3483,21 @@ LoRaMacStatus_t LoRaMacMibGetRequestConfirm( MibRequestConfirm_t* mibGet );
  */
 LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet );
 
+/*!
+ * \brief   LoRaMAC MIB-Set of several attributes
+ *
+ * \details Performs the MIB-SET-Requests of the list in order, as
+ *          \ref LoRaMacMibSetRequestConfirm does, and stops at the first
+ *          failure. The non-volatile context changes are notified once for
+ *          the whole list, and only if an attribute value changed.
+ *
+ * \param   [IN] mibSet - MIB-SET-Requests to perform. Refer to \ref MibRequestConfirm_t.
+ * \param   [IN] nbMib  - Number of requests in the list.
+ *
+ * \retval  LoRaMacStatus_t Status of the last request performed.
+ */
+LoRaMacStatus_t LoRaMacMibSetRequestConfirmList( MibRequestConfirm_t* mibSet, uint8_t nbMib );
+
 /*!
  * \brief   LoRaMAC MLME-Request
  *
@@ -2663,6 +3531,27 @@ LoRaMacStatus_t LoRaMacMibSetRequestConfirm( MibRequestConfirm_t* mibSet );
  */
 LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest );
 
+/*!
+ * \brief   LoRaMAC MLME-Request of several piggy-backed requests
+ *
+ * \details Requests at once MLME_LINK_CHECK, MLME_DEVICE_TIME,
+ *          MLME_PING_SLOT_INFO and MLME_BEACON_TIMING. Their MAC commands are
+ *          all sent in the FOpts of the next uplink, each request being
+ *          confirmed by its own MLME-Confirm. A request which is already
+ *          pending is answered by the same uplink.
+ *
+ * \remark  The requests are performed in the list order up to the first
+ *          failure. The requests performed before it remain pending.
+ *
+ * \param   [IN] mlmeRequests - MLME-Requests to perform. Refer to \ref MlmeReq_t.
+ * \param   [IN] nbRequests   - Number of requests in the list.
+ *
+ * \retval  LoRaMacStatus_t Status of the last request performed.
+ *          \ref LORAMAC_STATUS_PARAMETER_INVALID when a request isn't
+ *          piggy-backed.
+ */
+LoRaMacStatus_t LoRaMacMlmeRequests( MlmeReq_t* mlmeRequests, uint8_t nbRequests );
+
 /*!
  * \brief   LoRaMAC MCPS-Request
  *
@@ -2685,6 +3574,11 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest );
  * }
  * \endcode
  *
+ * \remark  With LORAMAC_TX_QUEUE_ENABLED, a request issued while the MAC is
+ *          busy is queued and sent later, see \ref LORAMACTXQUEUE. Queued
+ *          requests sent in the same frame share one MCPS-Confirm.
+ *          \ref LORAMAC_STATUS_BUSY is only returned when the queue is full.
+ *
  * \param   [IN] mcpsRequest - MCPS-Request to perform. Refer to \ref McpsReq_t.
  *
  * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
@@ -2697,6 +3591,33 @@ LoRaMacStatus_t LoRaMacMlmeRequest( MlmeReq_t* mlmeRequest );
  */
 LoRaMacStatus_t LoRaMacMcpsRequest( McpsReq_t* mcpsRequest );
 
+/*!
+ * \brief   LoRaMAC MCPS-Request without payload copy
+ *
+ * \details Same as \ref LoRaMacMcpsRequest, but the frame is built and
+ *          encrypted directly in the application buffer. The fBuffer field of
+ *          the request must point to the Payload field of a
+ *          \ref LoRaMacMcpsReqBuffer_t.
+ *
+ * \remark  The buffer belongs to the LoRaMAC layer until the MCPS-Confirm
+ *          event. The payload is encrypted in place. If the MAC is busy,
+ *          the request is queued as a copy, see \ref LoRaMacMcpsRequest.
+ *          When the buffer is a packet pool block, the LoRaMAC layer holds a
+ *          reference to it up to the MCPS-Confirm return and the application
+ *          may release its own right after the request.
+ *
+ * \param   [IN] mcpsRequest - MCPS-Request to perform. Refer to \ref McpsReq_t.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY,
+ *          \ref LORAMAC_STATUS_SERVICE_UNKNOWN,
+ *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+ *          \ref LORAMAC_STATUS_NO_NETWORK_JOINED,
+ *          \ref LORAMAC_STATUS_LENGTH_ERROR,
+ */
+LoRaMacStatus_t LoRaMacMcpsRequestInPlace( McpsReq_t* mcpsRequest );
+
 /*!
  * Automatically add the Region.h file at the end of LoRaMac.h file.
  * This is required because Region.h uses definitions from LoRaMac.h
@@ -34,6 +34,41 @@
 #include "region/Region.h"
 #include "LoRaMacAdr.h"
 
+/*!
+ * TX power step between two consecutive TX power indexes [dB]
+ */
+#define LORAMAC_ADR_TX_POWER_STEP                   2
+
+/*!
+ * Demodulation floor of a LoRa spreading factor [0.5 dB]. -7.5 dB at SF7,
+ * 2.5 dB lower per spreading factor.
+ */
+#define LORAMAC_ADR_SNR_FLOOR( sf )                 ( 20 - ( 5 * ( sf ) ) )
+
+/*
+ * Link margin strategy downlinks history
+ */
+typedef struct sLinkHistory
+{
+    /*!
+     * Downlinks SNR [dB], in a ring
+     */
+    int8_t Snr[LORAMAC_ADR_HISTORY_LEN];
+    /*!
+     * Index of the next recorded downlink
+     */
+    uint8_t Index;
+    /*!
+     * Number of recorded downlinks
+     */
+    uint8_t Nb;
+}LinkHistory_t;
+
+/*
+ * Link margin strategy context
+ */
+static LinkHistory_t LinkHistory;
+
 static bool CalcNextV10X( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut, uint32_t* adrAckCounter )
 {
     bool adrAckReq = false;
@@ -128,3 +163,141 @@ bool LoRaMacAdrCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* tx
     }
     return false;
 }
+
+static void LinkMarginReset( void )
+{
+    LinkHistory.Index = 0;
+    LinkHistory.Nb = 0;
+}
+
+static void LinkMarginOnDownlink( int16_t rssi, int8_t snr )
+{
+    // The RSSI is not used, the SNR alone gives the demodulation margin
+    ( void )rssi;
+
+    LinkHistory.Snr[LinkHistory.Index] = snr;
+    LinkHistory.Index = ( LinkHistory.Index + 1 ) % LORAMAC_ADR_HISTORY_LEN;
+    if( LinkHistory.Nb < LORAMAC_ADR_HISTORY_LEN )
+    {
+        LinkHistory.Nb++;
+    }
+}
+
+/*!
+ * \brief Selects the datarate and the TX power from the downlinks history
+ *
+ * \param [IN/OUT] adrNext ADR parameters. The datarate and the TX power are
+ *                         updated.
+ */
+static void LinkMarginSelect( CalcNextAdrParams_t* adrNext )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+    VerifyParams_t verify;
+    int16_t snrSum = 0;
+    int16_t snr;
+    int16_t margin = 0;
+    int8_t datarate;
+    int8_t minTxDatarate;
+    int8_t bestDatarate = -1;
+    uint32_t previousSf = 0xFF;
+    bool fasterDatarate = false;
+
+    for( uint8_t i = 0; i < LinkHistory.Nb; i++ )
+    {
+        snrSum += LinkHistory.Snr[i];
+    }
+    // Mean SNR [0.5 dB]
+    snr = ( 2 * snrSum ) / LinkHistory.Nb;
+
+    getPhy.Attribute = PHY_MIN_TX_DR;
+    getPhy.UplinkDwellTime = adrNext->UplinkDwellTime;
+    phyParam = RegionGetPhyParam( adrNext->Region, &getPhy );
+    minTxDatarate = phyParam.Value;
+
+    // Fastest datarate keeping the installation margin. Only the LoRa datarates
+    // of decreasing spreading factors are considered, the wider bandwidths
+    // having a higher noise floor.
+    verify.DatarateParams.UplinkDwellTime = adrNext->UplinkDwellTime;
+    for( datarate = minTxDatarate; datarate <= DR_15; datarate++ )
+    {
+        int16_t drMargin;
+
+        verify.DatarateParams.Datarate = datarate;
+        if( RegionVerify( adrNext->Region, &verify, PHY_TX_DR ) == false )
+        {
+            break;
+        }
+        getPhy.Attribute = PHY_SPREADING_FACTOR;
+        getPhy.Datarate = datarate;
+        phyParam = RegionGetPhyParam( adrNext->Region, &getPhy );
+        if( ( phyParam.Value < 7 ) || ( phyParam.Value > 12 ) || ( phyParam.Value >= previousSf ) )
+        {
+            break;
+        }
+        previousSf = phyParam.Value;
+
+        drMargin = snr - LORAMAC_ADR_SNR_FLOOR( phyParam.Value ) - ( 2 * LORAMAC_ADR_INSTALLATION_MARGIN );
+        if( drMargin < 0 )
+        {
+            fasterDatarate = true;
+            break;
+        }
+        bestDatarate = datarate;
+        margin = drMargin;
+    }
+
+    getPhy.Attribute = PHY_MAX_TX_POWER;
+    phyParam = RegionGetPhyParam( adrNext->Region, &getPhy );
+    adrNext->TxPower = phyParam.Value;
+
+    if( bestDatarate < 0 )
+    {
+        // No margin left, even at the slowest datarate
+        adrNext->Datarate = minTxDatarate;
+        return;
+    }
+    adrNext->Datarate = bestDatarate;
+
+    if( fasterDatarate == false )
+    {
+        // Lower the TX power with the remaining margin
+        for( int16_t steps = margin / ( 2 * LORAMAC_ADR_TX_POWER_STEP ); steps > 0; steps-- )
+        {
+            verify.TxPower = adrNext->TxPower + 1;
+            if( RegionVerify( adrNext->Region, &verify, PHY_TX_POWER ) == false )
+            {
+                break;
+            }
+            adrNext->TxPower++;
+        }
+    }
+}
+
+static bool LinkMarginCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut, uint32_t* adrAckCounter )
+{
+    CalcNextAdrParams_t params = *adrNext;
+
+    // The history is stale once the ADR ack limit is reached, the backoff
+    // then takes over
+    if( ( adrNext->AdrEnabled == true ) && ( LinkHistory.Nb >= LORAMAC_ADR_HISTORY_MIN_NB ) &&
+        ( adrNext->AdrAckCounter < adrNext->AdrAckLimit ) )
+    {
+        LinkMarginSelect( &params );
+    }
+    return LoRaMacAdrCalcNext( &params, drOut, txPowOut, adrAckCounter );
+}
+
+const LoRaMacAdrStrategy_t LoRaMacAdrStrategyBackoff =
+{
+    .Reset = NULL,
+    .OnDownlink = NULL,
+    .CalcNext = LoRaMacAdrCalcNext,
+};
+
+const LoRaMacAdrStrategy_t LoRaMacAdrStrategyLinkMargin =
+{
+    .Reset = LinkMarginReset,
+    .OnDownlink = LinkMarginOnDownlink,
+    .CalcNext = LinkMarginCalcNext,
+};
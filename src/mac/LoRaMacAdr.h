@@ -37,6 +37,10 @@
 #ifndef __LORAMACADR_H__
 #define __LORAMACADR_H__
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "LoRaMac.h"
+
 /*! \} defgroup LORAMACADR */
 
 /*
@@ -101,4 +105,76 @@ typedef struct sCalcNextAdrParams
  */
 bool LoRaMacAdrCalcNext( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut, uint32_t* adrAckCounter );
 
+/*!
+ * Number of downlinks recorded by the link margin ADR strategy
+ */
+#ifndef LORAMAC_ADR_HISTORY_LEN
+#define LORAMAC_ADR_HISTORY_LEN                     8
+#endif
+
+/*!
+ * Minimum number of recorded downlinks before the link margin ADR strategy
+ * selects the datarate and the TX power
+ */
+#ifndef LORAMAC_ADR_HISTORY_MIN_NB
+#define LORAMAC_ADR_HISTORY_MIN_NB                  4
+#endif
+
+/*!
+ * Margin kept by the link margin ADR strategy above the demodulation floor of
+ * the selected datarate [dB]. Covers the fading and the link asymmetry, the
+ * gateways usually transmitting with more power than the end-devices.
+ */
+#ifndef LORAMAC_ADR_INSTALLATION_MARGIN
+#define LORAMAC_ADR_INSTALLATION_MARGIN             10
+#endif
+
+/*!
+ * Device side ADR strategy
+ */
+typedef struct sLoRaMacAdrStrategy
+{
+    /*!
+     * \brief Drops the recorded link history. Called at the network
+     *        activation and when a LinkAdrReq is accepted. May be NULL.
+     */
+    void ( *Reset )( void );
+    /*!
+     * \brief Records the link quality of a valid downlink received in the RX1
+     *        or RX2 window. May be NULL.
+     *
+     * \param [IN] rssi Downlink RSSI [dBm]
+     * \param [IN] snr  Downlink SNR [dB]
+     */
+    void ( *OnDownlink )( int16_t rssi, int8_t snr );
+    /*!
+     * \brief Calculates the next datarate and TX power. Same as
+     *        \ref LoRaMacAdrCalcNext. Must not change the strategy state, the
+     *        MAC also calls it to evaluate the possible payload sizes.
+     */
+    bool ( *CalcNext )( CalcNextAdrParams_t* adrNext, int8_t* drOut, int8_t* txPowOut, uint32_t* adrAckCounter );
+}LoRaMacAdrStrategy_t;
+
+/*!
+ * LoRaWAN ADR backoff only, see \ref LoRaMacAdrCalcNext. Default strategy.
+ */
+extern const LoRaMacAdrStrategy_t LoRaMacAdrStrategyBackoff;
+
+/*!
+ * Selects the datarate and the TX power from the mean SNR of the last
+ * \ref LORAMAC_ADR_HISTORY_LEN downlinks, on top of the LoRaWAN ADR backoff.
+ *
+ * The fastest LoRa datarate whose demodulation floor stays
+ * \ref LORAMAC_ADR_INSTALLATION_MARGIN below the mean SNR is selected, in a
+ * single step. The TX power is then lowered with the remaining margin when no
+ * faster datarate exists. The history is only used once it holds
+ * \ref LORAMAC_ADR_HISTORY_MIN_NB downlinks and as long as the ADR ack limit
+ * is not reached.
+ *
+ * \remark The strategy overrides the network server ADR decisions once enough
+ *         downlinks are received after a LinkAdrReq. Only use it with network
+ *         servers not managing the device datarate.
+ */
+extern const LoRaMacAdrStrategy_t LoRaMacAdrStrategyLinkMargin;
+
 #endif // __LORAMACADR_H__
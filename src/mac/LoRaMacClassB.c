@@ -18,7 +18,10 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jaeckle ( STACKFORCE )
 */
 #include <math.h>
+#include <stdlib.h>
 #include "utilities.h"
+#include "crc.h"
+#include "binlog.h"
 #include "secure-element.h"
 #include "LoRaMac.h"
 #include "LoRaMacClassB.h"
@@ -98,6 +101,87 @@ typedef struct sLoRaMacClassBNvmCtx
     LoRaMacClassBBeaconNvmCtx_t BeaconCtx;
 } LoRaMacClassBNvmCtx_t;
 
+/*!
+ * Number of cached ping offsets per beacon period: unicast, then multicast
+ */
+#define PING_RAND_NB_ADDRESSES                      ( 1 + LORAMAC_MAX_MC_CTX )
+
+/*!
+ * Index of the unicast ping offset
+ */
+#define PING_RAND_UNICAST_INDEX                     0
+
+/*!
+ * Pseudo random value of a ping offset, computed once per beacon period
+ */
+typedef struct sPingRand
+{
+    /*!
+     * Beacon time of the beacon period, GPS time in seconds modulo 2^32
+     */
+    uint32_t BeaconTime;
+    /*!
+     * Frame address
+     */
+    uint32_t Address;
+    /*!
+     * Floor plan frequency of the ping slots of the address
+     */
+    uint32_t Frequency;
+    /*!
+     * Pseudo random value. The ping offset is Rand % PingPeriod.
+     */
+    uint16_t Rand;
+    /*!
+     * Set if the entry holds a computed value
+     */
+    bool Valid;
+}PingRand_t;
+
+/*
+ * Clock drift estimation, based on the beacon receptions
+ */
+typedef struct sBeaconDriftCtx
+{
+    /*!
+     * Time elapsed between two synchronizations on a beacon, in ms
+     */
+    uint32_t Interval[CLASSB_DRIFT_NB_SAMPLES];
+    /*!
+     * Local clock error measured at the beacon receptions, in ms. The error
+     * is positive, if the local clock is ahead.
+     */
+    int32_t Error[CLASSB_DRIFT_NB_SAMPLES];
+    /*!
+     * Index of the next sample
+     */
+    uint8_t Index;
+    /*!
+     * Number of valid samples
+     */
+    uint8_t NbSamples;
+    /*!
+     * Estimated clock drift in ppb
+     */
+    int32_t Drift;
+    /*!
+     * Largest residual error of the estimation over the samples, in ms
+     */
+    uint32_t Jitter;
+    /*!
+     * Number of beacons missed since the last synchronization
+     */
+    uint8_t NbMissed;
+    /*!
+     * Time of the last synchronization on a beacon
+     */
+    SysTime_t LastSync;
+    /*!
+     * Set if LastSync is valid
+     */
+    bool LastSyncValid;
+}BeaconDriftCtx_t;
+
 /*
  * LoRaMac Class B Context structure
  */
@@ -112,30 +196,57 @@ typedef struct sLoRaMacClassBCtx
     */
     BeaconContext_t BeaconCtx;
     /*!
+    * Clock drift estimation
+    */
+    BeaconDriftCtx_t BeaconDrift;
+    /*!
+    * Frequency of the first beacon channel of the region
+    */
+    uint32_t BeaconChannelFreq;
+    /*!
+    * Beacon channels stepwidth of the region
+    */
+    uint32_t BeaconChannelStepwidth;
+    /*!
+    * Number of beacon channels of the region
+    */
+    uint8_t BeaconNbChannels;
+    /*!
+    * Ping offsets and frequencies of the current and the next beacon periods,
+    * indexed by the beacon period parity
+    */
+    PingRand_t PingRand[2][PING_RAND_NB_ADDRESSES];
+    /*!
     * State of the beaconing mechanism
     */
     BeaconState_t BeaconState;
     /*!
-    * State of the ping slot mechanism
+    * State of the ping slot mechanism, shared by the unicast and multicast
+    * slots
     */
     PingSlotState_t PingSlotState;
     /*!
-    * State of the multicast slot mechanism
+    * Reception parameters of the next ping slot
+    */
+    RxConfigParams_t SlotRxConfig;
+    /*!
+    * Set once the radio has been configured with SlotRxConfig
     */
-    PingSlotState_t MulticastSlotState;
+    bool SlotRxConfigValid;
+    /*!
+    * Set if the next ping slot reuses the radio configuration of the
+    * previous one
+    */
+    bool SlotRxConfigReuse;
     /*!
     * Timer for CLASS B beacon acquisition and tracking.
     */
     TimerEvent_t BeaconTimer;
     /*!
-    * Timer for CLASS B ping slot timer.
+    * Timer for CLASS B unicast and multicast ping slots.
     */
     TimerEvent_t PingSlotTimer;
     /*!
-    * Timer for CLASS B multicast ping slot timer.
-    */
-    TimerEvent_t MulticastSlotTimer;
-    /*!
     * Container for the callbacks related to class b.
     */
     LoRaMacClassBCallback_t LoRaMacClassBCallbacks;
@@ -164,7 +275,6 @@ typedef union uLoRaMacClassBEvents
     {
         uint32_t Beacon        : 1;
         uint32_t PingSlot      : 1;
-        uint32_t MulticastSlot : 1;
     }Events;
 }LoRaMacClassBEvents_t;
 
@@ -181,22 +291,17 @@ static LoRaMacClassBNvmCtx_t NvmCtx;
 static LoRaMacClassBCtx_t Ctx;
 
 /*!
- * Computes the Ping Offset
+ * Computes the pseudo random value of the Ping Offset
  *
- * \param [IN]  beaconTime      - Time of the recent received beacon
+ * \param [IN]  time            - Beacon time, GPS time in seconds modulo 2^32
  * \param [IN]  address         - Frame address
- * \param [IN]  pingPeriod      - Ping period of the node
- * \param [OUT] pingOffset      - Pseudo random ping offset
+ *
+ * \retval Pseudo random value
  */
-static void ComputePingOffset( uint64_t beaconTime, uint32_t address, uint16_t pingPeriod, uint16_t *pingOffset )
+static uint16_t ComputePingRand( uint32_t time, uint32_t address )
 {
     uint8_t buffer[16];
     uint8_t cipher[16];
-    uint32_t result = 0;
-    /* Refer to chapter 15.2 of the LoRaWAN specification v1.1. The beacon time
-     * GPS time in seconds modulo 2^32
-     */
-    uint32_t time = ( beaconTime % ( ( ( uint64_t ) 1 ) << 32 ) );
 
     memset1( buffer, 0, 16 );
     memset1( cipher, 0, 16 );
@@ -213,9 +318,94 @@ static void ComputePingOffset( uint64_t beaconTime, uint32_t address, uint16_t p
 
     SecureElementAesEncrypt( buffer, 16, SLOT_RAND_ZERO_KEY, cipher );
 
-    result = ( ( ( uint32_t ) cipher[0] ) + ( ( ( uint32_t ) cipher[1] ) * 256 ) );
+    return ( uint16_t )( ( ( uint32_t ) cipher[0] ) + ( ( ( uint32_t ) cipher[1] ) * 256 ) );
+}
+
+static uint32_t CalcDownlinkChannelAndFrequency( uint32_t devAddr, TimerTime_t beaconTime, TimerTime_t beaconInterval );
+
+/*!
+ * Gets the cache entry of a ping offset, computing it if needed
+ *
+ * \param [IN]  time            - Beacon time, GPS time in seconds modulo 2^32
+ * \param [IN]  index           - Address index, PING_RAND_UNICAST_INDEX or
+ *                                1 + multicast channel index
+ * \param [IN]  address         - Frame address
+ *
+ * \retval Cache entry
+ */
+static PingRand_t* GetPingRandEntry( uint32_t time, uint8_t index, uint32_t address )
+{
+    PingRand_t* entry = &Ctx.PingRand[( time / ( CLASSB_BEACON_INTERVAL / 1000 ) ) & 0x01][index];
+
+    if( ( entry->Valid == false ) || ( entry->BeaconTime != time ) || ( entry->Address != address ) )
+    {
+        entry->Rand = ComputePingRand( time, address );
+        entry->Frequency = CalcDownlinkChannelAndFrequency( address, time, CLASSB_BEACON_INTERVAL );
+        entry->BeaconTime = time;
+        entry->Address = address;
+        entry->Valid = true;
+    }
+    return entry;
+}
+
+/*!
+ * Gets the pseudo random value of a ping offset, computing it if needed
+ *
+ * \param [IN]  time            - Beacon time, GPS time in seconds modulo 2^32
+ * \param [IN]  index           - Address index, PING_RAND_UNICAST_INDEX or
+ *                                1 + multicast channel index
+ * \param [IN]  address         - Frame address
+ *
+ * \retval Pseudo random value
+ */
+static uint16_t GetPingRand( uint32_t time, uint8_t index, uint32_t address )
+{
+    return GetPingRandEntry( time, index, address )->Rand;
+}
+
+/*!
+ * Computes the Ping Offset
+ *
+ * \param [IN]  beaconTime      - Time of the recent received beacon
+ * \param [IN]  index           - Address index, PING_RAND_UNICAST_INDEX or
+ *                                1 + multicast channel index
+ * \param [IN]  address         - Frame address
+ * \param [IN]  pingPeriod      - Ping period of the node
+ * \param [OUT] pingOffset      - Pseudo random ping offset
+ */
+static void ComputePingOffset( uint64_t beaconTime, uint8_t index, uint32_t address, uint16_t pingPeriod, uint16_t *pingOffset )
+{
+    /* Refer to chapter 15.2 of the LoRaWAN specification v1.1. The beacon time
+     * GPS time in seconds modulo 2^32
+     */
+    uint32_t time = ( beaconTime % ( ( ( uint64_t ) 1 ) << 32 ) );
 
-    *pingOffset = ( uint16_t )( result % pingPeriod );
+    *pingOffset = ( uint16_t )( GetPingRand( time, index, address ) % pingPeriod );
+}
+
+/*!
+ * Computes the ping offsets of the next beacon period ahead of the beacon, so
+ * that the ping slot processing finds them in the cache
+ */
+static void PrecomputePingOffsets( void )
+{
+    uint32_t time = Ctx.BeaconCtx.BeaconTime.Seconds + ( CLASSB_BEACON_INTERVAL / 1000 );
+    MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
+
+    if( Ctx.NvmCtx->PingSlotCtx.Ctrl.Assigned == 1 )
+    {
+        GetPingRand( time, PING_RAND_UNICAST_INDEX, *Ctx.LoRaMacClassBParams.LoRaMacDevAddr );
+    }
+    if( cur != NULL )
+    {
+        for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++, cur++ )
+        {
+            if( ( cur->ChannelParams.IsEnabled == true ) && ( cur->ChannelParams.Class == CLASS_B ) )
+            {
+                GetPingRand( time, 1 + i, cur->ChannelParams.Address );
+            }
+        }
+    }
 }
 
 /*!
@@ -227,21 +417,8 @@ static void ComputePingOffset( uint64_t beaconTime, uint32_t address, uint16_t p
  */
 static uint32_t CalcDownlinkFrequency( uint8_t channel )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
-    uint32_t frequency = 0;
-    uint32_t stepwidth = 0;
-
-    getPhy.Attribute = PHY_BEACON_CHANNEL_FREQ;
-    phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
-    frequency = phyParam.Value;
-
-    getPhy.Attribute = PHY_BEACON_CHANNEL_STEPWIDTH;
-    phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
-    stepwidth = phyParam.Value;
-
     // Calculate the frequency
-    return frequency + ( channel * stepwidth );
+    return Ctx.BeaconChannelFreq + ( channel * Ctx.BeaconChannelStepwidth );
 }
 
 /*!
@@ -258,21 +435,14 @@ static uint32_t CalcDownlinkFrequency( uint8_t channel )
  */
 static uint32_t CalcDownlinkChannelAndFrequency( uint32_t devAddr, TimerTime_t beaconTime, TimerTime_t beaconInterval )
 {
-    GetPhyParams_t getPhy;
-    PhyParam_t phyParam;
     uint32_t channel = 0;
-    uint8_t nbChannels = 0;
     uint32_t frequency = 0;
 
-    getPhy.Attribute = PHY_BEACON_NB_CHANNELS;
-    phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
-    nbChannels = (uint8_t) phyParam.Value;
-
-    if( nbChannels > 1 )
+    if( Ctx.BeaconNbChannels > 1 )
     {
         // Calculate the channel for the next downlink
         channel = devAddr + ( beaconTime / ( beaconInterval / 1000 ) );
-        channel = channel % nbChannels;
+        channel = channel % Ctx.BeaconNbChannels;
     }
 
     // Calculate the frequency for the next downlink
@@ -282,6 +452,237 @@ static uint32_t CalcDownlinkChannelAndFrequency( uint32_t devAddr, TimerTime_t b
     return frequency;
 }
 
+/*!
+ * \brief Computes the difference between two system times
+ *
+ * \param [IN] a System time
+ * \param [IN] b System time
+ *
+ * \retval Difference a - b in ms
+ */
+static int32_t SysTimeDiffMs( SysTime_t a, SysTime_t b )
+{
+    SysTime_t diff = SysTimeSub( a, b );
+
+    // The unsigned wrap around gives the negative differences
+    return ( int32_t )( diff.Seconds * 1000 + diff.SubSeconds );
+}
+
+/*!
+ * \brief Restarts the clock drift estimation
+ */
+static void BeaconDriftReset( void )
+{
+    memset1( ( uint8_t* ) &Ctx.BeaconDrift, 0, sizeof( BeaconDriftCtx_t ) );
+}
+
+/*!
+ * \brief Verifies if the clock drift estimation can be used
+ *
+ * \retval [true: enough beacons have been received, false: use the default
+ *          window handling]
+ */
+static bool BeaconDriftIsValid( void )
+{
+    return ( Ctx.BeaconDrift.NbSamples >= CLASSB_DRIFT_MIN_SAMPLES );
+}
+
+/*!
+ * \brief Updates the clock drift estimation with a beacon reception
+ *
+ * \remark The drift is the slope of the local clock error over the elapsed
+ *         time, accumulated over the last samples. The error is measured from
+ *         the synchronization on the previous beacon, hence the line goes
+ *         through the origin.
+ *
+ * \param [IN] localTime System time at the beacon reception, before the
+ *                       synchronization
+ * \param [IN] syncTime  System time given by the beacon
+ */
+static void BeaconDriftAddSample( SysTime_t localTime, SysTime_t syncTime )
+{
+    BeaconDriftCtx_t* drift = &Ctx.BeaconDrift;
+    int64_t sumError = 0;
+    int64_t sumInterval = 0;
+    int32_t interval = 0;
+    int32_t error = 0;
+
+    drift->NbMissed = 0;
+
+    if( drift->LastSyncValid == true )
+    {
+        interval = SysTimeDiffMs( syncTime, drift->LastSync );
+        error = SysTimeDiffMs( localTime, syncTime );
+
+        if( ( interval <= 0 ) || ( interval > CLASSB_MAX_BEACON_LESS_PERIOD ) ||
+            ( ( ( int64_t )abs( error ) * 1000000 ) > ( ( int64_t )interval * CLASSB_DRIFT_MAX_PPM ) ) )
+        {
+            // The system time has been updated in between, or the beacon
+            // has been missed for too long. Restart the estimation.
+            BeaconDriftReset( );
+        }
+        else
+        {
+            drift->Interval[drift->Index] = ( uint32_t )interval;
+            drift->Error[drift->Index] = error;
+            drift->Index = ( drift->Index + 1 ) % CLASSB_DRIFT_NB_SAMPLES;
+            if( drift->NbSamples < CLASSB_DRIFT_NB_SAMPLES )
+            {
+                drift->NbSamples++;
+            }
+
+            for( uint8_t i = 0; i < drift->NbSamples; i++ )
+            {
+                sumError += drift->Error[i];
+                sumInterval += drift->Interval[i];
+            }
+            drift->Drift = ( int32_t )( ( sumError * 1000000000 ) / sumInterval );
+
+            drift->Jitter = 0;
+            for( uint8_t i = 0; i < drift->NbSamples; i++ )
+            {
+                int32_t residual = drift->Error[i] - ( int32_t )( ( ( int64_t )drift->Drift * drift->Interval[i] ) / 1000000000 );
+
+                drift->Jitter = MAX( drift->Jitter, ( uint32_t )abs( residual ) );
+            }
+        }
+    }
+    drift->LastSync = syncTime;
+    drift->LastSyncValid = true;
+}
+
+/*!
+ * \brief Computes the expected local clock error at the next beacon
+ *
+ * \retval Clock error to add to the beacon event time in ms
+ */
+static int32_t BeaconDriftGetCorrection( void )
+{
+    int64_t elapsed = ( int64_t )( Ctx.BeaconDrift.NbMissed + 1 ) * CLASSB_BEACON_INTERVAL;
+
+    return ( int32_t )( ( elapsed * Ctx.BeaconDrift.Drift ) / 1000000000 );
+}
+
+/*!
+ * \brief Computes the RX error of the next beacon window. The error grows
+ *        linearly with the number of missed beacons.
+ *
+ * \retval RX error in ms
+ */
+static uint32_t BeaconDriftGetRxError( void )
+{
+    uint32_t rxError = ( Ctx.BeaconDrift.Jitter + CLASSB_DRIFT_RX_ERROR_MIN ) * ( Ctx.BeaconDrift.NbMissed + 1 );
+
+    return MIN( rxError, CLASSB_WINDOW_MOVE_EXPANSION_MAX );
+}
+
+/*!
+ * \brief Applies the clock compensation to a beacon period
+ *
+ * \param [IN] period Beacon period in ms
+ *
+ * \retval Compensated period in ms
+ */
+static TimerTime_t BeaconTimeCompensation( TimerTime_t period )
+{
+    if( BeaconDriftIsValid( ) == true )
+    {
+        // The measured drift already includes the temperature effects
+        return period;
+    }
+    return TimerTempCompensation( period, Ctx.BeaconCtx.Temperature );
+}
+
+/*!
+ * \brief Computes the RX error of a beacon window placed with the system time.
+ *        The error grows with the time elapsed since the last system time
+ *        synchronization.
+ *
+ * \param [IN]  delay   Delay until the beacon in ms
+ * \param [OUT] rxError RX error in ms
+ *
+ * \retval [true: the system time is accurate enough to place the window,
+ *          false: no usable time reference]
+ */
+static bool GetTimeSyncRxError( TimerTime_t delay, uint32_t* rxError )
+{
+    uint32_t syncAge = SysTimeGetSyncAge( );
+    uint32_t ppm = CLASSB_TIME_SYNC_PPM;
+    uint64_t elapsed = 0;
+
+    if( syncAge > ( CLASSB_MAX_BEACON_LESS_PERIOD / 1000 ) )
+    {
+        return false;
+    }
+
+    if( ( BeaconDriftIsValid( ) == true ) || ( SysTimeGetDrift( ) != 0 ) )
+    {
+        // The remaining error of a compensated clock
+        ppm = CLASSB_TIME_SYNC_DISCIPLINED_PPM;
+    }
+
+    elapsed = ( ( uint64_t )syncAge * 1000 ) + delay;
+    *rxError = CLASSB_TIME_SYNC_RX_ERROR_MIN + Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError +
+               ( uint32_t )( ( elapsed * ppm ) / 1000000 );
+
+    return ( *rxError <= CLASSB_TIME_SYNC_RX_ERROR_MAX );
+}
+
+/*!
+ * \brief Predicts the next beacon with the system time and sets up the
+ *        acquisition by time. The system time may have been synchronized by
+ *        a DeviceTimeAns, the application clock synchronization or a beacon.
+ *
+ * \param [IN] currentTime Current timer time in ms
+ *
+ * \retval [true: the acquisition by time is set up, false: no usable time
+ *          reference]
+ */
+static bool SetupAcquisitionFromSysTime( TimerTime_t currentTime )
+{
+    SysTimeTicks_t sysTime = SysTimeGetTicks( );
+    SysTimeTicks_t nextBeacon = 0;
+    TimerTime_t delay = 0;
+    uint32_t rxError = 0;
+    int32_t correction = 0;
+
+    // The beacons are sent at the multiples of the beacon interval since the
+    // GPS epoch
+    nextBeacon = SysTimeTicksNextGpsPeriod( sysTime, CLASSB_BEACON_INTERVAL / 1000 );
+    delay = ( TimerTime_t )SysTimeTicksToMs( ( nextBeacon - sysTime ) & SYS_TIME_TICKS_MASK );
+
+    if( GetTimeSyncRxError( delay, &rxError ) == false )
+    {
+        return false;
+    }
+    if( delay <= ( rxError + Radio.GetWakeupTime( ) ) )
+    {
+        // Too late to open the window early enough, wait for the next beacon
+        nextBeacon += SysTimeTicksFromMs( CLASSB_BEACON_INTERVAL );
+        delay += CLASSB_BEACON_INTERVAL;
+        if( GetTimeSyncRxError( delay, &rxError ) == false )
+        {
+            return false;
+        }
+    }
+
+    if( BeaconDriftIsValid( ) == true )
+    {
+        // Apply the measured clock drift over the time since the last
+        // synchronization
+        correction = ( int32_t )( ( ( ( ( int64_t )SysTimeGetSyncAge( ) * 1000 ) + delay ) * Ctx.BeaconDrift.Drift ) / 1000000000 );
+        delay += correction;
+    }
+
+    Ctx.BeaconCtx.BeaconTime.Seconds = SysTimeTicksToGps( nextBeacon ) - ( CLASSB_BEACON_INTERVAL / 1000 );
+    Ctx.BeaconCtx.BeaconTime.SubSeconds = 0;
+    Ctx.BeaconCtx.NextBeaconRx = SysTimeFromMs( currentTime + delay );
+    Ctx.BeaconCtx.BeaconTimingDelay = delay;
+    Ctx.BeaconCtx.AcquisitionRxError = rxError;
+    Ctx.BeaconCtx.Ctrl.BeaconDelaySet = 1;
+    return true;
+}
+
 /*!
  * \brief Calculates the correct frequency and opens up the beacon reception window.
  *
@@ -297,6 +698,10 @@ static void RxBeaconSetup( TimerTime_t rxTime, bool activateDefaultChannel )
     GetPhyParams_t getPhy;
     PhyParam_t phyParam;
     uint16_t windowTimeout = Ctx.BeaconCtx.SymbolTimeout;
+    uint32_t rxError = Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError;
+
+    // The beacon window reconfigures the radio
+    Ctx.SlotRxConfigValid = false;
 
     if( activateDefaultChannel == true )
     {
@@ -324,7 +729,20 @@ static void RxBeaconSetup( TimerTime_t rxTime, bool activateDefaultChannel )
         frequency = CalcDownlinkFrequency( Ctx.BeaconCtx.BeaconTimingChannel );
     }
 
-    if( ( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 ) || ( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 1 ) )
+    if( ( BeaconDriftIsValid( ) == true ) && ( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 0 ) )
+    {
+        // Size the window with the measured clock jitter, also in case
+        // of beacon loss
+        rxError = BeaconDriftGetRxError( );
+    }
+    else if( ( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 1 ) && ( Ctx.BeaconCtx.AcquisitionRxError > 0 ) )
+    {
+        // Size the acquisition window with the system time error
+        rxError = Ctx.BeaconCtx.AcquisitionRxError;
+    }
+
+    if( ( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 ) || ( Ctx.BeaconCtx.Ctrl.AcquisitionPending == 1 ) ||
+        ( BeaconDriftIsValid( ) == true ) )
     {
         // Apply the symbol timeout only if we have acquired the beacon
         // Otherwise, take the window enlargement into account
@@ -336,7 +754,7 @@ static void RxBeaconSetup( TimerTime_t rxTime, bool activateDefaultChannel )
         RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
                                         ( int8_t )phyParam.Value, // datarate
                                         Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
-                                        Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
+                                        rxError,
                                         &beaconRxConfig );
         windowTimeout = beaconRxConfig.WindowTimeout;
     }
@@ -346,6 +764,13 @@ static void RxBeaconSetup( TimerTime_t rxTime, bool activateDefaultChannel )
     rxBeaconSetup.Frequency = frequency;
 
     RegionRxBeaconSetup( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &rxBeaconSetup, &Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
+#ifdef LORAMAC_RADIO_TRACE_ENABLED
+    {
+        uint8_t record[2] = { LORAMAC_TRACE_SLOT_BEACON, Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate };
+
+        BinLogWrite( LORAMAC_TRACE_ID_RX_WINDOW, record, sizeof( record ) );
+    }
+#endif
 
     Ctx.LoRaMacClassBParams.MlmeIndication->BeaconInfo.Frequency = frequency;
     Ctx.LoRaMacClassBParams.MlmeIndication->BeaconInfo.Datarate = Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate;
@@ -397,6 +822,47 @@ static bool CalcNextSlotTime( uint16_t slotOffset, uint16_t pingPeriod, uint16_t
     return false;
 }
 
+/*!
+ * \brief Finds the first ping slot of an address which overlaps a time
+ *        interval. The ping slots of an address are periodic within the
+ *        beacon period.
+ *
+ * \param [IN] beaconStart Start of the beacon period
+ * \param [IN] slotOffset  The ping slot offset
+ * \param [IN] pingPeriod  The ping period
+ * \param [IN] pingNb      The number of ping slots in the beacon period
+ * \param [IN] start       Start of the interval
+ * \param [IN] end         End of the interval
+ *
+ * \retval End of the overlapping ping slot, 0 if no ping slot overlaps
+ */
+static TimerTime_t GetPingSlotOverlapEnd( TimerTime_t beaconStart, uint16_t slotOffset, uint16_t pingPeriod, uint8_t pingNb,
+                                          TimerTime_t start, TimerTime_t end )
+{
+    TimerTime_t firstSlot = beaconStart + CLASSB_BEACON_RESERVED + ( slotOffset * CLASSB_PING_SLOT_WINDOW );
+    TimerTime_t slotPeriod = ( TimerTime_t )pingPeriod * CLASSB_PING_SLOT_WINDOW;
+    TimerTime_t slotTime = 0;
+    uint32_t slot = 0;
+
+    if( slotPeriod == 0 )
+    {
+        return 0;
+    }
+
+    // First ping slot ending after the interval start
+    if( start >= ( firstSlot + CLASSB_PING_SLOT_WINDOW ) )
+    {
+        slot = ( ( start - firstSlot - CLASSB_PING_SLOT_WINDOW ) / slotPeriod ) + 1;
+    }
+    slotTime = firstSlot + ( slot * slotPeriod );
+
+    if( ( slot < pingNb ) && ( slotTime < end ) )
+    {
+        return slotTime + CLASSB_PING_SLOT_WINDOW;
+    }
+    return 0;
+}
+
 /*!
  * \brief Calculates CRC's of the beacon frame
  *
@@ -407,26 +873,13 @@ static bool CalcNextSlotTime( uint16_t slotOffset, uint16_t pingPeriod, uint16_t
  */
 static uint16_t BeaconCrc( uint8_t *buffer, uint16_t length )
 {
-    // The CRC calculation follows CCITT
-    const uint16_t polynom = 0x1021;
-    // CRC initial value
-    uint16_t crc = 0x0000;
-
     if( buffer == NULL )
     {
         return 0;
     }
 
-    for( uint16_t i = 0; i < length; ++i )
-    {
-        crc ^= ( uint16_t ) buffer[i] << 8;
-        for( uint16_t j = 0; j < 8; ++j )
-        {
-            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ polynom : ( crc << 1 );
-        }
-    }
-
-    return crc;
+    // The CRC calculation follows CCITT, 0x0000 initial value
+    return Crc16Update( 0x0000, buffer, length );
 }
 
 static void GetTemperatureLevel( LoRaMacClassBCallback_t *callbacks, BeaconContext_t *beaconCtx )
@@ -450,20 +903,35 @@ static void InitClassB( void )
     memset1( ( uint8_t* ) &NvmCtx, 0, sizeof( LoRaMacClassBNvmCtx_t ) );
     memset1( ( uint8_t* ) &Ctx.PingSlotCtx, 0, sizeof( PingSlotContext_t ) );
     memset1( ( uint8_t* ) &Ctx.BeaconCtx, 0, sizeof( BeaconContext_t ) );
+    memset1( ( uint8_t* ) Ctx.PingRand, 0, sizeof( Ctx.PingRand ) );
+    BeaconDriftReset( );
 
-    // Setup default temperature
+    // Setup default temperature. The sensor is only read once a beacon
+    // acquisition starts, which keeps it out of the MAC initialization.
     Ctx.BeaconCtx.Temperature = 25.0;
-    GetTemperatureLevel( &Ctx.LoRaMacClassBCallbacks, &Ctx.BeaconCtx );
 
     // Setup default ping slot datarate
     getPhy.Attribute = PHY_PING_SLOT_CHANNEL_DR;
     phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
     Ctx.NvmCtx->PingSlotCtx.Datarate = (int8_t)( phyParam.Value );
 
+    // Read the beacon channel plan, the downlink frequencies are computed from it
+    getPhy.Attribute = PHY_BEACON_CHANNEL_FREQ;
+    phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
+    Ctx.BeaconChannelFreq = phyParam.Value;
+
+    getPhy.Attribute = PHY_BEACON_CHANNEL_STEPWIDTH;
+    phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
+    Ctx.BeaconChannelStepwidth = phyParam.Value;
+
+    getPhy.Attribute = PHY_BEACON_NB_CHANNELS;
+    phyParam = RegionGetPhyParam( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &getPhy );
+    Ctx.BeaconNbChannels = ( uint8_t )phyParam.Value;
+
     // Setup default states
     Ctx.BeaconState = BEACON_STATE_ACQUISITION;
     Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
-    Ctx.MulticastSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
+    Ctx.SlotRxConfigValid = false;
 }
 
 static void InitClassBDefaults( void )
@@ -487,6 +955,18 @@ static void InitClassBDefaults( void )
 
 static void EnlargeWindowTimeout( void )
 {
+    if( BeaconDriftIsValid( ) == true )
+    {
+        // The beacon windows follow the estimated clock drift
+        Ctx.BeaconDrift.NbMissed++;
+        Ctx.BeaconCtx.BeaconWindowMovement = BeaconDriftGetRxError( );
+        Ctx.PingSlotCtx.SymbolTimeout += CLASSB_BEACON_SYMBOL_TO_DEFAULT;
+        if( Ctx.PingSlotCtx.SymbolTimeout > CLASSB_PING_SLOT_SYMBOL_TO_EXPANSION_MAX )
+        {
+            Ctx.PingSlotCtx.SymbolTimeout = CLASSB_PING_SLOT_SYMBOL_TO_EXPANSION_MAX;
+        }
+        return;
+    }
     // Update beacon movement
     Ctx.BeaconCtx.BeaconWindowMovement *= CLASSB_WINDOW_MOVE_EXPANSION_FACTOR;
     if( Ctx.BeaconCtx.BeaconWindowMovement > CLASSB_WINDOW_MOVE_EXPANSION_MAX )
@@ -511,6 +991,11 @@ static void ResetWindowTimeout( void )
     Ctx.BeaconCtx.SymbolTimeout = CLASSB_BEACON_SYMBOL_TO_DEFAULT;
     Ctx.PingSlotCtx.SymbolTimeout = CLASSB_BEACON_SYMBOL_TO_DEFAULT;
     Ctx.BeaconCtx.BeaconWindowMovement  = CLASSB_WINDOW_MOVE_DEFAULT;
+    if( BeaconDriftIsValid( ) == true )
+    {
+        // Open the beacon window only as early as the clock jitter requires
+        Ctx.BeaconCtx.BeaconWindowMovement = BeaconDriftGetRxError( );
+    }
 }
 
 static TimerTime_t CalcDelayForNextBeacon( TimerTime_t currentTime, TimerTime_t lastBeaconRx )
@@ -556,8 +1041,17 @@ static TimerTime_t UpdateBeaconState( LoRaMacEventInfoStatus_t status,
     beaconEventTime = CalcDelayForNextBeacon( currentTime, SysTimeToMs( Ctx.BeaconCtx.LastBeaconRx ) );
     Ctx.BeaconCtx.NextBeaconRx = SysTimeFromMs( currentTime + beaconEventTime );
 
-    // Take temperature compensation into account
-    beaconEventTime = TimerTempCompensation( beaconEventTime, Ctx.BeaconCtx.Temperature );
+    // Take temperature compensation or the estimated clock drift into account
+    beaconEventTime = BeaconTimeCompensation( beaconEventTime );
+    if( BeaconDriftIsValid( ) == true )
+    {
+        int32_t correction = BeaconDriftGetCorrection( );
+
+        if( ( correction > 0 ) || ( beaconEventTime > ( TimerTime_t )( -correction ) ) )
+        {
+            beaconEventTime += correction;
+        }
+    }
 
     // Move the window
     if( beaconEventTime > windowMovement )
@@ -617,7 +1111,6 @@ void LoRaMacClassBInit( LoRaMacClassBParams_t *classBParams, LoRaMacClassBCallba
     // Initialize timers
     TimerInit( &Ctx.BeaconTimer, LoRaMacClassBBeaconTimerEvent );
     TimerInit( &Ctx.PingSlotTimer, LoRaMacClassBPingSlotTimerEvent );
-    TimerInit( &Ctx.MulticastSlotTimer, LoRaMacClassBMulticastSlotTimerEvent );
 
     InitClassB( );
 #endif // LORAMAC_CLASSB_ENABLED
@@ -690,7 +1183,7 @@ void LoRaMacClassBSetPingSlotState( PingSlotState_t pingSlotState )
 void LoRaMacClassBSetMulticastSlotState( PingSlotState_t multicastSlotState )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
-    Ctx.MulticastSlotState = multicastSlotState;
+    Ctx.PingSlotState = multicastSlotState;
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
@@ -752,6 +1245,7 @@ static void LoRaMacClassBProcessBeacon( void )
             {
                 // Default symbol timeouts
                 ResetWindowTimeout( );
+                GetTemperatureLevel( &Ctx.LoRaMacClassBCallbacks, &Ctx.BeaconCtx );
 
                 if( Ctx.BeaconCtx.Ctrl.BeaconDelaySet == 1 )
                 {
@@ -760,6 +1254,11 @@ static void LoRaMacClassBProcessBeacon( void )
                         if( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) > currentTime )
                         {
                             beaconEventTime = TimerTempCompensation( SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) - currentTime, Ctx.BeaconCtx.Temperature );
+                            if( Ctx.BeaconCtx.AcquisitionRxError > 0 )
+                            {
+                                // Open the window early by the system time error
+                                beaconEventTime -= MIN( beaconEventTime - 1, Ctx.BeaconCtx.AcquisitionRxError + Radio.GetWakeupTime( ) );
+                            }
                         }
                         else
                         {
@@ -780,8 +1279,9 @@ static void LoRaMacClassBProcessBeacon( void )
                         Ctx.BeaconCtx.Ctrl.AcquisitionPending = 1;
 
                         // Don't use the default channel. We know on which
-                        // channel the next beacon will be transmitted
-                        RxBeaconSetup( CLASSB_BEACON_RESERVED, false );
+                        // channel the next beacon will be transmitted. The
+                        // window covers the error on both sides of the beacon.
+                        RxBeaconSetup( CLASSB_BEACON_RESERVED + ( 2 * Ctx.BeaconCtx.AcquisitionRxError ), false );
                     }
                 }
                 else
@@ -789,6 +1289,7 @@ static void LoRaMacClassBProcessBeacon( void )
                     Ctx.BeaconCtx.NextBeaconRx.Seconds = 0;
                     Ctx.BeaconCtx.NextBeaconRx.SubSeconds = 0;
                     Ctx.BeaconCtx.BeaconTimingDelay = 0;
+                    Ctx.BeaconCtx.AcquisitionRxError = 0;
 
                     Ctx.BeaconState = BEACON_STATE_ACQUISITION;
                 }
@@ -808,7 +1309,17 @@ static void LoRaMacClassBProcessBeacon( void )
             {
                 // Default symbol timeouts
                 ResetWindowTimeout( );
+                GetTemperatureLevel( &Ctx.LoRaMacClassBCallbacks, &Ctx.BeaconCtx );
 
+                if( SetupAcquisitionFromSysTime( currentTime ) == true )
+                {
+                    // The system time predicts the beacon. Open a window
+                    // around it instead of the continuous reception.
+                    Ctx.BeaconState = BEACON_STATE_ACQUISITION_BY_TIME;
+                    break;
+                }
+
+                Ctx.BeaconCtx.AcquisitionRxError = 0;
                 Ctx.BeaconCtx.Ctrl.AcquisitionPending = 1;
                 beaconEventTime = CLASSB_BEACON_INTERVAL;
 
@@ -866,7 +1377,8 @@ static void LoRaMacClassBProcessBeacon( void )
 
             // Handle beacon reception
             beaconEventTime = UpdateBeaconState( LORAMAC_EVENT_INFO_STATUS_BEACON_LOCKED,
-                                                 0, currentTime );
+                                                 ( BeaconDriftIsValid( ) == true ) ? Ctx.BeaconCtx.BeaconWindowMovement : 0,
+                                                 currentTime );
 
             // Setup the MLME confirm for the MLME_BEACON_ACQUISITION
             if( Ctx.LoRaMacClassBParams.LoRaMacFlags->Bits.MlmeReq == 1 )
@@ -893,7 +1405,7 @@ static void LoRaMacClassBProcessBeacon( void )
             {
                 Ctx.BeaconState = BEACON_STATE_GUARD;
                 beaconEventTime -= currentTime;
-                beaconEventTime = TimerTempCompensation( beaconEventTime, Ctx.BeaconCtx.Temperature );
+                beaconEventTime = BeaconTimeCompensation( beaconEventTime );
             }
             else
             {
@@ -968,241 +1480,196 @@ void LoRaMacClassBPingSlotTimerEvent( void* context )
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
-#ifdef LORAMAC_CLASSB_ENABLED
-static void LoRaMacClassBProcessPingSlot( void )
+void LoRaMacClassBMulticastSlotTimerEvent( void* context )
 {
-    static RxConfigParams_t pingSlotRxConfig;
-    TimerTime_t pingSlotTime = 0;
+    // The unicast and multicast slots share the same scheduler
+    LoRaMacClassBPingSlotTimerEvent( context );
+}
 
-    switch( Ctx.PingSlotState )
+#ifdef LORAMAC_CLASSB_ENABLED
+/*!
+ * \brief Gets the frequency and the datarate of a slot
+ *
+ * \param [IN]  multicastChannel Multicast channel of the slot, NULL for the
+ *                               unicast slot
+ * \param [OUT] frequency        Slot frequency
+ * \param [OUT] datarate         Slot datarate
+ */
+static void GetSlotRxParams( MulticastCtx_t *multicastChannel, uint32_t *frequency, int8_t *datarate )
+{
+    if( multicastChannel == NULL )
     {
-        case PINGSLOT_STATE_CALC_PING_OFFSET:
+        *frequency = Ctx.NvmCtx->PingSlotCtx.Frequency;
+        *datarate = Ctx.NvmCtx->PingSlotCtx.Datarate;
+
+        // Apply a custom frequency if the following bit is set
+        if( Ctx.NvmCtx->PingSlotCtx.Ctrl.CustomFreq == 0 )
         {
-            ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds,
-                               *Ctx.LoRaMacClassBParams.LoRaMacDevAddr,
-                               Ctx.NvmCtx->PingSlotCtx.PingPeriod,
-                               &( Ctx.PingSlotCtx.PingOffset ) );
-            Ctx.PingSlotState = PINGSLOT_STATE_SET_TIMER;
+            // Restore floor plan, computed once per beacon period
+            *frequency = GetPingRandEntry( Ctx.BeaconCtx.BeaconTime.Seconds, PING_RAND_UNICAST_INDEX,
+                                           *Ctx.LoRaMacClassBParams.LoRaMacDevAddr )->Frequency;
         }
-            // Intentional fall through
-        case PINGSLOT_STATE_SET_TIMER:
-        {
-            if( CalcNextSlotTime( Ctx.PingSlotCtx.PingOffset, Ctx.NvmCtx->PingSlotCtx.PingPeriod, Ctx.NvmCtx->PingSlotCtx.PingNb, &pingSlotTime ) == true )
-            {
-                if( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 )
-                {
-                    // Compute the symbol timeout. Apply it only, if the beacon is acquired
-                    // Otherwise, take the enlargement of the symbols into account.
-                    RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
-                                                     Ctx.NvmCtx->PingSlotCtx.Datarate,
-                                                     Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
-                                                     Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
-                                                     &pingSlotRxConfig );
-                    Ctx.PingSlotCtx.SymbolTimeout = pingSlotRxConfig.WindowTimeout;
-
-                    if( ( int32_t )pingSlotTime > pingSlotRxConfig.WindowOffset )
-                    {// Apply the window offset
-                        pingSlotTime += pingSlotRxConfig.WindowOffset;
-                    }
-                }
+    }
+    else
+    {
+        *frequency = multicastChannel->ChannelParams.RxParams.ClassB.Frequency;
+        *datarate = multicastChannel->ChannelParams.RxParams.ClassB.Datarate;
 
-                // Start the timer if the ping slot time is in range
-                Ctx.PingSlotState = PINGSLOT_STATE_IDLE;
-                TimerSetValue( &Ctx.PingSlotTimer, pingSlotTime );
-                TimerStart( &Ctx.PingSlotTimer );
-            }
-            break;
-        }
-        case PINGSLOT_STATE_IDLE:
+        // Restore the floor plan frequency if there is no individual frequency assigned
+        if( *frequency == 0 )
         {
-            uint32_t frequency = Ctx.NvmCtx->PingSlotCtx.Frequency;
+            *frequency = GetPingRandEntry( Ctx.BeaconCtx.BeaconTime.Seconds, 1 + ( multicastChannel - Ctx.LoRaMacClassBParams.MulticastChannels ),
+                                           multicastChannel->ChannelParams.Address )->Frequency;
+        }
+    }
+}
 
-            // Apply a custom frequency if the following bit is set
-            if( Ctx.NvmCtx->PingSlotCtx.Ctrl.CustomFreq == 0 )
-            {
-                // Restore floor plan
-                frequency = CalcDownlinkChannelAndFrequency( *Ctx.LoRaMacClassBParams.LoRaMacDevAddr, Ctx.BeaconCtx.BeaconTime.Seconds, CLASSB_BEACON_INTERVAL );
-            }
+/*!
+ * \brief Schedules the next slot of the merged unicast and multicast timeline
+ *
+ * \remark Slots of several addresses falling in the same ping slot window are
+ *         served by a single reception. Multicast slots have priority.
+ *
+ * \retval [true: slot scheduled, false: no slot left before the next beacon]
+ */
+static bool ScheduleNextSlot( void )
+{
+    MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
+    MulticastCtx_t *next = NULL;
+    TimerTime_t nextSlotTime = 0;
+    TimerTime_t slotTime = 0;
+    uint32_t nextSlotTimeUs = 0;
+    uint32_t frequency = 0;
+    int8_t datarate = 0;
+    bool found = false;
 
-            // Open the ping slot window only, if there is no multicast ping slot
-            // open. Multicast ping slots have always priority
-            if( Ctx.MulticastSlotState != PINGSLOT_STATE_RX )
+    // A slot only replaces the selected one when it starts at least one
+    // window earlier. The first multicast slot found wins for a given window.
+    if( cur != NULL )
+    {
+        for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++, cur++ )
+        {
+            if( ( cur->ChannelParams.IsEnabled == true ) && ( cur->ChannelParams.Class == CLASS_B ) &&
+                ( CalcNextSlotTime( cur->PingOffset, cur->PingPeriod, cur->PingNb, &slotTime ) == true ) )
             {
-                Ctx.PingSlotState = PINGSLOT_STATE_RX;
-
-                pingSlotRxConfig.Datarate = Ctx.NvmCtx->PingSlotCtx.Datarate;
-                pingSlotRxConfig.DownlinkDwellTime = Ctx.LoRaMacClassBParams.LoRaMacParams->DownlinkDwellTime;
-                pingSlotRxConfig.RepeaterSupport = Ctx.LoRaMacClassBParams.LoRaMacParams->RepeaterSupport;
-                pingSlotRxConfig.Frequency = frequency;
-                pingSlotRxConfig.RxContinuous = false;
-                pingSlotRxConfig.RxSlot = RX_SLOT_WIN_CLASS_B_PING_SLOT;
-
-                RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &pingSlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
-
-                if( pingSlotRxConfig.RxContinuous == false )
-                {
-                    Radio.Rx( Ctx.LoRaMacClassBParams.LoRaMacParams->MaxRxWindow );
-                }
-                else
+                if( ( found == false ) || ( ( slotTime + CLASSB_PING_SLOT_WINDOW ) <= nextSlotTime ) )
                 {
-                    Radio.Rx( 0 ); // Continuous mode
+                    nextSlotTime = slotTime;
+                    next = cur;
+                    found = true;
                 }
             }
-            else
-            {
-                // Multicast slots have priority. Skip Rx
-                Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
-                TimerSetValue( &Ctx.PingSlotTimer, CLASSB_PING_SLOT_WINDOW );
-                TimerStart( &Ctx.PingSlotTimer );
-            }
-            break;
         }
-        default:
+    }
+    if( ( Ctx.NvmCtx->PingSlotCtx.Ctrl.Assigned == 1 ) &&
+        ( CalcNextSlotTime( Ctx.PingSlotCtx.PingOffset, Ctx.NvmCtx->PingSlotCtx.PingPeriod, Ctx.NvmCtx->PingSlotCtx.PingNb, &slotTime ) == true ) )
+    {
+        if( ( found == false ) || ( ( slotTime + CLASSB_PING_SLOT_WINDOW ) <= nextSlotTime ) )
         {
-            Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
-            break;
+            nextSlotTime = slotTime;
+            next = NULL;
+            found = true;
         }
     }
-}
-#endif // LORAMAC_CLASSB_ENABLED
-
-void LoRaMacClassBMulticastSlotTimerEvent( void* context )
-{
-#ifdef LORAMAC_CLASSB_ENABLED
-    LoRaMacClassBEvents.Events.MulticastSlot = 1;
 
-    if( Ctx.LoRaMacClassBCallbacks.MacProcessNotify != NULL )
+    if( found == false )
     {
-        Ctx.LoRaMacClassBCallbacks.MacProcessNotify( );
+        return false;
     }
-#endif // LORAMAC_CLASSB_ENABLED
-}
 
-#ifdef LORAMAC_CLASSB_ENABLED
-static void LoRaMacClassBProcessMulticastSlot( void )
-{
-    static RxConfigParams_t multicastSlotRxConfig;
-    TimerTime_t multicastSlotTime = 0;
-    TimerTime_t slotTime = 0;
-    MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
+    GetSlotRxParams( next, &frequency, &datarate );
 
+    // The radio keeps its configuration from the previous slot when the next
+    // one directly follows it on the same channel
+    Ctx.SlotRxConfigReuse = ( Ctx.SlotRxConfigValid == true ) &&
+                            ( Ctx.SlotRxConfig.Frequency == frequency ) &&
+                            ( Ctx.SlotRxConfig.Datarate == datarate ) &&
+                            ( nextSlotTime <= CLASSB_PING_SLOT_WINDOW );
+    nextSlotTimeUs = nextSlotTime * 1000;
 
-    if( cur == NULL )
+    if( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 )
     {
-        return;
+        // Compute the symbol timeout. Apply it only, if the beacon is acquired
+        // Otherwise, take the enlargement of the symbols into account.
+        RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
+                                         datarate,
+                                         Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
+                                         Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
+                                         &Ctx.SlotRxConfig );
+        Ctx.PingSlotCtx.SymbolTimeout = Ctx.SlotRxConfig.WindowTimeout;
+
+        if( ( ( int32_t )nextSlotTimeUs + Ctx.SlotRxConfig.WindowOffsetUs ) > 0 )
+        {// Apply the window offset
+            nextSlotTimeUs += Ctx.SlotRxConfig.WindowOffsetUs;
+        }
     }
 
-    if( Ctx.MulticastSlotState == PINGSLOT_STATE_RX )
-    {
-        // A multicast slot is already open
-        return;
-    }
+    Ctx.PingSlotCtx.NextMulticastChannel = next;
+    Ctx.SlotRxConfig.Frequency = frequency;
+    Ctx.SlotRxConfig.Datarate = datarate;
+    Ctx.SlotRxConfig.DownlinkDwellTime = Ctx.LoRaMacClassBParams.LoRaMacParams->DownlinkDwellTime;
+    Ctx.SlotRxConfig.RepeaterSupport = Ctx.LoRaMacClassBParams.LoRaMacParams->RepeaterSupport;
+    Ctx.SlotRxConfig.RxContinuous = false;
+    Ctx.SlotRxConfig.RxSlot = ( next == NULL ) ? RX_SLOT_WIN_CLASS_B_PING_SLOT : RX_SLOT_WIN_CLASS_B_MULTICAST_SLOT;
+
+    // Start the timer if the ping slot time is in range
+    TimerStartTicks( &Ctx.PingSlotTimer, TimerUs2Ticks( nextSlotTimeUs ) );
+    return true;
+}
+
+static void LoRaMacClassBProcessPingSlot( void )
+{
+    MulticastCtx_t *cur = Ctx.LoRaMacClassBParams.MulticastChannels;
 
-    switch( Ctx.MulticastSlotState )
+    switch( Ctx.PingSlotState )
     {
         case PINGSLOT_STATE_CALC_PING_OFFSET:
         {
-            // Compute all offsets for every multicast slots
-            for( uint8_t i = 0; i < 4; i++ )
+            // Compute the offsets of every address
+            if( Ctx.NvmCtx->PingSlotCtx.Ctrl.Assigned == 1 )
             {
                 ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds,
-                                   cur->ChannelParams.Address,
-                                   cur->PingPeriod,
-                                   &( cur->PingOffset ) );
-                cur++;
+                                   PING_RAND_UNICAST_INDEX,
+                                   *Ctx.LoRaMacClassBParams.LoRaMacDevAddr,
+                                   Ctx.NvmCtx->PingSlotCtx.PingPeriod,
+                                   &( Ctx.PingSlotCtx.PingOffset ) );
             }
-            Ctx.MulticastSlotState = PINGSLOT_STATE_SET_TIMER;
-        }
-            // Intentional fall through
-        case PINGSLOT_STATE_SET_TIMER:
-        {
-            cur = Ctx.LoRaMacClassBParams.MulticastChannels;
-            Ctx.PingSlotCtx.NextMulticastChannel = NULL;
-
-            for( uint8_t i = 0; i < 4; i++ )
+            if( cur != NULL )
             {
-                // Calculate the next slot time for every multicast slot
-                if( CalcNextSlotTime( cur->PingOffset, cur->PingPeriod, cur->PingNb, &slotTime ) == true )
+                for( uint8_t i = 0; i < LORAMAC_MAX_MC_CTX; i++, cur++ )
                 {
-                    if( ( multicastSlotTime == 0 ) || ( multicastSlotTime > slotTime ) )
+                    if( ( cur->ChannelParams.IsEnabled == true ) && ( cur->ChannelParams.Class == CLASS_B ) )
                     {
-                        // Update the slot time and the next multicast channel
-                        multicastSlotTime = slotTime;
-                        Ctx.PingSlotCtx.NextMulticastChannel = cur;
+                        ComputePingOffset( Ctx.BeaconCtx.BeaconTime.Seconds,
+                                           1 + i,
+                                           cur->ChannelParams.Address,
+                                           cur->PingPeriod,
+                                           &( cur->PingOffset ) );
                     }
                 }
-                cur++;
             }
-
-            // Schedule the next multicast slot
-            if( Ctx.PingSlotCtx.NextMulticastChannel != NULL )
+            Ctx.PingSlotState = PINGSLOT_STATE_SET_TIMER;
+        }
+            // Intentional fall through
+        case PINGSLOT_STATE_SET_TIMER:
+        {
+            if( ScheduleNextSlot( ) == true )
             {
-                if( Ctx.BeaconCtx.Ctrl.BeaconAcquired == 1 )
-                {
-                    RegionComputeRxWindowParameters( *Ctx.LoRaMacClassBParams.LoRaMacRegion,
-                                                    Ctx.NvmCtx->PingSlotCtx.Datarate,
-                                                    Ctx.LoRaMacClassBParams.LoRaMacParams->MinRxSymbols,
-                                                    Ctx.LoRaMacClassBParams.LoRaMacParams->SystemMaxRxError,
-                                                    &multicastSlotRxConfig );
-                    Ctx.PingSlotCtx.SymbolTimeout = multicastSlotRxConfig.WindowTimeout;
-                }
-
-                if( ( int32_t )multicastSlotTime > multicastSlotRxConfig.WindowOffset )
-                {// Apply the window offset
-                    multicastSlotTime += multicastSlotRxConfig.WindowOffset;
-                }
-
-                // Start the timer if the ping slot time is in range
-                Ctx.MulticastSlotState = PINGSLOT_STATE_IDLE;
-                TimerSetValue( &Ctx.MulticastSlotTimer, multicastSlotTime );
-                TimerStart( &Ctx.MulticastSlotTimer );
+                Ctx.PingSlotState = PINGSLOT_STATE_IDLE;
             }
             break;
         }
         case PINGSLOT_STATE_IDLE:
         {
-            uint32_t frequency = 0;
-
-            // Verify if the multicast channel is valid
-            if( Ctx.PingSlotCtx.NextMulticastChannel == NULL )
-            {
-                Ctx.MulticastSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
-                TimerSetValue( &Ctx.MulticastSlotTimer, 1 );
-                TimerStart( &Ctx.MulticastSlotTimer );
-                break;
-            }
-
-            // Apply frequency
-            frequency = Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.RxParams.ClassB.Frequency;
-
-            // Restore the floor plan frequency if there is no individual frequency assigned
-            if( frequency == 0 )
-            {
-                // Restore floor plan
-                frequency = CalcDownlinkChannelAndFrequency( Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.Address, Ctx.BeaconCtx.BeaconTime.Seconds, CLASSB_BEACON_INTERVAL );
-            }
-
-            Ctx.MulticastSlotState = PINGSLOT_STATE_RX;
-
-            multicastSlotRxConfig.Datarate = Ctx.PingSlotCtx.NextMulticastChannel->ChannelParams.RxParams.ClassB.Datarate;
-            multicastSlotRxConfig.DownlinkDwellTime = Ctx.LoRaMacClassBParams.LoRaMacParams->DownlinkDwellTime;
-            multicastSlotRxConfig.RepeaterSupport = Ctx.LoRaMacClassBParams.LoRaMacParams->RepeaterSupport;
-            multicastSlotRxConfig.Frequency = frequency;
-            multicastSlotRxConfig.RxContinuous = false;
-            multicastSlotRxConfig.RxSlot = RX_SLOT_WIN_CLASS_B_MULTICAST_SLOT;
-
-            RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &multicastSlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
+            Ctx.PingSlotState = PINGSLOT_STATE_RX;
 
-            if( Ctx.PingSlotState == PINGSLOT_STATE_RX )
+            if( Ctx.SlotRxConfigReuse == false )
             {
-                // Close ping slot window, if necessary. Multicast slots have priority
-                Radio.Standby( );
-                Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
-                TimerSetValue( &Ctx.PingSlotTimer, CLASSB_PING_SLOT_WINDOW );
-                TimerStart( &Ctx.PingSlotTimer );
+                RegionRxConfig( *Ctx.LoRaMacClassBParams.LoRaMacRegion, &Ctx.SlotRxConfig, ( int8_t* )&Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate );
+                Ctx.SlotRxConfigValid = true;
             }
 
-            if( multicastSlotRxConfig.RxContinuous == false )
+            if( Ctx.SlotRxConfig.RxContinuous == false )
             {
                 Radio.Rx( Ctx.LoRaMacClassBParams.LoRaMacParams->MaxRxWindow );
             }
@@ -1210,18 +1677,25 @@ static void LoRaMacClassBProcessMulticastSlot( void )
             {
                 Radio.Rx( 0 ); // Continuous mode
             }
+#ifdef LORAMAC_RADIO_TRACE_ENABLED
+            {
+                uint8_t record[2] = { Ctx.SlotRxConfig.RxSlot, Ctx.LoRaMacClassBParams.McpsIndication->RxDatarate };
+
+                BinLogWrite( LORAMAC_TRACE_ID_RX_WINDOW, record, sizeof( record ) );
+            }
+#endif
             break;
         }
         default:
         {
-            Ctx.MulticastSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
+            Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
             break;
         }
     }
 }
 #endif // LORAMAC_CLASSB_ENABLED
 
-bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
+bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size, TimerTime_t lastRxDone )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
     GetPhyParams_t getPhy;
@@ -1287,11 +1761,20 @@ bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size )
                 timeOnAir.Seconds = time / 1000;
                 timeOnAir.SubSeconds = time - timeOnAir.Seconds * 1000;
 
+                // Time elapsed since the reception of the beacon
+                time = TimerGetElapsedTime( lastRxDone );
+                SysTime_t latency;
+                latency.Seconds = time / 1000;
+                latency.SubSeconds = time - latency.Seconds * 1000;
+
                 Ctx.BeaconCtx.LastBeaconRx = Ctx.BeaconCtx.BeaconTime;
                 Ctx.BeaconCtx.LastBeaconRx.Seconds += UNIX_GPS_EPOCH_OFFSET;
 
+                // Measure the local clock error before the synchronization
+                BeaconDriftAddSample( SysTimeSub( SysTimeGet( ), latency ), SysTimeAdd( Ctx.BeaconCtx.LastBeaconRx, timeOnAir ) );
+
                 // Update system time.
-                SysTimeSet( SysTimeAdd( Ctx.BeaconCtx.LastBeaconRx, timeOnAir ) );
+                SysTimeSet( SysTimeAdd( SysTimeAdd( Ctx.BeaconCtx.LastBeaconRx, timeOnAir ), latency ) );
 
                 Ctx.BeaconCtx.Ctrl.BeaconAcquired = 1;
                 Ctx.BeaconCtx.Ctrl.BeaconMode = 1;
@@ -1339,7 +1822,7 @@ bool LoRaMacClassBIsBeaconExpected( void )
 bool LoRaMacClassBIsPingExpected( void )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
-    if( Ctx.PingSlotState == PINGSLOT_STATE_RX )
+    if( ( Ctx.PingSlotState == PINGSLOT_STATE_RX ) && ( Ctx.PingSlotCtx.NextMulticastChannel == NULL ) )
     {
         return true;
     }
@@ -1352,7 +1835,7 @@ bool LoRaMacClassBIsPingExpected( void )
 bool LoRaMacClassBIsMulticastExpected( void )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
-    if( Ctx.MulticastSlotState == PINGSLOT_STATE_RX )
+    if( ( Ctx.PingSlotState == PINGSLOT_STATE_RX ) && ( Ctx.PingSlotCtx.NextMulticastChannel != NULL ) )
     {
         return true;
     }
@@ -1600,6 +2083,7 @@ void LoRaMacClassBBeaconTimingAns( uint16_t beaconTimingDelay, uint8_t beaconTim
             Ctx.BeaconCtx.Ctrl.BeaconDelaySet = 1;
             Ctx.BeaconCtx.Ctrl.BeaconChannelSet = 1;
             Ctx.BeaconCtx.NextBeaconRx = SysTimeFromMs( lastRxDone + Ctx.BeaconCtx.BeaconTimingDelay );
+            Ctx.BeaconCtx.AcquisitionRxError = 0;
             LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_BEACON_TIMING );
         }
 
@@ -1616,8 +2100,7 @@ void LoRaMacClassBDeviceTimeAns( void )
     SysTime_t nextBeacon = SysTimeGet( );
     uint32_t currentTimeMs = SysTimeToMs( nextBeacon );
 
-    nextBeacon.Seconds = nextBeacon.Seconds + ( 128 - ( nextBeacon.Seconds % 128 ) );
-    nextBeacon.SubSeconds = 0;
+    nextBeacon = SysTimeTicksToSysTime( SysTimeTicksNextGpsPeriod( SysTimeTicksFromSysTime( nextBeacon ), CLASSB_BEACON_INTERVAL / 1000 ) );
 
     Ctx.BeaconCtx.NextBeaconRx = nextBeacon;
     Ctx.BeaconCtx.LastBeaconRx = SysTimeSub( Ctx.BeaconCtx.NextBeaconRx, ( SysTime_t ){ .Seconds = CLASSB_BEACON_INTERVAL / 1000, .SubSeconds = 0 } );
@@ -1633,12 +2116,18 @@ void LoRaMacClassBDeviceTimeAns( void )
             Ctx.BeaconCtx.NextBeaconRx.SubSeconds = 0;
             LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_BEACON_NOT_FOUND, MLME_DEVICE_TIME );
         }
+        else if( SetupAcquisitionFromSysTime( TimerGetCurrentTime( ) ) == true )
+        {
+            // The acquisition window is placed on the fresh system time
+            LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_DEVICE_TIME );
+        }
         else
         {
             Ctx.BeaconCtx.Ctrl.BeaconDelaySet = 1;
             Ctx.BeaconCtx.BeaconTimingDelay = SysTimeToMs( Ctx.BeaconCtx.NextBeaconRx ) - currentTimeMs;
             Ctx.BeaconCtx.BeaconTime.Seconds = nextBeacon.Seconds - UNIX_GPS_EPOCH_OFFSET - 128;
             Ctx.BeaconCtx.BeaconTime.SubSeconds = 0;
+            Ctx.BeaconCtx.AcquisitionRxError = 0;
             LoRaMacConfirmQueueSetStatus( LORAMAC_EVENT_INFO_STATUS_OK, MLME_DEVICE_TIME );
         }
     }
@@ -1698,16 +2187,76 @@ TimerTime_t LoRaMacClassBIsUplinkCollision( TimerTime_t txTimeOnAir )
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
+TimerTime_t LoRaMacClassBGetUplinkShift( TimerTime_t txTimeOnAir )
+{
+#ifdef LORAMAC_CLASSB_ENABLED
+    MulticastCtx_t *cur = NULL;
+    TimerTime_t currentTime = TimerGetCurrentTime( );
+    TimerTime_t beaconStart = currentTime - ( ( currentTime - SysTimeToMs( Ctx.BeaconCtx.LastBeaconRx ) ) % CLASSB_BEACON_INTERVAL );
+    // The uplink keeps the radio busy up to its RX2 window
+    TimerTime_t duration = txTimeOnAir +
+                           Ctx.LoRaMacClassBParams.LoRaMacParams->ReceiveDelay1 +
+                           Ctx.LoRaMacClassBParams.LoRaMacParams->ReceiveDelay2 +
+                           Radio.GetWakeupTime( );
+    TimerTime_t limit = MIN( currentTime + CLASSB_UPLINK_SHIFT_MAX,
+                             beaconStart + CLASSB_BEACON_INTERVAL - CLASSB_BEACON_GUARD );
+    TimerTime_t start = currentTime;
+    TimerTime_t overlapEnd = 0;
+    bool overlap = true;
+
+    // Each step moves the uplink after the earliest overlapping ping slot
+    while( overlap == true )
+    {
+        if( ( start + duration ) > limit )
+        {
+            // No gap, the uplink isn't delayed
+            return 0;
+        }
+        overlap = false;
+
+        if( Ctx.NvmCtx->PingSlotCtx.Ctrl.Assigned == 1 )
+        {
+            overlapEnd = GetPingSlotOverlapEnd( beaconStart, Ctx.PingSlotCtx.PingOffset, Ctx.NvmCtx->PingSlotCtx.PingPeriod,
+                                                Ctx.NvmCtx->PingSlotCtx.PingNb, start, start + duration );
+            if( overlapEnd > 0 )
+            {
+                start = overlapEnd;
+                overlap = true;
+            }
+        }
+
+        cur = Ctx.LoRaMacClassBParams.MulticastChannels;
+        for( uint8_t i = 0; ( cur != NULL ) && ( i < LORAMAC_MAX_MC_CTX ); i++, cur++ )
+        {
+            if( ( cur->ChannelParams.IsEnabled == true ) && ( cur->ChannelParams.Class == CLASS_B ) )
+            {
+                overlapEnd = GetPingSlotOverlapEnd( beaconStart, cur->PingOffset, cur->PingPeriod, cur->PingNb,
+                                                    start, start + duration );
+                if( overlapEnd > 0 )
+                {
+                    start = overlapEnd;
+                    overlap = true;
+                }
+            }
+        }
+    }
+    return start - currentTime;
+#else
+    return 0;
+#endif // LORAMAC_CLASSB_ENABLED
+}
+
 void LoRaMacClassBStopRxSlots( void )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
     TimerStop( &Ctx.PingSlotTimer );
-    TimerStop( &Ctx.MulticastSlotTimer );
 
     CRITICAL_SECTION_BEGIN( );
     LoRaMacClassBEvents.Events.PingSlot = 0;
-    LoRaMacClassBEvents.Events.MulticastSlot = 0;
     CRITICAL_SECTION_END( );
+
+    // The radio is used by other windows until the slots are restarted
+    Ctx.SlotRxConfigValid = false;
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
@@ -1719,10 +2268,19 @@ void LoRaMacClassBStartRxSlots( void )
         Ctx.PingSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
         TimerSetValue( &Ctx.PingSlotTimer, 1 );
         TimerStart( &Ctx.PingSlotTimer );
+    }
+#endif // LORAMAC_CLASSB_ENABLED
+}
 
-        Ctx.MulticastSlotState = PINGSLOT_STATE_CALC_PING_OFFSET;
-        TimerSetValue( &Ctx.MulticastSlotTimer, 1 );
-        TimerStart( &Ctx.MulticastSlotTimer );
+void LoRaMacClassBSwitchRegion( void )
+{
+#ifdef LORAMAC_CLASSB_ENABLED
+    // The parameters received from the previous region network don't apply
+    InitClassB( );
+
+    if( Ctx.LoRaMacClassBNvmEvent != NULL )
+    {
+        Ctx.LoRaMacClassBNvmEvent( );
     }
 #endif // LORAMAC_CLASSB_ENABLED
 }
@@ -1738,15 +2296,21 @@ void LoRaMacClassBSetMulticastPeriodicity( MulticastCtx_t* multicastChannel )
 #endif // LORAMAC_CLASSB_ENABLED
 }
 
+bool LoRaMacClassBHasPendingEvents( void )
+{
+#ifdef LORAMAC_CLASSB_ENABLED
+    return ( LoRaMacClassBEvents.Value != 0 );
+#else
+    return false;
+#endif // LORAMAC_CLASSB_ENABLED
+}
+
 void LoRaMacClassBProcess( void )
 {
 #ifdef LORAMAC_CLASSB_ENABLED
     LoRaMacClassBEvents_t events;
 
-    CRITICAL_SECTION_BEGIN( );
-    events = LoRaMacClassBEvents;
-    LoRaMacClassBEvents.Value = 0;
-    CRITICAL_SECTION_END( );
+    events.Value = AtomicFetchAndClear( &LoRaMacClassBEvents.Value );
 
     if( events.Value != 0 )
     {
@@ -1758,10 +2322,11 @@ void LoRaMacClassBProcess( void )
         {
             LoRaMacClassBProcessPingSlot( );
         }
-        if( events.Events.MulticastSlot == 1 )
-        {
-            LoRaMacClassBProcessMulticastSlot( );
-        }
+    }
+    else if( Ctx.BeaconCtx.Ctrl.BeaconMode == 1 )
+    {
+        // Use the idle time to prepare the next beacon period
+        PrecomputePingOffsets( );
     }
 #endif // LORAMAC_CLASSB_ENABLED
 }
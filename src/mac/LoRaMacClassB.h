@@ -136,7 +136,8 @@ typedef struct sPingSlotContext
      */
     uint16_t SymbolTimeout;
     /*!
-     * The multicast channel which will be enabled next.
+     * The multicast channel which will be enabled next. NULL if the next
+     * slot is the unicast one.
      */
     MulticastCtx_t *NextMulticastChannel;
 }PingSlotContext_t;
@@ -214,6 +215,11 @@ typedef struct sBeaconContext
      * Delay for next beacon in ms
      */
     TimerTime_t BeaconTimingDelay;
+    /*!
+     * RX error in ms of the acquisition window predicted from the system
+     * time. 0 when the acquisition isn't based on the system time.
+     */
+    uint32_t AcquisitionRxError;
     TimerTime_t TimeStamp;
 }BeaconContext_t;
 
@@ -326,6 +332,8 @@ void LoRaMacClassBSetPingSlotState( PingSlotState_t pingSlotState );
 /*!
  * \brief Set the state of the multicast slot state machine
  *
+ * \remark The unicast and multicast slots share the same state machine.
+ *
  * \param [IN] pingSlotState multicast slot state.
  */
 void LoRaMacClassBSetMulticastSlotState( PingSlotState_t multicastSlotState );
@@ -344,11 +352,15 @@ void LoRaMacClassBBeaconTimerEvent( void* context );
 
 /*!
  * \brief State machine of the Class B for ping slots
+ *
+ * \remark A single timer schedules the unicast and multicast slots in time
+ *         order.
  */
 void LoRaMacClassBPingSlotTimerEvent( void* context );
 
 /*!
- * \brief State machine of the Class B for multicast slots
+ * \brief State machine of the Class B for multicast slots. Same as
+ *        \ref LoRaMacClassBPingSlotTimerEvent
  */
 void LoRaMacClassBMulticastSlotTimerEvent( void* context );
 
@@ -357,9 +369,10 @@ void LoRaMacClassBMulticastSlotTimerEvent( void* context );
  *
  * \param [IN] payload Pointer to the payload
  * \param [IN] size Size of the payload
+ * \param [IN] lastRxDone The time of the last frame reception
  * \retval [true, if the node has received a beacon; false, if not]
  */
-bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size );
+bool LoRaMacClassBRxBeacon( uint8_t *payload, uint16_t size, TimerTime_t lastRxDone );
 
 /*!
  * \brief The function validates, if the node expects a beacon
@@ -503,6 +516,19 @@ bool LoRaMacClassBBeaconFreqReq( uint32_t frequency );
  */
 TimerTime_t LoRaMacClassBIsUplinkCollision( TimerTime_t txTimeOnAir );
 
+/*!
+ * \brief Computes the delay which moves the next uplink and its RX windows
+ *        into the first gap between the unicast and multicast ping slots of
+ *        the current beacon period
+ *
+ * \param [IN] txTimeOnAir TX time on air for the next uplink
+ *
+ * \retval Returns the time the uplink should be delayed. 0 if the uplink
+ *         doesn't overlap a ping slot, or if no gap is found before the
+ *         beacon guard or within \ref CLASSB_UPLINK_SHIFT_MAX.
+ */
+TimerTime_t LoRaMacClassBGetUplinkShift( TimerTime_t txTimeOnAir );
+
 /*!
  * \brief Stops the timers for the RX slots. This includes the
  *        timers for ping and multicast slots.
@@ -515,6 +541,12 @@ void LoRaMacClassBStopRxSlots( void );
  */
 void LoRaMacClassBStartRxSlots( void );
 
+/*!
+ * \brief Resets the Class B context to the defaults of the region which
+ *        has been switched to. The beacon channel plan is read again.
+ */
+void LoRaMacClassBSwitchRegion( void );
+
 /*!
  * \brief Starts the timers for the RX slots. This includes the
  *        timers for ping and multicast slots.
@@ -525,6 +557,14 @@ void LoRaMacClassBStartRxSlots( void );
  */
 void LoRaMacClassBSetMulticastPeriodicity( MulticastCtx_t* multicastChannel );
 
+/*!
+ * \brief Verifies if a class B event is waiting to be processed by
+ *        \ref LoRaMacClassBProcess
+ *
+ * \retval [true, if an event is pending; false, if not]
+ */
+bool LoRaMacClassBHasPendingEvents( void );
+
 void LoRaMacClassBProcess( void );
 
 #endif // __LORAMACCLASSB_H__
@@ -112,4 +112,57 @@
  */
 #define CLASSB_WINDOW_MOVE_EXPANSION_FACTOR         2
 
+/*!
+ * Number of beacon receptions the clock drift estimation is based on
+ */
+#define CLASSB_DRIFT_NB_SAMPLES                     8
+
+/*!
+ * Number of beacon receptions after which the clock drift estimation
+ * replaces the window expansion
+ */
+#define CLASSB_DRIFT_MIN_SAMPLES                    3
+
+/*!
+ * Defines the minimum RX error in ms of the windows sized by the clock
+ * drift estimation
+ */
+#define CLASSB_DRIFT_RX_ERROR_MIN                   2
+
+/*!
+ * Defines the maximum clock drift in ppm. A larger drift restarts the
+ * clock drift estimation.
+ */
+#define CLASSB_DRIFT_MAX_PPM                        100
+
+/*!
+ * Defines the RX error in ms of the system time right after its
+ * synchronization. Covers the DeviceTimeAns resolution.
+ */
+#define CLASSB_TIME_SYNC_RX_ERROR_MIN               8
+
+/*!
+ * Defines the maximum RX error in ms of an acquisition window predicted from
+ * the system time. A larger error falls back to the continuous acquisition.
+ */
+#define CLASSB_TIME_SYNC_RX_ERROR_MAX               1000
+
+/*!
+ * Defines the clock error in ppm assumed since the last system time
+ * synchronization
+ */
+#define CLASSB_TIME_SYNC_PPM                        40
+
+/*!
+ * Defines the clock error in ppm assumed since the last system time
+ * synchronization, when the clock drift is compensated
+ */
+#define CLASSB_TIME_SYNC_DISCIPLINED_PPM            5
+
+/*!
+ * Defines the maximum time in ms an uplink is delayed to avoid the ping
+ * slots. 0 disables the delay.
+ */
+#define CLASSB_UPLINK_SHIFT_MAX                     8000
+
 #endif // __LORAMACCLASSBCONFIG_H__
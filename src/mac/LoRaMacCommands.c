@@ -25,13 +25,32 @@ Maintainer: Miguel Luis ( Semtech ), Daniel Jaeckle ( STACKFORCE ), Johannes Bru
 /*!
  * Number of MAC Command slots
  */
+#ifndef NUM_OF_MAC_COMMANDS
 #define NUM_OF_MAC_COMMANDS 15
+#endif
+
+#if ( NUM_OF_MAC_COMMANDS > 32 )
+#error "The FOpts packing handles up to 32 MAC commands"
+#endif
 
 /*!
  * Size of the CID field of MAC commands
  */
 #define CID_FIELD_SIZE 1
 
+/*!
+ * Maximum size of the FOpts field
+ */
+#define FOPTS_MAX_SIZE 15
+
+/*!
+ * Ranks of the MAC commands, by decreasing urgency
+ */
+#define MAC_CMD_RANK_STICKY_ANS 0
+#define MAC_CMD_RANK_ANS        1
+#define MAC_CMD_RANK_REQ        2
+#define MAC_CMD_NB_RANKS        3
+
 /*!
  *  Mac Commands list structure
  */
@@ -60,6 +79,11 @@ typedef struct sLoRaMacCommandsCtx
      * Buffer to store MAC command elements
      */
     MacCommand_t MacCommandSlots[NUM_OF_MAC_COMMANDS];
+    /*
+     * First free element of MacCommandSlots. The free elements are linked
+     * through their Next field.
+     */
+    MacCommand_t* FreeSlots;
     /*
      * Size of all MAC commands serialized as buffer
      */
@@ -79,23 +103,16 @@ static LoRaMacCommandsCtx_t NvmCtx;
 /* Memory management functions */
 
 /*!
- * \brief Determines if a MAC command slot is free
- *
- * \param[IN]     slot           - Slot to check
- * \retval                       - Status of the operation
+ * \brief Links all MAC command slots into the free list
  */
-static bool IsSlotFree( const MacCommand_t* slot )
+static void InitMacCommandSlots( void )
 {
-    uint8_t* mem = ( uint8_t* )slot;
-
-    for( uint16_t size = 0; size < sizeof( MacCommand_t ); size++ )
+    NvmCtx.FreeSlots = 0;
+    for( uint8_t itr = NUM_OF_MAC_COMMANDS; itr > 0; itr-- )
     {
-        if( mem[size] != 0x00 )
-        {
-            return false;
-        }
+        NvmCtx.MacCommandSlots[itr - 1].Next = NvmCtx.FreeSlots;
+        NvmCtx.FreeSlots = &NvmCtx.MacCommandSlots[itr - 1];
     }
-    return true;
 }
 
 /*!
@@ -105,18 +122,14 @@ static bool IsSlotFree( const MacCommand_t* slot )
  */
 static MacCommand_t* MallocNewMacCommandSlot( void )
 {
-    uint8_t itr = 0;
+    MacCommand_t* slot = NvmCtx.FreeSlots;
 
-    while( IsSlotFree( ( const MacCommand_t* )&NvmCtx.MacCommandSlots[itr] ) == false )
+    if( slot != 0 )
     {
-        itr++;
-        if( itr == NUM_OF_MAC_COMMANDS )
-        {
-            return 0;
-        }
+        NvmCtx.FreeSlots = slot->Next;
+        slot->Next = 0;
     }
-
-    return &NvmCtx.MacCommandSlots[itr];
+    return slot;
 }
 
 /*!
@@ -135,6 +148,10 @@ static bool FreeMacCommandSlot( MacCommand_t* slot )
 
     memset1( ( uint8_t* )slot, 0x00, sizeof( MacCommand_t ) );
 
+    // Put it back at the head of the free list
+    slot->Next = NvmCtx.FreeSlots;
+    NvmCtx.FreeSlots = slot;
+
     return true;
 }
 
@@ -168,7 +185,7 @@ static bool LinkedListInit( MacCommandsList_t* list )
  */
 static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
 {
-    if( ( list == 0 ) && ( element == 0 ) )
+    if( ( list == 0 ) || ( element == 0 ) )
     {
         return false;
     }
@@ -185,7 +202,8 @@ static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
         list->Last->Next = element;
     }
 
-    // Update the next point of this entry.
+    // Update the links of this entry.
+    element->Prev = list->Last;
     element->Next = 0;
 
     // Update the last entry of the list.
@@ -194,42 +212,6 @@ static bool LinkedListAdd( MacCommandsList_t* list, MacCommand_t* element )
     return true;
 }
 
-/*!
- * \brief Return the previous element in the list.
- *
- * \param[IN]     list           - List
- * \param[IN]     element        - Element where the previous element shall be searched
- * \retval                       - Status of the operation
- */
-static MacCommand_t* LinkedListGetPrevious( MacCommandsList_t* list, MacCommand_t* element )
-{
-    if( ( list == 0 ) && ( element == 0 ) )
-    {
-        return NULL;
-    }
-
-    MacCommand_t* curElement;
-
-    // Start at the head of the list
-    curElement = list->First;
-
-    // When current element is the first of the list, there's no previous element so we can return NULL immediately.
-    if( element != curElement )
-    {
-        // Loop through all elements until the end is reached or the next of current is the current element.
-        while( ( curElement != NULL ) && ( curElement->Next != element ) )
-        {
-            curElement = curElement->Next;
-        }
-    }
-    else
-    {
-        curElement = NULL;
-    }
-
-    return curElement;
-}
-
 /*!
  * \brief Remove an element from the list
  *
@@ -239,29 +221,36 @@ static MacCommand_t* LinkedListGetPrevious( MacCommandsList_t* list, MacCommand_
  */
 static bool LinkedListRemove( MacCommandsList_t* list, MacCommand_t* element )
 {
-    if( ( list == 0 ) && ( element == 0 ) )
+    if( ( list == 0 ) || ( element == 0 ) )
     {
         return false;
     }
 
-    MacCommand_t* PrevElement = LinkedListGetPrevious( list, element );
-
     if( list->First == element )
     {
         list->First = element->Next;
     }
+    else if( element->Prev != NULL )
+    {
+        element->Prev->Next = element->Next;
+    }
+    else
+    {
+        // Not part of the list
+        return false;
+    }
 
     if( list->Last == element )
     {
-        list->Last = PrevElement;
+        list->Last = element->Prev;
     }
-
-    if( PrevElement != NULL )
+    else
     {
-        PrevElement->Next = element->Next;
+        element->Next->Prev = element->Prev;
     }
 
     element->Next = NULL;
+    element->Prev = NULL;
 
     return true;
 }
@@ -286,6 +275,49 @@ static bool IsSticky( uint8_t cid )
     }
 }
 
+/*
+ * \brief Ranks a MAC command by urgency. The sticky answers are repeated until
+ *        a downlink is received, the other answers are expected in the next
+ *        uplink and the requests of the end-device may wait.
+ *
+ * \param[IN]   cid                - MAC command identifier
+ *
+ * \retval                     - Rank of the MAC command
+ */
+static uint8_t GetRank( uint8_t cid )
+{
+    if( IsSticky( cid ) == true )
+    {
+        return MAC_CMD_RANK_STICKY_ANS;
+    }
+    switch( cid )
+    {
+        case MOTE_MAC_LINK_CHECK_REQ:
+        case MOTE_MAC_DEVICE_TIME_REQ:
+        case MOTE_MAC_PING_SLOT_INFO_REQ:
+        case MOTE_MAC_BEACON_TIMING_REQ:
+            return MAC_CMD_RANK_REQ;
+        default:
+            return MAC_CMD_RANK_ANS;
+    }
+}
+
+/*
+ * \brief Serializes a MAC command
+ *
+ * \param[IN]   macCmd             - MAC command
+ * \param[out]  buffer             - Destination data buffer
+ *
+ * \retval                     - Size of the serialized command
+ */
+static uint8_t SerializeCmd( MacCommand_t* macCmd, uint8_t* buffer )
+{
+    buffer[0] = macCmd->CID;
+    memcpy1( &buffer[CID_FIELD_SIZE], macCmd->Payload, macCmd->PayloadSize );
+    macCmd->IsPacked = true;
+    return CID_FIELD_SIZE + macCmd->PayloadSize;
+}
+
 /*
  * \brief Wrapper function for the NvmCtx
  */
@@ -303,6 +335,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsInit( LoRaMacCommandsNvmEvent commandsNvmC
     memset1( ( uint8_t* )&NvmCtx, 0, sizeof( NvmCtx ) );
 
     LinkedListInit( &NvmCtx.MacCommandList );
+    InitMacCommandSlots( );
 
     // Assign callback
     CommandsNvmCtxChanged = commandsNvmCtxChanged;
@@ -357,6 +390,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsAddCmd( uint8_t cid, uint8_t* payload, siz
     newCmd->PayloadSize = payloadSize;
     memcpy1( ( uint8_t* )newCmd->Payload, payload, payloadSize );
     newCmd->IsSticky = IsSticky( cid );
+    newCmd->IsPacked = false;
 
     NvmCtx.SerializedCmdsSize += ( CID_FIELD_SIZE + payloadSize );
 
@@ -365,6 +399,47 @@ LoRaMacCommandStatus_t LoRaMacCommandsAddCmd( uint8_t cid, uint8_t* payload, siz
     return LORAMAC_COMMANDS_SUCCESS;
 }
 
+LoRaMacCommandStatus_t LoRaMacCommandsAddCmds( const MacCommand_t* cmds, uint8_t nbCmds )
+{
+    LoRaMacCommandStatus_t status = LORAMAC_COMMANDS_SUCCESS;
+    uint8_t i = 0;
+
+    if( cmds == 0 )
+    {
+        return LORAMAC_COMMANDS_ERROR_NPE;
+    }
+
+    for( i = 0; i < nbCmds; i++ )
+    {
+        MacCommand_t* newCmd = MallocNewMacCommandSlot( );
+
+        if( newCmd == 0 )
+        {
+            status = LORAMAC_COMMANDS_ERROR_MEMORY;
+            break;
+        }
+
+        // Add it to the list of Mac commands
+        LinkedListAdd( &NvmCtx.MacCommandList, newCmd );
+
+        // Set Values
+        newCmd->CID = cmds[i].CID;
+        newCmd->PayloadSize = cmds[i].PayloadSize;
+        memcpy1( ( uint8_t* )newCmd->Payload, cmds[i].Payload, cmds[i].PayloadSize );
+        newCmd->IsSticky = IsSticky( cmds[i].CID );
+        newCmd->IsPacked = false;
+
+        NvmCtx.SerializedCmdsSize += ( CID_FIELD_SIZE + cmds[i].PayloadSize );
+    }
+
+    if( i > 0 )
+    {
+        NvmCtxCallback( );
+    }
+
+    return status;
+}
+
 LoRaMacCommandStatus_t LoRaMacCommandsRemoveCmd( MacCommand_t* macCmd )
 {
     if( macCmd == NULL )
@@ -426,7 +501,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyCmds( void )
     // Loop through all elements
     while( curElement != NULL )
     {
-        if( curElement->IsSticky == false )
+        if( ( curElement->IsSticky == false ) && ( curElement->IsPacked == true ) )
         {
             nexElement = curElement->Next;
             LoRaMacCommandsRemoveCmd( curElement );
@@ -434,6 +509,7 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveNoneStickyCmds( void )
         }
         else
         {
+            curElement->IsPacked = false;
             curElement = curElement->Next;
         }
     }
@@ -477,6 +553,27 @@ LoRaMacCommandStatus_t LoRaMacCommandsGetSizeSerializedCmds( size_t* size )
     return LORAMAC_COMMANDS_SUCCESS;
 }
 
+LoRaMacCommandStatus_t LoRaMacCommandsGetSizeAnsCmds( size_t* size )
+{
+    if( size == NULL )
+    {
+        return LORAMAC_COMMANDS_ERROR_NPE;
+    }
+    MacCommand_t* curElement;
+    curElement = NvmCtx.MacCommandList.First;
+
+    *size = 0;
+    while( curElement != NULL )
+    {
+        if( GetRank( curElement->CID ) != MAC_CMD_RANK_REQ )
+        {
+            *size += CID_FIELD_SIZE + curElement->PayloadSize;
+        }
+        curElement = curElement->Next;
+    }
+    return LORAMAC_COMMANDS_SUCCESS;
+}
+
 LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer )
 {
     if( ( buffer == NULL ) || ( effectiveSize == NULL ) )
@@ -484,25 +581,89 @@ LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_
         return LORAMAC_COMMANDS_ERROR_NPE;
     }
     MacCommand_t* curElement;
-    curElement = NvmCtx.MacCommandList.First;
     uint8_t itr = 0;
 
-    // Loop through all elements
-    while( curElement != NULL )
+    for( curElement = NvmCtx.MacCommandList.First; curElement != NULL; curElement = curElement->Next )
     {
-        // If the next MAC command still fits into the buffer, add it.
-        if( ( availableSize - itr ) >= ( CID_FIELD_SIZE + curElement->PayloadSize ) )
+        curElement->IsPacked = false;
+    }
+
+    // Loop through all elements, the most urgent ones first
+    for( uint8_t rank = 0; rank < MAC_CMD_NB_RANKS; rank++ )
+    {
+        for( curElement = NvmCtx.MacCommandList.First; curElement != NULL; curElement = curElement->Next )
         {
-            buffer[itr++] = curElement->CID;
-            memcpy1( &buffer[itr], curElement->Payload, curElement->PayloadSize );
-            itr = itr + curElement->PayloadSize;
+            // If the MAC command still fits into the buffer, add it.
+            if( ( GetRank( curElement->CID ) == rank ) &&
+                ( ( availableSize - itr ) >= ( CID_FIELD_SIZE + curElement->PayloadSize ) ) )
+            {
+                itr += SerializeCmd( curElement, &buffer[itr] );
+            }
         }
-        else
+    }
+    *effectiveSize = itr;
+
+    return LORAMAC_COMMANDS_SUCCESS;
+}
+
+LoRaMacCommandStatus_t LoRaMacCommandsPackCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer, bool* isAnsDeferred )
+{
+    // Value of a byte of each rank. A byte outweighs all the bytes of the next
+    // ranks which fit into the FOpts field.
+    static const uint16_t rankValues[MAC_CMD_NB_RANKS] = { 256, 16, 1 };
+    // Best value and commands set, a bit per command, for each size
+    uint16_t values[FOPTS_MAX_SIZE + 1] = { 0 };
+    uint32_t sets[FOPTS_MAX_SIZE + 1] = { 0 };
+    MacCommand_t* cmds[NUM_OF_MAC_COMMANDS];
+    MacCommand_t* curElement;
+    uint8_t nbCmds = 0;
+    uint8_t itr = 0;
+
+    if( ( buffer == NULL ) || ( effectiveSize == NULL ) || ( isAnsDeferred == NULL ) )
+    {
+        return LORAMAC_COMMANDS_ERROR_NPE;
+    }
+    availableSize = MIN( availableSize, FOPTS_MAX_SIZE );
+
+    // 0/1 knapsack, the FOpts field is small enough to go through all sizes
+    for( curElement = NvmCtx.MacCommandList.First; curElement != NULL; curElement = curElement->Next )
+    {
+        size_t size = CID_FIELD_SIZE + curElement->PayloadSize;
+        uint16_t value = size * rankValues[GetRank( curElement->CID )];
+
+        for( size_t capacity = availableSize; capacity >= size; capacity-- )
         {
-            break;
+            if( ( values[capacity - size] + value ) > values[capacity] )
+            {
+                values[capacity] = values[capacity - size] + value;
+                sets[capacity] = sets[capacity - size] | ( 1UL << nbCmds );
+            }
+        }
+        curElement->IsPacked = false;
+        cmds[nbCmds++] = curElement;
+    }
+
+    // Serialize the selected commands, the most urgent ones first
+    *isAnsDeferred = false;
+    for( uint8_t rank = 0; rank < MAC_CMD_NB_RANKS; rank++ )
+    {
+        for( uint8_t i = 0; i < nbCmds; i++ )
+        {
+            if( GetRank( cmds[i]->CID ) != rank )
+            {
+                continue;
+            }
+            if( ( sets[availableSize] & ( 1UL << i ) ) != 0 )
+            {
+                itr += SerializeCmd( cmds[i], &buffer[itr] );
+            }
+            else if( rank != MAC_CMD_RANK_REQ )
+            {
+                *isAnsDeferred = true;
+            }
         }
-        curElement = curElement->Next;
     }
+    *effectiveSize = itr;
 
     return LORAMAC_COMMANDS_SUCCESS;
 }
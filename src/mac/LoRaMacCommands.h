@@ -56,6 +56,10 @@ struct sMacCommand
      *  The pointer to the next MAC Command element in the list
      */
     MacCommand_t* Next;
+    /*!
+     *  The pointer to the previous MAC Command element in the list
+     */
+    MacCommand_t* Prev;
     /*!
      * MAC command identifier
      */
@@ -72,6 +76,10 @@ struct sMacCommand
      * Indicates if it's a sticky MAC command
      */
     bool IsSticky;
+    /*!
+     * Indicates if the MAC command is part of the last serialized commands
+     */
+    bool IsPacked;
 };
 
 /*!
@@ -150,6 +158,21 @@ void* LoRaMacCommandsGetNvmCtx( size_t* commandsNvmCtxSize );
  */
 LoRaMacCommandStatus_t LoRaMacCommandsAddCmd( uint8_t cid, uint8_t* payload, size_t payloadSize );
 
+/*!
+ * \brief Adds several MAC commands to be sent, with a single context change
+ *        notification.
+ *
+ * \param[IN]   cmds               - MAC commands. Only the CID, Payload and
+ *                                   PayloadSize fields are used
+ * \param[IN]   nbCmds             - Number of MAC commands
+ *
+ * \retval                     - Status of the operation. When there are not
+ *                               enough free slots, the first commands are
+ *                               added and LORAMAC_COMMANDS_ERROR_MEMORY is
+ *                               returned.
+ */
+LoRaMacCommandStatus_t LoRaMacCommandsAddCmds( const MacCommand_t* cmds, uint8_t nbCmds );
+
 /*!
  * \brief Remove a MAC command.
  *
@@ -170,7 +193,9 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveCmd( MacCommand_t* macCmd );
 LoRaMacCommandStatus_t LoRaMacCommandsGetCmd( uint8_t cid, MacCommand_t** macCmd );
 
 /*!
- * \brief Remove all none sticky MAC commands.
+ * \brief Remove all none sticky MAC commands which were part of the last
+ *        serialized commands. The commands which didn't fit are kept for the
+ *        next uplink.
  *
  * \retval                     - Status of the operation
  */
@@ -193,7 +218,19 @@ LoRaMacCommandStatus_t LoRaMacCommandsRemoveStickyAnsCmds( void );
 LoRaMacCommandStatus_t LoRaMacCommandsGetSizeSerializedCmds( size_t* size );
 
 /*!
- * \brief Get as many as possible MAC commands serialized
+ * \brief Get size of the answer MAC commands serialized as buffer. Unlike the
+ *        requests of the end-device, the answers can't wait for a next uplink.
+ *
+ * \param[out]   size               - Size of the answer MAC commands
+ *
+ * \retval                     - Status of the operation
+ */
+LoRaMacCommandStatus_t LoRaMacCommandsGetSizeAnsCmds( size_t* size );
+
+/*!
+ * \brief Get as many as possible MAC commands serialized. The sticky answers
+ *        come first, then the other answers and the requests. A command which
+ *        doesn't fit is skipped.
  *
  * \param[IN]   availableSize      - Available size of memory for MAC commands
  * \param[out]  effectiveSize      - Size of memory which was effectively used for serializing.
@@ -203,6 +240,21 @@ LoRaMacCommandStatus_t LoRaMacCommandsGetSizeSerializedCmds( size_t* size );
  */
 LoRaMacCommandStatus_t LoRaMacCommandsSerializeCmds( size_t availableSize, size_t* effectiveSize,  uint8_t* buffer );
 
+/*!
+ * \brief Packs the MAC commands into the FOpts field. Selects the commands
+ *        which fill the available size with the most urgent ones: a byte of
+ *        sticky answer outweighs the other answers, and a byte of answer
+ *        outweighs the requests. The commands are serialized by urgency.
+ *
+ * \param[IN]   availableSize      - Available size, at most the FOpts field size
+ * \param[out]  effectiveSize      - Size of memory which was effectively used for serializing.
+ * \param[out]  buffer             - Destination data buffer
+ * \param[out]  isAnsDeferred      - Set if an answer didn't fit
+ *
+ * \retval                     - Status of the operation
+ */
+LoRaMacCommandStatus_t LoRaMacCommandsPackCmds( size_t availableSize, size_t* effectiveSize, uint8_t* buffer, bool* isAnsDeferred );
+
 /*!
  * \brief Determines if there are sticky MAC commands pending.
  *
@@ -33,14 +33,26 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ) and Daniel Jae
 typedef struct sLoRaMacConfirmQueueNvmCtx
 {
     /*!
-    * MlmeConfirm queue data structure
+    * MlmeConfirm data, indexed by request type
     */
-    MlmeConfirmQueue_t MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN];
+    MlmeConfirmQueue_t MlmeConfirms[LORA_MAC_MLME_NB];
+    /*!
+    * Requests in the order they were added, used as a ring
+    */
+    uint8_t MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN];
+    /*!
+    * Index of the first request of the ring
+    */
+    uint8_t MlmeConfirmQueueStart;
     /*!
     * Counts the number of MlmeConfirms to process
     */
     uint8_t MlmeConfirmQueueCnt;
     /*!
+    * Requests in the queue, one bit per request type
+    */
+    uint32_t ActiveRequests;
+    /*!
     * Variable which holds a common status
     */
     LoRaMacEventInfoStatus_t CommonStatus;
@@ -55,14 +67,6 @@ typedef struct sLoRaMacConfirmQueueCtx
     * LoRaMac callback function primitives
     */
     LoRaMacPrimitives_t* Primitives;
-    /*!
-    * Pointer to the first element of the ring buffer
-    */
-    MlmeConfirmQueue_t* BufferStart;
-    /*!
-    * Pointer to the last element of the ring buffer
-    */
-    MlmeConfirmQueue_t* BufferEnd;
     /*
      * Callback function to notify the upper layer about context change
      */
@@ -83,52 +87,21 @@ static LoRaMacConfirmQueueNvmCtx_t ConfirmQueueNvmCtx;
  */
 static LoRaMacConfirmQueueCtx_t ConfirmQueueCtx;
 
-static MlmeConfirmQueue_t* IncreaseBufferPointer( MlmeConfirmQueue_t* bufferPointer )
-{
-    if( bufferPointer == &ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN - 1] )
-    {
-        // Reset to the first element
-        bufferPointer = ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue;
-    }
-    else
-    {
-        // Increase
-        bufferPointer++;
-    }
-    return bufferPointer;
-}
-
-static MlmeConfirmQueue_t* DecreaseBufferPointer( MlmeConfirmQueue_t* bufferPointer )
+static MlmeConfirmQueue_t* GetElement( Mlme_t request )
 {
-    if( bufferPointer == ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue )
-    {
-        // Reset to the last element
-        bufferPointer = &ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue[LORA_MAC_MLME_CONFIRM_QUEUE_LEN - 1];
-    }
-    else
+    if( ( request >= LORA_MAC_MLME_NB ) ||
+        ( ( ConfirmQueueCtx.ConfirmQueueNvmCtx->ActiveRequests & ( 1UL << request ) ) == 0 ) )
     {
-        bufferPointer--;
+        return NULL;
     }
-    return bufferPointer;
+    return &ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirms[request];
 }
 
-static MlmeConfirmQueue_t* GetElement( Mlme_t request, MlmeConfirmQueue_t* bufferStart, MlmeConfirmQueue_t* bufferEnd )
+static MlmeConfirmQueue_t* GetQueueElement( uint8_t position )
 {
-    MlmeConfirmQueue_t* element = bufferStart;
+    LoRaMacConfirmQueueNvmCtx_t* nvmCtx = ConfirmQueueCtx.ConfirmQueueNvmCtx;
 
-    while( element != bufferEnd )
-    {
-        if( element->Request == request )
-        {
-            // We have found the element
-            return element;
-        }
-        else
-        {
-            element = IncreaseBufferPointer( element );
-        }
-    }
-    return NULL;
+    return &nvmCtx->MlmeConfirms[nvmCtx->MlmeConfirmQueue[( nvmCtx->MlmeConfirmQueueStart + position ) % LORA_MAC_MLME_CONFIRM_QUEUE_LEN]];
 }
 
 void LoRaMacConfirmQueueInit( LoRaMacPrimitives_t* primitives, LoRaMacConfirmQueueNvmEvent confirmQueueNvmCtxChanged )
@@ -142,10 +115,10 @@ void LoRaMacConfirmQueueInit( LoRaMacPrimitives_t* primitives, LoRaMacConfirmQue
     ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt = 0;
 
     // Init buffer
-    ConfirmQueueCtx.BufferStart = ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue;
-    ConfirmQueueCtx.BufferEnd = ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue;
+    ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueStart = 0;
+    ConfirmQueueCtx.ConfirmQueueNvmCtx->ActiveRequests = 0;
 
-    memset1( ( uint8_t* )ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue, 0xFF, sizeof( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueue ) );
+    memset1( ( uint8_t* )ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirms, 0xFF, sizeof( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirms ) );
 
     // Common status
     ConfirmQueueCtx.ConfirmQueueNvmCtx->CommonStatus = LORAMAC_EVENT_INFO_STATUS_ERROR;
@@ -176,104 +149,105 @@ void* LoRaMacConfirmQueueGetNvmCtx( size_t* confirmQueueNvmCtxSize )
 
 bool LoRaMacConfirmQueueAdd( MlmeConfirmQueue_t* mlmeConfirm )
 {
-    if( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt >= LORA_MAC_MLME_CONFIRM_QUEUE_LEN )
+    LoRaMacConfirmQueueNvmCtx_t* nvmCtx = ConfirmQueueCtx.ConfirmQueueNvmCtx;
+    MlmeConfirmQueue_t* element;
+
+    if( ( nvmCtx->MlmeConfirmQueueCnt >= LORA_MAC_MLME_CONFIRM_QUEUE_LEN ) || ( mlmeConfirm->Request >= LORA_MAC_MLME_NB ) )
     {
         // Protect the buffer against overwrites
         return false;
     }
+    if( GetElement( mlmeConfirm->Request ) != NULL )
+    {
+        // A single element per request type
+        return false;
+    }
 
     // Add the element to the ring buffer
-    ConfirmQueueCtx.BufferEnd->Request = mlmeConfirm->Request;
-    ConfirmQueueCtx.BufferEnd->Status = mlmeConfirm->Status;
-    ConfirmQueueCtx.BufferEnd->RestrictCommonReadyToHandle = mlmeConfirm->RestrictCommonReadyToHandle;
-    ConfirmQueueCtx.BufferEnd->ReadyToHandle = false;
+    element = &nvmCtx->MlmeConfirms[mlmeConfirm->Request];
+    element->Request = mlmeConfirm->Request;
+    element->Status = mlmeConfirm->Status;
+    element->RestrictCommonReadyToHandle = mlmeConfirm->RestrictCommonReadyToHandle;
+    element->ReadyToHandle = false;
+    nvmCtx->MlmeConfirmQueue[( nvmCtx->MlmeConfirmQueueStart + nvmCtx->MlmeConfirmQueueCnt ) % LORA_MAC_MLME_CONFIRM_QUEUE_LEN] = mlmeConfirm->Request;
+    nvmCtx->ActiveRequests |= 1UL << mlmeConfirm->Request;
     // Increase counter
-    ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt++;
-    // Update end pointer
-    ConfirmQueueCtx.BufferEnd = IncreaseBufferPointer( ConfirmQueueCtx.BufferEnd );
+    nvmCtx->MlmeConfirmQueueCnt++;
 
     return true;
 }
 
 bool LoRaMacConfirmQueueRemoveLast( void )
 {
-    if( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt == 0 )
+    LoRaMacConfirmQueueNvmCtx_t* nvmCtx = ConfirmQueueCtx.ConfirmQueueNvmCtx;
+
+    if( nvmCtx->MlmeConfirmQueueCnt == 0 )
     {
         return false;
     }
 
-    // Increase counter
-    ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt--;
-    // Update start pointer
-    ConfirmQueueCtx.BufferEnd = DecreaseBufferPointer( ConfirmQueueCtx.BufferEnd );
+    nvmCtx->ActiveRequests &= ~( 1UL << GetQueueElement( nvmCtx->MlmeConfirmQueueCnt - 1 )->Request );
+    // Decrease counter
+    nvmCtx->MlmeConfirmQueueCnt--;
 
     return true;
 }
 
 bool LoRaMacConfirmQueueRemoveFirst( void )
 {
-    if( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt == 0 )
+    LoRaMacConfirmQueueNvmCtx_t* nvmCtx = ConfirmQueueCtx.ConfirmQueueNvmCtx;
+
+    if( nvmCtx->MlmeConfirmQueueCnt == 0 )
     {
         return false;
     }
 
-    // Increase counter
-    ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt--;
-    // Update start pointer
-    ConfirmQueueCtx.BufferStart = IncreaseBufferPointer( ConfirmQueueCtx.BufferStart );
+    nvmCtx->ActiveRequests &= ~( 1UL << GetQueueElement( 0 )->Request );
+    // Decrease counter
+    nvmCtx->MlmeConfirmQueueCnt--;
+    // Update start index
+    nvmCtx->MlmeConfirmQueueStart = ( nvmCtx->MlmeConfirmQueueStart + 1 ) % LORA_MAC_MLME_CONFIRM_QUEUE_LEN;
 
     return true;
 }
 
 void LoRaMacConfirmQueueSetStatus( LoRaMacEventInfoStatus_t status, Mlme_t request )
 {
-    MlmeConfirmQueue_t* element = NULL;
+    MlmeConfirmQueue_t* element = GetElement( request );
 
-    if( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt > 0 )
+    if( element != NULL )
     {
-        element = GetElement( request, ConfirmQueueCtx.BufferStart, ConfirmQueueCtx.BufferEnd );
-        if( element != NULL )
-        {
-            element->Status = status;
-            element->ReadyToHandle = true;
-        }
+        element->Status = status;
+        element->ReadyToHandle = true;
     }
 }
 
 LoRaMacEventInfoStatus_t LoRaMacConfirmQueueGetStatus( Mlme_t request )
 {
-    MlmeConfirmQueue_t* element = NULL;
+    MlmeConfirmQueue_t* element = GetElement( request );
 
-    if( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt > 0 )
+    if( element != NULL )
     {
-        element = GetElement( request, ConfirmQueueCtx.BufferStart, ConfirmQueueCtx.BufferEnd );
-        if( element != NULL )
-        {
-            return element->Status;
-        }
+        return element->Status;
     }
     return LORAMAC_EVENT_INFO_STATUS_ERROR;
 }
 
 void LoRaMacConfirmQueueSetStatusCmn( LoRaMacEventInfoStatus_t status )
 {
-    MlmeConfirmQueue_t* element = ConfirmQueueCtx.BufferStart;
-
     ConfirmQueueCtx.ConfirmQueueNvmCtx->CommonStatus = status;
 
-    if( ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt > 0 )
+    for( uint8_t i = 0; i < ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt; i++ )
     {
-        do
+        MlmeConfirmQueue_t* element = GetQueueElement( i );
+
+        element->Status = status;
+        // Set the status if it is allowed to set it with a call to
+        // LoRaMacConfirmQueueSetStatusCmn.
+        if( element->RestrictCommonReadyToHandle == false )
         {
-            element->Status = status;
-            // Set the status if it is allowed to set it with a call to
-            // LoRaMacConfirmQueueSetStatusCmn.
-            if( element->RestrictCommonReadyToHandle == false )
-            {
-                element->ReadyToHandle = true;
-            }
-            element = IncreaseBufferPointer( element );
-        }while( element != ConfirmQueueCtx.BufferEnd );
+            element->ReadyToHandle = true;
+        }
     }
 }
 
@@ -282,9 +256,19 @@ LoRaMacEventInfoStatus_t LoRaMacConfirmQueueGetStatusCmn( void )
     return ConfirmQueueCtx.ConfirmQueueNvmCtx->CommonStatus;
 }
 
+void LoRaMacConfirmQueueSetRestrictCmn( Mlme_t request, bool restrictCmn )
+{
+    MlmeConfirmQueue_t* element = GetElement( request );
+
+    if( element != NULL )
+    {
+        element->RestrictCommonReadyToHandle = restrictCmn;
+    }
+}
+
 bool LoRaMacConfirmQueueIsCmdActive( Mlme_t request )
 {
-    if( GetElement( request, ConfirmQueueCtx.BufferStart, ConfirmQueueCtx.BufferEnd ) != NULL )
+    if( GetElement( request ) != NULL )
     {
         return true;
     }
@@ -294,34 +278,26 @@ bool LoRaMacConfirmQueueIsCmdActive( Mlme_t request )
 void LoRaMacConfirmQueueHandleCb( MlmeConfirm_t* mlmeConfirm )
 {
     uint8_t nbElements = ConfirmQueueCtx.ConfirmQueueNvmCtx->MlmeConfirmQueueCnt;
-    bool readyToHandle = false;
-    MlmeConfirmQueue_t mlmeConfirmToStore;
+    MlmeConfirmQueue_t element;
 
     for( uint8_t i = 0; i < nbElements; i++ )
     {
-        mlmeConfirm->MlmeRequest = ConfirmQueueCtx.BufferStart->Request;
-        mlmeConfirm->Status = ConfirmQueueCtx.BufferStart->Status;
-        readyToHandle = ConfirmQueueCtx.BufferStart->ReadyToHandle;
+        element = *GetQueueElement( 0 );
 
-        if( readyToHandle == true )
+        // Remove the element first, the confirm may issue a request of the
+        // same type
+        LoRaMacConfirmQueueRemoveFirst( );
+
+        if( element.ReadyToHandle == true )
         {
+            mlmeConfirm->MlmeRequest = element.Request;
+            mlmeConfirm->Status = element.Status;
             ConfirmQueueCtx.Primitives->MacMlmeConfirm( mlmeConfirm );
         }
         else
-        {
-            // The request is not processed yet. Store the state.
-            mlmeConfirmToStore.Request = ConfirmQueueCtx.BufferStart->Request;
-            mlmeConfirmToStore.Status = ConfirmQueueCtx.BufferStart->Status;
-            mlmeConfirmToStore.RestrictCommonReadyToHandle = ConfirmQueueCtx.BufferStart->RestrictCommonReadyToHandle;
-        }
-
-        // Increase the pointer afterwards to prevent overwrites
-        LoRaMacConfirmQueueRemoveFirst( );
-
-        if( readyToHandle == false )
         {
             // Add a request which has not been finished again to the queue
-            LoRaMacConfirmQueueAdd( &mlmeConfirmToStore );
+            LoRaMacConfirmQueueAdd( &element );
         }
     }
 }
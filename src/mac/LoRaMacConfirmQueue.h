@@ -30,7 +30,8 @@
  *
  * \defgroup  LORAMACCONFIRMQUEUE LoRa MAC confirm queue implementation
  *            This module specifies the API implementation of the LoRaMAC confirm queue.
- *            The confirm queue is implemented with as a ring buffer. The number of
+ *            The confirm queue is implemented with as a ring buffer of request
+ *            types, the confirm data being indexed by request type. The number of
  *            elements can be defined with \ref LORA_MAC_MLME_CONFIRM_QUEUE_LEN. The
  *            current implementation does not support multiple elements of the same
  *            Mlme_t type.
@@ -49,6 +50,11 @@
  */
 #define LORA_MAC_MLME_CONFIRM_QUEUE_LEN             5
 
+/*!
+ * Number of MLME request types
+ */
+#define LORA_MAC_MLME_NB                            ( MLME_BEACON_LOST + 1 )
+
 /*!
  * Structure to hold multiple MLME request confirm data
  */
@@ -112,7 +118,8 @@ void* LoRaMacConfirmQueueGetNvmCtx( size_t* confirmQueueNvmCtxSize );
  *
  * \param   [IN] mlmeConfirm - Pointer to the element to add.
  *
- * \retval  [true - operation was successful, false - operation failed]
+ * \retval  [true - operation was successful, false - operation failed, the
+ *          queue is full or already holds a request of the same type]
  */
 bool LoRaMacConfirmQueueAdd( MlmeConfirmQueue_t* mlmeConfirm );
 
@@ -162,6 +169,16 @@ void LoRaMacConfirmQueueSetStatusCmn( LoRaMacEventInfoStatus_t status );
  */
 LoRaMacEventInfoStatus_t LoRaMacConfirmQueueGetStatusCmn( void );
 
+/*!
+ * \brief   Sets if an element ignores the common status. A request deferred to
+ *          a next uplink must not be confirmed by the current one.
+ *
+ * \param   [IN] request - The related request.
+ *
+ * \param   [IN] restrictCmn - Set if the element ignores the common status.
+ */
+void LoRaMacConfirmQueueSetRestrictCmn( Mlme_t request, bool restrictCmn );
+
 /*!
  * \brief   Verifies if a request is in the queue and active.
  *
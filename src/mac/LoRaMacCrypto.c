@@ -56,6 +56,19 @@
  */
 #define FCNT_DOWN_INITAL_VALUE          0xFFFFFFFF
 
+/*
+ * Number of downlink frame counters
+ */
+#define FCNT_DOWN_NB                    ( MC_FCNT_DOWN_3 - N_FCNT_DOWN + 1 )
+
+/*
+ * Default number of uplink frame counters reserved by a context change.
+ * 0 notifies a context change on every uplink.
+ */
+#ifndef FCNT_UP_LOOKAHEAD_DEFAULT
+#define FCNT_UP_LOOKAHEAD_DEFAULT       0
+#endif
+
 /*
  * Frame direction definition for uplink communications
  */
@@ -86,6 +99,11 @@
  */
 #define NUM_OF_SEC_CTX                  5
 
+/*
+ * Number of multicast security context entries
+ */
+#define NUM_OF_MC_SEC_CTX               ( NUM_OF_SEC_CTX - 1 )
+
 /*
  * Size of the module context
  */
@@ -102,14 +120,22 @@
 #define CRYPTO_MAXMESSAGE_SIZE          256
 
 /*
- * Maximum size of the buffer for crypto operations
+ * MIC computaion offset
  */
-#define CRYPTO_BUFFER_SIZE              CRYPTO_MAXMESSAGE_SIZE + MIC_BLOCK_BX_SIZE
+#define CRYPTO_MIC_COMPUTATION_OFFSET   JOIN_REQ_TYPE_SIZE + LORAMAC_JOIN_EUI_FIELD_SIZE + DEV_NONCE_SIZE + LORAMAC_MHDR_FIELD_SIZE
 
 /*
- * MIC computaion offset
+ * Number of key stream blocks precomputed for the next uplink, enough for
+ * the largest payload
  */
-#define CRYPTO_MIC_COMPUTATION_OFFSET   JOIN_REQ_TYPE_SIZE + LORAMAC_JOIN_EUI_FIELD_SIZE + DEV_NONCE_SIZE + LORAMAC_MHDR_FIELD_SIZE
+#define CRYPTO_KEYSTREAM_UP_BLOCKS      ( CRYPTO_MAXMESSAGE_SIZE >> 4 )
+
+/*
+ * Number of key stream blocks precomputed for the expected downlink
+ */
+#ifndef CRYPTO_KEYSTREAM_DOWN_BLOCKS
+#define CRYPTO_KEYSTREAM_DOWN_BLOCKS    4
+#endif
 
 /*!
  * LoRaWAN Frame counter list.
@@ -121,36 +147,10 @@ typedef struct sFCntList
      */
     uint32_t FCntUp;
     /*!
-     * Network downlink frame counter which is incremented with each downlink on FPort 0
-     * or when the FPort field is missing.
-     */
-    uint32_t NFCntDown;
-    /*!
-     * Application downlink frame counter which is incremented with each downlink
-     * on a port different than 0.
-     */
-    uint32_t AFCntDown;
-    /*!
-     * In case if the device is connected to a LoRaWAN 1.0 Server,
-     * this counter is used for every kind of downlink frame.
-     */
-    uint32_t FCntDown;
-    /*!
-     * Multicast downlink counter for index 0
-     */
-    uint32_t McFCntDown0;
-    /*!
-     * Multicast downlink counter for index 1
-     */
-    uint32_t McFCntDown1;
-    /*!
-     * Multicast downlink counter for index 2
+     * Last accepted downlink frame counters, indexed by the frame counter
+     * identifier from N_FCNT_DOWN to MC_FCNT_DOWN_3. See \ref FCntIdentifier_t.
      */
-    uint32_t McFCntDown2;
-    /*!
-     * Multicast downlink counter for index 3
-     */
-    uint32_t McFCntDown3;
+    uint32_t FCntDown[FCNT_DOWN_NB];
 }FCntList_t;
 
 /*
@@ -181,6 +181,16 @@ typedef struct sLoRaMacCryptoNvmCtx
      * RJcount1 is a counter incremented with every Rejoin request Type 1 frame transmitted.
      */
     uint16_t RJcount1;
+    /*
+     * Highest uplink frame counter which may have been used when the context
+     * was last notified as changed. The uplink frame counter restarts from
+     * it after a reset.
+     */
+    uint32_t FCntUpReserved;
+    /*
+     * Number of uplink frame counters reserved at once
+     */
+    uint32_t FCntUpLookahead;
     /*
      * LastDownFCnt stores the information which frame counter was used to unsecure the last frame.
      * This information is needed to compute ConfFCnt in B1 block for the MIC.
@@ -205,6 +215,27 @@ typedef struct sLoRaMacCryptoCtx
      * Callback function to notify the upper layer about context change
      */
     LoRaMacCryptoNvmEvent EventCryptoNvmCtxChanged;
+    /*
+     * Set while the session keys of an accepted join aren't derived yet
+     */
+    bool IsKeyDerivationPending;
+    /*
+     * Join-accept JoinNonce, input of the pending derivation
+     */
+    uint8_t JoinNonce[3];
+    /*
+     * Join-accept NetID, input of the pending derivation
+     */
+    uint8_t NetID[3];
+    /*
+     * DevNonce or RJcount of the request answered by the join-accept, input
+     * of the pending derivation
+     */
+    uint8_t DevNonce[2];
+    /*
+     * Join server EUI, input of the pending derivation
+     */
+    uint8_t JoinEUI[LORAMAC_JOIN_EUI_FIELD_SIZE];
 }LoRaMacCryptoCtx_t;
 
 /*
@@ -230,6 +261,39 @@ typedef struct sKeyAddr
     KeyIdentifier_t RootKey;
 }KeyAddr_t;
 
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+/*
+ * Precomputed payload key stream of a frame
+ */
+typedef struct sKeyStream
+{
+    /*
+     * Payload key identifier
+     */
+    KeyIdentifier_t KeyID;
+    /*
+     * Address
+     */
+    uint32_t Address;
+    /*
+     * Frame counter
+     */
+    uint32_t FCnt;
+    /*
+     * Number of computed blocks, 0 when the key stream is invalid
+     */
+    uint8_t NbBlocks;
+    /*
+     * Capacity of the blocks buffer
+     */
+    uint8_t MaxBlocks;
+    /*
+     * Encrypted counter blocks A1..An
+     */
+    uint8_t* Blocks;
+}KeyStream_t;
+#endif
+
 /*
  *Crypto module context.
  */
@@ -241,7 +305,7 @@ static LoRaMacCryptoCtx_t CryptoCtx;
 static LoRaMacCryptoNvmCtx_t NvmCryptoCtx;
 
 /*
- * Key-Address list
+ * Key-Address list, indexed by the address identifier
  */
 static KeyAddr_t KeyAddrList[NUM_OF_SEC_CTX] =
     {
@@ -252,31 +316,38 @@ static KeyAddr_t KeyAddrList[NUM_OF_SEC_CTX] =
         { UNICAST_DEV_ADDR, APP_S_KEY, S_NWK_S_INT_KEY, NO_KEY }
     };
 
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+static uint8_t KeyStreamUpBlocks[CRYPTO_KEYSTREAM_UP_BLOCKS << 4];
+static uint8_t KeyStreamDownBlocks[CRYPTO_KEYSTREAM_DOWN_BLOCKS << 4];
+
+/*
+ * Precomputed key streams, indexed by the frame direction
+ */
+static KeyStream_t KeyStreams[2] =
+{
+    { .NbBlocks = 0, .MaxBlocks = CRYPTO_KEYSTREAM_UP_BLOCKS, .Blocks = KeyStreamUpBlocks },
+    { .NbBlocks = 0, .MaxBlocks = CRYPTO_KEYSTREAM_DOWN_BLOCKS, .Blocks = KeyStreamDownBlocks },
+};
+#endif
+
 /*
  * Local functions
  */
 
 /*
- * Encrypts the payload
+ * Lays out the counter blocks of the payload encryption, the secure element
+ * then looks up and schedules the key a single time per payload.
  *
- * \param[IN]  keyID            - Key identifier
+ * \param[IN]  size             - Size of the payload
  * \param[IN]  address          - Address
  * \param[IN]  dir              - Frame direction ( Uplink or Downlink )
  * \param[IN]  frameCounter     - Frame counter
- * \param[IN]  size             - Size of data
- * \param[IN/OUT]  buffer       - Data buffer
- * \retval                      - Status of the operation
+ * \param[OUT] sBlocks          - Counter blocks
+ * \retval                      - Number of counter blocks
  */
-static LoRaMacCryptoStatus_t PayloadEncrypt( uint8_t* buffer, int16_t size, KeyIdentifier_t keyID, uint32_t address, uint8_t dir, uint32_t frameCounter )
+static uint16_t PreparePayloadBlocks( int16_t size, uint32_t address, uint8_t dir, uint32_t frameCounter, uint8_t* sBlocks )
 {
-    if( buffer == 0 )
-    {
-        return LORAMAC_CRYPTO_ERROR_NPE;
-    }
-
-    uint8_t bufferIndex = 0;
-    uint16_t ctr = 1;
-    uint8_t sBlock[16] = { 0 };
+    uint16_t nbBlocks = ( size + 15 ) >> 4;
     uint8_t aBlock[16] = { 0 };
 
     aBlock[0] = 0x01;
@@ -293,48 +364,91 @@ static LoRaMacCryptoStatus_t PayloadEncrypt( uint8_t* buffer, int16_t size, KeyI
     aBlock[12] = ( frameCounter >> 16 ) & 0xFF;
     aBlock[13] = ( frameCounter >> 24 ) & 0xFF;
 
-    while( size > 0 )
+    for( uint16_t ctr = 1; ctr <= nbBlocks; ctr++ )
     {
         aBlock[15] = ctr & 0xFF;
-        ctr++;
-        if( SecureElementAesEncrypt( aBlock, 16, keyID, sBlock ) != SECURE_ELEMENT_SUCCESS )
-        {
-            return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
-        }
+        memcpy1( &sBlocks[( ctr - 1 ) << 4], aBlock, 16 );
+    }
+    return nbBlocks;
+}
 
-        for( uint8_t i = 0; i < ( ( size > 16 ) ? 16 : size ); i++ )
-        {
-            buffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
-        }
-        size -= 16;
-        bufferIndex += 16;
+/*
+ * Gets the precomputed key stream of a frame payload
+ *
+ * \param[IN]  keyID            - Payload key identifier
+ * \param[IN]  address          - Address
+ * \param[IN]  dir              - Frame direction ( Uplink or Downlink )
+ * \param[IN]  frameCounter     - Frame counter
+ * \param[OUT] blocks           - First blocks of the key stream
+ * \retval                      - Number of precomputed blocks, 0 if none
+ */
+static uint16_t GetKeyStream( KeyIdentifier_t keyID, uint32_t address, uint8_t dir, uint32_t frameCounter, uint8_t** blocks )
+{
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+    KeyStream_t* keyStream = &KeyStreams[dir];
+
+    if( ( keyStream->NbBlocks > 0 ) && ( keyStream->KeyID == keyID ) &&
+        ( keyStream->Address == address ) && ( keyStream->FCnt == frameCounter ) )
+    {
+        *blocks = keyStream->Blocks;
+        return keyStream->NbBlocks;
+    }
+#endif
+    *blocks = NULL;
+    return 0;
+}
+
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+/*
+ * Computes the key stream of a frame payload ahead of the frame
+ *
+ * \param[IN]  keyID            - Payload key identifier
+ * \param[IN]  address          - Address
+ * \param[IN]  dir              - Frame direction ( Uplink or Downlink )
+ * \param[IN]  frameCounter     - Frame counter
+ * \param[IN]  nbBlocks         - Number of blocks, limited to the buffer capacity
+ * \retval                      - Status of the operation
+ */
+static LoRaMacCryptoStatus_t PrecomputeKeyStream( KeyIdentifier_t keyID, uint32_t address, uint8_t dir, uint32_t frameCounter, uint16_t nbBlocks )
+{
+    KeyStream_t* keyStream = &KeyStreams[dir];
+    uint8_t* blocks = NULL;
+
+    nbBlocks = MIN( nbBlocks, keyStream->MaxBlocks );
+    if( GetKeyStream( keyID, address, dir, frameCounter, &blocks ) >= nbBlocks )
+    {
+        // Already available
+        return LORAMAC_CRYPTO_SUCCESS;
     }
 
+    keyStream->NbBlocks = 0;
+    PreparePayloadBlocks( nbBlocks << 4, address, dir, frameCounter, keyStream->Blocks );
+    if( SecureElementAesEncrypt( keyStream->Blocks, nbBlocks << 4, keyID, keyStream->Blocks ) != SECURE_ELEMENT_SUCCESS )
+    {
+        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+    }
+    keyStream->KeyID = keyID;
+    keyStream->Address = address;
+    keyStream->FCnt = frameCounter;
+    keyStream->NbBlocks = nbBlocks;
     return LORAMAC_CRYPTO_SUCCESS;
 }
+#endif
 
 #if( USE_LRWAN_1_1_X_CRYPTO == 1 )
 /*
- * Encrypts the FOpts
+ * Prepares the counter block of the FOpts encryption
  *
  * \param[IN]  address          - Address
  * \param[IN]  dir              - Frame direction ( Uplink or Downlink )
  * \param[IN]  fCntID           - Frame counter identifier
  * \param[IN]  frameCounter     - Frame counter
- * \param[IN]  size             - Size of data
- * \param[IN/OUT]  buffer       - Data buffer
+ * \param[OUT] aBlock           - Counter block
  * \retval                      - Status of the operation
  */
-static LoRaMacCryptoStatus_t FOptsEncrypt( uint16_t size, uint32_t address, uint8_t dir, FCntIdentifier_t fCntID, uint32_t frameCounter, uint8_t* buffer )
+static LoRaMacCryptoStatus_t PrepareFOptsBlock( uint32_t address, uint8_t dir, FCntIdentifier_t fCntID, uint32_t frameCounter, uint8_t* aBlock )
 {
-    if( buffer == 0 )
-    {
-        return LORAMAC_CRYPTO_ERROR_NPE;
-    }
-
-    uint8_t bufferIndex = 0;
-    uint8_t sBlock[16] = { 0 };
-    uint8_t aBlock[16] = { 0 };
+    memset1( aBlock, 0, 16 );
 
     aBlock[0] = 0x01;
 
@@ -381,21 +495,110 @@ static LoRaMacCryptoStatus_t FOptsEncrypt( uint16_t size, uint32_t address, uint
         aBlock[15] = 0x01;
     }
 
-    if( size > 0 )
+    return LORAMAC_CRYPTO_SUCCESS;
+}
+#endif
+
+/*
+ * Encrypts or decrypts the payload and the FOpts of a data frame
+ *
+ * The MIC verification of a downlink, the payload and the FOpts key streams
+ * are computed in a single secure element transaction. The frame is only
+ * deciphered once its MIC is verified.
+ *
+ * \param[IN]  keyID            - Payload key identifier
+ * \param[IN]  address          - Address
+ * \param[IN]  dir              - Frame direction ( Uplink or Downlink )
+ * \param[IN]  fCntID           - Frame counter identifier
+ * \param[IN]  frameCounter     - Frame counter
+ * \param[IN/OUT] macMsg        - Data message
+ * \param[IN]  micCmd           - MIC computation to verify against the message MIC. May be NULL
+ * \retval                      - Status of the operation
+ */
+static LoRaMacCryptoStatus_t DataFrameCipher( KeyIdentifier_t keyID, uint32_t address, uint8_t dir, FCntIdentifier_t fCntID, uint32_t frameCounter, LoRaMacMessageData_t* macMsg, SecureElementCmd_t* micCmd )
+{
+    if( macMsg->FRMPayload == 0 )
     {
-        if( SecureElementAesEncrypt( aBlock, 16, NWK_S_ENC_KEY, sBlock ) != SECURE_ELEMENT_SUCCESS )
+        return LORAMAC_CRYPTO_ERROR_NPE;
+    }
+
+    SecureElementCmd_t cmds[3];
+    uint8_t nbCmds = 0;
+    uint8_t sBlocks[CRYPTO_MAXMESSAGE_SIZE];
+    uint16_t nbBlocks = ( macMsg->FRMPayloadSize + 15 ) >> 4;
+    uint8_t* keyStream = NULL;
+    // The precomputed blocks leave a plain XOR, only the missing ones are
+    // computed
+    uint16_t nbKnownBlocks = MIN( GetKeyStream( keyID, address, dir, frameCounter, &keyStream ), nbBlocks );
+
+    if( micCmd != NULL )
+    {
+        cmds[nbCmds++] = *micCmd;
+    }
+    if( nbKnownBlocks < nbBlocks )
+    {
+        PreparePayloadBlocks( macMsg->FRMPayloadSize, address, dir, frameCounter, sBlocks );
+        if( nbKnownBlocks > 0 )
         {
-            return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+            memcpy1( sBlocks, keyStream, nbKnownBlocks << 4 );
+        }
+        keyStream = sBlocks;
+        cmds[nbCmds].Type = SECURE_ELEMENT_CMD_AES_ENCRYPT;
+        cmds[nbCmds].KeyID = keyID;
+        cmds[nbCmds].Buffer = sBlocks + ( nbKnownBlocks << 4 );
+        cmds[nbCmds].Size = ( nbBlocks - nbKnownBlocks ) << 4;
+        cmds[nbCmds].EncBuffer = sBlocks + ( nbKnownBlocks << 4 );
+        nbCmds++;
+    }
+
+#if( USE_LRWAN_1_1_X_CRYPTO == 1 )
+    uint8_t sBlock[16];
+    uint8_t fOptsLen = 0;
+
+    if( CryptoCtx.NvmCtx->LrWanVersion.Fields.Minor == 1 )
+    {
+        LoRaMacCryptoStatus_t retval = PrepareFOptsBlock( address, dir, fCntID, frameCounter, sBlock );
+        if( retval != LORAMAC_CRYPTO_SUCCESS )
+        {
+            return retval;
         }
-        for( uint8_t i = 0; i < size; i++ )
+        fOptsLen = macMsg->FHDR.FCtrl.Bits.FOptsLen;
+        if( fOptsLen > 0 )
         {
-            buffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
+            cmds[nbCmds].Type = SECURE_ELEMENT_CMD_AES_ENCRYPT;
+            cmds[nbCmds].KeyID = NWK_S_ENC_KEY;
+            cmds[nbCmds].Buffer = sBlock;
+            cmds[nbCmds].Size = 16;
+            cmds[nbCmds].EncBuffer = sBlock;
+            nbCmds++;
         }
     }
+#endif
+
+    if( ( nbCmds > 0 ) && ( SecureElementProcessBatch( cmds, nbCmds ) != SECURE_ELEMENT_SUCCESS ) )
+    {
+        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+    }
+
+    if( ( micCmd != NULL ) && ( cmds[0].Cmac != macMsg->MIC ) )
+    {
+        return LORAMAC_CRYPTO_FAIL_MIC;
+    }
+
+    for( int16_t i = 0; i < macMsg->FRMPayloadSize; i++ )
+    {
+        macMsg->FRMPayload[i] = macMsg->FRMPayload[i] ^ keyStream[i];
+    }
+
+#if( USE_LRWAN_1_1_X_CRYPTO == 1 )
+    for( uint8_t i = 0; i < fOptsLen; i++ )
+    {
+        macMsg->FHDR.FOpts[i] = macMsg->FHDR.FOpts[i] ^ sBlock[i];
+    }
+#endif
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
-#endif
 
 /*
  * Prepares B0 block for cmac computation.
@@ -494,54 +697,6 @@ static LoRaMacCryptoStatus_t ComputeCmacB0( uint8_t* msg, uint16_t len, KeyIdent
     return LORAMAC_CRYPTO_SUCCESS;
 }
 
-/*!
- * Verifies cmac with adding B0 block in front.
- *
- * \param[IN]  msg            - Message to compute the integrity code
- * \param[IN]  len            - Length of message
- * \param[IN]  keyID          - Key identifier
- * \param[IN]  isAck          - True if it is a acknowledge frame ( Sets ConfFCnt in B0 block )
- * \param[IN]  devAddr        - Device address
- * \param[IN]  dir            - Frame direction ( Uplink:0, Downlink:1 )
- * \param[IN]  fCnt           - Frame counter
- * \param[in]  expectedCmac   - Expected cmac
- * \retval                    - Status of the operation
- */
-static LoRaMacCryptoStatus_t VerifyCmacB0( uint8_t* msg, uint16_t len, KeyIdentifier_t keyID, bool isAck, uint8_t dir, uint32_t devAddr, uint32_t fCnt, uint32_t expectedCmac )
-{
-    if( msg == 0 )
-    {
-        return LORAMAC_CRYPTO_ERROR_NPE;
-    }
-    if( len > CRYPTO_MAXMESSAGE_SIZE )
-    {
-        return LORAMAC_CRYPTO_ERROR_BUF_SIZE;
-    }
-
-    uint8_t micBuff[CRYPTO_BUFFER_SIZE];
-    memset1( micBuff, 0, CRYPTO_BUFFER_SIZE );
-
-    // Initialize the first Block
-    PrepareB0( len, keyID, isAck, dir, devAddr, fCnt, micBuff );
-
-    // Copy the given data to the mic computation buffer
-    memcpy1( ( micBuff + MIC_BLOCK_BX_SIZE ), msg, len );
-
-    SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
-    retval = SecureElementVerifyAesCmac( micBuff, ( len + MIC_BLOCK_BX_SIZE ), expectedCmac, keyID );
-
-    if( retval == SECURE_ELEMENT_SUCCESS )
-    {
-        return LORAMAC_CRYPTO_SUCCESS;
-    }
-    else if( retval == SECURE_ELEMENT_FAIL_CMAC )
-    {
-        return LORAMAC_CRYPTO_FAIL_MIC;
-    }
-
-    return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
-}
-
 #if( USE_LRWAN_1_1_X_CRYPTO == 1 )
 /*
  * Prpares B1 block for cmac computation.
@@ -598,45 +753,6 @@ static LoRaMacCryptoStatus_t PrepareB1( uint16_t msgLen, KeyIdentifier_t keyID,
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
-
-/*
- * Computes cmac with adding B1 block in front ( only for Uplink frames LoRaWAN 1.1 )
- *
- *  cmac = aes128_cmac(keyID, B1 | msg)
- *
- * \param[IN]  msg            - Message to calculate the Integrity code
- * \param[IN]  len            - Length of message
- * \param[IN]  keyID          - Key identifier
- * \param[IN]  isAck          - True if it is a acknowledge frame ( Sets ConfFCnt in B0 block )
- * \param[IN]  txDr           - Data rate used for the transmission
- * \param[IN]  txCh           - Index of the channel used for the transmission
- * \param[IN]  devAddr        - Device address
- * \param[IN]  fCntUp         - Uplink Frame counter
- * \param[OUT] cmac           - Computed cmac
- * \retval                    - Status of the operation
- */
-static LoRaMacCryptoStatus_t ComputeCmacB1( uint8_t* msg, uint16_t len, KeyIdentifier_t keyID, bool isAck, uint8_t txDr, uint8_t txCh, uint32_t devAddr, uint32_t fCntUp, uint32_t* cmac )
-{
-    if( ( msg == 0 ) || ( cmac == 0 ) )
-    {
-        return LORAMAC_CRYPTO_ERROR_NPE;
-    }
-    if( len > CRYPTO_MAXMESSAGE_SIZE )
-    {
-        return LORAMAC_CRYPTO_ERROR_BUF_SIZE;
-    }
-
-    uint8_t micBuff[MIC_BLOCK_BX_SIZE];
-
-    // Initialize the first Block
-    PrepareB1( len, keyID, isAck, txDr, txCh, devAddr, fCntUp, micBuff );
-
-    if( SecureElementComputeAesCmac( micBuff, msg, len, keyID, cmac ) != SECURE_ELEMENT_SUCCESS )
-    {
-        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
-    }
-    return LORAMAC_CRYPTO_SUCCESS;
-}
 #endif
 
 /*
@@ -648,15 +764,13 @@ static LoRaMacCryptoStatus_t ComputeCmacB1( uint8_t* msg, uint16_t len, KeyIdent
  */
 static LoRaMacCryptoStatus_t GetKeyAddrItem( AddressIdentifier_t addrID, KeyAddr_t** item )
 {
-    for( uint8_t i = 0; i < NUM_OF_SEC_CTX; i++ )
+    // The list is indexed by the address identifier
+    if( ( addrID >= NUM_OF_SEC_CTX ) || ( KeyAddrList[addrID].AddrID != addrID ) )
     {
-        if( KeyAddrList[i].AddrID == addrID )
-        {
-            *item = &( KeyAddrList[i] );
-            return LORAMAC_CRYPTO_SUCCESS;
-        }
+        return LORAMAC_CRYPTO_ERROR_INVALID_ADDR_ID;
     }
-    return LORAMAC_CRYPTO_ERROR_INVALID_ADDR_ID;
+    *item = &( KeyAddrList[addrID] );
+    return LORAMAC_CRYPTO_SUCCESS;
 }
 
 /*
@@ -794,49 +908,19 @@ static LoRaMacCryptoStatus_t DeriveLifeTimeSessionKey( KeyIdentifier_t keyID, ui
 #endif
 
 /*
- * Gets the last received frame counter
+ * Gets the last received frame counter of a frame counter identifier
  *
  * \param[IN]     fCntID       - Frame counter identifier
- * \param[IN]     lastDown     - Last downlink counter value
  *
- * \retval                     - Status of the operation
+ * \retval                     - Last downlink counter. NULL for an invalid identifier
  */
-static LoRaMacCryptoStatus_t GetLastFcntDown( FCntIdentifier_t fCntID, uint32_t* lastDown )
+static uint32_t* GetFCntDownRef( FCntIdentifier_t fCntID )
 {
-    if( lastDown == NULL )
-    {
-        return LORAMAC_CRYPTO_ERROR_NPE;
-    }
-    switch( fCntID )
+    if( ( fCntID < N_FCNT_DOWN ) || ( fCntID > MC_FCNT_DOWN_3 ) )
     {
-        case N_FCNT_DOWN:
-            *lastDown = CryptoCtx.NvmCtx->FCntList.NFCntDown;
-            CryptoCtx.NvmCtx->LastDownFCnt = &CryptoCtx.NvmCtx->FCntList.NFCntDown;
-            break;
-        case A_FCNT_DOWN:
-            *lastDown = CryptoCtx.NvmCtx->FCntList.AFCntDown;
-            CryptoCtx.NvmCtx->LastDownFCnt = &CryptoCtx.NvmCtx->FCntList.AFCntDown;
-            break;
-        case FCNT_DOWN:
-            *lastDown = CryptoCtx.NvmCtx->FCntList.FCntDown;
-            CryptoCtx.NvmCtx->LastDownFCnt = &CryptoCtx.NvmCtx->FCntList.FCntDown;
-            break;
-        case MC_FCNT_DOWN_0:
-            *lastDown = CryptoCtx.NvmCtx->FCntList.McFCntDown0;
-            break;
-        case MC_FCNT_DOWN_1:
-            *lastDown = CryptoCtx.NvmCtx->FCntList.McFCntDown1;
-            break;
-        case MC_FCNT_DOWN_2:
-            *lastDown = CryptoCtx.NvmCtx->FCntList.McFCntDown2;
-            break;
-        case MC_FCNT_DOWN_3:
-            *lastDown = CryptoCtx.NvmCtx->FCntList.McFCntDown3;
-            break;
-        default:
-            return LORAMAC_CRYPTO_FAIL_FCNT_ID;
+        return NULL;
     }
-    return LORAMAC_CRYPTO_SUCCESS;
+    return &CryptoCtx.NvmCtx->FCntList.FCntDown[fCntID - N_FCNT_DOWN];
 }
 
 /*
@@ -849,21 +933,14 @@ static LoRaMacCryptoStatus_t GetLastFcntDown( FCntIdentifier_t fCntID, uint32_t*
  */
 static bool CheckFCntDown( FCntIdentifier_t fCntID, uint32_t currentDown )
 {
-    uint32_t lastDown = 0;
-    if( GetLastFcntDown( fCntID, &lastDown ) != LORAMAC_CRYPTO_SUCCESS )
-    {
-        return false;
-    }
-    if( ( currentDown > lastDown ) ||
-        // For LoRaWAN 1.0.X only. Allow downlink frames of 0
-        ( lastDown == FCNT_DOWN_INITAL_VALUE ) )
-    {
-        return true;
-    }
-    else
+    uint32_t* lastDown = GetFCntDownRef( fCntID );
+
+    if( lastDown == NULL )
     {
         return false;
     }
+    // For LoRaWAN 1.0.X only. Allow downlink frames of 0
+    return ( currentDown > *lastDown ) || ( *lastDown == FCNT_DOWN_INITAL_VALUE );
 }
 
 /*!
@@ -876,31 +953,17 @@ static bool CheckFCntDown( FCntIdentifier_t fCntID, uint32_t currentDown )
  */
 static void UpdateFCntDown( FCntIdentifier_t fCntID, uint32_t currentDown )
 {
-    switch( fCntID )
+    uint32_t* lastDown = GetFCntDownRef( fCntID );
+
+    if( lastDown == NULL )
     {
-        case N_FCNT_DOWN:
-            CryptoCtx.NvmCtx->FCntList.NFCntDown = currentDown;
-            break;
-        case A_FCNT_DOWN:
-            CryptoCtx.NvmCtx->FCntList.AFCntDown = currentDown;
-            break;
-        case FCNT_DOWN:
-            CryptoCtx.NvmCtx->FCntList.FCntDown = currentDown;
-            break;
-        case MC_FCNT_DOWN_0:
-            CryptoCtx.NvmCtx->FCntList.McFCntDown0 = currentDown;
-            break;
-        case MC_FCNT_DOWN_1:
-            CryptoCtx.NvmCtx->FCntList.McFCntDown1 = currentDown;
-            break;
-        case MC_FCNT_DOWN_2:
-            CryptoCtx.NvmCtx->FCntList.McFCntDown2 = currentDown;
-            break;
-        case MC_FCNT_DOWN_3:
-            CryptoCtx.NvmCtx->FCntList.McFCntDown3 = currentDown;
-            break;
-        default:
-            break;
+        return;
+    }
+    *lastDown = currentDown;
+    if( fCntID < MC_FCNT_DOWN_0 )
+    {
+        // The ConfFCnt of the next uplink acknowledges this unicast frame
+        CryptoCtx.NvmCtx->LastDownFCnt = lastDown;
     }
     CryptoCtx.EventCryptoNvmCtxChanged( );
 }
@@ -912,15 +975,12 @@ static void ResetFCnts( void )
 {
 
     CryptoCtx.NvmCtx->FCntList.FCntUp = 0;
-    CryptoCtx.NvmCtx->FCntList.NFCntDown = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->FCntList.AFCntDown = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->FCntList.FCntDown = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->LastDownFCnt = &CryptoCtx.NvmCtx->FCntList.FCntDown;
-
-    CryptoCtx.NvmCtx->FCntList.McFCntDown0 = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->FCntList.McFCntDown1 = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->FCntList.McFCntDown2 = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->FCntList.McFCntDown3 = FCNT_DOWN_INITAL_VALUE;
+    CryptoCtx.NvmCtx->FCntUpReserved = 0;
+    for( uint8_t i = 0; i < FCNT_DOWN_NB; i++ )
+    {
+        CryptoCtx.NvmCtx->FCntList.FCntDown[i] = FCNT_DOWN_INITAL_VALUE;
+    }
+    CryptoCtx.NvmCtx->LastDownFCnt = GetFCntDownRef( FCNT_DOWN );
 
     CryptoCtx.EventCryptoNvmCtxChanged( );
 }
@@ -941,6 +1001,8 @@ LoRaMacCryptoStatus_t LoRaMacCryptoInit( LoRaMacCryptoNvmEvent cryptoNvmCtxChang
 {
     // Assign non volatile context
     CryptoCtx.NvmCtx = &NvmCryptoCtx;
+    CryptoCtx.IsKeyDerivationPending = false;
+    LoRaMacCryptoDropKeyStreams( );
 
     // Assign callback
     if( cryptoNvmCtxChanged != 0 )
@@ -961,6 +1023,8 @@ LoRaMacCryptoStatus_t LoRaMacCryptoInit( LoRaMacCryptoNvmEvent cryptoNvmCtxChang
     CryptoCtx.NvmCtx->LrWanVersion.Fields.Revision = 1;
     CryptoCtx.NvmCtx->LrWanVersion.Fields.Rfu = 0;
 
+    CryptoCtx.NvmCtx->FCntUpLookahead = FCNT_UP_LOOKAHEAD_DEFAULT;
+
     // Reset frame counters
     ResetFCnts( );
 
@@ -979,6 +1043,16 @@ LoRaMacCryptoStatus_t LoRaMacCryptoRestoreNvmCtx( void* cryptoNvmCtx )
     if( cryptoNvmCtx != 0 )
     {
         memcpy1( ( uint8_t* ) &NvmCryptoCtx, ( uint8_t* ) cryptoNvmCtx, CRYPTO_NVM_CTX_SIZE );
+        // The restored session comes with its keys
+        CryptoCtx.IsKeyDerivationPending = false;
+        LoRaMacCryptoDropKeyStreams( );
+
+        // The uplinks sent after the context was stored may have used the
+        // counters up to the reserved one
+        if( NvmCryptoCtx.FCntList.FCntUp < NvmCryptoCtx.FCntUpReserved )
+        {
+            NvmCryptoCtx.FCntList.FCntUp = NvmCryptoCtx.FCntUpReserved;
+        }
         return LORAMAC_CRYPTO_SUCCESS;
     }
     else
@@ -1005,53 +1079,56 @@ LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntUp( uint32_t* currentUp )
     return LORAMAC_CRYPTO_SUCCESS;
 }
 
+LoRaMacCryptoStatus_t LoRaMacCryptoSetFCntUpLookahead( uint32_t lookahead )
+{
+    CryptoCtx.NvmCtx->FCntUpLookahead = lookahead;
+    // Applies from the next uplink
+    CryptoCtx.NvmCtx->FCntUpReserved = CryptoCtx.NvmCtx->FCntList.FCntUp;
+    CryptoCtx.EventCryptoNvmCtxChanged( );
+    return LORAMAC_CRYPTO_SUCCESS;
+}
+
+uint32_t LoRaMacCryptoGetFCntUpLookahead( void )
+{
+    return CryptoCtx.NvmCtx->FCntUpLookahead;
+}
+
 LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntDown( FCntIdentifier_t fCntID, uint16_t maxFCntGap, uint32_t frameFcnt, uint32_t* currentDown )
 {
-    uint32_t lastDown = 0;
-    int32_t fCntDiff = 0;
-    LoRaMacCryptoStatus_t cryptoStatus = LORAMAC_CRYPTO_ERROR;
+    uint32_t* lastDown = GetFCntDownRef( fCntID );
+    uint16_t fCntDiff = 0;
 
     if( currentDown == NULL )
     {
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
-
-    cryptoStatus = GetLastFcntDown( fCntID, &lastDown );
-    if( cryptoStatus != LORAMAC_CRYPTO_SUCCESS )
+    if( lastDown == NULL )
     {
-        return cryptoStatus;
+        return LORAMAC_CRYPTO_FAIL_FCNT_ID;
     }
 
     // For LoRaWAN 1.0.X only, allow downlink frames of 0
-    if( lastDown == FCNT_DOWN_INITAL_VALUE )
+    if( *lastDown == FCNT_DOWN_INITAL_VALUE )
     {
-         *currentDown = frameFcnt;
+        *currentDown = frameFcnt;
     }
     else
     {
-        // Add difference, consider roll-over
-        fCntDiff = ( int32_t )( ( int64_t )frameFcnt - ( int64_t )( lastDown & 0x0000FFFF ) );
+        // Forward distance modulo 2^16. A frame counter below the 16 LSBs of
+        // the last one is a roll-over of one uint16_t.
+        fCntDiff = ( uint16_t )( frameFcnt - *lastDown );
+        *currentDown = *lastDown + fCntDiff;
 
-        if( fCntDiff > 0 )
-        {  // Positive difference
-            *currentDown = lastDown + fCntDiff;
-        }
-        else if( fCntDiff == 0 )
+        if( fCntDiff == 0 )
         {  // Duplicate FCnt value, keep the current value.
-            *currentDown = lastDown;
             return LORAMAC_CRYPTO_FAIL_FCNT_DUPLICATED;
         }
-        else
-        {  // Negative difference, assume a roll-over of one uint16_t
-            *currentDown = ( lastDown & 0xFFFF0000 ) + 0x10000 + frameFcnt;
-        }
     }
 
-
     // For LoRaWAN 1.0.X only, check maxFCntGap
     if( CryptoCtx.NvmCtx->LrWanVersion.Fields.Minor == 0 )
     {
-        if( ( ( int64_t )*currentDown - ( int64_t )lastDown ) >= maxFCntGap )
+        if( ( ( int64_t )*currentDown - ( int64_t )*lastDown ) >= maxFCntGap )
         {
             return LORAMAC_CRYPTO_FAIL_MAX_GAP_FCNT;
         }
@@ -1067,16 +1144,23 @@ LoRaMacCryptoStatus_t LoRaMacCryptoSetMulticastReference( MulticastCtx_t* multic
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
 
-    multicastList[0].DownLinkCounter = &CryptoCtx.NvmCtx->FCntList.McFCntDown0;
-    multicastList[1].DownLinkCounter = &CryptoCtx.NvmCtx->FCntList.McFCntDown1;
-    multicastList[2].DownLinkCounter = &CryptoCtx.NvmCtx->FCntList.McFCntDown2;
-    multicastList[3].DownLinkCounter = &CryptoCtx.NvmCtx->FCntList.McFCntDown3;
+    for( uint8_t i = 0; i <= ( MC_FCNT_DOWN_3 - MC_FCNT_DOWN_0 ); i++ )
+    {
+        multicastList[i].DownLinkCounter = GetFCntDownRef( ( FCntIdentifier_t )( MC_FCNT_DOWN_0 + i ) );
+    }
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
 
 LoRaMacCryptoStatus_t LoRaMacCryptoSetKey( KeyIdentifier_t keyID, uint8_t* key )
 {
+    // The pending derivation must neither overwrite the key nor use a new
+    // root key
+    if( LoRaMacCryptoDeriveSessionKeys( ) != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+    }
+    LoRaMacCryptoDropKeyStreams( );
     if( SecureElementSetKey( keyID, key ) != SECURE_ELEMENT_SUCCESS )
     {
         return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
@@ -1155,6 +1239,12 @@ LoRaMacCryptoStatus_t LoRaMacCryptoPrepareReJoinType1( LoRaMacMessageReJoinType1
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
 
+    LoRaMacCryptoStatus_t derivationStatus = LoRaMacCryptoDeriveSessionKeys( );
+    if( derivationStatus != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return derivationStatus;
+    }
+
     // Check for RJcount1 overflow
     if( CryptoCtx.NvmCtx->RJcount1 == 65535 )
     {
@@ -1194,6 +1284,12 @@ LoRaMacCryptoStatus_t LoRaMacCryptoPrepareReJoinType0or2( LoRaMacMessageReJoinTy
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
 
+    LoRaMacCryptoStatus_t derivationStatus = LoRaMacCryptoDeriveSessionKeys( );
+    if( derivationStatus != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return derivationStatus;
+    }
+
     // Check for RJcount0 overflow
     if( CryptoCtx.RJcount0 == 65535 )
     {
@@ -1232,7 +1328,6 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
 
-    LoRaMacCryptoStatus_t retval = LORAMAC_CRYPTO_ERROR;
     KeyIdentifier_t micComputationKeyID;
     KeyIdentifier_t encryptionKeyID;
     uint8_t micComputationOffset = 0;
@@ -1296,7 +1391,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
     {
         // For legacy mode :
         //   cmac = aes128_cmac(NwkKey, MHDR |  JoinNonce | NetID | DevAddr | DLSettings | RxDelay | CFList | CFListType)
-        if( SecureElementVerifyAesCmac( macMsg->Buffer, ( macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE ), macMsg->MIC, micComputationKeyID ) != SECURE_ELEMENT_SUCCESS )
+        if( SecureElementVerifyAesCmac( NULL, macMsg->Buffer, ( macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE ), macMsg->MIC, micComputationKeyID ) != SECURE_ELEMENT_SUCCESS )
         {
             return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
         }
@@ -1318,7 +1413,7 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
 
         procBuffer[bufItr++] = macMsg->MHDR.Value;
 
-        if( SecureElementVerifyAesCmac( procBuffer,  ( macMsg->BufSize + micComputationOffset - LORAMAC_MHDR_FIELD_SIZE - LORAMAC_MIC_FIELD_SIZE ), macMsg->MIC, micComputationKeyID ) != SECURE_ELEMENT_SUCCESS )
+        if( SecureElementVerifyAesCmac( NULL, procBuffer,  ( macMsg->BufSize + micComputationOffset - LORAMAC_MHDR_FIELD_SIZE - LORAMAC_MIC_FIELD_SIZE ), macMsg->MIC, micComputationKeyID ) != SECURE_ELEMENT_SUCCESS )
         {
             return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
         }
@@ -1340,7 +1435,40 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
         }
     }
 
-    // Derive session keys
+    // The session keys are derived later on, out of the reception path. Only
+    // their inputs are kept, the RJcount0 is reset below.
+    memcpy1( CryptoCtx.JoinNonce, macMsg->JoinNonce, 3 );
+    memcpy1( CryptoCtx.NetID, macMsg->NetID, 3 );
+#if( USE_LRWAN_1_1_X_CRYPTO == 1 )
+    memcpy1( CryptoCtx.DevNonce, devNonceForKeyDerivation, 2 );
+#else
+    memcpy1( CryptoCtx.DevNonce, ( uint8_t* ) &CryptoCtx.NvmCtx->DevNonce, 2 );
+#endif
+    memcpy1( CryptoCtx.JoinEUI, joinEUI, LORAMAC_JOIN_EUI_FIELD_SIZE );
+    CryptoCtx.IsKeyDerivationPending = true;
+    LoRaMacCryptoDropKeyStreams( );
+
+    // Join-Accept is successfully processed, reset frame counters
+    CryptoCtx.RJcount0 = 0;
+    CryptoCtx.NvmCtx->FCntList.FCntUp = 0;
+    CryptoCtx.NvmCtx->FCntUpReserved = 0;
+    *GetFCntDownRef( FCNT_DOWN ) = FCNT_DOWN_INITAL_VALUE;
+    *GetFCntDownRef( N_FCNT_DOWN ) = FCNT_DOWN_INITAL_VALUE;
+    *GetFCntDownRef( A_FCNT_DOWN ) = FCNT_DOWN_INITAL_VALUE;
+    CryptoCtx.EventCryptoNvmCtxChanged( );
+
+    return LORAMAC_CRYPTO_SUCCESS;
+}
+
+LoRaMacCryptoStatus_t LoRaMacCryptoDeriveSessionKeys( void )
+{
+    LoRaMacCryptoStatus_t retval = LORAMAC_CRYPTO_ERROR;
+
+    if( CryptoCtx.IsKeyDerivationPending == false )
+    {
+        return LORAMAC_CRYPTO_SUCCESS;
+    }
+
 #if( USE_LRWAN_1_1_X_CRYPTO == 1 )
     if( CryptoCtx.NvmCtx->LrWanVersion.Fields.Minor == 1 )
     {
@@ -1357,25 +1485,25 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
             return retval;
         }
 
-        retval = DeriveSessionKey11x( F_NWK_S_INT_KEY, macMsg->JoinNonce, joinEUI, devNonceForKeyDerivation );
+        retval = DeriveSessionKey11x( F_NWK_S_INT_KEY, CryptoCtx.JoinNonce, CryptoCtx.JoinEUI, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey11x( S_NWK_S_INT_KEY, macMsg->JoinNonce, joinEUI, devNonceForKeyDerivation );
+        retval = DeriveSessionKey11x( S_NWK_S_INT_KEY, CryptoCtx.JoinNonce, CryptoCtx.JoinEUI, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey11x( NWK_S_ENC_KEY, macMsg->JoinNonce, joinEUI, devNonceForKeyDerivation );
+        retval = DeriveSessionKey11x( NWK_S_ENC_KEY, CryptoCtx.JoinNonce, CryptoCtx.JoinEUI, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey11x( APP_S_KEY, macMsg->JoinNonce, joinEUI, devNonceForKeyDerivation );
+        retval = DeriveSessionKey11x( APP_S_KEY, CryptoCtx.JoinNonce, CryptoCtx.JoinEUI, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
@@ -1397,42 +1525,75 @@ LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReq
             return retval;
         }
 
-        retval = DeriveSessionKey10x( APP_S_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* ) &CryptoCtx.NvmCtx->DevNonce );
+        retval = DeriveSessionKey10x( APP_S_KEY, CryptoCtx.JoinNonce, CryptoCtx.NetID, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey10x( NWK_S_ENC_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* ) &CryptoCtx.NvmCtx->DevNonce );
+        retval = DeriveSessionKey10x( NWK_S_ENC_KEY, CryptoCtx.JoinNonce, CryptoCtx.NetID, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey10x( F_NWK_S_INT_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* ) &CryptoCtx.NvmCtx->DevNonce );
+        retval = DeriveSessionKey10x( F_NWK_S_INT_KEY, CryptoCtx.JoinNonce, CryptoCtx.NetID, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
 
-        retval = DeriveSessionKey10x( S_NWK_S_INT_KEY, macMsg->JoinNonce, macMsg->NetID, ( uint8_t* ) &CryptoCtx.NvmCtx->DevNonce );
+        retval = DeriveSessionKey10x( S_NWK_S_INT_KEY, CryptoCtx.JoinNonce, CryptoCtx.NetID, CryptoCtx.DevNonce );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
     }
 
-    // Join-Accept is successfully processed, reset frame counters
-    CryptoCtx.RJcount0 = 0;
-    CryptoCtx.NvmCtx->FCntList.FCntUp = 0;
-    CryptoCtx.NvmCtx->FCntList.FCntDown = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->FCntList.NFCntDown = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.NvmCtx->FCntList.AFCntDown = FCNT_DOWN_INITAL_VALUE;
-    CryptoCtx.EventCryptoNvmCtxChanged( );
-
+    CryptoCtx.IsKeyDerivationPending = false;
+    LoRaMacCryptoDropKeyStreams( );
     return LORAMAC_CRYPTO_SUCCESS;
 }
 
+void LoRaMacCryptoDropKeyStreams( void )
+{
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+    KeyStreams[UPLINK].NbBlocks = 0;
+    KeyStreams[DOWNLINK].NbBlocks = 0;
+#endif
+}
+
+#if defined( LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED )
+LoRaMacCryptoStatus_t LoRaMacCryptoPrecomputeUplinkKeyStream( uint32_t devAddr, uint8_t size )
+{
+    LoRaMacCryptoStatus_t retval = LoRaMacCryptoDeriveSessionKeys( );
+
+    if( retval != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return retval;
+    }
+    // Application payloads, the FPort 0 ones use the NwkSEncKey
+    return PrecomputeKeyStream( APP_S_KEY, devAddr, UPLINK, CryptoCtx.NvmCtx->FCntList.FCntUp + 1, ( size + 15 ) >> 4 );
+}
+
+LoRaMacCryptoStatus_t LoRaMacCryptoPrecomputeDownlinkKeyStream( uint32_t devAddr )
+{
+    LoRaMacCryptoStatus_t retval = LoRaMacCryptoDeriveSessionKeys( );
+    FCntIdentifier_t fCntID = FCNT_DOWN;
+
+    if( retval != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return retval;
+    }
+    if( CryptoCtx.NvmCtx->LrWanVersion.Fields.Minor == 1 )
+    {
+        fCntID = A_FCNT_DOWN;
+    }
+    // The initial value wraps to the frame counter 0
+    return PrecomputeKeyStream( APP_S_KEY, devAddr, DOWNLINK, *GetFCntDownRef( fCntID ) + 1, CRYPTO_KEYSTREAM_DOWN_BLOCKS );
+}
+#endif
+
 LoRaMacCryptoStatus_t LoRaMacCryptoSecureMessage( uint32_t fCntUp, uint8_t txDr, uint8_t txCh, LoRaMacMessageData_t* macMsg )
 {
     LoRaMacCryptoStatus_t retval = LORAMAC_CRYPTO_ERROR;
@@ -1443,6 +1604,12 @@ LoRaMacCryptoStatus_t LoRaMacCryptoSecureMessage( uint32_t fCntUp, uint8_t txDr,
         return LORAMAC_CRYPTO_ERROR_NPE;
     }
 
+    retval = LoRaMacCryptoDeriveSessionKeys( );
+    if( retval != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return retval;
+    }
+
     if( fCntUp < CryptoCtx.NvmCtx->FCntList.FCntUp )
     {
         return LORAMAC_CRYPTO_FAIL_FCNT_SMALLER;
@@ -1457,72 +1624,100 @@ LoRaMacCryptoStatus_t LoRaMacCryptoSecureMessage( uint32_t fCntUp, uint8_t txDr,
 
     if( fCntUp > CryptoCtx.NvmCtx->FCntList.FCntUp )
     {
-        retval = PayloadEncrypt( macMsg->FRMPayload, macMsg->FRMPayloadSize, payloadDecryptionKeyID, macMsg->FHDR.DevAddr, UPLINK, fCntUp );
+        // Encrypt payload and FOpts
+        retval = DataFrameCipher( payloadDecryptionKeyID, macMsg->FHDR.DevAddr, UPLINK, FCNT_UP, fCntUp, macMsg, NULL );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
-
-#if( USE_LRWAN_1_1_X_CRYPTO == 1 )
-        if( CryptoCtx.NvmCtx->LrWanVersion.Fields.Minor == 1 )
-        {
-            // Encrypt FOpts
-            retval = FOptsEncrypt( macMsg->FHDR.FCtrl.Bits.FOptsLen, macMsg->FHDR.DevAddr, UPLINK, FCNT_UP, fCntUp, macMsg->FHDR.FOpts );
-            if( retval != LORAMAC_CRYPTO_SUCCESS )
-            {
-                return retval;
-            }
-        }
-#endif
     }
+    // A repetition of the same frame counter is sent from the same buffer.
+    // It is already serialized and only the MIC part depending on the
+    // channel and the datarate has to be computed again.
+    bool isRepetition = ( fCntUp == CryptoCtx.NvmCtx->FCntList.FCntUp );
+
     CryptoCtx.NvmCtx->FCntList.FCntUp = fCntUp;
-    CryptoCtx.EventCryptoNvmCtxChanged( );
+
+    // The context only has to be stored once the reserved counters are used
+    if( fCntUp >= CryptoCtx.NvmCtx->FCntUpReserved )
+    {
+        CryptoCtx.NvmCtx->FCntUpReserved = fCntUp + CryptoCtx.NvmCtx->FCntUpLookahead;
+        CryptoCtx.EventCryptoNvmCtxChanged( );
+    }
 
     // Serialize message
-    if( LoRaMacSerializerData( macMsg ) != LORAMAC_SERIALIZER_SUCCESS )
+    if( ( isRepetition == false ) && ( LoRaMacSerializerData( macMsg ) != LORAMAC_SERIALIZER_SUCCESS ) )
     {
         return LORAMAC_CRYPTO_ERROR_SERIALIZER;
     }
 
-    // Compute mic
+    // Compute mic over the serialized message, MIC field excluded
+    uint8_t* msg = macMsg->Buffer;
+    uint16_t msgLen = macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE;
+
 #if( USE_LRWAN_1_1_X_CRYPTO == 1 )
     if( CryptoCtx.NvmCtx->LrWanVersion.Fields.Minor == 1 )
     {
-        uint32_t cmacS = 0;
-        uint32_t cmacF = 0;
+        uint8_t b1[MIC_BLOCK_BX_SIZE];
+        uint8_t b0[MIC_BLOCK_BX_SIZE];
+        SecureElementCmd_t cmds[2];
 
-        // cmacS  = aes128_cmac(SNwkSIntKey, B1 | msg)
-        retval = ComputeCmacB1( macMsg->Buffer, ( macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE ), S_NWK_S_INT_KEY, macMsg->FHDR.FCtrl.Bits.Ack, txDr, txCh, macMsg->FHDR.DevAddr, fCntUp, &cmacS );
-        if( retval != LORAMAC_CRYPTO_SUCCESS )
+        if( msgLen > CRYPTO_MAXMESSAGE_SIZE )
         {
-            return retval;
+            return LORAMAC_CRYPTO_ERROR_BUF_SIZE;
         }
+
+        // Both CMACs are computed in a single secure element transaction
+        // cmacS  = aes128_cmac(SNwkSIntKey, B1 | msg)
+        PrepareB1( msgLen, S_NWK_S_INT_KEY, macMsg->FHDR.FCtrl.Bits.Ack, txDr, txCh, macMsg->FHDR.DevAddr, fCntUp, b1 );
+        cmds[0].Type = SECURE_ELEMENT_CMD_COMPUTE_AES_CMAC;
+        cmds[0].KeyID = S_NWK_S_INT_KEY;
+        cmds[0].MicBxBuffer = b1;
+        cmds[0].Buffer = msg;
+        cmds[0].Size = msgLen;
         //cmacF = aes128_cmac(FNwkSIntKey, B0 | msg)
-        retval = ComputeCmacB0( macMsg->Buffer, ( macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE ), F_NWK_S_INT_KEY, macMsg->FHDR.FCtrl.Bits.Ack, UPLINK, macMsg->FHDR.DevAddr, fCntUp, &cmacF );
-        if( retval != LORAMAC_CRYPTO_SUCCESS )
+        PrepareB0( msgLen, F_NWK_S_INT_KEY, macMsg->FHDR.FCtrl.Bits.Ack, UPLINK, macMsg->FHDR.DevAddr, fCntUp, b0 );
+        cmds[1].Type = SECURE_ELEMENT_CMD_COMPUTE_AES_CMAC;
+        cmds[1].KeyID = F_NWK_S_INT_KEY;
+        cmds[1].MicBxBuffer = b0;
+        cmds[1].Buffer = msg;
+        cmds[1].Size = msgLen;
+
+        // B0 doesn't depend on the channel nor on the datarate, a repetition
+        // only computes cmacS again
+        if( SecureElementProcessBatch( cmds, ( isRepetition == true ) ? 1 : 2 ) != SECURE_ELEMENT_SUCCESS )
         {
-            return retval;
+            return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
         }
+        uint32_t cmacS = cmds[0].Cmac;
+        uint32_t cmacF = ( isRepetition == true ) ? ( macMsg->MIC >> 16 ) : cmds[1].Cmac;
+
         // MIC = cmacS[0..1] | cmacF[0..1]
         macMsg->MIC = ( ( cmacF << 16 ) & 0xFFFF0000 ) | ( cmacS & 0x0000FFFF );
     }
     else
 #endif
+    if( isRepetition == true )
+    {
+        // The MIC is already in the buffer
+        return LORAMAC_CRYPTO_SUCCESS;
+    }
+    else
     {
         // MIC = cmacF[0..3]
         // The IsAck parameter is every time false since the ConfFCnt field is not used in legacy mode.
-        retval = ComputeCmacB0( macMsg->Buffer, ( macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE ), NWK_S_ENC_KEY, false, UPLINK, macMsg->FHDR.DevAddr, fCntUp, &macMsg->MIC );
+        retval = ComputeCmacB0( msg, msgLen, NWK_S_ENC_KEY, false, UPLINK, macMsg->FHDR.DevAddr, fCntUp, &macMsg->MIC );
         if( retval != LORAMAC_CRYPTO_SUCCESS )
         {
             return retval;
         }
     }
 
-    // Re-serialize message to add the MIC
-    if( LoRaMacSerializerData( macMsg ) != LORAMAC_SERIALIZER_SUCCESS )
-    {
-        return LORAMAC_CRYPTO_ERROR_SERIALIZER;
-    }
+    // Add the MIC. The remaining of the message is already serialized.
+    msg[msgLen++] = macMsg->MIC & 0xFF;
+    msg[msgLen++] = ( macMsg->MIC >> 8 ) & 0xFF;
+    msg[msgLen++] = ( macMsg->MIC >> 16 ) & 0xFF;
+    msg[msgLen++] = ( macMsg->MIC >> 24 ) & 0xFF;
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
@@ -1544,10 +1739,10 @@ LoRaMacCryptoStatus_t LoRaMacCryptoUnsecureMessage( AddressIdentifier_t addrID,
     KeyIdentifier_t micComputationKeyID = S_NWK_S_INT_KEY;
     KeyAddr_t* curItem;
 
-    // Parse the message
-    if( LoRaMacParserData( macMsg ) != LORAMAC_PARSER_SUCCESS )
+    retval = LoRaMacCryptoDeriveSessionKeys( );
+    if( retval != LORAMAC_CRYPTO_SUCCESS )
     {
-        return LORAMAC_CRYPTO_ERROR_PARSER;
+        return retval;
     }
 
     // Determine current security context
@@ -1574,37 +1769,41 @@ LoRaMacCryptoStatus_t LoRaMacCryptoUnsecureMessage( AddressIdentifier_t addrID,
         isAck = false;
     }
 
-    // Verify mic
-    retval = VerifyCmacB0( macMsg->Buffer, ( macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE ), micComputationKeyID, isAck, DOWNLINK, address, fCntDown, macMsg->MIC );
-    if( retval != LORAMAC_CRYPTO_SUCCESS )
+    uint16_t msgLen = macMsg->BufSize - LORAMAC_MIC_FIELD_SIZE;
+    uint8_t micBuff[MIC_BLOCK_BX_SIZE];
+    SecureElementCmd_t micCmd;
+
+    if( macMsg->Buffer == 0 )
     {
-        return retval;
+        return LORAMAC_CRYPTO_ERROR_NPE;
     }
+    if( msgLen > CRYPTO_MAXMESSAGE_SIZE )
+    {
+        return LORAMAC_CRYPTO_ERROR_BUF_SIZE;
+    }
+
+    // The B0 block is absorbed ahead of the message by the secure element,
+    // the message does not need to be copied behind it.
+    PrepareB0( msgLen, micComputationKeyID, isAck, DOWNLINK, address, fCntDown, micBuff );
+    micCmd.Type = SECURE_ELEMENT_CMD_COMPUTE_AES_CMAC;
+    micCmd.KeyID = micComputationKeyID;
+    micCmd.MicBxBuffer = micBuff;
+    micCmd.Buffer = macMsg->Buffer;
+    micCmd.Size = msgLen;
 
-    // Decrypt payload
     if( macMsg->FPort == 0 )
     {
         // Use network session encryption key
         payloadDecryptionKeyID = NWK_S_ENC_KEY;
     }
-    retval = PayloadEncrypt( macMsg->FRMPayload, macMsg->FRMPayloadSize, payloadDecryptionKeyID, address, DOWNLINK, fCntDown );
+
+    // Verify mic, then decrypt payload and FOpts
+    retval = DataFrameCipher( payloadDecryptionKeyID, address, DOWNLINK, fCntID, fCntDown, macMsg, &micCmd );
     if( retval != LORAMAC_CRYPTO_SUCCESS )
     {
         return retval;
     }
 
-#if( USE_LRWAN_1_1_X_CRYPTO == 1 )
-    if( CryptoCtx.NvmCtx->LrWanVersion.Fields.Minor == 1 )
-    {
-        // Decrypt FOpts
-        retval = FOptsEncrypt( macMsg->FHDR.FCtrl.Bits.FOptsLen, address, DOWNLINK, fCntID, fCntDown, macMsg->FHDR.FOpts );
-        if( retval != LORAMAC_CRYPTO_SUCCESS )
-        {
-            return retval;
-        }
-    }
-#endif
-
     UpdateFCntDown( fCntID, fCntDown );
 
     return LORAMAC_CRYPTO_SUCCESS;
@@ -1696,3 +1895,75 @@ LoRaMacCryptoStatus_t LoRaMacCryptoDeriveMcSessionKeyPair( AddressIdentifier_t a
 
     return LORAMAC_CRYPTO_SUCCESS;
 }
+
+LoRaMacCryptoStatus_t LoRaMacCryptoSetMcKeys( McChannelParams_t* channels, uint8_t nbChannels )
+{
+    SecureElementCmd_t cmds[3 * NUM_OF_MC_SEC_CTX];
+    uint8_t compBases[2 * NUM_OF_MC_SEC_CTX][16];
+    uint8_t nbCmds = 0;
+    KeyAddr_t* curItem;
+
+    if( channels == NULL )
+    {
+        return LORAMAC_CRYPTO_ERROR_NPE;
+    }
+    if( nbChannels > NUM_OF_MC_SEC_CTX )
+    {
+        return LORAMAC_CRYPTO_ERROR_BUF_SIZE;
+    }
+
+    // The pending derivation must neither overwrite the keys nor use a new
+    // root key
+    if( LoRaMacCryptoDeriveSessionKeys( ) != LORAMAC_CRYPTO_SUCCESS )
+    {
+        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+    }
+    LoRaMacCryptoDropKeyStreams( );
+
+    // The McKeys are decrypted first, one after the other with the McKEKey
+    for( uint8_t i = 0; i < nbChannels; i++ )
+    {
+        LoRaMacCryptoStatus_t retval = GetKeyAddrItem( channels[i].GroupID, &curItem );
+        if( retval != LORAMAC_CRYPTO_SUCCESS )
+        {
+            return retval;
+        }
+        if( channels[i].Address == 0 )
+        {
+            return LORAMAC_CRYPTO_ERROR_NPE;
+        }
+        cmds[nbCmds].Type = SECURE_ELEMENT_CMD_SET_KEY;
+        cmds[nbCmds].KeyID = curItem->RootKey;
+        cmds[nbCmds].Buffer = channels[i].McKeyE;
+        nbCmds++;
+    }
+
+    //McAppSKey = aes128_encrypt(McKey, 0x01 | McAddr | pad16)
+    //McNwkSKey = aes128_encrypt(McKey, 0x02 | McAddr | pad16)
+    for( uint8_t i = 0; i < ( 2 * nbChannels ); i++ )
+    {
+        McChannelParams_t* channel = &channels[i >> 1];
+
+        GetKeyAddrItem( channel->GroupID, &curItem );
+
+        memset1( compBases[i], 0, 16 );
+        compBases[i][0] = ( ( i & 0x01 ) == 0 ) ? 0x01 : 0x02;
+        compBases[i][1] = channel->Address & 0xFF;
+        compBases[i][2] = ( channel->Address >> 8 ) & 0xFF;
+        compBases[i][3] = ( channel->Address >> 16 ) & 0xFF;
+        compBases[i][4] = ( channel->Address >> 24 ) & 0xFF;
+
+        cmds[nbCmds].Type = SECURE_ELEMENT_CMD_DERIVE_AND_STORE_KEY;
+        cmds[nbCmds].Version = CryptoCtx.NvmCtx->LrWanVersion;
+        cmds[nbCmds].KeyID = curItem->RootKey;
+        cmds[nbCmds].TargetKeyID = ( ( i & 0x01 ) == 0 ) ? curItem->AppSkey : curItem->NwkSkey;
+        cmds[nbCmds].Buffer = compBases[i];
+        nbCmds++;
+    }
+
+    if( ( nbCmds > 0 ) && ( SecureElementProcessBatch( cmds, nbCmds ) != SECURE_ELEMENT_SUCCESS ) )
+    {
+        return LORAMAC_CRYPTO_ERROR_SECURE_ELEMENT_FUNC;
+    }
+    return LORAMAC_CRYPTO_SUCCESS;
+}
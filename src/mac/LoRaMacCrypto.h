@@ -195,6 +195,26 @@ LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntDown( FCntIdentifier_t fCntID, uint16_
  */
 LoRaMacCryptoStatus_t LoRaMacCryptoGetFCntUp( uint32_t* currentUp );
 
+/*!
+ * Sets the number of uplink frame counters reserved by each context change.
+ *
+ * The context change is only notified when the reserved counters are used,
+ * and the uplink counter resumes from the last reserved value after a
+ * restore. Up to lookahead counters are skipped after a reset.
+ *
+ * \param[IN]     lookahead      - Number of reserved counters. 0 and 1 notify
+ *                                 a change on every uplink.
+ * \retval                       - Status of the operation
+ */
+LoRaMacCryptoStatus_t LoRaMacCryptoSetFCntUpLookahead( uint32_t lookahead );
+
+/*!
+ * Gets the number of uplink frame counters reserved by each context change.
+ *
+ * \retval                       - Number of reserved counters
+ */
+uint32_t LoRaMacCryptoGetFCntUpLookahead( void );
+
 /*!
  * Provides multicast context.
  *
@@ -242,7 +262,8 @@ LoRaMacCryptoStatus_t LoRaMacCryptoPrepareReJoinType0or2( LoRaMacMessageReJoinTy
 
 /*!
  * Handles the join-accept message.
- * It decrypts the message, verifies the MIC and if successful derives the session keys.
+ * It decrypts the message, verifies the MIC and if successful keeps the inputs of the session keys derivation.
+ * The keys are derived by \ref LoRaMacCryptoDeriveSessionKeys, out of the reception path.
  *
  * \param[IN]     joinReqType    - Type of last join-request or rejoin which triggered the join-accept response
  * \param[IN]     joinEUI        - Join server EUI (8 byte)
@@ -251,6 +272,43 @@ LoRaMacCryptoStatus_t LoRaMacCryptoPrepareReJoinType0or2( LoRaMacMessageReJoinTy
  */
 LoRaMacCryptoStatus_t LoRaMacCryptoHandleJoinAccept( JoinReqIdentifier_t joinReqType, uint8_t* joinEUI, LoRaMacMessageJoinAccept_t* macMsg );
 
+/*!
+ * Derives the session and lifetime keys of the last accepted join, if not done yet.
+ *
+ * \remark Called from the MAC process. The functions using the session keys call it as well,
+ *         so that the keys are always derived before their first use.
+ *
+ * \retval                       - Status of the operation
+ */
+LoRaMacCryptoStatus_t LoRaMacCryptoDeriveSessionKeys( void );
+
+/*!
+ * Precomputes the payload key stream of the next uplink, so that its encryption is a plain XOR.
+ *
+ * \remark Only available when LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED is defined.
+ *
+ * \param[IN]     devAddr         - Device address
+ * \param[IN]     size            - Maximum payload size of the next uplink
+ * \retval                        - Status of the operation
+ */
+LoRaMacCryptoStatus_t LoRaMacCryptoPrecomputeUplinkKeyStream( uint32_t devAddr, uint8_t size );
+
+/*!
+ * Precomputes the first payload key stream blocks of the next expected downlink.
+ *
+ * \remark Only available when LORAMAC_KEYSTREAM_PRECOMPUTE_ENABLED is defined.
+ *
+ * \param[IN]     devAddr         - Device address
+ * \retval                        - Status of the operation
+ */
+LoRaMacCryptoStatus_t LoRaMacCryptoPrecomputeDownlinkKeyStream( uint32_t devAddr );
+
+/*!
+ * Drops the precomputed key streams. Needed when the session keys are swapped without the
+ * crypto module, as done by a LoRaMac instance switch.
+ */
+void LoRaMacCryptoDropKeyStreams( void );
+
 /*!
  * Secures a message (encryption + integrity).
  *
@@ -265,6 +323,9 @@ LoRaMacCryptoStatus_t LoRaMacCryptoSecureMessage( uint32_t fCntUp, uint8_t txDr,
 /*!
  * Unsecures a message (decryption + integrity verification).
  *
+ * \remark The payload is decrypted in place, in the serialized message.
+ *         The message must already be parsed with \ref LoRaMacParserData.
+ *
  * \param[IN]     addrID          - Address identifier
  * \param[IN]     address         - Address
  * \param[IN]     fCntID          - Frame counter identifier
@@ -310,6 +371,20 @@ LoRaMacCryptoStatus_t LoRaMacCryptoDeriveMcKEKey( KeyIdentifier_t keyID );
  */
 LoRaMacCryptoStatus_t LoRaMacCryptoDeriveMcSessionKeyPair( AddressIdentifier_t addrID, uint32_t mcAddr );
 
+/*!
+ * Sets the McKeys of several multicast groups and derives their key pairs
+ * ( McAppSKey, McNwkSKey ) in a single secure element batch
+ *
+ * The McKeys are decrypted with the same McKEKey, each pair is derived with
+ * the same McKey, the expanded keys being reused. The secure element NVM
+ * context changes once.
+ *
+ * \param[IN]     channels        - Multicast groups, GroupID, Address and McKeyE are used
+ * \param[IN]     nbChannels      - Number of multicast groups
+ * \retval                        - Status of the operation
+ */
+LoRaMacCryptoStatus_t LoRaMacCryptoSetMcKeys( McChannelParams_t* channels, uint8_t nbChannels );
+
 /*! \} addtogroup LORAMAC */
 
 #endif // __LORAMAC_CRYPTO_H__
@@ -21,6 +21,14 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ),
 #include "LoRaMacParser.h"
 #include "utilities.h"
 
+/*
+ * Offsets of the FHDR fields in a serialized data message
+ */
+#define DATA_DEV_ADDR_OFFSET            LORAMAC_MHDR_FIELD_SIZE
+#define DATA_F_CTRL_OFFSET              ( DATA_DEV_ADDR_OFFSET + LORAMAC_FHDR_DEV_ADD_FIELD_SIZE )
+#define DATA_F_CNT_OFFSET               ( DATA_F_CTRL_OFFSET + LORAMAC_FHDR_F_CTRL_FIELD_SIZE )
+#define DATA_F_OPTS_OFFSET              ( DATA_F_CNT_OFFSET + LORAMAC_FHDR_F_CNT_FIELD_SIZE )
+
 LoRaMacParserStatus_t LoRaMacParserJoinAccept( LoRaMacMessageJoinAccept_t* macMsg )
 {
     if( ( macMsg == 0 ) || ( macMsg->Buffer == 0 ) )
@@ -72,19 +80,12 @@ LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
         return LORAMAC_PARSER_ERROR_NPE;
     }
 
-    uint16_t bufItr = 0;
-
-    macMsg->MHDR.Value = macMsg->Buffer[bufItr++];
+    uint16_t bufItr = DATA_F_OPTS_OFFSET;
 
-    macMsg->FHDR.DevAddr = macMsg->Buffer[bufItr++];
-    macMsg->FHDR.DevAddr |= ( ( uint32_t ) macMsg->Buffer[bufItr++] << 8 );
-    macMsg->FHDR.DevAddr |= ( ( uint32_t ) macMsg->Buffer[bufItr++] << 16 );
-    macMsg->FHDR.DevAddr |= ( ( uint32_t ) macMsg->Buffer[bufItr++] << 24 );
-
-    macMsg->FHDR.FCtrl.Value = macMsg->Buffer[bufItr++];
-
-    macMsg->FHDR.FCnt = macMsg->Buffer[bufItr++];
-    macMsg->FHDR.FCnt |= macMsg->Buffer[bufItr++] << 8;
+    macMsg->MHDR.Value = macMsg->Buffer[0];
+    macMsg->FHDR.DevAddr = LoRaMacParserDataDevAddr( macMsg->Buffer );
+    macMsg->FHDR.FCtrl = LoRaMacParserDataFCtrl( macMsg->Buffer );
+    macMsg->FHDR.FCnt = LoRaMacParserDataFCnt( macMsg->Buffer );
 
     if( macMsg->FHDR.FCtrl.Bits.FOptsLen <= 15 )
     {
@@ -96,8 +97,10 @@ LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
         return LORAMAC_PARSER_FAIL;
     }
 
-    // Initialize anyway with zero.
+    // Initialize anyway with zero. The empty payload still points into the
+    // buffer, the decryption rejects a NULL one.
     macMsg->FPort = 0;
+    macMsg->FRMPayload = &macMsg->Buffer[bufItr];
     macMsg->FRMPayloadSize = 0;
 
     if( ( macMsg->BufSize - bufItr - LORAMAC_MIC_FIELD_SIZE ) > 0 )
@@ -105,7 +108,7 @@ LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
         macMsg->FPort = macMsg->Buffer[bufItr++];
 
         macMsg->FRMPayloadSize = ( macMsg->BufSize - bufItr - LORAMAC_MIC_FIELD_SIZE );
-        memcpy1( macMsg->FRMPayload, &macMsg->Buffer[bufItr], macMsg->FRMPayloadSize );
+        macMsg->FRMPayload = &macMsg->Buffer[bufItr];
         bufItr = bufItr + macMsg->FRMPayloadSize;
     }
 
@@ -116,3 +119,24 @@ LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t* macMsg )
 
     return LORAMAC_PARSER_SUCCESS;
 }
+
+uint32_t LoRaMacParserDataDevAddr( const uint8_t* buffer )
+{
+    const uint8_t* devAddr = &buffer[DATA_DEV_ADDR_OFFSET];
+
+    return ( uint32_t )devAddr[0] | ( ( uint32_t )devAddr[1] << 8 ) |
+           ( ( uint32_t )devAddr[2] << 16 ) | ( ( uint32_t )devAddr[3] << 24 );
+}
+
+LoRaMacFrameCtrl_t LoRaMacParserDataFCtrl( const uint8_t* buffer )
+{
+    LoRaMacFrameCtrl_t fCtrl;
+
+    fCtrl.Value = buffer[DATA_F_CTRL_OFFSET];
+    return fCtrl;
+}
+
+uint16_t LoRaMacParserDataFCnt( const uint8_t* buffer )
+{
+    return ( uint16_t )buffer[DATA_F_CNT_OFFSET] | ( ( uint16_t )buffer[DATA_F_CNT_OFFSET + 1] << 8 );
+}
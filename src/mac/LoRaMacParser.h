@@ -75,11 +75,46 @@ LoRaMacParserStatus_t LoRaMacParserJoinAccept( LoRaMacMessageJoinAccept_t *macMs
 /*!
  * Parse a serialized data message and fills the structured object.
  *
+ * \remark The FRMPayload field points into the serialized message, the
+ *         payload is not copied.
+ *
  * \param[IN/OUT] macMsg       - Data message object
  * \retval                     - Status of the operation
  */
 LoRaMacParserStatus_t LoRaMacParserData( LoRaMacMessageData_t *macMsg );
 
+/*!
+ * Reads the device address of a serialized data message, without parsing it.
+ *
+ * \remark The buffer must hold at least the MHDR and the FHDR.
+ *
+ * \param[IN]     buffer       - Serialized data message
+ * \retval                     - Device address
+ */
+uint32_t LoRaMacParserDataDevAddr( const uint8_t* buffer );
+
+/*!
+ * Reads the frame control field of a serialized data message, without
+ * parsing it.
+ *
+ * \remark The buffer must hold at least the MHDR and the FHDR.
+ *
+ * \param[IN]     buffer       - Serialized data message
+ * \retval                     - Frame control field
+ */
+LoRaMacFrameCtrl_t LoRaMacParserDataFCtrl( const uint8_t* buffer );
+
+/*!
+ * Reads the 16 LSBs of the frame counter of a serialized data message,
+ * without parsing it.
+ *
+ * \remark The buffer must hold at least the MHDR and the FHDR.
+ *
+ * \param[IN]     buffer       - Serialized data message
+ * \retval                     - Frame counter 16 LSBs
+ */
+uint16_t LoRaMacParserDataFCnt( const uint8_t* buffer );
+
 /*! \} addtogroup LORAMAC */
 
 #endif // __LORAMAC_PARSER_H__
@@ -0,0 +1,216 @@
+/*!
+ * \file      LoRaMacRetry.c
+ *
+ * \brief     LoRa MAC confirmed uplinks retry policies
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include "utilities.h"
+#include "region/Region.h"
+#include "LoRaMacRetry.h"
+
+/*!
+ * Number of acknowledgements after which the RX windows statistics are
+ * halved, so that they follow the link changes
+ */
+#define LORAMAC_RETRY_ACK_HISTORY_LEN               16
+
+/*
+ * Adaptive policy acknowledgements history
+ */
+typedef struct sRetryHistory
+{
+    /*!
+     * Failure score of each channel
+     */
+    uint8_t ChannelScores[LORAMAC_RETRY_NB_CHANNELS];
+    /*!
+     * Number of acknowledgements received in the RX1 window
+     */
+    uint8_t NbAckRx1;
+    /*!
+     * Number of acknowledgements received in the RX2 window
+     */
+    uint8_t NbAckRx2;
+    /*!
+     * Mean acknowledgements SNR [dB]
+     */
+    int8_t Snr;
+}RetryHistory_t;
+
+static RetryHistory_t RetryHistory;
+
+/*!
+ * \brief Gets the datarate below the one of the previous transmission
+ *
+ * \param [IN] params Retransmission parameters
+ *
+ * \retval datarate Next lower datarate
+ */
+static int8_t GetNextLowerDatarate( LoRaMacRetryParams_t* params )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    getPhy.Attribute = PHY_NEXT_LOWER_TX_DR;
+    getPhy.UplinkDwellTime = params->UplinkDwellTime;
+    getPhy.Datarate = params->Datarate;
+    phyParam = RegionGetPhyParam( params->Region, &getPhy );
+    return phyParam.Value;
+}
+
+static TimerTime_t DefaultGetAckTimeout( LoRaMacRetryParams_t* params, TimerTime_t ackTimeout )
+{
+    return ackTimeout;
+}
+
+static int8_t DefaultGetRetryDatarate( LoRaMacRetryParams_t* params )
+{
+    if( ( params->Trial % 2 ) == 1 )
+    {
+        return GetNextLowerDatarate( params );
+    }
+    return params->Datarate;
+}
+
+static void AdaptiveReset( void )
+{
+    memset1( ( uint8_t* )&RetryHistory, 0, sizeof( RetryHistory ) );
+}
+
+static void AdaptiveOnAck( uint8_t channel, LoRaMacRxSlot_t ackSlot, int8_t snr )
+{
+    if( ackSlot == RX_SLOT_NONE )
+    {
+        if( ( channel < LORAMAC_RETRY_NB_CHANNELS ) && ( RetryHistory.ChannelScores[channel] < UINT8_MAX ) )
+        {
+            RetryHistory.ChannelScores[channel]++;
+        }
+        return;
+    }
+
+    if( channel < LORAMAC_RETRY_NB_CHANNELS )
+    {
+        RetryHistory.ChannelScores[channel] /= 2;
+    }
+    if( ( RetryHistory.NbAckRx1 + RetryHistory.NbAckRx2 ) == 0 )
+    {
+        RetryHistory.Snr = snr;
+    }
+    else
+    {
+        RetryHistory.Snr = ( ( 3 * RetryHistory.Snr ) + snr ) / 4;
+    }
+
+    if( ackSlot == RX_SLOT_WIN_1 )
+    {
+        RetryHistory.NbAckRx1++;
+    }
+    else
+    {
+        RetryHistory.NbAckRx2++;
+    }
+    if( ( RetryHistory.NbAckRx1 + RetryHistory.NbAckRx2 ) >= LORAMAC_RETRY_ACK_HISTORY_LEN )
+    {
+        RetryHistory.NbAckRx1 /= 2;
+        RetryHistory.NbAckRx2 /= 2;
+    }
+}
+
+/*!
+ * \brief Verifies if the acknowledgements history shows a weak link at the
+ *        datarate of the previous transmission
+ *
+ * \param [IN] params Retransmission parameters
+ *
+ * \retval weak Returns true if the link is weak
+ */
+static bool IsLinkWeak( LoRaMacRetryParams_t* params )
+{
+    GetPhyParams_t getPhy;
+    PhyParam_t phyParam;
+
+    // The RX1 datarate follows the uplink one, a slower uplink makes the RX1
+    // acknowledgements more robust
+    if( RetryHistory.NbAckRx2 > RetryHistory.NbAckRx1 )
+    {
+        return true;
+    }
+
+    getPhy.Attribute = PHY_SPREADING_FACTOR;
+    getPhy.Datarate = params->Datarate;
+    phyParam = RegionGetPhyParam( params->Region, &getPhy );
+    if( ( phyParam.Value < 7 ) || ( phyParam.Value > 12 ) )
+    {
+        // No demodulation floor for the FSK datarates
+        return false;
+    }
+    // Demodulation floor [0.5 dB], -7.5 dB at SF7, 2.5 dB lower per spreading
+    // factor
+    return ( 2 * RetryHistory.Snr ) < ( ( 20 - ( 5 * ( int16_t )phyParam.Value ) ) + ( 2 * LORAMAC_RETRY_SNR_MARGIN ) );
+}
+
+static TimerTime_t AdaptiveGetAckTimeout( LoRaMacRetryParams_t* params, TimerTime_t ackTimeout )
+{
+    if( ( ( RetryHistory.NbAckRx1 + RetryHistory.NbAckRx2 ) == 0 ) || ( IsLinkWeak( params ) == true ) )
+    {
+        return ackTimeout;
+    }
+    // The acknowledgements are rather missed because of collisions. Spread
+    // the retransmissions of the colliding devices.
+    return ackTimeout + randr( 0, ackTimeout * ( ( 1 << MIN( params->Trial - 1, 3 ) ) - 1 ) );
+}
+
+static int8_t AdaptiveGetRetryDatarate( LoRaMacRetryParams_t* params )
+{
+    if( ( RetryHistory.NbAckRx1 + RetryHistory.NbAckRx2 ) == 0 )
+    {
+        return DefaultGetRetryDatarate( params );
+    }
+    if( IsLinkWeak( params ) == true )
+    {
+        return GetNextLowerDatarate( params );
+    }
+    if( params->Trial <= LORAMAC_RETRY_KEEP_DR_TRIALS )
+    {
+        return params->Datarate;
+    }
+    return DefaultGetRetryDatarate( params );
+}
+
+static bool AdaptiveIsChannelAvoided( uint8_t channel )
+{
+    return ( channel < LORAMAC_RETRY_NB_CHANNELS ) &&
+           ( RetryHistory.ChannelScores[channel] >= LORAMAC_RETRY_CHANNEL_AVOID_SCORE );
+}
+
+const LoRaMacRetryPolicy_t LoRaMacRetryPolicyDefault =
+{
+    .Reset = NULL,
+    .OnAck = NULL,
+    .GetAckTimeout = DefaultGetAckTimeout,
+    .GetRetryDatarate = DefaultGetRetryDatarate,
+    .IsChannelAvoided = NULL,
+};
+
+const LoRaMacRetryPolicy_t LoRaMacRetryPolicyAdaptive =
+{
+    .Reset = AdaptiveReset,
+    .OnAck = AdaptiveOnAck,
+    .GetAckTimeout = AdaptiveGetAckTimeout,
+    .GetRetryDatarate = AdaptiveGetRetryDatarate,
+    .IsChannelAvoided = AdaptiveIsChannelAvoided,
+};
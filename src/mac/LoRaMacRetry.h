@@ -0,0 +1,181 @@
+/*!
+ * \file      LoRaMacRetry.h
+ *
+ * \brief     LoRa MAC confirmed uplinks retry policies
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \defgroup  LORAMACRETRY LoRa MAC confirmed uplinks retry policies
+ *            A retry policy selects, for each retransmission of a confirmed
+ *            uplink whose acknowledgement was missed, the delay before it is
+ *            sent, its datarate and the channels it avoids. The MAC reports
+ *            the outcome of every transmission of a confirmed uplink to the
+ *            policy.
+ * \{
+ */
+#ifndef __LORAMACRETRY_H__
+#define __LORAMACRETRY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "LoRaMac.h"
+
+/*!
+ * Number of channels whose failures are recorded by the adaptive retry policy
+ */
+#ifndef LORAMAC_RETRY_NB_CHANNELS
+#define LORAMAC_RETRY_NB_CHANNELS                   96
+#endif
+
+/*!
+ * Failure score from which the adaptive retry policy avoids a channel. A
+ * missed acknowledgement adds 1, a received one halves the score.
+ */
+#ifndef LORAMAC_RETRY_CHANNEL_AVOID_SCORE
+#define LORAMAC_RETRY_CHANNEL_AVOID_SCORE           2
+#endif
+
+/*!
+ * Maximum number of channels drawn for a retransmission, the last one is
+ * kept even if the policy avoids it
+ */
+#ifndef LORAMAC_RETRY_CHANNEL_DRAWS
+#define LORAMAC_RETRY_CHANNEL_DRAWS                 3
+#endif
+
+/*!
+ * Margin of the acknowledgements SNR above the demodulation floor of the
+ * datarate under which the adaptive retry policy considers the link weak [dB]
+ */
+#ifndef LORAMAC_RETRY_SNR_MARGIN
+#define LORAMAC_RETRY_SNR_MARGIN                    5
+#endif
+
+/*!
+ * Number of transmissions the adaptive retry policy keeps the datarate for
+ * on a good link
+ */
+#ifndef LORAMAC_RETRY_KEEP_DR_TRIALS
+#define LORAMAC_RETRY_KEEP_DR_TRIALS                3
+#endif
+
+/*!
+ * Parameters of a confirmed uplink transmission
+ */
+typedef struct sLoRaMacRetryParams
+{
+    /*!
+     * Transmission number, 1 for the first transmission of the uplink
+     */
+    uint8_t Trial;
+    /*!
+     * Number of transmissions allowed for the uplink
+     */
+    uint8_t NbTrials;
+    /*!
+     * Datarate of the previous transmission
+     */
+    int8_t Datarate;
+    /*!
+     * UplinkDwellTime
+     */
+    uint8_t UplinkDwellTime;
+    /*!
+     * Region
+     */
+    LoRaMacRegion_t Region;
+}LoRaMacRetryParams_t;
+
+/*!
+ * Confirmed uplinks retry policy
+ */
+typedef struct sLoRaMacRetryPolicy
+{
+    /*!
+     * \brief Drops the recorded history. Called at the network activation
+     *        and when the region changes. May be NULL.
+     */
+    void ( *Reset )( void );
+    /*!
+     * \brief Records the outcome of a transmission of a confirmed uplink. May
+     *        be NULL.
+     *
+     * \param [IN] channel Channel of the transmission
+     * \param [IN] ackSlot Window the acknowledgement was received in,
+     *                     RX_SLOT_NONE when it was missed
+     * \param [IN] snr     Acknowledgement SNR [dB]
+     */
+    void ( *OnAck )( uint8_t channel, LoRaMacRxSlot_t ackSlot, int8_t snr );
+    /*!
+     * \brief Gets the time the MAC waits after the RX2 window opening before
+     *        it declares the acknowledgement missed and retransmits.
+     *
+     * \param [IN] params     Parameters of the transmission just sent
+     * \param [IN] ackTimeout Randomized ACK timeout of the region [ms]
+     *
+     * \retval timeout ACK timeout [ms]
+     */
+    TimerTime_t ( *GetAckTimeout )( LoRaMacRetryParams_t* params, TimerTime_t ackTimeout );
+    /*!
+     * \brief Gets the datarate of a retransmission. Only called for the
+     *        LoRaWAN 1.0.x retransmissions.
+     *
+     * \param [IN] params Parameters of the retransmission, the datarate is
+     *                    the one of the previous transmission
+     *
+     * \retval datarate Datarate of the retransmission
+     */
+    int8_t ( *GetRetryDatarate )( LoRaMacRetryParams_t* params );
+    /*!
+     * \brief Verifies if a retransmission should avoid a channel. The MAC then
+     *        draws another channel, a few times at most. May be NULL.
+     *
+     * \param [IN] channel Channel selected by the region
+     *
+     * \retval avoided Returns true if another channel should be drawn
+     */
+    bool ( *IsChannelAvoided )( uint8_t channel );
+}LoRaMacRetryPolicy_t;
+
+/*!
+ * LoRaWAN retries: region ACK timeout, the datarate is lowered every 2
+ * transmissions. Default policy.
+ */
+extern const LoRaMacRetryPolicy_t LoRaMacRetryPolicyDefault;
+
+/*!
+ * Retries adapted to the observed acknowledgements.
+ *
+ * The link is weak when the mean acknowledgements SNR is less than
+ * \ref LORAMAC_RETRY_SNR_MARGIN above the demodulation floor of the datarate,
+ * or when most acknowledgements are received in the RX2 window, the RX1
+ * datarate following the uplink one. A retransmission on a weak link lowers
+ * the datarate right away.
+ *
+ * On a good link the missed acknowledgements are rather caused by collisions.
+ * The datarate is kept for \ref LORAMAC_RETRY_KEEP_DR_TRIALS transmissions
+ * and the ACK timeout is randomly extended, up to 8 times, with the
+ * transmission number. Without acknowledgement history the policy behaves as
+ * \ref LoRaMacRetryPolicyDefault.
+ *
+ * The retransmissions avoid the channels whose failure score reached
+ * \ref LORAMAC_RETRY_CHANNEL_AVOID_SCORE.
+ */
+extern const LoRaMacRetryPolicy_t LoRaMacRetryPolicyAdaptive;
+
+/*! \} defgroup LORAMACRETRY */
+
+#endif // __LORAMACRETRY_H__
@@ -36,6 +36,123 @@
 #ifndef __LORAMACTEST_H__
 #define __LORAMACTEST_H__
 
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * MAC states counted by the profiling. Several states may be active at once,
+ * the hooks report them as a bit mask of ( 1 << state ).
+ */
+typedef enum eLoRaMacProfileState
+{
+    /*!
+     * No other state active
+     */
+    LORAMAC_PROFILE_STATE_IDLE = 0,
+    LORAMAC_PROFILE_STATE_STOPPED,
+    /*!
+     * From the frame transmission up to the end of its reception windows
+     */
+    LORAMAC_PROFILE_STATE_TX_RUNNING,
+    LORAMAC_PROFILE_STATE_RX,
+    LORAMAC_PROFILE_STATE_ACK_RETRY,
+    /*!
+     * Waiting for the duty-cycle or for a gap between the ping slots
+     */
+    LORAMAC_PROFILE_STATE_TX_DELAYED,
+    LORAMAC_PROFILE_STATE_TX_CONFIG,
+    LORAMAC_PROFILE_STATE_RX_ABORT,
+    /*!
+     * Listen before talk channel activity detection
+     */
+    LORAMAC_PROFILE_STATE_LBT_CAD,
+    LORAMAC_PROFILE_STATE_MAX,
+}LoRaMacProfileState_t;
+
+/*!
+ * Events passes of LoRaMacProcess counted by the profiling
+ */
+typedef enum eLoRaMacProfilePass
+{
+    /*!
+     * Radio events processing
+     */
+    LORAMAC_PROFILE_PASS_IRQ_EVENTS = 0,
+    /*!
+     * Requests completion and confirms
+     */
+    LORAMAC_PROFILE_PASS_REQUEST_EVENTS,
+    /*!
+     * Indications
+     */
+    LORAMAC_PROFILE_PASS_INDICATION_EVENTS,
+    LORAMAC_PROFILE_PASS_MAX,
+}LoRaMacProfilePass_t;
+
+/*!
+ * Requests timed by the profiling, from their acceptance to their confirm
+ */
+typedef enum eLoRaMacProfileRequest
+{
+    LORAMAC_PROFILE_REQUEST_MCPS_UNCONFIRMED = 0,
+    LORAMAC_PROFILE_REQUEST_MCPS_CONFIRMED,
+    LORAMAC_PROFILE_REQUEST_MCPS_PROPRIETARY,
+    /*!
+     * All the MLME requests, from the first one accepted to the confirms
+     */
+    LORAMAC_PROFILE_REQUEST_MLME,
+    LORAMAC_PROFILE_REQUEST_MAX,
+}LoRaMacProfileRequest_t;
+
+/*!
+ * MAC profiling hooks. The members may be NULL.
+ */
+typedef struct sLoRaMacProfileHooks
+{
+    /*!
+     * \brief Called on every MAC state change, from the context of the change
+     *        which may be an interrupt
+     *
+     * \param [IN] oldStates Previous states, bit mask of ( 1 << \ref LoRaMacProfileState_t )
+     * \param [IN] newStates New states, bit mask of ( 1 << \ref LoRaMacProfileState_t )
+     */
+    void ( *OnStateChange )( uint16_t oldStates, uint16_t newStates );
+    /*!
+     * \brief Called after every events pass of LoRaMacProcess
+     *
+     * \param [IN] pass     Events pass
+     * \param [IN] duration Pass duration [us]
+     */
+    void ( *OnEventsPass )( LoRaMacProfilePass_t pass, uint32_t duration );
+}LoRaMacProfileHooks_t;
+
+/*!
+ * MAC profiling counters
+ */
+typedef struct sLoRaMacProfileStats
+{
+    /*!
+     * Time spent in each state [ms]. The overlapping states are all counted.
+     */
+    uint32_t StateTime[LORAMAC_PROFILE_STATE_MAX];
+    /*!
+     * Processing time of the events passes [us]
+     */
+    uint32_t PassTime[LORAMAC_PROFILE_PASS_MAX];
+    /*!
+     * Number of events passes
+     */
+    uint32_t NbPasses[LORAMAC_PROFILE_PASS_MAX];
+    /*!
+     * Time from the requests acceptance to their confirm [ms]
+     */
+    uint32_t RequestTime[LORAMAC_PROFILE_REQUEST_MAX];
+    /*!
+     * Number of confirmed requests
+     */
+    uint32_t NbRequests[LORAMAC_PROFILE_REQUEST_MAX];
+}LoRaMacProfileStats_t;
+
 /*!
  * \brief   Enabled or disables the duty cycle
  *
@@ -46,6 +163,44 @@
  */
 void LoRaMacTestSetDutyCycleOn( bool enable );
 
+/*!
+ * \brief   Processes a MAC commands buffer as received in a downlink frame
+ *
+ * \details This is a test function. It shall be used for testing purposes only.
+ *          The answers are added to the MAC commands list as for a received
+ *          downlink frame.
+ *
+ * \param   [IN] payload - MAC commands buffer
+ * \param   [IN] size    - MAC commands buffer size
+ * \param   [IN] snr     - SNR of the downlink frame carrying the commands
+ */
+void LoRaMacTestProcessMacCommands( uint8_t* payload, uint8_t size, int8_t snr );
+
+/*!
+ * \brief   Sets the MAC profiling hooks
+ *
+ * \details This is a test function. The hooks are only called when
+ *          LORAMAC_PROFILE_ENABLED is defined, the profiling compiles away
+ *          otherwise.
+ *
+ * \param   [IN] hooks - Profiling hooks, NULL to remove them. Must stay valid
+ *                       while set.
+ */
+void LoRaMacTestSetProfileHooks( const LoRaMacProfileHooks_t* hooks );
+
+/*!
+ * \brief   Gets the MAC profiling counters
+ *
+ * \details This is a test function. The time spent in the current state is
+ *          included.
+ *
+ * \param   [OUT] stats - Profiling counters
+ * \param   [IN]  reset - Restarts the counting when true
+ *
+ * \retval  [true: counters read, false: LORAMAC_PROFILE_ENABLED not defined]
+ */
+bool LoRaMacTestGetProfileStats( LoRaMacProfileStats_t* stats, bool reset );
+
 /*! \} defgroup LORAMACTEST */
 
 #endif // __LORAMACTEST_H__
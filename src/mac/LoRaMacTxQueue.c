@@ -0,0 +1,362 @@
+/*!
+ * \file      LoRaMacTxQueue.c
+ *
+ * \brief     LoRa MAC uplink queue implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utilities.h"
+#include "LoRaMac.h"
+#include "LoRaMacTxQueue.h"
+
+#ifdef LORAMAC_TX_QUEUE_ENABLED
+
+/*
+ * Uplink queue element
+ */
+typedef struct sLoRaMacTxQueueElement
+{
+    /*!
+     * MCPS request type
+     */
+    Mcps_t Type;
+    /*!
+     * Frame port. Not used for proprietary frames.
+     */
+    uint8_t FPort;
+    /*!
+     * Uplink datarate, if ADR is off
+     */
+    int8_t Datarate;
+    /*!
+     * Number of trials of a confirmed frame
+     */
+    uint8_t NbTrials;
+    /*!
+     * Payload offset in the queue buffer
+     */
+    uint16_t Offset;
+    /*!
+     * Payload size
+     */
+    uint16_t Size;
+}LoRaMacTxQueueElement_t;
+
+/*
+ * LoRaMac uplink queue context structure
+ */
+typedef struct sLoRaMacTxQueueCtx
+{
+    /*!
+    * Queued requests, in the order they were added
+    */
+    LoRaMacTxQueueElement_t Elements[LORAMAC_TX_QUEUE_LEN];
+    /*!
+    * Number of queued requests
+    */
+    uint8_t Cnt;
+    /*!
+    * Payloads of the queued requests, in the order they were added
+    */
+    uint8_t Buffer[LORAMAC_TX_QUEUE_BUFFER_SIZE];
+    /*!
+    * Number of used bytes in Buffer
+    */
+    uint16_t BufferSize;
+}LoRaMacTxQueueCtx_t;
+
+/*
+ * Module context.
+ */
+static LoRaMacTxQueueCtx_t TxQueueCtx;
+
+/*!
+ * \brief Gets the send priority of an element
+ *
+ * \param [IN] element Queue element
+ *
+ * \retval priority 0 is the highest priority
+ */
+static uint8_t GetPriority( LoRaMacTxQueueElement_t* element )
+{
+    if( ( element->Type != MCPS_PROPRIETARY ) && ( element->Size == 0 ) )
+    {
+        // MAC commands only
+        return 0;
+    }
+    if( element->Type == MCPS_CONFIRMED )
+    {
+        return 1;
+    }
+    return 2;
+}
+
+/*!
+ * \brief Gets the index of the next element to send
+ *
+ * \retval index Element index. The queue must not be empty.
+ */
+static uint8_t GetNextIndex( void )
+{
+    uint8_t next = 0;
+
+    for( uint8_t i = 1; i < TxQueueCtx.Cnt; i++ )
+    {
+        if( GetPriority( &TxQueueCtx.Elements[i] ) < GetPriority( &TxQueueCtx.Elements[next] ) )
+        {
+            next = i;
+        }
+    }
+    return next;
+}
+
+/*!
+ * \brief Removes the first bytes of the payload of an element
+ *
+ * \param [IN] index Element index
+ * \param [IN] size  Number of bytes to remove
+ */
+static void RemovePayloadHead( uint8_t index, uint16_t size )
+{
+    LoRaMacTxQueueElement_t* element = &TxQueueCtx.Elements[index];
+    uint16_t offset = element->Offset;
+
+    // The payloads are stored in the elements order. Move the following
+    // bytes down, the forward copy handles the overlap.
+    memcpy1( &TxQueueCtx.Buffer[offset], &TxQueueCtx.Buffer[offset + size], TxQueueCtx.BufferSize - offset - size );
+    TxQueueCtx.BufferSize -= size;
+    element->Size -= size;
+
+    for( uint8_t i = index + 1; i < TxQueueCtx.Cnt; i++ )
+    {
+        TxQueueCtx.Elements[i].Offset -= size;
+    }
+}
+
+/*!
+ * \brief Removes an element and its payload from the queue
+ *
+ * \param [IN] index Element index
+ */
+static void RemoveElement( uint8_t index )
+{
+    RemovePayloadHead( index, TxQueueCtx.Elements[index].Size );
+
+    for( uint8_t i = index; i < ( TxQueueCtx.Cnt - 1 ); i++ )
+    {
+        TxQueueCtx.Elements[i] = TxQueueCtx.Elements[i + 1];
+    }
+    TxQueueCtx.Cnt--;
+}
+
+/*!
+ * \brief Fills the MCPS request parameters of an element
+ *
+ * \param [IN]  element     Queue element
+ * \param [IN]  buffer      Payload buffer
+ * \param [IN]  size        Payload size
+ * \param [OUT] mcpsRequest MCPS request
+ */
+static void GetRequest( LoRaMacTxQueueElement_t* element, uint8_t* buffer, uint16_t size, McpsReq_t* mcpsRequest )
+{
+    mcpsRequest->Type = element->Type;
+    if( element->Type == MCPS_PROPRIETARY )
+    {
+        mcpsRequest->Req.Proprietary.fBuffer = buffer;
+        mcpsRequest->Req.Proprietary.fBufferSize = size;
+        mcpsRequest->Req.Proprietary.Datarate = element->Datarate;
+    }
+    else
+    {
+        // The confirmed request parameters start with the unconfirmed ones
+        mcpsRequest->Req.Unconfirmed.fPort = element->FPort;
+        mcpsRequest->Req.Unconfirmed.fBuffer = buffer;
+        mcpsRequest->Req.Unconfirmed.fBufferSize = size;
+        mcpsRequest->Req.Unconfirmed.Datarate = element->Datarate;
+        if( element->Type == MCPS_CONFIRMED )
+        {
+            mcpsRequest->Req.Confirmed.NbTrials = element->NbTrials;
+        }
+    }
+}
+
+#endif // LORAMAC_TX_QUEUE_ENABLED
+
+void LoRaMacTxQueueInit( void )
+{
+#ifdef LORAMAC_TX_QUEUE_ENABLED
+    TxQueueCtx.Cnt = 0;
+    TxQueueCtx.BufferSize = 0;
+#endif // LORAMAC_TX_QUEUE_ENABLED
+}
+
+LoRaMacStatus_t LoRaMacTxQueueAdd( McpsReq_t* mcpsRequest )
+{
+#ifdef LORAMAC_TX_QUEUE_ENABLED
+    LoRaMacTxQueueElement_t* element;
+    uint8_t* fBuffer;
+    uint16_t fBufferSize;
+
+    if( TxQueueCtx.Cnt >= LORAMAC_TX_QUEUE_LEN )
+    {
+        return LORAMAC_STATUS_BUSY;
+    }
+    element = &TxQueueCtx.Elements[TxQueueCtx.Cnt];
+
+    switch( mcpsRequest->Type )
+    {
+        case MCPS_UNCONFIRMED:
+        {
+            element->FPort = mcpsRequest->Req.Unconfirmed.fPort;
+            element->Datarate = mcpsRequest->Req.Unconfirmed.Datarate;
+            element->NbTrials = 0;
+            fBuffer = mcpsRequest->Req.Unconfirmed.fBuffer;
+            fBufferSize = mcpsRequest->Req.Unconfirmed.fBufferSize;
+            break;
+        }
+        case MCPS_CONFIRMED:
+        {
+            element->FPort = mcpsRequest->Req.Confirmed.fPort;
+            element->Datarate = mcpsRequest->Req.Confirmed.Datarate;
+            element->NbTrials = mcpsRequest->Req.Confirmed.NbTrials;
+            fBuffer = mcpsRequest->Req.Confirmed.fBuffer;
+            fBufferSize = mcpsRequest->Req.Confirmed.fBufferSize;
+            break;
+        }
+        case MCPS_PROPRIETARY:
+        {
+            element->FPort = 0;
+            element->Datarate = mcpsRequest->Req.Proprietary.Datarate;
+            element->NbTrials = 0;
+            fBuffer = mcpsRequest->Req.Proprietary.fBuffer;
+            fBufferSize = mcpsRequest->Req.Proprietary.fBufferSize;
+            break;
+        }
+        default:
+            return LORAMAC_STATUS_SERVICE_UNKNOWN;
+    }
+
+    if( fBuffer == NULL )
+    {
+        fBufferSize = 0;
+    }
+    if( fBufferSize > LORAMAC_FRAME_PAYLOAD_MAX_SIZE )
+    {
+        return LORAMAC_STATUS_LENGTH_ERROR;
+    }
+    if( fBufferSize > ( LORAMAC_TX_QUEUE_BUFFER_SIZE - TxQueueCtx.BufferSize ) )
+    {
+        // A payload larger than the whole buffer can never be queued
+        return ( fBufferSize > LORAMAC_TX_QUEUE_BUFFER_SIZE ) ? LORAMAC_STATUS_LENGTH_ERROR : LORAMAC_STATUS_BUSY;
+    }
+
+    element->Type = mcpsRequest->Type;
+    element->Offset = TxQueueCtx.BufferSize;
+    element->Size = fBufferSize;
+    memcpy1( &TxQueueCtx.Buffer[element->Offset], fBuffer, fBufferSize );
+    TxQueueCtx.BufferSize += fBufferSize;
+    TxQueueCtx.Cnt++;
+
+    return LORAMAC_STATUS_OK;
+#else
+    return LORAMAC_STATUS_BUSY;
+#endif // LORAMAC_TX_QUEUE_ENABLED
+}
+
+bool LoRaMacTxQueuePeek( McpsReq_t* mcpsRequest )
+{
+#ifdef LORAMAC_TX_QUEUE_ENABLED
+    LoRaMacTxQueueElement_t* element;
+
+    if( TxQueueCtx.Cnt == 0 )
+    {
+        return false;
+    }
+    element = &TxQueueCtx.Elements[GetNextIndex( )];
+    GetRequest( element, NULL, element->Size, mcpsRequest );
+    return true;
+#else
+    return false;
+#endif // LORAMAC_TX_QUEUE_ENABLED
+}
+
+bool LoRaMacTxQueuePop( McpsReq_t* mcpsRequest, uint8_t* buffer, uint16_t maxSize )
+{
+#ifdef LORAMAC_TX_QUEUE_ENABLED
+    LoRaMacTxQueueElement_t next;
+    uint16_t size;
+    uint8_t i;
+
+    if( TxQueueCtx.Cnt == 0 )
+    {
+        return false;
+    }
+    i = GetNextIndex( );
+    next = TxQueueCtx.Elements[i];
+
+    if( ( maxSize > 0 ) && ( next.Size > maxSize ) )
+    {
+        // Split the payload, the remaining bytes are sent by the next frames
+        memcpy1( buffer, &TxQueueCtx.Buffer[next.Offset], maxSize );
+        RemovePayloadHead( i, maxSize );
+        GetRequest( &next, buffer, maxSize, mcpsRequest );
+        return true;
+    }
+
+    // Take the next request
+    memcpy1( buffer, &TxQueueCtx.Buffer[next.Offset], next.Size );
+    size = next.Size;
+    RemoveElement( i );
+
+    // Then the following requests of the same kind while they fit in the frame
+    while( ( next.Type != MCPS_PROPRIETARY ) && ( i < TxQueueCtx.Cnt ) )
+    {
+        LoRaMacTxQueueElement_t* element = &TxQueueCtx.Elements[i];
+
+        if( ( element->Type == next.Type ) && ( element->FPort == next.FPort ) &&
+            ( element->Datarate == next.Datarate ) && ( element->NbTrials == next.NbTrials ) &&
+            ( ( element->Size == 0 ) == ( next.Size == 0 ) ) &&
+            ( ( size + element->Size ) <= maxSize ) )
+        {
+            memcpy1( &buffer[size], &TxQueueCtx.Buffer[element->Offset], element->Size );
+            size += element->Size;
+            RemoveElement( i );
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    GetRequest( &next, buffer, size, mcpsRequest );
+    return true;
+#else
+    return false;
+#endif // LORAMAC_TX_QUEUE_ENABLED
+}
+
+uint8_t LoRaMacTxQueueGetCnt( void )
+{
+#ifdef LORAMAC_TX_QUEUE_ENABLED
+    return TxQueueCtx.Cnt;
+#else
+    return 0;
+#endif // LORAMAC_TX_QUEUE_ENABLED
+}
@@ -0,0 +1,120 @@
+/*!
+ * \file      LoRaMacTxQueue.h
+ *
+ * \brief     LoRa MAC uplink queue implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \defgroup  LORAMACTXQUEUE LoRa MAC uplink queue implementation
+ *            This module holds the MCPS requests issued while the LoRaMAC is
+ *            busy. The payloads are copied into a buffer of
+ *            \ref LORAMAC_TX_QUEUE_BUFFER_SIZE bytes shared by up to
+ *            \ref LORAMAC_TX_QUEUE_LEN requests.
+ *
+ *            The requests are sent by priority, then in the order they were
+ *            added:
+ *            - Empty frames, which only carry the pending MAC commands
+ *            - Confirmed frames
+ *            - Unconfirmed and proprietary frames
+ *
+ *            Requests of the same type, frame port and datarate are sent in a
+ *            single frame as long as their payloads fit in it. A single
+ *            MCPS-Confirm is then issued for all of them.
+ *
+ *            A queued payload larger than the frame, e.g. at a low datarate
+ *            with the uplink dwell time enabled, is split across consecutive
+ *            frames. Each frame issues its own MCPS-Confirm.
+ *
+ *            The module is only active when LORAMAC_TX_QUEUE_ENABLED is
+ *            defined.
+ * \{
+ */
+#ifndef __LORAMAC_TXQUEUE_H__
+#define __LORAMAC_TXQUEUE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LoRaMac.h"
+
+/*!
+ * Maximum number of queued MCPS requests
+ */
+#ifndef LORAMAC_TX_QUEUE_LEN
+#define LORAMAC_TX_QUEUE_LEN                        4
+#endif
+
+/*!
+ * Size of the buffer holding the payloads of the queued MCPS requests
+ */
+#ifndef LORAMAC_TX_QUEUE_BUFFER_SIZE
+#define LORAMAC_TX_QUEUE_BUFFER_SIZE                128
+#endif
+
+/*!
+ * \brief   Initializes the uplink queue. All queued requests are dropped.
+ */
+void LoRaMacTxQueueInit( void );
+
+/*!
+ * \brief   Adds a copy of an MCPS request to the queue.
+ *
+ * \param   [IN] mcpsRequest - MCPS request to add. The payload is copied.
+ *
+ * \retval  LoRaMacStatus_t Status of the operation. Possible returns are:
+ *          \ref LORAMAC_STATUS_OK,
+ *          \ref LORAMAC_STATUS_BUSY if the queue is full or disabled,
+ *          \ref LORAMAC_STATUS_SERVICE_UNKNOWN,
+ *          \ref LORAMAC_STATUS_PARAMETER_INVALID,
+ *          \ref LORAMAC_STATUS_LENGTH_ERROR.
+ */
+LoRaMacStatus_t LoRaMacTxQueueAdd( McpsReq_t* mcpsRequest );
+
+/*!
+ * \brief   Gets the parameters of the next request to send.
+ *
+ * \param   [OUT] mcpsRequest - Parameters of the next request. The payload
+ *                              pointer is set to NULL.
+ *
+ * \retval  [true - a request is queued, false - the queue is empty]
+ */
+bool LoRaMacTxQueuePeek( McpsReq_t* mcpsRequest );
+
+/*!
+ * \brief   Removes the next request to send from the queue, together with the
+ *          following requests which can be sent in the same frame.
+ *
+ * \param   [OUT] mcpsRequest - Request to send. The payload points to buffer.
+ *
+ * \param   [IN]  buffer - Buffer receiving the payload of the frame.
+ *
+ * \param   [IN]  maxSize - Maximum payload size of the frame. A larger payload
+ *                          of the next request is split, its remaining bytes
+ *                          stay queued for the next frames. A size of 0 takes
+ *                          the whole payload.
+ *
+ * \retval  [true - a request was removed, false - the queue is empty]
+ */
+bool LoRaMacTxQueuePop( McpsReq_t* mcpsRequest, uint8_t* buffer, uint16_t maxSize );
+
+/*!
+ * \brief   Query number of queued requests.
+ *
+ * \retval  Number of queued requests.
+ */
+uint8_t LoRaMacTxQueueGetCnt( void );
+
+#endif // __LORAMAC_TXQUEUE_H__
@@ -552,6 +552,29 @@ typedef enum eLoRaMacSrvCmd
     SRV_MAC_BEACON_FREQ_REQ          = 0x13,
 }LoRaMacSrvCmd_t;
 
+#ifdef DUTY_CYCLE_BUDGET_ENABLED
+/*!
+ * Duty-cycle observation window [ms]
+ */
+#define BAND_DC_BUDGET_WINDOW                       3600000
+
+/*!
+ * Number of buckets the airtime of a band is accounted in over the
+ * observation window. The airtime of a bucket is held on 16 bits, a bucket
+ * must not be longer than 10 minutes.
+ */
+#ifndef BAND_DC_BUDGET_NB_BUCKETS
+#define BAND_DC_BUDGET_NB_BUCKETS                   12
+#endif
+
+/*!
+ * Initial value of the airtime budget fields of a band
+ */
+#define BAND_DC_BUDGET_INIT                         , { 0 }, 0
+#else
+#define BAND_DC_BUDGET_INIT
+#endif // DUTY_CYCLE_BUDGET_ENABLED
+
 /*!
  * LoRaMAC band parameters definition
  */
@@ -577,6 +600,18 @@ typedef struct sBand
      * Holds the time where the device is off
      */
     TimerTime_t TimeOff;
+#ifdef DUTY_CYCLE_BUDGET_ENABLED
+    /*!
+     * Airtime in ms of the frames sent in the buckets of the observation
+     * window. Ring buffer indexed by the bucket number, it holds one more
+     * bucket than the window so that a frame is accounted for a whole window.
+     */
+    uint16_t Airtime[BAND_DC_BUDGET_NB_BUCKETS + 1];
+    /*!
+     * Number of the current bucket, time in ms divided by the bucket length
+     */
+    uint32_t Bucket;
+#endif // DUTY_CYCLE_BUDGET_ENABLED
 }Band_t;
 
 /*!
@@ -46,6 +46,12 @@
  *              - #define REGION_IN865
  *              - #define REGION_US915
  *              - #define REGION_RU864
+ *              - #define REGION_CUSTOM, channel plan compiled from a descriptor
+ *
+ *            - When a single region is defined, the region API calls are
+ *              resolved at compile time. Linking with link time optimization
+ *              ( REGION_SINGLE_LTO_ENABLED=ON ) then folds the region parameters
+ *              and tables into the MAC layer.
  *
  * \{
  */
@@ -58,6 +64,22 @@
 #include "LoRaMac.h"
 #include "timer.h"
 
+#if ( defined( REGION_AS923 ) + defined( REGION_AU915 ) + defined( REGION_CN470 ) + defined( REGION_CN779 ) + defined( REGION_EU433 ) + \
+      defined( REGION_EU868 ) + defined( REGION_KR920 ) + defined( REGION_IN865 ) + defined( REGION_US915 ) + defined( REGION_RU864 ) + \
+      defined( REGION_CUSTOM ) ) == 1
+/*!
+ * Only one region is part of the build
+ */
+#define REGION_SINGLE
+#elif ( defined( REGION_AS923 ) + defined( REGION_AU915 ) + defined( REGION_CN470 ) + defined( REGION_CN779 ) + defined( REGION_EU433 ) + \
+        defined( REGION_EU868 ) + defined( REGION_KR920 ) + defined( REGION_IN865 ) + defined( REGION_US915 ) + defined( REGION_RU864 ) + \
+        defined( REGION_CUSTOM ) ) > 1
+/*!
+ * Several regions are part of the build
+ */
+#define REGION_MULTIPLE
+#endif
+
 /*!
  * Macro to compute bit of a channel index.
  */
@@ -795,7 +817,12 @@ typedef enum ePhyAttribute
     /*!
      * The datarate of a ping slot channel.
      */
-    PHY_PING_SLOT_CHANNEL_DR
+    PHY_PING_SLOT_CHANNEL_DR,
+    /*!
+     * The spreading factor of a datarate. The FSK datarates report their
+     * bitrate [kbps] and the RFU datarates 0.
+     */
+    PHY_SPREADING_FACTOR
 }PhyAttribute_t;
 
 /*!
@@ -924,6 +951,10 @@ typedef struct sSetBandTxDoneParams
      * Last TX done time.
      */
     TimerTime_t LastTxDoneTime;
+    /*!
+     * Time-on-air of the last TX frame.
+     */
+    TimerTime_t LastTxAirTime;
 }SetBandTxDoneParams_t;
 
 /*!
@@ -1050,9 +1081,17 @@ typedef struct sRxConfigParams
      */
      uint32_t WindowTimeout;
     /*!
-     * RX window offset
+     * RX window offset, rounded up to the millisecond
      */
     int32_t WindowOffset;
+    /*!
+     * RX window offset in microseconds
+     */
+    int32_t WindowOffsetUs;
+    /*!
+     * RX symbol time in microseconds
+     */
+    uint32_t SymbolTimeUs;
     /*!
      * Downlink dwell time.
      */
@@ -1100,6 +1139,15 @@ typedef struct sTxConfigParams
      * Frame length to setup.
      */
     uint16_t PktLen;
+    /*!
+     * Intra-packet frequency hopping period [symbols], 0 disables the
+     * hopping. Applies to the regions supporting it.
+     */
+    uint8_t HopPeriod;
+    /*!
+     * Seed of the frequency hopping sequence.
+     */
+    uint32_t HopSeed;
 }TxConfigParams_t;
 
 /*!
@@ -1233,10 +1281,6 @@ typedef struct sCalcBackOffParams
      * Set to true, if the node has already joined a network, otherwise false.
      */
     bool Joined;
-    /*!
-     * Joined Set to true, if the last uplink was a join request
-     */
-    bool LastTxIsJoinRequest;
     /*!
      * Set to true, if the duty cycle is enabled, otherwise false.
      */
@@ -1245,14 +1289,14 @@ typedef struct sCalcBackOffParams
      * Current channel index.
      */
     uint8_t Channel;
-    /*!
-     * Elapsed time since the start of the node.
-     */
-    SysTime_t ElapsedTime;
     /*!
      * Time-on-air of the last transmission.
      */
     TimerTime_t TxTimeOnAir;
+    /*!
+     * Current time, read once by the MAC for the whole back-off update.
+     */
+    TimerTime_t CurrentTime;
 }CalcBackOffParams_t;
 
 /*!
@@ -1280,6 +1324,10 @@ typedef struct sNextChanParams
      * Set to true, if the duty cycle is enabled, otherwise false.
      */
     bool DutyCycleEnabled;
+    /*!
+     * Current time, read once by the MAC for the whole back-off update.
+     */
+    TimerTime_t CurrentTime;
 }NextChanParams_t;
 
 /*!
@@ -1683,6 +1731,37 @@ uint8_t RegionApplyDrOffset( LoRaMacRegion_t region, uint8_t downlinkDwellTime,
  */
 void RegionRxBeaconSetup( LoRaMacRegion_t region, RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr );
 
+/*!
+ * \brief Gets the time-on-air of an uplink frame without involving the radio
+ *        driver
+ *
+ * \remark Constant time integer computation, suitable for the uplink
+ *         scheduling path.
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval txTimeOnAir The time-on-air of the frame [ms]
+ */
+TimerTime_t RegionGetTimeOnAir( LoRaMacRegion_t region, int8_t datarate, uint8_t payloadLen );
+
+/*!
+ * \brief Gets the time-on-air of a downlink frame without involving the radio
+ *        driver
+ *
+ * \param [IN] region LoRaWAN region.
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval rxTimeOnAir The time-on-air of the frame [us]
+ */
+uint32_t RegionGetRxTimeOnAirUs( LoRaMacRegion_t region, int8_t datarate, uint8_t payloadLen );
+
 /*! \} defgroup REGION */
 
 #endif // __REGION_H__
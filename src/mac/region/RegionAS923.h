@@ -251,7 +251,7 @@
  * Band 0 definition
  * { DutyCycle, TxMaxPower, LastJoinTxDoneTime, LastTxDoneTime, TimeOff }
  */
-#define AS923_BAND0                                 { 100, AS923_MAX_TX_POWER, 0, 0, 0 } //  1.0 %
+#define AS923_BAND0                                 { 100, AS923_MAX_TX_POWER, 0, 0, 0 BAND_DC_BUDGET_INIT } //  1.0 %
 
 /*!
  * LoRaMac default channel 1
@@ -541,6 +541,28 @@ uint8_t RegionAS923ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
  */
  void RegionAS923RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr );
 
+/*!
+ * \brief Gets the time-on-air of an uplink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval txTimeOnAir The time-on-air of the frame [ms]
+ */
+TimerTime_t RegionAS923GetTimeOnAir( int8_t datarate, uint8_t payloadLen );
+
+/*!
+ * \brief Gets the time-on-air of a downlink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval rxTimeOnAir The time-on-air of the frame [us]
+ */
+uint32_t RegionAS923GetRxTimeOnAirUs( int8_t datarate, uint8_t payloadLen );
+
 /*! \} defgroup REGIONAS923 */
 
 #endif // __REGION_AS923_H__
@@ -44,10 +44,6 @@
  */
 typedef struct sRegionAU915NvmCtx
 {
-    /*!
-     * LoRaMAC channels
-     */
-    ChannelParams_t Channels[ AU915_MAX_NB_CHANNELS ];
     /*!
      * LoRaMac bands
      */
@@ -66,6 +62,41 @@ typedef struct sRegionAU915NvmCtx
     uint16_t ChannelsDefaultMask[ CHANNELS_MASK_SIZE ];
 }RegionAU915NvmCtx_t;
 
+/*!
+ * 125 kHz channel of index i in its group
+ */
+#define AU915_125KHZ_CHANNEL( i )         { .Frequency = 915200000 + ( i ) * 200000, .Rx1Frequency = 0, \
+                                            .DrRange.Value = ( DR_5 << 4 ) | DR_0, .Band = 0 }
+
+/*!
+ * Group of 8 consecutive channels starting at index i
+ */
+#define AU915_125KHZ_CHANNEL_8( i )     AU915_125KHZ_CHANNEL( i ), AU915_125KHZ_CHANNEL( i + 1 ), AU915_125KHZ_CHANNEL( i + 2 ), AU915_125KHZ_CHANNEL( i + 3 ), \
+                                        AU915_125KHZ_CHANNEL( i + 4 ), AU915_125KHZ_CHANNEL( i + 5 ), AU915_125KHZ_CHANNEL( i + 6 ), AU915_125KHZ_CHANNEL( i + 7 )
+
+/*!
+ * 500 kHz channel of index i in its group
+ */
+#define AU915_500KHZ_CHANNEL( i )         { .Frequency = 915900000 + ( i ) * 1600000, .Rx1Frequency = 0, \
+                                            .DrRange.Value = ( DR_6 << 4 ) | DR_6, .Band = 0 }
+
+/*!
+ * Group of 8 consecutive channels starting at index i
+ */
+#define AU915_500KHZ_CHANNEL_8( i )     AU915_500KHZ_CHANNEL( i ), AU915_500KHZ_CHANNEL( i + 1 ), AU915_500KHZ_CHANNEL( i + 2 ), AU915_500KHZ_CHANNEL( i + 3 ), \
+                                        AU915_500KHZ_CHANNEL( i + 4 ), AU915_500KHZ_CHANNEL( i + 5 ), AU915_500KHZ_CHANNEL( i + 6 ), AU915_500KHZ_CHANNEL( i + 7 )
+
+/*!
+ * LoRaMAC channels. The channel plan of the region is fixed, the channels are
+ * fully determined by their index and are not part of the context.
+ */
+static const ChannelParams_t Channels[ AU915_MAX_NB_CHANNELS ] =
+{
+    AU915_125KHZ_CHANNEL_8( 0 ), AU915_125KHZ_CHANNEL_8( 8 ), AU915_125KHZ_CHANNEL_8( 16 ), AU915_125KHZ_CHANNEL_8( 24 ),
+    AU915_125KHZ_CHANNEL_8( 32 ), AU915_125KHZ_CHANNEL_8( 40 ), AU915_125KHZ_CHANNEL_8( 48 ), AU915_125KHZ_CHANNEL_8( 56 ),
+    AU915_500KHZ_CHANNEL_8( 0 ),
+};
+
 /*
  * Non-volatile module context.
  */
@@ -140,40 +171,6 @@ static bool VerifyRfFreq( uint32_t freq )
     return true;
 }
 
-static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
-{
-    uint8_t nbEnabledChannels = 0;
-    uint8_t delayTransmission = 0;
-
-    for( uint8_t i = 0, k = 0; i < AU915_MAX_NB_CHANNELS; i += 16, k++ )
-    {
-        for( uint8_t j = 0; j < 16; j++ )
-        {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
-        }
-    }
-
-    *delayTx = delayTransmission;
-    return nbEnabledChannels;
-}
-
 PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
 {
     PhyParam_t phyParam = { 0 };
@@ -226,6 +223,11 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = AU915_MAX_TX_POWER;
             break;
         }
+        case PHY_SPREADING_FACTOR:
+        {
+            phyParam.Value = DataratesAU915[getPhy->Datarate];
+            break;
+        }
         case PHY_DEF_TX_POWER:
         {
             phyParam.Value = AU915_DEFAULT_TX_POWER;
@@ -337,7 +339,8 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_CHANNELS:
         {
-            phyParam.Channels = NvmCtx.Channels;
+            // Read only, the channel plan is fixed
+            phyParam.Channels = ( ChannelParams_t* )Channels;
             break;
         }
         case PHY_DEF_UPLINK_DWELL_TIME:
@@ -398,7 +401,7 @@ PhyParam_t RegionAU915GetPhyParam( GetPhyParams_t* getPhy )
 
 void RegionAU915SetBandTxDone( SetBandTxDoneParams_t* txDone )
 {
-    RegionCommonSetBandTxDone( txDone->Joined, &NvmCtx.Bands[NvmCtx.Channels[txDone->Channel].Band], txDone->LastTxDoneTime );
+    RegionCommonSetBandTxDone( txDone->Joined, &NvmCtx.Bands[Channels[txDone->Channel].Band], txDone->LastTxDoneTime, txDone->LastTxAirTime );
 }
 
 void RegionAU915InitDefaults( InitDefaultsParams_t* params )
@@ -415,22 +418,6 @@ void RegionAU915InitDefaults( InitDefaultsParams_t* params )
             // Initialize bands
             memcpy1( ( uint8_t* )NvmCtx.Bands, ( uint8_t* )bands, sizeof( Band_t ) * AU915_MAX_NB_BANDS );
 
-            // Channels
-            // 125 kHz channels
-            for( uint8_t i = 0; i < AU915_MAX_NB_CHANNELS - 8; i++ )
-            {
-                NvmCtx.Channels[i].Frequency = 915200000 + i * 200000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_5 << 4 ) | DR_0;
-                NvmCtx.Channels[i].Band = 0;
-            }
-            // 500 kHz channels
-            for( uint8_t i = AU915_MAX_NB_CHANNELS - 8; i < AU915_MAX_NB_CHANNELS; i++ )
-            {
-                NvmCtx.Channels[i].Frequency = 915900000 + ( i - ( AU915_MAX_NB_CHANNELS - 8 ) ) * 1600000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_6 << 4 ) | DR_6;
-                NvmCtx.Channels[i].Band = 0;
-            }
-
             // Initialize channels default mask
             NvmCtx.ChannelsDefaultMask[0] = 0xFFFF;
             NvmCtx.ChannelsDefaultMask[1] = 0xFFFF;
@@ -459,10 +446,8 @@ void RegionAU915InitDefaults( InitDefaultsParams_t* params )
             // Copy channels default mask
             RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, NvmCtx.ChannelsDefaultMask, 6 );
 
-            for( uint8_t i = 0; i < 6; i++ )
-            { // Copy-And the channels mask
-                NvmCtx.ChannelsMaskRemaining[i] &= NvmCtx.ChannelsMask[i];
-            }
+            // Copy-And the channels mask
+            RegionCommonChanMaskAnd( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, 6 );
             break;
         }
         default:
@@ -563,10 +548,8 @@ bool RegionAU915ChanMaskSet( ChanMaskSetParams_t* chanMaskSet )
             NvmCtx.ChannelsDefaultMask[4] = NvmCtx.ChannelsDefaultMask[4] & CHANNELS_MASK_500KHZ_MASK;
             NvmCtx.ChannelsDefaultMask[5] = 0x0000;
 
-            for( uint8_t i = 0; i < 6; i++ )
-            { // Copy-And the channels mask
-                NvmCtx.ChannelsMaskRemaining[i] &= NvmCtx.ChannelsMask[i];
-            }
+            // Copy-And the channels mask
+            RegionCommonChanMaskAnd( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, 6 );
             break;
         }
         case CHANNELS_DEFAULT_MASK:
@@ -582,7 +565,7 @@ bool RegionAU915ChanMaskSet( ChanMaskSetParams_t* chanMaskSet )
 
 void RegionAU915ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams )
 {
-    double tSymbol = 0.0;
+    RegionCommonSymbolTime_t tSymbol = 0;
 
     // Get the datarate, perform a boundary check
     rxConfigParams->Datarate = MIN( datarate, AU915_RX_MAX_DATARATE );
@@ -590,7 +573,8 @@ void RegionAU915ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
 
     tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesAU915[rxConfigParams->Datarate], BandwidthsAU915[rxConfigParams->Datarate] );
 
-    RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, Radio.GetWakeupTime( ), &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
+    RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, Radio.GetWakeupTime( ), &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset, &rxConfigParams->WindowOffsetUs );
+    rxConfigParams->SymbolTimeUs = RegionCommonSymbolTimeToUs( tSymbol );
 }
 
 bool RegionAU915RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
@@ -636,7 +620,7 @@ bool RegionAU915RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
 bool RegionAU915TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir )
 {
     int8_t phyDr = DataratesAU915[txConfig->Datarate];
-    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[NvmCtx.Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
     uint32_t bandwidth = GetBandwidth( txConfig->Datarate );
     int8_t phyTxPower = 0;
 
@@ -644,14 +628,14 @@ bool RegionAU915TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime
     phyTxPower = RegionCommonComputeTxPower( txPowerLimited, txConfig->MaxEirp, txConfig->AntennaGain );
 
     // Setup the radio frequency
-    Radio.SetChannel( NvmCtx.Channels[txConfig->Channel].Frequency );
+    Radio.SetChannel( Channels[txConfig->Channel].Frequency );
 
     Radio.SetTxConfig( MODEM_LORA, phyTxPower, 0, bandwidth, phyDr, 1, 8, false, true, 0, 0, false, 4000 );
 
     // Setup maximum payload lenght of the radio driver
     Radio.SetMaxPayloadLength( MODEM_LORA, txConfig->PktLen );
 
-    *txTimeOnAir = Radio.TimeOnAir( MODEM_LORA, txConfig->PktLen );
+    *txTimeOnAir = RegionAU915GetTimeOnAir( txConfig->Datarate, txConfig->PktLen );
     *txPower = txPowerLimited;
 
     return true;
@@ -787,7 +771,7 @@ uint8_t RegionAU915LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     linkAdrVerifyParams.ChannelsMask = channelsMask;
     linkAdrVerifyParams.MinDatarate = ( int8_t )phyParam.Value;
     linkAdrVerifyParams.MaxDatarate = AU915_TX_MAX_DATARATE;
-    linkAdrVerifyParams.Channels = NvmCtx.Channels;
+    linkAdrVerifyParams.Channels = Channels;
     linkAdrVerifyParams.MinTxPower = AU915_MIN_TX_POWER;
     linkAdrVerifyParams.MaxTxPower = AU915_MAX_TX_POWER;
     linkAdrVerifyParams.Version = linkAdrReq->Version;
@@ -801,10 +785,7 @@ uint8_t RegionAU915LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
         // Copy Mask
         RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, channelsMask, 6 );
 
-        NvmCtx.ChannelsMaskRemaining[0] &= NvmCtx.ChannelsMask[0];
-        NvmCtx.ChannelsMaskRemaining[1] &= NvmCtx.ChannelsMask[1];
-        NvmCtx.ChannelsMaskRemaining[2] &= NvmCtx.ChannelsMask[2];
-        NvmCtx.ChannelsMaskRemaining[3] &= NvmCtx.ChannelsMask[3];
+        RegionCommonChanMaskAnd( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, 4 );
         NvmCtx.ChannelsMaskRemaining[4] = NvmCtx.ChannelsMask[4];
         NvmCtx.ChannelsMaskRemaining[5] = NvmCtx.ChannelsMask[5];
     }
@@ -888,14 +869,13 @@ void RegionAU915CalcBackOff( CalcBackOffParams_t* calcBackOff )
 {
     RegionCommonCalcBackOffParams_t calcBackOffParams;
 
-    calcBackOffParams.Channels = NvmCtx.Channels;
+    calcBackOffParams.Channels = Channels;
     calcBackOffParams.Bands = NvmCtx.Bands;
-    calcBackOffParams.LastTxIsJoinRequest = calcBackOff->LastTxIsJoinRequest;
     calcBackOffParams.Joined = calcBackOff->Joined;
     calcBackOffParams.DutyCycleEnabled = calcBackOff->DutyCycleEnabled;
     calcBackOffParams.Channel = calcBackOff->Channel;
-    calcBackOffParams.ElapsedTime = calcBackOff->ElapsedTime;
     calcBackOffParams.TxTimeOnAir = calcBackOff->TxTimeOnAir;
+    calcBackOffParams.CurrentTime = calcBackOff->CurrentTime;
 
     RegionCommonCalcBackOff( &calcBackOffParams );
 }
@@ -905,6 +885,7 @@ LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTx = 0;
     uint8_t enabledChannels[AU915_MAX_NB_CHANNELS] = { 0 };
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
     TimerTime_t nextTxDelay = 0;
 
     // Count 125kHz channels
@@ -921,19 +902,24 @@ LoRaMacStatus_t RegionAU915NextChannel( NextChanParams_t* nextChanParams, uint8_
         }
     }
 
-    TimerTime_t elapsed = TimerGetElapsedTime( nextChanParams->LastAggrTx );
+    TimerTime_t elapsed = TimerGetElapsedTimeAt( nextChanParams->LastAggrTx, nextChanParams->CurrentTime );
     if( ( nextChanParams->LastAggrTx == 0 ) || ( nextChanParams->AggrTimeOff <= elapsed ) )
     {
         // Reset Aggregated time off
         *aggregatedTimeOff = 0;
 
         // Update bands Time OFF
-        nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, NvmCtx.Bands, AU915_MAX_NB_BANDS );
+        nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, NvmCtx.Bands, AU915_MAX_NB_BANDS, nextChanParams->CurrentTime );
 
         // Search how many channels are enabled
-        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate,
-                                                      NvmCtx.ChannelsMaskRemaining, NvmCtx.Channels,
-                                                      NvmCtx.Bands, enabledChannels, &delayTx );
+        countChannelsParams.Joined = nextChanParams->Joined;
+        countChannelsParams.Datarate = nextChanParams->Datarate;
+        countChannelsParams.ChannelsMask = NvmCtx.ChannelsMaskRemaining;
+        countChannelsParams.Channels = Channels;
+        countChannelsParams.Bands = NvmCtx.Bands;
+        countChannelsParams.MaxNbChannels = AU915_MAX_NB_CHANNELS;
+        countChannelsParams.JoinChannels = 0xFFFF; // All channels may be used to join
+        nbEnabledChannels = RegionCommonCountNbOfEnabledChannels( &countChannelsParams, enabledChannels, &delayTx );
     }
     else
     {
@@ -977,9 +963,9 @@ bool RegionAU915ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 
 void RegionAU915SetContinuousWave( ContinuousWaveParams_t* continuousWave )
 {
-    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[NvmCtx.Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
     int8_t phyTxPower = 0;
-    uint32_t frequency = NvmCtx.Channels[continuousWave->Channel].Frequency;
+    uint32_t frequency = Channels[continuousWave->Channel].Frequency;
 
     // Calculate physical TX power
     phyTxPower = RegionCommonComputeTxPower( txPowerLimited, continuousWave->MaxEirp, continuousWave->AntennaGain );
@@ -1022,3 +1008,13 @@ void RegionAU915RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr )
     // Store downlink datarate
     *outDr = AU915_BEACON_CHANNEL_DR;
 }
+
+TimerTime_t RegionAU915GetTimeOnAir( int8_t datarate, uint8_t payloadLen )
+{
+    return RegionCommonComputeTimeOnAir( DataratesAU915[datarate], BandwidthsAU915[datarate], payloadLen );
+}
+
+uint32_t RegionAU915GetRxTimeOnAirUs( int8_t datarate, uint8_t payloadLen )
+{
+    return RegionCommonComputeTimeOnAirUs( DataratesAU915[datarate], BandwidthsAU915[datarate], payloadLen, false );
+}
@@ -247,7 +247,7 @@
  * Band 0 definition
  * { DutyCycle, TxMaxPower, LastJoinTxDoneTime, LastTxDoneTime, TimeOff }
  */
-#define AU915_BAND0                                 { 1, AU915_MAX_TX_POWER, 0, 0, 0 } //  100.0 %
+#define AU915_BAND0                                 { 1, AU915_MAX_TX_POWER, 0, 0, 0 BAND_DC_BUDGET_INIT } //  100.0 %
 
 /*!
  * Defines the first channel for RX window 1 for US band
@@ -535,6 +535,28 @@ uint8_t RegionAU915ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
  */
  void RegionAU915RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr );
 
+/*!
+ * \brief Gets the time-on-air of an uplink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval txTimeOnAir The time-on-air of the frame [ms]
+ */
+TimerTime_t RegionAU915GetTimeOnAir( int8_t datarate, uint8_t payloadLen );
+
+/*!
+ * \brief Gets the time-on-air of a downlink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval rxTimeOnAir The time-on-air of the frame [us]
+ */
+uint32_t RegionAU915GetRxTimeOnAirUs( int8_t datarate, uint8_t payloadLen );
+
 /*! \} defgroup REGIONAU915 */
 
 #endif // __REGION_AU915_H__
@@ -41,10 +41,6 @@
  */
 typedef struct sRegionCN470NvmCtx
 {
-    /*!
-     * LoRaMAC channels
-     */
-    ChannelParams_t Channels[ CN470_MAX_NB_CHANNELS ];
     /*!
      * LoRaMac bands
      */
@@ -59,6 +55,31 @@ typedef struct sRegionCN470NvmCtx
     uint16_t ChannelsDefaultMask[ CHANNELS_MASK_SIZE ];
 }RegionCN470NvmCtx_t;
 
+/*!
+ * 125 kHz channel of index i in its group. The RX1 frequency is the downlink
+ * channel the uplink channel maps to.
+ */
+#define CN470_125KHZ_CHANNEL( i )         { .Frequency = 470300000 + ( i ) * 200000,                                        \
+                                            .Rx1Frequency = CN470_FIRST_RX1_CHANNEL + ( ( i ) % 48 ) * CN470_STEPWIDTH_RX1_CHANNEL, \
+                                            .DrRange.Value = ( DR_5 << 4 ) | DR_0, .Band = 0 }
+
+/*!
+ * Group of 8 consecutive channels starting at index i
+ */
+#define CN470_125KHZ_CHANNEL_8( i )     CN470_125KHZ_CHANNEL( i ), CN470_125KHZ_CHANNEL( i + 1 ), CN470_125KHZ_CHANNEL( i + 2 ), CN470_125KHZ_CHANNEL( i + 3 ), \
+                                        CN470_125KHZ_CHANNEL( i + 4 ), CN470_125KHZ_CHANNEL( i + 5 ), CN470_125KHZ_CHANNEL( i + 6 ), CN470_125KHZ_CHANNEL( i + 7 )
+
+/*!
+ * LoRaMAC channels. The channel plan of the region is fixed, the channels are
+ * fully determined by their index and are not part of the context.
+ */
+static const ChannelParams_t Channels[ CN470_MAX_NB_CHANNELS ] =
+{
+    CN470_125KHZ_CHANNEL_8( 0 ), CN470_125KHZ_CHANNEL_8( 8 ), CN470_125KHZ_CHANNEL_8( 16 ), CN470_125KHZ_CHANNEL_8( 24 ),
+    CN470_125KHZ_CHANNEL_8( 32 ), CN470_125KHZ_CHANNEL_8( 40 ), CN470_125KHZ_CHANNEL_8( 48 ), CN470_125KHZ_CHANNEL_8( 56 ),
+    CN470_125KHZ_CHANNEL_8( 64 ), CN470_125KHZ_CHANNEL_8( 72 ), CN470_125KHZ_CHANNEL_8( 80 ), CN470_125KHZ_CHANNEL_8( 88 ),
+};
+
 /*
  * Non-volatile module context.
  */
@@ -128,40 +149,6 @@ static bool VerifyRfFreq( uint32_t freq )
     return true;
 }
 
-static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
-{
-    uint8_t nbEnabledChannels = 0;
-    uint8_t delayTransmission = 0;
-
-    for( uint8_t i = 0, k = 0; i < CN470_MAX_NB_CHANNELS; i += 16, k++ )
-    {
-        for( uint8_t j = 0; j < 16; j++ )
-        {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
-        }
-    }
-
-    *delayTx = delayTransmission;
-    return nbEnabledChannels;
-}
-
 PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
 {
     PhyParam_t phyParam = { 0 };
@@ -193,6 +180,11 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = CN470_MAX_TX_POWER;
             break;
         }
+        case PHY_SPREADING_FACTOR:
+        {
+            phyParam.Value = DataratesCN470[getPhy->Datarate];
+            break;
+        }
         case PHY_DEF_TX_POWER:
         {
             phyParam.Value = CN470_DEFAULT_TX_POWER;
@@ -290,7 +282,8 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_CHANNELS:
         {
-            phyParam.Channels = NvmCtx.Channels;
+            // Read only, the channel plan is fixed
+            phyParam.Channels = ( ChannelParams_t* )Channels;
             break;
         }
         case PHY_DEF_UPLINK_DWELL_TIME:
@@ -347,7 +340,7 @@ PhyParam_t RegionCN470GetPhyParam( GetPhyParams_t* getPhy )
 
 void RegionCN470SetBandTxDone( SetBandTxDoneParams_t* txDone )
 {
-    RegionCommonSetBandTxDone( txDone->Joined, &NvmCtx.Bands[NvmCtx.Channels[txDone->Channel].Band], txDone->LastTxDoneTime );
+    RegionCommonSetBandTxDone( txDone->Joined, &NvmCtx.Bands[Channels[txDone->Channel].Band], txDone->LastTxDoneTime, txDone->LastTxAirTime );
 }
 
 void RegionCN470InitDefaults( InitDefaultsParams_t* params )
@@ -364,15 +357,6 @@ void RegionCN470InitDefaults( InitDefaultsParams_t* params )
             // Initialize bands
             memcpy1( ( uint8_t* )NvmCtx.Bands, ( uint8_t* )bands, sizeof( Band_t ) * CN470_MAX_NB_BANDS );
 
-            // Channels
-            // 125 kHz channels
-            for( uint8_t i = 0; i < CN470_MAX_NB_CHANNELS; i++ )
-            {
-                NvmCtx.Channels[i].Frequency = 470300000 + i * 200000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_5 << 4 ) | DR_0;
-                NvmCtx.Channels[i].Band = 0;
-            }
-
             // Initialize the channels default mask
             NvmCtx.ChannelsDefaultMask[0] = 0xFFFF;
             NvmCtx.ChannelsDefaultMask[1] = 0xFFFF;
@@ -488,7 +472,7 @@ bool RegionCN470ChanMaskSet( ChanMaskSetParams_t* chanMaskSet )
 
 void RegionCN470ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams )
 {
-    double tSymbol = 0.0;
+    RegionCommonSymbolTime_t tSymbol = 0;
 
     // Get the datarate, perform a boundary check
     rxConfigParams->Datarate = MIN( datarate, CN470_RX_MAX_DATARATE );
@@ -496,7 +480,8 @@ void RegionCN470ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
 
     tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesCN470[rxConfigParams->Datarate], BandwidthsCN470[rxConfigParams->Datarate] );
 
-    RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, Radio.GetWakeupTime( ), &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
+    RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, Radio.GetWakeupTime( ), &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset, &rxConfigParams->WindowOffsetUs );
+    rxConfigParams->SymbolTimeUs = RegionCommonSymbolTimeToUs( tSymbol );
 }
 
 bool RegionCN470RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
@@ -514,7 +499,7 @@ bool RegionCN470RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
     if( rxConfig->RxSlot == RX_SLOT_WIN_1 )
     {
         // Apply window 1 frequency
-        frequency = CN470_FIRST_RX1_CHANNEL + ( rxConfig->Channel % 48 ) * CN470_STEPWIDTH_RX1_CHANNEL;
+        frequency = Channels[rxConfig->Channel].Rx1Frequency;
     }
 
     // Read the physical datarate from the datarates table
@@ -542,20 +527,20 @@ bool RegionCN470RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
 bool RegionCN470TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir )
 {
     int8_t phyDr = DataratesCN470[txConfig->Datarate];
-    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[NvmCtx.Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
     int8_t phyTxPower = 0;
 
     // Calculate physical TX power
     phyTxPower = RegionCommonComputeTxPower( txPowerLimited, txConfig->MaxEirp, txConfig->AntennaGain );
 
     // Setup the radio frequency
-    Radio.SetChannel( NvmCtx.Channels[txConfig->Channel].Frequency );
+    Radio.SetChannel( Channels[txConfig->Channel].Frequency );
 
     Radio.SetTxConfig( MODEM_LORA, phyTxPower, 0, 0, phyDr, 1, 8, false, true, 0, 0, false, 4000 );
     // Setup maximum payload lenght of the radio driver
     Radio.SetMaxPayloadLength( MODEM_LORA, txConfig->PktLen );
     // Get the time-on-air of the next tx frame
-    *txTimeOnAir = Radio.TimeOnAir( MODEM_LORA, txConfig->PktLen );
+    *txTimeOnAir = RegionCN470GetTimeOnAir( txConfig->Datarate, txConfig->PktLen );
     *txPower = txPowerLimited;
 
     return true;
@@ -608,7 +593,7 @@ uint8_t RegionCN470LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
             for( uint8_t i = 0; i < 16; i++ )
             {
                 if( ( ( linkAdrParams.ChMask & ( 1 << i ) ) != 0 ) &&
-                    ( NvmCtx.Channels[linkAdrParams.ChMaskCtrl * 16 + i].Frequency == 0 ) )
+                    ( Channels[linkAdrParams.ChMaskCtrl * 16 + i].Frequency == 0 ) )
                 {// Trying to enable an undefined channel
                     status &= 0xFE; // Channel mask KO
                 }
@@ -634,7 +619,7 @@ uint8_t RegionCN470LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     linkAdrVerifyParams.ChannelsMask = channelsMask;
     linkAdrVerifyParams.MinDatarate = ( int8_t )phyParam.Value;
     linkAdrVerifyParams.MaxDatarate = CN470_TX_MAX_DATARATE;
-    linkAdrVerifyParams.Channels = NvmCtx.Channels;
+    linkAdrVerifyParams.Channels = Channels;
     linkAdrVerifyParams.MinTxPower = CN470_MIN_TX_POWER;
     linkAdrVerifyParams.MaxTxPower = CN470_MAX_TX_POWER;
     linkAdrVerifyParams.Version = linkAdrReq->Version;
@@ -708,14 +693,13 @@ void RegionCN470CalcBackOff( CalcBackOffParams_t* calcBackOff )
 {
     RegionCommonCalcBackOffParams_t calcBackOffParams;
 
-    calcBackOffParams.Channels = NvmCtx.Channels;
+    calcBackOffParams.Channels = Channels;
     calcBackOffParams.Bands = NvmCtx.Bands;
-    calcBackOffParams.LastTxIsJoinRequest = calcBackOff->LastTxIsJoinRequest;
     calcBackOffParams.Joined = calcBackOff->Joined;
     calcBackOffParams.DutyCycleEnabled = calcBackOff->DutyCycleEnabled;
     calcBackOffParams.Channel = calcBackOff->Channel;
-    calcBackOffParams.ElapsedTime = calcBackOff->ElapsedTime;
     calcBackOffParams.TxTimeOnAir = calcBackOff->TxTimeOnAir;
+    calcBackOffParams.CurrentTime = calcBackOff->CurrentTime;
 
     RegionCommonCalcBackOff( &calcBackOffParams );
 }
@@ -725,6 +709,7 @@ LoRaMacStatus_t RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTx = 0;
     uint8_t enabledChannels[CN470_MAX_NB_CHANNELS] = { 0 };
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
     TimerTime_t nextTxDelay = 0;
 
     // Count 125kHz channels
@@ -738,19 +723,24 @@ LoRaMacStatus_t RegionCN470NextChannel( NextChanParams_t* nextChanParams, uint8_
         NvmCtx.ChannelsMask[5] = 0xFFFF;
     }
 
-    TimerTime_t elapsed = TimerGetElapsedTime( nextChanParams->LastAggrTx );
+    TimerTime_t elapsed = TimerGetElapsedTimeAt( nextChanParams->LastAggrTx, nextChanParams->CurrentTime );
     if( ( nextChanParams->LastAggrTx == 0 ) || ( nextChanParams->AggrTimeOff <= elapsed ) )
     {
         // Reset Aggregated time off
         *aggregatedTimeOff = 0;
 
         // Update bands Time OFF
-        nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, NvmCtx.Bands, CN470_MAX_NB_BANDS );
+        nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, NvmCtx.Bands, CN470_MAX_NB_BANDS, nextChanParams->CurrentTime );
 
         // Search how many channels are enabled
-        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate,
-                                                      NvmCtx.ChannelsMask, NvmCtx.Channels,
-                                                      NvmCtx.Bands, enabledChannels, &delayTx );
+        countChannelsParams.Joined = nextChanParams->Joined;
+        countChannelsParams.Datarate = nextChanParams->Datarate;
+        countChannelsParams.ChannelsMask = NvmCtx.ChannelsMask;
+        countChannelsParams.Channels = Channels;
+        countChannelsParams.Bands = NvmCtx.Bands;
+        countChannelsParams.MaxNbChannels = CN470_MAX_NB_CHANNELS;
+        countChannelsParams.JoinChannels = 0xFFFF; // All channels may be used to join
+        nbEnabledChannels = RegionCommonCountNbOfEnabledChannels( &countChannelsParams, enabledChannels, &delayTx );
     }
     else
     {
@@ -792,9 +782,9 @@ bool RegionCN470ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 
 void RegionCN470SetContinuousWave( ContinuousWaveParams_t* continuousWave )
 {
-    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[NvmCtx.Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
     int8_t phyTxPower = 0;
-    uint32_t frequency = NvmCtx.Channels[continuousWave->Channel].Frequency;
+    uint32_t frequency = Channels[continuousWave->Channel].Frequency;
 
     // Calculate physical TX power
     phyTxPower = RegionCommonComputeTxPower( txPowerLimited, continuousWave->MaxEirp, continuousWave->AntennaGain );
@@ -830,3 +820,13 @@ void RegionCN470RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr )
     // Store downlink datarate
     *outDr = CN470_BEACON_CHANNEL_DR;
 }
+
+TimerTime_t RegionCN470GetTimeOnAir( int8_t datarate, uint8_t payloadLen )
+{
+    return RegionCommonComputeTimeOnAir( DataratesCN470[datarate], BandwidthsCN470[datarate], payloadLen );
+}
+
+uint32_t RegionCN470GetRxTimeOnAirUs( int8_t datarate, uint8_t payloadLen )
+{
+    return RegionCommonComputeTimeOnAirUs( DataratesCN470[datarate], BandwidthsCN470[datarate], payloadLen, false );
+}
@@ -231,7 +231,7 @@
  * Band 0 definition
  * { DutyCycle, TxMaxPower, LastJoinTxDoneTime, LastTxDoneTime, TimeOff }
  */
-#define CN470_BAND0                                 { 1, CN470_MAX_TX_POWER, 0, 0, 0 } //  100.0 %
+#define CN470_BAND0                                 { 1, CN470_MAX_TX_POWER, 0, 0, 0 BAND_DC_BUDGET_INIT } //  100.0 %
 
 /*!
  * Defines the first channel for RX window 1 for CN470 band
@@ -489,6 +489,28 @@ uint8_t RegionCN470ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
  */
  void RegionCN470RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr );
 
+/*!
+ * \brief Gets the time-on-air of an uplink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval txTimeOnAir The time-on-air of the frame [ms]
+ */
+TimerTime_t RegionCN470GetTimeOnAir( int8_t datarate, uint8_t payloadLen );
+
+/*!
+ * \brief Gets the time-on-air of a downlink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval rxTimeOnAir The time-on-air of the frame [us]
+ */
+uint32_t RegionCN470GetRxTimeOnAirUs( int8_t datarate, uint8_t payloadLen );
+
 /*! \} defgroup REGIONCN470 */
 
 #endif // __REGION_CN470_H__
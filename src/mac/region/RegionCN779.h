@@ -238,7 +238,7 @@
  * Band 0 definition
  * { DutyCycle, TxMaxPower, LastJoinTxDoneTime, LastTxDoneTime, TimeOff }
  */
-#define CN779_BAND0                                 { 100, CN779_MAX_TX_POWER, 0, 0, 0 } //  1.0 %
+#define CN779_BAND0                                 { 100, CN779_MAX_TX_POWER, 0, 0, 0 BAND_DC_BUDGET_INIT } //  1.0 %
 
 /*!
  * LoRaMac default channel 1
@@ -503,6 +503,28 @@ uint8_t RegionCN779ApplyDrOffset( uint8_t downlinkDwellTime, int8_t dr, int8_t d
  */
  void RegionCN779RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr );
 
+/*!
+ * \brief Gets the time-on-air of an uplink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval txTimeOnAir The time-on-air of the frame [ms]
+ */
+TimerTime_t RegionCN779GetTimeOnAir( int8_t datarate, uint8_t payloadLen );
+
+/*!
+ * \brief Gets the time-on-air of a downlink frame
+ *
+ * \param [IN] datarate Datarate of the frame
+ *
+ * \param [IN] payloadLen PHY payload length
+ *
+ * \retval rxTimeOnAir The time-on-air of the frame [us]
+ */
+uint32_t RegionCN779GetRxTimeOnAirUs( int8_t datarate, uint8_t payloadLen );
+
 /*! \} defgroup REGIONCN779 */
 
 #endif // __REGION_CN779_H__
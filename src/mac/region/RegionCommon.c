@@ -33,44 +33,93 @@
 #include "utilities.h"
 #include "RegionCommon.h"
 
-#define BACKOFF_DC_1_HOUR       100
-#define BACKOFF_DC_10_HOURS     1000
-#define BACKOFF_DC_24_HOURS     10000
+#ifdef DUTY_CYCLE_BUDGET_ENABLED
+/*!
+ * Length of a duty-cycle budget bucket [ms]
+ */
+#define BAND_DC_BUDGET_BUCKET_LENGTH    ( BAND_DC_BUDGET_WINDOW / BAND_DC_BUDGET_NB_BUCKETS )
 
-static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
+#if ( BAND_DC_BUDGET_BUCKET_LENGTH > 600000 )
+#error "The duty-cycle budget buckets must not be longer than 10 minutes"
+#endif
+
+/*!
+ * \brief Moves the airtime window of a band to the given time. The buckets
+ *        leaving the window are cleared.
+ *
+ * \param [IN] band Band to update.
+ *
+ * \param [IN] now Current time.
+ */
+static void BandBudgetUpdate( Band_t* band, TimerTime_t now )
 {
-    uint8_t nbActiveBits = 0;
+    uint32_t bucket = now / BAND_DC_BUDGET_BUCKET_LENGTH;
 
-    for( uint8_t j = 0; j < nbBits; j++ )
+    if( ( bucket < band->Bucket ) || ( ( bucket - band->Bucket ) > BAND_DC_BUDGET_NB_BUCKETS ) )
     {
-        if( ( mask & ( 1 << j ) ) == ( 1 << j ) )
-        {
-            nbActiveBits++;
-        }
+        // The whole window elapsed, or the timer wrapped around
+        memset1( ( uint8_t* )band->Airtime, 0, sizeof( band->Airtime ) );
+        band->Bucket = bucket;
+    }
+    while( band->Bucket != bucket )
+    {
+        band->Bucket++;
+        band->Airtime[band->Bucket % ( BAND_DC_BUDGET_NB_BUCKETS + 1 )] = 0;
     }
-    return nbActiveBits;
 }
 
-uint16_t RegionCommonGetJoinDc( SysTime_t elapsedTime )
+/*!
+ * \brief Computes the time until the airtime budget of a band allows a frame
+ *
+ * \param [IN] band Band to check.
+ *
+ * \param [IN] now Current time.
+ *
+ * \param [IN] txTimeOnAir Time-on-air of the frame.
+ *
+ * \retval Time to wait from now in ms, 0 if the frame fits in the budget.
+ */
+static TimerTime_t BandBudgetGetDelay( Band_t* band, TimerTime_t now, TimerTime_t txTimeOnAir )
 {
-    uint16_t dutyCycle = 0;
+    uint32_t budget = BAND_DC_BUDGET_WINDOW / band->DCycle;
+    uint32_t used = 0;
+    TimerTime_t delay = 0;
 
-    if( elapsedTime.Seconds < 3600 )
+    BandBudgetUpdate( band, now );
+    for( uint8_t i = 0; i < ( BAND_DC_BUDGET_NB_BUCKETS + 1 ); i++ )
     {
-        dutyCycle = BACKOFF_DC_1_HOUR;
+        used += band->Airtime[i];
     }
-    else if( elapsedTime.Seconds < ( 3600 + 36000 ) )
+
+    // The oldest bucket leaves the window when the next bucket starts
+    for( uint8_t k = 1; ( ( used + txTimeOnAir ) > budget ) && ( k <= ( BAND_DC_BUDGET_NB_BUCKETS + 1 ) ); k++ )
     {
-        dutyCycle = BACKOFF_DC_10_HOURS;
+        used -= band->Airtime[( band->Bucket + k ) % ( BAND_DC_BUDGET_NB_BUCKETS + 1 )];
+        delay = ( ( band->Bucket + k ) * BAND_DC_BUDGET_BUCKET_LENGTH ) - now;
     }
-    else
+    return delay;
+}
+#endif // DUTY_CYCLE_BUDGET_ENABLED
+
+static uint8_t CountChannels( uint16_t mask, uint8_t nbBits )
+{
+    uint8_t nbActiveBits = 0;
+
+    if( nbBits < 16 )
     {
-        dutyCycle = BACKOFF_DC_24_HOURS;
+        mask &= ( 1 << nbBits ) - 1;
     }
-    return dutyCycle;
+    // Each iteration clears the least significant set bit. The loop runs once
+    // per active channel instead of once per mask bit.
+    while( mask != 0 )
+    {
+        mask &= mask - 1;
+        nbActiveBits++;
+    }
+    return nbActiveBits;
 }
 
-bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_t dr, int8_t minDr, int8_t maxDr, ChannelParams_t* channels )
+bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_t dr, int8_t minDr, int8_t maxDr, const ChannelParams_t* channels )
 {
     if( RegionCommonValueInRange( dr, minDr, maxDr ) == 0 )
     {
@@ -79,9 +128,10 @@ bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_
 
     for( uint8_t i = 0, k = 0; i < nbChannels; i += 16, k++ )
     {
-        for( uint8_t j = 0; j < 16; j++ )
+        // Only visit the enabled channels, empty mask words are skipped at once
+        for( uint16_t mask = channelsMask[k], j = 0; mask != 0; mask >>= 1, j++ )
         {
-            if( ( ( channelsMask[k] & ( 1 << j ) ) != 0 ) )
+            if( ( mask & 0x0001 ) != 0 )
             {// Check datarate validity for enabled channels
                 if( RegionCommonValueInRange( dr, ( channels[i + j].DrRange.Fields.Min & 0x0F ),
                                                   ( channels[i + j].DrRange.Fields.Max & 0x0F ) ) == 1 )
@@ -136,6 +186,41 @@ uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uin
     return nbChannels;
 }
 
+uint8_t RegionCommonSelectChannel( uint16_t mask, uint8_t rank )
+{
+    uint8_t id = 0;
+
+    // Clear the lower active channels, the selected one is then the lowest set bit
+    while( ( rank > 0 ) && ( mask != 0 ) )
+    {
+        mask &= mask - 1;
+        rank--;
+    }
+    if( mask == 0 )
+    {
+        return 16;
+    }
+    // Isolate the lowest set bit and locate it by halving the search range
+    mask &= -mask;
+    if( ( mask & 0xFF00 ) != 0 )
+    {
+        id += 8;
+    }
+    if( ( mask & 0xF0F0 ) != 0 )
+    {
+        id += 4;
+    }
+    if( ( mask & 0xCCCC ) != 0 )
+    {
+        id += 2;
+    }
+    if( ( mask & 0xAAAA ) != 0 )
+    {
+        id += 1;
+    }
+    return id;
+}
+
 void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len )
 {
     if( ( channelsMaskDest != NULL ) && ( channelsMaskSrc != NULL ) )
@@ -147,8 +232,27 @@ void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMas
     }
 }
 
-void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDone )
+void RegionCommonChanMaskAnd( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len )
 {
+    if( ( channelsMaskDest != NULL ) && ( channelsMaskSrc != NULL ) )
+    {
+        for( uint8_t i = 0; i < len; i++ )
+        {
+            channelsMaskDest[i] &= channelsMaskSrc[i];
+        }
+    }
+}
+
+void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDone, TimerTime_t lastTxAirTime )
+{
+#ifdef DUTY_CYCLE_BUDGET_ENABLED
+    uint16_t* airtime;
+
+    BandBudgetUpdate( band, lastTxDone );
+    airtime = &band->Airtime[band->Bucket % ( BAND_DC_BUDGET_NB_BUCKETS + 1 )];
+    *airtime = MIN( ( uint32_t )*airtime + lastTxAirTime, UINT16_MAX );
+#endif // DUTY_CYCLE_BUDGET_ENABLED
+
     if( joined == true )
     {
         band->LastTxDoneTime = lastTxDone;
@@ -160,7 +264,7 @@ void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDon
     }
 }
 
-TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t* bands, uint8_t nbBands )
+TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t* bands, uint8_t nbBands, TimerTime_t now )
 {
     TimerTime_t nextTxDelay = TIMERTIME_T_MAX;
 
@@ -169,8 +273,8 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t*
     {
         if( joined == false )
         {
-            TimerTime_t elapsedJoin = TimerGetElapsedTime( bands[i].LastJoinTxDoneTime );
-            TimerTime_t elapsedTx = TimerGetElapsedTime( bands[i].LastTxDoneTime );
+            TimerTime_t elapsedJoin = TimerGetElapsedTimeAt( bands[i].LastJoinTxDoneTime, now );
+            TimerTime_t elapsedTx = TimerGetElapsedTimeAt( bands[i].LastTxDoneTime, now );
             TimerTime_t txDoneTime =  MAX( elapsedJoin,
                                         ( dutyCycle == true ) ? elapsedTx : 0 );
 
@@ -187,7 +291,7 @@ TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t*
         {
             if( dutyCycle == true )
             {
-                TimerTime_t elapsed = TimerGetElapsedTime( bands[i].LastTxDoneTime );
+                TimerTime_t elapsed = TimerGetElapsedTimeAt( bands[i].LastTxDoneTime, now );
                 if( bands[i].TimeOff <= elapsed )
                 {
                     bands[i].TimeOff = 0;
@@ -289,21 +393,120 @@ uint8_t RegionCommonLinkAdrReqVerifyParams( RegionCommonLinkAdrReqVerifyParams_t
     return status;
 }
 
-double RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth )
+#if defined( RX_WINDOW_FIXED_POINT_ENABLED )
+RegionCommonSymbolTime_t RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth )
+{
+    return ( ( uint32_t )1000000 << phyDr ) / bandwidth;
+}
+
+RegionCommonSymbolTime_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDr )
+{
+    return 8000 / phyDr; // 1 symbol equals 1 byte
+}
+
+uint32_t RegionCommonSymbolTimeToUs( RegionCommonSymbolTime_t tSymbol )
+{
+    return tSymbol;
+}
+#else
+RegionCommonSymbolTime_t RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth )
 {
     return ( ( double )( 1 << phyDr ) / ( double )bandwidth ) * 1000;
 }
 
-double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr )
+RegionCommonSymbolTime_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDr )
 {
     return ( 8.0 / ( double )phyDr ); // 1 symbol equals 1 byte
 }
 
-void RegionCommonComputeRxWindowParameters( double tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset )
+uint32_t RegionCommonSymbolTimeToUs( RegionCommonSymbolTime_t tSymbol )
+{
+    return ( uint32_t )( tSymbol * 1000.0 );
+}
+#endif
+
+TimerTime_t RegionCommonComputeTimeOnAir( uint8_t phyDr, uint32_t bandwidth, uint8_t payloadLen )
+{
+    if( phyDr == 0 )
+    {
+        // Datarate not available
+        return 0;
+    }
+
+    if( bandwidth == 0 )
+    { // FSK: preamble, sync word, length field, payload and CRC at phyDr kbit/s
+        uint32_t nbBytes = 5 + 3 + 1 + payloadLen + 2;
+
+        return ( 8 * nbBytes + ( phyDr >> 1 ) ) / phyDr;
+    }
+    else
+    { // LoRa
+        // Round up to the next millisecond
+        return ( RegionCommonComputeTimeOnAirUs( phyDr, bandwidth, payloadLen, true ) + 999 ) / 1000;
+    }
+}
+
+uint32_t RegionCommonComputeTimeOnAirUs( uint8_t phyDr, uint32_t bandwidth, uint8_t payloadLen, bool crcOn )
+{
+    if( phyDr == 0 )
+    {
+        // Datarate not available
+        return 0;
+    }
+
+    if( bandwidth == 0 )
+    { // FSK: preamble, sync word, length field, payload and CRC at phyDr kbit/s
+        uint32_t nbBytes = 5 + 3 + 1 + payloadLen + 2;
+
+        return ( 8000 * nbBytes + ( phyDr >> 1 ) ) / phyDr;
+    }
+    else
+    { // LoRa
+        // Low datarate optimization as set by the radio drivers
+        uint8_t lowDatarateOptimize = ( ( ( bandwidth == 125000 ) && ( phyDr >= 11 ) ) ||
+                                        ( ( bandwidth == 250000 ) && ( phyDr == 12 ) ) ) ? 1 : 0;
+        // Symbol time [us]. Exact for the 125, 250 and 500 kHz bandwidths.
+        uint32_t tSymbolUs = ( ( uint32_t )1000000 << phyDr ) / bandwidth;
+        int32_t payloadBits = ( 8 * payloadLen ) - ( 4 * phyDr ) + 28 + ( ( crcOn == true ) ? 16 : 0 );
+        int32_t bitsPerBlock = 4 * ( phyDr - ( 2 * lowDatarateOptimize ) );
+        uint32_t nbSymbols = 8;
+
+        if( payloadBits > 0 )
+        {
+            nbSymbols += ( ( payloadBits + bitsPerBlock - 1 ) / bitsPerBlock ) * ( 1 + 4 );
+        }
+        // Preamble of 8 + 4.25 symbols, counted in quarter of symbols
+        return ( ( ( 8 * 4 ) + 17 + ( nbSymbols * 4 ) ) * tSymbolUs ) >> 2;
+    }
+}
+
+#if defined( RX_WINDOW_FIXED_POINT_ENABLED )
+void RegionCommonComputeRxWindowParameters( RegionCommonSymbolTime_t tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset, int32_t* windowOffsetUs )
+{
+    // All the computations are done in microseconds
+    int32_t nbSymbolsTime = ( ( 2 * ( int32_t )minRxSymbols - 8 ) * ( int32_t )tSymbol ) + ( 2 * ( int32_t )rxError * 1000 );
+    int32_t offset = 0;
+
+    *windowTimeout = minRxSymbols;
+    if( nbSymbolsTime > 0 )
+    {
+        // Computed number of symbols, rounded up
+        *windowTimeout = MAX( ( uint32_t )( ( nbSymbolsTime + ( int32_t )tSymbol - 1 ) / ( int32_t )tSymbol ), minRxSymbols );
+    }
+
+    offset = ( 4 * ( int32_t )tSymbol ) - ( ( int32_t )( *windowTimeout * tSymbol ) / 2 ) - ( ( int32_t )wakeUpTime * 1000 );
+    *windowOffsetUs = offset;
+    // Convert to milliseconds, rounded up. The division rounds negative values up.
+    *windowOffset = ( offset > 0 ) ? ( ( offset + 999 ) / 1000 ) : ( offset / 1000 );
+}
+#else
+void RegionCommonComputeRxWindowParameters( RegionCommonSymbolTime_t tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset, int32_t* windowOffsetUs )
 {
     *windowTimeout = MAX( ( uint32_t )ceil( ( ( 2 * minRxSymbols - 8 ) * tSymbol + 2 * rxError ) / tSymbol ), minRxSymbols ); // Computed number of symbols
+    *windowOffsetUs = ( int32_t )ceil( ( ( 4.0 * tSymbol ) - ( ( *windowTimeout * tSymbol ) / 2.0 ) - wakeUpTime ) * 1000.0 );
     *windowOffset = ( int32_t )ceil( ( 4.0 * tSymbol ) - ( ( *windowTimeout * tSymbol ) / 2.0 ) - wakeUpTime );
 }
+#endif
 
 int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float antennaGain )
 {
@@ -317,46 +520,81 @@ int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float ant
 void RegionCommonCalcBackOff( RegionCommonCalcBackOffParams_t* calcBackOffParams )
 {
     uint8_t bandIdx = calcBackOffParams->Channels[calcBackOffParams->Channel].Band;
-    uint16_t dutyCycle = calcBackOffParams->Bands[bandIdx].DCycle;
-    uint16_t joinDutyCycle = 0;
+    Band_t* band = &calcBackOffParams->Bands[bandIdx];
 
-    // Reset time-off to initial value.
-    calcBackOffParams->Bands[bandIdx].TimeOff = 0;
-
-    if( calcBackOffParams->Joined == false )
+    // The join requests back-off is handled by the MAC layer, only the band
+    // duty-cycle applies here.
+    if( calcBackOffParams->DutyCycleEnabled == true )
     {
-        // Get the join duty cycle
-        joinDutyCycle = RegionCommonGetJoinDc( calcBackOffParams->ElapsedTime );
-        // Apply the most restricting duty cycle
-        dutyCycle = MAX( dutyCycle, joinDutyCycle );
-        // Reset the timeoff if the last frame was not a join request and when the duty cycle is not enabled
-        if( ( calcBackOffParams->DutyCycleEnabled == false ) && ( calcBackOffParams->LastTxIsJoinRequest == false ) )
-        {
-            // This is the case when the duty cycle is off and the last uplink frame was not a join.
-            // This could happen in case of a rejoin, e.g. in compliance test mode.
-            // In this special case we have to set the time off to 0, since the join duty cycle shall only
-            // be applied after the first join request.
-            calcBackOffParams->Bands[bandIdx].TimeOff = 0;
-        }
-        else
-        {
-            // Apply band time-off.
-            calcBackOffParams->Bands[bandIdx].TimeOff = calcBackOffParams->TxTimeOnAir * dutyCycle - calcBackOffParams->TxTimeOnAir;
-        }
+#ifdef DUTY_CYCLE_BUDGET_ENABLED
+        // The band may burst as long as its airtime over the observation
+        // window stays within the duty-cycle. The next frame is assumed to
+        // be as long as the last one.
+        TimerTime_t now = calcBackOffParams->CurrentTime;
+        TimerTime_t delay = BandBudgetGetDelay( band, now, calcBackOffParams->TxTimeOnAir );
+
+        // The time-off runs from the last TX done time
+        band->TimeOff = ( delay == 0 ) ? 0 : TimerGetElapsedTimeAt( band->LastTxDoneTime, now ) + delay;
+#else
+        band->TimeOff = calcBackOffParams->TxTimeOnAir * band->DCycle - calcBackOffParams->TxTimeOnAir;
+#endif // DUTY_CYCLE_BUDGET_ENABLED
     }
     else
     {
-        if( calcBackOffParams->DutyCycleEnabled == true )
+        band->TimeOff = 0;
+    }
+}
+
+
+uint8_t RegionCommonCountNbOfEnabledChannels( RegionCommonCountNbOfEnabledChannelsParams_t* countNbOfEnabledChannelsParams,
+                                              uint8_t* enabledChannels, uint8_t* delayTx )
+{
+    RegionCommonCountNbOfEnabledChannelsParams_t* params = countNbOfEnabledChannelsParams;
+    uint8_t nbEnabledChannels = 0;
+    uint8_t delayTransmission = 0;
+
+    for( uint16_t i = 0, k = 0; i < params->MaxNbChannels; i += 16, k++ )
+    {
+        uint16_t mask = params->ChannelsMask[k];
+
+        if( ( params->Joined == false ) && ( k == 0 ) )
         {
-            calcBackOffParams->Bands[bandIdx].TimeOff = calcBackOffParams->TxTimeOnAir * dutyCycle - calcBackOffParams->TxTimeOnAir;
+            mask &= params->JoinChannels;
         }
-        else
+        if( ( params->MaxNbChannels - i ) < 16 )
+        { // Discard the bits beyond the last channel
+            mask &= ( 1 << ( params->MaxNbChannels - i ) ) - 1;
+        }
+
+        // Only visit the channels enabled in the mask. The loop ends with the
+        // last one, empty mask words are skipped at once.
+        for( uint8_t j = 0; mask != 0; j++, mask >>= 1 )
         {
-            calcBackOffParams->Bands[bandIdx].TimeOff = 0;
+            if( ( mask & 0x0001 ) == 0 )
+            {
+                continue;
+            }
+            if( params->Channels[i + j].Frequency == 0 )
+            { // Check if the channel is enabled
+                continue;
+            }
+            if( RegionCommonValueInRange( params->Datarate, params->Channels[i + j].DrRange.Fields.Min,
+                                          params->Channels[i + j].DrRange.Fields.Max ) == false )
+            { // Check if the current channel selection supports the given datarate
+                continue;
+            }
+            if( params->Bands[params->Channels[i + j].Band].TimeOff > 0 )
+            { // Check if the band is available for transmission
+                delayTransmission++;
+                continue;
+            }
+            enabledChannels[nbEnabledChannels++] = i + j;
         }
     }
-}
 
+    *delayTx = delayTransmission;
+    return nbEnabledChannels;
+}
 
 void RegionCommonRxBeaconSetup( RegionCommonRxBeaconSetupParams_t* rxBeaconSetupParams )
 {
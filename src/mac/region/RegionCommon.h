@@ -40,6 +40,19 @@
 #include "LoRaMacTypes.h"
 #include "region/Region.h"
 
+/*!
+ * Symbol time type used by the RX windows computation
+ *
+ * \remark With RX_WINDOW_FIXED_POINT_ENABLED the symbol time is an integer
+ *         number of microseconds, otherwise a floating point number of
+ *         milliseconds.
+ */
+#if defined( RX_WINDOW_FIXED_POINT_ENABLED )
+typedef uint32_t RegionCommonSymbolTime_t;
+#else
+typedef double RegionCommonSymbolTime_t;
+#endif
+
 typedef struct sRegionCommonLinkAdrParams
 {
     /*!
@@ -121,7 +134,7 @@ typedef struct sRegionCommonLinkAdrReqVerifyParams
     /*!
      * Pointer to the channels.
      */
-    ChannelParams_t* Channels;
+    const ChannelParams_t* Channels;
     /*!
      * The minimum possible TX power.
      */
@@ -137,15 +150,11 @@ typedef struct sRegionCommonCalcBackOffParams
     /*!
      * A pointer to region specific channels.
      */
-    ChannelParams_t* Channels;
+    const ChannelParams_t* Channels;
     /*!
      * A pointer to region specific bands.
      */
     Band_t* Bands;
-    /*!
-     * Set to true, if the last uplink was a join request.
-     */
-    bool LastTxIsJoinRequest;
     /*!
      * Set to true, if the node is joined.
      */
@@ -158,14 +167,14 @@ typedef struct sRegionCommonCalcBackOffParams
      * The current channel.
      */
     uint8_t Channel;
-    /*!
-     * The elapsed time since initialization.
-     */
-    SysTime_t ElapsedTime;
     /*!
      * The time on air of the last Tx frame.
      */
     TimerTime_t TxTimeOnAir;
+    /*!
+     * The current time.
+     */
+    TimerTime_t CurrentTime;
 }RegionCommonCalcBackOffParams_t;
 
 typedef struct sRegionCommonRxBeaconSetupParams
@@ -200,15 +209,38 @@ typedef struct sRegionCommonRxBeaconSetupParams
     uint16_t SymbolTimeout;
 }RegionCommonRxBeaconSetupParams_t;
 
-/*!
- * \brief Calculates the join duty cycle.
- *        This is a generic function and valid for all regions.
- *
- * \param [IN] elapsedTime Elapsed time since the start of the device.
- *
- * \retval Duty cycle restriction.
- */
-uint16_t RegionCommonGetJoinDc( SysTime_t elapsedTime );
+typedef struct sRegionCommonCountNbOfEnabledChannelsParams
+{
+    /*!
+     * Set to true, if the node has joined the network
+     */
+    bool Joined;
+    /*!
+     * The datarate to count the available channels for.
+     */
+    uint8_t Datarate;
+    /*!
+     * A pointer to the channels mask to be verified.
+     */
+    uint16_t* ChannelsMask;
+    /*!
+     * A pointer to the channels.
+     */
+    const ChannelParams_t* Channels;
+    /*!
+     * A pointer to the bands.
+     */
+    Band_t* Bands;
+    /*!
+     * The number of available channels.
+     */
+    uint16_t MaxNbChannels;
+    /*!
+     * The channels 0 to 15 that may be used while the node has not joined the
+     * network.
+     */
+    uint16_t JoinChannels;
+}RegionCommonCountNbOfEnabledChannelsParams_t;
 
 /*!
  * \brief Verifies, if a value is in a given range.
@@ -243,7 +275,7 @@ uint8_t RegionCommonValueInRange( int8_t value, int8_t min, int8_t max );
  * \retval Returns true if the datarate is supported, false if not.
  */
 bool RegionCommonChanVerifyDr( uint8_t nbChannels, uint16_t* channelsMask, int8_t dr,
-                            int8_t minDr, int8_t maxDr, ChannelParams_t* channels );
+                            int8_t minDr, int8_t maxDr, const ChannelParams_t* channels );
 
 /*!
  * \brief Disables a channel in a given channels mask.
@@ -273,6 +305,20 @@ bool RegionCommonChanDisable( uint16_t* channelsMask, uint8_t id, uint8_t maxCha
  */
 uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uint8_t stopIdx );
 
+/*!
+ * \brief Selects an active channel of a 16 bit channels mask by its rank.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN] mask The 16 bit channels mask.
+ *
+ * \param [IN] rank Rank of the channel among the active channels, 0 being the
+ *                  active channel of lowest index.
+ *
+ * \retval Returns the index of the channel in the mask, 16 if the mask has not
+ *         enough active channels.
+ */
+uint8_t RegionCommonSelectChannel( uint16_t mask, uint8_t rank );
+
 /*!
  * \brief Copy a channels mask.
  *        This is a generic function and valid for all regions.
@@ -285,6 +331,19 @@ uint8_t RegionCommonCountChannels( uint16_t* channelsMask, uint8_t startIdx, uin
  */
 void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len );
 
+/*!
+ * \brief Keeps the channels of a channels mask that are also enabled in
+ *        another channels mask.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN] channelsMaskDest The channels mask to be updated.
+ *
+ * \param [IN] channelsMaskSrc The channels mask to AND with.
+ *
+ * \param [IN] len The index length to update.
+ */
+void RegionCommonChanMaskAnd( uint16_t* channelsMaskDest, uint16_t* channelsMaskSrc, uint8_t len );
+
 /*!
  * \brief Sets the last tx done property.
  *        This is a generic function and valid for all regions.
@@ -294,8 +353,12 @@ void RegionCommonChanMaskCopy( uint16_t* channelsMaskDest, uint16_t* channelsMas
  * \param [IN] band The band to be updated.
  *
  * \param [IN] lastTxDone The time of the last TX done.
+ *
+ * \param [IN] lastTxAirTime The time-on-air of the last TX frame. Accounted in
+ *                           the band airtime budget when DUTY_CYCLE_BUDGET_ENABLED
+ *                           is defined.
  */
-void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDone );
+void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDone, TimerTime_t lastTxAirTime );
 
 /*!
  * \brief Updates the time-offs of the bands.
@@ -309,9 +372,11 @@ void RegionCommonSetBandTxDone( bool joined, Band_t* band, TimerTime_t lastTxDon
  *
  * \param [IN] nbBands The number of bands available.
  *
+ * \param [IN] now The current time, all the bands are checked against it.
+ *
  * \retval Returns the time which must be waited to perform the next uplink.
  */
-TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t* bands, uint8_t nbBands );
+TimerTime_t RegionCommonUpdateBandTimeOff( bool joined, bool dutyCycle, Band_t* bands, uint8_t nbBands, TimerTime_t now );
 
 /*!
  * \brief Parses the parameter of an LinkAdrRequest.
@@ -346,24 +411,79 @@ uint8_t RegionCommonLinkAdrReqVerifyParams( RegionCommonLinkAdrReqVerifyParams_t
 /*!
  * \brief Computes the symbol time for LoRa modulation.
  *
+ * \remark The fixed-point symbol time is exact for the 125, 250 and 500 kHz
+ *         bandwidths. For other bandwidths it is truncated by less than 1 us.
+ *
  * \param [IN] phyDr Physical datarate to use.
  *
  * \param [IN] bandwidth Bandwidth to use.
  *
- * \retval Returns the symbol time.
+ * \retval Returns the symbol time. [us] when RX_WINDOW_FIXED_POINT_ENABLED
+ *         is defined, [ms] otherwise.
  */
-double RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth );
+RegionCommonSymbolTime_t RegionCommonComputeSymbolTimeLoRa( uint8_t phyDr, uint32_t bandwidth );
 
 /*!
  * \brief Computes the symbol time for FSK modulation.
  *
+ * \remark The fixed-point symbol time is exact for the 50 kbit/s datarate.
+ *         For other datarates it is truncated by less than 1 us.
+ *
  * \param [IN] phyDr Physical datarate to use.
  *
  * \param [IN] bandwidth Bandwidth to use.
  *
- * \retval Returns the symbol time.
+ * \retval Returns the symbol time. [us] when RX_WINDOW_FIXED_POINT_ENABLED
+ *         is defined, [ms] otherwise.
  */
-double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
+RegionCommonSymbolTime_t RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
+
+/*!
+ * \brief Converts a symbol time to microseconds.
+ *
+ * \param [IN] tSymbol Symbol time, as computed by
+ *                     \ref RegionCommonComputeSymbolTimeLoRa or
+ *                     \ref RegionCommonComputeSymbolTimeFsk.
+ *
+ * \retval Returns the symbol time [us].
+ */
+uint32_t RegionCommonSymbolTimeToUs( RegionCommonSymbolTime_t tSymbol );
+
+/*!
+ * \brief Computes the time-on-air of an uplink frame.
+ *
+ * \remark Uses the LoRaWAN uplink settings: 8 symbols preamble, explicit
+ *         header, CR 4/5 and CRC on for LoRa, 5 bytes preamble, 3 bytes sync
+ *         word, variable length and CRC on for FSK. Integer only computation,
+ *         the result equals the one of Radio.TimeOnAir.
+ *
+ * \param [IN] phyDr Physical datarate. Spreading factor for LoRa, kbit/s for FSK.
+ *
+ * \param [IN] bandwidth Bandwidth [Hz]. 0 for FSK.
+ *
+ * \param [IN] payloadLen PHY payload length [bytes].
+ *
+ * \retval Returns the time-on-air [ms].
+ */
+TimerTime_t RegionCommonComputeTimeOnAir( uint8_t phyDr, uint32_t bandwidth, uint8_t payloadLen );
+
+/*!
+ * \brief Computes the time-on-air of a frame in microseconds
+ *
+ * \remark Same settings as \ref RegionCommonComputeTimeOnAir. The LoRa
+ *         payload CRC is optional, the downlinks do not carry it.
+ *
+ * \param [IN] phyDr Physical datarate. Spreading factor for LoRa, kbit/s for FSK.
+ *
+ * \param [IN] bandwidth Bandwidth [Hz]. 0 for FSK.
+ *
+ * \param [IN] payloadLen PHY payload length [bytes].
+ *
+ * \param [IN] crcOn Set to true if the LoRa frame carries the payload CRC.
+ *
+ * \retval Returns the time-on-air [us].
+ */
+uint32_t RegionCommonComputeTimeOnAirUs( uint8_t phyDr, uint32_t bandwidth, uint8_t payloadLen, bool crcOn );
 
 /*!
  * \brief Computes the RX window timeout and the RX window offset.
@@ -380,8 +500,17 @@ double RegionCommonComputeSymbolTimeFsk( uint8_t phyDr );
  * \param [OUT] windowTimeout RX window timeout.
  *
  * \param [OUT] windowOffset RX window time offset to be applied to the RX delay.
+ *
+ * \param [OUT] windowOffsetUs RX window time offset in microseconds, not rounded.
+ *
+ * \remark The fixed-point computation is exact as long as the symbol time is
+ *         exact. It then matches the floating point one for LoRa, while the
+ *         latter may add one FSK symbol as 0.16 ms isn't exactly represented.
+ *         Otherwise the window offset error is below
+ *         ( windowTimeout / 2 + 4 ) us before being rounded up to the
+ *         millisecond.
  */
-void RegionCommonComputeRxWindowParameters( double tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset );
+void RegionCommonComputeRxWindowParameters( RegionCommonSymbolTime_t tSymbol, uint8_t minRxSymbols, uint32_t rxError, uint32_t wakeUpTime, uint32_t* windowTimeout, int32_t* windowOffset, int32_t* windowOffsetUs );
 
 /*!
  * \brief Computes the txPower, based on the max EIRP and the antenna gain.
@@ -407,6 +536,24 @@ int8_t RegionCommonComputeTxPower( int8_t txPowerIndex, float maxEirp, float ant
  */
 void RegionCommonCalcBackOff( RegionCommonCalcBackOffParams_t* calcBackOffParams );
 
+/*!
+ * \brief Collects the channels that are enabled, support the datarate and
+ *        whose band is available for transmission.
+ *        This is a generic function and valid for all regions.
+ *
+ * \param [IN] countNbOfEnabledChannelsParams A pointer to the input parameters.
+ *
+ * \param [OUT] enabledChannels The indexes of the collected channels, in
+ *                              ascending order. MaxNbChannels entries long.
+ *
+ * \param [OUT] delayTx The number of channels only restricted by their band
+ *                      time off.
+ *
+ * \retval Returns the number of collected channels.
+ */
+uint8_t RegionCommonCountNbOfEnabledChannels( RegionCommonCountNbOfEnabledChannelsParams_t* countNbOfEnabledChannelsParams,
+                                              uint8_t* enabledChannels, uint8_t* delayTx );
+
 /*!
  * \brief Sets up the radio into RX beacon mode.
  *
@@ -44,10 +44,6 @@
  */
 typedef struct sRegionUS915NvmCtx
 {
-    /*!
-     * LoRaMAC channels
-     */
-    ChannelParams_t Channels[ US915_MAX_NB_CHANNELS ];
     /*!
      * LoRaMac bands
      */
@@ -74,11 +70,57 @@ typedef struct sRegionUS915NvmCtx
     uint8_t JoinTrialsCounter;
 }RegionUS915NvmCtx_t;
 
+/*!
+ * 125 kHz channel of index i in its group
+ */
+#define US915_125KHZ_CHANNEL( i )         { .Frequency = 902300000 + ( i ) * 200000, .Rx1Frequency = 0, \
+                                            .DrRange.Value = ( DR_3 << 4 ) | DR_0, .Band = 0 }
+
+/*!
+ * Group of 8 consecutive channels starting at index i
+ */
+#define US915_125KHZ_CHANNEL_8( i )     US915_125KHZ_CHANNEL( i ), US915_125KHZ_CHANNEL( i + 1 ), US915_125KHZ_CHANNEL( i + 2 ), US915_125KHZ_CHANNEL( i + 3 ), \
+                                        US915_125KHZ_CHANNEL( i + 4 ), US915_125KHZ_CHANNEL( i + 5 ), US915_125KHZ_CHANNEL( i + 6 ), US915_125KHZ_CHANNEL( i + 7 )
+
+/*!
+ * 500 kHz channel of index i in its group
+ */
+#define US915_500KHZ_CHANNEL( i )         { .Frequency = 903000000 + ( i ) * 1600000, .Rx1Frequency = 0, \
+                                            .DrRange.Value = ( DR_4 << 4 ) | DR_4, .Band = 0 }
+
+/*!
+ * Group of 8 consecutive channels starting at index i
+ */
+#define US915_500KHZ_CHANNEL_8( i )     US915_500KHZ_CHANNEL( i ), US915_500KHZ_CHANNEL( i + 1 ), US915_500KHZ_CHANNEL( i + 2 ), US915_500KHZ_CHANNEL( i + 3 ), \
+                                        US915_500KHZ_CHANNEL( i + 4 ), US915_500KHZ_CHANNEL( i + 5 ), US915_500KHZ_CHANNEL( i + 6 ), US915_500KHZ_CHANNEL( i + 7 )
+
+/*!
+ * LoRaMAC channels. The channel plan of the region is fixed, the channels are
+ * fully determined by their index and are not part of the context.
+ */
+static const ChannelParams_t Channels[ US915_MAX_NB_CHANNELS ] =
+{
+    US915_125KHZ_CHANNEL_8( 0 ), US915_125KHZ_CHANNEL_8( 8 ), US915_125KHZ_CHANNEL_8( 16 ), US915_125KHZ_CHANNEL_8( 24 ),
+    US915_125KHZ_CHANNEL_8( 32 ), US915_125KHZ_CHANNEL_8( 40 ), US915_125KHZ_CHANNEL_8( 48 ), US915_125KHZ_CHANNEL_8( 56 ),
+    US915_500KHZ_CHANNEL_8( 0 ),
+};
+
 /*
  * Non-volatile module context.
  */
 static RegionUS915NvmCtx_t NvmCtx;
 
+/*!
+ * Channels of the frequency hopping table loaded in the radio
+ */
+static struct
+{
+    bool Valid;
+    bool Is500kHz;
+    uint32_t Seed;
+    uint16_t ChannelsMask[CHANNELS_MASK_SIZE];
+}HopTable;
+
 // Static functions
 static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
 {
@@ -95,42 +137,6 @@ static int8_t GetNextLowerTxDr( int8_t dr, int8_t minDr )
     return nextLowerDr;
 }
 
-/*!
- * \brief Searches for available 125 kHz channels in the given channel mask.
- *
- * \param [IN] channelMaskRemaining The remaining channel mask.
- *
- * \param [OUT] findAvailableChannelsIndex List containing the indexes of all available 125 kHz channels.
- *
- * \param [OUT] availableChannels Number of available 125 kHz channels.
- *
- * \retval Status
- */
-static LoRaMacStatus_t FindAvailable125kHzChannels( uint8_t* findAvailableChannelsIndex, uint16_t channelMaskRemaining, uint8_t* availableChannels )
-{
-    // Nullpointer check
-    if( findAvailableChannelsIndex == NULL || availableChannels == NULL )
-    {
-        return LORAMAC_STATUS_PARAMETER_INVALID;
-    }
-
-    // Initialize counter
-    *availableChannels = 0;
-    for( uint8_t i = 0; i < 8; i++ )
-    {
-        // Find available channels
-        if( ( channelMaskRemaining & ( 1 << i ) ) != 0 )
-        {
-            // Save available channel index
-            findAvailableChannelsIndex[*availableChannels] = i;
-            // Increment counter of available channels if the current channel is available
-            ( *availableChannels )++;
-        }
-    }
-
-    return LORAMAC_STATUS_OK;
-}
-
 /*!
  * \brief Computes the next 125kHz channel used for join requests.
  *
@@ -140,11 +146,10 @@ static LoRaMacStatus_t FindAvailable125kHzChannels( uint8_t* findAvailableChanne
  */
 static LoRaMacStatus_t ComputeNext125kHzJoinChannel( uint8_t* newChannelIndex )
 {
-    uint8_t currentChannelsMaskRemainingIndex;
-    uint16_t channelMaskRemaining;
-    uint8_t findAvailableChannelsIndex[8] = { 0 };
-    uint8_t availableChannels = 0;
     uint8_t startIndex = NvmCtx.JoinChannelGroupsCurrentIndex;
+    uint16_t groupsMask = 0;
+    uint16_t channelMaskRemaining;
+    uint8_t group;
 
     // Null pointer check
     if( newChannelIndex == NULL )
@@ -152,47 +157,35 @@ static LoRaMacStatus_t ComputeNext125kHzJoinChannel( uint8_t* newChannelIndex )
         return LORAMAC_STATUS_PARAMETER_INVALID;
     }
 
-    do {
-        // Current ChannelMaskRemaining, two groups per channel mask. For example Group 0 and 1 (8 bit) are ChannelMaskRemaining 0 (16 bit), etc.
-        currentChannelsMaskRemainingIndex = (uint8_t) startIndex / 2;
-
-        // For even numbers we need the 8 LSBs and for uneven the 8 MSBs
-        if( ( startIndex % 2 ) == 0 )
+    // Availability of the 8 bit groups, two groups per channel mask. For example Group 0 and 1 (8 bit) are ChannelMaskRemaining 0 (16 bit), etc.
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        if( ( NvmCtx.ChannelsMaskRemaining[i] & 0x00FF ) != 0 )
         {
-            channelMaskRemaining = ( NvmCtx.ChannelsMaskRemaining[currentChannelsMaskRemainingIndex] & 0x00FF );
+            groupsMask |= 1 << ( 2 * i );
         }
-        else
+        if( ( NvmCtx.ChannelsMaskRemaining[i] & 0xFF00 ) != 0 )
         {
-            channelMaskRemaining = ( ( NvmCtx.ChannelsMaskRemaining[currentChannelsMaskRemainingIndex] >> 8 ) & 0x00FF );
+            groupsMask |= 1 << ( ( 2 * i ) + 1 );
         }
+    }
+    if( groupsMask == 0 )
+    {
+        return LORAMAC_STATUS_PARAMETER_INVALID;
+    }
 
+    // Rotate the groups so that the search starts at the current group, the first available one is then the lowest set bit
+    groupsMask = ( ( groupsMask >> startIndex ) | ( groupsMask << ( 8 - startIndex ) ) ) & 0x00FF;
+    group = ( startIndex + RegionCommonSelectChannel( groupsMask, 0 ) ) % 8;
 
-        if( FindAvailable125kHzChannels( findAvailableChannelsIndex, channelMaskRemaining, &availableChannels ) == LORAMAC_STATUS_PARAMETER_INVALID )
-        {
-            return LORAMAC_STATUS_PARAMETER_INVALID;
-        }
-
-        if ( availableChannels > 0 )
-        {
-            // Choose randomly a free channel 125kHz
-            *newChannelIndex = ( startIndex * 8 ) + findAvailableChannelsIndex[randr( 0, ( availableChannels - 1 ) )];
-        }
+    // For even groups we need the 8 LSBs and for uneven the 8 MSBs
+    channelMaskRemaining = ( NvmCtx.ChannelsMaskRemaining[group / 2] >> ( ( group % 2 ) * 8 ) ) & 0x00FF;
 
-        // Increment start index
-        startIndex++;
-        if ( startIndex > 7 )
-        {
-            startIndex = 0;
-        }
-    } while( ( availableChannels == 0 ) && ( startIndex != NvmCtx.JoinChannelGroupsCurrentIndex ) );
+    // Choose randomly a free channel 125kHz
+    *newChannelIndex = ( group * 8 ) + RegionCommonSelectChannel( channelMaskRemaining, randr( 0, RegionCommonCountChannels( &channelMaskRemaining, 0, 1 ) - 1 ) );
 
-    if ( availableChannels > 0 )
-    {
-        NvmCtx.JoinChannelGroupsCurrentIndex = startIndex;
-        return LORAMAC_STATUS_OK;
-    }
-
-    return LORAMAC_STATUS_PARAMETER_INVALID;
+    NvmCtx.JoinChannelGroupsCurrentIndex = ( group + 1 ) % 8;
+    return LORAMAC_STATUS_OK;
 }
 
 static uint32_t GetBandwidth( uint32_t drIndex )
@@ -230,6 +223,45 @@ static int8_t LimitTxPower( int8_t txPower, int8_t maxBandTxPower, int8_t datara
     return txPowerResult;
 }
 
+static void SetupHopTable( uint8_t channel, uint32_t seed )
+{
+    uint32_t frequencies[US915_MAX_NB_CHANNELS - 8];
+    bool is500kHz = ( channel >= ( US915_MAX_NB_CHANNELS - 8 ) );
+    uint8_t first = ( is500kHz == true ) ? ( US915_MAX_NB_CHANNELS - 8 ) : 0;
+    uint8_t last = ( is500kHz == true ) ? US915_MAX_NB_CHANNELS : ( US915_MAX_NB_CHANNELS - 8 );
+    uint8_t nbChannels = 0;
+
+    if( ( HopTable.Valid == true ) && ( HopTable.Is500kHz == is500kHz ) && ( HopTable.Seed == seed ) )
+    {
+        uint8_t i = 0;
+
+        while( ( i < CHANNELS_MASK_SIZE ) && ( HopTable.ChannelsMask[i] == NvmCtx.ChannelsMask[i] ) )
+        {
+            i++;
+        }
+        if( i == CHANNELS_MASK_SIZE )
+        {
+            // The radio already holds the sequence of the enabled channels
+            return;
+        }
+    }
+
+    // Hop on the enabled channels of the bandwidth of the TX channel
+    for( uint8_t i = first; i < last; i++ )
+    {
+        if( ( NvmCtx.ChannelsMask[i / 16] & ( 1 << ( i % 16 ) ) ) != 0 )
+        {
+            frequencies[nbChannels++] = Channels[i].Frequency;
+        }
+    }
+    Radio.SetHopTable( frequencies, nbChannels, seed );
+
+    HopTable.Valid = true;
+    HopTable.Is500kHz = is500kHz;
+    HopTable.Seed = seed;
+    RegionCommonChanMaskCopy( HopTable.ChannelsMask, NvmCtx.ChannelsMask, CHANNELS_MASK_SIZE );
+}
+
 static bool VerifyRfFreq( uint32_t freq )
 {
     // Check radio driver support
@@ -254,40 +286,6 @@ static bool VerifyRfFreq( uint32_t freq )
     return true;
 }
 
-static uint8_t CountNbOfEnabledChannels( uint8_t datarate, uint16_t* channelsMask, ChannelParams_t* channels, Band_t* bands, uint8_t* enabledChannels, uint8_t* delayTx )
-{
-    uint8_t nbEnabledChannels = 0;
-    uint8_t delayTransmission = 0;
-
-    for( uint8_t i = 0, k = 0; i < US915_MAX_NB_CHANNELS; i += 16, k++ )
-    {
-        for( uint8_t j = 0; j < 16; j++ )
-        {
-            if( ( channelsMask[k] & ( 1 << j ) ) != 0 )
-            {
-                if( channels[i + j].Frequency == 0 )
-                { // Check if the channel is enabled
-                    continue;
-                }
-                if( RegionCommonValueInRange( datarate, channels[i + j].DrRange.Fields.Min,
-                                              channels[i + j].DrRange.Fields.Max ) == false )
-                { // Check if the current channel selection supports the given datarate
-                    continue;
-                }
-                if( bands[channels[i + j].Band].TimeOff > 0 )
-                { // Check if the band is available for transmission
-                    delayTransmission++;
-                    continue;
-                }
-                enabledChannels[nbEnabledChannels++] = i + j;
-            }
-        }
-    }
-
-    *delayTx = delayTransmission;
-    return nbEnabledChannels;
-}
-
 PhyParam_t RegionUS915GetPhyParam( GetPhyParams_t* getPhy )
 {
     PhyParam_t phyParam = { 0 };
@@ -319,6 +317,11 @@ PhyParam_t RegionUS915GetPhyParam( GetPhyParams_t* getPhy )
             phyParam.Value = US915_MAX_TX_POWER;
             break;
         }
+        case PHY_SPREADING_FACTOR:
+        {
+            phyParam.Value = DataratesUS915[getPhy->Datarate];
+            break;
+        }
         case PHY_DEF_TX_POWER:
         {
             phyParam.Value = US915_DEFAULT_TX_POWER;
@@ -416,7 +419,8 @@ PhyParam_t RegionUS915GetPhyParam( GetPhyParams_t* getPhy )
         }
         case PHY_CHANNELS:
         {
-            phyParam.Channels = NvmCtx.Channels;
+            // Read only, the channel plan is fixed
+            phyParam.Channels = ( ChannelParams_t* )Channels;
             break;
         }
         case PHY_DEF_UPLINK_DWELL_TIME:
@@ -478,7 +482,7 @@ PhyParam_t RegionUS915GetPhyParam( GetPhyParams_t* getPhy )
 
 void RegionUS915SetBandTxDone( SetBandTxDoneParams_t* txDone )
 {
-    RegionCommonSetBandTxDone( txDone->Joined, &NvmCtx.Bands[NvmCtx.Channels[txDone->Channel].Band], txDone->LastTxDoneTime );
+    RegionCommonSetBandTxDone( txDone->Joined, &NvmCtx.Bands[Channels[txDone->Channel].Band], txDone->LastTxDoneTime, txDone->LastTxAirTime );
 }
 
 void RegionUS915InitDefaults( InitDefaultsParams_t* params )
@@ -501,22 +505,6 @@ void RegionUS915InitDefaults( InitDefaultsParams_t* params )
             // Initialize the join trials counter
             NvmCtx.JoinTrialsCounter = 0;
 
-            // Channels
-            // 125 kHz channels
-            for( uint8_t i = 0; i < US915_MAX_NB_CHANNELS - 8; i++ )
-            {
-                NvmCtx.Channels[i].Frequency = 902300000 + i * 200000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_3 << 4 ) | DR_0;
-                NvmCtx.Channels[i].Band = 0;
-            }
-            // 500 kHz channels
-            for( uint8_t i = US915_MAX_NB_CHANNELS - 8; i < US915_MAX_NB_CHANNELS; i++ )
-            {
-                NvmCtx.Channels[i].Frequency = 903000000 + ( i - ( US915_MAX_NB_CHANNELS - 8 ) ) * 1600000;
-                NvmCtx.Channels[i].DrRange.Value = ( DR_4 << 4 ) | DR_4;
-                NvmCtx.Channels[i].Band = 0;
-            }
-
             // ChannelsMask
             NvmCtx.ChannelsDefaultMask[0] = 0xFFFF;
             NvmCtx.ChannelsDefaultMask[1] = 0xFFFF;
@@ -545,10 +533,8 @@ void RegionUS915InitDefaults( InitDefaultsParams_t* params )
             // Copy channels default mask
             RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, NvmCtx.ChannelsDefaultMask, 6 );
 
-            for( uint8_t i = 0; i < 6; i++ )
-            { // Copy-And the channels mask
-                NvmCtx.ChannelsMaskRemaining[i] &= NvmCtx.ChannelsMask[i];
-            }
+            // Copy-And the channels mask
+            RegionCommonChanMaskAnd( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, 6 );
             break;
         }
         default:
@@ -647,10 +633,8 @@ bool RegionUS915ChanMaskSet( ChanMaskSetParams_t* chanMaskSet )
             NvmCtx.ChannelsDefaultMask[4] = NvmCtx.ChannelsDefaultMask[4] & CHANNELS_MASK_500KHZ_MASK;
             NvmCtx.ChannelsDefaultMask[5] = 0x0000;
 
-            for( uint8_t i = 0; i < CHANNELS_MASK_SIZE; i++ )
-            { // Copy-And the channels mask
-                NvmCtx.ChannelsMaskRemaining[i] &= NvmCtx.ChannelsMask[i];
-            }
+            // Copy-And the channels mask
+            RegionCommonChanMaskAnd( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, CHANNELS_MASK_SIZE );
             break;
         }
         case CHANNELS_DEFAULT_MASK:
@@ -666,7 +650,7 @@ bool RegionUS915ChanMaskSet( ChanMaskSetParams_t* chanMaskSet )
 
 void RegionUS915ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols, uint32_t rxError, RxConfigParams_t *rxConfigParams )
 {
-    double tSymbol = 0.0;
+    RegionCommonSymbolTime_t tSymbol = 0;
 
     // Get the datarate, perform a boundary check
     rxConfigParams->Datarate = MIN( datarate, US915_RX_MAX_DATARATE );
@@ -674,7 +658,8 @@ void RegionUS915ComputeRxWindowParameters( int8_t datarate, uint8_t minRxSymbols
 
     tSymbol = RegionCommonComputeSymbolTimeLoRa( DataratesUS915[rxConfigParams->Datarate], BandwidthsUS915[rxConfigParams->Datarate] );
 
-    RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, Radio.GetWakeupTime( ), &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset );
+    RegionCommonComputeRxWindowParameters( tSymbol, minRxSymbols, rxError, Radio.GetWakeupTime( ), &rxConfigParams->WindowTimeout, &rxConfigParams->WindowOffset, &rxConfigParams->WindowOffsetUs );
+    rxConfigParams->SymbolTimeUs = RegionCommonSymbolTimeToUs( tSymbol );
 }
 
 bool RegionUS915RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
@@ -720,22 +705,29 @@ bool RegionUS915RxConfig( RxConfigParams_t* rxConfig, int8_t* datarate )
 bool RegionUS915TxConfig( TxConfigParams_t* txConfig, int8_t* txPower, TimerTime_t* txTimeOnAir )
 {
     int8_t phyDr = DataratesUS915[txConfig->Datarate];
-    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[NvmCtx.Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( txConfig->TxPower, NvmCtx.Bands[Channels[txConfig->Channel].Band].TxMaxPower, txConfig->Datarate, NvmCtx.ChannelsMask );
     uint32_t bandwidth = GetBandwidth( txConfig->Datarate );
     int8_t phyTxPower = 0;
+    bool freqHopOn = ( txConfig->HopPeriod != 0 ) && ( Radio.SetHopTable != NULL );
 
     // Calculate physical TX power
     phyTxPower = RegionCommonComputeTxPower( txPowerLimited, US915_DEFAULT_MAX_ERP, 0 );
 
     // Setup the radio frequency
-    Radio.SetChannel( NvmCtx.Channels[txConfig->Channel].Frequency );
+    Radio.SetChannel( Channels[txConfig->Channel].Frequency );
+
+    if( freqHopOn == true )
+    {
+        SetupHopTable( txConfig->Channel, txConfig->HopSeed );
+    }
 
-    Radio.SetTxConfig( MODEM_LORA, phyTxPower, 0, bandwidth, phyDr, 1, 8, false, true, 0, 0, false, 4000 );
+    Radio.SetTxConfig( MODEM_LORA, phyTxPower, 0, bandwidth, phyDr, 1, 8, false, true, freqHopOn,
+                       ( freqHopOn == true ) ? txConfig->HopPeriod : 0, false, 4000 );
 
     // Setup maximum payload lenght of the radio driver
     Radio.SetMaxPayloadLength( MODEM_LORA, txConfig->PktLen );
     // Get the time-on-air of the next tx frame
-    *txTimeOnAir = Radio.TimeOnAir( MODEM_LORA, txConfig->PktLen );
+    *txTimeOnAir = RegionUS915GetTimeOnAir( txConfig->Datarate, txConfig->PktLen );
     *txPower = txPowerLimited;
 
     return true;
@@ -871,7 +863,7 @@ uint8_t RegionUS915LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
     linkAdrVerifyParams.ChannelsMask = channelsMask;
     linkAdrVerifyParams.MinDatarate = ( int8_t )phyParam.Value;
     linkAdrVerifyParams.MaxDatarate = US915_TX_MAX_DATARATE;
-    linkAdrVerifyParams.Channels = NvmCtx.Channels;
+    linkAdrVerifyParams.Channels = Channels;
     linkAdrVerifyParams.MinTxPower = US915_MIN_TX_POWER;
     linkAdrVerifyParams.MaxTxPower = US915_MAX_TX_POWER;
     linkAdrVerifyParams.Version = linkAdrReq->Version;
@@ -885,10 +877,7 @@ uint8_t RegionUS915LinkAdrReq( LinkAdrReqParams_t* linkAdrReq, int8_t* drOut, in
         // Copy Mask
         RegionCommonChanMaskCopy( NvmCtx.ChannelsMask, channelsMask, 6 );
 
-        NvmCtx.ChannelsMaskRemaining[0] &= NvmCtx.ChannelsMask[0];
-        NvmCtx.ChannelsMaskRemaining[1] &= NvmCtx.ChannelsMask[1];
-        NvmCtx.ChannelsMaskRemaining[2] &= NvmCtx.ChannelsMask[2];
-        NvmCtx.ChannelsMaskRemaining[3] &= NvmCtx.ChannelsMask[3];
+        RegionCommonChanMaskAnd( NvmCtx.ChannelsMaskRemaining, NvmCtx.ChannelsMask, 4 );
         NvmCtx.ChannelsMaskRemaining[4] = NvmCtx.ChannelsMask[4];
         NvmCtx.ChannelsMaskRemaining[5] = NvmCtx.ChannelsMask[5];
     }
@@ -977,14 +966,13 @@ void RegionUS915CalcBackOff( CalcBackOffParams_t* calcBackOff )
 {
     RegionCommonCalcBackOffParams_t calcBackOffParams;
 
-    calcBackOffParams.Channels = NvmCtx.Channels;
+    calcBackOffParams.Channels = Channels;
     calcBackOffParams.Bands = NvmCtx.Bands;
-    calcBackOffParams.LastTxIsJoinRequest = calcBackOff->LastTxIsJoinRequest;
     calcBackOffParams.Joined = calcBackOff->Joined;
     calcBackOffParams.DutyCycleEnabled = calcBackOff->DutyCycleEnabled;
     calcBackOffParams.Channel = calcBackOff->Channel;
-    calcBackOffParams.ElapsedTime = calcBackOff->ElapsedTime;
     calcBackOffParams.TxTimeOnAir = calcBackOff->TxTimeOnAir;
+    calcBackOffParams.CurrentTime = calcBackOff->CurrentTime;
 
     RegionCommonCalcBackOff( &calcBackOffParams );
 }
@@ -994,6 +982,7 @@ LoRaMacStatus_t RegionUS915NextChannel( NextChanParams_t* nextChanParams, uint8_
     uint8_t nbEnabledChannels = 0;
     uint8_t delayTx = 0;
     uint8_t enabledChannels[US915_MAX_NB_CHANNELS] = { 0 };
+    RegionCommonCountNbOfEnabledChannelsParams_t countChannelsParams;
     TimerTime_t nextTxDelay = 0;
     uint8_t newChannelIndex;
 
@@ -1013,19 +1002,24 @@ LoRaMacStatus_t RegionUS915NextChannel( NextChanParams_t* nextChanParams, uint8_
         }
     }
 
-    TimerTime_t elapsed = TimerGetElapsedTime( nextChanParams->LastAggrTx );
+    TimerTime_t elapsed = TimerGetElapsedTimeAt( nextChanParams->LastAggrTx, nextChanParams->CurrentTime );
     if( ( nextChanParams->LastAggrTx == 0 ) || ( nextChanParams->AggrTimeOff <= elapsed ) )
     {
         // Reset Aggregated time off
         *aggregatedTimeOff = 0;
 
         // Update bands Time OFF
-        nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, NvmCtx.Bands, US915_MAX_NB_BANDS );
+        nextTxDelay = RegionCommonUpdateBandTimeOff( nextChanParams->Joined, nextChanParams->DutyCycleEnabled, NvmCtx.Bands, US915_MAX_NB_BANDS, nextChanParams->CurrentTime );
 
         // Search how many channels are enabled
-        nbEnabledChannels = CountNbOfEnabledChannels( nextChanParams->Datarate,
-                                                      NvmCtx.ChannelsMaskRemaining, NvmCtx.Channels,
-                                                      NvmCtx.Bands, enabledChannels, &delayTx );
+        countChannelsParams.Joined = nextChanParams->Joined;
+        countChannelsParams.Datarate = nextChanParams->Datarate;
+        countChannelsParams.ChannelsMask = NvmCtx.ChannelsMaskRemaining;
+        countChannelsParams.Channels = Channels;
+        countChannelsParams.Bands = NvmCtx.Bands;
+        countChannelsParams.MaxNbChannels = US915_MAX_NB_CHANNELS;
+        countChannelsParams.JoinChannels = 0xFFFF; // All channels may be used to join
+        nbEnabledChannels = RegionCommonCountNbOfEnabledChannels( &countChannelsParams, enabledChannels, &delayTx );
     }
     else
     {
@@ -1101,9 +1095,9 @@ bool RegionUS915ChannelsRemove( ChannelRemoveParams_t* channelRemove  )
 
 void RegionUS915SetContinuousWave( ContinuousWaveParams_t* continuousWave )
 {
-    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[NvmCtx.Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
+    int8_t txPowerLimited = LimitTxPower( continuousWave->TxPower, NvmCtx.Bands[Channels[continuousWave->Channel].Band].TxMaxPower, continuousWave->Datarate, NvmCtx.ChannelsMask );
     int8_t phyTxPower = 0;
-    uint32_t frequency = NvmCtx.Channels[continuousWave->Channel].Frequency;
+    uint32_t frequency = Channels[continuousWave->Channel].Frequency;
 
     // Calculate physical TX power
     phyTxPower = RegionCommonComputeTxPower( txPowerLimited, US915_DEFAULT_MAX_ERP, 0 );
@@ -1139,3 +1133,13 @@ void RegionUS915RxBeaconSetup( RxBeaconSetup_t* rxBeaconSetup, uint8_t* outDr )
     // Store downlink datarate
     *outDr = US915_BEACON_CHANNEL_DR;
 }
+
+TimerTime_t RegionUS915GetTimeOnAir( int8_t datarate, uint8_t payloadLen )
+{
+    return RegionCommonComputeTimeOnAir( DataratesUS915[datarate], BandwidthsUS915[datarate], payloadLen );
+}
+
+uint32_t RegionUS915GetRxTimeOnAirUs( int8_t datarate, uint8_t payloadLen )
+{
+    return RegionCommonComputeTimeOnAirUs( DataratesUS915[datarate], BandwidthsUS915[datarate], payloadLen, false );
+}
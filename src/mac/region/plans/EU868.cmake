@@ -0,0 +1,83 @@
+##
+##   ______                              _
+##  / _____)             _              | |
+## ( (____  _____ ____ _| |_ _____  ____| |__
+##  \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+##  _____) ) ____| | | || |_| ____( (___| | | |
+## (______/|_____)_|_|_| \__)_____)\____)_| |_|
+## (C)2013-2017 Semtech
+##  ___ _____ _   ___ _  _____ ___  ___  ___ ___
+## / __|_   _/_\ / __| |/ / __/ _ \| _ \/ __| __|
+## \__ \ | |/ _ \ (__| ' <| _| (_) |   / (__| _|
+## |___/ |_/_/ \_\___|_|\_\_| \___/|_|_\\___|___|
+## embedded.connectivity.solutions.==============
+##
+## License:  Revised BSD License, see LICENSE.TXT file included in the project
+##
+## Channel plan descriptor of the custom region. Same plan as RegionEU868,
+## copy it as a starting point for private network channel plans.
+##
+
+set(PLAN_NAME "EU868")
+
+# Bands { "DutyCycle:MinFrequency:MaxFrequency" }, the frequency range bounds are included
+set(PLAN_BANDS
+    "100:865000000:868000000"   # Band 0,  1.0 %
+    "100:868000001:868600000"   # Band 1,  1.0 %
+    "1000:863000000:864999999"  # Band 2,  0.1 %
+    "10:869400000:869650000"    # Band 3, 10.0 %
+    "100:869700000:870000000"   # Band 4,  1.0 %
+    "1000:868700000:869200000"  # Band 5,  0.1 %
+)
+
+# Default channels { "Frequency:DrMin:DrMax:Band" }
+set(PLAN_DEFAULT_CHANNELS
+    "868100000:0:5:1"
+    "868300000:0:5:1"
+    "868500000:0:5:1"
+)
+
+# Maximum number of channels, at most 16
+set(PLAN_MAX_NB_CHANNELS 16)
+
+# Number of channels of the CFList, which lists frequencies ( CFListType 0 )
+set(PLAN_CFLIST_NB_CHANNELS 5)
+
+# Datarate range of the channels created from the CFList
+set(PLAN_CHANNEL_DR_MIN 0)
+set(PLAN_CHANNEL_DR_MAX 5)
+
+# Datarates table, spreading factor for LoRa or kbps for FSK
+set(PLAN_DATARATES 12 11 10 9 8 7 7 50)
+# Bandwidths table [Hz], 0 for FSK
+set(PLAN_BANDWIDTHS 125000 125000 125000 125000 125000 125000 250000 0)
+# Maximum payloads tables
+set(PLAN_MAX_PAYLOADS 51 51 51 115 242 242 242 242)
+set(PLAN_MAX_PAYLOADS_REPEATER 51 51 51 115 222 222 222 222)
+# FSK datarate, -1 when the plan has none
+set(PLAN_FSK_DATARATE 7)
+
+set(PLAN_TX_MIN_DATARATE 0)
+set(PLAN_TX_MAX_DATARATE 7)
+set(PLAN_RX_MIN_DATARATE 0)
+set(PLAN_RX_MAX_DATARATE 7)
+set(PLAN_DEFAULT_DATARATE 0)
+set(PLAN_MAX_RX1_DR_OFFSET 5)
+
+# Lowest TX power index, TX_POWER_0 is the highest
+set(PLAN_MIN_TX_POWER 7)
+set(PLAN_DEFAULT_MAX_EIRP 16.0f)
+set(PLAN_DEFAULT_ANTENNA_GAIN 2.15f)
+set(PLAN_DUTY_CYCLE_ENABLED 1)
+
+# Second reception window
+set(PLAN_RX_WND_2_FREQ 869525000)
+set(PLAN_RX_WND_2_DR 0)
+
+# Class B
+set(PLAN_BEACON_CHANNEL_FREQ 869525000)
+set(PLAN_BEACON_CHANNEL_DR 3)
+set(PLAN_BEACON_SIZE 17)
+set(PLAN_RFU1_SIZE 2)
+set(PLAN_RFU2_SIZE 0)
+set(PLAN_PING_SLOT_CHANNEL_DR 3)
@@ -134,13 +134,14 @@ SecureElementStatus_t SecureElementComputeAesCmac( uint8_t* micBxBuffer, uint8_t
 /*!
  * Verifies a CMAC (computes and compare with expected cmac)
  *
+ * \param[IN]  micBxBuffer    - Buffer containing the initial Bx block. May be NULL
  * \param[IN]  buffer         - Data buffer
  * \param[IN]  size           - Data buffer size
  * \param[in]  expectedCmac   - Expected cmac
  * \param[IN]  keyID          - Key identifier to determine the AES key to be used
  * \retval                    - Status of the operation
  */
-SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* buffer, uint16_t size, uint32_t expectedCmac, KeyIdentifier_t keyID );
+SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* micBxBuffer, uint8_t* buffer, uint16_t size, uint32_t expectedCmac, KeyIdentifier_t keyID );
 
 /*!
  * Encrypt a buffer
@@ -153,6 +154,116 @@ SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* buffer, uint16_t size
  */
 SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, KeyIdentifier_t keyID, uint8_t* encBuffer );
 
+/*!
+ * Batched command types
+ */
+typedef enum eSecureElementCmdType
+{
+    /*!
+     * Encrypts Buffer into EncBuffer, see \ref SecureElementAesEncrypt
+     */
+    SECURE_ELEMENT_CMD_AES_ENCRYPT,
+    /*!
+     * Computes the CMAC of MicBxBuffer and Buffer into Cmac, see
+     * \ref SecureElementComputeAesCmac
+     */
+    SECURE_ELEMENT_CMD_COMPUTE_AES_CMAC,
+    /*!
+     * Stores Buffer as the KeyID key, see \ref SecureElementSetKey
+     */
+    SECURE_ELEMENT_CMD_SET_KEY,
+    /*!
+     * Derives the TargetKeyID key from Buffer with the KeyID root key, see
+     * \ref SecureElementDeriveAndStoreKey
+     */
+    SECURE_ELEMENT_CMD_DERIVE_AND_STORE_KEY,
+}SecureElementCmdType_t;
+
+/*!
+ * Batched command
+ */
+typedef struct sSecureElementCmd
+{
+    /*!
+     * Command type
+     */
+    SecureElementCmdType_t Type;
+    /*!
+     * Key identifier to determine the AES key to be used
+     */
+    KeyIdentifier_t KeyID;
+    /*!
+     * Initial Bx block of a CMAC command. May be NULL
+     */
+    uint8_t* MicBxBuffer;
+    /*!
+     * Data buffer
+     */
+    uint8_t* Buffer;
+    /*!
+     * Data buffer size
+     */
+    uint16_t Size;
+    /*!
+     * Encrypted buffer of an encryption command
+     */
+    uint8_t* EncBuffer;
+    /*!
+     * Computed cmac of a CMAC command
+     */
+    uint32_t Cmac;
+    /*!
+     * Key identifier of the key stored by a derivation command
+     */
+    KeyIdentifier_t TargetKeyID;
+    /*!
+     * LoRaWAN specification version of a derivation command
+     */
+    Version_t Version;
+    /*!
+     * Status of the command
+     */
+    SecureElementStatus_t Status;
+}SecureElementCmd_t;
+
+/*!
+ * Signature of callback function to be called by the Secure Element driver when a
+ * batch of commands has been processed.
+ *
+ * \param[IN]  cmds           - Processed commands, holding their results
+ * \param[IN]  nbCmds         - Number of commands
+ * \param[IN]  status         - Status of the batch, the status of its first failed command
+ */
+typedef void ( *SecureElementBatchDone )( SecureElementCmd_t* cmds, uint8_t nbCmds, SecureElementStatus_t status );
+
+/*!
+ * Processes a batch of commands in a single secure element transaction
+ *
+ * \remark The processing stops at the first failed command, the following ones
+ *         are set to SECURE_ELEMENT_ERROR. The keys stored by the batch change
+ *         the NVM context once, at its end.
+ *
+ * \param[IN]  cmds           - Commands to process, hold their results on return
+ * \param[IN]  nbCmds         - Number of commands
+ * \retval                    - Status of the batch, the status of its first failed command
+ */
+SecureElementStatus_t SecureElementProcessBatch( SecureElementCmd_t* cmds, uint8_t nbCmds );
+
+/*!
+ * Starts processing a batch of commands in a single secure element transaction
+ *
+ * \remark An external secure element driver returns as soon as the transaction
+ *         is queued and calls batchDone from its bus completion interrupt.
+ *         The drivers running on the MCU call batchDone before returning.
+ *         The commands must remain valid until batchDone is called.
+ *
+ * \param[IN]  cmds           - Commands to process, hold their results on completion
+ * \param[IN]  nbCmds         - Number of commands
+ * \param[IN]  batchDone      - Callback function called once the batch is processed
+ * \retval                    - Status of the batch start
+ */
+SecureElementStatus_t SecureElementProcessBatchAsync( SecureElementCmd_t* cmds, uint8_t nbCmds, SecureElementBatchDone batchDone );
+
 /*!
  * Derives and store a key
  *
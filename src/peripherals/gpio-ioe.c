@@ -22,85 +22,163 @@
  */
 #include <stdlib.h>
 #include <stdbool.h>
+#include "utilities.h"
 #include "gpio-ioe.h"
 #include "sx1509.h"
 
+/*!
+ * First and last registers of the cached register image
+ */
+#define IOE_IMAGE_FIRST_REG                         RegOpenDrainB
+#define IOE_IMAGE_LAST_REG                          RegSenseLowA
+
+/*!
+ * Number of registers of the cached register image
+ */
+#define IOE_IMAGE_SIZE                              ( IOE_IMAGE_LAST_REG - IOE_IMAGE_FIRST_REG + 1 )
+
 static Gpio_t *GpioIrq[16];
 
-void GpioIoeInit( Gpio_t *obj, PinNames pin, PinModes mode,  PinConfigs config, PinTypes type, uint32_t value )
+/*!
+ * RAM image of the open drain, polarity, direction, data, interrupt mask and
+ * sense registers, initialized with the SX1509 reset values
+ */
+static uint8_t IoeImage[IOE_IMAGE_SIZE] =
 {
-    uint8_t regAdd = 0;
-    uint8_t regVal = 0;
-    uint8_t tempVal = 0;
+    0x00, 0x00, // RegOpenDrainB, RegOpenDrainA
+    0x00, 0x00, // RegPolarityB, RegPolarityA
+    0xFF, 0xFF, // RegDirB, RegDirA
+    0xFF, 0xFF, // RegDataB, RegDataA
+    0xFF, 0xFF, // RegInterruptMaskB, RegInterruptMaskA
+    0x00, 0x00, // RegSenseHighB, RegSenseLowB
+    0x00, 0x00, // RegSenseHighA, RegSenseLowA
+};
 
-    SX1509Init( );
+/*!
+ * Image registers changed since the last commit, bit n for IOE_IMAGE_FIRST_REG + n
+ */
+static uint16_t IoeImageDirty = 0;
 
-    obj->pin = pin;
-    obj->pinIndex = ( 0x01 << pin % 16 );
+/*!
+ * Set by GpioIoeInterruptHandler, the interrupt sources are read by
+ * GpioIoeProcess
+ */
+static volatile bool IoeIrqPending = false;
 
-    if( ( obj->pin % 16 ) > 0x07 )
+/*!
+ * \brief Gets the image register of the bank of the given pin
+ *
+ * \param [IN] obj  Pointer to the GPIO object
+ * \param [IN] regB Register address of bank B, bank A register follows it
+ * \retval regAdd Register address of the pin bank
+ */
+static uint8_t GpioIoeGetBankReg( Gpio_t *obj, uint8_t regB )
+{
+    return ( ( obj->pin % 16 ) > 0x07 ) ? regB : regB + 1;
+}
+
+/*!
+ * \brief Sets or clears the bits of an image register
+ *
+ * \param [IN] regAdd Register address
+ * \param [IN] bits   Bits to change
+ * \param [IN] value  New value of the bits
+ */
+static void GpioIoeImageUpdate( uint8_t regAdd, uint8_t bits, uint8_t value )
+{
+    uint8_t index = regAdd - IOE_IMAGE_FIRST_REG;
+    uint8_t regVal = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    regVal = ( IoeImage[index] & ~bits ) | ( value & bits );
+    if( regVal != IoeImage[index] )
     {
-        regAdd = RegDirB;
-        obj->pinIndex = ( obj->pinIndex >> 8 ) & 0x00FF;
+        IoeImage[index] = regVal;
+        IoeImageDirty |= 1 << index;
     }
-    else
+    CRITICAL_SECTION_END( );
+}
+
+/*!
+ * \brief Writes the changed image registers to the expander with a single
+ *        burst covering the first to the last changed register
+ */
+static void GpioIoeCommit( void )
+{
+    uint8_t buffer[IOE_IMAGE_SIZE];
+    uint8_t first = 0;
+    uint8_t last = 0;
+    uint16_t dirty = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    dirty = IoeImageDirty;
+    IoeImageDirty = 0;
+    for( uint8_t i = 0; i < IOE_IMAGE_SIZE; i++ )
     {
-        regAdd = RegDirA;
-        obj->pinIndex = ( obj->pinIndex ) & 0x00FF;
+        buffer[i] = IoeImage[i];
     }
+    CRITICAL_SECTION_END( );
 
-    SX1509Read( regAdd, &regVal );
-
-    if( mode == PIN_OUTPUT )
+    if( dirty == 0 )
     {
-        regVal = regVal & ~obj->pinIndex;
+        return;
     }
-    else
+    while( ( dirty & ( 1 << first ) ) == 0 )
+    {
+        first++;
+    }
+    for( last = IOE_IMAGE_SIZE - 1; ( dirty & ( 1 << last ) ) == 0; last-- )
     {
-        regVal = regVal | obj->pinIndex;
     }
-    SX1509Write( regAdd, regVal );
+    SX1509WriteBuffer( IOE_IMAGE_FIRST_REG + first, &buffer[first], last - first + 1 );
+}
 
+/*!
+ * \brief Sets the edge sensing of the given pin
+ *
+ * \param [IN] obj   Pointer to the GPIO object
+ * \param [IN] sense Edge sensing [0: none, 1: rising, 2: falling, 3: both]
+ */
+static void GpioIoeSetSense( Gpio_t *obj, uint8_t sense )
+{
+    uint8_t pin = obj->pin % 8;
+    uint8_t shift = ( pin % 4 ) * 2;
+    uint8_t regAdd = 0;
 
     if( ( obj->pin % 16 ) > 0x07 )
     {
-        SX1509Read( RegOpenDrainB, &tempVal );
-        if( config == PIN_OPEN_DRAIN )
-        {
-            SX1509Write( RegOpenDrainB, tempVal | obj->pinIndex );
-        }
-        else
-        {
-            SX1509Write( RegOpenDrainB, tempVal & ~obj->pinIndex );
-        }
-        regAdd = RegDataB;
+        regAdd = ( pin < 4 ) ? RegSenseLowB : RegSenseHighB;
     }
     else
     {
-        SX1509Read( RegOpenDrainA, &tempVal );
-        if( config == PIN_OPEN_DRAIN )
-        {
-            SX1509Write( RegOpenDrainA, tempVal | obj->pinIndex );
-        }
-        else
-        {
-            SX1509Write( RegOpenDrainA, tempVal & ~obj->pinIndex );
-        }
-        regAdd = RegDataA;
+        regAdd = ( pin < 4 ) ? RegSenseLowA : RegSenseHighA;
     }
+    GpioIoeImageUpdate( regAdd, 0x03 << shift, sense << shift );
+}
 
-    SX1509Read( regAdd, &regVal );
+void GpioIoeInit( Gpio_t *obj, PinNames pin, PinModes mode,  PinConfigs config, PinTypes type, uint32_t value )
+{
+    SX1509Init( );
 
-    // Sets initial output value
-    if( value == 0 )
+    obj->pin = pin;
+    obj->pinIndex = ( 0x01 << pin % 16 );
+
+    if( ( obj->pin % 16 ) > 0x07 )
     {
-        regVal = regVal & ~obj->pinIndex;
+        obj->pinIndex = ( obj->pinIndex >> 8 ) & 0x00FF;
     }
     else
     {
-        regVal = regVal | obj->pinIndex;
+        obj->pinIndex = ( obj->pinIndex ) & 0x00FF;
     }
-    SX1509Write( regAdd, regVal );
+
+    GpioIoeImageUpdate( GpioIoeGetBankReg( obj, RegDirB ), obj->pinIndex, ( mode == PIN_OUTPUT ) ? 0x00 : 0xFF );
+    GpioIoeImageUpdate( GpioIoeGetBankReg( obj, RegOpenDrainB ), obj->pinIndex, ( config == PIN_OPEN_DRAIN ) ? 0xFF : 0x00 );
+    // Sets initial output value
+    GpioIoeImageUpdate( GpioIoeGetBankReg( obj, RegDataB ), obj->pinIndex, ( value == 0 ) ? 0x00 : 0xFF );
+
+    // The pin configuration is applied right away
+    GpioIoeCommit( );
 }
 
 void GpioIoeSetContext( Gpio_t *obj, void* context )
@@ -110,10 +188,6 @@ void GpioIoeSetContext( Gpio_t *obj, void* context )
 
 void GpioIoeSetInterrupt( Gpio_t *obj, IrqModes irqMode, IrqPriorities irqPriority, GpioIrqHandler *irqHandler )
 {
-    uint8_t regAdd = 0;
-    uint8_t regVal = 0;
-    uint8_t i = 0;
-    uint16_t tempVal = 0;
     uint8_t val = 0;
 
     if( irqHandler == NULL )
@@ -123,19 +197,7 @@ void GpioIoeSetInterrupt( Gpio_t *obj, IrqModes irqMode, IrqPriorities irqPriori
 
     obj->IrqHandler = irqHandler;
 
-    if( ( obj->pin % 16 ) > 0x07 )
-    {
-        regAdd = RegInterruptMaskB;
-    }
-    else
-    {
-        regAdd = RegInterruptMaskA;
-    }
-
-    SX1509Read( regAdd, &regVal );
-
-    regVal = regVal & ~( obj->pinIndex );
-    SX1509Write( regAdd, regVal );
+    GpioIoeImageUpdate( GpioIoeGetBankReg( obj, RegInterruptMaskB ), obj->pinIndex, 0x00 );
 
     if( irqMode == IRQ_RISING_EDGE )
     {
@@ -149,200 +211,50 @@ void GpioIoeSetInterrupt( Gpio_t *obj, IrqModes irqMode, IrqPriorities irqPriori
     {
         val = 0x03;
     }
-
-    tempVal = 0x0000;
-    i = 0;
-    while( tempVal != obj->pinIndex )
-    {
-        tempVal = 0x01 << i;
-        i++;
-    }
-
-    if( i < 4 )
-    {
-        regAdd = RegSenseLowA;
-    }
-    else if( i < 9 )
-    {
-        regAdd = RegSenseHighA;
-    }
-    else if( i < 13 )
-    {
-        regAdd = RegSenseLowB;
-    }
-    else
-    {
-        regAdd = RegSenseHighB;
-    }
-    SX1509Read( regAdd, &regVal );
-
-    switch( i )
-    {
-        case 1:
-        case 5:
-        case 9:
-        case 13:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_1 ) | val;
-            break;
-
-        case 2:
-        case 6:
-        case 10:
-        case 14:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_2 ) | ( val << 2 );
-            break;
-
-        case 3:
-        case 7:
-        case 11:
-        case 15:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_3 ) | ( val << 4 );
-            break;
-
-        case 4:
-        case 8:
-        case 12:
-        case 16:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_4 ) | ( val << 6 );
-            break;
-    }
-    SX1509Write( regAdd, regVal );
+    GpioIoeSetSense( obj, val );
+    GpioIoeCommit( );
 
     GpioIrq[obj->pin & 0x0F] = obj;
 }
 
 void GpioIoeRemoveInterrupt( Gpio_t *obj )
 {
-    uint8_t regAdd = 0;
-    uint8_t regVal = 0;
-    uint8_t i = 0;
-    uint16_t tempVal = 0;
-
     // Clear callback before changing pin mode
     GpioIrq[obj->pin & 0x0F] = NULL;
 
-    if( ( obj->pin % 16 ) > 0x07 )
-    {
-        regAdd = RegInterruptMaskB;
-    }
-    else
-    {
-        regAdd = RegInterruptMaskA;
-    }
-
-    SX1509Read( regAdd, &regVal );
-
-    regVal = regVal | obj->pinIndex;
-    SX1509Write( regAdd, regVal );
-
-    tempVal = 0x0000;
-    i = 0;
-    while( tempVal != obj->pinIndex )
-    {
-        tempVal = 0x01 << i;
-        i++;
-    }
-
-    if( i < 4 )
-    {
-        regAdd = RegSenseLowA;
-    }
-    else if( i < 9 )
-    {
-        regAdd = RegSenseHighA;
-    }
-    else if( i < 13 )
-    {
-        regAdd = RegSenseLowB;
-    }
-    else
-    {
-        regAdd = RegSenseHighB;
-    }
-    SX1509Read( regAdd, &regVal );
-
-    switch( i )
-    {
-        case 1:
-        case 5:
-        case 9:
-        case 13:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_1 );
-            break;
-
-        case 2:
-        case 6:
-        case 10:
-        case 14:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_2 );
-            break;
-
-        case 3:
-        case 7:
-        case 11:
-        case 15:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_3 );
-            break;
-
-        case 4:
-        case 8:
-        case 12:
-        case 16:
-            regVal = ( regVal & REG_SENSE_PIN_MASK_4 );
-            break;
-    }
-    SX1509Write( regAdd, regVal );
+    GpioIoeImageUpdate( GpioIoeGetBankReg( obj, RegInterruptMaskB ), obj->pinIndex, 0xFF );
+    GpioIoeSetSense( obj, 0x00 );
+    GpioIoeCommit( );
 }
 
 void GpioIoeWrite( Gpio_t *obj, uint32_t value )
 {
-    uint8_t regAdd = 0;
-    uint8_t regVal = 0;
-
-    if( ( obj->pin % 16 ) > 0x07 )
-    {
-        regAdd = RegDataB;
-    }
-    else
-    {
-        regAdd = RegDataA;
-    }
-
-    SX1509Read( regAdd, &regVal );
-
-    // Sets initial output value
-    if( value == 0 )
-    {
-        regVal = regVal & ~obj->pinIndex;
-    }
-    else
-    {
-        regVal = regVal | obj->pinIndex;
-    }
-    SX1509Write( regAdd, regVal );
+    // Committed by the next GpioIoeProcess call
+    GpioIoeImageUpdate( GpioIoeGetBankReg( obj, RegDataB ), obj->pinIndex, ( value == 0 ) ? 0x00 : 0xFF );
 }
 
 void GpioIoeToggle( Gpio_t *obj )
 {
-    GpioIoeWrite( obj, GpioIoeRead( obj ) ^ 1 );
+    uint8_t regAdd = GpioIoeGetBankReg( obj, RegDataB );
+
+    GpioIoeImageUpdate( regAdd, obj->pinIndex, ~IoeImage[regAdd - IOE_IMAGE_FIRST_REG] );
 }
 
 uint32_t GpioIoeRead( Gpio_t *obj )
 {
-    uint8_t regAdd = 0;
+    uint8_t regAdd = GpioIoeGetBankReg( obj, RegDataB );
     uint8_t regVal = 0;
 
-    if( ( obj->pin % 16 ) > 0x07 )
+    if( ( IoeImage[GpioIoeGetBankReg( obj, RegDirB ) - IOE_IMAGE_FIRST_REG] & obj->pinIndex ) == 0 )
     {
-        regAdd = RegDataB;
+        // Output pin, the image holds the value
+        regVal = IoeImage[regAdd - IOE_IMAGE_FIRST_REG];
     }
     else
     {
-        regAdd = RegDataA;
+        SX1509Read( regAdd, &regVal );
     }
 
-    SX1509Read( regAdd, &regVal );
-
     if( ( regVal & obj->pinIndex ) == 0x00 )
     {
         return 0;
@@ -355,14 +267,29 @@ uint32_t GpioIoeRead( Gpio_t *obj )
 
 void GpioIoeInterruptHandler( void )
 {
-    uint8_t irqLsb = 0;
-    uint8_t irqMsb = 0;
+    IoeIrqPending = true;
+}
+
+void GpioIoeProcess( void )
+{
+    // RegInterruptSourceB, RegInterruptSourceA
+    uint8_t irqSource[2] = { 0 };
+    // RegInterruptSourceB to RegEventStatusA, clear all interrupts/events
+    uint8_t irqClear[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
     uint16_t irq = 0;
 
-    SX1509Read( RegInterruptSourceA, &irqLsb );
-    SX1509Read( RegInterruptSourceB, &irqMsb );
+    GpioIoeCommit( );
 
-    irq = ( irqMsb << 8 ) | irqLsb;
+    if( IoeIrqPending == false )
+    {
+        return;
+    }
+    IoeIrqPending = false;
+
+    SX1509ReadBuffer( RegInterruptSourceB, irqSource, 2 );
+    SX1509WriteBuffer( RegInterruptSourceB, irqClear, 4 );
+
+    irq = ( irqSource[0] << 8 ) | irqSource[1];
     if( irq != 0x00 )
     {
         for( uint16_t mask = 0x0001, pinIndex = 0; mask != 0x000; mask <<= 1, pinIndex++ )
@@ -376,10 +303,4 @@ void GpioIoeInterruptHandler( void )
             }
         }
     }
-
-    // Clear all interrupts/events
-    SX1509Write( RegInterruptSourceA, 0xFF );
-    SX1509Write( RegInterruptSourceB, 0xFF );
-    SX1509Write( RegEventStatusB, 0xFF );
-    SX1509Write( RegEventStatusA, 0xFF );
 }
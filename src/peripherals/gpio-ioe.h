@@ -70,6 +70,9 @@ void GpioIoeRemoveInterrupt( Gpio_t *obj );
 /*!
  * \brief Writes the given value to the GPIO output
  *
+ * \remark The value is written to the register image and committed to the
+ *         expander by the next GpioIoeProcess call.
+ *
  * \param [IN] obj   Pointer to the GPIO object
  * \param [IN] value New GPIO output value
  */
@@ -78,6 +81,8 @@ void GpioIoeWrite( Gpio_t *obj, uint32_t value );
 /*!
  * \brief Toggle the value to the GPIO output
  *
+ * \remark Committed to the expander by the next GpioIoeProcess call.
+ *
  * \param [IN] obj   Pointer to the GPIO object
  */
 void GpioIoeToggle( Gpio_t *obj );
@@ -92,7 +97,20 @@ uint32_t GpioIoeRead( Gpio_t *obj );
 
 /*!
  * \brief GpioIoeInterruptHandler callback function.
+ *
+ * \remark Only records the expander interrupt, the pin handlers are called by
+ *         GpioIoeProcess. Several interrupts before the next GpioIoeProcess
+ *         call are coalesced.
  */
 void GpioIoeInterruptHandler( void );
 
+/*!
+ * \brief Commits the register image changes with a single I2C burst, then
+ *        reads the interrupt sources with a single burst and calls the
+ *        handlers of all the pending pins.
+ *
+ * \remark Must be called once per iteration of the application main loop.
+ */
+void GpioIoeProcess( void );
+
 #endif // __GPIO_IOE_H__
@@ -0,0 +1,623 @@
+/*
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+    (C)2013 Semtech
+ ___ _____ _   ___ _  _____ ___  ___  ___ ___
+/ __|_   _/_\ / __| |/ / __/ _ \| _ \/ __| __|
+\__ \ | |/ _ \ (__| ' <| _| (_) |   / (__| _|
+|___/ |_/_/ \_\___|_|\_\_| \___/|_|_\\___|___|
+embedded.connectivity.solutions===============
+
+Description: Secure Element implementation on the MCU AES hardware accelerator
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+
+Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ),
+            Daniel Jaeckle ( STACKFORCE ),  Johannes Bruder ( STACKFORCE )
+*/
+#include "secure-element.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "LoRaMacCrypto.h"
+#include "utilities.h"
+#include "aes-board.h"
+#include "entropy.h"
+
+#define NUM_OF_KEYS      24
+#define KEY_SIZE         16
+
+/*!
+ * Identifier value pair type for Keys
+ */
+typedef struct sKey
+{
+    /*
+     * Key identifier, a KeyIdentifier_t value stored on a byte to keep the
+     * NVM context compact
+     */
+    uint8_t KeyID;
+    /*
+     * Key value
+     */
+    uint8_t KeyValue[KEY_SIZE];
+} Key_t;
+
+/*
+ * Secure Element Non Volatile Context structure
+ */
+typedef struct sSecureElementNvCtx
+{
+    /*
+     * DevEUI storage
+     */
+    uint8_t DevEui[SE_EUI_SIZE];
+    /*
+     * Join EUI storage
+     */
+    uint8_t JoinEui[SE_EUI_SIZE];
+    /*
+     * Key List
+     */
+    Key_t KeyList[NUM_OF_KEYS];
+}SecureElementNvCtx_t;
+
+/*
+ * Module context
+ */
+static SecureElementNvCtx_t SeNvmCtx;
+
+static SecureElementNvmEvent SeNvmCtxChanged;
+
+/*
+ * Batch being processed
+ */
+static bool SeBatchRunning = false;
+
+/*
+ * The batch changed the NVM context
+ */
+static bool SeBatchNvmCtxChanged = false;
+
+/*
+ * CMAC computation context
+ */
+typedef struct sCmacCtx
+{
+    /*
+     * Chaining value
+     */
+    uint8_t X[AES_MCU_BLOCK_SIZE];
+    /*
+     * Pending message block, processed by CmacUpdate or CmacFinal
+     */
+    uint8_t M_last[AES_MCU_BLOCK_SIZE];
+    /*
+     * Number of bytes in the pending message block
+     */
+    uint8_t M_n;
+} CmacCtx_t;
+
+/*
+ * Local functions
+ */
+
+/*
+ * Gets key item from key list.
+ *
+ *  cmac = aes128_cmac(keyID, B0 | msg)
+ *
+ * \param[IN]  keyID          - Key identifier
+ * \param[OUT] keyItem        - Key item reference
+ * \retval                    - Status of the operation
+ */
+SecureElementStatus_t GetKeyByID( KeyIdentifier_t keyID, Key_t** keyItem )
+{
+    for( uint8_t i = 0; i < NUM_OF_KEYS; i++ )
+    {
+        if( SeNvmCtx.KeyList[i].KeyID == keyID )
+        {
+            *keyItem = &( SeNvmCtx.KeyList[i] );
+            return SECURE_ELEMENT_SUCCESS;
+        }
+    }
+    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+}
+
+/*
+ * Dummy callback in case if the user provides NULL function pointer
+ */
+static void DummyCB( void )
+{
+    return;
+}
+
+/*
+ * Notifies the NVM context change, once at the end of a batch
+ */
+static void NotifyNvmCtxChanged( void )
+{
+    if( SeBatchRunning == true )
+    {
+        SeBatchNvmCtxChanged = true;
+    }
+    else
+    {
+        SeNvmCtxChanged( );
+    }
+}
+
+/*
+ * Xors two blocks
+ *
+ * \param[IN]  a                 - First block
+ * \param[IN]  b                 - Second block
+ * \param[OUT] out               - Result. May be one of the inputs
+ */
+static void XorBlock( const uint8_t* a, const uint8_t* b, uint8_t* out )
+{
+    for( uint8_t i = 0; i < AES_MCU_BLOCK_SIZE; i++ )
+    {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+/*
+ * Computes a CMAC subkey out of the previous one, RFC 4493 section 2.3
+ *
+ * \param[IN]  in                - L or K1
+ * \param[OUT] out               - K1 or K2
+ */
+static void CmacGenerateSubkey( const uint8_t* in, uint8_t* out )
+{
+    uint8_t msb = in[0] & 0x80;
+
+    for( uint8_t i = 0; i < ( AES_MCU_BLOCK_SIZE - 1 ); i++ )
+    {
+        out[i] = ( uint8_t )( ( in[i] << 1 ) | ( in[i + 1] >> 7 ) );
+    }
+    out[AES_MCU_BLOCK_SIZE - 1] = ( uint8_t )( in[AES_MCU_BLOCK_SIZE - 1] << 1 );
+
+    if( msb != 0 )
+    {
+        out[AES_MCU_BLOCK_SIZE - 1] ^= 0x87;
+    }
+}
+
+/*
+ * Starts a CMAC computation. The key must already be loaded into the
+ * AES accelerator.
+ *
+ * \param[OUT] ctx               - CMAC context
+ */
+static void CmacInit( CmacCtx_t* ctx )
+{
+    memset1( ctx->X, 0, AES_MCU_BLOCK_SIZE );
+    ctx->M_n = 0;
+}
+
+/*
+ * Processes a message chunk. The last complete block is kept pending as it
+ * has to be processed by CmacFinal.
+ *
+ * \param[IN]  ctx               - CMAC context
+ * \param[IN]  data              - Message chunk
+ * \param[IN]  len               - Message chunk length
+ */
+static void CmacUpdate( CmacCtx_t* ctx, const uint8_t* data, uint16_t len )
+{
+    while( len > 0 )
+    {
+        if( ctx->M_n == AES_MCU_BLOCK_SIZE )
+        {
+            XorBlock( ctx->X, ctx->M_last, ctx->X );
+            AesMcuEncrypt( ctx->X, ctx->X );
+            ctx->M_n = 0;
+        }
+        ctx->M_last[ctx->M_n++] = *data++;
+        len--;
+    }
+}
+
+/*
+ * Processes the pending block and outputs the CMAC
+ *
+ * \param[IN]  ctx               - CMAC context
+ * \param[OUT] cmac              - Computed CMAC
+ */
+static void CmacFinal( CmacCtx_t* ctx, uint8_t* cmac )
+{
+    uint8_t subkey[AES_MCU_BLOCK_SIZE] = { 0 };
+
+    // L = AES( key, 0 )
+    AesMcuEncrypt( subkey, subkey );
+    CmacGenerateSubkey( subkey, subkey );
+
+    if( ctx->M_n == AES_MCU_BLOCK_SIZE )
+    {
+        // Complete last block, use K1
+        XorBlock( ctx->M_last, subkey, ctx->M_last );
+    }
+    else
+    {
+        // Incomplete last block, pad it and use K2
+        CmacGenerateSubkey( subkey, subkey );
+        ctx->M_last[ctx->M_n] = 0x80;
+        for( uint8_t i = ctx->M_n + 1; i < AES_MCU_BLOCK_SIZE; i++ )
+        {
+            ctx->M_last[i] = 0;
+        }
+        XorBlock( ctx->M_last, subkey, ctx->M_last );
+    }
+
+    XorBlock( ctx->X, ctx->M_last, ctx->X );
+    AesMcuEncrypt( ctx->X, cmac );
+}
+
+/*
+ * Computes a CMAC of a message using provided initial Bx block
+ *
+ *  cmac = aes128_cmac(keyID, blocks[i].Buffer)
+ *
+ * \param[IN]  micBxBuffer    - Buffer containing the initial Bx block
+ * \param[IN]  buffer         - Data buffer
+ * \param[IN]  size           - Data buffer size
+ * \param[IN]  keyID          - Key identifier to determine the AES key to be used
+ * \param[OUT] cmac           - Computed cmac
+ * \retval                    - Status of the operation
+ */
+static SecureElementStatus_t ComputeCmac( uint8_t *micBxBuffer, uint8_t *buffer, uint16_t size, KeyIdentifier_t keyID, uint32_t* cmac )
+{
+    if( ( buffer == NULL ) || ( cmac == NULL ) )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+
+    uint8_t Cmac[16];
+    CmacCtx_t cmacCtx;
+
+    Key_t* keyItem;
+    SecureElementStatus_t retval = GetKeyByID( keyID, &keyItem );
+
+    if( retval == SECURE_ELEMENT_SUCCESS )
+    {
+        AesMcuSetKey( keyItem->KeyValue );
+        CmacInit( &cmacCtx );
+
+        if( micBxBuffer != NULL )
+        {
+            CmacUpdate( &cmacCtx, micBxBuffer, 16 );
+        }
+
+        CmacUpdate( &cmacCtx, buffer, size );
+
+        CmacFinal( &cmacCtx, Cmac );
+
+        // Bring into the required format
+        *cmac = ( uint32_t )( ( uint32_t ) Cmac[3] << 24 | ( uint32_t ) Cmac[2] << 16 | ( uint32_t ) Cmac[1] << 8 | ( uint32_t ) Cmac[0] );
+    }
+
+    return retval;
+}
+
+/*
+ * API functions
+ */
+
+SecureElementStatus_t SecureElementInit( SecureElementNvmEvent seNvmCtxChanged )
+{
+    uint8_t itr = 0;
+    uint8_t zeroKey[16] = { 0 };
+
+    // Initialize with defaults
+    SeNvmCtx.KeyList[itr++].KeyID = APP_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = GEN_APP_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = NWK_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = J_S_INT_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = J_S_ENC_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = F_NWK_S_INT_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = S_NWK_S_INT_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = NWK_S_ENC_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = APP_S_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_ROOT_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_KE_KEY;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_KEY_0;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_APP_S_KEY_0;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_NWK_S_KEY_0;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_KEY_1;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_APP_S_KEY_1;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_NWK_S_KEY_1;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_KEY_2;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_APP_S_KEY_2;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_NWK_S_KEY_2;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_KEY_3;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_APP_S_KEY_3;
+    SeNvmCtx.KeyList[itr++].KeyID = MC_NWK_S_KEY_3;
+    SeNvmCtx.KeyList[itr].KeyID = SLOT_RAND_ZERO_KEY;
+
+    // Set standard keys
+    memcpy1( SeNvmCtx.KeyList[itr].KeyValue, zeroKey, KEY_SIZE );
+
+    memset1( SeNvmCtx.DevEui, 0, SE_EUI_SIZE );
+    memset1( SeNvmCtx.JoinEui, 0, SE_EUI_SIZE );
+
+    AesMcuInit( );
+
+    // Assign callback
+    if( seNvmCtxChanged != 0 )
+    {
+        SeNvmCtxChanged = seNvmCtxChanged;
+    }
+    else
+    {
+        SeNvmCtxChanged = DummyCB;
+    }
+
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+SecureElementStatus_t SecureElementRestoreNvmCtx( void* seNvmCtx )
+{
+    // Restore nvm context
+    if( seNvmCtx != 0 )
+    {
+        memcpy1( ( uint8_t* ) &SeNvmCtx, ( uint8_t* ) seNvmCtx, sizeof( SeNvmCtx ) );
+        return SECURE_ELEMENT_SUCCESS;
+    }
+    else
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+}
+
+void* SecureElementGetNvmCtx( size_t* seNvmCtxSize )
+{
+    *seNvmCtxSize = sizeof( SeNvmCtx );
+    return &SeNvmCtx;
+}
+
+SecureElementStatus_t SecureElementSetKey( KeyIdentifier_t keyID, uint8_t* key )
+{
+    if( key == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+
+    for( uint8_t i = 0; i < NUM_OF_KEYS; i++ )
+    {
+        if( SeNvmCtx.KeyList[i].KeyID == keyID )
+        {
+            if( ( keyID == MC_KEY_0 ) || ( keyID == MC_KEY_1 ) || ( keyID == MC_KEY_2 ) || ( keyID == MC_KEY_3 ) )
+            {  // Decrypt the key if its a Mckey
+                SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
+                uint8_t decryptedKey[16] = { 0 };
+
+                retval = SecureElementAesEncrypt( key, 16, MC_KE_KEY, decryptedKey );
+
+                memcpy1( SeNvmCtx.KeyList[i].KeyValue, decryptedKey, KEY_SIZE );
+                NotifyNvmCtxChanged( );
+
+                return retval;
+            }
+            else
+            {
+                memcpy1( SeNvmCtx.KeyList[i].KeyValue, key, KEY_SIZE );
+                NotifyNvmCtxChanged( );
+                return SECURE_ELEMENT_SUCCESS;
+            }
+        }
+    }
+
+    return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+}
+
+SecureElementStatus_t SecureElementComputeAesCmac( uint8_t *micBxBuffer, uint8_t *buffer, uint16_t size, KeyIdentifier_t keyID, uint32_t* cmac )
+{
+    if( keyID >= LORAMAC_CRYPTO_MULTICAST_KEYS )
+    {
+        //Never accept multicast key identifier for cmac computation
+        return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+    }
+
+    return ComputeCmac( micBxBuffer, buffer, size, keyID, cmac );
+}
+
+SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* micBxBuffer, uint8_t* buffer, uint16_t size, uint32_t expectedCmac, KeyIdentifier_t keyID )
+{
+    if( buffer == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+
+    SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
+    uint32_t compCmac = 0;
+    retval = ComputeCmac( micBxBuffer, buffer, size, keyID, &compCmac );
+    if( retval != SECURE_ELEMENT_SUCCESS )
+    {
+        return retval;
+    }
+
+    if( expectedCmac != compCmac )
+    {
+        retval = SECURE_ELEMENT_FAIL_CMAC;
+    }
+
+    return retval;
+}
+
+SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, KeyIdentifier_t keyID, uint8_t* encBuffer )
+{
+    if( buffer == NULL || encBuffer == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+
+    // Check if the size is divisible by 16,
+    if( ( size % 16 ) != 0 )
+    {
+        return SECURE_ELEMENT_ERROR_BUF_SIZE;
+    }
+
+    Key_t* pItem;
+    SecureElementStatus_t retval = GetKeyByID( keyID, &pItem );
+
+    if( retval == SECURE_ELEMENT_SUCCESS )
+    {
+        AesMcuSetKey( pItem->KeyValue );
+
+        uint8_t block = 0;
+
+        while( size != 0 )
+        {
+            AesMcuEncrypt( &buffer[block], &encBuffer[block] );
+            block = block + 16;
+            size = size - 16;
+        }
+    }
+    return retval;
+}
+
+SecureElementStatus_t SecureElementProcessBatch( SecureElementCmd_t* cmds, uint8_t nbCmds )
+{
+    SecureElementStatus_t retval = SECURE_ELEMENT_SUCCESS;
+
+    if( cmds == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+    SeBatchRunning = true;
+
+    for( uint8_t i = 0; i < nbCmds; i++ )
+    {
+        if( retval != SECURE_ELEMENT_SUCCESS )
+        {
+            // A previous command failed
+            cmds[i].Status = SECURE_ELEMENT_ERROR;
+            continue;
+        }
+        switch( cmds[i].Type )
+        {
+            case SECURE_ELEMENT_CMD_AES_ENCRYPT:
+                cmds[i].Status = SecureElementAesEncrypt( cmds[i].Buffer, cmds[i].Size, cmds[i].KeyID, cmds[i].EncBuffer );
+                break;
+            case SECURE_ELEMENT_CMD_COMPUTE_AES_CMAC:
+                cmds[i].Status = SecureElementComputeAesCmac( cmds[i].MicBxBuffer, cmds[i].Buffer, cmds[i].Size, cmds[i].KeyID, &cmds[i].Cmac );
+                break;
+            case SECURE_ELEMENT_CMD_SET_KEY:
+                cmds[i].Status = SecureElementSetKey( cmds[i].KeyID, cmds[i].Buffer );
+                break;
+            case SECURE_ELEMENT_CMD_DERIVE_AND_STORE_KEY:
+                cmds[i].Status = SecureElementDeriveAndStoreKey( cmds[i].Version, cmds[i].Buffer, cmds[i].KeyID, cmds[i].TargetKeyID );
+                break;
+            default:
+                cmds[i].Status = SECURE_ELEMENT_ERROR;
+                break;
+        }
+        retval = cmds[i].Status;
+    }
+    SeBatchRunning = false;
+    if( SeBatchNvmCtxChanged == true )
+    {
+        SeBatchNvmCtxChanged = false;
+        SeNvmCtxChanged( );
+    }
+    return retval;
+}
+
+SecureElementStatus_t SecureElementProcessBatchAsync( SecureElementCmd_t* cmds, uint8_t nbCmds, SecureElementBatchDone batchDone )
+{
+    if( batchDone == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+    // The commands are processed by the MCU, the batch completes right away
+    SecureElementStatus_t retval = SecureElementProcessBatch( cmds, nbCmds );
+    if( retval != SECURE_ELEMENT_ERROR_NPE )
+    {
+        batchDone( cmds, nbCmds, retval );
+    }
+    return retval;
+}
+
+SecureElementStatus_t SecureElementDeriveAndStoreKey( Version_t version, uint8_t* input, KeyIdentifier_t rootKeyID, KeyIdentifier_t targetKeyID )
+{
+    if( input == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+
+    SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
+    uint8_t key[16] = { 0 };
+
+    // In case of MC_KE_KEY, prevent other keys than NwkKey or AppKey for LoRaWAN 1.1 or later
+    if( targetKeyID == MC_KE_KEY )
+    {
+        if( ( ( rootKeyID == APP_KEY ) && ( version.Fields.Minor == 0 ) ) || ( rootKeyID == NWK_KEY ) )
+        {
+            return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
+        }
+    }
+
+    // Derive key
+    retval = SecureElementAesEncrypt( input, 16, rootKeyID, key );
+    if( retval != SECURE_ELEMENT_SUCCESS )
+    {
+        return retval;
+    }
+
+    // Store key
+    retval = SecureElementSetKey( targetKeyID, key );
+    if( retval != SECURE_ELEMENT_SUCCESS )
+    {
+        return retval;
+    }
+
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+SecureElementStatus_t SecureElementRandomNumber( uint32_t* randomNum )
+{
+    if( randomNum == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+    *randomNum = EntropyGetRandom( );
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+SecureElementStatus_t SecureElementSetDevEui( uint8_t* devEui )
+{
+    if( devEui == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+    memcpy1( SeNvmCtx.DevEui, devEui, SE_EUI_SIZE );
+    SeNvmCtxChanged( );
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+uint8_t* SecureElementGetDevEui( void )
+{
+    return SeNvmCtx.DevEui;
+}
+
+SecureElementStatus_t SecureElementSetJoinEui( uint8_t* joinEui )
+{
+    if( joinEui == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+    memcpy1( SeNvmCtx.JoinEui, joinEui, SE_EUI_SIZE );
+    SeNvmCtxChanged( );
+    return SECURE_ELEMENT_SUCCESS;
+}
+
+uint8_t* SecureElementGetJoinEui( void )
+{
+    return SeNvmCtx.JoinEui;
+}
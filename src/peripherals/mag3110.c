@@ -62,7 +62,7 @@ uint8_t MAG3110Reset( void )
 
 uint8_t MAG3110Write( uint8_t addr, uint8_t data )
 {
-    return MAG3110WriteBuffer( addr, &data, 1 );
+    return I2cWrite( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t MAG3110WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -72,7 +72,7 @@ uint8_t MAG3110WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
 
 uint8_t MAG3110Read( uint8_t addr, uint8_t *data )
 {
-    return MAG3110ReadBuffer( addr, data, 1 );
+    return I2cRead( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t MAG3110ReadBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -89,3 +89,18 @@ uint8_t MAG3110GetDeviceAddr( void )
 {
     return I2cDeviceAddr;
 }
+
+uint8_t MAG3110ReadMagneticField( int16_t *x, int16_t *y, int16_t *z )
+{
+    uint8_t buffer[6];
+
+    // OUT_X_MSB to OUT_Z_LSB in a single burst
+    if( MAG3110ReadBuffer( MAG3110_OUT_X_MSB, buffer, 6 ) == FAIL )
+    {
+        return FAIL;
+    }
+    *x = ( int16_t )( ( buffer[0] << 8 ) | buffer[1] );
+    *y = ( int16_t )( ( buffer[2] << 8 ) | buffer[3] );
+    *z = ( int16_t )( ( buffer[4] << 8 ) | buffer[5] );
+    return SUCCESS;
+}
@@ -33,6 +33,7 @@
 /*!
  * MAG3110 Registers
  */
+#define MAG3110_OUT_X_MSB                               0x01
 #define MAG3110_ID                                      0x07
 
 /*!
@@ -101,4 +102,14 @@ void MAG3110SetDeviceAddr( uint8_t addr );
  */
 uint8_t MAG3110GetDeviceAddr( void );
 
+/*!
+ * \brief Reads the X, Y and Z axis magnetic field in a single I2C burst
+ *
+ * \param [OUT] x X axis magnetic field sample
+ * \param [OUT] y Y axis magnetic field sample
+ * \param [OUT] z Z axis magnetic field sample
+ * \retval status [SUCCESS, FAIL]
+ */
+uint8_t MAG3110ReadMagneticField( int16_t *x, int16_t *y, int16_t *z );
+
 #endif // __MAG3110_H__
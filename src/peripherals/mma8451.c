@@ -21,6 +21,7 @@
  * \author    Gregory Cristian ( Semtech )
  */
 #include <stdbool.h>
+#include <math.h>
 #include "utilities.h"
 #include "i2c.h"
 #include "mma8451.h"
@@ -31,6 +32,51 @@ static uint8_t I2cDeviceAddr = 0;
 
 static bool MMA8451Initialized = false;
 
+/*!
+ * Shadows of the CTRL_REG1, CTRL_REG4, CTRL_REG5 and PL_CFG registers,
+ * initialized with their reset values. The read-modify-write sequences skip
+ * the read.
+ */
+static uint8_t CtrlReg1 = 0x00;
+static uint8_t CtrlReg4 = 0x00;
+static uint8_t CtrlReg5 = 0x00;
+static uint8_t PlCfg = 0x80;
+
+/*!
+ * Acceleration counts per g with the default +/-2 g range
+ */
+#define MMA8451_COUNTS_PER_G                        4096
+
+/*!
+ * FIFO batch sampling context
+ */
+static struct
+{
+    uint8_t Watermark;
+    uint8_t Decimation;
+    uint8_t DecimationCount;
+    int32_t DecimationSum[3];
+    uint16_t NbSamples;
+    int32_t Sum[3];
+    int64_t SumSquares[3];
+    uint8_t Buffer[1 + ( 6 * MMA8451_FIFO_SIZE )];
+}Fifo;
+
+/*!
+ * \brief Clears the summary accumulators
+ */
+static void MMA8451FifoResetSummary( void )
+{
+    Fifo.DecimationCount = 0;
+    Fifo.NbSamples = 0;
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        Fifo.DecimationSum[i] = 0;
+        Fifo.Sum[i] = 0;
+        Fifo.SumSquares[i] = 0;
+    }
+}
+
 /*!
  * \brief Writes a byte at specified address in the device
  *
@@ -113,6 +159,11 @@ uint8_t MMA8451Reset( )
 {
     if( MMA8451Write( 0x2B, 0x40 ) == SUCCESS ) // Reset the MMA8451 with CTRL_REG2
     {
+        CtrlReg1 = 0x00;
+        CtrlReg4 = 0x00;
+        CtrlReg5 = 0x00;
+        PlCfg = 0x80;
+        Fifo.Watermark = 0;
         return SUCCESS;
     }
     return FAIL;
@@ -120,7 +171,7 @@ uint8_t MMA8451Reset( )
 
 uint8_t MMA8451Write( uint8_t addr, uint8_t data )
 {
-    return MMA8451WriteBuffer( addr, &data, 1 );
+    return I2cWrite( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t MMA8451WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -130,7 +181,7 @@ uint8_t MMA8451WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
 
 uint8_t MMA8451Read( uint8_t addr, uint8_t *data )
 {
-    return MMA8451ReadBuffer( addr, data, 1 );
+    return I2cRead( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t MMA8451ReadBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -156,32 +207,174 @@ uint8_t MMA8451GetOrientation( void )
     return orientation;
 }
 
-void MMA8451OrientDetect( void )
+uint8_t MMA8451ReadAcceleration( int16_t *x, int16_t *y, int16_t *z )
 {
-    uint8_t ctrlReg1 = 0;
-    uint8_t tmpReg = 0;
+    uint8_t buffer[6];
 
+    // OUT_X_MSB to OUT_Z_LSB in a single burst
+    if( MMA8451ReadBuffer( MMA8451_OUT_X_MSB, buffer, 6 ) == FAIL )
+    {
+        return FAIL;
+    }
+    // 14 bits samples, left aligned
+    *x = ( int16_t )( ( buffer[0] << 8 ) | buffer[1] ) >> 2;
+    *y = ( int16_t )( ( buffer[2] << 8 ) | buffer[3] ) >> 2;
+    *z = ( int16_t )( ( buffer[4] << 8 ) | buffer[5] ) >> 2;
+    return SUCCESS;
+}
+
+void MMA8451OrientDetect( void )
+{
     // Set device in standby mode
-    MMA8451Read( MMA8451_CTRL_REG1, &ctrlReg1 );
-    MMA8451Write( MMA8451_CTRL_REG1, ctrlReg1 & 0xFE );
+    CtrlReg1 &= 0xFE;
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
 
     // Set the data rate to 50 Hz
-    MMA8451Write( MMA8451_CTRL_REG1, ctrlReg1 | 0x20 );
+    CtrlReg1 |= 0x20;
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
 
     // Set enable orientation detection.
-    MMA8451Read( MMA8451_PL_CFG, &tmpReg );
-    MMA8451Write( MMA8451_PL_CFG, tmpReg | 0x40 );
+    PlCfg |= 0x40;
+    MMA8451Write( MMA8451_PL_CFG, PlCfg );
 
     // Enable orientation interrupt
-    MMA8451Write( MMA8451_CTRL_REG4, 0x10 );
+    CtrlReg4 |= 0x10;
+    MMA8451Write( MMA8451_CTRL_REG4, CtrlReg4 );
 
     // Select orientation interrupt pin INT1
-    MMA8451Write( MMA8451_CTRL_REG5, 0x10 );
+    CtrlReg5 |= 0x10;
+    MMA8451Write( MMA8451_CTRL_REG5, CtrlReg5 );
 
     // Set the debounce counter 5 -> 100 ms at 50 Hz
     MMA8451Write( MMA8451_PL_COUNT, 0x05 );
 
     // Set device in active mode
-    MMA8451Read( MMA8451_CTRL_REG1, &ctrlReg1 );
-    MMA8451Write( MMA8451_CTRL_REG1, ctrlReg1 | 0x01 );
+    CtrlReg1 |= 0x01;
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
+}
+
+uint8_t MMA8451FifoStart( MMA8451DataRate_t dataRate, uint8_t watermark, uint8_t decimation )
+{
+    if( ( MMA8451Initialized == false ) || ( watermark == 0 ) || ( watermark > MMA8451_FIFO_SIZE ) || ( decimation == 0 ) )
+    {
+        return FAIL;
+    }
+
+    Fifo.Watermark = watermark;
+    Fifo.Decimation = decimation;
+    MMA8451FifoResetSummary( );
+
+    // The FIFO mode and the data rate can only be changed in standby mode
+    CtrlReg1 &= 0xFE;
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
+
+    // Circular buffer mode, the oldest samples are discarded on overflow
+    MMA8451Write( MMA8451_F_SETUP, 0x40 | watermark );
+
+    // Set the data rate, F_READ cleared for 14 bits FIFO samples
+    CtrlReg1 = ( CtrlReg1 & 0xC5 ) | ( dataRate << 3 );
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
+
+    // Enable FIFO interrupt on pin INT1
+    CtrlReg4 |= 0x40;
+    MMA8451Write( MMA8451_CTRL_REG4, CtrlReg4 );
+    CtrlReg5 |= 0x40;
+    MMA8451Write( MMA8451_CTRL_REG5, CtrlReg5 );
+
+    // Set device in active mode
+    CtrlReg1 |= 0x01;
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
+    return SUCCESS;
+}
+
+void MMA8451FifoStop( void )
+{
+    CtrlReg1 &= 0xFE;
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
+
+    MMA8451Write( MMA8451_F_SETUP, 0x00 );
+    CtrlReg4 &= ( uint8_t )~0x40;
+    MMA8451Write( MMA8451_CTRL_REG4, CtrlReg4 );
+    CtrlReg5 &= ( uint8_t )~0x40;
+    MMA8451Write( MMA8451_CTRL_REG5, CtrlReg5 );
+
+    CtrlReg1 |= 0x01;
+    MMA8451Write( MMA8451_CTRL_REG1, CtrlReg1 );
+    Fifo.Watermark = 0;
+}
+
+/*!
+ * \brief Adds a FIFO sample to the decimation stage and the decimated
+ *        samples to the summary accumulators
+ *
+ * \param [IN] sample OUT_X_MSB to OUT_Z_LSB values of a FIFO sample
+ */
+static void MMA8451FifoAddSample( const uint8_t *sample )
+{
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        // 14 bits samples, left aligned
+        Fifo.DecimationSum[i] += ( int16_t )( ( sample[2 * i] << 8 ) | sample[2 * i + 1] ) >> 2;
+    }
+    if( ++Fifo.DecimationCount < Fifo.Decimation )
+    {
+        return;
+    }
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        int32_t value = Fifo.DecimationSum[i] / Fifo.Decimation;
+
+        Fifo.Sum[i] += value;
+        Fifo.SumSquares[i] += ( int64_t )value * value;
+        Fifo.DecimationSum[i] = 0;
+    }
+    Fifo.DecimationCount = 0;
+    Fifo.NbSamples++;
+}
+
+uint8_t MMA8451FifoProcess( void )
+{
+    uint8_t nbSamples = 0;
+
+    if( Fifo.Watermark == 0 )
+    {
+        return 0;
+    }
+
+    // F_STATUS and the watermark samples in a single burst, the read address
+    // wraps from OUT_Z_LSB to OUT_X_MSB while the FIFO is enabled
+    if( MMA8451ReadBuffer( MMA8451_STATUS, Fifo.Buffer, 1 + ( 6 * Fifo.Watermark ) ) == FAIL )
+    {
+        return 0;
+    }
+
+    // F_CNT, the samples above the watermark are read by the next drain
+    nbSamples = Fifo.Buffer[0] & 0x3F;
+    if( nbSamples > Fifo.Watermark )
+    {
+        nbSamples = Fifo.Watermark;
+    }
+    for( uint8_t i = 0; i < nbSamples; i++ )
+    {
+        MMA8451FifoAddSample( &Fifo.Buffer[1 + ( 6 * i )] );
+    }
+    return nbSamples;
+}
+
+void MMA8451FifoGetSummary( MMA8451VibrationSummary_t *summary )
+{
+    summary->NbSamples = Fifo.NbSamples;
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        double variance = 0;
+
+        if( Fifo.NbSamples != 0 )
+        {
+            double mean = ( double )Fifo.Sum[i] / Fifo.NbSamples;
+
+            variance = ( ( double )Fifo.SumSquares[i] / Fifo.NbSamples ) - ( mean * mean );
+        }
+        summary->Rms[i] = ( variance > 0 ) ? ( float )( sqrt( variance ) / MMA8451_COUNTS_PER_G ) : 0;
+    }
+    MMA8451FifoResetSummary( );
 }
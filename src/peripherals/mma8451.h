@@ -35,6 +35,7 @@
  */ 
 #define MMA8451_STATUS                               0x00 //
 #define MMA8451_OUT_X_MSB                            0x01 //
+#define MMA8451_F_SETUP                              0x09 // FIFO setup
 #define MMA8451_SYSMOD                               0x0B //
 #define MMA8451_INT_SOURCE                           0x0C //
 #define MMA8451_ID                                   0x0D //
@@ -55,6 +56,41 @@
 #define MMA8451_CTRL_REG4                            0x2D // Interrupt enable
 #define MMA8451_CTRL_REG5                            0x2E // Interrupt pin selection
 
+/*!
+ * MMA8451 FIFO depth in samples
+ */
+#define MMA8451_FIFO_SIZE                            32
+
+/*!
+ * MMA8451 output data rates
+ */
+typedef enum
+{
+    MMA8451_DR_800_HZ,
+    MMA8451_DR_400_HZ,
+    MMA8451_DR_200_HZ,
+    MMA8451_DR_100_HZ,
+    MMA8451_DR_50_HZ,
+    MMA8451_DR_12_5_HZ,
+    MMA8451_DR_6_25_HZ,
+    MMA8451_DR_1_56_HZ,
+}MMA8451DataRate_t;
+
+/*!
+ * Vibration summary of the samples drained from the FIFO
+ */
+typedef struct MMA8451VibrationSummary_s
+{
+    /*!
+     * Number of decimated samples
+     */
+    uint16_t NbSamples;
+    /*!
+     * X, Y and Z axis RMS of the acceleration around its mean [g]
+     */
+    float Rms[3];
+}MMA8451VibrationSummary_t;
+
 /*!
  * \brief Initializes the device
  *
@@ -83,4 +119,48 @@ void MMA8451OrientDetect( void );
  */
 uint8_t MMA8451GetOrientation( void );
 
+/*!
+ * \brief Reads the X, Y and Z axis accelerations in a single I2C burst
+ *
+ * \param [OUT] x X axis 14 bits acceleration sample
+ * \param [OUT] y Y axis 14 bits acceleration sample
+ * \param [OUT] z Z axis 14 bits acceleration sample
+ * \retval status [SUCCESS, FAIL]
+ */
+uint8_t MMA8451ReadAcceleration( int16_t *x, int16_t *y, int16_t *z );
+
+/*!
+ * \brief Starts the FIFO batch sampling mode
+ *
+ * \remark The FIFO interrupt is routed to the INT1 pin. It fires once
+ *         watermark samples are buffered, MMA8451FifoProcess must then be
+ *         called before the FIFO overflows.
+ *
+ * \param [IN] dataRate   Output data rate
+ * \param [IN] watermark  Number of buffered samples triggering the interrupt [1:32]
+ * \param [IN] decimation Number of FIFO samples averaged per summary sample
+ * \retval status [SUCCESS, FAIL]
+ */
+uint8_t MMA8451FifoStart( MMA8451DataRate_t dataRate, uint8_t watermark, uint8_t decimation );
+
+/*!
+ * \brief Stops the FIFO batch sampling mode
+ */
+void MMA8451FifoStop( void );
+
+/*!
+ * \brief Drains the FIFO with a single I2C burst and feeds the samples to the
+ *        summary
+ *
+ * \retval nbSamples Number of drained samples
+ */
+uint8_t MMA8451FifoProcess( void );
+
+/*!
+ * \brief Gets the summary of the samples drained since the previous call
+ *
+ * \param [OUT] summary Vibration summary
+ */
+void MMA8451FifoGetSummary( MMA8451VibrationSummary_t *summary );
+
 #endif // __MMA8451_H__
@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include "utilities.h"
 #include "delay.h"
+#include "timer.h"
 #include "i2c.h"
 #include "mpl3115.h"
 
@@ -47,6 +48,34 @@ typedef enum
     ALTITUDE,
 }BarometerReadingType_t;
 
+/*!
+ * Number of registers read by a sample burst, STATUS_REG to OUT_T_LSB_REG
+ */
+#define MPL3115_SAMPLE_SIZE                         6
+
+/*!
+ * One shot conversion time with the OS_32 oversampling ratio [ms]
+ */
+#define MPL3115_CONVERSION_TIME                     130
+
+/*!
+ * Shadow of the CTRL_REG1 register. Every CTRL_REG1 write goes through
+ * MPL3115WriteCtrlReg1, the read-modify-write sequences skip the read.
+ */
+static uint8_t CtrlReg1 = 0;
+
+/*!
+ * Non-blocking reading context
+ */
+static struct
+{
+    BarometerReadingType_t Type;
+    MPL3115ReadingCallback *Callback;
+    uint8_t Retries;
+    TimerEvent_t Timer;
+    uint8_t Sample[MPL3115_SAMPLE_SIZE];
+}AsyncReading;
+
 /*!
  * \brief Writes a byte at specified address in the device
  *
@@ -125,6 +154,10 @@ void MPL3115SetModeActive( void );
  */
 void MPL3115ToggleOneShot( void );
 
+static uint8_t MPL3115WriteCtrlReg1( uint8_t value );
+static void OnSampleTimerEvent( void* context );
+static void OnSampleRead( void* context, uint8_t status );
+
 uint8_t MPL3115Init( void )
 {
     uint8_t regVal = 0;
@@ -134,6 +167,7 @@ uint8_t MPL3115Init( void )
     if( MPL3115Initialized == false )
     {
         MPL3115Write( CTRL_REG1, RST );
+        CtrlReg1 = 0;
         DelayMs( 50 );
         I2cResetBus( &I2c );
 
@@ -145,7 +179,7 @@ uint8_t MPL3115Init( void )
         }
 
         MPL3115Write( PT_DATA_CFG_REG, DREM | PDEFE | TDEFE );      // Enable data ready flags for pressure and temperature )
-        MPL3115Write( CTRL_REG1, ALT | OS_32 | SBYB );              // Set sensor to active state with oversampling ratio 128 (512 ms between samples)
+        MPL3115WriteCtrlReg1( ALT | OS_32 | SBYB );                 // Set sensor to active state with oversampling ratio 128 (512 ms between samples)
         MPL3115Initialized = true;
     }
     return SUCCESS;
@@ -156,6 +190,7 @@ uint8_t MPL3115Reset( void )
     // Reset all registers to POR values
     if( MPL3115Write( CTRL_REG1, RST ) == SUCCESS )
     {
+        CtrlReg1 = 0;
         return SUCCESS;
     }
     return FAIL;
@@ -163,7 +198,7 @@ uint8_t MPL3115Reset( void )
 
 uint8_t MPL3115Write( uint8_t addr, uint8_t data )
 {
-    return MPL3115WriteBuffer( addr, &data, 1 );
+    return I2cWrite( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t MPL3115WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -173,7 +208,7 @@ uint8_t MPL3115WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
 
 uint8_t MPL3115Read( uint8_t addr, uint8_t *data )
 {
-    return MPL3115ReadBuffer( addr, data, 1 );
+    return I2cRead( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t MPL3115ReadBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -191,18 +226,29 @@ uint8_t MPL3115GetDeviceAddr( void )
     return I2cDeviceAddr;
 }
 
-static float MPL3115ReadBarometer( BarometerReadingType_t type )
+/*!
+ * \brief Writes the CTRL_REG1 register and updates its shadow
+ *
+ * \param [IN]: value
+ * \retval status [SUCCESS, FAIL]
+ */
+static uint8_t MPL3115WriteCtrlReg1( uint8_t value )
 {
-    uint8_t counter = 0;
-    uint8_t tempBuf[3];
-    uint8_t msb = 0, csb = 0, lsb = 0;
-    uint8_t status = 0;
-
-    if( MPL3115Initialized == false )
+    if( MPL3115Write( CTRL_REG1, value ) == FAIL )
     {
-        return 0;
+        return FAIL;
     }
+    CtrlReg1 = value;
+    return SUCCESS;
+}
 
+/*!
+ * \brief Selects the barometer reading type and starts a one shot conversion
+ *
+ * \param [IN]: type
+ */
+static void MPL3115StartConversion( BarometerReadingType_t type )
+{
     if( type == ALTITUDE )
     {
         MPL3115SetModeAltimeter( );
@@ -211,50 +257,48 @@ static float MPL3115ReadBarometer( BarometerReadingType_t type )
     {
         MPL3115SetModeBarometer( );
     }
-
     MPL3115ToggleOneShot( );
+}
 
-    while( ( status & PDR ) != PDR )
-    {
-        MPL3115Read( STATUS_REG, &status );
-        DelayMs( 10 );
-        counter++;
+/*!
+ * \brief Polls the device until the data ready flags are set. The status and
+ *        the pressure and temperature samples are read in a single burst.
+ *
+ * \param [IN]:  flags
+ * \param [OUT]: sample STATUS_REG to OUT_T_LSB_REG registers values
+ * \retval status [SUCCESS, FAIL]
+ */
+static uint8_t MPL3115WaitSample( uint8_t flags, uint8_t *sample )
+{
+    uint8_t counter = 0;
 
+    sample[0] = 0;
+    while( ( sample[0] & flags ) != flags )
+    {
         if( counter > 20 )
         {
-            MPL3115Initialized = false;
-            MPL3115Init( );
-            if( type == ALTITUDE )
-            {
-                MPL3115SetModeAltimeter( );
-            }
-            else
-            {
-                MPL3115SetModeBarometer( );
-            }
-            MPL3115ToggleOneShot( );
-            counter = 0;
-
-            while( ( status & PDR ) != PDR )
-            {
-                MPL3115Read( STATUS_REG, &status );
-                DelayMs( 10 );
-                counter++;
-
-                if( counter > 20 )
-                {
-                    // Error out after max of 512 ms for a read
-                    return 0;
-                }
-            }
+            // Error out after max of 512 ms for a read
+            return FAIL;
         }
+        MPL3115ReadBuffer( STATUS_REG, sample, MPL3115_SAMPLE_SIZE );
+        DelayMs( 10 );
+        counter++;
     }
+    return SUCCESS;
+}
 
-    MPL3115ReadBuffer( OUT_P_MSB_REG, tempBuf, 3 );       //Read altitude data
-
-    msb = tempBuf[0];
-    csb = tempBuf[1];
-    lsb = tempBuf[2];
+/*!
+ * \brief Converts the pressure or altitude sample
+ *
+ * \param [IN]: type
+ * \param [IN]: sample STATUS_REG to OUT_T_LSB_REG registers values
+ * \retval barometer Altitude [m] or pressure [Pa]
+ */
+static float MPL3115DecodeBarometer( BarometerReadingType_t type, const uint8_t *sample )
+{
+    uint8_t msb = sample[OUT_P_MSB_REG];
+    uint8_t csb = sample[OUT_P_CSB_REG];
+    uint8_t lsb = sample[OUT_P_LSB_REG];
 
     if( type == ALTITUDE )
     {
@@ -274,6 +318,63 @@ static float MPL3115ReadBarometer( BarometerReadingType_t type )
     }
 }
 
+/*!
+ * \brief Converts the temperature sample
+ *
+ * \param [IN]: sample STATUS_REG to OUT_T_LSB_REG registers values
+ * \retval temperature Temperature [C]
+ */
+static float MPL3115DecodeTemperature( const uint8_t *sample )
+{
+    uint8_t msb = sample[OUT_T_MSB_REG];
+    uint8_t lsb = sample[OUT_T_LSB_REG];
+    bool negSign = false;
+    uint8_t val = 0;
+
+    if( msb > 0x7F )
+    {
+        val = ~( ( msb << 8 ) + lsb ) + 1;      // 2's complement
+        msb = val >> 8;
+        lsb = val & 0x00F0;
+        negSign = true;
+    }
+
+    if( negSign == true )
+    {
+        return 0 - ( msb + ( float )( ( lsb >> 4 ) / 16.0 ) );
+    }
+    else
+    {
+        return msb + ( float )( ( lsb >> 4 ) / 16.0 );
+    }
+}
+
+static float MPL3115ReadBarometer( BarometerReadingType_t type )
+{
+    uint8_t sample[MPL3115_SAMPLE_SIZE];
+
+    if( MPL3115Initialized == false )
+    {
+        return 0;
+    }
+
+    MPL3115StartConversion( type );
+
+    if( MPL3115WaitSample( PDR, sample ) == FAIL )
+    {
+        MPL3115Initialized = false;
+        MPL3115Init( );
+        MPL3115StartConversion( type );
+
+        if( MPL3115WaitSample( PDR, sample ) == FAIL )
+        {
+            return 0;
+        }
+    }
+
+    return MPL3115DecodeBarometer( type, sample );
+}
+
 float MPL3115ReadAltitude( void )
 {
     return MPL3115ReadBarometer( ALTITUDE );
@@ -286,13 +387,8 @@ float MPL3115ReadPressure( void )
 
 float MPL3115ReadTemperature( void )
 {
-    uint8_t counter = 0;
-    uint8_t tempBuf[2];
-    uint8_t msb = 0, lsb = 0;
-    bool negSign = false;
-    uint8_t val = 0;
+    uint8_t sample[MPL3115_SAMPLE_SIZE];
     float temperature = 0;
-    uint8_t status = 0;
 
     if( MPL3115Initialized == false )
     {
@@ -301,118 +397,120 @@ float MPL3115ReadTemperature( void )
 
     MPL3115ToggleOneShot( );
 
-    while( ( status & TDR ) != TDR )
+    if( MPL3115WaitSample( TDR, sample ) == FAIL )
     {
-        MPL3115Read( STATUS_REG, &status );
-        DelayMs( 10 );
-        counter++;
+        MPL3115Initialized = false;
+        MPL3115Init( );
+        MPL3115ToggleOneShot( );
 
-        if( counter > 20 )
+        if( MPL3115WaitSample( TDR, sample ) == FAIL )
         {
-            MPL3115Initialized = false;
-            MPL3115Init( );
-            MPL3115ToggleOneShot( );
-            counter = 0;
-
-            while( ( status & TDR ) != TDR )
-            {
-                MPL3115Read( STATUS_REG, &status );
-                DelayMs( 10 );
-                counter++;
-
-                if( counter > 20 )
-                {
-                    // Error out after max of 512 ms for a read
-                    return 0;
-                }
-            }
+            return 0;
         }
     }
 
-    MPL3115ReadBuffer( OUT_T_MSB_REG, tempBuf, 2 );
+    temperature = MPL3115DecodeTemperature( sample );
 
-    msb = tempBuf[0];
-    lsb = tempBuf[1];
+    MPL3115ToggleOneShot( );
 
-    if( msb > 0x7F )
+    return( temperature );
+}
+
+/*!
+ * \brief Reads the sample once the conversion time is elapsed
+ */
+static void OnSampleTimerEvent( void* context )
+{
+    I2cSetTransferCallback( &I2c, OnSampleRead, NULL );
+    if( I2cReadBuffer( &I2c, I2cDeviceAddr << 1, STATUS_REG, AsyncReading.Sample, MPL3115_SAMPLE_SIZE ) == FAIL )
     {
-        val = ~( ( msb << 8 ) + lsb ) + 1;      // 2s complement
-        msb = val >> 8;
-        lsb = val & 0x00F0;
-        negSign = true;
+        OnSampleRead( NULL, FAIL );
     }
+}
 
-    if( negSign == true )
+/*!
+ * \brief Completes the non-blocking reading or polls the device again when
+ *        the sample is not ready yet
+ */
+static void OnSampleRead( void* context, uint8_t status )
+{
+    MPL3115ReadingCallback *callback = AsyncReading.Callback;
+
+    I2cSetTransferCallback( &I2c, NULL, NULL );
+
+    if( ( status == SUCCESS ) && ( ( AsyncReading.Sample[0] & ( PDR | TDR ) ) != ( PDR | TDR ) ) )
+    {
+        if( AsyncReading.Retries < 20 )
+        {
+            AsyncReading.Retries++;
+            TimerSetValue( &AsyncReading.Timer, 10 );
+            TimerStart( &AsyncReading.Timer );
+            return;
+        }
+        status = FAIL;
+    }
+
+    AsyncReading.Callback = NULL;
+    if( status == FAIL )
     {
-        temperature = 0 - ( msb + ( float )( ( lsb >> 4 ) / 16.0 ) );
+        callback( FAIL, 0, 0 );
     }
     else
     {
-        temperature = msb + ( float )( ( lsb >> 4 ) / 16.0 );
+        callback( SUCCESS, MPL3115DecodeBarometer( AsyncReading.Type, AsyncReading.Sample ),
+                  MPL3115DecodeTemperature( AsyncReading.Sample ) );
     }
+}
 
-    MPL3115ToggleOneShot( );
+uint8_t MPL3115StartReading( bool altitude, MPL3115ReadingCallback *callback )
+{
+    if( ( MPL3115Initialized == false ) || ( callback == NULL ) || ( AsyncReading.Callback != NULL ) )
+    {
+        return FAIL;
+    }
 
-    return( temperature );
+    AsyncReading.Type = ( altitude == true ) ? ALTITUDE : PRESSURE;
+    AsyncReading.Callback = callback;
+    AsyncReading.Retries = 0;
+
+    MPL3115StartConversion( AsyncReading.Type );
+
+    TimerInit( &AsyncReading.Timer, OnSampleTimerEvent );
+    TimerSetValue( &AsyncReading.Timer, MPL3115_CONVERSION_TIME );
+    TimerStart( &AsyncReading.Timer );
+    return SUCCESS;
 }
 
 void MPL3115ToggleOneShot( void )
 {
-    uint8_t ctrlReg = 0;
-
     MPL3115SetModeStandby( );
 
-    MPL3115Read( CTRL_REG1, &ctrlReg );           // Read current settings
-    ctrlReg &= ~OST;                              // Clear OST bit
-    MPL3115Write( CTRL_REG1, ctrlReg );
-
-    MPL3115Read( CTRL_REG1, &ctrlReg );           // Read current settings to be safe
-    ctrlReg |= OST;                               // Set OST bit
-    MPL3115Write( CTRL_REG1, ctrlReg );
+    MPL3115WriteCtrlReg1( CtrlReg1 & ~OST );        // Clear OST bit
+    MPL3115WriteCtrlReg1( CtrlReg1 | OST );         // Set OST bit
 
     MPL3115SetModeActive( );
 }
 
 void MPL3115SetModeBarometer( void )
 {
-    uint8_t ctrlReg = 0;
-
     MPL3115SetModeStandby( );
-
-    MPL3115Read( CTRL_REG1, &ctrlReg );           // Read current settings
-    ctrlReg &= ~ALT;                              // Set ALT bit to zero
-    MPL3115Write( CTRL_REG1, ctrlReg );
-
+    MPL3115WriteCtrlReg1( CtrlReg1 & ~ALT );        // Set ALT bit to zero
     MPL3115SetModeActive( );
 }
 
 void MPL3115SetModeAltimeter( void )
 {
-    uint8_t ctrlReg = 0;
-
     MPL3115SetModeStandby( );
-
-    MPL3115Read( CTRL_REG1, &ctrlReg );           // Read current settings
-    ctrlReg |= ALT;                               // Set ALT bit to one
-    MPL3115Write( CTRL_REG1, ctrlReg );
-
+    MPL3115WriteCtrlReg1( CtrlReg1 | ALT );         // Set ALT bit to one
     MPL3115SetModeActive( );
 }
 
 void MPL3115SetModeStandby( void )
 {
-    uint8_t ctrlReg = 0;
-
-    MPL3115Read( CTRL_REG1, &ctrlReg );
-    ctrlReg &= ~SBYB;                             // Clear SBYB bit for Standby mode
-    MPL3115Write( CTRL_REG1, ctrlReg );
+    MPL3115WriteCtrlReg1( CtrlReg1 & ~SBYB );       // Clear SBYB bit for Standby mode
 }
 
 void MPL3115SetModeActive( void )
 {
-    uint8_t ctrlReg = 0;
-
-    MPL3115Read( CTRL_REG1, &ctrlReg );
-    ctrlReg |= SBYB;                              // Set SBYB bit for Active mode
-    MPL3115Write( CTRL_REG1, ctrlReg );
+    MPL3115WriteCtrlReg1( CtrlReg1 | SBYB );        // Set SBYB bit for Active mode
 }
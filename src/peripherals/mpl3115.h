@@ -24,6 +24,7 @@
 #define __MPL3115_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /*
  * MPL3115A2 I2C address
@@ -120,6 +121,15 @@
 #define PDEFE                 0x02
 #define TDEFE                 0x01
 
+/*!
+ * Non-blocking reading completion callback
+ *
+ * \param [IN] status      [SUCCESS, FAIL]
+ * \param [IN] barometer   Measured altitude or pressure
+ * \param [IN] temperature Measured temperature
+ */
+typedef void( MPL3115ReadingCallback )( uint8_t status, float barometer, float temperature );
+
 /*!
  * \brief Initializes the device
  *
@@ -155,4 +165,18 @@ float MPL3115ReadPressure( void );
  */
 float MPL3115ReadTemperature( void );
 
+/*!
+ * \brief Starts a non-blocking reading of the altitude or pressure and of the
+ *        temperature
+ *
+ * \remark The MCU can sleep during the conversion. The sample is read with a
+ *         single I2C burst and the callback is called from interrupt context.
+ *         The I2C bus must not be used until the callback is called.
+ *
+ * \param [IN] altitude Reads the altitude when true, the pressure otherwise
+ * \param [IN] callback Reading completion callback
+ * \retval status [SUCCESS, FAIL]
+ */
+uint8_t MPL3115StartReading( bool altitude, MPL3115ReadingCallback *callback );
+
 #endif // __MPL3115_H__
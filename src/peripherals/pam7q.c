@@ -20,14 +20,33 @@
  *
  * \author    Gregory Cristian ( Semtech )
  */
+#include <stddef.h>
 #include "utilities.h"
 #include "i2c.h"
+#include "gps.h"
 #include "pam7q.h"
 
 extern I2c_t I2c;
 
 static uint8_t I2cDeviceAddr = 0;
 
+/*!
+ * Non-blocking readout context
+ */
+static struct
+{
+    PAM7QReadoutCallback *Callback;
+    /*!
+     * Number of bytes still to be read, the size registers are read first
+     */
+    uint16_t PendingBytes;
+    bool SizeRead;
+    uint8_t NbParsed;
+    uint8_t Buffer[PAM7Q_READOUT_CHUNK_SIZE];
+}AsyncReadout;
+
+static void OnReadoutDone( void* context, uint8_t status );
+
 void PAM7QInit( void )
 {
     PAM7QSetDeviceAddr( PAM7Q_I2C_ADDRESS );
@@ -80,6 +99,93 @@ bool PAM7QGetGpsData( uint8_t *nmeaString, uint8_t *nmeaStringSize, uint16_t nme
     return result;
 }
 
+/*!
+ * \brief Reads the next burst of the readout or completes it
+ */
+static void PAM7QReadNextChunk( void )
+{
+    PAM7QReadoutCallback *callback = AsyncReadout.Callback;
+
+    if( AsyncReadout.PendingBytes > 0 )
+    {
+        uint16_t size = MIN( AsyncReadout.PendingBytes, PAM7Q_READOUT_CHUNK_SIZE );
+
+        if( I2cReadBuffer( &I2c, I2cDeviceAddr << 1, PAYLOAD, AsyncReadout.Buffer, size ) == FAIL )
+        {
+            OnReadoutDone( NULL, FAIL );
+        }
+        return;
+    }
+
+    I2cSetTransferCallback( &I2c, NULL, NULL );
+    AsyncReadout.Callback = NULL;
+    callback( SUCCESS, AsyncReadout.NbParsed );
+}
+
+/*!
+ * \brief Parses the received burst and goes on with the readout
+ */
+static void OnReadoutDone( void* context, uint8_t status )
+{
+    PAM7QReadoutCallback *callback = AsyncReadout.Callback;
+
+    if( status == FAIL )
+    {
+        I2cSetTransferCallback( &I2c, NULL, NULL );
+        AsyncReadout.Callback = NULL;
+        callback( FAIL, AsyncReadout.NbParsed );
+        return;
+    }
+
+    if( AsyncReadout.SizeRead == false )
+    {
+        AsyncReadout.SizeRead = true;
+        AsyncReadout.PendingBytes = ( uint16_t )( ( AsyncReadout.Buffer[0] << 8 ) | AsyncReadout.Buffer[1] );
+
+        // check for invalid length
+        if( AsyncReadout.PendingBytes == 0xFFFF )
+        {
+            AsyncReadout.PendingBytes = 0;
+        }
+    }
+    else
+    {
+        uint16_t size = MIN( AsyncReadout.PendingBytes, PAM7Q_READOUT_CHUNK_SIZE );
+
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            if( GpsParseGpsChar( AsyncReadout.Buffer[i] ) == true )
+            {
+                AsyncReadout.NbParsed++;
+            }
+        }
+        AsyncReadout.PendingBytes -= size;
+    }
+    PAM7QReadNextChunk( );
+}
+
+uint8_t PAM7QStartReadout( PAM7QReadoutCallback *callback )
+{
+    if( ( callback == NULL ) || ( AsyncReadout.Callback != NULL ) )
+    {
+        return FAIL;
+    }
+
+    AsyncReadout.Callback = callback;
+    AsyncReadout.PendingBytes = 0;
+    AsyncReadout.SizeRead = false;
+    AsyncReadout.NbParsed = 0;
+
+    I2cSetTransferCallback( &I2c, OnReadoutDone, NULL );
+    if( I2cReadBuffer( &I2c, I2cDeviceAddr << 1, MESSAGE_SIZE_1, AsyncReadout.Buffer, 2 ) == FAIL )
+    {
+        I2cSetTransferCallback( &I2c, NULL, NULL );
+        AsyncReadout.Callback = NULL;
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
 uint8_t PAM7QGetDeviceAddr( void )
 {
     return I2cDeviceAddr;
@@ -44,6 +44,29 @@ uint8_t PAM7QReadBuffer( uint8_t addr, uint8_t *data, uint8_t size );
 
 void GpsMcuOnPpsSignal( void );
 
+/*!
+ * Non-blocking readout completion callback
+ *
+ * \param [IN] status   [SUCCESS, FAIL]
+ * \param [IN] nbParsed Number of GGA and RMC sentences parsed
+ */
+typedef void( PAM7QReadoutCallback )( uint8_t status, uint8_t nbParsed );
+
+/*!
+ * \brief Starts a non-blocking readout of the NMEA data pending in the module
+ *
+ * \remark The pending data is read with I2C bursts of up to
+ *         \ref PAM7Q_READOUT_CHUNK_SIZE bytes, using the DMA when the board
+ *         supports it, and each burst is fed to \ref GpsParseGpsChar. Meant
+ *         to be started on the PPS edge, once the module has output the
+ *         sentences of the second. The callback is called from interrupt
+ *         context, the I2C bus must not be used until then.
+ *
+ * \param [IN] callback Readout completion callback
+ * \retval status [SUCCESS, FAIL]
+ */
+uint8_t PAM7QStartReadout( PAM7QReadoutCallback *callback );
+
 /*
  * MPL3115A2 I2C address
  */
@@ -54,6 +77,13 @@ void GpsMcuOnPpsSignal( void );
 
 #define PAYLOAD                                 0xFF
 
+/*
+ * Largest I2C burst of the non-blocking readout [bytes]
+ */
+#ifndef PAM7Q_READOUT_CHUNK_SIZE
+#define PAM7Q_READOUT_CHUNK_SIZE                128
+#endif
+
 
 #endif // __PAM7Q_H__
 
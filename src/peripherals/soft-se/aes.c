@@ -55,6 +55,37 @@
 #  define USE_TABLES
 #endif
 
+/* define to use the 32-bit T-table encryption core ( SOFT_SE_AES_TTABLE_ENABLED ).
+   Each round is then computed with 16 table look-ups on 32-bit words instead
+   of the byte oriented shift_sub_rows/mix_sub_columns. */
+#if defined( SOFT_SE_AES_TTABLE_ENABLED )
+#  define USE_TTABLE
+#endif
+
+/* the byte oriented encryption functions remain needed by the on the fly
+   keying modes */
+#if !defined( USE_TTABLE ) || \
+    defined( AES_ENC_128_OTFK ) || defined( AES_ENC_256_OTFK )
+#  define USE_BYTE_ENC_CORE
+#endif
+
+/* the decryption functions are byte oriented in all modes */
+#if defined( AES_DEC_PREKEYED ) || \
+    defined( AES_DEC_128_OTFK ) || defined( AES_DEC_256_OTFK )
+#  define USE_BYTE_DEC_CORE
+#endif
+
+/* number of 1 KB T-tables of the T-table core. With a single table the other
+   three are obtained with rotations, which suits the flash constrained
+   Cortex-M0/M0+. The Cortex-M3/M4 use the four tables. */
+#if !defined( AES_TTABLE_COUNT )
+#  if defined( __ARM_ARCH_6M__ )
+#    define AES_TTABLE_COUNT    1
+#  else
+#    define AES_TTABLE_COUNT    4
+#  endif
+#endif
+
 /*  On Intel Core 2 duo VERSION_1 is faster */
 
 /* alternative versions (test for performance on your system) */
@@ -64,6 +95,10 @@
 
 #include "aes.h"
 
+/* the encryption core is placed in RAM by LORAMAC_HOT ( RAM_FUNCTIONS_ENABLED ),
+   away from the flash wait states */
+#include "utilities.h"
+
 //#if defined( HAVE_UINT_32T )
 //  typedef unsigned long uint32_t;
 //#endif
@@ -193,14 +228,16 @@
 
 static const uint8_t sbox[256]  =  sb_data(f1);
 
-#if defined( AES_DEC_PREKEYED )
+#if defined( USE_BYTE_DEC_CORE )
 static const uint8_t isbox[256] = isb_data(f1);
 #endif
 
+#if defined( USE_BYTE_ENC_CORE )
 static const uint8_t gfm2_sbox[256] = sb_data(f2);
 static const uint8_t gfm3_sbox[256] = sb_data(f3);
+#endif
 
-#if defined( AES_DEC_PREKEYED )
+#if defined( USE_BYTE_DEC_CORE )
 static const uint8_t gfmul_9[256] = mm_data(f9);
 static const uint8_t gfmul_b[256] = mm_data(fb);
 static const uint8_t gfmul_d[256] = mm_data(fd);
@@ -208,12 +245,12 @@ static const uint8_t gfmul_e[256] = mm_data(fe);
 #endif
 
 #define s_box(x)     sbox[(x)]
-#if defined( AES_DEC_PREKEYED )
+#if defined( USE_BYTE_DEC_CORE )
 #define is_box(x)    isbox[(x)]
 #endif
 #define gfm2_sb(x)   gfm2_sbox[(x)]
 #define gfm3_sb(x)   gfm3_sbox[(x)]
-#if defined( AES_DEC_PREKEYED )
+#if defined( USE_BYTE_DEC_CORE )
 #define gfm_9(x)     gfmul_9[(x)]
 #define gfm_b(x)     gfmul_b[(x)]
 #define gfm_d(x)     gfmul_d[(x)]
@@ -304,6 +341,86 @@ uint8_t inv_affine(const uint8_t x)
 
 #endif
 
+#if defined( USE_TTABLE )
+
+#if !defined( USE_TABLES )
+#  error "The T-table core requires USE_TABLES"
+#endif
+
+/*  The state columns are held in 32-bit words, the row 0 byte being the least
+    significant one. te0 combines the S box and the mix columns coefficients
+    of the row 0 byte, te1 to te3 are te0 rotated by 8, 16 and 24 bits. */
+
+#define te0_w(x) ( ( uint32_t )f2(x) | ( ( uint32_t )f1(x) << 8 ) | ( ( uint32_t )f1(x) << 16 ) | ( ( uint32_t )f3(x) << 24 ) )
+#define te1_w(x) ( ( uint32_t )f3(x) | ( ( uint32_t )f2(x) << 8 ) | ( ( uint32_t )f1(x) << 16 ) | ( ( uint32_t )f1(x) << 24 ) )
+#define te2_w(x) ( ( uint32_t )f1(x) | ( ( uint32_t )f3(x) << 8 ) | ( ( uint32_t )f2(x) << 16 ) | ( ( uint32_t )f1(x) << 24 ) )
+#define te3_w(x) ( ( uint32_t )f1(x) | ( ( uint32_t )f1(x) << 8 ) | ( ( uint32_t )f3(x) << 16 ) | ( ( uint32_t )f2(x) << 24 ) )
+
+static const uint32_t te0[256] = sb_data(te0_w);
+
+#if ( AES_TTABLE_COUNT == 4 )
+static const uint32_t te1[256] = sb_data(te1_w);
+static const uint32_t te2[256] = sb_data(te2_w);
+static const uint32_t te3[256] = sb_data(te3_w);
+
+#define te_0(x)   te0[(x)]
+#define te_1(x)   te1[(x)]
+#define te_2(x)   te2[(x)]
+#define te_3(x)   te3[(x)]
+#elif ( AES_TTABLE_COUNT == 1 )
+#define rotl_w(x, n)    ( ( (x) << (n) ) | ( (x) >> ( 32 - (n) ) ) )
+
+#define te_0(x)   te0[(x)]
+#define te_1(x)   rotl_w(te0[(x)], 8)
+#define te_2(x)   rotl_w(te0[(x)], 16)
+#define te_3(x)   rotl_w(te0[(x)], 24)
+#else
+#  error "AES_TTABLE_COUNT must be 1 or 4"
+#endif
+
+#define load_w(p)   ( ( uint32_t )(p)[0] | ( ( uint32_t )(p)[1] << 8 ) | \
+                      ( ( uint32_t )(p)[2] << 16 ) | ( ( uint32_t )(p)[3] << 24 ) )
+
+#define t_col(a, b, c, d, k) ( te_0((a) & 0xff) ^ te_1(((b) >> 8) & 0xff) ^ \
+                               te_2(((c) >> 16) & 0xff) ^ te_3((d) >> 24) ^ load_w(k) )
+
+#define s_col(o, a, b, c, d, k) \
+    (o)[0] = s_box((a) & 0xff) ^ (k)[0];          \
+    (o)[1] = s_box(((b) >> 8) & 0xff) ^ (k)[1];   \
+    (o)[2] = s_box(((c) >> 16) & 0xff) ^ (k)[2];  \
+    (o)[3] = s_box((d) >> 24) ^ (k)[3]
+
+/*  Encrypt a single block with the T-tables. The input is entirely read before
+    the output is written, in and out may point to the same buffer. */
+
+LORAMAC_HOT static void ttable_encrypt( const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK], const uint8_t *k, uint8_t rnd )
+{   uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+    uint8_t r;
+
+    s0 = load_w(in     ) ^ load_w(k     );
+    s1 = load_w(in +  4) ^ load_w(k +  4);
+    s2 = load_w(in +  8) ^ load_w(k +  8);
+    s3 = load_w(in + 12) ^ load_w(k + 12);
+
+    for( r = 1 ; r < rnd ; ++r )
+    {
+        k += N_BLOCK;
+        t0 = t_col(s0, s1, s2, s3, k     );
+        t1 = t_col(s1, s2, s3, s0, k +  4);
+        t2 = t_col(s2, s3, s0, s1, k +  8);
+        t3 = t_col(s3, s0, s1, s2, k + 12);
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    k += N_BLOCK;
+    s_col(out     , s0, s1, s2, s3, k     );
+    s_col(out +  4, s1, s2, s3, s0, k +  4);
+    s_col(out +  8, s2, s3, s0, s1, k +  8);
+    s_col(out + 12, s3, s0, s1, s2, k + 12);
+}
+
+#endif
+
 #if defined( HAVE_MEMCPY )
 #  define block_copy_nn(d, s, l)    memcpy(d, s, l)
 #  define block_copy(d, s)          memcpy(d, s, N_BLOCK)
@@ -312,7 +429,7 @@ uint8_t inv_affine(const uint8_t x)
 #  define block_copy(d, s)          copy_block(d, s)
 #endif
 
-static void copy_block( void *d, const void *s )
+LORAMAC_HOT static void copy_block( void *d, const void *s )
 {
 #if defined( HAVE_UINT_32T )
     ((uint32_t*)d)[ 0] = ((uint32_t*)s)[ 0];
@@ -346,7 +463,7 @@ static void copy_block_nn( uint8_t * d, const uint8_t *s, uint8_t nn )
         *d++ = *s++;
 }
 
-static void xor_block( void *d, const void *s )
+LORAMAC_HOT static void xor_block( void *d, const void *s )
 {
 #if defined( HAVE_UINT_32T )
     ((uint32_t*)d)[ 0] ^= ((uint32_t*)s)[ 0];
@@ -373,7 +490,9 @@ static void xor_block( void *d, const void *s )
 #endif
 }
 
-static void copy_and_key( void *d, const void *s, const void *k )
+#if defined( USE_BYTE_ENC_CORE ) || defined( USE_BYTE_DEC_CORE )
+
+LORAMAC_HOT static void copy_and_key( void *d, const void *s, const void *k )
 {
 #if defined( HAVE_UINT_32T )
     ((uint32_t*)d)[ 0] = ((uint32_t*)s)[ 0] ^ ((uint32_t*)k)[ 0];
@@ -403,12 +522,16 @@ static void copy_and_key( void *d, const void *s, const void *k )
 #endif
 }
 
-static void add_round_key( uint8_t d[N_BLOCK], const uint8_t k[N_BLOCK] )
+LORAMAC_HOT static void add_round_key( uint8_t d[N_BLOCK], const uint8_t k[N_BLOCK] )
 {
     xor_block(d, k);
 }
 
-static void shift_sub_rows( uint8_t st[N_BLOCK] )
+#endif
+
+#if defined( USE_BYTE_ENC_CORE )
+
+LORAMAC_HOT static void shift_sub_rows( uint8_t st[N_BLOCK] )
 {   uint8_t tt;
 
     st[ 0] = s_box(st[ 0]); st[ 4] = s_box(st[ 4]);
@@ -424,7 +547,9 @@ static void shift_sub_rows( uint8_t st[N_BLOCK] )
     st[ 7] = s_box(st[ 3]); st[ 3] = s_box( tt );
 }
 
-#if defined( AES_DEC_PREKEYED )
+#endif
+
+#if defined( USE_BYTE_DEC_CORE )
 
 static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
 {   uint8_t tt;
@@ -444,12 +569,14 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
 
 #endif
 
+#if defined( USE_BYTE_ENC_CORE )
+
 #if defined( VERSION_1 )
-  static void mix_sub_columns( uint8_t dt[N_BLOCK] )
+  LORAMAC_HOT static void mix_sub_columns( uint8_t dt[N_BLOCK] )
   { uint8_t st[N_BLOCK];
     block_copy(st, dt);
 #else
-  static void mix_sub_columns( uint8_t dt[N_BLOCK], uint8_t st[N_BLOCK] )
+  LORAMAC_HOT static void mix_sub_columns( uint8_t dt[N_BLOCK], uint8_t st[N_BLOCK] )
   {
 #endif
     dt[ 0] = gfm2_sb(st[0]) ^ gfm3_sb(st[5]) ^ s_box(st[10]) ^ s_box(st[15]);
@@ -473,7 +600,9 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
     dt[15] = gfm3_sb(st[12]) ^ s_box(st[1]) ^ s_box(st[6]) ^ gfm2_sb(st[11]);
   }
 
-#if defined( AES_DEC_PREKEYED )
+#endif
+
+#if defined( USE_BYTE_DEC_CORE )
 
 #if defined( VERSION_1 )
   static void inv_mix_sub_columns( uint8_t dt[N_BLOCK] )
@@ -565,10 +694,13 @@ return_type aes_set_key( const uint8_t key[], length_type keylen, aes_context ct
 
 /*  Encrypt a single block of 16 bytes */
 
-return_type aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const aes_context ctx[1] )
+LORAMAC_HOT return_type aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const aes_context ctx[1] )
 {
     if( ctx->rnd )
     {
+#if defined( USE_TTABLE )
+        ttable_encrypt( in, out, ctx->ksch, ctx->rnd );
+#else
         uint8_t s1[N_BLOCK], r;
         copy_and_key( s1, in, ctx->ksch );
 
@@ -586,6 +718,7 @@ return_type aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const
 #endif
         shift_sub_rows( s1 );
         copy_and_key( out, s1, ctx->ksch + r * N_BLOCK );
+#endif
     }
     else
         return ( uint8_t )-1;
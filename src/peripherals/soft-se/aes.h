@@ -87,6 +87,10 @@ return_type aes_set_key( const uint8_t key[],
 
 #if defined( AES_ENC_PREKEYED )
 
+/*  The input block is entirely read before the output block is written,
+    in and out may point to the same buffer.
+*/
+
 return_type aes_encrypt( const uint8_t in[N_BLOCK],
                          uint8_t out[N_BLOCK],
                          const aes_context ctx[1] );
@@ -35,6 +35,7 @@ DEALINGS WITH THE SOFTWARE
 //#include <sys/param.h>
 //#include <sys/systm.h> 
 #include <stdint.h>
+#include <string.h>
 #include "aes.h"
 #include "cmac.h"
 #include "utilities.h"
@@ -46,13 +47,22 @@ DEALINGS WITH THE SOFTWARE
             (r)[15] = (v)[15] << 1;                                 \
     } while (0)
     
-#define XOR(v, r) do {                                          \
-            int32_t i;                                                  \
-            for (i = 0; i < 16; i++)     \
-        {   \
-                    (r)[i] = (r)[i] ^ (v)[i]; \
-        }                          \
-    } while (0) \
+#define XOR(v, r) xor_block((v), (r))
+
+/* r ^= v on a 16 bytes block, 32 bits at a time. The blocks may be unaligned,
+   the fixed size memcpy calls compile to single loads and stores. */
+static void xor_block(const uint8_t *v, uint8_t *r)
+{
+            uint32_t a, b;
+            int32_t i;
+
+            for (i = 0; i < 16; i += 4) {
+                    memcpy(&a, v + i, 4);
+                    memcpy(&b, r + i, 4);
+                    a ^= b;
+                    memcpy(r + i, &a, 4);
+            }
+}
 
 
 void AES_CMAC_Init(AES_CMAC_CTX *ctx)
@@ -71,7 +81,6 @@ void AES_CMAC_SetKey(AES_CMAC_CTX *ctx, const uint8_t key[AES_CMAC_KEY_LENGTH])
 void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
 {
             uint32_t mlen;
-        uint8_t in[16];
     
             if (ctx->M_n > 0) {
                   mlen = MIN(16 - ctx->M_n, len);
@@ -88,11 +97,8 @@ void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
             while (len > 16) {      /* not last block */
 
                     XOR(data, ctx->X);
-                    //rijndael_encrypt(&ctx->rijndael, ctx->X, ctx->X);
-
-                    memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-            aes_encrypt( in, in, &ctx->rijndael);
-                    memcpy1(&ctx->X[0], in, 16);
+                    /* aes_encrypt supports in place encryption */
+                    aes_encrypt( ctx->X, ctx->X, &ctx->rijndael);
 
                     data += 16;
                     len -= 16;
@@ -101,11 +107,20 @@ void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
             memcpy1(ctx->M_last, data, len);
             ctx->M_n = len;
 }
+
+void AES_CMAC_UpdateSegments(AES_CMAC_CTX *ctx, const AES_CMAC_SEGMENT *segments, uint8_t nbSegments)
+{
+    uint8_t i;
+
+    for (i = 0; i < nbSegments; i++) {
+        if (segments[i].len > 0)
+            AES_CMAC_Update(ctx, segments[i].data, segments[i].len);
+    }
+}
    
 void AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX *ctx)
 {
             uint8_t K[16];
-        uint8_t in[16];
             /* generate subkey K1 */
             memset1(K, '\0', 16);
 
@@ -145,9 +160,53 @@ void AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX *ctx)
 
            //rijndael_encrypt(&ctx->rijndael, ctx->X, digest);
 
-       memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-       aes_encrypt(in, digest, &ctx->rijndael);
+       aes_encrypt(ctx->X, digest, &ctx->rijndael);
            memset1(K, 0, sizeof K);
 
 }
 
+void AES_CMAC_Restart(AES_CMAC_CTX *ctx)
+{
+    /* keeps the key schedule */
+    memset1(ctx->X, 0, sizeof ctx->X);
+    ctx->M_n = 0;
+}
+
+void AES_CMAC_GetSubkeys(AES_CMAC_CTX *ctx, uint8_t k1[AES_CMAC_KEY_LENGTH], uint8_t k2[AES_CMAC_KEY_LENGTH])
+{
+    /* generate subkey K1 */
+    memset1(k1, '\0', 16);
+    aes_encrypt(k1, k1, &ctx->rijndael);
+    if (k1[0] & 0x80) {
+        LSHIFT(k1, k1);
+        k1[15] ^= 0x87;
+    } else
+        LSHIFT(k1, k1);
+
+    /* generate subkey K2 */
+    if (k1[0] & 0x80) {
+        LSHIFT(k1, k2);
+        k2[15] ^= 0x87;
+    } else
+        LSHIFT(k1, k2);
+}
+
+void AES_CMAC_FinalWithSubkeys(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX *ctx,
+                               const uint8_t k1[AES_CMAC_KEY_LENGTH], const uint8_t k2[AES_CMAC_KEY_LENGTH])
+{
+    if (ctx->M_n == 16) {
+        /* last block was a complete block */
+        XOR(k1, ctx->M_last);
+    } else {
+        /* padding(M_last) */
+        ctx->M_last[ctx->M_n] = 0x80;
+        while (++ctx->M_n < 16)
+            ctx->M_last[ctx->M_n] = 0;
+
+        XOR(k2, ctx->M_last);
+    }
+    XOR(ctx->M_last, ctx->X);
+
+    aes_encrypt(ctx->X, digest, &ctx->rijndael);
+}
+
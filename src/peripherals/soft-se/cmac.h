@@ -47,6 +47,12 @@ typedef struct _AES_CMAC_CTX {
             uint8_t        M_last[16];
             uint32_t       M_n;
     } AES_CMAC_CTX;
+
+/* Message segment, the CMAC is computed over the concatenation of the segments */
+typedef struct _AES_CMAC_SEGMENT {
+            const uint8_t *data;
+            uint32_t       len;
+    } AES_CMAC_SEGMENT;
    
 //#include <sys/cdefs.h>
     
@@ -55,8 +61,15 @@ void     AES_CMAC_Init(AES_CMAC_CTX * ctx);
 void     AES_CMAC_SetKey(AES_CMAC_CTX * ctx, const uint8_t key[AES_CMAC_KEY_LENGTH]);
 void     AES_CMAC_Update(AES_CMAC_CTX * ctx, const uint8_t * data, uint32_t len);
           //          __attribute__((__bounded__(__string__,2,3)));
+/* Scatter list variant: same as calling AES_CMAC_Update for each segment */
+void     AES_CMAC_UpdateSegments(AES_CMAC_CTX * ctx, const AES_CMAC_SEGMENT * segments, uint8_t nbSegments);
 void     AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX  * ctx);
             //     __attribute__((__bounded__(__minbytes__,1,AES_CMAC_DIGEST_LENGTH)));
+/* Precomputed subkeys variant: the K1/K2 subkeys only depend on the key */
+void     AES_CMAC_Restart(AES_CMAC_CTX * ctx);
+void     AES_CMAC_GetSubkeys(AES_CMAC_CTX * ctx, uint8_t k1[AES_CMAC_KEY_LENGTH], uint8_t k2[AES_CMAC_KEY_LENGTH]);
+void     AES_CMAC_FinalWithSubkeys(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX * ctx,
+                                   const uint8_t k1[AES_CMAC_KEY_LENGTH], const uint8_t k2[AES_CMAC_KEY_LENGTH]);
 //__END_DECLS
 
 #endif /* _CMAC_H_ */
@@ -22,25 +22,37 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ),
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "LoRaMacCrypto.h"
 #include "utilities.h"
+#include "board.h"
+#include "entropy.h"
 #include "aes.h"
 #include "cmac.h"
-#include "radio.h"
 
 #define NUM_OF_KEYS      24
 #define KEY_SIZE         16
 
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+/*!
+ * Number of expanded keys kept in the key cache
+ */
+#ifndef SOFT_SE_KEY_CACHE_SIZE
+#define SOFT_SE_KEY_CACHE_SIZE      4
+#endif
+#endif
+
 /*!
  * Identifier value pair type for Keys
  */
 typedef struct sKey
 {
     /*
-     * Key identifier
+     * Key identifier, a KeyIdentifier_t value stored on a byte to keep the
+     * NVM context compact
      */
-    KeyIdentifier_t KeyID;
+    uint8_t KeyID;
     /*
      * Key value
      */
@@ -60,6 +72,35 @@ typedef struct sSecureElementNvCtx
      * Join EUI storage
      */
     uint8_t JoinEui[SE_EUI_SIZE];
+    /*
+     * Key List
+     */
+    Key_t KeyList[NUM_OF_KEYS];
+}SecureElementNvCtx_t;
+
+/*
+ * Module context
+ */
+static SecureElementNvCtx_t SeNvmCtx;
+
+static SecureElementNvmEvent SeNvmCtxChanged;
+
+/*
+ * Batch being processed
+ */
+static bool SeBatchRunning = false;
+
+/*
+ * The batch changed the NVM context
+ */
+static bool SeBatchNvmCtxChanged = false;
+
+#if !defined( SOFT_SE_KEY_CACHE_ENABLED )
+/*
+ * Secure Element scratch context structure
+ */
+typedef struct sSecureElementScratchCtx
+{
     /*
      * AES computation context variable
      */
@@ -68,18 +109,60 @@ typedef struct sSecureElementNvCtx
      * CMAC computation context variable
      */
     AES_CMAC_CTX AesCmacCtx[1];
+}SecureElementScratchCtx_t;
+
+/*
+ * Computations working state. Kept out of the NVM context as it is set up
+ * again by each computation.
+ */
+static SecureElementScratchCtx_t SeScratchCtx;
+
+/*
+ * Key expanded in the scratch AES context. The following encryptions of a
+ * batch reuse it.
+ */
+static KeyIdentifier_t SeScratchKeyID;
+
+static bool SeScratchKeyValid = false;
+#endif
+
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+/*!
+ * Expanded key cache entry
+ */
+typedef struct sKeyCacheEntry
+{
     /*
-     * Key List
+     * Key identifier, meaningful only if the entry is valid
      */
-    Key_t KeyList[NUM_OF_KEYS];
-}SecureElementNvCtx_t;
+    KeyIdentifier_t KeyID;
+    /*
+     * Entry holds an expanded key
+     */
+    bool Valid;
+    /*
+     * Value of the use counter at the last access, used for replacement
+     */
+    uint32_t LastUse;
+    /*
+     * CMAC context holding the AES key schedule
+     */
+    AES_CMAC_CTX AesCmacCtx;
+    /*
+     * CMAC K1 and K2 subkeys
+     */
+    uint8_t CmacK1[16];
+    uint8_t CmacK2[16];
+} KeyCacheEntry_t;
 
 /*
- * Module context
+ * Expanded keys cache. Kept out of the NVM context as it can be rebuilt
+ * from the keys at any time.
  */
-static SecureElementNvCtx_t SeNvmCtx;
+static KeyCacheEntry_t KeyCache[SOFT_SE_KEY_CACHE_SIZE];
 
-static SecureElementNvmEvent SeNvmCtxChanged;
+static uint32_t KeyCacheUseCounter = 0;
+#endif
 
 /*
  * Local functions
@@ -115,6 +198,84 @@ static void DummyCB( void )
     return;
 }
 
+/*
+ * Notifies the NVM context change, once at the end of a batch
+ */
+static void NotifyNvmCtxChanged( void )
+{
+    if( SeBatchRunning == true )
+    {
+        SeBatchNvmCtxChanged = true;
+    }
+    else
+    {
+        SeNvmCtxChanged( );
+    }
+}
+
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+/*
+ * Drops the cached expanded key of the given key identifier
+ *
+ * \param[IN]  keyID             - Key identifier
+ */
+static void KeyCacheInvalidate( KeyIdentifier_t keyID )
+{
+    for( uint8_t i = 0; i < SOFT_SE_KEY_CACHE_SIZE; i++ )
+    {
+        if( KeyCache[i].KeyID == keyID )
+        {
+            KeyCache[i].Valid = false;
+        }
+    }
+}
+
+/*
+ * Drops all the cached expanded keys
+ */
+static void KeyCacheInvalidateAll( void )
+{
+    for( uint8_t i = 0; i < SOFT_SE_KEY_CACHE_SIZE; i++ )
+    {
+        KeyCache[i].Valid = false;
+    }
+}
+
+/*
+ * Gets the cache entry of a key. The key is expanded on a cache miss,
+ * replacing the least recently used entry.
+ *
+ * \param[IN]  keyItem           - Key
+ * \retval                       - Cache entry holding the expanded key
+ */
+static KeyCacheEntry_t* KeyCacheGet( Key_t* keyItem )
+{
+    KeyCacheEntry_t* entry = &KeyCache[0];
+
+    for( uint8_t i = 0; i < SOFT_SE_KEY_CACHE_SIZE; i++ )
+    {
+        if( ( KeyCache[i].Valid == true ) && ( KeyCache[i].KeyID == keyItem->KeyID ) )
+        {
+            KeyCache[i].LastUse = ++KeyCacheUseCounter;
+            return &KeyCache[i];
+        }
+        if( ( entry->Valid == true ) &&
+            ( ( KeyCache[i].Valid == false ) || ( KeyCache[i].LastUse < entry->LastUse ) ) )
+        {
+            entry = &KeyCache[i];
+        }
+    }
+
+    memset1( entry->AesCmacCtx.rijndael.ksch, '\0', 240 );
+    AES_CMAC_SetKey( &entry->AesCmacCtx, keyItem->KeyValue );
+    AES_CMAC_GetSubkeys( &entry->AesCmacCtx, entry->CmacK1, entry->CmacK2 );
+    entry->KeyID = keyItem->KeyID;
+    entry->Valid = true;
+    entry->LastUse = ++KeyCacheUseCounter;
+    return entry;
+}
+#endif
+
 /*
  * Computes a CMAC of a message using provided initial Bx block
  *
@@ -136,23 +297,41 @@ static SecureElementStatus_t ComputeCmac( uint8_t *micBxBuffer, uint8_t *buffer,
 
     uint8_t Cmac[16];
 
-    AES_CMAC_Init( SeNvmCtx.AesCmacCtx );
+#if !defined( SOFT_SE_KEY_CACHE_ENABLED )
+    AES_CMAC_Init( SeScratchCtx.AesCmacCtx );
+#endif
 
     Key_t* keyItem;
     SecureElementStatus_t retval = GetKeyByID( keyID, &keyItem );
 
     if( retval == SECURE_ELEMENT_SUCCESS )
     {
-        AES_CMAC_SetKey( SeNvmCtx.AesCmacCtx, keyItem->KeyValue );
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+        KeyCacheEntry_t* entry = KeyCacheGet( keyItem );
+        AES_CMAC_CTX* aesCmacCtx = &entry->AesCmacCtx;
+
+        AES_CMAC_Restart( aesCmacCtx );
+#else
+        AES_CMAC_CTX* aesCmacCtx = SeScratchCtx.AesCmacCtx;
+
+        AES_CMAC_SetKey( aesCmacCtx, keyItem->KeyValue );
+#endif
 
-        if( micBxBuffer != NULL )
+        // The Bx block and the message are processed in place, without being
+        // concatenated first
+        AES_CMAC_SEGMENT segments[2] =
         {
-            AES_CMAC_Update( SeNvmCtx.AesCmacCtx, micBxBuffer, 16 );
-        }
+            { .data = micBxBuffer, .len = ( micBxBuffer != NULL ) ? 16 : 0 },
+            { .data = buffer, .len = size },
+        };
 
-        AES_CMAC_Update( SeNvmCtx.AesCmacCtx, buffer, size );
+        AES_CMAC_UpdateSegments( aesCmacCtx, segments, 2 );
 
-        AES_CMAC_Final( Cmac, SeNvmCtx.AesCmacCtx );
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+        AES_CMAC_FinalWithSubkeys( Cmac, aesCmacCtx, entry->CmacK1, entry->CmacK2 );
+#else
+        AES_CMAC_Final( Cmac, aesCmacCtx );
+#endif
 
         // Bring into the required format
         *cmac = ( uint32_t )( ( uint32_t ) Cmac[3] << 24 | ( uint32_t ) Cmac[2] << 16 | ( uint32_t ) Cmac[1] << 8 | ( uint32_t ) Cmac[0] );
@@ -202,6 +381,10 @@ SecureElementStatus_t SecureElementInit( SecureElementNvmEvent seNvmCtxChanged )
     memset1( SeNvmCtx.DevEui, 0, SE_EUI_SIZE );
     memset1( SeNvmCtx.JoinEui, 0, SE_EUI_SIZE );
 
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+    KeyCacheInvalidateAll( );
+#endif
+
     // Assign callback
     if( seNvmCtxChanged != 0 )
     {
@@ -221,6 +404,12 @@ SecureElementStatus_t SecureElementRestoreNvmCtx( void* seNvmCtx )
     if( seNvmCtx != 0 )
     {
         memcpy1( ( uint8_t* ) &SeNvmCtx, ( uint8_t* ) seNvmCtx, sizeof( SeNvmCtx ) );
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+        // The restored keys may differ from the cached ones
+        KeyCacheInvalidateAll( );
+#else
+        SeScratchKeyValid = false;
+#endif
         return SECURE_ELEMENT_SUCCESS;
     }
     else
@@ -246,6 +435,15 @@ SecureElementStatus_t SecureElementSetKey( KeyIdentifier_t keyID, uint8_t* key )
     {
         if( SeNvmCtx.KeyList[i].KeyID == keyID )
         {
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+            // Also covers the keys stored by SecureElementDeriveAndStoreKey
+            KeyCacheInvalidate( keyID );
+#else
+            if( SeScratchKeyID == keyID )
+            {
+                SeScratchKeyValid = false;
+            }
+#endif
             if( ( keyID == MC_KEY_0 ) || ( keyID == MC_KEY_1 ) || ( keyID == MC_KEY_2 ) || ( keyID == MC_KEY_3 ) )
             {  // Decrypt the key if its a Mckey
                 SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
@@ -254,14 +452,14 @@ SecureElementStatus_t SecureElementSetKey( KeyIdentifier_t keyID, uint8_t* key )
                 retval = SecureElementAesEncrypt( key, 16, MC_KE_KEY, decryptedKey );
 
                 memcpy1( SeNvmCtx.KeyList[i].KeyValue, decryptedKey, KEY_SIZE );
-                SeNvmCtxChanged( );
+                NotifyNvmCtxChanged( );
 
                 return retval;
             }
             else
             {
                 memcpy1( SeNvmCtx.KeyList[i].KeyValue, key, KEY_SIZE );
-                SeNvmCtxChanged( );
+                NotifyNvmCtxChanged( );
                 return SECURE_ELEMENT_SUCCESS;
             }
         }
@@ -278,10 +476,14 @@ SecureElementStatus_t SecureElementComputeAesCmac( uint8_t *micBxBuffer, uint8_t
         return SECURE_ELEMENT_ERROR_INVALID_KEY_ID;
     }
 
-    return ComputeCmac( micBxBuffer, buffer, size, keyID, cmac );
+    SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
+    retval = ComputeCmac( micBxBuffer, buffer, size, keyID, cmac );
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
+    return retval;
 }
 
-SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* buffer, uint16_t size, uint32_t expectedCmac, KeyIdentifier_t keyID )
+SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* micBxBuffer, uint8_t* buffer, uint16_t size, uint32_t expectedCmac, KeyIdentifier_t keyID )
 {
     if( buffer == NULL )
     {
@@ -290,7 +492,9 @@ SecureElementStatus_t SecureElementVerifyAesCmac( uint8_t* buffer, uint16_t size
 
     SecureElementStatus_t retval = SECURE_ELEMENT_ERROR;
     uint32_t compCmac = 0;
-    retval = ComputeCmac( NULL, buffer, size, keyID, &compCmac );
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
+    retval = ComputeCmac( micBxBuffer, buffer, size, keyID, &compCmac );
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
     if( retval != SECURE_ELEMENT_SUCCESS )
     {
         return retval;
@@ -317,23 +521,104 @@ SecureElementStatus_t SecureElementAesEncrypt( uint8_t* buffer, uint16_t size, K
         return SECURE_ELEMENT_ERROR_BUF_SIZE;
     }
 
-    memset1( SeNvmCtx.AesContext.ksch, '\0', 240 );
-
     Key_t* pItem;
     SecureElementStatus_t retval = GetKeyByID( keyID, &pItem );
 
     if( retval == SECURE_ELEMENT_SUCCESS )
     {
-        aes_set_key( pItem->KeyValue, 16, &SeNvmCtx.AesContext );
+        BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
+#if defined( SOFT_SE_KEY_CACHE_ENABLED )
+        aes_context* aesContext = &KeyCacheGet( pItem )->AesCmacCtx.rijndael;
+#else
+        aes_context* aesContext = &SeScratchCtx.AesContext;
+
+        if( ( SeScratchKeyValid == false ) || ( SeScratchKeyID != keyID ) )
+        {
+            memset1( aesContext->ksch, '\0', 240 );
+            aes_set_key( pItem->KeyValue, 16, aesContext );
+            SeScratchKeyID = keyID;
+            SeScratchKeyValid = SeBatchRunning;
+        }
+#endif
 
         uint8_t block = 0;
 
         while( size != 0 )
         {
-            aes_encrypt( &buffer[block], &encBuffer[block], &SeNvmCtx.AesContext );
+            aes_encrypt( &buffer[block], &encBuffer[block], aesContext );
             block = block + 16;
             size = size - 16;
         }
+        BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
+    }
+    return retval;
+}
+
+SecureElementStatus_t SecureElementProcessBatch( SecureElementCmd_t* cmds, uint8_t nbCmds )
+{
+    SecureElementStatus_t retval = SECURE_ELEMENT_SUCCESS;
+
+    if( cmds == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+    SeBatchRunning = true;
+
+    // Keep the clock up for the whole batch
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_HIGH );
+
+    for( uint8_t i = 0; i < nbCmds; i++ )
+    {
+        if( retval != SECURE_ELEMENT_SUCCESS )
+        {
+            // A previous command failed
+            cmds[i].Status = SECURE_ELEMENT_ERROR;
+            continue;
+        }
+        switch( cmds[i].Type )
+        {
+            case SECURE_ELEMENT_CMD_AES_ENCRYPT:
+                cmds[i].Status = SecureElementAesEncrypt( cmds[i].Buffer, cmds[i].Size, cmds[i].KeyID, cmds[i].EncBuffer );
+                break;
+            case SECURE_ELEMENT_CMD_COMPUTE_AES_CMAC:
+                cmds[i].Status = SecureElementComputeAesCmac( cmds[i].MicBxBuffer, cmds[i].Buffer, cmds[i].Size, cmds[i].KeyID, &cmds[i].Cmac );
+                break;
+            case SECURE_ELEMENT_CMD_SET_KEY:
+                cmds[i].Status = SecureElementSetKey( cmds[i].KeyID, cmds[i].Buffer );
+                break;
+            case SECURE_ELEMENT_CMD_DERIVE_AND_STORE_KEY:
+                cmds[i].Status = SecureElementDeriveAndStoreKey( cmds[i].Version, cmds[i].Buffer, cmds[i].KeyID, cmds[i].TargetKeyID );
+                break;
+            default:
+                cmds[i].Status = SECURE_ELEMENT_ERROR;
+                break;
+        }
+        retval = cmds[i].Status;
+    }
+    SeBatchRunning = false;
+#if !defined( SOFT_SE_KEY_CACHE_ENABLED )
+    SeScratchKeyValid = false;
+#endif
+    if( SeBatchNvmCtxChanged == true )
+    {
+        SeBatchNvmCtxChanged = false;
+        SeNvmCtxChanged( );
+    }
+    BoardSetPerformanceLevel( BOARD_PERFORMANCE_LEVEL_LOW );
+    return retval;
+}
+
+SecureElementStatus_t SecureElementProcessBatchAsync( SecureElementCmd_t* cmds, uint8_t nbCmds, SecureElementBatchDone batchDone )
+{
+    if( batchDone == NULL )
+    {
+        return SECURE_ELEMENT_ERROR_NPE;
+    }
+    // The commands are processed by the MCU, the batch completes right away
+    SecureElementStatus_t retval = SecureElementProcessBatch( cmds, nbCmds );
+    if( retval != SECURE_ELEMENT_ERROR_NPE )
+    {
+        batchDone( cmds, nbCmds, retval );
     }
     return retval;
 }
@@ -380,7 +665,7 @@ SecureElementStatus_t SecureElementRandomNumber( uint32_t* randomNum )
     {
         return SECURE_ELEMENT_ERROR_NPE;
     }
-    *randomNum = Radio.Random( );
+    *randomNum = EntropyGetRandom( );
     return SECURE_ELEMENT_SUCCESS;
 }
 
@@ -56,7 +56,7 @@ uint8_t SX1509Reset( )
 
 uint8_t SX1509Write( uint8_t addr, uint8_t data )
 {
-    return SX1509WriteBuffer( addr, &data, 1 );
+    return I2cWrite( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t SX1509WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -66,7 +66,7 @@ uint8_t SX1509WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
 
 uint8_t SX1509Read( uint8_t addr, uint8_t *data )
 {
-    return SX1509ReadBuffer( addr, data, 1 );
+    return I2cRead( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t SX1509ReadBuffer( uint8_t addr, uint8_t *data, uint8_t size )
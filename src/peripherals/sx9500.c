@@ -63,7 +63,7 @@ uint8_t SX9500Reset( )
 
 uint8_t SX9500Write( uint8_t addr, uint8_t data )
 {
-    return SX9500WriteBuffer( addr, &data, 1 );
+    return I2cWrite( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t SX9500WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -73,7 +73,7 @@ uint8_t SX9500WriteBuffer( uint8_t addr, uint8_t *data, uint8_t size )
 
 uint8_t SX9500Read( uint8_t addr, uint8_t *data )
 {
-    return SX9500ReadBuffer( addr, data, 1 );
+    return I2cRead( &I2c, I2cDeviceAddr << 1, addr, data );
 }
 
 uint8_t SX9500ReadBuffer( uint8_t addr, uint8_t *data, uint8_t size )
@@ -93,30 +93,23 @@ uint8_t SX9500GetDeviceAddr( void )
 
 void SX9500LockUntilDetection( void )
 {
-    uint8_t val = 0;
+    // PROXCTRL0 to PROXCTRL8 values
+    uint8_t proxCtrl[] = { 0x0F, 0x43, 0x77, 0x01, 0x30, 0x0F, 0x04, 0x40, 0x00 };
+    // IRQSRC and STAT values
+    uint8_t val[2] = { 0 };
 
     SX9500Write( SX9500_REG_RESET, SX9500_RESET_CMD );
-    SX9500Read( SX9500_REG_IRQSRC, &val );
-    SX9500Read( SX9500_REG_STAT, &val );
-
-    SX9500Write( SX9500_REG_PROXCTRL0, 0x0F );
-    SX9500Write( SX9500_REG_PROXCTRL1, 0x43 );
-    SX9500Write( SX9500_REG_PROXCTRL2, 0x77 );
-    SX9500Write( SX9500_REG_PROXCTRL3, 0x01 );
-    SX9500Write( SX9500_REG_PROXCTRL4, 0x30 );
-    SX9500Write( SX9500_REG_PROXCTRL5, 0x0F );
-    SX9500Write( SX9500_REG_PROXCTRL6, 0x04 );
-    SX9500Write( SX9500_REG_PROXCTRL7, 0x40 );
-    SX9500Write( SX9500_REG_PROXCTRL8, 0x00 );
+    SX9500ReadBuffer( SX9500_REG_IRQSRC, val, 2 );
+
+    SX9500WriteBuffer( SX9500_REG_PROXCTRL0, proxCtrl, sizeof( proxCtrl ) );
     SX9500Write( SX9500_REG_IRQMSK, 0x60 );
 
-    val = 0;
+    val[1] = 0;
 
-    while( ( val & 0xF0 ) == 0x00 )
+    while( ( val[1] & 0xF0 ) == 0x00 )
     {
-        SX9500Read( SX9500_REG_STAT, &val );
+        SX9500Read( SX9500_REG_STAT, &val[1] );
     }
 
-    SX9500Read( SX9500_REG_STAT, &val );
-    SX9500Read( SX9500_REG_IRQSRC, &val );
+    SX9500ReadBuffer( SX9500_REG_IRQSRC, val, 2 );
 }
@@ -0,0 +1,38 @@
+/*!
+ * \file      radio.c
+ *
+ * \brief     Radio driver selection
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include "radio.h"
+
+/*!
+ * Driver table of the RADIO radio, RADIO_DRIVER is defined by the build system
+ */
+extern const struct Radio_s RADIO_DRIVER;
+
+const struct Radio_s* RadioDriver = &RADIO_DRIVER;
+
+const struct Radio_s* RadioSelect( const struct Radio_s* driver )
+{
+    const struct Radio_s* previous = RadioDriver;
+
+    RadioDriver = driver;
+    return previous;
+}
@@ -46,6 +46,23 @@ typedef enum
     RF_CAD,        //!< The radio is doing channel activity detection
 }RadioState_t;
 
+/*!
+ * Radio driver activity statistics
+ */
+typedef struct sRadioStats
+{
+    uint32_t TxCnt;          //!< Number of transmitted frames
+    uint32_t TxTimeoutCnt;   //!< Number of transmission timeouts
+    uint32_t RxCnt;          //!< Number of received frames
+    uint32_t RxCrcErrorCnt;  //!< Number of frames received with a CRC error
+    uint32_t RxTimeoutCnt;   //!< Number of reception timeouts
+    uint32_t RxHeaderAbortCnt; //!< Number of receptions aborted on a frame header meant for another receiver
+    uint32_t TxTime;         //!< Accumulated transmission time [ms]
+    uint32_t RxTime;         //!< Accumulated reception and CAD time [ms]
+    uint32_t TxCharge;       //!< Accumulated transmission charge estimate [uAs], 0 when not supported
+    uint32_t SpiCnt;         //!< Number of SPI transactions
+}RadioStats_t;
+
 /*!
  * \brief Radio driver callback functions
  */
@@ -91,6 +108,26 @@ typedef struct
      * \param [IN] channelDetected    Channel Activity detected during the CAD
      */
     void ( *CadDone ) ( bool channelActivityDetected );
+    /*!
+     * \brief Tx Done callback carrying the radio interrupt timestamp.
+     *        Called instead of TxDone when set.
+     *
+     * \param [IN] timestamp Timer ticks captured at the radio interrupt edge
+     *                       \ref TimerGetCurrentTicks
+     */
+    void    ( *TxDoneTimestamped )( uint32_t timestamp );
+    /*!
+     * \brief Rx Done callback carrying the radio interrupt timestamp.
+     *        Called instead of RxDone when set.
+     *
+     * \param [IN] payload   Received buffer pointer
+     * \param [IN] size      Received buffer size
+     * \param [IN] rssi      RSSI value computed while receiving the frame [dBm]
+     * \param [IN] snr       SNR value computed while receiving the frame [dB]
+     * \param [IN] timestamp Timer ticks captured at the radio interrupt edge
+     *                       \ref TimerGetCurrentTicks
+     */
+    void    ( *RxDoneTimestamped )( uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr, uint32_t timestamp );
 }RadioEvents_t;
 
 /*!
@@ -343,6 +380,37 @@ struct Radio_s
      * \brief Process radio irq
      */
     void ( *IrqProcess )( void );
+    /*!
+     * \brief Checks if a radio irq is waiting to be processed by IrqProcess
+     *
+     * \remark NULL when the radio irqs are processed from interrupt context.
+     *
+     * \retval isPending true if a radio irq is pending, false otherwise
+     */
+    bool ( *IsIrqPending )( void );
+    /*!
+     * \brief Gets the radio activity statistics
+     *
+     * \remark The times include the on-going transmission or reception.
+     *
+     * \param [OUT] stats Statistics accumulated since the last ResetStats
+     */
+    void ( *GetStats )( RadioStats_t* stats );
+    /*!
+     * \brief Clears the radio activity statistics
+     */
+    void ( *ResetStats )( void );
+    /*!
+     * \brief Checks if the radio is still processing the previous commands
+     *
+     * \remark The configuration functions may return before the radio
+     *         completed the commands. The radio may then overlap its setup
+     *         with other processing. The next blocking function waits for
+     *         them. NULL when all the functions are blocking.
+     *
+     * \retval isPending true while commands are being processed
+     */
+    bool ( *IsCommandPending )( void );
     /*
      * The next functions are available only on SX126x radios.
      */
@@ -358,20 +426,55 @@ struct Radio_s
     /*!
      * \brief Sets the Rx duty cycle management parameters
      *
-     * \remark Available on SX126x radios only.
+     * \remark Available on SX126x radios only. The radio uses the last
+     *         reception configuration and the duty cycle ends with the first
+     *         received frame.
      *
-     * \param [in]  rxTime        Structure describing reception timeout value
-     * \param [in]  sleepTime     Structure describing sleep timeout value
+     * \param [in]  rxTime        Reception period [15.625 us steps]
+     * \param [in]  sleepTime     Sleep period [15.625 us steps]
      */
     void ( *SetRxDutyCycle ) ( uint32_t rxTime, uint32_t sleepTime );
+    /*!
+     * \brief Sets the channels the LoRa intra-packet frequency hopping hops
+     *        on. The driver writes the next channel of a pseudo-random
+     *        sequence upon each FhssChangeChannel interrupt.
+     *
+     * \remark Available on SX127x only
+     *
+     * \param [IN] channels   Channels frequencies [Hz]
+     * \param [IN] nbChannels Number of channels, 0 to disable the table
+     * \param [IN] seed       Seed of the hopping sequence
+     */
+    void ( *SetHopTable )( const uint32_t *channels, uint8_t nbChannels, uint32_t seed );
 };
 
 /*!
- * \brief Radio driver
+ * \brief Selected radio driver
+ *
+ * \remark The driver tables are defined and initialized in the specific radio
+ *         board implementations. The build system selects the one of the
+ *         RADIO radio at startup.
+ */
+extern const struct Radio_s* RadioDriver;
+
+/*!
+ * \brief Radio driver. The calls go to the selected driver.
+ */
+#define Radio                                       ( *RadioDriver )
+
+/*!
+ * \brief Selects the radio driver the Radio calls go to
+ *
+ * \remark Lets a board with several radio chips run them at once, e.g. one
+ *         dedicated to the reception while the other one transmits. The chips
+ *         must use different drivers, a driver keeps the state of a single
+ *         chip. The region layer configures the selected radio, so that the
+ *         selection must be restored right after the configuration of another
+ *         radio.
  *
- * \remark This variable is defined and initialized in the specific radio
- *         board implementation
+ * \param [IN] driver Driver table of the radio to be selected
+ * \retval previous   Driver table of the previously selected radio
  */
-extern const struct Radio_s Radio;
+const struct Radio_s* RadioSelect( const struct Radio_s* driver );
 
 #endif // __RADIO_H__
@@ -0,0 +1,602 @@
+/*!
+ * \file      sim-radio.c
+ *
+ * \brief     Simulated radio driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#include <stdlib.h>
+#include "utilities.h"
+#include "timer.h"
+#include "radio.h"
+#include "sim-radio.h"
+
+/*!
+ * Radio wake-up time from sleep [ms]
+ */
+#define SIM_RADIO_WAKEUP_TIME                       1
+
+/*!
+ * Simulated radio settings
+ */
+typedef struct
+{
+    RadioModems_t Modem;
+    uint32_t Frequency;
+    uint32_t Bandwidth;
+    uint32_t Datarate;
+    uint8_t Coderate;
+    uint16_t PreambleLen;
+    uint16_t SymbTimeout;
+    bool FixLen;
+    bool CrcOn;
+    bool RxContinuous;
+    uint32_t TxTimeout;
+    int8_t Power;
+}SimRadioSettings_t;
+
+/*!
+ * Frame pending for delivery on the next reception window
+ */
+typedef struct
+{
+    bool IsPending;
+    uint8_t Size;
+    int16_t Rssi;
+    int8_t Snr;
+    uint8_t Payload[SIM_RADIO_MAX_PAYLOAD];
+}SimRadioRxFrame_t;
+
+/*
+ * Radio driver functions prototypes
+ */
+void RadioInit( RadioEvents_t *events );
+RadioState_t RadioGetStatus( void );
+void RadioSetModem( RadioModems_t modem );
+void RadioSetChannel( uint32_t freq );
+bool RadioIsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime );
+uint32_t RadioRandom( void );
+void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
+                       uint32_t datarate, uint8_t coderate,
+                       uint32_t bandwidthAfc, uint16_t preambleLen,
+                       uint16_t symbTimeout, bool fixLen,
+                       uint8_t payloadLen,
+                       bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                       bool iqInverted, bool rxContinuous );
+void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
+                       uint32_t bandwidth, uint32_t datarate,
+                       uint8_t coderate, uint16_t preambleLen,
+                       bool fixLen, bool crcOn, bool freqHopOn,
+                       uint8_t hopPeriod, bool iqInverted, uint32_t timeout );
+bool RadioCheckRfFrequency( uint32_t frequency );
+uint32_t RadioTimeOnAir( RadioModems_t modem, uint8_t pktLen );
+void RadioSend( uint8_t *buffer, uint8_t size );
+void RadioSleep( void );
+void RadioStandby( void );
+void RadioRx( uint32_t timeout );
+void RadioStartCad( void );
+void RadioSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time );
+int16_t RadioRssi( RadioModems_t modem );
+void RadioWrite( uint16_t addr, uint8_t data );
+uint8_t RadioRead( uint16_t addr );
+void RadioWriteBuffer( uint16_t addr, uint8_t *buffer, uint8_t size );
+void RadioReadBuffer( uint16_t addr, uint8_t *buffer, uint8_t size );
+void RadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max );
+void RadioSetPublicNetwork( bool enable );
+uint32_t RadioGetWakeupTime( void );
+void RadioGetStats( RadioStats_t* stats );
+void RadioResetStats( void );
+
+/*!
+ * Radio driver structure initialization
+ */
+const struct Radio_s SimRadio =
+{
+    RadioInit,
+    RadioGetStatus,
+    RadioSetModem,
+    RadioSetChannel,
+    RadioIsChannelFree,
+    RadioRandom,
+    RadioSetRxConfig,
+    RadioSetTxConfig,
+    RadioCheckRfFrequency,
+    RadioTimeOnAir,
+    RadioSend,
+    RadioSleep,
+    RadioStandby,
+    RadioRx,
+    RadioStartCad,
+    RadioSetTxContinuousWave,
+    RadioRssi,
+    RadioWrite,
+    RadioRead,
+    RadioWriteBuffer,
+    RadioReadBuffer,
+    RadioSetMaxPayloadLength,
+    RadioSetPublicNetwork,
+    RadioGetWakeupTime,
+    NULL, // void ( *IrqProcess )( void )
+    NULL, // bool ( *IsIrqPending )( void )
+    RadioGetStats,
+    RadioResetStats,
+    NULL, // bool ( *IsCommandPending )( void )
+    NULL, // void ( *RxBoosted )( uint32_t timeout ) - SX126x Only
+    NULL, // void ( *SetRxDutyCycle )( uint32_t rxTime, uint32_t sleepTime ) - SX126x Only
+    NULL, // void ( *SetHopTable )( const uint32_t *channels, uint8_t nbChannels, uint32_t seed ) - SX127x Only
+};
+
+/*!
+ * Radio callbacks variable
+ */
+static RadioEvents_t* RadioEvents;
+
+/*!
+ * Radio state
+ */
+static RadioState_t RadioState = RF_IDLE;
+
+/*!
+ * Transmission and reception settings
+ */
+static SimRadioSettings_t TxSettings;
+static SimRadioSettings_t RxSettings;
+
+/*!
+ * Time on air of the last transmitted frame [ms]
+ */
+static uint32_t TxTimeOnAir = 0;
+
+/*!
+ * Radio channel frequency
+ */
+static uint32_t RadioFrequency;
+
+/*!
+ * Host harness hooks
+ */
+static SimRadioHooks_t* RadioHooks = NULL;
+
+/*!
+ * Radio activity counters
+ */
+static SimRadioStats_t RadioStats;
+
+/*!
+ * Frame to be delivered on the next reception window
+ */
+static SimRadioRxFrame_t RxFrame;
+
+/*!
+ * Frame delivered on the current reception window
+ */
+static SimRadioRxFrame_t RxDoneFrame;
+
+/*!
+ * Tx and Rx operation timers
+ */
+static TimerEvent_t TxTimer;
+static TimerEvent_t RxTimer;
+
+/*!
+ * Indicates if the running Rx operation will deliver a frame
+ */
+static bool RxFrameExpected = false;
+
+/*!
+ * Start time of the running Rx operation
+ */
+static TimerTime_t RxStartTime = 0;
+
+/*!
+ * \brief Accumulates the time spent in the running Rx operation, if any
+ */
+static void RadioUpdateRxTime( void )
+{
+    if( RadioState == RF_RX_RUNNING )
+    {
+        TimerTime_t now = TimerGetCurrentTime( );
+
+        RadioStats.RxTime += now - RxStartTime;
+        RxStartTime = now;
+    }
+}
+
+/*!
+ * \brief Computes the LoRa symbol time
+ *
+ * \param [IN] bandwidth LoRa bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \param [IN] datarate  LoRa spreading factor
+ * \retval symbolTime    Symbol time [us]
+ */
+static uint32_t RadioLoRaSymbTime( uint32_t bandwidth, uint32_t datarate )
+{
+    return ( ( uint32_t )1000000 << datarate ) / ( 125000 << bandwidth );
+}
+
+/*!
+ * \brief Computes the time on air for the given settings
+ *
+ * \param [IN] settings Modem settings
+ * \param [IN] pktLen   Packet length
+ * \retval airTime      Time on air [ms]
+ */
+static uint32_t RadioComputeTimeOnAir( SimRadioSettings_t* settings, uint8_t pktLen )
+{
+    if( settings->Modem == MODEM_FSK )
+    {
+        // Preamble + sync word + length + payload + crc, in bits
+        uint32_t bits = 8 * ( settings->PreambleLen + 3 + ( ( settings->FixLen == true ) ? 0 : 1 ) +
+                              pktLen + ( ( settings->CrcOn == true ) ? 2 : 0 ) );
+        return ( bits * 1000 + settings->Datarate - 1 ) / settings->Datarate;
+    }
+    else
+    {
+        uint32_t sf = settings->Datarate;
+        uint32_t ts = RadioLoRaSymbTime( settings->Bandwidth, sf );
+        bool lowDatarateOptimize = ( ( settings->Bandwidth == 0 ) && ( ( sf == 11 ) || ( sf == 12 ) ) ) ||
+                                   ( ( settings->Bandwidth == 1 ) && ( sf == 12 ) );
+        int32_t num = 8 * pktLen - 4 * sf + 28 + ( ( settings->CrcOn == true ) ? 16 : 0 ) -
+                      ( ( settings->FixLen == true ) ? 20 : 0 );
+        int32_t den = 4 * ( sf - ( ( lowDatarateOptimize == true ) ? 2 : 0 ) );
+        int32_t nPayload = 8;
+
+        if( num > 0 )
+        {
+            nPayload += ( ( num + den - 1 ) / den ) * ( settings->Coderate + 4 );
+        }
+        // Preamble ( + 4.25 symbols ) and payload symbols, in us
+        uint32_t tOnAir = ( ( settings->PreambleLen * 4 + 17 ) * ts ) / 4 + nPayload * ts;
+        return ( tOnAir + 999 ) / 1000;
+    }
+}
+
+/*!
+ * \brief Tx operation end event
+ */
+static void OnTxTimerEvent( void* context )
+{
+    TimerStop( &TxTimer );
+    RadioState = RF_IDLE;
+    if( ( RadioEvents != NULL ) && ( RadioEvents->TxDoneTimestamped != NULL ) )
+    {
+        RadioEvents->TxDoneTimestamped( TimerGetCurrentTicks( ) );
+    }
+    else if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
+    {
+        RadioEvents->TxDone( );
+    }
+}
+
+/*!
+ * \brief Rx operation end event
+ */
+static void OnRxTimerEvent( void* context )
+{
+    TimerStop( &RxTimer );
+
+    if( RxSettings.RxContinuous == false )
+    {
+        RadioUpdateRxTime( );
+        RadioState = RF_IDLE;
+    }
+
+    if( RxFrameExpected == true )
+    {
+        RxFrameExpected = false;
+        RadioStats.RxDoneCount++;
+        if( ( RadioEvents != NULL ) && ( RadioEvents->RxDoneTimestamped != NULL ) )
+        {
+            RadioEvents->RxDoneTimestamped( RxDoneFrame.Payload, RxDoneFrame.Size, RxDoneFrame.Rssi, RxDoneFrame.Snr,
+                                            TimerGetCurrentTicks( ) );
+        }
+        else if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+        {
+            RadioEvents->RxDone( RxDoneFrame.Payload, RxDoneFrame.Size, RxDoneFrame.Rssi, RxDoneFrame.Snr );
+        }
+    }
+    else
+    {
+        RadioStats.RxTimeoutCount++;
+        if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
+        {
+            RadioEvents->RxTimeout( );
+        }
+    }
+}
+
+void SimRadioSetHooks( SimRadioHooks_t *hooks )
+{
+    RadioHooks = hooks;
+}
+
+void SimRadioQueueRxFrame( uint8_t *payload, uint8_t size, int16_t rssi, int8_t snr )
+{
+    memcpy1( RxFrame.Payload, payload, size );
+    RxFrame.Size = size;
+    RxFrame.Rssi = rssi;
+    RxFrame.Snr = snr;
+    RxFrame.IsPending = true;
+}
+
+SimRadioStats_t* SimRadioGetStats( void )
+{
+    return &RadioStats;
+}
+
+uint32_t SimRadioGetTxSettings( int8_t *power, uint32_t *bandwidth )
+{
+    *power = TxSettings.Power;
+    *bandwidth = TxSettings.Bandwidth;
+    return TxTimeOnAir;
+}
+
+uint32_t SimRadioGetRxBandwidth( void )
+{
+    return RxSettings.Bandwidth;
+}
+
+uint32_t SimRadioLoRaTimeOnAir( uint32_t bandwidth, uint32_t sf, bool crcOn, uint8_t size )
+{
+    SimRadioSettings_t settings = { 0 };
+
+    settings.Modem = MODEM_LORA;
+    settings.Bandwidth = bandwidth;
+    settings.Datarate = sf;
+    settings.Coderate = 1;
+    settings.PreambleLen = 8;
+    settings.FixLen = false;
+    settings.CrcOn = crcOn;
+    return RadioComputeTimeOnAir( &settings, size );
+}
+
+void RadioGetStats( RadioStats_t* stats )
+{
+    RadioUpdateRxTime( );
+
+    memset1( ( uint8_t* )stats, 0, sizeof( RadioStats_t ) );
+    stats->TxCnt = RadioStats.TxCount;
+    stats->RxCnt = RadioStats.RxDoneCount;
+    stats->RxTimeoutCnt = RadioStats.RxTimeoutCount;
+    stats->TxTime = RadioStats.TxTimeOnAir;
+    stats->RxTime = RadioStats.RxTime;
+}
+
+void RadioResetStats( void )
+{
+    memset1( ( uint8_t* )&RadioStats, 0, sizeof( SimRadioStats_t ) );
+    RxStartTime = TimerGetCurrentTime( );
+}
+
+void RadioInit( RadioEvents_t *events )
+{
+    RadioEvents = events;
+    RadioState = RF_IDLE;
+    RxFrameExpected = false;
+
+    TimerInit( &TxTimer, OnTxTimerEvent );
+    TimerInit( &RxTimer, OnRxTimerEvent );
+}
+
+RadioState_t RadioGetStatus( void )
+{
+    return RadioState;
+}
+
+void RadioSetModem( RadioModems_t modem )
+{
+    TxSettings.Modem = modem;
+    RxSettings.Modem = modem;
+}
+
+void RadioSetChannel( uint32_t freq )
+{
+    RadioFrequency = freq;
+}
+
+bool RadioIsChannelFree( RadioModems_t modem, uint32_t freq, int16_t rssiThresh, uint32_t maxCarrierSenseTime )
+{
+    return true;
+}
+
+uint32_t RadioRandom( void )
+{
+    return ( uint32_t )rand( );
+}
+
+void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
+                       uint32_t datarate, uint8_t coderate,
+                       uint32_t bandwidthAfc, uint16_t preambleLen,
+                       uint16_t symbTimeout, bool fixLen,
+                       uint8_t payloadLen,
+                       bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                       bool iqInverted, bool rxContinuous )
+{
+    RxSettings.Modem = modem;
+    RxSettings.Bandwidth = bandwidth;
+    RxSettings.Datarate = datarate;
+    RxSettings.Coderate = coderate;
+    RxSettings.PreambleLen = preambleLen;
+    RxSettings.SymbTimeout = symbTimeout;
+    RxSettings.FixLen = fixLen;
+    RxSettings.CrcOn = crcOn;
+    RxSettings.RxContinuous = rxContinuous;
+}
+
+void RadioSetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
+                       uint32_t bandwidth, uint32_t datarate,
+                       uint8_t coderate, uint16_t preambleLen,
+                       bool fixLen, bool crcOn, bool freqHopOn,
+                       uint8_t hopPeriod, bool iqInverted, uint32_t timeout )
+{
+    TxSettings.Modem = modem;
+    TxSettings.Power = power;
+    TxSettings.Bandwidth = bandwidth;
+    TxSettings.Datarate = datarate;
+    TxSettings.Coderate = coderate;
+    TxSettings.PreambleLen = preambleLen;
+    TxSettings.FixLen = fixLen;
+    TxSettings.CrcOn = crcOn;
+    TxSettings.TxTimeout = timeout;
+}
+
+bool RadioCheckRfFrequency( uint32_t frequency )
+{
+    return true;
+}
+
+uint32_t RadioTimeOnAir( RadioModems_t modem, uint8_t pktLen )
+{
+    TxSettings.Modem = modem;
+    return RadioComputeTimeOnAir( &TxSettings, pktLen );
+}
+
+void RadioSend( uint8_t *buffer, uint8_t size )
+{
+    uint32_t airTime = RadioComputeTimeOnAir( &TxSettings, size );
+
+    TimerStop( &RxTimer );
+    RxFrameExpected = false;
+
+    RadioUpdateRxTime( );
+    RadioState = RF_TX_RUNNING;
+    RadioStats.TxCount++;
+    RadioStats.TxTimeOnAir += airTime;
+    TxTimeOnAir = airTime;
+
+    if( ( RadioHooks != NULL ) && ( RadioHooks->OnTx != NULL ) )
+    {
+        RadioHooks->OnTx( RadioFrequency, ( TxSettings.Modem == MODEM_LORA ) ? TxSettings.Datarate : 0, buffer, size );
+    }
+
+    TimerSetValue( &TxTimer, airTime );
+    TimerStart( &TxTimer );
+}
+
+void RadioSleep( void )
+{
+    TimerStop( &TxTimer );
+    TimerStop( &RxTimer );
+    RxFrameExpected = false;
+    RadioUpdateRxTime( );
+    RadioState = RF_IDLE;
+}
+
+void RadioStandby( void )
+{
+    RadioSleep( );
+}
+
+void RadioRx( uint32_t timeout )
+{
+    uint32_t rxTime = timeout;
+
+    TimerStop( &TxTimer );
+    TimerStop( &RxTimer );
+
+    RadioUpdateRxTime( );
+    RadioState = RF_RX_RUNNING;
+    RxStartTime = TimerGetCurrentTime( );
+    RadioStats.RxCount++;
+
+    if( ( RadioHooks != NULL ) && ( RadioHooks->OnRx != NULL ) )
+    {
+        RadioHooks->OnRx( RadioFrequency, ( RxSettings.Modem == MODEM_LORA ) ? RxSettings.Datarate : 0 );
+    }
+
+    if( RxFrame.IsPending == true )
+    {
+        // Deliver the queued frame once it has been fully received
+        RxFrame.IsPending = false;
+        RxDoneFrame = RxFrame;
+        RxFrameExpected = true;
+        rxTime = RadioComputeTimeOnAir( &RxSettings, RxDoneFrame.Size );
+    }
+    else if( RxSettings.RxContinuous == true )
+    {
+        // Continuous reception. Nothing to be received.
+        return;
+    }
+    else if( ( RxSettings.Modem == MODEM_LORA ) && ( RxSettings.SymbTimeout != 0 ) )
+    {
+        // Single reception ends after the symbol timeout
+        rxTime = ( RxSettings.SymbTimeout * RadioLoRaSymbTime( RxSettings.Bandwidth, RxSettings.Datarate ) + 999 ) / 1000;
+    }
+
+    if( rxTime == 0 )
+    {
+        // Continuous reception. Nothing to be received.
+        return;
+    }
+    TimerSetValue( &RxTimer, rxTime );
+    TimerStart( &RxTimer );
+}
+
+void RadioStartCad( void )
+{
+    RadioState = RF_CAD;
+    if( ( RadioEvents != NULL ) && ( RadioEvents->CadDone != NULL ) )
+    {
+        RadioState = RF_IDLE;
+        RadioEvents->CadDone( false );
+    }
+}
+
+void RadioSetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
+{
+    RadioFrequency = freq;
+    RadioState = RF_TX_RUNNING;
+    TimerSetValue( &TxTimer, ( uint32_t )time * 1000 );
+    TimerStart( &TxTimer );
+}
+
+int16_t RadioRssi( RadioModems_t modem )
+{
+    return -120;
+}
+
+void RadioWrite( uint16_t addr, uint8_t data )
+{
+}
+
+uint8_t RadioRead( uint16_t addr )
+{
+    return 0;
+}
+
+void RadioWriteBuffer( uint16_t addr, uint8_t *buffer, uint8_t size )
+{
+}
+
+void RadioReadBuffer( uint16_t addr, uint8_t *buffer, uint8_t size )
+{
+    memset1( buffer, 0, size );
+}
+
+void RadioSetMaxPayloadLength( RadioModems_t modem, uint8_t max )
+{
+}
+
+void RadioSetPublicNetwork( bool enable )
+{
+}
+
+uint32_t RadioGetWakeupTime( void )
+{
+    return SIM_RADIO_WAKEUP_TIME;
+}
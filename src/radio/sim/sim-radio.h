@@ -0,0 +1,132 @@
+/*!
+ * \file      sim-radio.h
+ *
+ * \brief     Simulated radio driver implementation
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2017 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \author    Gregory Cristian ( Semtech )
+ */
+#ifndef __SIM_RADIO_H__
+#define __SIM_RADIO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "radio.h"
+
+/*!
+ * Maximum payload size handled by the simulated radio
+ */
+#define SIM_RADIO_MAX_PAYLOAD                       255
+
+/*!
+ * \brief Simulated radio hooks. Allow a host harness to model the network side.
+ */
+typedef struct sSimRadioHooks
+{
+    /*!
+     * \brief Called when a frame transmission starts
+     *
+     * \param [IN] freq   Channel RF frequency [Hz]
+     * \param [IN] sf     LoRa spreading factor or 0 for FSK
+     * \param [IN] buffer Frame buffer
+     * \param [IN] size   Frame size
+     */
+    void ( *OnTx )( uint32_t freq, uint8_t sf, uint8_t *buffer, uint8_t size );
+    /*!
+     * \brief Called when a reception window is opened
+     *
+     * \param [IN] freq Channel RF frequency [Hz]
+     * \param [IN] sf   LoRa spreading factor or 0 for FSK
+     */
+    void ( *OnRx )( uint32_t freq, uint8_t sf );
+}SimRadioHooks_t;
+
+/*!
+ * \brief Simulated radio activity counters
+ */
+typedef struct sSimRadioStats
+{
+    uint32_t TxCount;       //! Number of transmitted frames
+    uint32_t RxCount;       //! Number of opened reception windows
+    uint32_t RxDoneCount;   //! Number of delivered frames
+    uint32_t TxTimeOnAir;   //! Accumulated transmission time on air [ms]
+    uint32_t RxTimeoutCount;//! Number of reception windows closed without frame
+    uint32_t RxTime;        //! Accumulated reception time [ms]
+}SimRadioStats_t;
+
+/*!
+ * \brief Registers the host harness hooks
+ *
+ * \param [IN] hooks Hooks to be called by the simulated radio. NULL to remove.
+ */
+void SimRadioSetHooks( SimRadioHooks_t *hooks );
+
+/*!
+ * \brief Queues a frame to be delivered on the next reception window
+ *
+ * \remark The frame is handed to the RxDone callback after its time on air
+ *         once the next reception window opens.
+ *
+ * \param [IN] payload Frame buffer
+ * \param [IN] size    Frame size
+ * \param [IN] rssi    RSSI to be reported [dBm]
+ * \param [IN] snr     SNR to be reported [dB]
+ */
+void SimRadioQueueRxFrame( uint8_t *payload, uint8_t size, int16_t rssi, int8_t snr );
+
+/*!
+ * \brief Returns the simulated radio activity counters
+ *
+ * \retval stats Pointer to the counters
+ */
+SimRadioStats_t* SimRadioGetStats( void );
+
+/*!
+ * \brief Returns the settings of the last transmitted frame
+ *
+ * \param [OUT] power     RF output power [dBm]
+ * \param [OUT] bandwidth LoRa bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \retval airTime        Time on air of the last transmitted frame [ms]
+ */
+uint32_t SimRadioGetTxSettings( int8_t *power, uint32_t *bandwidth );
+
+/*!
+ * \brief Returns the LoRa bandwidth of the current reception settings
+ *
+ * \retval bandwidth LoRa bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ */
+uint32_t SimRadioGetRxBandwidth( void );
+
+/*!
+ * \brief Computes the time on air of a LoRaWAN LoRa frame
+ *
+ * \remark Explicit header, 4/5 coding rate and 8 symbols preamble.
+ *
+ * \param [IN] bandwidth LoRa bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \param [IN] sf        LoRa spreading factor
+ * \param [IN] crcOn     Payload CRC, set for uplinks
+ * \param [IN] size      Frame size
+ * \retval airTime       Time on air [ms]
+ */
+uint32_t SimRadioLoRaTimeOnAir( uint32_t bandwidth, uint32_t sf, bool crcOn, uint8_t size );
+
+/*!
+ * Radio driver table. Refer to \ref RadioSelect.
+ */
+extern const struct Radio_s SimRadio;
+
+#endif // __SIM_RADIO_H__
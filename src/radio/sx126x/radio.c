@@ -300,6 +300,32 @@ uint32_t RadioGetWakeupTime( void );
  */
 void RadioIrqProcess( void );
 
+/*!
+ * \brief Checks if a radio irq is waiting to be processed by RadioIrqProcess
+ *
+ * \retval isPending true if a radio irq is pending, false otherwise
+ */
+bool RadioIsIrqPending( void );
+
+/*!
+ * \brief Gets the radio activity statistics
+ *
+ * \param [OUT] stats Statistics accumulated since the last RadioResetStats
+ */
+void RadioGetStats( RadioStats_t* stats );
+
+/*!
+ * \brief Clears the radio activity statistics
+ */
+void RadioResetStats( void );
+
+/*!
+ * \brief Checks if the radio is still processing the previous commands
+ *
+ * \retval isPending true while commands are being processed
+ */
+bool RadioIsCommandPending( void );
+
 /*!
  * \brief Sets the radio in reception mode with Max LNA gain for the given time
  * \param [IN] timeout Reception timeout [ms]
@@ -318,7 +344,7 @@ void RadioSetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime );
 /*!
  * Radio driver structure initialization
  */
-const struct Radio_s Radio =
+const struct Radio_s SX126xRadio =
 {
     RadioInit,
     RadioGetStatus,
@@ -345,9 +371,14 @@ const struct Radio_s Radio =
     RadioSetPublicNetwork,
     RadioGetWakeupTime,
     RadioIrqProcess,
+    RadioIsIrqPending,
+    RadioGetStats,
+    RadioResetStats,
+    RadioIsCommandPending,
     // Available on SX126x only
     RadioRxBoosted,
-    RadioSetRxDutyCycle
+    RadioSetRxDutyCycle,
+    NULL, // void ( *SetHopTable )( const uint32_t *channels, uint8_t nbChannels, uint32_t seed ) - SX127x Only
 };
 
 /*
@@ -407,12 +438,44 @@ uint32_t RxTimeout = 0;
 
 bool RxContinuous = false;
 
+/*!
+ * Number of symbols following the preamble detection until the header is
+ * received: the preamble remainder, the sync word and the header itself plus
+ * a margin
+ */
+#define RADIO_RX_HEADER_GUARD_SYMBOLS               16
+
+/*!
+ * Single LoRa receptions check the received header against the configuration
+ */
+static bool RxHeaderFilterOn = false;
+
+/*!
+ * Payload CRC presence expected in the received LoRa headers
+ */
+static bool RxCrcOn = false;
+
+/*!
+ * Time allowed from the preamble detection to the header valid interrupt [ms]
+ */
+static uint32_t RxHeaderTimeout = 0;
+
+/*!
+ * Reception timeout given to RadioRx [ms]
+ */
+static uint32_t RxWindowTimeout = 0;
+
 
 PacketStatus_t RadioPktStatus;
 uint8_t RadioRxPayload[255];
 
 bool IrqFired = false;
 
+/*!
+ * Timer ticks captured at the last DIO interrupt edge
+ */
+static uint32_t IrqTicks = 0;
+
 /*
  * SX126x DIO IRQ callback functions prototype
  */
@@ -520,6 +583,7 @@ RadioState_t RadioGetStatus( void )
         case MODE_TX:
             return RF_TX_RUNNING;
         case MODE_RX:
+        case MODE_RX_DC:
             return RF_RX_RUNNING;
         case MODE_CAD:
             return RF_CAD;
@@ -645,6 +709,7 @@ void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
     {
         case MODEM_FSK:
             SX126xSetStopRxTimerOnPreambleDetect( false );
+            RxHeaderFilterOn = false;
             SX126x.ModulationParams.PacketType = PACKET_TYPE_GFSK;
 
             SX126x.ModulationParams.Params.Gfsk.BitRate = datarate;
@@ -721,6 +786,17 @@ void RadioSetRxConfig( RadioModems_t modem, uint32_t bandwidth,
             SX126x.PacketParams.Params.LoRa.CrcMode = ( RadioLoRaCrcModes_t )crcOn;
             SX126x.PacketParams.Params.LoRa.InvertIQ = ( RadioLoRaIQModes_t )iqInverted;
 
+            // Downlink receptions, using an inverted IQ, are cut as soon as the
+            // received frame cannot be the expected one
+            RxHeaderFilterOn = ( iqInverted == true ) && ( fixLen == false ) && ( rxContinuous == false );
+            RxCrcOn = crcOn;
+            RxHeaderTimeout = 0;
+            if( SX126x.ModulationParams.Params.LoRa.SpreadingFactor >= LORA_SF7 )
+            {
+                double ts = RadioLoRaSymbTime[SX126x.ModulationParams.Params.LoRa.Bandwidth - 4][12 - SX126x.ModulationParams.Params.LoRa.SpreadingFactor];
+                RxHeaderTimeout = ( uint32_t )ceil( ( preambleLen + RADIO_RX_HEADER_GUARD_SYMBOLS ) * ts );
+            }
+
             RadioSetModem( ( SX126x.ModulationParams.PacketType == PACKET_TYPE_GFSK ) ? MODEM_FSK : MODEM_LORA );
             SX126xSetModulationParams( &SX126x.ModulationParams );
             SX126xSetPacketParams( &SX126x.PacketParams );
@@ -924,8 +1000,6 @@ void RadioSleep( void )
 
     params.Fields.WarmStart = 1;
     SX126xSetSleep( params );
-
-    DelayMs( 2 );
 }
 
 void RadioStandby( void )
@@ -940,6 +1014,7 @@ void RadioRx( uint32_t timeout )
                            IRQ_RADIO_NONE,
                            IRQ_RADIO_NONE );
 
+    RxWindowTimeout = timeout;
     if( timeout != 0 )
     {
         TimerSetValue( &RxTimeoutTimer, timeout );
@@ -963,6 +1038,7 @@ void RadioRxBoosted( uint32_t timeout )
                            IRQ_RADIO_NONE,
                            IRQ_RADIO_NONE );
 
+    RxWindowTimeout = timeout;
     if( timeout != 0 )
     {
         TimerSetValue( &RxTimeoutTimer, timeout );
@@ -981,6 +1057,9 @@ void RadioRxBoosted( uint32_t timeout )
 
 void RadioSetRxDutyCycle( uint32_t rxTime, uint32_t sleepTime )
 {
+    SX126xSetDioIrqParams( IRQ_RADIO_ALL, IRQ_RADIO_ALL, IRQ_RADIO_NONE, IRQ_RADIO_NONE );
+    // The listening period only has to cover the preamble detection
+    SX126xSetStopRxTimerOnPreambleDetect( true );
     SX126xSetRxDutyCycle( rxTime, sleepTime );
 }
 
@@ -1077,11 +1156,27 @@ void RadioSetPublicNetwork( bool enable )
 
 uint32_t RadioGetWakeupTime( void )
 {
-    return SX126xGetBoardTcxoWakeupTime( ) + RADIO_WAKEUP_TIME;
+    return SX126xGetWakeupTime( );
+}
+
+void RadioGetStats( RadioStats_t* stats )
+{
+    SX126xGetStats( stats );
+}
+
+void RadioResetStats( void )
+{
+    SX126xResetStats( );
+}
+
+bool RadioIsCommandPending( void )
+{
+    return SX126xIsCommandPending( );
 }
 
 void RadioOnTxTimeoutIrq( void* context )
 {
+    SX126x.Stats.TxTimeoutCnt++;
     if( ( RadioEvents != NULL ) && ( RadioEvents->TxTimeout != NULL ) )
     {
         RadioEvents->TxTimeout( );
@@ -1090,17 +1185,24 @@ void RadioOnTxTimeoutIrq( void* context )
 
 void RadioOnRxTimeoutIrq( void* context )
 {
+    SX126x.Stats.RxTimeoutCnt++;
     if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
     {
         RadioEvents->RxTimeout( );
     }
 }
 
-void RadioOnDioIrq( void* context )
+LORAMAC_HOT void RadioOnDioIrq( void* context )
 {
+    IrqTicks = TimerGetCurrentTicks( );
     IrqFired = true;
 }
 
+bool RadioIsIrqPending( void )
+{
+    return IrqFired;
+}
+
 void RadioIrqProcess( void )
 {
     if( IrqFired == true )
@@ -1118,7 +1220,12 @@ void RadioIrqProcess( void )
             TimerStop( &TxTimeoutTimer );
             //!< Update operating mode state to a value lower than \ref MODE_STDBY_XOSC
             SX126xSetOperatingMode( MODE_STDBY_RC );
-            if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
+            SX126x.Stats.TxCnt++;
+            if( ( RadioEvents != NULL ) && ( RadioEvents->TxDoneTimestamped != NULL ) )
+            {
+                RadioEvents->TxDoneTimestamped( IrqTicks );
+            }
+            else if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
             {
                 RadioEvents->TxDone( );
             }
@@ -1129,6 +1236,11 @@ void RadioIrqProcess( void )
             uint8_t size;
 
             TimerStop( &RxTimeoutTimer );
+            if( SX126xGetOperatingMode( ) == MODE_RX_DC )
+            {
+                // The RX duty cycle ends with the received frame
+                SX126xSetOperatingMode( MODE_STDBY_RC );
+            }
             if( RxContinuous == false )
             {
                 //!< Update operating mode state to a value lower than \ref MODE_STDBY_XOSC
@@ -1143,7 +1255,12 @@ void RadioIrqProcess( void )
             }
             SX126xGetPayload( RadioRxPayload, &size , 255 );
             SX126xGetPacketStatus( &RadioPktStatus );
-            if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+            SX126x.Stats.RxCnt++;
+            if( ( RadioEvents != NULL ) && ( RadioEvents->RxDoneTimestamped != NULL ) )
+            {
+                RadioEvents->RxDoneTimestamped( RadioRxPayload, size, RadioPktStatus.Params.LoRa.RssiPkt, RadioPktStatus.Params.LoRa.SnrPkt, IrqTicks );
+            }
+            else if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
             {
                 RadioEvents->RxDone( RadioRxPayload, size, RadioPktStatus.Params.LoRa.RssiPkt, RadioPktStatus.Params.LoRa.SnrPkt );
             }
@@ -1151,11 +1268,12 @@ void RadioIrqProcess( void )
 
         if( ( irqRegs & IRQ_CRC_ERROR ) == IRQ_CRC_ERROR )
         {
-            if( RxContinuous == false )
+            if( ( RxContinuous == false ) || ( SX126xGetOperatingMode( ) == MODE_RX_DC ) )
             {
                 //!< Update operating mode state to a value lower than \ref MODE_STDBY_XOSC
                 SX126xSetOperatingMode( MODE_STDBY_RC );
             }
+            SX126x.Stats.RxCrcErrorCnt++;
             if( ( RadioEvents != NULL ) && ( RadioEvents->RxError ) )
             {
                 RadioEvents->RxError( );
@@ -1179,6 +1297,7 @@ void RadioIrqProcess( void )
                 TimerStop( &TxTimeoutTimer );
                 //!< Update operating mode state to a value lower than \ref MODE_STDBY_XOSC
                 SX126xSetOperatingMode( MODE_STDBY_RC );
+                SX126x.Stats.TxTimeoutCnt++;
                 if( ( RadioEvents != NULL ) && ( RadioEvents->TxTimeout != NULL ) )
                 {
                     RadioEvents->TxTimeout( );
@@ -1189,6 +1308,7 @@ void RadioIrqProcess( void )
                 TimerStop( &RxTimeoutTimer );
                 //!< Update operating mode state to a value lower than \ref MODE_STDBY_XOSC
                 SX126xSetOperatingMode( MODE_STDBY_RC );
+                SX126x.Stats.RxTimeoutCnt++;
                 if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
                 {
                     RadioEvents->RxTimeout( );
@@ -1198,7 +1318,15 @@ void RadioIrqProcess( void )
 
         if( ( irqRegs & IRQ_PREAMBLE_DETECTED ) == IRQ_PREAMBLE_DETECTED )
         {
-            //__NOP( );
+            if( ( RxHeaderFilterOn == true ) && ( RxHeaderTimeout != 0 ) &&
+                ( TimerIsStarted( &RxTimeoutTimer ) == true ) &&
+                ( ( irqRegs & ( IRQ_HEADER_VALID | IRQ_HEADER_ERROR | IRQ_RX_DONE ) ) == 0 ) )
+            {
+                // A falsely detected preamble would otherwise hold the reception
+                // until the end of the window
+                TimerSetValue( &RxTimeoutTimer, RxHeaderTimeout );
+                TimerStart( &RxTimeoutTimer );
+            }
         }
 
         if( ( irqRegs & IRQ_SYNCWORD_VALID ) == IRQ_SYNCWORD_VALID )
@@ -1208,7 +1336,31 @@ void RadioIrqProcess( void )
 
         if( ( irqRegs & IRQ_HEADER_VALID ) == IRQ_HEADER_VALID )
         {
-            //__NOP( );
+            if( ( RxHeaderFilterOn == true ) && ( SX126xGetOperatingMode( ) == MODE_RX ) &&
+                ( ( irqRegs & ( IRQ_RX_DONE | IRQ_CRC_ERROR ) ) == 0 ) )
+            {
+                bool crcOn = ( SX126xReadRegister( REG_LR_HEADER_CRC ) & REG_LR_HEADER_CRC_MASK ) != 0;
+                uint8_t size = SX126xReadRegister( REG_LR_PAYLOADLENGTH );
+
+                if( ( crcOn != RxCrcOn ) || ( size > MaxPayloadLength ) )
+                {
+                    // Uplink of another device or oversized frame. Do not wait
+                    // for its payload.
+                    TimerStop( &RxTimeoutTimer );
+                    SX126xSetStandby( STDBY_RC );
+                    SX126x.Stats.RxHeaderAbortCnt++;
+                    if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
+                    {
+                        RadioEvents->RxTimeout( );
+                    }
+                }
+                else if( TimerIsStarted( &RxTimeoutTimer ) == true )
+                {
+                    // Leave the frame the whole window to complete
+                    TimerSetValue( &RxTimeoutTimer, RxWindowTimeout );
+                    TimerStart( &RxTimeoutTimer );
+                }
+            }
         }
 
         if( ( irqRegs & IRQ_HEADER_ERROR ) == IRQ_HEADER_ERROR )
@@ -1219,6 +1371,7 @@ void RadioIrqProcess( void )
                 //!< Update operating mode state to a value lower than \ref MODE_STDBY_XOSC
                 SX126xSetOperatingMode( MODE_STDBY_RC );
             }
+            SX126x.Stats.RxTimeoutCnt++;
             if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
             {
                 RadioEvents->RxTimeout( );
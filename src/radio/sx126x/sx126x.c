@@ -42,6 +42,22 @@ typedef struct
  */
 static RadioOperatingModes_t OperatingMode;
 
+/*!
+ * \brief Start time of the current operating mode, used by the radio statistics
+ */
+static TimerTime_t StatsModeStartTime = 0;
+
+/*!
+ * \brief Device current of the applied PA setting, used by the radio
+ *        statistics [mA]
+ */
+static uint8_t TxCurrent = 0;
+
+/*!
+ * \brief Set while the RX gain register holds the boosted gain
+ */
+static bool RxBoostedApplied = false;
+
 /*!
  * \brief Stores the current packet type set in the radio
  */
@@ -62,6 +78,141 @@ volatile uint32_t FrequencyError = 0;
  */
 static bool ImageCalibrated = false;
 
+/*!
+ * \brief Holds the frequency band of the last Image calibration
+ */
+static uint8_t ImageCalibratedFreq[2];
+
+/*!
+ * \brief Radio temperature and temperature of the last Image calibration
+ */
+static int8_t Temperature = 25;
+static int8_t ImageCalibratedTemperature = 25;
+
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+/*!
+ * \brief TCXO supply voltage, valid when TcxoEnabled is true
+ */
+static RadioTcxoCtrlVoltage_t TcxoVoltage;
+static bool TcxoEnabled = false;
+
+/*!
+ * \brief Calibrated wake-up time [us], 0 while not calibrated
+ */
+static uint32_t WakeupTime = 0;
+static bool WakeupCalibrated = false;
+static int8_t WakeupCalibratedTemperature = 25;
+#endif
+
+/*!
+ * \brief Last packet type, modulation and packet parameters and RF frequency
+ *        applied to the radio
+ *
+ * \remark Commands which wouldn't change the radio configuration are skipped.
+ *         A parameters size of 0 means that the radio configuration is unknown.
+ */
+static bool PacketTypeApplied = false;
+static uint8_t ModulationParamsApplied[8];
+static uint8_t ModulationParamsAppliedSize = 0;
+static uint8_t PacketParamsApplied[9];
+static uint8_t PacketParamsAppliedSize = 0;
+static uint32_t RfFrequencyApplied = 0;
+static bool RfFrequencyAppliedValid = false;
+
+/*!
+ * \brief Last DIO IRQ parameters, PA configuration, TX parameters, buffer base
+ *        addresses and regulator mode applied to the radio
+ *
+ * \remark The radio retains them through a warm start sleep
+ */
+static uint8_t DioIrqParamsApplied[8];
+static uint8_t DioIrqParamsAppliedSize = 0;
+static uint8_t PaConfigApplied[4];
+static uint8_t PaConfigAppliedSize = 0;
+static uint8_t TxParamsApplied[2];
+static uint8_t TxParamsAppliedSize = 0;
+static uint8_t BufferBaseAddressApplied[2];
+static uint8_t BufferBaseAddressAppliedSize = 0;
+static uint8_t RegulatorModeApplied[1];
+static uint8_t RegulatorModeAppliedSize = 0;
+
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+/*!
+ * \brief Queued radio command
+ */
+typedef struct
+{
+    RadioCommands_t Opcode;                         //!< Command opcode
+    uint8_t         Size;                           //!< Number of parameters
+    uint8_t         Buffer[SX126X_CMD_QUEUE_MAX_PARAMS]; //!< Command parameters
+}SX126xQueuedCommand_t;
+
+/*!
+ * \brief Commands waiting for the radio to be ready
+ */
+static SX126xQueuedCommand_t CommandQueue[SX126X_CMD_QUEUE_SIZE];
+
+/*!
+ * \brief Command queue read and write indexes and number of queued commands
+ */
+static uint8_t CommandQueueHead = 0;
+static uint8_t CommandQueueTail = 0;
+static volatile uint8_t CommandQueueCount = 0;
+
+/*!
+ * \brief Sends the oldest queued command if the radio is ready
+ *
+ * \remark Must be called from a critical section or from interrupt context
+ */
+static void SX126xSendNextQueuedCommand( void );
+#endif
+
+/*!
+ * \brief Time at which the radio was set in sleep mode
+ */
+static TimerTime_t SleepStartTime = 0;
+
+/*!
+ * \brief Sends a configuration command without waiting for the radio to
+ *        process it
+ *
+ * \remark Uses the command queue when SX126X_BUSY_IRQ_ENABLED is defined and
+ *         the blocking SX126xWriteCommand otherwise.
+ *
+ * \param [in]  command       Opcode of the command
+ * \param [in]  buffer        Buffer holding the command parameters
+ * \param [in]  size          Number of parameters
+ */
+static void SX126xWriteCommandNoWait( RadioCommands_t command, uint8_t *buffer, uint16_t size );
+
+/*!
+ * \brief Forgets the radio configuration applied so far
+ *
+ * \remark Must be called whenever the radio loses its configuration
+ */
+static void SX126xInvalidateAppliedConfig( void );
+
+/*!
+ * \brief Checks if the given parameters differ from the applied ones and
+ *        stores them
+ *
+ * \param [IN/OUT] applied     Parameters applied to the radio
+ * \param [IN/OUT] appliedSize Size of the parameters applied to the radio
+ * \param [IN]     buffer      New parameters
+ * \param [IN]     size        Size of the new parameters
+ *
+ * \retval changed  true if the parameters have to be sent to the radio
+ */
+static bool SX126xUpdateAppliedParams( uint8_t *applied, uint8_t *appliedSize, uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Gets the Image calibration frequency band for the given frequency
+ *
+ * \param [IN]  freq    RF frequency
+ * \param [OUT] calFreq Image calibration frequency band
+ */
+static void SX126xGetCalibrationFreq( uint32_t freq, uint8_t *calFreq );
+
 /*
  * SX126x DIO IRQ callback functions prototype
  */
@@ -89,6 +240,7 @@ void SX126xProcessIrqs( void );
 void SX126xInit( DioIrqHandler dioIrq )
 {
     SX126xReset( );
+    SX126xInvalidateAppliedConfig( );
 
     SX126xIoIrqInit( dioIrq );
 
@@ -100,6 +252,10 @@ void SX126xInit( DioIrqHandler dioIrq )
 
     SX126xSetDio2AsRfSwitchCtrl( true );
     SX126xSetOperatingMode( MODE_STDBY_RC );
+
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+    SX126xCalibrateWakeupTime( );
+#endif
 }
 
 RadioOperatingModes_t SX126xGetOperatingMode( void )
@@ -109,6 +265,18 @@ RadioOperatingModes_t SX126xGetOperatingMode( void )
 
 void SX126xSetOperatingMode( RadioOperatingModes_t mode )
 {
+    TimerTime_t now = TimerGetCurrentTime( );
+
+    if( OperatingMode == MODE_TX )
+    {
+        SX126x.Stats.TxTime += now - StatsModeStartTime;
+        SX126x.Stats.TxCharge += ( now - StatsModeStartTime ) * TxCurrent;
+    }
+    else if( ( OperatingMode == MODE_RX ) || ( OperatingMode == MODE_CAD ) )
+    {
+        SX126x.Stats.RxTime += now - StatsModeStartTime;
+    }
+    StatsModeStartTime = now;
     OperatingMode = mode;
 #if defined( USE_RADIO_DEBUG )
     switch( mode )
@@ -130,10 +298,41 @@ void SX126xSetOperatingMode( RadioOperatingModes_t mode )
 #endif
 }
 
+void SX126xGetStats( RadioStats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    // Account for the time spent in the current operating mode
+    SX126xSetOperatingMode( OperatingMode );
+    *stats = SX126x.Stats;
+    CRITICAL_SECTION_END( );
+}
+
+void SX126xResetStats( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    memset1( ( uint8_t* )&SX126x.Stats, 0, sizeof( RadioStats_t ) );
+    StatsModeStartTime = TimerGetCurrentTime( );
+    CRITICAL_SECTION_END( );
+}
+
 void SX126xCheckDeviceReady( void )
 {
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+    // Queued commands must reach the radio first
+    SX126xFlushCommandQueue( );
+#endif
     if( ( SX126xGetOperatingMode( ) == MODE_SLEEP ) || ( SX126xGetOperatingMode( ) == MODE_RX_DC ) )
     {
+        if( SX126xGetOperatingMode( ) == MODE_SLEEP )
+        {
+            // The sleep mode entry is only waited for when the radio is needed again
+            TimerTime_t elapsed = TimerGetElapsedTime( SleepStartTime );
+
+            if( elapsed < SX126X_SLEEP_SETTLE_TIME )
+            {
+                DelayMs( SX126X_SLEEP_SETTLE_TIME - elapsed );
+            }
+        }
         SX126xWakeup( );
         // Switch is turned off when device is in sleep mode and turned on is all other modes
         SX126xAntSwOn( );
@@ -141,6 +340,105 @@ void SX126xCheckDeviceReady( void )
     SX126xWaitOnBusy( );
 }
 
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+static void SX126xSendNextQueuedCommand( void )
+{
+    SX126xQueuedCommand_t *cmd;
+
+    // A transaction is on-going when NSS is low
+    if( ( CommandQueueCount == 0 ) || ( GpioRead( &SX126x.BUSY ) == 1 ) || ( GpioRead( &SX126x.Spi.Nss ) == 0 ) )
+    {
+        return;
+    }
+    cmd = &CommandQueue[CommandQueueHead];
+
+    GpioWrite( &SX126x.Spi.Nss, 0 );
+    SX126x.Stats.SpiCnt++;
+
+    SpiInOut( &SX126x.Spi, ( uint8_t )cmd->Opcode );
+    SpiTransfer( &SX126x.Spi, cmd->Buffer, NULL, cmd->Size );
+
+    GpioWrite( &SX126x.Spi.Nss, 1 );
+
+    CommandQueueHead = ( CommandQueueHead + 1 ) % SX126X_CMD_QUEUE_SIZE;
+    CommandQueueCount--;
+}
+
+void SX126xQueueCommand( RadioCommands_t command, uint8_t *buffer, uint16_t size )
+{
+    if( ( size > SX126X_CMD_QUEUE_MAX_PARAMS ) ||
+        ( SX126xGetOperatingMode( ) == MODE_SLEEP ) || ( SX126xGetOperatingMode( ) == MODE_RX_DC ) )
+    {
+        // The radio has to be woken up or the command doesn't fit. Fall back to the blocking path.
+        SX126xWriteCommand( command, buffer, size );
+        return;
+    }
+
+    while( CommandQueueCount >= SX126X_CMD_QUEUE_SIZE )
+    {
+        // Queue full. Wait for the radio to consume a command.
+        SX126xWaitOnBusy( );
+        CRITICAL_SECTION_BEGIN( );
+        SX126xSendNextQueuedCommand( );
+        CRITICAL_SECTION_END( );
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+
+    CommandQueue[CommandQueueTail].Opcode = command;
+    CommandQueue[CommandQueueTail].Size = ( uint8_t )size;
+    memcpy1( CommandQueue[CommandQueueTail].Buffer, buffer, size );
+    CommandQueueTail = ( CommandQueueTail + 1 ) % SX126X_CMD_QUEUE_SIZE;
+    CommandQueueCount++;
+
+    // Send it right away when the radio is idle. Otherwise the BUSY line release triggers it.
+    SX126xSendNextQueuedCommand( );
+
+    CRITICAL_SECTION_END( );
+}
+
+void SX126xFlushCommandQueue( void )
+{
+    while( CommandQueueCount != 0 )
+    {
+        SX126xWaitOnBusy( );
+        CRITICAL_SECTION_BEGIN( );
+        SX126xSendNextQueuedCommand( );
+        CRITICAL_SECTION_END( );
+    }
+}
+
+void SX126xOnBusyIrq( void* context )
+{
+    SX126xSendNextQueuedCommand( );
+}
+#endif
+
+static void SX126xWriteCommandNoWait( RadioCommands_t command, uint8_t *buffer, uint16_t size )
+{
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+    SX126xQueueCommand( command, buffer, size );
+#else
+    SX126xWriteCommand( command, buffer, size );
+#endif
+}
+
+bool SX126xIsCommandPending( void )
+{
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+    if( CommandQueueCount != 0 )
+    {
+        return true;
+    }
+#endif
+    if( ( SX126xGetOperatingMode( ) == MODE_SLEEP ) || ( SX126xGetOperatingMode( ) == MODE_RX_DC ) )
+    {
+        // BUSY stays high while the radio sleeps
+        return false;
+    }
+    return ( GpioRead( &SX126x.BUSY ) == 1 );
+}
+
 void SX126xSetPayload( uint8_t *payload, uint8_t size )
 {
     SX126xWriteBuffer( 0x00, payload, size );
@@ -250,11 +548,20 @@ void SX126xSetSleep( SleepParams_t sleepConfig )
                       ( ( uint8_t )sleepConfig.Fields.WakeUpRTC ) );
     SX126xWriteCommand( RADIO_SET_SLEEP, &value, 1 );
     SX126xSetOperatingMode( MODE_SLEEP );
+    SleepStartTime = TimerGetCurrentTime( );
+    // The RX gain register is not retained
+    RxBoostedApplied = false;
+
+    if( sleepConfig.Fields.WarmStart == 0 )
+    {
+        // The radio configuration is lost on cold start
+        SX126xInvalidateAppliedConfig( );
+    }
 }
 
 void SX126xSetStandby( RadioStandbyModes_t standbyConfig )
 {
-    SX126xWriteCommand( RADIO_SET_STANDBY, ( uint8_t* )&standbyConfig, 1 );
+    SX126xWriteCommandNoWait( RADIO_SET_STANDBY, ( uint8_t* )&standbyConfig, 1 );
     if( standbyConfig == STDBY_RC )
     {
         SX126xSetOperatingMode( MODE_STDBY_RC );
@@ -289,6 +596,13 @@ void SX126xSetRx( uint32_t timeout )
 
     SX126xSetOperatingMode( MODE_RX );
 
+    if( RxBoostedApplied == true )
+    {
+        // The register keeps the boosted gain until the next sleep
+        SX126xWriteRegister( REG_RX_GAIN, 0x94 ); // power saving gain
+        RxBoostedApplied = false;
+    }
+
     buf[0] = ( uint8_t )( ( timeout >> 16 ) & 0xFF );
     buf[1] = ( uint8_t )( ( timeout >> 8 ) & 0xFF );
     buf[2] = ( uint8_t )( timeout & 0xFF );
@@ -302,6 +616,7 @@ void SX126xSetRxBoosted( uint32_t timeout )
     SX126xSetOperatingMode( MODE_RX );
 
     SX126xWriteRegister( REG_RX_GAIN, 0x96 ); // max LNA gain, increase current by ~2mA for around ~3dB in sensivity
+    RxBoostedApplied = true;
 
     buf[0] = ( uint8_t )( ( timeout >> 16 ) & 0xFF );
     buf[1] = ( uint8_t )( ( timeout >> 8 ) & 0xFF );
@@ -341,17 +656,22 @@ void SX126xSetTxInfinitePreamble( void )
 
 void SX126xSetStopRxTimerOnPreambleDetect( bool enable )
 {
-    SX126xWriteCommand( RADIO_SET_STOPRXTIMERONPREAMBLE, ( uint8_t* )&enable, 1 );
+    SX126xWriteCommandNoWait( RADIO_SET_STOPRXTIMERONPREAMBLE, ( uint8_t* )&enable, 1 );
 }
 
 void SX126xSetLoRaSymbNumTimeout( uint8_t SymbNum )
 {
-    SX126xWriteCommand( RADIO_SET_LORASYMBTIMEOUT, &SymbNum, 1 );
+    SX126xWriteCommandNoWait( RADIO_SET_LORASYMBTIMEOUT, &SymbNum, 1 );
 }
 
 void SX126xSetRegulatorMode( RadioRegulatorMode_t mode )
 {
-    SX126xWriteCommand( RADIO_SET_REGULATORMODE, ( uint8_t* )&mode, 1 );
+    uint8_t value = ( uint8_t )mode;
+
+    if( SX126xUpdateAppliedParams( RegulatorModeApplied, &RegulatorModeAppliedSize, &value, 1 ) == true )
+    {
+        SX126xWriteCommand( RADIO_SET_REGULATORMODE, &value, 1 );
+    }
 }
 
 void SX126xCalibrate( CalibrationParams_t calibParam )
@@ -367,10 +687,33 @@ void SX126xCalibrate( CalibrationParams_t calibParam )
     SX126xWriteCommand( RADIO_CALIBRATE, &value, 1 );
 }
 
-void SX126xCalibrateImage( uint32_t freq )
+static void SX126xInvalidateAppliedConfig( void )
 {
-    uint8_t calFreq[2];
+    ImageCalibrated = false;
+    PacketTypeApplied = false;
+    ModulationParamsAppliedSize = 0;
+    PacketParamsAppliedSize = 0;
+    RfFrequencyAppliedValid = false;
+    DioIrqParamsAppliedSize = 0;
+    PaConfigAppliedSize = 0;
+    TxParamsAppliedSize = 0;
+    BufferBaseAddressAppliedSize = 0;
+    RegulatorModeAppliedSize = 0;
+}
 
+static bool SX126xUpdateAppliedParams( uint8_t *applied, uint8_t *appliedSize, uint8_t *buffer, uint8_t size )
+{
+    if( ( *appliedSize == size ) && ( memcmp( applied, buffer, size ) == 0 ) )
+    {
+        return false;
+    }
+    memcpy1( applied, buffer, size );
+    *appliedSize = size;
+    return true;
+}
+
+static void SX126xGetCalibrationFreq( uint32_t freq, uint8_t *calFreq )
+{
     if( freq > 900000000 )
     {
         calFreq[0] = 0xE1;
@@ -391,12 +734,129 @@ void SX126xCalibrateImage( uint32_t freq )
         calFreq[0] = 0x75;
         calFreq[1] = 0x81;
     }
-    else if( freq > 425000000 )
+    else
     {
         calFreq[0] = 0x6B;
         calFreq[1] = 0x6F;
     }
-    SX126xWriteCommand( RADIO_CALIBRATEIMAGE, calFreq, 2 );
+}
+
+void SX126xCalibrateImage( uint32_t freq )
+{
+    uint8_t calFreq[2];
+
+    SX126xGetCalibrationFreq( freq, calFreq );
+    SX126xWriteCommandNoWait( RADIO_CALIBRATEIMAGE, calFreq, 2 );
+
+    ImageCalibratedFreq[0] = calFreq[0];
+    ImageCalibratedFreq[1] = calFreq[1];
+    ImageCalibratedTemperature = Temperature;
+    ImageCalibrated = true;
+}
+
+void SX126xSetTemperature( int8_t temperature )
+{
+    int16_t drift = ( int16_t )temperature - ImageCalibratedTemperature;
+
+    Temperature = temperature;
+    if( ( drift > SX126X_IMAGE_CALIBRATION_TEMPERATURE_DRIFT ) || ( drift < -SX126X_IMAGE_CALIBRATION_TEMPERATURE_DRIFT ) )
+    {
+        // Calibrated again upon the next RF frequency setting
+        ImageCalibrated = false;
+    }
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+    drift = ( int16_t )temperature - WakeupCalibratedTemperature;
+    if( ( drift > SX126X_WAKEUP_CALIBRATION_TEMPERATURE_DRIFT ) || ( drift < -SX126X_WAKEUP_CALIBRATION_TEMPERATURE_DRIFT ) )
+    {
+        WakeupCalibrated = false;
+    }
+#endif
+}
+
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+/*!
+ * \brief Checks if the TCXO starts within the given timeout
+ *
+ * \param [in]  timeout       TCXO timeout [15.625 us]
+ *
+ * \retval      started       True when the oscillator started in time
+ */
+static bool SX126xTcxoStartsWithin( uint32_t timeout )
+{
+    SX126xSetStandby( STDBY_RC );
+    // The TCXO supply is off in STDBY_RC mode. It is given the board startup
+    // time to discharge, every trial is then a cold start.
+    DelayMs( SX126xGetBoardTcxoWakeupTime( ) );
+
+    SX126xSetDio3AsTcxoCtrl( TcxoVoltage, timeout );
+    SX126xClearDeviceErrors( );
+    SX126xSetStandby( STDBY_XOSC );
+    return SX126xGetDeviceErrors( ).Fields.XoscStart == 0;
+}
+#endif
+
+void SX126xCalibrateWakeupTime( void )
+{
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+    SleepParams_t params = { 0 };
+    uint32_t startTicks;
+
+    if( TcxoEnabled == true )
+    {
+        // The board timeout is known to be long enough
+        uint32_t low = 0;
+        uint32_t high = SX126xGetBoardTcxoWakeupTime( ) << 6;
+        CalibrationParams_t calibParam;
+
+        while( ( high - low ) > 1 )
+        {
+            uint32_t timeout = ( low + high ) / 2;
+
+            if( SX126xTcxoStartsWithin( timeout ) == true )
+            {
+                high = timeout;
+            }
+            else
+            {
+                low = timeout;
+            }
+        }
+        high = MIN( high + ( high * SX126X_TCXO_STARTUP_MARGIN ) / 100, SX126xGetBoardTcxoWakeupTime( ) << 6 );
+
+        SX126xSetStandby( STDBY_RC );
+        SX126xSetDio3AsTcxoCtrl( TcxoVoltage, high );
+        // The calibrations done with a failed oscillator start are not valid
+        SX126xClearDeviceErrors( );
+        calibParam.Value = 0x7F;
+        SX126xCalibrate( calibParam );
+    }
+
+    params.Fields.WarmStart = 1;
+    SX126xSetSleep( params );
+    DelayMs( SX126X_SLEEP_SETTLE_TIME );
+
+    startTicks = TimerGetCurrentTicks( );
+    SX126xSetStandby( STDBY_XOSC );
+    SX126xWaitOnBusy( );
+    WakeupTime = TimerTicks2Us( TimerGetCurrentTicks( ) - startTicks ) + SX126X_WAKEUP_SETUP_TIME;
+    WakeupTime = MIN( WakeupTime, ( SX126xGetBoardTcxoWakeupTime( ) + RADIO_WAKEUP_TIME ) * 1000 );
+
+    SX126xSetStandby( STDBY_RC );
+
+    WakeupCalibratedTemperature = Temperature;
+    WakeupCalibrated = true;
+#endif
+}
+
+uint32_t SX126xGetWakeupTime( void )
+{
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+    if( WakeupTime != 0 )
+    {
+        return ( WakeupTime + 999 ) / 1000;
+    }
+#endif
+    return SX126xGetBoardTcxoWakeupTime( ) + RADIO_WAKEUP_TIME;
 }
 
 void SX126xSetPaConfig( uint8_t paDutyCycle, uint8_t hpMax, uint8_t deviceSel, uint8_t paLut )
@@ -407,7 +867,10 @@ void SX126xSetPaConfig( uint8_t paDutyCycle, uint8_t hpMax, uint8_t deviceSel, u
     buf[1] = hpMax;
     buf[2] = deviceSel;
     buf[3] = paLut;
-    SX126xWriteCommand( RADIO_SET_PACONFIG, buf, 4 );
+    if( SX126xUpdateAppliedParams( PaConfigApplied, &PaConfigAppliedSize, buf, 4 ) == true )
+    {
+        SX126xWriteCommandNoWait( RADIO_SET_PACONFIG, buf, 4 );
+    }
 }
 
 void SX126xSetRxTxFallbackMode( uint8_t fallbackMode )
@@ -427,7 +890,10 @@ void SX126xSetDioIrqParams( uint16_t irqMask, uint16_t dio1Mask, uint16_t dio2Ma
     buf[5] = ( uint8_t )( dio2Mask & 0x00FF );
     buf[6] = ( uint8_t )( ( dio3Mask >> 8 ) & 0x00FF );
     buf[7] = ( uint8_t )( dio3Mask & 0x00FF );
-    SX126xWriteCommand( RADIO_CFG_DIOIRQ, buf, 8 );
+    if( SX126xUpdateAppliedParams( DioIrqParamsApplied, &DioIrqParamsAppliedSize, buf, 8 ) == true )
+    {
+        SX126xWriteCommandNoWait( RADIO_CFG_DIOIRQ, buf, 8 );
+    }
 }
 
 uint16_t SX126xGetIrqStatus( void )
@@ -453,32 +919,63 @@ void SX126xSetDio3AsTcxoCtrl( RadioTcxoCtrlVoltage_t tcxoVoltage, uint32_t timeo
     buf[3] = ( uint8_t )( timeout & 0xFF );
 
     SX126xWriteCommand( RADIO_SET_TCXOMODE, buf, 4 );
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+    TcxoVoltage = tcxoVoltage;
+    TcxoEnabled = true;
+#endif
 }
 
 void SX126xSetRfFrequency( uint32_t frequency )
 {
     uint8_t buf[4];
+    uint8_t calFreq[2];
     uint32_t freq = 0;
 
-    if( ImageCalibrated == false )
+#if defined( SX126X_WAKEUP_CALIBRATION_ENABLED )
+    if( WakeupCalibrated == false )
+    {
+        SX126xCalibrateWakeupTime( );
+    }
+#endif
+    // Only calibrate again when the frequency band changes
+    SX126xGetCalibrationFreq( frequency, calFreq );
+    if( ( ImageCalibrated == false ) ||
+        ( ImageCalibratedFreq[0] != calFreq[0] ) || ( ImageCalibratedFreq[1] != calFreq[1] ) )
     {
         SX126xCalibrateImage( frequency );
-        ImageCalibrated = true;
     }
 
     freq = ( uint32_t )( ( double )frequency / ( double )FREQ_STEP );
+    if( ( RfFrequencyAppliedValid == true ) && ( RfFrequencyApplied == freq ) )
+    {
+        return;
+    }
+    RfFrequencyApplied = freq;
+    RfFrequencyAppliedValid = true;
+
     buf[0] = ( uint8_t )( ( freq >> 24 ) & 0xFF );
     buf[1] = ( uint8_t )( ( freq >> 16 ) & 0xFF );
     buf[2] = ( uint8_t )( ( freq >> 8 ) & 0xFF );
     buf[3] = ( uint8_t )( freq & 0xFF );
-    SX126xWriteCommand( RADIO_SET_RFFREQUENCY, buf, 4 );
+    SX126xWriteCommandNoWait( RADIO_SET_RFFREQUENCY, buf, 4 );
 }
 
 void SX126xSetPacketType( RadioPacketTypes_t packetType )
 {
+    if( ( PacketTypeApplied == true ) && ( PacketType == packetType ) )
+    {
+        return;
+    }
+    if( PacketType != packetType )
+    {
+        // Modulation and packet parameters have to be set again for the new packet type
+        ModulationParamsAppliedSize = 0;
+        PacketParamsAppliedSize = 0;
+    }
     // Save packet type internally to avoid questioning the radio
     PacketType = packetType;
-    SX126xWriteCommand( RADIO_SET_PACKETTYPE, ( uint8_t* )&packetType, 1 );
+    PacketTypeApplied = true;
+    SX126xWriteCommandNoWait( RADIO_SET_PACKETTYPE, ( uint8_t* )&packetType, 1 );
 }
 
 RadioPacketTypes_t SX126xGetPacketType( void )
@@ -489,25 +986,29 @@ RadioPacketTypes_t SX126xGetPacketType( void )
 void SX126xSetTxParams( int8_t power, RadioRampTimes_t rampTime )
 {
     uint8_t buf[2];
-
-    if( SX126xGetDeviceId( ) == SX1261 )
+    uint8_t deviceId = SX126xGetDeviceId( );
+    uint8_t nbSettings = 0;
+    const SX126xPaSetting_t *settings = SX126xGetBoardPaSettings( deviceId, &nbSettings );
+    const SX126xPaSetting_t *setting = &settings[nbSettings - 1];
+    int16_t txPower;
+
+    // The PA draws less current at the lowest duty cycle and hpMax reaching
+    // the requested power
+    for( uint8_t i = 0; i < nbSettings; i++ )
     {
-        if( power == 15 )
+        if( settings[i].Power >= power )
         {
-            SX126xSetPaConfig( 0x06, 0x00, 0x01, 0x01 );
-        }
-        else
-        {
-            SX126xSetPaConfig( 0x04, 0x00, 0x01, 0x01 );
-        }
-        if( power >= 14 )
-        {
-            power = 14;
-        }
-        else if( power < -17 )
-        {
-            power = -17;
+            setting = &settings[i];
+            break;
         }
+    }
+    txPower = setting->TxPower - MAX( setting->Power - power, 0 );
+
+    if( deviceId == SX1261 )
+    {
+        SX126xSetPaConfig( setting->PaDutyCycle, setting->HpMax, 0x01, 0x01 );
+        txPower = MAX( txPower, -17 );
+        txPower = MIN( txPower, 14 );
         SX126xWriteRegister( REG_OCP, 0x18 ); // current max is 80 mA for the whole device
     }
     else // sx1262
@@ -517,20 +1018,19 @@ void SX126xSetTxParams( int8_t power, RadioRampTimes_t rampTime )
         SX126xWriteRegister( 0x08D8, SX126xReadRegister( 0x08D8 ) | ( 0x0F << 1 ) );
         // WORKAROUND END
 
-        SX126xSetPaConfig( 0x04, 0x07, 0x00, 0x01 );
-        if( power > 22 )
-        {
-            power = 22;
-        }
-        else if( power < -9 )
-        {
-            power = -9;
-        }
+        SX126xSetPaConfig( setting->PaDutyCycle, setting->HpMax, 0x00, 0x01 );
+        txPower = MAX( txPower, -9 );
+        txPower = MIN( txPower, 22 );
         SX126xWriteRegister( REG_OCP, 0x38 ); // current max 160mA for the whole device
     }
-    buf[0] = power;
+    TxCurrent = setting->Current;
+
+    buf[0] = ( uint8_t )txPower;
     buf[1] = ( uint8_t )rampTime;
-    SX126xWriteCommand( RADIO_SET_TXPARAMS, buf, 2 );
+    if( SX126xUpdateAppliedParams( TxParamsApplied, &TxParamsAppliedSize, buf, 2 ) == true )
+    {
+        SX126xWriteCommandNoWait( RADIO_SET_TXPARAMS, buf, 2 );
+    }
 }
 
 void SX126xSetModulationParams( ModulationParams_t *modulationParams )
@@ -560,7 +1060,6 @@ void SX126xSetModulationParams( ModulationParams_t *modulationParams )
         buf[5] = ( tempVal >> 16 ) & 0xFF;
         buf[6] = ( tempVal >> 8 ) & 0xFF;
         buf[7] = ( tempVal& 0xFF );
-        SX126xWriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
         break;
     case PACKET_TYPE_LORA:
         n = 4;
@@ -568,14 +1067,15 @@ void SX126xSetModulationParams( ModulationParams_t *modulationParams )
         buf[1] = modulationParams->Params.LoRa.Bandwidth;
         buf[2] = modulationParams->Params.LoRa.CodingRate;
         buf[3] = modulationParams->Params.LoRa.LowDatarateOptimize;
-
-        SX126xWriteCommand( RADIO_SET_MODULATIONPARAMS, buf, n );
-
         break;
     default:
     case PACKET_TYPE_NONE:
         return;
     }
+    if( SX126xUpdateAppliedParams( ModulationParamsApplied, &ModulationParamsAppliedSize, buf, n ) == true )
+    {
+        SX126xWriteCommandNoWait( RADIO_SET_MODULATIONPARAMS, buf, n );
+    }
 }
 
 void SX126xSetPacketParams( PacketParams_t *packetParams )
@@ -634,7 +1134,10 @@ void SX126xSetPacketParams( PacketParams_t *packetParams )
     case PACKET_TYPE_NONE:
         return;
     }
-    SX126xWriteCommand( RADIO_SET_PACKETPARAMS, buf, n );
+    if( SX126xUpdateAppliedParams( PacketParamsApplied, &PacketParamsAppliedSize, buf, n ) == true )
+    {
+        SX126xWriteCommandNoWait( RADIO_SET_PACKETPARAMS, buf, n );
+    }
 }
 
 void SX126xSetCadParams( RadioLoRaCadSymbols_t cadSymbolNum, uint8_t cadDetPeak, uint8_t cadDetMin, RadioCadExitModes_t cadExitMode, uint32_t cadTimeout )
@@ -648,7 +1151,7 @@ void SX126xSetCadParams( RadioLoRaCadSymbols_t cadSymbolNum, uint8_t cadDetPeak,
     buf[4] = ( uint8_t )( ( cadTimeout >> 16 ) & 0xFF );
     buf[5] = ( uint8_t )( ( cadTimeout >> 8 ) & 0xFF );
     buf[6] = ( uint8_t )( cadTimeout & 0xFF );
-    SX126xWriteCommand( RADIO_SET_CADPARAMS, buf, 7 );
+    SX126xWriteCommandNoWait( RADIO_SET_CADPARAMS, buf, 7 );
     SX126xSetOperatingMode( MODE_CAD );
 }
 
@@ -658,7 +1161,10 @@ void SX126xSetBufferBaseAddress( uint8_t txBaseAddress, uint8_t rxBaseAddress )
 
     buf[0] = txBaseAddress;
     buf[1] = rxBaseAddress;
-    SX126xWriteCommand( RADIO_SET_BUFFERBASEADDRESS, buf, 2 );
+    if( SX126xUpdateAppliedParams( BufferBaseAddressApplied, &BufferBaseAddressAppliedSize, buf, 2 ) == true )
+    {
+        SX126xWriteCommandNoWait( RADIO_SET_BUFFERBASEADDRESS, buf, 2 );
+    }
 }
 
 RadioStatus_t SX126xGetStatus( void )
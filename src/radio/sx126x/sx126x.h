@@ -90,6 +90,17 @@
  */
 #define REG_LR_PAYLOADLENGTH                        0x0702
 
+/*!
+ * \brief The address of the register holding the payload CRC presence of the
+ *        received LoRa header
+ */
+#define REG_LR_HEADER_CRC                           0x076B
+
+/*!
+ * \brief Mask of the payload CRC presence bit in REG_LR_HEADER_CRC
+ */
+#define REG_LR_HEADER_CRC_MASK                      0x10
+
 /*!
  * \brief The addresses of the registers holding SyncWords values
  */
@@ -650,6 +661,19 @@ typedef union
     uint16_t Value;
 }RadioError_t;
 
+/*!
+ * \brief Represents a PA configuration reaching an output power at its best
+ *        efficiency, see \ref SX126xGetBoardPaSettings
+ */
+typedef struct
+{
+    int8_t  Power;                                              //!< Output power [dBm]
+    uint8_t PaDutyCycle;                                        //!< SetPaConfig paDutyCycle
+    uint8_t HpMax;                                              //!< SetPaConfig hpMax
+    int8_t  TxPower;                                            //!< SetTxParams power giving the output power [dBm]
+    uint8_t Current;                                            //!< Device current while transmitting [mA]
+}SX126xPaSetting_t;
+
 /*!
  * Radio hardware and global parameters
  */
@@ -664,6 +688,7 @@ typedef struct SX126x_s
     PacketParams_t PacketParams;
     PacketStatus_t PacketStatus;
     ModulationParams_t ModulationParams;
+    RadioStats_t  Stats;
 }SX126x_t;
 
 /*!
@@ -686,6 +711,49 @@ typedef void ( DioIrqHandler )( void* context );
 
 #define RX_BUFFER_SIZE                              256
 
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+/*!
+ * \brief Maximum number of commands held by the command queue
+ */
+#ifndef SX126X_CMD_QUEUE_SIZE
+#define SX126X_CMD_QUEUE_SIZE                       8
+#endif
+
+/*!
+ * \brief Maximum number of parameters of a queued command
+ */
+#define SX126X_CMD_QUEUE_MAX_PARAMS                 16
+#endif
+
+/*!
+ * \brief Time the radio needs to enter the sleep mode before it can be woken
+ *        up again [ms]
+ */
+#define SX126X_SLEEP_SETTLE_TIME                    2
+
+/*!
+ * \brief Temperature drift from the last Image calibration above which the
+ *        Image calibration is done again [degrees Celsius]
+ */
+#define SX126X_IMAGE_CALIBRATION_TEMPERATURE_DRIFT  10
+
+/*!
+ * \brief Temperature drift from the last wake-up time calibration above which
+ *        the wake-up time is calibrated again [degrees Celsius]
+ */
+#define SX126X_WAKEUP_CALIBRATION_TEMPERATURE_DRIFT 10
+
+/*!
+ * \brief Time taken by the configuration commands and the PLL lock once the
+ *        oscillator is ready, added to the measured wake-up time [us]
+ */
+#define SX126X_WAKEUP_SETUP_TIME                    1000
+
+/*!
+ * \brief Margin added to the measured TCXO startup time [%]
+ */
+#define SX126X_TCXO_STARTUP_MARGIN                  25
+
 /*!
  * \brief The radio callbacks structure
  * Holds function pointers to be called on radio interrupts
@@ -731,11 +799,63 @@ RadioOperatingModes_t SX126xGetOperatingMode( void );
  */
 void SX126xSetOperatingMode( RadioOperatingModes_t mode );
 
+/*!
+ * \brief Gets the radio activity statistics
+ *
+ * \param [OUT] stats Statistics accumulated since the last SX126xResetStats
+ */
+void SX126xGetStats( RadioStats_t* stats );
+
+/*!
+ * \brief Clears the radio activity statistics
+ */
+void SX126xResetStats( void );
+
 /*!
  * \brief Wakeup the radio if it is in Sleep mode and check that Busy is low
  */
 void SX126xCheckDeviceReady( void );
 
+#if defined( SX126X_BUSY_IRQ_ENABLED )
+/*!
+ * \brief Queues a command to be sent as soon as the radio is ready
+ *
+ * \remark The command is sent right away when the radio isn't busy. Otherwise
+ *         it is sent on the BUSY line release interrupt. The function only
+ *         blocks when the queue is full or when the radio must be woken up.
+ *
+ * \remark The blocking radio accessors flush the queue first. Commands must be
+ *         queued from the context using the other radio driver functions.
+ *
+ * \param [in]  command       Opcode of the command
+ * \param [in]  buffer        Buffer holding the command parameters
+ * \param [in]  size          Number of parameters
+ */
+void SX126xQueueCommand( RadioCommands_t command, uint8_t *buffer, uint16_t size );
+
+/*!
+ * \brief Waits until all the queued commands have been sent to the radio
+ */
+void SX126xFlushCommandQueue( void );
+
+/*!
+ * \brief BUSY line falling edge interrupt handler
+ *
+ * \param [in]  context       Interrupt context (unused)
+ */
+void SX126xOnBusyIrq( void* context );
+#endif
+
+/*!
+ * \brief Checks if the radio is still processing the previous commands
+ *
+ * \remark With SX126X_BUSY_IRQ_ENABLED the configuration commands are queued
+ *         and the functions sending them return right away.
+ *
+ * \retval isPending true while commands are queued or the radio is busy
+ */
+bool SX126xIsCommandPending( void );
+
 /*!
  * \brief Saves the payload to be send in the radio buffer
  *
@@ -807,6 +927,9 @@ uint32_t SX126xGetRandom( void );
 /*!
  * \brief Sets the radio in sleep mode
  *
+ * \remark On warm start the radio retains its configuration and only the
+ *         commands changing it are sent again after the wake up
+ *
  * \param [in]  sleepConfig   The sleep configuration describing data
  *                            retention and RTC wake-up
  */
@@ -904,6 +1027,41 @@ void SX126xCalibrate( CalibrationParams_t calibParam );
  */
 void SX126xCalibrateImage( uint32_t freq );
 
+/*!
+ * \brief Measures the TCXO startup time and the radio wake-up time
+ *
+ * \remark Only active when SX126X_WAKEUP_CALIBRATION_ENABLED is defined. The
+ *         TCXO timeout is set to the shortest one without oscillator start
+ *         error, plus SX126X_TCXO_STARTUP_MARGIN. The wake-up time is the time
+ *         from the sleep mode to the STDBY_XOSC mode. The calibration is done
+ *         by SX126xInit and again upon the next RF frequency setting once the
+ *         temperature drifted by more than
+ *         SX126X_WAKEUP_CALIBRATION_TEMPERATURE_DRIFT.
+ *
+ *         The radio is left in STDBY_RC mode.
+ */
+void SX126xCalibrateWakeupTime( void );
+
+/*!
+ * \brief Gets the time from the sleep mode to a radio operation
+ *
+ * \retval time Calibrated wake-up time, the board TCXO wake-up time plus
+ *              RADIO_WAKEUP_TIME when not calibrated [ms]
+ */
+uint32_t SX126xGetWakeupTime( void );
+
+/*!
+ * \brief Updates the radio temperature used to decide when the Image
+ *        calibration has to be done again
+ *
+ * \remark The Image calibration is done again upon the next RF frequency
+ *         setting once the temperature drifted by more than
+ *         SX126X_IMAGE_CALIBRATION_TEMPERATURE_DRIFT.
+ *
+ * \param [in]  temperature   Radio temperature [degrees Celsius]
+ */
+void SX126xSetTemperature( int8_t temperature );
+
 /*!
  * \brief Activate the extention of the timeout when long preamble is used
  *
@@ -1023,7 +1181,11 @@ RadioPacketTypes_t SX126xGetPacketType( void );
 /*!
  * \brief Sets the transmission parameters
  *
- * \param [in]  power         RF output power [-18..13] dBm
+ * \remark The PA is configured with the board setting of the lowest output
+ *         power reaching the requested one, see \ref SX126xGetBoardPaSettings.
+ *         The output power is then reduced by the power register.
+ *
+ * \param [in]  power         RF output power [dBm]
  * \param [in]  rampTime      Transmission ramp up time
  */
 void SX126xSetTxParams( int8_t power, RadioRampTimes_t rampTime );
@@ -1113,4 +1275,9 @@ void SX126xClearDeviceErrors( void );
  */
 void SX126xClearIrqStatus( uint16_t irq );
 
+/*!
+ * Radio driver table. Refer to \ref RadioSelect.
+ */
+extern const struct Radio_s SX126xRadio;
+
 #endif // __SX126x_H__
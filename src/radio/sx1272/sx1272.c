@@ -24,6 +24,7 @@
 #include <string.h>
 #include "utilities.h"
 #include "timer.h"
+#include "trace.h"
 #include "radio.h"
 #include "delay.h"
 #include "sx1272.h"
@@ -52,11 +53,104 @@ typedef struct
     uint8_t  RegValue;
 }FskBandwidth_t;
 
+/*!
+ * Run of contiguous registers
+ */
+typedef struct
+{
+    uint8_t Addr;
+    uint8_t Size;
+}RegRun_t;
+
+/*!
+ * FSK FIFO non-blocking transfers state
+ */
+typedef struct
+{
+    /*!
+     * Set while a FIFO transfer carried by the SPI DMA is in progress
+     */
+    volatile bool Busy;
+    /*!
+     * Stream sink of the received payload, NULL when the payload goes to the
+     * reception buffer
+     */
+    SX1272FskStreamSink_t *Sink;
+    /*!
+     * Double buffer of the streamed payload chunks. The DMA fills one of them
+     * while the other one is handed to the sink.
+     */
+    uint8_t Chunk[2][FSK_FIFO_SIZE];
+    /*!
+     * Index of the chunk being filled
+     */
+    uint8_t Index;
+    /*!
+     * Payload offset and size of the chunk being filled, size is 0 when none
+     */
+    uint16_t PendingOffset;
+    uint8_t PendingSize;
+}FskFifoTransfer_t;
 
 /*
  * Private functions prototypes
  */
 
+/*!
+ * \brief Invalidates the whole register shadow
+ */
+static void SX1272RegShadowInvalidate( void );
+
+/*!
+ * \brief Updates the register shadow after a registers burst access
+ *
+ * \param [IN] addr   First Radio register address
+ * \param [IN] buffer Buffer containing the registers values
+ * \param [IN] size   Number of registers
+ */
+static void SX1272RegShadowUpdate( uint16_t addr, uint8_t *buffer, uint8_t size );
+
+/*!
+ * \brief Checks if the register shadow holds the given register value
+ *
+ * \param [IN] addr  Register address
+ * \param [IN] value Register value
+ *
+ * \retval holds true if the register doesn't need to be written
+ */
+static bool SX1272RegShadowHolds( uint16_t addr, uint8_t value );
+
+/*!
+ * \brief Compiles the part of the LoRa profiles common to reception and
+ *        transmission
+ */
+static void SX1272CompileLoRaProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                      uint32_t datarate, uint8_t coderate,
+                                      uint16_t preambleLen, bool fixLen, bool crcOn,
+                                      bool freqHopOn, uint8_t hopPeriod, bool iqInverted );
+
+/*!
+ * \brief Sets bits of a register of a LoRa profile
+ *
+ * \param [IN/OUT] profile LoRa profile
+ * \param [IN] addr        Register address
+ * \param [IN] value       Register bits value
+ * \param [IN] mask        Register bits to be set
+ */
+static void SX1272LoRaProfileSet( RadioLoRaProfile_t *profile, uint8_t addr, uint8_t value, uint8_t mask );
+
+/*!
+ * \brief Hops to the next channel of the frequency hopping sequence
+ */
+static void SX1272FhssHop( void );
+
+/*!
+ * \brief Changes the driver state and accumulates the time spent in the
+ *        previous one for the radio statistics
+ *
+ * \param [IN] state New driver state
+ */
+static void SX1272SetState( RadioState_t state );
 
 /*!
  * \brief Sets the SX1272 in transmission mode for the given time
@@ -80,6 +174,46 @@ void SX1272WriteFifo( uint8_t *buffer, uint8_t size );
  */
 void SX1272ReadFifo( uint8_t *buffer, uint8_t size );
 
+/*!
+ * \brief Starts a non-blocking FIFO transfer carried by the SPI DMA. The NSS
+ *        is released upon the transfer completion.
+ *
+ * \remark Waits for the previous FIFO transfer to complete first
+ *
+ * \param [IN]  addr     FIFO address, bit 7 set for a write access
+ * \param [IN]  txBuffer Bytes to be written, NULL for a read access
+ * \param [OUT] rxBuffer Bytes read, NULL for a write access
+ * \param [IN]  size     Number of bytes
+ */
+static void SX1272FifoTransferStart( uint8_t addr, const uint8_t *txBuffer, uint8_t *rxBuffer, uint8_t size );
+
+/*!
+ * \brief Waits for the non-blocking FIFO transfer in progress to complete
+ */
+static void SX1272FifoTransferWait( void );
+
+/*!
+ * \brief SPI transfer completion callback of the non-blocking FIFO transfers
+ */
+static void SX1272OnFifoTransferDone( void* context );
+
+/*!
+ * \brief Reads the payload size of the FSK packet being received
+ */
+static void SX1272FskReadPayloadSize( void );
+
+/*!
+ * \brief Reads a chunk of the FSK packet being received off the FIFO
+ *
+ * \remark The chunks read upon the FifoLevel interrupt are transferred by the
+ *         DMA while the interrupt returns. The last chunk is read upon the
+ *         PayloadReady interrupt and completes the packet.
+ *
+ * \param [IN] size Chunk size
+ * \param [IN] last Set for the last chunk of the packet
+ */
+static void SX1272FskReadChunk( uint16_t size, bool last );
+
 /*!
  * \brief Sets the SX1272 operating mode
  *
@@ -171,6 +305,21 @@ const FskBandwidth_t FskBandwidths[] =
     { 300000, 0x00 }, // Invalid Bandwidth
 };
 
+/*!
+ * Contiguous register runs held by the LoRa profiles
+ */
+const RegRun_t LoRaProfileRuns[] =
+{
+    { REG_LR_MODEMCONFIG1, 6 },     // ModemConfig1 to PayloadLength
+    { REG_LR_DETECTOPTIMIZE, 1 },
+    { REG_LR_DETECTIONTHRESHOLD, 1 },
+};
+
+/*!
+ * Size of the longest LoRa profile run
+ */
+#define LORA_PROFILE_MAX_RUN_SIZE                   6
+
 /*
  * Private global variables
  */
@@ -185,6 +334,40 @@ static RadioEvents_t *RadioEvents;
  */
 static uint8_t RxTxBuffer[RX_BUFFER_SIZE];
 
+/*!
+ * FSK FIFO non-blocking transfers state
+ */
+static FskFifoTransfer_t FskFifo;
+
+/*!
+ * Write-through shadow of the radio registers and its valid bits
+ *
+ * \remark Registers updated by the radio itself (status, IRQ flags, FIFO
+ *         pointers, self clearing triggers, operating mode) bypass the shadow.
+ */
+static uint8_t RegShadow[REG_SHADOW_SIZE];
+static uint8_t RegShadowValid[REG_SHADOW_SIZE / 8];
+
+/*!
+ * Start time of the current driver state, used by the radio statistics
+ */
+static TimerTime_t StatsStateStartTime = 0;
+
+/*!
+ * Timer ticks captured at the last DIO0 interrupt edge
+ */
+static uint32_t Dio0IrqTicks = 0;
+
+/*!
+ * Frequency hopping sequence, PLL steps of the channels in hopping order
+ */
+static struct
+{
+    uint8_t Frf[FHSS_MAX_NB_CHANNELS][3];
+    uint8_t NbChannels;
+    uint8_t Index;
+}FhssHopTable;
+
 /*
  * Public global variables
  */
@@ -224,6 +407,9 @@ void SX1272Init( RadioEvents_t *events )
     TimerInit( &RxTimeoutSyncWord, SX1272OnTimeoutIrq );
 
     SX1272Reset( );
+    SX1272RegShadowInvalidate( );
+    // The radio is in FSK mode after a reset
+    SX1272.Settings.Modem = MODEM_FSK;
 
     SX1272SetOpMode( RF_OPMODE_SLEEP );
 
@@ -237,7 +423,7 @@ void SX1272Init( RadioEvents_t *events )
 
     SX1272SetModem( MODEM_FSK );
 
-    SX1272.Settings.State = RF_IDLE;
+    SX1272SetState( RF_IDLE );
 }
 
 RadioState_t SX1272GetStatus( void )
@@ -397,94 +583,17 @@ void SX1272SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
                            RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
                            ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
                            ( crcOn << 4 ) );
-            SX1272Write( REG_PACKETCONFIG2, ( SX1272Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+            SX1272Write( REG_PACKETCONFIG2, ( ( SX1272Read( REG_PACKETCONFIG2 ) & RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) |
+                                              RF_PACKETCONFIG2_DATAMODE_PACKET ) );
         }
         break;
     case MODEM_LORA:
         {
-            SX1272.Settings.LoRa.Bandwidth = bandwidth;
-            SX1272.Settings.LoRa.Datarate = datarate;
-            SX1272.Settings.LoRa.Coderate = coderate;
-            SX1272.Settings.LoRa.PreambleLen = preambleLen;
-            SX1272.Settings.LoRa.FixLen = fixLen;
-            SX1272.Settings.LoRa.PayloadLen = payloadLen;
-            SX1272.Settings.LoRa.CrcOn = crcOn;
-            SX1272.Settings.LoRa.FreqHopOn = freqHopOn;
-            SX1272.Settings.LoRa.HopPeriod = hopPeriod;
-            SX1272.Settings.LoRa.IqInverted = iqInverted;
-            SX1272.Settings.LoRa.RxContinuous = rxContinuous;
-
-            if( datarate > 12 )
-            {
-                datarate = 12;
-            }
-            else if( datarate < 6 )
-            {
-                datarate = 6;
-            }
+            RadioLoRaProfile_t profile;
 
-            if( ( ( bandwidth == 0 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
-                ( ( bandwidth == 1 ) && ( datarate == 12 ) ) )
-            {
-                SX1272.Settings.LoRa.LowDatarateOptimize = 0x01;
-            }
-            else
-            {
-                SX1272.Settings.LoRa.LowDatarateOptimize = 0x00;
-            }
-
-            SX1272Write( REG_LR_MODEMCONFIG1,
-                         ( SX1272Read( REG_LR_MODEMCONFIG1 ) &
-                           RFLR_MODEMCONFIG1_BW_MASK &
-                           RFLR_MODEMCONFIG1_CODINGRATE_MASK &
-                           RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK &
-                           RFLR_MODEMCONFIG1_RXPAYLOADCRC_MASK &
-                           RFLR_MODEMCONFIG1_LOWDATARATEOPTIMIZE_MASK ) |
-                           ( bandwidth << 6 ) | ( coderate << 3 ) |
-                           ( fixLen << 2 ) | ( crcOn << 1 ) |
-                           SX1272.Settings.LoRa.LowDatarateOptimize );
-
-            SX1272Write( REG_LR_MODEMCONFIG2,
-                         ( SX1272Read( REG_LR_MODEMCONFIG2 ) &
-                           RFLR_MODEMCONFIG2_SF_MASK &
-                           RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) |
-                           ( datarate << 4 ) |
-                           ( ( symbTimeout >> 8 ) & ~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) );
-
-            SX1272Write( REG_LR_SYMBTIMEOUTLSB, ( uint8_t )( symbTimeout & 0xFF ) );
-
-            SX1272Write( REG_LR_PREAMBLEMSB, ( uint8_t )( ( preambleLen >> 8 ) & 0xFF ) );
-            SX1272Write( REG_LR_PREAMBLELSB, ( uint8_t )( preambleLen & 0xFF ) );
-
-            if( fixLen == 1 )
-            {
-                SX1272Write( REG_LR_PAYLOADLENGTH, payloadLen );
-            }
-
-            if( SX1272.Settings.LoRa.FreqHopOn == true )
-            {
-                SX1272Write( REG_LR_PLLHOP, ( SX1272Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
-                SX1272Write( REG_LR_HOPPERIOD, SX1272.Settings.LoRa.HopPeriod );
-            }
-
-            if( datarate == 6 )
-            {
-                SX1272Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1272Read( REG_LR_DETECTOPTIMIZE ) &
-                               RFLR_DETECTIONOPTIMIZE_MASK ) |
-                               RFLR_DETECTIONOPTIMIZE_SF6 );
-                SX1272Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF6 );
-            }
-            else
-            {
-                SX1272Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1272Read( REG_LR_DETECTOPTIMIZE ) &
-                             RFLR_DETECTIONOPTIMIZE_MASK ) |
-                             RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12 );
-                SX1272Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF7_TO_SF12 );
-            }
+            SX1272CompileLoRaRxProfile( &profile, bandwidth, datarate, coderate, preambleLen, symbTimeout, fixLen,
+                                        payloadLen, crcOn, freqHopOn, hopPeriod, iqInverted, rxContinuous );
+            SX1272ApplyLoRaProfile( &profile );
         }
         break;
     }
@@ -536,82 +645,245 @@ void SX1272SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
         break;
     case MODEM_LORA:
         {
+            RadioLoRaProfile_t profile;
+
             SX1272.Settings.LoRa.Power = power;
-            SX1272.Settings.LoRa.Bandwidth = bandwidth;
-            SX1272.Settings.LoRa.Datarate = datarate;
-            SX1272.Settings.LoRa.Coderate = coderate;
-            SX1272.Settings.LoRa.PreambleLen = preambleLen;
-            SX1272.Settings.LoRa.FixLen = fixLen;
-            SX1272.Settings.LoRa.FreqHopOn = freqHopOn;
-            SX1272.Settings.LoRa.HopPeriod = hopPeriod;
-            SX1272.Settings.LoRa.CrcOn = crcOn;
-            SX1272.Settings.LoRa.IqInverted = iqInverted;
-            SX1272.Settings.LoRa.TxTimeout = timeout;
-
-            if( datarate > 12 )
-            {
-                datarate = 12;
-            }
-            else if( datarate < 6 )
-            {
-                datarate = 6;
-            }
-            if( ( ( bandwidth == 0 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
-                ( ( bandwidth == 1 ) && ( datarate == 12 ) ) )
-            {
-                SX1272.Settings.LoRa.LowDatarateOptimize = 0x01;
-            }
-            else
-            {
-                SX1272.Settings.LoRa.LowDatarateOptimize = 0x00;
-            }
+            SX1272CompileLoRaTxProfile( &profile, bandwidth, datarate, coderate, preambleLen, fixLen, crcOn,
+                                        freqHopOn, hopPeriod, iqInverted, timeout );
+            SX1272ApplyLoRaProfile( &profile );
+        }
+        break;
+    }
+}
 
-            if( SX1272.Settings.LoRa.FreqHopOn == true )
-            {
-                SX1272Write( REG_LR_PLLHOP, ( SX1272Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
-                SX1272Write( REG_LR_HOPPERIOD, SX1272.Settings.LoRa.HopPeriod );
-            }
+static void SX1272LoRaProfileSet( RadioLoRaProfile_t *profile, uint8_t addr, uint8_t value, uint8_t mask )
+{
+    uint8_t index = 0;
 
-            SX1272Write( REG_LR_MODEMCONFIG1,
-                         ( SX1272Read( REG_LR_MODEMCONFIG1 ) &
-                           RFLR_MODEMCONFIG1_BW_MASK &
-                           RFLR_MODEMCONFIG1_CODINGRATE_MASK &
-                           RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK &
-                           RFLR_MODEMCONFIG1_RXPAYLOADCRC_MASK &
-                           RFLR_MODEMCONFIG1_LOWDATARATEOPTIMIZE_MASK ) |
-                           ( bandwidth << 6 ) | ( coderate << 3 ) |
-                           ( fixLen << 2 ) | ( crcOn << 1 ) |
-                           SX1272.Settings.LoRa.LowDatarateOptimize );
+    for( uint8_t i = 0; i < sizeof( LoRaProfileRuns ) / sizeof( RegRun_t ); i++ )
+    {
+        if( ( addr >= LoRaProfileRuns[i].Addr ) && ( addr < ( LoRaProfileRuns[i].Addr + LoRaProfileRuns[i].Size ) ) )
+        {
+            index += addr - LoRaProfileRuns[i].Addr;
+            profile->Value[index] = ( profile->Value[index] & ~mask ) | ( value & mask );
+            profile->Mask[index] |= mask;
+            return;
+        }
+        index += LoRaProfileRuns[i].Size;
+    }
+}
 
-            SX1272Write( REG_LR_MODEMCONFIG2,
-                        ( SX1272Read( REG_LR_MODEMCONFIG2 ) &
-                          RFLR_MODEMCONFIG2_SF_MASK ) |
-                          ( datarate << 4 ) );
+static void SX1272CompileLoRaProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                      uint32_t datarate, uint8_t coderate,
+                                      uint16_t preambleLen, bool fixLen, bool crcOn,
+                                      bool freqHopOn, uint8_t hopPeriod, bool iqInverted )
+{
+    RadioLoRaSettings_t *settings = &profile->Settings;
+
+    memset1( ( uint8_t* )profile, 0, sizeof( RadioLoRaProfile_t ) );
+    settings->Bandwidth = bandwidth;
+    settings->Datarate = datarate;
+    settings->Coderate = coderate;
+    settings->PreambleLen = preambleLen;
+    settings->FixLen = fixLen;
+    settings->CrcOn = crcOn;
+    settings->FreqHopOn = freqHopOn;
+    settings->HopPeriod = hopPeriod;
+    settings->IqInverted = iqInverted;
+
+    if( datarate > 12 )
+    {
+        datarate = 12;
+    }
+    else if( datarate < 6 )
+    {
+        datarate = 6;
+    }
 
+    if( ( ( bandwidth == 0 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
+        ( ( bandwidth == 1 ) && ( datarate == 12 ) ) )
+    {
+        settings->LowDatarateOptimize = 0x01;
+    }
+    else
+    {
+        settings->LowDatarateOptimize = 0x00;
+    }
 
-            SX1272Write( REG_LR_PREAMBLEMSB, ( preambleLen >> 8 ) & 0x00FF );
-            SX1272Write( REG_LR_PREAMBLELSB, preambleLen & 0xFF );
+    SX1272LoRaProfileSet( profile, REG_LR_MODEMCONFIG1,
+                          ( bandwidth << 6 ) | ( coderate << 3 ) | ( fixLen << 2 ) | ( crcOn << 1 ) |
+                          settings->LowDatarateOptimize,
+                          ~( RFLR_MODEMCONFIG1_BW_MASK & RFLR_MODEMCONFIG1_CODINGRATE_MASK &
+                             RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK & RFLR_MODEMCONFIG1_RXPAYLOADCRC_MASK &
+                             RFLR_MODEMCONFIG1_LOWDATARATEOPTIMIZE_MASK ) );
+    SX1272LoRaProfileSet( profile, REG_LR_MODEMCONFIG2, datarate << 4, ( uint8_t )~RFLR_MODEMCONFIG2_SF_MASK );
 
-            if( datarate == 6 )
-            {
-                SX1272Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1272Read( REG_LR_DETECTOPTIMIZE ) &
-                               RFLR_DETECTIONOPTIMIZE_MASK ) |
-                               RFLR_DETECTIONOPTIMIZE_SF6 );
-                SX1272Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF6 );
-            }
-            else
+    SX1272LoRaProfileSet( profile, REG_LR_PREAMBLEMSB, ( uint8_t )( ( preambleLen >> 8 ) & 0xFF ), 0xFF );
+    SX1272LoRaProfileSet( profile, REG_LR_PREAMBLELSB, ( uint8_t )( preambleLen & 0xFF ), 0xFF );
+
+    if( datarate == 6 )
+    {
+        SX1272LoRaProfileSet( profile, REG_LR_DETECTOPTIMIZE, RFLR_DETECTIONOPTIMIZE_SF6, ( uint8_t )~RFLR_DETECTIONOPTIMIZE_MASK );
+        SX1272LoRaProfileSet( profile, REG_LR_DETECTIONTHRESHOLD, RFLR_DETECTIONTHRESH_SF6, 0xFF );
+    }
+    else
+    {
+        SX1272LoRaProfileSet( profile, REG_LR_DETECTOPTIMIZE, RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12, ( uint8_t )~RFLR_DETECTIONOPTIMIZE_MASK );
+        SX1272LoRaProfileSet( profile, REG_LR_DETECTIONTHRESHOLD, RFLR_DETECTIONTHRESH_SF7_TO_SF12, 0xFF );
+    }
+}
+
+void SX1272CompileLoRaRxProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate,
+                                 uint16_t preambleLen, uint16_t symbTimeout,
+                                 bool fixLen, uint8_t payloadLen,
+                                 bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, bool rxContinuous )
+{
+    SX1272CompileLoRaProfile( profile, bandwidth, datarate, coderate, preambleLen, fixLen, crcOn,
+                              freqHopOn, hopPeriod, iqInverted );
+    profile->Rx = true;
+    profile->Settings.PayloadLen = payloadLen;
+    profile->Settings.RxContinuous = rxContinuous;
+
+    // The symbol timeout is split across two registers
+    SX1272LoRaProfileSet( profile, REG_LR_MODEMCONFIG2,
+                          ( symbTimeout >> 8 ) & ~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK,
+                          ( uint8_t )~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK );
+    SX1272LoRaProfileSet( profile, REG_LR_SYMBTIMEOUTLSB, ( uint8_t )( symbTimeout & 0xFF ), 0xFF );
+
+    if( fixLen == 1 )
+    {
+        SX1272LoRaProfileSet( profile, REG_LR_PAYLOADLENGTH, payloadLen, 0xFF );
+    }
+}
+
+void SX1272CompileLoRaTxProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate,
+                                 uint16_t preambleLen, bool fixLen, bool crcOn,
+                                 bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, uint32_t timeout )
+{
+    SX1272CompileLoRaProfile( profile, bandwidth, datarate, coderate, preambleLen, fixLen, crcOn,
+                              freqHopOn, hopPeriod, iqInverted );
+    profile->Rx = false;
+    profile->Settings.TxTimeout = timeout;
+}
+
+void SX1272ApplyLoRaProfile( const RadioLoRaProfile_t *profile )
+{
+    const RadioLoRaSettings_t *settings = &profile->Settings;
+    uint8_t buffer[LORA_PROFILE_MAX_RUN_SIZE];
+    uint8_t index = 0;
+
+    if( SX1272.Settings.Modem != MODEM_LORA )
+    {
+        SX1272SetModem( MODEM_LORA );
+    }
+
+    SX1272.Settings.LoRa.Bandwidth = settings->Bandwidth;
+    SX1272.Settings.LoRa.Datarate = settings->Datarate;
+    SX1272.Settings.LoRa.Coderate = settings->Coderate;
+    SX1272.Settings.LoRa.PreambleLen = settings->PreambleLen;
+    SX1272.Settings.LoRa.FixLen = settings->FixLen;
+    SX1272.Settings.LoRa.CrcOn = settings->CrcOn;
+    SX1272.Settings.LoRa.FreqHopOn = settings->FreqHopOn;
+    SX1272.Settings.LoRa.HopPeriod = settings->HopPeriod;
+    SX1272.Settings.LoRa.IqInverted = settings->IqInverted;
+    SX1272.Settings.LoRa.LowDatarateOptimize = settings->LowDatarateOptimize;
+    if( profile->Rx == true )
+    {
+        SX1272.Settings.LoRa.PayloadLen = settings->PayloadLen;
+        SX1272.Settings.LoRa.RxContinuous = settings->RxContinuous;
+    }
+    else
+    {
+        SX1272.Settings.LoRa.TxTimeout = settings->TxTimeout;
+    }
+
+    if( settings->FreqHopOn == true )
+    {
+        SX1272Write( REG_LR_PLLHOP, ( SX1272Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
+        SX1272Write( REG_LR_HOPPERIOD, settings->HopPeriod );
+    }
+    else
+    {
+        // A null hop period disables the hopping of a previous configuration
+        SX1272Write( REG_LR_HOPPERIOD, 0 );
+    }
+
+    for( uint8_t i = 0; i < sizeof( LoRaProfileRuns ) / sizeof( RegRun_t ); i++ )
+    {
+        uint8_t addr = LoRaProfileRuns[i].Addr;
+        uint8_t size = LoRaProfileRuns[i].Size;
+        bool changed = false;
+
+        for( uint8_t j = 0; j < size; j++ )
+        {
+            const uint8_t mask = profile->Mask[index + j];
+
+            // The bits not set by the profile are kept. Their value comes from the register shadow.
+            buffer[j] = ( mask != 0xFF ) ? ( SX1272Read( addr + j ) & ~mask ) : 0;
+            buffer[j] |= profile->Value[index + j] & mask;
+            if( SX1272RegShadowHolds( addr + j, buffer[j] ) == false )
             {
-                SX1272Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1272Read( REG_LR_DETECTOPTIMIZE ) &
-                             RFLR_DETECTIONOPTIMIZE_MASK ) |
-                             RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12 );
-                SX1272Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF7_TO_SF12 );
+                changed = true;
             }
         }
-        break;
+        if( changed == true )
+        {
+            SX1272WriteBuffer( addr, buffer, size );
+        }
+        index += size;
+    }
+}
+
+void SX1272SetHopTable( const uint32_t *channels, uint8_t nbChannels, uint32_t seed )
+{
+    uint32_t state = ( seed != 0 ) ? seed : 1;
+
+    if( nbChannels > FHSS_MAX_NB_CHANNELS )
+    {
+        nbChannels = FHSS_MAX_NB_CHANNELS;
+    }
+
+    for( uint8_t i = 0; i < nbChannels; i++ )
+    {
+        uint32_t frf = ( uint32_t )( ( double )channels[i] / ( double )FREQ_STEP );
+
+        FhssHopTable.Frf[i][0] = ( uint8_t )( ( frf >> 16 ) & 0xFF );
+        FhssHopTable.Frf[i][1] = ( uint8_t )( ( frf >> 8 ) & 0xFF );
+        FhssHopTable.Frf[i][2] = ( uint8_t )( frf & 0xFF );
+    }
+
+    // Fisher-Yates shuffle driven by a xorshift generator
+    for( uint8_t i = nbChannels; i > 1; i-- )
+    {
+        uint8_t j;
+        uint8_t frf[3];
+
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        j = state % i;
+
+        memcpy1( frf, FhssHopTable.Frf[i - 1], 3 );
+        memcpy1( FhssHopTable.Frf[i - 1], FhssHopTable.Frf[j], 3 );
+        memcpy1( FhssHopTable.Frf[j], frf, 3 );
+    }
+    FhssHopTable.NbChannels = nbChannels;
+    FhssHopTable.Index = 0;
+}
+
+static void SX1272FhssHop( void )
+{
+    if( FhssHopTable.NbChannels != 0 )
+    {
+        SX1272WriteBuffer( REG_LR_FRFMSB, FhssHopTable.Frf[FhssHopTable.Index], 3 );
+        if( ++FhssHopTable.Index >= FhssHopTable.NbChannels )
+        {
+            FhssHopTable.Index = 0;
+        }
     }
 }
 
@@ -757,7 +1029,7 @@ void SX1272SetSleep( void )
     // Disable TCXO radio is in SLEEP mode
     SX1272SetBoardTcxo( false );
 
-    SX1272.Settings.State = RF_IDLE;
+    SX1272SetState( RF_IDLE );
 }
 
 void SX1272SetStby( void )
@@ -767,7 +1039,7 @@ void SX1272SetStby( void )
     TimerStop( &RxTimeoutSyncWord );
 
     SX1272SetOpMode( RF_OPMODE_STANDBY );
-    SX1272.Settings.State = RF_IDLE;
+    SX1272SetState( RF_IDLE );
 }
 
 void SX1272SetRx( uint32_t timeout )
@@ -837,6 +1109,7 @@ void SX1272SetRx( uint32_t timeout )
 
                 // DIO0=RxDone, DIO2=FhssChangeChannel
                 SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK  ) | RFLR_DIOMAPPING1_DIO0_00 | RFLR_DIOMAPPING1_DIO2_00 );
+                FhssHopTable.Index = 0;
             }
             else
             {
@@ -860,7 +1133,7 @@ void SX1272SetRx( uint32_t timeout )
 
     memset( RxTxBuffer, 0, ( size_t )RX_BUFFER_SIZE );
 
-    SX1272.Settings.State = RF_RX_RUNNING;
+    SX1272SetState( RF_RX_RUNNING );
     if( timeout != 0 )
     {
         TimerSetValue( &RxTimeoutTimer, timeout );
@@ -928,6 +1201,7 @@ void SX1272SetTx( uint32_t timeout )
 
                 // DIO0=TxDone, DIO2=FhssChangeChannel
                 SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK ) | RFLR_DIOMAPPING1_DIO0_01 | RFLR_DIOMAPPING1_DIO2_00 );
+                FhssHopTable.Index = 0;
             }
             else
             {
@@ -947,7 +1221,7 @@ void SX1272SetTx( uint32_t timeout )
         break;
     }
 
-    SX1272.Settings.State = RF_TX_RUNNING;
+    SX1272SetState( RF_TX_RUNNING );
     TimerStart( &TxTimeoutTimer );
     SX1272SetOpMode( RF_OPMODE_TRANSMITTER );
 }
@@ -976,7 +1250,7 @@ void SX1272StartCad( void )
             // DIO3=CADDone
             SX1272Write( REG_DIOMAPPING1, ( SX1272Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO3_MASK ) | RFLR_DIOMAPPING1_DIO3_00 );
 
-            SX1272.Settings.State = RF_CAD;
+            SX1272SetState( RF_CAD );
             SX1272SetOpMode( RFLR_OPMODE_CAD );
         }
         break;
@@ -1000,7 +1274,7 @@ void SX1272SetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
 
     TimerSetValue( &TxTimeoutTimer, timeout );
 
-    SX1272.Settings.State = RF_TX_RUNNING;
+    SX1272SetState( RF_TX_RUNNING );
     TimerStart( &TxTimeoutTimer );
     SX1272SetOpMode( RF_OPMODE_TRANSMITTER );
 }
@@ -1074,6 +1348,9 @@ void SX1272SetModem( RadioModems_t modem )
         return;
     }
 
+    // The register shadow is only valid for the current modem
+    SX1272RegShadowInvalidate( );
+
     SX1272.Settings.Modem = modem;
     switch( SX1272.Settings.Modem )
     {
@@ -1095,51 +1372,159 @@ void SX1272SetModem( RadioModems_t modem )
     }
 }
 
+static bool SX1272RegIsShadowed( uint16_t addr )
+{
+    if( addr >= REG_SHADOW_SIZE )
+    {
+        return false;
+    }
+    if( SX1272.Settings.Modem == MODEM_LORA )
+    {
+        switch( addr )
+        {
+        case REG_LR_FIFO:
+        case REG_LR_OPMODE:
+        case REG_LR_LNA:
+        case REG_LR_FIFOADDRPTR:
+        case REG_LR_FIFORXCURRENTADDR:
+        case REG_LR_IRQFLAGS:
+        case REG_LR_RXNBBYTES:
+        case REG_LR_RXHEADERCNTVALUEMSB:
+        case REG_LR_RXHEADERCNTVALUELSB:
+        case REG_LR_RXPACKETCNTVALUEMSB:
+        case REG_LR_RXPACKETCNTVALUELSB:
+        case REG_LR_MODEMSTAT:
+        case REG_LR_PKTSNRVALUE:
+        case REG_LR_PKTRSSIVALUE:
+        case REG_LR_RSSIVALUE:
+        case REG_LR_HOPCHANNEL:
+        case REG_LR_FIFORXBYTEADDR:
+        case REG_LR_FEIMSB:
+        case REG_LR_FEIMID:
+        case REG_LR_FEILSB:
+        case REG_LR_RSSIWIDEBAND:
+        case REG_LR_FORMERTEMP:
+            return false;
+        default:
+            return true;
+        }
+    }
+    else
+    {
+        switch( addr )
+        {
+        case REG_FIFO:
+        case REG_OPMODE:
+        case REG_LNA:
+        case REG_RXCONFIG:
+        case REG_RSSIVALUE:
+        case REG_AFCFEI:
+        case REG_AFCMSB:
+        case REG_AFCLSB:
+        case REG_FEIMSB:
+        case REG_FEILSB:
+        case REG_OSC:
+        case REG_SEQCONFIG1:
+        case REG_IMAGECAL:
+        case REG_TEMP:
+        case REG_IRQFLAGS1:
+        case REG_IRQFLAGS2:
+        case REG_FORMERTEMP:
+            return false;
+        default:
+            return true;
+        }
+    }
+}
+
+static void SX1272RegShadowInvalidate( void )
+{
+    memset1( RegShadowValid, 0, sizeof( RegShadowValid ) );
+}
+
+static void SX1272RegShadowUpdate( uint16_t addr, uint8_t *buffer, uint8_t size )
+{
+    if( addr == 0 )
+    {
+        // FIFO accesses don't increment the address
+        return;
+    }
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        if( ( addr + i ) >= REG_SHADOW_SIZE )
+        {
+            break;
+        }
+        if( SX1272RegIsShadowed( addr + i ) == true )
+        {
+            RegShadow[addr + i] = buffer[i];
+            RegShadowValid[( addr + i ) >> 3] |= 1 << ( ( addr + i ) & 0x07 );
+        }
+    }
+}
+
+static bool SX1272RegShadowHolds( uint16_t addr, uint8_t value )
+{
+    return ( SX1272RegIsShadowed( addr ) == true ) &&
+           ( ( RegShadowValid[addr >> 3] & ( 1 << ( addr & 0x07 ) ) ) != 0 ) &&
+           ( RegShadow[addr] == value );
+}
+
 void SX1272Write( uint16_t addr, uint8_t data )
 {
+    if( SX1272RegShadowHolds( addr, data ) == true )
+    {
+        // The register already holds the value
+        return;
+    }
     SX1272WriteBuffer( addr, &data, 1 );
 }
 
 uint8_t SX1272Read( uint16_t addr )
 {
     uint8_t data;
+
+    if( ( SX1272RegIsShadowed( addr ) == true ) &&
+        ( ( RegShadowValid[addr >> 3] & ( 1 << ( addr & 0x07 ) ) ) != 0 ) )
+    {
+        return RegShadow[addr];
+    }
     SX1272ReadBuffer( addr, &data, 1 );
     return data;
 }
 
 void SX1272WriteBuffer( uint16_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
+    SX1272FifoTransferWait( );
 
     //NSS = 0;
     GpioWrite( &SX1272.Spi.Nss, 0 );
+    SX1272.Stats.SpiCnt++;
 
     SpiInOut( &SX1272.Spi, addr | 0x80 );
-    for( i = 0; i < size; i++ )
-    {
-        SpiInOut( &SX1272.Spi, buffer[i] );
-    }
+    SpiTransfer( &SX1272.Spi, buffer, NULL, size );
 
     //NSS = 1;
     GpioWrite( &SX1272.Spi.Nss, 1 );
+
+    SX1272RegShadowUpdate( addr, buffer, size );
 }
 
 void SX1272ReadBuffer( uint16_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
+    SX1272FifoTransferWait( );
 
     //NSS = 0;
     GpioWrite( &SX1272.Spi.Nss, 0 );
+    SX1272.Stats.SpiCnt++;
 
     SpiInOut( &SX1272.Spi, addr & 0x7F );
-
-    for( i = 0; i < size; i++ )
-    {
-        buffer[i] = SpiInOut( &SX1272.Spi, 0 );
-    }
+    SpiTransfer( &SX1272.Spi, NULL, buffer, size );
 
     //NSS = 1;
     GpioWrite( &SX1272.Spi.Nss, 1 );
+
+    SX1272RegShadowUpdate( addr, buffer, size );
 }
 
 void SX1272WriteFifo( uint8_t *buffer, uint8_t size )
@@ -1152,6 +1537,137 @@ void SX1272ReadFifo( uint8_t *buffer, uint8_t size )
     SX1272ReadBuffer( 0, buffer, size );
 }
 
+static void SX1272FifoTransferStart( uint8_t addr, const uint8_t *txBuffer, uint8_t *rxBuffer, uint8_t size )
+{
+    SX1272FifoTransferWait( );
+
+    if( size == 0 )
+    {
+        return;
+    }
+
+    //NSS = 0;
+    GpioWrite( &SX1272.Spi.Nss, 0 );
+    SX1272.Stats.SpiCnt++;
+
+    SpiInOut( &SX1272.Spi, addr );
+
+    FskFifo.Busy = true;
+    SpiSetTransferCallback( &SX1272.Spi, SX1272OnFifoTransferDone, NULL );
+    SpiTransfer( &SX1272.Spi, txBuffer, rxBuffer, size );
+}
+
+static void SX1272FifoTransferWait( void )
+{
+    // The SPI DMA completion interrupt has a higher priority than the DIO ones
+    while( FskFifo.Busy == true )
+    {
+    }
+}
+
+static void SX1272OnFifoTransferDone( void* context )
+{
+    // Restores the blocking transfers
+    SpiSetTransferCallback( &SX1272.Spi, NULL, NULL );
+
+    //NSS = 1;
+    GpioWrite( &SX1272.Spi.Nss, 1 );
+
+    FskFifo.Busy = false;
+}
+
+static void SX1272FskReadPayloadSize( void )
+{
+    if( SX1272.Settings.Fsk.FixLen == false )
+    {
+        uint8_t size = 0;
+
+        SX1272ReadFifo( &size, 1 );
+        SX1272.Settings.FskPacketHandler.Size = size;
+    }
+    else
+    {
+        SX1272.Settings.FskPacketHandler.Size = ( ( uint16_t )( SX1272Read( REG_PACKETCONFIG2 ) & ~RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) << 8 ) |
+                                                SX1272Read( REG_PAYLOADLENGTH );
+    }
+    FskFifo.PendingSize = 0;
+}
+
+static void SX1272FskReadChunk( uint16_t size, bool last )
+{
+    uint8_t readyIndex = FskFifo.Index;
+    uint16_t readyOffset = FskFifo.PendingOffset;
+    uint8_t readySize = FskFifo.PendingSize;
+
+    if( FskFifo.Sink == NULL )
+    {
+        if( last == true )
+        {
+            SX1272ReadFifo( RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes, size );
+        }
+        else
+        {
+            SX1272FifoTransferStart( 0x00, NULL, RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes, size );
+        }
+        SX1272.Settings.FskPacketHandler.NbBytes += size;
+        return;
+    }
+
+    if( size > FSK_FIFO_SIZE )
+    {
+        // The FIFO can't hold more bytes, the missing ones have been overrun
+        size = FSK_FIFO_SIZE;
+    }
+
+    // The chunk handed to the sink below must have been filled
+    SX1272FifoTransferWait( );
+
+    FskFifo.Index ^= 1;
+    FskFifo.PendingOffset = SX1272.Settings.FskPacketHandler.NbBytes;
+    FskFifo.PendingSize = size;
+    if( last == true )
+    {
+        SX1272ReadFifo( FskFifo.Chunk[FskFifo.Index], size );
+    }
+    else
+    {
+        SX1272FifoTransferStart( 0x00, NULL, FskFifo.Chunk[FskFifo.Index], size );
+    }
+    SX1272.Settings.FskPacketHandler.NbBytes += size;
+
+    if( readySize != 0 )
+    {
+        FskFifo.Sink( FskFifo.Chunk[readyIndex], readyOffset, readySize );
+    }
+    if( ( last == true ) && ( size != 0 ) )
+    {
+        FskFifo.Sink( FskFifo.Chunk[FskFifo.Index], FskFifo.PendingOffset, size );
+    }
+    if( last == true )
+    {
+        FskFifo.PendingSize = 0;
+    }
+}
+
+void SX1272SetFskStreamSink( SX1272FskStreamSink_t *sink, uint16_t payloadLen )
+{
+    if( ( sink == NULL ) || ( payloadLen > FSK_MAX_PAYLOAD_LENGTH ) )
+    {
+        payloadLen = SX1272.Settings.Fsk.PayloadLen;
+    }
+
+    SX1272FifoTransferWait( );
+    FskFifo.Sink = sink;
+    FskFifo.PendingSize = 0;
+
+    if( ( SX1272.Settings.Modem == MODEM_FSK ) && ( SX1272.Settings.Fsk.FixLen == true ) )
+    {
+        SX1272Write( REG_PACKETCONFIG2, ( SX1272Read( REG_PACKETCONFIG2 ) & RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) |
+                                        ( ( payloadLen >> 8 ) & ~RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) );
+        SX1272Write( REG_PAYLOADLENGTH, ( uint8_t )payloadLen );
+    }
+}
+
 void SX1272SetMaxPayloadLength( RadioModems_t modem, uint8_t max )
 {
     SX1272SetModem( modem );
@@ -1191,6 +1707,39 @@ uint32_t SX1272GetWakeupTime( void )
     return SX1272GetBoardTcxoWakeupTime( ) + RADIO_WAKEUP_TIME;
 }
 
+static void SX1272SetState( RadioState_t state )
+{
+    TimerTime_t now = TimerGetCurrentTime( );
+
+    if( SX1272.Settings.State == RF_TX_RUNNING )
+    {
+        SX1272.Stats.TxTime += now - StatsStateStartTime;
+    }
+    else if( SX1272.Settings.State != RF_IDLE )
+    {
+        SX1272.Stats.RxTime += now - StatsStateStartTime;
+    }
+    StatsStateStartTime = now;
+    SX1272.Settings.State = state;
+}
+
+void SX1272GetStats( RadioStats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    // Account for the time spent in the current state
+    SX1272SetState( SX1272.Settings.State );
+    *stats = SX1272.Stats;
+    CRITICAL_SECTION_END( );
+}
+
+void SX1272ResetStats( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    memset1( ( uint8_t* )&SX1272.Stats, 0, sizeof( RadioStats_t ) );
+    StatsStateStartTime = TimerGetCurrentTime( );
+    CRITICAL_SECTION_END( );
+}
+
 void SX1272OnTimeoutIrq( void* context )
 {
     switch( SX1272.Settings.State )
@@ -1217,10 +1766,11 @@ void SX1272OnTimeoutIrq( void* context )
             }
             else
             {
-                SX1272.Settings.State = RF_IDLE;
+                SX1272SetState( RF_IDLE );
                 TimerStop( &RxTimeoutSyncWord );
             }
         }
+        SX1272.Stats.RxTimeoutCnt++;
         if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
         {
             RadioEvents->RxTimeout( );
@@ -1237,6 +1787,8 @@ void SX1272OnTimeoutIrq( void* context )
 
         // Reset the radio
         SX1272Reset( );
+        SX1272RegShadowInvalidate( );
+        SX1272.Settings.Modem = MODEM_FSK;
 
         // Initialize radio default values
         SX1272SetOpMode( RF_OPMODE_SLEEP );
@@ -1252,7 +1804,8 @@ void SX1272OnTimeoutIrq( void* context )
         SX1272SetPublicNetwork( SX1272.Settings.LoRa.PublicNetwork );
         // END WORKAROUND
 
-        SX1272.Settings.State = RF_IDLE;
+        SX1272SetState( RF_IDLE );
+        SX1272.Stats.TxTimeoutCnt++;
         if( ( RadioEvents != NULL ) && ( RadioEvents->TxTimeout != NULL ) )
         {
             RadioEvents->TxTimeout( );
@@ -1263,8 +1816,11 @@ void SX1272OnTimeoutIrq( void* context )
     }
 }
 
-void SX1272OnDio0Irq( void* context )
+LORAMAC_HOT void SX1272OnDio0Irq( void* context )
 {
+    Dio0IrqTicks = TimerGetCurrentTicks( );
+    TRACE_BEGIN( TRACE_PROBE_RADIO_IRQ );
+
     volatile uint8_t irqFlags = 0;
 
     switch( SX1272.Settings.State )
@@ -1291,7 +1847,7 @@ void SX1272OnDio0Irq( void* context )
                         if( SX1272.Settings.Fsk.RxContinuous == false )
                         {
                             TimerStop( &RxTimeoutSyncWord );
-                            SX1272.Settings.State = RF_IDLE;
+                            SX1272SetState( RF_IDLE );
                         }
                         else
                         {
@@ -1300,6 +1856,7 @@ void SX1272OnDio0Irq( void* context )
                             TimerStart( &RxTimeoutSyncWord );
                         }
 
+                        SX1272.Stats.RxCrcErrorCnt++;
                         if( ( RadioEvents != NULL ) && ( RadioEvents->RxError != NULL ) )
                         {
                             RadioEvents->RxError( );
@@ -1315,28 +1872,16 @@ void SX1272OnDio0Irq( void* context )
                 // Read received packet size
                 if( ( SX1272.Settings.FskPacketHandler.Size == 0 ) && ( SX1272.Settings.FskPacketHandler.NbBytes == 0 ) )
                 {
-                    if( SX1272.Settings.Fsk.FixLen == false )
-                    {
-                        SX1272ReadFifo( ( uint8_t* )&SX1272.Settings.FskPacketHandler.Size, 1 );
-                    }
-                    else
-                    {
-                        SX1272.Settings.FskPacketHandler.Size = SX1272Read( REG_PAYLOADLENGTH );
-                    }
-                    SX1272ReadFifo( RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes, SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
-                    SX1272.Settings.FskPacketHandler.NbBytes += ( SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
-                }
-                else
-                {
-                    SX1272ReadFifo( RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes, SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
-                    SX1272.Settings.FskPacketHandler.NbBytes += ( SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
+                    SX1272FskReadPayloadSize( );
                 }
+                // Read the last chunk once the chunks read upon FifoLevel are done
+                SX1272FskReadChunk( SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes, true );
 
                 TimerStop( &RxTimeoutTimer );
 
                 if( SX1272.Settings.Fsk.RxContinuous == false )
                 {
-                    SX1272.Settings.State = RF_IDLE;
+                    SX1272SetState( RF_IDLE );
                     TimerStop( &RxTimeoutSyncWord );
                 }
                 else
@@ -1346,9 +1891,14 @@ void SX1272OnDio0Irq( void* context )
                     TimerStart( &RxTimeoutSyncWord );
                 }
 
-                if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+                SX1272.Stats.RxCnt++;
+                if( ( RadioEvents != NULL ) && ( RadioEvents->RxDoneTimestamped != NULL ) )
+                {
+                    RadioEvents->RxDoneTimestamped( ( FskFifo.Sink == NULL ) ? RxTxBuffer : NULL, SX1272.Settings.FskPacketHandler.Size, SX1272.Settings.FskPacketHandler.RssiValue, 0, Dio0IrqTicks );
+                }
+                else if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
                 {
-                    RadioEvents->RxDone( RxTxBuffer, SX1272.Settings.FskPacketHandler.Size, SX1272.Settings.FskPacketHandler.RssiValue, 0 );
+                    RadioEvents->RxDone( ( FskFifo.Sink == NULL ) ? RxTxBuffer : NULL, SX1272.Settings.FskPacketHandler.Size, SX1272.Settings.FskPacketHandler.RssiValue, 0 );
                 }
                 SX1272.Settings.FskPacketHandler.PreambleDetected = false;
                 SX1272.Settings.FskPacketHandler.SyncWordDetected = false;
@@ -1368,10 +1918,11 @@ void SX1272OnDio0Irq( void* context )
 
                         if( SX1272.Settings.LoRa.RxContinuous == false )
                         {
-                            SX1272.Settings.State = RF_IDLE;
+                            SX1272SetState( RF_IDLE );
                         }
                         TimerStop( &RxTimeoutTimer );
 
+                        SX1272.Stats.RxCrcErrorCnt++;
                         if( ( RadioEvents != NULL ) && ( RadioEvents->RxError != NULL ) )
                         {
                             RadioEvents->RxError( );
@@ -1399,11 +1950,16 @@ void SX1272OnDio0Irq( void* context )
 
                     if( SX1272.Settings.LoRa.RxContinuous == false )
                     {
-                        SX1272.Settings.State = RF_IDLE;
+                        SX1272SetState( RF_IDLE );
                     }
                     TimerStop( &RxTimeoutTimer );
 
-                    if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+                    SX1272.Stats.RxCnt++;
+                    if( ( RadioEvents != NULL ) && ( RadioEvents->RxDoneTimestamped != NULL ) )
+                    {
+                        RadioEvents->RxDoneTimestamped( RxTxBuffer, SX1272.Settings.LoRaPacketHandler.Size, SX1272.Settings.LoRaPacketHandler.RssiValue, SX1272.Settings.LoRaPacketHandler.SnrValue, Dio0IrqTicks );
+                    }
+                    else if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
                     {
                         RadioEvents->RxDone( RxTxBuffer, SX1272.Settings.LoRaPacketHandler.Size, SX1272.Settings.LoRaPacketHandler.RssiValue, SX1272.Settings.LoRaPacketHandler.SnrValue );
                     }
@@ -1424,8 +1980,13 @@ void SX1272OnDio0Irq( void* context )
                 // Intentional fall through
             case MODEM_FSK:
             default:
-                SX1272.Settings.State = RF_IDLE;
-                if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
+                SX1272SetState( RF_IDLE );
+                SX1272.Stats.TxCnt++;
+                if( ( RadioEvents != NULL ) && ( RadioEvents->TxDoneTimestamped != NULL ) )
+                {
+                    RadioEvents->TxDoneTimestamped( Dio0IrqTicks );
+                }
+                else if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
                 {
                     RadioEvents->TxDone( );
                 }
@@ -1435,6 +1996,7 @@ void SX1272OnDio0Irq( void* context )
         default:
             break;
     }
+    TRACE_END( TRACE_PROBE_RADIO_IRQ );
 }
 
 void SX1272OnDio1Irq( void* context )
@@ -1452,14 +2014,7 @@ void SX1272OnDio1Irq( void* context )
                 // Read received packet size
                 if( ( SX1272.Settings.FskPacketHandler.Size == 0 ) && ( SX1272.Settings.FskPacketHandler.NbBytes == 0 ) )
                 {
-                    if( SX1272.Settings.Fsk.FixLen == false )
-                    {
-                        SX1272ReadFifo( ( uint8_t* )&SX1272.Settings.FskPacketHandler.Size, 1 );
-                    }
-                    else
-                    {
-                        SX1272.Settings.FskPacketHandler.Size = SX1272Read( REG_PAYLOADLENGTH );
-                    }
+                    SX1272FskReadPayloadSize( );
                 }
                 // ERRATA 3.1 - PayloadReady Set for 31.25ns if FIFO is Empty
                 //
@@ -1470,13 +2025,11 @@ void SX1272OnDio1Irq( void* context )
                 //              when FifoLevel fires
                 if( ( SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes ) >= SX1272.Settings.FskPacketHandler.FifoThresh )
                 {
-                    SX1272ReadFifo( ( RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes ), SX1272.Settings.FskPacketHandler.FifoThresh - 1 );
-                    SX1272.Settings.FskPacketHandler.NbBytes += SX1272.Settings.FskPacketHandler.FifoThresh - 1;
+                    SX1272FskReadChunk( SX1272.Settings.FskPacketHandler.FifoThresh - 1, false );
                 }
                 else
                 {
-                    SX1272ReadFifo( ( RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes ), SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
-                    SX1272.Settings.FskPacketHandler.NbBytes += ( SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
+                    SX1272FskReadChunk( SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes, false );
                 }
                 break;
             case MODEM_LORA:
@@ -1485,7 +2038,8 @@ void SX1272OnDio1Irq( void* context )
                 // Clear Irq
                 SX1272Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_RXTIMEOUT );
 
-                SX1272.Settings.State = RF_IDLE;
+                SX1272SetState( RF_IDLE );
+                SX1272.Stats.RxTimeoutCnt++;
                 if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
                 {
                     RadioEvents->RxTimeout( );
@@ -1502,13 +2056,13 @@ void SX1272OnDio1Irq( void* context )
                 // FifoEmpty interrupt
                 if( ( SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes ) > SX1272.Settings.FskPacketHandler.ChunkSize )
                 {
-                    SX1272WriteFifo( ( RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes ), SX1272.Settings.FskPacketHandler.ChunkSize );
+                    SX1272FifoTransferStart( 0x80, RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes, NULL, SX1272.Settings.FskPacketHandler.ChunkSize );
                     SX1272.Settings.FskPacketHandler.NbBytes += SX1272.Settings.FskPacketHandler.ChunkSize;
                 }
                 else
                 {
                     // Write the last chunk of data
-                    SX1272WriteFifo( RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes, SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
+                    SX1272FifoTransferStart( 0x80, RxTxBuffer + SX1272.Settings.FskPacketHandler.NbBytes, NULL, SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes );
                     SX1272.Settings.FskPacketHandler.NbBytes += SX1272.Settings.FskPacketHandler.Size - SX1272.Settings.FskPacketHandler.NbBytes;
                 }
                 break;
@@ -1554,6 +2108,8 @@ void SX1272OnDio2Irq( void* context )
             case MODEM_LORA:
                 if( SX1272.Settings.LoRa.FreqHopOn == true )
                 {
+                    SX1272FhssHop( );
+
                     // Clear Irq
                     SX1272Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL );
 
@@ -1575,6 +2131,8 @@ void SX1272OnDio2Irq( void* context )
             case MODEM_LORA:
                 if( SX1272.Settings.LoRa.FreqHopOn == true )
                 {
+                    SX1272FhssHop( );
+
                     // Clear Irq
                     SX1272Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL );
 
@@ -26,6 +26,7 @@
 #include <string.h>
 #include "utilities.h"
 #include "timer.h"
+#include "trace.h"
 #include "radio.h"
 #include "delay.h"
 #include "sx1276.h"
@@ -54,11 +55,63 @@ typedef struct
     uint8_t  RegValue;
 }FskBandwidth_t;
 
+/*!
+ * Run of contiguous registers
+ */
+typedef struct
+{
+    uint8_t Addr;
+    uint8_t Size;
+}RegRun_t;
+
+/*!
+ * FSK FIFO non-blocking transfers state
+ */
+typedef struct
+{
+    /*!
+     * Set while a FIFO transfer carried by the SPI DMA is in progress
+     */
+    volatile bool Busy;
+    /*!
+     * Stream sink of the received payload, NULL when the payload goes to the
+     * reception buffer
+     */
+    SX1276FskStreamSink_t *Sink;
+    /*!
+     * Double buffer of the streamed payload chunks. The DMA fills one of them
+     * while the other one is handed to the sink.
+     */
+    uint8_t Chunk[2][FSK_FIFO_SIZE];
+    /*!
+     * Index of the chunk being filled
+     */
+    uint8_t Index;
+    /*!
+     * Payload offset and size of the chunk being filled, size is 0 when none
+     */
+    uint16_t PendingOffset;
+    uint8_t PendingSize;
+}FskFifoTransfer_t;
 
 /*
  * Private functions prototypes
  */
 
+/*!
+ * \brief Invalidates the whole register shadow
+ */
+static void SX1276RegShadowInvalidate( void );
+
+/*!
+ * \brief Updates the register shadow after a registers burst access
+ *
+ * \param [IN] addr   First Radio register address
+ * \param [IN] buffer Buffer containing the registers values
+ * \param [IN] size   Number of registers
+ */
+static void SX1276RegShadowUpdate( uint16_t addr, uint8_t *buffer, uint8_t size );
+
 /*!
  * Performs the Rx chain calibration for LF and HF bands
  * \remark Must be called just after the reset so all registers are at their
@@ -66,6 +119,48 @@ typedef struct
  */
 static void RxChainCalibration( void );
 
+/*!
+ * \brief Checks if the register shadow holds the given register value
+ *
+ * \param [IN] addr  Register address
+ * \param [IN] value Register value
+ *
+ * \retval holds true if the register doesn't need to be written
+ */
+static bool SX1276RegShadowHolds( uint16_t addr, uint8_t value );
+
+/*!
+ * \brief Compiles the part of the LoRa profiles common to reception and
+ *        transmission
+ */
+static void SX1276CompileLoRaProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                      uint32_t datarate, uint8_t coderate,
+                                      uint16_t preambleLen, bool fixLen, bool crcOn,
+                                      bool freqHopOn, uint8_t hopPeriod, bool iqInverted );
+
+/*!
+ * \brief Sets bits of a register of a LoRa profile
+ *
+ * \param [IN/OUT] profile LoRa profile
+ * \param [IN] addr        Register address
+ * \param [IN] value       Register bits value
+ * \param [IN] mask        Register bits to be set
+ */
+static void SX1276LoRaProfileSet( RadioLoRaProfile_t *profile, uint8_t addr, uint8_t value, uint8_t mask );
+
+/*!
+ * \brief Hops to the next channel of the frequency hopping sequence
+ */
+static void SX1276FhssHop( void );
+
+/*!
+ * \brief Changes the driver state and accumulates the time spent in the
+ *        previous one for the radio statistics
+ *
+ * \param [IN] state New driver state
+ */
+static void SX1276SetState( RadioState_t state );
+
 /*!
  * \brief Sets the SX1276 in transmission mode for the given time
  * \param [IN] timeout Transmission timeout [ms] [0: continuous, others timeout]
@@ -88,6 +183,46 @@ void SX1276WriteFifo( uint8_t *buffer, uint8_t size );
  */
 void SX1276ReadFifo( uint8_t *buffer, uint8_t size );
 
+/*!
+ * \brief Starts a non-blocking FIFO transfer carried by the SPI DMA. The NSS
+ *        is released upon the transfer completion.
+ *
+ * \remark Waits for the previous FIFO transfer to complete first
+ *
+ * \param [IN]  addr     FIFO address, bit 7 set for a write access
+ * \param [IN]  txBuffer Bytes to be written, NULL for a read access
+ * \param [OUT] rxBuffer Bytes read, NULL for a write access
+ * \param [IN]  size     Number of bytes
+ */
+static void SX1276FifoTransferStart( uint8_t addr, const uint8_t *txBuffer, uint8_t *rxBuffer, uint8_t size );
+
+/*!
+ * \brief Waits for the non-blocking FIFO transfer in progress to complete
+ */
+static void SX1276FifoTransferWait( void );
+
+/*!
+ * \brief SPI transfer completion callback of the non-blocking FIFO transfers
+ */
+static void SX1276OnFifoTransferDone( void* context );
+
+/*!
+ * \brief Reads the payload size of the FSK packet being received
+ */
+static void SX1276FskReadPayloadSize( void );
+
+/*!
+ * \brief Reads a chunk of the FSK packet being received off the FIFO
+ *
+ * \remark The chunks read upon the FifoLevel interrupt are transferred by the
+ *         DMA while the interrupt returns. The last chunk is read upon the
+ *         PayloadReady interrupt and completes the packet.
+ *
+ * \param [IN] size Chunk size
+ * \param [IN] last Set for the last chunk of the packet
+ */
+static void SX1276FskReadChunk( uint16_t size, bool last );
+
 /*!
  * \brief Sets the SX1276 operating mode
  *
@@ -180,6 +315,22 @@ const FskBandwidth_t FskBandwidths[] =
     { 300000, 0x00 }, // Invalid Bandwidth
 };
 
+/*!
+ * Contiguous register runs held by the LoRa profiles
+ */
+const RegRun_t LoRaProfileRuns[] =
+{
+    { REG_LR_MODEMCONFIG1, 6 },     // ModemConfig1 to PayloadLength
+    { REG_LR_MODEMCONFIG3, 1 },
+    { REG_LR_DETECTOPTIMIZE, 1 },
+    { REG_LR_HIGHBWOPTIMIZE1, 2 },  // HighBwOptimize1 and DetectionThreshold
+};
+
+/*!
+ * Size of the longest LoRa profile run
+ */
+#define LORA_PROFILE_MAX_RUN_SIZE                   6
+
 /*
  * Private global variables
  */
@@ -194,6 +345,40 @@ static RadioEvents_t *RadioEvents;
  */
 static uint8_t RxTxBuffer[RX_BUFFER_SIZE];
 
+/*!
+ * FSK FIFO non-blocking transfers state
+ */
+static FskFifoTransfer_t FskFifo;
+
+/*!
+ * Write-through shadow of the radio registers and its valid bits
+ *
+ * \remark Registers updated by the radio itself (status, IRQ flags, FIFO
+ *         pointers, self clearing triggers, operating mode) bypass the shadow.
+ */
+static uint8_t RegShadow[REG_SHADOW_SIZE];
+static uint8_t RegShadowValid[REG_SHADOW_SIZE / 8];
+
+/*!
+ * Start time of the current driver state, used by the radio statistics
+ */
+static TimerTime_t StatsStateStartTime = 0;
+
+/*!
+ * Timer ticks captured at the last DIO0 interrupt edge
+ */
+static uint32_t Dio0IrqTicks = 0;
+
+/*!
+ * Frequency hopping sequence, PLL steps of the channels in hopping order
+ */
+static struct
+{
+    uint8_t Frf[FHSS_MAX_NB_CHANNELS][3];
+    uint8_t NbChannels;
+    uint8_t Index;
+}FhssHopTable;
+
 /*
  * Public global variables
  */
@@ -233,6 +418,9 @@ void SX1276Init( RadioEvents_t *events )
     TimerInit( &RxTimeoutSyncWord, SX1276OnTimeoutIrq );
 
     SX1276Reset( );
+    SX1276RegShadowInvalidate( );
+    // The radio is in FSK mode after a reset
+    SX1276.Settings.Modem = MODEM_FSK;
 
     RxChainCalibration( );
 
@@ -248,7 +436,7 @@ void SX1276Init( RadioEvents_t *events )
 
     SX1276SetModem( MODEM_FSK );
 
-    SX1276.Settings.State = RF_IDLE;
+    SX1276SetState( RF_IDLE );
 }
 
 RadioState_t SX1276GetStatus( void )
@@ -447,121 +635,17 @@ void SX1276SetRxConfig( RadioModems_t modem, uint32_t bandwidth,
                            RF_PACKETCONFIG1_PACKETFORMAT_MASK ) |
                            ( ( fixLen == 1 ) ? RF_PACKETCONFIG1_PACKETFORMAT_FIXED : RF_PACKETCONFIG1_PACKETFORMAT_VARIABLE ) |
                            ( crcOn << 4 ) );
-            SX1276Write( REG_PACKETCONFIG2, ( SX1276Read( REG_PACKETCONFIG2 ) | RF_PACKETCONFIG2_DATAMODE_PACKET ) );
+            SX1276Write( REG_PACKETCONFIG2, ( ( SX1276Read( REG_PACKETCONFIG2 ) & RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) |
+                                              RF_PACKETCONFIG2_DATAMODE_PACKET ) );
         }
         break;
     case MODEM_LORA:
         {
-            if( bandwidth > 2 )
-            {
-                // Fatal error: When using LoRa modem only bandwidths 125, 250 and 500 kHz are supported
-                while( 1 );
-            }
-            bandwidth += 7;
-            SX1276.Settings.LoRa.Bandwidth = bandwidth;
-            SX1276.Settings.LoRa.Datarate = datarate;
-            SX1276.Settings.LoRa.Coderate = coderate;
-            SX1276.Settings.LoRa.PreambleLen = preambleLen;
-            SX1276.Settings.LoRa.FixLen = fixLen;
-            SX1276.Settings.LoRa.PayloadLen = payloadLen;
-            SX1276.Settings.LoRa.CrcOn = crcOn;
-            SX1276.Settings.LoRa.FreqHopOn = freqHopOn;
-            SX1276.Settings.LoRa.HopPeriod = hopPeriod;
-            SX1276.Settings.LoRa.IqInverted = iqInverted;
-            SX1276.Settings.LoRa.RxContinuous = rxContinuous;
-
-            if( datarate > 12 )
-            {
-                datarate = 12;
-            }
-            else if( datarate < 6 )
-            {
-                datarate = 6;
-            }
-
-            if( ( ( bandwidth == 7 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
-                ( ( bandwidth == 8 ) && ( datarate == 12 ) ) )
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x01;
-            }
-            else
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x00;
-            }
-
-            SX1276Write( REG_LR_MODEMCONFIG1,
-                         ( SX1276Read( REG_LR_MODEMCONFIG1 ) &
-                           RFLR_MODEMCONFIG1_BW_MASK &
-                           RFLR_MODEMCONFIG1_CODINGRATE_MASK &
-                           RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) |
-                           ( bandwidth << 4 ) | ( coderate << 1 ) |
-                           fixLen );
-
-            SX1276Write( REG_LR_MODEMCONFIG2,
-                         ( SX1276Read( REG_LR_MODEMCONFIG2 ) &
-                           RFLR_MODEMCONFIG2_SF_MASK &
-                           RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK &
-                           RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) |
-                           ( datarate << 4 ) | ( crcOn << 2 ) |
-                           ( ( symbTimeout >> 8 ) & ~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK ) );
+            RadioLoRaProfile_t profile;
 
-            SX1276Write( REG_LR_MODEMCONFIG3,
-                         ( SX1276Read( REG_LR_MODEMCONFIG3 ) &
-                           RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK ) |
-                           ( SX1276.Settings.LoRa.LowDatarateOptimize << 3 ) );
-
-            SX1276Write( REG_LR_SYMBTIMEOUTLSB, ( uint8_t )( symbTimeout & 0xFF ) );
-
-            SX1276Write( REG_LR_PREAMBLEMSB, ( uint8_t )( ( preambleLen >> 8 ) & 0xFF ) );
-            SX1276Write( REG_LR_PREAMBLELSB, ( uint8_t )( preambleLen & 0xFF ) );
-
-            if( fixLen == 1 )
-            {
-                SX1276Write( REG_LR_PAYLOADLENGTH, payloadLen );
-            }
-
-            if( SX1276.Settings.LoRa.FreqHopOn == true )
-            {
-                SX1276Write( REG_LR_PLLHOP, ( SX1276Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
-                SX1276Write( REG_LR_HOPPERIOD, SX1276.Settings.LoRa.HopPeriod );
-            }
-
-            if( ( bandwidth == 9 ) && ( SX1276.Settings.Channel > RF_MID_BAND_THRESH ) )
-            {
-                // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
-                SX1276Write( REG_LR_HIGHBWOPTIMIZE1, 0x02 );
-                SX1276Write( REG_LR_HIGHBWOPTIMIZE2, 0x64 );
-            }
-            else if( bandwidth == 9 )
-            {
-                // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
-                SX1276Write( REG_LR_HIGHBWOPTIMIZE1, 0x02 );
-                SX1276Write( REG_LR_HIGHBWOPTIMIZE2, 0x7F );
-            }
-            else
-            {
-                // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
-                SX1276Write( REG_LR_HIGHBWOPTIMIZE1, 0x03 );
-            }
-
-            if( datarate == 6 )
-            {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                               RFLR_DETECTIONOPTIMIZE_MASK ) |
-                               RFLR_DETECTIONOPTIMIZE_SF6 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF6 );
-            }
-            else
-            {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                             RFLR_DETECTIONOPTIMIZE_MASK ) |
-                             RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF7_TO_SF12 );
-            }
+            SX1276CompileLoRaRxProfile( &profile, bandwidth, datarate, coderate, preambleLen, symbTimeout, fixLen,
+                                        payloadLen, crcOn, freqHopOn, hopPeriod, iqInverted, rxContinuous );
+            SX1276ApplyLoRaProfile( &profile );
         }
         break;
     }
@@ -613,90 +697,263 @@ void SX1276SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
         break;
     case MODEM_LORA:
         {
+            RadioLoRaProfile_t profile;
+
             SX1276.Settings.LoRa.Power = power;
-            if( bandwidth > 2 )
-            {
-                // Fatal error: When using LoRa modem only bandwidths 125, 250 and 500 kHz are supported
-                while( 1 );
-            }
-            bandwidth += 7;
-            SX1276.Settings.LoRa.Bandwidth = bandwidth;
-            SX1276.Settings.LoRa.Datarate = datarate;
-            SX1276.Settings.LoRa.Coderate = coderate;
-            SX1276.Settings.LoRa.PreambleLen = preambleLen;
-            SX1276.Settings.LoRa.FixLen = fixLen;
-            SX1276.Settings.LoRa.FreqHopOn = freqHopOn;
-            SX1276.Settings.LoRa.HopPeriod = hopPeriod;
-            SX1276.Settings.LoRa.CrcOn = crcOn;
-            SX1276.Settings.LoRa.IqInverted = iqInverted;
-            SX1276.Settings.LoRa.TxTimeout = timeout;
-
-            if( datarate > 12 )
-            {
-                datarate = 12;
-            }
-            else if( datarate < 6 )
-            {
-                datarate = 6;
-            }
-            if( ( ( bandwidth == 7 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
-                ( ( bandwidth == 8 ) && ( datarate == 12 ) ) )
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x01;
-            }
-            else
-            {
-                SX1276.Settings.LoRa.LowDatarateOptimize = 0x00;
-            }
+            SX1276CompileLoRaTxProfile( &profile, bandwidth, datarate, coderate, preambleLen, fixLen, crcOn,
+                                        freqHopOn, hopPeriod, iqInverted, timeout );
+            SX1276ApplyLoRaProfile( &profile );
+        }
+        break;
+    }
+}
 
-            if( SX1276.Settings.LoRa.FreqHopOn == true )
-            {
-                SX1276Write( REG_LR_PLLHOP, ( SX1276Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
-                SX1276Write( REG_LR_HOPPERIOD, SX1276.Settings.LoRa.HopPeriod );
-            }
+static void SX1276LoRaProfileSet( RadioLoRaProfile_t *profile, uint8_t addr, uint8_t value, uint8_t mask )
+{
+    uint8_t index = 0;
 
-            SX1276Write( REG_LR_MODEMCONFIG1,
-                         ( SX1276Read( REG_LR_MODEMCONFIG1 ) &
-                           RFLR_MODEMCONFIG1_BW_MASK &
-                           RFLR_MODEMCONFIG1_CODINGRATE_MASK &
-                           RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) |
-                           ( bandwidth << 4 ) | ( coderate << 1 ) |
-                           fixLen );
-
-            SX1276Write( REG_LR_MODEMCONFIG2,
-                         ( SX1276Read( REG_LR_MODEMCONFIG2 ) &
-                           RFLR_MODEMCONFIG2_SF_MASK &
-                           RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK ) |
-                           ( datarate << 4 ) | ( crcOn << 2 ) );
-
-            SX1276Write( REG_LR_MODEMCONFIG3,
-                         ( SX1276Read( REG_LR_MODEMCONFIG3 ) &
-                           RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK ) |
-                           ( SX1276.Settings.LoRa.LowDatarateOptimize << 3 ) );
-
-            SX1276Write( REG_LR_PREAMBLEMSB, ( preambleLen >> 8 ) & 0x00FF );
-            SX1276Write( REG_LR_PREAMBLELSB, preambleLen & 0xFF );
-
-            if( datarate == 6 )
-            {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                               RFLR_DETECTIONOPTIMIZE_MASK ) |
-                               RFLR_DETECTIONOPTIMIZE_SF6 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF6 );
-            }
-            else
+    for( uint8_t i = 0; i < sizeof( LoRaProfileRuns ) / sizeof( RegRun_t ); i++ )
+    {
+        if( ( addr >= LoRaProfileRuns[i].Addr ) && ( addr < ( LoRaProfileRuns[i].Addr + LoRaProfileRuns[i].Size ) ) )
+        {
+            index += addr - LoRaProfileRuns[i].Addr;
+            profile->Value[index] = ( profile->Value[index] & ~mask ) | ( value & mask );
+            profile->Mask[index] |= mask;
+            return;
+        }
+        index += LoRaProfileRuns[i].Size;
+    }
+}
+
+static void SX1276CompileLoRaProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                      uint32_t datarate, uint8_t coderate,
+                                      uint16_t preambleLen, bool fixLen, bool crcOn,
+                                      bool freqHopOn, uint8_t hopPeriod, bool iqInverted )
+{
+    RadioLoRaSettings_t *settings = &profile->Settings;
+
+    if( bandwidth > 2 )
+    {
+        // Fatal error: When using LoRa modem only bandwidths 125, 250 and 500 kHz are supported
+        while( 1 );
+    }
+    bandwidth += 7;
+
+    memset1( ( uint8_t* )profile, 0, sizeof( RadioLoRaProfile_t ) );
+    settings->Bandwidth = bandwidth;
+    settings->Datarate = datarate;
+    settings->Coderate = coderate;
+    settings->PreambleLen = preambleLen;
+    settings->FixLen = fixLen;
+    settings->CrcOn = crcOn;
+    settings->FreqHopOn = freqHopOn;
+    settings->HopPeriod = hopPeriod;
+    settings->IqInverted = iqInverted;
+
+    if( datarate > 12 )
+    {
+        datarate = 12;
+    }
+    else if( datarate < 6 )
+    {
+        datarate = 6;
+    }
+
+    if( ( ( bandwidth == 7 ) && ( ( datarate == 11 ) || ( datarate == 12 ) ) ) ||
+        ( ( bandwidth == 8 ) && ( datarate == 12 ) ) )
+    {
+        settings->LowDatarateOptimize = 0x01;
+    }
+    else
+    {
+        settings->LowDatarateOptimize = 0x00;
+    }
+
+    SX1276LoRaProfileSet( profile, REG_LR_MODEMCONFIG1,
+                          ( bandwidth << 4 ) | ( coderate << 1 ) | fixLen,
+                          ~( RFLR_MODEMCONFIG1_BW_MASK & RFLR_MODEMCONFIG1_CODINGRATE_MASK & RFLR_MODEMCONFIG1_IMPLICITHEADER_MASK ) );
+    SX1276LoRaProfileSet( profile, REG_LR_MODEMCONFIG2,
+                          ( datarate << 4 ) | ( crcOn << 2 ),
+                          ~( RFLR_MODEMCONFIG2_SF_MASK & RFLR_MODEMCONFIG2_RXPAYLOADCRC_MASK ) );
+    SX1276LoRaProfileSet( profile, REG_LR_MODEMCONFIG3,
+                          settings->LowDatarateOptimize << 3,
+                          ( uint8_t )~RFLR_MODEMCONFIG3_LOWDATARATEOPTIMIZE_MASK );
+
+    SX1276LoRaProfileSet( profile, REG_LR_PREAMBLEMSB, ( uint8_t )( ( preambleLen >> 8 ) & 0xFF ), 0xFF );
+    SX1276LoRaProfileSet( profile, REG_LR_PREAMBLELSB, ( uint8_t )( preambleLen & 0xFF ), 0xFF );
+
+    if( datarate == 6 )
+    {
+        SX1276LoRaProfileSet( profile, REG_LR_DETECTOPTIMIZE, RFLR_DETECTIONOPTIMIZE_SF6, ( uint8_t )~RFLR_DETECTIONOPTIMIZE_MASK );
+        SX1276LoRaProfileSet( profile, REG_LR_DETECTIONTHRESHOLD, RFLR_DETECTIONTHRESH_SF6, 0xFF );
+    }
+    else
+    {
+        SX1276LoRaProfileSet( profile, REG_LR_DETECTOPTIMIZE, RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12, ( uint8_t )~RFLR_DETECTIONOPTIMIZE_MASK );
+        SX1276LoRaProfileSet( profile, REG_LR_DETECTIONTHRESHOLD, RFLR_DETECTIONTHRESH_SF7_TO_SF12, 0xFF );
+    }
+}
+
+void SX1276CompileLoRaRxProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate,
+                                 uint16_t preambleLen, uint16_t symbTimeout,
+                                 bool fixLen, uint8_t payloadLen,
+                                 bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, bool rxContinuous )
+{
+    SX1276CompileLoRaProfile( profile, bandwidth, datarate, coderate, preambleLen, fixLen, crcOn,
+                              freqHopOn, hopPeriod, iqInverted );
+    profile->Rx = true;
+    profile->Settings.PayloadLen = payloadLen;
+    profile->Settings.RxContinuous = rxContinuous;
+
+    // The symbol timeout is split across two registers
+    SX1276LoRaProfileSet( profile, REG_LR_MODEMCONFIG2,
+                          ( symbTimeout >> 8 ) & ~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK,
+                          ( uint8_t )~RFLR_MODEMCONFIG2_SYMBTIMEOUTMSB_MASK );
+    SX1276LoRaProfileSet( profile, REG_LR_SYMBTIMEOUTLSB, ( uint8_t )( symbTimeout & 0xFF ), 0xFF );
+
+    if( fixLen == 1 )
+    {
+        SX1276LoRaProfileSet( profile, REG_LR_PAYLOADLENGTH, payloadLen, 0xFF );
+    }
+
+    // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
+    SX1276LoRaProfileSet( profile, REG_LR_HIGHBWOPTIMIZE1, ( profile->Settings.Bandwidth == 9 ) ? 0x02 : 0x03, 0xFF );
+}
+
+void SX1276CompileLoRaTxProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate,
+                                 uint16_t preambleLen, bool fixLen, bool crcOn,
+                                 bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, uint32_t timeout )
+{
+    SX1276CompileLoRaProfile( profile, bandwidth, datarate, coderate, preambleLen, fixLen, crcOn,
+                              freqHopOn, hopPeriod, iqInverted );
+    profile->Rx = false;
+    profile->Settings.TxTimeout = timeout;
+}
+
+void SX1276ApplyLoRaProfile( const RadioLoRaProfile_t *profile )
+{
+    const RadioLoRaSettings_t *settings = &profile->Settings;
+    uint8_t buffer[LORA_PROFILE_MAX_RUN_SIZE];
+    uint8_t index = 0;
+
+    if( SX1276.Settings.Modem != MODEM_LORA )
+    {
+        SX1276SetModem( MODEM_LORA );
+    }
+
+    SX1276.Settings.LoRa.Bandwidth = settings->Bandwidth;
+    SX1276.Settings.LoRa.Datarate = settings->Datarate;
+    SX1276.Settings.LoRa.Coderate = settings->Coderate;
+    SX1276.Settings.LoRa.PreambleLen = settings->PreambleLen;
+    SX1276.Settings.LoRa.FixLen = settings->FixLen;
+    SX1276.Settings.LoRa.CrcOn = settings->CrcOn;
+    SX1276.Settings.LoRa.FreqHopOn = settings->FreqHopOn;
+    SX1276.Settings.LoRa.HopPeriod = settings->HopPeriod;
+    SX1276.Settings.LoRa.IqInverted = settings->IqInverted;
+    SX1276.Settings.LoRa.LowDatarateOptimize = settings->LowDatarateOptimize;
+    if( profile->Rx == true )
+    {
+        SX1276.Settings.LoRa.PayloadLen = settings->PayloadLen;
+        SX1276.Settings.LoRa.RxContinuous = settings->RxContinuous;
+    }
+    else
+    {
+        SX1276.Settings.LoRa.TxTimeout = settings->TxTimeout;
+    }
+
+    if( settings->FreqHopOn == true )
+    {
+        SX1276Write( REG_LR_PLLHOP, ( SX1276Read( REG_LR_PLLHOP ) & RFLR_PLLHOP_FASTHOP_MASK ) | RFLR_PLLHOP_FASTHOP_ON );
+        SX1276Write( REG_LR_HOPPERIOD, settings->HopPeriod );
+    }
+    else
+    {
+        // A null hop period disables the hopping of a previous configuration
+        SX1276Write( REG_LR_HOPPERIOD, 0 );
+    }
+
+    for( uint8_t i = 0; i < sizeof( LoRaProfileRuns ) / sizeof( RegRun_t ); i++ )
+    {
+        uint8_t addr = LoRaProfileRuns[i].Addr;
+        uint8_t size = LoRaProfileRuns[i].Size;
+        bool changed = false;
+
+        for( uint8_t j = 0; j < size; j++ )
+        {
+            const uint8_t mask = profile->Mask[index + j];
+
+            // The bits not set by the profile are kept. Their value comes from the register shadow.
+            buffer[j] = ( mask != 0xFF ) ? ( SX1276Read( addr + j ) & ~mask ) : 0;
+            buffer[j] |= profile->Value[index + j] & mask;
+            if( SX1276RegShadowHolds( addr + j, buffer[j] ) == false )
             {
-                SX1276Write( REG_LR_DETECTOPTIMIZE,
-                             ( SX1276Read( REG_LR_DETECTOPTIMIZE ) &
-                             RFLR_DETECTIONOPTIMIZE_MASK ) |
-                             RFLR_DETECTIONOPTIMIZE_SF7_TO_SF12 );
-                SX1276Write( REG_LR_DETECTIONTHRESHOLD,
-                             RFLR_DETECTIONTHRESH_SF7_TO_SF12 );
+                changed = true;
             }
         }
-        break;
+        if( changed == true )
+        {
+            SX1276WriteBuffer( addr, buffer, size );
+        }
+        index += size;
+    }
+
+    if( ( profile->Rx == true ) && ( settings->Bandwidth == 9 ) )
+    {
+        // ERRATA 2.1 - Sensitivity Optimization with a 500 kHz Bandwidth
+        SX1276Write( REG_LR_HIGHBWOPTIMIZE2, ( SX1276.Settings.Channel > RF_MID_BAND_THRESH ) ? 0x64 : 0x7F );
+    }
+}
+
+void SX1276SetHopTable( const uint32_t *channels, uint8_t nbChannels, uint32_t seed )
+{
+    uint32_t state = ( seed != 0 ) ? seed : 1;
+
+    if( nbChannels > FHSS_MAX_NB_CHANNELS )
+    {
+        nbChannels = FHSS_MAX_NB_CHANNELS;
+    }
+
+    for( uint8_t i = 0; i < nbChannels; i++ )
+    {
+        uint32_t frf = ( uint32_t )( ( double )channels[i] / ( double )FREQ_STEP );
+
+        FhssHopTable.Frf[i][0] = ( uint8_t )( ( frf >> 16 ) & 0xFF );
+        FhssHopTable.Frf[i][1] = ( uint8_t )( ( frf >> 8 ) & 0xFF );
+        FhssHopTable.Frf[i][2] = ( uint8_t )( frf & 0xFF );
+    }
+
+    // Fisher-Yates shuffle driven by a xorshift generator
+    for( uint8_t i = nbChannels; i > 1; i-- )
+    {
+        uint8_t j;
+        uint8_t frf[3];
+
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        j = state % i;
+
+        memcpy1( frf, FhssHopTable.Frf[i - 1], 3 );
+        memcpy1( FhssHopTable.Frf[i - 1], FhssHopTable.Frf[j], 3 );
+        memcpy1( FhssHopTable.Frf[j], frf, 3 );
+    }
+    FhssHopTable.NbChannels = nbChannels;
+    FhssHopTable.Index = 0;
+}
+
+static void SX1276FhssHop( void )
+{
+    if( FhssHopTable.NbChannels != 0 )
+    {
+        SX1276WriteBuffer( REG_LR_FRFMSB, FhssHopTable.Frf[FhssHopTable.Index], 3 );
+        if( ++FhssHopTable.Index >= FhssHopTable.NbChannels )
+        {
+            FhssHopTable.Index = 0;
+        }
     }
 }
 
@@ -864,7 +1121,7 @@ void SX1276SetSleep( void )
     // Disable TCXO radio is in SLEEP mode
     SX1276SetBoardTcxo( false );
 
-    SX1276.Settings.State = RF_IDLE;
+    SX1276SetState( RF_IDLE );
 }
 
 void SX1276SetStby( void )
@@ -874,7 +1131,7 @@ void SX1276SetStby( void )
     TimerStop( &RxTimeoutSyncWord );
 
     SX1276SetOpMode( RF_OPMODE_STANDBY );
-    SX1276.Settings.State = RF_IDLE;
+    SX1276SetState( RF_IDLE );
 }
 
 void SX1276SetRx( uint32_t timeout )
@@ -991,6 +1248,7 @@ void SX1276SetRx( uint32_t timeout )
 
                 // DIO0=RxDone, DIO2=FhssChangeChannel
                 SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK  ) | RFLR_DIOMAPPING1_DIO0_00 | RFLR_DIOMAPPING1_DIO2_00 );
+                FhssHopTable.Index = 0;
             }
             else
             {
@@ -1014,7 +1272,7 @@ void SX1276SetRx( uint32_t timeout )
 
     memset( RxTxBuffer, 0, ( size_t )RX_BUFFER_SIZE );
 
-    SX1276.Settings.State = RF_RX_RUNNING;
+    SX1276SetState( RF_RX_RUNNING );
     if( timeout != 0 )
     {
         TimerSetValue( &RxTimeoutTimer, timeout );
@@ -1082,6 +1340,7 @@ void SX1276SetTx( uint32_t timeout )
 
                 // DIO0=TxDone, DIO2=FhssChangeChannel
                 SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO0_MASK & RFLR_DIOMAPPING1_DIO2_MASK ) | RFLR_DIOMAPPING1_DIO0_01 | RFLR_DIOMAPPING1_DIO2_00 );
+                FhssHopTable.Index = 0;
             }
             else
             {
@@ -1101,7 +1360,7 @@ void SX1276SetTx( uint32_t timeout )
         break;
     }
 
-    SX1276.Settings.State = RF_TX_RUNNING;
+    SX1276SetState( RF_TX_RUNNING );
     TimerStart( &TxTimeoutTimer );
     SX1276SetOpMode( RF_OPMODE_TRANSMITTER );
 }
@@ -1130,7 +1389,7 @@ void SX1276StartCad( void )
             // DIO3=CADDone
             SX1276Write( REG_DIOMAPPING1, ( SX1276Read( REG_DIOMAPPING1 ) & RFLR_DIOMAPPING1_DIO3_MASK ) | RFLR_DIOMAPPING1_DIO3_00 );
 
-            SX1276.Settings.State = RF_CAD;
+            SX1276SetState( RF_CAD );
             SX1276SetOpMode( RFLR_OPMODE_CAD );
         }
         break;
@@ -1154,7 +1413,7 @@ void SX1276SetTxContinuousWave( uint32_t freq, int8_t power, uint16_t time )
 
     TimerSetValue( &TxTimeoutTimer, timeout );
 
-    SX1276.Settings.State = RF_TX_RUNNING;
+    SX1276SetState( RF_TX_RUNNING );
     TimerStart( &TxTimeoutTimer );
     SX1276SetOpMode( RF_OPMODE_TRANSMITTER );
 }
@@ -1235,6 +1494,9 @@ void SX1276SetModem( RadioModems_t modem )
         return;
     }
 
+    // The register shadow is only valid for the current modem
+    SX1276RegShadowInvalidate( );
+
     SX1276.Settings.Modem = modem;
     switch( SX1276.Settings.Modem )
     {
@@ -1256,51 +1518,159 @@ void SX1276SetModem( RadioModems_t modem )
     }
 }
 
+static bool SX1276RegIsShadowed( uint16_t addr )
+{
+    if( addr >= REG_SHADOW_SIZE )
+    {
+        return false;
+    }
+    if( SX1276.Settings.Modem == MODEM_LORA )
+    {
+        switch( addr )
+        {
+        case REG_LR_FIFO:
+        case REG_LR_OPMODE:
+        case REG_LR_LNA:
+        case REG_LR_FIFOADDRPTR:
+        case REG_LR_FIFORXCURRENTADDR:
+        case REG_LR_IRQFLAGS:
+        case REG_LR_RXNBBYTES:
+        case REG_LR_RXHEADERCNTVALUEMSB:
+        case REG_LR_RXHEADERCNTVALUELSB:
+        case REG_LR_RXPACKETCNTVALUEMSB:
+        case REG_LR_RXPACKETCNTVALUELSB:
+        case REG_LR_MODEMSTAT:
+        case REG_LR_PKTSNRVALUE:
+        case REG_LR_PKTRSSIVALUE:
+        case REG_LR_RSSIVALUE:
+        case REG_LR_HOPCHANNEL:
+        case REG_LR_FIFORXBYTEADDR:
+        case REG_LR_FEIMSB:
+        case REG_LR_FEIMID:
+        case REG_LR_FEILSB:
+        case REG_LR_RSSIWIDEBAND:
+        case REG_LR_FORMERTEMP:
+            return false;
+        default:
+            return true;
+        }
+    }
+    else
+    {
+        switch( addr )
+        {
+        case REG_FIFO:
+        case REG_OPMODE:
+        case REG_LNA:
+        case REG_RXCONFIG:
+        case REG_RSSIVALUE:
+        case REG_AFCFEI:
+        case REG_AFCMSB:
+        case REG_AFCLSB:
+        case REG_FEIMSB:
+        case REG_FEILSB:
+        case REG_OSC:
+        case REG_SEQCONFIG1:
+        case REG_IMAGECAL:
+        case REG_TEMP:
+        case REG_IRQFLAGS1:
+        case REG_IRQFLAGS2:
+        case REG_FORMERTEMP:
+            return false;
+        default:
+            return true;
+        }
+    }
+}
+
+static void SX1276RegShadowInvalidate( void )
+{
+    memset1( RegShadowValid, 0, sizeof( RegShadowValid ) );
+}
+
+static void SX1276RegShadowUpdate( uint16_t addr, uint8_t *buffer, uint8_t size )
+{
+    if( addr == 0 )
+    {
+        // FIFO accesses don't increment the address
+        return;
+    }
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        if( ( addr + i ) >= REG_SHADOW_SIZE )
+        {
+            break;
+        }
+        if( SX1276RegIsShadowed( addr + i ) == true )
+        {
+            RegShadow[addr + i] = buffer[i];
+            RegShadowValid[( addr + i ) >> 3] |= 1 << ( ( addr + i ) & 0x07 );
+        }
+    }
+}
+
+static bool SX1276RegShadowHolds( uint16_t addr, uint8_t value )
+{
+    return ( SX1276RegIsShadowed( addr ) == true ) &&
+           ( ( RegShadowValid[addr >> 3] & ( 1 << ( addr & 0x07 ) ) ) != 0 ) &&
+           ( RegShadow[addr] == value );
+}
+
 void SX1276Write( uint16_t addr, uint8_t data )
 {
+    if( SX1276RegShadowHolds( addr, data ) == true )
+    {
+        // The register already holds the value
+        return;
+    }
     SX1276WriteBuffer( addr, &data, 1 );
 }
 
 uint8_t SX1276Read( uint16_t addr )
 {
     uint8_t data;
+
+    if( ( SX1276RegIsShadowed( addr ) == true ) &&
+        ( ( RegShadowValid[addr >> 3] & ( 1 << ( addr & 0x07 ) ) ) != 0 ) )
+    {
+        return RegShadow[addr];
+    }
     SX1276ReadBuffer( addr, &data, 1 );
     return data;
 }
 
 void SX1276WriteBuffer( uint16_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
+    SX1276FifoTransferWait( );
 
     //NSS = 0;
     GpioWrite( &SX1276.Spi.Nss, 0 );
+    SX1276.Stats.SpiCnt++;
 
     SpiInOut( &SX1276.Spi, addr | 0x80 );
-    for( i = 0; i < size; i++ )
-    {
-        SpiInOut( &SX1276.Spi, buffer[i] );
-    }
+    SpiTransfer( &SX1276.Spi, buffer, NULL, size );
 
     //NSS = 1;
     GpioWrite( &SX1276.Spi.Nss, 1 );
+
+    SX1276RegShadowUpdate( addr, buffer, size );
 }
 
 void SX1276ReadBuffer( uint16_t addr, uint8_t *buffer, uint8_t size )
 {
-    uint8_t i;
+    SX1276FifoTransferWait( );
 
     //NSS = 0;
     GpioWrite( &SX1276.Spi.Nss, 0 );
+    SX1276.Stats.SpiCnt++;
 
     SpiInOut( &SX1276.Spi, addr & 0x7F );
-
-    for( i = 0; i < size; i++ )
-    {
-        buffer[i] = SpiInOut( &SX1276.Spi, 0 );
-    }
+    SpiTransfer( &SX1276.Spi, NULL, buffer, size );
 
     //NSS = 1;
     GpioWrite( &SX1276.Spi.Nss, 1 );
+
+    SX1276RegShadowUpdate( addr, buffer, size );
 }
 
 void SX1276WriteFifo( uint8_t *buffer, uint8_t size )
@@ -1313,6 +1683,137 @@ void SX1276ReadFifo( uint8_t *buffer, uint8_t size )
     SX1276ReadBuffer( 0, buffer, size );
 }
 
+static void SX1276FifoTransferStart( uint8_t addr, const uint8_t *txBuffer, uint8_t *rxBuffer, uint8_t size )
+{
+    SX1276FifoTransferWait( );
+
+    if( size == 0 )
+    {
+        return;
+    }
+
+    //NSS = 0;
+    GpioWrite( &SX1276.Spi.Nss, 0 );
+    SX1276.Stats.SpiCnt++;
+
+    SpiInOut( &SX1276.Spi, addr );
+
+    FskFifo.Busy = true;
+    SpiSetTransferCallback( &SX1276.Spi, SX1276OnFifoTransferDone, NULL );
+    SpiTransfer( &SX1276.Spi, txBuffer, rxBuffer, size );
+}
+
+static void SX1276FifoTransferWait( void )
+{
+    // The SPI DMA completion interrupt has a higher priority than the DIO ones
+    while( FskFifo.Busy == true )
+    {
+    }
+}
+
+static void SX1276OnFifoTransferDone( void* context )
+{
+    // Restores the blocking transfers
+    SpiSetTransferCallback( &SX1276.Spi, NULL, NULL );
+
+    //NSS = 1;
+    GpioWrite( &SX1276.Spi.Nss, 1 );
+
+    FskFifo.Busy = false;
+}
+
+static void SX1276FskReadPayloadSize( void )
+{
+    if( SX1276.Settings.Fsk.FixLen == false )
+    {
+        uint8_t size = 0;
+
+        SX1276ReadFifo( &size, 1 );
+        SX1276.Settings.FskPacketHandler.Size = size;
+    }
+    else
+    {
+        SX1276.Settings.FskPacketHandler.Size = ( ( uint16_t )( SX1276Read( REG_PACKETCONFIG2 ) & ~RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) << 8 ) |
+                                                SX1276Read( REG_PAYLOADLENGTH );
+    }
+    FskFifo.PendingSize = 0;
+}
+
+static void SX1276FskReadChunk( uint16_t size, bool last )
+{
+    uint8_t readyIndex = FskFifo.Index;
+    uint16_t readyOffset = FskFifo.PendingOffset;
+    uint8_t readySize = FskFifo.PendingSize;
+
+    if( FskFifo.Sink == NULL )
+    {
+        if( last == true )
+        {
+            SX1276ReadFifo( RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes, size );
+        }
+        else
+        {
+            SX1276FifoTransferStart( 0x00, NULL, RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes, size );
+        }
+        SX1276.Settings.FskPacketHandler.NbBytes += size;
+        return;
+    }
+
+    if( size > FSK_FIFO_SIZE )
+    {
+        // The FIFO can't hold more bytes, the missing ones have been overrun
+        size = FSK_FIFO_SIZE;
+    }
+
+    // The chunk handed to the sink below must have been filled
+    SX1276FifoTransferWait( );
+
+    FskFifo.Index ^= 1;
+    FskFifo.PendingOffset = SX1276.Settings.FskPacketHandler.NbBytes;
+    FskFifo.PendingSize = size;
+    if( last == true )
+    {
+        SX1276ReadFifo( FskFifo.Chunk[FskFifo.Index], size );
+    }
+    else
+    {
+        SX1276FifoTransferStart( 0x00, NULL, FskFifo.Chunk[FskFifo.Index], size );
+    }
+    SX1276.Settings.FskPacketHandler.NbBytes += size;
+
+    if( readySize != 0 )
+    {
+        FskFifo.Sink( FskFifo.Chunk[readyIndex], readyOffset, readySize );
+    }
+    if( ( last == true ) && ( size != 0 ) )
+    {
+        FskFifo.Sink( FskFifo.Chunk[FskFifo.Index], FskFifo.PendingOffset, size );
+    }
+    if( last == true )
+    {
+        FskFifo.PendingSize = 0;
+    }
+}
+
+void SX1276SetFskStreamSink( SX1276FskStreamSink_t *sink, uint16_t payloadLen )
+{
+    if( ( sink == NULL ) || ( payloadLen > FSK_MAX_PAYLOAD_LENGTH ) )
+    {
+        payloadLen = SX1276.Settings.Fsk.PayloadLen;
+    }
+
+    SX1276FifoTransferWait( );
+    FskFifo.Sink = sink;
+    FskFifo.PendingSize = 0;
+
+    if( ( SX1276.Settings.Modem == MODEM_FSK ) && ( SX1276.Settings.Fsk.FixLen == true ) )
+    {
+        SX1276Write( REG_PACKETCONFIG2, ( SX1276Read( REG_PACKETCONFIG2 ) & RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) |
+                                        ( ( payloadLen >> 8 ) & ~RF_PACKETCONFIG2_PAYLOADLENGTH_MSB_MASK ) );
+        SX1276Write( REG_PAYLOADLENGTH, ( uint8_t )payloadLen );
+    }
+}
+
 void SX1276SetMaxPayloadLength( RadioModems_t modem, uint8_t max )
 {
     SX1276SetModem( modem );
@@ -1352,6 +1853,39 @@ uint32_t SX1276GetWakeupTime( void )
     return SX1276GetBoardTcxoWakeupTime( ) + RADIO_WAKEUP_TIME;
 }
 
+static void SX1276SetState( RadioState_t state )
+{
+    TimerTime_t now = TimerGetCurrentTime( );
+
+    if( SX1276.Settings.State == RF_TX_RUNNING )
+    {
+        SX1276.Stats.TxTime += now - StatsStateStartTime;
+    }
+    else if( SX1276.Settings.State != RF_IDLE )
+    {
+        SX1276.Stats.RxTime += now - StatsStateStartTime;
+    }
+    StatsStateStartTime = now;
+    SX1276.Settings.State = state;
+}
+
+void SX1276GetStats( RadioStats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    // Account for the time spent in the current state
+    SX1276SetState( SX1276.Settings.State );
+    *stats = SX1276.Stats;
+    CRITICAL_SECTION_END( );
+}
+
+void SX1276ResetStats( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    memset1( ( uint8_t* )&SX1276.Stats, 0, sizeof( RadioStats_t ) );
+    StatsStateStartTime = TimerGetCurrentTime( );
+    CRITICAL_SECTION_END( );
+}
+
 void SX1276OnTimeoutIrq( void* context )
 {
     switch( SX1276.Settings.State )
@@ -1378,10 +1912,11 @@ void SX1276OnTimeoutIrq( void* context )
             }
             else
             {
-                SX1276.Settings.State = RF_IDLE;
+                SX1276SetState( RF_IDLE );
                 TimerStop( &RxTimeoutSyncWord );
             }
         }
+        SX1276.Stats.RxTimeoutCnt++;
         if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
         {
             RadioEvents->RxTimeout( );
@@ -1398,6 +1933,8 @@ void SX1276OnTimeoutIrq( void* context )
 
         // Reset the radio
         SX1276Reset( );
+        SX1276RegShadowInvalidate( );
+        SX1276.Settings.Modem = MODEM_FSK;
 
         // Calibrate Rx chain
         RxChainCalibration( );
@@ -1416,7 +1953,8 @@ void SX1276OnTimeoutIrq( void* context )
         SX1276SetPublicNetwork( SX1276.Settings.LoRa.PublicNetwork );
         // END WORKAROUND
 
-        SX1276.Settings.State = RF_IDLE;
+        SX1276SetState( RF_IDLE );
+        SX1276.Stats.TxTimeoutCnt++;
         if( ( RadioEvents != NULL ) && ( RadioEvents->TxTimeout != NULL ) )
         {
             RadioEvents->TxTimeout( );
@@ -1427,8 +1965,11 @@ void SX1276OnTimeoutIrq( void* context )
     }
 }
 
-void SX1276OnDio0Irq( void* context )
+LORAMAC_HOT void SX1276OnDio0Irq( void* context )
 {
+    Dio0IrqTicks = TimerGetCurrentTicks( );
+    TRACE_BEGIN( TRACE_PROBE_RADIO_IRQ );
+
     volatile uint8_t irqFlags = 0;
 
     switch( SX1276.Settings.State )
@@ -1455,7 +1996,7 @@ void SX1276OnDio0Irq( void* context )
                         if( SX1276.Settings.Fsk.RxContinuous == false )
                         {
                             TimerStop( &RxTimeoutSyncWord );
-                            SX1276.Settings.State = RF_IDLE;
+                            SX1276SetState( RF_IDLE );
                         }
                         else
                         {
@@ -1464,6 +2005,7 @@ void SX1276OnDio0Irq( void* context )
                             TimerStart( &RxTimeoutSyncWord );
                         }
 
+                        SX1276.Stats.RxCrcErrorCnt++;
                         if( ( RadioEvents != NULL ) && ( RadioEvents->RxError != NULL ) )
                         {
                             RadioEvents->RxError( );
@@ -1479,28 +2021,16 @@ void SX1276OnDio0Irq( void* context )
                 // Read received packet size
                 if( ( SX1276.Settings.FskPacketHandler.Size == 0 ) && ( SX1276.Settings.FskPacketHandler.NbBytes == 0 ) )
                 {
-                    if( SX1276.Settings.Fsk.FixLen == false )
-                    {
-                        SX1276ReadFifo( ( uint8_t* )&SX1276.Settings.FskPacketHandler.Size, 1 );
-                    }
-                    else
-                    {
-                        SX1276.Settings.FskPacketHandler.Size = SX1276Read( REG_PAYLOADLENGTH );
-                    }
-                    SX1276ReadFifo( RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes, SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
-                    SX1276.Settings.FskPacketHandler.NbBytes += ( SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
-                }
-                else
-                {
-                    SX1276ReadFifo( RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes, SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
-                    SX1276.Settings.FskPacketHandler.NbBytes += ( SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
+                    SX1276FskReadPayloadSize( );
                 }
+                // Read the last chunk once the chunks read upon FifoLevel are done
+                SX1276FskReadChunk( SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes, true );
 
                 TimerStop( &RxTimeoutTimer );
 
                 if( SX1276.Settings.Fsk.RxContinuous == false )
                 {
-                    SX1276.Settings.State = RF_IDLE;
+                    SX1276SetState( RF_IDLE );
                     TimerStop( &RxTimeoutSyncWord );
                 }
                 else
@@ -1510,9 +2040,14 @@ void SX1276OnDio0Irq( void* context )
                     TimerStart( &RxTimeoutSyncWord );
                 }
 
-                if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+                SX1276.Stats.RxCnt++;
+                if( ( RadioEvents != NULL ) && ( RadioEvents->RxDoneTimestamped != NULL ) )
+                {
+                    RadioEvents->RxDoneTimestamped( ( FskFifo.Sink == NULL ) ? RxTxBuffer : NULL, SX1276.Settings.FskPacketHandler.Size, SX1276.Settings.FskPacketHandler.RssiValue, 0, Dio0IrqTicks );
+                }
+                else if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
                 {
-                    RadioEvents->RxDone( RxTxBuffer, SX1276.Settings.FskPacketHandler.Size, SX1276.Settings.FskPacketHandler.RssiValue, 0 );
+                    RadioEvents->RxDone( ( FskFifo.Sink == NULL ) ? RxTxBuffer : NULL, SX1276.Settings.FskPacketHandler.Size, SX1276.Settings.FskPacketHandler.RssiValue, 0 );
                 }
                 SX1276.Settings.FskPacketHandler.PreambleDetected = false;
                 SX1276.Settings.FskPacketHandler.SyncWordDetected = false;
@@ -1532,10 +2067,11 @@ void SX1276OnDio0Irq( void* context )
 
                         if( SX1276.Settings.LoRa.RxContinuous == false )
                         {
-                            SX1276.Settings.State = RF_IDLE;
+                            SX1276SetState( RF_IDLE );
                         }
                         TimerStop( &RxTimeoutTimer );
 
+                        SX1276.Stats.RxCrcErrorCnt++;
                         if( ( RadioEvents != NULL ) && ( RadioEvents->RxError != NULL ) )
                         {
                             RadioEvents->RxError( );
@@ -1578,11 +2114,16 @@ void SX1276OnDio0Irq( void* context )
 
                     if( SX1276.Settings.LoRa.RxContinuous == false )
                     {
-                        SX1276.Settings.State = RF_IDLE;
+                        SX1276SetState( RF_IDLE );
                     }
                     TimerStop( &RxTimeoutTimer );
 
-                    if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
+                    SX1276.Stats.RxCnt++;
+                    if( ( RadioEvents != NULL ) && ( RadioEvents->RxDoneTimestamped != NULL ) )
+                    {
+                        RadioEvents->RxDoneTimestamped( RxTxBuffer, SX1276.Settings.LoRaPacketHandler.Size, SX1276.Settings.LoRaPacketHandler.RssiValue, SX1276.Settings.LoRaPacketHandler.SnrValue, Dio0IrqTicks );
+                    }
+                    else if( ( RadioEvents != NULL ) && ( RadioEvents->RxDone != NULL ) )
                     {
                         RadioEvents->RxDone( RxTxBuffer, SX1276.Settings.LoRaPacketHandler.Size, SX1276.Settings.LoRaPacketHandler.RssiValue, SX1276.Settings.LoRaPacketHandler.SnrValue );
                     }
@@ -1603,8 +2144,13 @@ void SX1276OnDio0Irq( void* context )
                 // Intentional fall through
             case MODEM_FSK:
             default:
-                SX1276.Settings.State = RF_IDLE;
-                if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
+                SX1276SetState( RF_IDLE );
+                SX1276.Stats.TxCnt++;
+                if( ( RadioEvents != NULL ) && ( RadioEvents->TxDoneTimestamped != NULL ) )
+                {
+                    RadioEvents->TxDoneTimestamped( Dio0IrqTicks );
+                }
+                else if( ( RadioEvents != NULL ) && ( RadioEvents->TxDone != NULL ) )
                 {
                     RadioEvents->TxDone( );
                 }
@@ -1614,6 +2160,7 @@ void SX1276OnDio0Irq( void* context )
         default:
             break;
     }
+    TRACE_END( TRACE_PROBE_RADIO_IRQ );
 }
 
 void SX1276OnDio1Irq( void* context )
@@ -1631,14 +2178,7 @@ void SX1276OnDio1Irq( void* context )
                 // Read received packet size
                 if( ( SX1276.Settings.FskPacketHandler.Size == 0 ) && ( SX1276.Settings.FskPacketHandler.NbBytes == 0 ) )
                 {
-                    if( SX1276.Settings.Fsk.FixLen == false )
-                    {
-                        SX1276ReadFifo( ( uint8_t* )&SX1276.Settings.FskPacketHandler.Size, 1 );
-                    }
-                    else
-                    {
-                        SX1276.Settings.FskPacketHandler.Size = SX1276Read( REG_PAYLOADLENGTH );
-                    }
+                    SX1276FskReadPayloadSize( );
                 }
 
                 // ERRATA 3.1 - PayloadReady Set for 31.25ns if FIFO is Empty
@@ -1650,13 +2190,11 @@ void SX1276OnDio1Irq( void* context )
                 //              when FifoLevel fires
                 if( ( SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes ) >= SX1276.Settings.FskPacketHandler.FifoThresh )
                 {
-                    SX1276ReadFifo( ( RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes ), SX1276.Settings.FskPacketHandler.FifoThresh - 1 );
-                    SX1276.Settings.FskPacketHandler.NbBytes += SX1276.Settings.FskPacketHandler.FifoThresh - 1;
+                    SX1276FskReadChunk( SX1276.Settings.FskPacketHandler.FifoThresh - 1, false );
                 }
                 else
                 {
-                    SX1276ReadFifo( ( RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes ), SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
-                    SX1276.Settings.FskPacketHandler.NbBytes += ( SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
+                    SX1276FskReadChunk( SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes, false );
                 }
                 break;
             case MODEM_LORA:
@@ -1665,7 +2203,8 @@ void SX1276OnDio1Irq( void* context )
                 // Clear Irq
                 SX1276Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_RXTIMEOUT );
 
-                SX1276.Settings.State = RF_IDLE;
+                SX1276SetState( RF_IDLE );
+                SX1276.Stats.RxTimeoutCnt++;
                 if( ( RadioEvents != NULL ) && ( RadioEvents->RxTimeout != NULL ) )
                 {
                     RadioEvents->RxTimeout( );
@@ -1682,13 +2221,13 @@ void SX1276OnDio1Irq( void* context )
                 // FifoEmpty interrupt
                 if( ( SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes ) > SX1276.Settings.FskPacketHandler.ChunkSize )
                 {
-                    SX1276WriteFifo( ( RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes ), SX1276.Settings.FskPacketHandler.ChunkSize );
+                    SX1276FifoTransferStart( 0x80, RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes, NULL, SX1276.Settings.FskPacketHandler.ChunkSize );
                     SX1276.Settings.FskPacketHandler.NbBytes += SX1276.Settings.FskPacketHandler.ChunkSize;
                 }
                 else
                 {
                     // Write the last chunk of data
-                    SX1276WriteFifo( RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes, SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
+                    SX1276FifoTransferStart( 0x80, RxTxBuffer + SX1276.Settings.FskPacketHandler.NbBytes, NULL, SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes );
                     SX1276.Settings.FskPacketHandler.NbBytes += SX1276.Settings.FskPacketHandler.Size - SX1276.Settings.FskPacketHandler.NbBytes;
                 }
                 break;
@@ -1734,6 +2273,8 @@ void SX1276OnDio2Irq( void* context )
             case MODEM_LORA:
                 if( SX1276.Settings.LoRa.FreqHopOn == true )
                 {
+                    SX1276FhssHop( );
+
                     // Clear Irq
                     SX1276Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL );
 
@@ -1755,6 +2296,8 @@ void SX1276OnDio2Irq( void* context )
             case MODEM_LORA:
                 if( SX1276.Settings.LoRa.FreqHopOn == true )
                 {
+                    SX1276FhssHop( );
+
                     // Clear Irq
                     SX1276Write( REG_LR_IRQFLAGS, RFLR_IRQFLAGS_FHSSCHANGEDCHANNEL );
 
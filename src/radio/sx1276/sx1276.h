@@ -114,6 +114,28 @@ typedef struct
     uint8_t Size;
 }RadioLoRaPacketHandler_t;
 
+/*!
+ * Maximum number of channels of the frequency hopping table
+ */
+#define FHSS_MAX_NB_CHANNELS                        72
+
+/*!
+ * Number of registers held by a LoRa configuration profile
+ */
+#define LORA_PROFILE_NB_REGS                        10
+
+/*!
+ * Radio LoRa configuration profile. Register image of a reception or
+ * transmission configuration, compiled once and applied by burst writes.
+ */
+typedef struct
+{
+    RadioLoRaSettings_t Settings;                   //!< Driver settings of the configuration
+    bool                Rx;                         //!< Set for a reception configuration
+    uint8_t             Value[LORA_PROFILE_NB_REGS];//!< Registers image
+    uint8_t             Mask[LORA_PROFILE_NB_REGS]; //!< Registers bits set by the profile
+}RadioLoRaProfile_t;
+
 /*!
  * Radio Settings
  */
@@ -142,6 +164,7 @@ typedef struct SX1276_s
     Gpio_t        DIO5;
     Spi_t         Spi;
     RadioSettings_t Settings;
+    RadioStats_t  Stats;
 }SX1276_t;
 
 /*!
@@ -149,6 +172,17 @@ typedef struct SX1276_s
  */
 typedef void ( DioIrqHandler )( void* context );
 
+/*!
+ * \brief FSK stream sink, receives the payload of the FSK packets chunk by chunk
+ *
+ * \remark Called from interrupt context while the next chunk is read off the FIFO
+ *
+ * \param [IN] chunk  Payload chunk, only valid until the function returns
+ * \param [IN] offset Offset of the chunk in the payload
+ * \param [IN] size   Chunk size
+ */
+typedef void ( SX1276FskStreamSink_t )( const uint8_t *chunk, uint16_t offset, uint8_t size );
+
 /*!
  * SX1276 definitions
  */
@@ -157,6 +191,21 @@ typedef void ( DioIrqHandler )( void* context );
 
 #define RX_BUFFER_SIZE                              256
 
+/*!
+ * Size of the FIFO in FSK mode
+ */
+#define FSK_FIFO_SIZE                               64
+
+/*!
+ * Maximum payload length of a FSK packet in fixed length mode
+ */
+#define FSK_MAX_PAYLOAD_LENGTH                      2047
+
+/*!
+ * Number of registers held by the register shadow
+ */
+#define REG_SHADOW_SIZE                             0x80
+
 /*!
  * ============================================================================
  * Public functions prototypes
@@ -307,6 +356,66 @@ void SX1276SetTxConfig( RadioModems_t modem, int8_t power, uint32_t fdev,
                         bool fixLen, bool crcOn, bool freqHopOn,
                         uint8_t hopPeriod, bool iqInverted, uint32_t timeout );
 
+/*!
+ * \brief Compiles a LoRa reception configuration into a profile
+ *
+ * \remark The parameters are the LoRa ones of \ref SX1276SetRxConfig
+ *
+ * \param [OUT] profile     Compiled profile
+ * \param [IN] bandwidth    Bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \param [IN] datarate     Spreading factor [6..12]
+ * \param [IN] coderate     Coding rate [1: 4/5, 2: 4/6, 3: 4/7, 4: 4/8]
+ * \param [IN] preambleLen  Preamble length in symbols
+ * \param [IN] symbTimeout  RxSingle timeout in symbols
+ * \param [IN] fixLen       Fixed length packets [0: variable, 1: fixed]
+ * \param [IN] payloadLen   Payload length when fixed length is used
+ * \param [IN] crcOn        Enables/Disables the CRC [0: OFF, 1: ON]
+ * \param [IN] freqHopOn    Enables disables the intra-packet frequency hopping
+ * \param [IN] hopPeriod    Number of symbols between each hop
+ * \param [IN] iqInverted   Inverts IQ signals [0: not inverted, 1: inverted]
+ * \param [IN] rxContinuous Sets the reception in continuous mode
+ */
+void SX1276CompileLoRaRxProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate,
+                                 uint16_t preambleLen, uint16_t symbTimeout,
+                                 bool fixLen, uint8_t payloadLen,
+                                 bool crcOn, bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, bool rxContinuous );
+
+/*!
+ * \brief Compiles a LoRa transmission configuration into a profile
+ *
+ * \remark The parameters are the LoRa ones of \ref SX1276SetTxConfig. The
+ *         output power isn't part of the profile.
+ *
+ * \param [OUT] profile     Compiled profile
+ * \param [IN] bandwidth    Bandwidth [0: 125 kHz, 1: 250 kHz, 2: 500 kHz]
+ * \param [IN] datarate     Spreading factor [6..12]
+ * \param [IN] coderate     Coding rate [1: 4/5, 2: 4/6, 3: 4/7, 4: 4/8]
+ * \param [IN] preambleLen  Preamble length in symbols
+ * \param [IN] fixLen       Fixed length packets [0: variable, 1: fixed]
+ * \param [IN] crcOn        Enables disables the CRC [0: OFF, 1: ON]
+ * \param [IN] freqHopOn    Enables disables the intra-packet frequency hopping
+ * \param [IN] hopPeriod    Number of symbols between each hop
+ * \param [IN] iqInverted   Inverts IQ signals [0: not inverted, 1: inverted]
+ * \param [IN] timeout      Transmission timeout [ms]
+ */
+void SX1276CompileLoRaTxProfile( RadioLoRaProfile_t *profile, uint32_t bandwidth,
+                                 uint32_t datarate, uint8_t coderate,
+                                 uint16_t preambleLen, bool fixLen, bool crcOn,
+                                 bool freqHopOn, uint8_t hopPeriod,
+                                 bool iqInverted, uint32_t timeout );
+
+/*!
+ * \brief Applies a compiled LoRa profile
+ *
+ * \remark Each contiguous run of registers differing from the register
+ *         shadow is written by a single burst access.
+ *
+ * \param [IN] profile Profile to be applied
+ */
+void SX1276ApplyLoRaProfile( const RadioLoRaProfile_t *profile );
+
 /*!
  * \brief Computes the packet time on air in ms for the given payload
  *
@@ -368,6 +477,9 @@ int16_t SX1276ReadRssi( RadioModems_t modem );
 /*!
  * \brief Writes the radio register at the specified address
  *
+ * \remark The SPI access is skipped when the register shadow already holds
+ *         the value.
+ *
  * \param [IN]: addr Register address
  * \param [IN]: data New register value
  */
@@ -376,6 +488,9 @@ void SX1276Write( uint16_t addr, uint8_t data );
 /*!
  * \brief Reads the radio register at the specified address
  *
+ * \remark Configuration registers are read from the register shadow once
+ *         they have been accessed.
+ *
  * \param [IN]: addr Register address
  * \retval data Register value
  */
@@ -423,4 +538,56 @@ void SX1276SetPublicNetwork( bool enable );
  */
 uint32_t SX1276GetWakeupTime( void );
 
+/*!
+ * \brief Streams the payload of the received FSK packets to the given sink
+ *        instead of the internal reception buffer
+ *
+ * \remark The packets are then no longer limited by the size of the reception
+ *         buffer. In fixed length mode the payload length can go up to
+ *         \ref FSK_MAX_PAYLOAD_LENGTH. RxDone is called with a NULL payload once
+ *         the last chunk has been delivered. Upon RxError the chunks already
+ *         delivered must be discarded.
+ *
+ * \remark To be called after SX1276SetRxConfig.
+ *
+ * \param [IN] sink       Stream sink. NULL restores the internal reception buffer
+ * \param [IN] payloadLen Payload length in fixed length mode [1..FSK_MAX_PAYLOAD_LENGTH].
+ *                        Not used in variable length mode
+ */
+void SX1276SetFskStreamSink( SX1276FskStreamSink_t *sink, uint16_t payloadLen );
+
+/*!
+ * \brief Sets the channels the LoRa intra-packet frequency hopping hops on
+ *
+ * \remark The channels are shuffled in a pseudo-random sequence derived
+ *         from the seed and their PLL steps are computed once. Upon each
+ *         FhssChangeChannel interrupt the next channel of the sequence is
+ *         written by a single burst access. The sequence restarts with each
+ *         packet. The hopping itself is enabled by the freqHopOn and
+ *         hopPeriod parameters of SX1276SetTxConfig and SX1276SetRxConfig.
+ *
+ * \param [IN] channels   Channels frequencies [Hz]
+ * \param [IN] nbChannels Number of channels [0..FHSS_MAX_NB_CHANNELS].
+ *                        0 lets the application hop in FhssChangeChannel
+ * \param [IN] seed       Seed of the hopping sequence
+ */
+void SX1276SetHopTable( const uint32_t *channels, uint8_t nbChannels, uint32_t seed );
+
+/*!
+ * \brief Gets the radio activity statistics
+ *
+ * \param [OUT] stats Statistics accumulated since the last SX1276ResetStats
+ */
+void SX1276GetStats( RadioStats_t* stats );
+
+/*!
+ * \brief Clears the radio activity statistics
+ */
+void SX1276ResetStats( void );
+
+/*!
+ * Radio driver table. Refer to \ref RadioSelect.
+ */
+extern const struct Radio_s SX1276Radio;
+
 #endif // __SX1276_H__
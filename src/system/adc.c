@@ -21,6 +21,8 @@
  * \author    Gregory Cristian ( Semtech )
  */
 #include <stdbool.h>
+#include <stddef.h>
+#include "utilities.h"
 #include "adc-board.h"
 
 /*!
@@ -55,3 +57,13 @@ uint16_t AdcReadChannel( Adc_t *obj, uint32_t channel )
         return 0;
     }
 }
+
+uint8_t AdcStartConversion( Adc_t *obj, uint32_t channel, uint16_t nbSamples, AdcConversionCallback *callback, void* context )
+{
+    if( ( AdcInitialized == false ) || ( callback == NULL ) ||
+        ( nbSamples == 0 ) || ( nbSamples > ADC_MAX_NB_SAMPLES ) || ( ( nbSamples & ( nbSamples - 1 ) ) != 0 ) )
+    {
+        return FAIL;
+    }
+    return AdcMcuStartConversion( obj, channel, nbSamples, callback, context );
+}
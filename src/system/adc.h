@@ -26,6 +26,19 @@
 #include <stdint.h>
 #include "gpio.h"
 
+/*!
+ * Maximum number of samples averaged by a single AdcStartConversion
+ */
+#define ADC_MAX_NB_SAMPLES                          256
+
+/*!
+ * ADC conversion done callback prototype
+ *
+ * \param [IN] context User context given to AdcStartConversion
+ * \param [IN] value   Averaged conversion result
+ */
+typedef void( AdcConversionCallback )( void* context, uint16_t value );
+
 /*!
  * ADC object type definition
  */
@@ -58,4 +71,20 @@ void AdcDeInit( Adc_t *obj );
  */
 uint16_t AdcReadChannel( Adc_t *obj, uint32_t channel );
 
+/*!
+ * \brief Starts a non-blocking conversion of the given channel
+ *
+ * \remark The ADC averages nbSamples conversions and calls the callback from
+ *         the interrupt context with the result. STOP mode is prevented until
+ *         the conversion is done.
+ *
+ * \param [IN] obj       ADC object
+ * \param [IN] channel   ADC channel
+ * \param [IN] nbSamples Number of samples to average, power of 2 up to ADC_MAX_NB_SAMPLES
+ * \param [IN] callback  Conversion done callback
+ * \param [IN] context   User context given to the callback
+ * \retval status        [SUCCESS, FAIL] FAIL when a conversion is already ongoing
+ */
+uint8_t AdcStartConversion( Adc_t *obj, uint32_t channel, uint16_t nbSamples, AdcConversionCallback *callback, void* context );
+
 #endif // __ADC_H__
@@ -0,0 +1,148 @@
+/*!
+ * \file      binlog.c
+ *
+ * \brief     Binary deferred event log
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utilities.h"
+#include "board.h"
+#include "timer.h"
+#include "binlog.h"
+
+#ifdef BINLOG_ENABLED
+
+/*!
+ * Records ring
+ */
+static uint8_t BinLogRing[BINLOG_RING_SIZE];
+
+/*!
+ * Index of the oldest byte not sent yet
+ */
+static uint16_t BinLogRingIndex = 0;
+
+/*!
+ * Number of bytes in the ring
+ */
+static uint16_t BinLogRingCnt = 0;
+
+/*!
+ * Number of records dropped since the last dropped records report
+ */
+static uint16_t BinLogDropped = 0;
+
+/*!
+ * \brief Appends bytes to the ring, the room is checked by the caller
+ *
+ * \param [IN] data Data buffer
+ * \param [IN] size Data buffer size
+ */
+static void BinLogRingPush( const uint8_t *data, uint8_t size )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        BinLogRing[( BinLogRingIndex + BinLogRingCnt ) % BINLOG_RING_SIZE] = data[i];
+        BinLogRingCnt++;
+    }
+}
+
+/*!
+ * \brief Appends a record to the ring, the room is checked by the caller
+ *
+ * \param [IN] id   Event identifier
+ * \param [IN] data Event payload
+ * \param [IN] size Event payload size
+ */
+static void BinLogRingPushRecord( uint8_t id, const uint8_t *data, uint8_t size )
+{
+    uint32_t time = TimerGetCurrentTime( );
+    uint8_t header[BINLOG_HEADER_SIZE] =
+    {
+        BINLOG_SYNC, id, size,
+        ( uint8_t )( time >> 0 ), ( uint8_t )( time >> 8 ), ( uint8_t )( time >> 16 ), ( uint8_t )( time >> 24 )
+    };
+
+    BinLogRingPush( header, BINLOG_HEADER_SIZE );
+    BinLogRingPush( data, size );
+}
+
+void BinLogWrite( uint8_t id, const uint8_t *data, uint8_t size )
+{
+    CRITICAL_SECTION_BEGIN( );
+    if( BinLogDropped > 0 )
+    {
+        uint8_t dropped[2] = { ( uint8_t )( BinLogDropped >> 0 ), ( uint8_t )( BinLogDropped >> 8 ) };
+
+        if( ( size_t )( BINLOG_RING_SIZE - BinLogRingCnt ) < ( BINLOG_HEADER_SIZE + sizeof( dropped ) ) )
+        {
+            BinLogDropped++;
+            CRITICAL_SECTION_END( );
+            return;
+        }
+        BinLogRingPushRecord( BINLOG_ID_DROPPED, dropped, sizeof( dropped ) );
+        BinLogDropped = 0;
+    }
+    if( ( BINLOG_RING_SIZE - BinLogRingCnt ) < ( BINLOG_HEADER_SIZE + size ) )
+    {
+        // The application never waits for the UART
+        BinLogDropped++;
+        CRITICAL_SECTION_END( );
+        return;
+    }
+    BinLogRingPushRecord( id, data, size );
+    CRITICAL_SECTION_END( );
+}
+
+void BinLogProcess( void )
+{
+    uint16_t size;
+    uint16_t count;
+
+    do
+    {
+        // Contiguous bytes up to the ring end. The writers only add bytes
+        // after them.
+        size = MIN( BinLogRingCnt, BINLOG_RING_SIZE - BinLogRingIndex );
+
+        if( size == 0 )
+        {
+            return;
+        }
+        // The bytes being sent are only removed by this function
+        count = BoardLogWrite( &BinLogRing[BinLogRingIndex], size );
+
+        CRITICAL_SECTION_BEGIN( );
+        BinLogRingIndex = ( BinLogRingIndex + count ) % BINLOG_RING_SIZE;
+        BinLogRingCnt -= count;
+        CRITICAL_SECTION_END( );
+    }while( count == size );
+}
+
+#else
+
+void BinLogWrite( uint8_t id, const uint8_t *data, uint8_t size )
+{
+}
+
+void BinLogProcess( void )
+{
+}
+
+#endif // BINLOG_ENABLED
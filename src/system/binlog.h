@@ -0,0 +1,79 @@
+/*!
+ * \file      binlog.h
+ *
+ * \brief     Binary deferred event log
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \remark    The log is only active when BINLOG_ENABLED is defined.
+ *
+ *            The events are stored as records in a RAM ring and sent later to
+ *            the debug UART by \ref BinLogProcess, without formatting and
+ *            without waiting for the UART. A record is
+ *
+ *            | Sync | Id | Size | Time | Payload |
+ *            |  1   | 1  |  1   |  4   |  Size   |
+ *
+ *            Sync is \ref BINLOG_SYNC, Time is the \ref TimerGetCurrentTime
+ *            value. The multi-bytes fields are little endian.
+ */
+#ifndef __BINLOG_H__
+#define __BINLOG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * Size of the records ring [bytes]. The new records are dropped while the
+ * ring is full.
+ */
+#ifndef BINLOG_RING_SIZE
+#define BINLOG_RING_SIZE                            256
+#endif
+
+/*!
+ * First byte of every record
+ */
+#define BINLOG_SYNC                                 0xA5
+
+/*!
+ * Size of a record header [bytes]
+ */
+#define BINLOG_HEADER_SIZE                          7
+
+/*!
+ * Record identifier reporting the number of dropped records in a 16 bits
+ * payload. The other identifiers are defined by the application.
+ */
+#define BINLOG_ID_DROPPED                           0
+
+/*!
+ * \brief Stores an event record
+ *
+ * \param [IN] id   Event identifier
+ * \param [IN] data Event payload
+ * \param [IN] size Event payload size
+ */
+void BinLogWrite( uint8_t id, const uint8_t *data, uint8_t size );
+
+/*!
+ * \brief Sends the stored records the debug UART can take
+ *
+ * \remark To be called from the application main loop
+ */
+void BinLogProcess( void );
+
+#endif // __BINLOG_H__
@@ -0,0 +1,83 @@
+/*!
+ * \file      crc.c
+ *
+ * \brief     CRC-16 and CRC-32 computations
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "crc.h"
+#if defined( CRC_MCU_ENABLED )
+#include "crc-board.h"
+#endif
+
+/*
+ * CRC-16 CCITT of the 16 values of a nibble, polynomial 0x1021
+ */
+static const uint16_t Crc16Table[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+/*
+ * CRC-32 ( IEEE 802.3 ) of the 16 values of a nibble, reflected polynomial
+ * 0xEDB88320
+ */
+static const uint32_t Crc32Table[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint16_t Crc16Update( uint16_t crc, const uint8_t *buffer, uint32_t size )
+{
+#if defined( CRC_MCU_ENABLED )
+    if( CrcMcuUpdate16( &crc, buffer, size ) == true )
+    {
+        return crc;
+    }
+#endif
+    for( uint32_t i = 0; i < size; i++ )
+    {
+        // Most significant nibble first
+        crc = ( crc << 4 ) ^ Crc16Table[( crc >> 12 ) ^ ( buffer[i] >> 4 )];
+        crc = ( crc << 4 ) ^ Crc16Table[( crc >> 12 ) ^ ( buffer[i] & 0x0F )];
+    }
+    return crc;
+}
+
+uint32_t Crc32Update( uint32_t crc, const uint8_t *buffer, uint32_t size )
+{
+    // Register value, before the final XOR
+    crc = ~crc;
+
+#if defined( CRC_MCU_ENABLED )
+    if( CrcMcuUpdate32( &crc, buffer, size ) == true )
+    {
+        return ~crc;
+    }
+#endif
+    for( uint32_t i = 0; i < size; i++ )
+    {
+        // Least significant nibble first
+        crc = Crc32Table[( crc ^ buffer[i] ) & 0x0F] ^ ( crc >> 4 );
+        crc = Crc32Table[( crc ^ ( buffer[i] >> 4 ) ) & 0x0F] ^ ( crc >> 4 );
+    }
+    return ~crc;
+}
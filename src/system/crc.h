@@ -0,0 +1,69 @@
+/*!
+ * \file      crc.h
+ *
+ * \brief     CRC-16 and CRC-32 computations
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \remark    The CRCs are computed by the MCU CRC unit when CRC_MCU_ENABLED
+ *            is defined and the board supports the CRC, see crc-board.h.
+ *            They are computed with nibble tables otherwise.
+ *
+ *            The CRCs are updated buffer by buffer, a large image is checked
+ *            while it is read chunk by chunk.
+ */
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*!
+ * \brief Updates a CRC-16 CCITT: 0x1021 polynomial, MSB first, no final XOR
+ *
+ * \remark The LoRaWAN beacons CRC starts from 0x0000, the CCITT-FALSE one
+ *         from 0xFFFF.
+ *
+ * \param [IN] crc    CRC of the previous buffers, the initial value for the
+ *                    first buffer
+ * \param [IN] buffer Data buffer
+ * \param [IN] size   Data buffer size
+ *
+ * \retval crc        CRC of the previous buffers and this one
+ */
+uint16_t Crc16Update( uint16_t crc, const uint8_t *buffer, uint32_t size );
+
+/*!
+ * \brief Updates a CRC-32 (IEEE 802.3): reflected 0xEDB88320 polynomial,
+ *        0xFFFFFFFF initial value and final XOR
+ *
+ * \param [IN] crc    CRC-32 of the previous buffers, 0 for the first buffer
+ * \param [IN] buffer Data buffer
+ * \param [IN] size   Data buffer size
+ *
+ * \retval crc        CRC-32 of the previous buffers and this one
+ */
+uint32_t Crc32Update( uint32_t crc, const uint8_t *buffer, uint32_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CRC_H__
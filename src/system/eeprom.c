@@ -20,9 +20,216 @@
  *
  * \author    Gregory Cristian ( Semtech )
  */
+#include <stddef.h>
+#include "utilities.h"
 #include "eeprom-board.h"
 #include "eeprom.h"
 
+#if defined( EEPROM_ASYNC_ENABLED )
+
+/*!
+ * Queued write
+ */
+typedef struct sEepromWriteJob
+{
+    /*!
+     * EEPROM address to write to
+     */
+    uint16_t Addr;
+    /*!
+     * Size of the data
+     */
+    uint16_t Size;
+    /*!
+     * Number of bytes already programmed
+     */
+    uint16_t Done;
+    /*!
+     * Write status, FAIL once a chunk has failed
+     */
+    uint8_t Status;
+    /*!
+     * Completion callback
+     */
+    EepromWriteCallback_t Callback;
+    /*!
+     * Completion callback context
+     */
+    void* Context;
+}EepromWriteJob_t;
+
+/*!
+ * Queued writes, oldest first
+ */
+static EepromWriteJob_t EepromJobs[EEPROM_WRITE_QUEUE_SIZE];
+
+/*!
+ * Index of the oldest queued write
+ */
+static uint8_t EepromJobsIndex = 0;
+
+/*!
+ * Number of queued writes
+ */
+static uint8_t EepromJobsCnt = 0;
+
+/*!
+ * Data of the queued writes, stored in the queue order
+ */
+static uint8_t EepromPool[EEPROM_WRITE_POOL_SIZE];
+
+/*!
+ * Index of the oldest byte not programmed yet
+ */
+static uint16_t EepromPoolIndex = 0;
+
+/*!
+ * Number of bytes not programmed yet
+ */
+static uint16_t EepromPoolCnt = 0;
+
+/*!
+ * \brief Programs the next chunk of the oldest queued write. There must be a
+ *        queued write.
+ */
+static void EepromProcessChunk( void )
+{
+    EepromWriteJob_t* job = &EepromJobs[EepromJobsIndex];
+    uint8_t chunk[EEPROM_WRITE_CHUNK_SIZE];
+    uint16_t size = MIN( job->Size - job->Done, EEPROM_WRITE_CHUNK_SIZE );
+
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        chunk[i] = EepromPool[( EepromPoolIndex + i ) % EEPROM_WRITE_POOL_SIZE];
+    }
+    if( ( size > 0 ) && ( EepromMcuWriteBuffer( job->Addr + job->Done, chunk, size ) != SUCCESS ) )
+    {
+        job->Status = FAIL;
+    }
+    EepromPoolIndex = ( EepromPoolIndex + size ) % EEPROM_WRITE_POOL_SIZE;
+    EepromPoolCnt -= size;
+    job->Done += size;
+
+    if( job->Done == job->Size )
+    {
+        EepromWriteCallback_t callback = job->Callback;
+        void* context = job->Context;
+        uint8_t status = job->Status;
+
+        // Removed first, the callback may queue new writes
+        EepromJobsIndex = ( EepromJobsIndex + 1 ) % EEPROM_WRITE_QUEUE_SIZE;
+        EepromJobsCnt--;
+        if( callback != NULL )
+        {
+            callback( status, context );
+        }
+    }
+}
+
+uint8_t EepromWriteBufferAsync( uint16_t addr, uint8_t *buffer, uint16_t size, EepromWriteCallback_t callback, void* context )
+{
+    EepromWriteJob_t* job;
+
+    // Boundary check
+    if( size > ( 0xFFFF - addr ) )
+    {
+        return FAIL;
+    }
+    if( size > EEPROM_WRITE_POOL_SIZE )
+    {
+        uint8_t status;
+
+        // Can't be queued, written after the queued writes
+        EepromFlush( );
+        status = EepromMcuWriteBuffer( addr, buffer, size );
+        if( callback != NULL )
+        {
+            callback( status, context );
+        }
+        return SUCCESS;
+    }
+    while( ( EepromJobsCnt == EEPROM_WRITE_QUEUE_SIZE ) || ( ( EEPROM_WRITE_POOL_SIZE - EepromPoolCnt ) < size ) )
+    {
+        // The flash end of operation interrupt ends the board erases
+        while( EepromMcuIsBusy( ) == true ){ }
+        EepromProcessChunk( );
+    }
+
+    for( uint16_t i = 0; i < size; i++ )
+    {
+        EepromPool[( EepromPoolIndex + EepromPoolCnt + i ) % EEPROM_WRITE_POOL_SIZE] = buffer[i];
+    }
+    EepromPoolCnt += size;
+
+    job = &EepromJobs[( EepromJobsIndex + EepromJobsCnt ) % EEPROM_WRITE_QUEUE_SIZE];
+    job->Addr = addr;
+    job->Size = size;
+    job->Done = 0;
+    job->Status = SUCCESS;
+    job->Callback = callback;
+    job->Context = context;
+    EepromJobsCnt++;
+    return SUCCESS;
+}
+
+void EepromProcess( void )
+{
+    // A board erase ends with the flash end of operation interrupt, which
+    // wakes up the main loop again
+    if( ( EepromJobsCnt > 0 ) && ( EepromMcuIsBusy( ) == false ) )
+    {
+        EepromProcessChunk( );
+    }
+}
+
+bool EepromIsWritePending( void )
+{
+    return EepromJobsCnt > 0;
+}
+
+void EepromFlush( void )
+{
+    while( EepromJobsCnt > 0 )
+    {
+        while( EepromMcuIsBusy( ) == true ){ }
+        EepromProcessChunk( );
+    }
+}
+
+#else
+
+uint8_t EepromWriteBufferAsync( uint16_t addr, uint8_t *buffer, uint16_t size, EepromWriteCallback_t callback, void* context )
+{
+    uint8_t status;
+
+    // Boundary check
+    if( size > ( 0xFFFF - addr ) )
+    {
+        return FAIL;
+    }
+    status = EepromMcuWriteBuffer( addr, buffer, size );
+    if( callback != NULL )
+    {
+        callback( status, context );
+    }
+    return SUCCESS;
+}
+
+void EepromProcess( void )
+{
+}
+
+bool EepromIsWritePending( void )
+{
+    return false;
+}
+
+void EepromFlush( void )
+{
+}
+
+#endif // EEPROM_ASYNC_ENABLED
+
 uint8_t EepromWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
 {
     // Boundary check
@@ -30,6 +237,8 @@ uint8_t EepromWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
     {
         return 0;
     }
+    // Keeps the writes order
+    EepromFlush( );
     return EepromMcuWriteBuffer( addr, buffer, size );
 }
 
@@ -40,6 +249,8 @@ uint8_t EepromReadBuffer( uint16_t addr, uint8_t *buffer, uint16_t size )
     {
         return 0;
     }
+    // Reads the queued data once written
+    EepromFlush( );
     return EepromMcuReadBuffer( addr, buffer, size );
 }
 
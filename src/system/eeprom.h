@@ -24,6 +24,36 @@
 #define __EEPROM_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ * Maximum number of queued asynchronous writes
+ */
+#ifndef EEPROM_WRITE_QUEUE_SIZE
+#define EEPROM_WRITE_QUEUE_SIZE                     8
+#endif
+
+/*!
+ * Size of the pool holding the data of the queued asynchronous writes [bytes]
+ */
+#ifndef EEPROM_WRITE_POOL_SIZE
+#define EEPROM_WRITE_POOL_SIZE                      256
+#endif
+
+/*!
+ * Number of bytes programmed by a \ref EepromProcess call
+ */
+#ifndef EEPROM_WRITE_CHUNK_SIZE
+#define EEPROM_WRITE_CHUNK_SIZE                     16
+#endif
+
+/*!
+ * Asynchronous write completion callback
+ *
+ * \param[IN] status Write status [SUCCESS, FAIL]
+ * \param[IN] context Context given to \ref EepromWriteBufferAsync
+ */
+typedef void ( *EepromWriteCallback_t )( uint8_t status, void* context );
 
 /*!
  * Writes the given buffer to the EEPROM at the specified address.
@@ -35,6 +65,49 @@
  */
 uint8_t EepromWriteBuffer( uint16_t addr, uint8_t *buffer, uint16_t size );
 
+/*!
+ * Queues the write of the given buffer to the EEPROM at the specified
+ * address. The data is copied, the buffer can be reused on return.
+ *
+ * \remark Only active when EEPROM_ASYNC_ENABLED is defined, the buffer is
+ *         written before returning otherwise.
+ *
+ * \remark The writes complete in the order they are queued, after the writes
+ *         queued before them. \ref EepromWriteBuffer and
+ *         \ref EepromReadBuffer first complete the queued writes.
+ *
+ * \remark Waits for the oldest writes to complete while the queue is full.
+ *         A buffer larger than EEPROM_WRITE_POOL_SIZE is written before
+ *         returning.
+ *
+ * \param[IN] addr EEPROM address to write to
+ * \param[IN] buffer Pointer to the buffer to be written.
+ * \param[IN] size Size of the buffer to be written.
+ * \param[IN] callback Called once the buffer is written. Can be NULL.
+ * \param[IN] context Given to the callback
+ * \retval status [SUCCESS, FAIL]. The callback is only called on SUCCESS.
+ */
+uint8_t EepromWriteBufferAsync( uint16_t addr, uint8_t *buffer, uint16_t size, EepromWriteCallback_t callback, void* context );
+
+/*!
+ * Programs the next chunk of the queued writes, unless the EEPROM is busy
+ *
+ * \remark To be called from the application main loop
+ */
+void EepromProcess( void );
+
+/*!
+ * Indicates if queued writes are not completed yet
+ *
+ * \retval isPending Returns true if writes are pending
+ */
+bool EepromIsWritePending( void );
+
+/*!
+ * Completes the queued writes before returning
+ */
+void EepromFlush( void );
+
 /*!
  * Reads the EEPROM at the specified address to the given buffer.
  *
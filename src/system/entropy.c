@@ -0,0 +1,100 @@
+/*!
+ * \file      entropy.c
+ *
+ * \brief     Random numbers entropy pool
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utilities.h"
+#include "board.h"
+#include "entropy.h"
+
+/*!
+ * Random words
+ */
+static uint32_t EntropyPool[ENTROPY_POOL_SIZE];
+
+/*!
+ * Number of words left in the pool
+ */
+static uint8_t EntropyPoolCount = 0;
+
+/*!
+ * Source of the words the MCU can't provide
+ */
+static uint32_t ( *EntropyFallbackSource )( void ) = NULL;
+
+/*!
+ * \brief Fills the pool from the MCU hardware generator
+ */
+static void EntropyRefill( void )
+{
+    EntropyPoolCount += BoardGetTrueRandom( EntropyPool + EntropyPoolCount, ENTROPY_POOL_SIZE - EntropyPoolCount );
+}
+
+void EntropyInit( uint32_t ( *fallbackSource )( void ) )
+{
+    EntropyFallbackSource = fallbackSource;
+
+    CRITICAL_SECTION_BEGIN( );
+    EntropyPoolCount = 0;
+    EntropyRefill( );
+    CRITICAL_SECTION_END( );
+
+    if( EntropyFallbackSource == NULL )
+    {
+        return;
+    }
+    // The fallback source is sampled now, while it is set up anyway
+    while( EntropyPoolCount < ENTROPY_POOL_SIZE )
+    {
+        uint32_t random = EntropyFallbackSource( );
+
+        CRITICAL_SECTION_BEGIN( );
+        EntropyPool[EntropyPoolCount++] = random;
+        CRITICAL_SECTION_END( );
+    }
+}
+
+uint32_t EntropyGetRandom( void )
+{
+    uint32_t random = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( EntropyPoolCount == 0 )
+    {
+        EntropyRefill( );
+    }
+    if( EntropyPoolCount > 0 )
+    {
+        random = EntropyPool[--EntropyPoolCount];
+        // Taken words are never given twice
+        EntropyPool[EntropyPoolCount] = 0;
+        CRITICAL_SECTION_END( );
+        return random;
+    }
+    CRITICAL_SECTION_END( );
+
+    if( EntropyFallbackSource != NULL )
+    {
+        return EntropyFallbackSource( );
+    }
+    // No entropy source at all
+    return rand32( );
+}
@@ -0,0 +1,55 @@
+/*!
+ * \file      entropy.h
+ *
+ * \brief     Random numbers entropy pool
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \remark    The pool is filled from the MCU hardware generator, see
+ *            \ref BoardGetTrueRandom. The fallback source, usually the radio,
+ *            only fills the words the MCU can't provide. It is sampled when
+ *            the pool is initialized and when a word is taken from an empty
+ *            pool.
+ */
+#ifndef __ENTROPY_H__
+#define __ENTROPY_H__
+
+#include <stdint.h>
+
+/*!
+ * Number of random words held by the pool
+ */
+#ifndef ENTROPY_POOL_SIZE
+#define ENTROPY_POOL_SIZE                           4
+#endif
+
+/*!
+ * \brief Fills the pool
+ *
+ * \param [IN] fallbackSource Entropy source used when the MCU has no
+ *                            hardware generator, e.g. Radio.Random. May be
+ *                            NULL.
+ */
+void EntropyInit( uint32_t ( *fallbackSource )( void ) );
+
+/*!
+ * \brief Takes a random word from the pool
+ *
+ * \retval random Random word
+ */
+uint32_t EntropyGetRandom( void );
+
+#endif // __ENTROPY_H__
@@ -20,39 +20,168 @@
  *
  * \author    Gregory Cristian ( Semtech )
  */
+#include <stdatomic.h>
+#include "utilities.h"
 #include "fifo.h"
 
-static uint16_t FifoNext( Fifo_t *fifo, uint16_t index )
-{
-    return ( index + 1 ) % fifo->Size;
-}
+/*!
+ * Maximum FIFO size. The free running counters must be able to hold the
+ * count of a full FIFO
+ */
+#define FIFO_MAX_SIZE                               32768
+
+/*!
+ * \brief Orders the buffer accesses before the following index update
+ *
+ * \remark The index update publishes the data to the other side, which only
+ *         reads the buffer after having read the index.
+ */
+#define FIFO_BARRIER( )                             atomic_thread_fence( memory_order_seq_cst )
 
 void FifoInit( Fifo_t *fifo, uint8_t *buffer, uint16_t size )
 {
+    uint16_t pow2Size = 1;
+
+    if( size > FIFO_MAX_SIZE )
+    {
+        size = FIFO_MAX_SIZE;
+    }
+    while( ( pow2Size << 1 ) <= size )
+    {
+        pow2Size <<= 1;
+    }
+
     fifo->Begin = 0;
     fifo->End = 0;
     fifo->Data = buffer;
-    fifo->Size = size;
+    fifo->Size = pow2Size;
 }
 
 void FifoPush( Fifo_t *fifo, uint8_t data )
 {
-    fifo->End = FifoNext( fifo, fifo->End );
-    fifo->Data[fifo->End] = data;
+    uint16_t end = fifo->End;
+
+    fifo->Data[end & ( fifo->Size - 1 )] = data;
+    FIFO_BARRIER( );
+    fifo->End = end + 1;
 }
 
 uint8_t FifoPop( Fifo_t *fifo )
 {
-    uint8_t data = fifo->Data[FifoNext( fifo, fifo->Begin )];
+    uint16_t begin = fifo->Begin;
+    uint8_t data;
 
-    fifo->Begin = FifoNext( fifo, fifo->Begin );
+    FIFO_BARRIER( );
+    data = fifo->Data[begin & ( fifo->Size - 1 )];
+    FIFO_BARRIER( );
+    fifo->Begin = begin + 1;
     return data;
 }
 
+uint16_t FifoPushBuffer( Fifo_t *fifo, const uint8_t *buffer, uint16_t size )
+{
+    uint8_t *span;
+    uint16_t spanSize;
+    uint16_t count = 0;
+
+    // At most two spans, before and after the end of the buffer
+    while( ( count < size ) && ( ( spanSize = FifoFreeSpan( fifo, &span ) ) > 0 ) )
+    {
+        if( spanSize > ( size - count ) )
+        {
+            spanSize = size - count;
+        }
+        memcpy1( span, buffer + count, spanSize );
+        FifoCommit( fifo, spanSize );
+        count += spanSize;
+    }
+    return count;
+}
+
+uint16_t FifoPopBuffer( Fifo_t *fifo, uint8_t *buffer, uint16_t size )
+{
+    uint8_t *span;
+    uint16_t spanSize;
+    uint16_t count = 0;
+
+    // At most two spans, before and after the end of the buffer
+    while( ( count < size ) && ( ( spanSize = FifoPeekSpan( fifo, &span ) ) > 0 ) )
+    {
+        if( spanSize > ( size - count ) )
+        {
+            spanSize = size - count;
+        }
+        memcpy1( buffer + count, span, spanSize );
+        FifoSkip( fifo, spanSize );
+        count += spanSize;
+    }
+    return count;
+}
+
+uint16_t FifoPeekSpan( Fifo_t *fifo, uint8_t **data )
+{
+    uint16_t begin = fifo->Begin;
+    uint16_t count = ( uint16_t )( fifo->End - begin );
+    uint16_t index = begin & ( fifo->Size - 1 );
+
+    FIFO_BARRIER( );
+    *data = &fifo->Data[index];
+    if( count > ( fifo->Size - index ) )
+    {
+        count = fifo->Size - index;
+    }
+    return count;
+}
+
+void FifoSkip( Fifo_t *fifo, uint16_t size )
+{
+    uint16_t begin = fifo->Begin;
+    uint16_t count = ( uint16_t )( fifo->End - begin );
+
+    if( size > count )
+    {
+        size = count;
+    }
+    FIFO_BARRIER( );
+    fifo->Begin = begin + size;
+}
+
+uint16_t FifoFreeSpan( Fifo_t *fifo, uint8_t **data )
+{
+    uint16_t end = fifo->End;
+    uint16_t space = fifo->Size - ( uint16_t )( end - fifo->Begin );
+    uint16_t index = end & ( fifo->Size - 1 );
+
+    FIFO_BARRIER( );
+    *data = &fifo->Data[index];
+    if( space > ( fifo->Size - index ) )
+    {
+        space = fifo->Size - index;
+    }
+    return space;
+}
+
+void FifoCommit( Fifo_t *fifo, uint16_t size )
+{
+    uint16_t end = fifo->End;
+    uint16_t space = fifo->Size - ( uint16_t )( end - fifo->Begin );
+
+    if( size > space )
+    {
+        size = space;
+    }
+    FIFO_BARRIER( );
+    fifo->End = end + size;
+}
+
+uint16_t FifoGetCount( Fifo_t *fifo )
+{
+    return ( uint16_t )( fifo->End - fifo->Begin );
+}
+
 void FifoFlush( Fifo_t *fifo )
 {
-    fifo->Begin = 0;
-    fifo->End = 0;
+    fifo->Begin = fifo->End;
 }
 
 bool IsFifoEmpty( Fifo_t *fifo )
@@ -62,5 +191,5 @@ bool IsFifoEmpty( Fifo_t *fifo )
 
 bool IsFifoFull( Fifo_t *fifo )
 {
-    return ( FifoNext( fifo, fifo->End ) == fifo->Begin );
+    return ( FifoGetCount( fifo ) == fifo->Size );
 }
@@ -28,11 +28,17 @@
 
 /*!
  * FIFO structure
+ *
+ * \remark Single producer / single consumer ring buffer. The producer only
+ *         writes End and the consumer only writes Begin, so one side may run
+ *         in an interrupt handler without a critical section.
+ *         Begin and End are free running counters, the buffer index is the
+ *         counter masked with Size - 1.
  */
 typedef struct Fifo_s
 {
-    uint16_t Begin;
-    uint16_t End;
+    volatile uint16_t Begin;
+    volatile uint16_t End;
     uint8_t *Data;
     uint16_t Size;
 }Fifo_t;
@@ -40,15 +46,21 @@ typedef struct Fifo_s
 /*!
  * Initializes the FIFO structure
  *
+ * \remark The FIFO size must be a power of two. Other sizes are rounded down
+ *         to the nearest power of two, the upper part of the buffer is then
+ *         unused.
+ *
  * \param [IN] fifo   Pointer to the FIFO object
  * \param [IN] buffer Buffer to be used as FIFO
- * \param [IN] size   Size of the buffer
+ * \param [IN] size   Size of the buffer [1:32768]
  */
 void FifoInit( Fifo_t *fifo, uint8_t *buffer, uint16_t size );
 
 /*!
  * Pushes data to the FIFO
  *
+ * \remark Producer side. The FIFO must not be full.
+ *
  * \param [IN] fifo Pointer to the FIFO object
  * \param [IN] data Data to be pushed into the FIFO
  */
@@ -57,14 +69,97 @@ void FifoPush( Fifo_t *fifo, uint8_t data );
 /*!
  * Pops data from the FIFO
  *
+ * \remark Consumer side. The FIFO must not be empty.
+ *
  * \param [IN] fifo Pointer to the FIFO object
  * \retval data     Data popped from the FIFO
  */
 uint8_t FifoPop( Fifo_t *fifo );
 
+/*!
+ * Pushes as many bytes of a buffer as fit into the FIFO
+ *
+ * \remark Producer side
+ *
+ * \param [IN] fifo   Pointer to the FIFO object
+ * \param [IN] buffer Data to be pushed into the FIFO
+ * \param [IN] size   Number of bytes to push
+ * \retval count      Number of bytes pushed
+ */
+uint16_t FifoPushBuffer( Fifo_t *fifo, const uint8_t *buffer, uint16_t size );
+
+/*!
+ * Pops up to size bytes from the FIFO
+ *
+ * \remark Consumer side
+ *
+ * \param [IN]  fifo   Pointer to the FIFO object
+ * \param [OUT] buffer Buffer receiving the popped data
+ * \param [IN]  size   Maximum number of bytes to pop
+ * \retval count       Number of bytes popped
+ */
+uint16_t FifoPopBuffer( Fifo_t *fifo, uint8_t *buffer, uint16_t size );
+
+/*!
+ * Gets the contiguous block of data at the head of the FIFO without removing
+ * it. The block is released with \ref FifoSkip.
+ *
+ * \remark Consumer side. When the data wraps around the end of the buffer
+ *         the span stops at the end of the buffer, the remaining data is
+ *         returned by the next call.
+ *
+ * \param [IN]  fifo Pointer to the FIFO object
+ * \param [OUT] data Set to the first byte of the block
+ * \retval size      Size of the block. 0 if the FIFO is empty
+ */
+uint16_t FifoPeekSpan( Fifo_t *fifo, uint8_t **data );
+
+/*!
+ * Removes data from the head of the FIFO
+ *
+ * \remark Consumer side
+ *
+ * \param [IN] fifo Pointer to the FIFO object
+ * \param [IN] size Number of bytes to remove. Limited to the FIFO count
+ */
+void FifoSkip( Fifo_t *fifo, uint16_t size );
+
+/*!
+ * Gets the contiguous free block at the tail of the FIFO. The block is made
+ * available to the consumer with \ref FifoCommit, which allows to receive
+ * data directly into the FIFO, e.g. by DMA.
+ *
+ * \remark Producer side
+ *
+ * \param [IN]  fifo Pointer to the FIFO object
+ * \param [OUT] data Set to the first free byte
+ * \retval size      Size of the free block. 0 if the FIFO is full
+ */
+uint16_t FifoFreeSpan( Fifo_t *fifo, uint8_t **data );
+
+/*!
+ * Appends the data written to the free block to the FIFO
+ *
+ * \remark Producer side
+ *
+ * \param [IN] fifo Pointer to the FIFO object
+ * \param [IN] size Number of bytes written. Limited to the free space
+ */
+void FifoCommit( Fifo_t *fifo, uint16_t size );
+
+/*!
+ * Gets the number of bytes held by the FIFO
+ *
+ * \param [IN] fifo   Pointer to the FIFO object
+ * \retval count      Number of bytes in the FIFO
+ */
+uint16_t FifoGetCount( Fifo_t *fifo );
+
 /*!
  * Flushes the FIFO
  *
+ * \remark Consumer side. All the data pushed so far is dropped.
+ *
  * \param [IN] fifo   Pointer to the FIFO object
  */
 void FifoFlush( Fifo_t *fifo );
@@ -21,23 +21,36 @@
  * \author    Gregory Cristian ( Semtech )
  */
 #include <stdint.h>
-#include <stdlib.h>
-#include <math.h>
-#include <stdio.h>
-#include <string.h>
+#include <stdbool.h>
 #include "utilities.h"
 #include "board.h"
+#include "timer.h"
 #include "rtc-board.h"
+#include "systime.h"
 #include "gps-board.h"
 #include "gps.h"
 
 #define TRIGGER_GPS_CNT                             10
 
-/* Various type of NMEA data we can receive with the Gps */
-const char NmeaDataTypeGPGGA[] = "GPGGA";
-const char NmeaDataTypeGPGSA[] = "GPGSA";
-const char NmeaDataTypeGPGSV[] = "GPGSV";
-const char NmeaDataTypeGPRMC[] = "GPRMC";
+/*!
+ * Maximum size of a NMEA sentence. Longer sentences are dropped.
+ */
+#define NMEA_SENTENCE_MAX_SIZE                      128
+
+/*!
+ * Number of decimals of the minutes kept in the fixed point positions
+ */
+#define NMEA_POSITION_NB_DECIMALS                   5
+
+/*!
+ * Fixed point position units per minute of angle
+ */
+#define NMEA_POSITION_UNITS_PER_MINUTE              100000
+
+/*!
+ * Fixed point position units per degree
+ */
+#define NMEA_POSITION_UNITS_PER_DEGREE              ( 60 * NMEA_POSITION_UNITS_PER_MINUTE )
 
 /* Value used for the conversion of the position from DMS to decimal */
 const int32_t MaxNorthPosition = 8388607;       // 2^23 - 1
@@ -45,15 +58,268 @@ const int32_t MaxSouthPosition = 8388608;       // -2^23
 const int32_t MaxEastPosition = 8388607;        // 2^23 - 1
 const int32_t MaxWestPosition = 8388608;        // -2^23
 
-NmeaGpsData_t NmeaGpsData;
+/*!
+ * NMEA tokenizer states
+ */
+typedef enum eNmeaState
+{
+    NMEA_STATE_IDLE,
+    NMEA_STATE_FIELDS,
+    NMEA_STATE_CHECKSUM_HIGH,
+    NMEA_STATE_CHECKSUM_LOW,
+}NmeaState_t;
+
+/*!
+ * Parsed NMEA sentences
+ */
+typedef enum eNmeaSentence
+{
+    NMEA_SENTENCE_UNKNOWN,
+    NMEA_SENTENCE_GGA,
+    NMEA_SENTENCE_RMC,
+}NmeaSentence_t;
+
+/*!
+ * Extracted NMEA fields
+ */
+typedef enum eNmeaField
+{
+    NMEA_FIELD_NONE,
+    NMEA_FIELD_UTC_TIME,
+    NMEA_FIELD_DATE,
+    NMEA_FIELD_STATUS,
+    NMEA_FIELD_LATITUDE,
+    NMEA_FIELD_LATITUDE_POLE,
+    NMEA_FIELD_LONGITUDE,
+    NMEA_FIELD_LONGITUDE_POLE,
+    NMEA_FIELD_FIX_QUALITY,
+    NMEA_FIELD_HDOP,
+    NMEA_FIELD_ALTITUDE,
+}NmeaField_t;
+
+/*!
+ * GGA fields, starting after the sentence type
+ */
+static const NmeaField_t NmeaGgaFields[] =
+{
+    NMEA_FIELD_UTC_TIME,
+    NMEA_FIELD_LATITUDE,
+    NMEA_FIELD_LATITUDE_POLE,
+    NMEA_FIELD_LONGITUDE,
+    NMEA_FIELD_LONGITUDE_POLE,
+    NMEA_FIELD_FIX_QUALITY,
+    NMEA_FIELD_NONE,                // Satellites tracked
+    NMEA_FIELD_HDOP,
+    NMEA_FIELD_ALTITUDE,
+};
+
+/*!
+ * RMC fields, starting after the sentence type
+ */
+static const NmeaField_t NmeaRmcFields[] =
+{
+    NMEA_FIELD_UTC_TIME,
+    NMEA_FIELD_STATUS,
+    NMEA_FIELD_LATITUDE,
+    NMEA_FIELD_LATITUDE_POLE,
+    NMEA_FIELD_LONGITUDE,
+    NMEA_FIELD_LONGITUDE_POLE,
+    NMEA_FIELD_NONE,                // Speed
+    NMEA_FIELD_NONE,                // Course
+    NMEA_FIELD_DATE,
+};
+
+/*!
+ * NMEA tokenizer context
+ */
+typedef struct sNmeaParser
+{
+    NmeaState_t State;
+    NmeaSentence_t Sentence;
+    /*!
+     * Checksum of the characters received so far
+     */
+    uint8_t Checksum;
+    /*!
+     * Checksum received at the end of the sentence
+     */
+    uint8_t RxChecksum;
+    /*!
+     * Number of characters received in the sentence
+     */
+    uint8_t Size;
+    uint8_t FieldIndex;
+    uint8_t FieldSize;
+    /*!
+     * Sentence type, e.g. "GPGGA"
+     */
+    char Type[5];
+    /*!
+     * Current field value. Numbers are split in integer and fractional
+     * parts, the other fields only keep their first character.
+     */
+    uint32_t IntPart;
+    uint32_t FracPart;
+    uint8_t NbFrac;
+    bool Decimal;
+    bool Negative;
+    char FirstChar;
+    /*!
+     * Values extracted from the sentence, published once the checksum is
+     * verified
+     */
+    int32_t Latitude;
+    int32_t Longitude;
+    int16_t Altitude;
+    bool Fix;
+    /*!
+     * Horizontal dilution of precision in tenths, GPS_FIX_ANY_HDOP when
+     * missing
+     */
+    uint8_t Hdop;
+    /*!
+     * UTC time of day [s], -1 when missing
+     */
+    int32_t UtcTime;
+    /*!
+     * UTC date as ddmmyy, 0 when missing
+     */
+    uint32_t UtcDate;
+}NmeaParser_t;
+
+static NmeaParser_t NmeaParser;
+
+/*!
+ * Time of a PPS edge, given by the sentence which followed it
+ */
+typedef struct sGpsTimeSync
+{
+    /*!
+     * MCU time of the PPS edge
+     */
+    SysTime_t PpsMcuTime;
+    /*!
+     * UTC time of day of the PPS edge [s]
+     */
+    int32_t UtcTime;
+    /*!
+     * UTC date of the PPS edge as ddmmyy, 0 when unknown
+     */
+    uint32_t UtcDate;
+    /*!
+     * Set when the system time has to be synchronized
+     */
+    bool Pending;
+}GpsTimeSync_t;
+
+static GpsTimeSync_t GpsTimeSync;
+
+/*!
+ * PPS edge the RTC drift is measured from
+ */
+typedef struct sGpsDriftRef
+{
+    /*!
+     * MCU time of the PPS edge
+     */
+    SysTime_t PpsMcuTime;
+    /*!
+     * System time of the PPS edge
+     */
+    SysTime_t PpsTime;
+    bool Valid;
+}GpsDriftRef_t;
+
+static GpsDriftRef_t GpsDriftRef;
 
-static double HasFix = false;
-static double Latitude = 0;
-static double Longitude = 0;
+/*!
+ * Receiver power and fix requests management
+ */
+typedef struct sGpsPowerCtx
+{
+    /*!
+     * Set while the receiver is powered
+     */
+    bool IsOn;
+    /*!
+     * Timer time the receiver was powered on
+     */
+    TimerTime_t OnTime;
+    /*!
+     * Set while a fix is requested
+     */
+    bool FixRequested;
+    /*!
+     * Set by the parser once the requested fix is obtained
+     */
+    bool FixObtained;
+    /*!
+     * Requested horizontal dilution of precision in tenths
+     */
+    uint8_t MaxHdop;
+    /*!
+     * Start type of the request
+     */
+    GpsStartType_t StartType;
+    /*!
+     * Timer time of the request
+     */
+    TimerTime_t RequestTime;
+    /*!
+     * Time after which the request is abandoned [ms]
+     */
+    uint32_t Timeout;
+    /*!
+     * Set once a fix has been obtained
+     */
+    bool LastFixValid;
+    /*!
+     * MCU time of the last fix [s]
+     */
+    uint32_t LastFixTime;
+    /*!
+     * Estimated time to fix of each start type [ms]
+     */
+    uint32_t TimeToFix[GPS_START_TYPE_NB];
+    /*!
+     * Remainder of the cumulated charge [uAs]
+     */
+    uint32_t ChargeRemainder;
+    /*!
+     * Remainder of the cumulated on time [ms]
+     */
+    uint32_t OnTimeRemainder;
+    GpsFixStats_t Stats;
+}GpsPowerCtx_t;
+
+static GpsPowerCtx_t GpsPower =
+{
+    .TimeToFix = { GPS_HOT_START_TTF, GPS_WARM_START_TTF, GPS_COLD_START_TTF },
+};
+
+/*!
+ * MCU time of the latest PPS edge
+ */
+static SysTime_t PpsMcuTime;
+
+static bool PpsMcuTimeValid = false;
+
+static bool HasFix = false;
+
+/*!
+ * Latest position [1 / NMEA_POSITION_UNITS_PER_MINUTE minute]
+ */
+static int32_t LatitudeFixed = 0;
+static int32_t LongitudeFixed = 0;
 
 static int32_t LatitudeBinary = 0;
 static int32_t LongitudeBinary = 0;
 
+/*!
+ * Altitude of the latest GGA sentence
+ */
+static int16_t GgaAltitude = 0;
+
 static int16_t Altitude = ( int16_t )0xFFFF;
 
 static uint32_t PpsCnt = 0;
@@ -62,11 +328,15 @@ bool PpsDetected = false;
 
 void GpsPpsHandler( bool *parseData )
 {
+    PpsMcuTime = SysTimeGetMcuTime( );
+    PpsMcuTimeValid = true;
     PpsDetected = true;
     PpsCnt++;
     *parseData = false;
 
-    if( PpsCnt >= TRIGGER_GPS_CNT )
+    // Parse every second while a fix is requested, the receiver is powered
+    // off as soon as the fix is obtained
+    if( ( PpsCnt >= TRIGGER_GPS_CNT ) || ( GpsPower.FixRequested == true ) )
     {
         PpsCnt = 0;
         *parseData = true;
@@ -76,117 +346,342 @@ void GpsPpsHandler( bool *parseData )
 void GpsInit( void )
 {
     PpsDetected = false;
+    PpsMcuTimeValid = false;
+    GpsTimeSync.Pending = false;
+    GpsDriftRef.Valid = false;
+    NmeaParser.State = NMEA_STATE_IDLE;
+    // The receiver is powered by its initialization
+    GpsPower.IsOn = true;
+    GpsPower.OnTime = TimerGetCurrentTime( );
     GpsMcuInit( );
 }
 
 void GpsStart( void )
 {
+    if( GpsPower.IsOn == false )
+    {
+        GpsPower.IsOn = true;
+        GpsPower.OnTime = TimerGetCurrentTime( );
+    }
     GpsMcuStart( );
 }
 
 void GpsStop( void )
 {
     GpsMcuStop( );
+
+    if( GpsPower.IsOn == true )
+    {
+        uint32_t onTime = TimerGetElapsedTime( GpsPower.OnTime );
+
+        GpsPower.IsOn = false;
+        GpsPower.OnTimeRemainder += onTime;
+        GpsPower.Stats.TotalOnTime += GpsPower.OnTimeRemainder / 1000;
+        GpsPower.OnTimeRemainder %= 1000;
+        GpsPower.ChargeRemainder += onTime * GPS_ACTIVE_CURRENT;
+        GpsPower.Stats.TotalCharge += GpsPower.ChargeRemainder / 1000;
+        GpsPower.ChargeRemainder %= 1000;
+    }
 }
 
-void GpsProcess( void )
+GpsStartType_t GpsGetStartType( uint32_t *timeToFix )
 {
-    GpsMcuProcess( );
+    GpsStartType_t startType = GPS_START_COLD;
+
+    if( GpsPower.LastFixValid == true )
+    {
+        uint32_t age = SysTimeGetMcuTime( ).Seconds - GpsPower.LastFixTime;
+
+        if( age < GPS_EPHEMERIS_VALIDITY )
+        {
+            startType = GPS_START_HOT;
+        }
+        else if( age < GPS_ALMANAC_VALIDITY )
+        {
+            startType = GPS_START_WARM;
+        }
+    }
+    *timeToFix = GpsPower.TimeToFix[startType];
+    return startType;
 }
 
-bool GpsGetPpsDetectedState( void )
+void GpsRequestFix( uint8_t maxHdop )
 {
-    bool state = false;
+    uint32_t timeToFix = 0;
+
+    if( GpsPower.FixRequested == true )
+    {
+        // Keep the running request, with the new accuracy
+        GpsPower.MaxHdop = maxHdop;
+        return;
+    }
+
+    GpsPower.StartType = GpsGetStartType( &timeToFix );
+    if( GpsPower.IsOn == true )
+    {
+        // The receiver is tracking, the fix is about to come
+        GpsPower.StartType = GPS_START_HOT;
+        timeToFix = GpsPower.TimeToFix[GPS_START_HOT];
+    }
+    GpsPower.Timeout = timeToFix * GPS_FIX_TIMEOUT_FACTOR;
+    GpsPower.RequestTime = TimerGetCurrentTime( );
 
     CRITICAL_SECTION_BEGIN( );
-    state = PpsDetected;
-    PpsDetected = false;
+    GpsPower.MaxHdop = maxHdop;
+    GpsPower.FixObtained = false;
+    GpsPower.FixRequested = true;
     CRITICAL_SECTION_END( );
-    return state;
+
+    GpsStart( );
 }
 
-bool GpsHasFix( void )
+bool GpsIsFixPending( void )
 {
-    return HasFix;
+    return GpsPower.FixRequested;
 }
 
-void GpsConvertPositionIntoBinary( void )
+void GpsGetFixStats( GpsFixStats_t *stats )
+{
+    *stats = GpsPower.Stats;
+}
+
+/*!
+ * \brief Ends the fix request, powers the receiver off and updates the
+ *        statistics
+ *
+ * \param [IN] fixObtained Set if the requested fix was obtained
+ */
+static void GpsEndFixRequest( bool fixObtained )
 {
-    long double temp;
+    uint32_t onTime = TimerGetElapsedTime( GpsPower.RequestTime );
+
+    GpsPower.FixRequested = false;
+    GpsStop( );
 
-    if( Latitude >= 0 ) // North
+    GpsPower.Stats.LastStartType = GpsPower.StartType;
+    GpsPower.Stats.LastOnTime = onTime;
+    GpsPower.Stats.LastCharge = onTime * GPS_ACTIVE_CURRENT;
+    if( fixObtained == true )
     {
-        temp = Latitude * MaxNorthPosition;
-        LatitudeBinary = temp / 90;
+        GpsPower.Stats.NbFixes++;
+        // Follow the measured times to fix
+        GpsPower.TimeToFix[GpsPower.StartType] = ( ( 3 * GpsPower.TimeToFix[GpsPower.StartType] ) + onTime ) / 4;
     }
-    else                // South
+    else
     {
-        temp = Latitude * MaxSouthPosition;
-        LatitudeBinary = temp / 90;
+        GpsPower.Stats.NbTimeouts++;
     }
+}
 
-    if( Longitude >= 0 ) // East
+/*!
+ * \brief Ends the fix request once the fix is obtained or the request has
+ *        timed out
+ */
+static void GpsProcessFixRequest( void )
+{
+    bool fixObtained = false;
+
+    CRITICAL_SECTION_BEGIN( );
+    fixObtained = GpsPower.FixObtained;
+    GpsPower.FixObtained = false;
+    CRITICAL_SECTION_END( );
+
+    if( ( HasFix == true ) && ( GpsPower.IsOn == true ) )
+    {
+        // The receiver keeps its ephemeris from any fix
+        GpsPower.LastFixValid = true;
+        GpsPower.LastFixTime = SysTimeGetMcuTime( ).Seconds;
+    }
+
+    if( GpsPower.FixRequested == false )
+    {
+        return;
+    }
+    if( fixObtained == true )
     {
-        temp = Longitude * MaxEastPosition;
-        LongitudeBinary = temp / 180;
+        GpsEndFixRequest( true );
     }
-    else                // West
+    else if( TimerGetElapsedTime( GpsPower.RequestTime ) > GpsPower.Timeout )
     {
-        temp = Longitude * MaxWestPosition;
-        LongitudeBinary = temp / 180;
+        GpsEndFixRequest( false );
     }
 }
 
-void GpsConvertPositionFromStringToNumerical( void )
+/*!
+ * \brief Computes the number of days from 1970-01-01 to a date
+ *
+ * \param [IN] year  Year
+ * \param [IN] month Month, 1 to 12
+ * \param [IN] day   Day of the month, 1 to 31
+ * \retval days      Number of days
+ */
+static int32_t GpsDaysFromCivil( int32_t year, int32_t month, int32_t day )
 {
-    int i;
+    // The year starts in March, the leap day is the last one
+    int32_t y = ( month <= 2 ) ? ( year - 1 ) : year;
+    int32_t era = y / 400;
+    int32_t yearOfEra = y - ( era * 400 );
+    int32_t dayOfYear = ( ( ( 153 * ( month + ( ( month > 2 ) ? -3 : 9 ) ) ) + 2 ) / 5 ) + day - 1;
+    int32_t dayOfEra = ( yearOfEra * 365 ) + ( yearOfEra / 4 ) - ( yearOfEra / 100 ) + dayOfYear;
+
+    return ( era * 146097 ) + dayOfEra - 719468;
+}
 
-    double valueTmp1;
-    double valueTmp2;
-    double valueTmp3;
-    double valueTmp4;
+/*!
+ * \brief Computes the UTC time of a PPS edge
+ *
+ * \remark The GGA sentences have no date. The day is then the one closest
+ *         to the system time, if it has been synchronized.
+ *
+ * \param [IN]  sync       PPS edge time
+ * \param [OUT] utcSeconds UTC time since the Unix epoch [s]
+ * \retval status          false if the date is unknown
+ */
+static bool GpsGetUtcSeconds( GpsTimeSync_t *sync, uint32_t *utcSeconds )
+{
+    uint32_t now = 0;
+    uint32_t days = 0;
 
-    // Convert the latitude from ASCII to uint8_t values
-    for( i = 0 ; i < 10 ; i++ )
+    if( sync->UtcDate != 0 )
     {
-        NmeaGpsData.NmeaLatitude[i] = NmeaGpsData.NmeaLatitude[i] & 0xF;
+        days = ( uint32_t )GpsDaysFromCivil( 2000 + ( sync->UtcDate % 100 ), ( sync->UtcDate / 100 ) % 100, sync->UtcDate / 10000 );
+        *utcSeconds = ( days * 86400 ) + ( uint32_t )sync->UtcTime;
+        return true;
+    }
+    if( SysTimeGetSyncAge( ) == UINT32_MAX )
+    {
+        return false;
     }
-    // Convert latitude from degree/minute/second (DMS) format into decimal
-    valueTmp1 = ( double )NmeaGpsData.NmeaLatitude[0] * 10.0 + ( double )NmeaGpsData.NmeaLatitude[1];
-    valueTmp2 = ( double )NmeaGpsData.NmeaLatitude[2] * 10.0 + ( double )NmeaGpsData.NmeaLatitude[3];
-    valueTmp3 = ( double )NmeaGpsData.NmeaLatitude[5] * 1000.0 + ( double )NmeaGpsData.NmeaLatitude[6] * 100.0 +
-                ( double )NmeaGpsData.NmeaLatitude[7] * 10.0 + ( double )NmeaGpsData.NmeaLatitude[8];
 
-    Latitude = valueTmp1 + ( ( valueTmp2 + ( valueTmp3 * 0.0001 ) ) / 60.0 );
+    now = SysTimeGet( ).Seconds - GPS_UTC_LEAP_SECONDS;
+    *utcSeconds = ( ( now / 86400 ) * 86400 ) + ( uint32_t )sync->UtcTime;
+    if( *utcSeconds > ( now + 43200 ) )
+    {
+        *utcSeconds -= 86400;
+    }
+    else if( ( *utcSeconds + 43200 ) < now )
+    {
+        *utcSeconds += 86400;
+    }
+    return true;
+}
 
-    if( NmeaGpsData.NmeaLatitudePole[0] == 'S' )
+/*!
+ * \brief Measures the RTC drift between two PPS edges and updates the system
+ *        time drift compensation
+ *
+ * \param [IN] ppsMcuTime MCU time of the PPS edge
+ * \param [IN] ppsTime    System time of the PPS edge
+ */
+static void GpsUpdateDrift( SysTime_t ppsMcuTime, SysTime_t ppsTime )
+{
+    if( GpsDriftRef.Valid == true )
     {
-        Latitude *= -1;
+        SysTime_t mcuElapsed = SysTimeSub( ppsMcuTime, GpsDriftRef.PpsMcuTime );
+        int64_t mcuMs = ( ( int64_t )mcuElapsed.Seconds * 1000 ) + mcuElapsed.SubSeconds;
+        int64_t gpsMs = ( int64_t )( int32_t )( ppsTime.Seconds - GpsDriftRef.PpsTime.Seconds ) * 1000;
+        int64_t drift = 0;
+
+        if( ( mcuMs >= 0 ) && ( mcuMs < ( ( int64_t )GPS_PPS_DRIFT_PERIOD * 1000 ) ) )
+        {
+            // Keep measuring from the same edge
+            return;
+        }
+        if( mcuMs > 0 )
+        {
+            // Positive when the RTC runs slow
+            drift = ( ( gpsMs - mcuMs ) * 1000000 ) / mcuMs;
+            if( ( drift <= GPS_PPS_MAX_DRIFT ) && ( drift >= -GPS_PPS_MAX_DRIFT ) )
+            {
+                SysTimeSetDrift( ( int32_t )drift );
+            }
+        }
     }
+    GpsDriftRef.PpsMcuTime = ppsMcuTime;
+    GpsDriftRef.PpsTime = ppsTime;
+    GpsDriftRef.Valid = true;
+}
 
-    // Convert the longitude from ASCII to uint8_t values
-    for( i = 0 ; i < 10 ; i++ )
+/*!
+ * \brief Synchronizes the system time on the latest PPS edge
+ */
+static void GpsSyncSysTime( void )
+{
+    GpsTimeSync_t sync;
+    SysTime_t ppsTime = { .Seconds = 0, .SubSeconds = 0 };
+    uint32_t utcSeconds = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    sync = GpsTimeSync;
+    GpsTimeSync.Pending = false;
+    CRITICAL_SECTION_END( );
+
+    if( ( sync.Pending == false ) || ( GpsGetUtcSeconds( &sync, &utcSeconds ) == false ) )
     {
-        NmeaGpsData.NmeaLongitude[i] = NmeaGpsData.NmeaLongitude[i] & 0xF;
+        return;
     }
-    // Convert longitude from degree/minute/second (DMS) format into decimal
-    valueTmp1 = ( double )NmeaGpsData.NmeaLongitude[0] * 100.0 + ( double )NmeaGpsData.NmeaLongitude[1] * 10.0 + ( double )NmeaGpsData.NmeaLongitude[2];
-    valueTmp2 = ( double )NmeaGpsData.NmeaLongitude[3] * 10.0 + ( double )NmeaGpsData.NmeaLongitude[4];
-    valueTmp3 = ( double )NmeaGpsData.NmeaLongitude[6] * 1000.0 + ( double )NmeaGpsData.NmeaLongitude[7] * 100;
-    valueTmp4 = ( double )NmeaGpsData.NmeaLongitude[8] * 10.0 + ( double )NmeaGpsData.NmeaLongitude[9];
 
-    Longitude = valueTmp1 + ( valueTmp2 / 60.0 ) + ( ( ( valueTmp3 + valueTmp4 ) * 0.0001 ) / 60.0 );
+    ppsTime.Seconds = utcSeconds + GPS_UTC_LEAP_SECONDS;
+    GpsUpdateDrift( sync.PpsMcuTime, ppsTime );
+
+    // The time elapsed since the edge is measured with the RTC
+    SysTimeSet( SysTimeAdd( ppsTime, SysTimeSub( SysTimeGetMcuTime( ), sync.PpsMcuTime ) ) );
+}
+
+void GpsProcess( void )
+{
+    GpsMcuProcess( );
+    GpsSyncSysTime( );
+    GpsProcessFixRequest( );
+}
+
+bool GpsGetPpsDetectedState( void )
+{
+    bool state = false;
+
+    CRITICAL_SECTION_BEGIN( );
+    state = PpsDetected;
+    PpsDetected = false;
+    CRITICAL_SECTION_END( );
+    return state;
+}
+
+bool GpsHasFix( void )
+{
+    return HasFix;
+}
+
+void GpsConvertPositionIntoBinary( void )
+{
+    // binary = degrees * maxPosition / maxDegrees, truncated toward zero
+    if( LatitudeFixed >= 0 ) // North
+    {
+        LatitudeBinary = ( ( int64_t )LatitudeFixed * MaxNorthPosition ) / ( 90 * ( int64_t )NMEA_POSITION_UNITS_PER_DEGREE );
+    }
+    else                     // South
+    {
+        LatitudeBinary = ( ( int64_t )LatitudeFixed * MaxSouthPosition ) / ( 90 * ( int64_t )NMEA_POSITION_UNITS_PER_DEGREE );
+    }
 
-    if( NmeaGpsData.NmeaLongitudePole[0] == 'W' )
+    if( LongitudeFixed >= 0 ) // East
+    {
+        LongitudeBinary = ( ( int64_t )LongitudeFixed * MaxEastPosition ) / ( 180 * ( int64_t )NMEA_POSITION_UNITS_PER_DEGREE );
+    }
+    else                      // West
     {
-        Longitude *= -1;
+        LongitudeBinary = ( ( int64_t )LongitudeFixed * MaxWestPosition ) / ( 180 * ( int64_t )NMEA_POSITION_UNITS_PER_DEGREE );
     }
 }
 
+void GpsConvertPositionFromStringToNumerical( void )
+{
+}
 
-uint8_t GpsGetLatestGpsPositionDouble( double *lati, double *longi )
+uint8_t GpsGetLatestGpsPositionFixed( int32_t *lati, int32_t *longi )
 {
     uint8_t status = FAIL;
+
+    CRITICAL_SECTION_BEGIN( );
     if( HasFix == true )
     {
         status = SUCCESS;
@@ -195,8 +690,21 @@ uint8_t GpsGetLatestGpsPositionDouble( double *lati, double *longi )
     {
         GpsResetPosition( );
     }
-    *lati = Latitude;
-    *longi = Longitude;
+    // The parsed units are an exact multiple of the microdegree
+    *lati = LatitudeFixed / ( NMEA_POSITION_UNITS_PER_DEGREE / GPS_POSITION_UNITS_PER_DEGREE );
+    *longi = LongitudeFixed / ( NMEA_POSITION_UNITS_PER_DEGREE / GPS_POSITION_UNITS_PER_DEGREE );
+    CRITICAL_SECTION_END( );
+    return status;
+}
+
+uint8_t GpsGetLatestGpsPositionDouble( double *lati, double *longi )
+{
+    int32_t latitude = 0;
+    int32_t longitude = 0;
+    uint8_t status = GpsGetLatestGpsPositionFixed( &latitude, &longitude );
+
+    *lati = ( double )latitude / GPS_POSITION_UNITS_PER_DEGREE;
+    *longi = ( double )longitude / GPS_POSITION_UNITS_PER_DEGREE;
     return status;
 }
 
@@ -224,7 +732,7 @@ int16_t GpsGetLatestGpsAltitude( void )
     CRITICAL_SECTION_BEGIN( );
     if( HasFix == true )
     {
-        Altitude = atoi( NmeaGpsData.NmeaAltitude );
+        Altitude = GgaAltitude;
     }
     else
     {
@@ -236,423 +744,473 @@ int16_t GpsGetLatestGpsAltitude( void )
 }
 
 /*!
- * Calculates the checksum for a NMEA sentence
- *
- * Skip the first '$' if necessary and calculate checksum until '*' character is
- * reached (or buffSize exceeded).
+ * \brief Converts an hexadecimal character into its value
  *
- * \retval chkPosIdx Position of the checksum in the sentence
+ * \param [IN] c Hexadecimal character
+ * \retval value Character value, 0xFF if not an hexadecimal character
  */
-int32_t GpsNmeaChecksum( int8_t *nmeaStr, int32_t nmeaStrSize, int8_t * checksum )
+static uint8_t GpsHexCharToNibble( char c )
 {
-    int i = 0;
-    uint8_t checkNum = 0;
-
-    // Check input parameters
-    if( ( nmeaStr == NULL ) || ( checksum == NULL ) || ( nmeaStrSize <= 1 ) )
+    if( ( c >= '0' ) && ( c <= '9' ) )
     {
-        return -1;
+        return c - '0';
     }
-
-    // Skip the first '$' if necessary
-    if( nmeaStr[i] == '$' )
+    if( ( c >= 'A' ) && ( c <= 'F' ) )
     {
-        i += 1;
+        return c - 'A' + 10;
     }
-
-    // XOR until '*' or max length is reached
-    while( nmeaStr[i] != '*' )
+    if( ( c >= 'a' ) && ( c <= 'f' ) )
     {
-        checkNum ^= nmeaStr[i];
-        i += 1;
-        if( i >= nmeaStrSize )
-        {
-            return -1;
-        }
+        return c - 'a' + 10;
     }
+    return 0xFF;
+}
 
-    // Convert checksum value to 2 hexadecimal characters
-    checksum[0] = Nibble2HexChar( checkNum / 16 ); // upper nibble
-    checksum[1] = Nibble2HexChar( checkNum % 16 ); // lower nibble
+/*!
+ * \brief Gets the kind of the current field of the sentence
+ */
+static NmeaField_t GpsNmeaGetField( void )
+{
+    uint8_t index = NmeaParser.FieldIndex - 1;
 
-    return i + 1;
+    if( NmeaParser.Sentence == NMEA_SENTENCE_GGA )
+    {
+        return ( index < ( sizeof( NmeaGgaFields ) / sizeof( NmeaGgaFields[0] ) ) ) ? NmeaGgaFields[index] : NMEA_FIELD_NONE;
+    }
+    return ( index < ( sizeof( NmeaRmcFields ) / sizeof( NmeaRmcFields[0] ) ) ) ? NmeaRmcFields[index] : NMEA_FIELD_NONE;
 }
 
 /*!
- * Calculate the checksum of a NMEA frame and compare it to the checksum that is
- * present at the end of it.
- * Return true if it matches
+ * \brief Starts a new field
  */
-static bool GpsNmeaValidateChecksum( int8_t *serialBuff, int32_t buffSize )
+static void GpsNmeaResetField( void )
 {
-    int32_t checksumIndex;
-    int8_t checksum[2]; // 2 characters to calculate NMEA checksum
+    NmeaParser.FieldSize = 0;
+    NmeaParser.IntPart = 0;
+    NmeaParser.FracPart = 0;
+    NmeaParser.NbFrac = 0;
+    NmeaParser.Decimal = false;
+    NmeaParser.Negative = false;
+    NmeaParser.FirstChar = 0;
+}
 
-    checksumIndex = GpsNmeaChecksum( serialBuff, buffSize, checksum );
+/*!
+ * \brief Converts the current field from (d)ddmm.mmmmm into a fixed point
+ *        position
+ *
+ * \param [IN]  maxDegrees Maximum value of the position [degrees]
+ * \param [OUT] position   Position [1 / NMEA_POSITION_UNITS_PER_MINUTE minute]
+ * \retval status          false if the field is not a valid position
+ */
+static bool GpsNmeaGetPosition( uint32_t maxDegrees, int32_t *position )
+{
+    uint32_t degrees = NmeaParser.IntPart / 100;
+    uint32_t minutes = NmeaParser.IntPart % 100;
+    uint32_t frac = NmeaParser.FracPart;
+    uint32_t value;
 
-    // could we calculate a verification checksum ?
-    if( checksumIndex < 0 )
+    if( NmeaParser.FieldSize == 0 )
     {
-        return false;
+        // No position available
+        *position = 0;
+        return true;
     }
-
-    // check if there are enough char in the serial buffer to read checksum
-    if( checksumIndex >= ( buffSize - 2 ) )
+    if( ( NmeaParser.Negative == true ) || ( minutes >= 60 ) || ( degrees > maxDegrees ) )
     {
         return false;
     }
-
-    // check the checksum
-    if( ( serialBuff[checksumIndex] == checksum[0] ) && ( serialBuff[checksumIndex + 1] == checksum[1] ) )
+    for( uint8_t i = NmeaParser.NbFrac; i < NMEA_POSITION_NB_DECIMALS; i++ )
     {
-        return true;
+        frac *= 10;
     }
-    else
+    value = ( degrees * 60 + minutes ) * NMEA_POSITION_UNITS_PER_MINUTE + frac;
+    if( value > ( maxDegrees * NMEA_POSITION_UNITS_PER_DEGREE ) )
     {
         return false;
     }
+    *position = ( int32_t )value;
+    return true;
 }
 
-uint8_t GpsParseGpsData( int8_t *rxBuffer, int32_t rxBufferSize )
+/*!
+ * \brief Adds a character to the current field
+ *
+ * \retval status false if the character is not valid for the field
+ */
+static bool GpsNmeaAddFieldChar( char c )
 {
-    uint8_t i = 1;
-    uint8_t j = 0;
-    uint8_t fieldSize = 0;
-
-    if( rxBuffer[0] != '$' )
-    {
-        GpsMcuInvertPpsTrigger( );
-        return FAIL;
-    }
-
-    if( GpsNmeaValidateChecksum( rxBuffer, rxBufferSize ) == false )
-    {
-        return FAIL;
-    }
+    NmeaParser.FieldSize++;
 
-    fieldSize = 0;
-    while( rxBuffer[i + fieldSize++] != ',' )
+    if( NmeaParser.FieldIndex == 0 )
     {
-        if( fieldSize > 6 )
+        if( NmeaParser.FieldSize > sizeof( NmeaParser.Type ) )
         {
-            return FAIL;
+            return false;
         }
+        NmeaParser.Type[NmeaParser.FieldSize - 1] = c;
+        return true;
     }
-    for( j = 0; j < fieldSize; j++, i++ )
-    {
-        NmeaGpsData.NmeaDataType[j] = rxBuffer[i];
-    }
-    // Parse the GPGGA data
-    if( strncmp( ( const char* )NmeaGpsData.NmeaDataType, ( const char* )NmeaDataTypeGPGGA, 5 ) == 0 )
+
+    switch( GpsNmeaGetField( ) )
     {
-        // NmeaUtcTime
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        case NMEA_FIELD_LATITUDE:
+        case NMEA_FIELD_LONGITUDE:
+        case NMEA_FIELD_HDOP:
+        case NMEA_FIELD_ALTITUDE:
         {
-            if( fieldSize > 11 )
+            if( ( c >= '0' ) && ( c <= '9' ) )
             {
-                return FAIL;
+                if( NmeaParser.Decimal == false )
+                {
+                    // (d)ddmm or the altitude integer part
+                    if( NmeaParser.IntPart >= 10000 )
+                    {
+                        return false;
+                    }
+                    NmeaParser.IntPart = NmeaParser.IntPart * 10 + ( c - '0' );
+                }
+                else if( NmeaParser.NbFrac < NMEA_POSITION_NB_DECIMALS )
+                {
+                    // The extra decimals are dropped
+                    NmeaParser.FracPart = NmeaParser.FracPart * 10 + ( c - '0' );
+                    NmeaParser.NbFrac++;
+                }
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaUtcTime[j] = rxBuffer[i];
-        }
-        // NmeaLatitude
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 10 )
+            else if( ( c == '.' ) && ( NmeaParser.Decimal == false ) )
             {
-                return FAIL;
+                NmeaParser.Decimal = true;
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaLatitude[j] = rxBuffer[i];
-        }
-        // NmeaLatitudePole
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 2 )
+            else if( ( c == '-' ) && ( NmeaParser.FieldSize == 1 ) )
             {
-                return FAIL;
+                NmeaParser.Negative = true;
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaLatitudePole[j] = rxBuffer[i];
-        }
-        // NmeaLongitude
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 11 )
+            else
             {
-                return FAIL;
+                return false;
             }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaLongitude[j] = rxBuffer[i];
-        }
-        // NmeaLongitudePole
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        case NMEA_FIELD_UTC_TIME:
+        case NMEA_FIELD_DATE:
         {
-            if( fieldSize > 2 )
+            // hhmmss.ss or ddmmyy, the fraction of second is dropped
+            if( ( c >= '0' ) && ( c <= '9' ) )
             {
-                return FAIL;
+                if( NmeaParser.Decimal == false )
+                {
+                    if( NmeaParser.IntPart >= 100000 )
+                    {
+                        return false;
+                    }
+                    NmeaParser.IntPart = NmeaParser.IntPart * 10 + ( c - '0' );
+                }
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaLongitudePole[j] = rxBuffer[i];
-        }
-        // NmeaFixQuality
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 2 )
+            else if( ( c == '.' ) && ( NmeaParser.Decimal == false ) )
             {
-                return FAIL;
+                NmeaParser.Decimal = true;
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaFixQuality[j] = rxBuffer[i];
-        }
-        // NmeaSatelliteTracked
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 3 )
+            else
             {
-                return FAIL;
+                return false;
             }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        case NMEA_FIELD_NONE:
         {
-            NmeaGpsData.NmeaSatelliteTracked[j] = rxBuffer[i];
+            break;
         }
-        // NmeaHorizontalDilution
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        default:
         {
-            if( fieldSize > 6 )
+            if( NmeaParser.FieldSize == 1 )
             {
-                return FAIL;
+                NmeaParser.FirstChar = c;
             }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaHorizontalDilution[j] = rxBuffer[i];
-        }
-        // NmeaAltitude
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+    }
+    return true;
+}
+
+/*!
+ * \brief Processes the current field once it is complete
+ *
+ * \retval status false if the field is not valid or the sentence is not
+ *                parsed
+ */
+static bool GpsNmeaEndField( void )
+{
+    if( NmeaParser.FieldIndex == 0 )
+    {
+        // Any talker identifier is accepted
+        NmeaParser.Sentence = NMEA_SENTENCE_UNKNOWN;
+        if( ( NmeaParser.FieldSize == sizeof( NmeaParser.Type ) ) && ( NmeaParser.Type[2] == 'G' ) &&
+            ( NmeaParser.Type[3] == 'G' ) && ( NmeaParser.Type[4] == 'A' ) )
         {
-            if( fieldSize > 8 )
-            {
-                return FAIL;
-            }
+            NmeaParser.Sentence = NMEA_SENTENCE_GGA;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        else if( ( NmeaParser.FieldSize == sizeof( NmeaParser.Type ) ) && ( NmeaParser.Type[2] == 'R' ) &&
+                 ( NmeaParser.Type[3] == 'M' ) && ( NmeaParser.Type[4] == 'C' ) )
         {
-            NmeaGpsData.NmeaAltitude[j] = rxBuffer[i];
+            NmeaParser.Sentence = NMEA_SENTENCE_RMC;
         }
-        // NmeaAltitudeUnit
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        return NmeaParser.Sentence != NMEA_SENTENCE_UNKNOWN;
+    }
+
+    switch( GpsNmeaGetField( ) )
+    {
+        case NMEA_FIELD_UTC_TIME:
         {
-            if( fieldSize > 2 )
+            uint32_t hours = NmeaParser.IntPart / 10000;
+            uint32_t minutes = ( NmeaParser.IntPart / 100 ) % 100;
+            uint32_t seconds = NmeaParser.IntPart % 100;
+
+            if( NmeaParser.FieldSize == 0 )
             {
-                return FAIL;
+                // No time available
+                break;
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaAltitudeUnit[j] = rxBuffer[i];
-        }
-        // NmeaHeightGeoid
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 8 )
+            if( ( hours >= 24 ) || ( minutes >= 60 ) || ( seconds >= 60 ) )
             {
-                return FAIL;
+                return false;
             }
+            NmeaParser.UtcTime = ( int32_t )( ( hours * 3600 ) + ( minutes * 60 ) + seconds );
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaHeightGeoid[j] = rxBuffer[i];
-        }
-        // NmeaHeightGeoidUnit
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        case NMEA_FIELD_DATE:
         {
-            if( fieldSize > 2 )
+            uint32_t day = NmeaParser.IntPart / 10000;
+            uint32_t month = ( NmeaParser.IntPart / 100 ) % 100;
+
+            if( NmeaParser.FieldSize == 0 )
             {
-                return FAIL;
+                // No date available
+                break;
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaHeightGeoidUnit[j] = rxBuffer[i];
-        }
-
-        GpsFormatGpsData( );
-        return SUCCESS;
-    }
-    else if ( strncmp( ( const char* )NmeaGpsData.NmeaDataType, ( const char* )NmeaDataTypeGPRMC, 5 ) == 0 )
-    {
-        // NmeaUtcTime
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 11 )
+            if( ( day == 0 ) || ( day > 31 ) || ( month == 0 ) || ( month > 12 ) )
             {
-                return FAIL;
+                return false;
             }
+            NmeaParser.UtcDate = NmeaParser.IntPart;
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        case NMEA_FIELD_STATUS:
         {
-            NmeaGpsData.NmeaUtcTime[j] = rxBuffer[i];
+            NmeaParser.Fix = ( NmeaParser.FirstChar == 'A' ) ? true : false;
+            break;
         }
-        // NmeaDataStatus
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        case NMEA_FIELD_LATITUDE:
         {
-            if( fieldSize > 2 )
-            {
-                return FAIL;
-            }
+            return GpsNmeaGetPosition( 90, &NmeaParser.Latitude );
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        case NMEA_FIELD_LATITUDE_POLE:
         {
-            NmeaGpsData.NmeaDataStatus[j] = rxBuffer[i];
-        }
-        // NmeaLatitude
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 10 )
+            if( NmeaParser.FirstChar == 'S' )
             {
-                return FAIL;
+                NmeaParser.Latitude = -NmeaParser.Latitude;
             }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        case NMEA_FIELD_LONGITUDE:
         {
-            NmeaGpsData.NmeaLatitude[j] = rxBuffer[i];
+            return GpsNmeaGetPosition( 180, &NmeaParser.Longitude );
         }
-        // NmeaLatitudePole
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        case NMEA_FIELD_LONGITUDE_POLE:
         {
-            if( fieldSize > 2 )
+            if( NmeaParser.FirstChar == 'W' )
             {
-                return FAIL;
+                NmeaParser.Longitude = -NmeaParser.Longitude;
             }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        case NMEA_FIELD_FIX_QUALITY:
         {
-            NmeaGpsData.NmeaLatitudePole[j] = rxBuffer[i];
+            NmeaParser.Fix = ( NmeaParser.FirstChar > '0' ) ? true : false;
+            break;
         }
-        // NmeaLongitude
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        case NMEA_FIELD_HDOP:
         {
-            if( fieldSize > 11 )
+            uint32_t tenths = 0;
+
+            if( NmeaParser.FieldSize == 0 )
             {
-                return FAIL;
+                break;
             }
-        }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaLongitude[j] = rxBuffer[i];
-        }
-        // NmeaLongitudePole
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
-        {
-            if( fieldSize > 2 )
+            if( NmeaParser.NbFrac > 0 )
             {
-                return FAIL;
+                tenths = NmeaParser.FracPart;
+                for( uint8_t i = 1; i < NmeaParser.NbFrac; i++ )
+                {
+                    tenths /= 10;
+                }
             }
+            tenths += NmeaParser.IntPart * 10;
+            NmeaParser.Hdop = ( uint8_t )MIN( tenths, GPS_FIX_ANY_HDOP - 1 );
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        case NMEA_FIELD_ALTITUDE:
         {
-            NmeaGpsData.NmeaLongitudePole[j] = rxBuffer[i];
+            NmeaParser.Altitude = ( NmeaParser.Negative == true ) ? -( int16_t )NmeaParser.IntPart : ( int16_t )NmeaParser.IntPart;
+            break;
         }
-        // NmeaSpeed
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        default:
         {
-            if( fieldSize > 8 )
-            {
-                return FAIL;
-            }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
-        {
-            NmeaGpsData.NmeaSpeed[j] = rxBuffer[i];
-        }
-        // NmeaDetectionAngle
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+    }
+    return true;
+}
+
+/*!
+ * \brief Publishes the values of a verified sentence
+ */
+static void GpsNmeaPublish( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    HasFix = NmeaParser.Fix;
+    LatitudeFixed = NmeaParser.Latitude;
+    LongitudeFixed = NmeaParser.Longitude;
+    if( NmeaParser.Sentence == NMEA_SENTENCE_GGA )
+    {
+        GgaAltitude = NmeaParser.Altitude;
+    }
+    GpsConvertPositionIntoBinary( );
+
+    if( ( GpsPower.FixRequested == true ) && ( NmeaParser.Fix == true ) &&
+        ( ( GpsPower.MaxHdop == GPS_FIX_ANY_HDOP ) || ( NmeaParser.Hdop <= GpsPower.MaxHdop ) ) )
+    {
+        GpsPower.FixObtained = true;
+    }
+
+    if( ( NmeaParser.Fix == true ) && ( NmeaParser.UtcTime >= 0 ) && ( PpsMcuTimeValid == true ) &&
+        ( SysTimeSub( SysTimeGetMcuTime( ), PpsMcuTime ).Seconds == 0 ) )
+    {
+        // The sentence gives the time of the second started by the latest
+        // PPS edge
+        GpsTimeSync.PpsMcuTime = PpsMcuTime;
+        GpsTimeSync.UtcTime = NmeaParser.UtcTime;
+        GpsTimeSync.UtcDate = NmeaParser.UtcDate;
+        GpsTimeSync.Pending = true;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+bool GpsParseGpsChar( uint8_t data )
+{
+    char c = ( char )data;
+
+    if( c == '$' )
+    {
+        // A new sentence always restarts the tokenizer
+        NmeaParser.State = NMEA_STATE_FIELDS;
+        NmeaParser.Sentence = NMEA_SENTENCE_UNKNOWN;
+        NmeaParser.Checksum = 0;
+        NmeaParser.Size = 1;
+        NmeaParser.FieldIndex = 0;
+        NmeaParser.Latitude = 0;
+        NmeaParser.Longitude = 0;
+        NmeaParser.Altitude = 0;
+        NmeaParser.Fix = false;
+        NmeaParser.UtcTime = -1;
+        NmeaParser.UtcDate = 0;
+        NmeaParser.Hdop = GPS_FIX_ANY_HDOP;
+        GpsNmeaResetField( );
+        return false;
+    }
+    if( NmeaParser.State == NMEA_STATE_IDLE )
+    {
+        return false;
+    }
+    if( ( ++NmeaParser.Size > NMEA_SENTENCE_MAX_SIZE ) || ( c == '\r' ) || ( c == '\n' ) )
+    {
+        NmeaParser.State = NMEA_STATE_IDLE;
+        return false;
+    }
+
+    switch( NmeaParser.State )
+    {
+        case NMEA_STATE_FIELDS:
         {
-            if( fieldSize > 8 )
+            if( c == '*' )
             {
-                return FAIL;
+                NmeaParser.State = ( GpsNmeaEndField( ) == true ) ? NMEA_STATE_CHECKSUM_HIGH : NMEA_STATE_IDLE;
             }
+            else if( c == ',' )
+            {
+                NmeaParser.Checksum ^= data;
+                if( GpsNmeaEndField( ) == false )
+                {
+                    // Unsupported sentence or invalid field
+                    NmeaParser.State = NMEA_STATE_IDLE;
+                }
+                NmeaParser.FieldIndex++;
+                GpsNmeaResetField( );
+            }
+            else
+            {
+                NmeaParser.Checksum ^= data;
+                if( GpsNmeaAddFieldChar( c ) == false )
+                {
+                    NmeaParser.State = NMEA_STATE_IDLE;
+                }
+            }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        case NMEA_STATE_CHECKSUM_HIGH:
         {
-            NmeaGpsData.NmeaDetectionAngle[j] = rxBuffer[i];
+            NmeaParser.RxChecksum = GpsHexCharToNibble( c );
+            NmeaParser.State = ( NmeaParser.RxChecksum <= 0x0F ) ? NMEA_STATE_CHECKSUM_LOW : NMEA_STATE_IDLE;
+            break;
         }
-        // NmeaDate
-        fieldSize = 0;
-        while( rxBuffer[i + fieldSize++] != ',' )
+        case NMEA_STATE_CHECKSUM_LOW:
         {
-            if( fieldSize > 8 )
+            uint8_t nibble = GpsHexCharToNibble( c );
+
+            NmeaParser.State = NMEA_STATE_IDLE;
+            if( ( nibble <= 0x0F ) && ( ( ( NmeaParser.RxChecksum << 4 ) | nibble ) == NmeaParser.Checksum ) )
             {
-                return FAIL;
+                GpsNmeaPublish( );
+                return true;
             }
+            break;
         }
-        for( j = 0; j < fieldSize; j++, i++ )
+        default:
         {
-            NmeaGpsData.NmeaDate[j] = rxBuffer[i];
+            break;
         }
-
-        GpsFormatGpsData( );
-        return SUCCESS;
-    }
-    else
-    {
-        return FAIL;
     }
+    return false;
 }
 
-void GpsFormatGpsData( void )
+uint8_t GpsParseGpsData( int8_t *rxBuffer, int32_t rxBufferSize )
 {
-    if( strncmp( ( const char* )NmeaGpsData.NmeaDataType, ( const char* )NmeaDataTypeGPGGA, 5 ) == 0 )
+    uint8_t status = FAIL;
+
+    if( rxBuffer[0] != '$' )
     {
-        HasFix = ( NmeaGpsData.NmeaFixQuality[0] > 0x30 ) ? true : false;
+        GpsMcuInvertPpsTrigger( );
+        return FAIL;
     }
-    else if ( strncmp( ( const char* )NmeaGpsData.NmeaDataType, ( const char* )NmeaDataTypeGPRMC, 5 ) == 0 )
+
+    for( int32_t i = 0; i < rxBufferSize; i++ )
     {
-        HasFix = ( NmeaGpsData.NmeaDataStatus[0] == 0x41 ) ? true : false;
+        if( GpsParseGpsChar( ( uint8_t )rxBuffer[i] ) == true )
+        {
+            status = SUCCESS;
+        }
     }
-    GpsConvertPositionFromStringToNumerical( );
+    return status;
+}
+
+void GpsFormatGpsData( void )
+{
     GpsConvertPositionIntoBinary( );
 }
 
 void GpsResetPosition( void )
 {
     Altitude = ( int16_t )0xFFFF;
-    Latitude = 0;
-    Longitude = 0;
+    LatitudeFixed = 0;
+    LongitudeFixed = 0;
     LatitudeBinary = 0;
     LongitudeBinary = 0;
 }
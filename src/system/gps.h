@@ -26,27 +26,133 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-/* Structure to handle the GPS parsed data in ASCII */
-typedef struct
+/*!
+ * Number of leap seconds between the GPS time and the UTC time [s]. The system
+ * time follows the GPS time scale, as the LoRaWAN DeviceTimeAns.
+ */
+#ifndef GPS_UTC_LEAP_SECONDS
+#define GPS_UTC_LEAP_SECONDS                        18
+#endif
+
+/*!
+ * Minimum time between the PPS edges the RTC drift is measured on [s]. The
+ * PPS edges are timestamped with the RTC, a longer period lowers the effect of
+ * the RTC resolution.
+ */
+#ifndef GPS_PPS_DRIFT_PERIOD
+#define GPS_PPS_DRIFT_PERIOD                        600
+#endif
+
+/*!
+ * Largest RTC frequency error accepted by the PPS drift measurement [ppm].
+ * Larger measurements are considered as a time step and restart the
+ * measurement.
+ */
+#ifndef GPS_PPS_MAX_DRIFT
+#define GPS_PPS_MAX_DRIFT                           500
+#endif
+
+/*!
+ * Time since the last fix during which the receiver ephemeris are valid and
+ * the next start is a hot start [s]
+ */
+#ifndef GPS_EPHEMERIS_VALIDITY
+#define GPS_EPHEMERIS_VALIDITY                      14400
+#endif
+
+/*!
+ * Time since the last fix during which the receiver almanac is valid and the
+ * next start is a warm start [s]. The receiver cold starts afterwards.
+ */
+#ifndef GPS_ALMANAC_VALIDITY
+#define GPS_ALMANAC_VALIDITY                        604800
+#endif
+
+/*!
+ * Initial time to fix estimates of the hot, warm and cold starts [ms]. The
+ * estimates follow the measured times to fix.
+ */
+#ifndef GPS_HOT_START_TTF
+#define GPS_HOT_START_TTF                           5000
+#endif
+#ifndef GPS_WARM_START_TTF
+#define GPS_WARM_START_TTF                          35000
+#endif
+#ifndef GPS_COLD_START_TTF
+#define GPS_COLD_START_TTF                          60000
+#endif
+
+/*!
+ * A fix request is abandoned after this many times the estimated time to fix
+ */
+#ifndef GPS_FIX_TIMEOUT_FACTOR
+#define GPS_FIX_TIMEOUT_FACTOR                      3
+#endif
+
+/*!
+ * Receiver current while it is powered [mA]
+ */
+#ifndef GPS_ACTIVE_CURRENT
+#define GPS_ACTIVE_CURRENT                          25
+#endif
+
+/*!
+ * Fixed point position units per degree, the positions are given in
+ * microdegrees
+ */
+#define GPS_POSITION_UNITS_PER_DEGREE               1000000
+
+/*!
+ * Horizontal dilution of precision accepting any fix
+ */
+#define GPS_FIX_ANY_HDOP                            0xFF
+
+/*!
+ * Receiver start types, given by the age of the last fix
+ */
+typedef enum eGpsStartType
+{
+    GPS_START_HOT,
+    GPS_START_WARM,
+    GPS_START_COLD,
+    GPS_START_TYPE_NB,
+}GpsStartType_t;
+
+/*!
+ * Fix requests statistics
+ */
+typedef struct sGpsFixStats
 {
-    char NmeaDataType[6];
-    char NmeaUtcTime[11];
-    char NmeaDataStatus[2];
-    char NmeaLatitude[10];
-    char NmeaLatitudePole[2];
-    char NmeaLongitude[11];
-    char NmeaLongitudePole[2];
-    char NmeaFixQuality[2];
-    char NmeaSatelliteTracked[3];
-    char NmeaHorizontalDilution[6];
-    char NmeaAltitude[8];
-    char NmeaAltitudeUnit[2];
-    char NmeaHeightGeoid[8];
-    char NmeaHeightGeoidUnit[2];
-    char NmeaSpeed[8];
-    char NmeaDetectionAngle[8];
-    char NmeaDate[8];
-}NmeaGpsData_t;
+    /*!
+     * Number of fixes obtained for the requests
+     */
+    uint32_t NbFixes;
+    /*!
+     * Number of requests abandoned without fix
+     */
+    uint32_t NbTimeouts;
+    /*!
+     * Start type of the latest request
+     */
+    GpsStartType_t LastStartType;
+    /*!
+     * Receiver on time of the latest request [ms]
+     */
+    uint32_t LastOnTime;
+    /*!
+     * Receiver charge of the latest request [uAs]. The energy is the charge
+     * times the supply voltage.
+     */
+    uint32_t LastCharge;
+    /*!
+     * Cumulated receiver on time, requests or not [s]
+     */
+    uint32_t TotalOnTime;
+    /*!
+     * Cumulated receiver charge [mAs]
+     */
+    uint32_t TotalCharge;
+}GpsFixStats_t;
 
 /*!
  * \brief Initializes the handling of the GPS receiver
@@ -64,12 +170,57 @@ void GpsStart( void );
 void GpsStop( void );
 
 /*!
- * Updates the GPS status
+ * \brief Powers the receiver on until it gets a fix of the requested
+ *        accuracy
+ *
+ * \remark \ref GpsProcess powers the receiver off as soon as a verified
+ *         sentence reports such a fix, or once \ref GPS_FIX_TIMEOUT_FACTOR
+ *         times the time to fix estimated for the start type has elapsed.
+ *         Only the GGA sentences report the accuracy.
+ *
+ * \param [IN] maxHdop Maximum horizontal dilution of precision, in tenths.
+ *                     \ref GPS_FIX_ANY_HDOP accepts any fix.
+ */
+void GpsRequestFix( uint8_t maxHdop );
+
+/*!
+ * \brief Indicates if a fix request is in progress
+ *
+ * \retval pending
+ */
+bool GpsIsFixPending( void );
+
+/*!
+ * \brief Predicts the start type of the receiver from the age of the last fix
+ *
+ * \param [OUT] timeToFix Estimated time to fix [ms]
+ *
+ * \retval startType
+ */
+GpsStartType_t GpsGetStartType( uint32_t *timeToFix );
+
+/*!
+ * \brief Gets the fix requests statistics
+ *
+ * \param [OUT] stats Statistics
+ */
+void GpsGetFixStats( GpsFixStats_t *stats );
+
+/*!
+ * \brief Updates the GPS status. Synchronizes the system time on the latest
+ *        PPS edge and updates the RTC drift compensation.
+ *
+ * \remark Must be called from the main loop, the system time isn't updated
+ *         from the interrupts.
  */
 void GpsProcess( void );
 
 /*!
  * \brief PPS signal handling function
+ *
+ * \remark Timestamps the PPS edge with the RTC. The next parsed GGA or RMC
+ *         sentence gives the time of the second the edge started. The
+ *         system time is synchronized by \ref GpsProcess.
  */
 void GpsPpsHandler( bool *parseData );
 
@@ -94,15 +245,34 @@ bool GpsHasFix( void );
 void GpsConvertPositionIntoBinary( void );
 
 /*!
- * \brief Converts the latest Position (latitude and Longitude) from ASCII into
- *        DMS numerical format
+ * \brief Converts the latest Position (latitude and Longitude) into decimal
+ *        degrees
+ *
+ * \remark The position is parsed into fixed point, nothing is left to
+ *         convert. Kept for compatibility.
  */
 void GpsConvertPositionFromStringToNumerical( void );
 
+/*!
+ * \brief Gets the latest Position (latitude and Longitude) in fixed point if
+ *        available
+ *
+ * \param [OUT] lati Latitude [1 / GPS_POSITION_UNITS_PER_DEGREE degree],
+ *                   positive to the North
+ * \param [OUT] longi Longitude [1 / GPS_POSITION_UNITS_PER_DEGREE degree],
+ *                    positive to the East
+ *
+ * \retval status [SUCCESS, FAIL]
+ */
+uint8_t GpsGetLatestGpsPositionFixed( int32_t *lati, int32_t *longi );
+
 /*!
  * \brief Gets the latest Position (latitude and Longitude) as two double values
  *        if available
  *
+ * \remark Wrapper of \ref GpsGetLatestGpsPositionFixed. The floating point
+ *         support is only linked in by the applications calling it.
+ *
  * \param [OUT] lati Latitude value
  * \param [OUT] longi Longitude value
  *
@@ -121,10 +291,24 @@ uint8_t GpsGetLatestGpsPositionDouble ( double *lati, double *longi );
  */
 uint8_t GpsGetLatestGpsPositionBinary ( int32_t *latiBin, int32_t *longiBin );
 
+/*!
+ * \brief Feeds a character received from the GPS to the NMEA tokenizer.
+ *
+ * \remark The checksum is computed and the fields are extracted as the
+ *         characters are received. Only the GGA and RMC sentences are parsed,
+ *         the other sentences are skipped after their type. The position is
+ *         updated once the sentence checksum is verified.
+ *
+ * \param [IN] data Received character
+ *
+ * \retval status true when a GGA or RMC sentence has been parsed
+ */
+bool GpsParseGpsChar( uint8_t data );
+
 /*!
  * \brief Parses the NMEA sentence.
  *
- * \remark Only parses GPGGA and GPRMC sentences
+ * \remark Only parses GGA and RMC sentences
  *
  * \param [IN] rxBuffer Data buffer to be parsed
  * \param [IN] rxBufferSize Size of data buffer
@@ -21,6 +21,7 @@
  * \author    Gregory Cristian ( Semtech )
  */
 #include <stdbool.h>
+#include <stddef.h>
 #include "utilities.h"
 #include "i2c-board.h"
 
@@ -35,6 +36,8 @@ void I2cInit( I2c_t *obj, I2cId_t i2cId, PinNames scl, PinNames sda )
     {
         I2cInitialized = true;
 
+        obj->TransferDone = NULL;
+        obj->Context = NULL;
         I2cMcuInit( obj, i2cId, scl, sda );
         I2cMcuFormat( obj, MODE_I2C, I2C_DUTY_CYCLE_2, true, I2C_ACK_ADD_7_BIT, 400000 );
     }
@@ -53,29 +56,14 @@ void I2cResetBus( I2c_t *obj )
 
 uint8_t I2cWrite( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t data )
 {
-    if( I2cInitialized == true )
-    {
-        if( I2cMcuWriteBuffer( obj, deviceAddr, addr, &data, 1 ) == FAIL )
-        {
-            // if first attempt fails due to an IRQ, try a second time
-            if( I2cMcuWriteBuffer( obj, deviceAddr, addr, &data, 1 ) == FAIL )
-            {
-                return FAIL;
-            }
-            else
-            {
-                return SUCCESS;
-            }
-        }
-        else
-        {
-            return SUCCESS;
-        }
-    }
-    else
-    {
-        return FAIL;
-    }
+    I2cTransferCallback *callback = obj->TransferDone;
+    uint8_t status;
+
+    // data lives on the stack, the write must be done before returning
+    obj->TransferDone = NULL;
+    status = I2cWriteBuffer( obj, deviceAddr, addr, &data, 1 );
+    obj->TransferDone = callback;
+    return status;
 }
 
 uint8_t I2cWriteBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *buffer, uint16_t size )
@@ -85,7 +73,7 @@ uint8_t I2cWriteBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *
         if( I2cMcuWriteBuffer( obj, deviceAddr, addr, buffer, size ) == FAIL )
         {
             // if first attempt fails due to an IRQ, try a second time
-            if( I2cMcuWriteBuffer( obj, deviceAddr, addr, buffer, size ) == FAIL )
+            if( ( obj->TransferDone != NULL ) || ( I2cMcuWriteBuffer( obj, deviceAddr, addr, buffer, size ) == FAIL ) )
             {
                 return FAIL;
             }
@@ -107,14 +95,13 @@ uint8_t I2cWriteBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *
 
 uint8_t I2cRead( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *data )
 {
-    if( I2cInitialized == true )
-    {
-        return( I2cMcuReadBuffer( obj, deviceAddr, addr, data, 1 ) );
-    }
-    else
-    {
-        return FAIL;
-    }
+    I2cTransferCallback *callback = obj->TransferDone;
+    uint8_t status;
+
+    obj->TransferDone = NULL;
+    status = I2cReadBuffer( obj, deviceAddr, addr, data, 1 );
+    obj->TransferDone = callback;
+    return status;
 }
 
 uint8_t I2cReadBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *buffer, uint16_t size )
@@ -128,3 +115,11 @@ uint8_t I2cReadBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *b
         return FAIL;
     }
 }
+
+void I2cSetTransferCallback( I2c_t *obj, I2cTransferCallback *callback, void* context )
+{
+    CRITICAL_SECTION_BEGIN( );
+    obj->TransferDone = callback;
+    obj->Context = context;
+    CRITICAL_SECTION_END( );
+}
@@ -34,6 +34,14 @@ typedef enum
     I2C_2,
 }I2cId_t;
 
+/*!
+ * I2C transfer completion callback
+ *
+ * \param [IN] context Context given to I2cSetTransferCallback
+ * \param [IN] status  [SUCCESS, FAIL]
+ */
+typedef void( I2cTransferCallback )( void* context, uint8_t status );
+
 /*!
  * I2C object type definition
  */
@@ -42,6 +50,8 @@ typedef struct
     I2cId_t I2cId;
     Gpio_t Scl;
     Gpio_t Sda;
+    I2cTransferCallback* TransferDone;
+    void* Context;
 }I2c_t;
 
 /*!
@@ -80,11 +90,16 @@ uint8_t I2cWrite( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t data );
 /*!
  * \brief Write data buffer to the I2C device
  *
+ * \remark The transfer is non-blocking when a transfer callback is set, the
+ *         buffer must then stay valid until the callback is called.
+ *
  * \param [IN] obj              I2C object
  * \param [IN] deviceAddr       device address
  * \param [IN] addr             data address
  * \param [IN] buffer           data buffer to write
  * \param [IN] size             number of bytes to write
+ * \retval status [SUCCESS, FAIL] In non-blocking mode SUCCESS when the
+ *                                transfer is started
  */
 uint8_t I2cWriteBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *buffer, uint16_t size );
 
@@ -101,12 +116,31 @@ uint8_t I2cRead( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *data );
 /*!
  * \brief Read data buffer from the I2C device
  *
+ * \remark The transfer is non-blocking when a transfer callback is set, the
+ *         buffer must then stay valid until the callback is called.
+ *
  * \param [IN] obj              I2C object
  * \param [IN] deviceAddr       device address
  * \param [IN] addr             data address
  * \param [OUT] buffer          data buffer to read
  * \param [IN] size             number of data bytes to read
+ * \retval status [SUCCESS, FAIL] In non-blocking mode SUCCESS when the
+ *                                transfer is started
  */
 uint8_t I2cReadBuffer( I2c_t *obj, uint8_t deviceAddr, uint16_t addr, uint8_t *buffer, uint16_t size );
 
+/*!
+ * \brief Sets the callback called at the end of the buffer transfers
+ *
+ * \remark When a callback is set I2cWriteBuffer and I2cReadBuffer return as
+ *         soon as the transfer is started. The callback is called from
+ *         interrupt context on boards using DMA. I2cWrite and I2cRead stay
+ *         blocking. Set the callback to NULL to go back to blocking transfers.
+ *
+ * \param [IN] obj      I2C object
+ * \param [IN] callback Transfer completion callback
+ * \param [IN] context  Context passed to the callback
+ */
+void I2cSetTransferCallback( I2c_t *obj, I2cTransferCallback *callback, void* context );
+
 #endif // __I2C_H__
@@ -0,0 +1,574 @@
+/*!
+ * \file      nvmlog.c
+ *
+ * \brief     Log structured non-volatile memory store
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "utilities.h"
+#include "eeprom.h"
+#include "crc.h"
+#include "nvmlog.h"
+
+/*!
+ * Bank header magic number
+ */
+#define NVM_LOG_BANK_MAGIC                          0x4C4E
+
+/*!
+ * Bank header: magic number, sequence number and CRC
+ */
+#define NVM_LOG_BANK_HEADER_SIZE                    8
+
+/*!
+ * Record header: block index and flags, offset, size and CRC
+ */
+#define NVM_LOG_RECORD_HEADER_SIZE                  7
+
+/*!
+ * Record flags, stored with the block index
+ */
+#define NVM_LOG_RECORD_COMMIT                       0x80
+#define NVM_LOG_RECORD_FULL                         0x40
+#define NVM_LOG_RECORD_ID_MASK                      0x3F
+
+/*!
+ * Size of the stack buffer used to read the records data
+ */
+#define NVM_LOG_READ_CHUNK_SIZE                     32
+
+/*!
+ * Record header
+ */
+typedef struct sNvmLogRecord
+{
+    /*!
+     * Block index and flags
+     */
+    uint8_t Id;
+    /*!
+     * Offset of the data in the block
+     */
+    uint16_t Offset;
+    /*!
+     * Size of the data
+     */
+    uint16_t Size;
+}NvmLogRecord_t;
+
+/*!
+ * Log context
+ */
+typedef struct sNvmLogCtx
+{
+    /*!
+     * Blocks stored in the log
+     */
+    NvmLogBlock_t* Blocks;
+    /*!
+     * Number of blocks. 0 when not initialized
+     */
+    uint8_t NbBlocks;
+    /*!
+     * Active bank index
+     */
+    uint8_t Bank;
+    /*!
+     * Active bank sequence number, incremented on each compaction. Part of
+     * the records CRC, the records left by a previous use of the bank are
+     * never valid.
+     */
+    uint32_t Sequence;
+    /*!
+     * Offset of the first free byte of the active bank
+     */
+    uint16_t End;
+    /*!
+     * One bit per block whose records could not be written. The block is
+     * written again as a full record.
+     */
+    uint64_t Failed;
+}NvmLogCtx_t;
+
+/*!
+ * Module context
+ */
+static NvmLogCtx_t NvmLogCtx;
+
+/*!
+ * \brief Computes the CRC of a record header, seeded with the bank sequence
+ */
+static uint16_t NvmLogRecordCrc( uint32_t sequence, const uint8_t* header )
+{
+    uint8_t seq[4];
+
+    seq[0] = sequence & 0xFF;
+    seq[1] = ( sequence >> 8 ) & 0xFF;
+    seq[2] = ( sequence >> 16 ) & 0xFF;
+    seq[3] = ( sequence >> 24 ) & 0xFF;
+    return Crc16Update( Crc16Update( 0xFFFF, seq, 4 ), header, NVM_LOG_RECORD_HEADER_SIZE - 2 );
+}
+
+static uint16_t NvmLogBankAddr( uint8_t bank )
+{
+    return NVM_LOG_START_ADDR + ( bank * NVM_LOG_BANK_SIZE );
+}
+
+/*!
+ * \brief Reads a bank header
+ *
+ * \param [IN]  bank     Bank index
+ * \param [OUT] sequence Bank sequence number
+ * \retval              true if the header is valid
+ */
+static bool NvmLogReadBankHeader( uint8_t bank, uint32_t* sequence )
+{
+    uint8_t header[NVM_LOG_BANK_HEADER_SIZE];
+
+    if( EepromReadBuffer( NvmLogBankAddr( bank ), header, NVM_LOG_BANK_HEADER_SIZE ) != SUCCESS )
+    {
+        return false;
+    }
+    if( ( ( header[0] | ( header[1] << 8 ) ) != NVM_LOG_BANK_MAGIC ) ||
+        ( ( header[6] | ( header[7] << 8 ) ) != Crc16Update( 0xFFFF, header, 6 ) ) )
+    {
+        return false;
+    }
+    *sequence = ( uint32_t )header[2] | ( ( uint32_t )header[3] << 8 ) |
+                ( ( uint32_t )header[4] << 16 ) | ( ( uint32_t )header[5] << 24 );
+    return true;
+}
+
+static bool NvmLogWriteBankHeader( uint8_t bank, uint32_t sequence )
+{
+    uint8_t header[NVM_LOG_BANK_HEADER_SIZE];
+    uint16_t crc;
+
+    header[0] = NVM_LOG_BANK_MAGIC & 0xFF;
+    header[1] = ( NVM_LOG_BANK_MAGIC >> 8 ) & 0xFF;
+    header[2] = sequence & 0xFF;
+    header[3] = ( sequence >> 8 ) & 0xFF;
+    header[4] = ( sequence >> 16 ) & 0xFF;
+    header[5] = ( sequence >> 24 ) & 0xFF;
+    crc = Crc16Update( 0xFFFF, header, 6 );
+    header[6] = crc & 0xFF;
+    header[7] = crc >> 8;
+    return ( EepromWriteBuffer( NvmLogBankAddr( bank ), header, NVM_LOG_BANK_HEADER_SIZE ) == SUCCESS );
+}
+
+/*!
+ * \brief Record part write completion callback
+ *
+ * \param [IN] status  Write status
+ * \param [IN] context Block the record belongs to
+ */
+static void NvmLogOnWriteDone( uint8_t status, void* context )
+{
+    if( status != SUCCESS )
+    {
+        NvmLogCtx.Failed |= 1ULL << ( ( NvmLogBlock_t* )context - NvmLogCtx.Blocks );
+    }
+}
+
+/*!
+ * \brief Reads and checks the record at the given offset of the active bank
+ *
+ * \param [IN]  offset Record offset in the bank
+ * \param [OUT] record Record header
+ * \retval            true if the record is valid
+ */
+static bool NvmLogReadRecord( uint16_t offset, NvmLogRecord_t* record )
+{
+    uint8_t header[NVM_LOG_RECORD_HEADER_SIZE];
+    uint8_t data[NVM_LOG_READ_CHUNK_SIZE];
+    uint16_t addr = NvmLogBankAddr( NvmLogCtx.Bank ) + offset;
+    uint16_t crc;
+    uint8_t id;
+
+    if( ( offset + NVM_LOG_RECORD_HEADER_SIZE ) > NVM_LOG_BANK_SIZE )
+    {
+        return false;
+    }
+    if( EepromReadBuffer( addr, header, NVM_LOG_RECORD_HEADER_SIZE ) != SUCCESS )
+    {
+        return false;
+    }
+    record->Id = header[0];
+    record->Offset = header[1] | ( header[2] << 8 );
+    record->Size = header[3] | ( header[4] << 8 );
+
+    id = record->Id & NVM_LOG_RECORD_ID_MASK;
+    if( ( id >= NvmLogCtx.NbBlocks ) || ( record->Size == 0 ) ||
+        ( ( ( uint32_t )record->Offset + record->Size ) > NvmLogCtx.Blocks[id].Size ) ||
+        ( ( ( uint32_t )offset + NVM_LOG_RECORD_HEADER_SIZE + record->Size ) > NVM_LOG_BANK_SIZE ) )
+    {
+        return false;
+    }
+
+    crc = NvmLogRecordCrc( NvmLogCtx.Sequence, header );
+    addr += NVM_LOG_RECORD_HEADER_SIZE;
+    for( uint16_t i = 0; i < record->Size; i += NVM_LOG_READ_CHUNK_SIZE )
+    {
+        uint16_t size = ( ( record->Size - i ) < NVM_LOG_READ_CHUNK_SIZE ) ? ( record->Size - i ) : NVM_LOG_READ_CHUNK_SIZE;
+
+        if( EepromReadBuffer( addr + i, data, size ) != SUCCESS )
+        {
+            return false;
+        }
+        crc = Crc16Update( crc, data, size );
+    }
+    return ( ( header[5] | ( header[6] << 8 ) ) == crc );
+}
+
+/*!
+ * \brief Appends a record to the given bank
+ *
+ * \param [IN] bank     Bank index
+ * \param [IN] sequence Bank sequence number
+ * \param [IN] offset   Record offset in the bank
+ * \param [IN] record   Record header
+ * \param [IN] data     Record data
+ * \retval             true if the record has been written
+ */
+static bool NvmLogWriteRecord( uint8_t bank, uint32_t sequence, uint16_t offset, NvmLogRecord_t* record, const uint8_t* data )
+{
+    uint8_t header[NVM_LOG_RECORD_HEADER_SIZE];
+    uint16_t addr = NvmLogBankAddr( bank ) + offset;
+    NvmLogBlock_t* block = &NvmLogCtx.Blocks[record->Id & NVM_LOG_RECORD_ID_MASK];
+    uint16_t crc;
+
+    header[0] = record->Id;
+    header[1] = record->Offset & 0xFF;
+    header[2] = record->Offset >> 8;
+    header[3] = record->Size & 0xFF;
+    header[4] = record->Size >> 8;
+    crc = Crc16Update( NvmLogRecordCrc( sequence, header ), data, record->Size );
+    header[5] = crc & 0xFF;
+    header[6] = crc >> 8;
+
+    // The record is only valid once both parts are written. The queued
+    // writes complete in order, the header last.
+    if( EepromWriteBufferAsync( addr + NVM_LOG_RECORD_HEADER_SIZE, ( uint8_t* )data, record->Size, NvmLogOnWriteDone, block ) != SUCCESS )
+    {
+        return false;
+    }
+    return ( EepromWriteBufferAsync( addr, header, NVM_LOG_RECORD_HEADER_SIZE, NvmLogOnWriteDone, block ) == SUCCESS );
+}
+
+/*!
+ * \brief Finds the next byte range which differs between the image and the
+ *        new contents of a block
+ *
+ * \param [IN]     block Block
+ * \param [IN]     data  New block contents
+ * \param [IN/OUT] start Search start offset, set to the range start
+ * \retval              Range size. 0 when no byte differs
+ */
+static uint16_t NvmLogNextDelta( NvmLogBlock_t* block, const uint8_t* data, uint16_t* start )
+{
+    uint16_t i = *start;
+    uint16_t last;
+
+    while( ( i < block->Size ) && ( block->Image[i] == data[i] ) )
+    {
+        i++;
+    }
+    if( i >= block->Size )
+    {
+        return 0;
+    }
+    *start = i;
+    last = i;
+
+    // Merge the changes separated by less than a record header
+    for( i = i + 1; ( i < block->Size ) && ( ( i - last ) <= NVM_LOG_DELTA_GAP ); i++ )
+    {
+        if( block->Image[i] != data[i] )
+        {
+            last = i;
+        }
+    }
+    return last - *start + 1;
+}
+
+NvmLogStatus_t NvmLogInit( NvmLogBlock_t* blocks, uint8_t nbBlocks )
+{
+    uint32_t sequence[2];
+    bool valid[2];
+    uint32_t size = NVM_LOG_BANK_HEADER_SIZE;
+    uint16_t maxSize = 0;
+    uint16_t offset;
+    uint16_t commitEnd;
+    NvmLogRecord_t record;
+
+    NvmLogCtx.NbBlocks = 0;
+    NvmLogCtx.Failed = 0;
+
+    if( ( blocks == NULL ) || ( nbBlocks == 0 ) || ( nbBlocks > NVM_LOG_MAX_NB_BLOCKS ) )
+    {
+        return NVMLOG_ERROR_PARAM;
+    }
+    for( uint8_t i = 0; i < nbBlocks; i++ )
+    {
+        memset1( blocks[i].Image, 0, blocks[i].Size );
+        // Nothing to store for an empty block
+        blocks[i].Stored = ( blocks[i].Size == 0 );
+        size += NVM_LOG_RECORD_HEADER_SIZE + blocks[i].Size;
+        if( blocks[i].Size > maxSize )
+        {
+            maxSize = blocks[i].Size;
+        }
+    }
+    // A compaction must leave room for a full write of any block
+    if( ( size + NVM_LOG_RECORD_HEADER_SIZE + maxSize ) > NVM_LOG_BANK_SIZE )
+    {
+        return NVMLOG_ERROR_SIZE;
+    }
+    NvmLogCtx.Blocks = blocks;
+    NvmLogCtx.NbBlocks = nbBlocks;
+
+    // The active bank is the valid one with the latest sequence number
+    valid[0] = NvmLogReadBankHeader( 0, &sequence[0] );
+    valid[1] = NvmLogReadBankHeader( 1, &sequence[1] );
+    if( ( valid[0] == false ) && ( valid[1] == false ) )
+    {
+        NvmLogCtx.Bank = 0;
+        NvmLogCtx.Sequence = 1;
+        NvmLogCtx.End = NVM_LOG_BANK_HEADER_SIZE;
+        if( NvmLogWriteBankHeader( NvmLogCtx.Bank, NvmLogCtx.Sequence ) == false )
+        {
+            NvmLogCtx.NbBlocks = 0;
+            return NVMLOG_ERROR_NVM;
+        }
+        return NVMLOG_SUCCESS;
+    }
+    if( ( valid[1] == true ) && ( ( valid[0] == false ) || ( ( int32_t )( sequence[1] - sequence[0] ) > 0 ) ) )
+    {
+        NvmLogCtx.Bank = 1;
+    }
+    else
+    {
+        NvmLogCtx.Bank = 0;
+    }
+    NvmLogCtx.Sequence = sequence[NvmLogCtx.Bank];
+
+    // Find the end of the last committed write
+    offset = NVM_LOG_BANK_HEADER_SIZE;
+    commitEnd = offset;
+    while( NvmLogReadRecord( offset, &record ) == true )
+    {
+        offset += NVM_LOG_RECORD_HEADER_SIZE + record.Size;
+        if( ( record.Id & NVM_LOG_RECORD_COMMIT ) != 0 )
+        {
+            commitEnd = offset;
+        }
+    }
+
+    // Replay the committed records
+    offset = NVM_LOG_BANK_HEADER_SIZE;
+    while( offset < commitEnd )
+    {
+        uint8_t header[NVM_LOG_RECORD_HEADER_SIZE];
+        NvmLogBlock_t* block;
+        uint16_t addr = NvmLogBankAddr( NvmLogCtx.Bank ) + offset;
+
+        // Already checked by the first pass
+        EepromReadBuffer( addr, header, NVM_LOG_RECORD_HEADER_SIZE );
+        record.Id = header[0];
+        record.Offset = header[1] | ( header[2] << 8 );
+        record.Size = header[3] | ( header[4] << 8 );
+
+        block = &blocks[record.Id & NVM_LOG_RECORD_ID_MASK];
+        EepromReadBuffer( addr + NVM_LOG_RECORD_HEADER_SIZE, block->Image + record.Offset, record.Size );
+        if( ( record.Id & NVM_LOG_RECORD_FULL ) != 0 )
+        {
+            block->Stored = true;
+        }
+        offset += NVM_LOG_RECORD_HEADER_SIZE + record.Size;
+    }
+    NvmLogCtx.End = commitEnd;
+
+    return NVMLOG_SUCCESS;
+}
+
+NvmLogStatus_t NvmLogWrite( uint8_t id, const uint8_t* data )
+{
+    NvmLogBlock_t* block;
+    NvmLogRecord_t record;
+    uint16_t start;
+    uint16_t size;
+    uint32_t needed = 0;
+
+    if( ( id >= NvmLogCtx.NbBlocks ) || ( data == NULL ) )
+    {
+        return NVMLOG_ERROR_PARAM;
+    }
+    block = &NvmLogCtx.Blocks[id];
+    if( block->Size == 0 )
+    {
+        return NVMLOG_SUCCESS;
+    }
+    if( ( NvmLogCtx.Failed & ( 1ULL << id ) ) != 0 )
+    {
+        // Replaces the records which could not be written
+        NvmLogCtx.Failed &= ~( 1ULL << id );
+        block->Stored = false;
+    }
+
+    // Space taken by the records
+    if( block->Stored == false )
+    {
+        needed = NVM_LOG_RECORD_HEADER_SIZE + block->Size;
+    }
+    else
+    {
+        start = 0;
+        while( ( size = NvmLogNextDelta( block, data, &start ) ) > 0 )
+        {
+            needed += NVM_LOG_RECORD_HEADER_SIZE + size;
+            start += size;
+        }
+        if( needed == 0 )
+        {
+            // Unchanged
+            return NVMLOG_SUCCESS;
+        }
+    }
+
+    if( ( NvmLogCtx.End + needed ) > NVM_LOG_BANK_SIZE )
+    {
+        NvmLogStatus_t status = NvmLogCompact( );
+
+        if( status != NVMLOG_SUCCESS )
+        {
+            return status;
+        }
+        if( ( NvmLogCtx.End + needed ) > NVM_LOG_BANK_SIZE )
+        {
+            // Too many deltas, write the whole block instead
+            needed = NVM_LOG_RECORD_HEADER_SIZE + block->Size;
+            block->Stored = false;
+        }
+    }
+
+    if( block->Stored == false )
+    {
+        record.Id = id | NVM_LOG_RECORD_FULL | NVM_LOG_RECORD_COMMIT;
+        record.Offset = 0;
+        record.Size = block->Size;
+        if( NvmLogWriteRecord( NvmLogCtx.Bank, NvmLogCtx.Sequence, NvmLogCtx.End, &record, data ) == false )
+        {
+            return NVMLOG_ERROR_NVM;
+        }
+        NvmLogCtx.End += NVM_LOG_RECORD_HEADER_SIZE + record.Size;
+    }
+    else
+    {
+        uint16_t offset = NvmLogCtx.End;
+
+        start = 0;
+        while( ( size = NvmLogNextDelta( block, data, &start ) ) > 0 )
+        {
+            record.Id = id;
+            record.Offset = start;
+            record.Size = size;
+            offset += NVM_LOG_RECORD_HEADER_SIZE + size;
+            if( offset == ( NvmLogCtx.End + needed ) )
+            {
+                // The last record commits the write
+                record.Id |= NVM_LOG_RECORD_COMMIT;
+            }
+            if( NvmLogWriteRecord( NvmLogCtx.Bank, NvmLogCtx.Sequence, offset - NVM_LOG_RECORD_HEADER_SIZE - size, &record, data + start ) == false )
+            {
+                return NVMLOG_ERROR_NVM;
+            }
+            start += size;
+        }
+        NvmLogCtx.End = offset;
+    }
+
+    if( ( NvmLogCtx.Failed & ( 1ULL << id ) ) != 0 )
+    {
+        // Written without queuing and failed
+        return NVMLOG_ERROR_NVM;
+    }
+    memcpy1( block->Image, data, block->Size );
+    block->Stored = true;
+    return NVMLOG_SUCCESS;
+}
+
+NvmLogStatus_t NvmLogCompact( void )
+{
+    uint8_t bank = NvmLogCtx.Bank ^ 1;
+    uint32_t sequence = NvmLogCtx.Sequence + 1;
+    uint16_t offset = NVM_LOG_BANK_HEADER_SIZE;
+    NvmLogRecord_t record;
+
+    if( NvmLogCtx.NbBlocks == 0 )
+    {
+        return NVMLOG_ERROR_PARAM;
+    }
+
+    for( uint8_t i = 0; i < NvmLogCtx.NbBlocks; i++ )
+    {
+        NvmLogBlock_t* block = &NvmLogCtx.Blocks[i];
+
+        if( ( block->Stored == false ) || ( block->Size == 0 ) )
+        {
+            continue;
+        }
+        record.Id = i | NVM_LOG_RECORD_FULL | NVM_LOG_RECORD_COMMIT;
+        record.Offset = 0;
+        record.Size = block->Size;
+        NvmLogCtx.Failed &= ~( 1ULL << i );
+        if( NvmLogWriteRecord( bank, sequence, offset, &record, block->Image ) == false )
+        {
+            return NVMLOG_ERROR_NVM;
+        }
+        offset += NVM_LOG_RECORD_HEADER_SIZE + block->Size;
+    }
+
+    // The records must be written before the bank header
+    EepromFlush( );
+    if( NvmLogCtx.Failed != 0 )
+    {
+        return NVMLOG_ERROR_NVM;
+    }
+
+    // Switch banks. Until then the current bank stays the active one.
+    if( NvmLogWriteBankHeader( bank, sequence ) == false )
+    {
+        return NVMLOG_ERROR_NVM;
+    }
+    NvmLogCtx.Bank = bank;
+    NvmLogCtx.Sequence = sequence;
+    NvmLogCtx.End = offset;
+
+    return NVMLOG_SUCCESS;
+}
+
+uint16_t NvmLogGetFreeSpace( void )
+{
+    if( NvmLogCtx.NbBlocks == 0 )
+    {
+        return 0;
+    }
+    return NVM_LOG_BANK_SIZE - NvmLogCtx.End;
+}
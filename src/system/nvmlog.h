@@ -0,0 +1,154 @@
+/*!
+ * \file      nvmlog.h
+ *
+ * \brief     Log structured non-volatile memory store
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#ifndef __NVMLOG_H__
+#define __NVMLOG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * EEPROM address of the log
+ */
+#ifndef NVM_LOG_START_ADDR
+#define NVM_LOG_START_ADDR                          0
+#endif
+
+/*!
+ * Size of each of the two log banks. The log uses 2 * NVM_LOG_BANK_SIZE
+ * bytes of EEPROM.
+ *
+ * \remark A bank must hold a full record of each block plus one more for
+ *         the largest block, see \ref NvmLogInit.
+ */
+#ifndef NVM_LOG_BANK_SIZE
+#define NVM_LOG_BANK_SIZE                           2560
+#endif
+
+/*!
+ * Unchanged bytes between two changed ones below which a single delta record
+ * is written. Set a bit beyond the record header size.
+ */
+#ifndef NVM_LOG_DELTA_GAP
+#define NVM_LOG_DELTA_GAP                           8
+#endif
+
+/*!
+ * Maximum number of blocks handled by the log
+ */
+#define NVM_LOG_MAX_NB_BLOCKS                       64
+
+/*!
+ * NvmLog Status
+ */
+typedef enum eNvmLogStatus
+{
+    /*!
+     * No error occurred
+     */
+    NVMLOG_SUCCESS = 0,
+    /*!
+     * The blocks do not fit in a log bank
+     */
+    NVMLOG_ERROR_SIZE,
+    /*!
+     * Unknown block or log not initialized
+     */
+    NVMLOG_ERROR_PARAM,
+    /*!
+     * EEPROM access failure
+     */
+    NVMLOG_ERROR_NVM,
+}NvmLogStatus_t;
+
+/*!
+ * Block stored in the log
+ */
+typedef struct sNvmLogBlock
+{
+    /*!
+     * Copy of the block contents as stored in the log. Owned by the caller,
+     * must hold Size bytes.
+     */
+    uint8_t* Image;
+    /*!
+     * Block size
+     */
+    uint16_t Size;
+    /*!
+     * Set when the log holds the block contents
+     */
+    bool Stored;
+}NvmLogBlock_t;
+
+/*!
+ * \brief Initializes the log and restores the blocks contents
+ *
+ * \remark The log is made of two banks. The active one starts with a full
+ *         record of each stored block, followed by the delta records
+ *         appended by \ref NvmLogWrite. When the active bank is full, the
+ *         blocks are compacted into the other bank, which only becomes the
+ *         active one once completely written.
+ *         Each record is protected by a CRC and the last record of each
+ *         write carries a commit flag: the records following the last
+ *         commit, left by a power failure, are ignored.
+ *
+ * \param [IN] blocks   Blocks stored in the log, identified by their index.
+ *                      The images are set to the restored contents, or to
+ *                      zero for the blocks which are not stored yet.
+ * \param [IN] nbBlocks Number of blocks [1:NVM_LOG_MAX_NB_BLOCKS]
+ * \retval              Status of the operation. NVMLOG_ERROR_SIZE if the
+ *                      blocks do not fit in a bank.
+ */
+NvmLogStatus_t NvmLogInit( NvmLogBlock_t* blocks, uint8_t nbBlocks );
+
+/*!
+ * \brief Stores the new contents of a block
+ *
+ * \remark Only the byte ranges which differ from the block image are
+ *         appended to the log, a frame counter update only costs a few
+ *         bytes. The image is then updated.
+ *
+ * \param [IN] id   Block index
+ * \param [IN] data New block contents, of the block size
+ * \retval          Status of the operation
+ */
+NvmLogStatus_t NvmLogWrite( uint8_t id, const uint8_t* data );
+
+/*!
+ * \brief Copies the stored blocks into the other bank and makes it the
+ *        active one
+ *
+ * \remark Called by \ref NvmLogWrite when the active bank is full. May be
+ *         called beforehand, when the application is idle, to avoid the
+ *         compaction delay on a later write.
+ *
+ * \retval Status of the operation
+ */
+NvmLogStatus_t NvmLogCompact( void );
+
+/*!
+ * \brief Gets the free space of the active bank
+ *
+ * \retval Number of free bytes
+ */
+uint16_t NvmLogGetFreeSpace( void );
+
+#endif // __NVMLOG_H__
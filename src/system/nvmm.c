@@ -23,10 +23,19 @@ Maintainer: Miguel Luis ( Semtech ), Gregory Cristian ( Semtech ),
 
 #include "utilities.h"
 #include "eeprom.h"
+#include "crc.h"
 #include "nvmm.h"
 
 #define NVMM_MAGIC_NUMBER                   0xA23
 
+/*!
+ * Size of the stack buffer used to read a data block while computing its
+ * checksum
+ */
+#ifndef NVMM_READ_CHUNK_SIZE
+#define NVMM_READ_CHUNK_SIZE                32
+#endif
+
 typedef struct sDataBlockHeader
 {
     /*
@@ -41,28 +50,32 @@ typedef struct sDataBlockHeader
 
 static uint16_t DataBlockAdrCnt = sizeof( DataBlockHeader_t );
 
-static uint32_t ComputeChecksum( uint8_t* data, uint16_t size )
+static uint32_t ChecksumEnd( uint32_t crc )
 {
-    uint32_t checksum = NVMM_MAGIC_NUMBER; // Start with a magic number
+    // Mix in a magic number, an erased data block header never matches
+    return crc ^ NVMM_MAGIC_NUMBER;
+}
 
-    for( uint16_t i = 0; i < size; i++ )
-    {
-        checksum += data[i];
-    }
-    return checksum;
+static uint32_t ComputeChecksum( uint8_t* data, uint16_t size )
+{
+    return ChecksumEnd( Crc32Update( 0, data, size ) );
 }
 
 static uint32_t ComputeChecksumNvm( uint16_t addr, uint16_t size )
 {
-    uint32_t checksum = NVMM_MAGIC_NUMBER; // Start with a magic number
-    uint8_t data = 0;
+    uint8_t data[NVMM_READ_CHUNK_SIZE];
+    uint32_t crc = 0;
 
-    for( uint16_t i = 0; i < size; i++ )
+    while( size > 0 )
     {
-        EepromReadBuffer( addr + i, &data, 1 );
-        checksum += data;
+        uint16_t chunkSize = ( size < NVMM_READ_CHUNK_SIZE ) ? size : NVMM_READ_CHUNK_SIZE;
+
+        EepromReadBuffer( addr, data, chunkSize );
+        crc = Crc32Update( crc, data, chunkSize );
+        addr += chunkSize;
+        size -= chunkSize;
     }
-    return checksum;
+    return ChecksumEnd( crc );
 }
 
 /*
@@ -76,6 +89,8 @@ NvmmStatus_t NvmmDeclare( NvmmDataBlock_t* dataB, size_t num )
     // Increment the internal data block address
     dataB->virtualAddr = DataBlockAdrCnt;
 
+    dataB->verified = false;
+
     if( NvmmVerify( dataB, num ) == NVMM_SUCCESS )
     {
         retval = NVMM_SUCCESS;
@@ -110,8 +125,14 @@ NvmmStatus_t NvmmVerify( NvmmDataBlock_t* dataB, size_t num )
         return NVMM_FAIL_CHECKSUM;
     }
 
+    if( dataB->verified == true )
+    {
+        return NVMM_SUCCESS;
+    }
+
     if( ComputeChecksumNvm( dataB->virtualAddr, dataBHdr.Num ) == dataBHdr.CSum )
     {
+        dataB->verified = true;
         return NVMM_SUCCESS;
     }
     else
@@ -144,6 +165,9 @@ NvmmStatus_t NvmmWrite( NvmmDataBlock_t* dataB, void* src, size_t num )
     // Write data block
     EepromWriteBuffer( dataB->virtualAddr, ( uint8_t* ) src, num );
 
+    // The checksum only matches when the whole data block has been written
+    dataB->verified = ( num == dataBHdr.Num );
+
     CRITICAL_SECTION_END( );
 
     return NVMM_SUCCESS;
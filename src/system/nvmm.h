@@ -35,6 +35,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 /*!
  * Nvmm Status
@@ -72,6 +73,11 @@ typedef struct
    * Unique internal used virtual address for the data block.
    */
   uint16_t virtualAddr;
+  /*
+   * Set once the data block contents have been verified or written. Avoids
+   * reading the whole block again on the following verifications.
+   */
+  bool verified;
 }NvmmDataBlock_t;
 
 /*!
@@ -86,6 +92,9 @@ typedef struct
  * Reads the data block header and verifies the checksum to determine
  * if it ever has been written or the data is corrupted.
  *
+ * \remark The checksum is a CRC-32 of the data block contents. It is only
+ *         computed on the first verification of the data block handle.
+ *
  * \param[IN] dataB  Pointer to the data block.
  * \param[IN] num    Size as number of bytes.
  * \retval           Status of the operation
@@ -0,0 +1,168 @@
+/*!
+ * \file      packet-pool.c
+ *
+ * \brief     Reference counted packet buffers pool
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utilities.h"
+#include "packet-pool.h"
+
+#ifdef PACKET_POOL_ENABLED
+
+/*!
+ * Pool blocks, words keep them aligned for the word copies
+ */
+static uint32_t PacketPoolBlocks[PACKET_POOL_NB_BLOCKS][( PACKET_POOL_BLOCK_SIZE + 3 ) / 4];
+
+/*!
+ * Number of references of each block, 0 when the block is free
+ */
+static uint8_t PacketPoolRefCnts[PACKET_POOL_NB_BLOCKS];
+
+/*!
+ * Usage statistics
+ */
+static PacketPoolStats_t PacketPoolStats;
+
+/*!
+ * \brief Gets the index of the block holding the buffer
+ *
+ * \param [IN] buffer Any address
+ * \retval index      Block index, -1 if the buffer isn't part of the pool
+ */
+static int8_t GetBlockIndex( const void* buffer )
+{
+    uintptr_t address = ( uintptr_t )buffer;
+    uintptr_t start = ( uintptr_t )PacketPoolBlocks;
+
+    if( ( address < start ) || ( address >= ( start + sizeof( PacketPoolBlocks ) ) ) )
+    {
+        return -1;
+    }
+    return ( int8_t )( ( address - start ) / sizeof( PacketPoolBlocks[0] ) );
+}
+
+uint8_t* PacketPoolAlloc( void )
+{
+    uint8_t* block = NULL;
+
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < PACKET_POOL_NB_BLOCKS; i++ )
+    {
+        if( PacketPoolRefCnts[i] == 0 )
+        {
+            PacketPoolRefCnts[i] = 1;
+            PacketPoolStats.NbUsed++;
+            PacketPoolStats.PeakUsed = MAX( PacketPoolStats.PeakUsed, PacketPoolStats.NbUsed );
+            block = ( uint8_t* )PacketPoolBlocks[i];
+            break;
+        }
+    }
+    if( block == NULL )
+    {
+        PacketPoolStats.NbAllocFailures++;
+    }
+    CRITICAL_SECTION_END( );
+    return block;
+}
+
+void PacketPoolRef( const void* buffer )
+{
+    int8_t index = GetBlockIndex( buffer );
+
+    if( index < 0 )
+    {
+        return;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    if( PacketPoolRefCnts[index] > 0 )
+    {
+        PacketPoolRefCnts[index]++;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void PacketPoolFree( const void* buffer )
+{
+    int8_t index = GetBlockIndex( buffer );
+
+    if( index < 0 )
+    {
+        return;
+    }
+    CRITICAL_SECTION_BEGIN( );
+    if( PacketPoolRefCnts[index] > 0 )
+    {
+        PacketPoolRefCnts[index]--;
+        if( PacketPoolRefCnts[index] == 0 )
+        {
+            PacketPoolStats.NbUsed--;
+        }
+    }
+    CRITICAL_SECTION_END( );
+}
+
+uint8_t* PacketPoolGetBlock( const void* buffer )
+{
+    int8_t index = GetBlockIndex( buffer );
+
+    if( index < 0 )
+    {
+        return NULL;
+    }
+    return ( uint8_t* )PacketPoolBlocks[index];
+}
+
+void PacketPoolGetStats( PacketPoolStats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    *stats = PacketPoolStats;
+    CRITICAL_SECTION_END( );
+}
+
+#else
+
+uint8_t* PacketPoolAlloc( void )
+{
+    return NULL;
+}
+
+void PacketPoolRef( const void* buffer )
+{
+}
+
+void PacketPoolFree( const void* buffer )
+{
+}
+
+uint8_t* PacketPoolGetBlock( const void* buffer )
+{
+    return NULL;
+}
+
+void PacketPoolGetStats( PacketPoolStats_t* stats )
+{
+    stats->NbUsed = 0;
+    stats->PeakUsed = 0;
+    stats->NbAllocFailures = 0;
+}
+
+#endif // PACKET_POOL_ENABLED
@@ -0,0 +1,111 @@
+/*!
+ * \file      packet-pool.h
+ *
+ * \brief     Reference counted packet buffers pool
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \remark    The pool holds \ref PACKET_POOL_NB_BLOCKS fixed size blocks. A
+ *            block returns to the pool when its last reference is released,
+ *            which lets a buffer be handed from a layer to the next one
+ *            without copy. The blocks are large enough for a
+ *            LoRaMacMcpsReqBuffer_t, the layout used for the uplinks built in
+ *            place. Only available when PACKET_POOL_ENABLED is defined,
+ *            otherwise no block can be allocated.
+ */
+#ifndef __PACKET_POOL_H__
+#define __PACKET_POOL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * Number of blocks of the pool
+ */
+#ifndef PACKET_POOL_NB_BLOCKS
+#define PACKET_POOL_NB_BLOCKS                       3
+#endif
+
+/*!
+ * Size of a block [bytes]
+ */
+#ifndef PACKET_POOL_BLOCK_SIZE
+#define PACKET_POOL_BLOCK_SIZE                      272
+#endif
+
+/*!
+ * Pool usage statistics
+ */
+typedef struct sPacketPoolStats
+{
+    /*!
+     * Number of allocated blocks
+     */
+    uint8_t NbUsed;
+    /*!
+     * Highest number of simultaneously allocated blocks
+     */
+    uint8_t PeakUsed;
+    /*!
+     * Number of allocations which found the pool empty
+     */
+    uint32_t NbAllocFailures;
+}PacketPoolStats_t;
+
+/*!
+ * \brief Allocates a block with a single reference
+ *
+ * \retval block Start of the block, 4 bytes aligned. NULL if the pool is empty
+ */
+uint8_t* PacketPoolAlloc( void );
+
+/*!
+ * \brief Adds a reference to the block holding the buffer
+ *
+ * \remark Does nothing if the buffer isn't part of the pool, so that the
+ *         callers handle the pool and static buffers alike.
+ *
+ * \param [IN] buffer Any address within the block
+ */
+void PacketPoolRef( const void* buffer );
+
+/*!
+ * \brief Releases a reference to the block holding the buffer. The block
+ *        returns to the pool with its last reference.
+ *
+ * \remark Does nothing if the buffer isn't part of the pool.
+ *
+ * \param [IN] buffer Any address within the block
+ */
+void PacketPoolFree( const void* buffer );
+
+/*!
+ * \brief Gets the block holding the buffer
+ *
+ * \param [IN] buffer Any address
+ * \retval block      Start of the block, NULL if the buffer isn't part of the
+ *                    pool
+ */
+uint8_t* PacketPoolGetBlock( const void* buffer );
+
+/*!
+ * \brief Gets the pool usage statistics
+ *
+ * \param [OUT] stats Pool usage statistics
+ */
+void PacketPoolGetStats( PacketPoolStats_t* stats );
+
+#endif // __PACKET_POOL_H__
@@ -34,6 +34,11 @@ typedef enum
     SPI_2,
 }SpiId_t;
 
+/*!
+ * SPI transfer completion callback
+ */
+typedef void( SpiTransferCallback )( void* context );
+
 /*!
  * SPI object type definition
  */
@@ -44,6 +49,8 @@ typedef struct Spi_s
     Gpio_t Miso;
     Gpio_t Sclk;
     Gpio_t Nss;
+    SpiTransferCallback* TransferDone;
+    void* Context;
 }Spi_t;
 
 /*!
@@ -97,4 +104,32 @@ void SpiFrequency( Spi_t *obj, uint32_t hz );
  */
 uint16_t SpiInOut( Spi_t *obj, uint16_t outData );
 
+/*!
+ * \brief Sends and receives a burst of bytes
+ *
+ * \remark When no completion callback is set the function returns once the
+ *         transfer is done. Otherwise it returns as soon as the transfer is
+ *         started and the callback is called upon completion.
+ *
+ * \remark The buffers must stay valid until the transfer completes.
+ *
+ * \param [IN]  obj      SPI object
+ * \param [IN]  txBuffer Bytes to be sent. When NULL 0x00 bytes are sent
+ * \param [OUT] rxBuffer Received bytes. When NULL the received bytes are dropped
+ * \param [IN]  size     Number of bytes to be transferred
+ */
+void SpiTransfer( Spi_t *obj, const uint8_t *txBuffer, uint8_t *rxBuffer, uint16_t size );
+
+/*!
+ * \brief Sets the callback called upon \ref SpiTransfer completion
+ *
+ * \remark The callback is called from interrupt context. Setting it to NULL
+ *         makes \ref SpiTransfer blocking.
+ *
+ * \param [IN] obj      SPI object
+ * \param [IN] callback Transfer completion callback
+ * \param [IN] context  Context passed to the callback
+ */
+void SpiSetTransferCallback( Spi_t *obj, SpiTransferCallback *callback, void* context );
+
 #endif // __SPI_H__
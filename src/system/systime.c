@@ -23,6 +23,7 @@
  * \author    MCD Application Team ( STMicroelectronics International )
  */
 #include <stdio.h>
+#include <stdbool.h>
 #include "rtc-board.h"
 #include "systime.h"
 
@@ -51,6 +52,17 @@
 
 #define DIV_APPROX_1000( X )                        ( ( ( X ) >> 10 ) +( ( X ) >> 16 ) + ( ( X ) >> 17 ) )
 
+/*!
+ * \brief Divides a 32 bits value by 1000 with a multiply and a shift, exact
+ *        over the whole range
+ */
+#define DIV_1000( X )                               ( ( uint32_t )( ( ( uint64_t )( X ) * 0x10624DD3 ) >> 38 ) )
+
+/*!
+ * \brief Number of fractional bits of the scaled RTC frequency error
+ */
+#define SYS_TIME_DRIFT_FRAC_BITS                    30
+
 #define DIV_APPROX_60( X )                          ( ( ( X ) * 17476 ) >> 20 )
 
 #define DIV_APPROX_61( X )                          ( ( ( X ) * 68759 ) >> 22 )
@@ -73,6 +85,153 @@ static void CalendarDiv60( uint32_t in, uint32_t* out, uint32_t* remainder );
 
 const char *WeekDayString[]={ "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
 
+/*!
+ * RTC frequency error compensated by SysTimeGetTicks [ppm]
+ */
+static int32_t SysTimeDrift = 0;
+
+/*!
+ * RTC frequency error as a fraction of the elapsed ticks, scaled by
+ * 2^SYS_TIME_DRIFT_FRAC_BITS. Lets the compensation be computed without
+ * division.
+ */
+static int64_t SysTimeDriftScaled = 0;
+
+/*!
+ * MCU time of the last SysTimeSetTicks call [ticks]. The drift compensation
+ * is accumulated from this point.
+ */
+static SysTimeTicks_t SysTimeDriftRefTicks = 0;
+
+/*!
+ * MCU time of the last system time synchronization [s]
+ */
+static uint32_t SysTimeSyncSeconds = 0;
+
+/*!
+ * Set once the system time has been synchronized
+ */
+static bool SysTimeSyncValid = false;
+
+/*!
+ * \brief Converts milliseconds lower than a second into ticks, rounded up so
+ *        that the ticks convert back into the same milliseconds
+ *
+ * \param [IN] timeMs Time [ms]
+ *
+ * \retval ticks Time [ticks]
+ */
+static SysTimeTicks_t SysTimeSubMsToTicks( uint32_t timeMs )
+{
+    return DIV_1000( ( timeMs << SYS_TIME_TICKS_FRAC_BITS ) + 999 );
+}
+
+/*!
+ * \brief Gets the offset between the system time and the MCU time, kept by
+ *        the RTC backup registers
+ *
+ * \retval offset System time offset [ticks]
+ */
+static SysTimeTicks_t SysTimeGetOffsetTicks( void )
+{
+    uint32_t seconds = 0;
+    uint32_t subSeconds = 0;
+
+    RtcBkupRead( &seconds, &subSeconds );
+    return ( ( SysTimeTicks_t )seconds << SYS_TIME_TICKS_FRAC_BITS ) + SysTimeSubMsToTicks( subSeconds );
+}
+
+/*!
+ * \brief Computes the drift compensation accumulated up to the given MCU time
+ *
+ * \param [IN] mcuTicks MCU time [ticks]
+ *
+ * \retval compensation Time to add to the MCU time [ticks]
+ */
+static int64_t SysTimeGetDriftCompensation( SysTimeTicks_t mcuTicks )
+{
+    if( SysTimeDriftScaled == 0 )
+    {
+        return 0;
+    }
+    return ( ( int64_t )( mcuTicks - SysTimeDriftRefTicks ) * SysTimeDriftScaled ) >> SYS_TIME_DRIFT_FRAC_BITS;
+}
+
+SysTimeTicks_t SysTimeGetMcuTicks( void )
+{
+    uint16_t subSeconds = 0;
+    uint32_t seconds = RtcGetCalendarTime( &subSeconds );
+
+    return ( ( SysTimeTicks_t )seconds << SYS_TIME_TICKS_FRAC_BITS ) + SysTimeSubMsToTicks( subSeconds );
+}
+
+SysTimeTicks_t SysTimeGetTicks( void )
+{
+    SysTimeTicks_t mcuTicks = SysTimeGetMcuTicks( );
+
+    return ( mcuTicks + SysTimeGetOffsetTicks( ) + SysTimeGetDriftCompensation( mcuTicks ) ) & SYS_TIME_TICKS_MASK;
+}
+
+void SysTimeSetTicks( SysTimeTicks_t ticks )
+{
+    SysTimeTicks_t mcuTicks = SysTimeGetMcuTicks( );
+    SysTime_t offset = SysTimeTicksToSysTime( ( ticks - mcuTicks ) & SYS_TIME_TICKS_MASK );
+
+    RtcBkupWrite( offset.Seconds, ( uint32_t )offset.SubSeconds );
+
+    // The drift compensation restarts from the new time
+    SysTimeDriftRefTicks = mcuTicks;
+
+    SysTimeSyncSeconds = ( uint32_t )( mcuTicks >> SYS_TIME_TICKS_FRAC_BITS );
+    SysTimeSyncValid = true;
+}
+
+SysTimeTicks_t SysTimeTicksFromSysTime( SysTime_t sysTime )
+{
+    return ( ( SysTimeTicks_t )sysTime.Seconds << SYS_TIME_TICKS_FRAC_BITS ) + SysTimeSubMsToTicks( ( uint16_t )sysTime.SubSeconds );
+}
+
+SysTime_t SysTimeTicksToSysTime( SysTimeTicks_t ticks )
+{
+    SysTime_t sysTime =
+    {
+        .Seconds = ( uint32_t )( ticks >> SYS_TIME_TICKS_FRAC_BITS ),
+        .SubSeconds = ( int16_t )( ( ( ticks & SYS_TIME_TICKS_SUB_SECONDS_MASK ) * 1000 ) >> SYS_TIME_TICKS_FRAC_BITS )
+    };
+    return sysTime;
+}
+
+SysTimeTicks_t SysTimeTicksFromMs( uint32_t timeMs )
+{
+    uint32_t seconds = DIV_1000( timeMs );
+
+    return ( ( SysTimeTicks_t )seconds << SYS_TIME_TICKS_FRAC_BITS ) + SysTimeSubMsToTicks( timeMs - seconds * 1000 );
+}
+
+uint64_t SysTimeTicksToMs( SysTimeTicks_t ticks )
+{
+    return ( ticks >> SYS_TIME_TICKS_FRAC_BITS ) * 1000 +
+           ( ( ( ticks & SYS_TIME_TICKS_SUB_SECONDS_MASK ) * 1000 ) >> SYS_TIME_TICKS_FRAC_BITS );
+}
+
+SysTimeTicks_t SysTimeTicksFromGps( uint32_t gpsSeconds )
+{
+    return ( ( SysTimeTicks_t )gpsSeconds + UNIX_GPS_EPOCH_OFFSET ) << SYS_TIME_TICKS_FRAC_BITS;
+}
+
+uint32_t SysTimeTicksToGps( SysTimeTicks_t ticks )
+{
+    return ( uint32_t )( ticks >> SYS_TIME_TICKS_FRAC_BITS ) - UNIX_GPS_EPOCH_OFFSET;
+}
+
+SysTimeTicks_t SysTimeTicksNextGpsPeriod( SysTimeTicks_t ticks, uint32_t period )
+{
+    SysTimeTicks_t gpsEpoch = ( SysTimeTicks_t )UNIX_GPS_EPOCH_OFFSET << SYS_TIME_TICKS_FRAC_BITS;
+    SysTimeTicks_t periodMask = ( ( SysTimeTicks_t )period << SYS_TIME_TICKS_FRAC_BITS ) - 1;
+
+    return ( ( ( ticks - gpsEpoch ) | periodMask ) + 1 + gpsEpoch ) & SYS_TIME_TICKS_MASK;
+}
+
 SysTime_t SysTimeAdd( SysTime_t a, SysTime_t b )
 {
     SysTime_t c =  { .Seconds = 0, .SubSeconds = 0 };
@@ -103,31 +262,42 @@ SysTime_t SysTimeSub( SysTime_t a, SysTime_t b )
 
 void SysTimeSet( SysTime_t sysTime )
 {
-    SysTime_t deltaTime;
-  
-    SysTime_t calendarTime = { .Seconds = 0, .SubSeconds = 0 };
+    SysTimeSetTicks( SysTimeTicksFromSysTime( sysTime ) );
+}
 
-    calendarTime.Seconds = RtcGetCalendarTime( ( uint16_t* )&calendarTime.SubSeconds );
+void SysTimeSetDrift( int32_t drift )
+{
+    // Keeps the current time continuous across the rate change
+    SysTimeTicks_t ticks = SysTimeGetTicks( );
+    uint32_t syncSeconds = SysTimeSyncSeconds;
+    bool syncValid = SysTimeSyncValid;
+
+    SysTimeDrift = drift;
+    SysTimeDriftScaled = ( ( int64_t )drift << SYS_TIME_DRIFT_FRAC_BITS ) / 1000000;
+    SysTimeSetTicks( ticks );
+
+    // The system time isn't synchronized again
+    SysTimeSyncSeconds = syncSeconds;
+    SysTimeSyncValid = syncValid;
+}
 
-    // sysTime is epoch
-    deltaTime = SysTimeSub( sysTime, calendarTime );
+int32_t SysTimeGetDrift( void )
+{
+    return SysTimeDrift;
+}
 
-    RtcBkupWrite( deltaTime.Seconds, ( uint32_t )deltaTime.SubSeconds );
+uint32_t SysTimeGetSyncAge( void )
+{
+    if( SysTimeSyncValid == false )
+    {
+        return UINT32_MAX;
+    }
+    return ( uint32_t )( SysTimeGetMcuTicks( ) >> SYS_TIME_TICKS_FRAC_BITS ) - SysTimeSyncSeconds;
 }
 
 SysTime_t SysTimeGet( void )
 {
-    SysTime_t calendarTime = { .Seconds = 0, .SubSeconds = 0 };
-    SysTime_t sysTime = { .Seconds = 0, .SubSeconds = 0 };
-    SysTime_t deltaTime;
-
-    calendarTime.Seconds = RtcGetCalendarTime( ( uint16_t* )&calendarTime.SubSeconds );
-
-    RtcBkupRead( &deltaTime.Seconds, ( uint32_t* )&deltaTime.SubSeconds );
-
-    sysTime = SysTimeAdd( deltaTime, calendarTime );
-
-    return sysTime;
+    return SysTimeTicksToSysTime( SysTimeGetTicks( ) );
 }
 
 SysTime_t SysTimeGetMcuTime( void )
@@ -141,20 +311,19 @@ SysTime_t SysTimeGetMcuTime( void )
 
 uint32_t SysTimeToMs( SysTime_t sysTime )
 {
-    SysTime_t deltaTime;
-    RtcBkupRead( &deltaTime.Seconds, ( uint32_t* )&deltaTime.SubSeconds );
-    SysTime_t calendarTime = SysTimeSub( sysTime, deltaTime );
-    return calendarTime.Seconds * 1000 + calendarTime.SubSeconds;
+    SysTimeTicks_t mcuTicks = ( SysTimeTicksFromSysTime( sysTime ) - SysTimeGetOffsetTicks( ) ) & SYS_TIME_TICKS_MASK;
+
+    // The compensation is evaluated on the uncompensated time, the error is
+    // negligible for the supported drifts
+    mcuTicks -= SysTimeGetDriftCompensation( mcuTicks );
+    return ( uint32_t )SysTimeTicksToMs( mcuTicks );
 }
 
 SysTime_t SysTimeFromMs( uint32_t timeMs )
 {
-    uint32_t seconds = timeMs / 1000;
-    SysTime_t sysTime = { .Seconds = seconds, .SubSeconds =  timeMs - seconds * 1000 };
-    SysTime_t deltaTime = { 0 };
-    RtcBkupRead( &deltaTime.Seconds, ( uint32_t* )&deltaTime.SubSeconds );
+    SysTimeTicks_t mcuTicks = SysTimeTicksFromMs( timeMs );
 
-    return SysTimeAdd( sysTime, deltaTime );
+    return SysTimeTicksToSysTime( ( mcuTicks + SysTimeGetOffsetTicks( ) + SysTimeGetDriftCompensation( mcuTicks ) ) & SYS_TIME_TICKS_MASK );
 }
 
 uint32_t SysTimeMkTime( const struct tm* localtime )
@@ -85,6 +85,31 @@ typedef struct SysTime_s
     int16_t  SubSeconds;
 }SysTime_t;
 
+/*!
+ * \brief Number of fractional bits of the system time ticks
+ */
+#define SYS_TIME_TICKS_FRAC_BITS                    10
+
+/*!
+ * \brief Mask of the sub-seconds part of the system time ticks
+ */
+#define SYS_TIME_TICKS_SUB_SECONDS_MASK             ( ( 1ULL << SYS_TIME_TICKS_FRAC_BITS ) - 1 )
+
+/*!
+ * \brief Mask of the system time ticks. The seconds wrap around 32 bits like
+ *        the SysTime_t ones.
+ */
+#define SYS_TIME_TICKS_MASK                         ( ( 1ULL << ( 32 + SYS_TIME_TICKS_FRAC_BITS ) ) - 1 )
+
+/*!
+ * \brief System time as 1/1024 s ticks since UNIX epoch origin.
+ *
+ * \remark The RTCs count 1/1024 s ticks, the ticks are added, subtracted and
+ *         compared as plain integers and converted without division. Use
+ *         ( a - b ) & SYS_TIME_TICKS_MASK for the differences.
+ */
+typedef uint64_t SysTimeTicks_t;
+
 /*!
  * \brief Adds 2 SysTime_t values
  *
@@ -119,6 +144,37 @@ void SysTimeSet( SysTime_t sysTime );
  */
 SysTime_t SysTimeGet( void );
 
+/*!
+ * \brief Sets the RTC frequency error compensated by the system time
+ *
+ * \remark The system time is slewed continuously by drift microseconds per
+ *         elapsed second from the last \ref SysTimeSet call. The current
+ *         system time is kept. The value is lost on MCU reset.
+ *
+ * \param [IN] drift RTC frequency error [ppm]. Positive when the RTC runs
+ *                   slow.
+ */
+void SysTimeSetDrift( int32_t drift );
+
+/*!
+ * \brief Gets the RTC frequency error compensated by the system time
+ *
+ * \retval drift RTC frequency error [ppm]
+ */
+int32_t SysTimeGetDrift( void );
+
+/*!
+ * \brief Gets the time elapsed since the last system time synchronization
+ *
+ * \remark Only the \ref SysTimeSet calls synchronize the system time, the
+ *         drift updates keep the synchronization. The value is lost on MCU
+ *         reset.
+ *
+ * \retval age Elapsed time [s]. UINT32_MAX if the system time has never been
+ *             set.
+ */
+uint32_t SysTimeGetSyncAge( void );
+
 /*!
  * \brief Gets current MCU system time
  *
@@ -144,6 +200,92 @@ uint32_t SysTimeToMs( SysTime_t sysTime );
  */
 SysTime_t SysTimeFromMs( uint32_t timeMs );
 
+/*!
+ * \brief Gets current system time
+ *
+ * \retval ticks Current ticks since UNIX epoch origin
+ */
+SysTimeTicks_t SysTimeGetTicks( void );
+
+/*!
+ * \brief Sets new system time
+ *
+ * \param [IN] ticks New ticks since UNIX epoch origin
+ */
+void SysTimeSetTicks( SysTimeTicks_t ticks );
+
+/*!
+ * \brief Gets current MCU system time
+ *
+ * \retval ticks Current ticks since Mcu started
+ */
+SysTimeTicks_t SysTimeGetMcuTicks( void );
+
+/*!
+ * \brief Converts a SysTime_t value into ticks
+ *
+ * \param [IN] sysTime Time to be converted
+ *
+ * \retval ticks Converted time. The milliseconds round trip exactly.
+ */
+SysTimeTicks_t SysTimeTicksFromSysTime( SysTime_t sysTime );
+
+/*!
+ * \brief Converts ticks into a SysTime_t value
+ *
+ * \param [IN] ticks Time to be converted
+ *
+ * \retval sysTime Converted time, the sub-seconds are rounded down
+ */
+SysTime_t SysTimeTicksToSysTime( SysTimeTicks_t ticks );
+
+/*!
+ * \brief Converts a duration in milliseconds into ticks
+ *
+ * \param [IN] timeMs Duration to be converted [ms]
+ *
+ * \retval ticks Converted duration
+ */
+SysTimeTicks_t SysTimeTicksFromMs( uint32_t timeMs );
+
+/*!
+ * \brief Converts ticks into milliseconds
+ *
+ * \param [IN] ticks Time to be converted
+ *
+ * \retval timeMs Converted time [ms], rounded down
+ */
+uint64_t SysTimeTicksToMs( SysTimeTicks_t ticks );
+
+/*!
+ * \brief Converts a GPS time into ticks since UNIX epoch origin
+ *
+ * \param [IN] gpsSeconds Seconds since GPS epoch origin
+ *
+ * \retval ticks Converted time
+ */
+SysTimeTicks_t SysTimeTicksFromGps( uint32_t gpsSeconds );
+
+/*!
+ * \brief Converts ticks since UNIX epoch origin into a GPS time
+ *
+ * \param [IN] ticks Time to be converted
+ *
+ * \retval gpsSeconds Seconds since GPS epoch origin, rounded down
+ */
+uint32_t SysTimeTicksToGps( SysTimeTicks_t ticks );
+
+/*!
+ * \brief Gets the next start of a GPS time period, like the class B beacon
+ *        periods
+ *
+ * \param [IN] ticks  Time since UNIX epoch origin
+ * \param [IN] period Period [s], a power of 2
+ *
+ * \retval ticks Start of the period following the given time
+ */
+SysTimeTicks_t SysTimeTicksNextGpsPeriod( SysTimeTicks_t ticks, uint32_t period );
+
 /*!
  * \brief Convert a calendar time into time since UNIX epoch as a uint32_t.
  *
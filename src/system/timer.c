@@ -23,6 +23,7 @@
 #include "utilities.h"
 #include "board.h"
 #include "rtc-board.h"
+#include "trace.h"
 #include "timer.h"
 
 /*!
@@ -41,6 +42,66 @@
         }                                      \
     }while( 0 );
 
+#if defined( TIMER_HEAP_ENABLED )
+/*!
+ * Maximum number of simultaneously running timers
+ */
+#ifndef TIMER_HEAP_MAX_TIMERS
+#define TIMER_HEAP_MAX_TIMERS                       32
+#endif
+
+/*!
+ * Binary min-heap of running timers ordered by absolute expiry tick.
+ * TimerHeap[0] always contains the next timer to expire.
+ */
+static TimerEvent_t *TimerHeap[TIMER_HEAP_MAX_TIMERS];
+
+/*!
+ * Number of timers currently stored in the heap
+ */
+static uint8_t TimerHeapCount = 0;
+
+/*!
+ * \brief Compares 2 absolute expiry ticks taking the RTC wrap around into account
+ *
+ * \retval true if a expires before b
+ */
+#define TIMER_HEAP_BEFORE( a, b )                   ( ( int32_t )( ( a ) - ( b ) ) < 0 )
+
+/*!
+ * \brief Moves the heap entry at index up until the heap property is restored
+ *
+ * \param [IN] index Heap index of the entry to be moved
+ */
+static void TimerHeapSiftUp( uint8_t index );
+
+/*!
+ * \brief Moves the heap entry at index down until the heap property is restored
+ *
+ * \param [IN] index Heap index of the entry to be moved
+ */
+static void TimerHeapSiftDown( uint8_t index );
+
+/*!
+ * \brief Removes the heap entry at index
+ *
+ * \param [IN] index Heap index of the entry to be removed
+ */
+static void TimerHeapRemove( uint8_t index );
+
+/*!
+ * \brief Gets the latest expiry the alarm can be delayed to, the earliest
+ *        expiry plus slack of the timers in the subtree at index
+ *
+ * \remark The subtrees expiring after the deadline can't bring it forward and
+ *         are skipped.
+ *
+ * \param [IN] index    Heap index of the subtree root
+ * \param [IN] deadline Deadline found so far
+ * \retval deadline     Alarm deadline in absolute ticks
+ */
+static uint32_t TimerHeapGetDeadline( uint8_t index, uint32_t deadline );
+#else
 /*!
  * Timers list head pointer
  */
@@ -68,6 +129,53 @@ static void TimerInsertNewHeadTimer( TimerEvent_t *obj );
  */
 static void TimerInsertTimer( TimerEvent_t *obj );
 
+/*!
+ * \brief Gets the latest expiry the alarm can be delayed to, the earliest
+ *        expiry plus slack of the timers from obj on
+ *
+ * \param [IN] obj   First timer of the list to consider
+ * \retval deadline  Alarm deadline relative to the timer context
+ */
+static uint32_t TimerListGetDeadline( TimerEvent_t *obj );
+#endif
+
+/*!
+ * Queue of the deferred callbacks waiting for TimerProcess, oldest first
+ */
+static TimerEvent_t *TimerPendingHead = NULL;
+static TimerEvent_t *TimerPendingTail = NULL;
+
+/*!
+ * Sequence number given to the next queued deferred callback
+ */
+static uint16_t TimerPendingSeq = 0;
+
+/*!
+ * Main loop notification of a queued deferred callback
+ */
+static void ( *TimerProcessNotify )( void ) = NULL;
+
+/*!
+ * \brief Runs the callback of an expired timer, or queues it when deferred
+ *
+ * \param [IN] obj Expired timer
+ */
+static void TimerExpire( TimerEvent_t *obj );
+
+/*!
+ * \brief Drops the queued callback of a timer
+ *
+ * \param [IN] obj Timer object
+ */
+static void TimerCancelPending( TimerEvent_t *obj );
+
+/*!
+ * Deadline of the programmed alarm, later than the next timer expiry when the
+ * timers have some slack. In absolute ticks with TIMER_HEAP_ENABLED, relative
+ * to the timer context otherwise.
+ */
+static uint32_t TimerAlarmDeadline = 0;
+
 /*!
  * \brief Sets a timeout with the duration "timestamp"
  *
@@ -87,11 +195,17 @@ void TimerInit( TimerEvent_t *obj, void ( *callback )( void *context ) )
 {
     obj->Timestamp = 0;
     obj->ReloadValue = 0;
+    obj->Slack = 0;
     obj->IsStarted = false;
     obj->IsNext2Expire = false;
+    obj->IsDeferred = false;
+    obj->IsPending = false;
+    obj->HeapIndex = 0;
+    obj->PendingSeq = 0;
     obj->Callback = callback;
     obj->Context = NULL;
     obj->Next = NULL;
+    obj->NextPending = NULL;
 }
 
 void TimerSetContext( TimerEvent_t *obj, void* context )
@@ -99,6 +213,233 @@ void TimerSetContext( TimerEvent_t *obj, void* context )
     obj->Context = context;
 }
 
+#if defined( TIMER_HEAP_ENABLED )
+void TimerStart( TimerEvent_t *obj )
+{
+    TimerEvent_t* head = NULL;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    if( ( obj == NULL ) || ( TimerExists( obj ) == true ) )
+    {
+        CRITICAL_SECTION_END( );
+        return;
+    }
+
+    if( TimerHeapCount >= TIMER_HEAP_MAX_TIMERS )
+    {
+        // Heap capacity exceeded. Increase TIMER_HEAP_MAX_TIMERS
+        while( 1 );
+    }
+
+    head = ( TimerHeapCount > 0 ) ? TimerHeap[0] : NULL;
+
+    // Timers are stored using absolute RTC ticks
+    obj->Timestamp = RtcGetTimerValue( ) + obj->ReloadValue;
+    obj->IsStarted = true;
+    obj->IsNext2Expire = false;
+
+    obj->HeapIndex = TimerHeapCount;
+    TimerHeap[TimerHeapCount++] = obj;
+    TimerHeapSiftUp( obj->HeapIndex );
+
+    if( TimerHeap[0] == obj )
+    {
+        // New timer expires first. Re-program the alarm
+        if( head != NULL )
+        {
+            head->IsNext2Expire = false;
+        }
+        TimerSetTimeout( obj );
+    }
+    else if( ( TimerHeap[0]->IsNext2Expire == true ) &&
+             ( TIMER_HEAP_BEFORE( obj->Timestamp + obj->Slack, TimerAlarmDeadline ) == true ) )
+    {
+        // New timer can't wait for the delayed alarm. Bring it forward
+        TimerSetTimeout( TimerHeap[0] );
+    }
+    CRITICAL_SECTION_END( );
+}
+
+bool TimerIsStarted( TimerEvent_t *obj )
+{
+    return obj->IsStarted;
+}
+
+LORAMAC_HOT void TimerIrqHandler( void )
+{
+    TimerEvent_t* cur;
+
+    TRACE_BEGIN( TRACE_PROBE_TIMER_IRQ );
+
+    // Execute immediately the alarm callback
+    if( TimerHeapCount > 0 )
+    {
+        cur = TimerHeap[0];
+        TimerHeapRemove( 0 );
+        cur->IsStarted = false;
+        cur->IsNext2Expire = false;
+        TimerExpire( cur );
+    }
+
+    // Remove all the expired object from the heap
+    while( ( TimerHeapCount > 0 ) && ( TIMER_HEAP_BEFORE( RtcGetTimerValue( ), TimerHeap[0]->Timestamp ) == false ) )
+    {
+        cur = TimerHeap[0];
+        TimerHeapRemove( 0 );
+        cur->IsStarted = false;
+        cur->IsNext2Expire = false;
+        TimerExpire( cur );
+    }
+
+    // Start the next heap root if it exists AND NOT running
+    if( ( TimerHeapCount > 0 ) && ( TimerHeap[0]->IsNext2Expire == false ) )
+    {
+        TimerSetTimeout( TimerHeap[0] );
+    }
+
+    TRACE_END( TRACE_PROBE_TIMER_IRQ );
+}
+
+void TimerStop( TimerEvent_t *obj )
+{
+    CRITICAL_SECTION_BEGIN( );
+
+    TimerCancelPending( obj );
+
+    // Heap is empty or the obj to stop does not exist
+    if( ( obj == NULL ) || ( TimerExists( obj ) == false ) )
+    {
+        if( obj != NULL )
+        {
+            obj->IsStarted = false;
+        }
+        CRITICAL_SECTION_END( );
+        return;
+    }
+
+    obj->IsStarted = false;
+
+    if( obj->HeapIndex == 0 ) // Stop the root
+    {
+        TimerHeapRemove( 0 );
+        if( obj->IsNext2Expire == true ) // The root is already running
+        {
+            obj->IsNext2Expire = false;
+            if( TimerHeapCount > 0 )
+            {
+                TimerSetTimeout( TimerHeap[0] );
+            }
+            else
+            {
+                RtcStopAlarm( );
+            }
+        }
+    }
+    else // Stop an object within the heap
+    {
+        TimerHeapRemove( obj->HeapIndex );
+    }
+    CRITICAL_SECTION_END( );
+}
+
+static bool TimerExists( TimerEvent_t *obj )
+{
+    return ( obj->HeapIndex < TimerHeapCount ) && ( TimerHeap[obj->HeapIndex] == obj );
+}
+
+static void TimerHeapSiftUp( uint8_t index )
+{
+    TimerEvent_t* obj = TimerHeap[index];
+
+    while( index > 0 )
+    {
+        uint8_t parent = ( index - 1 ) >> 1;
+
+        if( TIMER_HEAP_BEFORE( obj->Timestamp, TimerHeap[parent]->Timestamp ) == false )
+        {
+            break;
+        }
+        TimerHeap[index] = TimerHeap[parent];
+        TimerHeap[index]->HeapIndex = index;
+        index = parent;
+    }
+    TimerHeap[index] = obj;
+    obj->HeapIndex = index;
+}
+
+static void TimerHeapSiftDown( uint8_t index )
+{
+    TimerEvent_t* obj = TimerHeap[index];
+
+    while( true )
+    {
+        uint8_t child = ( index << 1 ) + 1;
+
+        if( child >= TimerHeapCount )
+        {
+            break;
+        }
+        if( ( ( child + 1 ) < TimerHeapCount ) &&
+            ( TIMER_HEAP_BEFORE( TimerHeap[child + 1]->Timestamp, TimerHeap[child]->Timestamp ) == true ) )
+        {
+            child++;
+        }
+        if( TIMER_HEAP_BEFORE( TimerHeap[child]->Timestamp, obj->Timestamp ) == false )
+        {
+            break;
+        }
+        TimerHeap[index] = TimerHeap[child];
+        TimerHeap[index]->HeapIndex = index;
+        index = child;
+    }
+    TimerHeap[index] = obj;
+    obj->HeapIndex = index;
+}
+
+static void TimerHeapRemove( uint8_t index )
+{
+    TimerEvent_t* last = TimerHeap[--TimerHeapCount];
+
+    if( index == TimerHeapCount )
+    {
+        // Last entry removed. Nothing to re-order
+        return;
+    }
+    TimerHeap[index] = last;
+    last->HeapIndex = index;
+    if( ( index > 0 ) && ( TIMER_HEAP_BEFORE( last->Timestamp, TimerHeap[( index - 1 ) >> 1]->Timestamp ) == true ) )
+    {
+        TimerHeapSiftUp( index );
+    }
+    else
+    {
+        TimerHeapSiftDown( index );
+    }
+}
+
+static uint32_t TimerHeapGetDeadline( uint8_t index, uint32_t deadline )
+{
+    TimerEvent_t* obj;
+
+    if( index >= TimerHeapCount )
+    {
+        return deadline;
+    }
+    obj = TimerHeap[index];
+    if( TIMER_HEAP_BEFORE( deadline, obj->Timestamp ) == true )
+    {
+        // The whole subtree expires after the deadline
+        return deadline;
+    }
+    if( TIMER_HEAP_BEFORE( obj->Timestamp + obj->Slack, deadline ) == true )
+    {
+        deadline = obj->Timestamp + obj->Slack;
+    }
+    deadline = TimerHeapGetDeadline( ( index << 1 ) + 1, deadline );
+    return TimerHeapGetDeadline( ( index << 1 ) + 2, deadline );
+}
+#else
 void TimerStart( TimerEvent_t *obj )
 {
     uint32_t elapsedTime = 0;
@@ -133,6 +474,13 @@ void TimerStart( TimerEvent_t *obj )
         else
         {
             TimerInsertTimer( obj );
+
+            if( ( TimerListHead->IsNext2Expire == true ) &&
+                ( ( obj->Timestamp + obj->Slack ) < TimerAlarmDeadline ) )
+            {
+                // New timer can't wait for the delayed alarm. Bring it forward
+                TimerSetTimeout( TimerListHead );
+            }
         }
     }
     CRITICAL_SECTION_END( );
@@ -180,11 +528,13 @@ bool TimerIsStarted( TimerEvent_t *obj )
     return obj->IsStarted;
 }
 
-void TimerIrqHandler( void )
+LORAMAC_HOT void TimerIrqHandler( void )
 {
     TimerEvent_t* cur;
     TimerEvent_t* next;
 
+    TRACE_BEGIN( TRACE_PROBE_TIMER_IRQ );
+
     uint32_t old =  RtcGetTimerContext( );
     uint32_t now =  RtcSetTimerContext( );
     uint32_t deltaContext = now - old; // intentional wrap around
@@ -213,7 +563,7 @@ void TimerIrqHandler( void )
         cur = TimerListHead;
         TimerListHead = TimerListHead->Next;
         cur->IsStarted = false;
-        ExecuteCallBack( cur->Callback, cur->Context );
+        TimerExpire( cur );
     }
 
     // Remove all the expired object from the list
@@ -222,7 +572,7 @@ void TimerIrqHandler( void )
         cur = TimerListHead;
         TimerListHead = TimerListHead->Next;
         cur->IsStarted = false;
-        ExecuteCallBack( cur->Callback, cur->Context );
+        TimerExpire( cur );
     }
 
     // Start the next TimerListHead if it exists AND NOT running
@@ -230,6 +580,8 @@ void TimerIrqHandler( void )
     {
         TimerSetTimeout( TimerListHead );
     }
+
+    TRACE_END( TRACE_PROBE_TIMER_IRQ );
 }
 
 void TimerStop( TimerEvent_t *obj )
@@ -239,6 +591,8 @@ void TimerStop( TimerEvent_t *obj )
     TimerEvent_t* prev = TimerListHead;
     TimerEvent_t* cur = TimerListHead;
 
+    TimerCancelPending( obj );
+
     // List is empty or the obj to stop does not exist
     if( ( TimerListHead == NULL ) || ( obj == NULL ) )
     {
@@ -304,6 +658,18 @@ void TimerStop( TimerEvent_t *obj )
     CRITICAL_SECTION_END( );
 }
 
+static uint32_t TimerListGetDeadline( TimerEvent_t *obj )
+{
+    uint32_t deadline = obj->Timestamp + obj->Slack;
+
+    // The list is sorted, the timers expiring after the deadline can't bring it forward
+    for( TimerEvent_t* cur = obj->Next; ( cur != NULL ) && ( cur->Timestamp < deadline ); cur = cur->Next )
+    {
+        deadline = MIN( deadline, cur->Timestamp + cur->Slack );
+    }
+    return deadline;
+}
+
 static bool TimerExists( TimerEvent_t *obj )
 {
     TimerEvent_t* cur = TimerListHead;
@@ -318,6 +684,96 @@ static bool TimerExists( TimerEvent_t *obj )
     }
     return false;
 }
+#endif
+
+static void TimerExpire( TimerEvent_t *obj )
+{
+    if( obj->IsDeferred == false )
+    {
+        ExecuteCallBack( obj->Callback, obj->Context );
+        return;
+    }
+    if( obj->IsPending == true )
+    {
+        // Already queued
+        return;
+    }
+
+    obj->IsPending = true;
+    obj->PendingSeq = TimerPendingSeq++;
+    obj->NextPending = NULL;
+    if( TimerPendingTail != NULL )
+    {
+        TimerPendingTail->NextPending = obj;
+    }
+    else
+    {
+        TimerPendingHead = obj;
+    }
+    TimerPendingTail = obj;
+
+    if( TimerProcessNotify != NULL )
+    {
+        TimerProcessNotify( );
+    }
+}
+
+static void TimerCancelPending( TimerEvent_t *obj )
+{
+    TimerEvent_t* prev = NULL;
+    TimerEvent_t* cur = TimerPendingHead;
+
+    if( ( obj == NULL ) || ( obj->IsPending == false ) )
+    {
+        return;
+    }
+    while( ( cur != NULL ) && ( cur != obj ) )
+    {
+        prev = cur;
+        cur = cur->NextPending;
+    }
+    if( cur == NULL )
+    {
+        obj->IsPending = false;
+        return;
+    }
+
+    if( prev != NULL )
+    {
+        prev->NextPending = obj->NextPending;
+    }
+    else
+    {
+        TimerPendingHead = obj->NextPending;
+    }
+    if( TimerPendingTail == obj )
+    {
+        TimerPendingTail = prev;
+    }
+    obj->NextPending = NULL;
+    obj->IsPending = false;
+}
+
+void TimerSetDeferred( TimerEvent_t *obj, bool deferred )
+{
+    CRITICAL_SECTION_BEGIN( );
+    obj->IsDeferred = deferred;
+    if( deferred == false )
+    {
+        TimerCancelPending( obj );
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void TimerSetProcessNotify( void ( *notify )( void ) )
+{
+    TimerProcessNotify = notify;
+}
+
+bool TimerHasPendingEvents( void )
+{
+    return TimerPendingHead != NULL;
+}
 
 void TimerReset( TimerEvent_t *obj )
 {
@@ -325,10 +781,15 @@ void TimerReset( TimerEvent_t *obj )
     TimerStart( obj );
 }
 
-void TimerSetValue( TimerEvent_t *obj, uint32_t value )
+/*!
+ * \brief Sets the timer timeout value in RTC ticks
+ *
+ * \param [IN] obj   Structure containing the timer object parameters
+ * \param [IN] ticks New timer timeout value in RTC ticks
+ */
+static void TimerSetValueTicks( TimerEvent_t *obj, uint32_t ticks )
 {
     uint32_t minValue = 0;
-    uint32_t ticks = RtcMs2Tick( value );
 
     TimerStop( obj );
 
@@ -343,12 +804,44 @@ void TimerSetValue( TimerEvent_t *obj, uint32_t value )
     obj->ReloadValue = ticks;
 }
 
+void TimerSetValue( TimerEvent_t *obj, uint32_t value )
+{
+    TimerSetValueTicks( obj, RtcMs2Tick( value ) );
+}
+
+void TimerSetSlack( TimerEvent_t *obj, uint32_t slack )
+{
+    // Applies from the next start
+    obj->Slack = RtcMs2Tick( slack );
+}
+
+void TimerStartTicks( TimerEvent_t *obj, uint32_t ticks )
+{
+    TimerSetValueTicks( obj, ticks );
+    TimerStart( obj );
+}
+
 TimerTime_t TimerGetCurrentTime( void )
 {
     uint32_t now = RtcGetTimerValue( );
     return  RtcTick2Ms( now );
 }
 
+uint32_t TimerGetCurrentTicks( void )
+{
+    return RtcGetTimerValue( );
+}
+
+uint32_t TimerUs2Ticks( uint32_t us )
+{
+    return RtcUs2Tick( us );
+}
+
+uint32_t TimerTicks2Us( uint32_t ticks )
+{
+    return RtcTick2Us( ticks );
+}
+
 TimerTime_t TimerGetElapsedTime( TimerTime_t past )
 {
     if ( past == 0 )
@@ -362,6 +855,41 @@ TimerTime_t TimerGetElapsedTime( TimerTime_t past )
     return RtcTick2Ms( nowInTicks - pastInTicks );
 }
 
+TimerTime_t TimerGetElapsedTimeAt( TimerTime_t past, TimerTime_t now )
+{
+    if ( past == 0 )
+    {
+        return 0;
+    }
+    uint32_t nowInTicks = RtcMs2Tick( now );
+    uint32_t pastInTicks = RtcMs2Tick( past );
+
+    // Intentional wrap around. Works Ok if tick duration below 1ms
+    return RtcTick2Ms( nowInTicks - pastInTicks );
+}
+
+#if defined( TIMER_HEAP_ENABLED )
+static void TimerSetTimeout( TimerEvent_t *obj )
+{
+    uint32_t now = RtcSetTimerContext( );
+    uint32_t minTicks = RtcGetMinimumTimeout( );
+    uint32_t timeout = 0;
+
+    obj->IsNext2Expire = true;
+
+    // Delay the alarm within the slack of the timers to serve them together
+    TimerAlarmDeadline = TimerHeapGetDeadline( 0, obj->Timestamp + obj->Slack );
+    timeout = TimerAlarmDeadline - now;
+
+    // In case deadline too soon or already elapsed
+    if( ( int32_t )timeout < ( int32_t )minTicks )
+    {
+        timeout = minTicks;
+    }
+    // The alarm is relative to the timer context which has just been set to now
+    RtcSetAlarm( timeout );
+}
+#else
 static void TimerSetTimeout( TimerEvent_t *obj )
 {
     int32_t minTicks= RtcGetMinimumTimeout( );
@@ -372,8 +900,11 @@ static void TimerSetTimeout( TimerEvent_t *obj )
     {
         obj->Timestamp = RtcGetTimerElapsedTime( ) + minTicks;
     }
-    RtcSetAlarm( obj->Timestamp );
+    // Delay the alarm within the slack of the timers to serve them together
+    TimerAlarmDeadline = TimerListGetDeadline( obj );
+    RtcSetAlarm( TimerAlarmDeadline );
 }
+#endif
 
 TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature )
 {
@@ -382,5 +913,35 @@ TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature )
 
 void TimerProcess( void )
 {
+    TimerEvent_t* cur;
+
     RtcProcess( );
+
+    // Only the callbacks queued so far are run, the ones queued meanwhile
+    // wait for the next call. The queue is sorted by sequence number and a
+    // callback may remove any entry by stopping its timer.
+    CRITICAL_SECTION_BEGIN( );
+    uint16_t endSeq = TimerPendingSeq;
+    CRITICAL_SECTION_END( );
+
+    while( true )
+    {
+        CRITICAL_SECTION_BEGIN( );
+        cur = TimerPendingHead;
+        if( ( cur == NULL ) || ( ( int16_t )( cur->PendingSeq - endSeq ) >= 0 ) )
+        {
+            CRITICAL_SECTION_END( );
+            break;
+        }
+        TimerPendingHead = cur->NextPending;
+        if( TimerPendingHead == NULL )
+        {
+            TimerPendingTail = NULL;
+        }
+        cur->NextPending = NULL;
+        cur->IsPending = false;
+        CRITICAL_SECTION_END( );
+
+        ExecuteCallBack( cur->Callback, cur->Context );
+    }
 }
@@ -29,16 +29,27 @@
 
 /*!
  * \brief Timer object description
+ *
+ * \remark When TIMER_HEAP_ENABLED is defined the timers are kept in a binary
+ *         min-heap and Timestamp holds the absolute RTC tick at which the timer
+ *         expires. Otherwise the timers are kept in a sorted linked list and
+ *         Timestamp is relative to the RTC timer context.
  */
 typedef struct TimerEvent_s
 {
     uint32_t Timestamp;                  //! Current timer value
     uint32_t ReloadValue;                //! Timer delay value
+    uint32_t Slack;                      //! Tolerated lateness of the expiry [ticks]
     bool IsStarted;                      //! Is the timer currently running
     bool IsNext2Expire;                  //! Is the next timer to expire
+    bool IsDeferred;                     //! Is the callback run by TimerProcess
+    bool IsPending;                      //! Is the deferred callback waiting for TimerProcess
+    uint8_t HeapIndex;                   //! Position in the timers heap ( TIMER_HEAP_ENABLED only )
+    uint16_t PendingSeq;                 //! Queuing order of the deferred callback
     void ( *Callback )( void* context ); //! Timer IRQ callback function
     void *Context;                       //! User defined data object pointer to pass back
     struct TimerEvent_s *Next;           //! Pointer to the next Timer object.
+    struct TimerEvent_s *NextPending;    //! Pointer to the next deferred callback to run
 }TimerEvent_t;
 
 /*!
@@ -112,6 +123,63 @@ void TimerReset( TimerEvent_t *obj );
  */
 void TimerSetValue( TimerEvent_t *obj, uint32_t value );
 
+/*!
+ * \brief Sets the lateness the timer tolerates
+ *
+ * \remark The alarm is delayed up to the earliest expiry plus slack of the
+ *         running timers, so that the timers expiring within each other's
+ *         slack are served by a single wake up. The slack defaults to 0, which
+ *         the timers needing an exact expiry, like the RX windows, must keep.
+ *
+ * \param [IN] obj   Structure containing the timer object parameters
+ * \param [IN] slack Tolerated lateness [ms]
+ */
+void TimerSetSlack( TimerEvent_t *obj, uint32_t slack );
+
+/*!
+ * \brief Selects the context the timer callback is run in
+ *
+ * \remark A deferred callback is queued by the timer interrupt and run by
+ *         \ref TimerProcess from the main loop, which keeps the interrupt
+ *         short for the timers expiring at the same time, like the RX
+ *         windows ones. Several expiries before \ref TimerProcess run the
+ *         callback once. Stopping the timer drops its queued callback.
+ *         The callbacks are run from the interrupt by default.
+ *
+ * \param [IN] obj      Structure containing the timer object parameters
+ * \param [IN] deferred Set to run the callback from \ref TimerProcess
+ */
+void TimerSetDeferred( TimerEvent_t *obj, bool deferred );
+
+/*!
+ * \brief Sets the function notifying the main loop that a deferred callback
+ *        is queued
+ *
+ * \remark Called from the timer interrupt, typically to keep the MCU out of
+ *         the low power modes until \ref TimerProcess is called.
+ *
+ * \param [IN] notify Notification function. May be NULL.
+ */
+void TimerSetProcessNotify( void ( *notify )( void ) );
+
+/*!
+ * \brief Indicates if deferred callbacks wait for \ref TimerProcess
+ *
+ * \retval pending
+ */
+bool TimerHasPendingEvents( void );
+
+/*!
+ * \brief Sets the timer timeout value in RTC ticks and starts the timer
+ *
+ * \remark Allows timeouts finer than the millisecond on the RTCs running
+ *         faster than 1 kHz.
+ *
+ * \param [IN] obj   Structure containing the timer object parameters
+ * \param [IN] ticks New timer timeout value in RTC ticks
+ */
+void TimerStartTicks( TimerEvent_t *obj, uint32_t ticks );
+
 /*!
  * \brief Read the current time
  *
@@ -119,6 +187,29 @@ void TimerSetValue( TimerEvent_t *obj, uint32_t value );
  */
 TimerTime_t TimerGetCurrentTime( void );
 
+/*!
+ * \brief Read the current time in RTC ticks
+ *
+ * \retval time returns current time in RTC ticks
+ */
+uint32_t TimerGetCurrentTicks( void );
+
+/*!
+ * \brief Converts a time in microseconds to RTC ticks
+ *
+ * \param [IN] us Time in microseconds
+ * \retval ticks  returns the time in RTC ticks, rounded down
+ */
+uint32_t TimerUs2Ticks( uint32_t us );
+
+/*!
+ * \brief Converts a time in RTC ticks to microseconds
+ *
+ * \param [IN] ticks Time in RTC ticks
+ * \retval us        returns the time in microseconds, rounded down
+ */
+uint32_t TimerTicks2Us( uint32_t ticks );
+
 /*!
  * \brief Return the Time elapsed since a fix moment in Time
  *
@@ -129,6 +220,21 @@ TimerTime_t TimerGetCurrentTime( void );
  */
 TimerTime_t TimerGetElapsedTime( TimerTime_t past );
 
+/*!
+ * \brief Return the Time elapsed between a fix moment in Time and a given
+ *        current time
+ *
+ * \remark Allows several elapsed times to be computed out of a single
+ *         \ref TimerGetCurrentTime call.
+ *
+ * \remark TimerGetElapsedTimeAt will return 0 for past argument 0.
+ *
+ * \param [IN] past         fix moment in Time
+ * \param [IN] now          current time as returned by \ref TimerGetCurrentTime
+ * \retval time             returns elapsed time
+ */
+TimerTime_t TimerGetElapsedTimeAt( TimerTime_t past, TimerTime_t now );
+
 /*!
  * \brief Computes the temperature compensation for a period of time on a
  *        specific temperature.
@@ -141,7 +247,7 @@ TimerTime_t TimerGetElapsedTime( TimerTime_t past );
 TimerTime_t TimerTempCompensation( TimerTime_t period, float temperature );
 
 /*!
- * \brief Processes pending timer events
+ * \brief Processes pending timer events and runs the deferred callbacks
  */
 void TimerProcess( void );
 
@@ -0,0 +1,100 @@
+/*!
+ * \file      trace.c
+ *
+ * \brief     Processing time probes of the stack hot paths
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utilities.h"
+#include "board.h"
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+/*!
+ * Counter values at the start of the on-going processings
+ */
+static uint32_t TraceStart[TRACE_PROBE_MAX];
+
+/*!
+ * Trace ring
+ */
+static TraceRecord_t TraceRing[TRACE_RING_SIZE];
+
+/*!
+ * Index of the next record to write
+ */
+static uint8_t TraceRingIndex = 0;
+
+/*!
+ * Number of records in the ring
+ */
+static uint8_t TraceRingCnt = 0;
+
+void TraceBegin( TraceProbeId_t id )
+{
+    TraceStart[id] = BoardGetCycleCounter( );
+}
+
+void TraceEnd( TraceProbeId_t id )
+{
+    uint32_t end = BoardGetCycleCounter( );
+
+    CRITICAL_SECTION_BEGIN( );
+    TraceRing[TraceRingIndex].Id = id;
+    TraceRing[TraceRingIndex].Start = TraceStart[id];
+    TraceRing[TraceRingIndex].Duration = end - TraceStart[id]; // intentional wrap around
+    TraceRingIndex = ( TraceRingIndex + 1 ) % TRACE_RING_SIZE;
+    if( TraceRingCnt < TRACE_RING_SIZE )
+    {
+        TraceRingCnt++;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+uint8_t TraceGetRecords( TraceRecord_t* records, uint8_t maxNb )
+{
+    uint8_t nbRecords = 0;
+
+    CRITICAL_SECTION_BEGIN( );
+    while( ( nbRecords < maxNb ) && ( TraceRingCnt > 0 ) )
+    {
+        records[nbRecords++] = TraceRing[( TraceRingIndex + TRACE_RING_SIZE - TraceRingCnt ) % TRACE_RING_SIZE];
+        TraceRingCnt--;
+    }
+    CRITICAL_SECTION_END( );
+    return nbRecords;
+}
+
+#else
+
+void TraceBegin( TraceProbeId_t id )
+{
+}
+
+void TraceEnd( TraceProbeId_t id )
+{
+}
+
+uint8_t TraceGetRecords( TraceRecord_t* records, uint8_t maxNb )
+{
+    return 0;
+}
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,146 @@
+/*!
+ * \file      trace.h
+ *
+ * \brief     Processing time probes of the stack hot paths
+ *
+ * \copyright Revised BSD License, see section \ref LICENSE.
+ *
+ * \code
+ *                ______                              _
+ *               / _____)             _              | |
+ *              ( (____  _____ ____ _| |_ _____  ____| |__
+ *               \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ *               _____) ) ____| | | || |_| ____( (___| | | |
+ *              (______/|_____)_|_|_| \__)_____)\____)_| |_|
+ *              (C)2013-2019 Semtech
+ *
+ * \endcode
+ *
+ * \author    Miguel Luis ( Semtech )
+ *
+ * \remark    The probes are only active when TRACE_ENABLED is defined. The
+ *            \ref TRACE_BEGIN and \ref TRACE_END macros are empty otherwise.
+ *
+ *            The durations are counted by \ref BoardGetCycleCounter. They are
+ *            MCU cycles on the boards providing a cycle counter.
+ */
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*!
+ * Number of records kept by the trace ring. The oldest records are
+ * overwritten.
+ */
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE                             32
+#endif
+
+/*!
+ * Probed processing
+ */
+typedef enum eTraceProbeId
+{
+    /*!
+     * Radio RxDone event processing by the MAC
+     */
+    TRACE_PROBE_RADIO_RX_DONE = 0,
+    /*!
+     * Downlink frame MIC check and decryption
+     */
+    TRACE_PROBE_CRYPTO_UNSECURE,
+    /*!
+     * Uplink channel selection by the region
+     */
+    TRACE_PROBE_REGION_NEXT_CHANNEL,
+    /*!
+     * Expired timers processing
+     */
+    TRACE_PROBE_TIMER_IRQ,
+    /*!
+     * Fragment processing by the fragmentation decoder
+     */
+    TRACE_PROBE_FRAG_DECODER_PROCESS,
+    /*!
+     * MAC initialization, boot phase
+     */
+    TRACE_PROBE_MAC_INIT,
+    /*!
+     * Radio initialization and random seed, part of the MAC initialization
+     */
+    TRACE_PROBE_MAC_INIT_RADIO,
+    /*!
+     * MAC contexts restoration, boot phase
+     */
+    TRACE_PROBE_NVM_CTX_RESTORE,
+    /*!
+     * Radio DIO0 ( RxDone / TxDone ) interrupt handling
+     */
+    TRACE_PROBE_RADIO_IRQ,
+    /*!
+     * Number of probes
+     */
+    TRACE_PROBE_MAX,
+}TraceProbeId_t;
+
+/*!
+ * Trace record
+ */
+typedef struct sTraceRecord
+{
+    /*!
+     * Probed processing
+     */
+    TraceProbeId_t Id;
+    /*!
+     * Counter value at the processing start
+     */
+    uint32_t Start;
+    /*!
+     * Processing duration
+     */
+    uint32_t Duration;
+}TraceRecord_t;
+
+#ifdef TRACE_ENABLED
+
+#define TRACE_BEGIN( id )                           TraceBegin( id )
+#define TRACE_END( id )                             TraceEnd( id )
+
+#else
+
+#define TRACE_BEGIN( id )                           do{ }while( 0 )
+#define TRACE_END( id )                             do{ }while( 0 )
+
+#endif
+
+/*!
+ * \brief Marks the start of a probed processing
+ *
+ * \remark Use \ref TRACE_BEGIN instead
+ *
+ * \param [IN] id Probed processing
+ */
+void TraceBegin( TraceProbeId_t id );
+
+/*!
+ * \brief Marks the end of a probed processing and records its duration
+ *
+ * \remark Use \ref TRACE_END instead
+ *
+ * \param [IN] id Probed processing
+ */
+void TraceEnd( TraceProbeId_t id );
+
+/*!
+ * \brief Removes the records from the trace ring, oldest first
+ *
+ * \param [OUT] records Records buffer
+ * \param [IN]  maxNb   Records buffer size
+ * \retval nbRecords    Number of records copied to the buffer
+ */
+uint8_t TraceGetRecords( TraceRecord_t* records, uint8_t maxNb );
+
+#endif // __TRACE_H__